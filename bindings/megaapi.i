@@ -298,6 +298,11 @@ extern "C" jint JNIEXPORT JNICALL JNI_OnLoad(JavaVM *jvm, void *reserved)
 	jenv->GetByteArrayRegion($input, 0, $2, (jbyte *)$1);
 	jenv->DeleteLocalRef($input);
 %}
+
+//Bulk accessors of lists (MegaNodeList::getHandles...) fill Java arrays in a single call
+%include "arrays_java.i"
+%apply long long[] {MegaHandle *handles, int64_t *sizes, int64_t *times, int64_t *bytes};
+%apply int[] {int *types, int *ends, int *tags, int *states};
 #endif
 
 #ifdef SWIGPHP
@@ -352,6 +357,7 @@ extern "C" jint JNIEXPORT JNICALL JNI_OnLoad(JavaVM *jvm, void *reserved)
 %newobject mega::MegaTransferList::copy;
 %newobject mega::MegaNode::copy;
 %newobject mega::MegaNodeList::copy;
+%newobject mega::MegaNodeChangeList::copy;
 %newobject mega::MegaChildrenList::copy;
 %newobject mega::MegaShare::copy;
 %newobject mega::MegaShareList::copy;
@@ -394,6 +400,7 @@ extern "C" jint JNIEXPORT JNICALL JNI_OnLoad(JavaVM *jvm, void *reserved)
 %newobject mega::MegaApi::getTransferData;
 %newobject mega::MegaApi::getChildTransfers;
 %newobject mega::MegaApi::getChildren;
+%newobject mega::MegaApi::getNodeChanges;
 %newobject mega::MegaApi::getChildNode;
 %newobject mega::MegaApi::getParentNode;
 %newobject mega::MegaApi::getNodePath;
@@ -34,6 +34,7 @@ else()
     check_symbol_exists(glob glob.h HAVE_GLOB_H)
 
     check_function_exists(aio_write, HAVE_AIO_RT)
+    check_include_file(linux/io_uring.h HAVE_LINUX_IO_URING_H)
 
     # Check if our toolchain supports TI emulation mode.
     try_compile(SUPPORTS_TI_EMULATION_MODE
@@ -30,7 +30,15 @@ else()
     endif()
 endif()
 option(ENABLE_LOG_PERFORMANCE "Faster log message generation" OFF)
+set(LOG_MAX_LEVEL "max" CACHE STRING "Most detailed log messages compiled in: fatal, error, warning, info, debug or max")
+set(SYNC_LOG_MAX_LEVEL "max" CACHE STRING "Most detailed log messages of the sync engine compiled in, within LOG_MAX_LEVEL")
+set(TRANSFER_LOG_MAX_LEVEL "max" CACHE STRING "Most detailed log messages of transfers compiled in, within LOG_MAX_LEVEL")
+set(JSON_LOG_MAX_LEVEL "max" CACHE STRING "Most detailed log messages of JSON requests and responses compiled in, within LOG_MAX_LEVEL")
 option(ENABLE_DRIVE_NOTIFICATIONS "Allows to monitor (external) drives being [dis]connected to the computer" OFF)
+if (CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    option(USE_EPOLL "Wait for events with epoll, keeping the sockets registered between waits" OFF)
+    option(USE_FANOTIFY "Watch whole filesystems with fanotify (Linux 5.9, needs CAP_SYS_ADMIN) instead of every folder with inotify, when permitted" OFF)
+endif()
 option(ENABLE_QT_BINDINGS "Enable the target to build the Qt Bindings" OFF)
 option(ENABLE_JAVA_BINDINGS "Enable the target to build the Java Bindings" OFF)
 option(ENABLE_PYTHON_BINDINGS "Enable the target to build the Python Bindings" OFF)
@@ -62,19 +62,26 @@ set(SDKLIB_HEADERS
     include/mega/heartbeats.h
     include/mega/utils.h
     include/mega/account.h
+    include/mega/tracing.h
     include/mega/transfer.h
     include/mega/transferstats.h
     include/mega/config-android.h
     include/mega/treeproc.h
+    include/mega/treestateindex.h
     include/mega/arguments.h
     include/mega/attrmap.h
     include/mega/sharenodekeys.h
+    include/mega/sharedresources.h
     include/mega/request.h
     include/mega/mega_zxcvbn.h
+    include/mega/eventloopmonitor.h
+    include/mega/fileattributecache.h
     include/mega/fileattributefetch.h
+    include/mega/hashcash.h
     include/mega/version.h
     include/mega/node.h
     include/mega/mediafileattribute.h
+    include/mega/metrics.h
     include/mega/process.h
     include/mega/mega_csv.h
     include/mega/name_collision.h
@@ -98,7 +105,9 @@ set(SDKLIB_SOURCES
     src/command.cpp
     src/commands.cpp
     src/db.cpp
+    src/eventloopmonitor.cpp
     src/file.cpp
+    src/fileattributecache.cpp
     src/fileattributefetch.cpp
     src/filefingerprint.cpp
     src/filesystem.cpp
@@ -106,6 +115,7 @@ set(SDKLIB_SOURCES
     src/gfx/external.cpp
     src/gfx/freeimage.cpp
     src/gfx/gfx_pdfium.cpp
+    src/hashcash.cpp
     src/http.cpp
     src/json.cpp
     src/logging.cpp
@@ -115,6 +125,7 @@ set(SDKLIB_SOURCES
     src/mega_utf8proc.cpp
     src/mega_zxcvbn.cpp
     src/megaclient.cpp
+    src/metrics.cpp
     src/node.cpp
     src/pendingcontactrequest.cpp
     src/textchat.cpp
@@ -127,15 +138,18 @@ set(SDKLIB_SOURCES
     src/nodemanager.cpp
     src/setandelement.cpp
     src/share.cpp
+    src/sharedresources.cpp
     src/sharenodekeys.cpp
     src/sync.cpp
     src/syncfilter.cpp
     src/heartbeats.cpp
     src/testhooks.cpp
+    src/tracing.cpp
     src/transfer.cpp
     src/transferslot.cpp
     src/transferstats.cpp
     src/treeproc.cpp
+    src/treestateindex.cpp
     src/user.cpp
     src/useralerts.cpp
     src/utils.cpp
@@ -225,6 +239,7 @@ target_sources_conditional(SDKlib
     include/mega/thread/posixthread.h
     include/mega/posix/megaconsole.h
     include/mega/posix/megafs.h
+    include/mega/posix/megaiouring.h
     include/mega/posix/megaconsolewaiter.h
     include/mega/posix/meganet.h
     include/mega/posix/megasys.h
@@ -233,6 +248,7 @@ target_sources_conditional(SDKlib
     src/thread/posixthread.cpp
     src/posix/console.cpp
     src/posix/fs.cpp
+    src/posix/iouring.cpp
     src/posix/consolewaiter.cpp
     src/posix/net.cpp
 )
@@ -438,6 +454,16 @@ if(ENABLE_SDKLIB_WERROR)
     endif()
 endif()
 
+## Log levels compiled in, as the LogLevel values for config.h ##
+set(SDKLIB_LOG_LEVELS fatal error warning info debug max)
+foreach(LOG_SETTING LOG_MAX_LEVEL SYNC_LOG_MAX_LEVEL TRANSFER_LOG_MAX_LEVEL JSON_LOG_MAX_LEVEL)
+    list(FIND SDKLIB_LOG_LEVELS "${${LOG_SETTING}}" LOG_LEVEL_VALUE)
+    if(LOG_LEVEL_VALUE EQUAL -1)
+        message(FATAL_ERROR "${LOG_SETTING} must be one of: ${SDKLIB_LOG_LEVELS}")
+    endif()
+    set(MEGA_${LOG_SETTING} ${LOG_LEVEL_VALUE})
+endforeach()
+
 ## Create config files ##
 configure_file(
     cmake/config.h.in
@@ -89,9 +89,15 @@ namespace ac = ::mega::autocomplete;
 #include <iomanip>
 
 // FUSE
+#include <mega/fuse/common/file_cache_statistics.h>
+#include <mega/fuse/common/inode_cache_statistics.h>
+#include <mega/fuse/common/task_executor_statistics.h>
+#include <mega/fuse/common/task_priority.h>
 #include <mega/fuse/common/mount_info.h>
 #include <mega/fuse/common/mount_result.h>
 #include <mega/fuse/common/normalized_path.h>
+#include <mega/fuse/common/operation_statistics.h>
+#include <mega/fuse/common/operation_type.h>
 #include <mega/fuse/common/service_flags.h>
 
 using namespace mega;
@@ -4231,12 +4237,14 @@ static void exec_fuseflags(autocomplete::ACState& state)
     auto parseCacheFlags = [&](fuse::InodeCacheFlags& flags) {
         std::string ageThreshold;
         std::string interval;
+        std::string maxMemory;
         std::string maxSize;
         std::string sizeThreshold;
 
         state.extractflagparam("-cache-clean-age-threshold", ageThreshold);
         state.extractflagparam("-cache-clean-interval", interval);
         state.extractflagparam("-cache-clean-size-threshold", sizeThreshold);
+        state.extractflagparam("-cache-max-memory", maxMemory);
         state.extractflagparam("-cache-max-size", maxSize);
 
         if (!ageThreshold.empty())
@@ -4245,6 +4253,9 @@ static void exec_fuseflags(autocomplete::ACState& state)
         if (!interval.empty())
             flags.mCleanInterval = seconds(stoul(interval));
 
+        if (!maxMemory.empty())
+            flags.mMaxMemory = stoul(maxMemory);
+
         if (!maxSize.empty())
             flags.mMaxSize = stoul(maxSize);
 
@@ -4272,6 +4283,20 @@ static void exec_fuseflags(autocomplete::ACState& state)
             flags.mMinWorkers = stoul(min);
     }; // parseExecutorFlags
 
+    auto parseFileCacheFlags = [&](fuse::FileCacheFlags& flags) {
+        std::string interval;
+        std::string maxSize;
+
+        state.extractflagparam("-file-cache-clean-interval", interval);
+        state.extractflagparam("-file-cache-max-size", maxSize);
+
+        if (!interval.empty())
+            flags.mCleanInterval = seconds(stoul(interval));
+
+        if (!maxSize.empty())
+            flags.mMaxSize = std::stoull(maxSize);
+    }; // parseFileCacheFlags
+
     std::string flushDelay;
     std::string logLevel;
 
@@ -4287,11 +4312,15 @@ static void exec_fuseflags(autocomplete::ACState& state)
         flags.mLogLevel = fuse::toLogLevel(logLevel);
 
     parseCacheFlags(flags.mInodeCacheFlags);
+    parseFileCacheFlags(flags.mFileCacheFlags);
     parseExecutorFlags(flags.mMountExecutorFlags, "mount");
     parseExecutorFlags(flags.mServiceExecutorFlags, "service");
 
     client->mFuseService.serviceFlags(flags);
 
+    auto inodeCacheStatistics = client->mFuseService.inodeCacheStatistics();
+    auto statistics = client->mFuseService.fileCacheStatistics();
+
     std::cout << "Cache Clean Age Threshold: "
               << flags.mInodeCacheFlags.mCleanAgeThreshold.count()
               << "\n"
@@ -4301,9 +4330,39 @@ static void exec_fuseflags(autocomplete::ACState& state)
               << "Cache Clean Size Threshold: "
               << flags.mInodeCacheFlags.mCleanSizeThreshold
               << "\n"
+              << "Cache Evictions: "
+              << inodeCacheStatistics.mEvictions
+              << "\n"
+              << "Cache Hits: "
+              << inodeCacheStatistics.mHits
+              << "\n"
+              << "Cache Max Memory: "
+              << flags.mInodeCacheFlags.mMaxMemory
+              << "\n"
               << "Cache Max Size: "
               << flags.mInodeCacheFlags.mMaxSize
               << "\n"
+              << "Cache Memory: "
+              << inodeCacheStatistics.mMemory
+              << "\n"
+              << "Cache Misses: "
+              << inodeCacheStatistics.mMisses
+              << "\n"
+              << "Cache Size: "
+              << inodeCacheStatistics.mSize
+              << "\n"
+              << "File Cache Clean Interval: "
+              << flags.mFileCacheFlags.mCleanInterval.count()
+              << "s\n"
+              << "File Cache Hits: "
+              << statistics.mHits
+              << "\n"
+              << "File Cache Max Size: "
+              << flags.mFileCacheFlags.mMaxSize
+              << "\n"
+              << "File Cache Misses: "
+              << statistics.mMisses
+              << "\n"
               << "Flush Delay: "
               << flags.mFlushDelay.count()
               << "s\n"
@@ -4328,6 +4387,44 @@ static void exec_fuseflags(autocomplete::ACState& state)
               << "Service Min Thread Count: "
               << flags.mServiceExecutorFlags.mMinWorkers
               << std::endl;
+
+    auto executorStatistics = client->mFuseService.executorStatistics();
+
+    for (auto i = 0u; i < fuse::NumTaskPriorities; ++i)
+    {
+        auto& lane = executorStatistics.mLanes[i];
+
+        std::cout << "Service "
+                  << fuse::toString(static_cast<fuse::TaskPriority>(i))
+                  << " Lane: "
+                  << lane.mExecuted
+                  << " task(s), "
+                  << (lane.mExecuted ? lane.mTotalWait.count() / lane.mExecuted : 0)
+                  << "us average wait, "
+                  << lane.mMaxWait.count()
+                  << "us maximum wait"
+                  << std::endl;
+    }
+
+    auto operationStatistics = client->mFuseService.operationStatistics();
+
+    for (auto i = 0u; i < fuse::NumOperationTypes; ++i)
+    {
+        auto& histogram = operationStatistics.mOperations[i];
+
+        std::cout << "Service "
+                  << fuse::toString(static_cast<fuse::OperationType>(i))
+                  << " Latency: "
+                  << histogram.mCount
+                  << " operation(s), "
+                  << histogram.percentile(50).count()
+                  << "us median, "
+                  << histogram.percentile(99).count()
+                  << "us 99th percentile, "
+                  << histogram.mMaxLatency.count()
+                  << "us maximum"
+                  << std::endl;
+    }
 }
 
 static void exec_fusemountadd(autocomplete::ACState& state)
@@ -4341,6 +4438,7 @@ static void exec_fusemountadd(autocomplete::ACState& state)
 
     state.extractflagparam("-name", info.mFlags.mName);
 
+    info.mFlags.mOffline = state.extractflag("-offline");
     info.mFlags.mPersistent = state.extractflag("-persistent");
     info.mFlags.mReadOnly = state.extractflag("-read-only");
 
@@ -4595,6 +4693,20 @@ static void exec_fusemountflags(autocomplete::ACState& state)
     flags->mReadOnly |= readOnly;
     flags->mReadOnly &= !writable;
 
+    auto offline = state.extractflag("-offline");
+    auto online  = state.extractflag("-online");
+
+    if (offline && online)
+    {
+        std::cerr << "A mount is either available offline or online only."
+                  << std::endl;
+
+        return;
+    }
+
+    flags->mOffline |= offline;
+    flags->mOffline &= !online;
+
     auto persistent = state.extractflag("-persistent");
     auto transient  = state.extractflag("-transient");
 
@@ -4626,6 +4738,9 @@ static void exec_fusemountflags(autocomplete::ACState& state)
               << "Name: "
               << flags->mName
               << "\n"
+              << "Offline: "
+              << flags->mOffline
+              << "\n"
               << "Persistent: "
               << flags->mPersistent
               << "\n"
@@ -5178,8 +5293,14 @@ autocomplete::ACN autocompleteSyntax()
                                            wholenumber("seconds", 5 * 60)),
                                   sequence(flag("-cache-clean-size-threshold"),
                                            wholenumber("count", 64)),
-                                  sequence(flag("-cache-max-size"),
-                                           wholenumber("count", 256)),
+                                  either(sequence(flag("-cache-max-memory"),
+                                                  wholenumber("bytes", 0)),
+                                         sequence(flag("-cache-max-size"),
+                                                  wholenumber("count", 256))),
+                                  either(sequence(flag("-file-cache-clean-interval"),
+                                                  wholenumber("seconds", 5 * 60)),
+                                         sequence(flag("-file-cache-max-size"),
+                                                  wholenumber("bytes", 0))),
                                   sequence(flag("-flush-delay"),
                                            wholenumber("seconds", 4)),
                                   sequence(flag("-log-level"),
@@ -5206,6 +5327,7 @@ autocomplete::ACN autocompleteSyntax()
                     text("add"),
                     repeat(either(sequence(flag("-name"),
                                            param("name")),
+                                  flag("-offline"),
                                   flag("-persistent"),
                                   flag("-read-only"))),
                     remoteFSFolder(client, &cwd, "source"),
@@ -5243,6 +5365,8 @@ autocomplete::ACN autocompleteSyntax()
                                   flag("-enabled-at-startup"),
                                   sequence(flag("-name"),
                                            param("name")),
+                                  flag("-offline"),
+                                  flag("-online"),
                                   flag("-persistent"),
                                   flag("-read-only"),
                                   flag("-transient"),
@@ -6351,7 +6475,7 @@ void uploadLocalFolderContent(const LocalPath& localname, Node* cloudFolder, Ver
     }
 
     ScanService s;
-    ScanService::RequestPtr r = s.queueScan(localname, fa->fsid, false, {}, client->waiter);
+    ScanService::RequestPtr r = s.queueScan(client->fsaccess->fsFingerprint(localname), localname, fa->fsid, false, {}, client->waiter, true);
 
     while (!r->completed())
     {
@@ -40,10 +40,13 @@
 #include "mega/command.h"
 #include "mega/console.h"
 #include "mega/db.h"
+#include "mega/eventloopmonitor.h"
 #include "mega/file.h"
+#include "mega/fileattributecache.h"
 #include "mega/fileattributefetch.h"
 #include "mega/filefingerprint.h"
 #include "mega/filesystem.h"
+#include "mega/hashcash.h"
 #include "mega/http.h"
 #include "mega/json.h"
 #include "mega/logging.h"
@@ -57,6 +60,7 @@
 #include "mega/scoped_helpers.h"
 #include "mega/serialize64.h"
 #include "mega/share.h"
+#include "mega/sharedresources.h"
 #include "mega/sharenodekeys.h"
 #include "mega/sync.h"
 #include "mega/transfer.h"
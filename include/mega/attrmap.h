@@ -25,27 +25,142 @@
 #include "name_id.h"
 #include "utils.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 namespace mega {
 
 // maps attribute names to attribute values
-struct attr_map : map<nameid, string>
+//
+// A node has a handful of attributes, so they're kept in a vector sorted by name rather than in a
+// tree: one allocation for all of them instead of one each, and serialization walks them in order.
+// Unlike std::map, inserting or erasing an entry moves the others, invalidating iterators and
+// references to them.
+class attr_map
 {
-    attr_map() {}
+public:
+    using key_type = nameid;
+    using mapped_type = string;
+    using value_type = std::pair<nameid, string>;
+    using iterator = vector<value_type>::iterator;
+    using const_iterator = vector<value_type>::const_iterator;
+
+    attr_map() = default;
 
     attr_map(nameid key, string value)
     {
-        (*this)[key] = std::move(value);
+        mEntries.emplace_back(key, std::move(value));
     }
 
     attr_map(map<nameid, string>&& m)
     {
-        m.swap(*this);
+        mEntries.reserve(m.size());
+        for (auto& i : m)
+        {
+            mEntries.emplace_back(i.first, std::move(i.second));
+        }
+    }
+
+    iterator begin() { return mEntries.begin(); }
+    iterator end() { return mEntries.end(); }
+    const_iterator begin() const { return mEntries.begin(); }
+    const_iterator end() const { return mEntries.end(); }
+    const_iterator cbegin() const { return mEntries.cbegin(); }
+    const_iterator cend() const { return mEntries.cend(); }
+
+    bool empty() const { return mEntries.empty(); }
+    size_t size() const { return mEntries.size(); }
+    size_t capacity() const { return mEntries.capacity(); }
+    void clear() { mEntries.clear(); }
+    void reserve(size_t n) { mEntries.reserve(n); }
+    void shrink_to_fit() { mEntries.shrink_to_fit(); }
+    void swap(attr_map& other) { mEntries.swap(other.mEntries); }
+
+    iterator find(nameid k)
+    {
+        auto i = lower_bound(k);
+        return i != end() && i->first == k ? i : end();
+    }
+
+    const_iterator find(nameid k) const
+    {
+        auto i = lower_bound(k);
+        return i != end() && i->first == k ? i : end();
+    }
+
+    bool contains(nameid k) const { return find(k) != end(); }
+    size_t count(nameid k) const { return contains(k) ? 1 : 0; }
+
+    string& operator[](nameid k)
+    {
+        return emplace(k).first->second;
+    }
+
+    // throws std::out_of_range, as std::map does
+    const string& at(nameid k) const
+    {
+        auto i = find(k);
+        if (i == end()) throw std::out_of_range("attr_map::at");
+        return i->second;
+    }
+
+    string& at(nameid k)
+    {
+        return const_cast<string&>(static_cast<const attr_map&>(*this).at(k));
     }
 
-    bool contains(nameid k) const
+    // leaves an existing value alone, as std::map does
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(nameid k, Args&&... args)
     {
-        return this->find(k) != this->end();
+        // names mostly arrive in order, as serialize() writes them
+        if (mEntries.empty() || mEntries.back().first < k)
+        {
+            mEntries.emplace_back(std::piecewise_construct, std::forward_as_tuple(k), std::forward_as_tuple(std::forward<Args>(args)...));
+            return {std::prev(end()), true};
+        }
+
+        auto i = lower_bound(k);
+        if (i != end() && i->first == k)
+        {
+            return {i, false};
+        }
+        return {mEntries.emplace(i, std::piecewise_construct, std::forward_as_tuple(k), std::forward_as_tuple(std::forward<Args>(args)...)), true};
     }
+
+    std::pair<iterator, bool> insert(value_type v)
+    {
+        return emplace(v.first, std::move(v.second));
+    }
+
+    size_t erase(nameid k)
+    {
+        auto i = find(k);
+        if (i == end()) return 0;
+        mEntries.erase(i);
+        return 1;
+    }
+
+    iterator erase(const_iterator i)
+    {
+        return mEntries.erase(i);
+    }
+
+    bool operator==(const attr_map& other) const { return mEntries == other.mEntries; }
+    bool operator!=(const attr_map& other) const { return mEntries != other.mEntries; }
+
+private:
+    iterator lower_bound(nameid k)
+    {
+        return std::lower_bound(mEntries.begin(), mEntries.end(), k, [](const value_type& e, nameid n) { return e.first < n; });
+    }
+
+    const_iterator lower_bound(nameid k) const
+    {
+        return std::lower_bound(mEntries.begin(), mEntries.end(), k, [](const value_type& e, nameid n) { return e.first < n; });
+    }
+
+    vector<value_type> mEntries;
 };
 
 struct MEGA_API AttrMap
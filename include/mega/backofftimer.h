@@ -70,16 +70,41 @@ public:
 class MEGA_API BackoffTimerTracked;
 
 // This class keeps track of a group of BackoffTimerTracked, which register and deregister themselves.
-// Timers are in the multimap when they have non-0 non-NEVER timeouts set, giving us a much smaller group should we need to iterate it.
+// Timers are tracked when they have non-0 non-NEVER timeouts set, giving us a much smaller group should we need to iterate it.
+//
+// They're kept in a hierarchical timer wheel: each level has 64 slots, a slot of level L spanning
+// 64^L deciseconds, and a timer goes in the lowest level whose slot tells it apart from the
+// current time. Adding and removing one is unlinking it from a slot's list, without allocating,
+// and the soonest timeout is in the lowest occupied slot of the lowest occupied level. As time
+// passes, the slots it reaches are emptied a level down, or into the list of timed out timers.
 class MEGA_API BackoffTimerGroupTracker
 {
-    std::multimap<dstime, BackoffTimerTracked*> timeouts;
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr unsigned SLOTS = 1u << SLOT_BITS;
+    static constexpr unsigned LEVELS = (64 + SLOT_BITS - 1) / SLOT_BITS;
+
+    // the last list holds the timers that timed out at or before mNow
+    static constexpr int EXPIRED = LEVELS * SLOTS;
+
+    BackoffTimerTracked* mLists[LEVELS * SLOTS + 1] = {};
+    uint64_t mOccupied[LEVELS] = {};
+    dstime mNow = 0;
+    size_t mSize = 0;
+
+    inline void link(BackoffTimerTracked* bt, int list);
+    inline int listFor(dstime key) const;
+
+    // moves the current time forward, emptying the slots it has reached
+    void advance(dstime now);
 
 public:
-    typedef std::multimap<dstime, BackoffTimerTracked*>::iterator Iter;
+    inline void add(BackoffTimerTracked* bt);
+    inline void remove(BackoffTimerTracked* bt);
+
+    size_t size() const { return mSize; }
 
-    inline Iter add(BackoffTimerTracked* bt);
-    inline void remove(Iter i) { timeouts.erase(i); }
+    // the soonest timeout after the current time among the tracked timers, NEVER if there is none
+    dstime nextTimeout() const;
 
     // Find out the soonest (non-0 and non-NEVER) timeout in the group.
     // For transfers, it calls set(0) on any timed out timers, as the old code did.
@@ -94,7 +119,13 @@ class MEGA_API BackoffTimerTracked
     bool mIsEnabled;
     BackoffTimer bt;
     BackoffTimerGroupTracker& mTracker;
-    BackoffTimerGroupTracker::Iter mTrackerPos;
+
+    // its place in the tracker's wheel: mList is -1 while it isn't tracked
+    friend class BackoffTimerGroupTracker;
+    BackoffTimerTracked* mPrev = nullptr;
+    BackoffTimerTracked* mNext = nullptr;
+    dstime mKey = 0;
+    int mList = -1;
 
     void untrack();
     void track();
@@ -118,17 +149,76 @@ public:
     inline bool enabled()           { return mIsEnabled; }
 };
 
-inline auto BackoffTimerGroupTracker::add(BackoffTimerTracked* bt) -> Iter
+inline int BackoffTimerGroupTracker::listFor(dstime key) const
 {
-    return timeouts.emplace(bt->nextset() ? bt->nextset() : NEVER, bt);
+    if (key <= mNow)
+    {
+        return EXPIRED;
+    }
+
+    // the level is that of the highest slot-sized group of bits where key and mNow differ
+    unsigned level = 0;
+    for (uint64_t d = static_cast<uint64_t>(key ^ mNow) >> SLOT_BITS; d; d >>= SLOT_BITS)
+    {
+        ++level;
+    }
+    return static_cast<int>(level * SLOTS + ((static_cast<uint64_t>(key) >> (level * SLOT_BITS)) & (SLOTS - 1)));
+}
+
+inline void BackoffTimerGroupTracker::link(BackoffTimerTracked* bt, int list)
+{
+    bt->mList = list;
+    bt->mPrev = nullptr;
+    bt->mNext = mLists[list];
+    if (bt->mNext)
+    {
+        bt->mNext->mPrev = bt;
+    }
+    mLists[list] = bt;
+
+    if (list != EXPIRED)
+    {
+        mOccupied[list / SLOTS] |= uint64_t(1) << (list % SLOTS);
+    }
+}
+
+inline void BackoffTimerGroupTracker::add(BackoffTimerTracked* bt)
+{
+    bt->mKey = bt->nextset();
+    link(bt, listFor(bt->mKey));
+    ++mSize;
+}
+
+inline void BackoffTimerGroupTracker::remove(BackoffTimerTracked* bt)
+{
+    int list = bt->mList;
+    if (bt->mPrev)
+    {
+        bt->mPrev->mNext = bt->mNext;
+    }
+    else
+    {
+        mLists[list] = bt->mNext;
+        if (!bt->mNext && list != EXPIRED)
+        {
+            mOccupied[list / SLOTS] &= ~(uint64_t(1) << (list % SLOTS));
+        }
+    }
+    if (bt->mNext)
+    {
+        bt->mNext->mPrev = bt->mPrev;
+    }
+
+    bt->mPrev = bt->mNext = nullptr;
+    bt->mList = -1;
+    --mSize;
 }
 
 inline void BackoffTimerTracked::untrack()
 {
-    if (mIsEnabled && bt.nextset() != 0 && bt.nextset() != NEVER)
+    if (mList >= 0)
     {
-        mTracker.remove(mTrackerPos);
-        mTrackerPos = BackoffTimerGroupTracker::Iter();
+        mTracker.remove(this);
     }
 }
 
@@ -136,7 +226,7 @@ inline void BackoffTimerTracked::track()
 {
     if (mIsEnabled && bt.nextset() != 0 && bt.nextset() != NEVER)
     {
-        mTrackerPos = mTracker.add(this);
+        mTracker.add(this);
     }
 }
 
@@ -39,6 +39,10 @@ public:
     static string atob(const string&);
     static int atob(const char*, byte*, int);   // deprecated
 
+    // decode a handle of `size` bytes into `h`, false unless the string has exactly that size
+    static bool atob(const char*, handle& h, int size);
+    static bool atob(const char*, NodeHandle& h);
+
     static void itoa(int64_t, string *);
     static int64_t atoi(string *);
 
@@ -68,7 +68,18 @@ public:
     // true if the command returns strings, arrays or objects, but a seqtag is (optionally) also required. In example: ["seqtag"/error, <JSON from before v3>]
     bool mSeqtagArray = false;
 
-    // filters for JSON parsing in streaming
+    // background work that can wait for the other queued commands, which are sent before it.
+    // Only for commands whose order relative to those doesn't matter
+    bool mBulk = false;
+
+    // read-only command that doesn't depend on the commands sent before it, and whose response
+    // carries no seqtag. It can go through the secondary cs channel, while other batches are in flight
+    bool mIndependent = false;
+
+    // filters for JSON parsing in streaming (see JSONSplitter::processChunk).
+    // A command that sets them and is alone in its batch has its response processed in chunks
+    // as it arrives, and procresult() is only called if the response ends up buffered in full.
+    // Use together with batchSeparately
     std::map<std::string, std::function<bool(JSON *)>> mFilters;
 
     void cmd(const char*);
@@ -76,6 +87,7 @@ public:
     virtual void cancel(void);
 
     void arg(const char*, const char*, int = 1);
+    void arg(const char*, std::string_view, int = 1);
     void arg(const char*, const byte*, int);
     void arg(const char*, NodeHandle);
     void arg(const char*, m_off_t);
@@ -211,6 +223,9 @@ struct MEGA_API HttpReqFA : public HttpReq, public std::enable_shared_from_this<
     std::function<CommandPutFA*()> getURLForFACmd;
     int tag = 0;
 
+    // the attribute before encryption, for the file attribute cache
+    string plaintext;
+
 private:
     std::unique_ptr<string> data;
 };
@@ -714,7 +729,10 @@ private:
     NodeHandle targethandle;
     Completion mResultFunction;
 
-    void removePendingDBRecordsAndTempFiles();
+    // tags of the other uploads whose nodes were grouped into this command
+    vector<int> mBatchedTags;
+
+    void removePendingDBRecordsAndTempFiles(int uploadTag);
     void performAppCallback(Error e,
                             vector<NewNode>&,
                             bool targetOverride = false,
@@ -921,6 +939,9 @@ class MEGA_API CommandGetUserSessions : public Command
 {
     std::shared_ptr<AccountDetails> details;
 
+    // appends the session in the array already entered, and leaves it
+    bool readSession(JSON&);
+
 public:
     bool procresult(Result, JSON&) override;
 
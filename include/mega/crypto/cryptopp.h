@@ -37,6 +37,10 @@
 #include <cryptopp/algparam.h>
 #include <cryptopp/hmac.h>
 #include <cryptopp/pwdbased.h>
+#include <cryptopp/zdeflate.h>
+#include <cryptopp/zinflate.h>
+
+#include <array>
 
 namespace mega {
 
@@ -91,6 +95,9 @@ private:
     CryptoPP::GCM<CryptoPP::AES>::Encryption aesgcm_e;
     CryptoPP::GCM<CryptoPP::AES>::Decryption aesgcm_d;
 
+    // expanded AES-128 schedule for the hardware CTR/chunk MAC kernel
+    alignas(16) byte roundkeys[11 * 16];
+
     /**
      * @brief Authenticated symmetric encryption using AES in GCM mode.
      *
@@ -453,6 +460,37 @@ public:
     SymmCipher(const byte*);
 };
 
+/**
+ * @brief A few ciphers with their keys already set up
+ *
+ * SymmCipher::setkey expands the key for every supported mode, which costs more than
+ * decrypting the attributes of a node. The same keys tend to be used several times in a row
+ * (a node's attributes, then its file attributes or its children's keys), so this keeps the
+ * last ENTRIES of them and rekeys the least recently used one on a miss.
+ */
+class MEGA_API SymmCipherCache
+{
+public:
+    static const unsigned ENTRIES = 8;
+
+    // a cipher set up with the key (same semantics as SymmCipher::setkey).
+    // To be used right away: a later call may rekey it
+    SymmCipher* get(const byte* key, int type = 1);
+
+    // the instance of the calling thread, as SymmCipher is not thread-safe
+    static SymmCipherCache& local();
+
+private:
+    struct Entry
+    {
+        SymmCipher cipher;
+        uint64_t lastUse = 0;
+    };
+
+    std::array<Entry, ENTRIES> mEntries;
+    uint64_t mUses = 0;
+};
+
 /**
  * @brief Asymmetric cryptography using RSA.
  */
@@ -643,15 +681,44 @@ public:
     void get(std::string*);
 };
 
+// CRC-32 as in CryptoPP::CRC32, with PCLMULQDQ or the ARMv8 CRC instructions when available
 class MEGA_API HashCRC32
 {
-    CryptoPP::CRC32 hash;
+    uint32_t mCrc = 0xFFFFFFFF;
 
 public:
     void add(const byte*, unsigned);
+
+    // the 4 bytes of the CRC (little-endian), then starts over
     void get(byte*);
 };
 
+/**
+ * @brief Raw DEFLATE (RFC 1951) compression
+ */
+class MEGA_API Deflate
+{
+public:
+    /**
+     * @brief Compress a buffer
+     * @param data Data to compress
+     * @param len Data length
+     * @param compressed The compressed data is returned here
+     * @param level Compression level, from 1 (fastest) to 9 (smallest)
+     * @return False if the data couldn't be compressed
+     */
+    static bool compress(const byte* data, size_t len, std::string& compressed, int level = 6);
+
+    /**
+     * @brief Decompress a buffer compressed by compress()
+     * @param data Compressed data
+     * @param len Compressed data length
+     * @param decompressed The original data is returned here
+     * @return False if the data is corrupt
+     */
+    static bool decompress(const byte* data, size_t len, std::string& decompressed);
+};
+
 /**
  * @brief HMAC-SHA256 generator
  */
@@ -26,12 +26,14 @@
 #include "logging.h"
 #include "node.h"
 
+#include <condition_variable>
 #include <filesystem>
 #include <optional>
 
 namespace mega {
 // generic host transactional database access interface
 class DBTableTransactionCommitter;
+struct MegaClientAsyncQueue;
 
 // Class to load serialized node from data base
 class NodeSerialized
@@ -74,6 +76,12 @@ public:
     virtual bool next(uint32_t*, string*) = 0;
     bool next(uint32_t*, string*, SymmCipher*);
 
+    // the remaining records of a full sequential get, at once. They are decrypted by the worker
+    // threads of 'queue', in batches of DECRYPTION_BATCH_SIZE. As with next(), a record that fails
+    // to decrypt ends the sequence: it and the ones after it are not returned
+    static constexpr size_t DECRYPTION_BATCH_SIZE = 64;
+    void readAll(std::vector<std::pair<uint32_t, string>>& records, SymmCipher* key, MegaClientAsyncQueue& queue);
+
     // get specific record by key
     virtual bool get(uint32_t, string*) = 0;
 
@@ -100,6 +108,35 @@ public:
     // permanantly remove all database info
     virtual void remove() = 0;
 
+    // Group commit: commit() stops waiting for the disk, which is synced from a background
+    // thread once 'maxCommits' are pending or 'maxDelay' has passed since the first of them.
+    // A crash can lose the last commits, but never leaves the DB inconsistent.
+    // 'maxCommits' 0 disables it. Returns false if it's not supported
+    virtual bool setGroupCommit(std::chrono::milliseconds /*maxDelay*/, unsigned /*maxCommits*/)
+    {
+        return false;
+    }
+
+    // durability barrier: returns once the commits done so far are on disk
+    virtual bool flushCommits()
+    {
+        return true;
+    }
+
+    // gives back the memory of the DB caches, upon memory pressure
+    virtual void releaseMemory()
+    {
+    }
+
+    // Snapshot: the records are copied to a flat file when the table is closed, and the next
+    // full sequential get (rewind() and next()) reads them from there at once instead of
+    // querying the DB. The first change to the records discards it.
+    // Returns false if it's not supported
+    virtual bool setSnapshot(bool /*enable*/)
+    {
+        return false;
+    }
+
     void checkCommitter(DBTableTransactionCommitter*);
 
     // autoincrement
@@ -112,6 +149,107 @@ public:
 
 class NodeSearchFilter;
 class NodeSearchPage;
+class NodeSearchCursor;
+
+// Usage of the connections that run read-only queries apart from the one that writes
+struct DBReadPoolStats
+{
+    // queries run on a read-only connection
+    uint64_t pooled = 0;
+    // queries run on the primary connection (pending writes of nodes, no pool available...)
+    uint64_t primary = 0;
+    // queries that had to wait for a read-only connection to be released
+    uint64_t waits = 0;
+    std::chrono::microseconds waitTime{0};
+    std::chrono::microseconds longestWait{0};
+
+    std::string report() const;
+};
+
+// Sizes and read cost of the serialized nodes kept in DB
+struct DBBlobStats
+{
+    // blobs written, and how many of them were compressed
+    uint64_t written = 0;
+    uint64_t compressed = 0;
+    // bytes of the blobs written, before and after compression
+    uint64_t rawBytes = 0;
+    uint64_t storedBytes = 0;
+    // compressed blobs read, and time spent decompressing them
+    uint64_t decompressed = 0;
+    std::chrono::microseconds decompressTime{0};
+
+    std::string report() const;
+};
+
+// An entry of the journal of node changes, see DBTableNodes::setChangeJournal()
+struct DBNodeChange
+{
+    // assigned by the journal: increasing, never reused within a journal
+    uint64_t sequence = 0;
+    NodeHandle node;
+    // Node::changedMask()
+    uint64_t changes = 0;
+    // SCSN of the account when the change was applied
+    handle scsn = UNDEF;
+};
+
+// Scheduling class of a node query: background queries step aside for interactive ones
+enum class DBQueryPriority
+{
+    INTERACTIVE,
+    BACKGROUND,
+};
+
+// Counts the interactive queries waiting for the DB, so running background ones can yield
+class DBQueryScheduler
+{
+public:
+    // an interactive query starts or stops waiting (it stops once it owns the DB)
+    void interactiveWaiting();
+    void interactiveServed();
+
+    bool interactivePending() const
+    {
+        return mInteractiveWaiting.load() > 0;
+    }
+
+    // blocks until no interactive query is waiting, or 'timeout' expires
+    void waitForInteractive(std::chrono::milliseconds timeout);
+
+private:
+    std::atomic<unsigned> mInteractiveWaiting{0};
+    std::mutex mMutex;
+    std::condition_variable mIdle;
+};
+
+// How a node query can be interrupted: by its cancel token, by its deadline
+// or, for background queries, by an interactive query waiting on 'scheduler'
+struct DBQueryOptions
+{
+    using Clock = std::chrono::steady_clock;
+
+    DBQueryOptions() = default;
+
+    DBQueryOptions(CancelToken token)
+        : cancelFlag(token)
+    {}
+
+    CancelToken cancelFlag;
+    DBQueryPriority priority = DBQueryPriority::INTERACTIVE;
+    Clock::time_point deadline = Clock::time_point::max();
+    const DBQueryScheduler* scheduler = nullptr;
+
+    // outcome of the last query run with these options
+    mutable bool yielded = false;
+    mutable bool timedOut = false;
+
+    bool interruptible() const
+    {
+        return cancelFlag.exists() || deadline != Clock::time_point::max() ||
+               (scheduler && priority == DBQueryPriority::BACKGROUND);
+    }
+};
 
 class MEGA_API DBTableNodes
 {
@@ -120,6 +258,10 @@ public:
     // add or update a node
     virtual bool put(Node* node) = 0;
 
+    // add or update several nodes at once (in the current transaction). 'nodes' must not change
+    // until it returns, since the implementation may serialize them in parallel
+    virtual bool put(const std::vector<Node*>& nodes) = 0;
+
     // remove one node from 'nodes' table
     virtual bool remove(NodeHandle nodehandle) = 0;
 
@@ -131,8 +273,24 @@ public:
     virtual bool getNodesByOrigFingerprint(const std::string& fingerprint, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes) = 0;
 
     virtual uint64_t getNumberOfChildren(NodeHandle parentHandle) = 0;
-    virtual bool getChildren(const NodeSearchFilter& filter, int order, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, CancelToken cancelFlag, const NodeSearchPage& page) = 0;
-    virtual bool searchNodes(const NodeSearchFilter& filter, int order, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, CancelToken cancelFlag, const NodeSearchPage& page) = 0;
+    virtual bool getChildren(const NodeSearchFilter& filter, int order, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, const DBQueryOptions& options, const NodeSearchPage& page) = 0;
+    virtual bool searchNodes(const NodeSearchFilter& filter, int order, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, const DBQueryOptions& options, const NodeSearchPage& page) = 0;
+
+    // keyset-paged look-up of up to 'limit' children (all if 0) that follow 'cursor' in 'order', which is
+    // moved past them. They are handed to 'processBatch' in batches of 'batchSize' as they are read,
+    // and it can return false to stop the look-up
+    virtual bool getChildrenFrom(const NodeSearchFilter& filter,
+                                 int order,
+                                 NodeSearchCursor& cursor,
+                                 size_t limit,
+                                 size_t batchSize,
+                                 const std::function<bool(std::vector<std::pair<NodeHandle, NodeSerialized>>&)>& processBatch,
+                                 const DBQueryOptions& options) = 0;
+
+    // get all descendants of 'root' (not 'root' itself) up to 'maxDepth' levels below it (no limit if maxDepth < 1),
+    // and at most 'limit' of them (no limit if 0). Nodes are returned in breadth-first order, so parents always
+    // precede their children, and only the deepest level returned can be incomplete when the limit is reached
+    virtual bool getSubtree(NodeHandle root, int maxDepth, size_t limit, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, const DBQueryOptions& options) = 0;
 
     /**
      * @brief Retrieves all the different tags for all the nodes stored in the db and inserts them
@@ -141,26 +299,37 @@ public:
      * @param searchString If not empty, only tags containing it will be returned. It can contain
      * wild cards (*).
      * @param tags Output parameter to store the tags.
-     * @param cancelFlag to cancel the processing at any time
+     * @param options to cancel the processing at any time, or make it yield to interactive queries
      * @return true if no errors were encountered, false otherwise.
      */
     virtual bool getAllNodeTags(const std::string& searchString,
                                 std::set<std::string>& tags,
-                                CancelToken cancelFlag) = 0;
+                                const DBQueryOptions& options) = 0;
 
     virtual bool getRecentNodes(const NodeSearchPage& page,
                                 m_time_t since,
                                 std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes) = 0;
     virtual bool getNodesByFingerprint(const std::string& fingerprint, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes) = 0;
+    // the older versions of a file, newest first, in a single query
+    virtual bool getVersions(NodeHandle file, std::vector<std::pair<NodeHandle, NodeSerialized>>& versions) = 0;
     virtual bool getNodeByFingerprint(const std::string& fingerprint, mega::NodeSerialized& node, NodeHandle& handle) = 0;
+    // fingerprint of every node, as stored in the fingerprint column (duplicates included)
+    virtual bool getFingerprints(const std::function<void(const std::string&)>& processFingerprint) = 0;
     virtual bool getRootNodes(std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes) = 0;
 
     virtual bool getNodesWithSharesOrLink(std::vector<std::pair<NodeHandle, NodeSerialized>>&, ShareType_t shareType) = 0;
 
     virtual bool getFavouritesHandles(NodeHandle node, uint32_t count, std::vector<mega::NodeHandle>& nodes) = 0;
+
+    // name of every node (std::nullopt if the node has no name)
+    virtual bool getNodeNames(std::vector<std::pair<NodeHandle, std::optional<std::string>>>& names) = 0;
     virtual bool childNodeByNameType(NodeHandle parentHandle, const std::string& name, nodetype_t nodeType, std::pair<NodeHandle, NodeSerialized>& node) = 0;
 
-    virtual bool isAncestor(NodeHandle node, NodeHandle ancestror, CancelToken cancelFlag) = 0;
+    virtual bool isAncestor(NodeHandle node, NodeHandle ancestror, const DBQueryOptions& options) = 0;
+
+    // counter of a folder (or root node) without decoding its node. Returns false if it's not
+    // a folder in DB, or if the aggregates of folders aren't available
+    virtual bool getFolderCounter(NodeHandle folder, NodeCounter& counter) = 0;
 
     // count of items in 'nodes' table. Returns 0 if error
     virtual uint64_t getNumberOfNodes() = 0;
@@ -178,6 +347,34 @@ public:
     virtual void updateCounterAndFlags(NodeHandle nodeHandle, uint64_t flags, const std::string& nodeCounterBlob) = 0;
 
     virtual void createIndexes() = 0;
+
+    // Bulk load mode, for the initial load of a large number of nodes: writes aren't synced to
+    // storage and secondary indexes are dropped (createIndexes() rebuilds them once disabled).
+    // A crash in the meantime may lose the DB, which is fine since the load would restart
+    virtual void setBulkLoad(bool enable) = 0;
+
+    virtual DBReadPoolStats getReadPoolStats(bool reset) = 0;
+
+    // Optional full-text index of names, descriptions and tags, which searchNodes() and
+    // getChildren() use to narrow their text filters. Returns false if it isn't available
+    virtual bool setFullTextIndex(bool enable) = 0;
+    virtual bool hasFullTextIndex() const = 0;
+
+    // Optional compression of the serialized nodes written from now on. Blobs already stored
+    // are read as they are, whatever the current setting
+    virtual void setBlobCompression(bool enable) = 0;
+    virtual DBBlobStats getBlobStats(bool reset) = 0;
+
+    // Optional journal of node changes, kept in the same transactions as the nodes, so
+    // consumers outside the SDK can catch up from their last sequence. It's emptied by
+    // removeNodes(), and only the last 'maxChanges' entries are kept
+    virtual bool setChangeJournal(bool enable) = 0;
+    virtual bool hasChangeJournal() const = 0;
+    virtual bool appendNodeChanges(const std::vector<DBNodeChange>& changes, uint64_t maxChanges) = 0;
+    // up to 'limit' entries after 'afterSequence'. 'oldest' is the first sequence kept and 'last'
+    // the last one assigned (0 if none), so a consumer can tell whether it missed entries
+    virtual bool getNodeChanges(uint64_t afterSequence, size_t limit, std::vector<DBNodeChange>& changes,
+                                uint64_t& oldest, uint64_t& last) = 0;
 };
 
 class MEGA_API DBTableTransactionCommitter
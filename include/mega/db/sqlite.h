@@ -27,9 +27,13 @@
 
 #include "mega/db.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
+#include <mutex>
 #include <optional>
 #include <sqlite3.h>
+#include <thread>
 
 namespace mega {
 
@@ -45,7 +49,12 @@ protected:
     sqlite3_stmt* mPutStmt = nullptr;
 
     // handler for DB errors ('interrupt' is true if caller can be interrupted by CancelToken)
-    void errorHandler(int sqliteError, const std::string& operation, bool interrupt);
+    // 'connection' is the one that failed, if other than 'db'
+    void errorHandler(int sqliteError, const std::string& operation, bool interrupt, sqlite3* connection = nullptr);
+
+    // returns the value of an integer pragma, or 'defaultValue' on error
+    int64_t getPragma(const char* pragma, int64_t defaultValue);
+    void execPragma(const std::string& pragma);
 
 public:
     void rewind() override;
@@ -58,13 +67,73 @@ public:
     void commit() override;
     void abort() override;
     void remove() override;
+    bool setGroupCommit(std::chrono::milliseconds maxDelay, unsigned maxCommits) override;
+    bool flushCommits() override;
+    void releaseMemory() override;
+    bool setSnapshot(bool enable) override;
 
     SqliteDbTable(PrnGen &rng, sqlite3*, FileSystemAccess &fsAccess, const LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack);
     ~SqliteDbTable() override;
 
-private:
+protected:
     // whether an unmatched begin() has been issued
     bool inTransaction() const;
+
+private:
+    // Thread with its own connection that checkpoints the WAL, which syncs it to disk first. With
+    // synchronous=NORMAL, that's what makes the commits of the primary connection durable
+    class GroupCommitWriter
+    {
+    public:
+        GroupCommitWriter(const LocalPath& path, std::chrono::milliseconds maxDelay, unsigned maxCommits);
+        // syncs the pending commits before stopping the thread
+        ~GroupCommitWriter();
+
+        // a transaction has been committed to the WAL
+        void committed();
+
+        // waits for a checkpoint that starts after this call. Returns false if it couldn't
+        // checkpoint the whole WAL (so the last commits might not be synced yet)
+        bool flush();
+
+    private:
+        std::mutex mMutex;
+        std::condition_variable mWakeUp;
+        std::condition_variable mFlushed;
+        LocalPath mPath;
+        std::chrono::milliseconds mMaxDelay;
+        unsigned mMaxCommits;
+        unsigned mPending = 0;
+        std::chrono::steady_clock::time_point mFirstPending;
+        uint64_t mFlushRequested = 0;
+        uint64_t mFlushServed = 0;
+        bool mFlushComplete = true;
+        bool mStop = false;
+        std::thread mThread;
+
+        void run();
+        bool checkpoint(sqlite3*& connection);
+    };
+    std::unique_ptr<GroupCommitWriter> mGroupCommit;
+
+    // Snapshot file: header (magic, version, number of records, record 0 to validate it
+    // against the DB, which is the SCSN in the account's DB) followed by the records
+    static constexpr char SNAPSHOT_MAGIC[] = "MEGASNAP";
+    static constexpr uint32_t SNAPSHOT_VERSION = 1;
+    bool mSnapshotEnabled = false;
+    // the snapshot file, if any, has been removed because the records changed
+    bool mSnapshotDiscarded = false;
+    // contents of the snapshot being read by next()
+    std::string mSnapshot;
+    std::unique_ptr<CacheableReader> mSnapshotReader;
+    uint32_t mSnapshotRecordsLeft = 0;
+    LocalPath snapshotPath() const;
+    bool loadSnapshot();
+    void writeSnapshot();
+    void discardSnapshot();
+    // settings replaced while group commit is enabled
+    int mSynchronousBeforeGroupCommit = 2; // FULL
+    int64_t mAutoCheckpointBeforeGroupCommit = 1000; // SQLite's default (pages)
 };
 
 /**
@@ -81,15 +150,25 @@ public:
     bool getNodesWithSharesOrLink(std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, ShareType_t shareType) override;
 
     uint64_t getNumberOfChildren(NodeHandle parentHandle) override;
-    // If a cancelFlag is passed, it must be kept alive until this method returns.
-    bool getChildren(const mega::NodeSearchFilter& filter, int order, std::vector<std::pair<NodeHandle, NodeSerialized>>& children, CancelToken cancelFlag, const NodeSearchPage& page) override;
-    bool searchNodes(const mega::NodeSearchFilter& filter, int order, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, CancelToken cancelFlag, const NodeSearchPage& page) override;
+    // 'options' must be kept alive until this method returns.
+    bool getChildren(const mega::NodeSearchFilter& filter, int order, std::vector<std::pair<NodeHandle, NodeSerialized>>& children, const DBQueryOptions& options, const NodeSearchPage& page) override;
+    bool getChildrenFrom(const mega::NodeSearchFilter& filter,
+                         int order,
+                         NodeSearchCursor& cursor,
+                         size_t limit,
+                         size_t batchSize,
+                         const std::function<bool(std::vector<std::pair<NodeHandle, NodeSerialized>>&)>& processBatch,
+                         const DBQueryOptions& options) override;
+    bool searchNodes(const mega::NodeSearchFilter& filter, int order, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, const DBQueryOptions& options, const NodeSearchPage& page) override;
+    // 'options' must be kept alive until this method returns.
+    bool getSubtree(NodeHandle root, int maxDepth, size_t limit, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes, const DBQueryOptions& options) override;
 
     bool getAllNodeTags(const std::string& searchString,
                         std::set<std::string>& tags,
-                        CancelToken cancelFlag) override;
+                        const DBQueryOptions& options) override;
 
     bool getNodesByFingerprint(const std::string& fingerprint, std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes) override;
+    bool getVersions(NodeHandle file, std::vector<std::pair<NodeHandle, NodeSerialized>>& versions) override;
     bool getNodeByFingerprint(const std::string& fingerprint,
                               mega::NodeSerialized& node,
                               NodeHandle& handle) override;
@@ -99,13 +178,17 @@ public:
                         m_time_t since,
                         std::vector<std::pair<NodeHandle, NodeSerialized>>& nodes) override;
     bool getFavouritesHandles(NodeHandle node, uint32_t count, std::vector<mega::NodeHandle>& nodes) override;
+    bool getNodeNames(std::vector<std::pair<NodeHandle, std::optional<std::string>>>& names) override;
+    bool getFingerprints(const std::function<void(const std::string&)>& processFingerprint) override;
     bool childNodeByNameType(NodeHandle parentHanlde, const std::string& name, nodetype_t nodeType, std::pair<NodeHandle, NodeSerialized>& node) override;
     bool getNodeSizeTypeAndFlags(NodeHandle node, m_off_t& size, nodetype_t& nodeType, uint64_t &oldFlags) override;
-    bool isAncestor(mega::NodeHandle node, mega::NodeHandle ancestor, CancelToken cancelFlag) override;
+    bool isAncestor(mega::NodeHandle node, mega::NodeHandle ancestor, const DBQueryOptions& options) override;
+    bool getFolderCounter(NodeHandle folder, NodeCounter& counter) override;
     uint64_t getNumberOfNodes() override;
     uint64_t getNumberOfChildrenByType(NodeHandle parentHandle, nodetype_t nodeType) override;
 
     bool put(Node* node) override;
+    bool put(const std::vector<Node*>& nodes) override;
     using SqliteDbTable::put; // for the other virtual overload
     bool remove(mega::NodeHandle nodehandle) override;
     bool removeNodes() override;
@@ -113,14 +196,51 @@ public:
     void updateCounter(NodeHandle nodeHandle, const std::string& nodeCounterBlob) override;
     void updateCounterAndFlags(NodeHandle nodeHandle, uint64_t flags, const std::string& nodeCounterBlob) override;
     void createIndexes() override;
+    void setBulkLoad(bool enable) override;
+    DBReadPoolStats getReadPoolStats(bool reset) override;
+    bool setFullTextIndex(bool enable) override;
+    void setBlobCompression(bool enable) override;
+    DBBlobStats getBlobStats(bool reset) override;
+    bool setChangeJournal(bool enable) override;
+    bool hasChangeJournal() const override
+    {
+        return mChangeJournal;
+    }
+    bool appendNodeChanges(const std::vector<DBNodeChange>& changes, uint64_t maxChanges) override;
+    bool getNodeChanges(uint64_t afterSequence, size_t limit, std::vector<DBNodeChange>& changes,
+                        uint64_t& oldest, uint64_t& last) override;
+
+    // Encoding of the blobs in table nodeblobs (column 'encoding')
+    enum NodeBlobEncoding
+    {
+        NODE_BLOB_RAW = 0,
+        NODE_BLOB_DEFLATE = 1, // see Deflate
+    };
+    // returns false if the blob is corrupt or its encoding is unknown
+    static bool decodeNodeBlob(const void* data, int size, int encoding, std::string& blob);
+    bool hasFullTextIndex() const override
+    {
+        return mFullTextIndex;
+    }
+
+    void commit() override;
+    void abort() override;
 
     void remove() override;
     SqliteAccountState(PrnGen &rng, sqlite3*, FileSystemAccess &fsAccess, const mega::LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack);
     void finalise();
     virtual ~SqliteAccountState();
 
-    // Callback registered by some long-time running queries, so they can be canceled
-    // If the progress callback returns non-zero, the operation is interrupted
+    // Registers the SQL functions and collations used by the queries of the nodes table
+    static bool registerFunctions(sqlite3* db);
+
+    // (Re)builds table nodecounters, with the NodeCounter and the number of children of every
+    // folder, and the triggers that keep it up to date in the same transaction as table nodes
+    static bool buildNodeCounters(sqlite3* db);
+    static bool hasNodeCounters(sqlite3* db);
+
+    // Callback registered by some long-time running queries (through a QueryMonitor), so they
+    // can be canceled. If the progress callback returns non-zero, the operation is interrupted
     static int progressHandler(void *);
     static void userRegexp(sqlite3_context* context, int argc, sqlite3_value** argv);
 
@@ -128,10 +248,26 @@ public:
     // Gets the mimetype corresponding to the file extension
     static void userGetMimetype(sqlite3_context* context, int argc, sqlite3_value** argv);
 
+    // Method called when query uses 'naturalsortkey'
+    // Gets the naturalsorting_key() of a name, to fill column nameKey of old rows
+    static void userNaturalSortKey(sqlite3_context* context, int argc, sqlite3_value** argv);
+
     // Method called when query uses 'getSizeFromNodeCounter'
     // Gets the node size from node counter (blob)
     static void getSizeFromNodeCounter(sqlite3_context* context, int argc, sqlite3_value** argv);
 
+    // Method called when query uses 'getFieldFromNodeCounter'
+    // Gets a field of the node counter (blob), by its NodeCounterField
+    static void getFieldFromNodeCounter(sqlite3_context* context, int argc, sqlite3_value** argv);
+    enum NodeCounterField
+    {
+        NODE_COUNTER_STORAGE = 0,
+        NODE_COUNTER_VERSION_STORAGE,
+        NODE_COUNTER_FILES,
+        NODE_COUNTER_FOLDERS,
+        NODE_COUNTER_VERSIONS,
+    };
+
     /**
      * @brief This method is designed to apply all the filtering options in various methods that
      * perform a query to the database and use a NodeSearchFilter object.
@@ -149,8 +285,174 @@ private:
                                     std::set<std::string>& tags,
                                     std::function<bool(const std::string&)> isValidTagF);
 
+    // Column values of a row of the nodes table, as written by put()
+    struct NodeRow
+    {
+        // the node blob (for table nodeblobs) can be left for the caller to fill ('serializeNode' false)
+        NodeRow(const Node& node, bool serializeNode);
+
+        handle nodehandle;
+        handle parenthandle;
+        std::string name;
+        // naturalsorting_key() of 'name', so ORDER BY name in natural order needs no collation
+        std::string nameKey;
+        std::string fingerprint;
+        std::string origFingerprint;
+        int type;
+        int shareType;
+        int fav;
+        m_time_t ctime;
+        m_time_t mtime;
+        uint64_t flags;
+        std::string counter;
+        std::string serialized;
+        // size of 'serialized' before encodeNodeBlob()
+        size_t rawSize = 0;
+        int blobEncoding = NODE_BLOB_RAW;
+        int label;
+        std::optional<std::string> description;
+        std::optional<std::string> tags;
+    };
+    // columns of table nodes, the blob goes to nodeblobs
+    static constexpr int NODE_ROW_COLUMNS = 16;
+    // rows per statement of the bulk put(): 992 variables, below the SQLite default limit (999)
+    static constexpr size_t NODE_ROWS_PER_INSERT = 62;
+
+    // binds 'row' to the NODE_ROW_COLUMNS placeholders starting at 'first'
+    static void bindNodeRow(sqlite3_stmt* stmt, int first, const NodeRow& row);
+    static std::string putNodesSql(size_t numRows);
+    static std::string putNodeBlobsSql(size_t numRows);
+    // writes 1 or NODE_ROWS_PER_INSERT rows to tables nodes and nodeblobs
+    bool putNodeRows(const NodeRow* rows, size_t numRows);
+
+    // table nodesfts exists, so it's kept in sync with table nodes. Its texts are folded the
+    // same way as likeCompare() does, so the literals of patterns can be looked up
+    bool mFullTextIndex = false;
+    bool putFullTextRow(handle nodehandle,
+                        const std::optional<std::string>& name,
+                        const std::optional<std::string>& description,
+                        const std::optional<std::string>& tags);
+    bool removeFullTextRow(handle nodehandle);
+    // FTS5 query for the nodes that could match the text filters of 'filter', which
+    // matchFilter() still checks. Empty if they can't be narrowed
+    std::string getFullTextQuery(const NodeSearchFilter& filter) const;
+
+    // table nodechanges exists, so the changes of nodes are appended to it
+    bool mChangeJournal = false;
+
+    // compression of the blobs written from now on (the ones already stored are kept)
+    bool mCompressNodeBlobs = false;
+    DBBlobStats mBlobStats;
+    // smaller blobs rarely compress enough to pay for the decompression
+    static constexpr size_t MIN_COMPRESSED_BLOB_SIZE = 256;
+    // compresses 'blob' if 'compress' and it's worth it. Returns its NodeBlobEncoding
+    static int encodeNodeBlob(std::string& blob, bool compress);
+    // decodeNodeBlob(), accounting the cost in 'mBlobStats'
+    bool readNodeBlob(const void* data, int size, int encoding, std::string& blob);
+
+    // table nodecounters is kept up to date (its triggers are dropped in bulk load mode)
+    bool mNodeCounters = false;
+    void setNodeCountersEnabled(bool enabled);
+    static void dropNodeCounterTriggers(sqlite3* db);
+
+    // settings replaced while in bulk load mode
+    bool mBulkLoad = false;
+    int mSynchronousBeforeBulkLoad = 2; // FULL
+    int64_t mCacheSizeBeforeBulkLoad = -2000; // SQLite's default (KiB)
+
+    // Connection and prepared statements for the queries that can run on a read-only connection
+    struct ReadConnection
+    {
+        sqlite3* db = nullptr;
+        std::map<size_t, sqlite3_stmt*> stmtGetChildren;
+        std::map<size_t, sqlite3_stmt*> stmtSearchNodes;
+        sqlite3_stmt* stmtNodesByFp = nullptr;
+        sqlite3_stmt* stmtNodeByFp = nullptr;
+        sqlite3_stmt* stmtVersions = nullptr;
+        sqlite3_stmt* stmtRecents = nullptr;
+        sqlite3_stmt* stmtNodeBlob = nullptr;
+
+        void finalise();
+    };
+
+    bool processSqlQueryNodes(sqlite3_stmt* stmt, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>& nodes, ReadConnection& connection);
+
+    // Appends the node of the current row of a query returning (nodehandle, counter, ...), with
+    // its blob from table nodeblobs (so it's only read for the rows that the query returns)
+    void appendSqlRowNode(sqlite3_stmt* stmt, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>& nodes, ReadConnection& connection);
+
+    // Read-only connections to the same DB file. In WAL mode, they run queries while the primary
+    // connection is writing or committing, instead of queueing behind it
+    class ReadConnectionPool
+    {
+    public:
+        // up to 'maxConnections' are opened on demand from 'path'
+        void enable(const LocalPath& path, size_t maxConnections);
+        bool enabled() const;
+
+        // waits until a connection is available. Returns nullptr if none can be opened
+        ReadConnection* acquire();
+        void release(ReadConnection* connection);
+        void countPrimary();
+
+        // closes all connections. None of them can be in use
+        void close();
+
+        DBReadPoolStats stats(bool reset);
+
+    private:
+        mutable std::mutex mMutex;
+        std::condition_variable mReleased;
+        LocalPath mPath;
+        size_t mMaxConnections = 0;
+        std::vector<std::unique_ptr<ReadConnection>> mConnections;
+        std::vector<ReadConnection*> mIdle;
+        DBReadPoolStats mStats;
+
+        sqlite3* open() const;
+    };
+
+    // Returns a read connection to the pool when it goes out of scope
+    class ReadLease
+    {
+    public:
+        ReadLease(ReadConnectionPool* pool, ReadConnection* connection);
+        ~ReadLease();
+        ReadLease(ReadLease&& other) noexcept;
+        ReadLease(const ReadLease&) = delete;
+        ReadLease& operator=(const ReadLease&) = delete;
+        ReadLease& operator=(ReadLease&&) = delete;
+
+        ReadConnection& operator*() const
+        {
+            return *mConnection;
+        }
+
+    private:
+        ReadConnectionPool* mPool;
+        ReadConnection* mConnection;
+    };
+
+    // The pool is only used when the nodes table has no uncommitted changes, which a read-only
+    // connection wouldn't see. Callers serialize node writes and reads (see NodeManager), so
+    // no node can be written while a pooled query runs
+    ReadLease acquireReadConnection();
+    void nodesWritten();
+
+    static constexpr size_t MAX_READ_CONNECTIONS = 2;
+    ReadConnectionPool mReadPool;
+    ReadConnection mPrimaryReads;
+    std::atomic<bool> mPendingNodeWrites{false};
+
     // if add a new sqlite3_stmt update finalise()
     sqlite3_stmt* mStmtPutNode = nullptr;
+    sqlite3_stmt* mStmtPutNodes = nullptr;
+    sqlite3_stmt* mStmtPutNodeBlob = nullptr;
+    sqlite3_stmt* mStmtPutNodeBlobs = nullptr;
+    sqlite3_stmt* mStmtPutFullText = nullptr;
+    sqlite3_stmt* mStmtDelFullText = nullptr;
+    sqlite3_stmt* mStmtPutNodeChange = nullptr;
+    sqlite3_stmt* mStmtGetNodeChanges = nullptr;
     sqlite3_stmt* mStmtUpdateNode = nullptr;
     sqlite3_stmt* mStmtUpdateNodeAndFlags = nullptr;
     sqlite3_stmt* mStmtTypeAndSizeNode = nullptr;
@@ -160,22 +462,50 @@ private:
     sqlite3_stmt* mStmtChildrenFromType = nullptr;
 
     sqlite3_stmt* mStmtNumChildren = nullptr;
-    std::map<size_t, sqlite3_stmt*> mStmtGetChildren;
-    std::map<size_t, sqlite3_stmt*> mStmtSearchNodes;
+    sqlite3_stmt* mStmtFolderCounter = nullptr;
+    std::map<size_t, sqlite3_stmt*> mStmtGetChildrenFrom;
+    sqlite3_stmt* mStmtGetSubtree = nullptr;
     sqlite3_stmt* mStmtAllNodeTags = nullptr;
 
-    sqlite3_stmt* mStmtNodesByFp = nullptr;
-    sqlite3_stmt* mStmtNodeByFp = nullptr;
     sqlite3_stmt* mStmtNodeByOrigFp = nullptr;
     sqlite3_stmt* mStmtChildNode = nullptr;
     sqlite3_stmt* mStmtIsAncestor = nullptr;
     sqlite3_stmt* mStmtNumChild = nullptr;
-    sqlite3_stmt* mStmtRecents = nullptr; // For getRecentNodes()
     sqlite3_stmt* mStmtFavourites = nullptr;
 
     // how many SQLite instructions will be executed between callbacks to the progress handler
     // (tests with a value of 1000 results on a callback every 1.2ms on a desktop PC)
     static const int NUM_VIRTUAL_MACHINE_INSTRUCTIONS = 1000;
+
+    // queries taking longer are logged as warnings
+    static constexpr std::chrono::milliseconds SLOW_QUERY_THRESHOLD{100};
+
+    // Registers the progress handler of a query on 'connection' while in scope, according to
+    // its DBQueryOptions, and logs its runtime, rows scanned and rows returned when done
+    class QueryMonitor
+    {
+    public:
+        QueryMonitor(sqlite3* connection, const char* operation, const DBQueryOptions& options);
+        ~QueryMonitor();
+
+        // statement whose scan counters are logged (the last one set)
+        void setStatement(sqlite3_stmt* stmt);
+        void setRowsReturned(size_t rows)
+        {
+            mRowsReturned = rows;
+        }
+
+        // true if the query has to be interrupted now
+        bool interrupt();
+
+    private:
+        sqlite3* mConnection;
+        const char* mOperation;
+        const DBQueryOptions& mOptions;
+        sqlite3_stmt* mStmt = nullptr;
+        size_t mRowsReturned = 0;
+        std::chrono::steady_clock::time_point mStart;
+    };
 };
 
 class MEGA_API SqliteDbAccess : public DbAccess
@@ -299,6 +629,11 @@ private:
     bool stripExistingColumns(sqlite3* db, vector<NewColumn>& cols);
     bool addColumn(sqlite3* db, const string& name, const string& type);
     bool migrateDataToColumns(sqlite3* db, vector<NewColumn>&& cols);
+
+    static bool hasColumn(sqlite3* db, const string& table, const string& name);
+    // moves the node blobs of DBs created before table nodeblobs, rebuilding table nodes with
+    // 'createSplitTable' (which creates it as nodes_split)
+    bool moveNodeBlobs(sqlite3* db, const string& createSplitTable, bool& moved);
 };
 
 class OrderByClause
@@ -307,6 +642,10 @@ public:
     static std::string get(int order);
     static size_t getId(int order);
 
+    // Sort keys of 'order' as (expression, descending), ending with nodehandle so that the order
+    // is total, as keyset paging requires. NULLs are mapped to default values so they can be compared
+    static std::vector<std::pair<std::string, bool>> getKeys(int order);
+
     enum {
         DEFAULT_ASC = 1, DEFAULT_DESC,
         SIZE_ASC, SIZE_DESC,
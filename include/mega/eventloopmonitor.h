@@ -0,0 +1,176 @@
+/**
+ * @file mega/eventloopmonitor.h
+ * @brief Time accounting and slow-slice detection for the client thread
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_EVENTLOOPMONITOR_H
+#define MEGA_EVENTLOOPMONITOR_H 1
+
+#include "name_id.h"
+#include "types.h"
+
+#include <array>
+#include <atomic>
+#include <deque>
+
+namespace mega {
+
+// Where the client thread's time goes, and what held it up.
+//
+// Each phase of the SDK loop (exec, preparewait, the wait itself...) is timed by a Scope and
+// kept in a power-of-two histogram. The outermost scope is a slice: nothing else runs on the
+// thread until it ends. Within a slice, the work that can be named (a command's response, an
+// action packet, a request) is timed by a Task, and a slice that overruns the threshold is
+// logged and remembered together with the longest task it ran.
+//
+// Scopes and tasks are only used on the client thread, the results may be read from any.
+class MEGA_API EventLoopMonitor
+{
+public:
+    enum Phase
+    {
+        PHASE_EXEC,
+        PHASE_PREPARE_WAIT,
+        PHASE_WAIT,
+        PHASE_CHECK_EVENTS,
+        PHASE_CS_RESPONSE,
+        PHASE_SC_PROCESSING,
+        PHASE_SYNC_ACTIONS,
+        PHASE_SEND_REQUESTS,
+        PHASE_SEND_TRANSFERS,
+        NUM_PHASES
+    };
+
+    static const char* phaseName(Phase phase);
+
+    // Bucket i counts the durations under 2^i microseconds that no lower bucket did,
+    // the last one anything longer.
+    static constexpr size_t NUM_BUCKETS = 24;
+
+    // the most recent slow slices are kept, the oldest dropped first
+    static constexpr size_t MAX_SLOW_SLICES = 32;
+
+    static constexpr unsigned DEFAULT_SLOW_THRESHOLD_MS = 1000;
+
+    struct PhaseStats
+    {
+        std::array<uint64_t, NUM_BUCKETS> buckets{};
+        uint64_t count = 0;
+        std::chrono::microseconds total{0};
+        std::chrono::microseconds longest{0};
+    };
+
+    struct SlowSlice
+    {
+        m_time_t when = 0;
+        Phase phase = PHASE_EXEC;
+        std::chrono::microseconds duration{0};
+
+        // the longest task within the slice, if it ran any
+        string taskKind;
+        string taskName;
+        std::chrono::microseconds taskDuration{0};
+    };
+
+    // Times a phase until it goes out of scope.
+    class MEGA_API Scope
+    {
+    public:
+        Scope(EventLoopMonitor& monitor, Phase phase);
+        ~Scope();
+
+        MEGA_DISABLE_COPY_MOVE(Scope)
+
+    private:
+        EventLoopMonitor& mMonitor;
+        Phase mPhase;
+        std::chrono::steady_clock::time_point mStarted;
+    };
+
+    // Names the work done until it goes out of scope, in case its slice turns out to be slow.
+    // The kind and name are not copied unless needed, so they must outlive the task.
+    class MEGA_API Task
+    {
+    public:
+        Task(EventLoopMonitor& monitor, const char* kind, const char* name);
+
+        // for action packets, named by their type
+        Task(EventLoopMonitor& monitor, const char* kind, nameid name);
+
+        ~Task();
+
+        MEGA_DISABLE_COPY_MOVE(Task)
+
+    private:
+        EventLoopMonitor& mMonitor;
+        const char* mKind;
+        const char* mName;
+        nameid mNameId = 0;
+        bool mActive;
+        std::chrono::steady_clock::time_point mStarted;
+    };
+
+    EventLoopMonitor() = default;
+
+    MEGA_DISABLE_COPY_MOVE(EventLoopMonitor)
+
+    // 0 stops looking for slow slices
+    void setSlowThreshold(std::chrono::milliseconds threshold);
+    std::chrono::milliseconds slowThreshold() const;
+
+    PhaseStats phaseStats(Phase phase) const;
+    vector<SlowSlice> slowSlices() const;
+
+    // Everything above, as a JSON document, optionally starting afresh afterwards.
+    string toJson(bool reset);
+
+    void reset();
+
+private:
+    struct Histogram
+    {
+        std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> totalUs{0};
+        std::atomic<uint64_t> longestUs{0};
+    };
+
+    void enter(Phase phase);
+    void leave(Phase phase, std::chrono::steady_clock::time_point started);
+    void taskDone(const char* kind, const char* name, nameid id, std::chrono::microseconds elapsed);
+
+    bool inSlice() const { return mDepth > 0; }
+
+    std::array<Histogram, NUM_PHASES> mPhases;
+
+    std::atomic<unsigned> mSlowThresholdMs{DEFAULT_SLOW_THRESHOLD_MS};
+
+    // The slice in progress, on the client thread only.
+    unsigned mDepth = 0;
+    const char* mLongestTaskKind = nullptr;
+    string mLongestTaskName;
+    std::chrono::microseconds mLongestTask{0};
+
+    mutable std::mutex mSlowSlicesMutex;
+    std::deque<SlowSlice> mSlowSlices;
+};
+
+} // namespace
+
+#endif
@@ -213,6 +213,9 @@ struct SyncTransfer_inClient: public File
 
     // Whether the terminated SyncTransfer_inClient was already notified to the apps/in the logs
     std::atomic<bool> terminatedReasonAlreadyKnown{false};
+
+    // when the sync asked for it, for telemetry
+    std::chrono::steady_clock::time_point queuedAt = std::chrono::steady_clock::now();
 };
 
 struct SyncDownload_inClient: public SyncTransfer_inClient
@@ -0,0 +1,75 @@
+/**
+ * @file mega/fileattributecache.h
+ * @brief On-disk cache of fetched and generated file attributes
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_FILEATTRIBUTECACHE_H
+#define MEGA_FILEATTRIBUTECACHE_H 1
+
+#include "filesystem.h"
+#include "types.h"
+
+namespace mega {
+
+// Decrypted thumbnails and previews, one file per attribute named after its file attribute
+// handle. The handle identifies the attribute's content, so nodes sharing an attribute share
+// the entry and a node whose attribute changes simply refers to another one. Once the cache
+// grows past its capacity the least recently used entries are removed; the access times
+// survive restarts as the files' modification times.
+class MEGA_API FileAttributeCache
+{
+public:
+    static constexpr m_off_t DEFAULT_CAPACITY = 64 * 1024 * 1024;
+
+    FileAttributeCache(FileSystemAccess& fsAccess, const LocalPath& folder, m_off_t capacity = DEFAULT_CAPACITY);
+
+    // the attribute's content, if cached
+    bool get(handle fah, string& data);
+
+    void put(handle fah, const string& data);
+
+    // removes every entry, on logout
+    void clear();
+
+    m_off_t size() const { return mSize; }
+
+private:
+    struct Entry
+    {
+        m_off_t size = 0;
+        list<handle>::iterator position;
+    };
+
+    LocalPath path(handle fah) const;
+
+    void remove(map<handle, Entry>::iterator it);
+
+    FileSystemAccess& mFsAccess;
+    LocalPath mFolder;
+    m_off_t mCapacity;
+    m_off_t mSize = 0;
+
+    // most recently used first
+    list<handle> mRecency;
+    map<handle, Entry> mEntries;
+};
+
+} // namespace
+
+#endif
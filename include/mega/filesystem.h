@@ -553,8 +553,12 @@ class FileDistributor
     m_time_t mMtime;
     FileFingerprint confirmFingerprint;
 
+    // extra targets that don't exist yet become hard links instead of copies,
+    // so they share the content: a change through one path shows in all of them
+    bool mHardLinks;
+
 public:
-    FileDistributor(const LocalPath& lp, size_t ntargets, m_time_t mtime, const FileFingerprint& confirm);
+    FileDistributor(const LocalPath& lp, size_t ntargets, m_time_t mtime, const FileFingerprint& confirm, bool hardLinks = false);
     ~FileDistributor();
 
     enum TargetNameExistsResolution {
@@ -767,6 +771,13 @@ struct MEGA_API FileAccess
     // Truncate a file.
     virtual bool ftruncate(m_off_t size = 0) = 0;
 
+    // Reserve disk blocks for size bytes without changing the visible size,
+    // so the content can be written out of order into contiguous extents.
+    virtual bool fpreallocate(m_off_t) { return false; }
+
+    // Extend the file to size bytes without allocating the gaps.
+    virtual bool fsparse(m_off_t) { return false; }
+
     FileAccess(Waiter *waiter);
     virtual ~FileAccess();
 
@@ -901,6 +912,7 @@ public:
 
 // For directoryScan(...).
 struct MEGA_API FSNode;
+class MEGA_API FingerprintCache;
 
 // generic host filesystem access interface
 struct MEGA_API FileSystemAccess : public EventTrigger
@@ -949,6 +961,9 @@ struct MEGA_API FileSystemAccess : public EventTrigger
     // copy file, overwrite target, set mtime
     virtual bool copylocal(const LocalPath&, const LocalPath&, m_time_t) = 0;
 
+    // add another name for an existing file, the target must not exist
+    virtual bool hardlinklocal(const LocalPath&, const LocalPath&) { return false; }
+
     // delete file
     virtual bool unlinklocal(const LocalPath&) = 0;
 
@@ -1026,15 +1041,27 @@ struct MEGA_API FileSystemAccess : public EventTrigger
     // True if the filesystem indicated by the specified path has stable FSIDs.
     virtual bool fsStableIDs(const LocalPath& path) const = 0;
 
+    // Whether the filesystem indicated by the specified path is on a device without a seek penalty.
+    // False if the platform can't tell, solidState is only set on success.
+    virtual bool fsSolidState(const LocalPath& path, bool& solidState) const;
+
+    // Moves the calling thread's disk I/O to the idle (background) class, or back to normal,
+    // so that scanning and fingerprinting yield to whatever else is using the disk.
+    // False if the platform can't.
+    virtual bool setBackgroundIO(bool background);
+
     virtual bool initFilesystemNotificationSystem();
 #endif // ENABLE_SYNC
 
+    // Files that aren't in known are looked up in fingerprints, if any, before being read.
+    // A known entry that doesn't match means the file must be read again.
     virtual ScanResult directoryScan(const LocalPath& path,
                                      handle expectedFsid,
                                      map<LocalPath, FSNode>& known,
                                      std::vector<FSNode>& results,
                                      bool followSymLinks,
-                                     unsigned& nFingerprinted) = 0;
+                                     unsigned& nFingerprinted,
+                                     FingerprintCache* fingerprints) = 0;
 
     // Retrieve the FSID of the item at the specified path.
     // UNDEF is returned if we cannot determine the item's FSID.
@@ -1185,6 +1212,28 @@ private:
     string toName_of_localname_cached;
 };
 
+// Fingerprints known for the files of one filesystem, by fsid.
+// A file found anywhere (after a move, say) with the same fsid, size and mtime
+// has the same content for our purposes, so there's no need to read it again.
+class MEGA_API FingerprintCache
+{
+public:
+    // The oldest entries are dropped beyond this many.
+    static const size_t MAX_ENTRIES;
+
+    // True, with the node's fingerprint filled in, if there is one for its fsid, size and mtime.
+    bool reuse(FSNode& node);
+
+    void add(handle fsid, const FileFingerprint& fingerprint);
+
+private:
+    std::mutex mMutex;
+    std::unordered_map<handle, FileFingerprint> mFingerprints;
+
+    // In order of addition, for dropping entries.
+    std::deque<handle> mAdded;
+};
+
 class MEGA_API ScanService
 {
 public:
@@ -1199,7 +1248,9 @@ public:
             bool followSymlinks,
             LocalPath targetPath,
             handle expectedFsid,
-            map<LocalPath, FSNode>&& priorScanChildren);
+            map<LocalPath, FSNode>&& priorScanChildren,
+            bool interactive,
+            bool backgroundIO);
 
         MEGA_DISABLE_COPY_MOVE(ScanRequest);
 
@@ -1223,6 +1274,23 @@ public:
             return mExpectedFsid;
         }
 
+        // Files of the scan that had to be read, and those whose fingerprint was reused.
+        unsigned fingerprintsComputed() const
+        {
+            return mFingerprintsComputed;
+        }
+
+        unsigned fingerprintsReused() const
+        {
+            return mFingerprintsReused;
+        }
+
+        // Time the worker spent on the scan.
+        std::chrono::steady_clock::duration scanTime() const
+        {
+            return mScanTime;
+        }
+
     private:
         friend class ScanService;
 
@@ -1247,17 +1315,39 @@ public:
         // fsid that the target path should still referene
         handle mExpectedFsid;
 
+        // Whether the user is likely waiting on this folder, so it's scanned ahead of the others.
+        const bool mInteractive;
+
+        // Whether the worker should do the scan's I/O at background priority.
+        const bool mBackgroundIO;
+
+        unsigned mFingerprintsComputed = 0;
+        unsigned mFingerprintsReused = 0;
+        std::chrono::steady_clock::duration mScanTime{};
+
     }; // ScanRequest
 
     // For convenience.
     using RequestPtr = std::shared_ptr<ScanRequest>;
 
-    // Issue a scan for the given target.
-    RequestPtr queueScan(LocalPath targetPath, handle expectedFsid, bool followSymlinks, map<LocalPath, FSNode>&& priorScanChildren, shared_ptr<Waiter> waiter);
+    // Issue a scan for the given target, on the workers of the filesystem containing it.
+    RequestPtr queueScan(const fsfp_t& fsfp, LocalPath targetPath, handle expectedFsid, bool followSymlinks, map<LocalPath, FSNode>&& priorScanChildren, shared_ptr<Waiter> waiter, bool interactive = false, bool backgroundIO = false);
+
+    // How many folders of the filesystem at path can be scanned at once, starting its workers if need be.
+    unsigned workerThreads(const fsfp_t& fsfp, const LocalPath& path);
+
+    // Fingerprints known for the filesystem, nullptr if it has no workers yet.
+    // Valid for as long as this service.
+    FingerprintCache* fingerprintCache(const fsfp_t& fsfp);
 
     // Track performance (debug only)
     static CodeCounter::ScopeStats syncScanTime;
 
+    // Worker threads per filesystem, so folders in different subtrees can be scanned (and fingerprinted) at the same time.
+    // Spinning disks and network filesystems get a single thread, as concurrent scans would only make them seek.
+    static const unsigned SOLID_STATE_WORKER_THREADS;
+    static const unsigned UNKNOWN_DEVICE_WORKER_THREADS;
+
 private:
        // Convenience.
     using ScanRequestPtr = std::shared_ptr<ScanRequest>;
@@ -1272,18 +1362,23 @@ private:
 
         MEGA_DISABLE_COPY_MOVE(Worker);
 
-        // Queues a scan request for processing.
+        // Queues a scan request for processing, interactive requests ahead of the others.
         void queue(ScanRequestPtr request);
 
+        size_t numThreads() const
+        {
+            return mThreads.size();
+        }
+
+        // Shared by the threads, they all scan the same filesystem.
+        FingerprintCache mFingerprints;
+
     private:
         // Thread entry point.
         void loop();
 
-        // Processes a scan request.
-        ScanResult scan(ScanRequestPtr request, unsigned& nFingerprinted);
-
-        // Filesystem access.
-        std::unique_ptr<FileSystemAccess> mFsAccess;
+        // Processes a scan request, each thread has its own filesystem access.
+        ScanResult scan(ScanRequestPtr request, FileSystemAccess& fsAccess, unsigned& nFingerprinted);
 
         // Pending scan requests.
         std::deque<ScanRequestPtr> mPending;
@@ -1299,8 +1394,8 @@ private:
     // How many services are currently active.
     static std::atomic<size_t> mNumServices;
 
-    // Worker shared by all services.
-    static std::unique_ptr<Worker> mWorker;
+    // Workers shared by all services, one per filesystem.
+    static std::map<fsfp_t, std::unique_ptr<Worker>> mWorkers;
 
     // Synchronizes access to the above.
     static std::mutex mWorkerLock;
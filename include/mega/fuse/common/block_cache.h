@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mega/fuse/common/block_cache_forward.h>
+#include <mega/fuse/common/error_or_forward.h>
+
+#include <mega/filesystem.h>
+#include <mega/types.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+// Tracks which parts of a cloud file's content are present locally.
+//
+// Content is stored in a sparse file beside where the file's complete
+// content would live in the cache. Which blocks are present is recorded
+// in a small sidecar file so that fetched content survives a remount.
+class BlockCache
+{
+    BlockCache(FileAccessPtr content,
+               FileAccessPtr blocks,
+               FileSystemAccess& fsAccess,
+               LocalPath path,
+               NodeHandle handle,
+               m_off_t size);
+
+    // Persist which blocks are present.
+    bool flush();
+
+    // How many blocks does our file span?
+    std::size_t numBlocks() const;
+
+    // Where we store the file's content.
+    FileAccessPtr mContent;
+
+    // Where we record which blocks are present.
+    FileAccessPtr mBlocks;
+
+    // How we manipulate files on disk.
+    FileSystemAccess& mFSAccess;
+
+    // Which node's content are we caching?
+    NodeHandle mHandle;
+
+    // How many blocks are present?
+    std::size_t mNumPresent;
+
+    // Where would the file's complete content be stored?
+    LocalPath mPath;
+
+    // Which blocks are present?
+    std::vector<std::uint8_t> mPresent;
+
+    // How large is the file?
+    m_off_t mSize;
+
+public:
+    // How large is each block?
+    static constexpr m_off_t BlockSize = 1 << 20;
+
+    // A range of content [begin, end).
+    using Range = std::pair<m_off_t, m_off_t>;
+
+    ~BlockCache();
+
+    // Start or resume caching a node's content.
+    //
+    // Path is where the file's complete content would be stored.
+    static ErrorOr<BlockCachePtr> open(FileSystemAccess& fsAccess,
+                                       const LocalPath& path,
+                                       NodeHandle handle,
+                                       m_off_t size);
+
+    // Where is the node's partial content stored?
+    static LocalPath contentPath(const LocalPath& path);
+
+    // Where is the node's block bitmap stored?
+    static LocalPath blocksPath(const LocalPath& path);
+
+    // Does a cache file hold partial content?
+    static bool partial(const LocalPath& name);
+
+    // Remove any partial content stored for a file.
+    static void remove(FileSystemAccess& fsAccess, const LocalPath& path);
+
+    // Are all of the file's blocks present?
+    bool complete() const;
+
+    // Where is the content that's present locally?
+    FileAccess& content() const;
+
+    // Which block-aligned ranges must be fetched to read [offset, offset + length)?
+    std::vector<Range> missing(m_off_t offset, m_off_t length) const;
+
+    // Promote our content to the path of the file's complete content.
+    //
+    // Only valid when the cache is complete.
+    bool promote(m_time_t modified);
+
+    // Store fetched content.
+    //
+    // Offset must lie on a block boundary.
+    Error write(const std::string& content, m_off_t offset);
+}; // BlockCache
+
+} // fuse
+} // mega
+
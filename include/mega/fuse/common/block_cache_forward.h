@@ -0,0 +1,16 @@
+#pragma once
+
+#include <memory>
+
+namespace mega
+{
+namespace fuse
+{
+
+class BlockCache;
+
+using BlockCachePtr = std::unique_ptr<BlockCache>;
+
+} // fuse
+} // mega
+
@@ -134,6 +134,12 @@ public:
     // Query who a node's parent is.
     virtual NodeHandle parentHandle(NodeHandle handle) const = 0;
 
+    // Download part of a file's content from the cloud.
+    virtual void partialDownload(PartialDownloadCallback callback,
+                                 NodeHandle handle,
+                                 m_off_t offset,
+                                 m_off_t length) = 0;
+
     // What permissions are applicable to a node?
     virtual accesslevel_t permissions(NodeHandle handle) const = 0;
 
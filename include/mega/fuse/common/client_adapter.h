@@ -127,6 +127,12 @@ public:
     // Query who a node's parent is.
     NodeHandle parentHandle(NodeHandle handle) const override;
 
+    // Download part of a file's content from the cloud.
+    void partialDownload(PartialDownloadCallback callback,
+                         NodeHandle handle,
+                         m_off_t offset,
+                         m_off_t length) override;
+
     // What permissions are applicable to a node?
     accesslevel_t permissions(NodeHandle handle) const override;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <string>
 #include <utility>
 
 #include <mega/fuse/common/error_or_forward.h>
@@ -23,6 +24,9 @@ using MakeDirectoryCallback =
 using MoveCallback =
   std::function<void(Error)>;
 
+using PartialDownloadCallback =
+  std::function<void(ErrorOr<std::string>)>;
+
 using RemoveCallback =
   std::function<void(Error)>;
 
@@ -43,6 +43,9 @@ public:
     // Return a specialized reference to this directory.
     DirectoryInodeRef directory() override;
 
+    // Roughly how much memory does this directory occupy?
+    std::size_t footprint() const override;
+
     // Try and retrieve a reference to the specified child.
     InodeRef get(const std::string& name) const;
 
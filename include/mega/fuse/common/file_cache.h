@@ -1,11 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 
 #include <mega/fuse/common/bind_handle_forward.h>
 #include <mega/fuse/common/client_forward.h>
 #include <mega/fuse/common/error_or_forward.h>
 #include <mega/fuse/common/file_cache_forward.h>
+#include <mega/fuse/common/file_cache_statistics_forward.h>
 #include <mega/fuse/common/file_extension_db_forward.h>
 #include <mega/fuse/common/file_info_forward.h>
 #include <mega/fuse/common/file_inode_forward.h>
@@ -14,6 +18,7 @@
 #include <mega/fuse/common/lockable.h>
 #include <mega/fuse/common/mount_forward.h>
 #include <mega/fuse/common/task_executor_forward.h>
+#include <mega/fuse/common/task_queue.h>
 #include <mega/fuse/platform/service_context_forward.h>
 
 #include <mega/filesystem.h>
@@ -35,6 +40,12 @@ class FileCache
     friend class FileIOContext;
     friend class FileInfo;
 
+    // Record whether a read could be satisfied by the cache.
+    void accessed(InodeID id, bool hit);
+
+    // Called periodically to keep the cache within its quota.
+    void clean(const Task& task);
+
     // Create a new file description based on the file at the specified path.
     //
     // If create is false, this function will return a description only if
@@ -47,6 +58,11 @@ class FileCache
                                 FileAccessSharedPtr* fileAccess,
                                 bool create);
 
+    // Evict content until the cache's no larger than maxSize.
+    //
+    // Content below offline mounts is never evicted.
+    void evict(std::uint64_t maxSize);
+
     // Get a reference to an inode's file info.
     //
     // If no info is currently associated with the specified inode,
@@ -56,19 +72,42 @@ class FileCache
                      const FileAccess& fileAccess,
                      InodeID id);
 
+    // Fetch the content of every file below the specified mount.
+    void prefetch(NodeHandle mountHandle,
+                  const LocalPath& mountPath,
+                  const Task& task);
+
     // Remove context from the index.
     void remove(const FileIOContext& context, FileCacheLock lock);
 
     // Remove info from the index.
     void remove(const FileInfo& info, FileCacheLock lock);
 
+    // When was each inode's content last read?
+    FromInodeIDMap<std::chrono::steady_clock::time_point> mAccessed;
+
+    // How many background tasks are currently running?
+    std::size_t mActiveTasks;
+
+    // True when the cache should stop doing work in the background.
+    std::atomic<bool> mCancelled;
+
+    // Periodically evicts content when the cache's over its quota.
+    Task mCleanTask;
+
     // Tracks which context is associated with what inode.
     mutable ToFileIOContextPtrMap<InodeID> mContextByID;
 
+    // How many reads were satisfied by content in the cache?
+    std::atomic<std::uint64_t> mHits;
+
     // Tracks which info is associated with what inode.
     mutable ToFileInfoPtrMap<InodeID> mInfoByID;
 
-    // Signalled when a context or info instance is removed.
+    // How many reads had to fetch content from the cloud?
+    std::atomic<std::uint64_t> mMisses;
+
+    // Signalled when a context or info is removed or a task completes.
     std::condition_variable_any mRemoved;
 
 public:
@@ -119,9 +158,15 @@ public:
     // Where is an inode's local state located?
     LocalPath path(const FileExtension& extension, InodeID id) const;
 
+    // Fetch the content of every file below an offline mount.
+    void prefetch(const Mount& mount);
+
     // Remove an inode's content from the cache.
     void remove(const FileExtension& extension, InodeID id);
 
+    // How well has the cache been serving reads?
+    FileCacheStatistics statistics() const;
+
     // Where is the cache storing its data?
     const LocalPath mCachePath;
 
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include <mega/fuse/common/file_cache_flags_forward.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+struct FileCacheFlags
+{
+    // How often should the cache try to reduce its size?
+    std::chrono::seconds mCleanInterval = std::chrono::seconds(5 * 60);
+
+    // How many bytes of content is the cache allowed to store?
+    //
+    // Zero means the cache's size is unlimited.
+    std::uint64_t mMaxSize = 0u;
+}; // FileCacheFlags
+
+} // fuse
+} // mega
+
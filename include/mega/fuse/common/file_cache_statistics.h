@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+#include <mega/fuse/common/file_cache_statistics_forward.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+struct FileCacheStatistics
+{
+    // How many reads were satisfied by content in the cache?
+    std::uint64_t mHits = 0u;
+
+    // How many reads had to fetch content from the cloud?
+    std::uint64_t mMisses = 0u;
+}; // FileCacheStatistics
+
+} // fuse
+} // mega
+
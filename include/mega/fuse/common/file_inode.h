@@ -54,6 +54,9 @@ public:
     // Retrieve a reference to this file's file info.
     FileInfoRef fileInfo() const;
 
+    // Roughly how much memory does this file occupy?
+    std::size_t footprint() const override;
+
     // Specify which cloud node this file is associatd with.
     void handle(NodeHandle handle);
 
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <functional>
+#include <map>
 #include <mutex>
 #include <string>
 
+#include <mega/fuse/common/block_cache_forward.h>
 #include <mega/fuse/common/client_callbacks.h>
 #include <mega/fuse/common/error_or.h>
 #include <mega/fuse/common/file_cache_forward.h>
@@ -28,6 +33,17 @@ namespace mega
 namespace fuse
 {
 
+// Consumes content read from a file.
+//
+// The content lies within [offset, offset + size) of the file and is
+// only guaranteed to be available until the callback returns.
+//
+// The callback isn't called when there's no content to be read.
+using FileReadCallback =
+  std::function<Error(FileAccess& fileAccess,
+                      m_off_t offset,
+                      unsigned int size)>;
+
 template<>
 struct LockableTraits<FileIOContext>
 {
@@ -53,6 +69,17 @@ class FileIOContext
     // Convenience.
     using FlushContextPtr = std::shared_ptr<FlushContext>;
 
+    // How has the file's content been read recently?
+    enum class ReadPattern
+    {
+        // Reads land in no particular order.
+        RANDOM,
+        // Each read begins where the last one ended.
+        SEQUENTIAL,
+        // Reads are separated by gaps of the same size.
+        STRIDED
+    }; // ReadPattern
+
     // Create the file.
     ErrorOr<FileAccessSharedPtr> create();
 
@@ -62,6 +89,9 @@ class FileIOContext
     // How long should we wait before we flush modifications?
     std::chrono::seconds flushDelay() const;
 
+    // When should we flush the modifications made so far?
+    std::chrono::steady_clock::time_point flushTime() const;
+
     // Retrieve a reference to the inode DB.
     InodeDB& inodeDB() const;
 
@@ -73,7 +103,6 @@ class FileIOContext
 
     // Called when it's time to perform a queued flush.
     void onPeriodicFlush(FileIOContextRef& context,
-                         m_time_t lastModified,
                          NodeHandle mountHandle,
                          LocalPath& mountPath,
                          const Task& task);
@@ -89,6 +118,59 @@ class FileIOContext
               m_off_t hint = -1)
       -> ErrorOr<FileAccessSharedPtr>;
 
+    // Read data from a file whose content is only in the cloud.
+    //
+    // Only those blocks needed to satisfy the read are downloaded.
+    Error readPartial(m_off_t offset,
+                      unsigned int size,
+                      const FileReadCallback& callback);
+
+    // Fetch any missing content in [begin, end) in the background.
+    //
+    // The lock must hold mBlockLock and is released while the client is
+    // asked for the content.
+    void readAhead(std::unique_lock<std::mutex>& lock,
+                   m_off_t begin,
+                   m_off_t end);
+
+    // Called when content fetched in the background has arrived.
+    void readAheadCompleted(ErrorOr<std::string> content,
+                            m_off_t offset);
+
+    // Is any content in [begin, end) being fetched in the background?
+    //
+    // Assumes mBlockLock is held.
+    bool readingAhead(m_off_t begin, m_off_t end) const;
+
+    // Which blocks of the file's content are present locally?
+    //
+    // Only populated while the file has no complete local content.
+    BlockCachePtr mBlockCache;
+
+    // Signalled whenever content fetched in the background arrives.
+    std::condition_variable mBlockCV;
+
+    // Serializes access to mBlockCache and mRead* members.
+    std::mutex mBlockLock;
+
+    // How far beyond a sequential read should we fetch?
+    m_off_t mReadAhead;
+
+    // What content is being fetched in the background?
+    //
+    // Maps the beginning of each range to its end.
+    std::map<m_off_t, m_off_t> mReadAheads;
+
+    // Where did the last partial read end?
+    m_off_t mReadEnd;
+
+    // How has the file's content been read recently?
+    ReadPattern mReadPattern;
+
+    // How far did the last partial read begin from where its
+    // predecessor ended?
+    m_off_t mReadStride;
+
     // What file does this entry represent?
     FileInodeRef mFile;
 
@@ -113,6 +195,15 @@ class FileIOContext
     // True if we need to flush this file's content to the cloud.
     bool mFlushNeeded;
 
+    // When did the content first need to be flushed?
+    std::chrono::steady_clock::time_point mFlushNeededSince;
+
+    // When was the content last modified?
+    std::chrono::steady_clock::time_point mLastModified;
+
+    // How many modifications will the next flush upload?
+    unsigned long mModifications;
+
     // Represents a queued periodic flush, if any.
     Task mPeriodicFlushTask;
 
@@ -151,11 +242,22 @@ public:
     Error open(const Mount& mount,
                bool truncate);
 
+    // Make sure the file's content is present locally.
+    Error prefetch(const Mount& mount);
+
     // Read data from the file.
     ErrorOr<std::string> read(const Mount& mount,
                               m_off_t offset,
                               unsigned int size);
 
+    // Read data from the file without copying it.
+    //
+    // The callback is passed the file that holds the content.
+    Error read(const Mount& mount,
+               m_off_t offset,
+               unsigned int size,
+               const FileReadCallback& callback);
+
     // Increment this instance's reference count.
     void ref(RefBadge badge);
 
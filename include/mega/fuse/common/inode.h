@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <mutex>
@@ -55,10 +56,13 @@ class Inode
     virtual void remove(RefBadge badge, InodeDBLock lock) = 0;
 
     // Tracks how many actors reference this instance.
-    unsigned long mReferences;
+    //
+    // The count is only ever decremented while the InodeDB's lock is
+    // held but may be incremented by readers that don't hold it.
+    std::atomic<unsigned long> mReferences;
 
     // Has this inode been removed?
-    mutable bool mRemoved;
+    mutable std::atomic<bool> mRemoved;
 
 protected:
     Inode(InodeID id,
@@ -113,6 +117,12 @@ public:
     // returned.
     virtual FileInodeRef file();
 
+    // Roughly how much memory does this inode occupy?
+    //
+    // Must not acquire any locks as the inode cache may call this
+    // while the InodeDB's lock is held.
+    virtual std::size_t footprint() const = 0;
+
     // What cloud node, if any, is associated with this inode?
     virtual NodeHandle handle() const = 0;
 
@@ -175,6 +185,12 @@ public:
     // Replace other with this inode (assuming locks are not held.)
     Error replace(InodeRef other, bool replaceDirectories);
 
+    // Try and increment this instance's reference counter.
+    //
+    // Fails if the counter has already dropped to zero, meaning the
+    // instance is about to be removed from the inode database.
+    bool tryRef();
+
     // Unlink this inode (without taking any locks.)
     virtual Error unlink(InodeBadge badge) = 0;
 
@@ -1,15 +1,18 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <list>
-#include <map>
 #include <mutex>
 #include <thread>
 
 #include <mega/fuse/common/inode_cache_flags.h>
 #include <mega/fuse/common/inode_cache_forward.h>
+#include <mega/fuse/common/inode_cache_statistics_forward.h>
 #include <mega/fuse/common/inode_forward.h>
 #include <mega/fuse/common/inode_id_forward.h>
 
@@ -18,6 +21,15 @@ namespace mega
 namespace fuse
 {
 
+// Keeps recently accessed inodes in memory.
+//
+// The cache is split into shards, each guarded by its own lock, so that
+// kernel threads touching different inodes rarely contend.
+//
+// Entries are evicted using the CLOCK algorithm: Each shard's entries
+// form a ring swept by a hand. An entry that's been accessed since the
+// hand last passed it is given a second chance, otherwise it's evicted
+// if the cache is over its limits or the entry's old enough.
 class InodeCache
 {
     // Describes an inode in the cache.
@@ -25,35 +37,86 @@ class InodeCache
 
     using EntryList = std::list<Entry>;
     using EntryListIterator = EntryList::iterator;
-    using EntryPositionMap = std::map<InodeID, EntryListIterator>;
-    using EntryPositionMapIterator = EntryPositionMap::iterator;
+    using EntryPositionMap = FromInodeIDMap<EntryListIterator>;
 
     using Lock = std::unique_lock<std::mutex>;
 
+    // How many shards is the cache split into?
+    static constexpr std::size_t NumShards = 16;
+
+    // How many entries will the cleaner examine before releasing a shard?
+    static constexpr std::size_t SweepBatchSize = 32;
+
+    // A slice of the cache.
+    struct Shard
+    {
+        Shard();
+
+        // Describes each inode in this shard.
+        EntryList mEntries;
+
+        // The next entry the clock's hand will examine.
+        EntryListIterator mHand;
+
+        // Serializes access to this shard's members.
+        std::mutex mLock;
+
+        // Tracks where each inode can be found in this shard.
+        EntryPositionMap mPositions;
+    }; // Shard
+
+    // Has the cache grown beyond its limits?
+    bool exceeded(const InodeCacheFlags& flags) const;
+
     // Periodically tries to reduce the cache's size.
     void loop();
 
-    // Reduce the cache to the specified size.
+    // Try and reduce the cache to the size described by flags.
     //
-    // Only entries age or older are evicted.
-    InodeRefVector reduce(std::chrono::seconds age,
-                          Lock& lock,
-                          std::size_t size);
+    // Shards are swept a batch at a time so that no shard is locked for
+    // longer than it takes to examine a handful of entries.
+    void reduce(const InodeCacheFlags& flags);
+
+    // Which shard is responsible for the specified inode?
+    Shard& shard(InodeID id);
+
+    // Examine at most SweepBatchSize of a shard's entries.
+    //
+    // Returns the number of entries examined.
+    std::size_t sweep(const InodeCacheFlags& flags,
+                      InodeRefVector& evicted,
+                      std::chrono::steady_clock::time_point now,
+                      Shard& shard);
 
     // Wakes up the cleaner thread.
     std::condition_variable mCV;
 
-    // Describes each inode in the cache.
-    EntryList mEntries;
+    // How many inodes have been evicted from the cache?
+    std::atomic<std::uint64_t> mEvictions;
 
     // Dictates how we behave.
     InodeCacheFlags mFlags;
 
-    // Serializes access to class members.
+    // How many accesses were to inodes already in the cache?
+    std::atomic<std::uint64_t> mHits;
+
+    // Serializes access to mFlags and mReduce.
     mutable std::mutex mLock;
 
-    // Tracks where each inode can be found in the cache.
-    EntryPositionMap mPositions;
+    // Roughly how much memory do the cached inodes occupy?
+    std::atomic<std::size_t> mMemory;
+
+    // How many accesses were to inodes not yet in the cache?
+    std::atomic<std::uint64_t> mMisses;
+
+    // Signals the cleaner thread to reduce the cache's size.
+    bool mReduce;
+
+    // The shards that make up this cache.
+    std::array<Shard, NumShards> mShards;
+
+    // How many inodes are in the cache?
+    std::atomic<std::size_t> mSize;
 
     // Signals the cleaner thread to terminate.
     std::atomic<bool> mTerminate;
@@ -80,6 +143,9 @@ public:
 
     // Remove an inode from the cache.
     bool remove(const Inode& inode);
+
+    // How effective has the cache been?
+    InodeCacheStatistics statistics() const;
 }; // InodeCache
 
 } // fuse
@@ -21,6 +21,11 @@ struct InodeCacheFlags
     // Inodes can be evicted when the cache stores more than this value.
     std::size_t mCleanSizeThreshold = 64u;
 
+    // How much memory may the cached inodes occupy?
+    //
+    // Zero means the cache's memory use is unbounded.
+    std::size_t mMaxMemory = 0u;
+
     // How many inodes is the cache allowed to store?
     std::size_t mMaxSize = 256u;
 }; // InodeCacheFlags
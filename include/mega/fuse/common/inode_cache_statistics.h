@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <mega/fuse/common/inode_cache_statistics_forward.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+struct InodeCacheStatistics
+{
+    // How many inodes have been evicted from the cache?
+    std::uint64_t mEvictions = 0u;
+
+    // How many accesses were to inodes already in the cache?
+    std::uint64_t mHits = 0u;
+
+    // Roughly how much memory do the cached inodes occupy?
+    std::size_t mMemory = 0u;
+
+    // How many accesses were to inodes not yet in the cache?
+    std::uint64_t mMisses = 0u;
+
+    // How many inodes are in the cache?
+    std::size_t mSize = 0u;
+}; // InodeCacheStatistics
+
+} // fuse
+} // mega
+
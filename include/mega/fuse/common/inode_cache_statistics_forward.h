@@ -0,0 +1,12 @@
+#pragma once
+
+namespace mega
+{
+namespace fuse
+{
+
+struct InodeCacheStatistics;
+
+} // fuse
+} // mega
+
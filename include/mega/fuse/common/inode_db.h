@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <map>
 #include <mutex>
 #include <string>
@@ -20,6 +22,7 @@
 #include <mega/fuse/common/inode_db_forward.h>
 #include <mega/fuse/common/inode_forward.h>
 #include <mega/fuse/common/inode_id_forward.h>
+#include <mega/fuse/common/inode_index.h>
 #include <mega/fuse/common/lockable.h>
 #include <mega/fuse/common/node_event_forward.h>
 #include <mega/fuse/common/node_event_observer.h>
@@ -40,10 +43,25 @@ namespace mega
 namespace fuse
 {
 
+// Measures how contended the inode DB's lock is.
 template<>
 struct LockableTraits<InodeDB>
   : public LockableTraitsCommon<InodeDB, std::recursive_mutex>
 {
+    static void acquiring(const InodeDB& db);
+
+    static void acquired(const InodeDB& db);
+
+    static void couldntAcquire(const InodeDB& db);
+
+    // How many times has the lock been acquired?
+    static std::atomic<std::uint64_t> mAcquired;
+
+    // How many times did a thread have to wait for the lock?
+    static std::atomic<std::uint64_t> mContended;
+
+    // How long, in microseconds, have threads waited for the lock?
+    static std::atomic<std::uint64_t> mWaited;
 }; // LockableTraits<InodeDB>
 
 // Manages all inodes that are exposed to userspace.
@@ -132,9 +150,15 @@ class InodeDB final
         // Clear every inode's bind handle.
         Query mClearBindHandles;
 
+        // How many inodes are associated with a cloud node?
+        Query mCountCachedFiles;
+
         // What inodes are present under the specified node handle?
         Query mGetChildrenByParentHandle;
         
+        // What inodes are associated with a cloud node?
+        Query mGetCachedFiles;
+
         // What extension and ID is associated with the given node handle?
         Query mGetExtensionAndInodeIDByHandle;
 
@@ -331,6 +355,9 @@ class InodeDB final
     // Whether we should discard node events.
     bool mDiscard;
 
+    // Lets readers find in-memory inodes without acquiring our lock.
+    mutable InodeIndex mIndex;
+
     // What queries do we perform?
     mutable Queries mQueries;
 
@@ -368,6 +395,11 @@ public:
     // Discard node events.
     void discard(bool discard);
 
+    // Remove an unmodified inode's content from the cache.
+    //
+    // Returns true if the inode was removed from the database.
+    bool evict(InodeID id);
+
     // Check if an inode is in the database.
     bool exists(InodeID id) const;
 
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include <mega/fuse/common/inode_forward.h>
+#include <mega/fuse/common/inode_id_forward.h>
+#include <mega/fuse/common/inode_index_forward.h>
+#include <mega/fuse/common/shared_mutex.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+// Lets readers locate in-memory inodes without acquiring the InodeDB's lock.
+//
+// The index is split into shards, each guarded by its own lock, so that
+// readers rarely contend with one another and never wait for the InodeDB
+// to finish applying node events.
+//
+// The index never owns the inodes it refers to: Inodes are added and
+// removed by the InodeDB whenever they enter or leave memory.
+class InodeIndex
+{
+    // How many shards is the index split into?
+    static constexpr std::size_t NumShards = 16;
+
+    // A slice of the index.
+    struct Shard
+    {
+        // Tracks which inode is associated with what ID.
+        FromInodeIDMap<Inode*> mInodes;
+
+        // Serializes access to mInodes.
+        SharedMutex mLock;
+    }; // Shard
+
+    // Which shard is responsible for the specified inode?
+    Shard& shard(InodeID id) const;
+
+    // The shards that make up this index.
+    mutable std::array<Shard, NumShards> mShards;
+
+public:
+    InodeIndex();
+
+    ~InodeIndex();
+
+    // Add an inode to the index.
+    void add(Inode& inode);
+
+    // Retrieve a reference to an inode.
+    //
+    // A null reference is returned if the inode isn't in memory or if
+    // its last reference is being dropped.
+    InodeRef get(InodeID id) const;
+
+    // Remove an inode from the index.
+    void remove(InodeID id);
+}; // InodeIndex
+
+} // fuse
+} // mega
+
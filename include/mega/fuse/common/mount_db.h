@@ -36,6 +36,7 @@ struct LockableTraits<MountDB>
 class MountDB
   : public Lockable<MountDB>
 {
+    friend class FileCache;
     friend class platform::Mount;
 
     // Bundles up all of the MountDB's queries.
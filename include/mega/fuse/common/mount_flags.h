@@ -22,6 +22,7 @@ struct MountFlags
 
     std::string mName;
     bool mEnableAtStartup = false;
+    bool mOffline = false;
     bool mPersistent = false;
     bool mReadOnly = false;
 }; // MountFlags
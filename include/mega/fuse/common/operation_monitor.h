@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <mega/fuse/common/operation_monitor_forward.h>
+#include <mega/fuse/common/operation_statistics.h>
+#include <mega/fuse/common/operation_type.h>
+#include <mega/tracing.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+// Keeps a latency histogram for each kind of operation.
+class OperationMonitor
+{
+    // Tracks how long a single kind of operation has taken.
+    struct Histogram
+    {
+        std::array<std::atomic<std::uint64_t>, NumLatencyBuckets> mBuckets{};
+        std::atomic<std::uint64_t> mCount{0u};
+        std::atomic<std::uint64_t> mMaxLatency{0u};
+        std::atomic<std::uint64_t> mTotalLatency{0u};
+    }; // Histogram
+
+    std::array<Histogram, NumOperationTypes> mOperations;
+
+public:
+    OperationMonitor();
+
+    OperationMonitor(const OperationMonitor& other) = delete;
+
+    ~OperationMonitor();
+
+    OperationMonitor& operator=(const OperationMonitor& rhs) = delete;
+
+    // Record that an operation has completed.
+    void record(OperationType type,
+                std::chrono::steady_clock::time_point started);
+
+    // How long have our operations taken?
+    OperationStatistics statistics() const;
+}; // OperationMonitor
+
+// Records an operation's latency when it leaves scope.
+class OperationTimer
+{
+    OperationMonitor& mMonitor;
+    std::chrono::steady_clock::time_point mStarted;
+    OperationType mType;
+
+    // From when a worker took the operation, unlike the latency.
+    TraceScope mTrace;
+
+public:
+    OperationTimer(OperationMonitor& monitor,
+                   OperationType type,
+                   std::chrono::steady_clock::time_point started =
+                     std::chrono::steady_clock::now());
+
+    OperationTimer(const OperationTimer& other) = delete;
+
+    ~OperationTimer();
+
+    OperationTimer& operator=(const OperationTimer& rhs) = delete;
+}; // OperationTimer
+
+} // fuse
+} // mega
+
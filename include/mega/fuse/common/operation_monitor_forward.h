@@ -0,0 +1,13 @@
+#pragma once
+
+namespace mega
+{
+namespace fuse
+{
+
+class OperationMonitor;
+class OperationTimer;
+
+} // fuse
+} // mega
+
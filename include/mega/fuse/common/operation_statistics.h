@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include <mega/fuse/common/operation_statistics_forward.h>
+#include <mega/fuse/common/operation_type_forward.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+struct OperationStatistics
+{
+    // Describes how long a single kind of operation has taken.
+    struct Histogram
+    {
+        // Latency below which the specified percentage of operations fell.
+        std::chrono::microseconds percentile(unsigned int percent) const;
+
+        // How many operations fell into each latency bucket?
+        std::array<std::uint64_t, NumLatencyBuckets> mBuckets{};
+
+        // How many operations have been performed?
+        std::uint64_t mCount = 0u;
+
+        // How long did the slowest operation take?
+        std::chrono::microseconds mMaxLatency{0};
+
+        // How long did all operations take in total?
+        std::chrono::microseconds mTotalLatency{0};
+    }; // Histogram
+
+    // Describes each operation, indexed by type.
+    std::array<Histogram, NumOperationTypes> mOperations;
+}; // OperationStatistics
+
+} // fuse
+} // mega
+
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+namespace mega
+{
+namespace fuse
+{
+
+struct OperationStatistics;
+
+// Bucket i counts operations that completed in under 2^i microseconds.
+constexpr std::size_t NumLatencyBuckets = 24;
+
+} // fuse
+} // mega
+
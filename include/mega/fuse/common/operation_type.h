@@ -0,0 +1,30 @@
+#pragma once
+
+#include <mega/fuse/common/operation_type_forward.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+// What operations do we measure the latency of?
+#define DEFINE_OPERATION_TYPES(expander) \
+    expander(OT_FLUSH) \
+    expander(OT_GETATTR) \
+    expander(OT_LOOKUP) \
+    expander(OT_READ) \
+    expander(OT_READDIR) \
+    expander(OT_WRITE)
+
+enum OperationType : unsigned int
+{
+#define DEFINE_OPERATION_TYPE_ENUMERANT(name) name,
+    DEFINE_OPERATION_TYPES(DEFINE_OPERATION_TYPE_ENUMERANT)
+#undef DEFINE_OPERATION_TYPE_ENUMERANT
+}; // OperationType
+
+const char* toString(OperationType type);
+
+} // fuse
+} // mega
+
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+namespace mega
+{
+namespace fuse
+{
+
+enum OperationType : unsigned int;
+
+// How many distinct operations do we track?
+constexpr std::size_t NumOperationTypes = 6;
+
+} // fuse
+} // mega
+
@@ -6,6 +6,8 @@
 
 #include <mega/fuse/common/client_forward.h>
 #include <mega/fuse/common/error_or_forward.h>
+#include <mega/fuse/common/file_cache_statistics_forward.h>
+#include <mega/fuse/common/inode_cache_statistics_forward.h>
 #include <mega/fuse/common/inode_info_forward.h>
 #include <mega/fuse/common/log_level_forward.h>
 #include <mega/fuse/common/mount_flags_forward.h>
@@ -13,10 +15,12 @@
 #include <mega/fuse/common/mount_result_forward.h>
 #include <mega/fuse/common/node_event_queue_forward.h>
 #include <mega/fuse/common/normalized_path_forward.h>
+#include <mega/fuse/common/operation_statistics_forward.h>
 #include <mega/fuse/common/service_callbacks.h>
 #include <mega/fuse/common/service_context_forward.h>
 #include <mega/fuse/common/service_flags.h>
 #include <mega/fuse/common/service_forward.h>
+#include <mega/fuse/common/task_executor_statistics_forward.h>
 #include <mega/fuse/common/task_queue_forward.h>
 
 #include <mega/types.h>
@@ -44,6 +48,14 @@ public:
     // Check if a file exists in the cache.
     bool cached(NormalizedPath path) const;
 
+    // Where is a file's complete content in the cache?
+    //
+    // Only if the file has no local changes and its content matches the
+    // specified modification time and size.
+    ErrorOr<LocalPath> cachedContent(NodeHandle handle,
+                                     m_time_t modified,
+                                     m_off_t size) const;
+
     // Called by the client when its view of the cloud is current.
     void current();
 
@@ -73,6 +85,12 @@ public:
     // Execute a function on some thread.
     Task execute(std::function<void(const Task&)> function);
 
+    // How long have the service's tasks had to wait?
+    TaskExecutorStatistics executorStatistics() const;
+
+    // How effective has the file cache been?
+    FileCacheStatistics fileCacheStatistics() const;
+
     // Update a mount's flags.
     MountResult flags(const NormalizedPath& path,
                       const MountFlags& flags);
@@ -89,12 +107,18 @@ public:
     // Initialize the service.
     MountResult initialize();
 
+    // How effective has the inode cache been?
+    InodeCacheStatistics inodeCacheStatistics() const;
+
     // How verbose should our logging be?
     void logLevel(LogLevel level);
 
     // How verbose is our logging?
     LogLevel logLevel() const;
 
+    // How long have the service's operations taken?
+    OperationStatistics operationStatistics() const;
+
     // Retrieve the path of all mounts associated with this name.
     NormalizedPathVector paths(const std::string& name) const;
 
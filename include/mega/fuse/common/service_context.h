@@ -4,16 +4,20 @@
 
 #include <mega/fuse/common/client_forward.h>
 #include <mega/fuse/common/error_or_forward.h>
+#include <mega/fuse/common/file_cache_statistics_forward.h>
+#include <mega/fuse/common/inode_cache_statistics_forward.h>
 #include <mega/fuse/common/inode_info_forward.h>
 #include <mega/fuse/common/mount_flags_forward.h>
 #include <mega/fuse/common/mount_info_forward.h>
 #include <mega/fuse/common/mount_result_forward.h>
 #include <mega/fuse/common/node_event_queue_forward.h>
 #include <mega/fuse/common/normalized_path_forward.h>
+#include <mega/fuse/common/operation_statistics_forward.h>
 #include <mega/fuse/common/service_callbacks.h>
 #include <mega/fuse/common/service_context_forward.h>
 #include <mega/fuse/common/service_flags.h>
 #include <mega/fuse/common/service_forward.h>
+#include <mega/fuse/common/task_executor_statistics_forward.h>
 #include <mega/fuse/common/task_queue_forward.h>
 
 #include <mega/types.h>
@@ -37,6 +41,11 @@ public:
     // Check if a file exists in the cache.
     virtual bool cached(NormalizedPath path) const = 0;
 
+    // Where is a file's complete content in the cache?
+    virtual ErrorOr<LocalPath> cachedContent(NodeHandle handle,
+                                             m_time_t modified,
+                                             m_off_t size) const = 0;
+
     // Retrieve the client that owns this context.
     Client& client() const;
 
@@ -68,6 +77,12 @@ public:
     // Execute a function on some thread.
     virtual Task execute(std::function<void(const Task&)> function) = 0;
 
+    // How long have the service's tasks had to wait?
+    virtual TaskExecutorStatistics executorStatistics() const = 0;
+
+    // How effective has the file cache been?
+    virtual FileCacheStatistics fileCacheStatistics() const = 0;
+
     // Update a mount's flags.
     virtual MountResult flags(const LocalPath& path,
                               const MountFlags& flags) = 0;
@@ -81,6 +96,12 @@ public:
     // Describe all (enabled) mounts.
     virtual MountInfoVector get(bool enabled) const = 0;
 
+    // How effective has the inode cache been?
+    virtual InodeCacheStatistics inodeCacheStatistics() const = 0;
+
+    // How long have the service's operations taken?
+    virtual OperationStatistics operationStatistics() const = 0;
+
     // Retrieve the path of all mounts associated with this name.
     virtual NormalizedPathVector paths(const std::string& name) const = 0;
 
@@ -3,6 +3,7 @@
 #include <cstddef>
 #include <chrono>
 
+#include <mega/fuse/common/file_cache_flags.h>
 #include <mega/fuse/common/inode_cache_flags.h>
 #include <mega/fuse/common/log_level.h>
 #include <mega/fuse/common/service_flags_forward.h>
@@ -15,6 +16,9 @@ namespace fuse
 
 struct ServiceFlags
 {
+    // Controls how the service caches file content.
+    FileCacheFlags mFileCacheFlags;
+
     // How long should we wait before we flush after a write?
     std::chrono::seconds mFlushDelay = std::chrono::seconds(4);
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <chrono>
 #include <condition_variable>
 #include <list>
@@ -7,7 +8,9 @@
 #include <mutex>
 
 #include <mega/fuse/common/task_executor_flags.h>
+#include <mega/fuse/common/task_executor_statistics.h>
 #include <mega/fuse/common/task_executor.h>
+#include <mega/fuse/common/task_priority.h>
 #include <mega/fuse/common/task_queue.h>
 
 namespace mega
@@ -24,6 +27,33 @@ class TaskExecutor
     using WorkerPtr = std::unique_ptr<Worker>;
     using WorkerList = std::list<WorkerPtr>;
 
+    // Tasks of a particular priority.
+    struct Lane
+    {
+        // How many workers are executing this lane's tasks?
+        std::size_t mBusyWorkers = 0u;
+
+        // How long have this lane's tasks had to wait?
+        TaskExecutorStatistics::Lane mStatistics;
+
+        // Tracks what tasks have been queued in this lane.
+        TaskQueue mTasks;
+    }; // Lane
+
+    // Convenience.
+    using LaneArray = std::array<Lane, NumTaskPriorities>;
+
+    // Which lane has work a worker may execute now?
+    //
+    // Returns nullptr if no lane has any such work.
+    Lane* ready();
+
+    // May a worker execute a task from this lane?
+    bool permitted(const Lane& lane) const;
+
+    // When will a worker next be able to execute a task?
+    std::chrono::steady_clock::time_point when() const;
+
     // Tracks how many workers are waiting for work.
     std::size_t mAvailableWorkers;
 
@@ -33,12 +63,12 @@ class TaskExecutor
     // Controls how we spawn our workers and how they behave.
     TaskExecutorFlags mFlags;
 
+    // Tracks what tasks we've queued, one lane per priority.
+    LaneArray mLanes;
+
     // Serializes access to instance members.
     mutable std::mutex mLock;
 
-    // Tracks what tasks we've queued.
-    TaskQueue mTaskQueue;
-
     // Lets the workers know when they should terminate.
     bool mTerminating;
 
@@ -51,10 +81,29 @@ public:
     ~TaskExecutor();
 
     // Execute a task at some point in time.
+    Task execute(std::function<void(const Task&)> function,
+                 TaskPriority priority,
+                 std::chrono::steady_clock::time_point when,
+                 bool spawnWorker);
+
+    // Execute a task at some point in time.
+    //
+    // The task is interactive if it's due now and periodic otherwise.
     Task execute(std::function<void(const Task&)> function,
                  std::chrono::steady_clock::time_point when,
                  bool spawnWorker);
 
+    // Execute a task now.
+    Task execute(std::function<void(const Task&)> function,
+                 TaskPriority priority,
+                 bool spawnWorker)
+    {
+        return execute(std::move(function),
+                       priority,
+                       std::chrono::steady_clock::now(),
+                       spawnWorker);
+    }
+
     // Execute a task at some point in the future.
     template<typename Rep, typename Period>
     Task execute(std::function<void(const Task&)> function,
@@ -80,6 +129,9 @@ public:
 
     // Retrieve this executor's flags.
     TaskExecutorFlags flags() const;
+
+    // How long have tasks had to wait in each lane?
+    TaskExecutorStatistics statistics() const;
 }; // TaskExecutor
 
 } // fuse
@@ -12,6 +12,11 @@ namespace fuse
 
 struct TaskExecutorFlags
 {
+    // How many threads should read requests from each mount?
+    //
+    // Only meaningful for mounts.
+    std::size_t mDispatchThreads = 1;
+
     // How long should a worker stay idle before it quits?
     std::chrono::seconds mIdleTime = std::chrono::seconds(16);
 
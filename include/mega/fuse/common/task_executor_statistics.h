@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include <mega/fuse/common/task_executor_statistics_forward.h>
+#include <mega/fuse/common/task_priority_forward.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+struct TaskExecutorStatistics
+{
+    // Describes how long tasks in a single lane had to wait.
+    struct Lane
+    {
+        // How many tasks has this lane executed?
+        std::uint64_t mExecuted = 0u;
+
+        // How long did the unluckiest task wait past its due time?
+        std::chrono::microseconds mMaxWait{0};
+
+        // How long did all of this lane's tasks wait in total?
+        std::chrono::microseconds mTotalWait{0};
+    }; // Lane
+
+    // Describes each of the executor's lanes, indexed by priority.
+    std::array<Lane, NumTaskPriorities> mLanes;
+}; // TaskExecutorStatistics
+
+} // fuse
+} // mega
+
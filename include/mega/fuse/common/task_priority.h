@@ -0,0 +1,30 @@
+#pragma once
+
+#include <mega/fuse/common/task_priority_forward.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+// Lanes are serviced in the order below.
+#define DEFINE_TASK_PRIORITIES(expander) \
+    /* Work someone's waiting on such as opening a file. */ \
+    expander(TP_INTERACTIVE) \
+    /* Work no one's waiting on such as prefetching content. */ \
+    expander(TP_BACKGROUND) \
+    /* Work performed on a schedule such as flushing modifications. */ \
+    expander(TP_PERIODIC)
+
+enum TaskPriority : unsigned int
+{
+#define DEFINE_TASK_PRIORITY_ENUMERANT(name) name,
+    DEFINE_TASK_PRIORITIES(DEFINE_TASK_PRIORITY_ENUMERANT)
+#undef DEFINE_TASK_PRIORITY_ENUMERANT
+}; // TaskPriority
+
+const char* toString(TaskPriority priority);
+
+} // fuse
+} // mega
+
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+namespace mega
+{
+namespace fuse
+{
+
+enum TaskPriority : unsigned int;
+
+// How many distinct priorities are there?
+constexpr std::size_t NumTaskPriorities = 3;
+
+} // fuse
+} // mega
+
@@ -22,10 +22,15 @@
 #ifndef GFX_H
 #define GFX_H 1
 
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <mutex>
+#include <thread>
 
 #include "mega/types.h"
 #include "mega/filesystem.h"
+#include "mega/sharedresources.h"
 #ifdef USE_IOS
 #include "mega/posix/megawaiter.h"
 #else
@@ -105,13 +110,41 @@ public:
     virtual std::vector<std::string> generateImages(const LocalPath& localfilepath,
                                                     const std::vector<GfxDimension>& dimensions) = 0;
 
+    // The file and the dimensions of one entry of a batch
+    using BatchEntry = std::pair<LocalPath, std::vector<GfxDimension>>;
+
+    // Receives the images of the entry at index, as generateImages() would return them
+    using BatchResult = std::function<void(size_t index, std::vector<std::string>&& images)>;
+
+    // It generates the thumbnails of several files, reporting every entry through result once, in
+    // no particular order, as soon as it is done. Providers paying a fixed cost per request handle
+    // the whole batch at once, the default processes the entries one after another.
+    virtual void generateImagesBatch(const std::vector<BatchEntry>& entries, const BatchResult& result);
+
+    // How many entries generateImagesBatch() should be given at most
+    virtual size_t maxBatchSize() const { return 1; }
+
     // list of supported extensions (NULL if no pre-filtering is needed)
     virtual const char* supportedformats() = 0;
 
     // list of supported video extensions (NULL if no pre-filtering is needed)
     virtual const char* supportedvideoformats() = 0;
 
+    // Create an independent instance so that another GfxProc worker can process jobs alongside
+    // this one. Providers that can't run concurrently return nullptr, which keeps GfxProc to a
+    // single worker.
+    virtual std::unique_ptr<IGfxProvider> clone() const { return nullptr; }
+
+    // Set by GfxProc to its shutdown flag, so that long running work on one job can stop early
+    void setCancelFlag(const std::atomic<bool>* cancelled) { mCancelled = cancelled; }
+
     static std::unique_ptr<IGfxProvider> createInternalGfxProvider();
+
+protected:
+    bool isCancelled() const { return mCancelled && mCancelled->load(); }
+
+private:
+    const std::atomic<bool>* mCancelled = nullptr;
 };
 
 // Interface for the local graphic processor provider
@@ -147,18 +180,44 @@ protected:
 // bitmap graphics processor
 class MEGA_API GfxProc
 {
+public:
+    // How long the workers have spent on the jobs processed so far
+    struct Statistics
+    {
+        uint64_t jobs = 0;
+        std::chrono::milliseconds totalTime{0};
+        std::chrono::milliseconds maxTime{0};
+    };
+
+private:
+    // Decoding a photo takes a full size bitmap, this bounds how many are held in memory at once
+    static constexpr unsigned MAX_WORKERS = 4;
+
     std::atomic<bool> finished{false};
-    WAIT_CLASS waiter;
+    std::mutex mWorkMutex;
+    std::condition_variable mWorkAvailable;
     std::mutex mutex;
-    THREAD_CLASS thread;
+    std::vector<std::thread> mWorkers;
     bool threadstarted = false;
     SymmCipher mCheckEventsKey;
     GfxJobQueue requests;
     GfxJobQueue responses;
     std::unique_ptr<IGfxProvider>  mGfxProvider;
 
-    static void *threadEntryPoint(void *param);
-    void loop();
+    mutable std::mutex mStatisticsMutex;
+    Statistics mStatistics;
+
+    // With SharedResources, the jobs run on the shared gfx pool instead of workers of our own,
+    // one at a time with mGfxProvider.
+    std::unique_ptr<SharedWorkerPool::Lane> mSharedLane;
+
+    // provider is null for the worker sharing mGfxProvider with savefa()
+    void loop(IGfxProvider* provider);
+
+    // a turn on the shared gfx pool: as many queued jobs as the provider takes at once
+    void processSharedTurn();
+
+    void process(const std::vector<GfxJob*>& jobs, IGfxProvider* provider);
 
     std::vector<GfxDimension> getJobDimensions(GfxJob *job);
 
@@ -200,9 +259,14 @@ public:
 
     MegaClient* client = nullptr;
 
-    // start a thread that will do the processing
+    // start the threads that will do the processing: one per core, up to MAX_WORKERS,
+    // if the provider can be cloned for each of them, or a single one otherwise.
+    // With SharedResources enabled, join the shared gfx pool instead.
     void startProcessingThread();
 
+    // per-job timings, thread safe
+    Statistics statistics() const;
+
     // The provided IGfxProvider implements library specific image processing
     // Thread safety among IGfxProvider methods is guaranteed by GfxProc
     GfxProc(std::unique_ptr<IGfxProvider>);
@@ -64,6 +64,8 @@ public:
     const char* supportedformats() override;
     const char* supportedvideoformats() override;
 
+    std::unique_ptr<IGfxProvider> clone() const override;
+
     GfxProviderFreeImage();
     ~GfxProviderFreeImage();
 
@@ -72,6 +74,11 @@ protected:
     string sformats;
     bool readbitmapFreeimage(const LocalPath&, int);
 
+#ifdef FIF_LOAD_NOPIXELS
+    // the thumbnail in the EXIF data of a camera photo, if it alone is big enough
+    bool readbitmapEmbeddedThumbnail(FREE_IMAGE_FORMAT, const LocalPath&, int);
+#endif
+
 #if defined(HAVE_FFMPEG)  || defined(HAVE_PDFIUM)
     static std::mutex gfxMutex;
 #endif
@@ -80,6 +87,7 @@ protected:
     const char* supportedformatsFfmpeg();
     bool isFfmpegFile(const string &ext);
     bool readbitmapFfmpeg(const LocalPath&, int);
+    bool readbitmapFfmpeg(const LocalPath&, int, bool allowHardware, bool& usedHardware);
 #endif
 
 #ifdef HAVE_PDFIUM
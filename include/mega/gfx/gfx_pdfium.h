@@ -29,6 +29,9 @@
 #include "mega/logging.h"
 #include <fpdfview.h>
 
+#include <chrono>
+#include <functional>
+
 namespace mega {
 
 class PdfiumReader
@@ -42,16 +45,18 @@ public:
     // PdfiumReader member method calling init() is responsible for locking pdfMutex
     static void init();
 
-#ifdef _WIN32
-    // BGRA format, 4 bytes per pixel (32bits), byte order: blue, green, red, alpha.
-    // init() is called internally if library is not initialized.
-    // workingDirFolder : Path to create a temporary file.
-    static unique_ptr<char[]> readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path, const LocalPath &workingDirFolder);
-#else
-    // Returns a bitmap in BGRA format, 4 bytes per pixel (32bits), byte order: blue, green, red, alpha.
+    // Returns a bitmap of the first page in BGRA format, 4 bytes per pixel (32bits), byte order: blue, green, red, alpha.
     // init() is called internally if library is not initialized.
-    static unique_ptr<char[]> readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path);
-#endif
+    // size: the page is scaled down so that its shorter side is no larger, if positive
+    // cancelled: polled while loading and rendering, the job is abandoned once it returns true
+    static unique_ptr<char[]> readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path,
+                                                int size, const std::function<bool()>& cancelled);
+
+    // How long loading and rendering one document may take
+    static constexpr std::chrono::seconds TIME_BUDGET{10};
+
+    // The largest bitmap rendered, ~47MB, as an A0 page at one pixel per point would need
+    static constexpr int MAX_BITMAP_PIXELS = 3500 * 3500;
     // It decreases the initializations internal counter and destroys the library once it reaches zero.
     static void destroy();
 
@@ -156,6 +156,11 @@ public:
     std::vector<std::string> generateImages(const LocalPath& localfilepath,
                                             const std::vector<GfxDimension>& dimensions) override;
 
+    // one round trip to the worker for the whole batch, which processes the files in parallel
+    void generateImagesBatch(const std::vector<BatchEntry>& entries, const BatchResult& result) override;
+
+    size_t maxBatchSize() const override { return MAX_BATCH_SIZE; }
+
     const char* supportedformats() override;
 
     const char* supportedvideoformats() override;
@@ -190,6 +195,9 @@ private:
 
     const char* getformats(const char* (Formats::*formatsFunc)() const);
 
+    // about what the worker's thread pool takes at once by default
+    static constexpr size_t MAX_BATCH_SIZE = 8;
+
     Formats mFormats;
 
     std::unique_ptr<GfxIsolatedProcess> mProcess;
@@ -21,8 +21,10 @@
 #include "mega/gfx.h"
 #include "mega/gfx/worker/comms.h"
 #include "mega/gfx/worker/comms_client.h"
+#include "mega/gfx/worker/tasks.h"
 
 #include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -53,6 +55,12 @@ public:
                     const std::vector<GfxDimension>& dimensions,
                     std::vector<std::string>& images);
 
+    // Sends all the tasks in one request over a single connection. result is called with the
+    // index and images of each task as the server streams them back. Returns false if the
+    // server couldn't be reached or stopped replying before every task was reported.
+    bool runGfxBatch(const std::vector<GfxTask>& tasks,
+                     const std::function<void(size_t, std::vector<std::string>&&)>& result);
+
     bool runSupportFormats(std::string& formats, std::string& videoformats);
 
     static GfxClient create(const std::string& endpointName);
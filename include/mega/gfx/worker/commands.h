@@ -37,7 +37,9 @@ enum class CommandType
     HELLO_RESPONSE              = 7,
     SUPPORT_FORMATS             = 8,
     SUPPORT_FORMATS_RESPONSE    = 9,
-    END                         = 10  // 1 more than the last valid one
+    NEW_GFX_BATCH               = 10,
+    NEW_GFX_BATCH_RESPONSE      = 11,
+    END                         = 12  // 1 more than the last valid one
 };
 
 class ICommand
@@ -106,6 +108,37 @@ struct CommandNewGfxResponse : public ICommand
     bool unserialize(const std::string& data) override;
 };
 
+// Several tasks in one request. The server streams back one CommandNewGfxBatchResponse
+// per task, on the same connection, as soon as each one is processed.
+struct CommandNewGfxBatch : public ICommand
+{
+    std::vector<GfxTask> Tasks;
+
+    CommandType type() const override { return CommandType::NEW_GFX_BATCH; }
+
+    std::string typeStr() const override { return "NEW_GFX_BATCH"; };
+
+    std::string serialize() const override;
+
+    bool unserialize(const std::string& data) override;
+};
+
+struct CommandNewGfxBatchResponse : public ICommand
+{
+    uint32_t    Index; // of the task in CommandNewGfxBatch::Tasks
+    uint32_t    ErrorCode;
+    std::string ErrorText;
+    std::vector<std::string> Images;
+
+    CommandType type() const override { return CommandType::NEW_GFX_BATCH_RESPONSE; }
+
+    std::string typeStr() const override { return "NEW_GFX_BATCH_RESPONSE"; };
+
+    std::string serialize() const override;
+
+    bool unserialize(const std::string& data) override;
+};
+
 struct CommandHello : public ICommand
 {
     std::string Text;
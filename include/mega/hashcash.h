@@ -0,0 +1,100 @@
+/**
+ * @file mega/hashcash.h
+ * @brief Solver for the API's hashcash challenges
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_HASHCASH_H
+#define MEGA_HASHCASH_H 1
+
+#include "types.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+
+namespace mega {
+
+// Solves an X-Hashcash challenge on threads of its own, so the client keeps going meanwhile.
+//
+// A candidate is a 4-byte prefix to the token repeated 262144 times, and the solution is the
+// first one, counting up from 1, whose SHA-256 starts with a value under the threshold given by
+// the easiness. Each thread takes the next candidate to try and hashes it from a buffer of its
+// own, and stops once that candidate is past the best solution found so far: the result is the
+// same whatever the number of threads.
+class MEGA_API HashcashSolver
+{
+public:
+    // Starts right away. notify is called from a solver thread once done (or cancelled).
+    // No threadCount means one per core.
+    HashcashSolver(string token, uint8_t easiness, std::function<void()> notify, unsigned threadCount = 0);
+
+    // cancels, if not done yet
+    ~HashcashSolver();
+
+    MEGA_DISABLE_COPY_MOVE(HashcashSolver)
+
+    void cancel();
+    bool done() const { return mDone; }
+    void wait();
+
+    const string& token() const { return mToken; }
+    uint8_t easiness() const { return mEasiness; }
+
+    // Once done: the solution, in B64, empty if cancelled or none was found.
+    const string& prefix() const;
+
+    // what it took
+    uint64_t attempts() const { return mAttempts; }
+    std::chrono::milliseconds elapsed() const;
+    unsigned threadCount() const { return static_cast<unsigned>(mThreads.size()); }
+
+private:
+    static constexpr uint64_t NO_SOLUTION = uint64_t(1) << 32;
+
+    void work();
+
+    string mToken;
+    uint8_t mEasiness;
+    uint32_t mThreshold;
+    string mTokenBinary;
+    std::function<void()> mNotify;
+
+    std::atomic<uint64_t> mNextCandidate{1};
+    std::atomic<uint64_t> mBest{NO_SOLUTION};
+    std::atomic<uint64_t> mAttempts{0};
+    std::atomic<bool> mCancelled{false};
+
+    std::chrono::steady_clock::time_point mStarted;
+    std::chrono::steady_clock::time_point mFinished;
+    string mPrefix;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mDoneCondition;
+    unsigned mRunning = 0;
+    std::atomic<bool> mDone{false};
+
+    std::vector<std::thread> mThreads;
+};
+
+// Solves a challenge on every core, blocking until done. Returns the prefix in B64.
+string gencash(const string& token, uint8_t easiness);
+
+} // namespace
+
+#endif
@@ -80,6 +80,24 @@ public:
 
     SyncTransferCounts mSnapshotTransferCounts;
     SyncTransferCounts mResolvedTransferCounts;
+
+    // the values of the last heartbeat sent, to skip the ones that wouldn't show anything new
+    struct Report
+    {
+        SPHBStatus status = CommandBackupPutHeartBeat::STATE_NOT_INITIALIZED;
+        int8_t progress = 0;
+        uint32_t pendingUps = 0;
+        uint32_t pendingDowns = 0;
+        handle lastItemUpdated = UNDEF;
+
+        bool operator==(const Report& o) const
+        {
+            return status == o.status && progress == o.progress && pendingUps == o.pendingUps
+                && pendingDowns == o.pendingDowns && lastItemUpdated == o.lastItemUpdated;
+        }
+    };
+    std::unique_ptr<Report> mLastReport;
+
 private:
     SPHBStatus mSPHBStatus = CommandBackupPutHeartBeat::STATE_NOT_INITIALIZED;
 };
@@ -119,7 +137,8 @@ private:
 
     Syncs& syncs;
 
-    void beatBackupInfo(UnifiedSync& us);
+    // the heartbeat of 'us', if due, is appended to 'beats': beat() sends them all at once
+    void beatBackupInfo(UnifiedSync& us, std::vector<std::function<void(MegaClient&)>>& beats);
 };
 
 #endif
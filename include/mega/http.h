@@ -240,6 +240,74 @@ private:
     m_off_t aggregateProgressForTimePeriod(dstime timePeriodToAggregate, dstime totalTime, m_off_t bytesToAggregate) const;
 };
 
+// Paces a flow of bytes to a rate. The bucket holds up to one second of traffic and
+// may go into debt, so chunks bigger than what is available still pass and are paid later.
+class MEGA_API TokenBucket
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    // bytes per second, 0 for unlimited. Takes effect immediately, keeping the tokens
+    // accumulated so far (capped to the new burst)
+    void setRate(m_off_t bps, clock::time_point now = clock::now());
+    m_off_t rate() const { return mRate; }
+
+    // bytes that can be transferred now (the largest m_off_t if unlimited)
+    m_off_t available(clock::time_point now = clock::now());
+
+    // account for transferred bytes
+    void consume(m_off_t bytes);
+
+private:
+    void refill(clock::time_point now);
+
+    m_off_t mRate = 0;
+    double mTokens = 0;
+    clock::time_point mRefilled;
+};
+
+// Process-wide cache of transfer buffers in size classes a quarter of a power of two apart, shared by
+// the upload and download slots and the worker threads. Freed buffers are kept for reuse up to a
+// limit on the cached bytes; from 2 MB they are hugepage aligned, and advised so where supported.
+class MEGA_API TransferBufferPool
+{
+public:
+    static TransferBufferPool& instance();
+
+    // the returned buffers are HEADER aligned
+    byte* allocate(size_t len);
+    void deallocate(byte* b);
+
+    static constexpr size_t HEADER = 64;
+    static constexpr size_t MIN_CLASS_SIZE = 16 * 1024;
+    static constexpr size_t MAX_CLASS_SIZE = 64 * 1024 * 1024;
+    static constexpr size_t HUGEPAGE_SIZE = 2 * 1024 * 1024;
+    static constexpr size_t DEFAULT_MAX_CACHED_BYTES = 256 * 1024 * 1024;
+
+    void setMaxCachedBytes(size_t bytes);
+
+    // in use, peak and cached bytes, and how often a cached buffer could be reused
+    std::string report(bool reset);
+
+    size_t inUseBytes();
+    size_t cachedBytes();
+
+private:
+    TransferBufferPool();
+
+    static size_t classSize(size_t sizeClass);
+    static size_t classFor(size_t len);
+
+    std::mutex mMutex;
+    std::vector<std::vector<byte*>> mFree;
+    size_t mMaxCachedBytes = DEFAULT_MAX_CACHED_BYTES;
+    size_t mCachedBytes = 0;
+    size_t mInUseBytes = 0;
+    size_t mPeakInUseBytes = 0;
+    uint64_t mReused = 0;
+    uint64_t mAllocated = 0;
+};
+
 extern std::mutex g_APIURL_default_mutex;
 extern string g_APIURL_default;
 extern bool g_disablepkp_default;
@@ -326,6 +394,35 @@ struct MEGA_API HttpIO : public EventTrigger
     // get max upload speed
     virtual m_off_t getmaxuploadspeed();
 
+    // multiplex the requests to the API and/or storage servers over HTTP/2 connections, where
+    // the server supports it. Returns false if the network layer doesn't
+    virtual bool setHttp2Multiplexing(bool api, bool transfers);
+
+    // connect to IPv6 and IPv4 addresses in parallel, with a head start for IPv6, so a broken
+    // IPv6 route doesn't stall the requests until they time out. Returns false if not supported
+    virtual bool setHappyEyeballs(bool enable);
+
+    // bandwidth budgets, adjustable at any time without touching the connections (0 removes the limit):
+    // per storage host in a direction (an empty host sets the default for every host without its own limit),
+    // and per bandwidth class in a direction. setmaxdownloadspeed()/setmaxuploadspeed() keep capping the whole direction
+    virtual bool setHostBandwidthLimit(direction_t d, const string& host, m_off_t bpslimit);
+    virtual bool setBandwidthClassLimit(direction_t d, bwclass_t c, m_off_t bpslimit);
+
+    // size of the receive buffer of the network layer for downloads (0 for its default).
+    // A bigger one hands over the data in fewer, larger pieces. Returns false if not supported
+    virtual bool setDownloadBufferSize(long bytes);
+
+    // offer the compressed encodings that the network layer can decode for the responses of the API.
+    // Returns false if it can't decode any
+    virtual bool setApiCompression(bool enable);
+
+    // health of storage servers, shared by all transfers: whether the server of the URL has been
+    // failing, slow to respond or slow to transfer lately, compared to the others
+    virtual bool isHostDegraded(const string& url);
+
+    // a transfer request to the URL stopped receiving data and was abandoned
+    virtual void hostStalled(const string& url);
+
     virtual bool cacheresolvedurls(const std::vector<string>&, std::vector<string>&&) { return false; }
 
     HttpIO();
@@ -351,6 +448,12 @@ struct MEGA_API HttpReq
     bool mExpectRedirect = false;
     bool mChunked = false;
 
+    // for a connection pre-warm (see prewarm()), the direction of the transfers it's meant for
+    direction_t mPrewarmDirection = NONE;
+
+    // whose traffic this is, for the bandwidth budgets of the HttpIO
+    bwclass_t mBandwidthClass = BW_USER;
+
     bool sslcheckfailed;
     string sslfakeissuer;
     string mRedirectURL;
@@ -360,6 +463,15 @@ struct MEGA_API HttpReq
     size_t inpurge;
     size_t outpos;
 
+    // While the size of the response is unknown, put() stores it in segments of SEGMENT_SIZE bytes
+    // instead of growing 'in', which would copy all the data received so far on every reallocation.
+    // joinSegments() moves them to 'in' (exactly sized), and it must be called once the request
+    // is finished, before using 'in'
+    bool mSegmented = false;
+    std::vector<string> mSegments;
+    static constexpr size_t SEGMENT_SIZE = 1 << 20;
+    void joinSegments();
+
     string outbuf;
 
     // if the out payload includes a fetch nodes command
@@ -384,6 +496,9 @@ struct MEGA_API HttpReq
     string mHashcashToken;
     uint8_t mHashcashEasiness{};
 
+    // Solution to the challenge above, to be sent with the request (solved on sending if empty)
+    string mHashcashPrefix;
+
     // HttpIO implementation-specific identifier for this connection
     void* httpiohandle;
 
@@ -406,6 +521,10 @@ struct MEGA_API HttpReq
     // send a DNS request
     void dns(MegaClient*);
 
+    // send a HEAD request to open a connection to the server, which stays idle afterwards
+    // for the transfers in direction d, with the TLS session already established
+    void prewarm(MegaClient*, direction_t d);
+
     // store chunk of incoming data with optional purging
     void put(void*, unsigned, bool = false);
 
@@ -422,11 +541,16 @@ struct MEGA_API HttpReq
         size_t start;
         size_t end;
 
-        http_buf_t(byte* b, size_t s, size_t e);  // takes ownership of the byte*, which must have been allocated with new[]
+        http_buf_t(byte* b, size_t s, size_t e);  // takes ownership of the byte*, which must have been allocated with allocate()
         ~http_buf_t();
         void swap(http_buf_t& other);
         bool isNull() const;
 
+        // transfer buffers start on a cache line, so AES-CTR and the raid XOR run on aligned data
+        static constexpr size_t ALIGNMENT = 64;
+        static byte* allocate(size_t len);
+        static void deallocate(byte* b);
+
     private:
         byte* buf;
     };
@@ -509,6 +633,13 @@ public:
 
     bool encrypt(m_off_t pos, m_off_t npos, string& urlSuffix);
 
+    // Only the chunks with (index % parts == part), so a large buffer can be spread over several
+    // threads.  Their entries must be in the chunkmac_map already.  The part's CRC is xored into
+    // partsCrc, which adds up to the one encrypt() puts in the URL once all the parts are done.
+    bool encryptPart(m_off_t pos, m_off_t npos, unsigned part, unsigned parts, byte* partsCrc);
+
+    static string urlSuffix(m_off_t pos, const byte* crc);
+
 private:
     SymmCipher* key;
     chunkmac_map* macs;
@@ -548,9 +679,23 @@ struct MEGA_API HttpReqUL : public HttpReqXfer
 
     void prepare(const char*, SymmCipher*, uint64_t, m_off_t, m_off_t);
 
+    // the chunks of a large request are encrypted as several jobs; the last one to finish prepares it
+    static constexpr m_off_t PREPARE_PART_SIZE = 1024 * 1024;
+
+    // on the owning thread, before the jobs: how many of them, at most one per worker
+    unsigned prepareParts(m_off_t pos, m_off_t npos, unsigned workers);
+
+    // returns true for the job that completed the request
+    bool preparePart(const char*, SymmCipher*, uint64_t, m_off_t, m_off_t, unsigned part, unsigned parts);
+
     m_off_t transferred(MegaClient*);
 
     ~HttpReqUL() { }
+
+private:
+    std::mutex mPartsMutex;
+    unsigned mPendingParts = 0;
+    byte mPartsCrc[EncryptByChunks::CRCSIZE];
 };
 
 // file chunk download
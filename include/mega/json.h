@@ -22,6 +22,8 @@
 #ifndef MEGA_JSON_H
 #define MEGA_JSON_H 1
 
+#include <string_view>
+
 #include "name_id.h"
 #include "types.h"
 
@@ -92,6 +94,10 @@ public:
 
     static void unescape(string*);
 
+    // first '"', '\\' or NUL at or after 'ptr', which is inside a string. Vectorized (SSE2, AVX2
+    // or NEON) when the build targets it. It may read past the NUL, but never across its page
+    static const char* scanString(const char* ptr);
+
     /**
      * @brief Extract a string value for a name in a JSON string
      * @param json JSON string to check
@@ -117,16 +123,36 @@ public:
     static string stripWhitespace(const char* text);
 };
 
+// Buffers given back by destroyed JSONWriters, emptied but keeping their capacity, so that
+// composing a batch of thousands of commands doesn't allocate the JSON of each one of them.
+// There is a pool per thread, so they don't need locking
+class MEGA_API JSONBufferPool
+{
+public:
+    // an empty string, reused if possible
+    static string acquire();
+    static void release(string&& buffer);
+
+    static constexpr size_t MAX_BUFFERS = 1024;
+    // bigger buffers (fetchnodes, big putnodes...) are freed
+    static constexpr size_t MAX_CAPACITY = 16 * 1024;
+};
+
 class MEGA_API JSONWriter
 {
 public:
     JSONWriter();
+    ~JSONWriter();
 
-    MEGA_DEFAULT_COPY_MOVE(JSONWriter)
+    JSONWriter(const JSONWriter&);
+    JSONWriter(JSONWriter&&) noexcept = default;
+    JSONWriter& operator=(const JSONWriter&) = default;
+    JSONWriter& operator=(JSONWriter&&) noexcept = default;
 
     void cmd(const char*);
     void notself(MegaClient*);
 
+    void arg(const char*, std::string_view, int = 1);
     void arg(const char*, const string&, int = 1);
     void arg(const char*, const char*, int = 1);
     void arg(const char*, handle, int);
@@ -139,6 +165,7 @@ public:
     // These should only be used when producing JSON meant for human consumption.
     // If you're generating JSON meant to be consumed by our servers, you
     // should escape things using arg_B64 above.
+    void arg_stringWithEscapes(const char*, std::string_view, int = 1);
     void arg_stringWithEscapes(const char*, const char*, int = 1);
     void arg_stringWithEscapes(const char*, const string&, int = 1);
 
@@ -175,6 +202,11 @@ private:
 
     int elements();
 
+    // escaped straight into 'json'
+    static void appendEscaped(string& json, std::string_view data);
+    // base64 straight into mJson
+    void appendB64(const byte* data, int len);
+
     string mJson;
     std::array<signed char, MAXDEPTH> mLevels;
     signed char mLevel;
@@ -92,11 +92,13 @@
 #include <array>
 #include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <cstring>
 #include <iostream>
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 // define MEGA_QT_LOGGING to support QString
@@ -641,7 +643,8 @@ public:
     }
     inline static LogLevel getLogLevel()
     {
-        return logCurrentLevel;
+        // checked before every message: no ordering needed with anything else
+        return logCurrentLevel.load(std::memory_order_relaxed);
     }
 
     // set the limit of size to requests payload
@@ -695,25 +698,42 @@ struct LoggerVoidify
     void operator&(SimpleLogger&) {}
 };
 
-#define LOG_verbose \
-    ::mega::SimpleLogger::getLogLevel() < ::mega::logMax ? (void)0 : \
-        ::mega::LoggerVoidify() & ::mega::SimpleLogger(::mega::logMax, ::mega::log_file_leafname(__FILE__), __LINE__)
+// The most detailed level of the messages compiled in: the others are dropped by the compiler,
+// arguments and all. A translation unit may lower MEGA_LOG_UNIT_MAX_LEVEL for its own messages.
+#ifndef MEGA_LOG_MAX_LEVEL
+#define MEGA_LOG_MAX_LEVEL 5
+#endif
+
+// for the subsystems having a setting of their own
+#ifndef MEGA_SYNC_LOG_MAX_LEVEL
+#define MEGA_SYNC_LOG_MAX_LEVEL MEGA_LOG_MAX_LEVEL
+#endif
+#ifndef MEGA_TRANSFER_LOG_MAX_LEVEL
+#define MEGA_TRANSFER_LOG_MAX_LEVEL MEGA_LOG_MAX_LEVEL
+#endif
+#ifndef MEGA_JSON_LOG_MAX_LEVEL
+#define MEGA_JSON_LOG_MAX_LEVEL MEGA_LOG_MAX_LEVEL
+#endif
 
-#define LOG_debug \
-    ::mega::SimpleLogger::getLogLevel() < ::mega::logDebug ? (void)0 : \
-        ::mega::LoggerVoidify() & ::mega::SimpleLogger(::mega::logDebug, ::mega::log_file_leafname(__FILE__), __LINE__)
+#ifndef MEGA_LOG_UNIT_MAX_LEVEL
+#define MEGA_LOG_UNIT_MAX_LEVEL MEGA_LOG_MAX_LEVEL
+#endif
 
-#define LOG_info \
-    ::mega::SimpleLogger::getLogLevel() < ::mega::logInfo ? (void)0 : \
-        ::mega::LoggerVoidify() & ::mega::SimpleLogger(::mega::logInfo, ::mega::log_file_leafname(__FILE__), __LINE__)
+// Whether messages of this level are compiled in, under the given ceiling, and wanted now.
+// Nothing else is evaluated when not.
+#define MEGA_LOG_ENABLED(MAX_LEVEL, LOG_LEVEL) \
+    (static_cast<int>(LOG_LEVEL) <= (MAX_LEVEL) && static_cast<int>(LOG_LEVEL) <= MEGA_LOG_MAX_LEVEL && \
+     ::mega::SimpleLogger::getLogLevel() >= (LOG_LEVEL))
 
-#define LOG_warn \
-    ::mega::SimpleLogger::getLogLevel() < ::mega::logWarning ? (void)0 : \
-        ::mega::LoggerVoidify() & ::mega::SimpleLogger(::mega::logWarning, ::mega::log_file_leafname(__FILE__), __LINE__)
+#define LOG_generic(MAX_LEVEL, LOG_LEVEL) \
+    !MEGA_LOG_ENABLED(MAX_LEVEL, LOG_LEVEL) ? (void)0 : \
+        ::mega::LoggerVoidify() & ::mega::SimpleLogger(LOG_LEVEL, ::mega::log_file_leafname(__FILE__), __LINE__)
 
-#define LOG_err \
-    ::mega::SimpleLogger::getLogLevel() < ::mega::logError ? (void)0 : \
-        ::mega::LoggerVoidify() & ::mega::SimpleLogger(::mega::logError, ::mega::log_file_leafname(__FILE__), __LINE__)
+#define LOG_verbose LOG_generic(MEGA_LOG_UNIT_MAX_LEVEL, ::mega::logMax)
+#define LOG_debug LOG_generic(MEGA_LOG_UNIT_MAX_LEVEL, ::mega::logDebug)
+#define LOG_info LOG_generic(MEGA_LOG_UNIT_MAX_LEVEL, ::mega::logInfo)
+#define LOG_warn LOG_generic(MEGA_LOG_UNIT_MAX_LEVEL, ::mega::logWarning)
+#define LOG_err LOG_generic(MEGA_LOG_UNIT_MAX_LEVEL, ::mega::logError)
 
 #define LOG_fatal \
     ::mega::SimpleLogger(::mega::logFatal, ::mega::log_file_leafname(__FILE__), __LINE__)
@@ -743,7 +763,7 @@ inline bool isWithinActivePeriod(const TimeUnit sleepDuration, const TimeUnit ac
 }
 
 #define LOG_generic_timed(LOG_LEVEL, SLEEP_DUR, ACTIVE_DUR) \
-::mega::SimpleLogger::getLogLevel() < LOG_LEVEL || !isWithinActivePeriod(SLEEP_DUR, ACTIVE_DUR) ? \
+!MEGA_LOG_ENABLED(MEGA_LOG_UNIT_MAX_LEVEL, LOG_LEVEL) || !isWithinActivePeriod(SLEEP_DUR, ACTIVE_DUR) ? \
     (void)0 : \
     ::mega::LoggerVoidify() & \
         ::mega::SimpleLogger(LOG_LEVEL, ::mega::log_file_leafname(__FILE__), __LINE__)
@@ -828,6 +848,71 @@ public:
     LogCallback exclusiveCallback;
 };
 
+class LogRing;
+
+// Takes the delivery of log messages off the threads producing them, so that debug logging
+// doesn't hold up transfers while the outputs take their locks and write files.
+//
+// Each thread copies its messages, encoded as a level plus the lengths and bytes of the
+// fields, into a ring buffer of its own with no lock taken, and a thread of the logger's own
+// turns them back into the arguments of Logger::log for the target. A message that doesn't fit
+// in its thread's ring is dropped: the count is logged by the drain thread once there is room.
+// Fatal messages are waited for, so they're out before a crash.
+class AsyncLogger : public Logger
+{
+public:
+    // bytes of messages each thread may have waiting
+    static const size_t DEFAULT_RING_SIZE = 262144;
+
+    explicit AsyncLogger(size_t ringSize = DEFAULT_RING_SIZE);
+
+    // delivers what is waiting first
+    ~AsyncLogger();
+
+    MEGA_DISABLE_COPY_MOVE(AsyncLogger)
+
+    // where the messages go from now on: the drain thread starts with the first one
+    void setTarget(Logger* target);
+    Logger* target() const { return mTarget; }
+
+    void log(const char *time, int loglevel, const char *source, const char *message
+#ifdef ENABLE_LOG_PERFORMANCE
+        , const char **directMessages, size_t *directMessagesSizes, unsigned numberMessages
+#endif
+    ) override;
+
+    // returns once the messages logged before have been handed to the target
+    void flush();
+
+    // messages lost to full rings so far
+    uint64_t dropped() const { return mDropped; }
+
+private:
+    void drain();
+
+    // the calling thread's ring, registered on first use
+    LogRing& ring();
+
+    // returns whether there was anything to deliver
+    bool deliver(LogRing& ring, std::string& record);
+
+    const unsigned mId;
+    const size_t mRingSize;
+    std::atomic<Logger*> mTarget{nullptr};
+    std::atomic<uint64_t> mDropped{0};
+
+    std::mutex mMutex;
+    std::condition_variable mWakeup;
+    std::condition_variable mFlushed;
+    std::vector<std::shared_ptr<LogRing>> mRings;
+    uint64_t mFlushRequested = 0;
+    uint64_t mFlushCompleted = 0;
+    bool mExiting = false;
+    std::thread mThread;
+
+    static std::atomic<unsigned> sNextId;
+};
+
 
 // This used to be a static member of MegaApi_impl
 // However, megacli could not use or test it from there since it
@@ -837,4 +922,7 @@ public:
 extern ExternalLogger g_externalLogger;
 extern ExclusiveLogger g_exclusiveLogger;
 
+// in front of either of them, when logging is asynchronous
+extern AsyncLogger g_asyncLogger;
+
 } // namespace
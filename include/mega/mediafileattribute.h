@@ -27,6 +27,10 @@
 #include "filesystem.h"
 #include <string>
 
+#ifdef USE_MEDIAINFO
+namespace MediaInfoLib { class MediaInfo; }
+#endif
+
 namespace mega {
 
 enum fatype_ids { fa_media = 8, fa_mediaext = 9 };
@@ -78,15 +82,28 @@ struct MEGA_API MediaProperties
     static bool isMediaFilenameExtAudio(const std::string& ext);
     static bool isMediaFilenameExt(const std::string& ext);
 
+    // Sizes of the two ranged reads extraction starts from: the container header, and the footer
+    // where files written in one pass (MP4/MOV with the moov atom last, for one) keep their index.
+    static constexpr unsigned HEADER_READ_SIZE = 512 * 1024;
+    static constexpr unsigned FOOTER_READ_SIZE = 512 * 1024;
+
     // Open the specified local file with mediainfoLib and get its video parameters.  This function fills in the names but not the IDs
     void extractMediaPropertyFileAttributes(LocalPath& localFilename, FileSystemAccess* fa);
 
+    // The same for a file not at hand, a cloud node read with DirectRead say, from its first and last
+    // bytes only (up to the sizes above). Returns false if mediainfoLib needed any other part of it.
+    bool extractMediaPropertyFileAttributes(const std::string& header, const std::string& footer, m_off_t fileSize);
+
     // Look up the IDs of the codecs and container, and encode and encrypt all the info into a string with file attribute 8, and possibly file attribute 9.
     std::string convertMediaPropertyFileAttributes(uint32_t attributekey[4], MediaFileInfo& mediaInfo);
 
     // get binary data and synthetic extension ("jpg" or "png") for cover data in ID3v2 tag
     template<class T>
     static StringPair getCoverFromId3v2(const T& file);
+
+private:
+    // fill in the names and parameters from an opened mediainfoLib instance
+    void readMediaInfo(MediaInfoLib::MediaInfo& minfo, const std::string& source);
 #endif
 
     std::string serialize();
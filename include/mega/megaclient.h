@@ -26,11 +26,15 @@
 #include "backofftimer.h"
 #include "db.h"
 #include "drivenotify.h"
+#include "eventloopmonitor.h"
+#include "fileattributecache.h"
 #include "filefingerprint.h"
 #include "gfx.h"
+#include "hashcash.h"
 #include "http.h"
 #include "json.h"
 #include "mediafileattribute.h"
+#include "metrics.h"
 #include "name_collision.h"
 #include "nodemanager.h"
 #include "pendingcontactrequest.h"
@@ -40,6 +44,7 @@
 #include "setandelement.h"
 #include "sharenodekeys.h"
 #include "sync.h"
+#include "tracing.h"
 #include "transfer.h"
 #include "transferstats.h"
 #include "treeproc.h"
@@ -273,6 +278,21 @@ struct FileAttributesPending : public mapWithLookupExisting<UploadHandle, Upload
     }
 };
 
+// Thumbnail and preview of an upload whose putnodes didn't wait for them (MegaClient::mAttachFileAttributesLater).
+// They are attached to the new node(s) with CommandAttachFA as soon as both the attribute and the node exist.
+struct FileAttributesAfterUpload
+{
+    // types still being generated or sent to the attribute servers
+    int outstanding = 0;
+
+    // set once a putnodes of the upload has finished, and the nodes it created
+    bool putnodesDone = false;
+    vector<NodeHandle> nodes;
+
+    // attributes that were stored before the putnodes finished
+    vector<pair<fatype, handle>> ready;
+};
+
 class MegaClient;
 
 class MEGA_API KeyManager
@@ -719,6 +739,13 @@ public:
     // load all trees: nodes, shares, contacts
     void fetchnodes(bool nocache, bool loadSyncs, bool reloadingMidSession);
 
+    // drop the local state and fetch it again from the servers (the ongoing fetchnodes, if any, completes with it)
+    void reloadFromServers();
+
+    // catching up a session resumed from cache replays the action packets one by one: past this many
+    // (and more than the nodes in the cache), fetching the whole tree again is cheaper
+    static constexpr size_t CATCHUP_MIN_RELOAD_ACTIONPACKETS = 20000;
+
     // fetchnodes stats
     FetchNodesStats fnstats;
 
@@ -838,6 +865,7 @@ public:
 
     // enqueue/abort direct read
     void pread(Node*, m_off_t, m_off_t, void*);
+    void pread(Node*, m_off_t, m_off_t, std::unique_ptr<DirectReadConsumer>);
     void pread(handle, SymmCipher* key, int64_t, m_off_t, m_off_t, void*, bool = false,  const char* = NULL, const char* = NULL, const char* = NULL);
     void preadabort(Node*, m_off_t = -1, m_off_t = -1);
     void preadabort(handle, m_off_t = -1, m_off_t = -1);
@@ -876,8 +904,28 @@ public:
     // send files/folders to user
     void putnodes(const char*, vector<NewNode>&&, int tag, CommandPutNodes::Completion&& completion = nullptr);
 
+    // new node of a finished upload: with mBatchSmallUploads, the ones for the same target
+    // that complete in the same exec() pass go out as a single putnodes command
+    void putnodesOfUpload(NodeHandle target,
+                          VersioningOption vo,
+                          NewNode&& newnode,
+                          int tag,
+                          putsource_t source,
+                          CommandPutNodes::Completion&& completion,
+                          bool canChangeVault);
+
     void putFileAttributes(handle h, fatype t, const std::string& encryptedAttributes, int tag);
 
+    // a file attribute of a mAttachFileAttributesLater upload was stored (fah) or failed (UNDEF).
+    // Returns false if the upload is not tracked there
+    bool lateFileAttributeResolved(UploadHandle uh, fatype type, handle fah);
+
+    // a putnodes of an upload finished, with the created node or undefined on failure
+    void lateFileAttributesTarget(UploadHandle uh, NodeHandle node);
+
+    // memory held by the active downloads, from the network requests to the disk writes
+    stats::DownloadPipelineStats downloadPipelineStats() const;
+
     // attach file attribute to upload or node handle
     bool putfa(NodeOrUploadHandle, fatype, SymmCipher*, int tag, std::unique_ptr<string>);
 
@@ -1414,6 +1462,30 @@ public:
     // cacheable status
     CacheableStatusMap mCachedStatus;
 
+    // Content hashes of the files uploaded by this client, so that an upload whose fingerprint
+    // doesn't match any node (e.g. renamed or touched) can still be a copy of an identical one
+    class ContentHashIndex : private map<string, CachedContentHash>
+    {
+    public:
+        ContentHashIndex(MegaClient *client) { mClient = client; }
+
+        // the file node uploaded with this content, if it's still in the account
+        std::shared_ptr<Node> lookup(const string& hash, m_off_t size);
+
+        // add/update the node for a content, both in memory and DB
+        void add(const string& hash, NodeHandle h);
+
+        // adds an item loaded from DB
+        void load(unique_ptr<CachedContentHash> entry);
+
+        void clear() { map::clear(); }
+
+    private:
+        MegaClient *mClient = nullptr;
+    };
+
+    ContentHashIndex mContentHashIndex;
+
     // warning timestamps related to storage overquota in paywall mode
     vector<m_time_t> mOverquotaWarningTs;
 
@@ -1499,6 +1571,11 @@ private:
     int mPendingCatchUps = 0;
     bool mReceivingCatchUp = false;
 
+    // action packets replayed so far to catch up the state loaded from cache, and
+    // whether the remaining ones should be replaced by a reload once this batch is done
+    size_t mCatchUpActionPackets = 0;
+    bool mCatchUpReload = false;
+
     // account is blocked: stops querying for action packets, pauses transfer & removes transfer slot availability
     bool mBlocked = false;
     bool mBlockedSet = false; //value set in current execution
@@ -1514,6 +1591,22 @@ private:
     // Request status monitor
     unique_ptr<HttpReq> mReqStatCS;
 
+    // secondary cs channel, for the independent commands (see setSecondaryCommandChannel())
+    unique_ptr<HttpReq> pendingcsSecondary;
+    BackoffTimer btcsSecondary;
+    unique_ptr<HashcashSolver> mSecondaryHashcash;
+
+    // sends the batches of the secondary cs channel and processes their responses
+    void execSecondaryCs();
+
+    // URL to post a batch of commands to
+    string csUrl(const string& idempotenceId, bool v3);
+
+    // connection pre-warms in flight, and when each direction + host was last pre-warmed
+    std::list<unique_ptr<HttpReq>> mPrewarmReqs;
+    std::map<string, dstime> mPrewarmedHosts;
+    static constexpr dstime PREWARM_INTERVAL_DS = 600;
+
     // List of Notification IDs that should show in Notification Center
     std::vector<uint32_t> mEnabledNotifications;
 
@@ -1571,12 +1664,18 @@ public:
     // i.e., there must be at least this number of raid transfers to let us predict whether the next download transfer will be raided or non-raided
     static const unsigned MEANINGFUL_PORTION_OF_MAXTRANSFERS_QUEUE_FOR_RAID_PREDICTIVE_SYSTEM;
 
+    // minimum time between chunk progress writes of the same transfer to the persistent cache
+    static const dstime TRANSFERCACHEPROGRESS_DS;
+
     // maximum number of queued putfa before halting the upload queue
     static const int MAXQUEUEDFA;
 
     // maximum number of concurrent putfa
     static const int MAXPUTFA;
 
+    // maximum number of uploads with file attributes still to attach after their putnodes
+    static const size_t MAXLATEFILEATTRIBUTEUPLOADS;
+
     // update time at which next deferred transfer retry kicks in
     void nexttransferretry(direction_t d, dstime*);
 
@@ -1663,7 +1762,7 @@ public:
     bool isprivatehandle(handle*);
 
     // add direct read
-    void queueread(handle, bool, SymmCipher*, int64_t, m_off_t, m_off_t, void*, const char* = NULL, const char* = NULL, const char* = NULL);
+    void queueread(handle, bool, SymmCipher*, int64_t, m_off_t, m_off_t, void*, const char* = NULL, const char* = NULL, const char* = NULL, std::unique_ptr<DirectReadConsumer> = nullptr);
 
     // execute pending direct reads
     bool execdirectreads();
@@ -1716,6 +1815,11 @@ public:
     // transfer cache table
     unique_ptr<DbTable> tctable;
 
+    // group commit of sctable and tctable (see DbTable::setGroupCommit). Commits lost on a crash
+    // are recovered from the SCSN catch-up, and transfers resume from their last synced state
+    static constexpr std::chrono::milliseconds DB_GROUP_COMMIT_DELAY{200};
+    static constexpr unsigned DB_GROUP_COMMIT_MAX_COMMITS = 32;
+
     // during processing of request responses, transfer table updates can be wrapped up in a single begin/commit
     TransferDbCommitter* mTctableRequestCommitter = nullptr;
 
@@ -1769,8 +1873,17 @@ public:
 
     // When triggering an API Hashcash challenge, the HTTP response will contain
     // X-Hashcash header, with relevant data to be saved and used for the next retry.
-    string mReqHashcashToken;
-    uint8_t mReqHashcashEasiness{};
+    // The challenge is solved in the background, and the retry waits for it.
+    unique_ptr<HashcashSolver> mReqHashcash;
+
+    // starts solving the challenge received in req
+    void solveHashcash(unique_ptr<HashcashSolver>& solver, HttpReq& req);
+
+    // a retry must wait while its challenge is being solved
+    static bool solvingHashcash(const unique_ptr<HashcashSolver>& solver) { return solver && !solver->done(); }
+
+    // hands the solution, if any, to the retry
+    void attachHashcash(unique_ptr<HashcashSolver>& solver, HttpReq& req);
 
     // Only queue the "Server busy" event once, until the current cs completes, otherwise we may DDOS
     // ourselves in cases where many clients get 500s for a while and then recover at the same time
@@ -1786,7 +1899,7 @@ public:
     void persistAlert(UserAlert::Base* a);
 
     // record type indicator for statusTable
-    enum StatusTableRecType { CACHEDSTATUS };
+    enum StatusTableRecType { CACHEDSTATUS, CACHEDCONTENTHASH };
 
     // open/create "statecache" and "nodes" tables in DB
     void opensctable();
@@ -1824,6 +1937,59 @@ public:
     bool insca;
     bool insca_notlast;
 
+    // Opt-in: while actionpackets are spoonfed ("ir":1), notifypurge() is postponed, so the changes
+    // of consecutive batches are written to DB and reported once per node, with the last one.
+    // The scsn in DB only advances with them. Up to MAX_COALESCED_NODES changed nodes are kept.
+    bool mCoalesceActionPackets = false;
+    static constexpr size_t MAX_COALESCED_NODES = 100000;
+    bool coalescingActionPackets();
+
+    // Opt-in: independent commands (Command::mIndependent) are sent through a second cs request,
+    // so they don't wait for the round trip of the batch in flight, e.g. on high-latency links
+    void setSecondaryCommandChannel(bool enable);
+
+    // Opt-in: one connection is opened in advance to each storage server returned by `g`/`u`
+    // (at most every PREWARM_INTERVAL_DS per server), ready for the parallel chunk requests
+    bool mPrewarmStorageConnections = false;
+    void prewarmStorageConnections(const std::vector<string>& urls, direction_t d);
+
+    // Opt-in: large non-raid transfers probe how many parallel connections give the best
+    // throughput (see TransferSlot::adaptConnections()), up to MAX_NUM_CONNECTIONS.
+    // The last count that transfers converged on per direction is where the next ones start
+    bool mAdaptiveConnections = false;
+    int mLearnedConnections[2] = {};
+
+    // Default for the downloads created from now on (Transfer::mDiskAllocation).
+    // Preallocating keeps large files unfragmented, and failures surface before any data is fetched
+    Transfer::DiskAllocation mDownloadDiskAllocation = Transfer::DISK_ALLOCATION_GROW;
+
+    // Opt-in: a download with several local targets hard links the extra ones (see FileDistributor)
+    bool mDistributeWithHardLinks = false;
+
+    // Memory per raid download for the parts that get ahead of the slowest one (RaidBufferManager::setRaidLookahead)
+    m_off_t mRaidLookaheadBytes = 0;
+
+    // Signalled by the app, ie. upon the memory warnings of iOS and Android.  The caches give
+    // memory back, and the raid downloads keep a single chunk ahead until it's NONE again
+    enum class MemoryPressure { NONE, MODERATE, CRITICAL };
+    void setMemoryPressure(MemoryPressure level);
+    MemoryPressure memoryPressure() const { return mMemoryPressure; }
+
+    // the lookahead for raid downloads, as reduced by the memory pressure
+    m_off_t raidLookaheadBytes() const;
+
+    // Opt-in: small uploads take a fraction of a slot in dispatchTransfers (up to twice
+    // MAXTOTALTRANSFERS), and their putnodes are grouped per target (see putnodesOfUpload)
+    bool mBatchSmallUploads = false;
+
+    // Opt-in: putnodes of uploads goes ahead without waiting for the thumbnail and preview, which are
+    // attached afterwards. Beyond MAXLATEFILEATTRIBUTEUPLOADS such uploads, new ones wait as before
+    bool mAttachFileAttributesLater = false;
+
+    // Memory for downloaded data not yet written, for all downloads (see downloadPipelineStats).
+    // Connections don't request more while it's used up, except raid parts behind the others. 0 for no limit
+    m_off_t mDownloadMemoryBudget = 0;
+
     // no two interrelated client instances should ever have the same sessionid
     char sessionid[10];
 
@@ -1858,9 +2024,26 @@ public:
     // A record of which file attributes are needed (or now available) per upload transfer
     FileAttributesPending fileAttributesUploading;
 
+    // The uploads that didn't wait for their file attributes
+    mapWithLookupExisting<UploadHandle, FileAttributesAfterUpload> fileAttributesAfterUpload;
+
     // file attribute fetch channels
     fafc_map fafcs;
 
+    // attributes fetched or uploaded before, when the app gave us a folder to keep them in
+    unique_ptr<FileAttributeCache> mFileAttributeCache;
+
+    // getfa() requests served from that cache, delivered by exec() as fetched ones are
+    struct CachedFileAttribute
+    {
+        handle nodehandle;
+        fatype type;
+        handle fah;
+        int tag;
+        string data;
+    };
+    deque<CachedFileAttribute> mCachedFileAttributes;
+
     // generate attribute string based on the pending attributes for this upload
     void pendingattrstring(UploadHandle, string*);
 
@@ -1869,6 +2052,7 @@ public:
     dsdrn_map dsdrns;      // indicates the time at which DRNs should be retried
     dr_list drq;           // DirectReads that are in DirectReadNodes which have fectched URLs
     drs_list drss;         // DirectReadSlot for each DR in drq, up to Max
+    StreamingCache mStreamingCache;   // data the DirectReads delivered, served again to later reads
     void removeAppData(void* t); // remove appdata (usually a MegaTransfer*) from every DirectRead
 
     // merge newly received share into nodes
@@ -1914,6 +2098,8 @@ public:
     // transfer tslots
     transferslot_list tslots;
 
+    MemoryPressure mMemoryPressure = MemoryPressure::NONE;
+
     // raid transfers counter
     unsigned raidTransfersCounter{};
 
@@ -1968,6 +2154,10 @@ public:
     // update transfer in the persistent cache
     void transfercacheadd(Transfer*, TransferDbCommitter*);
 
+    // same for chunk progress, but at most every TRANSFERCACHEPROGRESS_DS per transfer; the
+    // transfer is marked for its slot to write it later (TransferSlot::doio or its destructor)
+    void transfercacheprogress(Transfer*, TransferDbCommitter&);
+
     // remove a transfer from the persistent cache
     void transfercachedel(Transfer*, TransferDbCommitter* committer);
 
@@ -2090,11 +2280,23 @@ public:
 
 #endif
     // determine if all transfer slots are full
-    bool slotavail() const;
+    bool slotavail(bool smallUpload = false) const;
 
     // transfer queue dispatch/retry handling
     void dispatchTransfers();
 
+    // upload putnodes waiting for the end of the exec() pass, by target/versioning/source/vault
+    struct QueuedUploadPutnodes
+    {
+        vector<NewNode> nodes;
+
+        // tag and completion of each node's upload
+        vector<pair<int, CommandPutNodes::Completion>> owners;
+    };
+    map<tuple<NodeHandle, VersioningOption, putsource_t, bool>, QueuedUploadPutnodes> mQueuedUploadPutnodes;
+
+    void sendQueuedUploadPutnodes();
+
     void freeq(direction_t);
 
     // client-server request double-buffering
@@ -2316,15 +2518,18 @@ public:
     // process node subtree
     void proctree(std::shared_ptr<Node>, TreeProc*, bool skipinshares = false, bool skipversions = false);
 
+    // same, but the subtree is gathered level by level first and then given to TreeProc::procBatch()
+    void proctreeInBatches(std::shared_ptr<Node>, TreeProc*, bool skipinshares = false, bool skipversions = false);
+
     // hash password
     error pw_key(const char*, byte*) const;
 
-    // returns a pointer to tmptransfercipher setting its key to the one provided
-    // tmptransfercipher key will change: to be used right away: this is not a dedicated SymmCipher for the transfer!
+    // returns a cipher from SymmCipherCache::local() set with the key provided
+    // its key may change: to be used right away: this is not a dedicated SymmCipher for the transfer!
     SymmCipher *getRecycledTemporaryTransferCipher(const byte *key, int type = 1);
 
-    // returns a pointer to tmpnodecipher setting its key to the one provided
-    // tmpnodecipher key will change: to be used right away: this is not a dedicated SymmCipher for the node!
+    // returns a cipher from SymmCipherCache::local() set with the key provided
+    // its key may change: to be used right away: this is not a dedicated SymmCipher for the node!
     SymmCipher *getRecycledTemporaryNodeCipher(const string *key);
     SymmCipher *getRecycledTemporaryNodeCipher(const byte *key);
 
@@ -2456,11 +2661,34 @@ public:
         uint64_t transferStarts = 0, transferFinishes = 0;
         uint64_t transferTempErrors = 0, transferFails = 0;
         uint64_t prepwaitImmediate = 0, prepwaitZero = 0, prepwaitHttpio = 0, prepwaitFsaccess = 0, nonzeroWait = 0;
+        uint64_t applyKeysSerial = 0, applyKeysParallel = 0, applyKeysBatches = 0;
+        uint64_t fetchnodesKeysSerial = 0, fetchnodesKeysParallel = 0, fetchnodesKeysBatches = 0;
+        // DB look-ups by fingerprint skipped by the filter / done and found nothing / done and found nodes
+        uint64_t fingerprintFilterNegatives = 0, fingerprintFilterFalsePositives = 0, fingerprintFilterPositives = 0;
         CodeCounter::DurationSum csRequestWaitTime;
         CodeCounter::DurationSum transfersActiveTime;
         std::string report(bool reset, HttpIO* httpio, Waiter* waiter, const RequestDispatcher& reqs);
     } performanceStats;
 
+    // Exported through the MetricsRegistry, labelled with the client's number in the process.
+    // Unlike the above, they are never reset.
+    struct Metrics
+    {
+        Metrics();
+
+        const string labels;
+        MetricCounter transfersStarted;
+        MetricCounter transfersFinished;
+        MetricCounter transferTemporaryErrors;
+        MetricCounter transferFailures;
+        MetricGauge csRequestsInFlight;
+        MetricHistogram csRequestMilliseconds;
+        MetricsRegistration registration;
+    } mMetrics;
+
+    // Always on, unlike the above: phase histograms and slow slices of the client thread
+    EventLoopMonitor mLoopMonitor;
+
     std::string getDeviceidHash();
 
     /**
@@ -2548,16 +2776,28 @@ private:
     // Since it's quite expensive to create a SymmCipher, this are provided to use for quick operations - just set the key and use.
     SymmCipher tmpnodecipher;
 
-    // Since it's quite expensive to create a SymmCipher, this is provided to use for quick operation - just set the key and use.
-    SymmCipher tmptransfercipher;
-
     error changePasswordV1(User* u, const char* password, const char* pin);
     error changePasswordV2(const char* password, const char* pin);
-    void fillCypheredAccountDataV2(const char* password, vector<byte>& clientRandomValue, vector<byte>& encmasterkey,
-                                   string& hashedauthkey, string& salt);
+    // the completion gets the client random value, the encrypted master key, the hashed auth key and the salt
+    using CypheredAccountDataV2Completion = std::function<void(vector<byte>&, vector<byte>&, string&, string&)>;
+    void fillCypheredAccountDataV2(const char* password, CypheredAccountDataV2Completion completion);
 
     static vector<byte> deriveKey(const char* password, const string& salt, size_t derivedKeySize);
 
+    // PBKDF2 takes hundreds of milliseconds on slow devices: deriveKeyAsync() runs it in the
+    // worker threads and the completion is called from exec(), in the order of the requests
+    struct PendingKeyDerivation
+    {
+        vector<byte> derivedKey;
+        std::atomic<bool> done{false};
+        std::function<void(const vector<byte>&)> completion;
+        int tag = 0;
+    };
+    std::deque<shared_ptr<PendingKeyDerivation>> mPendingKeyDerivations;
+
+    void deriveKeyAsync(const char* password, const string& salt, size_t derivedKeySize, std::function<void(const vector<byte>&)> completion);
+    void processPendingKeyDerivations();
+
 //
 // JourneyID and ViewID
 //
@@ -2597,13 +2837,17 @@ public:
     // generate "aft" command
     void fetchSetInPreviewMode(std::function<void(Error, Set*, elementsmap_t*)> completion);
 
-    // generate "aepb" command
+    // bulk Element commands carry at most this many Elements: bigger requests are split in several
+    // commands, and their results are reported together once all of them finished
+    static constexpr size_t SET_ELEMENTS_PER_COMMAND = 1000;
+
+    // generate "aepb" command(s)
     void putSetElements(vector<SetElement>&& els, std::function<void(Error, const vector<const SetElement*>*, const vector<int64_t>*)> completion);
 
     // generate "aep" command
     void putSetElement(SetElement&& el, std::function<void(Error, const SetElement*)> completion);
 
-    // generate "aerb" command
+    // generate "aerb" command(s)
     void removeSetElements(handle sid, vector<handle>&& eids, std::function<void(Error, const vector<int64_t>*)> completion);
 
     // generate "aer" command
@@ -2693,7 +2937,7 @@ private:
     void sc_ass(); // AP after exported set update
 
     bool initscsets();
-    bool fetchscset(string* data, uint32_t id);
+    bool fetchscset(unique_ptr<Set> s, uint32_t id); // s unserialized by fetchsc(), null on error
     bool updatescsets();
     void notifypurgesets();
     void notifyset(Set*);
@@ -2701,7 +2945,7 @@ private:
     map<handle, Set> mSets; // indexed by Set id
 
     bool initscsetelements();
-    bool fetchscsetelement(string* data, uint32_t id);
+    bool fetchscsetelement(unique_ptr<SetElement> el, uint32_t id); // same as fetchscset()
     bool updatescsetelements();
     void notifypurgesetelements();
     void notifysetelement(SetElement*);
@@ -2804,8 +3048,16 @@ public:
     // Data type to handle wrongly formatted password info. Key: info, val: ErrCode
     using BadPasswordData = std::map<std::string, PasswordEntryError>;
 
+    // password nodes created by a single putnodes command: bigger imports are sent in several
+    // consecutive commands, one after the other finished
+    static constexpr size_t PASSWORD_NODES_PER_COMMAND = 1000;
+
     /**
-     * @brief Creates multiple password nodes with a single putnodes call
+     * @brief Creates multiple password nodes with putnodes calls of up to PASSWORD_NODES_PER_COMMAND
+     * nodes each
+     *
+     * The result is reported once, through MegaApp::putnodes_result with rTag, with all the nodes
+     * created. If one of the commands fails, the remaining nodes are not sent.
      *
      * @note API_EARGS will be returned if:
      *     - nParent is not a password node folder
@@ -2815,11 +3067,14 @@ public:
      * the password (AttrMap) as values.
      * @param nParent The parent node that will contain the nodes to be created
      * @param rTag tag parameter for putnodes call
+     * @param progress If set, called with the nodes created so far and the total every time one
+     * of the commands (but the last) finishes
      * @return error code (API_OK if succeeded)
      */
     error createPasswordNodes(const ValidPasswordData& data,
                               std::shared_ptr<Node> nParent,
-                              int rTag);
+                              int rTag,
+                              std::function<void(size_t created, size_t total)> progress = nullptr);
 
     /**
      * @brief Ensures the given data can be used to create a new password node.
@@ -2856,6 +3111,16 @@ public:
         validatePasswordEntries(std::vector<pwm::import::PassEntryParseResult>&& entries,
                                 ncoll::NameCollisionSolver& nameValidator);
 
+    /**
+     * @brief Validates a single entry, adding it to bad or good as validatePasswordEntries does.
+     *
+     * Meant for the entries coming from the streaming parser, so they don't need to be stored.
+     */
+    static void validatePasswordEntry(pwm::import::PassEntryParseResult&& entry,
+                                      ncoll::NameCollisionSolver& nameValidator,
+                                      BadPasswordData& bad,
+                                      ValidPasswordData& good);
+
     static std::string generatePasswordChars(const bool useUpper,
                                              const bool useDigits,
                                              const bool useSymbols,
@@ -0,0 +1,172 @@
+/**
+ * @file mega/metrics.h
+ * @brief Counters, gauges and histograms exported by the SDK's modules
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_METRICS_H
+#define MEGA_METRICS_H 1
+
+#include "types.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+namespace mega {
+
+// A value exported under a name, with labels telling apart the instances of the same metric
+// (e.g. client="2"). Updates are lock-free: only the export takes a lock.
+class MEGA_API Metric
+{
+public:
+    enum class Type
+    {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM,
+    };
+
+    // labels in the export's syntax, without braces: name="value",other="value"
+    Metric(Type type, string name, string help, string labels);
+    virtual ~Metric() = default;
+
+    MEGA_DISABLE_COPY_MOVE(Metric)
+
+    Type type() const { return mType; }
+    const string& name() const { return mName; }
+    const string& help() const { return mHelp; }
+    const string& labels() const { return mLabels; }
+
+private:
+    const Type mType;
+    const string mName;
+    const string mHelp;
+    const string mLabels;
+};
+
+// only goes up: the export's name would end in _total
+class MEGA_API MetricCounter : public Metric
+{
+public:
+    MetricCounter(string name, string help, string labels = string());
+
+    void add(uint64_t n = 1) { mValue.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return mValue.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> mValue{0};
+};
+
+class MEGA_API MetricGauge : public Metric
+{
+public:
+    MetricGauge(string name, string help, string labels = string());
+
+    void set(int64_t value) { mValue.store(value, std::memory_order_relaxed); }
+    void add(int64_t n) { mValue.fetch_add(n, std::memory_order_relaxed); }
+    int64_t value() const { return mValue.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> mValue{0};
+};
+
+// Counts of the values recorded, HDR-style: exact below SUB_BUCKETS, and above that in
+// SUB_BUCKETS buckets per power of two, so any value is known within 1/SUB_BUCKETS of itself.
+// Values from 2^MAX_EXPONENT on count in the last bucket.
+class MEGA_API MetricHistogram : public Metric
+{
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_EXPONENT = 40;
+    static constexpr size_t BUCKETS = SUB_BUCKETS * (MAX_EXPONENT - SUB_BUCKET_BITS + 1);
+
+    struct Snapshot
+    {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        std::vector<uint64_t> buckets;
+
+        // the value under which this fraction of them fall, to within a bucket
+        uint64_t quantile(double fraction) const;
+
+        // values at most this many
+        uint64_t countUpTo(uint64_t value) const;
+    };
+
+    MetricHistogram(string name, string help, string labels = string());
+
+    void record(uint64_t value);
+
+    // while others record: the count and the buckets may be a few values apart
+    Snapshot snapshot() const;
+
+    static size_t bucketOf(uint64_t value);
+
+    // the largest value counted in the bucket
+    static uint64_t bucketLimit(size_t bucket);
+
+private:
+    std::atomic<uint64_t> mSum{0};
+    std::unique_ptr<std::atomic<uint64_t>[]> mBuckets;
+};
+
+// The metrics exported, from every module. A module lists its metrics for as long as they live
+// with a MetricsRegistration, so the registry never sees one going away.
+class MEGA_API MetricsRegistry
+{
+public:
+    static MetricsRegistry& instance();
+
+    // each metric, by name, holding the registry's lock
+    void visit(std::function<void(const Metric&)> visitor) const;
+
+    // The Prometheus text format (0.0.4), which OpenMetrics scrapers take also. Histograms get
+    // their buckets at each power of two.
+    string exportText() const;
+
+private:
+    friend class MetricsRegistration;
+
+    void add(const Metric* metric);
+    void remove(const Metric* metric);
+
+    mutable std::mutex mMutex;
+    std::vector<const Metric*> mMetrics;
+};
+
+class MEGA_API MetricsRegistration
+{
+public:
+    MetricsRegistration(std::initializer_list<const Metric*> metrics,
+                        MetricsRegistry& registry = MetricsRegistry::instance());
+
+    // waits for an export in progress
+    ~MetricsRegistration();
+
+    MEGA_DISABLE_COPY_MOVE(MetricsRegistration)
+
+private:
+    MetricsRegistry& mRegistry;
+    std::vector<const Metric*> mMetrics;
+};
+
+} // namespace
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef MEGA_NAME_ID_H
 #define MEGA_NAME_ID_H
 
+#include <cstddef>
 #include <cstdint>
 
 namespace mega
@@ -46,6 +47,97 @@ static constexpr nameid mcsmr = MAKENAMEID5('m', 'c', 's', 'm', 'r');
 #endif
 } // namespace name_id
 
+// compile-time perfect hash from a fixed set of nameids to their position in
+// that set, so that field loops can switch over a dense index (a jump table)
+// instead of a search over sparse 64-bit ids; names outside the set map to
+// size(), which lands in the switch's default branch
+template<std::size_t N>
+class NameIdDispatch
+{
+public:
+    template<typename... T>
+    constexpr explicit NameIdDispatch(T... names):
+        mNames{static_cast<nameid>(names)...}
+    {
+        static_assert(sizeof...(T) == N, "one nameid per entry");
+
+        for (unsigned attempt = 0; attempt < MAX_ATTEMPTS && !mValid; ++attempt)
+        {
+            mMultiplier = SEED + attempt * STEP;
+            mValid = fill();
+        }
+    }
+
+    // position of the name in the set, or size() if it isn't part of it
+    constexpr std::size_t operator()(nameid name) const
+    {
+        const std::size_t slot = mSlots[hash(name)];
+        return (slot && mNames[slot - 1] == name) ? slot - 1 : N;
+    }
+
+    constexpr std::size_t size() const
+    {
+        return N;
+    }
+
+    // false if no collision-free multiplier was found (e.g. duplicate names)
+    constexpr bool valid() const
+    {
+        return mValid;
+    }
+
+private:
+    static_assert(N > 0 && N < 255, "slots store positions in a byte");
+
+    static constexpr unsigned bitsFor(std::size_t n)
+    {
+        unsigned bits = 1;
+        while ((std::size_t(1) << bits) < 4 * n)
+        {
+            ++bits;
+        }
+        return bits;
+    }
+
+    static constexpr unsigned BITS = bitsFor(N);
+    static constexpr std::size_t SLOTS = std::size_t(1) << BITS;
+    static constexpr unsigned MAX_ATTEMPTS = 4096;
+    static constexpr nameid SEED = 0x9E3779B97F4A7C15ull;
+    static constexpr nameid STEP = 0x2545F4914F6CDD1Eull;
+
+    constexpr std::size_t hash(nameid name) const
+    {
+        return static_cast<std::size_t>((name * mMultiplier) >> (64 - BITS));
+    }
+
+    constexpr bool fill()
+    {
+        for (std::size_t i = 0; i < SLOTS; ++i)
+        {
+            mSlots[i] = 0;
+        }
+
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            std::uint8_t& slot = mSlots[hash(mNames[i])];
+            if (slot)
+            {
+                return false;
+            }
+            slot = static_cast<std::uint8_t>(i + 1);
+        }
+        return true;
+    }
+
+    nameid mNames[N];
+    std::uint8_t mSlots[SLOTS] = {};
+    nameid mMultiplier = SEED;
+    bool mValid = false;
+};
+
+template<typename... T>
+NameIdDispatch(T...) -> NameIdDispatch<sizeof...(T)>;
+
 } // namespace mega
 
 #endif // MEGA_NAME_ID_H
@@ -143,7 +143,14 @@ public:
     shared_ptr<Node> getNodeInRam(bool updatePositionAtLRU = true);
     NodeHandle getNodeHandle() const;
 
+    // queue of the cache LRU that mLRUPosition points into (the probation one is used by the 2Q policy)
+    enum class LRUQueue { NONE, MAIN, PROBATION };
+    LRUQueue mLRUQueue = LRUQueue::NONE;
+    // only valid if mLRUQueue isn't NONE
     std::list<std::shared_ptr<Node> >::const_iterator mLRUPosition;
+    // bytes charged to the cache LRU for this node (only when its size is limited by bytes)
+    size_t mLRUCharge = 0;
+    bool isInCacheLRU() const;
 
 private:
     NodeHandle mNodeHandle;
@@ -244,6 +251,34 @@ struct MEGA_API Node : public NodeCore, FileFingerprint
     // try to resolve node key string
     bool applykey();
 
+    // applykey() split in steps, so the decryption can be done by a worker thread:
+    // prepareKeyDecryption() and finishKeyDecryption() use the client and must be called from
+    // its thread, KeyDecryption::decrypt() only uses the data captured by the former.
+    // The node must not change in between.
+    struct KeyDecryption
+    {
+        string encryptedKey;
+        byte cipherKey[SymmCipher::KEYLENGTH];
+        const string* attrString = nullptr;
+        unsigned keyLength = 0;
+        bool foreign = false;
+
+        // the client's private key, if the node key is RSA-encrypted (its operations are const)
+        const AsymmCipher* rsaKey = nullptr;
+
+        // results
+        byte key[FILENODEKEYLENGTH];
+        bool keyDecrypted = false;
+        std::unique_ptr<byte[]> attrs;
+
+        void decrypt(SymmCipher& cipher);
+    };
+
+    // false if there's nothing to decrypt this way (no suitable key yet, RSA-encrypted key without
+    // a private key or key already applied). Then applykey() must be used
+    bool prepareKeyDecryption(KeyDecryption& kd);
+    bool finishKeyDecryption(KeyDecryption& kd);
+
     // Returns false if the share key can't correctly decrypt the key and the
     // attributes of the node. Otherwise, it returns true. There are cases in
     // which it's not possible to check if the key is valid (for example when
@@ -258,6 +293,7 @@ struct MEGA_API Node : public NodeCore, FileFingerprint
 
     // decrypt attribute string, set fileattrs and save fingerprint
     void setattr();
+    void setattr(byte* decryptedAttrs);
 
     // display name (UTF-8)
     const char* displayname() const;
@@ -361,6 +397,31 @@ struct MEGA_API Node : public NodeCore, FileFingerprint
         bool tags : 1;
     } changed;
 
+    // 'changed' as a bit mask, for whom needs to keep it (the values match MegaNode::CHANGE_TYPE_*).
+    // Internal fields aren't included
+    enum : uint64_t
+    {
+        CHANGED_REMOVED = 0x01,
+        CHANGED_ATTRS = 0x02,
+        CHANGED_OWNER = 0x04,
+        CHANGED_CTIME = 0x08,
+        CHANGED_FILEATTRSTRING = 0x10,
+        CHANGED_INSHARE = 0x20,
+        CHANGED_OUTSHARES = 0x40,
+        CHANGED_PARENT = 0x80,
+        CHANGED_PENDINGSHARES = 0x100,
+        CHANGED_PUBLICLINK = 0x200,
+        CHANGED_NEWNODE = 0x400,
+        CHANGED_NAME = 0x800,
+        CHANGED_FAVOURITE = 0x1000,
+        CHANGED_COUNTER = 0x2000,
+        CHANGED_SENSITIVE = 0x4000,
+        CHANGED_PWD = 0x8000,
+        CHANGED_DESCRIPTION = 0x10000,
+        CHANGED_TAGS = 0x20000,
+    };
+    uint64_t changedMask() const;
+
 
     void setKey(const string& key);
     void setkey(const byte*);
@@ -500,6 +561,12 @@ struct MEGA_API Node : public NodeCore, FileFingerprint
     bool isPasswordNode() const;
     bool isPasswordNodeFolder() const;
 
+    // estimated bytes of RAM used by this node, including the heap blocks it owns
+    size_t getMemoryFootprint() const;
+
+    // release the spare capacity of the buffers owned by this node (see NodeManager::setCompactNodes)
+    void shrinkToFit();
+
 private:
     // full folder/file key, symmetrically or asymmetrically encrypted
     // node crypto keys (raw or cooked -
@@ -510,6 +577,11 @@ private:
     NodeCounter mCounter;
 
     static nameid getExtensionNameId(const std::string& ext);
+
+    // steps shared by applykey() and finishKeyDecryption()
+    const char* locateDecryptableKey(SymmCipher*& sc, bool& foreign);
+    void setDecryptedKey(const byte* key, unsigned keylength, std::unique_ptr<byte[]>* decryptedAttrs);
+    bool checkKeyApplied();
 };
 
 inline const string& Node::nodekey() const
@@ -551,7 +623,14 @@ public:
     std::string getDescription();
     std::string getTags();
     handle getHandle();
+    handle getParentHandle();
 
+    // Parse all components up front. It doesn't depend on client's state, so it can be done
+    // by a worker thread before calling createNode() from the client's thread
+    bool parse() { return !readFailed(); }
+
+    // Parsed members are moved into the new Node, so this can be called only once.
+    // The serialized buffer must be alive until it returns
     std::unique_ptr<Node> createNode(MegaClient& client, bool fromOldCache, std::list<std::unique_ptr<NewShare>>& ownNewshares);
 
     enum
@@ -586,7 +665,7 @@ private:
     string mAuthKey;
     std::unique_ptr<byte[]> mShareKey;
     int mShareDirection = INT_MAX; // valid values are -1 (outshares) and 0 (inshare)
-    std::list<std::vector<char>> mShares;
+    std::vector<std::pair<const char*, size_t>> mShares; // views over the serialized buffer
     AttrMap mAttrs;
     string mAttrString; // encrypted attrs
     handle mPubLinkHandle = 0;
@@ -655,6 +734,10 @@ struct MEGA_API LocalNodeCore
     // The fingerprint of the node and/or file we are synced with
     FileFingerprint syncedFingerprint;
 
+    // For folders, their mtime when last scanned (0 if unknown), kept across restarts.
+    // Folders whose mtime differs now have had entries added or removed, so they're scanned first.
+    m_time_t mtimeAsScanned = 0;
+
     // FILENODE or FOLDERNODE
     nodetype_t type = TYPE_UNKNOWN;
 
@@ -683,7 +766,9 @@ struct MEGA_API LocalNode
     localnode_map children;
 
     unique_ptr<LocalPath> cloneShortname() const;
-    localnode_map schildren;
+
+    // children by shortname, allocated only once a child has one (most folders never do)
+    unique_ptr<localnode_map> schildren;
 
     // The last scan of the folder (for folders).
     // Removed again when the folder is fully synced.
@@ -745,6 +830,9 @@ struct MEGA_API LocalNode
         unsigned scanInProgress : 1;
         unsigned scanObsolete : 1;
 
+        // the filesystem reported a change here, its next scan goes ahead of the background ones
+        unsigned scanInteractive : 1;
+
         // When recursing the tree, sometimes we need a node to set a flag in its parent
         // but, on other runs we skip over some nodes (eg. syncHere flag false)
         // however, we still need to compute the required flags for the parent node.
@@ -949,10 +1037,13 @@ struct MEGA_API LocalNode
     // True if this subtree requires syncing.
     bool syncRequired() const;
 
+    // True if recursiveSync() has anything to do for this subtree, or for its parent on its behalf
+    bool flaggedForVisit() const;
+
     // Pass any TREE_ACTION_SUBTREE flags on to child nodes, so we can clear the flag at this level
     void propagateAnySubtreeFlags();
 
-    // Queue a scan request for this node if needed, and if a slot is available (just one per sync)
+    // Queue a scan request for this node if needed, and if a slot is available (one per scan worker thread)
     // Also receive the results if they are ready
     bool processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath);
 
@@ -965,10 +1056,16 @@ struct MEGA_API LocalNode
     treestate_t checkTreestate(bool notifyChangeToApp);
     void recursiveSetAndReportTreestate(treestate_t ts, bool recurse, bool reportToApp);
 
+    // adds (or removes) the reported states of the subtree to Syncs::mTreestateIndex, as its paths change
+    void recursiveIndexTreestate(bool add);
+
     // timer to delay upload start
     dstime nagleds = 0;
     void bumpnagleds();
 
+    // Estimated bytes held for this node: the object, its names, and its entries in the parent's and sync's maps
+    size_t memoryUsage() const;
+
     // build full local path to this node
     void getlocalpath(LocalPath&) const;
     LocalPath getLocalPath() const;
@@ -23,16 +23,26 @@
 #ifndef NODEMANAGER_H
 #define NODEMANAGER_H 1
 
+#include <array>
+#include <deque>
 #include <map>
+#include <optional>
 #include <limits>
 #include <set>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
 #include <vector>
+#include "db.h"
 #include "node.h"
 #include "types.h"
 
 namespace mega {
 
 class DBTableNodes;
+struct DBReadPoolStats;
+struct DBBlobStats;
 struct FileFingerprint;
 class FingerprintContainer;
 class MegaClient;
@@ -126,6 +136,18 @@ public:
         mUseAndForTextQuery = useAnd;
     }
 
+    // Nodes whose name could match the name filter, according to the name index of NodeManager.
+    // Nodes not included can be discarded without matching their name. If not set, any node could match
+    void setNameCandidates(std::shared_ptr<const std::unordered_set<handle>> candidates)
+    {
+        mNameCandidates = std::move(candidates);
+    }
+
+    bool isNameCandidate(const handle h) const
+    {
+        return !mNameCandidates || mNameCandidates->count(h);
+    }
+
     const std::string& byName() const
     {
         return mNameFilter.getText();
@@ -240,6 +262,7 @@ private:
     TextPattern mTagFilter;
     bool mTagFilterContainsSeparator{false};
     bool mUseAndForTextQuery{true};
+    std::shared_ptr<const std::unordered_set<handle>> mNameCandidates;
 
     static bool isDocType(const MimeType_t t);
 };
@@ -256,6 +279,38 @@ private:
     size_t mSize;
 };
 
+/**
+ * @brief Position of a keyset-paged look-up
+ *
+ * It keeps the sort key of the last node returned, so the next page starts right after it
+ * instead of skipping all the previous ones. Only valid for the same filter and order.
+ * A default-constructed cursor starts from the first node.
+ */
+class NodeSearchCursor
+{
+public:
+    using SortValue = std::variant<int64_t, std::string>;
+
+    bool atStart() const { return mSortKey.empty() && !mEnd; }
+    bool atEnd() const { return mEnd; }
+
+    int order() const { return mOrder; }
+    const std::vector<SortValue>& sortKey() const { return mSortKey; }
+
+    void moveTo(int order, std::vector<SortValue>&& sortKey)
+    {
+        mOrder = order;
+        mSortKey = std::move(sortKey);
+    }
+
+    void moveToEnd() { mEnd = true; }
+
+private:
+    int mOrder = 0;
+    std::vector<SortValue> mSortKey;
+    bool mEnd = false;
+};
+
 /**
  * @brief The NodeManager class
  *
@@ -290,18 +345,49 @@ public:
     // read children from DB and load them in memory
     sharedNode_list getChildren(const Node *parent, CancelToken cancelToken = CancelToken());
 
+    // Load the subtree of 'root' in memory, up to 'maxDepth' levels below it (no limit if maxDepth < 1),
+    // with a single query to DB. Node records are parsed in parallel by the client's worker threads.
+    // Folders whose children got fully loaded are marked accordingly, so later calls to getChildren()
+    // are resolved from RAM. Only as many levels as fit into the cache LRU are loaded, and reading
+    // stops once there are more nodes than that, so a big subtree isn't read from DB completely.
+    // Returns the number of nodes loaded from DB
+    size_t prefetchSubtree(NodeHandle root, int maxDepth, CancelToken cancelFlag = CancelToken());
+
     sharedNode_vector getChildren(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page);
 
+    // Keyset-paged variant: up to 'pageSize' children (all if 0) that follow 'cursor', which is moved
+    // past them. Unlike offset paging, the cost of a page doesn't depend on how deep it is
+    sharedNode_vector getChildren(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, size_t pageSize, NodeSearchCursor& cursor);
+
+    // Streaming variant: the children that follow 'cursor' are handed to 'processBatch' in batches of
+    // 'batchSize' while they are read from DB. It can return false to stop, and 'cursor' is left after
+    // the last batch handed. Returns false on DB errors. The DB query is still open while 'processBatch'
+    // runs, so it must not stream or page children itself
+    bool streamChildren(const NodeSearchFilter& filter,
+                        int order,
+                        CancelToken cancelFlag,
+                        size_t batchSize,
+                        NodeSearchCursor& cursor,
+                        std::function<bool(sharedNode_vector&)> processBatch);
+
     // get up to "maxcount" nodes, not older than "since", ordered by creation time
-    // Note: nodes are read from DB and loaded in memory
+    // Note: nodes are read from DB and loaded in memory, and then kept up to date as they change,
+    // so the next calls covered by the same range don't query the DB again (see mRecentNodes)
     sharedNode_vector getRecentNodes(unsigned maxcount,
                                      m_time_t since,
                                      bool excludeSensitives = false);
 
+    // Searches limited to some locations are interactive queries, the ones over the whole account
+    // are background queries (see setDbQueryDeadlines)
     sharedNode_vector searchNodes(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page);
 
+    // Background query: it yields to the interactive ones (getChildren(), located searchNodes())
+    // that arrive while it runs, and it's retried afterwards
     std::set<std::string> getAllNodeTags(const char* searchString, CancelToken cancelFlag);
 
+    // Time allowed to every DB query of each DBQueryPriority before it's interrupted (0: no limit)
+    void setDbQueryDeadlines(std::chrono::milliseconds interactive, std::chrono::milliseconds background);
+
     sharedNode_vector getNodesByFingerprint(FileFingerprint& fingerprint);
     sharedNode_vector getNodesByOrigFingerprint(const std::string& fingerprint, Node *parent);
     std::shared_ptr<Node> getNodeByFingerprint(FileFingerprint &fingerprint);
@@ -324,6 +410,10 @@ public:
     std::vector<NodeHandle> getFavouritesNodeHandles(NodeHandle node, uint32_t count);
     size_t getNumberOfChildrenFromNode(NodeHandle parentHandle);
 
+    // Counter of a folder, taken from RAM if it's loaded or else from the aggregates kept in DB,
+    // without loading it. Returns false if the folder isn't found that way (files aren't)
+    bool getFolderCounter(NodeHandle folder, NodeCounter& counter);
+
     // Returns the number of children nodes of specific node type with a query to DB
     // Valid types are FILENODE and FOLDERNODE
     size_t getNumberOfChildrenByType(NodeHandle parentHandle, nodetype_t nodeType);
@@ -342,8 +432,25 @@ public:
     std::shared_ptr<Node> getNodeFromBlob(const string* nodeSerialized);
 
     // attempt to apply received keys to decrypt node's keys
+    // Symmetric keys and attributes are decrypted by the client's worker threads, in batches
+    // of PARALLEL_BATCH_SIZE nodes (see MegaClient::PerformanceStats::applyKeysBatches)
     void applyKeys(uint32_t appliedKeys);
 
+    // same, only for the given nodes (see TreeProcApplyKey)
+    void applyKeys(const sharedNode_vector& nodes);
+
+    // nodes per job when some work is split across the client's worker threads
+    static constexpr size_t PARALLEL_BATCH_SIZE = 512;
+
+    // Fetchnodes from API: a received node is queued instead of applying its key and writing it to DB
+    // right away. Every DECODING_QUEUE_BATCHES batches of PARALLEL_BATCH_SIZE nodes, their symmetric keys
+    // and attributes are decrypted by the worker threads, and then the nodes are finished and written
+    // to DB in the order they were received (see MegaClient::PerformanceStats::fetchnodesKeysBatches).
+    // flushDecodingQueue() must be called at the end of every array of nodes
+    void queueNodeForDecoding(std::shared_ptr<Node> node);
+    void flushDecodingQueue();
+    static constexpr size_t DECODING_QUEUE_BATCHES = 8;
+
     // add node to the notification queue
     void notifyNode(std::shared_ptr<Node> node, sharedNode_vector* nodesToReport = nullptr);
 
@@ -383,7 +490,6 @@ public:
     // Remove fingerprint from mFingerprint
     void removeFingerprint(Node* node, bool unloadNode = false);
     FingerprintPosition invalidFingerprintPos();
-    std::list<std::shared_ptr<Node>>::const_iterator invalidCacheLRUPos() const;
 
     // Node has received last updates and it's ready to store in DB
     void saveNodeInDb(Node *node);
@@ -402,6 +508,10 @@ public:
     // Returns the number of versions for a node (including the current version)
     int getNumVersions(NodeHandle nodeHandle);
 
+    // Returns the versions of a file, starting with itself and followed by the older ones.
+    // Those not in RAM are loaded from the DB at once
+    sharedNode_vector getVersions(NodeHandle nodeHandle);
+
     NodeHandle getRootNodeFiles() const;
     NodeHandle getRootNodeVault() const;
     NodeHandle getRootNodeRubbish() const;
@@ -426,8 +536,91 @@ public:
     uint64_t getCacheLRUMaxSize() const;
     void setCacheLRUMaxSize(uint64_t cacheLRUMaxSize);
 
+    // Limit for the bytes used by the nodes at cache LRU (see Node::getMemoryFootprint).
+    // It applies on top of the limit of nodes set by setCacheLRUMaxSize()
+    uint64_t getCacheLRUMaxBytes() const;
+    void setCacheLRUMaxBytes(uint64_t cacheLRUMaxBytes);
+
+    enum class CacheLRUPolicy
+    {
+        // single queue, nodes are evicted in least-recently-used order
+        LRU = 0,
+        // simplified 2Q: nodes enter a probation queue and only move to the main queue when
+        // they are used again. Probation is evicted first, so one-off walks (ie. a full
+        // searchNodes) don't flush the working set
+        TWO_QUEUES,
+    };
+
+    CacheLRUPolicy getCacheLRUPolicy() const;
+    void setCacheLRUPolicy(CacheLRUPolicy policy);
+
+    struct CacheLRUStats
+    {
+        uint64_t hits = 0;        // lookups of nodes that were at cache LRU
+        uint64_t misses = 0;      // nodes that had to be loaded from DB
+        uint64_t evictions = 0;   // nodes unloaded from cache LRU to honor its limits
+    };
+
+    CacheLRUStats getCacheLRUStats() const;
+
     uint64_t getNumNodesAtCacheLRU() const;
 
+    // Upon memory pressure: unloads the least valuable nodes until at most 'keepNodes' remain at
+    // cache LRU, and drops the lookup caches. The limits of the cache LRU are not changed
+    void releaseMemory(uint64_t keepNodes);
+
+    // Compact mode: nodes loaded in RAM release the spare capacity of their strings and
+    // containers, trading a few reallocations upon updates for a smaller footprint.
+    void setCompactNodes(bool compact);
+    bool compactNodes() const;
+
+    // Bulk load DB mode (see DBTableNodes::setBulkLoad): if enabled, it's used while the nodes
+    // are fetched from servers, from startBulkLoad() until initCompleted()
+    void setBulkLoadDb(bool enable);
+    bool bulkLoadDb() const;
+    void startBulkLoad();
+
+    // Usage of the read-only DB connections (see DBTableNodes::getReadPoolStats)
+    DBReadPoolStats getDbReadPoolStats(bool reset);
+
+    // Compression of the nodes written to DB (see DBTableNodes::setBlobCompression)
+    void setDbBlobCompression(bool enable);
+    bool dbBlobCompression() const;
+    DBBlobStats getDbBlobStats(bool reset);
+
+    // Optional index of node names in RAM (roughly 100 bytes per node). searchNodes() and
+    // getChildren() use it to skip the pattern matching of names that can't match, and to
+    // return right away when no name can. Enabling it reads the names of all nodes from DB
+    void setNameIndexEnabled(bool enabled);
+    bool isNameIndexEnabled() const;
+
+    // Optional full-text index of names, descriptions and tags kept in DB, which narrows the
+    // text filters of searchNodes() and getChildren(). Returns false if SQLite lacks FTS5
+    bool setFullTextIndexEnabled(bool enabled);
+    bool isFullTextIndexEnabled() const;
+
+    // Optional journal of node changes kept in DB, appended by notifyPurge() along with the
+    // nodes, so consumers outside the SDK can catch up from their last sequence, even across
+    // restarts. Only the last MAX_JOURNAL_CHANGES entries are kept
+    static constexpr uint64_t MAX_JOURNAL_CHANGES = 100000;
+    bool setChangeJournalEnabled(bool enabled);
+    bool isChangeJournalEnabled() const;
+
+    // Up to 'limit' entries (0 for all) after 'afterSequence'. 'lastSequence' gets the last one
+    // assigned, and 'missed' whether some entries after 'afterSequence' aren't available anymore
+    // (trimmed, or the journal was emptied by a reload), so the consumer must walk the tree again
+    bool getNodeChanges(uint64_t afterSequence,
+                        size_t limit,
+                        std::vector<DBNodeChange>& changes,
+                        uint64_t& lastSequence,
+                        bool& missed);
+
+    // Estimated false positive rate of the fingerprint filter (1 if it's not built)
+    double getFingerprintFilterFalsePositiveRate() const;
+
+    // Estimated bytes of RAM used by the nodes at cache LRU (see Node::getMemoryFootprint)
+    uint64_t getMemoryUsageOfNodesAtCacheLRU() const;
+
     // true when the filesystem has been initialized
     // i.e., when nodes have been fully loaded from a fetchnodes or from cache
     bool ready();
@@ -476,17 +669,171 @@ private:
         std::set<FileFingerprint, FileFingerprintCmp> mAllFingerprintsLoaded;
     };
 
+    // Bloom filter of the fingerprints stored in DB, so look-ups of fingerprints that aren't
+    // present (new files, in practice) skip the DB query. Bits are never cleared: fingerprints
+    // of removed nodes only make false positives likelier until it's rebuilt
+    class FingerprintFilter
+    {
+    public:
+        // clears the filter and sizes it for 'expectedEntries'
+        void reset(size_t expectedEntries);
+        // the filter can't answer until it has been built
+        void disable();
+        bool isEnabled() const { return !mBits.empty(); }
+
+        void add(const std::string& fingerprint);
+        void add(uint64_t hash);
+        // false if 'fingerprint' is definitely not present (always true when disabled)
+        bool mightContain(const std::string& fingerprint) const;
+
+        // more entries than it was sized for, so false positives are above target
+        bool isOverloaded() const { return mEntries > mCapacity; }
+        size_t entries() const { return mEntries; }
+
+        // probability of a false positive given the bits set so far
+        double falsePositiveRate() const;
+
+        static uint64_t hash(const std::string& fingerprint);
+
+    private:
+        // ~1% false positives with 7 hashes
+        static constexpr size_t BITS_PER_ENTRY = 10;
+        static constexpr unsigned NUM_HASHES = 7;
+        static constexpr size_t MIN_CAPACITY = 1024;
+
+        std::vector<uint64_t> mBits;
+        size_t mNumBits = 0;
+        size_t mBitsSet = 0;
+        size_t mCapacity = 0;
+        // fingerprints that set at least one new bit (so duplicates mostly aren't counted)
+        size_t mEntries = 0;
+    };
+    FingerprintFilter mFingerprintFilter;
+
+    // Reads all fingerprints from DB to build the filter, sized for them to double
+    void rebuildFingerprintFilter();
+    void addToFingerprintFilter(const Node& node);
+
     // Stores nodes that have been loaded in RAM from DB (not necessarily all of them)
     std::map<NodeHandle, NodeManagerNode> mNodes;
 
+    // Lock-striped mirror of the nodes in RAM (and the number of children of the parents
+    // whose children are all known), so read-only lookups don't need to take mMutex.
+    // It's only written while holding mMutex, right where mNodes is updated.
+    class NodeShards
+    {
+    public:
+        static constexpr size_t NUM_SHARDS = 16;
+
+        std::shared_ptr<Node> getNode(NodeHandle h) const;
+        bool getNumChildren(NodeHandle h, size_t& numChildren) const;
+
+        void setNode(NodeHandle h, const std::shared_ptr<Node>& node);
+        // keeps the children counter in line with 'nodeManagerNode'
+        void updateChildren(NodeHandle h, const NodeManagerNode& nodeManagerNode);
+        void erase(NodeHandle h);
+        void clear();
+
+    private:
+        struct Entry
+        {
+            std::weak_ptr<Node> mNode;
+            size_t mNumChildren = 0;
+            bool mAllChildrenKnown = false;
+        };
+
+        struct Shard
+        {
+            mutable std::shared_mutex mMutex;
+            std::map<NodeHandle, Entry> mEntries;
+        };
+
+        std::array<Shard, NUM_SHARDS> mShards;
+
+        Shard& shard(NodeHandle h);
+        const Shard& shard(NodeHandle h) const;
+    } mNodeShards;
+
+    // Trigrams of the names of all nodes (in RAM or not), folded the same way likeCompare()
+    // does (case and accents). Kept in line with DB by putNodeInDb() and node removals.
+    class NodeNameIndex
+    {
+    public:
+        void add(handle h, const std::optional<std::string>& name); // replaces the previous one, if any
+        void remove(handle h);
+        size_t size() const { return mTrigramsByNode.size(); }
+
+        // false if 'text' has no literal sequence long enough to narrow the search
+        bool getCandidates(const std::string& text, std::unordered_set<handle>& candidates) const;
+
+    private:
+        using Trigram = uint64_t;
+
+        // false if some character can't be folded (it would match any character)
+        static bool getTrigrams(const std::string& text, bool isPattern, std::vector<Trigram>& trigrams);
+
+        std::unordered_map<Trigram, std::unordered_set<handle>> mNodesByTrigram;
+        std::unordered_map<handle, std::vector<Trigram>> mTrigramsByNode;
+        // nodes whose name can't be indexed, so they are always candidates
+        std::unordered_set<handle> mUnindexed;
+    };
+    std::unique_ptr<NodeNameIndex> mNameIndex;
+
+    // Restricts the name filter of 'filter' to the candidates of the name index (if enabled).
+    // Returns false if no node can match 'filter'
+    bool setNameCandidates(NodeSearchFilter& filter) const;
+
     uint64_t mCacheLRUMaxSize = std::numeric_limits<uint64_t>::max();
+    uint64_t mCacheLRUMaxBytes = std::numeric_limits<uint64_t>::max();
+    uint64_t mCacheLRUBytes = 0;
+    CacheLRUPolicy mCacheLRUPolicy = CacheLRUPolicy::LRU;
+    CacheLRUStats mCacheLRUStats;
+    bool mCompactNodes = false;
+
+    bool mBulkLoadDb = false;
+    bool mDbBlobCompression = false;
+    bool mInBulkLoad = false;
+    std::chrono::steady_clock::time_point mBulkLoadStart;
+    void endBulkLoad_internal();
+    // main queue (the only one for CacheLRUPolicy::LRU)
     std::list<std::shared_ptr<Node> > mCacheLRU;
+    // probation queue of CacheLRUPolicy::TWO_QUEUES: nodes used once since they were loaded
+    std::list<std::shared_ptr<Node> > mCacheLRUProbation;
 
     std::atomic<uint64_t> mNodesInRam;
 
     // nodes that have changed and are pending to notify to app and dump to DB
     sharedNode_vector mNodeNotify;
 
+    // The handles and ctimes of the mRecentNodesCount most recent files since mRecentNodesSince
+    // (all of them if mRecentNodesComplete), newest first, as the DB returned them to
+    // getRecentNodes(). The nodes notified later update them, so the recent actions of an active
+    // account don't query the DB over and over. Only handles are kept, so the cache LRU still
+    // decides which of those nodes stay in RAM
+    std::vector<std::pair<NodeHandle, m_time_t>> mRecentNodes;
+    bool mRecentNodesValid = false;
+
+    // The children found by childNodeByNameType(), by parent, type and name, so resolving many
+    // paths doesn't look up their common prefixes again. Renames and moves don't update it: a
+    // cached child is checked on use, and dropped if it's no longer there
+    std::map<std::tuple<NodeHandle, nodetype_t, std::string>, NodeHandle> mChildLookups;
+
+    // The results of isAncestor(). Any notified change could alter them (moves, removals and
+    // new nodes), so they are only valid while mTreeGeneration, bumped by notifyNode(), is unchanged
+    std::map<std::pair<NodeHandle, NodeHandle>, bool> mAncestorLookups;
+    uint64_t mAncestorLookupsGeneration = 0;
+    uint64_t mTreeGeneration = 0;
+
+    // size at which each of the lookup caches above is emptied
+    static constexpr size_t LOOKUP_CACHE_SIZE = 4096;
+    bool mRecentNodesComplete = false;
+    unsigned mRecentNodesCount = 0;
+    m_time_t mRecentNodesSince = 0;
+
+    // whether the node would be returned by the DB query of the recent nodes
+    bool isRecentNodeCandidate(const Node& node, m_time_t since) const;
+    void updateRecentNodes(const sharedNode_vector& changedNodes);
+
     shared_ptr<Node> getNodeInRAM(NodeHandle handle);
     void saveNodeInRAM(std::shared_ptr<Node> node, bool isRootnode, MissingParentNodes& missingParentNodes);    // takes ownership
 
@@ -498,15 +845,24 @@ private:
         DECREASE,
     };
 
-    // Update a node counter for 'origin' and its subtree (recursively)
+    // Update a node counter for 'origin' and its ancestors, up to 'stopAt' (excluded)
     // If operationType is INCREASE, nc is added, in other case is decreased (ie. upon deletion)
-    void updateTreeCounter(std::shared_ptr<Node> origin, NodeCounter nc, OperationType operation, sharedNode_vector* nodesToReport);
+    void updateTreeCounter(std::shared_ptr<Node> origin, NodeCounter nc, OperationType operation, sharedNode_vector* nodesToReport, const Node* stopAt = nullptr);
+
+    // Update the counters of the ancestors of the removed nodes in 'nodesToReport' with a single
+    // write per ancestor. Updated ancestors are appended to 'nodesToReport'
+    void discountRemovedNodes(sharedNode_vector& nodesToReport);
+
+    // nullptr if 'a' and 'b' are in different trees (or any of them is nullptr)
+    static std::shared_ptr<Node> getClosestCommonAncestor(std::shared_ptr<Node> a, std::shared_ptr<Node> b);
 
     // returns nullptr if there are unserialization errors. Also triggers a full reload (fetchnodes)
     shared_ptr<Node> getNodeFromNodeSerialized(const NodeSerialized& nodeSerialized);
+    shared_ptr<Node> getNodeFromNodeData(NodeData& nodeData, const std::string& nodeCounter);
 
     // reads from DB and loads the node in memory
     shared_ptr<Node> unserializeNode(const string*, bool fromOldCache);
+    shared_ptr<Node> unserializeNode(NodeData& nodeData, bool fromOldCache);
 
     // returns the counter for the specified node, calculating it recursively and accessing to DB if it's neccesary
     NodeCounter calculateNodeCounter(const NodeHandle &nodehandle, nodetype_t parentType, std::shared_ptr<Node> node, bool isInRubbish);
@@ -526,18 +882,48 @@ private:
     // If a valid object is passed, it must be kept alive until this method returns.
     sharedNode_vector processUnserializedNodes(const std::vector<std::pair<NodeHandle, NodeSerialized>>& nodesFromTable, NodeHandle ancestorHandle = NodeHandle(), CancelToken cancelFlag = CancelToken());
 
-    sharedNode_vector searchNodes_internal(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page);
+    sharedNode_vector searchNodes_internal(const NodeSearchFilter& filter, int order, const DBQueryOptions& options, const NodeSearchPage& page);
     sharedNode_vector processUnserializedNodes(const std::vector<std::pair<NodeHandle, NodeSerialized>>& nodesFromTable, CancelToken cancelFlag);
-    sharedNode_vector getChildren_internal(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page);
+    sharedNode_vector getChildren_internal(const NodeSearchFilter& filter, int order, const DBQueryOptions& options, const NodeSearchPage& page);
+    bool getChildrenFrom_internal(const NodeSearchFilter& filter,
+                                  int order,
+                                  const DBQueryOptions& options,
+                                  size_t limit,
+                                  size_t batchSize,
+                                  NodeSearchCursor& cursor,
+                                  const std::function<bool(sharedNode_vector&)>& processBatch);
+    // true if 'filter' only wants non-sensitive nodes and its parent is sensitive
+    bool isParentExcludedBySensitivity(const NodeSearchFilter& filter);
     sharedNode_vector getRecentNodes_internal(const NodeSearchPage& page, m_time_t since);
+    // the recent nodes from mRecentNodes, if it has all of them (false otherwise)
+    bool getCachedRecentNodes(unsigned maxcount, m_time_t since, bool excludeSensitives, sharedNode_vector& result);
+
+    std::set<std::string> getAllNodeTags_internal(const char* searchString, const DBQueryOptions& options);
+
+    // Interactive DB queries are announced to 'mQueryScheduler' while they wait for 'mMutex', so
+    // the background query holding it can yield
+    DBQueryScheduler mQueryScheduler;
+    std::chrono::milliseconds mInteractiveQueryDeadline{0};
+    std::chrono::milliseconds mBackgroundQueryDeadline{0};
+    // a background query yields this many times at most, and waits this long every time
+    static constexpr unsigned MAX_QUERY_YIELDS = 8;
+    static constexpr std::chrono::milliseconds QUERY_YIELD_WAIT{100};
 
-    std::set<std::string> getAllNodeTags_internal(const char* searchString, CancelToken cancelFlag);
+    DBQueryOptions queryOptions(CancelToken cancelFlag, DBQueryPriority priority) const;
+    std::unique_lock<MutexType> lockForInteractiveQuery();
+    // runs 'query' holding 'mMutex', and again after leaving it to interactive queries if it yielded
+    void runBackgroundQuery(CancelToken cancelFlag, const std::function<void(const DBQueryOptions&)>& query);
 
     // node temporary in memory, which will be removed upon write to DB
     std::shared_ptr<Node> mNodeToWriteInDb;
 
     // Stores (or updates) the node in the DB. It also tries to decrypt it for the last time before storing it.
-    void putNodeInDb(Node* node) const;
+    void putNodeInDb(Node* node);
+    // Same for several nodes, written at once
+    void putNodesInDb(const std::vector<Node*>& nodes);
+    void prepareNodeForDb(Node& node);
+    // keeps the in-RAM indexes of DB contents up to date
+    void nodeStoredInDb(const Node& node);
 
     // true when the NodeManager has been inicialized and contains a valid filesystem
     bool mInitialized = false;
@@ -564,12 +950,35 @@ private:
     sharedNode_vector getNodesByOrigFingerprint_internal(const std::string& fingerprint, Node *parent);
     std::shared_ptr<Node> getNodeByFingerprint_internal(FileFingerprint &fingerprint);
     std::shared_ptr<Node> childNodeByNameType_internal(const Node *parent, const std::string& name, nodetype_t nodeType);
+    // childNodeByNameType_internal() without mChildLookups
+    std::shared_ptr<Node> findChildByNameType_internal(const Node* parent, const std::string& name, nodetype_t nodeType);
     sharedNode_vector getRootNodes_internal();
 
     std::vector<NodeHandle> getFavouritesNodeHandles_internal(NodeHandle node, uint32_t count);
     size_t getNumberOfChildrenFromNode_internal(NodeHandle parentHandle);
     size_t getNumberOfChildrenByType_internal(NodeHandle parentHandle, nodetype_t nodeType);
     bool isAncestor_internal(NodeHandle nodehandle, NodeHandle ancestor, CancelToken cancelFlag);
+    size_t prefetchSubtree_internal(NodeHandle root, int maxDepth, CancelToken cancelFlag);
+
+    struct KeyDecryptionJob
+    {
+        std::shared_ptr<Node> node;
+        Node::KeyDecryption kd;
+        // false if the key is left to Node::applykey()
+        bool prepared = false;
+        // false if owned by this job until written to DB (see mNodeToWriteInDb)
+        bool inRam = true;
+    };
+    // Decrypts the prepared jobs in the worker threads, or in this one if they fit in a single batch.
+    // Returns the number of batches
+    size_t decryptKeys(std::deque<KeyDecryptionJob>& jobs);
+    // applyKeys() steps: queue the node's job, or apply its key right away if it can't be prepared.
+    // Then decrypt what has been queued (in the worker threads) and finish
+    void addKeyToApply_internal(std::deque<KeyDecryptionJob>& jobs, std::shared_ptr<Node> node);
+    void applyQueuedKeys_internal(std::deque<KeyDecryptionJob>& jobs);
+    void queueNodeForDecoding_internal(std::shared_ptr<Node> node);
+    void flushDecodingQueue_internal();
+    std::deque<KeyDecryptionJob> mNodesToDecode;
     void removeChanges_internal();
     void cleanNodes_internal();
     std::shared_ptr<Node> getNodeFromBlob_internal(const string* nodeSerialized);
@@ -591,7 +1000,16 @@ private:
     void setRootNodeRubbish_internal(NodeHandle h);
     void initCompleted_internal();
     void insertNodeCacheLRU_internal(std::shared_ptr<Node> node);
+    void removeNodeCacheLRU_internal(NodeManagerNode& nodeManagerNode);
     void unLoadNodeFromCacheLRU();
+
+    // unloads the least valuable node at cache LRU, in the order of the current policy
+    void evictNodeCacheLRU_internal();
+    bool isCacheLRUOverLimits() const;
+
+    // Moves 'node' to the front of the LRU only if mMutex is free: used by lookups that
+    // were served from mNodeShards, which must not block behind the client thread
+    void tryInsertNodeCacheLRU(const std::shared_ptr<Node>& node);
 };
 
 } // namespace
@@ -89,6 +89,7 @@ public:
 
     bool renamelocal(const LocalPath&, const LocalPath&, bool) override;
     bool copylocal(const LocalPath&, const LocalPath&, m_time_t) override;
+    bool hardlinklocal(const LocalPath&, const LocalPath&) override;
     bool rubbishlocal(string*);
     bool unlinklocal(const LocalPath&) override;
     bool rmdirlocal(const LocalPath&) override;
@@ -117,11 +118,16 @@ public:
                              map<LocalPath, FSNode>& known,
                              std::vector<FSNode>& results,
                              bool followSymLinks,
-                             unsigned& nFingerprinted) override;
+                             unsigned& nFingerprinted,
+                             FingerprintCache* fingerprints) override;
 
 #ifdef ENABLE_SYNC
     bool fsStableIDs(const LocalPath& path) const override;
 
+    bool fsSolidState(const LocalPath& path, bool& solidState) const override;
+
+    bool setBackgroundIO(bool background) override;
+
 #endif // ENABLE_SYNC
 
     bool hardLink(const LocalPath& source, const LocalPath& target) override;
@@ -137,6 +143,10 @@ struct MEGA_API PosixAsyncIOContext : public AsyncIOContext
     void finish() override;
 
     struct aiocb *aiocb;
+
+    // set while queued to io_uring or dispatch, which need no control block
+    bool inflight = false;
+    int fd = -1;
 };
 #endif
 
@@ -146,6 +156,10 @@ private:
     int fd;
 public:
     int stealFileDescriptor();
+
+    // the open descriptor, still owned by this object
+    int fileDescriptor() const;
+
     int defaultfilepermissions;
 
     static bool mFoundASymlink;
@@ -165,6 +179,8 @@ public:
     bool fstat(m_time_t& modified, m_off_t& size) override;
 
     bool ftruncate(m_off_t size) override;
+    bool fpreallocate(m_off_t size) override;
+    bool fsparse(m_off_t size) override;
 
     bool sysread(byte *, unsigned, m_off_t) override;
     bool sysstat(m_time_t*, m_off_t*, FSLogging) override;
@@ -185,6 +201,12 @@ public:
 protected:
     AsyncIOContext* newasynccontext() override;
     static void asyncopfinished(union sigval sigev_value);
+
+    // queues through io_uring (Linux), dispatch (Apple) or POSIX AIO, whichever is available
+    void asyncsysop(AsyncIOContext* context, bool write);
+
+    // common ending of all of them, error is 0 on success
+    static void asyncopcompleted(PosixAsyncIOContext* context, int error);
 #endif
 
 private:
@@ -217,6 +239,9 @@ public:
                             Waiter* waiter) override;
 
 private:
+    // Notifies every node watched under handle, returns Waiter::NEEDEXEC if there were any.
+    int notifyWatches(int handle, const string& name, bool deletedSelf, bool permissionsChanged);
+
     // Tracks which notifiers were created by this instance.
     list<DirNotify*> mNotifiers;
 
@@ -226,6 +251,23 @@ private:
     // Tracks which nodes are associated with what inotify handle.
     WatchMap mWatches;
 
+#ifdef USE_FANOTIFY
+    // Reads fanotify events from mNotifyFd, which marks whole filesystems.
+    int checkFanotifyEvents();
+
+    // Whether mNotifyFd is a fanotify descriptor rather than an inotify one.
+    bool mFanotify = false;
+
+    // Watched folders by file handle, as fanotify reports them.
+    // The IDs stand in for inotify handles in mWatches.
+    map<string, int> mFileHandleIds;
+    map<int, string> mFileHandleKeys;
+    int mNextFileHandleId = 0;
+
+    // How many notifiers share the marks on each filesystem (by device.)
+    map<dev_t, unsigned> mMarkedFilesystems;
+#endif // USE_FANOTIFY
+
 #endif // ENABLE_SYNC
 }; // LinuxFileSystemAccess
 
@@ -256,6 +298,12 @@ private:
 
     // Our position in our owner's mNotifiers list.
     list<DirNotify*>::iterator mNotifiersIt;
+
+#ifdef USE_FANOTIFY
+    // The filesystem we marked, if we did.
+    bool mMarked = false;
+    dev_t mDevice = 0;
+#endif // USE_FANOTIFY
 }; // LinuxDirNotify
 
 #endif // ENABLE_SYNC
@@ -0,0 +1,79 @@
+/**
+ * @file mega/posix/megaiouring.h
+ * @brief Asynchronous file reads and writes through io_uring
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#pragma once
+
+#if defined(__linux__) && defined(HAVE_LINUX_IO_URING_H)
+
+#include <atomic>
+#include <mutex>
+
+#include "mega/types.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace mega {
+
+// A process-wide submission/completion ring, driven with the raw system calls so there is no
+// dependency on liburing. Completions are delivered on the ring's own thread.
+class IoUring
+{
+public:
+    // called with the number of bytes transferred, or -errno
+    typedef void (*Completion)(void* userData, int result);
+
+    // nullptr when the kernel has no io_uring, or it is blocked (as in some containers)
+    static IoUring* instance();
+
+    // false if the operation couldn't be queued (ring full or failing), errno is set then
+    bool submit(bool write, int fd, void* buf, unsigned len, m_off_t pos, Completion completion, void* userData);
+
+    static constexpr unsigned ENTRIES = 256;
+
+private:
+    IoUring() = default;
+    bool setup();
+    void completionLoop();
+
+    int mFd = -1;
+    std::mutex mSubmitMutex;
+
+    // submission queue
+    unsigned* mSqHead = nullptr;
+    unsigned* mSqTail = nullptr;
+    unsigned* mSqMask = nullptr;
+    unsigned* mSqArray = nullptr;
+    ::io_uring_sqe* mSqes = nullptr;
+
+    // completion queue
+    unsigned* mCqHead = nullptr;
+    unsigned* mCqTail = nullptr;
+    unsigned* mCqMask = nullptr;
+    ::io_uring_cqe* mCqes = nullptr;
+
+    // bounded by ENTRIES, so the completion queue (twice as big) can never overflow
+    std::atomic<unsigned> mInFlight{0};
+};
+
+} // namespace
+
+#endif
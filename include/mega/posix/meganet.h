@@ -91,6 +91,8 @@ protected:
     string useragent;
     CURLM* curlm[3];
 
+    // holds curlsh, which may be shared with the other instances (see SharedResources)
+    std::shared_ptr<CURLSH> mCurlShare;
     CURLSH* curlsh;
 #ifdef MEGA_USE_C_ARES
     ares_channel ares;
@@ -109,6 +111,9 @@ protected:
     bool ipv6requestsenabled;
     std::queue<CurlHttpContext *> pendingrequests;
     std::map<string, CurlDNSEntry> dnscache;
+
+    // sets httpctx->resolve to the fresh IPv6 and IPv4 addresses of the host, if both are cached
+    bool raceableaddresses(CurlHttpContext* httpctx);
     int pkpErrors;
 
     void send_pending_requests();
@@ -197,10 +202,78 @@ protected:
     m_time_t curltimeoutreset[3];
     bool arerequestspaused[3];
     int numconnections[3];
-    set<CURL *>pausedrequests[3];
-    m_off_t partialdata[2];
+    // paused transfer requests, resumed round-robin (by priority class) as their budgets refill
+    std::deque<CURL *>pausedrequests[3];
     m_off_t maxspeed[2];
 
+    // bandwidth budgets per direction, per direction and bandwidth class, and per direction and host
+    TokenBucket directionbuckets[2];
+    TokenBucket classbuckets[2][BW_CLASSES];
+    std::map<string, TokenBucket> hostbuckets[2];
+    std::map<string, m_off_t> hostlimits[2];
+    m_off_t hostlimit(direction_t d, const string& host) const;
+
+    // bytes the request may transfer now: the least of all of its budgets
+    m_off_t bandwidthallowance(CurlHttpContext* httpctx);
+    void consumebandwidth(CurlHttpContext* httpctx, m_off_t bytes);
+
+    // cURL upload buffer for transfers, when there is no upload speed limit
+    static const long UPLOAD_BUFFER_SIZE = 512 * 1024;
+
+    // cURL receive buffer for downloads (see setDownloadBufferSize()), 0 for the default
+    long downloadbuffersize = 0;
+
+    // Accept-Encoding of the API requests (see setApiCompression()), empty if disabled
+    string apiacceptencoding;
+
+    // give cURL both the IPv6 and IPv4 addresses of the hosts to race (RFC 8305), when known
+    bool happyeyeballs = false;
+
+    // HTTP/2 multiplexing, per direction (see setHttp2Multiplexing())
+    bool http2multiplexing[3] = {};
+    void applyMultiplexing(direction_t d);
+
+    // requests completed per host, how many of them were HTTP/2 streams,
+    // and how many needed a new connection instead of reusing one
+    struct HostConnectionStats
+    {
+        uint64_t requests = 0;
+        uint64_t http2Streams = 0;
+        uint64_t newConnections = 0;
+
+        // total ms spent resolving the host, connecting and in the TLS handshake
+        double resolveMs = 0;
+        double connectMs = 0;
+        double tlsMs = 0;
+
+        // compressed responses, their size on the wire and once decoded
+        uint64_t encodedResponses = 0;
+        m_off_t encodedBytes = 0;
+        m_off_t decodedBytes = 0;
+    };
+    std::map<string, HostConnectionStats> hostConnectionStats;
+    void recordConnection(CURL* easy_handle, HttpReq* req);
+
+    // health of the storage servers, from the outcome of the transfer requests (EWMAs)
+    struct HostHealth
+    {
+        double errorRate = 0;       // 0 to 1
+        double firstByteMs = 0;     // downloads only
+        double bytesPerSecond = 0;  // requests big enough to measure it
+        unsigned samples = 0;
+        dstime updated = 0;
+    };
+    std::map<string, HostHealth> hostHealth;
+    void updatehealth(CURL* easy_handle, HttpReq* req, bool failed);
+    void updatehealth(HostHealth& health, bool failed, double firstByteMs, double bytesPerSecond);
+
+    // between 0 and 1: the success rate, times the latency and throughput relative to the median of the other hosts
+    double hostscore(const string& host) const;
+
+    static const double HEALTH_EWMA_WEIGHT;
+    static const double DEGRADED_HOST_SCORE;
+    static const dstime HEALTH_MAX_AGE_DS;
+
 public:
     void post(HttpReq*, const char* = 0, unsigned = 0) override;
     void cancel(HttpReq*) override;
@@ -235,6 +308,23 @@ public:
 
     bool cacheresolvedurls(const std::vector<string>& urls, std::vector<string>&& ips) override;
 
+    bool setHttp2Multiplexing(bool api, bool transfers) override;
+
+    // requests, HTTP/2 streams and new connections per host
+    string connectionStatsReport(bool reset);
+
+    bool setHappyEyeballs(bool enable) override;
+
+    bool setHostBandwidthLimit(direction_t d, const string& host, m_off_t bpslimit) override;
+    bool setBandwidthClassLimit(direction_t d, bwclass_t c, m_off_t bpslimit) override;
+
+    bool setDownloadBufferSize(long bytes) override;
+
+    bool setApiCompression(bool enable) override;
+
+    bool isHostDegraded(const string& url) override;
+    void hostStalled(const string& url) override;
+
     CurlHttpIO();
     ~CurlHttpIO();
 
@@ -265,6 +355,13 @@ struct MEGA_API CurlHttpContext
     CurlHttpIO* httpio;
 
     struct curl_slist *headers;
+
+    // both addresses of hostname, for cURL to race them (see setHappyEyeballs())
+    struct curl_slist *resolve = nullptr;
+
+    // from post() until the IP of the host was known
+    double resolveTime = -1;
+
     bool isIPv6;
     bool isCachedIp;
     string hostname;
@@ -278,6 +375,15 @@ struct MEGA_API CurlHttpContext
 #ifdef MEGA_USE_C_ARES
     int ares_pending;
 #endif
+
+    // budget of the host for transfer requests (owned by the CurlHttpIO)
+    TokenBucket* hostbucket = nullptr;
+
+    // the response has a Content-Encoding: cURL decodes it, so its Content-Length
+    // doesn't match the received data, unless it came in Original-Content-Length
+    bool encodedresponse = false;
+    bool originalcontentlength = false;
+    m_off_t decodedbytes = 0;
 };
 
 struct MEGA_API CurlDNSEntry
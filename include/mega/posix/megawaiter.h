@@ -25,7 +25,12 @@
 #include "mega/waiter.h"
 #include <mutex>
 
-#ifndef USE_POLL
+#ifdef USE_EPOLL
+    #include <sys/epoll.h>
+    #include <vector>
+#endif
+
+#if !defined(USE_POLL) && !defined(USE_EPOLL)
     #define MEGA_FD_ZERO FD_ZERO
     #define MEGA_FD_SET FD_SET
     #define MEGA_FD_ISSET FD_ISSET
@@ -54,7 +59,7 @@ struct PosixWaiter : public Waiter
     mega_fd_set_t rfds, wfds, efds;
     mega_fd_set_t ignorefds;
 
-#ifdef USE_POLL
+#if defined(USE_POLL) || defined(USE_EPOLL)
 
     static void clear_fdset(mega_fd_set_t *s)
     {
@@ -78,10 +83,26 @@ struct PosixWaiter : public Waiter
 
     void notify();
 
+#ifdef USE_EPOLL
+    // the registration of fd (if any) is stale, because it was or is about to be closed,
+    // so the number could be reused by a new fd before the next wait()
+    void forgetfd(int fd);
+#endif
+
 protected:
     int m_pipe[2];
     std::mutex mMutex;
     bool alreadyNotified = false;
+
+#ifdef USE_EPOLL
+    // the fds are kept registered across calls to wait() (sorted by fd, with their epoll
+    // events), only the differences with the fd sets of each wait() are updated
+    int mEpollFd = -1;
+    std::vector<std::pair<int, uint32_t>> mRegistered;
+    std::vector<std::pair<int, uint32_t>> mWanted;
+    std::vector<epoll_event> mEvents;
+    void updateregistrations();
+#endif
 };
 } // namespace
 
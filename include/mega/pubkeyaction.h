@@ -49,6 +49,9 @@ class MEGA_API PubKeyActionPutNodes : public PubKeyAction
     vector<NewNode> nn;    // nodes to add
     CommandPutNodes::Completion completion;
 
+    // below this number of nodes, their keys are encrypted in the client's thread
+    static constexpr size_t PARALLEL_BATCH_SIZE = 32;
+
 public:
     void proc(MegaClient*, User*);
 
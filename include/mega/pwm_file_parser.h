@@ -3,6 +3,8 @@
 
 #include "mega/types.h"
 
+#include <functional>
+
 namespace mega::pwm::import
 {
 
@@ -90,6 +92,22 @@ struct PassFileParseResult
  */
 PassFileParseResult parseGooglePasswordCSVFile(const std::string& filePath);
 
+/**
+ * @brief Receives each of the entries parsed from a file, as soon as its row has been read.
+ */
+using PassEntryConsumer = std::function<void(PassEntryParseResult&&)>;
+
+/**
+ * @brief Same as the overload above, but streaming: the entries are handed to onEntry while the
+ * file is read instead of being kept in memory.
+ *
+ * @param filePath The path to the csv file.
+ * @param onEntry Called with every row found in the file, valid or not.
+ * @return The report of the file as a whole. Its mResults member is left empty.
+ */
+PassFileParseResult parseGooglePasswordCSVFile(const std::string& filePath,
+                                               const PassEntryConsumer& onEntry);
+
 enum class FileSource : uint8_t
 {
     GOOGLE_PASSWORD = 0,
@@ -105,6 +123,14 @@ enum class FileSource : uint8_t
  * codes and messages.
  */
 PassFileParseResult readPasswordImportFile(const std::string& filePath, const FileSource source);
+
+/**
+ * @brief Streaming version of readPasswordImportFile: the entries are handed to onEntry as they
+ * are parsed, and the mResults member of the returned object is left empty.
+ */
+PassFileParseResult readPasswordImportFile(const std::string& filePath,
+                                           const FileSource source,
+                                           const PassEntryConsumer& onEntry);
 }
 
 #endif // INCLUDE_MEGA_PWM_FILE_PARSER_H_
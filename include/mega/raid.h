@@ -51,7 +51,11 @@ namespace mega {
             chunkmac_map chunkmacs;
 
             std::condition_variable finalizedCV;
-            bool finalized = false;
+            std::atomic<bool> finalized{false};
+
+            // the whole chunks of a large piece are decrypted as several jobs; the last one to finish finalizes it
+            static constexpr size_t FINALIZE_PART_SIZE = 1024 * 1024;
+            std::atomic<unsigned> pendingParts{0};
 
             FilePiece();
             FilePiece(m_off_t p, size_t len);    // makes a buffer of the specified size (with extra space for SymmCipher::ctr_crypt padding)
@@ -59,7 +63,11 @@ namespace mega {
             void swap(FilePiece& other);
 
             // decrypt & mac
-            bool finalize(bool parallel, m_off_t filesize, int64_t ctriv, SymmCipher *cipher, chunkmac_map* source_chunkmacs);
+            // in parallel mode only the whole chunks with (index % parts == part) are processed
+            bool finalize(bool parallel, m_off_t filesize, int64_t ctriv, SymmCipher *cipher, chunkmac_map* source_chunkmacs, unsigned part = 0, unsigned parts = 1);
+
+            // how many jobs the parallel finalization should be split into, at most one per worker
+            unsigned finalizeParts(unsigned workers);
 
         };
 
@@ -94,6 +102,19 @@ namespace mega {
         // Is this connection unable to continue currently because other connections are too far behind
         bool isRaidConnectionProgressBlocked(unsigned connectionNum) const;
 
+        // Memory that the parts ahead can fill with future raid lines while they wait for the slowest
+        // one, in bytes for all of them. 0 for RaidReadAheadChunksPausePoint chunks per part
+        void setRaidLookahead(m_off_t bytes);
+
+        // how far the received data of this part is behind the part furthest ahead, in bytes of the part
+        m_off_t raidPartLag(unsigned connectionNum) const;
+
+        // received data that is not combined into output pieces yet (raid parts and the leftover), in bytes
+        m_off_t bufferedInputBytes() const;
+
+        // size of the output piece held for a connection, 0 if none
+        m_off_t outputPieceBytes(unsigned connectionNum) const;
+
         // in case URLs expire, use this to update them and keep downloading without wasting any data
         void updateUrlsAndResetPos(const std::vector<std::string>& tempUrls);
 
@@ -149,8 +170,7 @@ namespace mega {
 
         // parameters to control raid download
         enum { RaidMaxChunksPerRead = 5 };
-        enum { RaidReadAheadChunksPausePoint = 8 };
-        enum { RaidReadAheadChunksUnpausePoint = 4 };
+        enum { RaidReadAheadChunksPausePoint = 8 };   // paused parts resume at half the lookahead
 
         bool is_raid{};
         bool is_newRaid{};
@@ -163,6 +183,13 @@ namespace mega {
         // controls buffer sizes used
         unsigned raidLinesPerChunk;
 
+        // see setRaidLookahead()
+        m_off_t raidLookaheadBytes{};
+        m_off_t raidPartLookahead() const;
+
+        // end of the data received for a part, contiguous from raidpartspos
+        m_off_t raidPartReceivedPos(unsigned connectionNum) const;
+
         // of the six raid URLs, which 5 are we downloading from
         unsigned unusedRaidConnection;
 
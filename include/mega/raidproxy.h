@@ -46,6 +46,10 @@ struct uint128_t
 #endif // ! SUPPORTS_TI_EMULATION_MODE
 
 typedef uint128_t raidsector_t;
+
+// Rebuilds data sector `missing` [0 - EFFECTIVE_RAIDPARTS) of `count` consecutive raid lines
+// from the parity sector of each line, XORed with its other data sectors
+void recoverLines(byte* lines, const byte* parity, m_off_t count, unsigned missing);
 using HttpReqType = HttpReqDL;
 using HttpReqPtr = std::shared_ptr<HttpReqType>;
 using HttpInputBuf = ::mega::HttpReq::http_buf_t;
@@ -22,6 +22,8 @@
 #ifndef MEGA_REQUEST_H
 #define MEGA_REQUEST_H 1
 
+#include <chrono>
+
 #include "types.h"
 #include "json.h"
 
@@ -71,24 +73,58 @@ public:
     // if contains only one command and that command is FetchNodes
     bool isFetchNodes() const;
 
+    // if contains only one command and that command has filters to process its response in chunks
+    bool isStreaming() const;
+
     Command* getCurrentCommand();
 };
 
 
+// Limits the number of commands of the batches being formed from how long previous batches took,
+// from sending them until their responses were processed. A batch of bulk commands thus doesn't
+// keep the interactive ones waiting for much more than TARGET_BATCH_TIME
+class MEGA_API CommandBatchSizer
+{
+public:
+    void completed(size_t commands, std::chrono::milliseconds elapsed);
+    size_t limit() const { return mLimit; }
+
+    static constexpr size_t MAX_COMMANDS = 10000;
+    static constexpr size_t MIN_COMMANDS = 100;
+    static constexpr std::chrono::milliseconds TARGET_BATCH_TIME{2000};
+
+    // batches up to this size only measure the round trip
+    static constexpr size_t SMALL_BATCH = 4;
+
+private:
+    double mRoundTripMs = 200;
+    double mPerCommandMs = 0;
+    size_t mLimit = MAX_COMMANDS;
+};
+
 class MEGA_API RequestDispatcher
 {
     // these ones have been sent to the server, but we haven't received the response yet
     Request inflightreq;
     retryreason_t inflightFailReason = RETRY_NONE;
+    std::chrono::steady_clock::time_point inflightSent;
 
-    // client-server request double-buffering, in batches of up to MAX_COMMANDS
+    // client-server request double-buffering, in batches of up to mBatchSizer.limit() commands.
+    // Bulk commands (Command::mBulk) are only sent when there are no others waiting
     deque<Request> nextreqs;
+    deque<Request> nextBulkReqs;
+    CommandBatchSizer mBatchSizer;
 
     // flags for dealing with resetting everything from a command in progress
     bool processing = false;
     bool clearWhenSafe = false;
 
-    static const int MAX_COMMANDS = 10000;
+    // queue of the secondary cs channel, for independent commands (Command::mIndependent).
+    // Once created, it's kept until its commands are done even if the channel is disabled
+    std::unique_ptr<RequestDispatcher> mSecondaryReqs;
+    bool mSecondaryChannel = false;
+
+    void add(deque<Request>& queue, Command*);
 
     // unique request ID
     char reqid[10];
@@ -126,6 +162,9 @@ public:
     // Amount of data consumed for chunked requests, 0 for non-chunked requests
     size_t chunkedProgress();
 
+    // Whether the response to the in-progress request can be processed in chunks
+    bool inflightStreaming() const;
+
     // If we need to retry (eg due to networking issue, abandoned req, server refusal etc) call this and we will abandon that attempt.
     // The req will be retried via the next serverrequest(), and idempotence takes care of avoiding duplicate actions
     void inflightFailure(retryreason_t reason);
@@ -138,6 +177,14 @@ public:
 
     void clear();
 
+    size_t batchLimit() const { return mBatchSizer.limit(); }
+
+    // Route the independent commands queued from now on to the secondary channel (or not)
+    void setSecondaryChannel(bool enable, PrnGen&);
+
+    // Dispatcher of the secondary channel, nullptr if it was never enabled
+    RequestDispatcher* secondaryChannel() const { return mSecondaryReqs.get(); }
+
 #if defined(MEGA_MEASURE_CODE) || defined(DEBUG)
     Request deferredRequests;
     std::function<bool(Command*)> deferRequests;
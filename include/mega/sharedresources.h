@@ -0,0 +1,127 @@
+/**
+ * @file mega/sharedresources.h
+ * @brief Worker threads and caches shared by the clients of a process
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_SHAREDRESOURCES_H
+#define MEGA_SHAREDRESOURCES_H 1
+
+#include "types.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+namespace mega {
+
+// Worker threads shared by several users, each queueing its jobs in a lane of its own.
+// The workers serve the lanes in turns, one job at a time, so a user with a long queue
+// doesn't hold up the others.
+class MEGA_API SharedWorkerPool
+{
+public:
+    class MEGA_API Lane
+    {
+    public:
+        // at most maxRunning jobs of this lane run at the same time
+        Lane(std::shared_ptr<SharedWorkerPool> pool, unsigned maxRunning);
+
+        // Waits for the running jobs, and for the queued ones unless they were cleared.
+        ~Lane();
+
+        MEGA_DISABLE_COPY_MOVE(Lane)
+
+        // an urgent job goes ahead of the others of this lane
+        void push(std::function<void()> job, bool discardable, bool urgent = false);
+
+        // drops the queued jobs, or only the discardable ones
+        void clear(bool discardableOnly);
+
+        unsigned threadCount() const;
+
+    private:
+        friend class SharedWorkerPool;
+
+        struct Job
+        {
+            std::function<void()> f;
+            bool discardable = false;
+        };
+
+        std::shared_ptr<SharedWorkerPool> mPool;
+
+        // under the pool's mutex
+        std::deque<Job> mJobs;
+        unsigned mRunning = 0;
+        unsigned mMaxRunning;
+    };
+
+    explicit SharedWorkerPool(unsigned threadCount);
+
+    // only once every lane is gone
+    ~SharedWorkerPool();
+
+    MEGA_DISABLE_COPY_MOVE(SharedWorkerPool)
+
+    unsigned threadCount() const { return static_cast<unsigned>(mThreads.size()); }
+
+private:
+    void loop();
+
+    // the next lane in turn with a job it may start, under mMutex
+    Lane* nextLane();
+
+    std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    std::condition_variable mJobDone;
+    std::vector<Lane*> mLanes;
+    size_t mNextLane = 0;
+    bool mExiting = false;
+    std::vector<std::thread> mThreads;
+};
+
+// Opt-in sharing of the worker threads and network caches between all the clients of a
+// process, so a server running many accounts doesn't need threads for each of them.
+// Only clients created after it's enabled use the shared resources; each resource is created
+// by its first user and goes away with the last one.
+class MEGA_API SharedResources
+{
+public:
+    static void setEnabled(bool enabled);
+    static bool enabled();
+
+    // for the clients' MegaClientAsyncQueues: encryption and decryption of transfer data, keys
+    static std::shared_ptr<SharedWorkerPool> cryptoPool();
+
+    // for GfxProc, the thread count taking effect when the pool is created
+    static std::shared_ptr<SharedWorkerPool> gfxPool(unsigned threadCount);
+
+private:
+    static std::shared_ptr<SharedWorkerPool> pool(std::weak_ptr<SharedWorkerPool>& pool, unsigned threadCount);
+
+    static std::atomic<bool> sEnabled;
+    static std::mutex sMutex;
+    static std::weak_ptr<SharedWorkerPool> sCryptoPool;
+    static std::weak_ptr<SharedWorkerPool> sGfxPool;
+};
+
+} // namespace
+
+#endif
@@ -25,6 +25,8 @@
 #include "types.h"
 
 namespace mega {
+struct MegaClientAsyncQueue;
+
 // cr element share/node map key generator
 class MEGA_API ShareNodeKeys
 {
@@ -44,6 +46,12 @@ public:
     // The result is suitable for sending all the collected keys for each share, per Node, to the API.
     void add(const string& nodekey, handle nodehandle, std::shared_ptr<Node>, bool, const byte* = NULL, int = 0);
 
+    // Same as add() for each of the nodes, in order, with their keys encrypted in the worker threads
+    void add(const sharedNode_vector& nodes, std::shared_ptr<Node> sn, bool includeParentChain, MegaClientAsyncQueue& queue);
+
+    // nodes per job of the above: a key is a single AES block, so each job needs plenty of them
+    static constexpr size_t ENCRYPTION_BATCH_SIZE = 1024;
+
     void get(Command*, bool skiphandles = false);
 };
 } // namespace
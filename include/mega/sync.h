@@ -23,6 +23,7 @@
 #define MEGA_SYNC_H 1
 
 #include "db.h"
+#include "treestateindex.h"
 #include "waiter.h"
 
 #include <filesystem>
@@ -193,6 +194,9 @@ public:
     // Only meaningful when a sync is in CDM_PERIODIC_SCANNING mode.
     unsigned mScanIntervalSec = 0;
 
+    // Whether background scans (and their fingerprinting) run at idle I/O priority.
+    bool mBackgroundIO = true;
+
     // enum to string conversion
     static const char* synctypename(const Type type);
     static bool synctypefromname(const string& name, Type& type);
@@ -223,10 +227,50 @@ struct PerSyncStats
     int32_t numUploads = 0;
     int32_t numDownloads = 0;
 
+    // Files scans had to read to fingerprint, and those whose fingerprint was known already
+    int64_t numFingerprintsComputed = 0;
+    int64_t numFingerprintsReused = 0;
+
     bool operator==(const PerSyncStats&);
     bool operator!=(const PerSyncStats&);
 };
 
+class JSONWriter;
+
+// Where a sync's time goes, accumulated since it was loaded (see Syncs::telemetryJson).
+// Updated on the sync thread, and may be read from any other.
+struct SyncTelemetry
+{
+    struct Timing
+    {
+        // Upper bounds of the histogram buckets; the last bucket has anything longer.
+        static constexpr std::array<unsigned, 5> BUCKET_LIMITS_MS{{1, 10, 100, 1000, 10000}};
+
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> totalUs{0};
+        std::atomic<uint64_t> maxUs{0};
+        std::array<std::atomic<uint64_t>, BUCKET_LIMITS_MS.size() + 1> histogram{};
+
+        void add(std::chrono::steady_clock::duration elapsed);
+        void toJson(JSONWriter& writer, const char* name, bool withHistogram) const;
+    };
+
+    // directory scans, on the scan workers
+    Timing scan;
+
+    // pairing up a folder's cloud, LocalNode and filesystem children
+    Timing triplets;
+
+    // deciding (and starting) what to do for one row
+    Timing resolve;
+
+    // from queueing an upload until its putnodes completes
+    Timing upload;
+
+    // from queueing a download until the file is moved into place
+    Timing download;
+};
+
 struct UnifiedSync
 {
     // Reference to containing Syncs object
@@ -241,6 +285,9 @@ struct UnifiedSync
     // High level info about this sync, sent to backup centre
     std::unique_ptr<BackupInfoSync> mBackupInfo;
 
+    // Kept here rather than in Sync, so it's still readable while the Sync is torn down.
+    SyncTelemetry mTelemetry;
+
     // The next detail heartbeat to send to the backup centre
     std::shared_ptr<HeartBeatSyncInfo> mNextHeartbeat;
 
@@ -492,7 +539,10 @@ public:
     void addstatecachechildren(uint32_t, idlocalnode_map*, LocalPath&, LocalNode*, int);
 
     // Caches all synchronized LocalNode
-    void cachenodes();
+    // Unless 'all' is set, stops once STATECACHE_WRITE_BUDGET has been spent, leaving the rest
+    // queued for the next sync loop, so a large initial sync doesn't stall the thread in one write
+    void cachenodes(bool all = true);
+    static const std::chrono::milliseconds STATECACHE_WRITE_BUDGET;
 
     // change state, signal to application
     void changestate(SyncError newSyncError, bool newEnableFlag, bool notifyApp, bool keepSyncDb);
@@ -530,6 +580,15 @@ public:
         vector<FSNode>& fsNodes,
         vector<SyncRow>& inferredRows) const;
 
+    // Rows for just the children of a folder we are only passing through (nothing to do at this
+    // level), that have something to do in their subtree.  Plus the ignore file, if there is one.
+    bool inferFlaggedChildTriplets(
+        NodeHandle cloudParent,
+        const LocalNode& syncParent,
+        vector<CloudNode>& cloudNodes,
+        vector<FSNode>& fsNodes,
+        vector<SyncRow>& inferredRows) const;
+
     struct PerFolderLogSummaryCounts
     {
         // in order to not swamp the logs, but still be able to diagnose.
@@ -591,8 +650,20 @@ public:
     bool checkMovesWereComplete();
     bool movesWereComplete() const;
 
-    void recursiveCollectNameConflicts(SyncRow& row, SyncPath& fullPath, list<NameConflict>* ncs, size_t& count, size_t& limit);
-    void recursiveCollectNameConflicts(list<NameConflict>* conflicts, size_t* count = nullptr, size_t* limit = nullptr);
+    // Estimated memory held by this sync's LocalNode tree, and how many nodes it has
+    size_t localNodeMemoryUsage(size_t& numNodes) const;
+    void logLocalNodeMemoryUsage(const char* when) const;
+
+    // Name conflicts of the sync, in path order, from the index kept by recursiveSync.
+    // Stops once count reaches limit.
+    void collectNameConflicts(list<NameConflict>* conflicts, size_t* count = nullptr, size_t* limit = nullptr) const;
+
+    // Records the conflicts among a folder's rows, replacing those of its previous visit.
+    void indexNameConflicts(const LocalNode& folder, const SyncPath& fullPath, const vector<SyncRow>& childRows);
+
+    // The name conflicts found when each folder's rows were last computed in full.
+    // Entries go when their LocalNode does, so a query costs the conflicts rather than a tree walk.
+    map<const LocalNode*, list<NameConflict>> mNameConflicts;
 
     void purgeStaleDownloads();
     bool makeSyncNode_fromFS(SyncRow& row, SyncRow& parentRow, SyncPath& fullPath, bool considerSynced);
@@ -615,6 +686,7 @@ private:
     bool mScanningWasComplete{};
     bool mScanningWasCompletePreviously{};
     bool mMovesWereComplete{};
+    bool mLocalNodeMemoryLogged{};
 
 public:
     // does the filesystem have stable IDs? (FAT does not)
@@ -644,14 +716,28 @@ public:
      */
     bool openOrCreateDb(DBErrorCallback&& errorHandler);
 
-    // Asynchronous scan request / result.
-    std::shared_ptr<ScanService::ScanRequest> mActiveScanRequestGeneral;
+    // Asynchronous scan requests / results, one per scan worker thread so that
+    // folders in different subtrees are scanned in parallel while we recurse.
+    std::vector<std::shared_ptr<ScanService::ScanRequest>> mActiveScanRequestsGeneral;
+
+    // a slot for a new general scan request, nullptr if all are still in progress
+    std::shared_ptr<ScanService::ScanRequest>* freeGeneralScanSlot();
+
+    // active in the sense of not yet consumed, complete or not
+    bool anyGeneralScanRequest() const;
 
     // we can additionally be scanning one more yet-unscanned folder
     // in order to always be progressing even when downloads are
     // triggering rescans of their target folder
     std::shared_ptr<ScanService::ScanRequest> mActiveScanRequestUnscanned;
 
+    // Fingerprints known for our filesystem, seeded with the synced ones on startup
+    FingerprintCache* mFingerprintCache = nullptr;
+
+    // For PerSyncStats: how well the fingerprint reuse is doing
+    int64_t mFingerprintsComputed = 0;
+    int64_t mFingerprintsReused = 0;
+
     static const int SCANNING_DELAY_DS;
     static const int EXTRA_SCANNING_DELAY_DS;
     static const int FILE_UPDATE_DELAY_DS;
@@ -1328,6 +1414,10 @@ struct Syncs
     // async, callback on client thread
     void renameSync(handle backupId, const string& newname, std::function<void(Error e)> result);
 
+    // async, callback on client thread
+    // Takes effect from the sync's next scan requests.
+    void setSyncBackgroundIO(handle backupId, bool backgroundIO, std::function<void(Error e)> result);
+
     void prepareForLogout(bool keepSyncsConfigFile, std::function<void()> clientCompletion);
 
     void locallogout(bool removecaches, bool keepSyncsConfigFile, bool reopenStoreAfter);
@@ -1434,6 +1524,10 @@ public:
 
     string exportSyncConfigs(const SyncConfigVector configs) const;
     string exportSyncConfigs() const;
+
+    // Machine-readable (JSON) telemetry: per sync timings and stalls, and the depths of the
+    // queues between the client and sync threads. Safe to call from any thread.
+    string telemetryJson(bool withHistograms) const;
     error createMegaignoreFromLegacyExclusions(const LocalPath& targetPath);
 
     void importSyncConfigs(const char* data, std::function<void(error)> completion);
@@ -1619,7 +1713,6 @@ public:
     std::chrono::steady_clock::time_point lastSyncConflictsCount{std::chrono::steady_clock::now()};
     std::chrono::steady_clock::time_point lastSyncStallsCount{std::chrono::steady_clock::now()};
     static const std::chrono::milliseconds MIN_DELAY_BETWEEN_SYNC_STALLS_OR_CONFLICTS_COUNT;
-    static const std::chrono::milliseconds MAX_DELAY_BETWEEN_SYNC_STALLS_OR_CONFLICTS_COUNT;
     static const std::chrono::milliseconds MIN_DELAY_BETWEEN_SYNC_VERBOSE_TIMED; // 5 secs
     static const std::chrono::milliseconds TIME_WINDOW_FOR_SYNC_VERBOSE_TIMED; // 1 sec
 
@@ -1632,6 +1725,9 @@ public:
     // total number of LocalNode objects (only updated by syncs thread)
     std::atomic<int32_t> totalLocalNodes{0};
 
+    // the treestate reported for each path, updated on the sync thread and looked up from any
+    TreestateIndex mTreestateIndex;
+
     // backup rework implies certain restrictions that can be skipped
     // by setting this flag
     bool mBackupRestrictionsEnabled = true;
@@ -1678,6 +1774,7 @@ private:
     void clear_inThread(bool reopenStoreAfter);
     void purgeRunningSyncs_inThread();
     void renameSync_inThread(handle backupId, const string& newname, std::function<void(Error e)> result);
+    void setSyncBackgroundIO_inThread(handle backupId, bool backgroundIO, std::function<void(Error e)> result);
     error backupOpenDrive_inThread(const LocalPath& drivePath);
     error backupCloseDrive_inThread(LocalPath drivePath);
     void getSyncProblems_inThread(SyncProblems& problems);
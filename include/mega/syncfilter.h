@@ -22,6 +22,7 @@
 #define MEGA_SYNC_FILTER_H 1
 
 #include <memory>
+#include <unordered_map>
 
 #include "types.h"
 
@@ -181,9 +182,20 @@ public:
     bool mSyncThisMegaignore = false;
 
 private:
+    // Rebuilds the indexes below from mStringFilters.
+    void index();
+
     // Name and/or path filters.
     StringFilterPtrVector mStringFilters;
 
+    // Filters without wildcards match a single string, so they're looked up by it rather
+    // than tried in turn: [path filter][case insensitive, key uppercased].
+    // Values are indexes into mStringFilters, ascending.
+    std::unordered_map<string, vector<size_t>> mLiteralFilters[2][2];
+
+    // Indexes into mStringFilters of the other filters, ascending.
+    vector<size_t> mPatternFilters;
+
     // File size filter.
     SizeFilterPtr mSizeFilter;
 }; /* FilterChain */
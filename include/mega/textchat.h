@@ -240,7 +240,12 @@ private:
 
     // maps a scheduled meeting id to a scheduled meeting
     // a scheduled meetings allows the user to specify an event that will occur in the future (check ScheduledMeeting class documentation)
-    map<handle/*schedId*/, std::unique_ptr<ScheduledMeeting>> mScheduledMeetings;
+    mutable map<handle/*schedId*/, std::unique_ptr<ScheduledMeeting>> mScheduledMeetings;
+
+    // the records of the scheduled meetings read from the cache: they're unserialized into
+    // mScheduledMeetings the first time they're needed, since all the chats are loaded at startup
+    mutable std::vector<string> mSerializedSchedMeetings;
+    void loadSchedMeetings() const;
 
     // list of scheduled meetings changed
     handle_set mSchedMeetingsChanged;
@@ -252,6 +257,7 @@ private:
     byte flags = 0;     // currently only used for "archive" flag at first bit
     void deleteSchedMeeting(const handle sm)
     {
+        loadSchedMeetings();
         mScheduledMeetings.erase(sm);
         mSchedMeetingsChanged.insert(sm);
     }
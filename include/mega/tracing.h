@@ -0,0 +1,180 @@
+/**
+ * @file mega/tracing.h
+ * @brief Timeline of the SDK's hot paths, in per-thread ring buffers
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_TRACING_H
+#define MEGA_TRACING_H 1
+
+#include "types.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+namespace mega {
+
+// The last events of a thread, written by that thread only. Dumping copies them while the thread
+// keeps going, without taking a lock: what the thread overwrote meanwhile is left out.
+class MEGA_API TraceRing
+{
+public:
+    struct Event
+    {
+        const char* category = nullptr;
+        const char* name = nullptr;
+        uint64_t start = 0;     // ns, steady clock
+        uint64_t duration = 0;  // ns
+    };
+
+    TraceRing(size_t capacity, unsigned id);
+
+    MEGA_DISABLE_COPY_MOVE(TraceRing)
+
+    // only from the thread owning the ring
+    void push(const char* category, const char* name, uint64_t start, uint64_t duration);
+
+    // the events still there, oldest first
+    std::vector<Event> events() const;
+
+    // leaves out of events() what was written until now
+    void clear();
+
+    unsigned id() const { return mId; }
+    size_t capacity() const { return mCapacity; }
+
+    void setThreadName(string name);
+    string threadName() const;
+
+private:
+    struct Slot
+    {
+        std::atomic<const char*> category{nullptr};
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> start{0};
+        std::atomic<uint64_t> duration{0};
+    };
+
+    const size_t mCapacity;
+    const unsigned mId;
+    std::unique_ptr<Slot[]> mSlots;
+
+    // events being written, and written
+    std::atomic<uint64_t> mWriting{0};
+    std::atomic<uint64_t> mWritten{0};
+    std::atomic<uint64_t> mCleared{0};
+
+    mutable std::mutex mNameMutex;
+    string mThreadName;
+};
+
+// Records complete events (a name, when it started and how long it took) into a ring for each
+// thread. Disabled, a TraceScope costs one relaxed load.
+class MEGA_API Tracer
+{
+public:
+    static constexpr size_t DEFAULT_RING_SIZE = 16384;
+
+    // rings of the threads gone, kept for the dump
+    static constexpr size_t MAX_RETIRED_RINGS = 32;
+
+    static Tracer& instance();
+
+    void setEnabled(bool enabled) { mEnabled.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+    // for the threads recording their first event from now on
+    void setRingSize(size_t events);
+
+    static uint64_t now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // name and category have to outlive the dump: string literals
+    void record(const char* category, const char* name, uint64_t start, uint64_t duration);
+
+    // names the calling thread in the dump
+    void setThreadName(string name);
+
+    // The events of every thread in the Chrome trace event format, which chrome://tracing
+    // and the Perfetto UI open.
+    string exportChromeJson() const;
+
+    // forgets the events recorded until now
+    void clear();
+
+private:
+    friend class TraceThreadRing;
+
+    Tracer() = default;
+
+    TraceRing& ring();
+    void retire(const std::shared_ptr<TraceRing>& ring);
+
+    std::atomic<bool> mEnabled{false};
+    std::atomic<size_t> mRingSize{DEFAULT_RING_SIZE};
+
+    mutable std::mutex mMutex;
+    std::vector<std::shared_ptr<TraceRing>> mRings;
+    std::deque<std::shared_ptr<TraceRing>> mRetired;
+    unsigned mNextId = 1;
+};
+
+class MEGA_API TraceScope
+{
+public:
+    TraceScope(const char* category, const char* name)
+    {
+        if (Tracer::instance().enabled())
+        {
+            mCategory = category;
+            mName = name;
+            mStart = Tracer::now();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (mName)
+        {
+            Tracer::instance().record(mCategory, mName, mStart, Tracer::now() - mStart);
+        }
+    }
+
+    MEGA_DISABLE_COPY_MOVE(TraceScope)
+
+private:
+    const char* mCategory = nullptr;
+    const char* mName = nullptr;
+    uint64_t mStart = 0;
+};
+
+#define MEGA_TRACE_CONCAT_(a, b) a##b
+#define MEGA_TRACE_CONCAT(a, b) MEGA_TRACE_CONCAT_(a, b)
+
+// the rest of the enclosing scope, as an event of this category and name (string literals)
+#define MEGA_TRACE_SCOPE(category, name) \
+    ::mega::TraceScope MEGA_TRACE_CONCAT(megaTraceScope, __LINE__)(category, name)
+
+} // namespace
+
+#endif
@@ -128,8 +128,8 @@ struct MEGA_API Transfer : public FileFingerprint
     // file crypto key and shared cipher
     std::array<byte, SymmCipher::KEYLENGTH> transferkey;
 
-    // returns a pointer to MegaClient::tmptransfercipher setting its key to the transfer
-    // tmptransfercipher key will change: to be used right away: this is not a dedicated SymmCipher for this transfer!
+    // returns a pointer to a recycled cipher (MegaClient::getRecycledTemporaryTransferCipher) set to the transfer key
+    // its key may change: to be used right away: this is not a dedicated SymmCipher for this transfer!
     SymmCipher *transfercipher();
 
     chunkmac_map chunkmacs;
@@ -166,6 +166,9 @@ struct MEGA_API Transfer : public FileFingerprint
 
     void removeAndDeleteSelf(transferstate_t finalState);
 
+    // user-initiated if any of the files was requested by the user, otherwise sync or backup
+    bwclass_t bandwidthClass() const;
+
     // previous wrong fingerprint
     FileFingerprint badfp;
 
@@ -190,6 +193,23 @@ struct MEGA_API Transfer : public FileFingerprint
 
     bool skipserialization;
 
+    // the temporary URL was requested again because its storage server was degraded (see TransferSlot::doio())
+    bool mRenewedUrlForDegradedHost = false;
+
+    // chunk progress not written to the transfer cache yet, and when it was last written
+    // (see MegaClient::transfercacheprogress)
+    bool mProgressUncached = false;
+    dstime mProgressCachedDs = 0;
+
+    // how a download claims its disk space when it starts from scratch
+    enum DiskAllocation
+    {
+        DISK_ALLOCATION_GROW = 0,       // the file grows as chunks are written
+        DISK_ALLOCATION_PREALLOCATE,    // all the blocks are reserved up front (FileAccess::fpreallocate)
+        DISK_ALLOCATION_SPARSE,         // full size up front, holes until written (FileAccess::fsparse)
+    };
+    DiskAllocation mDiskAllocation;
+
     Transfer(MegaClient*, direction_t);
     virtual ~Transfer();
 
@@ -979,6 +999,59 @@ private:
     m_off_t calcThroughput(m_off_t numBytes, m_off_t timeCount) const;
 };
 
+// Decrypted streaming data, in aligned blocks, shared by all the DirectReads of a client so
+// readers seeking around the same file (players, the HTTP proxy) don't fetch it again.
+// Least recently used blocks are dropped beyond the size limit. Client thread only.
+class MEGA_API StreamingCache
+{
+public:
+    static constexpr m_off_t BLOCKSIZE = 1024 * 1024;
+
+    // a block being assembled from the data a DirectRead delivers
+    struct Partial
+    {
+        m_off_t pos = -1;
+        string data;
+    };
+
+    // 0 (the default) disables the cache and drops its contents
+    void setLimit(size_t bytes);
+    bool enabled() const { return mLimit > 0; }
+
+    // the block containing pos (starting at pos - pos % BLOCKSIZE), or nullptr
+    const string* find(handle h, int64_t ctriv, m_off_t pos);
+
+    // add data delivered for [pos, pos + len) to the blocks it completes
+    void fill(handle h, int64_t ctriv, m_off_t fileSize, m_off_t pos, const byte* data, size_t len, Partial& partial);
+
+    size_t size() const { return mSize; }
+
+private:
+    typedef std::tuple<handle, int64_t, m_off_t> BlockKey;
+    typedef list<pair<BlockKey, string>> BlockList;
+
+    BlockList mBlocks;   // most recently used first
+    map<BlockKey, BlockList::iterator> mIndex;
+    size_t mSize = 0;
+    size_t mLimit = 0;
+
+    void trim();
+};
+
+// Takes the data of a direct read in place of MegaApp::pread_data and pread_failure,
+// for readers inside the SDK with no app transfer to report to. The read owns it.
+class MEGA_API DirectReadConsumer
+{
+public:
+    virtual ~DirectReadConsumer() = default;
+
+    // false ends the read, as pread_data returning false does
+    virtual bool data(byte* buffer, m_off_t length, m_off_t position) = 0;
+
+    // when to retry, as pread_failure: NEVER gives the read up
+    virtual dstime failure(const Error& error, int retries, dstime timeLeft) = 0;
+};
+
 struct MEGA_API DirectRead
 {
     m_off_t count;
@@ -996,12 +1069,24 @@ struct MEGA_API DirectRead
 
     void* appdata;
 
+    // if set, it receives the data rather than the app (appdata points to it)
+    std::unique_ptr<DirectReadConsumer> consumer;
+
     int reqtag;
 
+    // block in progress for MegaClient::mStreamingCache, and how much of the requested
+    // range came from it (the read starts that much later)
+    StreamingCache::Partial cachePartial;
+    m_off_t servedFromCache = 0;
+
     void abort();
     m_off_t drMaxReqSize() const;
 
-    DirectRead(DirectReadNode*, m_off_t, m_off_t, int, void*);
+    // hand over data, or report a failure, to the consumer or else the app
+    bool deliver(byte* buffer, m_off_t len, m_off_t pos, m_off_t speed, m_off_t meanSpeed);
+    dstime failure(const Error& e, int retries, dstime timeLeft);
+
+    DirectRead(DirectReadNode*, m_off_t, m_off_t, int, void*, std::unique_ptr<DirectReadConsumer> = nullptr);
     ~DirectRead();
 };
 
@@ -1037,7 +1122,7 @@ struct MEGA_API DirectReadNode
     void cmdresult(const Error&, dstime = 0);
 
     // enqueue new read
-    void enqueue(m_off_t, m_off_t, int, void*);
+    DirectRead* enqueue(m_off_t, m_off_t, int, void*, std::unique_ptr<DirectReadConsumer> = nullptr);
 
     // dispatch all reads
     void dispatch();
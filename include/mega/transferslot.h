@@ -56,6 +56,9 @@ struct TransferSlotStats
     double mTotalConnectTime{};
     m_off_t mNumRequestsWithCalculatedLatency{};
 
+    // Size targeted by the last upload request, from the slot's throughput and failures.
+    m_off_t mUploadRequestSize{};
+
     // Ratio between failed requests and total requests.
     double failedRequestRatio() const;
     // Time (ms) taken to establish a connection
@@ -67,6 +70,8 @@ struct TransferSlotStats
     // This value is used for logging information only.
     m_off_t averageStartTransferTime() const;
 };
+
+struct DownloadPipelineStats;
 } // namespace stats
 
 class TransferDbCommitter;
@@ -102,6 +107,16 @@ struct MEGA_API TransferSlot
     // min file size for multiple connections in transfer slot
     static const m_off_t MIN_FILESIZE_FOR_MULTIPLE_CONNECTIONS;
 
+    // min file size to adapt the number of connections to the throughput (see adaptConnections())
+    static const m_off_t MIN_FILESIZE_FOR_ADAPTIVE_CONNECTIONS;
+
+    // time to measure the throughput with a number of connections, longer than the
+    // window of SpeedController::getCircularMeanSpeed() so it only reflects that number
+    static const dstime CONNECTION_PROBE_DS;
+
+    // how often a non-raid download checks the health of its storage server
+    static const dstime HOST_HEALTH_CHECK_DS;
+
     // maximum gap between chunks for uploads
     static const m_off_t MAX_GAP_SIZE;
 
@@ -124,6 +139,9 @@ struct MEGA_API TransferSlot
     int connections;
     vector<std::shared_ptr<HttpReqXfer>> reqs;
 
+    // connections allowed to start new requests, <= connections. Changes only if adapted
+    int mActiveConnections = 0;
+
     // Keep track of transfer network speed per channel, and overall
     vector<SpeedController> mReqSpeeds;
     SpeedController mTransferSpeed;
@@ -198,6 +216,9 @@ struct MEGA_API TransferSlot
     // transfer stats
     stats::TransferSlotStats tsStats;
 
+    // add the memory held by this download to each stage
+    void addDownloadPipelineStats(stats::DownloadPipelineStats& stats) const;
+
     TransferSlot(Transfer*);
     ~TransferSlot();
 
@@ -212,6 +233,19 @@ private:
 
     // returns true if connection haven't received data recently (set incrementErrors) or if slower than other connections (reset incrementErrors)
     bool testForSlowRaidConnection(unsigned connectionNum, bool& incrementErrors);
+
+    // Throughput probing over the number of active connections: doubles it while every step gains
+    // 10%+ (slow start), then keeps the best one and periodically tries one more (or one less, if
+    // the throughput dropped), going back when the probe doesn't pay off
+    bool mAdaptiveConnections = false;
+    bool mConnectionsSlowStart = true;
+    dstime mConnectionsChanged = 0;
+    int mBestConnections = 0;
+    m_off_t mBestConnectionsSpeed = 0;
+    unsigned mConnectionProbesSkipped = 0;
+    void adaptConnections();
+
+    dstime mLastHostHealthCheck = 0;
 };
 
 } // namespace
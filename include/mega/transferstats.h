@@ -26,6 +26,30 @@
 namespace mega::stats
 {
 
+/**
+ * @brief Download data held in memory, per stage of the pipeline.
+ * Computed from the active slots by MegaClient::downloadPipelineStats.
+ */
+struct DownloadPipelineStats
+{
+    struct Stage
+    {
+        unsigned pieces{};
+        m_off_t bytes{};
+    };
+
+    // requests in flight, and raid parts waiting to be combined
+    Stage receive;
+
+    // pieces being decrypted and MACed on the worker threads
+    Stage decrypt;
+
+    // decrypted pieces, queued or being written to disk
+    Stage write;
+
+    m_off_t bytes() const { return receive.bytes + decrypt.bytes + write.bytes; }
+};
+
 /**
  * @brief A class to store and manage transfer statistics.
  * This class collects data for multiple transfers (uploads/downloads) and
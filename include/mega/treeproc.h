@@ -34,6 +34,10 @@ class MEGA_API TreeProc
 public:
     virtual void proc(MegaClient*, std::shared_ptr<Node>) = 0;
 
+    // the whole subtree at once, from MegaClient::proctreeInBatches(): descendants come before
+    // their ancestors, as proc() sees them. Override it to do the work in the worker threads
+    virtual void procBatch(MegaClient*, sharedNode_vector& nodes);
+
     virtual ~TreeProc() { }
 };
 
@@ -50,6 +54,7 @@ class MEGA_API TreeProcApplyKey : public TreeProc
 {
 public:
     void proc(MegaClient*, std::shared_ptr<Node>);
+    void procBatch(MegaClient*, sharedNode_vector& nodes) override;
 };
 
 class MEGA_API TreeProcCopy : public TreeProc
@@ -73,6 +78,7 @@ class MEGA_API TreeProcShareKeys : public TreeProc
 
 public:
     void proc(MegaClient*, std::shared_ptr<Node>);
+    void procBatch(MegaClient*, sharedNode_vector& nodes) override;
     void get(Command*);
 
     TreeProcShareKeys(std::shared_ptr<Node>, bool);
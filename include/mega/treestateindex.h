@@ -0,0 +1,88 @@
+/**
+ * @file mega/treestateindex.h
+ * @brief The sync state of each local path, for the shell's overlay icons
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_TREESTATEINDEX_H
+#define MEGA_TREESTATEINDEX_H 1
+
+#include "filesystem.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace mega {
+
+// The treestate last reported for each path of the syncs, kept up to date by the sync thread and
+// looked up by any number of threads without waiting for it.
+//
+// It's a hash array mapped trie of the paths' hashes, five bits per level, whose nodes never
+// change once published: an update copies the nodes on the way to its leaf and publishes the new
+// root at once. A lookup takes the root there is and walks it, hashing the path and following a
+// few levels down, while the sync thread goes on with its updates.
+class MEGA_API TreestateIndex
+{
+public:
+    TreestateIndex();
+    ~TreestateIndex();
+
+    MEGA_DISABLE_COPY_MOVE(TreestateIndex)
+
+    // any thread: false if the path has no treestate (TREESTATE_NONE)
+    bool lookup(const LocalPath& path, treestate_t& ts, nodetype_t& type) const;
+
+    // the sync thread only: TREESTATE_NONE removes the path
+    void set(const LocalPath& path, treestate_t ts, nodetype_t type);
+    void erase(const LocalPath& path);
+
+    // the path and everything below it, when a sync goes away without reporting each one
+    void eraseBelow(const LocalPath& root);
+
+    void clear();
+
+    size_t size() const { return mSize.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry
+    {
+        LocalPath path;
+        treestate_t ts;
+        nodetype_t type;
+    };
+
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    static uint64_t hashOf(const LocalPath& path);
+
+    static NodePtr inserted(const NodePtr& node, uint64_t hash, unsigned shift, const Entry& entry, bool& added);
+    static NodePtr erased(const NodePtr& node, uint64_t hash, unsigned shift, const LocalPath& path);
+    static void visit(const NodePtr& node, const std::function<void(const Entry&)>& visitor);
+
+    NodePtr root() const { return std::atomic_load_explicit(&mRoot, std::memory_order_acquire); }
+    void publish(NodePtr root) { std::atomic_store_explicit(&mRoot, std::move(root), std::memory_order_release); }
+
+    NodePtr mRoot;
+    std::atomic<size_t> mSize{0};
+};
+
+} // namespace
+
+#endif
@@ -712,6 +712,9 @@ typedef map<int, FileAttributeFetchChannel*> fafc_map;
 typedef enum { GET = 0, PUT, API, NONE } direction_t;
 typedef enum { LARGEFILE = 0, SMALLFILE } filesizetype_t;
 
+// bandwidth class of a transfer, for per-class budgets: user-initiated, sync, backup
+typedef enum { BW_USER = 0, BW_SYNC, BW_BACKUP, BW_CLASSES } bwclass_t;
+
 struct StringCmp
 {
     bool operator()(const string* a, const string* b) const
@@ -990,6 +993,21 @@ private:
 
 };
 
+// SHA-256 of the content of an uploaded file and the node it became (see MegaClient::ContentHashIndex)
+class CachedContentHash : public Cacheable
+{
+public:
+    CachedContentHash(const string& hash, NodeHandle h);
+
+    bool serialize(string* data) const override;
+
+    // returns null in case of failure
+    static unique_ptr<CachedContentHash> unserialize(const string& data);
+
+    string mHash;
+    NodeHandle mHandle;
+};
+
 typedef enum
 {
     INVALID = -1,
@@ -1155,7 +1173,7 @@ public:
         return !!flag && *flag;
     }
 
-    bool exists()
+    bool exists() const
     {
         return !!flag;
     }
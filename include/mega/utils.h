@@ -21,9 +21,11 @@
 
 #ifndef MEGA_UTILS_H
 #define MEGA_UTILS_H 1
+#include "sharedresources.h"
 #include "types.h"
 
 #include <charconv>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <shared_mutex>
@@ -47,6 +49,8 @@ std::pair<bool, TypeOfLink> toTypeOfLink (nodetype_t type);
 #define LOG_HANDLE(x) toHandle(x)
 class SimpleLogger;
 class LocalPath;
+class MetricHistogram;
+class MetricsRegistration;
 SimpleLogger& operator<<(SimpleLogger&, NodeHandle h);
 SimpleLogger& operator<<(SimpleLogger&, UploadHandle h);
 SimpleLogger& operator<<(SimpleLogger&, NodeOrUploadHandle h);
@@ -66,6 +70,9 @@ struct MEGA_API ChunkedHash
 
     static m_off_t chunkfloor(m_off_t);
     static m_off_t chunkceil(m_off_t, m_off_t limit = -1);
+
+    // number of the chunk containing that position
+    static m_off_t chunkindex(m_off_t);
 };
 
 /**
@@ -342,9 +349,17 @@ public:
 
     static int32_t toUpper(const int32_t c)
     {
+        if (c >= 0 && c < 0x80)
+        {
+            return c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c;
+        }
         return utf8proc_toupper(c);
     }
 
+    // whether every byte is below 0x80, checked a word at a time
+    static bool isAscii(const char* data, size_t size);
+    static bool isAscii(const string& text) { return isAscii(text.data(), text.size()); }
+
     static string toUpperUtf8(const string& text);
     static string toLowerUtf8(const string& text);
 
@@ -398,6 +413,9 @@ extern struct tm* m_localtime(m_time_t, struct tm *dt);
 extern struct tm* m_gmtime(m_time_t, struct tm *dt);
 extern m_time_t m_mktime(struct tm*);
 extern dstime m_clock_getmonotonictimeDS();
+
+// the same monotonic clock, in milliseconds
+extern int64_t m_clock_getmonotonictimeMS();
 // Similar behaviour to mktime but it receives a struct tm with a date in UTC and return mktime in UTC
 extern m_time_t m_mktime_UTC(const struct tm *src);
 
@@ -447,7 +465,15 @@ class chunkmac_map
         bool isMacsmacSoFar() { return finished && offset == unsigned(-1); }
     };
 
-    map<m_off_t, ChunkMAC> mMacMap;
+    // kept sorted by position; a flat vector walks millions of chunks without pointer chasing.
+    // Entries are only inserted on the owning thread, so workers may update distinct existing ones.
+    // Chunk boundaries are deterministic, so while there are no gaps an entry's slot is just its
+    // chunk index minus the first one's; lookups only fall back to a binary search around gaps.
+    typedef std::pair<m_off_t, ChunkMAC> MacEntry;
+    vector<MacEntry> mMacs;
+
+    vector<MacEntry>::iterator find(m_off_t pos);
+    ChunkMAC& entry(m_off_t pos);   // inserted if not present yet
 
     // we collapse the leading consecutive entries, for large files.
     // this is the map key for how far that collapsing has progressed
@@ -471,6 +497,7 @@ public:
     void updateMacsmacProgress(SymmCipher *cipher);
     void copyEntriesTo(chunkmac_map& other);
     void copyEntryTo(m_off_t pos, chunkmac_map& other);
+    void addEntry(m_off_t pos);    // not started, if it wasn't there
     void debugLogOuputMacs();
 
     void ctr_encrypt(m_off_t chunkid, SymmCipher *cipher, byte *chunkstart, unsigned chunksize, m_off_t startpos, int64_t ctriv, bool finishesChunk);
@@ -478,16 +505,16 @@ public:
 
     size_t size() const
     {
-        return mMacMap.size();
+        return mMacs.size();
     }
     void clear()
     {
-        mMacMap.clear();
+        mMacs.clear();
         macsmacSoFarPos = -1;
         progresscontiguous = 0;
     }
     void swap(chunkmac_map& other) {
-        mMacMap.swap(other.mMacMap);
+        mMacs.swap(other.mMacs);
         std::swap(macsmacSoFarPos, other.macsmacSoFarPos);
         std::swap(progresscontiguous, other.progresscontiguous);
     }
@@ -574,6 +601,9 @@ std::pair<bool, int64_t> generateMetaMac(SymmCipher &cipher, FileAccess &ifAcces
 
 std::pair<bool, int64_t> generateMetaMac(SymmCipher &cipher, InputStreamAccess &isAccess, const int64_t iv);
 
+// SHA-256 of the whole content, false if it couldn't be read
+bool generateContentHash(InputStreamAccess& isAccess, string& hash);
+
 bool CompareLocalFileMetaMacWithNodeKey(FileAccess* fa, const std::string& nodeKey, int type);
 
 bool CompareLocalFileMetaMacWithNode(FileAccess* fa, Node* node);
@@ -582,14 +612,30 @@ bool CompareLocalFileMetaMacWithNode(FileAccess* fa, Node* node);
 // Maintains a small thread pool for executing independent operations such as encrypt/decrypt a block of data
 // The number of threads can be 0 (eg. for helper MegaApi that deals with public folder links) in which case something queued is
 // immediately executed synchronously on the caller's thread
+// With SharedResources enabled, the operations run on the threads of the shared crypto pool instead,
+// taking turns with the other clients.
+// URGENT jobs are started before any NORMAL one, so work the client thread is blocked on
+// doesn't wait behind a long run of background decryption.
 struct MegaClientAsyncQueue
 {
-    void push(std::function<void(SymmCipher&)> f, bool discardable);
+    enum Priority { NORMAL, URGENT, NUM_PRIORITIES };
+
+    void push(std::function<void(SymmCipher&)> f, bool discardable, Priority priority = NORMAL);
     void clearDiscardable();
 
+    // Split [0, count) in batches of 'batchSize' that are processed by f() in the worker threads
+    // (each one with its own SymmCipher), as URGENT jobs. Blocks until all of them are done.
+    // Returns the number of batches
+    size_t runInBatches(size_t count, size_t batchSize, std::function<void(size_t, size_t, SymmCipher&)> f);
+
     MegaClientAsyncQueue(Waiter& w, unsigned threadCount);
     ~MegaClientAsyncQueue();
 
+    unsigned threadCount() const { return mSharedLane ? mSharedLane->threadCount() : static_cast<unsigned>(mThreads.size()); }
+
+    // From now on, export the time the jobs wait for a thread, per priority, with these labels
+    void exportQueueLatency(const string& labels);
+
 private:
     Waiter& mWaiter;
     std::mutex mMutex;
@@ -599,14 +645,22 @@ private:
     {
         bool discardable = false;
         std::function<void(SymmCipher&)> f;
+        std::chrono::steady_clock::time_point queued;
         Entry(bool disc, std::function<void(SymmCipher&)>&& func)
-             : discardable(disc), f(func)
+             : discardable(disc), f(func), queued(std::chrono::steady_clock::now())
         {}
     };
 
-    std::deque<Entry> mQueue;
+    std::deque<Entry> mQueues[NUM_PRIORITIES];
     std::vector<std::thread> mThreads;
     SymmCipher mZeroThreadsCipher;
+    std::unique_ptr<SharedWorkerPool::Lane> mSharedLane;
+
+    // under mMutex; the registration is destroyed first, so no export reads a dead histogram
+    std::unique_ptr<MetricHistogram> mQueueLatency[NUM_PRIORITIES];
+    std::unique_ptr<MetricsRegistration> mQueueLatencyRegistration;
+
+    void recordQueueLatency(Priority priority, std::chrono::steady_clock::time_point queued);
 
     void asyncThreadLoop();
 };
@@ -1149,6 +1203,21 @@ bool likeCompare(const char* pattern,
                  const UChar32 esc = static_cast<UChar32>(ESCAPE_CHARACTER),
                  const bool stripAccents = true);
 
+/*
+ * Folds the case (and the accents, if 'stripAccents') of 'text' code point by code point, as
+ * likeCompare() does. If likeCompare() matches a pattern, its folded literal sequences are
+ * substrings of the folded text.
+ *
+ * @return false if 'text' isn't valid UTF-8
+ */
+bool foldCaseAccent(const std::string& text, std::string& folded, const bool stripAccents = true);
+
+/*
+ * Literal sequences of a "LIKE" expression: the pieces between wildcards, without escaped
+ * characters (which likeCompare() doesn't fold) nor invalid UTF-8.
+ */
+std::vector<std::string> getPatternLiterals(const std::string& pattern);
+
 // Get the current process ID
 unsigned long getCurrentPid();
 
@@ -1297,6 +1366,21 @@ SplitResult split(const std::string& value, char delimiter);
  */
 int naturalsorting_compare(const char* i, const char* j);
 
+/**
+ * @brief Builds a key whose byte order (as memcmp) is the order of naturalsorting_compare()
+ *
+ * It allows storing the natural order of names, so they can be sorted without a custom collation.
+ * Every symbol or alphabetic character takes three ASCII bytes: its CharType and its lowercase
+ * value in hexadecimal. Every run of digits takes its CharType, its length without leading zeros
+ * in four decimal digits, and those digits. Runs of more than 9999 significant digits are kept
+ * as the first 9999 of them.
+ *
+ * @param name Name to build the key for
+ *
+ * @returns the key for 'name', an ASCII string
+ */
+std::string naturalsorting_key(const std::string& name);
+
 /**
  * @class NaturalSortingComparator
  * @brief A helper struct to be used in container templates such as std::set to force natural
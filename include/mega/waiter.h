@@ -23,6 +23,7 @@
 #define MEGA_WAITER_H 1
 
 #include <atomic>
+#include <limits>
 
 #include "types.h"
 
@@ -58,9 +59,19 @@ struct MEGA_API Waiter
     // wait ceiling
     std::atomic<dstime> maxds;
 
-    // begin waiting cycle with timeout
+    // finer wait ceiling: absolute time on the m_clock_getmonotonictimeMS() clock, NEVERMS if unset
+    static constexpr int64_t NEVERMS = std::numeric_limits<int64_t>::max();
+    std::atomic<int64_t> maxms{NEVERMS};
+
+    // begin waiting cycle with timeout (clears maxms)
     virtual void init(dstime);
 
+    // wake up no later than the given millisecond, for deadlines that don't fall on a decisecond
+    void wakeupatms(int64_t ms);
+
+    // the time to wait for in milliseconds, honouring both ceilings, or -1 to wait for ever
+    int64_t timeoutms() const;
+
     // add wakeup events
     void wakeupby(EventTrigger*, int);
 
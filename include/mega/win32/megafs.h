@@ -70,6 +70,7 @@ public:
 
     bool renamelocal(const LocalPath&, const LocalPath&, bool) override;
     bool copylocal(const LocalPath&, const LocalPath&, m_time_t) override;
+    bool hardlinklocal(const LocalPath&, const LocalPath&) override;
     bool unlinklocal(const LocalPath&) override;
     bool rmdirlocal(const LocalPath&) override;
     bool mkdirlocal(const LocalPath&, bool hidden, bool logAlreadyExistsError) override;
@@ -91,7 +92,8 @@ public:
     static void emptydirlocal(const LocalPath&, dev_t = 0);
 
     ScanResult directoryScan(const LocalPath& path, handle expectedFsid,
-        map<LocalPath, FSNode>& known, std::vector<FSNode>& results, bool followSymlinks, unsigned& nFingerprinted) override;
+        map<LocalPath, FSNode>& known, std::vector<FSNode>& results, bool followSymlinks, unsigned& nFingerprinted,
+        FingerprintCache* fingerprints) override;
 
     WinFileSystemAccess();
     ~WinFileSystemAccess();
@@ -101,6 +103,10 @@ public:
 #ifdef ENABLE_SYNC
     bool fsStableIDs(const LocalPath& path) const override;
 
+    bool fsSolidState(const LocalPath& path, bool& solidState) const override;
+
+    bool setBackgroundIO(bool background) override;
+
     std::set<WinDirNotify*> dirnotifys;
 #endif
 
@@ -129,13 +135,33 @@ private:
     Waiter* clientWaiter;
 
     string notifybuf;
+    string processbuf;
+    DWORD notifybufsize;
     DWORD dwBytes;
     OVERLAPPED overlapped;
 
+    // The volume's change journal, to replay what an overflowed notification buffer lost.
+    // Opening it takes privileges we may not have, then overflows rescan the whole sync.
+    HANDLE hVolume;
+    DWORDLONG mJournalId;
+
+    // journal position when the pending read was issued: anything it missed comes later
+    LONGLONG mReadFromUsn;
+
+    // the root as GetFinalPathNameByHandleW reports it, to recognise records below it
+    std::wstring mRootFinalPath;
+
     static VOID CALLBACK completion(DWORD dwErrorCode, DWORD dwBytes, LPOVERLAPPED lpOverlapped);
     void process(DWORD wNumberOfBytesTransfered);
     void readchanges();
 
+    void openJournal(const std::wstring& longname);
+    bool journalPosition(LONGLONG& nextUsn);
+    bool replayJournal(LONGLONG fromUsn, LONGLONG toUsn);
+
+    // recovery from a lost notification buffer, a full rescan unless the journal covers it
+    void overflowed(LONGLONG fromUsn);
+
     static std::atomic<unsigned> smNotifierCount;
     static std::mutex smNotifyMutex;
     static HANDLE smEventHandle;
@@ -183,6 +209,8 @@ public:
     bool fstat(m_time_t& modified, m_off_t& size) override;
 
     bool ftruncate(m_off_t size) override;
+    bool fpreallocate(m_off_t size) override;
+    bool fsparse(m_off_t size) override;
 
     bool sysread(byte *, unsigned, m_off_t) override;
     bool sysstat(m_time_t*, m_off_t*, FSLogging) override;
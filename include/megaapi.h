@@ -96,6 +96,7 @@ class MegaSyncStall;
 class MegaSyncStallList;
 class MegaSyncStallMap;
 class MegaFuseExecutorFlags;
+class MegaFuseFileCacheFlags;
 class MegaFuseFlags;
 class MegaFuseInodeCacheFlags;
 class MegaMount;
@@ -107,6 +108,7 @@ class MegaNodeTree;
 class MegaCompleteUploadData;
 class MegaNotificationList;
 class MegaCancelSubscriptionReasonList;
+class MegaNodeChangeList;
 
 #if defined(SWIG)
     #define MEGA_DEPRECATED
@@ -3885,6 +3887,191 @@ class MegaNodeList
          * @param node MegaNode to be added. The node inserted is a copy from 'node'
          */
         virtual void addNode(MegaNode* node);
+
+        /**
+         * @brief Copies the handles of the nodes in the list to an array
+         *
+         * This function (and the similar ones below) allows bindings to read a whole list in
+         * one call, without crossing the language boundary nor creating a wrapper per node.
+         * Position i of the array gets the value of the MegaNode at the position i in the list.
+         *
+         * @param handles Array to fill. It must have room for 'count' elements
+         * @param count Maximum number of values to copy
+         * @return Number of values copied: the minimum between 'count' and the size of the list
+         */
+        virtual int getHandles(MegaHandle* handles, int count) const;
+
+        /**
+         * @brief Copies the sizes of the nodes in the list to an array
+         *
+         * @see MegaNodeList::getHandles, MegaNode::getSize
+         *
+         * @param sizes Array to fill. It must have room for 'count' elements
+         * @param count Maximum number of values to copy
+         * @return Number of values copied: the minimum between 'count' and the size of the list
+         */
+        virtual int getSizes(int64_t* sizes, int count) const;
+
+        /**
+         * @brief Copies the creation times of the nodes in the list to an array
+         *
+         * @see MegaNodeList::getHandles, MegaNode::getCreationTime
+         *
+         * @param times Array to fill. It must have room for 'count' elements
+         * @param count Maximum number of values to copy
+         * @return Number of values copied: the minimum between 'count' and the size of the list
+         */
+        virtual int getCreationTimes(int64_t* times, int count) const;
+
+        /**
+         * @brief Copies the modification times of the nodes in the list to an array
+         *
+         * @see MegaNodeList::getHandles, MegaNode::getModificationTime
+         *
+         * @param times Array to fill. It must have room for 'count' elements
+         * @param count Maximum number of values to copy
+         * @return Number of values copied: the minimum between 'count' and the size of the list
+         */
+        virtual int getModificationTimes(int64_t* times, int count) const;
+
+        /**
+         * @brief Copies the types of the nodes in the list to an array
+         *
+         * @see MegaNodeList::getHandles, MegaNode::getType
+         *
+         * @param types Array to fill. It must have room for 'count' elements
+         * @param count Maximum number of values to copy
+         * @return Number of values copied: the minimum between 'count' and the size of the list
+         */
+        virtual int getTypes(int* types, int count) const;
+
+        /**
+         * @brief Returns the bytes required by MegaNodeList::getNames for all the nodes in the list
+         * @return Sum of the lengths (in bytes, UTF-8) of the names of the nodes
+         */
+        virtual size_t getNamesSize() const;
+
+        /**
+         * @brief Copies the names of the nodes in the list to a single buffer
+         *
+         * The names (UTF-8, as MegaNode::getName returns them) are written one after the other,
+         * without separators nor null terminators. Position i of 'ends' gets the offset right
+         * after the name of the MegaNode at the position i in the list, so that name takes the
+         * bytes from ends[i - 1] (or 0, for the first one) to ends[i].
+         *
+         * Names are copied until 'count' names have been copied or the next one doesn't fit in
+         * the buffer. Use MegaNodeList::getNamesSize to get the size of the buffer for all of them.
+         *
+         * @param buffer Buffer to fill
+         * @param size Size of the buffer, in bytes
+         * @param ends Array to fill with the end of each name. It must have room for 'count' elements
+         * @param count Maximum number of names to copy
+         * @return Number of names copied
+         */
+        virtual int getNames(char* buffer, size_t size, int* ends, int count) const;
+};
+
+/**
+ * @brief List of entries of the journal of node changes
+ *
+ * Each entry records that a node changed: its handle, the changes (as MegaNode::getChanges
+ * returns them) and the sequence number of the entry in the journal.
+ *
+ * Objects of this class are immutable.
+ *
+ * @see MegaApi::getNodeChanges
+ */
+class MegaNodeChangeList
+{
+protected:
+    MegaNodeChangeList();
+
+public:
+    virtual ~MegaNodeChangeList();
+
+    /**
+     * @brief Creates a copy of this MegaNodeChangeList object
+     *
+     * You are the owner of the returned object
+     *
+     * @return Copy of the MegaNodeChangeList object
+     */
+    virtual MegaNodeChangeList* copy() const;
+
+    /**
+     * @brief Returns the number of entries in the list
+     * @return Number of entries in the list
+     */
+    virtual int size() const;
+
+    /**
+     * @brief Returns the sequence number of the entry at the position i in the list
+     *
+     * Sequence numbers increase along the journal. Use the one of the last entry read as
+     * the first parameter of the next call to MegaApi::getNodeChanges.
+     *
+     * If the index is >= the size of the list, this function returns 0.
+     *
+     * @param i Position of the entry in the list
+     * @return Sequence number of the entry
+     */
+    virtual long long getSequenceNumber(int i) const;
+
+    /**
+     * @brief Returns the handle of the node that changed, for the entry at the position i in the list
+     *
+     * If the index is >= the size of the list, this function returns INVALID_HANDLE.
+     *
+     * @param i Position of the entry in the list
+     * @return Handle of the node
+     */
+    virtual MegaHandle getNodeHandle(int i) const;
+
+    /**
+     * @brief Returns the changes of the entry at the position i in the list
+     *
+     * The value is a bit field with the same values as MegaNode::getChanges.
+     *
+     * If the index is >= the size of the list, this function returns 0.
+     *
+     * @param i Position of the entry in the list
+     * @return Changes of the node
+     */
+    virtual uint64_t getChanges(int i) const;
+
+    /**
+     * @brief Returns the sequence number of the server state when the change was applied
+     *
+     * The value is the binary form of the SCSN of the account, for the entry at the
+     * position i in the list.
+     *
+     * If the index is >= the size of the list, this function returns INVALID_HANDLE.
+     *
+     * @param i Position of the entry in the list
+     * @return SCSN of the change
+     */
+    virtual MegaHandle getSCSN(int i) const;
+
+    /**
+     * @brief Returns the last sequence number of the journal
+     *
+     * It may be greater than the one of the last entry of the list, if it was limited.
+     *
+     * @return Last sequence number assigned in the journal, or 0 if none was
+     */
+    virtual long long getLastSequenceNumber() const;
+
+    /**
+     * @brief Returns whether some changes after the requested sequence number are not available
+     *
+     * It happens when the consumer fell behind the entries kept by the journal, when the
+     * local cache of nodes was reloaded, or when the journal was disabled and enabled again.
+     * The consumer has to walk the whole tree of nodes again, and then continue from
+     * MegaNodeChangeList::getLastSequenceNumber.
+     *
+     * @return True if some changes were missed
+     */
+    virtual bool hasMissedChanges() const;
 };
 
 /**
@@ -4026,6 +4213,65 @@ class MegaTransferList
          * @return Number of MegaTransfer objects in the list
          */
         virtual int size();
+
+        /**
+         * @brief Copies the tags of the transfers in the list to an array
+         *
+         * This function (and the similar ones below) allows bindings to read a whole list in
+         * one call, without crossing the language boundary nor creating a wrapper per transfer.
+         * Position i of the array gets the value of the MegaTransfer at the position i in the list.
+         *
+         * @see MegaTransfer::getTag
+         *
+         * @param tags Array to fill. It must have room for 'count' elements
+         * @param count Maximum number of values to copy
+         * @return Number of values copied: the minimum between 'count' and the size of the list
+         */
+        virtual int getTags(int* tags, int count);
+
+        /**
+         * @brief Copies the states of the transfers in the list to an array
+         *
+         * @see MegaTransferList::getTags, MegaTransfer::getState
+         *
+         * @param states Array to fill. It must have room for 'count' elements
+         * @param count Maximum number of values to copy
+         * @return Number of values copied: the minimum between 'count' and the size of the list
+         */
+        virtual int getStates(int* states, int count);
+
+        /**
+         * @brief Copies the transferred bytes of the transfers in the list to an array
+         *
+         * @see MegaTransferList::getTags, MegaTransfer::getTransferredBytes
+         *
+         * @param bytes Array to fill. It must have room for 'count' elements
+         * @param count Maximum number of values to copy
+         * @return Number of values copied: the minimum between 'count' and the size of the list
+         */
+        virtual int getTransferredBytes(int64_t* bytes, int count);
+
+        /**
+         * @brief Copies the total bytes of the transfers in the list to an array
+         *
+         * @see MegaTransferList::getTags, MegaTransfer::getTotalBytes
+         *
+         * @param bytes Array to fill. It must have room for 'count' elements
+         * @param count Maximum number of values to copy
+         * @return Number of values copied: the minimum between 'count' and the size of the list
+         */
+        virtual int getTotalBytes(int64_t* bytes, int count);
+
+        /**
+         * @brief Copies the node handles of the transfers in the list to an array
+         *
+         * @see MegaTransferList::getTags, MegaTransfer::getNodeHandle
+         *
+         * @param handles Array to fill. It must have room for 'count' elements
+         * @param count Maximum number of values to copy
+         * @return Number of values copied: the minimum between 'count' and the size of the list
+         */
+        virtual int getNodeHandles(MegaHandle* handles, int count);
 };
 
 /**
@@ -7213,6 +7459,17 @@ public:
     */
     virtual int getDownloadCount() const = 0;
 
+  /** @brief Indicates how many files the sync's scans have read in order to fingerprint them
+    */
+    virtual long long getFingerprintComputedCount() const = 0;
+
+  /** @brief Indicates how many files the sync's scans found unchanged, so their fingerprint was reused
+    *
+    * Together with getFingerprintComputedCount, the hit ratio of the fingerprint reuse.
+    * Files moved between folders are reused as long as their size and modification time are the same.
+    */
+    virtual long long getFingerprintReusedCount() const = 0;
+
   /** @brief Make a copy of this object
     * You take ownership of the result.
     */
@@ -10637,6 +10894,30 @@ class MegaApi
 #endif
         virtual ~MegaApi();
 
+        /**
+         * @brief Share worker threads and network caches between the MegaApi instances of the process
+         *
+         * Meant for processes that run many accounts at once, one MegaApi per account. Once enabled,
+         * the MegaApi objects created afterwards don't start worker threads of their own:
+         * - Encryption and decryption run on a single pool, with one thread per core. The pool
+         * serves the instances in turns, so one with many pending operations doesn't hold up the others.
+         * - Thumbnails and previews are generated by a single pool of up to four threads, one job
+         * per instance at a time.
+         * - The cURL DNS cache and TLS sessions are shared, so a connection opened by one instance
+         * resumes the TLS session of another one instead of doing a full handshake.
+         *
+         * Each instance still has its own SDK thread and its own network connections.
+         * Instances created with zero worker threads keep running their operations synchronously.
+         *
+         * The instances created before calling this function keep their own resources.
+         * The shared resources are released with the last instance using them.
+         *
+         * It is disabled by default.
+         *
+         * @param enable True to share the resources with MegaApi objects created from now on
+         */
+        static void setSharedResources(bool enable);
+
 
         /**
          * @brief Register a listener to receive all events (requests, transfers, global, synchronization)
@@ -12632,6 +12913,71 @@ class MegaApi
          */
         static void setLogJSONContent(bool enable);
 
+        /**
+         * @brief Deliver log messages from a thread of their own
+         *
+         * When enabled, the threads logging copy their messages into buffers of their own,
+         * without waiting for any lock, and a background thread passes them on to the loggers
+         * added by MegaApi::addLoggerObject, in the order each thread logged them. This keeps
+         * debug logging from slowing down transfers and syncs.
+         *
+         * Messages logged faster than the loggers take them are dropped once a thread has
+         * 256 KB of them waiting, and a warning with the number dropped is logged. Fatal
+         * messages are waited for.
+         *
+         * Disabling it waits for the messages queued until then. By default, logging is
+         * synchronous.
+         *
+         * @param enable True to log asynchronously, false to call the loggers from the
+         * threads logging.
+         */
+        static void setLogAsync(bool enable);
+
+        /**
+         * @brief Get the SDK's metrics
+         *
+         * The counters, gauges and histograms registered by the SDK's modules, for every
+         * MegaApi instance in the process, in the Prometheus text format (version 0.0.4).
+         * The samples of each instance are told apart by a client label.
+         *
+         * Counters only go up for the lifetime of the instance. Histograms have their buckets
+         * at each power of two of their unit, which is part of their name.
+         *
+         * You take the ownership of the returned value
+         *
+         * @return The metrics, as text
+         */
+        static char* getMetrics();
+
+        /**
+         * @brief Record a timeline of what the SDK's threads do
+         *
+         * When enabled, each thread records when its main steps started and how long they
+         * took: the iterations of the client's event loop, the sync thread's passes, the
+         * transfers' I/O, the database queries and the FUSE operations. Every thread keeps
+         * its last 16384 events, overwriting the oldest, so a freeze can be looked into after
+         * it happened by calling MegaApi::getTrace.
+         *
+         * Recording takes a few tens of nanoseconds per event, and nothing at all while
+         * disabled. By default, it is disabled.
+         *
+         * @param enable True to record the timeline, false to stop recording it. The events
+         * already recorded are kept.
+         */
+        static void setTracing(bool enable);
+
+        /**
+         * @brief Get the timeline recorded since MegaApi::setTracing enabled it
+         *
+         * The events are in the Chrome trace event format (JSON), which chrome://tracing and
+         * the Perfetto UI (ui.perfetto.dev) open. Each SDK thread shows as a track of its own.
+         *
+         * You take the ownership of the returned value
+         *
+         * @return The timeline, as JSON
+         */
+        static char* getTrace();
+
         /**
          * @brief Add a MegaLogger implementation to receive SDK logs
          *
@@ -12810,6 +13156,11 @@ class MegaApi
          * fileSource documentation).
          * - MegaRequest::getParentHandle - Handle of the parent provided as an argument.
          *
+         * Big imports create the Password Nodes in several steps. After each one of them but the
+         * last, onRequestUpdate is called with:
+         * - MegaRequest::getTransferredBytes - Number of Password Nodes created so far.
+         * - MegaRequest::getTotalBytes - Number of Password Nodes to create.
+         *
          * Valid data in the MegaRequest object received in onRequestFinish when the error code
          * is MegaError::API_OK:
          * - MegaRequest::getMegaHandleList - A list with all the handles for all the new imported
@@ -13369,6 +13720,25 @@ class MegaApi
          */
         void getThumbnail(MegaNode* node, const char *dstFilePath, MegaRequestListener *listener = NULL);
 
+        /**
+         * @brief Get the thumbnails of a list of nodes
+         *
+         * It starts one MegaApi::getThumbnail request per node, and all of them together: the
+         * thumbnails stored in the same server are then downloaded in a single round trip, so it is
+         * preferred to consecutive calls to MegaApi::getThumbnail when several are needed at once
+         * (i.e. to fill a grid of images). Thumbnails already available in the folder set by
+         * MegaApi::setFileAttributeCacheFolder, and repeated nodes, are not downloaded again.
+         *
+         * The listener receives one onRequestFinish per node, with the same data and errors
+         * documented for MegaApi::getThumbnail.
+         *
+         * @param nodes Nodes to get the thumbnail
+         * @param dstFolderPath Destination folder, ending with a '\' or '/' character. The
+         * thumbnails are named Base64-encoded handle + "0.jpg" inside it.
+         * @param listener MegaRequestListener to track these requests
+         */
+        void getThumbnails(MegaNodeList* nodes, const char* dstFolderPath, MegaRequestListener* listener = nullptr);
+
         /**
          * @brief Get the preview of a node
          *
@@ -13394,6 +13764,19 @@ class MegaApi
          */
         void getPreview(MegaNode* node, const char *dstFilePath, MegaRequestListener *listener = NULL);
 
+        /**
+         * @brief Get the previews of a list of nodes
+         *
+         * Same as MegaApi::getThumbnails, for previews: one MegaApi::getPreview request is started
+         * per node, all of them together.
+         *
+         * @param nodes Nodes to get the preview
+         * @param dstFolderPath Destination folder, ending with a '\' or '/' character. The
+         * previews are named Base64-encoded handle + "1.jpg" inside it.
+         * @param listener MegaRequestListener to track these requests
+         */
+        void getPreviews(MegaNodeList* nodes, const char* dstFolderPath, MegaRequestListener* listener = nullptr);
+
         /**
          * @brief Get the avatar of a MegaUser
          *
@@ -14525,6 +14908,24 @@ class MegaApi
          */
         void exportNode(MegaNode *node, int64_t expireTime, bool writable, bool megaHosted, MegaRequestListener *listener = NULL);
 
+        /**
+         * @brief Generate the public links of a list of files/folders in MEGA
+         *
+         * It starts one MegaApi::exportNode request per node, and all of them together: their
+         * commands are then sent to the servers in the same batches, so it is preferred to
+         * consecutive calls to MegaApi::exportNode when publishing many links at once.
+         *
+         * The listener receives one onRequestFinish per node, with the same data and errors
+         * documented for MegaApi::exportNode.
+         *
+         * @param nodes Nodes to get the public link
+         * @param expireTime Unix timestamp until the public links will be valid (0 for no expiration)
+         * @param writable if the links should be writable.
+         * @param megaHosted if the share keys should be shared with MEGA
+         * @param listener MegaRequestListener to track these requests
+         */
+        void exportNodes(MegaNodeList* nodes, int64_t expireTime, bool writable, bool megaHosted, MegaRequestListener* listener = nullptr);
+
         /**
          * @brief Stop sharing a file/folder
          *
@@ -16094,6 +16495,42 @@ class MegaApi
          */
         void startDownload(MegaNode* node, const char* localPath, const char *customName, const char *appData, bool startFirst, MegaCancelToken *cancelToken, int collisionCheck, int collisionResolution, bool undelete, MegaTransferListener *listener = NULL);
 
+        /**
+         * @brief Upload several files or folders to the same folder in MEGA
+         *
+         * It is equivalent to calling MegaApi::startUpload for every path, without custom names,
+         * modification times or app data, but all the transfers are queued at once. Use it rather
+         * than a loop of single uploads when starting many of them.
+         *
+         * @param localPaths Local paths of the files or folders
+         * @param parent Parent node for the files or folders in the MEGA account
+         * @param startFirst puts the transfers on top of the upload queue
+         *  + If you don't need this param provide false as value
+         * @param cancelToken MegaCancelToken to be able to cancel the uploads, shared by all of them.
+         * App retains the ownership of this param.
+         * @param listener MegaTransferListener to track the transfers
+         */
+        void startUploads(MegaStringList* localPaths, MegaNode* parent, bool startFirst, MegaCancelToken* cancelToken, MegaTransferListener* listener = NULL);
+
+        /**
+         * @brief Download several files or folders from MEGA into the same local folder
+         *
+         * It is equivalent to calling MegaApi::startDownload for every node, saving each one inside
+         * localFolder under its name in MEGA, but all the transfers are queued at once. Use it rather
+         * than a loop of single downloads when starting many of them.
+         *
+         * @param nodes MegaNodes that identify the files or folders
+         * @param localFolder Destination folder, with or without a trailing '\' or '/' character
+         * @param startFirst puts the transfers on top of the download queue
+         *  + If you don't need this param provide false as value
+         * @param cancelToken MegaCancelToken to be able to cancel the downloads, shared by all of them.
+         * App retains the ownership of this param.
+         * @param collisionCheck Indicates the collision check on same files, see MegaApi::startDownload
+         * @param collisionResolution Indicates how to save same files, see MegaApi::startDownload
+         * @param listener MegaTransferListener to track the transfers
+         */
+        void startDownloads(MegaNodeList* nodes, const char* localFolder, bool startFirst, MegaCancelToken* cancelToken, int collisionCheck, int collisionResolution, MegaTransferListener* listener = NULL);
+
         /**
          * @brief Start an streaming download for a file in MEGA
          *
@@ -17362,6 +17799,24 @@ class MegaApi
          */
         long long getNumLocalNodes();
 
+        /**
+         * @brief Get the sync engine's timing counters, as a JSON document
+         *
+         * The document holds the length of the sync and client thread queues, the number
+         * of stalls last reported and, for every configured sync, its stall count and the
+         * cumulative time spent scanning folders, computing triplets, resolving rows and
+         * waiting for uploads and downloads to complete (count, totalUs and maxUs).
+         *
+         * The counters accumulate since the SDK started, so apps can sample them
+         * periodically and compare the differences.
+         *
+         * You take the ownership of the returned value. Use delete [] to free it.
+         *
+         * @param includeHistograms True to add a histogram of the durations to every counter
+         * @return JSON document with the counters
+         */
+        const char* getSyncTelemetry(bool includeHistograms);
+
         /**
          * @brief Query the sync engine to find out what is causing sync stalls
          *
@@ -17741,80 +18196,615 @@ class MegaApi
         void setLRUCacheSize(unsigned long long size);
 
         /**
-         * @brief Returns number of nodes stored at cache LRU
+         * @brief Set the maximum number of bytes used by the nodes at cache LRU
          *
-         * @return Number of nodes at cache LRU
+         * Every node is charged by its estimated memory usage. This limit applies on top of
+         * the one set by MegaApi::setLRUCacheSize: nodes are unloaded when any of them is exceeded.
+         *
+         * By default it's defined at unsigned long long max value
+         *
+         * @param bytes Maximum number of bytes for the nodes at cache LRU
          */
-        unsigned long long getNumNodesAtCacheLRU() const;
-
-        enum { ORDER_NONE = 0, ORDER_DEFAULT_ASC, ORDER_DEFAULT_DESC,
-            ORDER_SIZE_ASC, ORDER_SIZE_DESC,
-            ORDER_CREATION_ASC, ORDER_CREATION_DESC,
-            ORDER_MODIFICATION_ASC, ORDER_MODIFICATION_DESC,
-            /*deprecated*/ ORDER_ALPHABETICAL_ASC, /*deprecated*/ ORDER_ALPHABETICAL_DESC,
-            /*deprecated*/ ORDER_PHOTO_ASC, /*deprecated*/ ORDER_PHOTO_DESC,
-            /*deprecated*/ ORDER_VIDEO_ASC, /*deprecated*/ ORDER_VIDEO_DESC,
-            ORDER_LINK_CREATION_ASC, ORDER_LINK_CREATION_DESC,
-            ORDER_LABEL_ASC, ORDER_LABEL_DESC, ORDER_FAV_ASC, ORDER_FAV_DESC,};
-
-
-        enum { FILE_TYPE_DEFAULT = 0, // FILE_TYPE_UNKNOWN already exists at WinBase.h
-               FILE_TYPE_PHOTO,
-               FILE_TYPE_AUDIO,
-               FILE_TYPE_VIDEO,
-               FILE_TYPE_DOCUMENT,
-               FILE_TYPE_PDF,
-               FILE_TYPE_PRESENTATION,
-               FILE_TYPE_ARCHIVE,
-               FILE_TYPE_PROGRAM,
-               FILE_TYPE_MISC,
-               FILE_TYPE_SPREADSHEET,
-               FILE_TYPE_ALL_DOCS,    // any of {DOCUMENT, PDF, PRESENTATION, SPREADSHEET}
-               FILE_TYPE_OTHERS,
-               FILE_TYPE_LAST = FILE_TYPE_OTHERS,
-             };
-
-        enum { SEARCH_TARGET_INSHARE = 0,
-               SEARCH_TARGET_OUTSHARE,
-               SEARCH_TARGET_PUBLICLINK,
-               SEARCH_TARGET_ROOTNODE,      // search in Cloud and Vault rootnodes
-               SEARCH_TARGET_ALL, };
+        void setLRUCacheSizeInBytes(unsigned long long bytes);
 
         /**
-         * @brief Get the number of child nodes
+         * @brief Coalesce MegaGlobalListener::onNodesUpdate callbacks
          *
-         * If the node doesn't exist in MEGA or isn't a folder,
-         * this function returns 0
+         * Once enabled, the changes to nodes are delivered at most once every minInterval milliseconds.
+         * A node changed several times in between is reported once, in its latest state, with
+         * MegaNode::getChanges returning all the changes accumulated since it was last reported.
          *
-         * This function doesn't search recursively, only returns the direct child nodes.
+         * Callbacks for nodes that changed before a request finished may then arrive after
+         * its onRequestFinish.
          *
-         * @param parent Parent node
-         * @return Number of child nodes
+         * It is disabled by default, every change to the nodes is reported as soon as it happens.
+         *
+         * @param minInterval Minimum time between two onNodesUpdate callbacks, in milliseconds, 0 to disable
+         * @param maxBatch Maximum number of nodes in a single callback, the rest wait for the next interval. 0 for no limit
          */
-        int getNumChildren(MegaNode* parent);
+        void setNodesUpdateBatching(int minInterval, int maxBatch);
 
         /**
-         * @brief Get the number of child files of a node
+         * @brief Set how long the SDK thread may be kept busy before it's reported
          *
-         * If the node doesn't exist in MEGA or isn't a folder,
-         * this function returns 0
+         * A single step of the SDK thread (processing a batch of server responses or action
+         * packets, starting the pending requests or transfers...) that takes longer is logged as
+         * a warning, and kept for MegaApi::getEventLoopStats. Both name the longest command,
+         * action packet, request or sync activity it ran.
          *
-         * This function doesn't search recursively, only returns the direct child files.
+         * The default threshold is 1000 milliseconds.
          *
-         * @param parent Parent node
-         * @return Number of child files
+         * @param milliseconds Threshold in milliseconds, 0 to stop looking for slow steps
          */
-        int getNumChildFiles(MegaNode* parent);
+        void setSlowTaskThreshold(int milliseconds);
 
         /**
-         * @brief Get the number of child folders of a node
+         * @brief Get the time spent by the SDK thread in each phase of its loop, as a JSON document
          *
-         * If the node doesn't exist in MEGA or isn't a folder,
-         * this function returns 0
+         * The document holds, for every phase ("exec", "preparewait", "wait", "checkevents",
+         * "csresponse", "scprocessing", "syncactions", "sendrequests" and "sendtransfers"), the
+         * number of times it ran, the total and longest time (count, totalUs and maxUs) and a
+         * histogram of its durations. Item i of the histogram counts the runs shorter than 2^i
+         * microseconds that no earlier item does; the last one counts anything longer.
          *
-         * This function doesn't search recursively, only returns the direct child folders.
+         * The "slow" array lists the latest steps over the threshold set by
+         * MegaApi::setSlowTaskThreshold, oldest first: when they happened, their phase, duration
+         * and, if known, the kind, name and duration of the work that took longest (taskKind,
+         * taskName and taskUs).
          *
-         * @param parent Parent node
+         * Phases nest: "csresponse", "scprocessing" and "syncactions" are part of "exec".
+         *
+         * You take the ownership of the returned value. Use delete [] to free it.
+         *
+         * @param reset True to start counting afresh after getting the current values
+         * @return JSON document with the statistics
+         */
+        const char* getEventLoopStats(bool reset);
+
+        enum
+        {
+            LRU_CACHE_POLICY_LRU = 0,
+            LRU_CACHE_POLICY_2Q = 1,
+        };
+
+        /**
+         * @brief Set the replacement policy of the cache LRU
+         *
+         * Valid values are:
+         * - MegaApi::LRU_CACHE_POLICY_LRU = 0 (default)
+         * The least recently used node is unloaded first.
+         *
+         * - MegaApi::LRU_CACHE_POLICY_2Q = 1
+         * Nodes used only once since they were loaded are unloaded before the ones used
+         * again, so walks through a large number of nodes (ie. a full search) don't flush
+         * the most used nodes of the cache.
+         *
+         * @param policy Replacement policy of the cache LRU
+         */
+        void setLRUCachePolicy(int policy);
+
+        /**
+         * @brief Returns number of nodes stored at cache LRU
+         *
+         * @return Number of nodes at cache LRU
+         */
+        unsigned long long getNumNodesAtCacheLRU() const;
+
+        /**
+         * @brief Enable or disable the compact mode for nodes kept in RAM
+         *
+         * In compact mode, the nodes loaded in RAM release the spare capacity of their
+         * buffers. It reduces the memory used by every node at the cost of some extra
+         * reallocations when nodes are updated. It's recommended for devices with limited
+         * memory, together with MegaApi::setLRUCacheSize.
+         *
+         * By default, the compact mode is disabled.
+         *
+         * @param enable True to enable the compact mode, false to disable it
+         */
+        void setCompactNodes(bool enable);
+
+        /**
+         * @brief Enable or disable the bulk load mode of the local DB
+         *
+         * In bulk load mode, the nodes fetched from servers are written to the local DB
+         * without syncing it to storage, with larger caches and without secondary indexes,
+         * which are built at once when the fetch nodes finishes. It reduces the time of the
+         * first login of large accounts, mainly on slow storage. If the app is killed during
+         * the load, the DB may be lost and the nodes are fetched again.
+         *
+         * It takes effect from the next fetch nodes from servers. By default, it's disabled.
+         *
+         * @param enable True to enable the bulk load mode, false to disable it
+         */
+        void setBulkLoadDbMode(bool enable);
+
+        /**
+         * @brief Enable or disable the compression of the nodes stored in the local DB
+         *
+         * Nodes with long attributes (descriptions, tags, many versions...) take much less
+         * space in the local DB when compressed, at the cost of some CPU time when they are
+         * read from it. Compressed nodes remain readable after disabling it.
+         *
+         * It applies to the nodes written to the local DB from now on. By default, it's disabled.
+         *
+         * @param enable True to compress the nodes, false to store them uncompressed
+         */
+        void setDbNodeCompression(bool enable);
+
+        /**
+         * @brief Enable or disable the coalescing of action packets
+         *
+         * When the changes made by other clients are received in several consecutive
+         * batches (e.g. after moving or renaming many nodes, or when resuming a session
+         * that was offline for a while), they are written to the local DB and reported by
+         * MegaListener::onNodesUpdate once per node, with the last batch, instead of once
+         * per batch. Until then, the nodes in RAM are up to date, but the callbacks for
+         * them are delayed.
+         *
+         * By default, it's disabled.
+         *
+         * @param enable True to coalesce the batches of action packets, false to apply them one by one
+         */
+        void setActionPacketCoalescing(bool enable);
+
+        /**
+         * @brief Enable or disable a secondary channel for read-only API commands
+         *
+         * Commands that only retrieve information, like the URLs to download files and
+         * thumbnails, are sent in a request of their own, without waiting for the response to
+         * the batch of commands in progress. That improves the throughput of downloads on
+         * links with a high latency.
+         *
+         * By default, it's disabled.
+         *
+         * @param enable True to send read-only commands through a secondary channel
+         */
+        void setSecondaryCommandChannel(bool enable);
+
+        /**
+         * @brief Enable or disable HTTP/2 multiplexing for API requests and transfers
+         *
+         * Concurrent requests to the same server share a single connection, instead of
+         * opening one connection per request, when the server supports HTTP/2. Otherwise,
+         * HTTP/1.1 is used as usual. The change applies to the requests started afterwards.
+         *
+         * By default, it's disabled.
+         *
+         * @param api True to multiplex the requests to the API servers
+         * @param transfers True to multiplex the requests to the storage servers
+         * @return False if the network layer doesn't support HTTP/2
+         */
+        bool setHttp2Multiplexing(bool api, bool transfers);
+
+        /**
+         * @brief Enable or disable pre-warming of the connections to the storage servers
+         *
+         * When the URLs to download or upload a file are received, a connection to each storage
+         * server is opened in advance, so the TLS handshake is already done when the parallel
+         * requests of the transfer need it.
+         *
+         * By default, it's disabled.
+         *
+         * @param enable True to open connections to the storage servers in advance
+         */
+        void setStorageConnectionPrewarming(bool enable);
+
+        /**
+         * @brief Enable or disable the racing of IPv6 and IPv4 connections (happy eyeballs)
+         *
+         * When both the IPv6 and the IPv4 address of a server are known, connections to both are
+         * attempted, IPv6 first and IPv4 shortly after, and the first one to succeed is used.
+         * That prevents a broken IPv6 route from stalling the requests until they time out.
+         *
+         * It's only available in builds that resolve names with c-ares. Otherwise, cURL already
+         * races the addresses that it resolves.
+         *
+         * By default, it's disabled.
+         *
+         * @param enable True to race IPv6 and IPv4 connections
+         * @return False if this build doesn't support it
+         */
+        bool setHappyEyeballs(bool enable);
+
+        enum
+        {
+            BANDWIDTH_CLASS_USER = 0,
+            BANDWIDTH_CLASS_SYNC = 1, // two-way and one-way syncs, except backups
+            BANDWIDTH_CLASS_BACKUP = 2,
+        };
+
+        /**
+         * @brief Set the maximum speed of the transfers with one storage server, in bytes per second
+         *
+         * The limit applies on top of setMaxDownloadSpeed and setMaxUploadSpeed, and can be
+         * changed at any time: ongoing transfers adapt without reconnecting.
+         *
+         * A value <= 0 removes the limit.
+         *
+         * @param direction MegaTransfer::TYPE_DOWNLOAD or MegaTransfer::TYPE_UPLOAD
+         * @param host Host name of the storage server, or NULL to set the limit of every
+         * storage server that doesn't have its own
+         * @param bpslimit Speed in bytes per second
+         * @return False if the network layer doesn't allow to control the speed per server
+         */
+        bool setHostBandwidthLimit(int direction, const char* host, long long bpslimit);
+
+        /**
+         * @brief Set the maximum speed of one class of transfers, in bytes per second
+         *
+         * Transfers started by the app are MegaApi::BANDWIDTH_CLASS_USER, the ones of the syncs are
+         * MegaApi::BANDWIDTH_CLASS_SYNC and the ones of the backups MegaApi::BANDWIDTH_CLASS_BACKUP.
+         * A transfer shared by several classes belongs to the first of them. When the budget of
+         * setMaxDownloadSpeed or setMaxUploadSpeed is scarce, the classes get it in that order.
+         *
+         * The limit can be changed at any time (e.g. to let backups use the whole link at night):
+         * ongoing transfers adapt without reconnecting.
+         *
+         * A value <= 0 removes the limit.
+         *
+         * @param direction MegaTransfer::TYPE_DOWNLOAD or MegaTransfer::TYPE_UPLOAD
+         * @param bandwidthClass One of the MegaApi::BANDWIDTH_CLASS_* values
+         * @param bpslimit Speed in bytes per second
+         * @return False if the network layer doesn't allow to control the speed per class
+         */
+        bool setBandwidthClassLimit(int direction, int bandwidthClass, long long bpslimit);
+
+        /**
+         * @brief Enable or disable the adaptation of the number of connections of large transfers
+         *
+         * When enabled, large transfers that aren't CloudRAID measure their throughput while they
+         * add or remove parallel connections, and keep the number that gives the best one, up to 6.
+         * That helps on links with high bandwidth and latency, where the number of connections set
+         * by setMaxConnections may be too low. The number found is where the next transfers start.
+         *
+         * The change applies to the transfers started afterwards. By default, it's disabled.
+         *
+         * @param enable True to adapt the number of connections to the throughput
+         */
+        void setAdaptiveConnections(bool enable);
+
+        /**
+         * @brief Set the size of the receive buffer for downloads, in bytes
+         *
+         * A bigger buffer passes the received data to the SDK in fewer, larger pieces, which
+         * reduces the CPU usage of fast downloads. Values are limited to the range supported by
+         * the network layer (1 KB to 512 KB with cURL). It's ignored while the download speed is
+         * limited to 100 KB/s or less. The change applies to the requests started afterwards.
+         *
+         * @param bytes Buffer size in bytes, or 0 for the default of the network layer
+         * @return False if the network layer doesn't support it
+         */
+        bool setDownloadBufferSize(int bytes);
+
+        /**
+         * @brief Enable or disable compressed responses from the API servers
+         *
+         * When enabled, the requests to the API offer the compressed encodings that the network
+         * layer can decode (gzip, br and zstd with cURL, depending on how it was built). Responses
+         * are decoded as they are received. That saves data on metered links, for example with
+         * the fetch of nodes of large accounts, at the cost of some CPU.
+         *
+         * The change applies to the requests started afterwards. By default, it's disabled.
+         *
+         * @param enable True to accept compressed responses
+         * @return False if the network layer can't decode any compressed encoding
+         */
+        bool setApiCompression(bool enable);
+
+        enum
+        {
+            DISK_ALLOCATION_GROW = 0,
+            DISK_ALLOCATION_PREALLOCATE = 1,
+            DISK_ALLOCATION_SPARSE = 2,
+        };
+
+        /**
+         * @brief Set how downloads claim their space on disk
+         *
+         * Valid values are:
+         * - MegaApi::DISK_ALLOCATION_GROW: the file grows as the data is written (default)
+         * - MegaApi::DISK_ALLOCATION_PREALLOCATE: the space for the whole file is reserved when
+         * the download starts, which keeps large files unfragmented and makes a full disk show up
+         * before anything is downloaded. The file still reports the size written so far
+         * - MegaApi::DISK_ALLOCATION_SPARSE: the file gets its final size when the download
+         * starts, but the blocks are only allocated as the data is written
+         *
+         * It's applied to downloads that start from the beginning, not to resumed ones. If the
+         * filesystem doesn't support the chosen method, the file just grows as it's written.
+         * The change applies to the downloads added afterwards.
+         *
+         * @param mode One of the values above
+         * @return False if the value isn't valid
+         */
+        bool setDownloadDiskAllocation(int mode);
+
+        /**
+         * @brief Enable or disable hard links for downloads with several local targets
+         *
+         * When the same file is downloaded to several local paths at once (for example, a cloud
+         * file synced into two places), the extra copies are cloned if the filesystem supports
+         * it (Btrfs, XFS, APFS, ReFS) and copied otherwise. When enabled, targets that don't exist
+         * yet become hard links to the downloaded file instead, which takes no extra space even
+         * without cloning. Note that hard links share their content: editing the file through one
+         * path changes it in every other one.
+         *
+         * The change applies to the downloads that finish afterwards. By default, it's disabled.
+         *
+         * @param enable True to hard link the extra targets
+         */
+        void setDownloadHardLinks(bool enable);
+
+        /**
+         * @brief Set the memory that a CloudRAID download can use to get ahead of its slowest part
+         *
+         * Files stored in CloudRAID are downloaded from several storage servers in parallel, and
+         * assembled in order. The parts that arrive faster are kept in memory up to this limit,
+         * after which their connections wait for the slowest part. A higher limit helps when one
+         * server is much slower than the others, at the cost of memory per download.
+         *
+         * The change applies to the downloads started afterwards.
+         *
+         * @param bytes Memory in bytes for each download, or 0 for the default of the SDK
+         */
+        void setRaidLookahead(long long bytes);
+
+        enum
+        {
+            MEMORY_PRESSURE_NONE = 0,
+            MEMORY_PRESSURE_MODERATE = 1,
+            MEMORY_PRESSURE_CRITICAL = 2,
+        };
+
+        /**
+         * @brief Tell the SDK that the system is running low on memory
+         *
+         * Call it upon the memory warnings of the platform (i.e. didReceiveMemoryWarning on iOS,
+         * onTrimMemory on Android), and again with MegaApi::MEMORY_PRESSURE_NONE once they are over.
+         *
+         * Valid values are:
+         * - MegaApi::MEMORY_PRESSURE_NONE = 0
+         * Normal operation.
+         *
+         * - MegaApi::MEMORY_PRESSURE_MODERATE = 1
+         * Half of the nodes at cache LRU are unloaded, and the local databases give back the memory
+         * of their caches.
+         *
+         * - MegaApi::MEMORY_PRESSURE_CRITICAL = 2
+         * As above, but all the nodes at cache LRU are unloaded.
+         *
+         * The unloaded nodes are loaded again from the local database as they are needed, and the
+         * limits set by MegaApi::setLRUCacheSize and MegaApi::setLRUCacheSizeInBytes don't change.
+         * Until MegaApi::MEMORY_PRESSURE_NONE is set again, CloudRAID downloads keep a single chunk
+         * ahead of their slowest part, instead of the lookahead set by MegaApi::setRaidLookahead.
+         *
+         * @param level Memory pressure level
+         */
+        void setMemoryPressure(int level);
+
+        /**
+         * @brief Enable or disable the journal of node changes
+         *
+         * The journal is kept in the local cache of nodes. Every change of a node that is
+         * notified by MegaListener::onNodesUpdate or MegaGlobalListener::onNodesUpdate
+         * appends an entry to it, in the same transaction as the updated node. Apps that keep
+         * their own index of nodes can read the entries since the last one they processed by
+         * MegaApi::getNodeChanges, even after a restart, instead of walking the whole tree again.
+         *
+         * Only the latest 100000 entries are kept. The setting is stored with the local cache
+         * of nodes, so it must be enabled again for a new local cache (i.e. after a new login).
+         * Nodes loaded by a full fetch of the account aren't added to the journal. Disabling it
+         * removes its entries, but sequence numbers aren't assigned again when it's enabled later.
+         *
+         * @param enable True to enable the journal, false to disable and remove it
+         * @return True if the journal was enabled or disabled, false if there is no local cache
+         * of nodes or it failed
+         */
+        bool setNodeChangeJournalEnabled(bool enable);
+
+        /**
+         * @brief Check whether the journal of node changes is enabled
+         *
+         * @see MegaApi::setNodeChangeJournalEnabled
+         *
+         * @return True if the journal is enabled
+         */
+        bool isNodeChangeJournalEnabled();
+
+        /**
+         * @brief Get the entries of the journal of node changes after a sequence number
+         *
+         * When MegaNodeChangeList::hasMissedChanges is true, some entries after
+         * 'afterSequenceNumber' are not kept anymore, and the consumer has to walk the whole
+         * tree of nodes again.
+         *
+         * You take the ownership of the returned value
+         *
+         * @see MegaApi::setNodeChangeJournalEnabled
+         *
+         * @param afterSequenceNumber Sequence number of the last entry already processed, or 0
+         * to get the journal from the start
+         * @param limit Maximum number of entries to return, or 0 for all of them
+         * @return List of entries, or NULL if the journal is disabled or it failed
+         */
+        MegaNodeChangeList* getNodeChanges(long long afterSequenceNumber, int limit);
+
+        /**
+         * @brief Enable or disable the deduplication of uploads by content
+         *
+         * Uploads are skipped, and the existing node copied instead, when a node with the same
+         * fingerprint (size, modification time and a sample of the content) already exists.
+         * When this option is enabled, files are also hashed in full when queued, and the hashes
+         * of the files uploaded by this app are kept in the local cache. So a file that was renamed
+         * or touched, with the same content, is copied from the node it was uploaded as.
+         *
+         * Hashing reads each file once more before it's uploaded, in the thread that starts the
+         * upload. The change applies to the uploads started afterwards. By default, it's disabled.
+         *
+         * @param enable True to deduplicate uploads by content
+         */
+        void setUploadContentDedup(bool enable);
+
+        /**
+         * @brief Enable or disable the batching of small uploads
+         *
+         * Uploads of many small files, such as source trees, spend more time in the per-file
+         * requests than sending data. When this option is enabled, more small files (up to
+         * 128 KB) are uploaded at the same time, so their upload URLs are requested together and
+         * the connections to the storage servers are kept busy. The new nodes of the uploads that
+         * finish together into the same folder are created with a single request.
+         *
+         * This applies to regular and folder uploads, and to the uploads of syncs. By default,
+         * it's disabled.
+         *
+         * @param enable True to batch small uploads
+         */
+        void setSmallUploadBatching(bool enable);
+
+        /**
+         * @brief Set the memory used to keep streamed data for later reads
+         *
+         * Data received by MegaApi::startStreaming (and so by the HTTP proxy server) is kept,
+         * decrypted, in blocks of 1 MB up to this limit. Later reads of the same ranges, like a
+         * player seeking back or a second reader of the same file, are served from memory
+         * instead of being downloaded again. The least recently used blocks are dropped first.
+         *
+         * By default, the limit is 0, and nothing is kept.
+         *
+         * @param bytes Maximum memory in bytes, or 0 to disable and free the cache
+         */
+        void setStreamingCacheSize(long long bytes);
+
+        /**
+         * @brief Create the nodes of uploads without waiting for their thumbnail and preview
+         *
+         * The thumbnail and preview of uploaded images and videos are generated locally. By
+         * default, the node of the upload is created once both are ready, so a slow decoding
+         * delays the MegaTransferListener::onTransferFinish callback. When this option is
+         * enabled, the node is created as soon as the data is uploaded, and the thumbnail and
+         * preview are added to it when they are ready (a node update is received then).
+         *
+         * If too many uploads are still waiting for their imagery, the next ones get the
+         * default behavior until they catch up.
+         *
+         * @param enable True to attach the thumbnail and preview after creating the node
+         */
+        void setFileAttributesAfterUpload(bool enable);
+
+        /**
+         * @brief Limit the memory used by downloaded data that is not written to disk yet
+         *
+         * Downloaded data is decrypted on worker threads and then written to the local file.
+         * When the disk or the CPU can't keep up with the network, this data accumulates in
+         * memory. With a limit set, downloads don't request more data from the storage
+         * servers while the data received, being decrypted and being written (for all the
+         * downloads together) reaches the limit, and resume as it's written.
+         *
+         * By default there is no limit.
+         *
+         * @param bytes Maximum memory in bytes, or 0 for no limit
+         */
+        void setDownloadMemoryBudget(long long bytes);
+
+        enum
+        {
+            DOWNLOAD_STAGE_RECEIVE = 0,
+            DOWNLOAD_STAGE_DECRYPT = 1,
+            DOWNLOAD_STAGE_WRITE = 2,
+        };
+
+        /**
+         * @brief Get the memory held by the active downloads at a stage
+         *
+         * Valid values for the stage are:
+         * - MegaApi::DOWNLOAD_STAGE_RECEIVE: requests in progress, and data waiting to be
+         *   combined with that of other connections
+         * - MegaApi::DOWNLOAD_STAGE_DECRYPT: data being decrypted and verified
+         * - MegaApi::DOWNLOAD_STAGE_WRITE: data waiting to be (or being) written to disk
+         *
+         * @param stage Stage of the download to check
+         * @return Memory used by that stage in bytes, or 0 for an invalid stage
+         */
+        long long getDownloadPipelineBytes(int stage);
+
+        /**
+         * @brief Returns an estimation of the memory used by the nodes stored at cache LRU
+         *
+         * The value can be divided by MegaApi::getNumNodesAtCacheLRU to get the average
+         * number of bytes per node, which helps to choose a value for MegaApi::setLRUCacheSize.
+         *
+         * @return Estimated number of bytes used by the nodes at cache LRU
+         */
+        unsigned long long getMemoryUsageOfNodesAtCacheLRU() const;
+
+        enum { ORDER_NONE = 0, ORDER_DEFAULT_ASC, ORDER_DEFAULT_DESC,
+            ORDER_SIZE_ASC, ORDER_SIZE_DESC,
+            ORDER_CREATION_ASC, ORDER_CREATION_DESC,
+            ORDER_MODIFICATION_ASC, ORDER_MODIFICATION_DESC,
+            /*deprecated*/ ORDER_ALPHABETICAL_ASC, /*deprecated*/ ORDER_ALPHABETICAL_DESC,
+            /*deprecated*/ ORDER_PHOTO_ASC, /*deprecated*/ ORDER_PHOTO_DESC,
+            /*deprecated*/ ORDER_VIDEO_ASC, /*deprecated*/ ORDER_VIDEO_DESC,
+            ORDER_LINK_CREATION_ASC, ORDER_LINK_CREATION_DESC,
+            ORDER_LABEL_ASC, ORDER_LABEL_DESC, ORDER_FAV_ASC, ORDER_FAV_DESC,};
+
+
+        enum { FILE_TYPE_DEFAULT = 0, // FILE_TYPE_UNKNOWN already exists at WinBase.h
+               FILE_TYPE_PHOTO,
+               FILE_TYPE_AUDIO,
+               FILE_TYPE_VIDEO,
+               FILE_TYPE_DOCUMENT,
+               FILE_TYPE_PDF,
+               FILE_TYPE_PRESENTATION,
+               FILE_TYPE_ARCHIVE,
+               FILE_TYPE_PROGRAM,
+               FILE_TYPE_MISC,
+               FILE_TYPE_SPREADSHEET,
+               FILE_TYPE_ALL_DOCS,    // any of {DOCUMENT, PDF, PRESENTATION, SPREADSHEET}
+               FILE_TYPE_OTHERS,
+               FILE_TYPE_LAST = FILE_TYPE_OTHERS,
+             };
+
+        enum { SEARCH_TARGET_INSHARE = 0,
+               SEARCH_TARGET_OUTSHARE,
+               SEARCH_TARGET_PUBLICLINK,
+               SEARCH_TARGET_ROOTNODE,      // search in Cloud and Vault rootnodes
+               SEARCH_TARGET_ALL, };
+
+        /**
+         * @brief Get the number of child nodes
+         *
+         * If the node doesn't exist in MEGA or isn't a folder,
+         * this function returns 0
+         *
+         * This function doesn't search recursively, only returns the direct child nodes.
+         *
+         * @param parent Parent node
+         * @return Number of child nodes
+         */
+        int getNumChildren(MegaNode* parent);
+
+        /**
+         * @brief Get the number of child files of a node
+         *
+         * If the node doesn't exist in MEGA or isn't a folder,
+         * this function returns 0
+         *
+         * This function doesn't search recursively, only returns the direct child files.
+         *
+         * @param parent Parent node
+         * @return Number of child files
+         */
+        int getNumChildFiles(MegaNode* parent);
+
+        /**
+         * @brief Get the number of child folders of a node
+         *
+         * If the node doesn't exist in MEGA or isn't a folder,
+         * this function returns 0
+         *
+         * This function doesn't search recursively, only returns the direct child folders.
+         *
+         * @param parent Parent node
          * @return Number of child folders
          */
         int getNumChildFolders(MegaNode* parent);
@@ -20204,6 +21194,26 @@ class MegaApi
          */
         bool httpServerIsOfflineAttributeEnabled();
 
+        /**
+         * @brief Serve the SDK's metrics at /metrics
+         *
+         * By default, it is not enabled
+         *
+         * The metrics are served in the Prometheus text format, which OpenMetrics scrapers
+         * also accept, so a monitoring agent can collect them from the HTTP server. They
+         * are the same as MegaApi::getMetrics returns.
+         *
+         * @param enable true to serve the metrics, false to answer 404 for /metrics
+         */
+        void httpServerEnableMetrics(bool enable);
+
+        /**
+         * @brief Check if the metrics are served at /metrics
+         *
+         * @return true if the metrics are served, otherwise false
+         */
+        bool httpServerIsMetricsEnabled();
+
         /**
          * @brief Enable/disable the restricted mode of the HTTP server
          *
@@ -20481,6 +21491,33 @@ class MegaApi
          */
         int httpServerGetMaxOutputSize();
 
+        /**
+         * @brief Set the number of event loops of the HTTP proxy server
+         *
+         * By default, the HTTP proxy server serves all its connections from a single thread.
+         * With more loops, each one runs on a thread of its own and the new connections are
+         * spread between them, so many concurrent streams can use several CPU cores.
+         *
+         * Only available on Linux and without TLS. Otherwise, the server uses a single loop
+         * whatever the value set here.
+         *
+         * The new value will be taken into account the next time the server is started.
+         * It's possible and effective to call this function even before the server has been
+         * started.
+         *
+         * @param count Number of event loops, or a number <= 0 to use one per CPU core
+         */
+        void httpServerSetLoopCount(int count);
+
+        /**
+         * @brief Get the number of event loops of the HTTP proxy server
+         *
+         * See MegaApi::httpServerSetLoopCount
+         *
+         * @return Number of event loops the server uses the next time it's started
+         */
+        int httpServerGetLoopCount();
+
         /**
          * @brief Start an FTP server in specified port
          *
@@ -25677,6 +26714,19 @@ protected:
 public:
     virtual ~MegaFuseExecutorFlags();
 
+    /**
+     * @brief
+     * How many threads read requests from the kernel for each mount?
+     *
+     * Only applies to the mount executor's flags and only on Linux, where
+     * each additional thread reads from its own clone of the mount's
+     * channel. Elsewhere, requests are always read by a single thread.
+     *
+     * @return
+     * How many threads read requests for each mount.
+     */
+    virtual size_t getDispatchThreadCount() const = 0;
+
     /**
      * @brief
      * How many threads is the executor allowed to spawn?
@@ -25704,6 +26754,20 @@ public:
      */
     virtual size_t getMinThreadCount() const = 0;
 
+    /**
+     * @brief
+     * Specify how many threads read requests from the kernel for each mount.
+     *
+     * Only mounts created after this value has been changed are affected.
+     *
+     * @param count
+     * How many threads should read requests for each mount.
+     *
+     * @return
+     * True if count is a non-zero value, false otherwise.
+     */
+    virtual bool setDispatchThreadCount(size_t count) = 0;
+
     /**
      * @brief
      * Specify how many threads the executor is allowed to spawn.
@@ -25753,6 +26817,22 @@ public:
         LOG_LEVEL_DEBUG
     }; // LogLevel
 
+    enum Operation
+    {
+        // The kernel asked us to flush a file.
+        OPERATION_FLUSH,
+        // The kernel asked us to describe an inode.
+        OPERATION_GETATTR,
+        // The kernel asked us to look up a name in a directory.
+        OPERATION_LOOKUP,
+        // The kernel asked us to read from a file.
+        OPERATION_READ,
+        // The kernel asked us to list a directory.
+        OPERATION_READDIR,
+        // The kernel asked us to write to a file.
+        OPERATION_WRITE
+    }; // Operation
+
     virtual ~MegaFuseFlags();
 
     /**
@@ -25773,6 +26853,19 @@ public:
      */
     static MegaFuseFlags* create();
 
+    /**
+     * @brief
+     * Retrieve a reference to the file cache's flags.
+     *
+     * These flags control how much file content the FUSE subsystem may
+     * keep on disk. They also report how many reads the cache has been
+     * able to satisfy since the flags were retrieved.
+     *
+     * @return
+     * A reference to the file cache's flags.
+     */
+    virtual MegaFuseFileCacheFlags* getFileCacheFlags() = 0;
+
     /**
      * @brief
      * How long should we wait until we upload a modified file?
@@ -25813,6 +26906,41 @@ public:
      */
     virtual MegaFuseExecutorFlags* getMountExecutorFlags() = 0;
 
+    /**
+     * @brief
+     * How many operations of a given kind has the service performed?
+     *
+     * Like the other statistics, this is a snapshot taken when the flags
+     * were retrieved.
+     *
+     * @param operation
+     * One of the MegaFuseFlags::OPERATION_* values.
+     *
+     * @return
+     * How many such operations have completed.
+     */
+    virtual uint64_t getOperationCount(int operation) const = 0;
+
+    /**
+     * @brief
+     * How quickly did the service complete a given kind of operation?
+     *
+     * Latencies are tracked in power-of-two buckets so the result is an
+     * upper bound that may be up to twice the true value.
+     *
+     * @param operation
+     * One of the MegaFuseFlags::OPERATION_* values.
+     *
+     * @param percentile
+     * What percentage of operations should have completed within the
+     * returned latency? 100 yields the slowest operation's latency.
+     *
+     * @return
+     * A latency in microseconds.
+     */
+    virtual uint64_t getOperationLatency(int operation,
+                                         unsigned int percentile) const = 0;
+
     /**
      * @brief
      * Retrieve a reference to the subsystem's executor flags.
@@ -25830,6 +26958,11 @@ public:
      * @brief
      * Specify how long we should wait before uploading a modified file.
      *
+     * A file is uploaded once it hasn't been modified for this long. Larger
+     * files must remain unmodified for up to eight times as long, and a file
+     * that is modified continuously is uploaded after at most thirty-two
+     * times as long.
+     *
      * @param seconds
      * How many seconds before a modified file is uploaded.
      */
@@ -25845,6 +26978,73 @@ public:
     virtual void setLogLevel(int level) = 0;
 }; // MegaFuseFlags
 
+class MegaFuseFileCacheFlags
+{
+protected:
+    MegaFuseFileCacheFlags();
+
+public:
+    virtual ~MegaFuseFileCacheFlags();
+
+    /**
+     * @brief
+     * How often should the cache check whether it has grown too large?
+     *
+     * @return
+     * How many seconds between each check.
+     */
+    virtual size_t getCleanInterval() const = 0;
+
+    /**
+     * @brief
+     * How many reads were satisfied by content already in the cache?
+     *
+     * @return
+     * The number of reads that didn't need to fetch any content.
+     */
+    virtual uint64_t getHits() const = 0;
+
+    /**
+     * @brief
+     * How much file content may the cache keep on disk?
+     *
+     * When the cache grows beyond this size, the content that was read
+     * least recently is evicted. Modified content and content below
+     * mounts that are available offline are never evicted.
+     *
+     * @return
+     * The cache's maximum size in bytes or zero if it is unlimited.
+     */
+    virtual uint64_t getMaxSize() const = 0;
+
+    /**
+     * @brief
+     * How many reads had to fetch content from the cloud?
+     *
+     * @return
+     * The number of reads that fetched content from the cloud.
+     */
+    virtual uint64_t getMisses() const = 0;
+
+    /**
+     * @brief
+     * Specify how often the cache should check whether it has grown too large.
+     *
+     * @param seconds
+     * How many seconds between each check.
+     */
+    virtual void setCleanInterval(size_t seconds) = 0;
+
+    /**
+     * @brief
+     * Specify how much file content the cache may keep on disk.
+     *
+     * @param size
+     * The cache's maximum size in bytes or zero if it should be unlimited.
+     */
+    virtual void setMaxSize(uint64_t size) = 0;
+}; // MegaFuseFileCacheFlags
+
 class MegaFuseInodeCacheFlags
 {
 protected:
@@ -25859,14 +27059,71 @@ public:
 
     virtual size_t getCleanSizeThreshold() const = 0;
 
+    /**
+     * @brief
+     * How many inodes have been evicted from the cache?
+     *
+     * @return
+     * The number of inodes evicted since the service started.
+     */
+    virtual uint64_t getEvictions() const = 0;
+
+    /**
+     * @brief
+     * How many accesses were to inodes already in the cache?
+     *
+     * @return
+     * The number of accesses that found their inode in the cache.
+     */
+    virtual uint64_t getHits() const = 0;
+
+    /**
+     * @brief
+     * How much memory may the cached inodes occupy?
+     *
+     * When the cache grows beyond this size, inodes that haven't been
+     * accessed recently are evicted regardless of their age.
+     *
+     * @return
+     * The cache's memory budget in bytes or zero if it is unlimited.
+     */
+    virtual size_t getMaxMemory() const = 0;
+
     virtual size_t getMaxSize() const = 0;
 
+    /**
+     * @brief
+     * Roughly how much memory do the cached inodes occupy?
+     *
+     * @return
+     * An estimate, in bytes, of the memory occupied by cached inodes.
+     */
+    virtual size_t getMemory() const = 0;
+
+    /**
+     * @brief
+     * How many accesses were to inodes not yet in the cache?
+     *
+     * @return
+     * The number of accesses that added their inode to the cache.
+     */
+    virtual uint64_t getMisses() const = 0;
+
     virtual void setCleanAgeThreshold(std::size_t seconds) = 0;
 
     virtual void setCleanInterval(std::size_t seconds) = 0;
 
     virtual void setCleanSizeThreshold(std::size_t size) = 0;
 
+    /**
+     * @brief
+     * Specify how much memory the cached inodes may occupy.
+     *
+     * @param size
+     * The cache's memory budget in bytes or zero if it should be unlimited.
+     */
+    virtual void setMaxMemory(size_t size) = 0;
+
     virtual void setMaxSize(std::size_t size) = 0;
 }; // MegaFuseInodeCacheFlags
 
@@ -26047,6 +27304,15 @@ public:
      */
     virtual const char* getName() const = 0;
 
+    /**
+     * @brief
+     * Query whether a mount's content is available offline.
+     *
+     * @return
+     * True if the mount's content is available offline.
+     */
+    virtual bool getOffline() const = 0;
+
     /**
      * @brief
      * Query whether a mount is persistent.
@@ -26088,6 +27354,19 @@ public:
      */
     virtual void setName(const char* name) = 0;
 
+    /**
+     * @brief
+     * Specify whether a mount's content should be available offline.
+     *
+     * The content of every file below an offline mount is downloaded in
+     * the background once the mount is enabled and is never evicted from
+     * the file cache, even if the cache exceeds its maximum size.
+     *
+     * @param offline
+     * True if the mount's content should be available offline.
+     */
+    virtual void setOffline(bool offline) = 0;
+
     /**
      * @brief
      * Specify whether a mount is persistent.
@@ -52,8 +52,11 @@
 #endif
 
 // FUSE
+#include <mega/fuse/common/file_cache_statistics.h>
+#include <mega/fuse/common/inode_cache_statistics.h>
 #include <mega/fuse/common/mount_flags.h>
 #include <mega/fuse/common/mount_result.h>
+#include <mega/fuse/common/operation_statistics.h>
 #include <mega/fuse/common/service_flags.h>
 
 ////////////////////////////// SETTINGS //////////////////////////////
@@ -331,6 +334,12 @@ protected:
         // Otherwise this is the record we will send to create this folder
         NewNode newnode;
 
+        // true once 'newnode' is sent, until the batch carrying it completes and 'megaNode' is set
+        bool creating = false;
+
+        // true once the uploads of 'files' are started
+        bool filesQueued = false;
+
         // files to upload to this folder
         struct FileRecord {
             LocalPath lp;
@@ -351,21 +360,43 @@ protected:
     };
     Tree mUploadTree;
 
-    /* Scan entire tree recursively, and retrieve folder structure and files to be uploaded.
+    /* Scan entire tree, and retrieve folder structure and files to be uploaded.
      * A putnodes command can only add subtrees under same target, so in case we need to add
      * subtrees under different targets, this method will generate a subtree for each one.
-     * This happens on the worker thread.
+     * This happens on the worker thread, the folders themselves are listed (and their files
+     * fingerprinted) by the ScanService workers, several at once.
      */
     enum scanFolder_result { scanFolder_succeeded, scanFolder_cancelled, scanFolder_failed };
     scanFolder_result scanFolder(Tree& tree, LocalPath& localPath, uint32_t& foldercount, uint32_t& filecount);
 
+    // Folders queued to the ScanService at once, per worker thread of the filesystem being uploaded
+    static constexpr unsigned FOLDER_SCANS_PER_WORKER = 4;
+
+    // Sends folder creation batches, up to MAX_FOLDER_BATCHES_IN_FLIGHT at a time, and starts the
+    // uploads of the files of each folder as soon as it exists. Called from the main thread, when
+    // the scan is done and again as each batch completes.
+    void createFolders();
+
+    // putnodes batches waiting for their reply at once; they reach the servers together
+    static constexpr unsigned MAX_FOLDER_BATCHES_IN_FLIGHT = 4;
+    unsigned mFolderBatchesInFlight = 0;
+
+    // set when a batch fails or the operation is cancelled, no batch is sent afterwards
+    error mFolderCreationError = API_OK;
+    bool mFolderCreationCancelled = false;
+
+    // files found by the scan, and how many of them have been handed to sendPendingTransfers
+    uint32_t mFileCount = 0;
+    size_t mFilesQueued = 0;
+
     // Gathers up enough (but not too many) newnode records that are all descendants of a single folder
     // and can be created in a single operation.
     // Called from the main thread just before we send the next set of folder creation commands.
+    // batchResult_batchesComplete means there's nothing else to send until the batches in flight complete.
     enum batchResult { batchResult_cancelled, batchResult_requestSent, batchResult_batchesComplete, batchResult_stillRecursing };
     batchResult createNextFolderBatch(Tree& tree, vector<NewNode>& newnodes, uint32_t filecount, bool isBatchRootLevel);
 
-    // Iterate through all pending files of each uploaded folder, and start all upload transfers
+    // Iterate through the files of each uploaded folder that exists already, and not started yet, to start their upload transfers
     bool genUploadTransfersForFiles(Tree& tree, TransferQueue& transferQueue);
 };
 
@@ -533,14 +564,56 @@ protected:
         LocalPath localPath;
         vector<unique_ptr<MegaNode>> childrenNodes;
     };
-    vector<LocalTree> mLocalTree;
 
-    // Scan entire tree recursively, and retrieve folder structure and files to be downloaded.
+    // Folders found by the walk and not walked yet, with the local path each one goes to.
+    // Only folders are kept here, their files are taken as each one is walked.
+    // Foreign nodes carry their children, so those are walked in place (in the transfer's public node).
+    struct FolderToWalk
+    {
+        unique_ptr<MegaNode> ownedNode;
+        MegaNode* node;
+        LocalPath localPath;
+    };
+    vector<FolderToWalk> mFoldersToWalk;
+
+    // The walk goes in steps: the main thread takes the next folders, and their files, off mFoldersToWalk,
+    // and the worker thread creates them locally, generating the transfers that are started as the next step is taken.
+    // Subfolders are only walked in a later step, once their parents exist.
+    static constexpr size_t FOLDERS_PER_STEP = 256;
+    static constexpr size_t FILES_PER_STEP = 4096;
+
+    // Local folders of a step created at once, each thread with its own FileSystemAccess
+    static constexpr unsigned FOLDER_CREATION_THREADS = 4;
+
+    // folders and files found so far, and folders handed to the worker thread (all of them created but the last step's)
+    unsigned mFolderCount = 0;
+    unsigned mFileCount = 0;
+    unsigned mFoldersHanded = 0;
+
+    FileSystemType mFsType = FS_UNKNOWN;
+
+    // The step handed to the worker thread, guarded by mStepMutex
+    struct Step
+    {
+        vector<LocalTree> folders;
+    };
+    std::mutex mStepMutex;
+    std::condition_variable mStepCondition;
+    unique_ptr<Step> mNextStep;
+    bool mWalkFinished = false;
+
+    // Takes the next step off the walk. Happens on the main thread.
     enum scanFolder_result { scanFolder_succeeded, scanFolder_cancelled, scanFolder_failed };
-    scanFolder_result scanFolder(MegaNode *node, LocalPath& path, FileSystemType fsType, unsigned& fileAddedCount);
+    scanFolder_result walkNextStep(Step& step);
+
+    // Hands the step to the worker thread, or tells it there are no more.
+    void handStepToWorker(unique_ptr<Step> step);
+
+    // Called on the main thread with the transfers of the step the worker thread is done with, to take the next one.
+    void stepCompleted(shared_ptr<TransferQueue> transferQueue, Error e);
 
-    // Create all local directories in one shot. This happens on the worker thread.
-    std::unique_ptr<TransferQueue> createFolderGenDownloadTransfersForFiles(FileSystemType fsType, uint32_t fileCount, Error& e);
+    // Create the local directories of a step, generating the transfers of their files. This happens on the worker thread.
+    std::unique_ptr<TransferQueue> createFolderGenDownloadTransfersForFiles(Step& step, Error& e);
 
     // Iterate through all pending files, and adds all download transfers
     bool genDownloadTransfersForFiles(TransferQueue* transferQueue,
@@ -663,6 +736,9 @@ class MegaNodePrivate : public MegaNode, public Cacheable
         static string removeAppPrefixFromFingerprint(const char* appFingerprint, m_off_t* nodeSize = nullptr);
         static string addAppPrefixToFingerprint(const string& fingerprint, const m_off_t nodeSize);
 
+        // for updates coalesced with earlier ones not reported yet
+        void addChanges(uint64_t changes) { changed |= changes; }
+
     protected:
         MegaNodePrivate(Node *node);
         const char* getAttrFrom(const char *attrName, const attr_map* attrMap) const;
@@ -1316,6 +1392,9 @@ class MegaTransferPrivate : public MegaTransfer, public Cacheable
         nodetype_t fingerprint_filetype = TYPE_UNKNOWN;
         FileFingerprint fingerprint_onDisk;
 
+        // SHA-256 of the content, only with MegaApi::setUploadContentDedup
+        string contentHash_onDisk;
+
 protected:
         int type;
         int tag;
@@ -1613,6 +1692,8 @@ public:
     int getFileCount() const override { return stats.numFiles; }
     int getUploadCount() const override { return stats.numUploads; }
     int getDownloadCount() const override { return stats.numDownloads; }
+    long long getFingerprintComputedCount() const override { return stats.numFingerprintsComputed; }
+    long long getFingerprintReusedCount() const override { return stats.numFingerprintsReused; }
     MegaSyncStatsPrivate *copy() const override { return new MegaSyncStatsPrivate(*this); }
 };
 
@@ -2430,6 +2511,8 @@ class MegaNodeListPrivate : public MegaNodeList
         MegaNodeListPrivate(const MegaNodeListPrivate *nodeList, bool copyChildren = false);
         MegaNodeListPrivate(sharedNode_vector& v);
         MegaNodeListPrivate(sharedNode_list& l);
+        // takes the ownership of the nodes
+        MegaNodeListPrivate(std::vector<std::unique_ptr<MegaNode>>&& nodes);
         ~MegaNodeListPrivate() override;
         MegaNodeList *copy() const override;
         MegaNode* get(int i) const override;
@@ -2440,9 +2523,43 @@ class MegaNodeListPrivate : public MegaNodeList
         //This ones takes the ownership of the given node
         void addNode(std::unique_ptr<MegaNode> node);
 
+        int getHandles(MegaHandle* handles, int count) const override;
+        int getSizes(int64_t* sizes, int count) const override;
+        int getCreationTimes(int64_t* times, int count) const override;
+        int getModificationTimes(int64_t* times, int count) const override;
+        int getTypes(int* types, int count) const override;
+        size_t getNamesSize() const override;
+        int getNames(char* buffer, size_t size, int* ends, int count) const override;
+
 	protected:
 		MegaNode** list;
 		int s;
+
+        // fills 'values' with 'value(node)' of the first 'count' nodes at most
+        template<typename T, typename GetValue>
+        int getValues(T* values, int count, GetValue&& value) const;
+};
+
+class MegaNodeChangeListPrivate : public MegaNodeChangeList
+{
+public:
+    MegaNodeChangeListPrivate(std::vector<DBNodeChange>&& changes, uint64_t lastSequence, bool missed);
+
+    MegaNodeChangeList* copy() const override;
+    int size() const override;
+    long long getSequenceNumber(int i) const override;
+    MegaHandle getNodeHandle(int i) const override;
+    uint64_t getChanges(int i) const override;
+    MegaHandle getSCSN(int i) const override;
+    long long getLastSequenceNumber() const override;
+    bool hasMissedChanges() const override;
+
+private:
+    const DBNodeChange* at(int i) const;
+
+    std::vector<DBNodeChange> mChanges;
+    uint64_t mLastSequence = 0;
+    bool mMissed = false;
 };
 
 class MegaChildrenListsPrivate : public MegaChildrenLists
@@ -2502,9 +2619,19 @@ class MegaTransferListPrivate : public MegaTransferList
         MegaTransfer* get(int i) override;
         int size() override;
 
+        int getTags(int* tags, int count) override;
+        int getStates(int* states, int count) override;
+        int getTransferredBytes(int64_t* bytes, int count) override;
+        int getTotalBytes(int64_t* bytes, int count) override;
+        int getNodeHandles(MegaHandle* handles, int count) override;
+
 	protected:
 		MegaTransfer** list;
 		int s;
+
+        // fills 'values' with 'value(transfer)' of the first 'count' transfers at most
+        template<typename T, typename GetValue>
+        int getValues(T* values, int count, GetValue&& value) const;
 };
 
 class MegaContactRequestListPrivate : public MegaContactRequestList
@@ -2713,6 +2840,8 @@ class TransferQueue
     public:
         TransferQueue();
         void push(MegaTransferPrivate *transfer);
+        // all of them under a single lock, in order
+        void push(std::vector<MegaTransferPrivate *>&& transfers);
         void push_front(MegaTransferPrivate *transfer);
         MegaTransferPrivate * pop();
         bool empty();
@@ -3289,12 +3418,17 @@ class MegaApiImpl : public MegaApp
         void resetCredentials(MegaUser *user, MegaRequestListener *listener = NULL);
         char* getMyRSAPrivateKey();
         void setLogExtraForModules(bool networking, bool syncs);
+        static void setSharedResources(bool enable);
         static void setLogLevel(int logLevel);
         static void setMaxPayloadLogSize(long long maxSize);
         static void addLoggerClass(MegaLogger *megaLogger, bool singleExclusiveLogger);
         static void removeLoggerClass(MegaLogger *megaLogger, bool singleExclusiveLogger);
         static void setLogToConsole(bool enable);
         static void setLogJSONContent(bool enable);
+        static void setLogAsync(bool enable);
+        static char* getMetrics();
+        static void setTracing(bool enable);
+        static char* getTrace();
         static void log(int logLevel, const char* message, const char *filename = NULL, int line = -1);
         void setLoggingName(const char* loggingName);
 
@@ -3331,6 +3465,8 @@ class MegaApiImpl : public MegaApp
         void putThumbnail(MegaBackgroundMediaUpload* node, const char *srcFilePath, MegaRequestListener *listener = NULL);
         void setThumbnailByHandle(MegaNode* node, MegaHandle attributehandle, MegaRequestListener *listener = NULL);
         void getPreview(MegaNode* node, const char *dstFilePath, MegaRequestListener *listener = NULL);
+        void getThumbnails(MegaNodeList* nodes, const char* dstFolderPath, MegaRequestListener* listener = nullptr);
+        void getPreviews(MegaNodeList* nodes, const char* dstFolderPath, MegaRequestListener* listener = nullptr);
 		void cancelGetPreview(MegaNode* node, MegaRequestListener *listener = NULL);
         void setPreview(MegaNode* node, const char *srcFilePath, MegaRequestListener *listener = NULL);
         void putPreview(MegaBackgroundMediaUpload* node, const char *srcFilePath, MegaRequestListener *listener = NULL);
@@ -3377,6 +3513,7 @@ class MegaApiImpl : public MegaApp
         MegaStringList* getAllNodeTags(const char* searchString, CancelToken cancelToken);
 
         void exportNode(MegaNode *node, int64_t expireTime, bool writable, bool megaHosted, MegaRequestListener *listener = NULL);
+        void exportNodes(MegaNodeList* nodes, int64_t expireTime, bool writable, bool megaHosted, MegaRequestListener* listener = nullptr);
         void disableExport(MegaNode *node, MegaRequestListener *listener = NULL);
         void fetchNodes(MegaRequestListener *listener = NULL);
         void getPricing(MegaRequestListener *listener = NULL);
@@ -3441,6 +3578,8 @@ class MegaApiImpl : public MegaApp
         void startUpload(bool startFirst, const char* localPath, MegaNode* parent, const char* fileName, const char* targetUser, int64_t mtime, int folderTransferTag, bool isBackup, const char* appData, bool isSourceFileTemporary, bool forceNewUpload, FileSystemType fsType, CancelToken cancelToken, MegaTransferListener* listener);
         MegaTransferPrivate* createUploadTransfer(bool startFirst, const char *localPath, MegaNode *parent, const char *fileName, const char *targetUser, int64_t mtime, int folderTransferTag, bool isBackup, const char *appData, bool isSourceFileTemporary, bool forceNewUpload, FileSystemType fsType, CancelToken cancelToken, MegaTransferListener *listener, const FileFingerprint* preFingerprintedFile = nullptr);
         void startDownload (bool startFirst, MegaNode *node, const char* localPath, const char *customName, int folderTransferTag, const char *appData, CancelToken cancelToken, int collisionCheck, int collisionResolution, bool undelete, MegaTransferListener *listener);
+        void startUploads(MegaStringList* localPaths, MegaNode* parent, bool startFirst, CancelToken cancelToken, MegaTransferListener* listener);
+        void startDownloads(MegaNodeList* nodes, const char* localFolder, bool startFirst, CancelToken cancelToken, int collisionCheck, int collisionResolution, MegaTransferListener* listener);
         MegaTransferPrivate* createDownloadTransfer(bool startFirst, MegaNode *node, const char* localPath, const char *customName, int folderTransferTag, const char *appData, CancelToken cancelToken, int collisionCheck, int collisionResolution, bool undelete, MegaTransferListener *listener, FileSystemType fsType);
         void startStreaming(MegaNode* node, m_off_t startPos, m_off_t size, MegaTransferListener *listener);
         void setStreamingMinimumRate(int bytesPerSecond);
@@ -3521,6 +3660,9 @@ class MegaApiImpl : public MegaApp
         // Query whether a file is in FUSE's file cache.
         bool isCached(const char* path);
 
+        // where the node's current content is, whole, in the FUSE cache
+        bool cachedContentPath(MegaNode* node, LocalPath& path);
+
         // Query whether FUSE is supported on this platform.
         bool isFUSESupported();
 
@@ -3612,6 +3754,7 @@ class MegaApiImpl : public MegaApp
         void setLegacyExclusionUpperSizeLimit(unsigned long long limit);
         MegaError* exportLegacyExclusionRules(const char* absolutePath);
         long long getNumLocalNodes();
+        const char* getSyncTelemetry(bool includeHistograms);
         int isNodeSyncable(MegaNode *megaNode);
         MegaError *isNodeSyncableWithError(MegaNode* node);
         bool isScanning();
@@ -3661,7 +3804,39 @@ class MegaApiImpl : public MegaApp
         void resetTotalUploads();
         void updateStats();
         void setLRUCacheSize(unsigned long long size);
+        void setLRUCacheSizeInBytes(unsigned long long bytes);
+        void setNodesUpdateBatching(int minInterval, int maxBatch);
+        void setSlowTaskThreshold(int milliseconds);
+        const char* getEventLoopStats(bool reset);
+        void setLRUCachePolicy(int policy);
         unsigned long long getNumNodesAtCacheLRU() const;
+        void setCompactNodes(bool enable);
+        void setBulkLoadDbMode(bool enable);
+        void setDbNodeCompression(bool enable);
+        void setActionPacketCoalescing(bool enable);
+        void setSecondaryCommandChannel(bool enable);
+        bool setHttp2Multiplexing(bool api, bool transfers);
+        void setStorageConnectionPrewarming(bool enable);
+        bool setHappyEyeballs(bool enable);
+        bool setHostBandwidthLimit(int direction, const char* host, long long bpslimit);
+        bool setBandwidthClassLimit(int direction, int bandwidthClass, long long bpslimit);
+        void setAdaptiveConnections(bool enable);
+        bool setDownloadBufferSize(int bytes);
+        bool setApiCompression(bool enable);
+        bool setDownloadDiskAllocation(int mode);
+        void setDownloadHardLinks(bool enable);
+        void setRaidLookahead(long long bytes);
+        void setMemoryPressure(int level);
+        bool setNodeChangeJournalEnabled(bool enable);
+        bool isNodeChangeJournalEnabled();
+        MegaNodeChangeList* getNodeChanges(long long afterSequenceNumber, int limit);
+        void setUploadContentDedup(bool enable);
+        void setSmallUploadBatching(bool enable);
+        void setStreamingCacheSize(long long bytes);
+        void setFileAttributesAfterUpload(bool enable);
+        void setDownloadMemoryBudget(long long bytes);
+        long long getDownloadPipelineBytes(int stage);
+        unsigned long long getMemoryUsageOfNodesAtCacheLRU() const;
         unsigned long long getNumNodes();
         unsigned long long getAccurateNumNodes();
         long long getTotalDownloadedBytes();
@@ -3779,6 +3954,11 @@ public:
     public:
         bool processMegaTree(MegaNode* node, MegaTreeProcessor* processor, bool recursive = 1);
 
+    private:
+        bool processMegaTreeNodes(MegaNode* node, MegaTreeProcessor* processor, bool recursive);
+
+    public:
+
         MegaNode *createForeignFileNode(MegaHandle handle, const char *key, const char *name, m_off_t size, m_off_t mtime, const char* fingerprintCrc,
                                        MegaHandle parentHandle, const char *privateauth, const char *publicauth, const char *chatauth);
         MegaNode *createForeignFolderNode(MegaHandle handle, const char *name, MegaHandle parentHandle,
@@ -3896,6 +4076,8 @@ public:
         int httpServerGetMaxBufferSize();
         void httpServerSetMaxOutputSize(int outputSize);
         int httpServerGetMaxOutputSize();
+        void httpServerSetLoopCount(int count);
+        int httpServerGetLoopCount();
 
         // permissions
         void httpServerEnableFileServer(bool enable);
@@ -3907,6 +4089,8 @@ public:
         int httpServerGetRestrictedMode();
         bool httpServerIsLocalOnly();
         void httpServerEnableOfflineAttribute(bool enable);
+        void httpServerEnableMetrics(bool enable);
+        bool httpServerIsMetricsEnabled();
         void httpServerEnableSubtitlesSupport(bool enable);
         bool httpServerIsSubtitlesSupportEnabled();
 
@@ -4144,6 +4328,8 @@ public:
         void fireOnUsersUpdate(MegaUserList *users);
         void fireOnUserAlertsUpdate(MegaUserAlertList *alerts);
         void fireOnNodesUpdate(MegaNodeList *nodes);
+        // delivers the coalesced node changes if they are due, all of them at once if forced
+        void flushNodesUpdate(bool force);
         void fireOnAccountUpdate();
         void fireOnSetsUpdate(MegaSetList* sets);
         void fireOnSetElementsUpdate(MegaSetElementList* elements);
@@ -4189,6 +4375,9 @@ public:
         mutex fingerprintingFsAccessMutex;
         MegaFileSystemAccess fingerprintingFsAccess;
 
+        // uploads are also hashed in full while fingerprinting (see MegaClient::ContentHashIndex)
+        std::atomic<bool> mUploadContentDedup{false};
+
         mutex mLastRecievedLoggedMeMutex;
         sessiontype_t mLastReceivedLoggedInState = NOTLOGGEDIN;
         handle mLastReceivedLoggedInMeHandle = UNDEF;
@@ -4202,9 +4391,11 @@ public:
         MegaHTTPServer *httpServer;
         int httpServerMaxBufferSize;
         int httpServerMaxOutputSize;
+        int httpServerLoopCount;
         bool httpServerEnableFiles;
         bool httpServerEnableFolders;
         bool httpServerOfflineAttributeEnabled;
+        bool httpServerMetricsEnabled;
         int httpServerRestrictedMode;
         bool httpServerSubtitlesSupportEnabled;
         set<MegaTransferListener *> httpServerListeners;
@@ -4246,6 +4437,16 @@ public:
 
         set<MegaGlobalListener *> globalListeners;
         set<MegaListener *> listeners;
+
+        // onNodesUpdate coalescing, see MegaApi::setNodesUpdateBatching(), off with a zero interval
+        std::chrono::milliseconds mNodesUpdateInterval{0};
+        size_t mNodesUpdateMaxBatch = 0;
+        std::chrono::steady_clock::time_point mLastNodesUpdate;
+
+        // changed nodes not reported yet, oldest first, each one once with its changes accumulated
+        std::list<std::unique_ptr<MegaNodePrivate>> mPendingNodesUpdate;
+        std::map<MegaHandle, std::list<std::unique_ptr<MegaNodePrivate>>::iterator> mPendingNodesUpdateByHandle;
+
         retryreason_t waitingRequest;
         mutable std::recursive_timed_mutex sdkMutex;
         using SdkMutexGuard = std::unique_lock<std::recursive_timed_mutex>;   // (equivalent to typedef)
@@ -4563,6 +4764,7 @@ public:
         std::shared_ptr<Node> getNodeByFingerprintInternal(const char *fingerprint, Node *parent);
 
         void getNodeAttribute(MegaNode* node, int type, const char *dstFilePath, MegaRequestListener *listener = NULL);
+        void getNodeAttributes(MegaNodeList* nodes, int type, const char* dstFolderPath, MegaRequestListener* listener);
         void cancelGetNodeAttribute(MegaNode *node, int type, MegaRequestListener *listener = NULL);
         void setNodeAttribute(MegaNode* node, int type, const char *srcFilePath, MegaHandle attributehandle, MegaRequestListener *listener = NULL);
         void putNodeAttribute(MegaBackgroundMediaUpload* bu, int type, const char *srcFilePath, MegaRequestListener *listener = NULL);
@@ -4701,6 +4903,8 @@ public:
     uv_buf_t nextBuffer();
     // Increase the free data counter
     void freeData(size_t len);
+    // Free the buffer, to be allocated again by the next init (or append)
+    void release();
     // Set upper bound limit for capacity
     void setMaxBufferSize(unsigned int bufferSize);
     // Set upper bound limit for chunk size to write to the consumer
@@ -4751,6 +4955,130 @@ protected:
     int duration;
 };
 
+// Part of a chunk of node data, queued to be written to a connection. The chunk is shared with
+// the other connections it's queued to, and written from as is.
+struct StreamingSlice
+{
+    std::shared_ptr<const std::string> chunk;
+    size_t offset;
+    size_t len;
+};
+
+// Sizes the queue of node data of a streaming connection from the pace its client takes the data
+// at, and from how the read delivers it. The queue covers the time a paused read takes to deliver
+// again plus a margin, which doubles whenever the client runs dry and shrinks back while the read
+// is paused for it. While the client's pace isn't known yet, or the read barely keeps up with it,
+// the queue may take the whole budget.
+class StreamingBufferController
+{
+public:
+    typedef std::chrono::steady_clock::time_point time_point;
+
+    // the queue size stays within [minSize, maxSize]
+    StreamingBufferController(size_t minSize, size_t maxSize);
+
+    // The client took len bytes. ranDry: the read still owed it data, and none was queued.
+    void onDrained(size_t len, bool ranDry, time_point now);
+
+    // the read paused, with this queue full
+    void onPaused();
+
+    // bytes per second the client takes, 0 if not known yet
+    double drainRate() const { return rate; }
+    double marginSeconds() const { return margin; }
+
+    // readLatency: seconds a read takes to deliver since (re)started
+    // readRate: bytes per second it delivers, 0 if not known yet
+    size_t queueSize(double readLatency, double readRate) const;
+
+    static constexpr double MIN_MARGIN = 1;
+    static constexpr double MAX_MARGIN = 30;
+
+private:
+    size_t minSize;
+    size_t maxSize;
+    double rate = 0;
+    double margin = MIN_MARGIN;
+
+    // writes further apart than this come from a client that paused: not its pace
+    static constexpr double MAX_DRAIN_GAP = 1;
+    static constexpr double MIN_SAMPLE_TIME = 0.25;
+    time_point sampleStart;
+    time_point lastDrain;
+    size_t sampleBytes = 0;
+};
+
+class MegaHTTPContext;
+
+// The streaming read of a node by one or more HTTP connections. A connection requesting data
+// the read is about to deliver, or delivered recently, follows it instead of starting a read of
+// its own: each chunk read is copied once and queued to every follower that needs it. The read
+// pauses while any follower has more data queued than its StreamingBufferController allows, and
+// it goes on as far as the followers need.
+// Followers are added and removed in the threads of their loops, the data arrives in the SDK thread.
+class StreamingFeed : public MegaTransferListener
+{
+public:
+    // recently read data kept for connections joining late
+    static const size_t WINDOW_SIZE = 4 * StreamingBuffer::MAX_BUFFER_SIZE;
+
+    StreamingFeed(MegaApiImpl *megaApi, MegaNode *node, m_off_t start);
+    ~StreamingFeed();
+
+    bool isFeeding(MegaNode *node) const;
+
+    // whether a connection wanting data from pos can follow this read
+    bool canServe(m_off_t pos);
+
+    // queue [start, end) to the connection, as it's read (or from what's been read)
+    void follow(MegaHTTPContext *httpctx, m_off_t start, m_off_t end);
+    void unfollow(MegaHTTPContext *httpctx);
+
+    // a follower wrote len bytes of its queue: a paused read may go on
+    void drained(MegaHTTPContext *httpctx, size_t len);
+
+    bool onTransferData(MegaApi *, MegaTransfer *transfer, char *buffer, size_t size) override;
+    void onTransferFinish(MegaApi *, MegaTransfer *transfer, MegaError *e) override;
+
+private:
+    struct Follower
+    {
+        MegaHTTPContext *httpctx;
+        m_off_t pos;
+        m_off_t end;
+        StreamingBufferController controller;
+        bool delivered = false;
+    };
+
+    // under feedMutex
+    bool deliver(Follower &follower);
+    // a follower has as much queued as it may to go on reading, or half of that to resume
+    bool backlogged(bool resuming);
+    void read();
+
+    MegaApiImpl *megaApi;
+    std::unique_ptr<MegaNode> node;
+
+    std::mutex feedMutex;
+    std::list<Follower> followers;
+    // data read most recently, in order, up to readPos
+    std::deque<std::pair<m_off_t, std::shared_ptr<const std::string>>> window;
+    size_t windowSize = 0;
+    // next position to deliver, and the end of the range being read
+    m_off_t readPos;
+    m_off_t readEnd;
+    bool reading = false;
+    // the read was told to stop, or delivered all: its onTransferFinish is on the way
+    bool stopping = false;
+
+    // how the reads deliver: seconds to the first data since started, then bytes per second
+    double readLatency = 0;
+    double readRate = 0;
+    StreamingBufferController::time_point readStarted;
+    StreamingBufferController::time_point lastData;
+    bool awaitingData = false;
+};
+
 class MegaTCPServer;
 class MegaTCPContext : public MegaTransferListener, public MegaRequestListener
 {
@@ -4805,7 +5133,8 @@ protected:
 
     set<handle> allowedHandles;
     handle lastHandle;
-    list<MegaTCPContext*> connections;
+    list<MegaTCPContext*> connections; // under connectionsMutex, the loops share it
+    std::mutex connectionsMutex;
     uv_async_t exit_handle;
     MegaApiImpl *megaApi;
     bool semaphoresdestroyed;
@@ -4820,7 +5149,21 @@ protected:
     bool started;
     int port;
     bool closing;
-    int remainingcloseevents;
+    int remainingcloseevents; // of the connections of uv_loop only
+
+    // Further event loops, each on a thread of its own with a socket listening on the same
+    // port (SO_REUSEPORT): the kernel spreads the new connections between the loops, and
+    // every connection stays on the loop that accepted it. Stopped before the main loop.
+    struct WorkerLoop
+    {
+        MegaTCPServer *tcpServer;
+        uv_loop_t uv_loop;
+        uv_tcp_t server;
+        uv_async_t exit_handle;
+        std::thread thread;
+    };
+    std::vector<std::unique_ptr<WorkerLoop>> workers;
+    unsigned loopCount;
 
 #ifdef ENABLE_EVT_TLS
     // TLS
@@ -4853,6 +5196,7 @@ protected:
     static void onExitHandleClose(uv_handle_t* handle);
 
     static void onCloseRequested(uv_async_t* handle);
+    static void onWorkerCloseRequested(uv_async_t* handle);
 
     static void onWriteFinished(uv_write_t* req, int status); //This might need to go to HTTPServer
 #ifdef ENABLE_EVT_TLS
@@ -4864,6 +5208,12 @@ protected:
     void run();
     void initializeAndStartListening();
 
+    // binds and listens on the server's address, sharing the port with other sockets if reusePort
+    bool listen(uv_loop_t *loop, uv_tcp_t *handle, bool reusePort);
+    void startWorkers(unsigned count);
+    void stopWorkers();
+    bool isMainLoop(const uv_loop_t *loop) const { return loop == &uv_loop; }
+
     void answer(MegaTCPContext* tcpctx, const char *rsp, size_t rlen);
 
 
@@ -4875,6 +5225,7 @@ protected:
     virtual void processOnAsyncEventClose(MegaTCPContext* tcpctx);
     virtual bool respondNewConnection(MegaTCPContext* tcpctx) = 0; //returns true if server needs to start by reading
     virtual void processOnExitHandleClose(MegaTCPServer* tcpServer);
+    virtual void processOnClose(MegaTCPContext* tcpctx);
 
 public:
     const bool useIPv6;
@@ -4893,6 +5244,10 @@ public:
     void setMaxOutputSize(int outputSize);
     int getMaxBufferSize();
     int getMaxOutputSize();
+
+    // event loops serving the connections from the next start, at least one
+    void setLoopCount(unsigned count);
+    unsigned getLoopCount();
     void setRestrictedMode(int mode);
     int getRestrictedMode();
     bool isHandleAllowed(handle h);
@@ -4926,7 +5281,16 @@ public:
     size_t lastBufferLen;
     bool nodereceived;
     bool failed;
-    bool pause;
+
+    // node data to write (under mutex), and the data being written
+    std::shared_ptr<StreamingFeed> feed;
+    std::deque<StreamingSlice> slices;
+    size_t queuedBytes;
+    std::vector<StreamingSlice> writingSlices;
+
+    // the connection stays open for the next request, which may have arrived already
+    bool keepAlive;
+    std::string pipelined;
 
     // Request information
     bool range;
@@ -4963,8 +5327,10 @@ public:
     uv_mutex_t mutex_responses;
     std::list<std::string> responses;
 
+    // forget the request answered, for the next one on the connection
+    void resetRequest();
+
     virtual void onTransferStart(MegaApi *, MegaTransfer *transfer);
-    virtual bool onTransferData(MegaApi *, MegaTransfer *transfer, char *buffer, size_t size);
     virtual void onTransferFinish(MegaApi* api, MegaTransfer *transfer, MegaError *e);
     virtual void onRequestFinish(MegaApi* api, MegaRequest *request, MegaError *e);
 };
@@ -4978,6 +5344,17 @@ protected:
     bool folderServerEnabled;
     bool offlineAttribute;
     bool subtitlesSupportEnabled;
+    bool metricsEnabled;
+
+    // the node reads connections can follow, from any of the loops
+    std::list<std::weak_ptr<StreamingFeed>> feeds;
+    std::mutex feedsMutex;
+
+    // requests received while another is being answered, at most
+    static const size_t MAX_PIPELINED_SIZE = 65536;
+
+    // slices of node data written at once
+    static const unsigned MAX_WRITE_BUFFERS = 16;
 
     //virtual methods:
     virtual void processReceivedData(MegaTCPContext *ftpctx, ssize_t nread, const uv_buf_t * buf);
@@ -4987,6 +5364,7 @@ protected:
     virtual void processOnAsyncEventClose(MegaTCPContext* tcpctx);
     virtual bool respondNewConnection(MegaTCPContext* tcpctx);
     virtual void processOnExitHandleClose(MegaTCPServer* tcpServer);
+    virtual void processOnClose(MegaTCPContext* tcpctx);
 
 
     // HTTP parser callback
@@ -5002,6 +5380,17 @@ protected:
     static void sendNextBytes(MegaHTTPContext *httpctx);
     static int streamNode(MegaHTTPContext *httpctx);
 
+    // the data written last is no longer needed (under the context's mutex)
+    static void releaseWrittenData(MegaHTTPContext *httpctx);
+
+    // queue [start, start + len) of the node to the connection, from a read shared if possible
+    void followFeed(MegaHTTPContext *httpctx, m_off_t start, m_off_t len);
+    static void unfollowFeed(MegaHTTPContext *httpctx);
+
+    // the response is complete: go on with the next request
+    void processNextRequest(MegaHTTPContext *httpctx);
+    bool parsePipelined(MegaHTTPContext *httpctx);
+
     //Utility funcitons
     static std::string getHTTPMethodName(int httpmethod);
     static std::string getHTTPErrorString(int errorcode);
@@ -5033,6 +5422,8 @@ public:
     bool isFolderServerEnabled();
     void enableOfflineAttribute(bool enable);
     bool isOfflineAttributeEnabled();
+    void enableMetrics(bool enable);
+    bool isMetricsEnabled();
     bool isSubtitlesSupportEnabled();
     void enableSubtitlesSupport(bool enable);
 
@@ -5181,9 +5572,22 @@ protected:
     virtual void processOnAsyncEventClose(MegaTCPContext* tcpctx);
     virtual bool respondNewConnection(MegaTCPContext* tcpctx);
     virtual void processOnExitHandleClose(MegaTCPServer* tcpServer);
+    virtual void processOnClose(MegaTCPContext* tcpctx);
 
     void sendNextBytes(MegaFTPDataContext *ftpdatactx);
 
+#ifndef _WIN32
+    // Without TLS, a file whose complete content is in the FUSE cache is sent by the kernel
+    // straight from there, instead of being downloaded and copied through the streaming buffer.
+    bool sendCachedContent(MegaFTPDataContext *ftpdatactx, m_off_t start);
+    void sendCachedBytes(MegaFTPDataContext *ftpdatactx);
+    void finishCachedContent(MegaFTPDataContext *ftpdatactx);
+    static void onCachedSocketWritable(uv_poll_t* handle, int status, int events);
+
+    // bytes sent from the cache before the loop may go on with other connections
+    static const size_t MAX_CACHED_SEND = 4194304;
+#endif
+
 
 public:
     MegaFTPContext *controlftpctx;
@@ -5229,6 +5633,16 @@ public:
     std::unique_ptr<FileAccess> tmpFileAccess;
     size_t tmpFileSize;
 
+#ifndef _WIN32
+    // the cached file being sent, and the copy of the socket polled for room to send it
+    uv_file cachedFile;
+    int cachedSocket;
+    uv_poll_t *cachedSocketPoll;
+    m_off_t cachedOffset;
+
+    bool sendingCachedContent() const { return cachedFile >= 0; }
+#endif
+
     bool controlRespondedElsewhere;
     string controlResponseMessage;
     int controlResponseCode;
@@ -5571,12 +5985,16 @@ class MegaFuseExecutorFlagsPrivate
 public:
     MegaFuseExecutorFlagsPrivate(fuse::TaskExecutorFlags& flags);
 
+    size_t getDispatchThreadCount() const override;
+
     size_t getMinThreadCount() const override;
 
     size_t getMaxThreadCount() const override;
 
     size_t getMaxThreadIdleTime() const override;
 
+    bool setDispatchThreadCount(size_t count) override;
+
     bool setMaxThreadCount(size_t max) override;
 
     void setMinThreadCount(size_t min) override;
@@ -5584,13 +6002,38 @@ public:
     void setMaxThreadIdleTime(size_t max) override;
 }; // MegaFuseExecutorFlagsPrivate
 
+class MegaFuseFileCacheFlagsPrivate
+  : public MegaFuseFileCacheFlags
+{
+    fuse::FileCacheFlags& mFlags;
+    const fuse::FileCacheStatistics& mStatistics;
+
+public:
+    MegaFuseFileCacheFlagsPrivate(fuse::FileCacheFlags& flags,
+                                  const fuse::FileCacheStatistics& statistics);
+
+    size_t getCleanInterval() const override;
+
+    uint64_t getHits() const override;
+
+    uint64_t getMaxSize() const override;
+
+    uint64_t getMisses() const override;
+
+    void setCleanInterval(size_t seconds) override;
+
+    void setMaxSize(uint64_t size) override;
+}; // MegaFuseFileCacheFlagsPrivate
+
 class MegaFuseInodeCacheFlagsPrivate
   : public MegaFuseInodeCacheFlags
 {
     fuse::InodeCacheFlags& mFlags;
+    const fuse::InodeCacheStatistics& mStatistics;
 
 public:
-    explicit MegaFuseInodeCacheFlagsPrivate(fuse::InodeCacheFlags& flags);
+    MegaFuseInodeCacheFlagsPrivate(fuse::InodeCacheFlags& flags,
+                                   const fuse::InodeCacheStatistics& statistics);
 
     size_t getCleanAgeThreshold() const override;
 
@@ -5598,14 +6041,26 @@ public:
 
     size_t getCleanSizeThreshold() const override;
 
+    uint64_t getEvictions() const override;
+
+    uint64_t getHits() const override;
+
+    size_t getMaxMemory() const override;
+
     size_t getMaxSize() const override;
 
+    size_t getMemory() const override;
+
+    uint64_t getMisses() const override;
+
     void setCleanAgeThreshold(std::size_t seconds) override;
 
     void setCleanInterval(std::size_t seconds) override;
 
     void setCleanSizeThreshold(std::size_t size) override;
 
+    void setMaxMemory(size_t size) override;
+
     void setMaxSize(std::size_t size) override;
 }; // MegaFuseExecutorFlagsPrivate
 
@@ -5613,15 +6068,24 @@ class MegaFuseFlagsPrivate
   : public MegaFuseFlags
 {
     fuse::ServiceFlags mFlags;
+    fuse::FileCacheStatistics mFileCacheStatistics;
+    MegaFuseFileCacheFlagsPrivate mFileCacheFlags;
+    fuse::InodeCacheStatistics mInodeCacheStatistics;
     MegaFuseInodeCacheFlagsPrivate mInodeCacheFlags;
     MegaFuseExecutorFlagsPrivate mMountExecutorFlags;
     MegaFuseExecutorFlagsPrivate mSubsystemExecutorFlags;
+    fuse::OperationStatistics mOperationStatistics;
 
 public:
-    MegaFuseFlagsPrivate(const fuse::ServiceFlags& flags);
+    MegaFuseFlagsPrivate(const fuse::ServiceFlags& flags,
+                         const fuse::FileCacheStatistics& fileCacheStatistics = {},
+                         const fuse::InodeCacheStatistics& inodeCacheStatistics = {},
+                         const fuse::OperationStatistics& operationStatistics = {});
 
     MegaFuseFlags* copy() const override;
 
+    MegaFuseFileCacheFlags* getFileCacheFlags() override;
+
     const fuse::ServiceFlags& getFlags() const;
 
     size_t getFlushDelay() const override;
@@ -5632,6 +6096,11 @@ public:
 
     MegaFuseExecutorFlags* getMountExecutorFlags() override;
 
+    uint64_t getOperationCount(int operation) const override;
+
+    uint64_t getOperationLatency(int operation,
+                                 unsigned int percentile) const override;
+
     MegaFuseExecutorFlags* getSubsystemExecutorFlags() override;
 
     void setFlushDelay(size_t seconds) override;
@@ -5694,6 +6163,8 @@ public:
 
     const char* getName() const override;
 
+    bool getOffline() const override;
+
     bool getPersistent() const override;
 
     bool getReadOnly() const override;
@@ -5702,6 +6173,8 @@ public:
 
     void setName(const char* name) override;
 
+    void setOffline(bool offline) override;
+
     void setPersistent(bool persistent) override;
 
     void setReadOnly(bool readOnly) override;
@@ -138,64 +138,113 @@ TimerWithBackoff::TimerWithBackoff(PrnGen &rng, int tag)
 }
 
 
-void BackoffTimerGroupTracker::update(dstime* waituntil, bool transfers)
+static unsigned lowestBit(uint64_t bits)
 {
-    // This function performs a similar action as calling BackoffTimer::update for all the timers in the group,
-    // which is to say, the `waituntil` parameter will be updated with the soonest time that we would need to
-    // wake up from any of the timers in this group, should any of them be in a back-off state.
-    // There are also some side-effects specfic to transfers which are preserved from the old system.
+    unsigned i = 0;
+    for (; !(bits & 0xff); bits >>= 8) i += 8;
+    for (; !(bits & 1); bits >>= 1) ++i;
+    return i;
+}
 
-    vector<BackoffTimerTracked*> v;
-    v.reserve(timeouts.size());
+void BackoffTimerGroupTracker::advance(dstime now)
+{
+    if (now <= mNow)
+    {
+        return;
+    }
+
+    dstime old = mNow;
+    mNow = now;
 
-    if (transfers)
+    // From the top: a level's timers can only move to a lower level, or time out.
+    for (unsigned level = LEVELS; level--; )
     {
-        for (auto t : timeouts)
+        unsigned shift = level * SLOT_BITS;
+        if (!mOccupied[level] || (old >> shift) == (now >> shift))
         {
-            // put the ones to work on in a vector, as working on them changes their position in the map
-            if (t.first <= Waiter::ds)
-            {
-                v.push_back(t.second);
-            }
-            else
-            {
-                break;
-            }
+            continue;
         }
 
-        for (auto t : v)
+        // Its timers all share old's bits above the level. If now's differ, they've all timed
+        // out; otherwise those in the slots up to now's have, or need a lower level to be told
+        // apart from it.
+        uint64_t reached = mOccupied[level];
+        if (shift + SLOT_BITS >= 64 || (old >> (shift + SLOT_BITS)) == (now >> (shift + SLOT_BITS)))
         {
-            t->update(waituntil);
-            if (t->armed())
+            unsigned slot = static_cast<unsigned>((now >> shift) & (SLOTS - 1));
+            reached &= slot == SLOTS - 1 ? ~uint64_t(0) : (uint64_t(2) << slot) - 1;
+        }
+
+        while (reached)
+        {
+            unsigned slot = lowestBit(reached);
+            reached &= reached - 1;
+
+            int list = static_cast<int>(level * SLOTS + slot);
+            BackoffTimerTracked* bt = mLists[list];
+            mLists[list] = nullptr;
+            mOccupied[level] &= ~(uint64_t(1) << slot);
+
+            while (bt)
             {
-                // fire the timer only once but keeping it armed
-                t->set(0);
-                LOG_debug << "Disabling armed transfer backoff";
+                BackoffTimerTracked* next = bt->mNext;
+                link(bt, listFor(bt->mKey));
+                bt = next;
             }
         }
-
     }
-    else
+}
+
+dstime BackoffTimerGroupTracker::nextTimeout() const
+{
+    for (unsigned level = 0; level < LEVELS; ++level)
     {
-        // put the ones to work on in a vector, as working on them changes their position in the map
-        for (auto t : timeouts)
+        if (mOccupied[level])
         {
-            if (t.second->armed())
-            {
-                v.push_back(t.second);
-            }
-            if (t.first > Waiter::ds)
+            // a slot above level 0 holds a range of times, so its soonest is looked for
+            dstime soonest = NEVER;
+            for (auto bt = mLists[level * SLOTS + lowestBit(mOccupied[level])]; bt; bt = bt->mNext)
             {
-                break;
+                soonest = std::min(soonest, bt->mKey);
             }
+            return soonest;
         }
+    }
+    return NEVER;
+}
 
-        for (auto t : v)
+void BackoffTimerGroupTracker::update(dstime* waituntil, bool transfers)
+{
+    // This function performs a similar action as calling BackoffTimer::update for all the timers in the group,
+    // which is to say, the `waituntil` parameter will be updated with the soonest time that we would need to
+    // wake up from any of the timers in this group, should any of them be in a back-off state.
+    // There are also some side-effects specfic to transfers which are preserved from the old system.
+
+    advance(Waiter::ds);
+
+    // put the ones to work on in a vector, as working on them changes their position in the wheel
+    vector<BackoffTimerTracked*> v;
+    for (auto bt = mLists[EXPIRED]; bt; bt = bt->mNext)
+    {
+        v.push_back(bt);
+    }
+
+    for (auto t : v)
+    {
+        // update may set next=1 so we can't just call the first one.
+        t->update(waituntil);
+        if (transfers && t->armed())
         {
-            // update may set next=1 so we can't just call the first one.
-            t->update(waituntil);
+            // fire the timer only once but keeping it armed
+            t->set(0);
+            LOG_debug << "Disabling armed transfer backoff";
         }
+    }
 
+    dstime soonest = nextTimeout();
+    if (soonest < *waituntil)
+    {
+        *waituntil = soonest;
     }
 }
 
@@ -19,66 +19,206 @@
  * program.
  */
 
+#if defined(__SSSE3__) || defined(__AVX2__)
+#include <tmmintrin.h>
+#define MEGA_BASE64_SSSE3 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define MEGA_BASE64_NEON 1
+#endif
+
+#if defined(__clang__) || defined(__GNUC__)
+// the vector loads may read past the terminating NUL, but never past its page
+#define MEGA_BASE64_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#define MEGA_BASE64_NO_SANITIZE_ADDRESS
+#endif
+
 #include "mega/base64.h"
 #include "mega/utils.h"
 
 namespace mega {
-// modified base64 conversion (no trailing '=' and '-_' instead of '+/')
-unsigned char Base64::to64(byte c)
+
+namespace {
+
+constexpr char ALPHABET64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+struct Decoding64
 {
-    c &= 63;
+    byte values[256];
+};
 
-    if (c < 26)
+// both the modified and the standard alphabets are accepted; 255 for anything else
+constexpr Decoding64 makeDecoding64()
+{
+    Decoding64 d{};
+    for (int c = 0; c < 256; c++)
     {
-        return static_cast<unsigned char>(c + 'A');
+        d.values[c] = 255;
     }
-
-    if (c < 52)
+    for (int i = 0; i < 64; i++)
     {
-        return static_cast<unsigned char>(c - 26 + 'a');
+        d.values[static_cast<byte>(ALPHABET64[i])] = static_cast<byte>(i);
     }
+    d.values['+'] = 62;
+    d.values['/'] = 63;
+    return d;
+}
 
-    if (c < 62)
-    {
-        return static_cast<unsigned char>(c - 52 + '0');
-    }
+constexpr Decoding64 DECODING64 = makeDecoding64();
 
-    if (c == 62)
+#if defined(MEGA_BASE64_SSSE3) || defined(MEGA_BASE64_NEON)
+// whether `size` bytes can be loaded from `ptr` without crossing into the next page
+bool samePage(const char* ptr, uintptr_t size)
+{
+    return (reinterpret_cast<uintptr_t>(ptr) & 4095) <= 4096 - size;
+}
+#endif
+
+#if defined(MEGA_BASE64_SSSE3)
+// 16 characters into 12 bytes, storing 16; 12 bytes, loading 16, into 16 characters
+constexpr int DECODE_CHARS = 16, DECODE_BYTES = 12, DECODE_STORED = 16;
+constexpr int ENCODE_BYTES = 12, ENCODE_LOADED = 16, ENCODE_CHARS = 16;
+
+// decodes 16 characters at once, false if any of them isn't base64
+bool decodeBlock(const char* a, byte* b)
+{
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+
+    const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)),
+                                        _mm_cmplt_epi8(c, _mm_set1_epi8('Z' + 1)));
+    const __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)),
+                                        _mm_cmplt_epi8(c, _mm_set1_epi8('z' + 1)));
+    const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                        _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+    const __m128i s62 = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('-')),
+                                     _mm_cmpeq_epi8(c, _mm_set1_epi8('+')));
+    const __m128i s63 = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('_')),
+                                     _mm_cmpeq_epi8(c, _mm_set1_epi8('/')));
+
+    const __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                                       _mm_or_si128(digit, _mm_or_si128(s62, s63)));
+    if (_mm_movemask_epi8(valid) != 0xFFFF)
     {
-        return '-';
+        return false;
     }
 
-    return '_';
+    // each class is an offset from the character, the special ones are set directly
+    __m128i v = _mm_add_epi8(c, _mm_or_si128(_mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')),
+                                                          _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+                                             _mm_and_si128(digit, _mm_set1_epi8(52 - '0'))));
+    v = _mm_or_si128(_mm_andnot_si128(_mm_or_si128(s62, s63), v),
+                     _mm_or_si128(_mm_and_si128(s62, _mm_set1_epi8(62)),
+                                  _mm_and_si128(s63, _mm_set1_epi8(63))));
+
+    // pack the 6-bit values: pairs into 12 bits, then into 24 bits, then the bytes in order
+    const __m128i pairs = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+    const __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    const __m128i bytes = _mm_shuffle_epi8(groups, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+                                                                 14, 13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(b), bytes);
+    return true;
 }
 
-unsigned char Base64::from64(byte c)
+// encodes the first 12 of 16 bytes into 16 characters
+void encodeBlock(const byte* b, char* a)
 {
-    if ((c >= 'A') && (c <= 'Z'))
-    {
-        return static_cast<unsigned char>(c - 'A');
-    }
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+
+    // every 32-bit lane gets the 3 bytes of a group, then its four 6-bit values
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i hi = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+                                       _mm_set1_epi32(0x04000040));
+    const __m128i lo = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+                                       _mm_set1_epi32(0x01000010));
+    const __m128i indices = _mm_or_si128(hi, lo);
+
+    // offset from each value to its character, selected by range
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices),
+                                              _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '-' - 62, '_' - 63, 'A', 0, 0);
+    const __m128i chars = _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(a), chars);
+}
+#elif defined(MEGA_BASE64_NEON)
+// 64 characters into 48 bytes; 48 bytes into 64 characters
+constexpr int DECODE_CHARS = 64, DECODE_BYTES = 48, DECODE_STORED = 48;
+constexpr int ENCODE_BYTES = 48, ENCODE_LOADED = 48, ENCODE_CHARS = 64;
 
-    if ((c >= 'a') && (c <= 'z'))
-    {
-        return static_cast<unsigned char>(c - 'a' + 26);
-    }
+uint8x16x4_t loadTable(const byte* t)
+{
+    uint8x16x4_t table;
+    table.val[0] = vld1q_u8(t);
+    table.val[1] = vld1q_u8(t + 16);
+    table.val[2] = vld1q_u8(t + 32);
+    table.val[3] = vld1q_u8(t + 48);
+    return table;
+}
 
-    if ((c >= '0') && (c <= '9'))
+// decodes 64 characters at once, false if any of them isn't base64
+bool decodeBlock(const char* a, byte* b)
+{
+    const uint8x16x4_t low = loadTable(DECODING64.values);
+    const uint8x16x4_t high = loadTable(DECODING64.values + 64);
+    const uint8x16_t offset = vdupq_n_u8(64);
+    const uint8x16_t ascii = vdupq_n_u8(128);
+
+    uint8x16x4_t v = vld4q_u8(reinterpret_cast<const uint8_t*>(a));
+    uint8x16_t invalid = vdupq_n_u8(0);
+    for (int i = 0; i < 4; i++)
     {
-        return static_cast<unsigned char>(c - '0' + 52);
+        const uint8x16_t c = v.val[i];
+        v.val[i] = vqtbx4q_u8(vqtbl4q_u8(low, c), high, vsubq_u8(c, offset));
+        invalid = vorrq_u8(invalid, vorrq_u8(vcgeq_u8(c, ascii),
+                                              vceqq_u8(v.val[i], vdupq_n_u8(255))));
     }
-
-    if (c == '-' || c == '+')
+    if (vmaxvq_u8(invalid))
     {
-        return static_cast<unsigned char>(62);
+        return false;
     }
 
-    if (c == '_' || c == '/')
+    uint8x16x3_t out;
+    out.val[0] = vorrq_u8(vshlq_n_u8(v.val[0], 2), vshrq_n_u8(v.val[1], 4));
+    out.val[1] = vorrq_u8(vshlq_n_u8(v.val[1], 4), vshrq_n_u8(v.val[2], 2));
+    out.val[2] = vorrq_u8(vshlq_n_u8(v.val[2], 6), v.val[3]);
+    vst3q_u8(b, out);
+    return true;
+}
+
+// encodes 48 bytes into 64 characters
+void encodeBlock(const byte* b, char* a)
+{
+    const uint8x16x4_t alphabet = loadTable(reinterpret_cast<const byte*>(ALPHABET64));
+    const uint8x16_t mask = vdupq_n_u8(63);
+
+    const uint8x16x3_t in = vld3q_u8(b);
+    uint8x16x4_t out;
+    out.val[0] = vshrq_n_u8(in.val[0], 2);
+    out.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[0], 4), vshrq_n_u8(in.val[1], 4)), mask);
+    out.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[1], 2), vshrq_n_u8(in.val[2], 6)), mask);
+    out.val[3] = vandq_u8(in.val[2], mask);
+    for (int i = 0; i < 4; i++)
     {
-        return static_cast<unsigned char>(63);
+        out.val[i] = vqtbl4q_u8(alphabet, out.val[i]);
     }
+    vst4q_u8(reinterpret_cast<uint8_t*>(a), out);
+}
+#endif
+
+} // namespace
+
+// modified base64 conversion (no trailing '=' and '-_' instead of '+/')
+unsigned char Base64::to64(byte c)
+{
+    return static_cast<unsigned char>(ALPHABET64[c & 63]);
+}
 
-    return static_cast<unsigned char>(255);
+unsigned char Base64::from64(byte c)
+{
+    return DECODING64.values[c];
 }
 
 
@@ -99,11 +239,40 @@ std::string Base64::atob(const std::string &in)
     return out;
 }
 
+MEGA_BASE64_NO_SANITIZE_ADDRESS
 int Base64::atob(const char* a, byte* b, int blen)
 {
+    int p = 0;
+
+#if defined(MEGA_BASE64_SSSE3) || defined(MEGA_BASE64_NEON)
+    while (blen - p >= DECODE_STORED && samePage(a, DECODE_CHARS) && decodeBlock(a, b + p))
+    {
+        a += DECODE_CHARS;
+        p += DECODE_BYTES;
+    }
+#endif
+
+    // whole groups of 4 characters, each one checked before the next is read
+    while (blen - p >= 3)
+    {
+        const byte c0 = from64(static_cast<byte>(a[0]));
+        if (c0 == 255) break;
+        const byte c1 = from64(static_cast<byte>(a[1]));
+        if (c1 == 255) break;
+        const byte c2 = from64(static_cast<byte>(a[2]));
+        if (c2 == 255) break;
+        const byte c3 = from64(static_cast<byte>(a[3]));
+        if (c3 == 255) break;
+
+        b[p++] = static_cast<byte>((c0 << 2) | (c1 >> 4));
+        b[p++] = static_cast<byte>((c1 << 4) | (c2 >> 2));
+        b[p++] = static_cast<byte>((c2 << 6) | c3);
+        a += 4;
+    }
+
+    // the last group, which may be incomplete or not fit
     byte c[4]={};
     int i;
-    int p = 0;
 
     for (;;)
     {
@@ -138,6 +307,35 @@ int Base64::atob(const char* a, byte* b, int blen)
     }
 }
 
+bool Base64::atob(const char* a, handle& h, int size)
+{
+    assert(size > 0 && size <= int(sizeof h));
+
+    // one more byte, so that longer strings are detected
+    byte buf[sizeof h + 1] = {};
+    if (atob(a, buf, sizeof buf) != size)
+    {
+        return false;
+    }
+
+    h = 0;
+    memcpy(&h, buf, static_cast<size_t>(size));
+    return true;
+}
+
+bool Base64::atob(const char* a, NodeHandle& h)
+{
+    // node handles are 6 bytes
+    handle nh;
+    if (!atob(a, nh, 6))
+    {
+        return false;
+    }
+
+    h.set6byte(nh);
+    return true;
+}
+
 void Base64::itoa(int64_t val, string *result)
 {
     byte c;
@@ -225,6 +423,27 @@ int Base64::btoa(const byte* b, int blen, char* a)
 {
     int p = 0;
 
+#if defined(MEGA_BASE64_SSSE3) || defined(MEGA_BASE64_NEON)
+    while (blen >= ENCODE_LOADED)
+    {
+        encodeBlock(b, a + p);
+        b += ENCODE_BYTES;
+        blen -= ENCODE_BYTES;
+        p += ENCODE_CHARS;
+    }
+#endif
+
+    // whole groups of 3 bytes
+    while (blen >= 3)
+    {
+        a[p++] = static_cast<char>(to64(static_cast<byte>(b[0] >> 2)));
+        a[p++] = static_cast<char>(to64(static_cast<byte>((b[0] << 4) | (b[1] >> 4))));
+        a[p++] = static_cast<char>(to64(static_cast<byte>((b[1] << 2) | (b[2] >> 6))));
+        a[p++] = static_cast<char>(to64(b[2]));
+        blen -= 3;
+        b += 3;
+    }
+
     for (;;)
     {
         if (blen <= 0)
@@ -276,6 +276,11 @@ void Command::arg(const char* name, const char* value, int quotes)
     jsonWriter.arg(name, value, quotes);
 }
 
+void Command::arg(const char* name, std::string_view value, int quotes)
+{
+    jsonWriter.arg(name, value, quotes);
+}
+
 // binary data
 void Command::arg(const char* name, const byte* value, int len)
 {
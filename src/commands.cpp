@@ -215,6 +215,9 @@ CommandGetFA::CommandGetFA(MegaClient *client, int p, handle fahref)
     cmd("ufa");
     arg("fah", (byte*)&fahref, sizeof fahref);
 
+    // only looks up the URL of a file attribute server
+    mIndependent = true;
+
     if (client->usehttps)
     {
         arg("ssl", 2);
@@ -491,6 +494,11 @@ bool CommandPutFile::procresult(Result r, JSON& json)
                         LOG_err << "Unpaired IPs received for URLs in `u` command. URLs: " << tempurls.size() << " IPs: " << tempips.size();
                     }
 
+                    if (client->mPrewarmStorageConnections)
+                    {
+                        client->prewarmStorageConnections(tempurls, PUT);
+                    }
+
                     tslot->transfer->tempurls = tempurls;
                     tslot->transferbuf.setIsRaid(tslot->transfer, tempurls, tslot->transfer->pos, tslot->maxRequestSize);
                     tslot->starttime = tslot->lastdata = client->waiter->ds;
@@ -735,6 +743,9 @@ CommandGetFile::CommandGetFile(MegaClient *client, const byte* key, size_t keySi
 {
     cmd(undelete ? "gd" : "g");
     arg(p ? "n" : "p", (byte*)&h, MegaClient::NODEHANDLE);
+
+    // download URLs don't have to wait for the batch in flight
+    mIndependent = true;
     arg("g", 1); // server will provide download URL(s)/token(s) (if skipped, only information about the file)
     if (!singleUrl)
     {
@@ -887,6 +898,11 @@ bool CommandGetFile::procresult(Result r, JSON& json)
                     {
                         LOG_err << "Unpaired IPs received for URLs in `g` command. URLs: " << tempurls.size() << " IPs: " << tempips.size();
                     }
+
+                    if (!canceled && client->mPrewarmStorageConnections)
+                    {
+                        client->prewarmStorageConnections(tempurls, GET);
+                    }
                 });
 
                 if (canceled) //do not proceed: SymmCipher may no longer exist
@@ -1268,9 +1284,9 @@ CommandPutNodes::CommandPutNodes(MegaClient* client,
 }
 
 // add new nodes and handle->node handle mapping
-void CommandPutNodes::removePendingDBRecordsAndTempFiles()
+void CommandPutNodes::removePendingDBRecordsAndTempFiles(int uploadTag)
 {
-    pendingdbid_map::iterator it = client->pendingtcids.find(tag);
+    pendingdbid_map::iterator it = client->pendingtcids.find(uploadTag);
     if (it != client->pendingtcids.end())
     {
         if (client->tctable)
@@ -1287,7 +1303,7 @@ void CommandPutNodes::removePendingDBRecordsAndTempFiles()
         }
         client->pendingtcids.erase(it);
     }
-    pendingfiles_map::iterator pit = client->pendingfiles.find(tag);
+    pendingfiles_map::iterator pit = client->pendingfiles.find(uploadTag);
     if (pit != client->pendingfiles.end())
     {
         vector<LocalPath> &pfs = pit->second;
@@ -1304,6 +1320,15 @@ void CommandPutNodes::performAppCallback(Error e,
                                          bool targetOverride,
                                          const map<string, string>& fileHandles)
 {
+    for (auto& n : newnodes)
+    {
+        if (!n.uploadhandle.isUndef())
+        {
+            client->lateFileAttributesTarget(n.uploadhandle,
+                                             n.added ? NodeHandle().set6byte(n.mAddedHandle) : NodeHandle());
+        }
+    }
+
     if (mResultFunction)
         mResultFunction(e, type, newnodes, targetOverride, tag, fileHandles);
     else
@@ -1312,7 +1337,11 @@ void CommandPutNodes::performAppCallback(Error e,
 
 bool CommandPutNodes::procresult(Result r, JSON& json)
 {
-    removePendingDBRecordsAndTempFiles();
+    removePendingDBRecordsAndTempFiles(tag);
+    for (int batchedTag : mBatchedTags)
+    {
+        removePendingDBRecordsAndTempFiles(batchedTag);
+    }
 
     if (r.wasErrorOrOK())
     {
@@ -1513,7 +1542,7 @@ CommandMoveNode::CommandMoveNode(MegaClient* client, std::shared_ptr<Node> n, st
     assert(t->type != FILENODE);
 
     TreeProcShareKeys tpsk(t, true);
-    client->proctree(n, &tpsk);
+    client->proctreeInBatches(n, &tpsk);
     tpsk.get(this);
 
     tag = client->reqtag;
@@ -2114,7 +2143,7 @@ CommandSetShare::CommandSetShare(MegaClient* client, std::shared_ptr<Node> n, Us
     {
         // the new share's nodekeys for this user: generate node list
         TreeProcShareKeys tpsk(n, false);
-        client->proctree(n, &tpsk);
+        client->proctreeInBatches(n, &tpsk);
         tpsk.get(this);
     }
 }
@@ -3936,6 +3965,9 @@ CommandNodeKeyUpdate::CommandNodeKeyUpdate(MegaClient* client, handle_vector* v)
 {
     byte nodekey[FILENODEKEYLENGTH];
 
+    // rewrites keys already usable, nothing else waits for it
+    mBulk = true;
+
     cmd("k");
     beginarray("nk");
 
@@ -6035,35 +6067,86 @@ CommandGetUserSessions::CommandGetUserSessions(MegaClient* client, std::shared_p
     arg("x", 1); // Request the additional id and alive information
     arg("d", 1); // Request the additional device-id
 
+    // accounts used from many devices can have long lists of sessions, parse them as they arrive
+    batchSeparately = true;
+
     details = ad;
     tag = client->reqtag;
+
+    // Parsing started
+    mFilters.emplace("", [this](JSON*)
+    {
+        details->sessions.clear();
+        return true;
+    });
+
+    // Each session
+    mFilters.emplace("[[", [this](JSON* json)
+    {
+        return json->enterarray() && readSession(*json);
+    });
+
+    // End of the list: only its closing bracket is left, or the whole list if it was empty
+    mFilters.emplace("[", [this](JSON* json)
+    {
+        json->enterarray();
+        if (!json->leavearray())
+        {
+            return false;
+        }
+
+        this->client->app->account_details(details.get(), false, false, false, false, false, true);
+        return true;
+    });
+
+    // Numeric error, either a number or an error object {"err":XXX}
+    mFilters.emplace("#", [this](JSON* json)
+    {
+        Error e;
+        checkError(e, *json);
+
+        JSON empty("");
+        return procresult(Result(CmdError, e), empty);
+    });
+
+    // Parsing error
+    mFilters.emplace("E", [this](JSON*)
+    {
+        this->client->app->account_details(details.get(), API_EINTERNAL);
+        return true;
+    });
 }
 
-bool CommandGetUserSessions::procresult(Result, JSON& json)
+bool CommandGetUserSessions::readSession(JSON& json)
 {
-    details->sessions.clear();
+    size_t t = details->sessions.size();
+    details->sessions.resize(t + 1);
 
-    while (json.enterarray())
-    {
-        size_t t = details->sessions.size();
-        details->sessions.resize(t + 1);
+    details->sessions[t].timestamp = json.getint();
+    details->sessions[t].mru = json.getint();
+    json.storeobject(&details->sessions[t].useragent);
+    json.storeobject(&details->sessions[t].ip);
 
-        details->sessions[t].timestamp = json.getint();
-        details->sessions[t].mru = json.getint();
-        json.storeobject(&details->sessions[t].useragent);
-        json.storeobject(&details->sessions[t].ip);
+    const char* country = json.getvalue();
+    memcpy(details->sessions[t].country, country ? country : "\0\0", 2);
+    details->sessions[t].country[2] = 0;
 
-        const char* country = json.getvalue();
-        memcpy(details->sessions[t].country, country ? country : "\0\0", 2);
-        details->sessions[t].country[2] = 0;
+    details->sessions[t].current = (int)json.getint();
 
-        details->sessions[t].current = (int)json.getint();
+    details->sessions[t].id = json.gethandle(8);
+    details->sessions[t].alive = (int)json.getint();
+    json.storeobject(&details->sessions[t].deviceid);
 
-        details->sessions[t].id = json.gethandle(8);
-        details->sessions[t].alive = (int)json.getint();
-        json.storeobject(&details->sessions[t].deviceid);
+    return json.leavearray();
+}
 
-        if (!json.leavearray())
+bool CommandGetUserSessions::procresult(Result, JSON& json)
+{
+    details->sessions.clear();
+
+    while (json.enterarray())
+    {
+        if (!readSession(json))
         {
             client->app->account_details(details.get(), API_EINTERNAL);
             return false;
@@ -6702,8 +6785,10 @@ CommandFetchNodes::CommandFetchNodes(MegaClient* client,
         arg("ca", 1);
     }
 
-    if (client->isClientType(MegaClient::ClientType::PASSWORD_MANAGER))
+    // only the subtree below it (the Password Manager Base, for now)
+    if (!partialFetchRoot.isUndef())
     {
+        assert(client->isClientType(MegaClient::ClientType::PASSWORD_MANAGER));
         arg("n", partialFetchRoot);
         arg("part", 1);
     }
@@ -6749,6 +6834,8 @@ CommandFetchNodes::CommandFetchNodes(MegaClient* client,
                 client->pendingsccommit = false;
             }
 
+            client->mNodeManager.startBulkLoad();
+
             mFirstChunkProcessed = true;
         }
         else
@@ -6788,6 +6875,7 @@ CommandFetchNodes::CommandFetchNodes(MegaClient* client,
     // End of node array
     f = mFilters.emplace("{[f", [this, client](JSON *json)
     {
+        client->mNodeManager.flushDecodingQueue();
         client->mergenewshares(0);
         client->mNodeManager.checkOrphanNodes(mMissingParentNodes);
 
@@ -7051,6 +7139,8 @@ bool CommandFetchNodes::procresult(Result r, JSON& json)
         client->pendingsccommit = false;
     }
 
+    client->mNodeManager.startBulkLoad();
+
     for (;;)
     {
         switch (json.getnameid())
@@ -19,6 +19,39 @@
  * program.
  */
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#define MEGA_AES_NI 1
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define MEGA_AES_ARMV8 1
+#endif
+
+#if defined(MEGA_AES_NI) && (defined(__GNUC__) || defined(__clang__))
+// only these functions are built for AES-NI, the CPU is checked before calling them
+#define MEGA_AES_TARGET __attribute__((target("aes,sse2")))
+#else
+#define MEGA_AES_TARGET
+#endif
+
+#if defined(MEGA_AES_NI) && (defined(__GNUC__) || defined(__clang__))
+#define MEGA_CRC_TARGET __attribute__((target("pclmul,sse4.1")))
+#else
+#define MEGA_CRC_TARGET
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define MEGA_CRC_ARMV8 1
+#endif
+
 #include "mega.h"
 
 namespace mega {
@@ -56,6 +89,239 @@ std::string PrnGen::genstring(const size_t len)
     return result;
 }
 
+namespace {
+
+constexpr byte AES_SBOX[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+// FIPS-197 AES-128 key schedule, 11 round keys of 16 bytes
+void expandAes128Key(const byte* key, byte* roundkeys)
+{
+    static const byte rcon[10] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+
+    memcpy(roundkeys, key, 16);
+
+    for (int i = 4; i < 44; i++)
+    {
+        const byte* prev = roundkeys + 4 * (i - 1);
+        byte t[4] = { prev[0], prev[1], prev[2], prev[3] };
+
+        if (!(i % 4))
+        {
+            byte first = t[0];
+            t[0] = static_cast<byte>(AES_SBOX[t[1]] ^ rcon[i / 4 - 1]);
+            t[1] = AES_SBOX[t[2]];
+            t[2] = AES_SBOX[t[3]];
+            t[3] = AES_SBOX[first];
+        }
+
+        for (int j = 0; j < 4; j++)
+        {
+            roundkeys[4 * i + j] = static_cast<byte>(roundkeys[4 * (i - 4) + j] ^ t[j]);
+        }
+    }
+}
+
+bool hasAesInstructions()
+{
+#if defined(MEGA_AES_NI) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 25)) && (info[3] & (1 << 26));
+#elif defined(MEGA_AES_NI)
+    unsigned a, b, c, d;
+    return __get_cpuid(1, &a, &b, &c, &d) && (c & bit_AES) && (d & bit_SSE2);
+#elif defined(MEGA_AES_ARMV8)
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if defined(MEGA_AES_NI)
+
+MEGA_AES_TARGET inline __m128i loadBlock(const byte* p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+MEGA_AES_TARGET inline void storeBlock(byte* p, __m128i b)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), b);
+}
+
+MEGA_AES_TARGET inline __m128i encryptBlock(__m128i b, const __m128i* rk)
+{
+    b = _mm_xor_si128(b, rk[0]);
+    for (int r = 1; r < 10; r++)
+    {
+        b = _mm_aesenc_si128(b, rk[r]);
+    }
+    return _mm_aesenclast_si128(b, rk[10]);
+}
+
+// CTR over whole blocks fused with the chunk MAC (CBC-MAC over the plaintext). The MAC is a serial
+// dependency chain, so each of its blocks is run through the rounds together with the keystream
+// of the next block; without a MAC four counters are kept in flight.
+MEGA_AES_TARGET void ctrMacBlocks(const byte* roundkeys, byte* data, size_t blocks, byte* ctr, byte* mac, bool encrypt)
+{
+    __m128i rk[11];
+    for (int r = 0; r < 11; r++)
+    {
+        rk[r] = loadBlock(roundkeys + 16 * r);
+    }
+
+    if (!mac)
+    {
+        for (; blocks >= 4; blocks -= 4, data += 64)
+        {
+            __m128i b[4];
+            for (int j = 0; j < 4; j++)
+            {
+                b[j] = _mm_xor_si128(loadBlock(ctr), rk[0]);
+                SymmCipher::incblock(ctr);
+            }
+            for (int r = 1; r < 10; r++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    b[j] = _mm_aesenc_si128(b[j], rk[r]);
+                }
+            }
+            for (int j = 0; j < 4; j++)
+            {
+                storeBlock(data + 16 * j, _mm_xor_si128(loadBlock(data + 16 * j), _mm_aesenclast_si128(b[j], rk[10])));
+            }
+        }
+
+        for (; blocks; blocks--, data += 16)
+        {
+            storeBlock(data, _mm_xor_si128(loadBlock(data), encryptBlock(loadBlock(ctr), rk)));
+            SymmCipher::incblock(ctr);
+        }
+        return;
+    }
+
+    __m128i m = loadBlock(mac);
+    __m128i ks = encryptBlock(loadBlock(ctr), rk);
+
+    for (; blocks; blocks--, data += 16)
+    {
+        __m128i in = loadBlock(data);
+        __m128i out = _mm_xor_si128(in, ks);
+        storeBlock(data, out);
+
+        SymmCipher::incblock(ctr);
+        __m128i c = _mm_xor_si128(loadBlock(ctr), rk[0]);
+        m = _mm_xor_si128(_mm_xor_si128(m, encrypt ? in : out), rk[0]);
+        for (int r = 1; r < 10; r++)
+        {
+            m = _mm_aesenc_si128(m, rk[r]);
+            c = _mm_aesenc_si128(c, rk[r]);
+        }
+        m = _mm_aesenclast_si128(m, rk[10]);
+        ks = _mm_aesenclast_si128(c, rk[10]);
+    }
+
+    storeBlock(mac, m);
+}
+
+#elif defined(MEGA_AES_ARMV8)
+
+inline uint8x16_t encryptBlock(uint8x16_t b, const uint8x16_t* rk)
+{
+    for (int r = 0; r < 9; r++)
+    {
+        b = vaesmcq_u8(vaeseq_u8(b, rk[r]));
+    }
+    return veorq_u8(vaeseq_u8(b, rk[9]), rk[10]);
+}
+
+// same scheduling as the AES-NI version
+void ctrMacBlocks(const byte* roundkeys, byte* data, size_t blocks, byte* ctr, byte* mac, bool encrypt)
+{
+    uint8x16_t rk[11];
+    for (int r = 0; r < 11; r++)
+    {
+        rk[r] = vld1q_u8(roundkeys + 16 * r);
+    }
+
+    if (!mac)
+    {
+        for (; blocks >= 4; blocks -= 4, data += 64)
+        {
+            uint8x16_t b[4];
+            for (int j = 0; j < 4; j++)
+            {
+                b[j] = vld1q_u8(ctr);
+                SymmCipher::incblock(ctr);
+            }
+            for (int r = 0; r < 9; r++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    b[j] = vaesmcq_u8(vaeseq_u8(b[j], rk[r]));
+                }
+            }
+            for (int j = 0; j < 4; j++)
+            {
+                uint8x16_t ks = veorq_u8(vaeseq_u8(b[j], rk[9]), rk[10]);
+                vst1q_u8(data + 16 * j, veorq_u8(vld1q_u8(data + 16 * j), ks));
+            }
+        }
+
+        for (; blocks; blocks--, data += 16)
+        {
+            vst1q_u8(data, veorq_u8(vld1q_u8(data), encryptBlock(vld1q_u8(ctr), rk)));
+            SymmCipher::incblock(ctr);
+        }
+        return;
+    }
+
+    uint8x16_t m = vld1q_u8(mac);
+    uint8x16_t ks = encryptBlock(vld1q_u8(ctr), rk);
+
+    for (; blocks; blocks--, data += 16)
+    {
+        uint8x16_t in = vld1q_u8(data);
+        uint8x16_t out = veorq_u8(in, ks);
+        vst1q_u8(data, out);
+
+        SymmCipher::incblock(ctr);
+        uint8x16_t c = vld1q_u8(ctr);
+        m = veorq_u8(m, encrypt ? in : out);
+        for (int r = 0; r < 9; r++)
+        {
+            m = vaesmcq_u8(vaeseq_u8(m, rk[r]));
+            c = vaesmcq_u8(vaeseq_u8(c, rk[r]));
+        }
+        m = veorq_u8(vaeseq_u8(m, rk[9]), rk[10]);
+        ks = veorq_u8(vaeseq_u8(c, rk[9]), rk[10]);
+    }
+
+    vst1q_u8(mac, m);
+}
+
+#endif
+
+} // namespace
+
 SymmCipher::SymmCipher(const byte* key)
 {
     setkey(key);
@@ -72,6 +338,8 @@ void SymmCipher::setkey(const byte* newkey, int type)
         xorblock(newkey + KEYLENGTH, key);
     }
 
+    expandAes128Key(key, roundkeys);
+
     aesecb_e.SetKey(key, KEYLENGTH);
     aesecb_d.SetKey(key, KEYLENGTH);
 
@@ -100,6 +368,41 @@ bool SymmCipher::setkey(const string* key)
     return false;
 }
 
+SymmCipher* SymmCipherCache::get(const byte* key, int type)
+{
+    byte effectiveKey[SymmCipher::KEYLENGTH];
+    memcpy(effectiveKey, key, sizeof(effectiveKey));
+    if (!type)
+    {
+        SymmCipher::xorblock(key + SymmCipher::KEYLENGTH, effectiveKey);
+    }
+
+    Entry* lru = &mEntries[0];
+    for (Entry& e : mEntries)
+    {
+        if (e.lastUse && !memcmp(e.cipher.key, effectiveKey, sizeof(effectiveKey)))
+        {
+            e.lastUse = ++mUses;
+            return &e.cipher;
+        }
+
+        if (e.lastUse < lru->lastUse)
+        {
+            lru = &e;
+        }
+    }
+
+    lru->cipher.setkey(effectiveKey);
+    lru->lastUse = ++mUses;
+    return &lru->cipher;
+}
+
+SymmCipherCache& SymmCipherCache::local()
+{
+    thread_local SymmCipherCache cache;
+    return cache;
+}
+
 bool SymmCipher::cbc_encrypt_with_key(const std::string& plain, std::string& cipher, const byte* key, const size_t keylen, const byte* iv)
 {
     try
@@ -704,6 +1007,19 @@ void SymmCipher::ctr_crypt(byte* data, unsigned len, m_off_t pos, ctr_iv ctriv,
         memcpy(mac + sizeof ctriv, ctr, sizeof ctriv);
     }
 
+#if defined(MEGA_AES_NI) || defined(MEGA_AES_ARMV8)
+    static const bool aesInstructions = hasAesInstructions();
+
+    // whole blocks go through the fused kernel, a trailing partial block through the loop below
+    if (aesInstructions && len >= (unsigned)BLOCKSIZE)
+    {
+        unsigned blocks = len / BLOCKSIZE;
+        ctrMacBlocks(roundkeys, data, blocks, ctr, mac, encrypt);
+        data += blocks * BLOCKSIZE;
+        len -= blocks * BLOCKSIZE;
+    }
+#endif
+
     while ((int)len > 0)
     {
         if (encrypt)
@@ -1131,14 +1447,195 @@ void HashSHA256::get(std::string *retStr)
     hash.Final((byte*)retStr->data());
 }
 
+namespace {
+
+// CRC-32 (IEEE 802.3, reflected), a table lookup per byte
+struct Crc32Table
+{
+    uint32_t entries[256];
+
+    constexpr Crc32Table() : entries()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+constexpr Crc32Table CRC32_TABLE;
+
+uint32_t crc32Bytes(uint32_t crc, const byte* data, size_t len)
+{
+    while (len--)
+    {
+        crc = CRC32_TABLE.entries[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(MEGA_AES_NI)
+
+bool hasClmulInstructions()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 1)) && (info[2] & (1 << 19));
+#else
+    unsigned a, b, c, d;
+    return __get_cpuid(1, &a, &b, &c, &d) && (c & bit_PCLMUL) && (c & bit_SSE4_1);
+#endif
+}
+
+MEGA_CRC_TARGET inline __m128i crcLoad(const byte* p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// x times the two folding constants in k (one per half), plus next
+MEGA_CRC_TARGET inline __m128i crcFold(__m128i x, __m128i k, __m128i next)
+{
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), _mm_clmulepi64_si128(x, k, 0x00)), next);
+}
+
+// Folds 64 bytes at a time with carry-less multiplications, then Barrett-reduces to 32 bits
+// (Gopal et al., "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction").
+// len is at least 64 and a multiple of 16
+MEGA_CRC_TARGET uint32_t crc32Clmul(uint32_t crc, const byte* data, size_t len)
+{
+    alignas(16) static const uint64_t k1k2[] = { 0x0154442bd4, 0x01c6e41596 };
+    alignas(16) static const uint64_t k3k4[] = { 0x01751997d0, 0x00ccaa009e };
+    alignas(16) static const uint64_t k5k0[] = { 0x0163cd6124, 0x0000000000 };
+    alignas(16) static const uint64_t poly[] = { 0x01db710641, 0x01f7011641 };
+
+    __m128i x1 = _mm_xor_si128(crcLoad(data), _mm_cvtsi32_si128(static_cast<int>(crc)));
+    __m128i x2 = crcLoad(data + 16);
+    __m128i x3 = crcLoad(data + 32);
+    __m128i x4 = crcLoad(data + 48);
+    data += 64;
+    len -= 64;
+
+    __m128i k = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+    for (; len >= 64; data += 64, len -= 64)
+    {
+        x1 = crcFold(x1, k, crcLoad(data));
+        x2 = crcFold(x2, k, crcLoad(data + 16));
+        x3 = crcFold(x3, k, crcLoad(data + 32));
+        x4 = crcFold(x4, k, crcLoad(data + 48));
+    }
+
+    k = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+    x1 = crcFold(crcFold(crcFold(x1, k, x2), k, x3), k, x4);
+    for (; len >= 16; data += 16, len -= 16)
+    {
+        x1 = crcFold(x1, k, crcLoad(data));
+    }
+
+    // 128 to 64 bits
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), _mm_clmulepi64_si128(x1, k, 0x10));
+
+    k = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x00), _mm_srli_si128(x1, 4));
+
+    // Barrett reduction to 32 bits
+    k = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+    __m128i t = _mm_and_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x10), mask32);
+    x1 = _mm_xor_si128(x1, _mm_clmulepi64_si128(t, k, 0x00));
+
+    return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+#elif defined(MEGA_CRC_ARMV8)
+
+uint32_t crc32Armv8(uint32_t crc, const byte* data, size_t len)
+{
+    for (; len >= 8; data += 8, len -= 8)
+    {
+        uint64_t v;
+        memcpy(&v, data, sizeof(v));
+        crc = __crc32d(crc, v);
+    }
+
+    while (len--)
+    {
+        crc = __crc32b(crc, *data++);
+    }
+    return crc;
+}
+
+#endif
+
+} // namespace
+
 void HashCRC32::add(const byte* data, unsigned len)
 {
-    hash.Update(data, len);
+#if defined(MEGA_AES_NI)
+    static const bool clmul = hasClmulInstructions();
+    if (clmul && len >= 64)
+    {
+        unsigned bulk = len & ~15u;
+        mCrc = crc32Clmul(mCrc, data, bulk);
+        data += bulk;
+        len -= bulk;
+    }
+#elif defined(MEGA_CRC_ARMV8)
+    mCrc = crc32Armv8(mCrc, data, len);
+    return;
+#endif
+
+    mCrc = crc32Bytes(mCrc, data, len);
 }
 
+// little-endian, as CryptoPP::CRC32 did, and restarts
 void HashCRC32::get(byte* out)
 {
-    hash.Final(out);
+    uint32_t value = ~mCrc;
+    for (int i = 0; i < 4; i++)
+    {
+        out[i] = static_cast<byte>(value >> (8 * i));
+    }
+    mCrc = 0xFFFFFFFF;
+}
+
+bool Deflate::compress(const byte* data, size_t len, std::string& compressed, int level)
+{
+    try
+    {
+        compressed.clear();
+        Deflator deflator(new StringSink(compressed), level);
+        deflator.Put(data, len);
+        deflator.MessageEnd();
+        return true;
+    }
+    catch (const CryptoPP::Exception& e)
+    {
+        LOG_err << "Failed DEFLATE compression " << e.what();
+        return false;
+    }
+}
+
+bool Deflate::decompress(const byte* data, size_t len, std::string& decompressed)
+{
+    try
+    {
+        decompressed.clear();
+        Inflator inflator(new StringSink(decompressed));
+        inflator.Put(data, len);
+        inflator.MessageEnd();
+        return true;
+    }
+    catch (const CryptoPP::Exception& e)
+    {
+        LOG_err << "Failed DEFLATE decompression " << e.what();
+        return false;
+    }
 }
 
 HMACSHA256::HMACSHA256(const byte *key, size_t length)
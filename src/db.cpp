@@ -94,6 +94,38 @@ bool DbTable::next(uint32_t* type, string* data, SymmCipher* key)
     return false;
 }
 
+void DbTable::readAll(std::vector<std::pair<uint32_t, string>>& records, SymmCipher* key, MegaClientAsyncQueue& queue)
+{
+    uint32_t type;
+    string data;
+    while (next(&type, &data))
+    {
+        if (type > nextid)
+        {
+            nextid = type & ~(static_cast<unsigned>(IDSPACING) - 1);
+        }
+        records.emplace_back(type, std::move(data));
+    }
+
+    std::vector<char> decrypted(records.size());
+    queue.runInBatches(records.size(), DECRYPTION_BATCH_SIZE,
+                       [&records, &decrypted, key](size_t begin, size_t end, SymmCipher& cipher)
+                       {
+                           cipher.setkey(key->key);
+                           for (size_t i = begin; i < end; ++i)
+                           {
+                               decrypted[i] = !records[i].first || PaddedCBC::decrypt(&records[i].second, &cipher);
+                           }
+                       });
+
+    auto failed = std::find(decrypted.begin(), decrypted.end(), false);
+    if (failed != decrypted.end())
+    {
+        LOG_err << "Failed to decrypt DB record " << records[static_cast<size_t>(failed - decrypted.begin())].first;
+        records.erase(records.begin() + (failed - decrypted.begin()), records.end());
+    }
+}
+
 DBTableTransactionCommitter *DbTable::getTransactionCommitter() const
 {
     return mTransactionCommitter;
@@ -132,6 +164,51 @@ void DbTable::checkCommitter(DBTableTransactionCommitter*)
     assert(mTransactionCommitter);
 }
 
+std::string DBReadPoolStats::report() const
+{
+    std::ostringstream s;
+    s << " DB read queries pooled/primary: " << pooled << "/" << primary << " waits: " << waits
+      << " wait time: " << std::chrono::duration_cast<std::chrono::milliseconds>(waitTime).count()
+      << " ms longest: " << std::chrono::duration_cast<std::chrono::milliseconds>(longestWait).count() << " ms";
+    return s.str();
+}
+
+std::string DBBlobStats::report() const
+{
+    std::ostringstream s;
+    s << " DB node blobs written: " << written << " (compressed: " << compressed << ")"
+      << " bytes raw/stored: " << rawBytes << "/" << storedBytes
+      << " decompressed: " << decompressed
+      << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(decompressTime).count() << " ms";
+    return s.str();
+}
+
+void DBQueryScheduler::interactiveWaiting()
+{
+    ++mInteractiveWaiting;
+}
+
+void DBQueryScheduler::interactiveServed()
+{
+    assert(mInteractiveWaiting.load() > 0);
+    if (--mInteractiveWaiting == 0)
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mIdle.notify_all();
+    }
+}
+
+void DBQueryScheduler::waitForInteractive(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> g(mMutex);
+    mIdle.wait_for(g,
+                   timeout,
+                   [this]()
+                   {
+                       return !interactivePending();
+                   });
+}
+
 const int DbAccess::LEGACY_DB_VERSION = 13;
 const int DbAccess::DB_VERSION = DbAccess::LEGACY_DB_VERSION + 1;
 const int DbAccess::LAST_DB_VERSION_WITHOUT_NOD = 12;
@@ -132,16 +132,6 @@ SqliteDbTable *SqliteDbAccess::open(PrnGen &rng, FileSystemAccess &fsAccess, con
 
 }
 
-// An adapter around naturalsorting_compare
-static int
-    sqlite_naturalsorting_compare(void*, int size1, const void* data1, int size2, const void* data2)
-{
-    // We need to ensure that the strings to compare are null terminated
-    std::string s1{static_cast<const char*>(data1), static_cast<size_t>(size1)};
-    std::string s2{static_cast<const char*>(data2), static_cast<size_t>(size2)};
-    return naturalsorting_compare(s1.c_str(), s2.c_str());
-}
-
 DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAccess, const string &name, const int flags, DBErrorCallback dBErrorCallBack)
 {
     /**
@@ -156,57 +146,48 @@ DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAcc
         return nullptr;
     }
 
-    if (sqlite3_create_function(db, u8"getmimetype", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0, &SqliteAccountState::userGetMimetype, 0, 0) != SQLITE_OK)
+    if (!SqliteAccountState::registerFunctions(db))
     {
-        LOG_err << "Data base error(sqlite3_create_function userGetMimetype): " << sqlite3_errmsg(db);
         sqlite3_close(db);
         return nullptr;
     }
 
-    if (sqlite3_create_function(db,
-                                u8"getSizeFromNodeCounter",
-                                1,
-                                SQLITE_UTF8 | SQLITE_DETERMINISTIC,
-                                0,
-                                &SqliteAccountState::getSizeFromNodeCounter,
-                                0,
-                                0) != SQLITE_OK)
+    // Create specific table for handle nodes. The serialized nodes are kept in 'nodeblobs', so
+    // scans of 'nodes' only read small rows
+    auto nodesTableSql = [](const std::string& table)
     {
-        LOG_err << "Data base error(sqlite3_create_function getSizeFromNodeCounter): "
-                << sqlite3_errmsg(db);
-        sqlite3_close(db);
-        return nullptr;
-    }
+        return "CREATE TABLE IF NOT EXISTS " + table + " (nodehandle int64 PRIMARY KEY NOT NULL, "
+               "parenthandle int64, name text, fingerprint BLOB, origFingerprint BLOB, "
+               "type tinyint, mimetypeVirtual tinyint AS (getmimetype(name)) VIRTUAL, "
+               "sizeVirtual int64 AS (getSizeFromNodeCounter(counter)) VIRTUAL,"
+               "share tinyint, fav tinyint, ctime int64, mtime int64 DEFAULT 0, "
+               "flags int64, counter BLOB NOT NULL, "
+               "label tinyint DEFAULT 0, description text, tags text, nameKey text)";
+    };
+    std::string sql = nodesTableSql("nodes") + "; "
+                      "CREATE TABLE IF NOT EXISTS nodeblobs (nodehandle INTEGER PRIMARY KEY NOT NULL, node BLOB NOT NULL, "
+                      "encoding tinyint NOT NULL DEFAULT 0)";
 
-    if (sqlite3_create_collation(db,
-                                 "NATURALNOCASE",
-                                 SQLITE_UTF8,
-                                 nullptr,
-                                 sqlite_naturalsorting_compare))
+    int result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
     {
-        LOG_err << "Data base error(sqlite3_create_collation NATURALNOCASE): "
-                << sqlite3_errmsg(db);
+        LOG_err << "Data base error: " << sqlite3_errmsg(db);
         sqlite3_close(db);
         return nullptr;
     }
 
-    // Create specific table for handle nodes
-    std::string sql = "CREATE TABLE IF NOT EXISTS nodes (nodehandle int64 PRIMARY KEY NOT NULL, "
-                      "parenthandle int64, name text, fingerprint BLOB, origFingerprint BLOB, "
-                      "type tinyint, mimetypeVirtual tinyint AS (getmimetype(name)) VIRTUAL, "
-                      "sizeVirtual int64 AS (getSizeFromNodeCounter(counter)) VIRTUAL,"
-                      "share tinyint, fav tinyint, ctime int64, mtime int64 DEFAULT 0, "
-                      "flags int64, counter BLOB NOT NULL, "
-                      "node BLOB NOT NULL, label tinyint DEFAULT 0, description text, tags text)";
-
-    int result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+    // blobs stored before 'encoding' existed are raw (SqliteAccountState::NODE_BLOB_RAW)
+    if (!hasColumn(db, "nodeblobs", "encoding") &&
+        sqlite3_exec(db, "ALTER TABLE nodeblobs ADD COLUMN encoding tinyint NOT NULL DEFAULT 0", nullptr, nullptr, nullptr) != SQLITE_OK)
     {
-        LOG_err << "Data base error: " << sqlite3_errmsg(db);
+        LOG_err << "Db error while adding 'nodeblobs.encoding' column: " << sqlite3_errmsg(db);
         sqlite3_close(db);
         return nullptr;
     }
 
+    // rows written before 'nameKey' existed get it from their names, see below
+    const bool hadNameKey = hasColumn(db, "nodes", "nameKey");
+
     // Add following columns to existing 'nodes' table that might not have them, and populate them
     // if needed:
     vector<NewColumn> newCols{
@@ -226,6 +207,7 @@ DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAcc
         {"sizeVirtual",
          "int64 AS (getSizeFromNodeCounter(counter)) VIRTUAL", NodeData::COMPONENT_NONE,
          nullptr                                                                                                                            },
+        {"nameKey",         "text",                            NodeData::COMPONENT_NONE,        nullptr},
     };
 
     if (!addAndPopulateColumns(db, std::move(newCols)))
@@ -234,6 +216,33 @@ DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAcc
         return nullptr;
     }
 
+    if (!hadNameKey)
+    {
+        LOG_info << "Migrating Data base - computing the sort keys of names";
+        if (sqlite3_exec(db, "UPDATE nodes SET nameKey = naturalsortkey(name)", nullptr, nullptr, nullptr) != SQLITE_OK)
+        {
+            LOG_err << "Db error while populating 'nodes.nameKey' column: " << sqlite3_errmsg(db);
+            sqlite3_close(db);
+            return nullptr;
+        }
+    }
+
+    // after the new columns, which are populated from the blobs of the old table
+    bool nodeBlobsMoved = false;
+    if (!moveNodeBlobs(db, nodesTableSql("nodes_split"), nodeBlobsMoved))
+    {
+        sqlite3_close(db);
+        return nullptr;
+    }
+
+    // the triggers go with table nodes when it's rebuilt. Without them, the counters of
+    // folders are decoded from their nodes as before
+    if (!SqliteAccountState::hasNodeCounters(db))
+    {
+        LOG_info << "Building the aggregates of folders";
+        SqliteAccountState::buildNodeCounters(db);
+    }
+
 #if __ANDROID__
     // Android doesn't provide a temporal directory -> change default policy for temp
     // store (FILE=1) to avoid failures on large queries, so it relies on MEMORY=2
@@ -246,35 +255,18 @@ DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAcc
     }
 #endif
 
-    result = sqlite3_create_function(db, "regexp", 2, SQLITE_ANY,0, &SqliteAccountState::userRegexp, 0, 0);
-    if (result)
-    {
-        LOG_err << "Data base error(sqlite3_create_function userRegexp): " << sqlite3_errmsg(db);
-        sqlite3_close(db);
-        return nullptr;
-    }
-
-    result = sqlite3_create_function(db,
-                                     "matchFilter",
-                                     10,
-                                     SQLITE_ANY,
-                                     0,
-                                     &SqliteAccountState::userMatchFilter,
-                                     0,
-                                     0);
-    if (result)
+    auto accountState = new SqliteAccountState(rng,
+                                               db,
+                                               fsAccess,
+                                               dbPath,
+                                               (flags & DB_OPEN_FLAG_TRANSACTED) > 0,
+                                               std::move(dBErrorCallBack));
+    if (nodeBlobsMoved)
     {
-        LOG_err << "Data base error(sqlite3_create_function userMatchFilter): "
-                << sqlite3_errmsg(db);
-        sqlite3_close(db);
-        return nullptr;
+        // nodes loaded from this DB don't go through NodeManager::initCompleted()
+        accountState->createIndexes();
     }
-    return new SqliteAccountState(rng,
-                                db,
-                                fsAccess,
-                                dbPath,
-                                (flags & DB_OPEN_FLAG_TRANSACTED) > 0,
-                                std::move(dBErrorCallBack));
+    return accountState;
 }
 
 bool SqliteDbAccess::probe(FileSystemAccess& fsAccess, const string& name) const
@@ -426,6 +418,10 @@ void SqliteDbAccess::removeDBFiles(FileSystemAccess& fsAccess, mega::LocalPath&
 
 #endif
 
+    // see SqliteDbTable::setSnapshot()
+    auto snapshotSuffix = LocalPath::fromRelativePath("-snapshot");
+    auto snapshotToRemove = dbPath + snapshotSuffix;
+    fsAccess.unlinklocal(snapshotToRemove);
 }
 
 bool SqliteDbAccess::addAndPopulateColumns(sqlite3* db, vector<NewColumn>&& newCols)
@@ -490,6 +486,55 @@ bool SqliteDbAccess::addColumn(sqlite3* db, const string& name, const string& ty
     return true;
 }
 
+bool SqliteDbAccess::hasColumn(sqlite3* db, const string& table, const string& name)
+{
+    sqlite3_stmt* stmt = nullptr;
+    bool found = false;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM pragma_table_xinfo(?1) WHERE name = ?2", -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_bind_text(stmt, 1, table.c_str(), static_cast<int>(table.size()), SQLITE_STATIC) == SQLITE_OK &&
+        sqlite3_bind_text(stmt, 2, name.c_str(), static_cast<int>(name.size()), SQLITE_STATIC) == SQLITE_OK)
+    {
+        found = sqlite3_step(stmt) == SQLITE_ROW;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+bool SqliteDbAccess::moveNodeBlobs(sqlite3* db, const string& createSplitTable, bool& moved)
+{
+    moved = false;
+    if (!hasColumn(db, "nodes", "node"))
+    {
+        return true;
+    }
+
+    LOG_info << "Migrating Data base - moving node blobs to their own table";
+
+    // the table is rebuilt without the blob column, since SQLite can't drop it in place
+    // (before 3.35) and its space wouldn't be released anyway
+    static const string columns = "nodehandle, parenthandle, name, fingerprint, origFingerprint, type, "
+                                  "share, fav, ctime, mtime, flags, counter, label, description, tags, nameKey";
+    const string sql = "BEGIN; "
+                       "INSERT OR REPLACE INTO nodeblobs (nodehandle, node) SELECT nodehandle, node FROM nodes; "
+                       "DROP TABLE IF EXISTS nodes_split; " +
+                       createSplitTable + "; "
+                       "INSERT INTO nodes_split (" + columns + ") SELECT " + columns + " FROM nodes; "
+                       "DROP TABLE nodes; "
+                       "ALTER TABLE nodes_split RENAME TO nodes; "
+                       "COMMIT";
+
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        LOG_err << "Db error while moving node blobs: " << sqlite3_errmsg(db);
+        sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+        return false;
+    }
+
+    // the indexes went with the old table
+    moved = true;
+    return true;
+}
+
 bool SqliteDbAccess::migrateDataToColumns(sqlite3* db, vector<NewColumn>&& cols)
 {
     if (cols.empty()) return true;
@@ -503,8 +548,10 @@ bool SqliteDbAccess::migrateDataToColumns(sqlite3* db, vector<NewColumn>&& cols)
     LOG_info << "Migrating Data base - populating new columns";
 
     // get existing data
+    const std::string source = hasColumn(db, "nodes", "node") ? "SELECT nodehandle, node, 0 FROM nodes"
+                                                              : "SELECT nodehandle, node, encoding FROM nodeblobs";
     sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db, "SELECT nodehandle, node FROM nodes", -1, &stmt, nullptr) != SQLITE_OK)
+    if (sqlite3_prepare_v2(db, source.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
     {
         LOG_err << "Db error while preparing to extract data to migrate: " << sqlite3_errmsg(db);
         return false;
@@ -516,10 +563,14 @@ bool SqliteDbAccess::migrateDataToColumns(sqlite3* db, vector<NewColumn>&& cols)
     uint64_t affectedRows = 0;
     while (sqlite3_step(stmt) == SQLITE_ROW)
     {
-        const char* blob = static_cast<const char*>(sqlite3_column_blob(stmt, 1));
-        int blobSize = sqlite3_column_bytes(stmt, 1);
+        std::string blob;
         handle nh = sqlite3_column_int64(stmt, 0);
-        NodeData nd(blob, blobSize, NodeData::COMPONENT_ATTRS);
+        if (!SqliteAccountState::decodeNodeBlob(sqlite3_column_blob(stmt, 1), sqlite3_column_bytes(stmt, 1), sqlite3_column_int(stmt, 2), blob))
+        {
+            LOG_err << "Db error during migration, unable to decode the node " << toNodeHandle(nh);
+            continue;
+        }
+        NodeData nd(blob.data(), blob.size(), NodeData::COMPONENT_ATTRS);
 
         std::vector<std::unique_ptr<MigrateType>> migrateElement;
         migrateElement.reserve(cols.size());
@@ -632,6 +683,9 @@ SqliteDbTable::~SqliteDbTable()
 {
     resetCommitter();
 
+    // before closing the connection, so its last commits are synced
+    mGroupCommit.reset();
+
     if (!db)
     {
         return;
@@ -646,6 +700,13 @@ SqliteDbTable::~SqliteDbTable()
         SqliteDbTable::abort(); // fully qualify virtual function
     }
 
+    // from the committed records, once they're on disk. An existing one is still valid if
+    // the records didn't change
+    if (mSnapshotEnabled && (mSnapshotDiscarded || !fsaccess->fileExistsAt(snapshotPath())))
+    {
+        writeSnapshot();
+    }
+
     sqlite3_close(db);
     LOG_debug << "Database closed " << dbfile;
 }
@@ -663,6 +724,15 @@ void SqliteDbTable::rewind()
         return;
     }
 
+    mSnapshotReader.reset();
+    mSnapshot.clear();
+    if (mSnapshotEnabled && !mSnapshotDiscarded && loadSnapshot())
+    {
+        sqlite3_finalize(pStmt);
+        pStmt = nullptr;
+        return;
+    }
+
     int result = SQLITE_OK;
 
     if (pStmt)
@@ -685,6 +755,23 @@ bool SqliteDbTable::next(uint32_t* index, string* data)
         return false;
     }
 
+    if (mSnapshotReader)
+    {
+        string content;
+        if (mSnapshotRecordsLeft && mSnapshotReader->unserializeu32(*index) && mSnapshotReader->unserializestring_u32(content))
+        {
+            --mSnapshotRecordsLeft;
+            *data = std::move(content);
+            return true;
+        }
+
+        // its size was checked when loaded
+        assert(!mSnapshotRecordsLeft);
+        mSnapshotReader.reset();
+        mSnapshot.clear();
+        return false;
+    }
+
     if (!pStmt)
     {
         return false;
@@ -712,6 +799,8 @@ bool SqliteDbTable::next(uint32_t* index, string* data)
 // retrieve record by index
 bool SqliteDbTable::get(uint32_t index, string* data)
 {
+    MEGA_TRACE_SCOPE("db", "get");
+
     if (!db)
     {
         return false;
@@ -744,6 +833,8 @@ bool SqliteDbTable::get(uint32_t index, string* data)
 // add/update record by index
 bool SqliteDbTable::put(uint32_t index, char* data, unsigned len)
 {
+    MEGA_TRACE_SCOPE("db", "put");
+
     if (!db)
     {
         return false;
@@ -753,6 +844,7 @@ bool SqliteDbTable::put(uint32_t index, char* data, unsigned len)
     assert((index & (DbTable::IDSPACING - 1)) != MegaClient::CACHEDNODE); // nodes must be stored in DbTableNodes ('nodes' table, not 'statecache' table)
 
     checkTransaction();
+    discardSnapshot();
 
     int sqlResult = SQLITE_OK;
     if (!mPutStmt)
@@ -784,12 +876,15 @@ bool SqliteDbTable::put(uint32_t index, char* data, unsigned len)
 // delete record by index
 bool SqliteDbTable::del(uint32_t index)
 {
+    MEGA_TRACE_SCOPE("db", "del");
+
     if (!db)
     {
         return false;
     }
 
     checkTransaction();
+    discardSnapshot();
 
     int sqlResult = SQLITE_OK;
     if (!mDelStmt)
@@ -823,6 +918,7 @@ void SqliteDbTable::truncate()
 
     checkTransaction();
     assert(inTransaction());
+    discardSnapshot();
 
     int rc = sqlite3_exec(db, "DELETE FROM statecache", 0, 0, NULL);
     errorHandler(rc, "Truncate ", false);
@@ -845,6 +941,8 @@ void SqliteDbTable::begin()
 // commit transaction
 void SqliteDbTable::commit()
 {
+    MEGA_TRACE_SCOPE("db", "commit");
+
     if (!db)
     {
         return;
@@ -854,6 +952,11 @@ void SqliteDbTable::commit()
 
     int rc = sqlite3_exec(db, "COMMIT", 0, 0, NULL);
     errorHandler(rc, "Commit transaction", false);
+
+    if (rc == SQLITE_OK && mGroupCommit)
+    {
+        mGroupCommit->committed();
+    }
 }
 
 // abort transaction
@@ -877,6 +980,10 @@ void SqliteDbTable::remove()
         return;
     }
 
+    mGroupCommit.reset();
+    mSnapshotEnabled = false;
+    discardSnapshot();
+
     sqlite3_finalize(pStmt);
     pStmt = nullptr;
     sqlite3_finalize(mDelStmt);
@@ -896,278 +1003,1718 @@ void SqliteDbTable::remove()
     fsaccess->unlinklocal(dbfile);
 }
 
-void SqliteDbTable::errorHandler(int sqliteError, const string& operation, bool interrupt)
+bool SqliteDbTable::setGroupCommit(std::chrono::milliseconds maxDelay, unsigned maxCommits)
 {
-    DBError dbError = DBError::DB_ERROR_UNKNOWN;
-    switch (sqliteError)
+    if (!db)
     {
-    case SQLITE_OK:
-    case SQLITE_ROW:
-    case SQLITE_DONE:
-        return;
+        return false;
+    }
 
-    case SQLITE_INTERRUPT:
-        if (interrupt)
+    if (!maxCommits)
+    {
+        if (mGroupCommit)
         {
-            // SQLITE_INTERRUPT isn't handle as an error if caller can be interrupted
-            LOG_debug <<  operation << ": interrupted";
-            return;
+            mGroupCommit.reset();
+            execPragma("synchronous=" + std::to_string(mSynchronousBeforeGroupCommit));
+            execPragma("wal_autocheckpoint=" + std::to_string(mAutoCheckpointBeforeGroupCommit));
+            LOG_debug << "Group commit disabled for " << dbfile;
         }
-        break;
-
-    case SQLITE_FULL:
-        dbError = DBError::DB_ERROR_FULL;
-        break;
-
-    case SQLITE_IOERR:
-        dbError = DBError::DB_ERROR_IO;
-        break;
-
-    default:
-        dbError = DBError::DB_ERROR_UNKNOWN;
-        break;
+        return true;
     }
 
-    string err = string(" Error: ") + (sqlite3_errmsg(db) ? sqlite3_errmsg(db) : std::to_string(sqliteError));
-    LOG_err << operation << ": " << dbfile << err;
-    assert(!operation.c_str());
+    if (mGroupCommit)
+    {
+        return true;
+    }
 
-    if (mDBErrorCallBack && dbError != DBError::DB_ERROR_UNKNOWN)
+    // commits in rollback journal modes can't be made durable later
+    sqlite3_stmt* stmt = nullptr;
+    bool wal = false;
+    if (sqlite3_prepare_v2(db, "PRAGMA journal_mode", -1, &stmt, NULL) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW)
     {
-        // Only notify DB errors related to disk-is-full and input/output failures
-        mDBErrorCallBack(dbError);
+        const unsigned char* mode = sqlite3_column_text(stmt, 0);
+        wal = mode && !strcmp(reinterpret_cast<const char*>(mode), "wal");
+    }
+    sqlite3_finalize(stmt);
+    if (!wal)
+    {
+        LOG_debug << "Group commit not available without WAL for " << dbfile;
+        return false;
     }
+
+    mSynchronousBeforeGroupCommit = static_cast<int>(getPragma("synchronous", mSynchronousBeforeGroupCommit));
+    mAutoCheckpointBeforeGroupCommit = getPragma("wal_autocheckpoint", mAutoCheckpointBeforeGroupCommit);
+
+    // commits only append to the WAL, and automatic checkpoints (which sync) would run in them
+    execPragma("synchronous=NORMAL");
+    execPragma("wal_autocheckpoint=0");
+
+    mGroupCommit = std::make_unique<GroupCommitWriter>(dbfile, maxDelay, maxCommits);
+    LOG_debug << "Group commit enabled for " << dbfile << " (" << maxDelay.count() << " ms, " << maxCommits << " commits)";
+    return true;
 }
 
-SqliteAccountState::SqliteAccountState(PrnGen &rng, sqlite3 *pdb, FileSystemAccess &fsAccess, const LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack)
-    : SqliteDbTable(rng, pdb, fsAccess, path, checkAlwaysTransacted, dBErrorCallBack)
+bool SqliteDbTable::flushCommits()
 {
+    return !mGroupCommit || mGroupCommit->flush();
 }
 
-SqliteAccountState::~SqliteAccountState()
+void SqliteDbTable::releaseMemory()
 {
-    finalise();
+    if (db)
+    {
+        sqlite3_db_release_memory(db);
+    }
 }
 
-int SqliteAccountState::progressHandler(void *param)
+SqliteDbTable::GroupCommitWriter::GroupCommitWriter(const LocalPath& path, std::chrono::milliseconds maxDelay, unsigned maxCommits)
+    : mPath(path)
+    , mMaxDelay(maxDelay)
+    , mMaxCommits(maxCommits)
+    , mThread(&GroupCommitWriter::run, this)
 {
-    CancelToken* cancelFlag = static_cast<CancelToken*>(param);
-    return cancelFlag->isCancelled();
 }
 
-bool SqliteAccountState::processSqlQueryAllNodeTags(
-    sqlite3_stmt* stmt,
-    std::set<std::string>& tags,
-    std::function<bool(const std::string&)> isValidTagF)
+SqliteDbTable::GroupCommitWriter::~GroupCommitWriter()
 {
-    assert(stmt);
-    int sqlResult = SQLITE_ERROR;
-    while ((sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
     {
-        const void* data = sqlite3_column_blob(stmt, 0);
-        int size = sqlite3_column_bytes(stmt, 0);
-        if (!data || !size)
+        std::lock_guard<std::mutex> g(mMutex);
+        mStop = true;
+    }
+    mWakeUp.notify_one();
+    mThread.join();
+}
+
+void SqliteDbTable::GroupCommitWriter::committed()
+{
+    bool wakeUp = false;
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        if (!mPending++)
         {
-            continue;
+            mFirstPending = std::chrono::steady_clock::now();
+            wakeUp = true; // to start counting 'mMaxDelay'
         }
-        std::string allTags(static_cast<const char*>(data), static_cast<size_t>(size));
-        const std::set<std::string> separatedTags = splitString(allTags, MegaClient::TAG_DELIMITER);
-        std::for_each(std::begin(separatedTags),
-                      std::end(separatedTags),
-                      [&tags, &isValidTagF](const std::string& t)
-                      {
-                          if (isValidTagF(t))
-                              tags.insert(t);
-                      });
+        wakeUp = wakeUp || mPending >= mMaxCommits;
     }
 
-    errorHandler(sqlResult, "Process sql query for all node tags", true);
-    return sqlResult == SQLITE_DONE;
+    if (wakeUp)
+    {
+        mWakeUp.notify_one();
+    }
 }
 
-bool SqliteAccountState::processSqlQueryNodes(sqlite3_stmt *stmt, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>& nodes)
+bool SqliteDbTable::GroupCommitWriter::flush()
 {
-    assert(stmt);
-    int sqlResult = SQLITE_ERROR;
-    while ((sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
+    std::unique_lock<std::mutex> lock(mMutex);
+    const uint64_t request = ++mFlushRequested;
+    mWakeUp.notify_one();
+    mFlushed.wait(lock, [this, request]() { return mFlushServed >= request; });
+    return mFlushComplete;
+}
+
+void SqliteDbTable::GroupCommitWriter::run()
+{
+    sqlite3* connection = nullptr;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
     {
-        NodeHandle nodeHandle;
-        nodeHandle.set6byte(sqlite3_column_int64(stmt, 0));
+        if (!mStop && mFlushRequested == mFlushServed && mPending < mMaxCommits)
+        {
+            if (!mPending)
+            {
+                mWakeUp.wait(lock);
+                continue;
+            }
 
-        NodeSerialized node;
+            if (mWakeUp.wait_until(lock, mFirstPending + mMaxDelay) == std::cv_status::no_timeout)
+            {
+                continue;
+            }
+        }
 
-        // Blob node counter
-        const void* data = sqlite3_column_blob(stmt, 1);
-        int size = sqlite3_column_bytes(stmt, 1);
-        if (data && size)
+        if (mPending || mFlushRequested != mFlushServed)
         {
-            node.mNodeCounter = std::string(static_cast<const char*>(data), size);
+            const uint64_t serving = mFlushRequested;
+            mPending = 0;
+
+            lock.unlock();
+            const bool complete = checkpoint(connection);
+            lock.lock();
+
+            mFlushServed = serving;
+            mFlushComplete = complete;
+            mFlushed.notify_all();
         }
 
-        // blob node
-        data = sqlite3_column_blob(stmt, 2);
-        size = sqlite3_column_bytes(stmt, 2);
-        if (data && size)
+        if (mStop)
         {
-            node.mNode = std::string(static_cast<const char*>(data), size);
-            nodes.insert(nodes.end(), std::make_pair(nodeHandle, std::move(node)));
+            break;
         }
     }
 
-    errorHandler(sqlResult, "Process sql query", true);
-
-    return sqlResult == SQLITE_DONE;
+    sqlite3_close(connection);
 }
 
-bool SqliteAccountState::remove(NodeHandle nodehandle)
+bool SqliteDbTable::GroupCommitWriter::checkpoint(sqlite3*& connection)
 {
-    if (!db)
+    if (!connection &&
+        sqlite3_open_v2(mPath.toPath(false).c_str(), &connection, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
     {
+        LOG_err << "Group commit: unable to open " << mPath << ": " << sqlite3_errmsg(connection);
+        sqlite3_close(connection);
+        connection = nullptr;
         return false;
     }
 
-    checkTransaction();
-
-    char buf[64];
-
-    snprintf(buf, sizeof(buf), "DELETE FROM nodes WHERE nodehandle = %" PRId64, nodehandle.as8byte());
-
-    int sqlResult = sqlite3_exec(db, buf, 0, 0, NULL);
-    errorHandler(sqlResult, "Delete node", false);
+    // PASSIVE doesn't wait for readers nor the writer, the frames they still need are
+    // checkpointed by the next round
+    int logFrames = 0;
+    int checkpointedFrames = 0;
+    int result = sqlite3_wal_checkpoint_v2(connection, nullptr, SQLITE_CHECKPOINT_PASSIVE, &logFrames, &checkpointedFrames);
+    if (result != SQLITE_OK && result != SQLITE_BUSY)
+    {
+        LOG_err << "Group commit: checkpoint of " << mPath << " failed: " << sqlite3_errmsg(connection);
+        return false;
+    }
 
-    return sqlResult == SQLITE_OK;
+    return result == SQLITE_OK && logFrames == checkpointedFrames;
 }
 
-bool SqliteAccountState::removeNodes()
+bool SqliteDbTable::setSnapshot(bool enable)
 {
     if (!db)
     {
         return false;
     }
 
-    checkTransaction();
-
-    int sqlResult = sqlite3_exec(db, "DELETE FROM nodes", 0, 0, NULL);
-    errorHandler(sqlResult, "Delete nodes", false);
+    mSnapshotEnabled = enable;
+    if (!enable)
+    {
+        discardSnapshot();
+    }
+    return true;
+}
 
-    return sqlResult == SQLITE_OK;
+LocalPath SqliteDbTable::snapshotPath() const
+{
+    LocalPath path = dbfile;
+    path.append(LocalPath::fromRelativePath("-snapshot"));
+    return path;
 }
 
-void SqliteAccountState::updateCounter(NodeHandle nodeHandle, const std::string& nodeCounterBlob)
+bool SqliteDbTable::loadSnapshot()
 {
-    if (!db)
+    const LocalPath path = snapshotPath();
+    auto fileAccess = fsaccess->newfileaccess(false);
+    if (!fileAccess->fopen(path, true, false, FSLogging::noLogging))
     {
-        return;
+        return false;
     }
 
-    checkTransaction();
-
-    int sqlResult = SQLITE_OK;
-    if (!mStmtUpdateNode)
+    // read at once: the records take a few MB at most
+    if (fileAccess->size <= 0 || fileAccess->size > std::numeric_limits<unsigned>::max() ||
+        !fileAccess->fread(&mSnapshot, static_cast<unsigned>(fileAccess->size), 0, 0, FSLogging::logOnError))
     {
-        sqlResult = sqlite3_prepare_v2(db, "UPDATE nodes SET counter = ?  WHERE nodehandle = ?", -1, &mStmtUpdateNode, NULL);
+        mSnapshot.clear();
+        discardSnapshot();
+        return false;
     }
-
-    if (sqlResult == SQLITE_OK)
-    {
-        if ((sqlResult = sqlite3_bind_blob(mStmtUpdateNode, 1, nodeCounterBlob.data(), static_cast<int>(nodeCounterBlob.size()), SQLITE_STATIC)) == SQLITE_OK)
-        {
-            if ((sqlResult = sqlite3_bind_int64(mStmtUpdateNode, 2, nodeHandle.as8byte())) == SQLITE_OK)
-            {
-                sqlResult = sqlite3_step(mStmtUpdateNode);
-            }
-        }
-
+    fileAccess.reset();
+
+    auto reader = std::make_unique<CacheableReader>(mSnapshot);
+    char magic[sizeof(SNAPSHOT_MAGIC) - 1];
+    uint32_t version = 0;
+    uint32_t numRecords = 0;
+    uint64_t recordsSize = 0;
+    string firstRecord;
+    string firstRecordInDb;
+    const bool valid = reader->unserializebinary(reinterpret_cast<byte*>(magic), sizeof(magic)) &&
+                       !memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) &&
+                       reader->unserializeu32(version) && version == SNAPSHOT_VERSION &&
+                       reader->unserializeu32(numRecords) &&
+                       reader->unserializeu64(recordsSize) &&
+                       recordsSize == static_cast<uint64_t>(reader->end - reader->ptr) &&
+                       reader->unserializestring_u32(firstRecord) &&
+                       get(0, &firstRecordInDb) == !firstRecord.empty() && firstRecord == firstRecordInDb;
+    if (!valid)
+    {
+        LOG_warn << "Discarding outdated or corrupt snapshot of " << dbfile;
+        mSnapshot.clear();
+        discardSnapshot();
+        return false;
     }
 
-    errorHandler(sqlResult, "Update counter", false);
-
-    sqlite3_reset(mStmtUpdateNode);
+    LOG_debug << "Reading " << numRecords << " records from the snapshot of " << dbfile;
+    mSnapshotReader = std::move(reader);
+    mSnapshotRecordsLeft = numRecords;
+    return true;
 }
 
-void SqliteAccountState::updateCounterAndFlags(NodeHandle nodeHandle, uint64_t flags, const std::string& nodeCounterBlob)
+void SqliteDbTable::writeSnapshot()
 {
-    if (!db)
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT id, content FROM statecache", -1, &stmt, NULL) != SQLITE_OK)
     {
+        LOG_err << "Unable to read the records of " << dbfile << " for the snapshot: " << sqlite3_errmsg(db);
         return;
     }
 
-    checkTransaction();
+    string records;
+    string firstRecord;
+    uint32_t numRecords = 0;
+    CacheableWriter recordsWriter(records);
+    int result = SQLITE_OK;
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const uint32_t id = static_cast<uint32_t>(sqlite3_column_int64(stmt, 0));
+        string content(static_cast<const char*>(sqlite3_column_blob(stmt, 1)), static_cast<size_t>(sqlite3_column_bytes(stmt, 1)));
+        if (!id)
+        {
+            firstRecord = content;
+        }
+
+        recordsWriter.serializeu32(id);
+        recordsWriter.serializestring_u32(content);
+        ++numRecords;
+    }
+    sqlite3_finalize(stmt);
+
+    if (result != SQLITE_DONE)
+    {
+        LOG_err << "Unable to read the records of " << dbfile << " for the snapshot: " << sqlite3_errmsg(db);
+        return;
+    }
+
+    string snapshot;
+    CacheableWriter writer(snapshot);
+    writer.serializebinary(reinterpret_cast<byte*>(const_cast<char*>(SNAPSHOT_MAGIC)), sizeof(SNAPSHOT_MAGIC) - 1);
+    writer.serializeu32(SNAPSHOT_VERSION);
+    writer.serializeu32(numRecords);
+    writer.serializeu64(records.size() + sizeof(uint32_t) + firstRecord.size());
+    writer.serializestring_u32(firstRecord);
+    snapshot.append(records);
+
+    // written aside and renamed, so there's never a partial snapshot in place
+    const LocalPath path = snapshotPath();
+    LocalPath tmpPath = path;
+    tmpPath.append(LocalPath::fromRelativePath(".tmp"));
+    auto fileAccess = fsaccess->newfileaccess(false);
+    bool written = fileAccess->fopen(tmpPath, false, true, FSLogging::logOnError) &&
+                   fileAccess->ftruncate() &&
+                   fileAccess->fwrite(reinterpret_cast<const byte*>(snapshot.data()), static_cast<unsigned>(snapshot.size()), 0);
+    fileAccess.reset();
+
+    if (!written || !fsaccess->renamelocal(tmpPath, path, true))
+    {
+        LOG_err << "Unable to write the snapshot of " << dbfile;
+        fsaccess->unlinklocal(tmpPath);
+        return;
+    }
+
+    LOG_debug << "Snapshot of " << dbfile << " written with " << numRecords << " records";
+}
+
+void SqliteDbTable::discardSnapshot()
+{
+    if (mSnapshotDiscarded)
+    {
+        return;
+    }
+
+    // until it's written again when the table is closed
+    mSnapshotDiscarded = true;
+    const LocalPath path = snapshotPath();
+    if (fsaccess->fileExistsAt(path))
+    {
+        fsaccess->unlinklocal(path);
+    }
+}
+
+int64_t SqliteDbTable::getPragma(const char* pragma, int64_t defaultValue)
+{
+    std::string sql = std::string("PRAGMA ") + pragma;
+    sqlite3_stmt* stmt = nullptr;
+    int64_t value = defaultValue;
+    int sqlResult = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
+    if (sqlResult == SQLITE_OK && (sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        value = sqlite3_column_int64(stmt, 0);
+    }
+    errorHandler(sqlResult, sql, false);
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+void SqliteDbTable::execPragma(const std::string& pragma)
+{
+    std::string sql = "PRAGMA " + pragma;
+    sqlite3_stmt* stmt = nullptr;
+    // some pragmas return the new value, so it's stepped instead of sqlite3_exec'd
+    int sqlResult = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
+    if (sqlResult == SQLITE_OK)
+    {
+        sqlResult = sqlite3_step(stmt);
+    }
+    if (sqlResult != SQLITE_ROW && sqlResult != SQLITE_DONE)
+    {
+        LOG_err << "Data base error (" << sql << "): " << sqlite3_errmsg(db);
+    }
+    sqlite3_finalize(stmt);
+}
+
+void SqliteDbTable::errorHandler(int sqliteError, const string& operation, bool interrupt, sqlite3* connection)
+{
+    DBError dbError = DBError::DB_ERROR_UNKNOWN;
+    switch (sqliteError)
+    {
+    case SQLITE_OK:
+    case SQLITE_ROW:
+    case SQLITE_DONE:
+        return;
+
+    case SQLITE_INTERRUPT:
+        if (interrupt)
+        {
+            // SQLITE_INTERRUPT isn't handle as an error if caller can be interrupted
+            LOG_debug <<  operation << ": interrupted";
+            return;
+        }
+        break;
+
+    case SQLITE_FULL:
+        dbError = DBError::DB_ERROR_FULL;
+        break;
+
+    case SQLITE_IOERR:
+        dbError = DBError::DB_ERROR_IO;
+        break;
+
+    default:
+        dbError = DBError::DB_ERROR_UNKNOWN;
+        break;
+    }
+
+    if (!connection)
+    {
+        connection = db;
+    }
+    string err = string(" Error: ") + (sqlite3_errmsg(connection) ? sqlite3_errmsg(connection) : std::to_string(sqliteError));
+    LOG_err << operation << ": " << dbfile << err;
+    assert(!operation.c_str());
+
+    if (mDBErrorCallBack && dbError != DBError::DB_ERROR_UNKNOWN)
+    {
+        // Only notify DB errors related to disk-is-full and input/output failures
+        mDBErrorCallBack(dbError);
+    }
+}
+
+SqliteAccountState::SqliteAccountState(PrnGen &rng, sqlite3 *pdb, FileSystemAccess &fsAccess, const LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack)
+    : SqliteDbTable(rng, pdb, fsAccess, path, checkAlwaysTransacted, dBErrorCallBack)
+{
+    mPrimaryReads.db = db;
+
+    // without WAL, readers and the writer block each other, so there's nothing to gain
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "PRAGMA journal_mode", -1, &stmt, NULL) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        const unsigned char* mode = sqlite3_column_text(stmt, 0);
+        if (mode && !strcmp(reinterpret_cast<const char*>(mode), "wal"))
+        {
+            mReadPool.enable(path, MAX_READ_CONNECTIONS);
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    // the full-text index is kept in sync for as long as it exists (and FTS5 is available)
+    stmt = nullptr;
+    mFullTextIndex = sqlite3_prepare_v2(db, "SELECT rowid FROM nodesfts LIMIT 0", -1, &stmt, NULL) == SQLITE_OK;
+    sqlite3_finalize(stmt);
+
+    // so is the journal of node changes
+    stmt = nullptr;
+    mChangeJournal = sqlite3_prepare_v2(db, "SELECT seq FROM nodechanges LIMIT 0", -1, &stmt, NULL) == SQLITE_OK;
+    sqlite3_finalize(stmt);
+
+    mNodeCounters = hasNodeCounters(db);
+}
+
+SqliteAccountState::~SqliteAccountState()
+{
+    finalise();
+}
+
+int SqliteAccountState::progressHandler(void *param)
+{
+    return static_cast<QueryMonitor*>(param)->interrupt();
+}
+
+SqliteAccountState::QueryMonitor::QueryMonitor(sqlite3* connection,
+                                               const char* operation,
+                                               const DBQueryOptions& options)
+    : mConnection(connection)
+    , mOperation(operation)
+    , mOptions(options)
+    , mStart(std::chrono::steady_clock::now())
+{
+    mOptions.yielded = false;
+    mOptions.timedOut = false;
+
+    if (mOptions.interruptible())
+    {
+        sqlite3_progress_handler(mConnection,
+                                 NUM_VIRTUAL_MACHINE_INSTRUCTIONS,
+                                 SqliteAccountState::progressHandler,
+                                 static_cast<void*>(this));
+    }
+}
+
+SqliteAccountState::QueryMonitor::~QueryMonitor()
+{
+    // unregister the handler (no-op if not registered)
+    sqlite3_progress_handler(mConnection, -1, nullptr, nullptr);
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - mStart);
+    // steps of full scans are rows read without the help of an index
+    const int scanned = mStmt ? sqlite3_stmt_status(mStmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 0) : 0;
+    const int vmSteps = mStmt ? sqlite3_stmt_status(mStmt, SQLITE_STMTSTATUS_VM_STEP, 0) : 0;
+    const char* outcome = mOptions.yielded                  ? " (yielded)" :
+                          mOptions.timedOut                 ? " (deadline expired)" :
+                          mOptions.cancelFlag.isCancelled() ? " (cancelled)" :
+                                                              "";
+
+    if (elapsed >= SLOW_QUERY_THRESHOLD)
+    {
+        LOG_warn << "Slow DB query: " << mOperation << outcome << " took " << elapsed.count()
+                 << " ms. Rows scanned: " << scanned << " (" << vmSteps
+                 << " VM steps), rows returned: " << mRowsReturned;
+    }
+    else
+    {
+        LOG_verbose << "DB query: " << mOperation << outcome << " took " << elapsed.count()
+                    << " ms. Rows scanned: " << scanned << " (" << vmSteps
+                    << " VM steps), rows returned: " << mRowsReturned;
+    }
+}
+
+void SqliteAccountState::QueryMonitor::setStatement(sqlite3_stmt* stmt)
+{
+    // cached statements keep counting across executions
+    mStmt = stmt;
+    if (mStmt)
+    {
+        sqlite3_stmt_status(mStmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+        sqlite3_stmt_status(mStmt, SQLITE_STMTSTATUS_VM_STEP, 1);
+    }
+}
+
+bool SqliteAccountState::QueryMonitor::interrupt()
+{
+    if (mOptions.cancelFlag.isCancelled())
+    {
+        return true;
+    }
+
+    if (mOptions.deadline != DBQueryOptions::Clock::time_point::max() &&
+        DBQueryOptions::Clock::now() >= mOptions.deadline)
+    {
+        mOptions.timedOut = true;
+        return true;
+    }
+
+    if (mOptions.priority == DBQueryPriority::BACKGROUND && mOptions.scheduler &&
+        mOptions.scheduler->interactivePending())
+    {
+        mOptions.yielded = true;
+        return true;
+    }
+
+    return false;
+}
+
+bool SqliteAccountState::processSqlQueryAllNodeTags(
+    sqlite3_stmt* stmt,
+    std::set<std::string>& tags,
+    std::function<bool(const std::string&)> isValidTagF)
+{
+    assert(stmt);
+    int sqlResult = SQLITE_ERROR;
+    while ((sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const void* data = sqlite3_column_blob(stmt, 0);
+        int size = sqlite3_column_bytes(stmt, 0);
+        if (!data || !size)
+        {
+            continue;
+        }
+        std::string allTags(static_cast<const char*>(data), static_cast<size_t>(size));
+        const std::set<std::string> separatedTags = splitString(allTags, MegaClient::TAG_DELIMITER);
+        std::for_each(std::begin(separatedTags),
+                      std::end(separatedTags),
+                      [&tags, &isValidTagF](const std::string& t)
+                      {
+                          if (isValidTagF(t))
+                              tags.insert(t);
+                      });
+    }
+
+    errorHandler(sqlResult, "Process sql query for all node tags", true);
+    return sqlResult == SQLITE_DONE;
+}
+
+bool SqliteAccountState::processSqlQueryNodes(sqlite3_stmt *stmt, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>& nodes)
+{
+    return processSqlQueryNodes(stmt, nodes, mPrimaryReads);
+}
+
+bool SqliteAccountState::processSqlQueryNodes(sqlite3_stmt* stmt, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>& nodes, ReadConnection& connection)
+{
+    MEGA_TRACE_SCOPE("db", "queryNodes");
+
+    assert(stmt);
+    int sqlResult = SQLITE_ERROR;
+    while ((sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        appendSqlRowNode(stmt, nodes, connection);
+    }
+
+    errorHandler(sqlResult, "Process sql query", true, sqlite3_db_handle(stmt));
+
+    return sqlResult == SQLITE_DONE;
+}
+
+void SqliteAccountState::appendSqlRowNode(sqlite3_stmt* stmt, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>& nodes, ReadConnection& connection)
+{
+    NodeHandle nodeHandle;
+    nodeHandle.set6byte(sqlite3_column_int64(stmt, 0));
+
+    // the blob is read once the query has filtered and sorted the rows
+    int sqlResult = SQLITE_OK;
+    if (!connection.stmtNodeBlob)
+    {
+        sqlResult = sqlite3_prepare_v2(connection.db, "SELECT node, encoding FROM nodeblobs WHERE nodehandle = ?", -1, &connection.stmtNodeBlob, NULL);
+    }
+
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(connection.stmtNodeBlob, 1, nodeHandle.as8byte())) == SQLITE_OK &&
+        (sqlResult = sqlite3_step(connection.stmtNodeBlob)) == SQLITE_ROW)
+    {
+        const void* data = sqlite3_column_blob(connection.stmtNodeBlob, 0);
+        int size = sqlite3_column_bytes(connection.stmtNodeBlob, 0);
+        if (data && size)
+        {
+            // blobs are only valid until next step, so each one is copied once, straight into its final place
+            nodes.emplace_back(nodeHandle, NodeSerialized());
+            NodeSerialized& node = nodes.back().second;
+            if (!readNodeBlob(data, size, sqlite3_column_int(connection.stmtNodeBlob, 1), node.mNode))
+            {
+                nodes.pop_back();
+                sqlite3_reset(connection.stmtNodeBlob);
+                return;
+            }
+
+            // Blob node counter
+            data = sqlite3_column_blob(stmt, 1);
+            size = sqlite3_column_bytes(stmt, 1);
+            if (data && size)
+            {
+                node.mNodeCounter.assign(static_cast<const char*>(data), static_cast<size_t>(size));
+            }
+        }
+    }
+
+    errorHandler(sqlResult, "Get node blob", false, connection.db);
+
+    sqlite3_reset(connection.stmtNodeBlob);
+}
+
+bool SqliteAccountState::remove(NodeHandle nodehandle)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    checkTransaction();
+    nodesWritten();
+
+    char buf[128];
+
+    snprintf(buf, sizeof(buf), "DELETE FROM nodes WHERE nodehandle = %" PRId64 "; DELETE FROM nodeblobs WHERE nodehandle = %" PRId64,
+             nodehandle.as8byte(), nodehandle.as8byte());
+
+    int sqlResult = sqlite3_exec(db, buf, 0, 0, NULL);
+    errorHandler(sqlResult, "Delete node", false);
+
+    if (sqlResult == SQLITE_OK && mFullTextIndex)
+    {
+        return removeFullTextRow(nodehandle.as8byte());
+    }
+
+    return sqlResult == SQLITE_OK;
+}
+
+bool SqliteAccountState::removeNodes()
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    checkTransaction();
+    nodesWritten();
+
+    // emptied first, so its triggers have nothing to update while the nodes are deleted
+    if (mNodeCounters)
+    {
+        int sqlResult = sqlite3_exec(db, "DELETE FROM nodecounters", 0, 0, NULL);
+        errorHandler(sqlResult, "Delete node counters", false);
+    }
+
+    int sqlResult = sqlite3_exec(db, mFullTextIndex ? "DELETE FROM nodes; DELETE FROM nodeblobs; DELETE FROM nodesfts"
+                                                    : "DELETE FROM nodes; DELETE FROM nodeblobs", 0, 0, NULL);
+    errorHandler(sqlResult, "Delete nodes", false);
+
+    // the entries don't lead to the current nodes anymore. Sequences aren't reused, so
+    // consumers see that they missed some
+    if (sqlResult == SQLITE_OK && mChangeJournal)
+    {
+        sqlResult = sqlite3_exec(db, "DELETE FROM nodechanges", 0, 0, NULL);
+        errorHandler(sqlResult, "Delete node changes", false);
+    }
+
+    return sqlResult == SQLITE_OK;
+}
+
+void SqliteAccountState::updateCounter(NodeHandle nodeHandle, const std::string& nodeCounterBlob)
+{
+    if (!db)
+    {
+        return;
+    }
+
+    checkTransaction();
+    nodesWritten();
+
+    int sqlResult = SQLITE_OK;
+    if (!mStmtUpdateNode)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "UPDATE nodes SET counter = ?  WHERE nodehandle = ?", -1, &mStmtUpdateNode, NULL);
+    }
+
+    if (sqlResult == SQLITE_OK)
+    {
+        if ((sqlResult = sqlite3_bind_blob(mStmtUpdateNode, 1, nodeCounterBlob.data(), static_cast<int>(nodeCounterBlob.size()), SQLITE_STATIC)) == SQLITE_OK)
+        {
+            if ((sqlResult = sqlite3_bind_int64(mStmtUpdateNode, 2, nodeHandle.as8byte())) == SQLITE_OK)
+            {
+                sqlResult = sqlite3_step(mStmtUpdateNode);
+            }
+        }
+
+    }
+
+    errorHandler(sqlResult, "Update counter", false);
+
+    sqlite3_reset(mStmtUpdateNode);
+}
+
+void SqliteAccountState::updateCounterAndFlags(NodeHandle nodeHandle, uint64_t flags, const std::string& nodeCounterBlob)
+{
+    if (!db)
+    {
+        return;
+    }
+
+    checkTransaction();
+    nodesWritten();
+
+    int sqlResult = SQLITE_OK;
+    if (!mStmtUpdateNodeAndFlags)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "UPDATE nodes SET counter = ?, flags = ? WHERE nodehandle = ?", -1, &mStmtUpdateNodeAndFlags, NULL);
+    }
+
+    if (sqlResult == SQLITE_OK)
+    {
+        if ((sqlResult = sqlite3_bind_blob(mStmtUpdateNodeAndFlags, 1, nodeCounterBlob.data(), static_cast<int>(nodeCounterBlob.size()), SQLITE_STATIC)) == SQLITE_OK)
+        {
+            if ((sqlResult = sqlite3_bind_int64(mStmtUpdateNodeAndFlags, 2, flags)) == SQLITE_OK)
+            {
+                if ((sqlResult = sqlite3_bind_int64(mStmtUpdateNodeAndFlags, 3, nodeHandle.as8byte())) == SQLITE_OK)
+                {
+                    sqlResult = sqlite3_step(mStmtUpdateNodeAndFlags);
+                }
+            }
+        }
+    }
+
+    errorHandler(sqlResult, "Update counter and flags", false);
+
+    sqlite3_reset(mStmtUpdateNodeAndFlags);
+}
+
+void SqliteAccountState::createIndexes()
+{
+    if (!db)
+    {
+        return;
+    }
+    // Create index for column that is not primary key (which already has an index by default)
+    std::string sql = "CREATE INDEX IF NOT EXISTS parenthandleindex on nodes (parenthandle)";
+    int result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (parenthandleindex): " << sqlite3_errmsg(db);
+    }
+
+    sql = "CREATE INDEX IF NOT EXISTS fingerprintindex on nodes (fingerprint)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (fingerprintindex): " << sqlite3_errmsg(db);
+    }
+
+#if defined( __ANDROID__) || defined(USE_IOS)
+    sql = "CREATE INDEX IF NOT EXISTS origFingerprintindex on nodes (origFingerprint)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (origFingerprintindex): " << sqlite3_errmsg(db);
+    }
+#endif
+
+    sql = "CREATE INDEX IF NOT EXISTS shareindex on nodes (share)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (shareindex): " << sqlite3_errmsg(db);
+    }
+
+    sql = "CREATE INDEX IF NOT EXISTS favindex on nodes (fav)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (favindex): " << sqlite3_errmsg(db);
+    }
+
+    sql = "CREATE INDEX IF NOT EXISTS ctimeindex on nodes (ctime)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (ctimeindex): " << sqlite3_errmsg(db);
+    }
+
+    // children in the default order (folders first, then by name) are read as they're indexed
+    sql = "CREATE INDEX IF NOT EXISTS childrenbynameindex on nodes (parenthandle, type DESC, nameKey, nodehandle)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (childrenbynameindex): " << sqlite3_errmsg(db);
+    }
+}
+
+void SqliteAccountState::setBlobCompression(bool enable)
+{
+    mCompressNodeBlobs = enable;
+}
+
+DBBlobStats SqliteAccountState::getBlobStats(bool reset)
+{
+    DBBlobStats stats = mBlobStats;
+    if (reset)
+    {
+        mBlobStats = DBBlobStats();
+    }
+    return stats;
+}
+
+int SqliteAccountState::encodeNodeBlob(std::string& blob, bool compress)
+{
+    if (!compress || blob.size() < MIN_COMPRESSED_BLOB_SIZE)
+    {
+        return NODE_BLOB_RAW;
+    }
+
+    // blobs that barely shrink are kept raw, so they're read without the cost of inflating them
+    std::string compressed;
+    if (!Deflate::compress(reinterpret_cast<const byte*>(blob.data()), blob.size(), compressed) ||
+        compressed.size() + compressed.size() / 8 >= blob.size())
+    {
+        return NODE_BLOB_RAW;
+    }
+
+    blob = std::move(compressed);
+    return NODE_BLOB_DEFLATE;
+}
+
+bool SqliteAccountState::decodeNodeBlob(const void* data, int size, int encoding, std::string& blob)
+{
+    switch (encoding)
+    {
+    case NODE_BLOB_RAW:
+        blob.assign(static_cast<const char*>(data), static_cast<size_t>(size));
+        return true;
+
+    case NODE_BLOB_DEFLATE:
+        return Deflate::decompress(static_cast<const byte*>(data), static_cast<size_t>(size), blob);
+
+    default:
+        // written by a newer version
+        LOG_err << "Unknown encoding of node blob: " << encoding;
+        return false;
+    }
+}
+
+bool SqliteAccountState::readNodeBlob(const void* data, int size, int encoding, std::string& blob)
+{
+    if (encoding == NODE_BLOB_RAW)
+    {
+        return decodeNodeBlob(data, size, encoding, blob);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const bool result = decodeNodeBlob(data, size, encoding, blob);
+    ++mBlobStats.decompressed;
+    mBlobStats.decompressTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return result;
+}
+
+bool SqliteAccountState::setFullTextIndex(bool enable)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    if (enable == mFullTextIndex)
+    {
+        return true;
+    }
+
+    nodesWritten();
+
+    sqlite3_finalize(mStmtPutFullText);
+    mStmtPutFullText = nullptr;
+    sqlite3_finalize(mStmtDelFullText);
+    mStmtDelFullText = nullptr;
+
+    if (!enable)
+    {
+        // not kept in sync anymore
+        mFullTextIndex = false;
+        int result = sqlite3_exec(db, "DROP TABLE IF EXISTS nodesfts", nullptr, nullptr, nullptr);
+        errorHandler(result, "Drop full-text index", false);
+        return result == SQLITE_OK;
+    }
+
+    // the trigram tokenizer allows substring look-ups, as the patterns of the filters need.
+    // FTS5 is an optional feature of SQLite
+    int result = sqlite3_exec(db,
+                              "CREATE VIRTUAL TABLE nodesfts USING fts5(name, description, tags, fallback, tokenize = 'trigram')",
+                              nullptr, nullptr, nullptr);
+    if (result != SQLITE_OK)
+    {
+        LOG_warn << "Full-text index not available: " << sqlite3_errmsg(db);
+        return false;
+    }
+    mFullTextIndex = true;
+
+    sqlite3_stmt* stmt = nullptr;
+    result = sqlite3_prepare_v2(db, "SELECT nodehandle, name, description, tags FROM nodes", -1, &stmt, NULL);
+    uint64_t numRows = 0;
+    bool success = result == SQLITE_OK;
+    while (success && (result = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        auto text = [stmt](int column) -> std::optional<std::string>
+        {
+            const unsigned char* value = sqlite3_column_text(stmt, column);
+            if (!value)
+            {
+                return std::nullopt;
+            }
+            return std::string(reinterpret_cast<const char*>(value), static_cast<size_t>(sqlite3_column_bytes(stmt, column)));
+        };
+
+        success = putFullTextRow(sqlite3_column_int64(stmt, 0), text(1), text(2), text(3));
+        ++numRows;
+    }
+    success = success && result == SQLITE_DONE;
+    errorHandler(result, "Populate full-text index", false);
+    sqlite3_finalize(stmt);
+
+    if (!success)
+    {
+        setFullTextIndex(false);
+        return false;
+    }
+
+    LOG_debug << "Full-text index created for " << numRows << " nodes";
+    return true;
+}
+
+bool SqliteAccountState::setChangeJournal(bool enable)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    if (enable == mChangeJournal)
+    {
+        return true;
+    }
+
+    sqlite3_finalize(mStmtPutNodeChange);
+    mStmtPutNodeChange = nullptr;
+    sqlite3_finalize(mStmtGetNodeChanges);
+    mStmtGetNodeChanges = nullptr;
+
+    // AUTOINCREMENT, so sequences of removed entries aren't assigned again. Dropping the
+    // table would restart them, so the last one is kept in nodechangeslast while the journal
+    // is disabled and restored plus one when it's created again. That skipped sequence tells
+    // consumers that changes made meanwhile weren't recorded, instead of them reading the new
+    // entries as a continuation (or skipping them because their cursor is ahead)
+    int result = sqlite3_exec(db,
+                              enable ? "SAVEPOINT nodechangesjournal; "
+                                       "CREATE TABLE IF NOT EXISTS nodechanges (seq INTEGER PRIMARY KEY AUTOINCREMENT, "
+                                       "nodehandle int64 NOT NULL, changes int64 NOT NULL, scsn int64); "
+                                       "CREATE TABLE IF NOT EXISTS nodechangeslast (seq int64 NOT NULL); "
+                                       "INSERT INTO sqlite_sequence (name, seq) SELECT 'nodechanges', MAX(seq) + 1 FROM nodechangeslast "
+                                       "HAVING COUNT(*) > 0; "
+                                       "DROP TABLE nodechangeslast; "
+                                       "RELEASE nodechangesjournal"
+                                     : "SAVEPOINT nodechangesjournal; "
+                                       "CREATE TABLE IF NOT EXISTS nodechangeslast (seq int64 NOT NULL); "
+                                       "DELETE FROM nodechangeslast; "
+                                       "INSERT INTO nodechangeslast (seq) SELECT seq FROM sqlite_sequence WHERE name = 'nodechanges'; "
+                                       "DROP TABLE IF EXISTS nodechanges; "
+                                       "RELEASE nodechangesjournal",
+                              nullptr, nullptr, nullptr);
+    errorHandler(result, enable ? "Create node change journal" : "Drop node change journal", false);
+    if (result != SQLITE_OK)
+    {
+        return false;
+    }
+
+    mChangeJournal = enable;
+    return true;
+}
+
+bool SqliteAccountState::appendNodeChanges(const std::vector<DBNodeChange>& changes, uint64_t maxChanges)
+{
+    if (!db || !mChangeJournal)
+    {
+        return false;
+    }
+
+    if (changes.empty())
+    {
+        return true;
+    }
+
+    checkTransaction();
+
+    int sqlResult = SQLITE_OK;
+    if (!mStmtPutNodeChange)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "INSERT INTO nodechanges (nodehandle, changes, scsn) VALUES (?, ?, ?)",
+                                       -1, &mStmtPutNodeChange, NULL);
+    }
+
+    for (size_t i = 0; sqlResult == SQLITE_OK && i < changes.size(); ++i)
+    {
+        const DBNodeChange& change = changes[i];
+        if ((sqlResult = sqlite3_bind_int64(mStmtPutNodeChange, 1, static_cast<sqlite3_int64>(change.node.as8byte()))) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_int64(mStmtPutNodeChange, 2, static_cast<sqlite3_int64>(change.changes))) == SQLITE_OK &&
+            (sqlResult = sqlite3_bind_int64(mStmtPutNodeChange, 3, static_cast<sqlite3_int64>(change.scsn))) == SQLITE_OK)
+        {
+            sqlResult = sqlite3_step(mStmtPutNodeChange);
+            sqlResult = sqlResult == SQLITE_DONE ? SQLITE_OK : sqlResult;
+        }
+        sqlite3_reset(mStmtPutNodeChange);
+    }
+    errorHandler(sqlResult, "Put node changes", false);
+
+    if (sqlResult == SQLITE_OK)
+    {
+        // the oldest entries go, along the rowid (seq) index
+        const std::string trim = "DELETE FROM nodechanges WHERE seq <= (SELECT MAX(seq) FROM nodechanges) - " +
+                                 std::to_string(maxChanges);
+        sqlResult = sqlite3_exec(db, trim.c_str(), nullptr, nullptr, nullptr);
+        errorHandler(sqlResult, "Trim node changes", false);
+    }
+
+    return sqlResult == SQLITE_OK;
+}
+
+bool SqliteAccountState::getNodeChanges(uint64_t afterSequence, size_t limit, std::vector<DBNodeChange>& changes,
+                                        uint64_t& oldest, uint64_t& last)
+{
+    oldest = 0;
+    last = 0;
+    if (!db || !mChangeJournal)
+    {
+        return false;
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    int sqlResult = sqlite3_prepare_v2(db,
+                                       "SELECT (SELECT MIN(seq) FROM nodechanges), "
+                                       "(SELECT seq FROM sqlite_sequence WHERE name = 'nodechanges')",
+                                       -1, &stmt, NULL);
+    if (sqlResult == SQLITE_OK && (sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        oldest = static_cast<uint64_t>(sqlite3_column_int64(stmt, 0));
+        last = static_cast<uint64_t>(sqlite3_column_int64(stmt, 1));
+        sqlResult = SQLITE_OK;
+    }
+    sqlite3_finalize(stmt);
+
+    if (sqlResult == SQLITE_OK && !mStmtGetNodeChanges)
+    {
+        sqlResult = sqlite3_prepare_v2(db,
+                                       "SELECT seq, nodehandle, changes, scsn FROM nodechanges WHERE seq > ? ORDER BY seq LIMIT ?",
+                                       -1, &mStmtGetNodeChanges, NULL);
+    }
+
+    const sqlite3_int64 pageSize = limit ? static_cast<sqlite3_int64>(limit) : -1;
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtGetNodeChanges, 1, static_cast<sqlite3_int64>(afterSequence))) == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtGetNodeChanges, 2, pageSize)) == SQLITE_OK)
+    {
+        while ((sqlResult = sqlite3_step(mStmtGetNodeChanges)) == SQLITE_ROW)
+        {
+            DBNodeChange change;
+            change.sequence = static_cast<uint64_t>(sqlite3_column_int64(mStmtGetNodeChanges, 0));
+            change.node.set6byte(static_cast<uint64_t>(sqlite3_column_int64(mStmtGetNodeChanges, 1)));
+            change.changes = static_cast<uint64_t>(sqlite3_column_int64(mStmtGetNodeChanges, 2));
+            change.scsn = static_cast<handle>(sqlite3_column_int64(mStmtGetNodeChanges, 3));
+            changes.push_back(change);
+        }
+    }
+
+    errorHandler(sqlResult, "Get node changes", false);
+    if (mStmtGetNodeChanges)
+    {
+        sqlite3_reset(mStmtGetNodeChanges);
+    }
+
+    return sqlResult == SQLITE_DONE;
+}
+
+bool SqliteAccountState::putFullTextRow(handle nodehandle,
+                                        const std::optional<std::string>& name,
+                                        const std::optional<std::string>& description,
+                                        const std::optional<std::string>& tags)
+{
+    int sqlResult = SQLITE_OK;
+    if (!mStmtPutFullText)
+    {
+        // FTS5 tables don't support REPLACE nor UPSERT, so the previous row is deleted first
+        sqlResult = sqlite3_prepare_v2(db,
+                                       "INSERT INTO nodesfts (rowid, name, description, tags, fallback) VALUES (?, ?, ?, ?, ?)",
+                                       -1, &mStmtPutFullText, NULL);
+    }
+
+    if (sqlResult != SQLITE_OK || !removeFullTextRow(nodehandle))
+    {
+        errorHandler(sqlResult, "Put full-text row", false);
+        return false;
+    }
+
+    // texts that can't be folded are stored as NULL, and the node is matched by 'fallback'
+    bool unfoldable = false;
+    auto fold = [&unfoldable](const std::optional<std::string>& text, std::string& folded)
+    {
+        if (text && !foldCaseAccent(*text, folded))
+        {
+            unfoldable = true;
+            return false;
+        }
+        return text.has_value();
+    };
+
+    std::string foldedName;
+    std::string foldedDescription;
+    std::string foldedTags;
+    // nodes without a name pass any name filter
+    const bool hasName = fold(name, foldedName);
+    unfoldable = unfoldable || !hasName;
+    const bool hasDescription = fold(description, foldedDescription);
+    const bool hasTags = fold(tags, foldedTags);
+
+    auto bindOptionalText = [this](int index, bool has, const std::string& text)
+    {
+        return has ? sqlite3_bind_text(mStmtPutFullText, index, text.c_str(), static_cast<int>(text.size()), SQLITE_STATIC)
+                   : sqlite3_bind_null(mStmtPutFullText, index);
+    };
+
+    if ((sqlResult = sqlite3_bind_int64(mStmtPutFullText, 1, static_cast<sqlite3_int64>(nodehandle))) == SQLITE_OK &&
+        (sqlResult = bindOptionalText(2, hasName, foldedName)) == SQLITE_OK &&
+        (sqlResult = bindOptionalText(3, hasDescription, foldedDescription)) == SQLITE_OK &&
+        (sqlResult = bindOptionalText(4, hasTags, foldedTags)) == SQLITE_OK &&
+        (sqlResult = unfoldable ? sqlite3_bind_text(mStmtPutFullText, 5, "yes", 3, SQLITE_STATIC)
+                                : sqlite3_bind_null(mStmtPutFullText, 5)) == SQLITE_OK)
+    {
+        sqlResult = sqlite3_step(mStmtPutFullText);
+    }
+
+    errorHandler(sqlResult, "Put full-text row", false);
+    sqlite3_reset(mStmtPutFullText);
+
+    return sqlResult == SQLITE_DONE;
+}
+
+bool SqliteAccountState::removeFullTextRow(handle nodehandle)
+{
+    int sqlResult = SQLITE_OK;
+    if (!mStmtDelFullText)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "DELETE FROM nodesfts WHERE rowid = ?", -1, &mStmtDelFullText, NULL);
+    }
+
+    if (sqlResult == SQLITE_OK &&
+        (sqlResult = sqlite3_bind_int64(mStmtDelFullText, 1, static_cast<sqlite3_int64>(nodehandle))) == SQLITE_OK)
+    {
+        sqlResult = sqlite3_step(mStmtDelFullText);
+    }
+
+    errorHandler(sqlResult, "Delete full-text row", false);
+    sqlite3_reset(mStmtDelFullText);
+
+    return sqlResult == SQLITE_DONE;
+}
+
+std::string SqliteAccountState::getFullTextQuery(const NodeSearchFilter& filter) const
+{
+    if (!mFullTextIndex)
+    {
+        return {};
+    }
+
+    // every literal sequence of a pattern must be in the column. Shorter ones than a trigram
+    // can't be looked up, so they're skipped
+    auto condition = [](const char* column, const std::string& pattern)
+    {
+        std::string expression;
+        for (const std::string& literal : getPatternLiterals(pattern))
+        {
+            std::string folded;
+            if (!foldCaseAccent(literal, folded) ||
+                std::count_if(folded.begin(), folded.end(), [](char c) { return (c & 0xC0) != 0x80; }) < 3)
+            {
+                continue;
+            }
+
+            std::string phrase;
+            for (char c : folded)
+            {
+                phrase += c;
+                if (c == '"')
+                {
+                    phrase += c;
+                }
+            }
+            expression += (expression.empty() ? "" : " AND ") + std::string(column) + " : \"" + phrase + "\"";
+        }
+        return expression;
+    };
+
+    std::vector<std::string> conditions;
+    bool allNarrowed = true;
+    auto addCondition = [&conditions, &allNarrowed, &condition](bool present, const char* column, const std::string& pattern)
+    {
+        if (!present)
+        {
+            return;
+        }
+
+        std::string expression = condition(column, pattern);
+        if (expression.empty())
+        {
+            allNarrowed = false;
+        }
+        else
+        {
+            conditions.push_back("(" + expression + ")");
+        }
+    };
+    addCondition(filter.hasName(), "name", filter.byName());
+    addCondition(filter.hasDescription(), "description", filter.byDescription());
+    addCondition(filter.hasTag(), "tags", filter.byTag());
+
+    // with OR, a condition that can't be narrowed could match any node
+    if (conditions.empty() || (!filter.useAndForTextQuery() && !allNarrowed))
+    {
+        return {};
+    }
+
+    return "(" + joinStrings(conditions.begin(), conditions.end(), filter.useAndForTextQuery() ? " AND " : " OR ") +
+           ") OR fallback : \"yes\"";
+}
+
+void SqliteAccountState::setBulkLoad(bool enable)
+{
+    if (!db || enable == mBulkLoad)
+    {
+        return;
+    }
+
+    mBulkLoad = enable;
+    LOG_debug << "DB bulk load mode " << (enable ? "enabled" : "disabled");
+
+    if (enable)
+    {
+        mSynchronousBeforeBulkLoad = static_cast<int>(getPragma("synchronous", mSynchronousBeforeBulkLoad));
+        mCacheSizeBeforeBulkLoad = getPragma("cache_size", mCacheSizeBeforeBulkLoad);
+
+        execPragma("synchronous=OFF");
+        execPragma("cache_size=-65536"); // 64 MiB
+        execPragma("mmap_size=268435456"); // 256 MiB
+        // no other connection reads the DB meanwhile, so the lock is taken once
+        execPragma("locking_mode=EXCLUSIVE");
+
+        // indexes are maintained row by row, it's cheaper to build them once at the end
+        for (const char* index : {"parenthandleindex", "fingerprintindex", "origFingerprintindex", "shareindex", "favindex", "ctimeindex"})
+        {
+            std::string sql = std::string("DROP INDEX IF EXISTS ") + index;
+            int result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+            if (result)
+            {
+                LOG_err << "Data base error while dropping index (" << index << "): " << sqlite3_errmsg(db);
+            }
+        }
+
+        // same for the aggregates of folders, whose triggers would count children without index
+        dropNodeCounterTriggers(db);
+        setNodeCountersEnabled(false);
+    }
+    else
+    {
+        execPragma("synchronous=" + std::to_string(mSynchronousBeforeBulkLoad));
+        execPragma("cache_size=" + std::to_string(mCacheSizeBeforeBulkLoad));
+        execPragma("mmap_size=0");
+        // the exclusive lock is released upon the next access to the DB, before pooled
+        // connections try to read it
+        execPragma("locking_mode=NORMAL");
+        sqlite3_exec(db, "SELECT 1 FROM nodes LIMIT 1", nullptr, nullptr, nullptr);
+
+        setNodeCountersEnabled(buildNodeCounters(db));
+    }
+}
+
+void SqliteAccountState::setNodeCountersEnabled(bool enabled)
+{
+    mNodeCounters = enabled;
+
+    // the look-ups differ with and without table nodecounters
+    sqlite3_finalize(mStmtNumChildren);
+    mStmtNumChildren = nullptr;
+}
+
+namespace
+{
+// columns of table nodecounters taken from the node counter in 'counter'
+std::string nodeCounterValues(const std::string& counter)
+{
+    std::string values;
+    for (int field : {SqliteAccountState::NODE_COUNTER_STORAGE,
+                      SqliteAccountState::NODE_COUNTER_VERSION_STORAGE,
+                      SqliteAccountState::NODE_COUNTER_FILES,
+                      SqliteAccountState::NODE_COUNTER_FOLDERS,
+                      SqliteAccountState::NODE_COUNTER_VERSIONS})
+    {
+        values += ", getFieldFromNodeCounter(" + counter + ", " + std::to_string(field) + ")";
+    }
+    return values;
+}
+
+const char* const nodeCounterTriggers[] = {"nodecounters_replace",
+                                           "nodecounters_insert",
+                                           "nodecounters_update",
+                                           "nodecounters_move",
+                                           "nodecounters_delete"};
+}
 
-    int sqlResult = SQLITE_OK;
-    if (!mStmtUpdateNodeAndFlags)
+bool SqliteAccountState::hasNodeCounters(sqlite3* db)
+{
+    sqlite3_stmt* stmt = nullptr;
+    bool found = false;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type = 'trigger' AND name = 'nodecounters_insert'", -1, &stmt, nullptr) == SQLITE_OK)
     {
-        sqlResult = sqlite3_prepare_v2(db, "UPDATE nodes SET counter = ?, flags = ? WHERE nodehandle = ?", -1, &mStmtUpdateNodeAndFlags, NULL);
+        found = sqlite3_step(stmt) == SQLITE_ROW;
     }
+    sqlite3_finalize(stmt);
+    return found;
+}
 
-    if (sqlResult == SQLITE_OK)
+void SqliteAccountState::dropNodeCounterTriggers(sqlite3* db)
+{
+    for (const char* trigger : nodeCounterTriggers)
     {
-        if ((sqlResult = sqlite3_bind_blob(mStmtUpdateNodeAndFlags, 1, nodeCounterBlob.data(), static_cast<int>(nodeCounterBlob.size()), SQLITE_STATIC)) == SQLITE_OK)
+        std::string sql = std::string("DROP TRIGGER IF EXISTS ") + trigger;
+        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
         {
-            if ((sqlResult = sqlite3_bind_int64(mStmtUpdateNodeAndFlags, 2, flags)) == SQLITE_OK)
-            {
-                if ((sqlResult = sqlite3_bind_int64(mStmtUpdateNodeAndFlags, 3, nodeHandle.as8byte())) == SQLITE_OK)
-                {
-                    sqlResult = sqlite3_step(mStmtUpdateNodeAndFlags);
-                }
-            }
+            LOG_err << "Data base error while dropping trigger (" << trigger << "): " << sqlite3_errmsg(db);
         }
     }
+}
 
-    errorHandler(sqlResult, "Update counter and flags", false);
+bool SqliteAccountState::buildNodeCounters(sqlite3* db)
+{
+    static const std::string columns = "nodehandle, storage, versionstorage, files, folders, versions, children";
+    static const std::string notFile = std::to_string(FILENODE);
+
+    // An INSERT OR REPLACE of nodes doesn't fire the DELETE trigger for the replaced row (unless
+    // recursive_triggers is enabled), so the BEFORE INSERT trigger discounts it from its parent.
+    // Folders inserted after their children count them once; later, children are counted one by one
+    // Disabling format for query readability
+    // clang-format off
+    const std::string sql =
+        "SAVEPOINT nodecounters; "
+        "CREATE TABLE IF NOT EXISTS nodecounters (nodehandle INTEGER PRIMARY KEY NOT NULL, "
+            "storage int64 NOT NULL, versionstorage int64 NOT NULL, files int64 NOT NULL, "
+            "folders int64 NOT NULL, versions int64 NOT NULL, children int64 NOT NULL); "
+        "DELETE FROM nodecounters; "
+        "INSERT INTO nodecounters (" + columns + ") "
+            "SELECT N.nodehandle" + nodeCounterValues("N.counter") + ", IFNULL(C.children, 0) "
+            "FROM nodes AS N LEFT JOIN (SELECT parenthandle, count(*) AS children FROM nodes GROUP BY parenthandle) AS C "
+            "ON (C.parenthandle = N.nodehandle) WHERE N.type != " + notFile + "; "
+        "CREATE TRIGGER nodecounters_replace BEFORE INSERT ON nodes BEGIN "
+            "UPDATE nodecounters SET children = children - 1 "
+            "WHERE nodehandle = (SELECT parenthandle FROM nodes WHERE nodehandle = NEW.nodehandle); "
+        "END; "
+        "CREATE TRIGGER nodecounters_insert AFTER INSERT ON nodes BEGIN "
+            "UPDATE nodecounters SET children = children + 1 WHERE nodehandle = NEW.parenthandle; "
+            "INSERT INTO nodecounters (" + columns + ") "
+                "SELECT NEW.nodehandle" + nodeCounterValues("NEW.counter") + ", "
+                "(SELECT count(*) FROM nodes WHERE parenthandle = NEW.nodehandle) "
+                "WHERE NEW.type != " + notFile + " "
+                "ON CONFLICT (nodehandle) DO UPDATE SET storage = excluded.storage, "
+                "versionstorage = excluded.versionstorage, files = excluded.files, "
+                "folders = excluded.folders, versions = excluded.versions; "
+        "END; "
+        "CREATE TRIGGER nodecounters_update AFTER UPDATE OF counter ON nodes WHEN NEW.type != " + notFile + " BEGIN "
+            "UPDATE nodecounters SET (storage, versionstorage, files, folders, versions) = "
+                "(SELECT " + nodeCounterValues("NEW.counter").substr(2) + ") "
+            "WHERE nodehandle = NEW.nodehandle; "
+        "END; "
+        "CREATE TRIGGER nodecounters_move AFTER UPDATE OF parenthandle ON nodes "
+        "WHEN OLD.parenthandle IS NOT NEW.parenthandle BEGIN "
+            "UPDATE nodecounters SET children = children - 1 WHERE nodehandle = OLD.parenthandle; "
+            "UPDATE nodecounters SET children = children + 1 WHERE nodehandle = NEW.parenthandle; "
+        "END; "
+        "CREATE TRIGGER nodecounters_delete AFTER DELETE ON nodes BEGIN "
+            "UPDATE nodecounters SET children = children - 1 WHERE nodehandle = OLD.parenthandle; "
+            "DELETE FROM nodecounters WHERE nodehandle = OLD.nodehandle; "
+        "END; "
+        "RELEASE nodecounters";
+    // clang-format on
+
+    dropNodeCounterTriggers(db);
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        // i.e. SQLite older than 3.24 (no upserts)
+        LOG_warn << "Data base error while building the aggregates of folders: " << sqlite3_errmsg(db);
+        sqlite3_exec(db, "ROLLBACK TO nodecounters; RELEASE nodecounters", nullptr, nullptr, nullptr);
+        return false;
+    }
+    return true;
+}
 
-    sqlite3_reset(mStmtUpdateNodeAndFlags);
+bool SqliteAccountState::registerFunctions(sqlite3* db)
+{
+    if (sqlite3_create_function(db, u8"getmimetype", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0, &SqliteAccountState::userGetMimetype, 0, 0) != SQLITE_OK)
+    {
+        LOG_err << "Data base error(sqlite3_create_function userGetMimetype): " << sqlite3_errmsg(db);
+        return false;
+    }
+
+    if (sqlite3_create_function(db,
+                                u8"getSizeFromNodeCounter",
+                                1,
+                                SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                0,
+                                &SqliteAccountState::getSizeFromNodeCounter,
+                                0,
+                                0) != SQLITE_OK)
+    {
+        LOG_err << "Data base error(sqlite3_create_function getSizeFromNodeCounter): "
+                << sqlite3_errmsg(db);
+        return false;
+    }
+
+    if (sqlite3_create_function(db,
+                                u8"getFieldFromNodeCounter",
+                                2,
+                                SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                0,
+                                &SqliteAccountState::getFieldFromNodeCounter,
+                                0,
+                                0) != SQLITE_OK)
+    {
+        LOG_err << "Data base error(sqlite3_create_function getFieldFromNodeCounter): "
+                << sqlite3_errmsg(db);
+        return false;
+    }
+
+    if (sqlite3_create_function(db,
+                                u8"naturalsortkey",
+                                1,
+                                SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                0,
+                                &SqliteAccountState::userNaturalSortKey,
+                                0,
+                                0) != SQLITE_OK)
+    {
+        LOG_err << "Data base error(sqlite3_create_function userNaturalSortKey): "
+                << sqlite3_errmsg(db);
+        return false;
+    }
+
+    if (sqlite3_create_function(db, "regexp", 2, SQLITE_ANY,0, &SqliteAccountState::userRegexp, 0, 0))
+    {
+        LOG_err << "Data base error(sqlite3_create_function userRegexp): " << sqlite3_errmsg(db);
+        return false;
+    }
+
+    if (sqlite3_create_function(db,
+                                "matchFilter",
+                                11,
+                                SQLITE_ANY,
+                                0,
+                                &SqliteAccountState::userMatchFilter,
+                                0,
+                                0))
+    {
+        LOG_err << "Data base error(sqlite3_create_function userMatchFilter): "
+                << sqlite3_errmsg(db);
+        return false;
+    }
+
+    return true;
 }
 
-void SqliteAccountState::createIndexes()
+void SqliteAccountState::commit()
 {
-    if (!db)
+    SqliteDbTable::commit();
+
+    if (!inTransaction())
     {
-        return;
+        mPendingNodeWrites = false;
     }
-    // Create index for column that is not primary key (which already has an index by default)
-    std::string sql = "CREATE INDEX IF NOT EXISTS parenthandleindex on nodes (parenthandle)";
-    int result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+}
+
+void SqliteAccountState::abort()
+{
+    SqliteDbTable::abort();
+
+    if (!inTransaction())
     {
-        LOG_err << "Data base error while creating index (parenthandleindex): " << sqlite3_errmsg(db);
+        mPendingNodeWrites = false;
     }
+}
 
-    sql = "CREATE INDEX IF NOT EXISTS fingerprintindex on nodes (fingerprint)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+void SqliteAccountState::nodesWritten()
+{
+    // out of a transaction, changes are committed right away
+    if (inTransaction())
     {
-        LOG_err << "Data base error while creating index (fingerprintindex): " << sqlite3_errmsg(db);
+        mPendingNodeWrites = true;
     }
+}
 
-#if defined( __ANDROID__) || defined(USE_IOS)
-    sql = "CREATE INDEX IF NOT EXISTS origFingerprintindex on nodes (origFingerprint)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+SqliteAccountState::ReadLease SqliteAccountState::acquireReadConnection()
+{
+    // in bulk load mode, the primary connection holds an exclusive lock
+    if (mReadPool.enabled() && !mBulkLoad && !mPendingNodeWrites)
     {
-        LOG_err << "Data base error while creating index (origFingerprintindex): " << sqlite3_errmsg(db);
+        if (ReadConnection* connection = mReadPool.acquire())
+        {
+            return ReadLease(&mReadPool, connection);
+        }
+    }
+
+    mReadPool.countPrimary();
+    return ReadLease(nullptr, &mPrimaryReads);
+}
+
+DBReadPoolStats SqliteAccountState::getReadPoolStats(bool reset)
+{
+    return mReadPool.stats(reset);
+}
+
+void SqliteAccountState::ReadConnection::finalise()
+{
+    for (auto& s : stmtGetChildren)
+    {
+        sqlite3_finalize(s.second);
+    }
+    stmtGetChildren.clear();
+
+    for (auto& s : stmtSearchNodes)
+    {
+        sqlite3_finalize(s.second);
+    }
+    stmtSearchNodes.clear();
+
+    sqlite3_finalize(stmtNodesByFp);
+    stmtNodesByFp = nullptr;
+
+    sqlite3_finalize(stmtVersions);
+    stmtVersions = nullptr;
+
+    sqlite3_finalize(stmtNodeByFp);
+    stmtNodeByFp = nullptr;
+
+    sqlite3_finalize(stmtRecents);
+    stmtRecents = nullptr;
+
+    sqlite3_finalize(stmtNodeBlob);
+    stmtNodeBlob = nullptr;
+}
+
+void SqliteAccountState::ReadConnectionPool::enable(const LocalPath& path, size_t maxConnections)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    mPath = path;
+    mMaxConnections = maxConnections;
+}
+
+bool SqliteAccountState::ReadConnectionPool::enabled() const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return mMaxConnections > 0;
+}
+
+sqlite3* SqliteAccountState::ReadConnectionPool::open() const
+{
+    sqlite3* db = nullptr;
+    // a connection is used by one thread at a time, so SQLite doesn't need to serialize calls
+    int result = sqlite3_open_v2(mPath.toPath(false).c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+    if (result != SQLITE_OK || !registerFunctions(db))
+    {
+        LOG_err << "Unable to open read-only connection to " << mPath << ": " << (db ? sqlite3_errmsg(db) : "");
+        sqlite3_close(db);
+        return nullptr;
     }
+
+    // in case the primary connection is checkpointing or releasing an exclusive lock
+    sqlite3_busy_timeout(db, 1000);
+
+#if __ANDROID__
+    // see SqliteDbAccess::openTableWithNodes()
+    sqlite3_exec(db, "PRAGMA temp_store=2;", nullptr, nullptr, nullptr);
 #endif
 
-    sql = "CREATE INDEX IF NOT EXISTS shareindex on nodes (share)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+    return db;
+}
+
+SqliteAccountState::ReadConnection* SqliteAccountState::ReadConnectionPool::acquire()
+{
+    std::unique_lock<std::mutex> g(mMutex);
+
+    if (mIdle.empty() && mConnections.size() < mMaxConnections)
     {
-        LOG_err << "Data base error while creating index (shareindex): " << sqlite3_errmsg(db);
+        if (sqlite3* db = open())
+        {
+            mConnections.emplace_back(new ReadConnection);
+            mConnections.back()->db = db;
+            mIdle.push_back(mConnections.back().get());
+        }
+        else
+        {
+            // don't retry on every query
+            mMaxConnections = mConnections.size();
+        }
     }
 
-    sql = "CREATE INDEX IF NOT EXISTS favindex on nodes (fav)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+    if (mConnections.empty())
     {
-        LOG_err << "Data base error while creating index (favindex): " << sqlite3_errmsg(db);
+        return nullptr;
     }
 
-    sql = "CREATE INDEX IF NOT EXISTS ctimeindex on nodes (ctime)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+    if (mIdle.empty())
     {
-        LOG_err << "Data base error while creating index (ctimeindex): " << sqlite3_errmsg(db);
+        ++mStats.waits;
+        auto start = std::chrono::steady_clock::now();
+        mReleased.wait(g, [this]() { return !mIdle.empty(); });
+        auto waited = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        mStats.waitTime += waited;
+        mStats.longestWait = std::max(mStats.longestWait, waited);
+    }
+
+    ++mStats.pooled;
+    ReadConnection* connection = mIdle.back();
+    mIdle.pop_back();
+    return connection;
+}
+
+void SqliteAccountState::ReadConnectionPool::release(ReadConnection* connection)
+{
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mIdle.push_back(connection);
+    }
+    mReleased.notify_one();
+}
+
+void SqliteAccountState::ReadConnectionPool::countPrimary()
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    ++mStats.primary;
+}
+
+void SqliteAccountState::ReadConnectionPool::close()
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    assert(mIdle.size() == mConnections.size());
+
+    for (auto& connection : mConnections)
+    {
+        connection->finalise();
+        sqlite3_close(connection->db);
+    }
+    mConnections.clear();
+    mIdle.clear();
+    mMaxConnections = 0;
+}
+
+DBReadPoolStats SqliteAccountState::ReadConnectionPool::stats(bool reset)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    DBReadPoolStats stats = mStats;
+    if (reset)
+    {
+        mStats = DBReadPoolStats();
+    }
+    return stats;
+}
+
+SqliteAccountState::ReadLease::ReadLease(ReadConnectionPool* pool, ReadConnection* connection)
+    : mPool(pool)
+    , mConnection(connection)
+{
+}
+
+SqliteAccountState::ReadLease::ReadLease(ReadLease&& other) noexcept
+    : mPool(other.mPool)
+    , mConnection(other.mConnection)
+{
+    other.mPool = nullptr;
+}
+
+SqliteAccountState::ReadLease::~ReadLease()
+{
+    if (mPool)
+    {
+        mPool->release(mConnection);
     }
 }
 
@@ -1183,6 +2730,27 @@ void SqliteAccountState::finalise()
     sqlite3_finalize(mStmtPutNode);
     mStmtPutNode = nullptr;
 
+    sqlite3_finalize(mStmtPutNodes);
+    mStmtPutNodes = nullptr;
+
+    sqlite3_finalize(mStmtPutNodeBlob);
+    mStmtPutNodeBlob = nullptr;
+
+    sqlite3_finalize(mStmtPutNodeBlobs);
+    mStmtPutNodeBlobs = nullptr;
+
+    sqlite3_finalize(mStmtPutFullText);
+    mStmtPutFullText = nullptr;
+
+    sqlite3_finalize(mStmtDelFullText);
+    mStmtDelFullText = nullptr;
+
+    sqlite3_finalize(mStmtPutNodeChange);
+    mStmtPutNodeChange = nullptr;
+
+    sqlite3_finalize(mStmtGetNodeChanges);
+    mStmtGetNodeChanges = nullptr;
+
     sqlite3_finalize(mStmtUpdateNode);
     mStmtUpdateNode = nullptr;
 
@@ -1198,47 +2766,203 @@ void SqliteAccountState::finalise()
     sqlite3_finalize(mStmtChildrenFromType);
     mStmtChildrenFromType = nullptr;
 
-    sqlite3_finalize(mStmtNumChildren);
-    mStmtNumChildren = nullptr;
+    sqlite3_finalize(mStmtNumChildren);
+    mStmtNumChildren = nullptr;
+
+    sqlite3_finalize(mStmtFolderCounter);
+    mStmtFolderCounter = nullptr;
+
+    for (auto& s : mStmtGetChildrenFrom)
+    {
+        sqlite3_finalize(s.second);
+    }
+    mStmtGetChildrenFrom.clear();
+
+    sqlite3_finalize(mStmtGetSubtree);
+    mStmtGetSubtree = nullptr;
+
+    sqlite3_finalize(mStmtAllNodeTags);
+    mStmtAllNodeTags = nullptr;
+
+    sqlite3_finalize(mStmtNodeByOrigFp);
+    mStmtNodeByOrigFp = nullptr;
+
+    sqlite3_finalize(mStmtChildNode);
+    mStmtChildNode = nullptr;
+
+    sqlite3_finalize(mStmtIsAncestor);
+    mStmtIsAncestor = nullptr;
+
+    sqlite3_finalize(mStmtNumChild);
+    mStmtNumChild = nullptr;
+
+    sqlite3_finalize(mStmtFavourites);
+    mStmtFavourites = nullptr;
+
+    mPrimaryReads.finalise();
+    mReadPool.close();
+}
+
+SqliteAccountState::NodeRow::NodeRow(const Node& node, bool serializeNode):
+    nodehandle(node.nodehandle),
+    parenthandle(node.parenthandle),
+    name(node.displayname()),
+    nameKey(naturalsorting_key(name)),
+    type(node.type),
+    shareType(node.getShareType()),
+    ctime(node.ctime),
+    mtime(node.mtime),
+    flags(node.getDBFlags()),
+    counter(node.getCounter().serialize())
+{
+    if (serializeNode)
+    {
+        node.serialize(&serialized);
+        assert(serialized.size());
+        rawSize = serialized.size();
+    }
+
+    node.FileFingerprint::serialize(&fingerprint);
+
+    attr_map::const_iterator attrIt = node.attrs.map.find(MAKENAMEID2('c', '0'));
+    if (attrIt != node.attrs.map.end())
+    {
+       origFingerprint = attrIt->second;
+    }
+
+    // node->attrstring has value => node is encrypted
+    static nameid favId = AttrMap::string2nameid("fav");
+    auto favIt = node.attrs.map.find(favId);
+    fav = (favIt != node.attrs.map.end() && favIt->second == "1"); // test 'fav' attr value (only "1" is valid)
+
+    static nameid labelId = AttrMap::string2nameid("lbl");
+    auto labelIt = node.attrs.map.find(labelId);
+    label = (labelIt == node.attrs.map.end()) ? LBL_UNKNOWN : std::atoi(labelIt->second.c_str());
+
+    static nameid descriptionId = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION);
+    if (auto descriptionIt = node.attrs.map.find(descriptionId);
+        descriptionIt != node.attrs.map.end())
+    {
+        description = descriptionIt->second;
+    }
+
+    static nameid tagId = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS);
+    if (auto tagIt = node.attrs.map.find(tagId); tagIt != node.attrs.map.end())
+    {
+        tags = tagIt->second;
+    }
+}
+
+void SqliteAccountState::bindNodeRow(sqlite3_stmt* stmt, int first, const NodeRow& row)
+{
+    // values are bound as SQLITE_STATIC, so 'row' must outlive the statement's step
+    auto bindOptionalText = [stmt](int index, const std::optional<std::string>& text)
+    {
+        if (text)
+        {
+            sqlite3_bind_text(stmt, index, text->c_str(), static_cast<int>(text->length()), SQLITE_STATIC);
+        }
+        else
+        {
+            sqlite3_bind_null(stmt, index);
+        }
+    };
+
+    sqlite3_bind_int64(stmt, first, row.nodehandle);
+    sqlite3_bind_int64(stmt, first + 1, row.parenthandle);
+    sqlite3_bind_text(stmt, first + 2, row.name.c_str(), static_cast<int>(row.name.length()), SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, first + 3, row.fingerprint.data(), static_cast<int>(row.fingerprint.size()), SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, first + 4, row.origFingerprint.data(), static_cast<int>(row.origFingerprint.size()), SQLITE_STATIC);
+    sqlite3_bind_int(stmt, first + 5, row.type);
+    sqlite3_bind_int(stmt, first + 6, row.shareType);
+    sqlite3_bind_int(stmt, first + 7, row.fav);
+    sqlite3_bind_int64(stmt, first + 8, row.ctime);
+    sqlite3_bind_int64(stmt, first + 9, row.mtime);
+    sqlite3_bind_int64(stmt, first + 10, static_cast<sqlite3_int64>(row.flags));
+    sqlite3_bind_blob(stmt, first + 11, row.counter.data(), static_cast<int>(row.counter.size()), SQLITE_STATIC);
+    sqlite3_bind_int(stmt, first + 12, row.label);
+    bindOptionalText(first + 13, row.description);
+    bindOptionalText(first + 14, row.tags);
+    sqlite3_bind_text(stmt, first + 15, row.nameKey.c_str(), static_cast<int>(row.nameKey.length()), SQLITE_STATIC);
+}
 
-    for (auto& s : mStmtGetChildren)
+std::string SqliteAccountState::putNodesSql(size_t numRows)
+{
+    std::string sql = "INSERT OR REPLACE INTO nodes (nodehandle, parenthandle, "
+                      "name, fingerprint, origFingerprint, type, share, fav, ctime, "
+                      "mtime, flags, counter, label, description, tags, nameKey) "
+                      "VALUES ";
+    for (size_t i = 0; i < numRows; ++i)
     {
-        sqlite3_finalize(s.second);
+        sql += i ? ", (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)" : "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
     }
-    mStmtGetChildren.clear();
+    return sql;
+}
 
-    for (auto& s : mStmtSearchNodes)
+std::string SqliteAccountState::putNodeBlobsSql(size_t numRows)
+{
+    std::string sql = "INSERT OR REPLACE INTO nodeblobs (nodehandle, node, encoding) VALUES ";
+    for (size_t i = 0; i < numRows; ++i)
     {
-        sqlite3_finalize(s.second);
+        sql += i ? ", (?, ?, ?)" : "(?, ?, ?)";
     }
-    mStmtSearchNodes.clear();
+    return sql;
+}
 
-    sqlite3_finalize(mStmtAllNodeTags);
-    mStmtAllNodeTags = nullptr;
+bool SqliteAccountState::putNodeRows(const NodeRow* rows, size_t numRows)
+{
+    // statements are cached for single rows and for full multi-row inserts
+    assert(numRows == 1 || numRows == NODE_ROWS_PER_INSERT);
+    const bool single = numRows == 1;
+    sqlite3_stmt*& nodesStmt = single ? mStmtPutNode : mStmtPutNodes;
+    sqlite3_stmt*& blobsStmt = single ? mStmtPutNodeBlob : mStmtPutNodeBlobs;
 
-    sqlite3_finalize(mStmtNodesByFp);
-    mStmtNodesByFp = nullptr;
+    int sqlResult = SQLITE_OK;
+    if (!nodesStmt)
+    {
+        sqlResult = sqlite3_prepare_v2(db, putNodesSql(numRows).c_str(), -1, &nodesStmt, NULL);
+    }
 
-    sqlite3_finalize(mStmtNodeByFp);
-    mStmtNodeByFp = nullptr;
+    if (sqlResult == SQLITE_OK && !blobsStmt)
+    {
+        sqlResult = sqlite3_prepare_v2(db, putNodeBlobsSql(numRows).c_str(), -1, &blobsStmt, NULL);
+    }
 
-    sqlite3_finalize(mStmtNodeByOrigFp);
-    mStmtNodeByOrigFp = nullptr;
+    if (sqlResult == SQLITE_OK)
+    {
+        for (size_t i = 0; i < numRows; ++i)
+        {
+            const int blobColumn = static_cast<int>(i) * 3 + 1;
+            bindNodeRow(nodesStmt, static_cast<int>(i * NODE_ROW_COLUMNS) + 1, rows[i]);
+            sqlite3_bind_int64(blobsStmt, blobColumn, rows[i].nodehandle);
+            sqlite3_bind_blob(blobsStmt, blobColumn + 1, rows[i].serialized.data(), static_cast<int>(rows[i].serialized.size()), SQLITE_STATIC);
+            sqlite3_bind_int(blobsStmt, blobColumn + 2, rows[i].blobEncoding);
+
+            ++mBlobStats.written;
+            mBlobStats.rawBytes += rows[i].rawSize;
+            mBlobStats.storedBytes += rows[i].serialized.size();
+            mBlobStats.compressed += rows[i].blobEncoding != NODE_BLOB_RAW;
+        }
 
-    sqlite3_finalize(mStmtChildNode);
-    mStmtChildNode = nullptr;
+        sqlResult = sqlite3_step(nodesStmt);
+        if (sqlResult == SQLITE_DONE)
+        {
+            sqlResult = sqlite3_step(blobsStmt);
+        }
+    }
 
-    sqlite3_finalize(mStmtIsAncestor);
-    mStmtIsAncestor = nullptr;
+    errorHandler(sqlResult, single ? "Put node" : "Put nodes", false);
 
-    sqlite3_finalize(mStmtNumChild);
-    mStmtNumChild = nullptr;
+    sqlite3_reset(nodesStmt);
+    sqlite3_reset(blobsStmt);
 
-    sqlite3_finalize(mStmtRecents);
-    mStmtRecents = nullptr;
+    bool result = sqlResult == SQLITE_DONE;
+    for (size_t i = 0; mFullTextIndex && result && i < numRows; ++i)
+    {
+        result = putFullTextRow(rows[i].nodehandle, rows[i].name, rows[i].description, rows[i].tags);
+    }
 
-    sqlite3_finalize(mStmtFavourites);
-    mStmtFavourites = nullptr;
+    return result;
 }
 
 bool SqliteAccountState::put(Node *node)
@@ -1249,114 +2973,102 @@ bool SqliteAccountState::put(Node *node)
     }
 
     checkTransaction();
+    nodesWritten();
 
-    int sqlResult = SQLITE_OK;
-    if (!mStmtPutNode)
+    NodeRow row(*node, true);
+    row.blobEncoding = encodeNodeBlob(row.serialized, mCompressNodeBlobs);
+    return putNodeRows(&row, 1);
+}
+
+bool SqliteAccountState::put(const std::vector<Node*>& nodes)
+{
+    if (!db)
     {
-        sqlResult =
-            sqlite3_prepare_v2(db,
-                               "INSERT OR REPLACE INTO nodes (nodehandle, parenthandle, "
-                               "name, fingerprint, origFingerprint, type, share, fav, ctime, "
-                               "mtime, flags, counter, node, label, description, tags) "
-                               "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)",
-                               -1,
-                               &mStmtPutNode,
-                               NULL);
+        return false;
     }
 
-    if (sqlResult == SQLITE_OK)
+    if (nodes.size() < NODE_ROWS_PER_INSERT)
     {
-        string nodeSerialized;
-        node->serialize(&nodeSerialized);
-        assert(nodeSerialized.size());
-
-        sqlite3_bind_int64(mStmtPutNode, 1, node->nodehandle);
-        sqlite3_bind_int64(mStmtPutNode, 2, node->parenthandle);
-
-        std::string name = node->displayname();
-        sqlite3_bind_text(mStmtPutNode, 3, name.c_str(), static_cast<int>(name.length()), SQLITE_STATIC);
-
-        string fp;
-        node->FileFingerprint::serialize(&fp);
-        sqlite3_bind_blob(mStmtPutNode, 4, fp.data(), static_cast<int>(fp.size()), SQLITE_STATIC);
-
-        std::string origFingerprint;
-        attr_map::const_iterator attrIt = node->attrs.map.find(MAKENAMEID2('c', '0'));
-        if (attrIt != node->attrs.map.end())
-        {
-           origFingerprint = attrIt->second;
-        }
-        sqlite3_bind_blob(mStmtPutNode, 5, origFingerprint.data(), static_cast<int>(origFingerprint.size()), SQLITE_STATIC);
-
-        sqlite3_bind_int(mStmtPutNode, 6, node->type);
-
-        int shareType = node->getShareType();
-        sqlite3_bind_int(mStmtPutNode, 7, shareType);
-
-        // node->attrstring has value => node is encrypted
-        nameid favId = AttrMap::string2nameid("fav");
-        auto favIt = node->attrs.map.find(favId);
-        bool fav = (favIt != node->attrs.map.end() && favIt->second == "1"); // test 'fav' attr value (only "1" is valid)
-        sqlite3_bind_int(mStmtPutNode, 8, fav);
-        sqlite3_bind_int64(mStmtPutNode, 9, node->ctime);
-        sqlite3_bind_int64(mStmtPutNode, 10, node->mtime);
-        sqlite3_bind_int64(mStmtPutNode, 11, node->getDBFlags());
-        std::string nodeCountersBlob = node->getCounter().serialize();
-        sqlite3_bind_blob(mStmtPutNode,
-                          12,
-                          nodeCountersBlob.data(),
-                          static_cast<int>(nodeCountersBlob.size()),
-                          SQLITE_STATIC);
-        sqlite3_bind_blob(mStmtPutNode,
-                          13,
-                          nodeSerialized.data(),
-                          static_cast<int>(nodeSerialized.size()),
-                          SQLITE_STATIC);
-
-        static nameid labelId = AttrMap::string2nameid("lbl");
-        auto labelIt = node->attrs.map.find(labelId);
-        int label = (labelIt == node->attrs.map.end()) ? LBL_UNKNOWN : std::atoi(labelIt->second.c_str());
-        sqlite3_bind_int(mStmtPutNode, 14, label);
-
-        nameid descriptionId = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION);
-        if (auto descriptionIt = node->attrs.map.find(descriptionId);
-            descriptionIt != node->attrs.map.end())
-        {
-            const std::string& description = descriptionIt->second;
-            sqlite3_bind_text(mStmtPutNode,
-                              15,
-                              description.c_str(),
-                              static_cast<int>(description.length()),
-                              SQLITE_STATIC);
+        // not worth a thread nor a statement of a few rows
+        bool result = true;
+        for (Node* node : nodes)
+        {
+            result = put(node) && result;
         }
-        else
+        return result;
+    }
+
+    checkTransaction();
+    nodesWritten();
+
+    // Node blobs are serialized in a background thread while the rows are inserted. The other
+    // columns may need the node's ancestors, so they are taken here. The caller keeps the
+    // nodes unchanged meanwhile
+    std::vector<std::string> serialized(nodes.size());
+    std::vector<std::pair<size_t, int>> sizeAndEncoding(nodes.size());
+    size_t numSerialized = 0;
+    std::mutex serializedMutex;
+    std::condition_variable serializedCv;
+    const bool compress = mCompressNodeBlobs;
+    std::thread serializer([&]()
+    {
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            nodes[i]->serialize(&serialized[i]);
+            sizeAndEncoding[i].first = serialized[i].size();
+            sizeAndEncoding[i].second = encodeNodeBlob(serialized[i], compress);
+
+            if ((i + 1) % NODE_ROWS_PER_INSERT == 0 || i + 1 == nodes.size())
+            {
+                std::lock_guard<std::mutex> g(serializedMutex);
+                numSerialized = i + 1;
+                serializedCv.notify_one();
+            }
+        }
+    });
+
+    std::vector<NodeRow> rows;
+    rows.reserve(NODE_ROWS_PER_INSERT);
+    bool result = true;
+    for (size_t begin = 0; begin < nodes.size(); begin += NODE_ROWS_PER_INSERT)
+    {
+        const size_t end = std::min(begin + NODE_ROWS_PER_INSERT, nodes.size());
+
+        rows.clear();
+        for (size_t i = begin; i < end; ++i)
         {
-            sqlite3_bind_null(mStmtPutNode, 15);
+            rows.emplace_back(*nodes[i], false);
         }
 
-        nameid tagId = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS);
-        if (auto tagIt = node->attrs.map.find(tagId); tagIt != node->attrs.map.end())
         {
-            const std::string& tag = tagIt->second;
-            sqlite3_bind_text(mStmtPutNode,
-                              16,
-                              tag.c_str(),
-                              static_cast<int>(tag.length()),
-                              SQLITE_STATIC);
+            std::unique_lock<std::mutex> g(serializedMutex);
+            serializedCv.wait(g, [&numSerialized, end]() { return numSerialized >= end; });
         }
-        else
+
+        for (size_t i = begin; i < end; ++i)
         {
-            sqlite3_bind_null(mStmtPutNode, 16);
+            rows[i - begin].serialized = std::move(serialized[i]);
+            rows[i - begin].rawSize = sizeAndEncoding[i].first;
+            rows[i - begin].blobEncoding = sizeAndEncoding[i].second;
+            assert(rows[i - begin].serialized.size());
         }
 
-        sqlResult = sqlite3_step(mStmtPutNode);
-    }
+        if (rows.size() < NODE_ROWS_PER_INSERT)
+        {
+            // the remainder goes row by row
+            for (const NodeRow& row : rows)
+            {
+                result = putNodeRows(&row, 1) && result;
+            }
+            continue;
+        }
 
-    errorHandler(sqlResult, "Put node", false);
+        result = putNodeRows(rows.data(), rows.size()) && result;
+    }
 
-    sqlite3_reset(mStmtPutNode);
+    serializer.join();
 
-    return sqlResult == SQLITE_DONE;
+    return result;
 }
 
 bool SqliteAccountState::getNode(NodeHandle nodehandle, NodeSerialized &nodeSerialized)
@@ -1372,7 +3084,7 @@ bool SqliteAccountState::getNode(NodeHandle nodehandle, NodeSerialized &nodeSeri
     int sqlResult = SQLITE_OK;
     if (!mStmtGetNode)
     {
-        sqlResult = sqlite3_prepare_v2(db, "SELECT counter, node FROM nodes  WHERE nodehandle = ?", -1, &mStmtGetNode, NULL);
+        sqlResult = sqlite3_prepare_v2(db, "SELECT N.counter, B.node, B.encoding FROM nodes AS N, nodeblobs AS B WHERE N.nodehandle = ?1 AND B.nodehandle = ?1", -1, &mStmtGetNode, NULL);
     }
 
     if (sqlResult == SQLITE_OK)
@@ -1390,8 +3102,7 @@ bool SqliteAccountState::getNode(NodeHandle nodehandle, NodeSerialized &nodeSeri
                 if (dataNodeCounter && sizeNodeCounter && dataNodeSerialized && sizeNodeSerialized)
                 {
                     nodeSerialized.mNodeCounter.assign(static_cast<const char*>(dataNodeCounter), sizeNodeCounter);
-                    nodeSerialized.mNode.assign(static_cast<const char*>(dataNodeSerialized), sizeNodeSerialized);
-                    success = true;
+                    success = readNodeBlob(dataNodeSerialized, sizeNodeSerialized, sqlite3_column_int(mStmtGetNode, 2), nodeSerialized.mNode);
                 }
             }
         }
@@ -1418,7 +3129,7 @@ bool SqliteAccountState::getNodesByOrigFingerprint(const std::string &fingerprin
     int sqlResult = SQLITE_OK;
     if (!mStmtNodeByOrigFp)
     {
-        sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, counter, node FROM nodes WHERE origfingerprint = ?", -1, &mStmtNodeByOrigFp, NULL);
+        sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, counter FROM nodes WHERE origfingerprint = ?", -1, &mStmtNodeByOrigFp, NULL);
     }
 
     bool result = false;
@@ -1446,7 +3157,7 @@ bool SqliteAccountState::getRootNodes(std::vector<std::pair<NodeHandle, NodeSeri
 
     sqlite3_stmt *stmt = nullptr;
     bool result = false;
-    int sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, counter, node FROM nodes WHERE type >= ? AND type <= ?", -1, &stmt, NULL);
+    int sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, counter FROM nodes WHERE type >= ? AND type <= ?", -1, &stmt, NULL);
     if (sqlResult == SQLITE_OK)
     {
         if ((sqlResult = sqlite3_bind_int(stmt, 1, nodetype_t::ROOTNODE)) == SQLITE_OK)
@@ -1474,7 +3185,7 @@ bool SqliteAccountState::getNodesWithSharesOrLink(std::vector<std::pair<NodeHand
 
     sqlite3_stmt *stmt = nullptr;
     bool result = false;
-    int sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, counter, node FROM nodes WHERE share & ? != 0", -1, &stmt, NULL);
+    int sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, counter FROM nodes WHERE share & ? != 0", -1, &stmt, NULL);
     if (sqlResult == SQLITE_OK)
     {
         if ((sqlResult = sqlite3_bind_int(stmt, 1, static_cast<int>(shareType))) == SQLITE_OK)
@@ -1501,7 +3212,11 @@ uint64_t SqliteAccountState::getNumberOfChildren(NodeHandle parentHandle)
     int sqlResult = SQLITE_OK;
     if (!mStmtNumChildren)
     {
-        sqlResult = sqlite3_prepare_v2(db, "SELECT count(*) FROM nodes WHERE parenthandle = ?", -1, &mStmtNumChildren, NULL);
+        // folders have it at table nodecounters, files (with versions) don't
+        const char* sql = mNodeCounters ? "SELECT IFNULL((SELECT children FROM nodecounters WHERE nodehandle = ?1), "
+                                          "(SELECT count(*) FROM nodes WHERE parenthandle = ?1))"
+                                        : "SELECT count(*) FROM nodes WHERE parenthandle = ?";
+        sqlResult = sqlite3_prepare_v2(db, sql, -1, &mStmtNumChildren, NULL);
     }
 
     if (sqlResult == SQLITE_OK)
@@ -1522,6 +3237,48 @@ uint64_t SqliteAccountState::getNumberOfChildren(NodeHandle parentHandle)
     return numChildren;
 }
 
+bool SqliteAccountState::getFolderCounter(NodeHandle folder, NodeCounter& counter)
+{
+    if (!db || !mNodeCounters)
+    {
+        return false;
+    }
+
+    bool found = false;
+    int sqlResult = SQLITE_OK;
+    if (!mStmtFolderCounter)
+    {
+        sqlResult = sqlite3_prepare_v2(db,
+                                       "SELECT storage, versionstorage, files, folders, versions "
+                                       "FROM nodecounters WHERE nodehandle = ?",
+                                       -1,
+                                       &mStmtFolderCounter,
+                                       NULL);
+    }
+
+    if (sqlResult == SQLITE_OK)
+    {
+        if ((sqlResult = sqlite3_bind_int64(mStmtFolderCounter, 1, folder.as8byte())) == SQLITE_OK)
+        {
+            if ((sqlResult = sqlite3_step(mStmtFolderCounter)) == SQLITE_ROW)
+            {
+                counter.storage = sqlite3_column_int64(mStmtFolderCounter, 0);
+                counter.versionStorage = sqlite3_column_int64(mStmtFolderCounter, 1);
+                counter.files = static_cast<size_t>(sqlite3_column_int64(mStmtFolderCounter, 2));
+                counter.folders = static_cast<size_t>(sqlite3_column_int64(mStmtFolderCounter, 3));
+                counter.versions = static_cast<size_t>(sqlite3_column_int64(mStmtFolderCounter, 4));
+                found = true;
+            }
+        }
+    }
+
+    errorHandler(sqlResult, "Get folder counter", false);
+
+    sqlite3_reset(mStmtFolderCounter);
+
+    return found;
+}
+
 namespace
 {
 /**
@@ -1540,144 +3297,375 @@ struct QueryTagId
         return mId;
     }
 
-    operator std::string() const
+    operator std::string() const
+    {
+        return "?" + std::to_string(mId);
+    }
+
+    std::string operator+(const std::string& other)
+    {
+        return std::string(*this) + other;
+    }
+
+    friend std::string operator+(const std::string& lhs, const QueryTagId& rhs)
+    {
+        return lhs + std::string(rhs);
+    }
+
+private:
+    int mId;
+};
+
+// Helper function for binding values like int, int64
+template<typename T, typename V>
+int bindValue(int& sqlResult,
+              sqlite3_stmt* stmt,
+              int index,
+              V value,
+              int (*bindFunc)(sqlite3_stmt*, int, T))
+{
+    if constexpr (std::is_integral_v<T> && std::is_integral_v<V>)
+    {
+        // Allow casting between integral types
+        static_assert(sizeof(T) >= sizeof(V),
+                      "Target type T must be able to hold value of type V without truncation");
+    }
+    if (sqlResult == SQLITE_OK)
+    {
+        sqlResult = bindFunc(stmt, index, static_cast<T>(value));
+    }
+    return sqlResult;
+}
+
+// Helper function for binding text
+int bindText(int& sqlResult, sqlite3_stmt* stmt, int index, const std::string& text)
+{
+    if (sqlResult == SQLITE_OK)
+    {
+        sqlResult = sqlite3_bind_text(stmt,
+                                      index,
+                                      text.c_str(),
+                                      static_cast<int>(text.size()),
+                                      SQLITE_STATIC);
+    }
+    return sqlResult;
+}
+
+// Helper function for binding pointers
+int bindPointer(int& sqlResult, sqlite3_stmt* stmt, int index, void* ptr, const char* type)
+{
+    if (sqlResult == SQLITE_OK)
+    {
+        sqlResult = sqlite3_bind_pointer(stmt, index, ptr, type, nullptr);
+    }
+    return sqlResult;
+}
+}
+
+bool SqliteAccountState::getChildren(const mega::NodeSearchFilter& filter,
+                                     int order,
+                                     vector<pair<NodeHandle, NodeSerialized>>& children,
+                                     const DBQueryOptions& options,
+                                     const NodeSearchPage& page)
+{
+    if (!db)
+        return false;
+
+    ReadLease lease = acquireReadConnection();
+    ReadConnection& connection = *lease;
+
+    QueryMonitor monitor(connection.db, "Get children with filter", options);
+
+    // There are multiple criteria used in ORDER BY clause.
+    // For every order type a new statement is created
+    // and with or without the full-text index
+    const std::string fullTextQuery = getFullTextQuery(filter);
+    const size_t cacheId = OrderByClause::getId(order) * 2 + !fullTextQuery.empty();
+    sqlite3_stmt*& stmt = connection.stmtGetChildren[cacheId];
+
+    int sqlResult = SQLITE_OK;
+    static const QueryTagId idParentHand{1};
+    static const QueryTagId idPageSize{2};
+    static const QueryTagId idPageOff{3};
+    static const QueryTagId idFilter{4};
+    static const QueryTagId idFullText{5};
+    if (!stmt)
+    {
+        // Inherited sensitivity is not a concern here. When filtering out sensitive nodes, the
+        // parent of all children would be checked before getting here. There's no point in making
+        // this query recursive just because of that.
+
+        using namespace std::string_literals;
+        // Disabling format for query readability
+        // clang-format off
+        const std::string sqlQuery =
+            "SELECT nodehandle, counter "s +
+            "FROM nodes "
+            "WHERE (parenthandle = " + idParentHand + ") " + // Versions aren't taken in consideration
+            (fullTextQuery.empty() ? ""s : "AND nodehandle IN (SELECT rowid FROM nodesfts WHERE nodesfts MATCH "s + idFullText + ") ") +
+            "AND matchFilter(" + idFilter + ", flags, type, ctime, mtime, mimetypeVirtual, name, description, tags, fav, nodehandle)"
+            "ORDER BY \n" +
+            OrderByClause::get(order) + " \n" +
+            "LIMIT " + idPageSize + " OFFSET " + idPageOff;
+        // clang-format on
+
+        sqlResult = sqlite3_prepare_v2(connection.db, sqlQuery.c_str(), -1, &stmt, NULL);
+    }
+
+    bool result = false;
+
+    const sqlite3_int64 pageSize = page.size() ? static_cast<sqlite3_int64>(page.size()) : -1;
+    NodeSearchFilter filterCopy = filter;
+
+    bindPointer(sqlResult, stmt, idFilter, &filterCopy, NodeSearchFilterPtrStr);
+    bindValue(sqlResult, stmt, idParentHand, filter.byParentHandle(), sqlite3_bind_int64);
+    bindValue(sqlResult, stmt, idPageSize, pageSize, sqlite3_bind_int64);
+    bindValue(sqlResult, stmt, idPageOff, page.startingOffset(), sqlite3_bind_int64);
+    if (!fullTextQuery.empty())
+    {
+        bindText(sqlResult, stmt, idFullText, fullTextQuery);
+    }
+
+    monitor.setStatement(stmt);
+    if (sqlResult == SQLITE_OK)
+        result = processSqlQueryNodes(stmt, children, connection);
+    monitor.setRowsReturned(children.size());
+
+    errorHandler(sqlResult, "Get children with filter", true, connection.db);
+
+    sqlite3_reset(stmt);
+
+    return result;
+}
+
+bool SqliteAccountState::getChildrenFrom(const mega::NodeSearchFilter& filter,
+                                         int order,
+                                         NodeSearchCursor& cursor,
+                                         size_t limit,
+                                         size_t batchSize,
+                                         const std::function<bool(std::vector<std::pair<NodeHandle, NodeSerialized>>&)>& processBatch,
+                                         const DBQueryOptions& options)
+{
+    if (!db)
+        return false;
+
+    if (cursor.atEnd())
+        return true;
+
+    const std::vector<std::pair<std::string, bool>> keys = OrderByClause::getKeys(order);
+    if (!cursor.atStart() && (cursor.order() != order || cursor.sortKey().size() != keys.size()))
+    {
+        LOG_err << "Get children from cursor: the cursor belongs to another order";
+        assert(false);
+        return false;
+    }
+
+    QueryMonitor monitor(db, "Get children from cursor", options);
+
+    // One statement per order, with and without the keyset condition
+    const size_t cacheId = OrderByClause::getId(order) * 2 + (cursor.atStart() ? 0 : 1);
+    sqlite3_stmt*& stmt = mStmtGetChildrenFrom[cacheId];
+
+    int sqlResult = SQLITE_OK;
+    static const QueryTagId idParentHand{1};
+    static const QueryTagId idPageSize{2};
+    static const QueryTagId idFilter{3};
+    static const int idFirstKey = 4;
+    static const int firstKeyColumn = 2;
+    if (!stmt)
+    {
+        std::string keyColumns;
+        std::string orderBy;
+        for (const auto& key : keys)
+        {
+            keyColumns += ", " + key.first;
+            orderBy += (orderBy.empty() ? "" : ", ") + key.first + (key.second ? " DESC" : "");
+        }
+
+        // rows after the cursor: (k1 after v1) OR (k1 = v1 AND ((k2 after v2) OR (k2 = v2 AND ...)))
+        std::string afterCursor;
+        for (size_t i = keys.size(); i-- > 0;)
+        {
+            const std::string value = QueryTagId{idFirstKey + static_cast<int>(i)};
+            const std::string after = keys[i].first + (keys[i].second ? " < " : " > ") + value;
+            afterCursor = afterCursor.empty() ? after
+                                              : "(" + after + " OR (" + keys[i].first + " = " + value + " AND " + afterCursor + "))";
+        }
+
+        using namespace std::string_literals;
+        // Disabling format for query readability
+        // clang-format off
+        const std::string sqlQuery =
+            "SELECT nodehandle, counter"s + keyColumns + " "
+            "FROM nodes "
+            "WHERE (parenthandle = " + idParentHand + ") "
+            "AND matchFilter(" + idFilter + ", flags, type, ctime, mtime, mimetypeVirtual, name, description, tags, fav, nodehandle) " +
+            (cursor.atStart() ? "" : "AND " + afterCursor + " ") +
+            "ORDER BY \n" + orderBy + " \n" +
+            "LIMIT " + idPageSize;
+        // clang-format on
+
+        sqlResult = sqlite3_prepare_v2(db, sqlQuery.c_str(), -1, &stmt, NULL);
+    }
+
+    const sqlite3_int64 pageSize = limit ? static_cast<sqlite3_int64>(limit) : -1;
+    NodeSearchFilter filterCopy = filter;
+
+    bindPointer(sqlResult, stmt, idFilter, &filterCopy, NodeSearchFilterPtrStr);
+    bindValue(sqlResult, stmt, idParentHand, filter.byParentHandle(), sqlite3_bind_int64);
+    bindValue(sqlResult, stmt, idPageSize, pageSize, sqlite3_bind_int64);
+    for (size_t i = 0; i < cursor.sortKey().size(); ++i)
     {
-        return "?" + std::to_string(mId);
+        const int id = idFirstKey + static_cast<int>(i);
+        const NodeSearchCursor::SortValue& value = cursor.sortKey()[i];
+        if (std::holds_alternative<std::string>(value))
+        {
+            bindText(sqlResult, stmt, id, std::get<std::string>(value));
+        }
+        else
+        {
+            bindValue(sqlResult, stmt, id, std::get<int64_t>(value), sqlite3_bind_int64);
+        }
     }
 
-    std::string operator+(const std::string& other)
+    // the cursor keeps the values bound until the query finishes
+    std::vector<NodeSearchCursor::SortValue> lastSortKey;
+    size_t rows = 0;
+    bool stopped = false;
+    if (!batchSize)
     {
-        return std::string(*this) + other;
+        batchSize = std::numeric_limits<size_t>::max();
     }
 
-    friend std::string operator+(const std::string& lhs, const QueryTagId& rhs)
+    monitor.setStatement(stmt);
+    std::vector<std::pair<NodeHandle, NodeSerialized>> batch;
+    while (sqlResult == SQLITE_OK || sqlResult == SQLITE_ROW)
     {
-        return lhs + std::string(rhs);
-    }
+        sqlResult = sqlite3_step(stmt);
+        if (sqlResult != SQLITE_ROW)
+        {
+            break;
+        }
 
-private:
-    int mId;
-};
+        appendSqlRowNode(stmt, batch, mPrimaryReads);
 
-// Helper function for binding values like int, int64
-template<typename T, typename V>
-int bindValue(int& sqlResult,
-              sqlite3_stmt* stmt,
-              int index,
-              V value,
-              int (*bindFunc)(sqlite3_stmt*, int, T))
-{
-    if constexpr (std::is_integral_v<T> && std::is_integral_v<V>)
-    {
-        // Allow casting between integral types
-        static_assert(sizeof(T) >= sizeof(V),
-                      "Target type T must be able to hold value of type V without truncation");
-    }
-    if (sqlResult == SQLITE_OK)
-    {
-        sqlResult = bindFunc(stmt, index, static_cast<T>(value));
+        if (++rows % batchSize && rows != static_cast<size_t>(pageSize))
+        {
+            continue;
+        }
+
+        // the sort key is only kept where the next look-up could start
+        lastSortKey.clear();
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            const int column = firstKeyColumn + static_cast<int>(i);
+            if (sqlite3_column_type(stmt, column) == SQLITE_TEXT)
+            {
+                const unsigned char* text = sqlite3_column_text(stmt, column);
+                lastSortKey.emplace_back(std::string(reinterpret_cast<const char*>(text),
+                                                     static_cast<size_t>(sqlite3_column_bytes(stmt, column))));
+            }
+            else
+            {
+                lastSortKey.emplace_back(static_cast<int64_t>(sqlite3_column_int64(stmt, column)));
+            }
+        }
+
+        if (!processBatch(batch))
+        {
+            stopped = true;
+            break;
+        }
+        batch.clear();
     }
-    return sqlResult;
-}
 
-// Helper function for binding text
-int bindText(int& sqlResult, sqlite3_stmt* stmt, int index, const std::string& text)
-{
-    if (sqlResult == SQLITE_OK)
+    bool result = stopped || sqlResult == SQLITE_DONE;
+    if (sqlResult == SQLITE_DONE)
     {
-        sqlResult = sqlite3_bind_text(stmt,
-                                      index,
-                                      text.c_str(),
-                                      static_cast<int>(text.size()),
-                                      SQLITE_STATIC);
+        if (!batch.empty())
+        {
+            processBatch(batch);
+        }
+
+        if (rows < static_cast<size_t>(pageSize))
+        {
+            // the last page was read
+            cursor.moveToEnd();
+        }
     }
-    return sqlResult;
-}
 
-// Helper function for binding pointers
-int bindPointer(int& sqlResult, sqlite3_stmt* stmt, int index, void* ptr, const char* type)
-{
-    if (sqlResult == SQLITE_OK)
+    if (result && !lastSortKey.empty())
     {
-        sqlResult = sqlite3_bind_pointer(stmt, index, ptr, type, nullptr);
+        cursor.moveTo(order, std::move(lastSortKey));
     }
-    return sqlResult;
-}
+
+    monitor.setRowsReturned(rows);
+
+    errorHandler(sqlResult, "Get children from cursor", true);
+
+    sqlite3_reset(stmt);
+
+    return result;
 }
 
-bool SqliteAccountState::getChildren(const mega::NodeSearchFilter& filter,
-                                     int order,
-                                     vector<pair<NodeHandle, NodeSerialized>>& children,
-                                     CancelToken cancelFlag,
-                                     const NodeSearchPage& page)
+bool SqliteAccountState::getSubtree(NodeHandle root,
+                                    int maxDepth,
+                                    size_t limit,
+                                    vector<pair<NodeHandle, NodeSerialized>>& nodes,
+                                    const DBQueryOptions& options)
 {
     if (!db)
         return false;
 
-    if (cancelFlag.exists())
-        sqlite3_progress_handler(db,
-                                 NUM_VIRTUAL_MACHINE_INSTRUCTIONS,
-                                 SqliteAccountState::progressHandler,
-                                 static_cast<void*>(&cancelFlag));
-
-    // There are multiple criteria used in ORDER BY clause.
-    // For every order type a new statement is created
-    const size_t cacheId = OrderByClause::getId(order);
-    sqlite3_stmt*& stmt = mStmtGetChildren[cacheId];
+    QueryMonitor monitor(db, "Get subtree", options);
 
     int sqlResult = SQLITE_OK;
-    static const QueryTagId idParentHand{1};
-    static const QueryTagId idPageSize{2};
-    static const QueryTagId idPageOff{3};
-    static const QueryTagId idFilter{4};
-    if (!stmt)
+    static const QueryTagId idRoot{1};
+    static const QueryTagId idMaxDepth{2};
+    static const QueryTagId idLimit{3};
+    if (!mStmtGetSubtree)
     {
-        // Inherited sensitivity is not a concern here. When filtering out sensitive nodes, the
-        // parent of all children would be checked before getting here. There's no point in making
-        // this query recursive just because of that.
-
         using namespace std::string_literals;
         // Disabling format for query readability
         // clang-format off
         const std::string sqlQuery =
-            "SELECT nodehandle, counter, node "s +
-            "FROM nodes "
-            "WHERE (parenthandle = " + idParentHand + ") " // Versions aren't taken in consideration
-            "AND matchFilter(" + idFilter + ", flags, type, ctime, mtime, mimetypeVirtual, name, description, tags, fav)"
-            "ORDER BY \n" +
-            OrderByClause::get(order) + " \n" +
-            "LIMIT " + idPageSize + " OFFSET " + idPageOff;
+            "WITH RECURSIVE subtree(nodehandle, depth) AS ("s +
+                "SELECT nodehandle, 1 FROM nodes WHERE parenthandle = " + idRoot + " "
+                "UNION ALL "
+                "SELECT N.nodehandle, S.depth + 1 FROM nodes AS N INNER JOIN subtree AS S "
+                "ON (N.parenthandle = S.nodehandle) "
+                "WHERE (" + idMaxDepth + " < 1 OR S.depth < " + idMaxDepth + ")) "
+            "SELECT N.nodehandle, N.counter "
+            "FROM nodes AS N INNER JOIN subtree AS S ON (N.nodehandle = S.nodehandle) "
+            "ORDER BY S.depth "
+            "LIMIT " + idLimit;
         // clang-format on
 
-        sqlResult = sqlite3_prepare_v2(db, sqlQuery.c_str(), -1, &stmt, NULL);
+        sqlResult = sqlite3_prepare_v2(db, sqlQuery.c_str(), -1, &mStmtGetSubtree, NULL);
     }
 
     bool result = false;
+    const sqlite3_int64 rowLimit = limit ? static_cast<sqlite3_int64>(limit) : -1;
 
-    const sqlite3_int64 pageSize = page.size() ? static_cast<sqlite3_int64>(page.size()) : -1;
-    NodeSearchFilter filterCopy = filter;
-
-    bindPointer(sqlResult, stmt, idFilter, &filterCopy, NodeSearchFilterPtrStr);
-    bindValue(sqlResult, stmt, idParentHand, filter.byParentHandle(), sqlite3_bind_int64);
-    bindValue(sqlResult, stmt, idPageSize, pageSize, sqlite3_bind_int64);
-    bindValue(sqlResult, stmt, idPageOff, page.startingOffset(), sqlite3_bind_int64);
+    bindValue(sqlResult, mStmtGetSubtree, idRoot, root.as8byte(), sqlite3_bind_int64);
+    bindValue(sqlResult, mStmtGetSubtree, idMaxDepth, maxDepth, sqlite3_bind_int);
+    bindValue(sqlResult, mStmtGetSubtree, idLimit, rowLimit, sqlite3_bind_int64);
 
+    monitor.setStatement(mStmtGetSubtree);
     if (sqlResult == SQLITE_OK)
-        result = processSqlQueryNodes(stmt, children);
-
-    // unregister the handler (no-op if not registered)
-    sqlite3_progress_handler(db, -1, nullptr, nullptr);
+        result = processSqlQueryNodes(mStmtGetSubtree, nodes);
+    monitor.setRowsReturned(nodes.size());
 
-    errorHandler(sqlResult, "Get children with filter", true);
+    errorHandler(sqlResult, "Get subtree", true);
 
-    sqlite3_reset(stmt);
+    sqlite3_reset(mStmtGetSubtree);
 
     return result;
 }
 
 bool SqliteAccountState::getAllNodeTags(const std::string& searchString,
                                         std::set<std::string>& tags,
-                                        CancelToken cancelFlag)
+                                        const DBQueryOptions& options)
 {
     if (!db)
     {
@@ -1685,25 +3673,18 @@ bool SqliteAccountState::getAllNodeTags(const std::string& searchString,
         return false;
     }
 
+    QueryMonitor monitor(db, "Get all node tags", options);
+
     // When early returning, this gets executed
     int sqlResult = SQLITE_OK;
     const MrProper cleanUp(
-        [this, &sqlResult]()
+        [this, &sqlResult, &monitor, &tags]()
         {
-            // unregister the handler (no-op if not registered)
-            sqlite3_progress_handler(db, -1, nullptr, nullptr);
+            monitor.setRowsReturned(tags.size());
             errorHandler(sqlResult, "Get all node tags", true);
             sqlite3_reset(mStmtAllNodeTags);
         });
 
-    if (cancelFlag.exists())
-    {
-        sqlite3_progress_handler(db,
-                                 NUM_VIRTUAL_MACHINE_INSTRUCTIONS,
-                                 SqliteAccountState::progressHandler,
-                                 static_cast<void*>(&cancelFlag));
-    }
-
     static const std::string selectStmBase{R"(
         SELECT DISTINCT tags
             FROM nodes
@@ -1721,6 +3702,7 @@ bool SqliteAccountState::getAllNodeTags(const std::string& searchString,
     {
         return false;
     }
+    monitor.setStatement(mStmtAllNodeTags);
     // The search string has something different from *?
     bool therIsSomethingToSearch = std::any_of(searchString.begin(),
                                                searchString.end(),
@@ -1758,22 +3740,23 @@ bool SqliteAccountState::getAllNodeTags(const std::string& searchString,
 bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
                                      int order,
                                      vector<pair<NodeHandle, NodeSerialized>>& nodes,
-                                     CancelToken cancelFlag,
+                                     const DBQueryOptions& options,
                                      const NodeSearchPage& page)
 {
     if (!db)
         return false;
 
-    if (cancelFlag.exists())
-        sqlite3_progress_handler(db,
-                                 NUM_VIRTUAL_MACHINE_INSTRUCTIONS,
-                                 SqliteAccountState::progressHandler,
-                                 static_cast<void*>(&cancelFlag));
+    ReadLease lease = acquireReadConnection();
+    ReadConnection& connection = *lease;
+
+    QueryMonitor monitor(connection.db, "Search nodes with filter", options);
 
     // There are multiple criteria used in ORDER BY clause.
     // For every order type a new statement is created
-    size_t cacheId = OrderByClause::getId(order);
-    sqlite3_stmt*& stmt = mStmtSearchNodes[cacheId];
+    // and with or without the full-text index
+    const std::string fullTextQuery = getFullTextQuery(filter);
+    size_t cacheId = OrderByClause::getId(order) * 2 + !fullTextQuery.empty();
+    sqlite3_stmt*& stmt = connection.stmtSearchNodes[cacheId];
 
     static const QueryTagId idVerFlag{1};
     static const QueryTagId idName{2};
@@ -1786,6 +3769,7 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
     static const QueryTagId idSensFlag{9};
     static const QueryTagId idIncShares{10};
     static const QueryTagId idFilter{11};
+    static const QueryTagId idFullText{12};
 
     int sqlResult = SQLITE_OK;
     if (!stmt)
@@ -1804,7 +3788,6 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
                                                                              "name",
                                                                              "type",
                                                                              "counter",
-                                                                             "node",
                                                                              "sizeVirtual",
                                                                              "ctime",
                                                                              "mtime",
@@ -1813,7 +3796,8 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
                                                                              "fav",
                                                                              "label",
                                                                              "description",
-                                                                             "tags"};
+                                                                             "tags",
+                                                                             "nameKey"};
         // Output: "nodehandle, parenthandle, flags, ..."
         static const std::string columnsForNodeAndFilters =
             joinStrings(std::cbegin(columnsForNodeAndFiltersVec),
@@ -1831,8 +3815,8 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
                         });
 
         static const std::string columnsForNodeAndOrderBy =
-            "nodehandle, counter, node, " // for nodes
-            "type, sizeVirtual, ctime, mtime, name, label, fav"; // for ORDER BY only
+            "nodehandle, counter, " // for nodes
+            "type, sizeVirtual, ctime, mtime, nameKey, label, fav"; // for ORDER BY only
 
         using namespace std::string_literals;
 
@@ -1869,11 +3853,12 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
                 " AND (P.flags & " + idSensFlag + ") = 0) "
                 "AND P.type != " + filenodeStr + "))";
 
-        static const std::string whereClause =
-            "matchFilter("s + idFilter +
-            ", flags, type, ctime, mtime, mimetypeVirtual, name, description, tags, fav)";
+        const std::string whereClause =
+            (fullTextQuery.empty() ? ""s : "nodehandle IN (SELECT rowid FROM nodesfts WHERE nodesfts MATCH "s + idFullText + ") AND ") +
+            "matchFilter(" + idFilter +
+            ", flags, type, ctime, mtime, mimetypeVirtual, name, description, tags, fav, nodehandle)";
 
-        static const std::string nodesAfterFilters =
+        const std::string nodesAfterFilters =
             "nodesAfterFilters (" + columnsForNodeAndOrderBy + ") \n"
             "AS (SELECT " + columnsForNodeAndOrderBy + " \n"
                 "FROM nodesOfShares \n"
@@ -1899,7 +3884,7 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
             "LIMIT " + idPageSize + " OFFSET " + idPageOff;
         // clang-format on
 
-        sqlResult = sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, NULL);
+        sqlResult = sqlite3_prepare_v2(connection.db, query.c_str(), -1, &stmt, NULL);
     }
 
     constexpr uint64_t versionFlag = (1 << Node::FLAGS_IS_VERSION); // exclude file versions
@@ -1921,13 +3906,16 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
     bindPointer(sqlResult, stmt, idFilter, &filterCopy, NodeSearchFilterPtrStr);
     bindValue(sqlResult, stmt, idSens, filter.bySensitivity(), sqlite3_bind_int);
     bindValue(sqlResult, stmt, idSensFlag, senstivityFlag, sqlite3_bind_int64);
+    if (!fullTextQuery.empty())
+    {
+        bindText(sqlResult, stmt, idFullText, fullTextQuery);
+    }
 
-    const bool result = (sqlResult == SQLITE_OK) && processSqlQueryNodes(stmt, nodes);
-
-    // unregister the handler (no-op if not registered)
-    sqlite3_progress_handler(db, -1, nullptr, nullptr);
+    monitor.setStatement(stmt);
+    const bool result = (sqlResult == SQLITE_OK) && processSqlQueryNodes(stmt, nodes, connection);
+    monitor.setRowsReturned(nodes.size());
 
-    errorHandler(sqlResult, "Search nodes with filter", true);
+    errorHandler(sqlResult, "Search nodes with filter", true, connection.db);
 
     sqlite3_reset(stmt);
 
@@ -1941,32 +3929,78 @@ bool SqliteAccountState::getNodesByFingerprint(const std::string &fingerprint, s
         return false;
     }
 
+    ReadLease lease = acquireReadConnection();
+    ReadConnection& connection = *lease;
+
     int sqlResult = SQLITE_OK;
-    if (!mStmtNodesByFp)
+    if (!connection.stmtNodesByFp)
     {
-        sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, counter, node FROM nodes WHERE fingerprint = ?", -1, &mStmtNodesByFp, NULL);
+        sqlResult = sqlite3_prepare_v2(connection.db, "SELECT nodehandle, counter FROM nodes WHERE fingerprint = ?", -1, &connection.stmtNodesByFp, NULL);
     }
 
     bool result = false;
     if (sqlResult == SQLITE_OK)
     {
-        if ((sqlResult = sqlite3_bind_blob(mStmtNodesByFp, 1, fingerprint.data(), (int)fingerprint.size(), SQLITE_STATIC)) == SQLITE_OK)
+        if ((sqlResult = sqlite3_bind_blob(connection.stmtNodesByFp, 1, fingerprint.data(), (int)fingerprint.size(), SQLITE_STATIC)) == SQLITE_OK)
         {
-            result = processSqlQueryNodes(mStmtNodesByFp, nodes);
+            result = processSqlQueryNodes(connection.stmtNodesByFp, nodes, connection);
         }
     }
 
     if (sqlResult != SQLITE_OK)
     {
-        errorHandler(sqlResult, "get nodes by fingerprint", false);
+        errorHandler(sqlResult, "get nodes by fingerprint", false, connection.db);
     }
 
-    sqlite3_reset(mStmtNodesByFp);
+    sqlite3_reset(connection.stmtNodesByFp);
 
     return result;
 
 }
 
+bool SqliteAccountState::getVersions(NodeHandle file, std::vector<std::pair<NodeHandle, NodeSerialized>>& versions)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    ReadLease lease = acquireReadConnection();
+    ReadConnection& connection = *lease;
+
+    int sqlResult = SQLITE_OK;
+    if (!connection.stmtVersions)
+    {
+        // a file's only child is its previous version: follow the chain down, keeping its order
+        sqlResult = sqlite3_prepare_v2(connection.db,
+                                       "WITH RECURSIVE chain(nodehandle, depth) AS "
+                                       "(SELECT nodehandle, 1 FROM nodes WHERE parenthandle = ? "
+                                       "UNION ALL "
+                                       "SELECT n.nodehandle, c.depth + 1 FROM nodes n INNER JOIN chain c ON n.parenthandle = c.nodehandle) "
+                                       "SELECT n.nodehandle, n.counter FROM chain c INNER JOIN nodes n ON n.nodehandle = c.nodehandle "
+                                       "ORDER BY c.depth",
+                                       -1, &connection.stmtVersions, NULL);
+    }
+
+    bool result = false;
+    if (sqlResult == SQLITE_OK)
+    {
+        if ((sqlResult = sqlite3_bind_int64(connection.stmtVersions, 1, file.as8byte())) == SQLITE_OK)
+        {
+            result = processSqlQueryNodes(connection.stmtVersions, versions, connection);
+        }
+    }
+
+    if (sqlResult != SQLITE_OK)
+    {
+        errorHandler(sqlResult, "get versions", false, connection.db);
+    }
+
+    sqlite3_reset(connection.stmtVersions);
+
+    return result;
+}
+
 bool SqliteAccountState::getNodeByFingerprint(const std::string &fingerprint, mega::NodeSerialized &node, NodeHandle& handle)
 {
     if (!db)
@@ -1974,19 +4008,22 @@ bool SqliteAccountState::getNodeByFingerprint(const std::string &fingerprint, me
         return false;
     }
 
+    ReadLease lease = acquireReadConnection();
+    ReadConnection& connection = *lease;
+
     int sqlResult = SQLITE_OK;
-    if (!mStmtNodeByFp)
+    if (!connection.stmtNodeByFp)
     {
-        sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, counter, node FROM nodes WHERE fingerprint = ? LIMIT 1", -1, &mStmtNodeByFp, NULL);
+        sqlResult = sqlite3_prepare_v2(connection.db, "SELECT nodehandle, counter FROM nodes WHERE fingerprint = ? LIMIT 1", -1, &connection.stmtNodeByFp, NULL);
     }
 
     bool result = false;
     if (sqlResult == SQLITE_OK)
     {
-        if ((sqlResult = sqlite3_bind_blob(mStmtNodeByFp, 1, fingerprint.data(), (int)fingerprint.size(), SQLITE_STATIC)) == SQLITE_OK)
+        if ((sqlResult = sqlite3_bind_blob(connection.stmtNodeByFp, 1, fingerprint.data(), (int)fingerprint.size(), SQLITE_STATIC)) == SQLITE_OK)
         {
             std::vector<std::pair<NodeHandle, NodeSerialized>> nodes;
-            result = processSqlQueryNodes(mStmtNodeByFp, nodes);
+            result = processSqlQueryNodes(connection.stmtNodeByFp, nodes, connection);
             if (nodes.size())
             {
                 node = nodes.begin()->second;
@@ -1997,10 +4034,10 @@ bool SqliteAccountState::getNodeByFingerprint(const std::string &fingerprint, me
 
     if (sqlResult != SQLITE_OK)
     {
-        errorHandler(sqlResult, "Get node by fingerprint", false);
+        errorHandler(sqlResult, "Get node by fingerprint", false, connection.db);
     }
 
-    sqlite3_reset(mStmtNodeByFp);
+    sqlite3_reset(connection.stmtNodeByFp);
 
     return result;
 }
@@ -2014,10 +4051,13 @@ bool SqliteAccountState::getRecentNodes(const NodeSearchPage& page,
         return false;
     }
 
+    ReadLease lease = acquireReadConnection();
+    ReadConnection& connection = *lease;
+
     constexpr uint64_t excludeFlags =
         (1 << Node::FLAGS_IS_VERSION | 1 << Node::FLAGS_IS_IN_RUBBISH);
     static const std::string filenode = std::to_string(FILENODE);
-    static const std::string sqlQuery = "SELECT n1.nodehandle, n1.counter, n1.node "
+    static const std::string sqlQuery = "SELECT n1.nodehandle, n1.counter "
                                         "FROM nodes n1 "
                                         "WHERE n1.flags & " +
                                         std::to_string(excludeFlags) +
@@ -2026,27 +4066,27 @@ bool SqliteAccountState::getRecentNodes(const NodeSearchPage& page,
                                         "ORDER BY n1.ctime DESC LIMIT ?2 OFFSET ?3";
 
     int sqlResult = SQLITE_OK;
-    if (!mStmtRecents)
+    if (!connection.stmtRecents)
     {
-        sqlResult = sqlite3_prepare_v2(db, sqlQuery.c_str(), -1, &mStmtRecents, NULL);
+        sqlResult = sqlite3_prepare_v2(connection.db, sqlQuery.c_str(), -1, &connection.stmtRecents, NULL);
     }
 
     bool stepResult = false;
     const int64_t nodeCount = page.size() ? static_cast<int64_t>(page.size()) : -1;
     const int64_t offset = static_cast<int64_t>(page.startingOffset());
-    if (sqlResult == SQLITE_OK && sqlResult == sqlite3_bind_int64(mStmtRecents, 1, since) &&
-        sqlResult == sqlite3_bind_int64(mStmtRecents, 2, nodeCount) &&
-        sqlResult == sqlite3_bind_int64(mStmtRecents, 3, offset))
+    if (sqlResult == SQLITE_OK && sqlResult == sqlite3_bind_int64(connection.stmtRecents, 1, since) &&
+        sqlResult == sqlite3_bind_int64(connection.stmtRecents, 2, nodeCount) &&
+        sqlResult == sqlite3_bind_int64(connection.stmtRecents, 3, offset))
     {
-        stepResult = processSqlQueryNodes(mStmtRecents, nodes);
+        stepResult = processSqlQueryNodes(connection.stmtRecents, nodes, connection);
     }
 
     if (sqlResult != SQLITE_OK)
     {
-        errorHandler(sqlResult, "Get recent nodes", false);
+        errorHandler(sqlResult, "Get recent nodes", false, connection.db);
     }
 
-    sqlite3_reset(mStmtRecents);
+    sqlite3_reset(connection.stmtRecents);
 
     return stepResult;
 }
@@ -2092,6 +4132,70 @@ bool SqliteAccountState::getFavouritesHandles(NodeHandle node, uint32_t count, s
     return sqlResult == SQLITE_DONE || sqlResult == SQLITE_ROW;
 }
 
+bool SqliteAccountState::getNodeNames(std::vector<std::pair<NodeHandle, std::optional<std::string>>>& names)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    int sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, name FROM nodes", -1, &stmt, NULL);
+    if (sqlResult == SQLITE_OK)
+    {
+        while ((sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            NodeHandle nodeHandle;
+            nodeHandle.set6byte(sqlite3_column_int64(stmt, 0));
+
+            const unsigned char* name = sqlite3_column_text(stmt, 1);
+            if (name)
+            {
+                names.emplace_back(nodeHandle, std::string(reinterpret_cast<const char*>(name), static_cast<size_t>(sqlite3_column_bytes(stmt, 1))));
+            }
+            else
+            {
+                names.emplace_back(nodeHandle, std::nullopt);
+            }
+        }
+    }
+
+    errorHandler(sqlResult, "Get node names", false);
+
+    sqlite3_finalize(stmt);
+
+    return sqlResult == SQLITE_DONE;
+}
+
+bool SqliteAccountState::getFingerprints(const std::function<void(const std::string&)>& processFingerprint)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    // fingerprintindex covers the query
+    sqlite3_stmt* stmt = nullptr;
+    int sqlResult = sqlite3_prepare_v2(db, "SELECT fingerprint FROM nodes", -1, &stmt, NULL);
+    if (sqlResult == SQLITE_OK)
+    {
+        std::string fingerprint;
+        while ((sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            const void* data = sqlite3_column_blob(stmt, 0);
+            int size = sqlite3_column_bytes(stmt, 0);
+            fingerprint.assign(data ? static_cast<const char*>(data) : "", data ? static_cast<size_t>(size) : 0);
+            processFingerprint(fingerprint);
+        }
+    }
+
+    errorHandler(sqlResult, "Get fingerprints", false);
+
+    sqlite3_finalize(stmt);
+
+    return sqlResult == SQLITE_DONE;
+}
+
 bool SqliteAccountState::childNodeByNameType(NodeHandle parentHandle, const std::string& name, nodetype_t nodeType, std::pair<NodeHandle, NodeSerialized> &node)
 {
     bool success = false;
@@ -2100,7 +4204,7 @@ bool SqliteAccountState::childNodeByNameType(NodeHandle parentHandle, const std:
         return success;
     }
 
-    std::string sqlQuery = "SELECT nodehandle, counter, node FROM nodes WHERE parenthandle = ? AND name = ? AND type = ? limit 1";
+    std::string sqlQuery = "SELECT nodehandle, counter FROM nodes WHERE parenthandle = ? AND name = ? AND type = ? limit 1";
 
     int sqlResult = SQLITE_OK;
     if (!mStmtChildNode)
@@ -2180,7 +4284,7 @@ bool SqliteAccountState::getNodeSizeTypeAndFlags(NodeHandle node, m_off_t& size,
     return sqlResult == SQLITE_ROW;
 }
 
-bool SqliteAccountState::isAncestor(NodeHandle node, NodeHandle ancestor, CancelToken cancelFlag)
+bool SqliteAccountState::isAncestor(NodeHandle node, NodeHandle ancestor, const DBQueryOptions& options)
 {
     bool result = false;
     if (!db)
@@ -2194,10 +4298,7 @@ bool SqliteAccountState::isAncestor(NodeHandle node, NodeHandle ancestor, Cancel
             "AS E ON (A.nodehandle = E.parenthandle)) "
             "SELECT * FROM nodesCTE WHERE parenthandle = ?";
 
-    if (cancelFlag.exists())
-    {
-        sqlite3_progress_handler(db, NUM_VIRTUAL_MACHINE_INSTRUCTIONS, SqliteAccountState::progressHandler, static_cast<void*>(&cancelFlag));
-    }
+    QueryMonitor monitor(db, "Is ancestor", options);
 
     int sqlResult = SQLITE_OK;
     if (!mStmtIsAncestor)
@@ -2211,6 +4312,7 @@ bool SqliteAccountState::isAncestor(NodeHandle node, NodeHandle ancestor, Cancel
         {
             if ((sqlResult = sqlite3_bind_int64(mStmtIsAncestor, 2, ancestor.as8byte())) == SQLITE_OK)
             {
+                monitor.setStatement(mStmtIsAncestor);
                 if ((sqlResult = sqlite3_step(mStmtIsAncestor)) == SQLITE_ROW)
                 {
                     result = true;
@@ -2218,9 +4320,7 @@ bool SqliteAccountState::isAncestor(NodeHandle node, NodeHandle ancestor, Cancel
             }
         }
     }
-
-    // unregister the handler (no-op if not registered)
-    sqlite3_progress_handler(db, -1, nullptr, nullptr);
+    monitor.setRowsReturned(result);
 
     if (sqlResult != SQLITE_ROW && sqlResult != SQLITE_DONE)
     {
@@ -2342,6 +4442,55 @@ void SqliteAccountState::getSizeFromNodeCounter(sqlite3_context* context,
     sqlite3_result_int64(context, nc.storage);
 }
 
+void SqliteAccountState::getFieldFromNodeCounter(sqlite3_context* context,
+                                                 int argc,
+                                                 sqlite3_value** argv)
+{
+    if (argc != 2)
+    {
+        LOG_err << "getFieldFromNodeCounter: Invalid parameters for getFieldFromNodeCounter";
+        assert(argc == 2);
+        sqlite3_result_int64(context, 0);
+        return;
+    }
+
+    const auto blob = sqlite3_value_blob(argv[0]);
+    if (!blob)
+    {
+        LOG_err << "getFieldFromNodeCounter: invalid FromNodeCounter blob";
+        sqlite3_result_int64(context, 0);
+        return;
+    }
+    const auto blobSize = sqlite3_value_bytes(argv[0]);
+    const std::string nodeCounter(static_cast<const char*>(blob), static_cast<size_t>(blobSize));
+    const NodeCounter nc(nodeCounter);
+
+    sqlite3_int64 value = 0;
+    switch (sqlite3_value_int(argv[1]))
+    {
+        case NODE_COUNTER_STORAGE:
+            value = nc.storage;
+            break;
+        case NODE_COUNTER_VERSION_STORAGE:
+            value = nc.versionStorage;
+            break;
+        case NODE_COUNTER_FILES:
+            value = static_cast<sqlite3_int64>(nc.files);
+            break;
+        case NODE_COUNTER_FOLDERS:
+            value = static_cast<sqlite3_int64>(nc.folders);
+            break;
+        case NODE_COUNTER_VERSIONS:
+            value = static_cast<sqlite3_int64>(nc.versions);
+            break;
+        default:
+            LOG_err << "getFieldFromNodeCounter: unknown field";
+            assert(false);
+            break;
+    }
+    sqlite3_result_int64(context, value);
+}
+
 void SqliteAccountState::userGetMimetype(sqlite3_context* context, int argc, sqlite3_value** argv)
 {
     if (argc != 1)
@@ -2359,6 +4508,21 @@ void SqliteAccountState::userGetMimetype(sqlite3_context* context, int argc, sql
     sqlite3_result_int(context, result);
 }
 
+void SqliteAccountState::userNaturalSortKey(sqlite3_context* context, int argc, sqlite3_value** argv)
+{
+    if (argc != 1)
+    {
+        LOG_err << "Invalid parameters for userNaturalSortKey";
+        assert(argc == 1);
+        sqlite3_result_null(context);
+        return;
+    }
+
+    const char* name = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+    const string key = naturalsorting_key(name ? name : "");
+    sqlite3_result_text(context, key.c_str(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
+}
+
 void SqliteAccountState::userMatchFilter(sqlite3_context* context, int argc, sqlite3_value** argv)
 {
     bool result = false;
@@ -2367,10 +4531,11 @@ void SqliteAccountState::userMatchFilter(sqlite3_context* context, int argc, sql
                                sqlite3_result_int(context, result);
                            }};
 
-    if (argc != 10)
+    if (argc != 11)
     {
         LOG_err << "Invalid parameters for userMatchFilter. Expected (in this order): filter*, "
-                   "flags, type, ctime, mtime, mimetypeVirtual, name, description, tags, fav";
+                   "flags, type, ctime, mtime, mimetypeVirtual, name, description, tags, fav, "
+                   "nodehandle";
         assert(false);
         return;
     }
@@ -2419,7 +4584,9 @@ void SqliteAccountState::userMatchFilter(sqlite3_context* context, int argc, sql
         conditionEvals.emplace_back(
             [&filter, &argv]()
             {
-                return filter->isValidName(sqlite3_value_text(argv[6]));
+                // cheap check against the name index (if any) before the pattern matching
+                return filter->isNameCandidate(sqlite3_value_int64(argv[10])) &&
+                       filter->isValidName(sqlite3_value_text(argv[6]));
             });
     if (filter->hasDescription())
         conditionEvals.emplace_back(
@@ -2461,7 +4628,7 @@ void SqliteAccountState::userMatchFilter(sqlite3_context* context, int argc, sql
 
 std::string OrderByClause::get(int order)
 {
-    static const std::string nameSort = "name COLLATE NATURALNOCASE";
+    static const std::string nameSort = "nameKey";
     static const std::string typeSort = " type DESC";
     switch (order)
     {
@@ -2496,6 +4663,62 @@ std::string OrderByClause::get(int order)
     }
 }
 
+std::vector<std::pair<std::string, bool>> OrderByClause::getKeys(int order)
+{
+    static const std::pair<std::string, bool> nameAsc{"IFNULL(nameKey, '')", false};
+    static const std::pair<std::string, bool> nameDesc{nameAsc.first, true};
+    static const std::pair<std::string, bool> typeDesc{"type", true};
+
+    std::vector<std::pair<std::string, bool>> keys;
+    switch (order)
+    {
+        case DEFAULT_DESC:
+            keys = {typeDesc, nameDesc};
+            break;
+        case SIZE_ASC:
+            keys = {typeDesc, {"IFNULL(sizeVirtual, 0)", false}, nameAsc};
+            break;
+        case SIZE_DESC:
+            keys = {typeDesc, {"IFNULL(sizeVirtual, 0)", true}, nameDesc};
+            break;
+        case CTIME_ASC:
+            keys = {typeDesc, {"IFNULL(ctime, 0)", false}, nameAsc};
+            break;
+        case CTIME_DESC:
+            keys = {typeDesc, {"IFNULL(ctime, 0)", true}, nameDesc};
+            break;
+        case MTIME_ASC:
+            keys = {typeDesc, {"IFNULL(mtime, 0)", false}, nameAsc};
+            break;
+        case MTIME_DESC:
+            keys = {typeDesc, {"IFNULL(mtime, 0)", true}, nameDesc};
+            break;
+        case LABEL_ASC:
+            keys = {{"(CASE WHEN IFNULL(label, 0) = 0 THEN 1 ELSE 0 END)", false},
+                    {"IFNULL(label, 0)", false},
+                    typeDesc,
+                    nameAsc};
+            break;
+        case LABEL_DESC:
+            keys = {{"IFNULL(label, 0)", true}, typeDesc, nameAsc};
+            break;
+        // fav have inverse order
+        case FAV_ASC:
+            keys = {{"IFNULL(fav, 0)", true}, typeDesc, nameAsc};
+            break;
+        case FAV_DESC:
+            keys = {{"IFNULL(fav, 0)", false}, typeDesc, nameAsc};
+            break;
+        case DEFAULT_ASC:
+        default:
+            keys = {typeDesc, nameAsc};
+            break;
+    }
+
+    keys.emplace_back("nodehandle", false);
+    return keys;
+}
+
 size_t OrderByClause::getId(int order)
 {
     return static_cast<size_t>(order);
@@ -0,0 +1,298 @@
+/**
+ * @file eventloopmonitor.cpp
+ * @brief Time accounting and slow-slice detection for the client thread
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/eventloopmonitor.h"
+#include "mega/attrmap.h"
+#include "mega/json.h"
+#include "mega/logging.h"
+#include "mega/utils.h"
+
+namespace mega {
+
+using namespace std::chrono;
+
+constexpr size_t EventLoopMonitor::NUM_BUCKETS;
+constexpr size_t EventLoopMonitor::MAX_SLOW_SLICES;
+constexpr unsigned EventLoopMonitor::DEFAULT_SLOW_THRESHOLD_MS;
+
+const char* EventLoopMonitor::phaseName(Phase phase)
+{
+    switch (phase)
+    {
+        case PHASE_EXEC: return "exec";
+        case PHASE_PREPARE_WAIT: return "preparewait";
+        case PHASE_WAIT: return "wait";
+        case PHASE_CHECK_EVENTS: return "checkevents";
+        case PHASE_CS_RESPONSE: return "csresponse";
+        case PHASE_SC_PROCESSING: return "scprocessing";
+        case PHASE_SYNC_ACTIONS: return "syncactions";
+        case PHASE_SEND_REQUESTS: return "sendrequests";
+        case PHASE_SEND_TRANSFERS: return "sendtransfers";
+        case NUM_PHASES: break;
+    }
+    assert(false);
+    return "unknown";
+}
+
+EventLoopMonitor::Scope::Scope(EventLoopMonitor& monitor, Phase phase)
+    : mMonitor(monitor)
+    , mPhase(phase)
+    , mStarted(steady_clock::now())
+{
+    mMonitor.enter(mPhase);
+}
+
+EventLoopMonitor::Scope::~Scope()
+{
+    mMonitor.leave(mPhase, mStarted);
+}
+
+EventLoopMonitor::Task::Task(EventLoopMonitor& monitor, const char* kind, const char* name)
+    : mMonitor(monitor)
+    , mKind(kind)
+    , mName(name)
+    , mActive(monitor.inSlice() && monitor.mSlowThresholdMs.load(std::memory_order_relaxed))
+{
+    if (mActive)
+    {
+        mStarted = steady_clock::now();
+    }
+}
+
+EventLoopMonitor::Task::Task(EventLoopMonitor& monitor, const char* kind, nameid name)
+    : Task(monitor, kind, nullptr)
+{
+    mNameId = name;
+}
+
+EventLoopMonitor::Task::~Task()
+{
+    if (mActive)
+    {
+        mMonitor.taskDone(mKind, mName, mNameId, duration_cast<microseconds>(steady_clock::now() - mStarted));
+    }
+}
+
+void EventLoopMonitor::enter(Phase phase)
+{
+    // the wait leaves the thread free, it doesn't hold anything up
+    if (phase != PHASE_WAIT)
+    {
+        ++mDepth;
+    }
+}
+
+void EventLoopMonitor::leave(Phase phase, steady_clock::time_point started)
+{
+    auto elapsed = duration_cast<microseconds>(steady_clock::now() - started);
+    auto us = static_cast<uint64_t>(std::max<int64_t>(elapsed.count(), 0));
+
+    size_t bucket = 0;
+    while (bucket + 1 < NUM_BUCKETS && us >> bucket)
+    {
+        ++bucket;
+    }
+
+    auto& histogram = mPhases[phase];
+    histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+    histogram.totalUs.fetch_add(us, std::memory_order_relaxed);
+
+    // only the client thread writes, a reset may race but just loses the sample
+    if (us > histogram.longestUs.load(std::memory_order_relaxed))
+    {
+        histogram.longestUs.store(us, std::memory_order_relaxed);
+    }
+
+    if (phase == PHASE_WAIT)
+    {
+        return;
+    }
+
+    assert(mDepth);
+    if (--mDepth)
+    {
+        return;
+    }
+
+    // the end of a slice
+    auto threshold = mSlowThresholdMs.load(std::memory_order_relaxed);
+    if (threshold && elapsed >= milliseconds(threshold))
+    {
+        SlowSlice slice;
+        slice.when = m_time();
+        slice.phase = phase;
+        slice.duration = elapsed;
+
+        if (mLongestTaskKind)
+        {
+            slice.taskKind = mLongestTaskKind;
+            slice.taskName = mLongestTaskName;
+            slice.taskDuration = mLongestTask;
+
+            LOG_warn << "Slow " << phaseName(phase) << ": " << elapsed.count() / 1000 << " ms, longest in "
+                     << slice.taskKind << " " << slice.taskName << ": " << mLongestTask.count() / 1000 << " ms";
+        }
+        else
+        {
+            LOG_warn << "Slow " << phaseName(phase) << ": " << elapsed.count() / 1000 << " ms";
+        }
+
+        lock_guard<mutex> g(mSlowSlicesMutex);
+        if (mSlowSlices.size() == MAX_SLOW_SLICES)
+        {
+            mSlowSlices.pop_front();
+        }
+        mSlowSlices.emplace_back(std::move(slice));
+    }
+
+    mLongestTaskKind = nullptr;
+    mLongestTask = microseconds(0);
+}
+
+void EventLoopMonitor::taskDone(const char* kind, const char* name, nameid id, microseconds elapsed)
+{
+    // tasks nest in each other, the outer one is the longest and names the work
+    if (elapsed <= mLongestTask || !inSlice())
+    {
+        return;
+    }
+
+    mLongestTaskKind = kind;
+    if (name)
+    {
+        mLongestTaskName = name;
+    }
+    else
+    {
+        mLongestTaskName = AttrMap::nameid2string(id);
+    }
+    mLongestTask = elapsed;
+}
+
+void EventLoopMonitor::setSlowThreshold(milliseconds threshold)
+{
+    mSlowThresholdMs.store(static_cast<unsigned>(std::max<milliseconds::rep>(threshold.count(), 0)), std::memory_order_relaxed);
+}
+
+milliseconds EventLoopMonitor::slowThreshold() const
+{
+    return milliseconds(mSlowThresholdMs.load(std::memory_order_relaxed));
+}
+
+EventLoopMonitor::PhaseStats EventLoopMonitor::phaseStats(Phase phase) const
+{
+    assert(phase < NUM_PHASES);
+
+    auto& histogram = mPhases[phase];
+
+    PhaseStats stats;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i)
+    {
+        stats.buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+    }
+    stats.count = histogram.count.load(std::memory_order_relaxed);
+    stats.total = microseconds(histogram.totalUs.load(std::memory_order_relaxed));
+    stats.longest = microseconds(histogram.longestUs.load(std::memory_order_relaxed));
+    return stats;
+}
+
+vector<EventLoopMonitor::SlowSlice> EventLoopMonitor::slowSlices() const
+{
+    lock_guard<mutex> g(mSlowSlicesMutex);
+    return vector<SlowSlice>(mSlowSlices.begin(), mSlowSlices.end());
+}
+
+string EventLoopMonitor::toJson(bool reset)
+{
+    JSONWriter writer;
+    writer.beginobject();
+    writer.arg("slowThresholdMs", m_off_t(slowThreshold().count()));
+
+    writer.beginarray("phases");
+    for (int i = 0; i < NUM_PHASES; ++i)
+    {
+        auto phase = static_cast<Phase>(i);
+        auto stats = phaseStats(phase);
+
+        writer.beginobject();
+        writer.arg("name", phaseName(phase));
+        writer.arg("count", m_off_t(stats.count));
+        writer.arg("totalUs", m_off_t(stats.total.count()));
+        writer.arg("maxUs", m_off_t(stats.longest.count()));
+
+        writer.beginarray("histogram");
+        for (auto n : stats.buckets)
+        {
+            writer.addcomma();
+            writer.appendraw(std::to_string(n).c_str());
+        }
+        writer.endarray();
+        writer.endobject();
+    }
+    writer.endarray();
+
+    writer.beginarray("slow");
+    for (auto& slice : slowSlices())
+    {
+        writer.beginobject();
+        writer.arg("time", m_off_t(slice.when));
+        writer.arg("phase", phaseName(slice.phase));
+        writer.arg("us", m_off_t(slice.duration.count()));
+
+        if (!slice.taskKind.empty())
+        {
+            writer.arg("taskKind", slice.taskKind);
+            writer.arg_stringWithEscapes("taskName", slice.taskName);
+            writer.arg("taskUs", m_off_t(slice.taskDuration.count()));
+        }
+        writer.endobject();
+    }
+    writer.endarray();
+
+    writer.endobject();
+
+    if (reset)
+    {
+        this->reset();
+    }
+
+    return writer.getstring();
+}
+
+void EventLoopMonitor::reset()
+{
+    for (auto& histogram : mPhases)
+    {
+        for (auto& n : histogram.buckets)
+        {
+            n.store(0, std::memory_order_relaxed);
+        }
+        histogram.count.store(0, std::memory_order_relaxed);
+        histogram.totalUs.store(0, std::memory_order_relaxed);
+        histogram.longestUs.store(0, std::memory_order_relaxed);
+    }
+
+    lock_guard<mutex> g(mSlowSlicesMutex);
+    mSlowSlices.clear();
+}
+
+} // namespace
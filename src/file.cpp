@@ -423,17 +423,13 @@ void File::sendPutnodesOfUpload(MegaClient* client, UploadHandle fileAttrMatchHa
             }
         }
 
-        client->reqs.add(new CommandPutNodes(client,
-                                             th,
-                                             NULL,
-                                             mVersioningOption,
-                                             std::move(newnodes),
-                                             tag,
-                                             source,
-                                             nullptr,
-                                             std::move(completion),
-                                             canChangeVault,
-                                             {})); // customerIpPort
+        client->putnodesOfUpload(th,
+                                 mVersioningOption,
+                                 std::move(newnodes.front()),
+                                 tag,
+                                 source,
+                                 std::move(completion),
+                                 canChangeVault);
     }
 }
 
@@ -772,6 +768,11 @@ SyncUpload_inClient::~SyncUpload_inClient()
     {
         // Remove file attributes if they weren't removed upon ~Transfer destructor
         syncThreadSafeState->client()->fileAttributesUploading.erase(uploadHandle);
+
+        if (!wasPutnodesCompleted)
+        {
+            syncThreadSafeState->client()->fileAttributesAfterUpload.erase(uploadHandle);
+        }
     }
 
     if (putnodesStarted)
@@ -0,0 +1,165 @@
+/**
+ * @file fileattributecache.cpp
+ * @brief On-disk cache of fetched and generated file attributes
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/fileattributecache.h"
+#include "mega/logging.h"
+#include "mega/utils.h"
+
+#include <algorithm>
+
+namespace mega {
+
+FileAttributeCache::FileAttributeCache(FileSystemAccess& fsAccess, const LocalPath& folder, m_off_t capacity)
+    : mFsAccess(fsAccess)
+    , mFolder(folder)
+    , mCapacity(capacity)
+{
+    mFsAccess.mkdirlocal(mFolder, false, false);
+
+    // pick up what earlier sessions cached, most recently used first
+    vector<std::tuple<m_time_t, handle, m_off_t>> found;
+
+    auto da = mFsAccess.newdiraccess();
+    LocalPath folderPath = mFolder;
+    if (da->dopen(&folderPath, nullptr, false))
+    {
+        LocalPath name;
+        nodetype_t type;
+        while (da->dnext(folderPath, name, false, &type))
+        {
+            string encoded = name.toPath(false);
+            handle fah = encoded.size() == 16 ? Utils::hexStringToUint64(encoded) : UNDEF;
+            if (type != FILENODE || Utils::uint64ToHexString(fah) != encoded)
+            {
+                continue;
+            }
+
+            auto fa = mFsAccess.newfileaccess();
+            if (fa->fopen(path(fah), true, false, FSLogging::noLogging))
+            {
+                found.emplace_back(fa->mtime, fah, fa->size);
+            }
+        }
+    }
+
+    std::sort(found.begin(), found.end(), std::greater<>());
+    for (auto& [mtime, fah, size] : found)
+    {
+        mRecency.push_back(fah);
+        mEntries[fah] = Entry{size, std::prev(mRecency.end())};
+        mSize += size;
+    }
+
+    // the capacity may have been lowered since
+    while (mSize > mCapacity && !mRecency.empty())
+    {
+        remove(mEntries.find(mRecency.back()));
+    }
+
+    LOG_debug << "File attribute cache holds " << mEntries.size() << " attributes, " << mSize << " bytes";
+}
+
+bool FileAttributeCache::get(handle fah, string& data)
+{
+    auto it = mEntries.find(fah);
+    if (it == mEntries.end())
+    {
+        return false;
+    }
+
+    auto fa = mFsAccess.newfileaccess();
+    if (!fa->fopen(path(fah), true, false, FSLogging::logExceptFileNotFound)
+        || !fa->fread(&data, static_cast<unsigned>(fa->size), 0, 0, FSLogging::logOnError))
+    {
+        // removed behind our back, it will be fetched again
+        remove(it);
+        return false;
+    }
+    fa.reset();
+
+    mRecency.splice(mRecency.begin(), mRecency, it->second.position);
+    mFsAccess.setmtimelocal(path(fah), m_time());
+    return true;
+}
+
+void FileAttributeCache::put(handle fah, const string& data)
+{
+    if (data.empty() || m_off_t(data.size()) > mCapacity)
+    {
+        return;
+    }
+
+    auto it = mEntries.find(fah);
+    if (it != mEntries.end())
+    {
+        // attributes never change under the same handle
+        mRecency.splice(mRecency.begin(), mRecency, it->second.position);
+        return;
+    }
+
+    LocalPath filePath = path(fah);
+    auto fa = mFsAccess.newfileaccess();
+    if (!fa->fopen(filePath, false, true, FSLogging::logOnError)
+        || !fa->fwrite((const byte*)data.data(), static_cast<unsigned>(data.size()), 0))
+    {
+        fa.reset();
+        mFsAccess.unlinklocal(filePath);
+        return;
+    }
+    fa.reset();
+
+    mRecency.push_front(fah);
+    mEntries[fah] = Entry{m_off_t(data.size()), mRecency.begin()};
+    mSize += m_off_t(data.size());
+
+    while (mSize > mCapacity)
+    {
+        remove(mEntries.find(mRecency.back()));
+    }
+}
+
+void FileAttributeCache::clear()
+{
+    while (!mEntries.empty())
+    {
+        remove(mEntries.begin());
+    }
+}
+
+LocalPath FileAttributeCache::path(handle fah) const
+{
+    // hexadecimal, as base64 names could clash on case insensitive filesystems
+    LocalPath filePath = mFolder;
+    filePath.appendWithSeparator(LocalPath::fromRelativePath(Utils::uint64ToHexString(fah)), false);
+    return filePath;
+}
+
+void FileAttributeCache::remove(map<handle, Entry>::iterator it)
+{
+    assert(it != mEntries.end());
+
+    mFsAccess.unlinklocal(path(it->first));
+    mSize -= it->second.size;
+    mRecency.erase(it->second.position);
+    mEntries.erase(it);
+}
+
+} // namespace
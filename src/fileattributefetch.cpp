@@ -149,6 +149,10 @@ void FileAttributeFetchChannel::parse(int /*fac*/, bool final)
                     {
                         LOG_err << "Failed to CBC decrypt file attributes";
                     }
+                    else if (client->mFileAttributeCache)
+                    {
+                        client->mFileAttributeCache->put(h, string(ptr, falen));
+                    }
                     client->app->fa_complete(it->second->nodehandle, it->second->type, ptr, falen);
                 }
 
@@ -29,6 +29,9 @@ namespace
 {
 constexpr int MAXFULL = 8192;
 
+// sparse samples of a large file that fall within this span are fetched with a single read
+constexpr unsigned SPARSEREADSPAN = 65536;
+
 } // anonymous
 
 namespace mega {
@@ -189,18 +192,41 @@ bool FileFingerprint::genfingerprint(FileAccess* fa, bool ignoremtime)
     {
         // large file: sparse coverage, four sparse CRC32s
         HashCRC32 crc32;
-        byte block[4 * sizeof crc];
-        const unsigned blocks = MAXFULL / unsigned(sizeof block * crc.size());
+        const size_t blockSize = 4 * sizeof crc;
+        const unsigned blocks = MAXFULL / unsigned(blockSize * crc.size());
+        const unsigned samples = unsigned(crc.size()) * blocks;
 
-        for (unsigned i = 0; i < crc.size(); i++)
+        auto sampleOffset = [&](unsigned k)
         {
-            for (unsigned j = 0; j < blocks; j++)
+            return static_cast<m_off_t>((static_cast<size_t>(size) - blockSize) * k / (samples - 1));
+        };
+
+        // file range currently in window
+        std::vector<byte> window;
+        m_off_t windowStart = 0;
+        m_off_t windowEnd = 0;
+
+        for (unsigned k = 0; k < samples; k++)
+        {
+            m_off_t offset = sampleOffset(k);
+
+            if (offset + static_cast<m_off_t>(blockSize) > windowEnd)
             {
-                if (!fa->frawread(block,
-                                  sizeof block,
-                                  static_cast<m_off_t>((static_cast<size_t>(size) - sizeof block) *
-                                                       (i * blocks + j) /
-                                                       (crc.size() * blocks - 1)),
+                // read up to the last of the next samples that still fits in the span
+                unsigned last = k;
+                while (last + 1 < samples &&
+                       sampleOffset(last + 1) + static_cast<m_off_t>(blockSize) - offset <= SPARSEREADSPAN)
+                {
+                    last++;
+                }
+
+                windowStart = offset;
+                windowEnd = sampleOffset(last) + static_cast<m_off_t>(blockSize);
+                window.resize(static_cast<size_t>(windowEnd - windowStart));
+
+                if (!fa->frawread(window.data(),
+                                  static_cast<unsigned>(window.size()),
+                                  windowStart,
                                   true,
                                   FSLogging::logOnError))
                 {
@@ -208,12 +234,15 @@ bool FileFingerprint::genfingerprint(FileAccess* fa, bool ignoremtime)
                     fa->closef();
                     return true;
                 }
-
-                crc32.add(block, sizeof block);
             }
 
-            crc32.get((byte*)&crcval);
-            newcrc[i] = static_cast<int32_t>(htonl(static_cast<uint32_t>(crcval)));
+            crc32.add(window.data() + (offset - windowStart), static_cast<unsigned>(blockSize));
+
+            if ((k + 1) % blocks == 0)
+            {
+                crc32.get((byte*)&crcval);
+                newcrc[k / blocks] = static_cast<int32_t>(htonl(static_cast<uint32_t>(crcval)));
+            }
         }
     }
 
@@ -221,6 +221,20 @@ int compareUtf(UnicodeCodepointIterator<CharT> first1, bool unescaping1,
     return 1;
 }
 
+// Identical strings compare equal however they're read, provided both are read the same way: the
+// common case in the sync's comparisons, settled with a memcmp instead of a codepoint walk.
+template<typename StringT>
+bool identical(const StringT& s1, bool unescaping1, const StringT& s2, bool unescaping2)
+{
+    return unescaping1 == unescaping2 && s1 == s2;
+}
+
+template<typename StringT, typename StringU>
+bool identical(const StringT&, bool, const StringU&, bool)
+{
+    return false;
+}
+
 } // detail
 
 fsfp_t::fsfp_t(std::uint64_t fingerprint,
@@ -361,6 +375,11 @@ bool fsfp_tracker_t::remove(const fsfp_t& id)
 
 int compareUtf(const string& s1, bool unescaping1, const string& s2, bool unescaping2, bool caseInsensitive)
 {
+    if (detail::identical(s1, unescaping1, s2, unescaping2))
+    {
+        return 0;
+    }
+
     return detail::compareUtf(
                 unicodeCodepointIterator(s1), unescaping1,
                 unicodeCodepointIterator(s2), unescaping2,
@@ -369,6 +388,11 @@ int compareUtf(const string& s1, bool unescaping1, const string& s2, bool unesca
 
 int compareUtf(const string& s1, bool unescaping1, const LocalPath& s2, bool unescaping2, bool caseInsensitive)
 {
+    if (detail::identical(s1, unescaping1, s2.localpath, unescaping2))
+    {
+        return 0;
+    }
+
     return detail::compareUtf(
         unicodeCodepointIterator(s1), unescaping1,
         unicodeCodepointIterator(s2.localpath), unescaping2,
@@ -377,6 +401,11 @@ int compareUtf(const string& s1, bool unescaping1, const LocalPath& s2, bool une
 
 int compareUtf(const LocalPath& s1, bool unescaping1, const string& s2, bool unescaping2, bool caseInsensitive)
 {
+    if (detail::identical(s1.localpath, unescaping1, s2, unescaping2))
+    {
+        return 0;
+    }
+
     return detail::compareUtf(
         unicodeCodepointIterator(s1.localpath), unescaping1,
         unicodeCodepointIterator(s2), unescaping2,
@@ -385,6 +414,11 @@ int compareUtf(const LocalPath& s1, bool unescaping1, const string& s2, bool une
 
 int compareUtf(const LocalPath& s1, bool unescaping1, const LocalPath& s2, bool unescaping2, bool caseInsensitive)
 {
+    if (detail::identical(s1.localpath, unescaping1, s2.localpath, unescaping2))
+    {
+        return 0;
+    }
+
     return detail::compareUtf(
         unicodeCodepointIterator(s1.localpath), unescaping1,
         unicodeCodepointIterator(s2.localpath), unescaping2,
@@ -946,6 +980,9 @@ void LocalPath::utf8_normalize(string* filename)
 {
     if (!filename) return;
 
+    // ASCII is already in NFC: only names with other characters need utf8proc
+    if (Utils::isAscii(*filename)) return;
+
     const char* cfilename = filename->c_str();
     size_t fnsize = filename->size();
     string result;
@@ -1000,6 +1037,16 @@ handle FileSystemAccess::fsidOf(const LocalPath& path, bool follow, bool skipcas
 
 #ifdef ENABLE_SYNC
 
+bool FileSystemAccess::fsSolidState(const LocalPath&, bool&) const
+{
+    return false;
+}
+
+bool FileSystemAccess::setBackgroundIO(bool)
+{
+    return false;
+}
+
 bool FileSystemAccess::initFilesystemNotificationSystem()
 {
     return true;
@@ -2057,11 +2104,12 @@ LocalPath FileNameGenerator::suffix(FileAccess* fa, const LocalPath& localname,
     return localnewname;
 }
 
-FileDistributor::FileDistributor(const LocalPath& lp, size_t ntargets, m_time_t mtime, const FileFingerprint& confirm)
+FileDistributor::FileDistributor(const LocalPath& lp, size_t ntargets, m_time_t mtime, const FileFingerprint& confirm, bool hardLinks)
     : theFile(lp)
     , numTargets(ntargets)
     , mMtime(mtime)
     , confirmFingerprint(confirm)
+    , mHardLinks(hardLinks)
 {
 
 }
@@ -2374,6 +2422,13 @@ bool FileDistributor::distributeTo(LocalPath& lp, FileSystemAccess& fsaccess, Ta
         }
         else
         {
+            if (mHardLinks && !fsaccess.fileExistsAt(lp) && fsaccess.hardlinklocal(theFile, lp))
+            {
+                LOG_debug << "Hard linked downloaded file to target path";
+                removeTarget();
+                return true;
+            }
+
             // otherwise copy
             if (copyTo(theFile, lp, mMtime, method, fsaccess, transient_error, name_too_long, syncForDebris, confirmFingerprint))
             {
@@ -2407,19 +2462,68 @@ bool isNetworkFilesystem(FileSystemType type)
 
 
 std::atomic<size_t> ScanService::mNumServices(0);
-std::unique_ptr<ScanService::Worker> ScanService::mWorker;
-std::mutex ScanService::mWorkerLock;
+#if defined(__ANDROID__) || defined(USE_IOS)
+const size_t FingerprintCache::MAX_ENTRIES = 50000;
+#else
+const size_t FingerprintCache::MAX_ENTRIES = 250000;
+#endif
 
-ScanService::ScanService()
+bool FingerprintCache::reuse(FSNode& node)
 {
-    // Locking here, rather than in the if statement, ensures that the
-    // worker is fully constructed when control leaves the constructor.
-    std::lock_guard<std::mutex> lock(mWorkerLock);
+    if (node.type != FILENODE || node.fsid == UNDEF)
+        return false;
 
-    if (++mNumServices == 1)
+    std::lock_guard<std::mutex> guard(mMutex);
+
+    auto i = mFingerprints.find(node.fsid);
+
+    if (i == mFingerprints.end()
+        || i->second.size != node.fingerprint.size
+        || i->second.mtime != node.fingerprint.mtime)
+        return false;
+
+    node.fingerprint = i->second;
+
+    return true;
+}
+
+void FingerprintCache::add(handle fsid, const FileFingerprint& fingerprint)
+{
+    if (fsid == UNDEF || !fingerprint.isvalid)
+        return;
+
+    std::lock_guard<std::mutex> guard(mMutex);
+
+    auto result = mFingerprints.emplace(fsid, fingerprint);
+
+    if (!result.second)
     {
-        mWorker.reset(new Worker());
+        result.first->second = fingerprint;
+        return;
     }
+
+    mAdded.emplace_back(fsid);
+
+    if (mAdded.size() > MAX_ENTRIES)
+    {
+        mFingerprints.erase(mAdded.front());
+        mAdded.pop_front();
+    }
+}
+
+std::map<fsfp_t, std::unique_ptr<ScanService::Worker>> ScanService::mWorkers;
+std::mutex ScanService::mWorkerLock;
+
+#if defined(__ANDROID__) || defined(USE_IOS)
+const unsigned ScanService::SOLID_STATE_WORKER_THREADS = 2;
+#else
+const unsigned ScanService::SOLID_STATE_WORKER_THREADS = 4;
+#endif
+const unsigned ScanService::UNKNOWN_DEVICE_WORKER_THREADS = 2;
+
+ScanService::ScanService()
+{
+    ++mNumServices;
 }
 
 ScanService::~ScanService()
@@ -2427,17 +2531,65 @@ ScanService::~ScanService()
     if (--mNumServices == 0)
     {
         std::lock_guard<std::mutex> lock(mWorkerLock);
-        mWorker.reset();
+        mWorkers.clear();
+    }
+}
+
+unsigned ScanService::workerThreads(const fsfp_t& fsfp, const LocalPath& path)
+{
+    // Workers are only destroyed with the last service, so this one stays valid once returned.
+    std::lock_guard<std::mutex> lock(mWorkerLock);
+
+    auto& worker = mWorkers[fsfp];
+
+    if (!worker)
+    {
+        FSACCESS_CLASS fsAccess;
+
+        auto type = fsAccess.getlocalfstype(path);
+        bool solidState = false;
+        bool known = fsAccess.fsSolidState(path, solidState);
+
+        unsigned numThreads = UNKNOWN_DEVICE_WORKER_THREADS;
+
+        if (isNetworkFilesystem(type) || (known && !solidState))
+            numThreads = 1;
+        else if (known)
+            numThreads = SOLID_STATE_WORKER_THREADS;
+
+        LOG_debug << "Filesystem " << fsfp.toString()
+                  << " containing " << path
+                  << " is " << (isNetworkFilesystem(type) ? "remote" : !known ? "of unknown kind" : solidState ? "solid state" : "rotational")
+                  << ", scanning with " << numThreads << " thread(s)";
+
+        worker.reset(new Worker(numThreads));
     }
+
+    return static_cast<unsigned>(std::max<size_t>(worker->numThreads(), 1));
+}
+
+FingerprintCache* ScanService::fingerprintCache(const fsfp_t& fsfp)
+{
+    std::lock_guard<std::mutex> lock(mWorkerLock);
+
+    auto i = mWorkers.find(fsfp);
+
+    return i == mWorkers.end() ? nullptr : &i->second->mFingerprints;
 }
 
-auto ScanService::queueScan(LocalPath targetPath, handle expectedFsid, bool followSymlinks, map<LocalPath, FSNode>&& priorScanChildren, shared_ptr<Waiter> waiter) -> RequestPtr
+auto ScanService::queueScan(const fsfp_t& fsfp, LocalPath targetPath, handle expectedFsid, bool followSymlinks, map<LocalPath, FSNode>&& priorScanChildren, shared_ptr<Waiter> waiter, bool interactive, bool backgroundIO) -> RequestPtr
 {
+    // Make sure the filesystem has its workers.
+    workerThreads(fsfp, targetPath);
+
     // Create a request to represent the scan.
-    auto request = std::make_shared<ScanRequest>(std::move(waiter), followSymlinks, targetPath, expectedFsid, std::move(priorScanChildren));
+    auto request = std::make_shared<ScanRequest>(std::move(waiter), followSymlinks, targetPath, expectedFsid, std::move(priorScanChildren), interactive, backgroundIO);
 
     // Queue request for processing.
-    mWorker->queue(request);
+    {
+        std::lock_guard<std::mutex> lock(mWorkerLock);
+        mWorkers[fsfp]->queue(request);
+    }
 
     return request;
 }
@@ -2446,7 +2598,9 @@ ScanService::ScanRequest::ScanRequest(shared_ptr<Waiter> waiter,
     bool followSymLinks,
     LocalPath targetPath,
     handle expectedFsid,
-    map<LocalPath, FSNode>&& priorScanChildren)
+    map<LocalPath, FSNode>&& priorScanChildren,
+    bool interactive,
+    bool backgroundIO)
     : mWaiter(waiter)
     , mScanResult(SCAN_INPROGRESS)
     , mFollowSymLinks(followSymLinks)
@@ -2454,12 +2608,13 @@ ScanService::ScanRequest::ScanRequest(shared_ptr<Waiter> waiter,
     , mResults()
     , mTargetPath(std::move(targetPath))
     , mExpectedFsid(expectedFsid)
+    , mInteractive(interactive)
+    , mBackgroundIO(backgroundIO)
 {
 }
 
 ScanService::Worker::Worker(size_t numThreads)
-    : mFsAccess(new FSACCESS_CLASS())
-    , mPending()
+    : mPending()
     , mPendingLock()
     , mPendingNotifier()
     , mThreads()
@@ -2515,7 +2670,18 @@ void ScanService::Worker::queue(ScanRequestPtr request)
     // Queue the request.
     {
         std::unique_lock<std::mutex> lock(mPendingLock);
-        mPending.emplace_back(std::move(request));
+
+        auto i = mPending.end();
+
+        // Behind the other interactive requests but ahead of the rest.
+        if (request->mInteractive)
+        {
+            i = std::find_if(mPending.begin(), mPending.end(), [](const ScanRequestPtr& pending) {
+                return !pending || !pending->mInteractive;
+            });
+        }
+
+        mPending.emplace(i, std::move(request));
     }
 
     // Tell the lucky thread it has something to do.
@@ -2527,6 +2693,11 @@ void ScanService::Worker::loop()
     // We're ready when we have some work to do.
     auto ready = [this]() { return !mPending.empty(); };
 
+    FSACCESS_CLASS fsAccess;
+
+    // The I/O priority this thread is at.
+    bool backgroundIO = false;
+
     for ( ; ; )
     {
         ScanRequestPtr request;
@@ -2549,13 +2720,22 @@ void ScanService::Worker::loop()
             mPending.pop_front();
         }
 
+        if (request->mBackgroundIO != backgroundIO)
+        {
+            if (!fsAccess.setBackgroundIO(request->mBackgroundIO))
+            {
+                LOG_debug << "Unable to change the I/O priority of the scan thread";
+            }
+            backgroundIO = request->mBackgroundIO;
+        }
+
         LOG_verbose << "Directory scan begins: " << request->mTargetPath;
         using namespace std::chrono;
         auto scanStart = high_resolution_clock::now();
 
         // Process the request.
         unsigned nFingerprinted = 0;
-        auto result = scan(request, nFingerprinted);
+        auto result = scan(request, fsAccess, nFingerprinted);
         auto scanEnd = high_resolution_clock::now();
 
         if (result == SCAN_SUCCESS)
@@ -2575,24 +2755,41 @@ void ScanService::Worker::loop()
     }
 }
 
-// Really we only have one worker despite the vector of threads - maybe we should just have one
-// regardless of multiple clients too - there is only one filesystem after all (but not singleton!!)
+// Workers (with their threads) shared by all clients, one per filesystem (but not singletons!!)
 CodeCounter::ScopeStats ScanService::syncScanTime = { "folderScan" };
 
-auto ScanService::Worker::scan(ScanRequestPtr request, unsigned& nFingerprinted) -> ScanResult
+auto ScanService::Worker::scan(ScanRequestPtr request, FileSystemAccess& fsAccess, unsigned& nFingerprinted) -> ScanResult
 {
     CodeCounter::ScopeTimer rst(syncScanTime);
+    auto started = std::chrono::steady_clock::now();
 
-    auto result = mFsAccess->directoryScan(request->mTargetPath,
+    auto result = fsAccess.directoryScan(request->mTargetPath,
         request->mExpectedFsid,
         request->mKnown,
         request->mResults,
         request->mFollowSymLinks,
-        nFingerprinted);
+        nFingerprinted,
+        &mFingerprints);
 
     // No need to keep this data around anymore.
     request->mKnown.clear();
 
+    // Whatever was fingerprinted, or reused, may turn up somewhere else later.
+    unsigned nValid = 0;
+
+    for (auto& node : request->mResults)
+    {
+        if (node.type == FILENODE && node.fingerprint.isvalid)
+        {
+            mFingerprints.add(node.fsid, node.fingerprint);
+            ++nValid;
+        }
+    }
+
+    request->mFingerprintsComputed = nFingerprinted;
+    request->mFingerprintsReused = nValid > nFingerprinted ? nValid - nFingerprinted : 0;
+    request->mScanTime = std::chrono::steady_clock::now() - started;
+
     return result;
 }
 
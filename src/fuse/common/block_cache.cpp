@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <mega/fuse/common/block_cache.h>
+#include <mega/fuse/common/error_or.h>
+#include <mega/fuse/common/logging.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+// How large is the sidecar's header?
+//
+// The header records the node's handle and size.
+static constexpr std::size_t HeaderSize = 2 * sizeof(std::uint64_t);
+
+static const std::string BlocksSuffix = ".blocks";
+static const std::string ContentSuffix = ".partial";
+
+static bool endsWith(const std::string& name, const std::string& suffix);
+
+BlockCache::BlockCache(FileAccessPtr content,
+                       FileAccessPtr blocks,
+                       FileSystemAccess& fsAccess,
+                       LocalPath path,
+                       NodeHandle handle,
+                       m_off_t size)
+  : mContent(std::move(content))
+  , mBlocks(std::move(blocks))
+  , mFSAccess(fsAccess)
+  , mHandle(handle)
+  , mNumPresent(0)
+  , mPath(std::move(path))
+  , mPresent()
+  , mSize(size)
+{
+    mPresent.resize((numBlocks() + 7) / 8);
+}
+
+bool BlockCache::flush()
+{
+    std::string buffer(HeaderSize, '\0');
+
+    auto handle = mHandle.as8byte();
+    auto size = static_cast<std::uint64_t>(mSize);
+
+    std::memcpy(&buffer[0], &handle, sizeof(handle));
+    std::memcpy(&buffer[sizeof(handle)], &size, sizeof(size));
+
+    buffer.append(mPresent.begin(), mPresent.end());
+
+    return mBlocks->fwrite(reinterpret_cast<const byte*>(buffer.data()),
+                           static_cast<unsigned>(buffer.size()),
+                           0);
+}
+
+std::size_t BlockCache::numBlocks() const
+{
+    return static_cast<std::size_t>((mSize + BlockSize - 1) / BlockSize);
+}
+
+BlockCache::~BlockCache() = default;
+
+ErrorOr<BlockCachePtr> BlockCache::open(FileSystemAccess& fsAccess,
+                                        const LocalPath& path,
+                                        NodeHandle handle,
+                                        m_off_t size)
+{
+    // Sanity.
+    assert(!handle.isUndef());
+    assert(size > 0);
+
+    auto content = fsAccess.newfileaccess(false);
+    auto blocks = fsAccess.newfileaccess(false);
+
+    // Couldn't open or create the file that stores our content.
+    if (!content->fopen(contentPath(path), true, true, FSLogging::logOnError))
+        return API_EWRITE;
+
+    // Couldn't open or create the file that stores our bitmap.
+    if (!blocks->fopen(blocksPath(path), true, true, FSLogging::logOnError))
+        return API_EWRITE;
+
+    BlockCachePtr cache(new BlockCache(std::move(content),
+                                       std::move(blocks),
+                                       fsAccess,
+                                       path,
+                                       handle,
+                                       size));
+
+    // Convenience.
+    auto& bitmap = cache->mPresent;
+
+    // Try and load the bitmap left by an earlier mount.
+    auto loaded = ([&]() {
+        auto length = HeaderSize + bitmap.size();
+
+        // Bitmap describes some other content.
+        if (cache->mBlocks->size != static_cast<m_off_t>(length)
+            || cache->mContent->size != size)
+            return false;
+
+        std::string buffer;
+
+        // Couldn't read the bitmap.
+        if (!cache->mBlocks->fread(&buffer,
+                                   static_cast<unsigned>(length),
+                                   0,
+                                   0,
+                                   FSLogging::logOnError))
+            return false;
+
+        std::uint64_t handle_;
+        std::uint64_t size_;
+
+        std::memcpy(&handle_, &buffer[0], sizeof(handle_));
+        std::memcpy(&size_, &buffer[sizeof(handle_)], sizeof(size_));
+
+        // Bitmap describes some other node's content.
+        if (handle_ != handle.as8byte()
+            || size_ != static_cast<std::uint64_t>(size))
+            return false;
+
+        std::copy(buffer.begin() + HeaderSize, buffer.end(), bitmap.begin());
+
+        // Count how many blocks are present.
+        for (std::size_t i = 0, n = cache->numBlocks(); i < n; ++i)
+            cache->mNumPresent += (bitmap[i / 8] >> (i % 8)) & 1;
+
+        return true;
+    })();
+
+    // Resumed from an earlier mount.
+    if (loaded)
+        return cache;
+
+    // Discard whatever content was present and start afresh.
+    if (!cache->mContent->ftruncate(0)
+        || !cache->mContent->ftruncate(size)
+        || !cache->mBlocks->ftruncate(0)
+        || !cache->flush())
+        return API_EWRITE;
+
+    return cache;
+}
+
+LocalPath BlockCache::contentPath(const LocalPath& path)
+{
+    auto path_ = path;
+
+    path_.append(LocalPath::fromRelativePath(ContentSuffix));
+
+    return path_;
+}
+
+LocalPath BlockCache::blocksPath(const LocalPath& path)
+{
+    auto path_ = path;
+
+    path_.append(LocalPath::fromRelativePath(BlocksSuffix));
+
+    return path_;
+}
+
+bool BlockCache::partial(const LocalPath& name)
+{
+    auto name_ = name.toPath(false);
+
+    return endsWith(name_, BlocksSuffix)
+           || endsWith(name_, ContentSuffix);
+}
+
+void BlockCache::remove(FileSystemAccess& fsAccess, const LocalPath& path)
+{
+    fsAccess.unlinklocal(contentPath(path));
+    fsAccess.unlinklocal(blocksPath(path));
+}
+
+bool BlockCache::complete() const
+{
+    return mNumPresent == numBlocks();
+}
+
+FileAccess& BlockCache::content() const
+{
+    // Sanity.
+    assert(mContent);
+
+    return *mContent;
+}
+
+auto BlockCache::missing(m_off_t offset, m_off_t length) const
+  -> std::vector<Range>
+{
+    std::vector<Range> ranges;
+
+    // Clamp the range to the file's content.
+    auto end = std::min(offset + length, mSize);
+
+    // Which blocks does the range span?
+    auto first = static_cast<std::size_t>(offset / BlockSize);
+    auto last = static_cast<std::size_t>((end + BlockSize - 1) / BlockSize);
+
+    // Coalesce adjacent missing blocks into a single range.
+    for (auto i = first; i < last; ++i)
+    {
+        // Block's already present.
+        if ((mPresent[i / 8] >> (i % 8)) & 1)
+            continue;
+
+        auto begin = static_cast<m_off_t>(i) * BlockSize;
+        auto end_ = std::min(begin + BlockSize, mSize);
+
+        // Extend the previous range.
+        if (!ranges.empty() && ranges.back().second == begin)
+            ranges.back().second = end_;
+        else
+            ranges.emplace_back(begin, end_);
+    }
+
+    return ranges;
+}
+
+bool BlockCache::promote(m_time_t modified)
+{
+    // Sanity.
+    assert(complete());
+
+    // Release our files so that they can be moved.
+    mContent.reset();
+    mBlocks.reset();
+
+    // Couldn't move our content into place.
+    if (!mFSAccess.renamelocal(contentPath(mPath), mPath, true))
+        return false;
+
+    // Give the content the cloud's modification time.
+    if (!mFSAccess.setmtimelocal(mPath, modified))
+        FUSEWarningF("Couldn't set modification time of: %s",
+                     mPath.toPath(false).c_str());
+
+    // Bitmap's no longer necessary.
+    mFSAccess.unlinklocal(blocksPath(mPath));
+
+    return true;
+}
+
+Error BlockCache::write(const std::string& content, m_off_t offset)
+{
+    // Sanity.
+    assert(mContent);
+    assert(offset % BlockSize == 0);
+    assert(offset + static_cast<m_off_t>(content.size()) <= mSize);
+
+    // Couldn't store the content.
+    if (!mContent->fwrite(reinterpret_cast<const byte*>(content.data()),
+                          static_cast<unsigned>(content.size()),
+                          offset))
+        return API_EWRITE;
+
+    auto end = offset + static_cast<m_off_t>(content.size());
+
+    // Which blocks have we completely populated?
+    auto first = static_cast<std::size_t>(offset / BlockSize);
+    auto last = static_cast<std::size_t>(end / BlockSize);
+
+    // The file's last block needn't be a full block.
+    if (end == mSize)
+        last = numBlocks();
+
+    // Mark the blocks as present.
+    for (auto i = first; i < last; ++i)
+    {
+        auto& byte_ = mPresent[i / 8];
+        auto mask = static_cast<std::uint8_t>(1u << (i % 8));
+
+        mNumPresent += !(byte_ & mask);
+        byte_ |= mask;
+    }
+
+    // Couldn't persist the bitmap.
+    //
+    // Content's still usable by this mount.
+    if (!flush())
+        FUSEWarningF("Couldn't persist block bitmap of: %s",
+                     mPath.toPath(false).c_str());
+
+    return API_OK;
+}
+
+bool endsWith(const std::string& name, const std::string& suffix)
+{
+    return name.size() >= suffix.size()
+           && !name.compare(name.size() - suffix.size(),
+                            suffix.size(),
+                            suffix);
+}
+
+} // fuse
+} // mega
+
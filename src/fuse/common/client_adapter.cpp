@@ -72,6 +72,44 @@ public:
     void completed(Error result);
 }; // ClientDownload
 
+class ClientPartialDownload
+  : public DirectReadConsumer
+{
+    // How many times will we retry a failed read?
+    static constexpr int MaxRetries = 7;
+
+    // Who do we call when we've completed?
+    PartialDownloadCallback mCallback;
+
+    // The content we've received so far.
+    std::string mContent;
+
+    // How much content do we want?
+    m_off_t mLength;
+
+    // Why did the read end?
+    Error mResult;
+
+public:
+    ClientPartialDownload(PartialDownloadCallback callback,
+                          m_off_t length);
+
+    // Forwards our result to the callback.
+    //
+    // The client destroys us when the read ends for whatever reason.
+    ~ClientPartialDownload();
+
+    // Called when the client's received some of our content.
+    bool data(byte* buffer,
+              m_off_t length,
+              m_off_t position) override;
+
+    // Called when the read has failed.
+    dstime failure(const Error& error,
+                   int retries,
+                   dstime timeLeft) override;
+}; // ClientPartialDownload
+
 class ClientNodeEvent
   : public NodeEvent
 {
@@ -809,6 +847,56 @@ NodeHandle ClientAdapter::parentHandle(NodeHandle handle) const
     return NodeHandle();
 }
 
+void ClientAdapter::partialDownload(PartialDownloadCallback callback,
+                                    NodeHandle handle,
+                                    m_off_t offset,
+                                    m_off_t length)
+{
+    // Sanity.
+    assert(callback);
+    assert(!handle.isUndef());
+    assert(offset >= 0);
+    assert(length > 0);
+
+    // Asks the client to read part of the file.
+    auto download = [=](PartialDownloadCallback& callback,
+                        const Task& task) {
+        // Client's being torn down.
+        if (task.cancelled())
+            return callback(API_EINCOMPLETE);
+
+        // Try and locate the node to be read.
+        auto node = mClient.nodeByHandle(handle);
+
+        // Node doesn't exist.
+        if (!node)
+            return callback(API_ENOENT);
+
+        // Node's not a file.
+        if (node->type != FILENODE)
+            return callback(API_EARGS);
+
+        // Range lies beyond the end of the file.
+        if (offset >= node->size)
+            return callback(API_EARGS);
+
+        // Clamp the range to the file's content.
+        auto length_ = std::min(length, node->size - offset);
+
+        // The read owns our consumer from here on.
+        auto consumer = std::make_unique<ClientPartialDownload>(std::move(callback),
+                                                                length_);
+
+        // Ask the client to read the content.
+        mClient.pread(node.get(), offset, length_, std::move(consumer));
+    }; // download
+
+    // Ask the client to read the file's content.
+    execute(std::bind(std::move(download),
+                      wrap(std::move(callback)),
+                      std::placeholders::_1));
+}
+
 accesslevel_t ClientAdapter::permissions(NodeHandle handle) const
 {
     // Make sure deinitialize(...) waits for this call to complete.
@@ -1139,6 +1227,60 @@ bool ClientDownload::begin(MegaClient& client)
     return false;
 }
 
+ClientPartialDownload::ClientPartialDownload(PartialDownloadCallback callback,
+                                             m_off_t length)
+  : DirectReadConsumer()
+  , mCallback(std::move(callback))
+  , mContent()
+  , mLength(length)
+  , mResult(API_EINCOMPLETE)
+{
+    mContent.reserve(static_cast<std::size_t>(length));
+}
+
+ClientPartialDownload::~ClientPartialDownload()
+{
+    // Couldn't read all of our content.
+    if (mResult != API_OK)
+        mCallback(mResult);
+    else
+        mCallback(std::move(mContent));
+}
+
+bool ClientPartialDownload::data(byte* buffer,
+                                 m_off_t length,
+                                 m_off_t)
+{
+    // Latch the content we've received.
+    mContent.append(reinterpret_cast<const char*>(buffer),
+                    static_cast<std::size_t>(length));
+
+    // We still need more content.
+    if (static_cast<m_off_t>(mContent.size()) < mLength)
+        return true;
+
+    // We've received all of our content.
+    mResult = API_OK;
+
+    return false;
+}
+
+dstime ClientPartialDownload::failure(const Error& error,
+                                      int retries,
+                                      dstime)
+{
+    // Failure's transient so retry, backing off exponentially.
+    if (retries <= MaxRetries
+        && error != API_EINCOMPLETE
+        && !(error == API_ETOOMANY && error.hasExtraInfo()))
+        return retries <= 1 ? 0 : static_cast<dstime>(1) << (retries - 1);
+
+    // Give up.
+    mResult = error ? error : Error(API_EINCOMPLETE);
+
+    return NEVER;
+}
+
 std::shared_ptr<Node> child(MegaClient& client,
                             NodeHandle parent,
                             const std::string& name)
@@ -23,22 +23,26 @@ static std::size_t currentVersion(Query& query);
 static void downgrade10(Query& query);
 static void downgrade21(Query& query);
 static void downgrade32(Query& query);
+static void downgrade43(Query& query);
 
 static void upgrade01(Query& query);
 static void upgrade12(Query& query);
 static void upgrade23(Query& query);
+static void upgrade34(Query& query);
 
 static const std::vector<DowngradeFunction> downgrades = {
     nullptr,
     &downgrade10,
     &downgrade21,
     &downgrade32,
+    &downgrade43,
 }; // downgrades
 
 static const std::vector<UpgradeFunction> upgrades = {
     &upgrade01,
     &upgrade12,
     &upgrade23,
+    &upgrade34,
 }; // upgrades
 
 template<typename Function>
@@ -165,6 +169,12 @@ void downgrade32(Query& query)
     query.execute();
 }
 
+void downgrade43(Query& query)
+{
+    query = "alter table mounts drop column offline";
+    query.execute();
+}
+
 void upgrade01(Query& query)
 {
     // Tracks all inodes with local state.
@@ -337,6 +347,18 @@ void upgrade23(Query& query)
     query.execute();
 }
 
+void upgrade34(Query& query)
+{
+    // Tracks whether a mount's content should be kept available offline.
+    query = "alter table mounts "
+            "  add column offline integer "
+            "  constraint nn_mounts_offline "
+            "             not null "
+            "             default 0";
+
+    query.execute();
+}
+
 } // fuse
 } // mega
 
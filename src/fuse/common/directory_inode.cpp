@@ -85,6 +85,11 @@ DirectoryInodeRef DirectoryInode::directory()
     return DirectoryInodeRef(this);
 }
 
+std::size_t DirectoryInode::footprint() const
+{
+    return sizeof(*this);
+}
+
 InodeRef DirectoryInode::get(const std::string& name) const
 {
     InodeLock guard(*this);
@@ -1,16 +1,25 @@
 #include <mega/fuse/common/bind_handle.h>
+#include <mega/fuse/common/block_cache.h>
 #include <mega/fuse/common/client.h>
 #include <mega/fuse/common/file_cache.h>
+#include <mega/fuse/common/file_cache_statistics.h>
 #include <mega/fuse/common/file_info.h>
 #include <mega/fuse/common/file_inode.h>
 #include <mega/fuse/common/file_io_context.h>
+#include <mega/fuse/common/inode.h>
 #include <mega/fuse/common/inode_db.h>
 #include <mega/fuse/common/inode_id.h>
 #include <mega/fuse/common/logging.h>
+#include <mega/fuse/common/mount_db.h>
+#include <mega/fuse/common/mount_info.h>
+#include <mega/fuse/common/node_info.h>
 #include <mega/fuse/common/ref.h>
+#include <mega/fuse/common/service_flags.h>
+#include <mega/fuse/platform/mount.h>
 #include <mega/fuse/platform/service_context.h>
 #include <mega/scoped_helpers.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <chrono>
@@ -18,6 +27,7 @@
 #include <stdexcept>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 namespace mega
 {
@@ -28,6 +38,67 @@ static LocalPath cachePath(const Client& client);
 
 static void ensureCachePathExists(Client& client, const LocalPath& path);
 
+void FileCache::accessed(InodeID id, bool hit)
+{
+    // Keep track of how well the cache's serving reads.
+    if (hit)
+        ++mHits;
+    else
+        ++mMisses;
+
+    FileCacheLock guard(*this);
+
+    // Remember when the inode's content was last read.
+    mAccessed[id] = std::chrono::steady_clock::now();
+}
+
+void FileCache::clean(const Task& task)
+{
+    // Cleaning's been cancelled.
+    if (task.cancelled())
+        return;
+
+    // Let cancel() know that we're running.
+    {
+        FileCacheLock guard(*this);
+
+        // Cache's being torn down.
+        if (mCancelled)
+            return;
+
+        ++mActiveTasks;
+    }
+
+    // Let cancel() know when we've completed.
+    auto completed = makeScopedDestructor([this]() {
+        FileCacheLock guard(*this);
+
+        --mActiveTasks;
+
+        mRemoved.notify_all();
+    });
+
+    // Convenience.
+    auto flags = mContext.serviceFlags().mFileCacheFlags;
+
+    // Keep the cache within its quota, if it has one.
+    if (flags.mMaxSize)
+        evict(flags.mMaxSize);
+
+    FileCacheLock guard(*this);
+
+    // Cache's being torn down.
+    if (mCancelled)
+        return;
+
+    // Schedule the next cleaning.
+    mCleanTask = executor().execute(std::bind(&FileCache::clean,
+                                              this,
+                                              std::placeholders::_1),
+                                    flags.mCleanInterval,
+                                    true);
+}
+
 ErrorOr<FileInfoRef> FileCache::create(const FileExtension& extension,
                                        const LocalPath& path,
                                        InodeID id,
@@ -79,6 +150,194 @@ ErrorOr<FileInfoRef> FileCache::create(const FileExtension& extension,
     return info;
 }
 
+void FileCache::evict(std::uint64_t maxSize)
+{
+    // Describes what content the cache holds for a particular inode.
+    struct Entry
+    {
+        // When was the inode's content last read?
+        std::chrono::steady_clock::time_point mAccessed;
+
+        // Is all of the inode's content present?
+        bool mComplete = false;
+
+        // When was the inode's content last written to disk?
+        m_time_t mModified = 0;
+
+        // Where is the inode's partial content stored?
+        std::vector<LocalPath> mPartialPaths;
+
+        // How much space does the inode's content occupy?
+        std::uint64_t mSize = 0u;
+    }; // Entry
+
+    // Convenience.
+    auto& fsAccess = client().fsAccess();
+
+    auto dirAccess = fsAccess.newdiraccess();
+    auto fileAccess = fsAccess.newfileaccess(false);
+    auto path = mCachePath;
+
+    // Try and open the cache directory for iteration.
+    if (!dirAccess->dopen(&path, nullptr, false))
+        return;
+
+    FromInodeIDMap<Entry> entries;
+    LocalPath name;
+    std::uint64_t size = 0u;
+    nodetype_t type;
+
+    // Determine how much space each inode's content occupies.
+    while (dirAccess->dnext(path, name, false, &type))
+    {
+        // Entry isn't a file.
+        if (type != FILENODE)
+            continue;
+
+        // Convert file name to inode ID.
+        auto id = InodeID::fromFileName(name.toPath(false));
+
+        // Invalid ID.
+        if (!id)
+            continue;
+
+        auto restorer = makeScopedSizeRestorer(path);
+
+        path.appendWithSeparator(name, true);
+
+        // File's vanished since we listed it.
+        if (!fileAccess->fopen(path, FSLogging::noLogging))
+            continue;
+
+        auto& entry = entries[id];
+
+        entry.mModified = std::max(entry.mModified, fileAccess->mtime);
+        entry.mSize += static_cast<std::uint64_t>(fileAccess->size);
+
+        size += static_cast<std::uint64_t>(fileAccess->size);
+
+        // Partial content is removed file by file.
+        if (BlockCache::partial(name))
+            entry.mPartialPaths.emplace_back(path);
+        else
+            entry.mComplete = true;
+    }
+
+    // Cache's within its quota.
+    if (size <= maxSize)
+        return;
+
+    // Latch when each inode's content was last read.
+    {
+        FileCacheLock guard(*this);
+
+        for (auto& a : mAccessed)
+        {
+            auto e = entries.find(a.first);
+
+            if (e != entries.end())
+                e->second.mAccessed = a.second;
+        }
+    }
+
+    using Candidate = std::pair<InodeID, const Entry*>;
+
+    std::vector<Candidate> candidates;
+
+    candidates.reserve(entries.size());
+
+    for (auto& e : entries)
+        candidates.emplace_back(e.first, &e.second);
+
+    // Evict content that hasn't been read in the longest time first.
+    //
+    // Content that hasn't been read at all since we started is ordered
+    // by when it was last written to disk.
+    std::sort(candidates.begin(),
+              candidates.end(),
+              [](const Candidate& lhs, const Candidate& rhs) {
+                  if (lhs.second->mAccessed != rhs.second->mAccessed)
+                      return lhs.second->mAccessed < rhs.second->mAccessed;
+
+                  return lhs.second->mModified < rhs.second->mModified;
+              });
+
+    // Which mounts should keep their content available offline?
+    NodeHandleSet offline;
+
+    for (auto& info : mContext.mMountDB.get(false))
+    {
+        if (info.mFlags.mOffline)
+            offline.emplace(info.mHandle);
+    }
+
+    // Is an inode's content pinned in the cache?
+    auto pinned = [&](InodeID id) {
+        // Content's only ever been local.
+        if (id.synthetic())
+            return true;
+
+        NodeHandle handle(id);
+
+        // Check whether the inode lies below an offline mount.
+        for ( ; !handle.isUndef(); handle = client().parentHandle(handle))
+        {
+            if (offline.count(handle))
+                return true;
+        }
+
+        return false;
+    }; // pinned
+
+    // Leave some headroom so we don't evict on every cleaning.
+    auto target = maxSize - maxSize / 10;
+    auto evicted = 0ul;
+    auto released = std::uint64_t(0u);
+
+    for (auto& candidate : candidates)
+    {
+        // Cache's small enough or is being torn down.
+        if (size <= target || mCancelled)
+            break;
+
+        // Convenience.
+        auto& entry = *candidate.second;
+        auto id = candidate.first;
+
+        // Content below an offline mount is never evicted.
+        if (pinned(id))
+            continue;
+
+        // Complete content must be evicted via the database.
+        if (entry.mComplete && !mContext.mInodeDB.evict(id))
+            continue;
+
+        // Partial content can be removed directly.
+        if (!entry.mComplete)
+        {
+            FileCacheLock guard(*this);
+
+            // Content's being read.
+            if (mContextByID.count(id))
+                continue;
+
+            for (auto& partialPath : entry.mPartialPaths)
+                fsAccess.unlinklocal(partialPath);
+
+            mAccessed.erase(id);
+        }
+
+        released += entry.mSize;
+        size -= entry.mSize;
+
+        ++evicted;
+    }
+
+    FUSEInfoF("Evicted %lu inode(s) from the file cache, releasing %llu byte(s)",
+              evicted,
+              static_cast<unsigned long long>(released));
+}
+
 FileInfoRef FileCache::info(const FileExtension& extension,
                             const FileAccess& fileAccess,
                             InodeID id)
@@ -102,6 +361,86 @@ FileInfoRef FileCache::info(const FileExtension& extension,
     return FileInfoRef(i->second.get());
 }
 
+void FileCache::prefetch(NodeHandle mountHandle,
+                         const LocalPath& mountPath,
+                         const Task& task)
+{
+    // Let cancel() know when we've completed.
+    auto completed = makeScopedDestructor([this]() {
+        FileCacheLock guard(*this);
+
+        --mActiveTasks;
+
+        mRemoved.notify_all();
+    });
+
+    // Prefetch's been cancelled.
+    if (task.cancelled())
+        return;
+
+    FUSEDebugF("Prefetching content below %s",
+               mountPath.toPath(false).c_str());
+
+    // Which directories have yet to be visited?
+    std::vector<NodeHandle> directories(1, mountHandle);
+    auto fetched = 0ul;
+
+    while (!directories.empty() && !mCancelled)
+    {
+        // Pop the next directory from the stack.
+        auto parent = directories.back();
+
+        directories.pop_back();
+
+        std::vector<NodeHandle> files;
+
+        // Collect the directory's children.
+        client().each([&](NodeInfo info) {
+            if (info.mIsDirectory)
+                directories.emplace_back(info.mHandle);
+            else
+                files.emplace_back(info.mHandle);
+        }, parent);
+
+        for (auto handle : files)
+        {
+            // Cache's being torn down.
+            if (mCancelled)
+                return;
+
+            // Make sure the mount's still enabled and offline.
+            auto mount = mContext.mMountDB.mount(mountPath);
+
+            if (!mount || !mount->flags().mOffline)
+                return;
+
+            // Retrieve an inode representing this file.
+            auto inode = mContext.mInodeDB.get(handle);
+
+            // File's been removed since we listed it.
+            if (!inode)
+                continue;
+
+            // Make sure the file's content is present locally.
+            auto result = context(inode->file())->prefetch(*mount);
+
+            if (result == API_OK)
+            {
+                ++fetched;
+                continue;
+            }
+
+            FUSEWarningF("Unable to prefetch %s: %d",
+                         toNodeHandle(handle).c_str(),
+                         static_cast<int>(result));
+        }
+    }
+
+    FUSEDebugF("Prefetched %lu file(s) below %s",
+               fetched,
+               mountPath.toPath(false).c_str());
+}
+
 void FileCache::remove(const FileIOContext& context,
                        FileCacheLock lock)
 {
@@ -150,8 +489,14 @@ void FileCache::remove(const FileInfo& info, FileCacheLock lock)
 
 FileCache::FileCache(platform::ServiceContext& context)
   : Lockable()
+  , mAccessed()
+  , mActiveTasks(0u)
+  , mCancelled{false}
+  , mCleanTask()
   , mContextByID()
+  , mHits{0u}
   , mInfoByID()
+  , mMisses{0u}
   , mRemoved()
   , mCachePath(cachePath(context.client()))
   , mContext(context)
@@ -159,6 +504,13 @@ FileCache::FileCache(platform::ServiceContext& context)
     FUSEDebug1("File Cache constructed");
 
     ensureCachePathExists(client(), mCachePath);
+
+    // Periodically make sure the cache's within its quota.
+    mCleanTask = executor().execute(std::bind(&FileCache::clean,
+                                              this,
+                                              std::placeholders::_1),
+                                    mContext.serviceFlags().mFileCacheFlags.mCleanInterval,
+                                    true);
 }
 
 FileCache::~FileCache()
@@ -171,6 +523,18 @@ FileCache::~FileCache()
 
 void FileCache::cancel()
 {
+    // Make sure no further work is performed in the background.
+    auto cleanTask = ([this]() {
+        FileCacheLock guard(*this);
+
+        mCancelled = true;
+
+        return std::move(mCleanTask);
+    })();
+
+    // Cancel any pending cleaning.
+    cleanTask.cancel();
+
     // What contexts currently exist?
     auto contexts = ([this]() {
         // Acquire lock.
@@ -200,7 +564,7 @@ void FileCache::cancel()
 
     // True when all of the contexts have been destroyed.
     auto empty = [this]() {
-        return mContextByID.empty();
+        return mContextByID.empty() && !mActiveTasks;
     }; // empty
 
     FileCacheLock lock(*this);
@@ -322,8 +686,15 @@ void FileCache::current()
         if (!id)
             continue;
 
+        // Partial content is kept for as long as its node exists.
+        if (BlockCache::partial(name))
+        {
+            if (!id.synthetic() && client().exists(NodeHandle(id)))
+                continue;
+        }
+
         // Inode's still present in the database.
-        if (mContext.mInodeDB.exists(id))
+        else if (mContext.mInodeDB.exists(id))
             continue;
 
         auto restorer = makeScopedSizeRestorer(path);
@@ -401,6 +772,33 @@ FileInfoRef FileCache::info(const FileExtension& extension,
     return FileInfoRef(i->second.get());
 }
 
+void FileCache::prefetch(const Mount& mount)
+{
+    // Convenience.
+    auto mountHandle = mount.handle();
+    auto mountPath = mount.path();
+
+    FileCacheLock guard(*this);
+
+    // Cache's being torn down.
+    if (mCancelled)
+        return;
+
+    // Let cancel() know the prefetch is in progress.
+    ++mActiveTasks;
+
+    // Fetch the mount's content in the background.
+    executor().execute(std::bind(static_cast<void (FileCache::*)(NodeHandle,
+                                                                 const LocalPath&,
+                                                                 const Task&)>(&FileCache::prefetch),
+                                 this,
+                                 mountHandle,
+                                 std::move(mountPath),
+                                 std::placeholders::_1),
+                       TP_BACKGROUND,
+                       true);
+}
+
 LocalPath FileCache::path(const FileExtension& extension, InodeID id) const
 {
     auto name = LocalPath::fromRelativePath(toFileName(id));
@@ -431,8 +829,27 @@ void FileCache::remove(const FileExtension& extension, InodeID id)
     if (mInfoByID.count(id))
         return;
 
+    // Convenience.
+    auto path = this->path(extension, id);
+
     // Try and remove the file.
-    client().fsAccess().unlinklocal(path(extension, id));
+    client().fsAccess().unlinklocal(path);
+
+    // Remove any partial content, too.
+    BlockCache::remove(client().fsAccess(), path);
+
+    // Content's no longer in the cache.
+    mAccessed.erase(id);
+}
+
+FileCacheStatistics FileCache::statistics() const
+{
+    FileCacheStatistics statistics;
+
+    statistics.mHits = mHits;
+    statistics.mMisses = mMisses;
+
+    return statistics;
 }
 
 LocalPath cachePath(const Client& client)
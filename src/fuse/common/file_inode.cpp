@@ -86,6 +86,12 @@ FileInfoRef FileInode::fileInfo() const
     return mInfo;
 }
 
+std::size_t FileInode::footprint() const
+{
+    // A cached file keeps its file info alive.
+    return sizeof(*this) + sizeof(FileInfo);
+}
+
 void FileInode::handle(NodeHandle handle)
 {
     InodeDBLock guard(mInodeDB);
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <condition_variable>
@@ -5,6 +6,7 @@
 #include <utility>
 
 #include <mega/fuse/common/bind_handle.h>
+#include <mega/fuse/common/block_cache.h>
 #include <mega/fuse/common/client.h>
 #include <mega/fuse/common/error_or.h>
 #include <mega/fuse/common/file_cache.h>
@@ -28,6 +30,19 @@ namespace mega
 namespace fuse
 {
 
+// How far beyond a sequential read will we fetch at most?
+static constexpr m_off_t MaxReadAhead = 16 * BlockCache::BlockSize;
+
+// Each step of this size adds a flush delay to the time a file must remain
+// idle before its modifications are uploaded.
+static constexpr m_off_t FlushSizeStep = 64 << 20;
+
+// How many flush delays must a file remain idle at most?
+static constexpr m_off_t MaxFlushIdleDelays = 8;
+
+// How many flush delays may modifications wait at most to be uploaded?
+static constexpr int MaxFlushDeferralDelays = 32;
+
 void LockableTraits<FileIOContext>::acquired(const FileIOContext& context)
 {
     FUSEDebugF("Acquired lock on file IO context %s",
@@ -78,6 +93,12 @@ class FileIOContext::FlushContext
     // Serializes access to instance members.
     mutable std::mutex mLock;
 
+    // How many modifications are we uploading?
+    const unsigned long mModifications;
+
+    // How much content are we uploading?
+    const m_off_t mSize;
+
     // The actual upload used to send content to the cloud.
     UploadPtr mUpload;
 
@@ -88,8 +109,14 @@ public:
     // Try and cancel any upload in progress.
     bool cancel();
 
+    // How many modifications are we uploading?
+    unsigned long modifications() const;
+
     // Retrieve the upload's result.
     Error result() const;
+
+    // How much content are we uploading?
+    m_off_t size() const;
 }; // FlushContext
 
 ErrorOr<FileAccessSharedPtr> FileIOContext::create()
@@ -173,14 +200,37 @@ ErrorOr<FileAccessSharedPtr> FileIOContext::download(const Mount& mount)
     // Where should we download the file's content?
     auto path = mFileCache.path(extension, id);
 
-    // Ask the client to download our content.
-    client.download(std::move(wrapper),
-                    handle,
-                    std::move(*logicalPath),
-                    path);
+    // Latch any content fetched by earlier reads.
+    //
+    // No reader can be touching it as we hold the context exclusively
+    // but content fetched in the background may still be arriving.
+    auto blockCache = ([&]() {
+        std::lock_guard<std::mutex> guard(mBlockLock);
 
-    // Wait for the file to be downloaded.
-    auto result = waiter.get_future().get();
+        return std::move(mBlockCache);
+    })();
+
+    auto result = ([&]() -> Error {
+        // Earlier reads have already fetched all of the file's content.
+        if (blockCache
+            && blockCache->complete()
+            && blockCache->promote(mFile->info().mModified))
+            return API_OK;
+
+        // Partial content is of no use once the whole file's downloaded.
+        blockCache.reset();
+
+        BlockCache::remove(client.fsAccess(), path);
+
+        // Ask the client to download our content.
+        client.download(std::move(wrapper),
+                        handle,
+                        std::move(*logicalPath),
+                        path);
+
+        // Wait for the file to be downloaded.
+        return waiter.get_future().get();
+    })();
 
     // Couldn't download the file.
     if (result != API_OK)
@@ -217,6 +267,24 @@ std::chrono::seconds FileIOContext::flushDelay() const
     return mFileCache.mContext.serviceFlags().mFlushDelay;
 }
 
+std::chrono::steady_clock::time_point FileIOContext::flushTime() const
+{
+    // Convenience.
+    auto delay = flushDelay();
+
+    // Larger files must remain idle longer as each upload costs more.
+    auto delays = std::min(mFileInfo->size() / FlushSizeStep,
+                           MaxFlushIdleDelays - 1) + 1;
+
+    // When will the file have been idle long enough?
+    auto idle = mLastModified + delay * delays;
+
+    // Files that never become idle are still flushed eventually.
+    auto deadline = mFlushNeededSince + delay * MaxFlushDeferralDelays;
+
+    return std::min(idle, deadline);
+}
+
 InodeDB& FileIOContext::inodeDB() const
 {
     return mFileCache.mContext.mInodeDB;
@@ -296,18 +364,33 @@ Error FileIOContext::manualFlush([[maybe_unused]] FileIOContextSharedLock& conte
     if (result != API_OK)
         return result;
 
+    FUSEInfoF("Flushed %lld byte(s) of %s after %lu modification(s)",
+              static_cast<long long>(context->size()),
+              toString(mFile->id()).c_str(),
+              context->modifications());
+
+    // Content was modified while it was being flushed.
+    if (mModifications > context->modifications())
+    {
+        // Those modifications still need to be flushed.
+        mModifications -= context->modifications();
+        mFlushNeededSince = std::chrono::steady_clock::now();
+
+        return result;
+    }
+
     // Content's been flushed to the cloud.
     if (mFlushNeeded)
         mFile->modified(false);
 
     mFlushNeeded = false;
+    mModifications = 0;
 
     // Return result to caller.
     return result;
 }
 
 void FileIOContext::onPeriodicFlush(FileIOContextRef& context,
-                                    m_time_t lastModified,
                                     NodeHandle mountHandle,
                                     LocalPath& mountPath,
                                     const Task& task)
@@ -325,11 +408,11 @@ void FileIOContext::onPeriodicFlush(FileIOContextRef& context,
     if (task.cancelled() || !mFlushNeeded)
         return;
 
-    // When was our content last modified?
-    auto modified = mFileInfo->modified();
+    // When should our modifications be flushed?
+    auto when = flushTime();
 
-    // Content was modified since the flush was queued.
-    if (lastModified != modified)
+    // Content's still being modified.
+    if (std::chrono::steady_clock::now() < when)
     {
         // Another task will flush the modifications.
         if (mPeriodicFlushTask != task)
@@ -340,11 +423,10 @@ void FileIOContext::onPeriodicFlush(FileIOContextRef& context,
                                std::bind(&FileIOContext::onPeriodicFlush,
                                          this,
                                          std::move(context),
-                                         modified,
                                          mountHandle,
                                          std::move(mountPath),
                                          std::placeholders::_1),
-                               flushDelay(),
+                               when,
                                true);
 
         // We're all done for now.
@@ -352,18 +434,39 @@ void FileIOContext::onPeriodicFlush(FileIOContextRef& context,
     }
 
     // Perform the flush.
-    manualFlush(contextLock,
-                flushLock,
-                mountHandle,
-                std::move(mountPath));
+    auto result = manualFlush(contextLock,
+                              flushLock,
+                              mountHandle,
+                              mountPath);
 
     // Sanity.
     assert(contextLock.owns_lock());
     assert(flushLock.owns_lock());
 
-    // Clear flush task if necessary.
-    if (mPeriodicFlushTask == task)
-        mPeriodicFlushTask.reset();
+    // Another task will flush any further modifications.
+    if (mPeriodicFlushTask != task)
+        return;
+
+    // Content was modified while it was being flushed.
+    if (result == API_OK && mFlushNeeded)
+    {
+        // Flush those modifications, too.
+        mPeriodicFlushTask = mFileCache.executor().execute(
+                               std::bind(&FileIOContext::onPeriodicFlush,
+                                         this,
+                                         std::move(context),
+                                         mountHandle,
+                                         std::move(mountPath),
+                                         std::placeholders::_1),
+                               flushTime(),
+                               true);
+
+        // We're all done for now.
+        return;
+    }
+
+    // Clear flush task.
+    mPeriodicFlushTask.reset();
 }
 
 auto FileIOContext::open([[maybe_unused]] FileIOContextLock& lock, const Mount& mount, m_off_t hint)
@@ -443,6 +546,14 @@ FileIOContext::FileIOContext(FileCache& cache,
                              FileInfoRef info,
                              bool modified)
   : Lockable()
+  , mBlockCache()
+  , mBlockCV()
+  , mBlockLock()
+  , mReadAhead(0)
+  , mReadAheads()
+  , mReadEnd(-1)
+  , mReadPattern(ReadPattern::RANDOM)
+  , mReadStride(0)
   , mFile(std::move(file))
   , mFileAccess()
   , mFileCache(cache)
@@ -451,6 +562,9 @@ FileIOContext::FileIOContext(FileCache& cache,
   , mFlushContext()
   , mFlushLock()
   , mFlushNeeded(modified)
+  , mFlushNeededSince(std::chrono::steady_clock::now())
+  , mLastModified(mFlushNeededSince)
+  , mModifications(0ul)
   , mPeriodicFlushTask()
   , mReferences(0u)
 {
@@ -550,12 +664,21 @@ void FileIOContext::modified(const Mount& mount)
     // Acquire flush lock.
     std::lock_guard<std::mutex> guard(mFlushLock);
 
+    // Remember when the file was modified.
+    mLastModified = std::chrono::steady_clock::now();
+
     // Mark file as having been modified.
     if (!mFlushNeeded)
+    {
         mFile->modified(true);
+        mFlushNeededSince = mLastModified;
+    }
 
     mFlushNeeded = true;
 
+    // Coalesce this modification with any others not yet flushed.
+    ++mModifications;
+
     // A flush has already been queued.
     if (mPeriodicFlushTask && !mPeriodicFlushTask.completed())
         return;
@@ -565,11 +688,10 @@ void FileIOContext::modified(const Mount& mount)
                            std::bind(&FileIOContext::onPeriodicFlush,
                                      this,
                                      FileIOContextRef(this),
-                                     mFileInfo->modified(),
                                      mount.handle(),
                                      mount.path(),
                                      std::placeholders::_1),
-                           flushDelay(),
+                           flushTime(),
                            true);
 }
 
@@ -587,12 +709,69 @@ Error FileIOContext::open(const Mount& mount,
     return API_OK;
 }
 
+Error FileIOContext::prefetch(const Mount& mount)
+{
+    // Make sure nothing else is touching this file.
+    FileIOContextSharedLock guard(*this);
+
+    // File's content is already present locally.
+    if (mFileInfo)
+        return API_OK;
+
+    // File has no content in the cloud.
+    if (mFile->removed() || mFile->handle().isUndef())
+        return API_OK;
+
+    // Download the file's content.
+    auto result = open(guard, mount);
+
+    // Couldn't download the file.
+    if (!result)
+        return result.error();
+
+    return API_OK;
+}
+
 ErrorOr<std::string> FileIOContext::read(const Mount& mount,
                                          m_off_t offset,
                                          unsigned int size)
+{
+    std::string buffer;
+
+    // Copies the file's content into our buffer.
+    auto copy = [&buffer](FileAccess& fileAccess,
+                          m_off_t offset,
+                          unsigned int size) -> Error {
+        // Couldn't read from the file.
+        if (!fileAccess.fread(&buffer,
+                              size,
+                              0,
+                              offset,
+                              FSLogging::logOnError))
+            return API_EREAD;
+
+        return API_OK;
+    }; // copy
+
+    // Try and read the file.
+    auto result = read(mount, offset, size, copy);
+
+    // Couldn't read the file.
+    if (result != API_OK)
+        return result;
+
+    // Return result to caller.
+    return buffer;
+}
+
+Error FileIOContext::read(const Mount& mount,
+                          m_off_t offset,
+                          unsigned int size,
+                          const FileReadCallback& callback)
 {
     assert(offset >= 0);
     assert(size);
+    assert(callback);
 
     // Update file's access time.
     mFile->accessed();
@@ -600,6 +779,16 @@ ErrorOr<std::string> FileIOContext::read(const Mount& mount,
     // Make sure nothing else is touching this file.
     FileIOContextSharedLock guard(*this);
 
+    // File's content is only in the cloud.
+    if (!mFileInfo
+        && mFileAccess.expired()
+        && !mFile->removed()
+        && !mFile->handle().isUndef())
+        return readPartial(offset, size, callback);
+
+    // Let the cache know whether the content had to be downloaded.
+    mFileCache.accessed(mFile->id(), !!mFileInfo);
+
     // Make sure the file's present and open.
     auto result = open(guard, mount);
 
@@ -620,24 +809,268 @@ ErrorOr<std::string> FileIOContext::read(const Mount& mount,
     auto remaining = fileAccess->size - offset;
 
     // Clamp size.
-    size = std::min(static_cast<unsigned int>(remaining), size);
+    size = static_cast<unsigned int>(std::min<m_off_t>(remaining, size));
 
     // No data available for reading.
     if (!size)
-        return std::string();
+        return API_OK;
 
-    std::string buffer;
+    // Let the caller consume the content.
+    return callback(*fileAccess, offset, size);
+}
 
-    // Couldn't read from the file.
-    if (!fileAccess->fread(&buffer,
-                           size,
-                           0,
-                           offset,
-                           FSLogging::logOnError))
-        return API_EREAD;
+Error FileIOContext::readPartial(m_off_t offset,
+                                 unsigned int size,
+                                 const FileReadCallback& callback)
+{
+    // Convenience.
+    auto& client = mFileCache.client();
+    auto handle = mFile->handle();
+    auto length = mFile->info().mSize;
 
-    // Return result to caller.
-    return buffer;
+    // Clamp offset.
+    offset = std::min(offset, length);
+
+    // Clamp size.
+    size = static_cast<unsigned int>(
+             std::min<m_off_t>(length - offset, size));
+
+    // No data available for reading.
+    if (!size)
+        return API_OK;
+
+    // Make sure no one else is fetching content.
+    std::unique_lock<std::mutex> lock(mBlockLock);
+
+    // Start or resume tracking what content is present locally.
+    if (!mBlockCache)
+    {
+        auto cache = BlockCache::open(client.fsAccess(),
+                                      mFileCache.path(mFile->extension(),
+                                                      mFile->id()),
+                                      handle,
+                                      length);
+
+        // Couldn't create the files that hold our content.
+        if (!cache)
+            return cache.error();
+
+        mBlockCache = std::move(*cache);
+    }
+
+    // How far is this read from where the last one ended?
+    auto stride = offset - mReadEnd;
+
+    // Classify the read.
+    if (!stride)
+        mReadPattern = ReadPattern::SEQUENTIAL;
+    else if (stride == mReadStride)
+        mReadPattern = ReadPattern::STRIDED;
+    else
+        mReadPattern = ReadPattern::RANDOM;
+
+    mReadEnd = offset + size;
+    mReadStride = stride;
+
+    // Fetch further ahead the longer the reads remain sequential.
+    if (mReadPattern == ReadPattern::SEQUENTIAL)
+        mReadAhead = std::min(std::max(mReadAhead * 2, BlockCache::BlockSize),
+                              MaxReadAhead);
+    else
+        mReadAhead = 0;
+
+    // Where does the last block touched by this read end?
+    auto blockEnd = (mReadEnd + BlockCache::BlockSize - 1)
+                    / BlockCache::BlockSize
+                    * BlockCache::BlockSize;
+
+    // Start fetching what we expect to be read next while we satisfy
+    // this read.
+    if (mReadPattern == ReadPattern::SEQUENTIAL)
+        readAhead(lock, blockEnd, mReadEnd + mReadAhead);
+    else if (mReadPattern == ReadPattern::STRIDED && stride > 0)
+        readAhead(lock, mReadEnd + stride, mReadEnd + stride + size);
+
+    // Wait for any background fetch of content this read needs.
+    mBlockCV.wait(lock, [&]() {
+        return !readingAhead(offset, mReadEnd);
+    });
+
+    // What content isn't present locally?
+    auto missing = mBlockCache->missing(offset, size);
+
+    // Let the cache know whether the read needs content from the cloud.
+    mFileCache.accessed(mFile->id(), missing.empty());
+
+    // Fetch whatever content isn't present locally.
+    for (auto& range : missing)
+    {
+        // So we can wait for the client's result.
+        std::promise<ErrorOr<std::string>> waiter;
+
+        // Transmits the client's result to our waiter.
+        auto wrapper = [&waiter](ErrorOr<std::string> result) {
+            waiter.set_value(std::move(result));
+        }; // wrapper
+
+        // Ask the client to download this range.
+        client.partialDownload(std::move(wrapper),
+                               handle,
+                               range.first,
+                               range.second - range.first);
+
+        // Wait for the range to be downloaded.
+        auto content = waiter.get_future().get();
+
+        // Try and store the range's content.
+        auto result = content ? mBlockCache->write(*content, range.first)
+                              : content.error();
+
+        // Couldn't fetch content needed by the read.
+        if (result != API_OK)
+            return result;
+    }
+
+    // Let the caller consume the cached content.
+    return callback(mBlockCache->content(), offset, size);
+}
+
+void FileIOContext::readAhead(std::unique_lock<std::mutex>& lock,
+                              m_off_t begin,
+                              m_off_t end)
+{
+    // Sanity.
+    assert(lock.owns_lock());
+
+    // Nothing to fetch.
+    if (begin >= end)
+        return;
+
+    // What ranges are we going to fetch?
+    std::vector<BlockCache::Range> ranges;
+
+    // Fetch whatever isn't present or already being fetched.
+    for (auto& range : mBlockCache->missing(begin, end - begin))
+    {
+        // Where does the content we're yet to fetch begin?
+        auto first = range.first;
+
+        for (auto i = range.first; i < range.second; )
+        {
+            // Where does this block end?
+            auto next = std::min(i + BlockCache::BlockSize, range.second);
+
+            // Block's already being fetched.
+            if (readingAhead(i, next))
+            {
+                // Fetch the blocks that preceded it.
+                if (first < i)
+                    ranges.emplace_back(first, i);
+
+                first = next;
+            }
+
+            i = next;
+        }
+
+        // Fetch any remaining blocks.
+        if (first < range.second)
+            ranges.emplace_back(first, range.second);
+    }
+
+    // Nothing needs to be fetched.
+    if (ranges.empty())
+        return;
+
+    // Remember that this content's being fetched.
+    for (auto& range : ranges)
+        mReadAheads.emplace(range);
+
+    // Convenience.
+    auto& client = mFileCache.client();
+    auto& executor = mFileCache.executor();
+    auto handle = mFile->handle();
+    auto id = mFile->id();
+
+    // The client may report the result of a request immediately.
+    lock.unlock();
+
+    for (auto& range : ranges)
+    {
+        // Called by the client when the content's arrived.
+        //
+        // The content's stored by the executor as the client's thread
+        // mustn't wait for mBlockLock: A reader may hold it while it
+        // waits for the client to deliver content of its own.
+        auto completed = [&executor](FileIOContextRef& context,
+                                     m_off_t offset,
+                                     ErrorOr<std::string> content) {
+            auto store = [offset](FileIOContextRef& context,
+                                  ErrorOr<std::string>& content,
+                                  const Task&) {
+                context->readAheadCompleted(std::move(content), offset);
+            }; // store
+
+            executor.execute(std::bind(std::move(store),
+                                       std::move(context),
+                                       std::move(content),
+                                       std::placeholders::_1),
+                             true);
+        }; // completed
+
+        FUSEDebugF("Reading ahead [%lld, %lld) of %s",
+                   static_cast<long long>(range.first),
+                   static_cast<long long>(range.second),
+                   toString(id).c_str());
+
+        // Ask the client to download the content.
+        client.partialDownload(std::bind(std::move(completed),
+                                         FileIOContextRef(this),
+                                         range.first,
+                                         std::placeholders::_1),
+                               handle,
+                               range.first,
+                               range.second - range.first);
+    }
+
+    // Reacquire the lock.
+    lock.lock();
+}
+
+void FileIOContext::readAheadCompleted(ErrorOr<std::string> content,
+                                       m_off_t offset)
+{
+    std::lock_guard<std::mutex> guard(mBlockLock);
+
+    // Store the content if we're still tracking partial content.
+    if (content && mBlockCache)
+    {
+        auto result = mBlockCache->write(*content, offset);
+
+        if (result != API_OK)
+            FUSEWarningF("Couldn't store content read ahead of %s: %d",
+                         toString(mFile->id()).c_str(),
+                         static_cast<int>(result));
+    }
+
+    // Content's no longer being fetched.
+    mReadAheads.erase(offset);
+
+    // Let any waiting readers know the content's arrived.
+    mBlockCV.notify_all();
+}
+
+bool FileIOContext::readingAhead(m_off_t begin, m_off_t end) const
+{
+    // Locate the last range that begins before end.
+    auto i = mReadAheads.lower_bound(end);
+
+    // No range begins before end.
+    if (i == mReadAheads.begin())
+        return false;
+
+    // Ranges never overlap so only this one can end after begin.
+    return (--i)->second > begin;
 }
 
 void FileIOContext::ref(RefBadge) 
@@ -940,6 +1373,8 @@ FileIOContext::FlushContext::FlushContext(FileIOContext& context,
   : mCV()
   , mContext(context)
   , mLock()
+  , mModifications(context.mModifications)
+  , mSize(context.mFileInfo->size())
   , mUpload()
 {
     // Sanity.
@@ -986,6 +1421,11 @@ bool FileIOContext::FlushContext::cancel()
     return mUpload->cancelled();
 }
 
+unsigned long FileIOContext::FlushContext::modifications() const
+{
+    return mModifications;
+}
+
 Error FileIOContext::FlushContext::result() const
 {
     // Acquire lock.
@@ -1003,6 +1443,11 @@ Error FileIOContext::FlushContext::result() const
     return mUpload->result();
 }
 
+m_off_t FileIOContext::FlushContext::size() const
+{
+    return mSize;
+}
+
 } // fuse
 } // mega
 
@@ -289,14 +289,16 @@ ErrorOr<LocalPath> Inode::path(InodeID parentID) const
 
 void Inode::ref(RefBadge)
 {
-    // Make sure nothing else can mess with our counter.
-    InodeDBLock guard(mInodeDB);
-
-    // Increment the counter.
-    ++mReferences;
+    // No lock's necessary as the caller either holds a reference or is
+    // holding the InodeDB's lock: Either way, our counter can't drop
+    // to zero beneath us.
+    auto references = ++mReferences;
 
     // Make sure our counter hasn't wrapped around.
-    assert(mReferences);
+    assert(references);
+
+    // Silence the compiler.
+    static_cast<void>(references);
 }
 
 void Inode::removed(bool removed) const
@@ -340,8 +342,6 @@ void Inode::removed(bool removed) const
 
 bool Inode::removed() const
 {
-    InodeDBLock guard(mInodeDB);
-
     return mRemoved;
 }
 
@@ -417,6 +417,21 @@ Error Inode::replace(InodeRef target, bool replaceDirectories)
     }
 }
 
+bool Inode::tryRef()
+{
+    auto references = mReferences.load();
+
+    // Only take a reference if someone else still holds one.
+    while (references)
+    {
+        if (mReferences.compare_exchange_weak(references, references + 1))
+            return true;
+    }
+
+    // Our last reference is being dropped.
+    return false;
+}
+
 Error Inode::unlink()
 {
     while (true)
@@ -459,10 +474,9 @@ void Inode::unref(RefBadge badge)
     assert(mReferences);
 
     // Decrement the counter.
-    --mReferences;
-
+    //
     // Inode still has some references.
-    if (mReferences)
+    if (--mReferences)
         return;
 
     // All references to this inode have been dropped.
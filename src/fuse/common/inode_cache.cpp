@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <chrono>
 #include <functional>
 
 #include <mega/fuse/common/inode_cache.h>
+#include <mega/fuse/common/inode_cache_statistics.h>
 #include <mega/fuse/common/inode.h>
 #include <mega/fuse/common/logging.h>
 #include <mega/fuse/common/ref.h>
@@ -19,35 +21,56 @@ struct InodeCache::Entry
 {
     Entry(const Inode& inode)
       : mAccessed(steady_clock::now())
+      , mFootprint(inode.footprint())
       , mInode(const_cast<Inode*>(&inode))
       , mPosition()
+      , mReferenced(false)
     {
     }
 
     // When was the inode last accessed?
     steady_clock::time_point mAccessed;
 
+    // Roughly how much memory does the inode occupy?
+    std::size_t mFootprint;
+
     // What inode has been cached?
     InodeRef mInode;
 
-    // Where is the inode in the cache's position map?
-    EntryPositionMapIterator mPosition;
+    // Where is the inode in the shard's position map?
+    EntryPositionMap::iterator mPosition;
+
+    // Has the inode been accessed since the hand last passed it?
+    bool mReferenced;
 }; // Entry;
 
+InodeCache::Shard::Shard()
+  : mEntries()
+  , mHand(mEntries.end())
+  , mLock()
+  , mPositions()
+{
+}
+
+bool InodeCache::exceeded(const InodeCacheFlags& flags) const
+{
+    // Convenience.
+    auto maxMemory = flags.mMaxMemory;
+    auto maxSize = flags.mMaxSize;
+
+    return (maxMemory && mMemory > maxMemory)
+           || (maxSize && mSize > maxSize);
+}
+
 void InodeCache::loop()
 {
     // Convenience.
-    auto& ageThreshold = mFlags.mCleanAgeThreshold;
     auto& interval = mFlags.mCleanInterval;
-    auto& sizeThreshold = mFlags.mCleanSizeThreshold;
 
     FUSEDebug1("Inode Cache Cleaner thread started");
 
     while (true)
     {
-        // Stores references to any evicted inodes.
-        auto evicted = InodeRefVector();
-
         // Acquire lock.
         Lock lock(mLock);
 
@@ -55,68 +78,166 @@ void InodeCache::loop()
         if (mTerminate)
             break;
 
-        // Wait until interval has passed or until we're notified.
-        mCV.wait_for(lock, interval);
+        // Wait until interval has passed, until we're notified or until
+        // the cache has grown beyond its limits.
+        mCV.wait_for(lock, interval, [&]() {
+            return mTerminate || mReduce || exceeded(mFlags);
+        });
+
+        // Are we shutting down?
+        if (mTerminate)
+            break;
+
+        // Latch the cache's flags.
+        auto flags = mFlags;
+
+        // We're servicing any outstanding request.
+        mReduce = false;
+
+        // Let others update our flags while we clean.
+        lock.unlock();
 
         // Try and reduce the cache's size.
-        evicted = reduce(ageThreshold, lock, sizeThreshold);
+        reduce(flags);
     }
 
     FUSEDebug1("Inode Cache Cleaner thread stopped");
 }
 
-InodeRefVector InodeCache::reduce(std::chrono::seconds age, Lock&, std::size_t size)
+void InodeCache::reduce(const InodeCacheFlags& flags)
 {
     // For debugging.
-    FUSEDebugF("Cleaning inode cache: age >= %lus, size > %lu",
-               age.count(),
-               size);
-
-    // Which inodes are to be evicted?
-    auto evicted = InodeRefVector();
+    FUSEDebugF("Cleaning inode cache: age >= %lus, size > %lu, memory > %lu",
+               flags.mCleanAgeThreshold.count(),
+               flags.mCleanSizeThreshold,
+               flags.mMaxMemory);
 
     // Convenience.
     auto now = steady_clock::now();
 
-    // How many inodes are in the cache?
-    auto num = mEntries.size();
+    // How many inodes were in the cache?
+    std::size_t num = mSize;
+
+    // How many inodes did we evict?
+    std::size_t count = 0u;
 
-    // Evict inodes until we store less than size.
-    while (mEntries.size() > size)
+    // Each entry needs at most two looks: One to clear its referenced
+    // bit and another to evict it.
+    auto budget = 2 * num + NumShards;
+
+    while (budget && !mTerminate)
     {
-        // Select oldest inode in the cache.
-        auto& entry = mEntries.back();
+        // How many entries did we examine this round?
+        std::size_t examined = 0u;
+
+        // Sweep a batch of entries from each shard.
+        for (auto& shard : mShards)
+        {
+            // Stores references to any evicted inodes.
+            //
+            // The references are dropped only after the shard's lock
+            // has been released.
+            auto evicted = InodeRefVector();
+
+            examined += sweep(flags, evicted, now, shard);
+            count += evicted.size();
+        }
+
+        // The cache's already small enough.
+        if (!examined)
+            break;
+
+        budget -= std::min(budget, examined);
+    }
+
+    FUSEDebugF("Removed %lu/%lu inode(s) from the inode cache",
+               count,
+               num);
+}
+
+auto InodeCache::shard(InodeID id) -> Shard&
+{
+    return mShards[id.get() % NumShards];
+}
 
-        // We've evicted all inodes older than age.
-        if (age.count() && age > now - entry.mAccessed)
+std::size_t InodeCache::sweep(const InodeCacheFlags& flags,
+                              InodeRefVector& evicted,
+                              steady_clock::time_point now,
+                              Shard& shard)
+{
+    // Convenience.
+    auto& age = flags.mCleanAgeThreshold;
+    auto& entries = shard.mEntries;
+    auto& hand = shard.mHand;
+
+    Lock guard(shard.mLock);
+
+    // How many entries have we examined?
+    auto examined = 0u;
+
+    for (; examined < SweepBatchSize && !entries.empty(); ++examined)
+    {
+        // Must we evict entries regardless of their age?
+        auto forced = exceeded(flags);
+
+        // The cache's small enough.
+        if (!forced && mSize <= flags.mCleanSizeThreshold)
             break;
 
+        // The hand's reached the end of the ring.
+        if (hand == entries.end())
+            hand = entries.begin();
+
+        // Convenience.
+        auto& entry = *hand;
+
+        // Give recently accessed inodes a second chance.
+        if (entry.mReferenced)
+        {
+            entry.mReferenced = false;
+            ++hand;
+            continue;
+        }
+
+        // Inode's too young to be evicted.
+        if (!forced && age.count() && age > now - entry.mAccessed)
+        {
+            ++hand;
+            continue;
+        }
+
         FUSEDebugF("Removing inode %s from inode cache",
                    toString(entry.mInode->id()).c_str());
 
+        // Update statistics.
+        mMemory -= entry.mFootprint;
+        --mSize;
+        ++mEvictions;
+
         // Remove inode from the position map.
-        mPositions.erase(entry.mPosition);
+        shard.mPositions.erase(entry.mPosition);
 
         // Take ownership of the entry's inode.
         evicted.emplace_back(std::move(entry.mInode));
 
         // Remove inode from the cache.
-        mEntries.pop_back();
+        hand = entries.erase(hand);
     }
 
-    FUSEDebugF("Removed %lu/%lu inode(s) from the inode cache",
-               evicted.size(),
-               num);
-
-    return evicted;
+    return examined;
 }
 
 InodeCache::InodeCache(const InodeCacheFlags& flags)
   : mCV()
-  , mEntries()
+  , mEvictions{0u}
   , mFlags(flags)
+  , mHits{0u}
   , mLock()
-  , mPositions()
+  , mMemory{0u}
+  , mMisses{0u}
+  , mReduce(false)
+  , mShards()
+  , mSize{0u}
   , mTerminate{false}
   , mThread(&InodeCache::loop, this)
 {
@@ -126,7 +247,10 @@ InodeCache::InodeCache(const InodeCacheFlags& flags)
 InodeCache::~InodeCache()
 {
     // Let the cleaner know it should terminate.
-    mTerminate = true;
+    {
+        Lock guard(mLock);
+        mTerminate = true;
+    }
 
     // Wake the cleaner if necessary.
     mCV.notify_one();
@@ -140,38 +264,53 @@ InodeCache::~InodeCache()
 
 bool InodeCache::add(const Inode& inode)
 {
-    Lock guard(mLock);
-
     // Convenience.
-    auto e  = mEntries.begin();
     auto id = inode.id();
+    auto& shard = this->shard(id);
 
-    // Is the inode already in the cache?
-    auto p = mPositions.find(id);
-
-    // Inode's already in the cache.
-    if (p != mPositions.end())
     {
-        // Mark inode as most recently accessed if necessary.
-        if (e != p->second)
-            mEntries.splice(e, mEntries, p->second);
+        Lock guard(shard.mLock);
 
-        // Update inode's access time.
-        p->second->mAccessed = steady_clock::now();
+        // Is the inode already in the cache?
+        auto p = shard.mPositions.find(id);
 
-        // Inode's been updated.
-        return false;
+        // Inode's already in the cache.
+        if (p != shard.mPositions.end())
+        {
+            // Mark the inode as having been referenced.
+            p->second->mReferenced = true;
+
+            // Update inode's access time.
+            p->second->mAccessed = steady_clock::now();
+
+            // Update statistics.
+            ++mHits;
+
+            // Inode's been updated.
+            return false;
+        }
+
+        // Add the inode just behind the clock's hand.
+        auto e = shard.mEntries.emplace(shard.mHand, inode);
+
+        // For debugging.
+        FUSEDebugF("Adding inode %s to inode cache",
+                   toString(id).c_str());
+
+        // Add inode to the position map.
+        e->mPosition = shard.mPositions.emplace(id, e).first;
+
+        // Update statistics.
+        mMemory += e->mFootprint;
+        ++mMisses;
+        ++mSize;
     }
 
-    // Add inode to the cache.
-    e = mEntries.emplace(e, inode);
-    
-    // For debugging.
-    FUSEDebugF("Adding inode %s to inode cache",
-               toString(id).c_str());
+    // Wake the cleaner if the cache's grown too large.
+    Lock guard(mLock);
 
-    // Add inode to the position map.
-    e->mPosition = mPositions.emplace(id, e).first;
+    if (exceeded(mFlags))
+        mCV.notify_one();
 
     // Inode's been added to the cache.
     return true;
@@ -179,17 +318,31 @@ bool InodeCache::add(const Inode& inode)
 
 void InodeCache::clear()
 {
-    EntryList entries;
-    EntryPositionMap positions;
-
-    // Acquire ownership of mEntries and mPositions.
+    for (auto& shard : mShards)
     {
-        // Acquire lock.
-        std::lock_guard<std::mutex> guard(mLock);
+        EntryList entries;
+        EntryPositionMap positions;
+
+        // Acquire ownership of the shard's entries and positions.
+        {
+            // Acquire lock.
+            Lock guard(shard.mLock);
+
+            // Take ownership of the shard's entries and positions.
+            entries = std::move(shard.mEntries);
+            positions = std::move(shard.mPositions);
+
+            // Make sure the shard's members are in a known state.
+            shard.mEntries.clear();
+            shard.mHand = shard.mEntries.end();
+            shard.mPositions.clear();
+
+            // Update statistics.
+            for (auto& entry : entries)
+                mMemory -= entry.mFootprint;
 
-        // Take ownership of mEntries and mPositions.
-        entries = std::move(mEntries);
-        positions = std::move(mPositions);
+            mSize -= entries.size();
+        }
     }
 }
 
@@ -205,6 +358,8 @@ void InodeCache::flags(const InodeCacheFlags& flags)
         mFlags.mCleanInterval = std::chrono::seconds::max();
 
     // Wake the cleaner so the flags take effect.
+    mReduce = true;
+
     mCV.notify_one();
 }
 
@@ -217,32 +372,63 @@ InodeCacheFlags InodeCache::flags() const
 
 bool InodeCache::remove(const Inode& inode)
 {
-    Lock guard(mLock);
-
     // Convenience.
     auto id = inode.id();
+    auto& shard = this->shard(id);
+
+    // Keeps the inode alive until we've released the shard's lock.
+    InodeRef ref;
+
+    Lock guard(shard.mLock);
 
     // Is this inode in the cache?
-    auto p = mPositions.find(id);
+    auto p = shard.mPositions.find(id);
 
     // Inode isn't in the cache.
-    if (p == mPositions.end())
+    if (p == shard.mPositions.end())
         return false;
 
     // For debugging.
     FUSEDebugF("Removing inode %s from inode cache",
                toString(id).c_str());
 
+    // Convenience.
+    auto e = p->second;
+
+    // Make sure the hand doesn't refer to a dead entry.
+    if (shard.mHand == e)
+        ++shard.mHand;
+
+    // Update statistics.
+    mMemory -= e->mFootprint;
+    --mSize;
+
+    // Take ownership of the entry's inode.
+    ref = std::move(e->mInode);
+
     // Remove the inode from the cache.
-    mEntries.erase(p->second);
+    shard.mEntries.erase(e);
 
     // Remove inode from the position map.
-    mPositions.erase(p);
+    shard.mPositions.erase(p);
 
     // Inode's been removed from the cache.
     return true;
 }
 
+InodeCacheStatistics InodeCache::statistics() const
+{
+    InodeCacheStatistics statistics;
+
+    statistics.mEvictions = mEvictions;
+    statistics.mHits = mHits;
+    statistics.mMemory = mMemory;
+    statistics.mMisses = mMisses;
+    statistics.mSize = mSize;
+
+    return statistics;
+}
+
 } // fuse
 } // mega
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <map>
@@ -36,6 +37,56 @@ namespace mega
 namespace fuse
 {
 
+// Below this many files, looking up each child is cheap enough.
+static constexpr std::uint64_t BulkLookupThreshold = 256u;
+
+// Any wait shorter than this is considered uncontended.
+static constexpr std::chrono::microseconds ContendedThreshold(10);
+
+// When did this thread start waiting for the inode DB's lock?
+static thread_local std::chrono::steady_clock::time_point waitStarted;
+
+std::atomic<std::uint64_t> LockableTraits<InodeDB>::mAcquired{0};
+std::atomic<std::uint64_t> LockableTraits<InodeDB>::mContended{0};
+std::atomic<std::uint64_t> LockableTraits<InodeDB>::mWaited{0};
+
+void LockableTraits<InodeDB>::acquiring(const InodeDB&)
+{
+    waitStarted = std::chrono::steady_clock::now();
+}
+
+void LockableTraits<InodeDB>::acquired(const InodeDB&)
+{
+    ++mAcquired;
+
+    // Lock was acquired by trying.
+    if (waitStarted == std::chrono::steady_clock::time_point())
+        return;
+
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+
+    // How long did this thread wait for the lock?
+    auto waited =
+      duration_cast<microseconds>(std::chrono::steady_clock::now()
+                                  - waitStarted);
+
+    waitStarted = std::chrono::steady_clock::time_point();
+
+    // Lock was free.
+    if (waited < ContendedThreshold)
+        return;
+
+    ++mContended;
+
+    mWaited += static_cast<std::uint64_t>(waited.count());
+}
+
+void LockableTraits<InodeDB>::couldntAcquire(const InodeDB&)
+{
+    ++mContended;
+}
+
 class InodeDB::EventObserver
 {
     // Called when a node's been added.
@@ -92,7 +143,9 @@ public:
 InodeDB::Queries::Queries(Database& database)
   : mAddInode(database.query())
   , mClearBindHandles(database.query())
+  , mCountCachedFiles(database.query())
   , mGetChildrenByParentHandle(database.query())
+  , mGetCachedFiles(database.query())
   , mGetExtensionAndInodeIDByHandle(database.query())
   , mGetExtensionAndInodeIDByNameAndParentHandle(database.query())
   , mGetHandleByID(database.query())
@@ -123,6 +176,10 @@ InodeDB::Queries::Queries(Database& database)
 
     mClearBindHandles = "update inodes set bind_handle = null";
 
+    mCountCachedFiles = "select count(handle) as count "
+                        "  from inodes "
+                        " where handle is not null";
+
     mGetChildrenByParentHandle = "select bind_handle "
                                  "     , extension "
                                  "     , handle "
@@ -131,6 +188,12 @@ InodeDB::Queries::Queries(Database& database)
                                  "  from inodes "
                                  " where parent_handle = :parent_handle";
 
+    mGetCachedFiles = "select extension "
+                      "     , handle "
+                      "     , id "
+                      "  from inodes "
+                      " where handle is not null";
+
     mGetExtensionAndInodeIDByHandle = "select extension "
                                       "     , id "
                                       "  from inodes "
@@ -219,6 +282,7 @@ InodeRef InodeDB::add(InodePtr (InodeDB::*build)(const NodeInfo&),
     // Add the inode to the index.
     auto h = mByHandle.emplace(handle, ptr.get()).first;
 
+    mIndex.add(*ptr);
     mByID.emplace(id, std::move(ptr));
 
     // Return inode to caller.
@@ -486,6 +550,45 @@ InodeRefVector InodeDB::children(const DirectoryInode& parent) const
     // Pop dummy marker.
     storage.pop_front();
 
+    // How many of our cloud children are files?
+    auto numFiles = static_cast<std::uint64_t>(
+                      std::count_if(storage.begin(),
+                                    storage.end(),
+                                    [](const NodeInfo& info) {
+                                        return !info.mIsDirectory;
+                                    }));
+
+    // Maps a cached file's handle to its extension and ID.
+    std::map<NodeHandle, std::pair<FileExtension, InodeID>> cached;
+
+    // Is it cheaper to load every cached file than to look up each child?
+    auto bulk = ([&]() {
+        // Not enough files to make loading the cache worthwhile.
+        if (numFiles < BulkLookupThreshold)
+            return false;
+
+        query = transaction.query(mQueries.mCountCachedFiles);
+        query.execute();
+
+        // Only worthwhile if the cache holds fewer files than we have.
+        return query.field("count").uint64() < numFiles;
+    })();
+
+    // Load every cached file in one pass.
+    if (bulk)
+    {
+        query = transaction.query(mQueries.mGetCachedFiles);
+
+        for (query.execute(); query; ++query)
+        {
+            auto extension = fileExtensionDB().get(query.field("extension"));
+
+            cached.emplace(query.field("handle").handle(),
+                           std::make_pair(std::move(extension),
+                                          query.field("id").inode()));
+        }
+    }
+
     // Prepare query.
     query = transaction.query(mQueries.mGetExtensionAndInodeIDByHandle);
 
@@ -511,19 +614,41 @@ InodeRefVector InodeDB::children(const DirectoryInode& parent) const
             if (info.mIsDirectory)
                 return self.add(&InodeDB::buildDirectory, info);
 
-            query.reset();
+            // Where is the child in the file cache?
+            auto location = ([&]() -> std::pair<FileExtension, InodeID> {
+                // We've already loaded every cached file.
+                if (bulk)
+                {
+                    auto c = cached.find(info.mHandle);
 
-            // Check if child's in the file cache.
-            query.param(":handle") = info.mHandle;
-            query.execute();
+                    // Child's not in the file cache.
+                    if (c == cached.end())
+                        return std::make_pair(FileExtension(), InodeID());
+
+                    return std::move(c->second);
+                }
+
+                query.reset();
+
+                // Check if child's in the file cache.
+                query.param(":handle") = info.mHandle;
+                query.execute();
+
+                // Child's not in the file cache.
+                if (!query)
+                    return std::make_pair(FileExtension(), InodeID());
+
+                return std::make_pair(fileExtensionDB().get(query.field("extension")),
+                                      query.field("id").inode());
+            })();
 
             // Child's not in the file cache.
-            if (!query)
+            if (!location.second)
                 return self.add(&InodeDB::buildFile, info);
 
             // Convenience.
-            auto extension = fileExtensionDB().get(query.field("extension"));
-            auto id = query.field("id").inode();
+            auto extension = std::move(location.first);
+            auto id = location.second;
 
             // Try and get our hands on the file's info.
             auto fileInfo = fileCache().info(extension, id);
@@ -549,6 +674,7 @@ InodeRefVector InodeDB::children(const DirectoryInode& parent) const
 
             // Add child to index.
             mByHandle.emplace(info.mHandle, ptr.get());
+            mIndex.add(*ptr);
             mByID.emplace(id, std::move(ptr));
 
             // Return new child instance.
@@ -611,6 +737,7 @@ InodeRefVector InodeDB::children(const DirectoryInode& parent) const
         children.emplace_back(ptr.get());
 
         // Add child to index.
+        mIndex.add(*ptr);
         mByID.emplace(id, std::move(ptr));
     }
 
@@ -832,6 +959,8 @@ InodeRef InodeDB::get(FileCache& fileCache,
         ptr->fileInfo(std::move(fileInfo));
 
         // Add the inode to the index.
+        mIndex.add(*ptr);
+
         i = mByID.emplace(id, std::move(ptr)).first;
 
         // File doesn't exist in the cloud.
@@ -1122,6 +1251,8 @@ ErrorOr<MakeInodeResult> InodeDB::makeFile(const platform::Mount& mount,
         assert(!mByID.count(id));
 
         // Add the inode to our index.
+        mIndex.add(*ptr);
+
         auto i = mByID.emplace(id, std::move(ptr)).first;
 
         // Return a reference to our new inode.
@@ -1262,6 +1393,8 @@ void InodeDB::remove(const DirectoryInode& inode, InodeDBLock)
     auto count = mByHandle.erase(inode.handle());
     assert(count);
 
+    mIndex.remove(inode.id());
+
     count = mByID.erase(inode.id());
     assert(count);
 
@@ -1300,6 +1433,7 @@ void InodeDB::remove(const FileInode& inode, InodeDBLock lock)
         ptr = std::move(i->second);
 
         // Remove the inode from the ID index.
+        mIndex.remove(id);
         mByID.erase(i);
 
         // Remove the inode from the other indexes.
@@ -1518,6 +1652,7 @@ InodeDB::InodeDB(platform::ServiceContext& context)
   , mCV()
   , mContext(context)
   , mDiscard(false)
+  , mIndex()
   , mQueries(context.mDatabase)
 {
     FUSEDebug1("Inode DB constructed");
@@ -1533,6 +1668,15 @@ InodeDB::InodeDB(platform::ServiceContext& context)
 
 InodeDB::~InodeDB()
 {
+    using Traits = LockableTraits<InodeDB>;
+
+    FUSEDebugF("Inode DB lock acquired %llu time(s), "
+               "contended %llu time(s), "
+               "waited %llu microsecond(s)",
+               static_cast<unsigned long long>(Traits::mAcquired.load()),
+               static_cast<unsigned long long>(Traits::mContended.load()),
+               static_cast<unsigned long long>(Traits::mWaited.load()));
+
     FUSEDebug1("Inode DB destroyed");
 }
 
@@ -1708,6 +1852,53 @@ bool InodeDB::exists(InodeID id) const
     return !!query;
 }
 
+bool InodeDB::evict(InodeID id)
+{
+    // Sanity.
+    assert(id);
+
+    auto guard = lockAll(mContext.mDatabase, *this);
+
+    // Inode's in use so its content must be retained.
+    if (mByID.count(id))
+        return false;
+
+    auto transaction = mContext.mDatabase.transaction();
+    auto query = transaction.query(mQueries.mGetInodeByID);
+
+    query.param(":id") = id;
+    query.execute();
+
+    // Inode isn't in the database.
+    if (!query)
+        return false;
+
+    // Content hasn't been flushed or bound to a node in the cloud.
+    if (query.field("modified")
+        || !query.field("bind_handle").null()
+        || query.field("handle").null())
+        return false;
+
+    // Convenience.
+    auto extension = fileExtensionDB().get(query.field("extension"));
+
+    // Remove the inode from the database.
+    query = transaction.query(mQueries.mRemoveInodeByID);
+
+    query.param(":id") = id;
+    query.execute();
+
+    transaction.commit();
+
+    // Remove the inode's content from the cache.
+    fileCache().remove(extension, id);
+
+    FUSEDebugF("Evicted %s from the file cache",
+               toString(id).c_str());
+
+    return true;
+}
+
 FileCache& InodeDB::fileCache() const
 {
     return mContext.mFileCache;
@@ -1748,6 +1939,13 @@ InodeRef InodeDB::get(InodeID id, bool inMemoryOnly) const
 {
     assert(id);
 
+    // Check if the inode's in memory without waiting for our lock.
+    //
+    // This way, the kernel's requests aren't stalled while we're busy
+    // applying node events from the cloud.
+    if (auto ref = mIndex.get(id))
+        return ref->accessed(), ref;
+
     // Acquire database lock.
     auto lock = lockAll(mContext.mDatabase, *this);
 
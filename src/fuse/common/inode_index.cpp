@@ -0,0 +1,85 @@
+#include <cassert>
+#include <mutex>
+#include <shared_mutex>
+
+#include <mega/fuse/common/inode.h>
+#include <mega/fuse/common/inode_id.h>
+#include <mega/fuse/common/inode_index.h>
+#include <mega/fuse/common/ref.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+auto InodeIndex::shard(InodeID id) const -> Shard&
+{
+    return mShards[id.get() % NumShards];
+}
+
+InodeIndex::InodeIndex()
+  : mShards()
+{
+}
+
+InodeIndex::~InodeIndex() = default;
+
+void InodeIndex::add(Inode& inode)
+{
+    // Convenience.
+    auto& shard = this->shard(inode.id());
+
+    std::lock_guard<SharedMutex> guard(shard.mLock);
+
+    // Sanity.
+    assert(!shard.mInodes.count(inode.id()));
+
+    // Add the inode to the index.
+    shard.mInodes.emplace(inode.id(), &inode);
+}
+
+InodeRef InodeIndex::get(InodeID id) const
+{
+    // Convenience.
+    auto& shard = this->shard(id);
+
+    std::shared_lock<SharedMutex> guard(shard.mLock);
+
+    // Is the inode in memory?
+    auto i = shard.mInodes.find(id);
+
+    // Inode isn't in memory.
+    if (i == shard.mInodes.end())
+        return InodeRef();
+
+    // The inode's last reference is being dropped.
+    //
+    // The inode can't be destroyed while we hold the shard's lock as
+    // it must first be removed from the index.
+    if (!i->second->tryRef())
+        return InodeRef();
+
+    // Return a reference to the caller.
+    return InodeRef(i->second, AdoptRef);
+}
+
+void InodeIndex::remove(InodeID id)
+{
+    // Convenience.
+    auto& shard = this->shard(id);
+
+    std::lock_guard<SharedMutex> guard(shard.mLock);
+
+    // Remove the inode from the index.
+    auto count = shard.mInodes.erase(id);
+
+    // Sanity.
+    assert(count);
+
+    // Silence the compiler.
+    static_cast<void>(count);
+}
+
+} // fuse
+} // mega
+
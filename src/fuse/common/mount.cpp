@@ -213,6 +213,10 @@ void Mount::enabled()
 
     // Flush any modified files contained by this mount.
     fileCache.flush(*this, inodeDB.modified(mHandle));
+
+    // Make sure the mount's content is available offline.
+    if (flags().mOffline)
+        fileCache.prefetch(*this);
 }
 
 void Mount::executorFlags(const TaskExecutorFlags&)
@@ -221,9 +225,20 @@ void Mount::executorFlags(const TaskExecutorFlags&)
 
 void Mount::flags(const MountFlags& flags)
 {
-    std::lock_guard<std::mutex> guard(mLock);
+    // Was the mount's content already available offline?
+    auto offline = ([&]() {
+        std::lock_guard<std::mutex> guard(mLock);
+
+        auto offline = mFlags.mOffline;
+
+        mFlags = flags;
+
+        return offline;
+    })();
 
-    mFlags = flags;
+    // Mount's content should now be available offline.
+    if (!offline && flags.mOffline)
+        mMountDB.mContext.mFileCache.prefetch(*this);
 }
 
 MountFlags Mount::flags() const
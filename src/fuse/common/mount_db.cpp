@@ -49,13 +49,15 @@ MountDB::Queries::Queries(Database& mDatabase)
                 "  :name, "
                 "  :path, "
                 "  :persistent, "
-                "  :read_only "
+                "  :read_only, "
+                "  :offline "
                 ")";
 
     mGetMountByPath = "select * from mounts where path = :path";
 
     mGetMountFlagsByPath = "select enable_at_startup "
                            "     , name "
+                           "     , offline "
                            "     , persistent "
                            "     , read_only "
                            "  from mounts "
@@ -84,6 +86,7 @@ MountDB::Queries::Queries(Database& mDatabase)
     mSetMountFlagsByPath = "update mounts "
                            "   set enable_at_startup = :enable_at_startup "
                            "     , name = :name "
+                           "     , offline = :offline "
                            "     , persistent = :persistent "
                            "     , read_only = :read_only "
                            " where path = :path";
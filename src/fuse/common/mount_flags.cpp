@@ -15,6 +15,7 @@ bool MountFlags::operator==(const MountFlags& rhs) const
 {
     return mName == rhs.mName
            && mEnableAtStartup == rhs.mEnableAtStartup
+           && mOffline == rhs.mOffline
            && mPersistent == rhs.mPersistent
            && mReadOnly == rhs.mReadOnly;
 }
@@ -31,6 +32,7 @@ try
 
     flags.mEnableAtStartup = query.field("enable_at_startup");
     flags.mName = query.field("name").string();
+    flags.mOffline = query.field("offline");
     flags.mPersistent = query.field("persistent");
     flags.mReadOnly = query.field("read_only");
 
@@ -54,6 +56,7 @@ try
 
     query.param(":enable_at_startup") = mEnableAtStartup;
     query.param(":name") = mName;
+    query.param(":offline") = mOffline;
     query.param(":persistent") = mPersistent;
     query.param(":read_only") = mReadOnly;
 }
@@ -0,0 +1,107 @@
+#include <cassert>
+
+#include <mega/fuse/common/logging.h>
+#include <mega/fuse/common/operation_monitor.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+using namespace std::chrono;
+
+// Operations slower than this are logged as they complete.
+static constexpr auto SlowThreshold = seconds(1);
+
+OperationMonitor::OperationMonitor()
+  : mOperations()
+{
+}
+
+OperationMonitor::~OperationMonitor()
+{
+}
+
+void OperationMonitor::record(OperationType type,
+                              steady_clock::time_point started)
+{
+    // Sanity.
+    assert(type < NumOperationTypes);
+
+    // How long did this operation take?
+    auto latency = duration_cast<microseconds>(steady_clock::now() - started);
+    auto latency_ = static_cast<std::uint64_t>(latency.count());
+
+    // Which bucket does this operation belong in?
+    auto bucket = std::size_t(0u);
+
+    while (bucket + 1 < NumLatencyBuckets && latency_ >> bucket)
+        ++bucket;
+
+    auto& histogram = mOperations[type];
+
+    histogram.mBuckets[bucket].fetch_add(1u, std::memory_order_relaxed);
+    histogram.mCount.fetch_add(1u, std::memory_order_relaxed);
+    histogram.mTotalLatency.fetch_add(latency_, std::memory_order_relaxed);
+
+    // Keep track of the slowest operation.
+    auto maxLatency = histogram.mMaxLatency.load(std::memory_order_relaxed);
+
+    while (maxLatency < latency_
+           && !histogram.mMaxLatency.compare_exchange_weak(maxLatency,
+                                                           latency_,
+                                                           std::memory_order_relaxed))
+        ;
+
+    // Operation was fast enough.
+    if (latency < SlowThreshold)
+        return;
+
+    FUSEWarningF("Slow %s operation took %llu milliseconds",
+                 toString(type),
+                 static_cast<unsigned long long>(latency_ / 1000u));
+}
+
+OperationStatistics OperationMonitor::statistics() const
+{
+    OperationStatistics statistics;
+
+    // Latch each operation's histogram.
+    for (std::size_t i = 0; i < NumOperationTypes; ++i)
+    {
+        auto& source = mOperations[i];
+        auto& target = statistics.mOperations[i];
+
+        for (std::size_t j = 0; j < NumLatencyBuckets; ++j)
+            target.mBuckets[j] = source.mBuckets[j].load(std::memory_order_relaxed);
+
+        target.mCount = source.mCount.load(std::memory_order_relaxed);
+
+        target.mMaxLatency =
+          microseconds(source.mMaxLatency.load(std::memory_order_relaxed));
+
+        target.mTotalLatency =
+          microseconds(source.mTotalLatency.load(std::memory_order_relaxed));
+    }
+
+    return statistics;
+}
+
+OperationTimer::OperationTimer(OperationMonitor& monitor,
+                               OperationType type,
+                               steady_clock::time_point started)
+  : mMonitor(monitor)
+  , mStarted(started)
+  , mType(type)
+  , mTrace("fuse", toString(type))
+{
+}
+
+OperationTimer::~OperationTimer()
+{
+    mMonitor.record(mType, mStarted);
+}
+
+} // fuse
+} // mega
+
@@ -0,0 +1,40 @@
+#include <algorithm>
+
+#include <mega/fuse/common/operation_statistics.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+using std::chrono::microseconds;
+
+microseconds OperationStatistics::Histogram::percentile(unsigned int percent) const
+{
+    // No operations have been performed.
+    if (!mCount)
+        return microseconds(0);
+
+    // How many operations must fall below the latency we return?
+    auto wanted = (mCount * std::min(percent, 100u) + 99u) / 100u;
+
+    // How many operations have we seen so far?
+    auto seen = std::uint64_t(0u);
+
+    // Find the bucket containing the wanted operation.
+    for (std::size_t i = 0; i + 1 < mBuckets.size(); ++i)
+    {
+        seen += mBuckets[i];
+
+        // Every operation in this bucket took less than 2^i microseconds.
+        if (seen >= wanted)
+            return std::min(microseconds(std::int64_t(1) << i), mMaxLatency);
+    }
+
+    // Operation's in the last, unbounded, bucket.
+    return mMaxLatency;
+}
+
+} // fuse
+} // mega
+
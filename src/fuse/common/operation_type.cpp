@@ -0,0 +1,23 @@
+#include <mega/fuse/common/operation_type.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+const char* toString(OperationType type)
+{
+    switch (type)
+    {
+#define DEFINE_OPERATION_TYPE_CLAUSE(name) case name: return #name;
+        DEFINE_OPERATION_TYPES(DEFINE_OPERATION_TYPE_CLAUSE);
+#undef DEFINE_OPERATION_TYPE_CLAUSE
+    }
+
+    // Silence the compiler.
+    return "N/A";
+}
+
+} // fuse
+} // mega
+
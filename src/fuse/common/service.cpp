@@ -3,6 +3,8 @@
 
 #include <mega/fuse/common/client.h>
 #include <mega/fuse/common/error_or.h>
+#include <mega/fuse/common/file_cache_statistics.h>
+#include <mega/fuse/common/inode_cache_statistics.h>
 #include <mega/fuse/common/inode_info.h>
 #include <mega/fuse/common/logging.h>
 #include <mega/fuse/common/mount_event_type.h>
@@ -10,7 +12,9 @@
 #include <mega/fuse/common/mount_info.h>
 #include <mega/fuse/common/mount_result.h>
 #include <mega/fuse/common/normalized_path.h>
+#include <mega/fuse/common/operation_statistics.h>
 #include <mega/fuse/common/service.h>
+#include <mega/fuse/common/task_executor_statistics.h>
 #include <mega/fuse/common/task_queue.h>
 #include <mega/fuse/platform/service_context.h>
 
@@ -59,6 +63,16 @@ bool Service::cached(NormalizedPath path) const
     return mContext && mContext->cached(path);
 }
 
+ErrorOr<LocalPath> Service::cachedContent(NodeHandle handle,
+                                          m_time_t modified,
+                                          m_off_t size) const
+{
+    if (mContext)
+        return mContext->cachedContent(handle, modified, size);
+
+    return API_ENOENT;
+}
+
 void Service::current()
 {
     if (mContext)
@@ -153,6 +167,22 @@ Task Service::execute(std::function<void(const Task&)> function)
     return task;
 }
 
+TaskExecutorStatistics Service::executorStatistics() const
+{
+    if (mContext)
+        return mContext->executorStatistics();
+
+    return TaskExecutorStatistics();
+}
+
+FileCacheStatistics Service::fileCacheStatistics() const
+{
+    if (mContext)
+        return mContext->fileCacheStatistics();
+
+    return FileCacheStatistics();
+}
+
 MountResult Service::flags(const NormalizedPath& path,
                            const MountFlags& flags)
 {
@@ -210,6 +240,14 @@ catch (std::runtime_error& exception)
     return MOUNT_UNEXPECTED;
 }
 
+InodeCacheStatistics Service::inodeCacheStatistics() const
+{
+    if (mContext)
+        return mContext->inodeCacheStatistics();
+
+    return InodeCacheStatistics();
+}
+
 void Service::logLevel(LogLevel level)
 {
     std::lock_guard<std::mutex> guard(mFlagsLock);
@@ -224,6 +262,14 @@ LogLevel Service::logLevel() const
     return Logger::logLevel();
 }
 
+OperationStatistics Service::operationStatistics() const
+{
+    if (mContext)
+        return mContext->operationStatistics();
+
+    return OperationStatistics();
+}
+
 NormalizedPathVector Service::paths(const std::string& name) const
 {
     if (mContext)
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <thread>
@@ -34,12 +35,65 @@ public:
     ~Worker();
 }; // Worker
 
+// Tasks that wait longer than this past their due time are logged.
+static constexpr auto WaitWarningThreshold = std::chrono::seconds(1);
+
+auto TaskExecutor::ready() -> Lane*
+{
+    // Convenience.
+    auto now = std::chrono::steady_clock::now();
+
+    // Lanes are ordered by priority.
+    for (auto& lane : mLanes)
+    {
+        if (lane.mTasks.when() <= now && permitted(lane))
+            return &lane;
+    }
+
+    // No lane has any work we can execute now.
+    return nullptr;
+}
+
+bool TaskExecutor::permitted(const Lane& lane) const
+{
+    // Interactive work can always be executed.
+    if (&lane == &mLanes[TP_INTERACTIVE])
+        return true;
+
+    // How many workers are executing less urgent work?
+    auto busy = std::size_t(0u);
+
+    for (auto& lane_ : mLanes)
+        busy += lane_.mBusyWorkers;
+
+    busy -= mLanes[TP_INTERACTIVE].mBusyWorkers;
+
+    // Always leave a worker free for interactive work.
+    return busy + 1 < std::max<std::size_t>(mFlags.mMaxWorkers, 2u);
+}
+
+std::chrono::steady_clock::time_point TaskExecutor::when() const
+{
+    auto when = std::chrono::steady_clock::time_point::max();
+
+    // Ignore lanes whose work we couldn't execute anyway.
+    //
+    // We'll be notified when a worker finishes executing a task.
+    for (auto& lane : mLanes)
+    {
+        if (permitted(lane))
+            when = std::min(when, lane.mTasks.when());
+    }
+
+    return when;
+}
+
 TaskExecutor::TaskExecutor(const TaskExecutorFlags& flags)
   : mAvailableWorkers(0u)
   , mCV()
   , mFlags(flags)
+  , mLanes()
   , mLock()
-  , mTaskQueue()
   , mTerminating(false)
   , mWorkers()
 {
@@ -80,6 +134,7 @@ TaskExecutor::~TaskExecutor()
 }
 
 Task TaskExecutor::execute(std::function<void(const Task&)> function,
+                           TaskPriority priority,
                            std::chrono::steady_clock::time_point when,
                            bool spawnWorker)
 {
@@ -131,7 +186,7 @@ Task TaskExecutor::execute(std::function<void(const Task&)> function,
     assert(!mWorkers.empty());
 
     // Queue the task for execution.
-    mTaskQueue.queue(task);
+    mLanes[priority].mTasks.queue(task);
 
     // Release executor lock.
     lock.unlock();
@@ -143,6 +198,20 @@ Task TaskExecutor::execute(std::function<void(const Task&)> function,
     return task;
 }
 
+Task TaskExecutor::execute(std::function<void(const Task&)> function,
+                           std::chrono::steady_clock::time_point when,
+                           bool spawnWorker)
+{
+    // Is the task due now?
+    auto priority = TP_INTERACTIVE;
+
+    // Task's to be executed sometime in the future.
+    if (when > std::chrono::steady_clock::now())
+        priority = TP_PERIODIC;
+
+    return execute(std::move(function), priority, when, spawnWorker);
+}
+
 void TaskExecutor::flags(const TaskExecutorFlags& flags)
 {
     std::lock_guard<std::mutex> guard(mLock);
@@ -159,6 +228,18 @@ TaskExecutorFlags TaskExecutor::flags() const
     return mFlags;
 }
 
+TaskExecutorStatistics TaskExecutor::statistics() const
+{
+    TaskExecutorStatistics statistics;
+
+    std::lock_guard<std::mutex> guard(mLock);
+
+    for (auto i = 0u; i < NumTaskPriorities; ++i)
+        statistics.mLanes[i] = mLanes[i].mStatistics;
+
+    return statistics;
+}
+
 void TaskExecutor::Worker::loop()
 {
     // Acquire executor lock.
@@ -168,23 +249,28 @@ void TaskExecutor::Worker::loop()
     auto& availableWorkers = mExecutor.mAvailableWorkers;
     auto& cv = mExecutor.mCV;
     auto& flags = mExecutor.mFlags;
-    auto& taskQueue = mExecutor.mTaskQueue;
+    auto& lanes = mExecutor.mLanes;
     auto& terminating = mExecutor.mTerminating;
     auto& workers = mExecutor.mWorkers;
 
-    // When should we wake up?
-    auto nextWakeup = [&]() {
-        if (!taskQueue.empty())
-            return taskQueue.when();
+    using std::chrono::steady_clock;
 
-        using std::chrono::steady_clock;
+    // Have any tasks been queued?
+    auto empty = [&]() {
+        return std::all_of(lanes.begin(), lanes.end(), [](const Lane& lane) {
+            return lane.mTasks.empty();
+        });
+    }; // empty
 
-        return steady_clock::now() + flags.mIdleTime;
+    // When should we wake up?
+    auto nextWakeup = [&]() {
+        return std::min(mExecutor.when(),
+                        steady_clock::now() + flags.mIdleTime);
     }; // nextWakeup
 
     // Should we wake up?
     auto shouldWake = [&]() {
-        return terminating || taskQueue.ready();
+        return terminating || mExecutor.ready();
     }; // shouldWake
 
     FUSEDebug1("Worker thread started");
@@ -207,7 +293,7 @@ void TaskExecutor::Worker::loop()
                 continue;
 
             // Keep at least a single worker alive if there tasks pending.
-            if (!taskQueue.empty() && workers.size() < 2)
+            if (!empty() && workers.size() < 2)
                 continue;
 
             // So we don't block on our own removal.
@@ -224,14 +310,35 @@ void TaskExecutor::Worker::loop()
         if (mExecutor.mTerminating)
             break;
 
-        // Pop a task from the queue.
-        auto task = taskQueue.dequeue();
+        // Select the most urgent lane with work we can execute.
+        auto& lane = *mExecutor.ready();
+
+        // How long has the task waited past its due time?
+        auto now = steady_clock::now();
+        auto wait = std::chrono::duration_cast<std::chrono::microseconds>(
+                      now - std::min(now, lane.mTasks.when()));
+
+        // Pop a task from the lane.
+        auto task = lane.mTasks.dequeue();
 
         // Sanity.
         assert(task);
 
+        // Update the lane's statistics.
+        ++lane.mStatistics.mExecuted;
+
+        lane.mStatistics.mMaxWait = std::max(lane.mStatistics.mMaxWait, wait);
+        lane.mStatistics.mTotalWait += wait;
+
+        // Let the user know if the task was badly delayed.
+        if (wait >= WaitWarningThreshold)
+            FUSEWarningF("Task waited %lldms in the %s lane",
+                         static_cast<long long>(wait.count() / 1000),
+                         toString(static_cast<TaskPriority>(&lane - lanes.data())));
+
         // Let the executor know we're busy.
         --availableWorkers;
+        ++lane.mBusyWorkers;
 
         // Release the lock so other workers can proceed.
         lock.unlock();
@@ -244,6 +351,11 @@ void TaskExecutor::Worker::loop()
 
         // Let the executor know we're available.
         ++availableWorkers;
+        --lane.mBusyWorkers;
+
+        // Less urgent work may be waiting for us to finish.
+        if (&lane != &lanes[TP_INTERACTIVE])
+            cv.notify_one();
     }
 
     --availableWorkers;
@@ -0,0 +1,23 @@
+#include <mega/fuse/common/task_priority.h>
+
+namespace mega
+{
+namespace fuse
+{
+
+const char* toString(TaskPriority priority)
+{
+    switch (priority)
+    {
+#define DEFINE_TASK_PRIORITY_CLAUSE(name) case name: return #name;
+        DEFINE_TASK_PRIORITIES(DEFINE_TASK_PRIORITY_CLAUSE);
+#undef DEFINE_TASK_PRIORITY_CLAUSE
+    }
+
+    // Silence the compiler.
+    return "N/A";
+}
+
+} // fuse
+} // mega
+
@@ -49,6 +49,13 @@ ErrorOr<std::string> FileContext::read(m_off_t offset, unsigned int size)
     return mContext->read(mount(), offset, size);
 }
 
+Error FileContext::read(m_off_t offset,
+                        unsigned int size,
+                        const FileReadCallback& callback)
+{
+    return mContext->read(mount(), offset, size, callback);
+}
+
 Error FileContext::touch(m_time_t modified)
 {
     return mContext->touch(mount(), modified);
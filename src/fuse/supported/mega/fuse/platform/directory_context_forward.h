@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <set>
 
 namespace mega
 {
@@ -12,6 +13,7 @@ namespace platform
 class DirectoryContext;
 
 using DirectoryContextPtr = std::unique_ptr<DirectoryContext>;
+using DirectoryContextRawPtrSet = std::set<DirectoryContext*>;
 
 } // platform
 } // fuse
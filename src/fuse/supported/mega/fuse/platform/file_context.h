@@ -1,7 +1,7 @@
 #pragma once
 
 #include <mega/fuse/common/error_or_forward.h>
-#include <mega/fuse/common/file_io_context_forward.h>
+#include <mega/fuse/common/file_io_context.h>
 #include <mega/fuse/common/file_open_flag_forward.h>
 #include <mega/fuse/common/ref.h>
 #include <mega/fuse/platform/context.h>
@@ -44,6 +44,11 @@ public:
     // Read data from the file.
     ErrorOr<std::string> read(m_off_t offset, unsigned int size);
 
+    // Read data from the file without copying it.
+    Error read(m_off_t offset,
+               unsigned int size,
+               const FileReadCallback& callback);
+
     // Update the file's modification time.
     Error touch(m_time_t modified);
 
@@ -5,6 +5,7 @@
 #include <mega/fuse/common/file_extension_db.h>
 #include <mega/fuse/common/inode_cache.h>
 #include <mega/fuse/common/inode_db.h>
+#include <mega/fuse/common/operation_monitor.h>
 #include <mega/fuse/common/service_context.h>
 #include <mega/fuse/common/service_flags.h>
 #include <mega/fuse/common/task_executor.h>
@@ -37,6 +38,11 @@ public:
     // Check if a file exists in the cache.
     bool cached(NormalizedPath path) const override;
 
+    // Where is a file's complete content in the cache?
+    ErrorOr<LocalPath> cachedContent(NodeHandle handle,
+                                     m_time_t modified,
+                                     m_off_t size) const override;
+
     // Called by the client when its view of the cloud is current.
     void current() override;
 
@@ -65,6 +71,12 @@ public:
     // Execute a function on some thread.
     Task execute(std::function<void(const Task&)> function) override;
 
+    // How long have the service's tasks had to wait?
+    TaskExecutorStatistics executorStatistics() const override;
+
+    // How effective has the file cache been?
+    FileCacheStatistics fileCacheStatistics() const override;
+
     // Update a mount's flags.
     MountResult flags(const LocalPath& path,
                       const MountFlags& flags) override;
@@ -81,6 +93,12 @@ public:
     // Describe all (enabled) mounts.
     MountInfoVector get(bool enabled) const override;
 
+    // How effective has the inode cache been?
+    InodeCacheStatistics inodeCacheStatistics() const override;
+
+    // How long have the service's operations taken?
+    OperationStatistics operationStatistics() const override;
+
     // Retrieve the path of all mounts associated with this name.
     NormalizedPathVector paths(const std::string& name) const override;
 
@@ -100,6 +118,7 @@ public:
     MountResult upgrade(const LocalPath& path,
                         std::size_t target) override;
 
+    OperationMonitor mOperationMonitor;
     Database mDatabase;
     TaskExecutor mExecutor;
     FileExtensionDB mFileExtensionDB;
@@ -17,6 +17,14 @@ namespace fuse
 namespace platform
 {
 
+fuse_chan* clone(fuse_chan*)
+{
+    // macFUSE has no way of cloning a channel.
+    errno = ENOTSUP;
+
+    return nullptr;
+}
+
 PathVector filesystems(FilesystemPredicate predicate)
 {
     // How many filesystems are mounted?
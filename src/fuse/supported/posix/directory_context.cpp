@@ -29,6 +29,7 @@ DirectoryContext::DirectoryContext(DirectoryInodeRef directory,
   , mChildren()
   , mDirectory(std::move(directory))
   , mLock()
+  , mNames()
   , mParent(mDirectory->parent())
   , mPopulated(false)
 {
@@ -81,10 +82,50 @@ InodeInfo DirectoryContext::get(std::size_t index) const
     if (index < 2)
         info.mName.assign(index + 1, '.');
 
+    // Remember which child this name was reported for.
+    if (index >= 2)
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+
+        mNames[info.mName] = index - 2;
+    }
+
     // Return description to caller.
     return info;
 }
 
+InodeRef DirectoryContext::get(const std::string& name) const
+{
+    InodeRef child;
+
+    // Check if we've reported a child with this name.
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+
+        auto i = mNames.find(name);
+
+        // We haven't reported a child with this name.
+        if (i == mNames.end())
+            return InodeRef();
+
+        child = mChildren[i->second];
+    }
+
+    // Child no longer exists.
+    if (!child || child->removed())
+        return InodeRef();
+
+    // Get our hands on the child's description.
+    auto info = child->info();
+
+    // Child's been moved or renamed since we reported it.
+    if (info.mName != name || info.mParentID != mDirectory->id())
+        return InodeRef();
+
+    // Return child to caller.
+    return child;
+}
+
 InodeRef DirectoryContext::inode() const
 {
     return mDirectory;
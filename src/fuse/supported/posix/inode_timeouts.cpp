@@ -0,0 +1,120 @@
+#include <algorithm>
+
+#include <mega/fuse/platform/constants.h>
+#include <mega/fuse/platform/inode_timeouts.h>
+
+namespace mega
+{
+namespace fuse
+{
+namespace platform
+{
+
+// How many inodes we'll keep history for.
+constexpr std::size_t MaxHistory = 8192;
+
+// Convenience.
+using Seconds = std::chrono::duration<double>;
+
+void InodeTimeouts::prune(Clock::time_point now)
+{
+    // Any inode stable for this long has reached the longest timeout.
+    auto stable = Seconds(std::max(AttributeTimeout, EntryTimeout) * 2);
+
+    // Forget inodes that have been stable for a long time.
+    for (auto i = mHistory.begin(); i != mHistory.end(); )
+    {
+        if (now - i->second.mChanged >= stable)
+            i = mHistory.erase(i);
+        else
+            ++i;
+    }
+
+    // Forget the inode that has been stable the longest if necessary.
+    while (mHistory.size() >= MaxHistory)
+    {
+        auto oldest = std::min_element(mHistory.begin(),
+                                       mHistory.end(),
+                                       [](const auto& lhs, const auto& rhs) {
+                                           return lhs.second.mChanged
+                                                  < rhs.second.mChanged;
+                                       });
+
+        mHistory.erase(oldest);
+    }
+}
+
+double InodeTimeouts::timeout(InodeID id, double maximum) const
+{
+    std::lock_guard<std::mutex> guard(mLock);
+
+    // Has this inode changed recently?
+    auto i = mHistory.find(id);
+
+    // Inode hasn't changed recently.
+    if (i == mHistory.end())
+        return maximum;
+
+    // How long has it been since the inode last changed?
+    auto elapsed = Seconds(Clock::now() - i->second.mChanged).count();
+
+    // Assume the inode will remain stable for about half as long as it
+    // has been stable, or as it usually is, whichever is longer.
+    auto timeout = std::max(elapsed, i->second.mInterval) / 2;
+
+    // Keep the timeout within reasonable bounds.
+    return std::clamp(timeout, MinimumTimeout, maximum);
+}
+
+InodeTimeouts::InodeTimeouts()
+  : mHistory()
+  , mLock()
+{
+}
+
+double InodeTimeouts::attributes(InodeID id) const
+{
+    return timeout(id, AttributeTimeout);
+}
+
+void InodeTimeouts::changed(InodeID id)
+{
+    auto now = Clock::now();
+
+    std::lock_guard<std::mutex> guard(mLock);
+
+    // Has this inode changed before?
+    auto i = mHistory.find(id);
+
+    // Inode's changed before.
+    if (i != mHistory.end())
+    {
+        auto& history = i->second;
+
+        // How long was the inode stable?
+        auto elapsed = Seconds(now - history.mChanged).count();
+
+        // Update the inode's average interval between changes.
+        history.mChanged = now;
+        history.mInterval = (history.mInterval + elapsed) / 2;
+
+        return;
+    }
+
+    // Make sure we don't track too many inodes.
+    if (mHistory.size() >= MaxHistory)
+        prune(now);
+
+    // Start tracking the inode's changes.
+    mHistory.emplace(id, History{now, 0.0});
+}
+
+double InodeTimeouts::entry(InodeID parent) const
+{
+    return timeout(parent, EntryTimeout);
+}
+
+} // platform
+} // fuse
+} // mega
+
@@ -1,10 +1,13 @@
 #include <fcntl.h>
 #include <mntent.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/sysmacros.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <cerrno>
+#include <cstdint>
 
 #include <mega/fuse/common/logging.h>
 #include <mega/fuse/common/mount_result.h>
@@ -13,6 +16,11 @@
 #include <mega/fuse/platform/process.h>
 #include <mega/fuse/platform/utility.h>
 
+// Older kernel headers don't know about cloning.
+#ifndef FUSE_DEV_IOC_CLONE
+#define FUSE_DEV_IOC_CLONE _IOR(229, 0, std::uint32_t)
+#endif // FUSE_DEV_IOC_CLONE
+
 namespace mega
 {
 namespace fuse
@@ -20,6 +28,14 @@ namespace fuse
 namespace platform
 {
 
+static void destroyClone(fuse_chan* channel);
+
+static int receiveClone(fuse_chan** channel, char* buffer, std::size_t size);
+
+static int sendClone(fuse_chan* channel,
+                     const struct iovec vectors[],
+                     std::size_t count);
+
 bool abort(const std::string& path)
 {
     // Clarity.
@@ -81,6 +97,43 @@ bool abort(const std::string& path)
     return true;
 }
 
+fuse_chan* clone(fuse_chan* channel)
+{
+    // How the clone communicates with the kernel.
+    static fuse_chan_ops operations = {
+        /* receive */ &receiveClone,
+        /*    send */ &sendClone,
+        /* destroy */ &destroyClone
+    }; // operations
+
+    // The clone can't block as it shares its queue with other readers.
+    FileDescriptor descriptor(open("/dev/fuse",
+                                   O_CLOEXEC | O_NONBLOCK | O_RDWR));
+
+    // Couldn't open the FUSE device.
+    if (!descriptor)
+        return nullptr;
+
+    // Which connection should the clone share?
+    auto connection = static_cast<std::uint32_t>(fuse_chan_fd(channel));
+
+    // Couldn't attach the clone to the connection.
+    if (ioctl(descriptor.get(), FUSE_DEV_IOC_CLONE, &connection) < 0)
+        return nullptr;
+
+    // Wrap the descriptor in a channel.
+    auto* clone = fuse_chan_new(&operations,
+                                descriptor.get(),
+                                fuse_chan_bufsize(channel),
+                                nullptr);
+
+    // Channel now owns the descriptor.
+    if (clone)
+        static_cast<void>(descriptor.release());
+
+    return clone;
+}
+
 PathVector filesystems(FilesystemPredicate predicate)
 {
     // Convenience.
@@ -197,6 +250,40 @@ catch (std::runtime_error& exception)
     return MOUNT_UNEXPECTED;
 }
 
+void destroyClone(fuse_chan* channel)
+{
+    close(fuse_chan_fd(channel));
+}
+
+int receiveClone(fuse_chan** channel, char* buffer, std::size_t size)
+{
+    while (true)
+    {
+        auto result = read(fuse_chan_fd(*channel), buffer, size);
+
+        // Received a request.
+        if (result >= 0)
+            return static_cast<int>(result);
+
+        // Request was interrupted so it's safe to try again.
+        if (errno == ENOENT)
+            continue;
+
+        return -errno;
+    }
+}
+
+int sendClone(fuse_chan* channel,
+              const struct iovec vectors[],
+              std::size_t count)
+{
+    // Couldn't send the reply.
+    if (writev(fuse_chan_fd(channel), vectors, static_cast<int>(count)) < 0)
+        return -errno;
+
+    return 0;
+}
+
 } // platform
 } // fuse
 } // mega
@@ -11,8 +11,15 @@ namespace fuse
 namespace platform
 {
 
-constexpr auto AttributeTimeout = 120.0;
-constexpr auto EntryTimeout = 120.0;
+// How long may the kernel cache information about a stable inode?
+constexpr auto AttributeTimeout = 3600.0;
+constexpr auto EntryTimeout = 3600.0;
+
+// How long may the kernel cache information about a changing inode?
+constexpr auto MinimumTimeout = 1.0;
+
+// How much data may the kernel transfer in a single read or write?
+constexpr auto MaxTransferSize = 1u << 20;
 
 extern const std::string FilesystemName;
 
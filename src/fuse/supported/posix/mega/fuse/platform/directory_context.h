@@ -1,5 +1,8 @@
 #pragma once
 
+#include <map>
+#include <string>
+
 #include <mega/fuse/common/directory_inode_forward.h>
 #include <mega/fuse/common/ref.h>
 #include <mega/fuse/platform/context.h>
@@ -27,6 +30,9 @@ class DirectoryContext
     // Serializes access to instance members.
     mutable std::mutex mLock;
 
+    // Maps the name of each child we've reported to its index.
+    mutable std::map<std::string, std::size_t> mNames;
+
     // The parent of the directory we're iterating.
     DirectoryInodeRef mParent;
 
@@ -45,6 +51,9 @@ public:
     // Retrieve information about a specific directory entry.
     InodeInfo get(std::size_t index) const;
 
+    // Retrieve a reference to a child we've already reported.
+    InodeRef get(const std::string& name) const;
+
     // What inode does this context represent?
     InodeRef inode() const override;
 
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+#include <mega/fuse/common/inode_id.h>
+#include <mega/fuse/common/inode_id_forward.h>
+
+namespace mega
+{
+namespace fuse
+{
+namespace platform
+{
+
+// Decides how long the kernel may cache an inode's attributes and entries.
+//
+// Inodes that change often are given short timeouts while inodes that
+// haven't changed for a while are given progressively longer timeouts.
+class InodeTimeouts
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Describes how often an inode has changed.
+    struct History
+    {
+        // When did the inode last change?
+        Clock::time_point mChanged;
+
+        // How long, on average, between changes?
+        double mInterval;
+    }; // History
+
+    // Forget the inodes that have been stable for a long time.
+    void prune(Clock::time_point now);
+
+    // How long may the kernel cache information about an inode?
+    double timeout(InodeID id, double maximum) const;
+
+    // Describes how often each inode has changed.
+    FromInodeIDMap<History> mHistory;
+
+    // Serializes access to mHistory.
+    mutable std::mutex mLock;
+
+public:
+    InodeTimeouts();
+
+    // How long may the kernel cache an inode's attributes?
+    double attributes(InodeID id) const;
+
+    // Record that an inode has changed.
+    void changed(InodeID id);
+
+    // How long may the kernel cache a directory's entries?
+    double entry(InodeID parent) const;
+}; // InodeTimeouts
+
+} // platform
+} // fuse
+} // mega
+
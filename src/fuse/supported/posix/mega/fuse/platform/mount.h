@@ -1,18 +1,24 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include <mega/fuse/common/activity_monitor.h>
 #include <mega/fuse/common/inode_forward.h>
 #include <mega/fuse/common/inode_forward.h>
+#include <mega/fuse/common/inode_id_forward.h>
 #include <mega/fuse/common/mount_inode_id_forward.h>
 #include <mega/fuse/common/mount.h>
+#include <mega/fuse/common/operation_monitor.h>
 #include <mega/fuse/common/tags.h>
 #include <mega/fuse/common/task_executor_flags_forward.h>
 #include <mega/fuse/common/task_executor.h>
+#include <mega/fuse/platform/directory_context_forward.h>
 #include <mega/fuse/platform/inode_invalidator.h>
+#include <mega/fuse/platform/inode_timeouts.h>
 #include <mega/fuse/platform/library.h>
 #include <mega/fuse/platform/mount_forward.h>
 #include <mega/fuse/platform/request_forward.h>
@@ -66,6 +72,42 @@ class Mount final
         mExecutor.execute(std::move(wrapper_), spawnWorker);
     }
 
+    // Same as above but records how long the request took to complete.
+    template<typename... Arguments, typename... Parameters>
+    void execute(OperationType type,
+                 void (Mount::*callback)(Parameters...),
+                 bool spawnWorker,
+                 Arguments&&... arguments)
+    {
+        using Callback = std::function<void()>;
+        using Wrapper = std::function<void(const Task&)>;
+
+        // Latency includes the time spent waiting for a worker.
+        auto started = std::chrono::steady_clock::now();
+
+        Callback callback_ =
+          std::bind(callback,
+                    this,
+                    std::forward<Arguments>(arguments)...);
+
+        auto wrapper = [started, type](Activity,
+                                       Callback& callback,
+                                       OperationMonitor& monitor,
+                                       const Task&) {
+            OperationTimer timer(monitor, type, started);
+
+            callback();
+        }; // wrapper
+
+        Wrapper wrapper_ = std::bind(std::move(wrapper),
+                                     mActivities.begin(),
+                                     std::move(callback_),
+                                     std::ref(operations()),
+                                     std::placeholders::_1);
+
+        mExecutor.execute(std::move(wrapper_), spawnWorker);
+    }
+
     void lookup(Request request,
                 MountInodeID parent,
                 const std::string& name);
@@ -99,6 +141,9 @@ class Mount final
                const std::string& name,
                mode_t mode);
 
+    // Where should we record how long our operations take?
+    OperationMonitor& operations() const;
+
     void open(Request request,
               MountInodeID inode,
               fuse_file_info& info);
@@ -158,6 +203,12 @@ class Mount final
     // Tracks whether any requests are in progress.
     ActivityMonitor mActivities;
 
+    // What directories are currently being listed?
+    FromInodeIDMap<DirectoryContextRawPtrSet> mListings;
+
+    // Serializes access to mListings.
+    std::mutex mListingsLock;
+
     // Responsible for performing requests.
     TaskExecutor mExecutor;
 
@@ -167,6 +218,9 @@ class Mount final
     // Responsible for invalidating inodes.
     InodeInvalidator mInvalidator;
 
+    // Decides how long the kernel may cache information about inodes.
+    InodeTimeouts mTimeouts;
+
 public:
     Mount(const MountInfo& info,
           MountDB& mountDB);
@@ -40,6 +40,8 @@ public:
 
     void replyBuffer(const std::string& buffer);
 
+    void replyData(int descriptor, off_t offset, std::size_t size);
+
     void replyEntry(const struct fuse_entry_param& entry);
 
     void replyError(int error);
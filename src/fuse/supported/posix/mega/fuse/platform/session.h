@@ -1,12 +1,16 @@
 #pragma once
 
+#include <cstddef>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <mega/fuse/common/mount_inode_id.h>
 #include <mega/fuse/platform/library.h>
 #include <mega/fuse/platform/mount_forward.h>
 #include <mega/fuse/platform/session_forward.h>
+#include <mega/fuse/platform/signal.h>
 
 namespace mega
 {
@@ -118,11 +122,21 @@ class Session
                       off_t offset,
                       fuse_file_info* info);
 
+    // Reads and dispatches requests from a clone of our channel.
+    void loop(fuse_chan* channel);
+
     fuse_chan* mChannel;
+
+    // Threads reading requests from clones of our channel.
+    std::vector<std::thread> mDispatchers;
+
     Mount& mMount;
     static const fuse_lowlevel_ops mOperations;
     fuse_session* mSession;
 
+    // Signalled when our dispatchers should terminate.
+    Signal mTerminate;
+
 public:
     Session(Mount& mount);
 
@@ -159,7 +173,17 @@ public:
                          MountInodeID parent);
 
     // Retrieve the next request from FUSE.
+    //
+    // Returns an empty string if another thread took the request.
     std::string nextRequest();
+
+    // Read requests from count threads rather than just one.
+    //
+    // The extra threads read from clones of our channel.
+    void startDispatchers(std::size_t count);
+
+    // Stop any threads started by startDispatchers.
+    void stopDispatchers();
 }; // Session
 
 } // platform
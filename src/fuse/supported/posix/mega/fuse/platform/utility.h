@@ -24,6 +24,11 @@ using PathVector = std::vector<std::string>;
 
 bool abort(const std::string& path);
 
+// Create a channel that shares a FUSE connection with channel.
+//
+// Returns nullptr, with errno set, if the platform can't clone channels.
+fuse_chan* clone(fuse_chan* channel);
+
 PathVector filesystems(FilesystemPredicate predicate = nullptr);
 
 FileDescriptorPair pipe(bool closeReaderOnFork,
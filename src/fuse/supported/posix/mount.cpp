@@ -25,6 +25,8 @@
 #include <mega/fuse/platform/service_context.h>
 #include <mega/fuse/platform/utility.h>
 
+#include "megafs.h"
+
 namespace mega
 {
 namespace fuse
@@ -51,9 +53,6 @@ void Mount::access(Request request,
     if (mask == F_OK)
         return request.replyOk();
 
-    // What are we allowed to do with this inode?
-    auto permissions = ref->permissions();
-
     // Only directories are executable.
     if ((mask & X_OK) && ref->file())
         return request.replyError(EACCES);
@@ -62,8 +61,15 @@ void Mount::access(Request request,
     if (!(mask & W_OK))
         return request.replyOk();
 
+    // Nothing's writable on a read-only mount.
+    //
+    // Checked first as learning the inode's permissions means
+    // describing it which involves both the Inode DB and the client.
+    if (!writable())
+        return request.replyError(EROFS);
+
     // Inode's writable.
-    if (permissions == FULL && writable())
+    if (ref->permissions() == FULL)
         return request.replyOk();
 
     // Inode or mount is read-only.
@@ -140,7 +146,35 @@ void Mount::lookup(Request request,
     if (name.size() > MaxNameLength)
         return request.replyError(ENAMETOOLONG);
 
-    auto childRef = directoryRef->get(name);
+    // Check if the child was reported by a listing of its parent.
+    //
+    // When listing a directory, the kernel will follow up with a lookup
+    // for each entry we've reported. Answering those lookups from the
+    // listing saves us from querying the cloud and the inode database
+    // again for every entry.
+    auto childRef = ([&]() {
+        std::lock_guard<std::mutex> guard(mListingsLock);
+
+        auto i = mListings.find(directoryRef->id());
+
+        // Parent isn't being listed.
+        if (i == mListings.end())
+            return InodeRef();
+
+        // Check if any of the listings reported this child.
+        for (auto* context : i->second)
+        {
+            if (auto child = context->get(name))
+                return child;
+        }
+
+        // Child wasn't reported by any listing.
+        return InodeRef();
+    })();
+
+    // Child wasn't reported by a listing so look it up the usual way.
+    if (!childRef)
+        childRef = directoryRef->get(name);
 
     // Child doesn't exist.
     if (!childRef)
@@ -158,11 +192,12 @@ void Mount::lookup(Request request,
 
     std::memset(&entry, 0, sizeof(entry));
 
-    entry.attr_timeout = AttributeTimeout;
-    entry.entry_timeout = EntryTimeout;
-
     translate(entry, map(info.mID), info);
 
+    // Let the kernel cache the entry for as long as it's likely stable.
+    entry.attr_timeout = mTimeouts.attributes(info.mID);
+    entry.entry_timeout = mTimeouts.entry(directoryRef->id());
+
     request.replyEntry(entry);
 }
 
@@ -243,7 +278,7 @@ void Mount::getattr(Request request,
 
     translate(attributes, inode, info);
 
-    request.replyAttributes(attributes, AttributeTimeout);
+    request.replyAttributes(attributes, mTimeouts.attributes(info.mID));
 }
 
 void Mount::mkdir(Request request,
@@ -297,6 +332,10 @@ void Mount::mknod(Request request,
 
     translate(entry, MountInodeID(info.mID), info);
 
+    // Decide how long the kernel may cache the new entry.
+    entry.attr_timeout = mTimeouts.attributes(info.mID);
+    entry.entry_timeout = mTimeouts.entry(directoryRef->id());
+
     // Pin inode in memory.
     pin(std::move(std::get<0>(*result)), info);
 
@@ -304,6 +343,11 @@ void Mount::mknod(Request request,
     request.replyEntry(entry);
 }
 
+OperationMonitor& Mount::operations() const
+{
+    return mMountDB.mContext.mOperationMonitor;
+}
+
 void Mount::open(Request request,
                  MountInodeID inode,
                  fuse_file_info& info)
@@ -392,10 +436,20 @@ void Mount::opendir(Request request,
     if (!directoryRef)
         return request.replyError(ENOTDIR);
 
+    // Convenience.
+    auto id = directoryRef->id();
+
     // Instantiate directory iterator context.
     auto context =
       std::make_unique<DirectoryContext>(std::move(directoryRef), *this);
 
+    // Let lookups know that this directory's being listed.
+    {
+        std::lock_guard<std::mutex> guard(mListingsLock);
+
+        mListings[id].emplace(context.get());
+    }
+
     // Pass context to FUSE.
     info.fh = reinterpret_cast<std::uint64_t>(context.get());
 
@@ -417,15 +471,36 @@ void Mount::read(Request request,
     // Sanity.
     assert(context);
 
+    // Have we passed any content to FUSE?
+    auto replied = false;
+
+    // Pass the file's descriptor to FUSE so it needn't be copied.
+    auto reply = [&](FileAccess& fileAccess,
+                     m_off_t offset,
+                     unsigned int size) {
+        auto& fileAccess_ = static_cast<PosixFileAccess&>(fileAccess);
+
+        request.replyData(fileAccess_.fileDescriptor(),
+                          static_cast<off_t>(offset),
+                          size);
+
+        replied = true;
+
+        return Error(API_OK);
+    }; // reply
+
     // Try and read the file.
-    auto result = context->read(offset, static_cast<unsigned int>(size));
+    auto result = context->read(offset,
+                                static_cast<unsigned int>(size),
+                                reply);
 
     // Couldn't read the file.
-    if (!result)
-        return request.replyError(translate(result.error()));
+    if (result != API_OK)
+        return request.replyError(translate(result));
 
-    // Pass read data to FUSE.
-    request.replyBuffer(std::move(*result));
+    // Caller's hit the end of the file.
+    if (!replied)
+        request.replyBuffer(std::string());
 }
 
 void Mount::readdir(Request request,
@@ -508,6 +583,21 @@ void Mount::releasedir(Request request,
     // Sanity.
     assert(context);
 
+    // Make sure lookups no longer consult this context.
+    {
+        std::lock_guard<std::mutex> guard(mListingsLock);
+
+        auto i = mListings.find(context->inode()->id());
+
+        // Forget the context.
+        if (i != mListings.end())
+            i->second.erase(context);
+
+        // Directory's no longer being listed.
+        if (i != mListings.end() && i->second.empty())
+            mListings.erase(i);
+    }
+
     // Release context.
     delete context;
 
@@ -687,7 +777,7 @@ void Mount::setattr(Request request,
     translate(attributes, inode, ref->info());
 
     // Forward description to userspace.
-    request.replyAttributes(attributes, AttributeTimeout);
+    request.replyAttributes(attributes, mTimeouts.attributes(ref->id()));
 }
 
 void Mount::statfs(Request request, MountInodeID inode)
@@ -781,19 +871,28 @@ void Mount::write(Request request,
 Mount::Mount(const MountInfo& info, MountDB& mountDB)
   : fuse::Mount(info, mountDB)
   , mActivities()
+  , mListings()
+  , mListingsLock()
   , mExecutor(mountDB.executorFlags())
   , mSession(*this)
   , mInvalidator(mSession)
+  , mTimeouts()
 {
     // Let the database know a new session has been added.
     mMountDB.sessionAdded(mSession);
 
+    // Read requests from additional threads if requested.
+    mSession.startDispatchers(mountDB.executorFlags().mDispatchThreads);
+
     FUSEDebugF("Mount constructed: %s",
                path().toPath(false).c_str());
 }
 
 Mount::~Mount()
 {
+    // Make sure no other thread's dispatching requests.
+    mSession.stopDispatchers();
+
     // Let the database know that a session is being removed.
     mMountDB.sessionRemoved(mSession);
 
@@ -819,11 +918,15 @@ void Mount::executorFlags(const TaskExecutorFlags& flags)
 
 void Mount::invalidateAttributes(InodeID id)
 {
+    mTimeouts.changed(id);
+
     mInvalidator.invalidateAttributes(mActivities, map(id));
 }
 
 void Mount::invalidateData(InodeID id, m_off_t offset, m_off_t size)
 {
+    mTimeouts.changed(id);
+
     mInvalidator.invalidateData(mActivities, map(id), offset, size);
 }
 
@@ -839,6 +942,8 @@ void Mount::invalidateEntry(const std::string& name,
     assert(child);
     assert(parent);
 
+    mTimeouts.changed(parent);
+
     mInvalidator.invalidateEntry(mActivities,
                                  map(child),
                                  name,
@@ -849,6 +954,8 @@ void Mount::invalidateEntry(const std::string& name, InodeID parent)
 {
     assert(parent);
 
+    mTimeouts.changed(parent);
+
     mInvalidator.invalidateEntry(mActivities, map(parent), name);
 }
 
@@ -101,6 +101,21 @@ void Request::replyBuffer(const std::string& buffer)
     });
 }
 
+void Request::replyData(int descriptor, off_t offset, std::size_t size)
+{
+    reply([&](fuse_req_t request) {
+        auto buffer = FUSE_BUFVEC_INIT(size);
+
+        // Let FUSE read (or splice) the content from the descriptor.
+        buffer.buf[0].fd = descriptor;
+        buffer.buf[0].flags =
+          static_cast<fuse_buf_flags>(FUSE_BUF_IS_FD | FUSE_BUF_FD_SEEK);
+        buffer.buf[0].pos = offset;
+
+        return fuse_reply_data(request, &buffer, FUSE_BUF_SPLICE_MOVE);
+    });
+}
+
 void Request::replyEntry(const struct fuse_entry_param& entry)
 {
     reply([&](fuse_req_t request) {
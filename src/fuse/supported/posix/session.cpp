@@ -1,4 +1,8 @@
+#include <fcntl.h>
+#include <poll.h>
+
 #include <cassert>
+#include <cerrno>
 #include <cstring>
 #include <vector>
 
@@ -13,6 +17,7 @@
 #include <mega/fuse/platform/request.h>
 #include <mega/fuse/platform/service_context.h>
 #include <mega/fuse/platform/session.h>
+#include <mega/fuse/platform/utility.h>
 
 namespace mega
 {
@@ -117,6 +122,15 @@ void Session::init(void*, fuse_conn_info* connection)
 
     connection->want |= FUSE_CAP_ATOMIC_O_TRUNC;
 
+    // Don't have the kernel split writes into single pages.
+    connection->want |= connection->capable & FUSE_CAP_BIG_WRITES;
+
+    // Libfuse clamps this to the size of its request buffer.
+    connection->max_write = MaxTransferSize;
+
+    // Let reads be spliced from the cache's files when possible.
+    connection->want |= connection->capable & FUSE_CAP_SPLICE_WRITE;
+
     for (auto& entry : capabilities)
     {
         auto capable = (connection->capable & entry.second) > 0;
@@ -137,7 +151,8 @@ void Session::lookup(fuse_req_t request,
                name,
                request);
 
-    mount(request).execute(&Mount::lookup,
+    mount(request).execute(OT_LOOKUP,
+                           &Mount::lookup,
                            true,
                            Request(request),
                            parent_,
@@ -154,7 +169,8 @@ void Session::flush(fuse_req_t request,
                toString(inode_).c_str(),
                request);
 
-    mount(request).execute(&Mount::flush,
+    mount(request).execute(OT_FLUSH,
+                           &Mount::flush,
                            true,
                            Request(request),
                            inode_,
@@ -226,7 +242,8 @@ void Session::getattr(fuse_req_t request,
                toString(inode_).c_str(),
                request);
 
-    mount(request).execute(&Mount::getattr,
+    mount(request).execute(OT_GETATTR,
+                           &Mount::getattr,
                            true,
                            Request(request),
                            inode_);
@@ -324,7 +341,8 @@ void Session::read(fuse_req_t request,
                request,
                size);
 
-    mount(request).execute(&Mount::read,
+    mount(request).execute(OT_READ,
+                           &Mount::read,
                            true,
                            Request(request),
                            inode_,
@@ -348,7 +366,8 @@ void Session::readdir(fuse_req_t request,
                size,
                request);
 
-    mount(request).execute(&Mount::readdir,
+    mount(request).execute(OT_READDIR,
+                           &Mount::readdir,
                            true,
                            Request(request),
                            inode_,
@@ -523,7 +542,8 @@ void Session::write(fuse_req_t request,
                request,
                size);
 
-    mount(request).execute(&Mount::write,
+    mount(request).execute(OT_WRITE,
+                           &Mount::write,
                            true,
                            Request(request),
                            inode_,
@@ -534,8 +554,10 @@ void Session::write(fuse_req_t request,
 
 Session::Session(Mount& mount)
   : mChannel(nullptr)
+  , mDispatchers()
   , mMount(mount)
   , mSession(nullptr)
+  , mTerminate("Terminate")
 {
     std::vector<char*> pointers;
     std::vector<std::string> values;
@@ -549,6 +571,9 @@ Session::Session(Mount& mount)
     LINUX_ONLY(values.emplace_back("-ononempty"));
     POSIX_ONLY(values.emplace_back("-ovolname=" + mMount.name()));
 
+    // Let macFUSE issue larger reads and writes.
+    POSIX_ONLY(values.emplace_back(format("-oiosize=%u", MaxTransferSize)));
+
     for (auto& value : values)
         pointers.emplace_back(&value[0]);
 
@@ -586,6 +611,7 @@ Session::Session(Mount& mount)
 Session::~Session()
 {
     assert(mChannel);
+    assert(mDispatchers.empty());
     assert(mSession);
 
     fuse_session_remove_chan(mChannel);
@@ -727,6 +753,64 @@ void Session::invalidateEntry(const std::string& name, MountInodeID parent)
     }
 }
 
+void Session::loop(fuse_chan* channel)
+{
+    assert(channel);
+    assert(mSession);
+
+    std::string buffer(fuse_chan_bufsize(channel), '\0');
+
+    // Wake up when a request arrives or when we need to terminate.
+    struct pollfd descriptors[] = {
+        {fuse_chan_fd(channel), POLLIN, 0},
+        {mTerminate.descriptor(), POLLIN, 0}
+    }; // descriptors
+
+    while (!fuse_session_exited(mSession))
+    {
+        auto result = poll(descriptors, 2, -1);
+
+        // Call was interrupted.
+        if (result < 0 && errno == EINTR)
+            continue;
+
+        if (result < 0)
+        {
+            FUSEErrorF("Unexpected error waiting for requests: %s",
+                       std::strerror(errno));
+            break;
+        }
+
+        // We've been asked to terminate.
+        if (descriptors[1].revents)
+            break;
+
+        // Channel hasn't received a request.
+        if (!descriptors[0].revents)
+            continue;
+
+        auto* channel_ = channel;
+
+        result = fuse_chan_recv(&channel_, &buffer[0], buffer.size());
+
+        // Another thread took the request.
+        if (result == -EAGAIN || result == -EINTR)
+            continue;
+
+        // Connection's been closed.
+        if (result <= 0)
+            break;
+
+        // Dispatch the request.
+        fuse_session_process(mSession,
+                             buffer.data(),
+                             static_cast<std::size_t>(result),
+                             channel);
+    }
+
+    fuse_chan_destroy(channel);
+}
+
 std::string Session::nextRequest()
 {
     assert(mChannel);
@@ -741,6 +825,10 @@ std::string Session::nextRequest()
         if (!result)
             return std::string();
 
+        // Another thread took the request.
+        if (result == -EAGAIN)
+            return std::string();
+
         if (result > 0)
         {
             buffer.resize(static_cast<std::size_t>(result));
@@ -755,6 +843,66 @@ std::string Session::nextRequest()
     }
 }
 
+void Session::startDispatchers(std::size_t count)
+{
+    assert(mChannel);
+    assert(mDispatchers.empty());
+
+    // Spawn a thread for each additional dispatcher.
+    for (auto i = 1u; i < count; ++i)
+    {
+        auto* clone = platform::clone(mChannel);
+
+        // Platform or kernel can't clone channels.
+        if (!clone)
+        {
+            FUSEWarningF("Unable to clone channel: %s",
+                         std::strerror(errno));
+            break;
+        }
+
+        mDispatchers.emplace_back(&Session::loop, this, clone);
+    }
+
+    // Only one thread is reading from our channel.
+    if (mDispatchers.empty())
+        return;
+
+    // Requests are shared so our channel mustn't block.
+    auto descriptor = fuse_chan_fd(mChannel);
+    auto flags = fcntl(descriptor, F_GETFL);
+
+    // Fall back to a single reader rather than risk blocking.
+    if (flags < 0 || fcntl(descriptor, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        FUSEWarningF("Unable to make channel nonblocking: %s",
+                     std::strerror(errno));
+
+        return stopDispatchers();
+    }
+
+    FUSEDebugF("Reading requests with %zu thread(s): %s",
+               mDispatchers.size() + 1,
+               mMount.path().toPath(false).c_str());
+}
+
+void Session::stopDispatchers()
+{
+    // No dispatchers are running.
+    if (mDispatchers.empty())
+        return;
+
+    // Let the dispatchers know they should terminate.
+    mTerminate.raise();
+
+    // Wait for them to terminate.
+    for (auto& dispatcher : mDispatchers)
+        dispatcher.join();
+
+    mDispatchers.clear();
+    mTerminate.clear();
+}
+
 Mount& mount(fuse_req_t request)
 {
     return mount(fuse_req_userdata(request));
@@ -4,6 +4,10 @@
 #include <mega/fuse/common/client.h>
 #include <mega/fuse/common/database_builder.h>
 #include <mega/fuse/common/error_or.h>
+#include <mega/fuse/common/file_cache_statistics.h>
+#include <mega/fuse/common/file_info.h>
+#include <mega/fuse/common/file_inode.h>
+#include <mega/fuse/common/inode_cache_statistics.h>
 #include <mega/fuse/common/inode_info.h>
 #include <mega/fuse/common/inode.h>
 #include <mega/fuse/common/mount_info.h>
@@ -32,6 +36,7 @@ static LocalPath dbPath(const Client& client);
 
 ServiceContext::ServiceContext(const ServiceFlags& flags, Service& service)
   : fuse::ServiceContext(service)
+  , mOperationMonitor()
   , mDatabase(dbInit(service.mClient))
   , mExecutor(flags.mServiceExecutorFlags)
   , mFileExtensionDB()
@@ -90,6 +95,36 @@ bool ServiceContext::cached(NormalizedPath path) const
     return result.first->cached();
 }
 
+ErrorOr<LocalPath> ServiceContext::cachedContent(NodeHandle handle,
+                                                 m_time_t modified,
+                                                 m_off_t size) const
+{
+    // Is there a file inode associated with this node?
+    auto inode = mInodeDB.get(handle);
+    auto file = inode ? inode->file() : FileInodeRef();
+
+    // Local changes haven't been flushed to the cloud yet.
+    if (!file || file->wasModified())
+        return API_ENOENT;
+
+    // Is the file's complete content in the cache?
+    auto info = file->fileInfo();
+
+    if (!info)
+        return API_ENOENT;
+
+    m_time_t cachedModified;
+    m_off_t cachedSize;
+
+    info->get(cachedModified, cachedSize);
+
+    // The cached content belongs to some other version of the file.
+    if (cachedModified != modified || cachedSize != size)
+        return API_ENOENT;
+
+    return info->path();
+}
+
 void ServiceContext::current()
 {
     mMountDB.current();
@@ -165,6 +200,16 @@ Task ServiceContext::execute(std::function<void(const Task&)> function)
     return mExecutor.execute(std::move(function), true);
 }
 
+TaskExecutorStatistics ServiceContext::executorStatistics() const
+{
+    return mExecutor.statistics();
+}
+
+FileCacheStatistics ServiceContext::fileCacheStatistics() const
+{
+    return mFileCache.statistics();
+}
+
 MountResult ServiceContext::flags(const LocalPath& path,
                                   const MountFlags& flags)
 {
@@ -191,6 +236,16 @@ MountInfoVector ServiceContext::get(bool enabled) const
     return mMountDB.get(enabled);
 }
 
+InodeCacheStatistics ServiceContext::inodeCacheStatistics() const
+{
+    return mInodeCache.statistics();
+}
+
+OperationStatistics ServiceContext::operationStatistics() const
+{
+    return mOperationMonitor.statistics();
+}
+
 NormalizedPathVector ServiceContext::paths(const std::string& name) const
 {
     return mMountDB.paths(name);
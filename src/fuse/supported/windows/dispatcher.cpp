@@ -2,6 +2,7 @@
 #include <cstring>
 
 #include <mega/fuse/common/logging.h>
+#include <mega/fuse/common/operation_monitor.h>
 #include <mega/fuse/platform/constants.h>
 #include <mega/fuse/platform/dispatcher.h>
 #include <mega/fuse/platform/mount_db.h>
@@ -194,6 +195,9 @@ NTSTATUS Dispatcher::flush(FSP_FILE_SYSTEM* filesystem,
 
     auto& dispatcher = platform::dispatcher(*filesystem);
 
+    // Record how long this request takes.
+    OperationTimer timer(dispatcher.mMount.operations(), OT_FLUSH);
+
     FUSEDebugF("flush: context: %p, info: %p",
                context,
                info);
@@ -216,6 +220,9 @@ NTSTATUS Dispatcher::getDirInfoByName(FSP_FILE_SYSTEM* filesystem,
     assert(info);
 
     auto& dispatcher = platform::dispatcher(*filesystem);
+
+    // Record how long this request takes.
+    OperationTimer timer(dispatcher.mMount.operations(), OT_LOOKUP);
     auto path_ = normalize(&path[1]);
 
     FUSEDebugF("getDirInfoByName: context: %p, path: %s, info: %p",
@@ -240,6 +247,9 @@ NTSTATUS Dispatcher::getFileInfo(FSP_FILE_SYSTEM* filesystem,
 
     auto& dispatcher = platform::dispatcher(*filesystem);
 
+    // Record how long this request takes.
+    OperationTimer timer(dispatcher.mMount.operations(), OT_GETATTR);
+
     FUSEDebugF("getFileInfo: context: %p, info: %p",
                context,
                info);
@@ -611,6 +621,7 @@ Dispatcher::Dispatcher(Mount& mount)
     parameters.FlushAndPurgeOnCleanup = true;
     parameters.MaxComponentLength = MaxNameLength;
     parameters.PersistentAcls = true;
+    parameters.PostCleanupWhenModifiedOnly = true;
     parameters.ReadOnlyVolume = !mount.writable();
     parameters.SectorSize = 512;
     parameters.FileInfoTimeout = 128;
@@ -7,6 +7,7 @@
 #include <mega/fuse/common/inode_info_forward.h>
 #include <mega/fuse/common/mount.h>
 #include <mega/fuse/common/mount_result_forward.h>
+#include <mega/fuse/common/operation_monitor_forward.h>
 #include <mega/fuse/common/task_executor.h>
 #include <mega/fuse/platform/context_forward.h>
 #include <mega/fuse/platform/dispatcher.h>
@@ -67,6 +68,9 @@ class Mount
     // For convenience.
     InodeDB& inodeDB() const;
 
+    // Where should we record how long requests take?
+    OperationMonitor& operations() const;
+
     NTSTATUS open(const std::wstring& path,
                   UINT32 options,
                   UINT32 access,
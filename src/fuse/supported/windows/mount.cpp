@@ -1,3 +1,4 @@
+#include <chrono>
 #include <cstring>
 
 #include <mega/fuse/common/client.h>
@@ -12,6 +13,7 @@
 #include <mega/fuse/common/mount_inode_id.h>
 #include <mega/fuse/common/mount_result.h>
 #include <mega/fuse/common/node_info.h>
+#include <mega/fuse/common/operation_monitor.h>
 #include <mega/fuse/common/ref.h>
 #include <mega/fuse/platform/context.h>
 #include <mega/fuse/platform/date_time.h>
@@ -376,6 +378,11 @@ InodeDB& Mount::inodeDB() const
     return mMountDB.mContext.mInodeDB;
 }
 
+OperationMonitor& Mount::operations() const
+{
+    return mMountDB.mContext.mOperationMonitor;
+}
+
 NTSTATUS Mount::open(const std::wstring& path,
                      UINT32 options,
                      UINT32 access,
@@ -487,9 +494,15 @@ NTSTATUS Mount::read(PVOID context, PVOID buffer, UINT64 offset, ULONG length, U
     // Get our hands on the request's "hint."
     auto hint = mDispatcher.request().Hint;
 
+    // When did we receive this request?
+    auto started = std::chrono::steady_clock::now();
+
     // Actually reads the file.
     auto read = [=](Activity&, const Task&)
     {
+        // Record how long this request takes.
+        OperationTimer timer(operations(), OT_READ, started);
+
         auto response = std::make_unique<FSP_FSCTL_TRANSACT_RSP>();
 
         std::memset(response.get(), 0, sizeof(response));
@@ -499,23 +512,37 @@ NTSTATUS Mount::read(PVOID context, PVOID buffer, UINT64 offset, ULONG length, U
         response->Kind = FspFsctlTransactReadKind;
         response->Size = sizeof(*response);
 
+        // Reads the file's content directly into the user's buffer.
+        auto populate = [&](FileAccess& fileAccess,
+                            m_off_t offset,
+                            unsigned int size) {
+            // Couldn't read the file's content.
+            if (!fileAccess.frawread(static_cast<byte*>(buffer),
+                                     size,
+                                     offset,
+                                     true,
+                                     FSLogging::logOnError))
+                return Error(API_EREAD);
+
+            // Let the caller know how much data was read.
+            response->IoStatus.Information = static_cast<ULONG>(size);
+
+            return Error(API_OK);
+        }; // populate
+
         // Try and read the file.
-        auto result = context_->read(static_cast<m_off_t>(offset), length);
+        auto result = context_->read(static_cast<m_off_t>(offset),
+                                     length,
+                                     populate);
 
         // Couldn't read the file.
-        if (!result)
-            return mDispatcher.reply(*response, result.error());
-
-        // Let the caller know how much data was read.
-        response->IoStatus.Information = static_cast<ULONG>(result->size());
+        if (result != API_OK)
+            return mDispatcher.reply(*response, result);
 
         // Caller's hit the end of the file.
         if (!response->IoStatus.Information)
             return mDispatcher.reply(*response, STATUS_END_OF_FILE);
 
-        // Populate user's buffer.
-        std::memcpy(buffer, result->c_str(), result->size());
-
         // Let the caller know their read has been successful.
         mDispatcher.reply(*response, STATUS_SUCCESS);
     }; // read
@@ -543,8 +570,14 @@ NTSTATUS Mount::readDirectory(PVOID context,
     // Get our hands on the request's "hint."
     auto hint = mDispatcher.request().Hint;
 
+    // When did we receive this request?
+    auto started = std::chrono::steady_clock::now();
+
     // Actually reads the directory.
     auto read = [=](Activity&, const Task&) {
+        // Record how long this request takes.
+        OperationTimer timer(operations(), OT_READDIR, started);
+
         auto numWritten = 0ul;
         auto response = std::make_unique<FSP_FSCTL_TRANSACT_RSP>();
 
@@ -783,6 +816,9 @@ NTSTATUS Mount::write(PVOID context,
     // Get our hands on the request's "hint."
     auto hint = mDispatcher.request().Hint;
 
+    // When did we receive this request?
+    auto started = std::chrono::steady_clock::now();
+
     // Convenience.
     auto length_ = static_cast<m_off_t>(length);
     auto offset_ = static_cast<m_off_t>(offset);
@@ -793,6 +829,9 @@ NTSTATUS Mount::write(PVOID context,
 
     // Actually perform the write.
     auto write = [=](Activity&, const Task&) {
+        // Record how long this request takes.
+        OperationTimer timer(operations(), OT_WRITE, started);
+
         auto response = std::make_unique<FSP_FSCTL_TRANSACT_RSP>();
 
         // Prepare for response.
@@ -24,6 +24,11 @@ public:
     // Check if a file exists in the cache.
     bool cached(NormalizedPath path) const override;
 
+    // Where is a file's complete content in the cache?
+    ErrorOr<LocalPath> cachedContent(NodeHandle handle,
+                                     m_time_t modified,
+                                     m_off_t size) const override;
+
     // Called by the client when its view of the cloud is current.
     void current() override;
 
@@ -52,6 +57,12 @@ public:
     // Execute a function on some task.
     Task execute(std::function<void(const Task&)> function) override;
 
+    // How long have the service's tasks had to wait?
+    TaskExecutorStatistics executorStatistics() const override;
+
+    // How effective has the file cache been?
+    FileCacheStatistics fileCacheStatistics() const override;
+
     // Update a mount's flags.
     MountResult flags(const LocalPath& path,
                       const MountFlags& flags) override;
@@ -65,6 +76,12 @@ public:
     // Describe all (enabled) mounts.
     MountInfoVector get(bool enabled) const override;
 
+    // How effective has the inode cache been?
+    InodeCacheStatistics inodeCacheStatistics() const override;
+
+    // How long have the service's operations taken?
+    OperationStatistics operationStatistics() const override;
+
     // Retrieve the path of all mounts associated with this name.
     NormalizedPathVector paths(const std::string& name) const override;
 
@@ -1,12 +1,16 @@
 #include <mega/fuse/common/client.h>
 #include <mega/fuse/common/error_or.h>
+#include <mega/fuse/common/file_cache_statistics.h>
+#include <mega/fuse/common/inode_cache_statistics.h>
 #include <mega/fuse/common/inode_info.h>
 #include <mega/fuse/common/mount_event_type.h>
 #include <mega/fuse/common/mount_event.h>
 #include <mega/fuse/common/mount_info.h>
 #include <mega/fuse/common/mount_result.h>
 #include <mega/fuse/common/normalized_path.h>
+#include <mega/fuse/common/operation_statistics.h>
 #include <mega/fuse/common/service.h>
+#include <mega/fuse/common/task_executor_statistics.h>
 #include <mega/fuse/common/task_queue.h>
 #include <mega/fuse/platform/service_context.h>
 
@@ -36,6 +40,11 @@ bool ServiceContext::cached(NormalizedPath) const
     return false;
 }
 
+ErrorOr<LocalPath> ServiceContext::cachedContent(NodeHandle, m_time_t, m_off_t) const
+{
+    return API_ENOENT;
+}
+
 void ServiceContext::current()
 {
 }
@@ -89,6 +98,16 @@ Task ServiceContext::execute(std::function<void(const Task&)> function)
     return task;
 }
 
+TaskExecutorStatistics ServiceContext::executorStatistics() const
+{
+    return TaskExecutorStatistics();
+}
+
+FileCacheStatistics ServiceContext::fileCacheStatistics() const
+{
+    return FileCacheStatistics();
+}
+
 MountResult ServiceContext::flags(const LocalPath&, const MountFlags&)
 {
     return MOUNT_UNKNOWN;
@@ -109,6 +128,16 @@ MountInfoVector ServiceContext::get(bool) const
     return MountInfoVector();
 }
 
+InodeCacheStatistics ServiceContext::inodeCacheStatistics() const
+{
+    return InodeCacheStatistics();
+}
+
+OperationStatistics ServiceContext::operationStatistics() const
+{
+    return OperationStatistics();
+}
+
 NormalizedPathVector ServiceContext::paths(const std::string&) const
 {
     return NormalizedPathVector();
@@ -23,6 +23,7 @@
 #include "mega/gfx.h"
 #include "mega/logging.h"
 #include "mega/gfx/GfxProcCG.h"
+#include <algorithm>
 #include <numeric>
 #include <tuple>
 
@@ -115,13 +116,6 @@ bool GfxProc::isvideo(const LocalPath& localfilename)
     return false;
 }
 
-void *GfxProc::threadEntryPoint(void *param)
-{
-    GfxProc* gfxProcessor = (GfxProc*)param;
-    gfxProcessor->loop();
-    return NULL;
-}
-
 std::vector<GfxDimension> GfxProc::getJobDimensions(GfxJob *job)
 {
     std::vector<GfxDimension> jobDimensions;
@@ -134,50 +128,125 @@ std::vector<GfxDimension> GfxProc::getJobDimensions(GfxJob *job)
     return jobDimensions;
 }
 
-void GfxProc::loop()
+void GfxProc::loop(IGfxProvider* provider)
 {
-    GfxJob *job = NULL;
+    size_t batchSize = std::max<size_t>(1, (provider ? provider : mGfxProvider.get())->maxBatchSize());
+
     while (!finished)
     {
-        waiter.init(NEVER);
-        waiter.wait();
-        while ((job = requests.pop()))
+        // as many queued jobs as the provider takes at once
+        std::vector<GfxJob*> jobs;
+        {
+            std::unique_lock<std::mutex> g(mWorkMutex);
+            mWorkAvailable.wait(g, [&]() {
+                for (GfxJob* job; jobs.size() < batchSize && (job = requests.pop()); )
+                {
+                    jobs.push_back(job);
+                }
+                return finished || !jobs.empty();
+            });
+        }
+
+        if (finished)
         {
-            if (finished)
+            for (auto job : jobs)
             {
                 delete job;
-                break;
             }
+            break;
+        }
 
-            LOG_debug << "Processing media file: " << job->h;
+        process(jobs, provider);
+    }
+}
 
-            auto images = generateImages(job->localfilename, getJobDimensions(job));
-            for (auto& image : images)
-            {
-                string* jpeg = image.empty() ? nullptr : new string(std::move(image));
-                job->images.push_back(jpeg);
-            }
+void GfxProc::processSharedTurn()
+{
+    size_t batchSize = std::max<size_t>(1, mGfxProvider->maxBatchSize());
 
-            responses.push(job);
-            client->waiter->notify();
-        }
+    std::vector<GfxJob*> jobs;
+    for (GfxJob* job; jobs.size() < batchSize && (job = requests.pop()); )
+    {
+        jobs.push_back(job);
     }
 
-    while ((job = requests.pop()))
+    // an earlier turn may have taken our jobs in its batch
+    if (!jobs.empty())
     {
-        delete job;
+        process(jobs, nullptr);
     }
+}
 
-    while ((job = responses.pop()))
+void GfxProc::process(const std::vector<GfxJob*>& jobs, IGfxProvider* provider)
+{
+    std::vector<IGfxProvider::BatchEntry> entries;
+    for (auto job : jobs)
     {
-        for (unsigned i = 0; i < job->imagetypes.size(); i++)
+        LOG_debug << "Processing media file: " << job->h;
+        entries.emplace_back(job->localfilename, getJobDimensions(job));
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    std::vector<bool> reported(jobs.size());
+
+    auto result = [&](size_t index, std::vector<std::string>&& images)
+    {
+        assert(index < jobs.size() && !reported[index]);
+        if (index >= jobs.size() || reported[index])
         {
-            delete job->images[i];
+            return;
+        }
+        reported[index] = true;
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+        {
+            std::lock_guard<std::mutex> g(mStatisticsMutex);
+            ++mStatistics.jobs;
+            mStatistics.totalTime += elapsed;
+            mStatistics.maxTime = std::max(mStatistics.maxTime, elapsed);
+        }
+
+        GfxJob* job = jobs[index];
+        LOG_debug << "Processed media file: " << job->h << " in " << elapsed.count() << " ms";
+
+        images.resize(entries[index].second.size());
+        for (auto& image : images)
+        {
+            string* jpeg = image.empty() ? nullptr : new string(std::move(image));
+            job->images.push_back(jpeg);
+        }
+
+        // available right away, not only once the whole batch is done
+        responses.push(job);
+        client->waiter->notify();
+    };
+
+    if (provider)
+    {
+        provider->generateImagesBatch(entries, result);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> g(mutex);
+        mGfxProvider->generateImagesBatch(entries, result);
+    }
+
+    // a provider failing part of a batch still has to see every job finished
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        if (!reported[i])
+        {
+            result(i, {});
         }
-        delete job;
     }
 }
 
+GfxProc::Statistics GfxProc::statistics() const
+{
+    std::lock_guard<std::mutex> g(mStatisticsMutex);
+    return mStatistics;
+}
+
 int GfxProc::checkevents(Waiter *)
 {
     if (!client)
@@ -224,7 +293,7 @@ int GfxProc::checkevents(Waiter *)
                         it->pendingfa.erase(job->imagetypes[i]);
                         client->checkfacompletion(job->h.uploadHandle());
                     }
-                    else
+                    else if (!client->lateFileAttributeResolved(job->h.uploadHandle(), job->imagetypes[i], UNDEF))
                     {
                         LOG_debug << "Transfer related to media file not found: " << job->h;
                     }
@@ -238,6 +307,14 @@ int GfxProc::checkevents(Waiter *)
     return needexec ? Waiter::NEEDEXEC : 0;
 }
 
+void IGfxProvider::generateImagesBatch(const std::vector<BatchEntry>& entries, const BatchResult& result)
+{
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        result(i, generateImages(entries[i].first, entries[i].second));
+    }
+}
+
 std::vector<std::string> IGfxLocalProvider::generateImages(const LocalPath& localfilepath,
                                                            const std::vector<GfxDimension>& dimensions)
 {
@@ -249,9 +326,21 @@ std::vector<std::string> IGfxLocalProvider::generateImages(const LocalPath& loca
         0,
         [](int max, const GfxDimension& d) { return std::max(max, std::max(d.w(), d.h())); });
 
+    // Largest first: providers may resize the stored bitmap in place, so every smaller image
+    // is then derived from the previous, already downscaled, one rather than from the source.
+    std::vector<size_t> order(dimensions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(),
+                     order.end(),
+                     [&dimensions](size_t a, size_t b)
+                     {
+                         return std::max(dimensions[a].w(), dimensions[a].h()) >
+                                std::max(dimensions[b].w(), dimensions[b].h());
+                     });
+
     if (readbitmap(localfilepath, maxDimension))
     {
-        for (unsigned int i = 0; i < dimensions.size(); ++i)
+        for (size_t i : order)
         {
             string jpeg;
             int targetWidth = dimensions[i].w(), targetHeight = dimensions[i].h();
@@ -347,7 +436,18 @@ int GfxProc::gendimensionsputfa(const LocalPath& localfilename, NodeOrUploadHand
     }
 
     requests.push(job);
-    waiter.notify();
+
+    if (mSharedLane)
+    {
+        mSharedLane->push([this]() { processSharedTurn(); }, false);
+        return generatingAttrs;
+    }
+
+    {
+        // a worker about to wait has either seen the job or will be woken
+        std::lock_guard<std::mutex> g(mWorkMutex);
+    }
+    mWorkAvailable.notify_one();
     return generatingAttrs;
 }
 
@@ -396,22 +496,79 @@ bool GfxProc::savefa(const LocalPath& localfilepath, const GfxDimension& dimensi
 GfxProc::GfxProc(std::unique_ptr<IGfxProvider> middleware)
     : mGfxProvider(std::move(middleware))
 {
+    mGfxProvider->setCancelFlag(&finished);
 }
 
 void GfxProc::startProcessingThread()
 {
-    thread.start(threadEntryPoint, this);
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+    if (SharedResources::enabled())
+    {
+        // the memory bound of MAX_WORKERS bitmaps holds for the whole process then
+        mSharedLane = std::make_unique<SharedWorkerPool::Lane>(SharedResources::gfxPool(std::min(cores, MAX_WORKERS)), 1);
+        LOG_debug << "Using the shared gfx workers";
+        threadstarted = true;
+        return;
+    }
+
+    // the first worker shares mGfxProvider (under mutex) with savefa()
+    mWorkers.emplace_back(&GfxProc::loop, this, nullptr);
+
+    for (unsigned i = 1; i < std::min(cores, MAX_WORKERS); ++i)
+    {
+        auto provider = mGfxProvider->clone();
+        if (!provider)
+        {
+            break;
+        }
+        provider->setCancelFlag(&finished);
+
+        mWorkers.emplace_back([this](std::unique_ptr<IGfxProvider> provider)
+                              {
+                                  loop(provider.get());
+                              },
+                              std::move(provider));
+    }
+
+    LOG_debug << "Started " << mWorkers.size() << " gfx worker(s)";
     threadstarted = true;
 }
 
 GfxProc::~GfxProc()
 {
-    finished = true;
-    waiter.notify();
+    {
+        std::lock_guard<std::mutex> g(mWorkMutex);
+        finished = true;
+    }
+    mWorkAvailable.notify_all();
+
+    if (mSharedLane)
+    {
+        // the jobs still queued are deleted below, a running one stops early with finished set
+        mSharedLane->clear(false);
+        mSharedLane.reset();
+    }
+
     assert(threadstarted);
-    if (threadstarted)
+    for (auto& worker : mWorkers)
     {
-        thread.join();
+        worker.join();
+    }
+
+    GfxJob *job = NULL;
+    while ((job = requests.pop()))
+    {
+        delete job;
+    }
+
+    while ((job = responses.pop()))
+    {
+        for (unsigned i = 0; i < job->images.size(); i++)
+        {
+            delete job->images[i];
+        }
+        delete job;
     }
 }
 
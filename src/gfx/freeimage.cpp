@@ -50,6 +50,10 @@ extern "C" {
 #include <libavutil/mathematics.h>
 #include <libavutil/display.h>
 #include <libavutil/imgutils.h>
+#if LIBAVCODEC_VERSION_MAJOR >= 58
+#include <libavutil/hwcontext.h>
+#define HAVE_FFMPEG_HWACCEL
+#endif
 }
 #endif
 
@@ -172,6 +176,90 @@ bool GfxProviderFreeImage::readbitmapMediaInfo(const LocalPath& imagePath)
 }
 #endif
 
+#ifdef FIF_LOAD_NOPIXELS
+bool GfxProviderFreeImage::readbitmapEmbeddedThumbnail(FREE_IMAGE_FORMAT fif, const LocalPath& imagePath, int size)
+{
+    // header and metadata only, the EXIF thumbnail comes with them
+    FIBITMAP* header = FreeImage_LoadX(fif, imagePath.localpath.c_str(), FIF_LOAD_NOPIXELS);
+    if (!header)
+    {
+        return false;
+    }
+    auto headerGuard = makeUniqueFrom(header, FreeImage_Unload);
+
+    FIBITMAP* thumbnail = FreeImage_GetThumbnail(header);
+    if (!thumbnail)
+    {
+        return false;
+    }
+
+    auto width = static_cast<int64_t>(FreeImage_GetWidth(header));
+    auto height = static_cast<int64_t>(FreeImage_GetHeight(header));
+    auto thumbnailWidth = static_cast<int64_t>(FreeImage_GetWidth(thumbnail));
+    auto thumbnailHeight = static_cast<int64_t>(FreeImage_GetHeight(thumbnail));
+
+    // the short side has to cover the square crop as well as the bounding box
+    if (!width || !height || std::min(thumbnailWidth, thumbnailHeight) < size)
+    {
+        return false;
+    }
+
+    // some cameras letterbox the thumbnail into a fixed 4:3 frame
+    if (std::abs(thumbnailWidth * height - thumbnailHeight * width) * 100 > thumbnailWidth * height)
+    {
+        return false;
+    }
+
+    if (!(dib = FreeImage_Clone(thumbnail)))
+    {
+        return false;
+    }
+
+    // the thumbnail is stored unrotated, orient it as JPEG_EXIFROTATE does the main image
+    FITAG* tag = nullptr;
+    WORD orientation = 1;
+    if (FreeImage_GetMetadata(FIMD_EXIF_MAIN, header, "Orientation", &tag) && tag
+        && FreeImage_GetTagType(tag) == FIDT_SHORT)
+    {
+        orientation = *static_cast<const WORD*>(FreeImage_GetTagValue(tag));
+    }
+
+    double angle = 0;
+    switch (orientation)
+    {
+        case 3: angle = 180; break;
+        case 5: case 8: angle = 90; break;
+        case 6: case 7: angle = -90; break;
+    }
+
+    if (angle)
+    {
+        FIBITMAP* rotated = FreeImage_Rotate(dib, angle);
+        FreeImage_Unload(dib);
+        if (!(dib = rotated))
+        {
+            return false;
+        }
+    }
+
+    if (orientation == 2)
+    {
+        FreeImage_FlipHorizontal(dib);
+    }
+    else if (orientation == 4 || orientation == 5 || orientation == 7)
+    {
+        FreeImage_FlipVertical(dib);
+    }
+
+    w = static_cast<int>(FreeImage_GetWidth(dib));
+    h = static_cast<int>(FreeImage_GetHeight(dib));
+
+    LOG_debug << "Using the embedded " << w << "x" << h << " thumbnail of " << imagePath;
+
+    return w > 0 && h > 0;
+}
+#endif
+
 bool GfxProviderFreeImage::readbitmapFreeimage(const LocalPath& imagePath, int size)
 {
 
@@ -183,6 +271,13 @@ bool GfxProviderFreeImage::readbitmapFreeimage(const LocalPath& imagePath, int s
         return false;
     }
 
+#ifdef FIF_LOAD_NOPIXELS
+    if (fif == FIF_JPEG && readbitmapEmbeddedThumbnail(fif, imagePath, size))
+    {
+        return true;
+    }
+#endif
+
 #ifndef OLD_FREEIMAGE
     if (fif == FIF_JPEG)
     {
@@ -231,6 +326,59 @@ const char *GfxProviderFreeImage::supportedformatsFfmpeg()
             ".qt.sls.tmf.trp.ts.ty.vc1.vob.vr.webm.wmv.";
 }
 
+#ifdef HAVE_FFMPEG_HWACCEL
+namespace {
+
+// Opening a device costs more than decoding a key frame of a small video in software
+constexpr int64_t HWACCEL_MIN_PIXELS = 1920 * 1080;
+
+// opaque points at the device's pixel format, reset if the stream turns out not to be supported
+AVPixelFormat getHardwareFormat(AVCodecContext* context, const AVPixelFormat* formats)
+{
+    auto hwPixelFormat = static_cast<AVPixelFormat*>(context->opaque);
+    for (auto format = formats; *format != AV_PIX_FMT_NONE; ++format)
+    {
+        if (*format == *hwPixelFormat)
+        {
+            return *format;
+        }
+    }
+
+    LOG_debug << "Hardware decoder can't take this stream, decoding in software";
+    *hwPixelFormat = AV_PIX_FMT_NONE;
+    return avcodec_default_get_format(context, formats);
+}
+
+// Attaches the first device that the decoder supports and that can be opened here
+// (VAAPI, VideoToolbox, DXVA2/D3D11VA, MediaCodec...), AV_PIX_FMT_NONE for none
+AVPixelFormat setupHardwareDecoding(const AVCodec* decoder, AVCodecContext* context)
+{
+    for (int i = 0; const AVCodecHWConfig* config = avcodec_get_hw_config(decoder, i); ++i)
+    {
+        if (!(config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX))
+        {
+            continue;
+        }
+
+        AVBufferRef* device = nullptr;
+        if (av_hwdevice_ctx_create(&device, config->device_type, nullptr, nullptr, 0) < 0)
+        {
+            continue;
+        }
+
+        // owned by the context from now on
+        context->hw_device_ctx = device;
+
+        LOG_debug << "Decoding video with " << av_hwdevice_get_type_name(config->device_type);
+        return config->pix_fmt;
+    }
+
+    return AV_PIX_FMT_NONE;
+}
+
+} // namespace
+#endif
+
 bool GfxProviderFreeImage::isFfmpegFile(const string& ext)
 {
     const char* ptr;
@@ -241,7 +389,25 @@ bool GfxProviderFreeImage::isFfmpegFile(const string& ext)
     return false;
 }
 
-bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int /*size*/)
+bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int size)
+{
+    bool usedHardware = false;
+    if (readbitmapFfmpeg(imagePath, size, true, usedHardware))
+    {
+        return true;
+    }
+
+    // drivers do fail on some streams they claim to support
+    if (usedHardware)
+    {
+        LOG_debug << "Hardware decoding failed, retrying in software: " << imagePath;
+        return readbitmapFfmpeg(imagePath, size, false, usedHardware);
+    }
+
+    return false;
+}
+
+bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int size, bool allowHardware, bool& usedHardware)
 {
 #ifndef DEBUG
     av_log_set_level(AV_LOG_PANIC);
@@ -269,18 +435,33 @@ bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int /*si
     }
 
 
-    // Find first video stream type
+    // Find first video stream type, preferring the cover art if the container has one big enough.
+    // Its single picture is queued by avformat and decoded without any seeking.
     AVStream *videoStream = NULL;
     int videoStreamIdx = 0;
     for (unsigned i = 0; i < formatContext->nb_streams; i++)
     {
-        if (formatContext->streams[i]->codecpar && formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+        AVStream* stream = formatContext->streams[i];
+        if (!stream->codecpar || stream->codecpar->codec_type != AVMEDIA_TYPE_VIDEO)
+        {
+            continue;
+        }
+
+        bool coverArt = (stream->disposition & AV_DISPOSITION_ATTACHED_PIC) != 0;
+        if (coverArt && std::min(stream->codecpar->width, stream->codecpar->height) >= size)
         {
-            videoStream = formatContext->streams[i];
+            videoStream = stream;
             videoStreamIdx = static_cast<int>(i);
             break;
         }
+
+        if (!videoStream || ((videoStream->disposition & AV_DISPOSITION_ATTACHED_PIC) && !coverArt))
+        {
+            videoStream = stream;
+            videoStreamIdx = static_cast<int>(i);
+        }
     }
+    bool isCoverArt = videoStream && (videoStream->disposition & AV_DISPOSITION_ATTACHED_PIC);
 
     if (!videoStream)
     {
@@ -321,17 +502,31 @@ bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int /*si
         return false;
     }
 
-    // Force seeking to key frames
+    // Force seeking to key frames, and decode nothing but key frames from there: the first
+    // one found is the frame used, the ones between that depend on it aren't needed
     formatContext->seek2any = false;
+    if (!isCoverArt)
+    {
+        codecContext->skip_frame = AVDISCARD_NONKEY;
+    }
     if (decoder->capabilities & CAP_TRUNCATED)
     {
         codecContext->flags |= CAP_TRUNCATED;
     }
 
     AVPixelFormat sourcePixelFormat = static_cast<AVPixelFormat>(codecParm->format);
+    // Scale the frame down while converting it, as JPEG_FAST does for photos, but never below
+    // the requested size on the short side so that square thumbnails can still be cropped from it
+    int targetWidth = width, targetHeight = height;
+    if (size > 0 && std::min(width, height) > size)
+    {
+        targetWidth = static_cast<int>(static_cast<int64_t>(width) * size / std::min(width, height));
+        targetHeight = static_cast<int>(static_cast<int64_t>(height) * size / std::min(width, height));
+    }
+
     AVPixelFormat targetPixelFormat = AV_PIX_FMT_BGR24; //raw data expected by freeimage is in this format
     SwsContext* swsContext = sws_getContext(width, height, sourcePixelFormat,
-                                            width, height, targetPixelFormat,
+                                            targetWidth, targetHeight, targetPixelFormat,
                                             SWS_FAST_BILINEAR, NULL, NULL, NULL);
     auto swsContextGuard = makeUniqueFrom(swsContext, sws_freeContext);
     if (!swsContext)
@@ -340,6 +535,24 @@ bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int /*si
         return false;
     }
 
+    // Hardware decoding where there's a device for it, frames are downloaded before scaling
+    AVPixelFormat hwPixelFormat = AV_PIX_FMT_NONE;
+#ifdef HAVE_FFMPEG_HWACCEL
+    if (allowHardware && !isCoverArt && static_cast<int64_t>(width) * height >= HWACCEL_MIN_PIXELS)
+    {
+        hwPixelFormat = setupHardwareDecoding(decoder, codecContext);
+        if (hwPixelFormat != AV_PIX_FMT_NONE)
+        {
+            usedHardware = true;
+            codecContext->opaque = &hwPixelFormat;
+            codecContext->get_format = getHardwareFormat;
+        }
+    }
+#else
+    static_cast<void>(allowHardware);
+    static_cast<void>(usedHardware);
+#endif
+
     // Open codec
     if (avcodec_open2(codecContext, decoder, NULL) < 0)
     {
@@ -354,15 +567,21 @@ bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int /*si
     AVFrame* targetFrame = av_frame_alloc();
     auto targetFrameGuard = makeUniqueFrom(&targetFrame, av_frame_free);
 
-    if (!videoFrame || !targetFrame)
+    // the frames downloaded from the device, usually NV12 rather than the stream's format
+    AVFrame* hwTransferFrame = av_frame_alloc();
+    auto hwTransferFrameGuard = makeUniqueFrom(&hwTransferFrame, av_frame_free);
+    SwsContext* hwSwsContext = nullptr;
+    auto hwSwsContextGuard = makeUniqueFrom(&hwSwsContext, [](SwsContext** context) { sws_freeContext(*context); });
+
+    if (!videoFrame || !targetFrame || !hwTransferFrame)
     {
         LOG_warn << "Error allocating video frames";
         return false;
     }
 
     targetFrame->format = targetPixelFormat;
-    targetFrame->width = width;
-    targetFrame->height = height;
+    targetFrame->width = targetWidth;
+    targetFrame->height = targetHeight;
     if (av_image_alloc(targetFrame->data, targetFrame->linesize, targetFrame->width, targetFrame->height, targetPixelFormat, 32) < 0)
     {
         LOG_warn << "Error allocating frame";
@@ -386,7 +605,7 @@ bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int /*si
     }
 
     string extension = imagePath.extension();
-    if (!extension.empty()
+    if (!extension.empty() && !isCoverArt
             && strcmp(extension.c_str(),".mp3") && seek_target > 0
             && av_seek_frame(formatContext, videoStreamIdx, seek_target, AVSEEK_FLAG_BACKWARD) < 0)
     {
@@ -418,19 +637,46 @@ bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int /*si
 
             while (avcodec_receive_frame(codecContext, videoFrame) >= 0)
             {
+                AVFrame* sourceFrame = videoFrame;
+                SwsContext* frameSwsContext = swsContext;
+
+#ifdef HAVE_FFMPEG_HWACCEL
+                if (hwPixelFormat != AV_PIX_FMT_NONE && videoFrame->format == hwPixelFormat)
+                {
+                    if (av_hwframe_transfer_data(hwTransferFrame, videoFrame, 0) < 0)
+                    {
+                        LOG_warn << "Error transferring frame from the hardware decoder";
+                        return false;
+                    }
+
+                    hwSwsContext = sws_getCachedContext(hwSwsContext, width, height,
+                                                        static_cast<AVPixelFormat>(hwTransferFrame->format),
+                                                        targetWidth, targetHeight, targetPixelFormat,
+                                                        SWS_FAST_BILINEAR, NULL, NULL, NULL);
+                    if (!hwSwsContext)
+                    {
+                        LOG_warn << "SWS Context not found: " << hwTransferFrame->format;
+                        return false;
+                    }
+
+                    sourceFrame = hwTransferFrame;
+                    frameSwsContext = hwSwsContext;
+                }
+                else
+#endif
                 if (sourcePixelFormat != codecContext->pix_fmt)
                 {
                     LOG_warn << "Error: pixel format changed from " << sourcePixelFormat << " to " << codecContext->pix_fmt;
                     return false;
                 }
 
-                scalingResult = sws_scale(swsContext, videoFrame->data, videoFrame->linesize,
+                scalingResult = sws_scale(frameSwsContext, sourceFrame->data, sourceFrame->linesize,
                                           0, codecParm->height, targetFrame->data, targetFrame->linesize);
 
                 if (scalingResult > 0)
                 {
                     const int legacy_align = 1;
-                    int imagesize = av_image_get_buffer_size(targetPixelFormat, width, height, legacy_align);
+                    int imagesize = av_image_get_buffer_size(targetPixelFormat, targetWidth, targetHeight, legacy_align);
                     FIMEMORY fmemory;
                     fmemory.data = malloc(static_cast<size_t>(imagesize));
                     if (!fmemory.data)
@@ -442,16 +688,16 @@ bool GfxProviderFreeImage::readbitmapFfmpeg(const LocalPath& imagePath, int /*si
 
                     if (av_image_copy_to_buffer((uint8_t *)fmemory.data, imagesize,
                                 targetFrame->data, targetFrame->linesize,
-                                targetPixelFormat, width, height, legacy_align) <= 0)
+                                targetPixelFormat, targetWidth, targetHeight, legacy_align) <= 0)
                     {
                         LOG_warn << "Error copying frame";
                         return false;
                     }
 
                     //int pitch = imagesize/height;
-                    int pitch = width*3;
+                    int pitch = targetWidth*3;
 
-                    if (!(dib = FreeImage_ConvertFromRawBits((BYTE*)fmemory.data,width,height,
+                    if (!(dib = FreeImage_ConvertFromRawBits((BYTE*)fmemory.data,targetWidth,targetHeight,
                                                              pitch, 24, FI_RGBA_RED_SHIFT, FI_RGBA_GREEN_MASK,
                                                              FI_RGBA_BLUE_MASK | 0xFFFF, TRUE) ) )
                     {
@@ -498,7 +744,7 @@ bool GfxProviderFreeImage::isPdfFile(const string &ext)
     return false;
 }
 
-bool GfxProviderFreeImage::readbitmapPdf(const LocalPath& imagePath, int /*size*/)
+bool GfxProviderFreeImage::readbitmapPdf(const LocalPath& imagePath, int size)
 {
     std::lock_guard<std::mutex> g(gfxMutex);
     if (!pdfiumInitialized)
@@ -508,24 +754,8 @@ bool GfxProviderFreeImage::readbitmapPdf(const LocalPath& imagePath, int /*size*
     }
 
     int orientation;
-#ifdef _WIN32
-    wstring tmpPath;
-    tmpPath.resize(MAX_PATH);
-    LocalPath workingDir;
-    if (!GetTempPathW(MAX_PATH, (LPWSTR)tmpPath.data())) // If the function fails, the return value is zero.
-    {
-        LOG_warn << "Error getting temporary path to process pdf.";
-        workingDir.clear();
-    }
-    else
-    {
-        workingDir = LocalPath::fromPlatformEncodedAbsolute(tmpPath.c_str());
-    }
-
-    unique_ptr<char[]> data = PdfiumReader::readBitmapFromPdf(w, h, orientation, imagePath, workingDir);
-#else
-    unique_ptr<char[]> data = PdfiumReader::readBitmapFromPdf(w, h, orientation, imagePath);
-#endif
+    unique_ptr<char[]> data = PdfiumReader::readBitmapFromPdf(w, h, orientation, imagePath, size,
+                                                              [this]() { return isCancelled(); });
 
     if (!data || !w || !h)
     {
@@ -573,6 +803,12 @@ const char *GfxProviderFreeImage::supportedvideoformats()
     return NULL;
 }
 
+std::unique_ptr<IGfxProvider> GfxProviderFreeImage::clone() const
+{
+    // the bitmap is per instance, what pdfium and ffmpeg share is guarded by gfxMutex
+    return std::make_unique<GfxProviderFreeImage>();
+}
+
 bool GfxProviderFreeImage::readbitmap(const LocalPath& localname, int size)
 {
 
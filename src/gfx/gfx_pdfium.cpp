@@ -24,7 +24,8 @@
 
 #ifdef HAVE_PDFIUM
 
-#define MAX_PDF_MEM_SIZE 1024*1024*100
+#include <fpdf_dataavail.h>
+#include <fpdf_progressive.h>
 
 namespace mega {
 
@@ -56,151 +57,174 @@ void PdfiumReader::destroy()
     }
 }
 
-#ifdef _WIN32
-std::unique_ptr<char[]> PdfiumReader::readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path, const LocalPath &workingDirFolder)
-#else
-std::unique_ptr<char[]> PdfiumReader::readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path)
-#endif
+namespace {
+
+// Reads the document through FileAccess, which copes with any path on every platform, and gives up
+// on the job, failing the read or pausing the render for good, once it runs out of time or is cancelled.
+struct PdfJob : FPDF_FILEACCESS, FX_FILEAVAIL, FX_DOWNLOADHINTS, IFSDK_PAUSE
 {
+    PdfJob(FileAccess& file, const std::function<bool()>& cancelled)
+        : mFile(file)
+        , mCancelled(cancelled)
+        , mDeadline(std::chrono::steady_clock::now() + PdfiumReader::TIME_BUDGET)
+    {
+        m_FileLen = static_cast<unsigned long>(file.size);
+        m_GetBlock = &PdfJob::getBlock;
+        m_Param = this;
 
-    std::lock_guard<std::mutex> g(pdfMutex);
-    assert (initialized);
+        FX_FILEAVAIL::version = 1;
+        IsDataAvail = &PdfJob::isDataAvail;
+
+        FX_DOWNLOADHINTS::version = 1;
+        AddSegment = &PdfJob::addSegment;
 
-    FPDF_DOCUMENT pdf_doc = FPDF_LoadDocument(path.toPath(false).c_str(), nullptr);
-#ifdef _WIN32
-    LocalPath tmpFilePath;
-    bool removetemporaryfile = false;
-    std::unique_ptr<byte[]> buffer;
-    FSACCESS_CLASS fa;
+        IFSDK_PAUSE::version = 1;
+        NeedToPauseNow = &PdfJob::needToPauseNow;
+        user = this;
+    }
 
-    // In Windows it fails if the path has non-ascii chars
-    if (pdf_doc == nullptr && FPDF_GetLastError() == FPDF_ERR_FILE)
+    bool expired()
     {
-        std::unique_ptr<FileAccess> pdfFile = fa.newfileaccess();
-        if (pdfFile->fopen(path, FSLogging::logOnError))
+        if (!mExpired && (std::chrono::steady_clock::now() > mDeadline || (mCancelled && mCancelled())))
         {
-            if (pdfFile->size > MAX_PDF_MEM_SIZE)
-            {
-                if (!workingDirFolder.empty())
-                {
-                    LocalPath originPath = path;
-                    tmpFilePath = workingDirFolder;
-                    tmpFilePath.appendWithSeparator(LocalPath::fromRelativePath(".megapdftmp"),false);
-                    if (fa.copylocal(originPath, tmpFilePath, pdfFile->mtime))
-                    {
-                        pdf_doc = FPDF_LoadDocument(tmpFilePath.toPath(false).c_str(), nullptr);
-                        removetemporaryfile = true;
-                    }
-                }
-            }
-            else if (pdfFile->openf(FSLogging::logOnError))
-            {
-                buffer.reset(new byte[pdfFile->size]);
-                pdfFile->frawread(buffer.get(), static_cast<unsigned>(pdfFile->size), static_cast<m_off_t>(0), true, FSLogging::logOnError);
-                pdfFile->closef();
-                pdf_doc = FPDF_LoadMemDocument(buffer.get(), static_cast<int>(pdfFile->size), nullptr);
-            }
+            mExpired = true;
         }
+        return mExpired;
     }
-#endif
-    if (pdf_doc != nullptr)
+
+    static int getBlock(void* param, unsigned long position, unsigned char* buffer, unsigned long size)
     {
-        int page_count = FPDF_GetPageCount(pdf_doc);
-        if (page_count > 0)
-        {
-            FPDF_PAGE page = FPDF_LoadPage(pdf_doc, 0 /*pageIndex*/);
-            if (page != nullptr)
-            {
-                w = static_cast<int>(FPDF_GetPageWidth(page));
-                h = static_cast<int>(FPDF_GetPageHeight(page));
-
-                // we should restrict the maximum size of PDF pages to process, otherwise
-                // it may require too much memory (and CPU).
-                // as a compromise, the A0 standarized size should be enough for most cases,
-                // A0: 841 x 1188 mm -> 2384 x 3368 points (as returned by FPDF_GetPageX())
-                // to allow some margins, and rotated ones, avoid larger than 3500 points in
-                // any dimension, which would require a buffer of maximum 3500x3500x4 = ~47MB
-
-                if ((!w || !h)  // error reading size
-                        || (w > 3500 || h > 3500))  // page too large
-                {
-                    if (!w || !h)
-                    {
-                        LOG_err << "Error reading PDF page size for " << path;
-                    }
-                    else
-                    {
-                        LOG_err << "Page size too large. Skipping PDF preview for " << path;
-                    }
-                    FPDF_ClosePage(page);
-                    FPDF_CloseDocument(pdf_doc);
-#ifdef _WIN32
-                if (removetemporaryfile)
-                {
-                    fa.unlinklocal(tmpFilePath);
-                }
-#endif
-                    return nullptr;
-                }
-
-                // BGRA format, 4 bytes per pixel (32bits), byte order: blue, green, red, alpha.
-                std::unique_ptr<char[]> buffer(new char[static_cast<size_t>(w * h * 4)]);
-                FPDF_BITMAP bitmap = FPDFBitmap_CreateEx(w, h, FPDFBitmap_BGRA, buffer.get(), w * 4);
-                if (!bitmap) //out of memory
-                {
-                    LOG_warn << "Error generating bitmap image (OOM)";
-                    FPDF_ClosePage(page);
-                    FPDF_CloseDocument(pdf_doc);
-#ifdef _WIN32
-                    if (removetemporaryfile)
-                    {
-                        fa.unlinklocal(tmpFilePath);
-                    }
-#endif
-                    return nullptr;
-                }
-
-                FPDFBitmap_FillRect(bitmap, 0, 0, w, h, 0xFFFFFFFF);
-                FPDF_RenderPageBitmap(bitmap, page, 0, 0, w, h, 2, 0);
-                FPDFBitmap_Destroy(bitmap);
-                FPDF_ClosePage(page);
-                FPDF_CloseDocument(pdf_doc);
-#ifdef _WIN32
-                if (removetemporaryfile)
-                {
-                    fa.unlinklocal(tmpFilePath);
-                }
-#endif
-                // Needed by Qt: ROTATION_DOWN = 3
-                orientation = 3;
-                return buffer;
-            }
-            else
-            {
-                FPDF_CloseDocument(pdf_doc);
-                LOG_err << "Error loading PDF page to create thumb for " << path;
-            }
-        }
-        else
-        {
-            FPDF_CloseDocument(pdf_doc);
-            LOG_err << "Error getting number of pages for " << path;
-        }
+        auto job = static_cast<PdfJob*>(param);
+        return !job->expired() && job->mFile.frawread(buffer, static_cast<unsigned>(size), static_cast<m_off_t>(position), true, FSLogging::logOnError);
     }
-    else
+
+    // the whole file is at hand, the data availability interface is only there for linearized loading
+    static FPDF_BOOL isDataAvail(FX_FILEAVAIL*, size_t, size_t)
     {
-        LOG_err << "Error loading PDF to create thumbnail for " << path << " " << FPDF_GetLastError();
+        return true;
     }
 
-#ifdef _WIN32
-    if (removetemporaryfile)
+    static void addSegment(FX_DOWNLOADHINTS*, size_t, size_t)
     {
-        fa.unlinklocal(tmpFilePath);
     }
-#endif
 
-    return nullptr;
+    static FPDF_BOOL needToPauseNow(IFSDK_PAUSE* pause)
+    {
+        return static_cast<PdfJob*>(pause->user)->expired();
+    }
+
+    FileAccess& mFile;
+    const std::function<bool()>& mCancelled;
+    std::chrono::steady_clock::time_point mDeadline;
+    bool mExpired = false;
+};
+
+} // namespace
+
+std::unique_ptr<char[]> PdfiumReader::readBitmapFromPdf(int &w, int &h, int &orientation, const LocalPath &path,
+                                                        int size, const std::function<bool()>& cancelled)
+{
+    std::lock_guard<std::mutex> g(pdfMutex);
+    assert (initialized);
+
+    FSACCESS_CLASS fsAccess;
+    std::unique_ptr<FileAccess> file = fsAccess.newfileaccess();
+    if (!file->fopen(path, true, false, FSLogging::logOnError))
+    {
+        LOG_err << "Error opening PDF to create thumbnail for " << path;
+        return nullptr;
+    }
+
+    if (file->size > static_cast<m_off_t>(std::numeric_limits<unsigned long>::max()))
+    {
+        LOG_err << "PDF too large to create thumbnail for " << path;
+        return nullptr;
+    }
+
+    // Linearized documents are loaded from their first page's cross-reference section only,
+    // the rest of the document is never parsed. Others are loaded as a whole.
+    PdfJob job(*file, cancelled);
+    std::unique_ptr<std::remove_pointer<FPDF_AVAIL>::type, decltype(&FPDFAvail_Destroy)> avail(FPDFAvail_Create(&job, &job), FPDFAvail_Destroy);
+    if (!avail || FPDFAvail_IsDocAvail(avail.get(), &job) != PDF_DATA_AVAIL)
+    {
+        LOG_err << "Error loading PDF to create thumbnail for " << path;
+        return nullptr;
+    }
+
+    std::unique_ptr<std::remove_pointer<FPDF_DOCUMENT>::type, decltype(&FPDF_CloseDocument)> pdf_doc(FPDFAvail_GetDocument(avail.get(), nullptr), FPDF_CloseDocument);
+    if (!pdf_doc)
+    {
+        LOG_err << "Error loading PDF to create thumbnail for " << path << " " << (job.expired() ? "(out of time)" : std::to_string(FPDF_GetLastError()));
+        return nullptr;
+    }
+
+    if (FPDF_GetPageCount(pdf_doc.get()) <= 0)
+    {
+        LOG_err << "Error getting number of pages for " << path;
+        return nullptr;
+    }
+
+    if (FPDFAvail_IsPageAvail(avail.get(), 0, &job) != PDF_DATA_AVAIL)
+    {
+        LOG_err << "Error loading PDF page to create thumb for " << path;
+        return nullptr;
+    }
+
+    std::unique_ptr<std::remove_pointer<FPDF_PAGE>::type, decltype(&FPDF_ClosePage)> page(FPDF_LoadPage(pdf_doc.get(), 0 /*pageIndex*/), FPDF_ClosePage);
+    if (!page)
+    {
+        LOG_err << "Error loading PDF page to create thumb for " << path;
+        return nullptr;
+    }
+
+    double pageWidth = FPDF_GetPageWidth(page.get());
+    double pageHeight = FPDF_GetPageHeight(page.get());
+    if (pageWidth < 1 || pageHeight < 1)
+    {
+        LOG_err << "Error reading PDF page size for " << path;
+        return nullptr;
+    }
+
+    // no more pixels than the largest image generated from them needs
+    double scale = size > 0 ? std::min(1.0, size / std::min(pageWidth, pageHeight)) : 1.0;
+    w = std::max(1, static_cast<int>(pageWidth * scale));
+    h = std::max(1, static_cast<int>(pageHeight * scale));
+
+    if (static_cast<int64_t>(w) * h > MAX_BITMAP_PIXELS)
+    {
+        LOG_err << "Page size too large. Skipping PDF preview for " << path;
+        return nullptr;
+    }
+
+    // BGRA format, 4 bytes per pixel (32bits), byte order: blue, green, red, alpha.
+    std::unique_ptr<char[]> buffer(new (std::nothrow) char[static_cast<size_t>(w) * static_cast<size_t>(h) * 4]);
+    FPDF_BITMAP bitmap = buffer ? FPDFBitmap_CreateEx(w, h, FPDFBitmap_BGRA, buffer.get(), w * 4) : nullptr;
+    if (!bitmap) //out of memory
+    {
+        LOG_warn << "Error generating bitmap image (OOM)";
+        return nullptr;
+    }
+
+    FPDFBitmap_FillRect(bitmap, 0, 0, w, h, 0xFFFFFFFF);
+
+    // progressive, so that the job can be abandoned halfway through a page
+    int status = FPDF_RenderPageBitmap_Start(bitmap, page.get(), 0, 0, w, h, 2, 0, &job);
+    while (status == FPDF_RENDER_TOBECONTINUED && !job.expired())
+    {
+        status = FPDF_RenderPage_Continue(page.get(), &job);
+    }
+    FPDF_RenderPage_Close(page.get());
+    FPDFBitmap_Destroy(bitmap);
+
+    if (status != FPDF_RENDER_DONE)
+    {
+        LOG_err << "Error rendering PDF page to create thumb for " << path << (job.expired() ? " (out of time)" : "");
+        return nullptr;
+    }
 
+    // Needed by Qt: ROTATION_DOWN = 3
+    orientation = 3;
+    return buffer;
 }
 
 } // namespace mega
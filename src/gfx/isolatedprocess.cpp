@@ -125,6 +125,26 @@ std::vector<std::string> GfxProviderIsolatedProcess::generateImages(
     return images;
 }
 
+void GfxProviderIsolatedProcess::generateImagesBatch(const std::vector<BatchEntry>& entries,
+                                                     const BatchResult& result)
+{
+    std::vector<gfx::GfxTask> tasks(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        tasks[i].Path = LocalPath::fromAbsolutePath(entries[i].first.toPath(false)).platformEncoded();
+        tasks[i].Dimensions = entries[i].second;
+    }
+
+    // results not received are reported as empty images by GfxProc
+    auto gfxclient = GfxClient::create(mEndpointName);
+    gfxclient.runGfxBatch(tasks,
+                          [&entries, &result](size_t index, std::vector<std::string>&& images)
+                          {
+                              images.resize(entries[index].second.size());
+                              result(index, std::move(images));
+                          });
+}
+
 const char* GfxProviderIsolatedProcess::supportedformats()
 {
     return getformats(&Formats::formats);
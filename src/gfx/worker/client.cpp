@@ -105,6 +105,56 @@ bool GfxClient::runGfxTask(const std::string& localpath,
     }
 }
 
+bool GfxClient::runGfxBatch(const std::vector<GfxTask>& tasks,
+                            const std::function<void(size_t, std::vector<std::string>&&)>& result)
+{
+    // 3 seconds at most
+    auto endpoint = connectWithRetry(milliseconds(100), 30);
+    if (!endpoint)
+    {
+        LOG_err << "runGfxBatch Couldn't connect";
+        return false;
+    }
+
+    CommandNewGfxBatch command;
+    command.Tasks = tasks;
+
+    ProtocolWriter writer(endpoint.get());
+    if (!writer.writeCommand(&command, milliseconds(5000)))
+    {
+        LOG_err << "GfxClient couldn't send gfxBatch request";
+        return false;
+    }
+
+    // the timeout applies to each response, the server processes several tasks at once
+    ProtocolReader reader(endpoint.get());
+    for (size_t received = 0; received < tasks.size(); ++received)
+    {
+        auto response = reader.readCommand(milliseconds(5000));
+        auto batchResponse = dynamic_cast<CommandNewGfxBatchResponse*>(response.get());
+        if (!batchResponse || batchResponse->Index >= tasks.size())
+        {
+            LOG_err << "GfxClient couldn't get gfxBatch response, " << received << "/" << tasks.size() << " received";
+            return false;
+        }
+
+        if (batchResponse->ErrorCode == static_cast<uint32_t>(GfxTaskProcessStatus::ERR))
+        {
+            LOG_info << "GfxClient gets gfxBatch response with error: "
+                     << batchResponse->ErrorText
+                     << ", "
+                     << batchResponse->Index;
+            result(batchResponse->Index, {});
+            continue;
+        }
+
+        result(batchResponse->Index, std::move(batchResponse->Images));
+    }
+
+    LOG_verbose << "GfxClient gets gfxBatch responses successfully, " << tasks.size() << " tasks";
+    return true;
+}
+
 bool GfxClient::runSupportFormats(std::string& formats, std::string& videoformats)
 {
     auto endpoint = connectWithRetry(milliseconds(100), 30); // 3 seconds at most
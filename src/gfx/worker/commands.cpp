@@ -8,6 +8,7 @@ namespace
 using mega::CacheableWriter;
 using mega::CacheableReader;
 using mega::GfxDimension;
+using mega::gfx::GfxTask;
 
 class GfxSerializationHelper
 {
@@ -22,6 +23,11 @@ public:
     {
         writer.serializestring_u32(source);
     }
+    static void serialize(CacheableWriter& writer, const GfxTask& source)
+    {
+        writer.serializestring_u32(source.Path);
+        GfxSerializationHelper::serialize(writer, source.Dimensions);
+    }
     template<typename T>
     static void serialize(CacheableWriter& writer, const std::vector<T>& target)
     {
@@ -53,6 +59,19 @@ public:
     {
         return reader.unserializestring_u32(target);
     }
+    static bool unserialize(CacheableReader& reader, GfxTask& target)
+    {
+        if (!reader.unserializestring_u32(target.Path))
+        {
+            return false;
+        }
+        if (!GfxSerializationHelper::unserialize(reader, target.Dimensions))
+        {
+            return false;
+        }
+        // empty dimensions considered an invalid task
+        return !target.Dimensions.empty();
+    }
     template<typename T>
     static bool unserialize(CacheableReader& reader, std::vector<T>& target, const size_t maxVectSize = MAX_VECT_SIZE)
     {
@@ -102,6 +121,10 @@ std::unique_ptr<ICommand> ICommand::factory(CommandType type)
         return std::make_unique<CommandSupportFormats>();
     case CommandType::SUPPORT_FORMATS_RESPONSE:
         return std::make_unique<CommandSupportFormatsResponse>();
+    case CommandType::NEW_GFX_BATCH:
+        return std::make_unique<CommandNewGfxBatch>();
+    case CommandType::NEW_GFX_BATCH_RESPONSE:
+        return std::make_unique<CommandNewGfxBatchResponse>();
     default:
         assert(false);
         return nullptr;
@@ -189,6 +212,67 @@ bool CommandNewGfxResponse::unserialize(const std::string& data)
     return true;
 }
 
+std::string CommandNewGfxBatch::serialize() const
+{
+    std::string toret;
+    CacheableWriter writer(toret);
+    GfxSerializationHelper::serialize(writer, Tasks);
+    return toret;
+}
+
+bool CommandNewGfxBatch::unserialize(const std::string& data)
+{
+    CacheableReader reader(data);
+    // tasks
+    if (!GfxSerializationHelper::unserialize(reader, Tasks))
+    {
+        return false;
+    }
+    // empty batch considered invalid
+    if (Tasks.size() == 0)
+    {
+        return false;
+    }
+    return true;
+}
+
+std::string CommandNewGfxBatchResponse::serialize() const
+{
+    std::string toret;
+    CacheableWriter writer(toret);
+    writer.serializeu32(Index);
+    writer.serializeu32(ErrorCode);
+    writer.serializestring_u32(ErrorText);
+    GfxSerializationHelper::serialize(writer, Images);
+    return toret;
+}
+
+bool CommandNewGfxBatchResponse::unserialize(const std::string& data)
+{
+    CacheableReader reader(data);
+    // Index
+    if (!reader.unserializeu32(Index))
+    {
+        return false;
+    }
+    // ErrorCode
+    if (!reader.unserializeu32(ErrorCode))
+    {
+        return false;
+    }
+    // ErrorText
+    if (!reader.unserializestring_u32(ErrorText))
+    {
+        return false;
+    }
+    // images
+    if (!GfxSerializationHelper::unserialize(reader, Images))
+    {
+        return false;
+    }
+    return true;
+}
+
 std::string CommandHello::serialize() const
 {
     std::string toret;
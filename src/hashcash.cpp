@@ -0,0 +1,187 @@
+/**
+ * @file hashcash.cpp
+ * @brief Solver for the API's hashcash challenges
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/hashcash.h"
+#include "mega/base64.h"
+#include "mega/crypto/cryptopp.h"
+#include "mega/logging.h"
+
+namespace mega {
+
+constexpr uint64_t HashcashSolver::NO_SOLUTION;
+
+// the token is hashed this many times after the prefix
+static constexpr unsigned TOKEN_COPIES = 262144;
+
+// and from a buffer with this many copies, added over and over
+static constexpr unsigned BUFFER_COPIES = 4096;
+
+static constexpr size_t TOKEN_SIZE = 48;
+
+HashcashSolver::HashcashSolver(string token, uint8_t easiness, std::function<void()> notify, unsigned threadCount)
+    : mToken(std::move(token))
+    , mEasiness(easiness)
+    // easiness: encoded threshold (maximum acceptable value in the first 32 bits of the
+    // hash, big endian - the lower, the harder to solve)
+    , mThreshold(static_cast<uint32_t>((((easiness & 63) << 1) + 1) << ((easiness >> 6) * 7 + 3)))
+    , mTokenBinary(Base64::atob(mToken))
+    , mNotify(std::move(notify))
+    , mStarted(std::chrono::steady_clock::now())
+{
+    if (!threadCount)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // token is 64 chars in B64, the 48 bytes in binary
+    if (mTokenBinary.size() != TOKEN_SIZE)
+    {
+        LOG_err << "Invalid hashcash token: " << mToken;
+        threadCount = 0;
+    }
+
+    std::lock_guard<std::mutex> g(mMutex);
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        try
+        {
+            mThreads.emplace_back([this]() { work(); });
+            ++mRunning;
+        }
+        catch (std::system_error& e)
+        {
+            LOG_err << "Failed to start hashcash thread: " << e.what();
+            break;
+        }
+    }
+
+    if (!mRunning)
+    {
+        // nothing to wait for
+        mFinished = std::chrono::steady_clock::now();
+        mDone = true;
+    }
+}
+
+HashcashSolver::~HashcashSolver()
+{
+    cancel();
+    for (auto& t : mThreads)
+    {
+        t.join();
+    }
+}
+
+void HashcashSolver::cancel()
+{
+    mCancelled = true;
+}
+
+void HashcashSolver::wait()
+{
+    std::unique_lock<std::mutex> g(mMutex);
+    mDoneCondition.wait(g, [this]() { return mDone.load(); });
+}
+
+const string& HashcashSolver::prefix() const
+{
+    assert(mDone);
+    return mPrefix;
+}
+
+std::chrono::milliseconds HashcashSolver::elapsed() const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    auto until = mDone ? mFinished : std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(until - mStarted);
+}
+
+void HashcashSolver::work()
+{
+    std::vector<byte> buffer(BUFFER_COPIES * TOKEN_SIZE);
+    for (unsigned i = 0; i < BUFFER_COPIES; ++i)
+    {
+        memcpy(buffer.data() + i * TOKEN_SIZE, mTokenBinary.data(), TOKEN_SIZE);
+    }
+
+    // Each candidate taken is hashed through, unless cancelled: every one below the
+    // best solution is tried by some thread, and the best is the first.
+    for (uint64_t candidate; !mCancelled && (candidate = mNextCandidate++) < mBest; )
+    {
+        // the final result, but not its correctness, depends on the CPU's endianness
+        auto prefix = static_cast<uint32_t>(candidate);
+
+        HashSHA256 hasher;
+        hasher.add(reinterpret_cast<const byte*>(&prefix), sizeof prefix);
+        for (unsigned i = TOKEN_COPIES / BUFFER_COPIES; i--; )
+        {
+            hasher.add(buffer.data(), static_cast<unsigned>(buffer.size()));
+        }
+
+        string hash;
+        hasher.get(&hash);
+        ++mAttempts;
+
+        auto h = reinterpret_cast<const byte*>(hash.data());
+        uint32_t value = uint32_t(h[0]) << 24 | uint32_t(h[1]) << 16 | uint32_t(h[2]) << 8 | h[3];
+        if (value <= mThreshold)
+        {
+            for (uint64_t best = mBest; candidate < best && !mBest.compare_exchange_weak(best, candidate); )
+            {
+            }
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        if (--mRunning)
+        {
+            return;
+        }
+
+        // the last one out
+        mFinished = std::chrono::steady_clock::now();
+
+        uint64_t best = mBest;
+        if (!mCancelled && best != NO_SOLUTION)
+        {
+            auto prefix = static_cast<uint32_t>(best);
+            mPrefix = Base64::btoa(string(reinterpret_cast<const char*>(&prefix), sizeof prefix));
+        }
+        mDone = true;
+    }
+    mDoneCondition.notify_all();
+
+    if (mNotify)
+    {
+        mNotify();
+    }
+}
+
+string gencash(const string& token, uint8_t easiness)
+{
+    HashcashSolver solver(token, easiness, nullptr);
+    solver.wait();
+    return solver.prefix();
+}
+
+} // namespace
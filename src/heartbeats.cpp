@@ -303,7 +303,7 @@ bool BackupInfoSync::operator!=(const BackupInfoSync &o) const
     return !(*this == o);
 }
 
-void BackupMonitor::beatBackupInfo(UnifiedSync& us)
+void BackupMonitor::beatBackupInfo(UnifiedSync& us, std::vector<std::function<void(MegaClient&)>>& beats)
 {
     assert(syncs.onSyncThread());
 
@@ -339,9 +339,6 @@ void BackupMonitor::beatBackupInfo(UnifiedSync& us)
          (elapsedSec >= MAX_HEARBEAT_SECS_DELAY ||
          (elapsedSec*10 >= FREQUENCY_HEARTBEAT_DS && hbs->mModified)))
     {
-
-        hbs->setLastBeat(m_time(nullptr));
-
         m_off_t inflightProgress = 0;
         if (us.mSync)
         {
@@ -354,26 +351,38 @@ void BackupMonitor::beatBackupInfo(UnifiedSync& us)
 
         auto progress = uint8_t(100.0 * reportCounts.progress(inflightProgress));
 
+        HeartBeatSyncInfo::Report report;
+        report.status = hbs->sphbStatus();
+        report.progress = static_cast<int8_t>(progress);
+        report.pendingUps = static_cast<uint32_t>(reportCounts.mUploads.mPending);
+        report.pendingDowns = static_cast<uint32_t>(reportCounts.mUploads.mPending);
+        report.lastItemUpdated = hbs->lastItemUpdated();
+
+        if (elapsedSec < MAX_HEARBEAT_SECS_DELAY && hbs->mLastReport && *hbs->mLastReport == report)
+        {
+            // the changes since the last one don't show in the heartbeat: wait for one that does
+            hbs->mModified = false;
+            return;
+        }
+
+        hbs->setLastBeat(m_time(nullptr));
+        hbs->mLastReport = std::make_unique<HeartBeatSyncInfo::Report>(report);
         hbs->mSending = true;
 
         auto backupId = us.mConfig.mBackupId;
-        auto status = hbs->sphbStatus();
-        auto pendingUps = static_cast<uint32_t>(reportCounts.mUploads.mPending);
-        auto pendingDowns = static_cast<uint32_t>(reportCounts.mUploads.mPending);
         auto lastAction = hbs->lastAction();
-        auto lastItemUpdated = hbs->lastItemUpdated();
 
-        syncs.queueClient(
-            [=](MegaClient& mc, DBTableTransactionCommitter&)
+        beats.emplace_back(
+            [=](MegaClient& mc)
             {
                 mc.reqs.add(new CommandBackupPutHeartBeat(&mc,
                                                           backupId,
-                                                          status,
-                                                          static_cast<int8_t>(progress),
-                                                          pendingUps,
-                                                          pendingDowns,
+                                                          report.status,
+                                                          report.progress,
+                                                          report.pendingUps,
+                                                          report.pendingDowns,
                                                           lastAction,
-                                                          lastItemUpdated,
+                                                          report.lastItemUpdated,
                                                           [hbs](Error)
                                                           {
                                                               hbs->mSending = false;
@@ -393,13 +402,29 @@ void BackupMonitor::beat()
     assert(syncs.onSyncThread());
 
     // Only send heartbeats for enabled active syncs.
+    std::vector<std::function<void(MegaClient&)>> beats;
     for (auto& us : syncs.mSyncVec)
     {
         if (us->mSync && us->mConfig.getEnabled())
         {
-            beatBackupInfo(*us);
+            beatBackupInfo(*us, beats);
         }
     };
+
+    if (beats.empty())
+    {
+        return;
+    }
+
+    // a single trip to the client thread, so all of them go in the same request to the API
+    syncs.queueClient(
+        [beats = std::move(beats)](MegaClient& mc, DBTableTransactionCommitter&)
+        {
+            for (auto& beat : beats)
+            {
+                beat(mc);
+            }
+        });
 }
 
 #endif
@@ -38,6 +38,10 @@
 #include <resolv.h>
 #endif
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
 namespace mega {
 
 // data receive timeout (ds)
@@ -328,6 +332,45 @@ bool HttpIO::setmaxuploadspeed(m_off_t)
     return false;
 }
 
+bool HttpIO::setHttp2Multiplexing(bool, bool)
+{
+    return false;
+}
+
+bool HttpIO::setHappyEyeballs(bool)
+{
+    return false;
+}
+
+bool HttpIO::setHostBandwidthLimit(direction_t, const string&, m_off_t)
+{
+    return false;
+}
+
+bool HttpIO::setBandwidthClassLimit(direction_t, bwclass_t, m_off_t)
+{
+    return false;
+}
+
+bool HttpIO::setDownloadBufferSize(long)
+{
+    return false;
+}
+
+bool HttpIO::setApiCompression(bool)
+{
+    return false;
+}
+
+bool HttpIO::isHostDegraded(const string&)
+{
+    return false;
+}
+
+void HttpIO::hostStalled(const string&)
+{
+}
+
 m_off_t HttpIO::getmaxdownloadspeed()
 {
     return 0;
@@ -352,6 +395,7 @@ void HttpReq::post(MegaClient* client, const char* data, unsigned len)
     outpos = 0;
     notifiedbufpos = 0;
     inpurge = 0;
+    mSegments.clear();
     method = METHOD_POST;
     contentlength = -1;
     lastdata = Waiter::ds;
@@ -403,6 +447,12 @@ void HttpReq::dns(MegaClient *client)
     httpio->post(this);
 }
 
+void HttpReq::prewarm(MegaClient *client, direction_t d)
+{
+    mPrewarmDirection = d;
+    get(client);
+}
+
 void HttpReq::disconnect()
 {
     if (httpio)
@@ -441,7 +491,7 @@ HttpReq::~HttpReq()
         httpio->cancel(this);
     }
 
-    delete[] buf;
+    http_buf_t::deallocate(buf);
 }
 
 void HttpReq::init()
@@ -456,6 +506,7 @@ void HttpReq::init()
     lastdata = NEVER;
     outpos = 0;
     in.clear();
+    mSegments.clear();
     contenttype.clear();
     mRedirectURL.clear();
 }
@@ -497,6 +548,24 @@ void HttpReq::put(void* data, unsigned len, bool purge)
 
         memcpy(buf + bufpos, data, len);
     }
+    else if (mSegmented && contentlength < 0 && !mChunked)
+    {
+        const char* segmentData = static_cast<const char*>(data);
+        size_t remaining = len;
+        while (remaining)
+        {
+            if (mSegments.empty() || mSegments.back().size() == SEGMENT_SIZE)
+            {
+                mSegments.emplace_back();
+                mSegments.back().reserve(SEGMENT_SIZE);
+            }
+
+            size_t chunk = std::min(remaining, SEGMENT_SIZE - mSegments.back().size());
+            mSegments.back().append(segmentData, chunk);
+            segmentData += chunk;
+            remaining -= chunk;
+        }
+    }
     else
     {
         if (inpurge && purge)
@@ -511,6 +580,30 @@ void HttpReq::put(void* data, unsigned len, bool purge)
     bufpos += len;
 }
 
+void HttpReq::joinSegments()
+{
+    if (mSegments.empty())
+    {
+        return;
+    }
+
+    size_t total = in.size();
+    for (const string& segment : mSegments)
+    {
+        total += segment.size();
+    }
+
+    // the pages of a big reservation are only committed as they are written,
+    // so each segment is freed right after being copied
+    in.reserve(total);
+    for (string& segment : mSegments)
+    {
+        in.append(segment);
+        string().swap(segment);
+    }
+    mSegments.clear();
+}
+
 
 HttpReq::http_buf_t::http_buf_t(byte* b, size_t s, size_t e)
     : start(s), end(e), buf(b)
@@ -519,7 +612,18 @@ HttpReq::http_buf_t::http_buf_t(byte* b, size_t s, size_t e)
 
 HttpReq::http_buf_t::~http_buf_t()
 {
-    delete[] buf;
+    deallocate(buf);
+}
+
+byte* HttpReq::http_buf_t::allocate(size_t len)
+{
+    static_assert(TransferBufferPool::HEADER % ALIGNMENT == 0, "pooled buffers must keep the transfer buffer alignment");
+    return TransferBufferPool::instance().allocate(len);
+}
+
+void HttpReq::http_buf_t::deallocate(byte* b)
+{
+    TransferBufferPool::instance().deallocate(b);
 }
 
 void HttpReq::http_buf_t::swap(http_buf_t& other)
@@ -633,7 +737,7 @@ byte* HttpReq::reserveput(unsigned* len)
 // number of bytes transferred in this request
 m_off_t HttpReq::transferred(MegaClient*)
 {
-    if (buf)
+    if (buf || !mSegments.empty())
     {
         return bufpos;
     }
@@ -674,14 +778,14 @@ void HttpReqDL::prepare(const char* tempurl, SymmCipher* /*key*/,
         // (re)allocate buffer
         if (buf)
         {
-            delete[] buf;
+            http_buf_t::deallocate(buf);
             buf = NULL;
         }
 
         if (size)
         {
-            buf = new byte[(size + SymmCipher::BLOCKSIZE - 1) &
-                           ~(static_cast<size_t>(SymmCipher::BLOCKSIZE) - 1)];
+            buf = http_buf_t::allocate((size + SymmCipher::BLOCKSIZE - 1) &
+                                       ~(static_cast<size_t>(SymmCipher::BLOCKSIZE) - 1));
         }
         buflen = size;
     }
@@ -771,13 +875,56 @@ bool EncryptByChunks::encrypt(m_off_t pos, m_off_t npos, string& urlSuffix)
     assert(endpos == finalpos);
     buf = nextbuffer(0);   // last call in case caller does buffer post-processing (such as write to file as we go)
 
-    ostringstream s;
-    s << "/" << pos << "?d=" << Base64Str<EncryptByChunks::CRCSIZE>(crc);
-    urlSuffix = s.str();
+    urlSuffix = EncryptByChunks::urlSuffix(pos, crc);
 
     return !!buf;
 }
 
+bool EncryptByChunks::encryptPart(m_off_t pos, m_off_t npos, unsigned part, unsigned parts, byte* partsCrc)
+{
+    m_off_t startpos = pos;
+    m_off_t endpos = ChunkedHash::chunkceil(startpos, npos);
+    m_off_t chunksize = endpos - startpos;
+    for (unsigned index = 0; chunksize; ++index)
+    {
+        // the other parts' chunks are skipped, but their buffers still have to be walked past
+        byte* buf = nextbuffer(unsigned(chunksize));
+        if (!buf) return false;
+
+        if (index % parts == part)
+        {
+            macs->ctr_encrypt(startpos,
+                              key,
+                              buf,
+                              unsigned(chunksize),
+                              startpos,
+                              static_cast<int64_t>(ctriv),
+                              false);
+
+            LOG_debug << "Encrypted chunk: " << startpos << " - " << endpos << "   Size: " << chunksize << " [part " << part << "/" << parts << "]";
+
+            updateCRC(buf, unsigned(chunksize), unsigned(startpos - pos));
+        }
+
+        startpos = endpos;
+        endpos = ChunkedHash::chunkceil(startpos, npos);
+        chunksize = endpos - startpos;
+    }
+
+    for (unsigned i = 0; i < CRCSIZE; ++i)
+    {
+        partsCrc[i] ^= crc[i];
+    }
+    return true;
+}
+
+string EncryptByChunks::urlSuffix(m_off_t pos, const byte* crc)
+{
+    ostringstream s;
+    s << "/" << pos << "?d=" << Base64Str<EncryptByChunks::CRCSIZE>(crc);
+    return s.str();
+}
+
 
 EncryptBufferByChunks::EncryptBufferByChunks(byte* b, SymmCipher* k, chunkmac_map* m, uint64_t iv)
     : EncryptByChunks(k, m, iv)
@@ -809,6 +956,59 @@ void HttpReqUL::prepare(const char* tempurl, SymmCipher* key,
     setreq((tempurl + urlSuffix).c_str(), REQ_BINARY);
 }
 
+unsigned HttpReqUL::prepareParts(m_off_t pos, m_off_t npos, unsigned workers)
+{
+    m_off_t parts = (npos - pos) / PREPARE_PART_SIZE;
+    parts = std::max<m_off_t>(1, std::min<m_off_t>(parts, workers));
+
+    if (parts > 1)
+    {
+        // the jobs may only update existing entries
+        for (m_off_t startpos = pos; startpos < npos; startpos = ChunkedHash::chunkceil(startpos, npos))
+        {
+            mChunkmacs.addEntry(startpos);
+        }
+
+        std::lock_guard<std::mutex> g(mPartsMutex);
+        mPendingParts = static_cast<unsigned>(parts);
+        memset(mPartsCrc, 0, sizeof mPartsCrc);
+    }
+    return static_cast<unsigned>(parts);
+}
+
+bool HttpReqUL::preparePart(const char* tempurl, SymmCipher* key,
+                            uint64_t ctriv, m_off_t pos,
+                            m_off_t npos, unsigned part, unsigned parts)
+{
+    if (parts == 1)
+    {
+        prepare(tempurl, key, ctriv, pos, npos);
+        return true;
+    }
+
+    EncryptBufferByChunks eb((byte*)out->data(), key, &mChunkmacs, ctriv);
+    byte crc[EncryptByChunks::CRCSIZE] = {};
+    eb.encryptPart(pos, npos, part, parts, crc);
+
+    std::lock_guard<std::mutex> g(mPartsMutex);
+    for (unsigned i = 0; i < EncryptByChunks::CRCSIZE; ++i)
+    {
+        mPartsCrc[i] ^= crc[i];
+    }
+
+    if (--mPendingParts)
+    {
+        return false;
+    }
+
+    // unpad for POSTing
+    size = (unsigned)(npos - pos);
+    out->resize(size);
+
+    setreq((tempurl + EncryptByChunks::urlSuffix(pos, mPartsCrc)).c_str(), REQ_BINARY);
+    return true;
+}
+
 // number of bytes sent in this request
 m_off_t HttpReqUL::transferred(MegaClient* client)
 {
@@ -1084,4 +1284,209 @@ m_off_t SpeedController::aggregateProgressForTimePeriod(dstime timePeriodToAggre
     return (timePeriodToAggregate * bytesToAggregate) / totalTime;
 }
 
+void TokenBucket::setRate(m_off_t bps, clock::time_point now)
+{
+    if (!mRate)
+    {
+        // start with a full burst when going from unlimited to limited
+        mTokens = static_cast<double>(bps);
+    }
+    else
+    {
+        refill(now);
+        mTokens = std::min(mTokens, static_cast<double>(bps));
+    }
+
+    mRate = bps;
+    mRefilled = now;
+}
+
+m_off_t TokenBucket::available(clock::time_point now)
+{
+    if (!mRate)
+    {
+        return std::numeric_limits<m_off_t>::max();
+    }
+
+    refill(now);
+    return mTokens > 0 ? static_cast<m_off_t>(mTokens) : 0;
+}
+
+void TokenBucket::consume(m_off_t bytes)
+{
+    if (mRate)
+    {
+        mTokens -= static_cast<double>(bytes);
+    }
+}
+
+void TokenBucket::refill(clock::time_point now)
+{
+    if (now > mRefilled)
+    {
+        std::chrono::duration<double> elapsed = now - mRefilled;
+        mTokens = std::min(mTokens + elapsed.count() * static_cast<double>(mRate), static_cast<double>(mRate));
+        mRefilled = now;
+    }
+}
+
+
+namespace {
+
+// stored just before every buffer handed out by the pool
+struct PooledBufferHeader
+{
+    size_t sizeClass;   // NOT_POOLED for the ones bigger than the largest class
+    size_t bytes;
+    size_t alignment;
+};
+
+constexpr size_t NOT_POOLED = ~size_t(0);
+
+} // namespace
+
+TransferBufferPool& TransferBufferPool::instance()
+{
+    // never destroyed: buffers may still be released by static objects on exit
+    static TransferBufferPool* pool = new TransferBufferPool;
+    return *pool;
+}
+
+TransferBufferPool::TransferBufferPool()
+    : mFree(classFor(MAX_CLASS_SIZE) + 1)
+{
+    static_assert(sizeof(PooledBufferHeader) <= HEADER, "the header must fit before the buffer");
+}
+
+size_t TransferBufferPool::classSize(size_t sizeClass)
+{
+    return (MIN_CLASS_SIZE << (sizeClass / 4)) / 4 * (4 + sizeClass % 4);
+}
+
+size_t TransferBufferPool::classFor(size_t len)
+{
+    size_t sizeClass = 0;
+    while (classSize(sizeClass) < len)
+    {
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+byte* TransferBufferPool::allocate(size_t len)
+{
+    size_t sizeClass = len <= MAX_CLASS_SIZE ? classFor(len) : NOT_POOLED;
+    size_t bytes = sizeClass == NOT_POOLED ? len : classSize(sizeClass);
+
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mInUseBytes += bytes;
+        mPeakInUseBytes = std::max(mPeakInUseBytes, mInUseBytes);
+
+        if (sizeClass != NOT_POOLED && !mFree[sizeClass].empty())
+        {
+            byte* b = mFree[sizeClass].back();
+            mFree[sizeClass].pop_back();
+            mCachedBytes -= bytes;
+            ++mReused;
+            return b;
+        }
+        ++mAllocated;
+    }
+
+    size_t alignment = bytes >= HUGEPAGE_SIZE ? HUGEPAGE_SIZE : HEADER;
+    byte* raw = static_cast<byte*>(::operator new[](HEADER + bytes, std::align_val_t(alignment)));
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (alignment == HUGEPAGE_SIZE)
+    {
+        madvise(raw, HEADER + bytes, MADV_HUGEPAGE);   // only a hint, fine if transparent hugepages are off
+    }
+#endif
+
+    auto header = reinterpret_cast<PooledBufferHeader*>(raw);
+    header->sizeClass = sizeClass;
+    header->bytes = bytes;
+    header->alignment = alignment;
+    return raw + HEADER;
+}
+
+void TransferBufferPool::deallocate(byte* b)
+{
+    if (!b)
+    {
+        return;
+    }
+
+    byte* raw = b - HEADER;
+    auto header = reinterpret_cast<PooledBufferHeader*>(raw);
+
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        assert(mInUseBytes >= header->bytes);
+        mInUseBytes -= header->bytes;
+
+        if (header->sizeClass != NOT_POOLED && mCachedBytes + header->bytes <= mMaxCachedBytes)
+        {
+            mFree[header->sizeClass].push_back(b);
+            mCachedBytes += header->bytes;
+            return;
+        }
+    }
+
+    ::operator delete[](raw, std::align_val_t(header->alignment));
+}
+
+void TransferBufferPool::setMaxCachedBytes(size_t bytes)
+{
+    std::vector<byte*> release;
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mMaxCachedBytes = bytes;
+
+        // drop the largest buffers first, they are the least likely to be reused
+        for (size_t sizeClass = mFree.size(); sizeClass-- && mCachedBytes > mMaxCachedBytes; )
+        {
+            auto& buffers = mFree[sizeClass];
+            while (!buffers.empty() && mCachedBytes > mMaxCachedBytes)
+            {
+                release.push_back(buffers.back());
+                buffers.pop_back();
+                mCachedBytes -= classSize(sizeClass);
+            }
+        }
+    }
+
+    for (byte* b : release)
+    {
+        byte* raw = b - HEADER;
+        ::operator delete[](raw, std::align_val_t(reinterpret_cast<PooledBufferHeader*>(raw)->alignment));
+    }
+}
+
+std::string TransferBufferPool::report(bool reset)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    std::ostringstream s;
+    s << " transfer buffers in use/peak/cached: " << mInUseBytes << "/" << mPeakInUseBytes << "/" << mCachedBytes
+      << " reused/allocated: " << mReused << "/" << mAllocated;
+    if (reset)
+    {
+        mPeakInUseBytes = mInUseBytes;
+        mReused = mAllocated = 0;
+    }
+    return s.str();
+}
+
+size_t TransferBufferPool::inUseBytes()
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return mInUseBytes;
+}
+
+size_t TransferBufferPool::cachedBytes()
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return mCachedBytes;
+}
 } // namespace
@@ -21,25 +21,148 @@
 #include <cctype>
 #include <cstdint>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MEGA_JSON_SCAN_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MEGA_JSON_SCAN_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define MEGA_JSON_SCAN_NEON 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define MEGA_JSON_NO_SANITIZE_ADDRESS
+#elif defined(__clang__) || defined(__GNUC__)
+// the aligned loads may go past the end of the buffer, within the page of its NUL
+#define MEGA_JSON_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#define MEGA_JSON_NO_SANITIZE_ADDRESS
+#endif
+
 #include "mega/json.h"
 #include "mega/base64.h"
 #include "mega/megaclient.h"
 #include "mega/logging.h"
 #include "mega/mega_utf8proc.h"
 
+#undef MEGA_LOG_UNIT_MAX_LEVEL
+#define MEGA_LOG_UNIT_MAX_LEVEL MEGA_JSON_LOG_MAX_LEVEL
+
 namespace mega {
 
 std::atomic<bool> gLogJSONRequests{false};
 
 #define JSON_verbose if (gLogJSONRequests) LOG_verbose
 
+namespace {
+
+#if defined(MEGA_JSON_SCAN_AVX2) || defined(MEGA_JSON_SCAN_SSE2)
+unsigned firstBit(unsigned mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+bool endsString(char c)
+{
+    return c == '"' || c == '\\' || !c;
+}
+
+} // namespace
+
+MEGA_JSON_NO_SANITIZE_ADDRESS
+const char* JSON::scanString(const char* ptr)
+{
+#if defined(MEGA_JSON_SCAN_AVX2) || defined(MEGA_JSON_SCAN_SSE2) || defined(MEGA_JSON_SCAN_NEON)
+#if defined(MEGA_JSON_SCAN_AVX2)
+    constexpr uintptr_t blockSize = 32;
+#else
+    constexpr uintptr_t blockSize = 16;
+#endif
+
+    // byte by byte up to an aligned block, so no load crosses a page boundary
+    while (reinterpret_cast<uintptr_t>(ptr) & (blockSize - 1))
+    {
+        if (endsString(*ptr))
+        {
+            return ptr;
+        }
+        ptr++;
+    }
+
+#if defined(MEGA_JSON_SCAN_AVX2)
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i zero = _mm256_setzero_si256();
+    for (;; ptr += blockSize)
+    {
+        const __m256i block = _mm256_load_si256(reinterpret_cast<const __m256i*>(ptr));
+        const __m256i found = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, quote),
+                                                              _mm256_cmpeq_epi8(block, backslash)),
+                                              _mm256_cmpeq_epi8(block, zero));
+        if (unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(found)))
+        {
+            return ptr + firstBit(mask);
+        }
+    }
+#elif defined(MEGA_JSON_SCAN_SSE2)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i zero = _mm_setzero_si128();
+    for (;; ptr += blockSize)
+    {
+        const __m128i block = _mm_load_si128(reinterpret_cast<const __m128i*>(ptr));
+        const __m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                                                        _mm_cmpeq_epi8(block, backslash)),
+                                           _mm_cmpeq_epi8(block, zero));
+        if (unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(found)))
+        {
+            return ptr + firstBit(mask);
+        }
+    }
+#else
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    for (;; ptr += blockSize)
+    {
+        const uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t*>(ptr));
+        const uint8x16_t found = vorrq_u8(vorrq_u8(vceqq_u8(block, quote), vceqq_u8(block, backslash)),
+                                          vceqzq_u8(block));
+        if (vmaxvq_u8(found))
+        {
+            // NEON has no movemask, the block is checked again byte by byte
+            while (!endsString(*ptr))
+            {
+                ptr++;
+            }
+            return ptr;
+        }
+    }
+#endif
+#else
+    while (!endsString(*ptr))
+    {
+        ptr++;
+    }
+    return ptr;
+#endif
+}
+
 // store array or object in string s
 // reposition after object
 bool JSON::storeobject(string* s)
 {
     int openobject[2] = { 0 };
     const char* ptr;
-    bool escaped = false;
 
     while (*(const signed char*)pos > 0 && *pos <= ' ')
     {
@@ -74,15 +197,15 @@ bool JSON::storeobject(string* s)
         }
         else if (*ptr == '"')
         {
-            ptr++;
+            ptr = scanString(ptr + 1);
 
-            while (*ptr && (escaped || *ptr != '"'))
+            // escaped characters are skipped along with their backslash
+            while (*ptr == '\\' && ptr[1])
             {
-                escaped = *ptr == '\\' && !escaped;
-                ptr++;
+                ptr = scanString(ptr + 2);
             }
 
-            if (!*ptr)
+            if (*ptr != '"')
             {
                 LOG_err << "Parse error (\")";
                 return false;
@@ -412,16 +535,25 @@ bool JSON::ishandle(int size)
 // decode handle
 handle JSON::gethandle(int size)
 {
-    byte buf[9] = { 0 };
+    if (*pos == ',')
+    {
+        pos++;
+    }
 
-    // no arithmetic or semantic comparisons will be performed on handles, so
-    // no endianness issues
-    if (storebinary(buf, sizeof buf) == size)
+    if (*pos != '"')
     {
-        return MemAccess::get<handle>((const char*)buf);
+        return UNDEF;
     }
 
-    return UNDEF;
+    // no arithmetic or semantic comparisons will be performed on handles, so
+    // no endianness issues
+    handle h;
+    bool decoded = Base64::atob(pos + 1, h, size);
+
+    // skip string
+    storeobject();
+
+    return decoded ? h : UNDEF;
 }
 
 NodeHandle JSON::getNodeHandle()
@@ -793,13 +925,81 @@ string JSON::stripWhitespace(const char* text)
     return result;
 }
 
+namespace {
+
+struct ThreadBufferPool
+{
+    std::vector<string> buffers;
+    ~ThreadBufferPool();
+};
+
+// trivially destructible, so it can still be checked by writers destroyed after the pool
+thread_local bool tBufferPoolDestroyed = false;
+
+ThreadBufferPool::~ThreadBufferPool()
+{
+    tBufferPoolDestroyed = true;
+}
+
+std::vector<string>* threadBuffers()
+{
+    thread_local ThreadBufferPool pool;
+    return tBufferPoolDestroyed ? nullptr : &pool.buffers;
+}
+
+} // namespace
+
+string JSONBufferPool::acquire()
+{
+    std::vector<string>* buffers = threadBuffers();
+    if (!buffers || buffers->empty())
+    {
+        return string();
+    }
+
+    string buffer = std::move(buffers->back());
+    buffers->pop_back();
+    return buffer;
+}
+
+void JSONBufferPool::release(string&& buffer)
+{
+    // nothing to reuse from the ones that fit in the string object itself
+    if (buffer.capacity() <= string().capacity() || buffer.capacity() > MAX_CAPACITY)
+    {
+        return;
+    }
+
+    std::vector<string>* buffers = threadBuffers();
+    if (!buffers || buffers->size() >= MAX_BUFFERS)
+    {
+        return;
+    }
+
+    buffer.clear();
+    buffers->push_back(std::move(buffer));
+}
+
 JSONWriter::JSONWriter()
-  : mJson()
+  : mJson(JSONBufferPool::acquire())
   , mLevels()
   , mLevel(-1)
 {
 }
 
+JSONWriter::JSONWriter(const JSONWriter& other)
+  : mJson(JSONBufferPool::acquire())
+  , mLevels(other.mLevels)
+  , mLevel(other.mLevel)
+{
+    mJson.append(other.mJson);
+}
+
+JSONWriter::~JSONWriter()
+{
+    JSONBufferPool::release(std::move(mJson));
+}
+
 void JSONWriter::cmd(const char* cmd)
 {
     mJson.append("\"a\":\"");
@@ -814,12 +1014,7 @@ void JSONWriter::notself(MegaClient* client)
     mJson.append("\"");
 }
 
-void JSONWriter::arg(const char* name, const string& value, int quotes)
-{
-    arg(name, value.c_str(), quotes);
-}
-
-void JSONWriter::arg(const char* name, const char* value, int quotes)
+void JSONWriter::arg(const char* name, std::string_view value, int quotes)
 {
     addcomma();
     mJson.append("\"");
@@ -833,6 +1028,16 @@ void JSONWriter::arg(const char* name, const char* value, int quotes)
     }
 }
 
+void JSONWriter::arg(const char* name, const string& value, int quotes)
+{
+    arg(name, std::string_view(value), quotes);
+}
+
+void JSONWriter::arg(const char* name, const char* value, int quotes)
+{
+    arg(name, std::string_view(value), quotes);
+}
+
 void JSONWriter::arg(const char* name, handle h, int len)
 {
     char buf[16];
@@ -850,13 +1055,12 @@ void JSONWriter::arg(const char* name, NodeHandle h)
 
 void JSONWriter::arg(const char* name, const byte* value, int len)
 {
-    char* buf = new char[static_cast<size_t>(len * 4 / 3 + 4)];
-
-    Base64::btoa(value, len, buf);
-
-    arg(name, buf);
-
-    delete[] buf;
+    addcomma();
+    mJson.append("\"");
+    mJson.append(name);
+    mJson.append("\":\"");
+    appendB64(value, len);
+    mJson.append("\"");
 }
 
 void JSONWriter::arg_B64(const char* n, const string& data)
@@ -869,14 +1073,28 @@ void JSONWriter::arg_fsfp(const char* n, std::uint64_t fp)
     arg(n, (const byte*)&fp, int(sizeof(fp)));
 }
 
+void JSONWriter::arg_stringWithEscapes(const char* name, std::string_view value, int quote)
+{
+    addcomma();
+    mJson.append("\"");
+    mJson.append(name);
+    mJson.append(quote ? "\":\"" : "\":");
+    appendEscaped(mJson, value);
+
+    if (quote)
+    {
+        mJson.append("\"");
+    }
+}
+
 void JSONWriter::arg_stringWithEscapes(const char* name, const string& value, int quote)
 {
-    arg(name, escape(value.c_str(), value.size()), quote);
+    arg_stringWithEscapes(name, std::string_view(value), quote);
 }
 
 void JSONWriter::arg_stringWithEscapes(const char* name, const char* value, int quote)
 {
-    arg(name, escape(value, strlen(value)), quote);
+    arg_stringWithEscapes(name, std::string_view(value), quote);
 }
 
 void JSONWriter::arg(const char* name, m_off_t n)
@@ -969,15 +1187,8 @@ void JSONWriter::element(handle h, int len)
 
 void JSONWriter::element(const byte* data, int len)
 {
-    char* buf = new char[static_cast<size_t>(len * 4 / 3 + 4)];
-
-    len = Base64::btoa(data, len, buf);
-
     mJson.append(elements() ? ",\"" : "\"");
-    mJson.append(buf, static_cast<size_t>(len));
-
-    delete[] buf;
-
+    appendB64(data, len);
     mJson.append("\"");
 }
 
@@ -1036,12 +1247,27 @@ int JSONWriter::elements()
     return 1;
 }
 
+void JSONWriter::appendB64(const byte* data, int len)
+{
+    // room for the terminator written by btoa()
+    size_t start = mJson.size();
+    mJson.resize(start + static_cast<size_t>(len * 4 / 3 + 4));
+    int written = Base64::btoa(data, len, &mJson[start]);
+    mJson.resize(start + static_cast<size_t>(written));
+}
+
 string JSONWriter::escape(const char* data, size_t length) const
 {
-    const utf8proc_uint8_t* current = reinterpret_cast<const utf8proc_uint8_t *>(data);
-    utf8proc_ssize_t remaining = static_cast<utf8proc_ssize_t>(length);
-    utf8proc_int32_t codepoint = 0;
     string result;
+    appendEscaped(result, std::string_view(data, length));
+    return result;
+}
+
+void JSONWriter::appendEscaped(string& result, std::string_view data)
+{
+    const utf8proc_uint8_t* current = reinterpret_cast<const utf8proc_uint8_t *>(data.data());
+    utf8proc_ssize_t remaining = static_cast<utf8proc_ssize_t>(data.size());
+    utf8proc_int32_t codepoint = 0;
 
     while (remaining > 0)
     {
@@ -1071,8 +1297,6 @@ string JSONWriter::escape(const char* data, size_t length) const
             break;
         }
     }
-
-    return result;
 }
 
 JSONSplitter::JSONSplitter()
@@ -1438,19 +1662,15 @@ bool JSONSplitter::isStarting()
 
 int JSONSplitter::strEnd()
 {
-    const char* ptr = mPos;
-    while ((ptr = strchr(ptr + 1, '"')))
+    const char* ptr = JSON::scanString(mPos + 1);
+    while (*ptr == '\\' && ptr[1])
     {
-        const char *e = ptr;
-        while (*(--e) == '\\')
-        {
-            // noop
-        }
+        ptr = JSON::scanString(ptr + 2);
+    }
 
-        if ((ptr - e) & 1)
-        {
-            return int(ptr + 1 - mPos);
-        }
+    if (*ptr == '"')
+    {
+        return int(ptr + 1 - mPos);
     }
 
     return -1;
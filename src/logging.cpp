@@ -24,6 +24,7 @@
 
 #include "mega/logging.h"
 
+#include <algorithm>
 #include <ctime>
 
 namespace mega {
@@ -31,6 +32,9 @@ namespace mega {
 ExternalLogger g_externalLogger;
 ExclusiveLogger g_exclusiveLogger;
 
+// after its targets, so it goes first, delivering what it still holds
+AsyncLogger g_asyncLogger;
+
 Logger *SimpleLogger::logger = &g_externalLogger;
 
 // by the default, display logs with level equal or less than logInfo
@@ -181,4 +185,339 @@ void ExclusiveLogger::log(const char *time, int loglevel, const char *source, co
     );
 }
 
+// A ring buffer written by one thread and read by another, of records prefixed by their size.
+class LogRing
+{
+public:
+    explicit LogRing(size_t capacity)
+      : mData(new char[capacity])
+      , mCapacity(capacity)
+    {
+    }
+
+    // producer: appends a record made of these pieces, if there is room for it
+    bool push(std::initializer_list<std::pair<const void*, size_t>> pieces)
+    {
+        uint32_t size = sizeof(uint32_t);
+        for (auto& piece : pieces)
+        {
+            size += static_cast<uint32_t>(piece.second);
+        }
+
+        size_t head = mHead.load(std::memory_order_relaxed);
+        if (mCapacity - (head - mTail.load(std::memory_order_acquire)) < size)
+        {
+            return false;
+        }
+
+        head = put(head, &size, sizeof size);
+        for (auto& piece : pieces)
+        {
+            head = put(head, piece.first, piece.second);
+        }
+        mHead.store(head, std::memory_order_release);
+        return true;
+    }
+
+    // consumer: takes the oldest record, without its size
+    bool pop(std::string& record)
+    {
+        size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail == mHead.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        uint32_t size;
+        get(tail, &size, sizeof size);
+        record.resize(size - sizeof size);
+        get(tail + sizeof size, &record[0], record.size());
+        mTail.store(tail + size, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return mTail.load(std::memory_order_acquire) == mHead.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return mCapacity; }
+
+    // by the producer
+    std::atomic<uint64_t> mDropped{0};
+    std::atomic<bool> mAbandoned{false};
+
+    // by the consumer: the drops logged already
+    uint64_t mReported = 0;
+
+private:
+    size_t put(size_t position, const void* data, size_t size)
+    {
+        size_t offset = position % mCapacity;
+        size_t first = std::min(size, mCapacity - offset);
+        memcpy(mData.get() + offset, data, first);
+        memcpy(mData.get(), static_cast<const char*>(data) + first, size - first);
+        return position + size;
+    }
+
+    void get(size_t position, void* data, size_t size) const
+    {
+        size_t offset = position % mCapacity;
+        size_t first = std::min(size, mCapacity - offset);
+        memcpy(data, mData.get() + offset, first);
+        memcpy(static_cast<char*>(data) + first, mData.get(), size - first);
+    }
+
+    std::unique_ptr<char[]> mData;
+    const size_t mCapacity;
+
+    // bytes ever written and read: the difference is what's waiting
+    std::atomic<size_t> mHead{0};
+    std::atomic<size_t> mTail{0};
+};
+
+namespace {
+
+// The record's fields are stored with their terminating null, so that the drain thread can pass
+// them on from the record itself.
+struct LogRecordHeader
+{
+    int32_t level;
+    uint32_t timeSize;    // zero when there is no time
+    uint32_t sourceSize;  // zero when there is no source
+};
+
+// the ring of the thread, for the one logger it was last used with
+struct ThreadLogRing
+{
+    unsigned owner = 0;
+    std::shared_ptr<LogRing> ring;
+
+    ~ThreadLogRing()
+    {
+        if (ring)
+        {
+            ring->mAbandoned = true;
+        }
+    }
+};
+
+thread_local ThreadLogRing tThreadLogRing;
+
+// how often the drain thread looks for messages, when there are none
+constexpr auto LOG_DRAIN_INTERVAL = std::chrono::milliseconds(20);
+
+} // namespace
+
+std::atomic<unsigned> AsyncLogger::sNextId{1};
+
+AsyncLogger::AsyncLogger(size_t ringSize)
+  : mId(sNextId++)
+  , mRingSize(std::max<size_t>(ringSize, 4096))
+{
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mExiting = true;
+    }
+    mWakeup.notify_all();
+
+    if (mThread.joinable())
+    {
+        mThread.join();
+    }
+}
+
+void AsyncLogger::setTarget(Logger* target)
+{
+    mTarget = target;
+
+    std::lock_guard<std::mutex> g(mMutex);
+    if (target && !mThread.joinable() && !mExiting)
+    {
+        mThread = std::thread([this]() { drain(); });
+    }
+}
+
+LogRing& AsyncLogger::ring()
+{
+    auto& local = tThreadLogRing;
+    if (local.owner != mId || !local.ring)
+    {
+        if (local.ring)
+        {
+            local.ring->mAbandoned = true;
+        }
+
+        local.owner = mId;
+        local.ring = std::make_shared<LogRing>(mRingSize);
+
+        std::lock_guard<std::mutex> g(mMutex);
+        mRings.push_back(local.ring);
+    }
+    return *local.ring;
+}
+
+void AsyncLogger::log(const char *time, int loglevel, const char *source, const char *message
+#ifdef ENABLE_LOG_PERFORMANCE
+    , const char **directMessages, size_t *directMessagesSizes, unsigned numberMessages
+#endif
+)
+{
+    LogRing& r = ring();
+
+    LogRecordHeader header{loglevel,
+                           static_cast<uint32_t>(time ? strlen(time) + 1 : 0),
+                           static_cast<uint32_t>(source ? strlen(source) + 1 : 0)};
+
+    // the message is put together here: the direct messages point into the caller's buffers
+    std::pair<const void*, size_t> text{message ? message : "", message ? strlen(message) : 0};
+#ifdef ENABLE_LOG_PERFORMANCE
+    std::string joined;
+    if (numberMessages)
+    {
+        joined.assign(static_cast<const char*>(text.first), text.second);
+        for (unsigned i = 0; i < numberMessages; ++i)
+        {
+            joined.append(directMessages[i], directMessagesSizes[i]);
+        }
+        text = {joined.data(), joined.size()};
+    }
+#endif
+
+    // a huge payload only gets its beginning through, rather than nothing
+    size_t fixed = sizeof(uint32_t) + sizeof header + header.timeSize + header.sourceSize + 1;
+    size_t limit = r.capacity() / 4;
+    if (fixed + text.second > limit)
+    {
+        text.second = fixed < limit ? limit - fixed : 0;
+    }
+
+    if (!r.push({{&header, sizeof header},
+                 {time, header.timeSize},
+                 {source, header.sourceSize},
+                 {text.first, text.second},
+                 {"", 1}}))
+    {
+        ++r.mDropped;
+        ++mDropped;
+        return;
+    }
+
+    if (loglevel == logFatal)
+    {
+        flush();
+    }
+}
+
+void AsyncLogger::flush()
+{
+    std::unique_lock<std::mutex> g(mMutex);
+    if (!mThread.joinable() || mThread.get_id() == std::this_thread::get_id())
+    {
+        return;
+    }
+
+    auto requested = ++mFlushRequested;
+    mWakeup.notify_all();
+    mFlushed.wait(g, [&]() { return mFlushCompleted >= requested || mExiting; });
+}
+
+bool AsyncLogger::deliver(LogRing& ring, std::string& record)
+{
+    Logger* target = mTarget;
+    bool delivered = false;
+
+    while (ring.pop(record))
+    {
+        delivered = true;
+        if (!target)
+        {
+            continue;
+        }
+
+        LogRecordHeader header;
+        memcpy(&header, record.data(), sizeof header);
+
+        const char* fields = record.data() + sizeof header;
+        const char* time = header.timeSize ? fields : nullptr;
+        const char* source = header.sourceSize ? fields + header.timeSize : nullptr;
+        const char* message = fields + header.timeSize + header.sourceSize;
+
+        target->log(time, header.level, source, message
+#ifdef ENABLE_LOG_PERFORMANCE
+                    , nullptr, nullptr, 0
+#endif
+        );
+    }
+
+    uint64_t dropped = ring.mDropped;
+    if (dropped != ring.mReported && target)
+    {
+        string message = "[AsyncLogger] " + std::to_string(dropped - ring.mReported) + " log messages dropped";
+        target->log(nullptr, logWarning, nullptr, message.c_str()
+#ifdef ENABLE_LOG_PERFORMANCE
+                    , nullptr, nullptr, 0
+#endif
+        );
+        ring.mReported = dropped;
+    }
+
+    return delivered;
+}
+
+void AsyncLogger::drain()
+{
+    // the outputs might log themselves
+    SimpleLogger::mThreadLocalLoggingDisabled = true;
+
+    std::string record;
+    std::vector<std::shared_ptr<LogRing>> rings;
+
+    std::unique_lock<std::mutex> g(mMutex);
+    for (;;)
+    {
+        auto flushing = mFlushRequested;
+        rings = mRings;
+        g.unlock();
+
+        bool delivered = false;
+        for (auto& r : rings)
+        {
+            delivered |= deliver(*r, record);
+        }
+
+        g.lock();
+
+        // the rings of threads gone, once emptied
+        mRings.erase(std::remove_if(mRings.begin(), mRings.end(), [](const std::shared_ptr<LogRing>& r)
+                                    {
+                                        return r->mAbandoned && r->empty();
+                                    }),
+                     mRings.end());
+
+        if (mFlushCompleted != flushing)
+        {
+            mFlushCompleted = flushing;
+            mFlushed.notify_all();
+        }
+
+        if (delivered || mFlushRequested != mFlushCompleted)
+        {
+            continue;
+        }
+
+        if (mExiting)
+        {
+            mFlushed.notify_all();
+            return;
+        }
+
+        mWakeup.wait_for(g, LOG_DRAIN_INTERVAL);
+    }
+}
+
 } // namespace
@@ -737,18 +737,15 @@ bool MediaFileInfo::timeToRetryMediaPropertyExtraction(const std::string& fileat
     return false;
 }
 
-bool mediaInfoOpenFileWithLimits(MediaInfoLib::MediaInfo& mi, LocalPath& filename, FileAccess* fa, unsigned maxBytesToRead, unsigned maxSeconds)
+// Feeds mediainfoLib the file's first and last bytes, read already, and anything else it seeks
+// to through 'read', within the limits. Without 'read', the header and footer have to do.
+static bool mediaInfoOpenWithLimits(MediaInfoLib::MediaInfo& mi, m_off_t filesize, const string& header, const string& footer,
+                                    const std::function<bool(byte*, unsigned, m_off_t)>& read, unsigned maxBytesToRead, unsigned maxSeconds)
 {
-    if (!fa->fopen(filename, true, false, FSLogging::logOnError))
-    {
-        LOG_err << "could not open local file for mediainfo";
-        return false;
-    }
-
-    m_off_t filesize = fa->size;
     size_t totalBytesRead = 0;
     mi.Open_Buffer_Init(static_cast<ZenLib::int64u>(filesize), 0);
     m_off_t readpos = 0;
+    m_off_t footerpos = filesize - static_cast<m_off_t>(footer.size());
     m_time_t startTime = 0;
 
     bool hasVideo = false;
@@ -763,34 +760,48 @@ bool mediaInfoOpenFileWithLimits(MediaInfoLib::MediaInfo& mi, LocalPath& filenam
             break;
         }
 
-        if (totalBytesRead > maxBytesToRead || (startTime != 0 && ((m_time() - startTime) > maxSeconds)))
+        const byte* data = buf;
+        if (readpos < static_cast<m_off_t>(header.size()))
+        {
+            n = unsigned(std::min<m_off_t>(n, static_cast<m_off_t>(header.size()) - readpos));
+            data = reinterpret_cast<const byte*>(header.data()) + readpos;
+        }
+        else if (readpos >= footerpos)
+        {
+            data = reinterpret_cast<const byte*>(footer.data()) + (readpos - footerpos);
+        }
+        else
         {
-            if (hasVideo && vidDuration)
+            if (!read || totalBytesRead > maxBytesToRead || (startTime != 0 && ((m_time() - startTime) > maxSeconds)))
             {
-                break;
+                if (hasVideo && vidDuration)
+                {
+                    break;
+                }
+
+                LOG_warn << (read ? "could not extract mediainfo data within reasonable limits"
+                                  : "mediainfo needs more of the file than its header and footer");
+                mi.Open_Buffer_Finalize();
+                return false;
             }
 
-            LOG_warn << "could not extract mediainfo data within reasonable limits";
-            mi.Open_Buffer_Finalize();
-            fa->closef();
-            return false;
+            n = unsigned(std::min<m_off_t>(n, footerpos - readpos));
+            if (!read(buf, n, readpos))
+            {
+                LOG_err << "could not read local file";
+                mi.Open_Buffer_Finalize();
+                return false;
+            }
+            totalBytesRead += n;
         }
 
-        if (!fa->frawread(buf, n, readpos, true, FSLogging::logOnError))
-        {
-            LOG_err << "could not read local file";
-            mi.Open_Buffer_Finalize();
-            fa->closef();
-            return false;
-        }
         readpos += n;
         if (startTime == 0)
         {
             startTime = m_time();
         }
 
-        totalBytesRead += n;
-        size_t bitfield = mi.Open_Buffer_Continue((byte*)buf, n);
+        size_t bitfield = mi.Open_Buffer_Continue(data, n);
         // flag bitmask --> 1:accepted, 2:filled, 4:updated, 8:finalised
         bool accepted = bitfield & 1;
         bool filled = bitfield & 2;
@@ -824,10 +835,40 @@ bool mediaInfoOpenFileWithLimits(MediaInfoLib::MediaInfo& mi, LocalPath& filenam
     }
 
     mi.Open_Buffer_Finalize();
-    fa->closef();
     return true;
 }
 
+bool mediaInfoOpenFileWithLimits(MediaInfoLib::MediaInfo& mi, LocalPath& filename, FileAccess* fa, unsigned maxBytesToRead, unsigned maxSeconds)
+{
+    if (!fa->fopen(filename, true, false, FSLogging::logOnError))
+    {
+        LOG_err << "could not open local file for mediainfo";
+        return false;
+    }
+
+    // the two ranged reads that are enough for most files, then whatever else mediainfo seeks to
+    m_off_t filesize = fa->size;
+    string header(size_t(std::min<m_off_t>(filesize, MediaProperties::HEADER_READ_SIZE)), '\0');
+    string footer(size_t(std::min<m_off_t>(filesize - m_off_t(header.size()), MediaProperties::FOOTER_READ_SIZE)), '\0');
+
+    if ((!header.empty() && !fa->frawread((byte*)header.data(), unsigned(header.size()), 0, true, FSLogging::logOnError))
+        || (!footer.empty() && !fa->frawread((byte*)footer.data(), unsigned(footer.size()), filesize - m_off_t(footer.size()), true, FSLogging::logOnError)))
+    {
+        LOG_err << "could not read local file";
+        fa->closef();
+        return false;
+    }
+
+    auto read = [fa](byte* buf, unsigned n, m_off_t pos)
+    {
+        return fa->frawread(buf, n, pos, true, FSLogging::logOnError);
+    };
+
+    bool result = mediaInfoOpenWithLimits(mi, filesize, header, footer, read, maxBytesToRead, maxSeconds);
+    fa->closef();
+    return result;
+}
+
 void MediaProperties::extractMediaPropertyFileAttributes(LocalPath& localFilename, FileSystemAccess* fsa)
 {
     if (auto tmpfa = fsa->newfileaccess())
@@ -838,76 +879,7 @@ void MediaProperties::extractMediaPropertyFileAttributes(LocalPath& localFilenam
 
             if (mediaInfoOpenFileWithLimits(minfo, localFilename, tmpfa.get(), 10485760, 3))  // we can read more off local disk
             {
-                if (!minfo.Count_Get(MediaInfoLib::Stream_General, 0))
-                {
-                    LOG_warn << "mediainfo: no general information found in file";
-                }
-                if (!minfo.Count_Get(MediaInfoLib::Stream_Video, 0))
-                {
-                    LOG_warn << "mediainfo: no video information found in file";
-                }
-                if (!minfo.Count_Get(MediaInfoLib::Stream_Audio, 0))
-                {
-                    LOG_warn << "mediainfo: no audio information found in file";
-                    no_audio = true;
-                }
-
-                ZenLib::Ztring gci = minfo.Get(MediaInfoLib::Stream_General, 0, __T("CodecID"), MediaInfoLib::Info_Text);
-                ZenLib::Ztring gf = minfo.Get(MediaInfoLib::Stream_General, 0, __T("Format"), MediaInfoLib::Info_Text);
-                ZenLib::Ztring gd = minfo.Get(MediaInfoLib::Stream_General, 0, __T("Duration"), MediaInfoLib::Info_Text);
-                ZenLib::Ztring vw = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("Width"), MediaInfoLib::Info_Text);
-                ZenLib::Ztring vh = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("Height"), MediaInfoLib::Info_Text);
-                ZenLib::Ztring vd = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("Duration"), MediaInfoLib::Info_Text);
-                ZenLib::Ztring vfr = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("FrameRate"), MediaInfoLib::Info_Text);
-                ZenLib::Ztring vrm = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("FrameRate_Mode"), MediaInfoLib::Info_Text);
-                ZenLib::Ztring vci = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("CodecID"), MediaInfoLib::Info_Text);
-                ZenLib::Ztring vcf = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("Format"), MediaInfoLib::Info_Text);
-                ZenLib::Ztring vr = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("Rotation"), MediaInfoLib::Info_Text);
-                ZenLib::Ztring aci = minfo.Get(MediaInfoLib::Stream_Audio, 0, __T("CodecID"), MediaInfoLib::Info_Text);
-                ZenLib::Ztring acf = minfo.Get(MediaInfoLib::Stream_Audio, 0, __T("Format"), MediaInfoLib::Info_Text);
-                ZenLib::Ztring ad = minfo.Get(MediaInfoLib::Stream_Audio, 0, __T("Duration"), MediaInfoLib::Info_Text);
-
-                if (vr.To_int32u() == 90 || vr.To_int32u() == 270)
-                {
-                    width = vh.To_int32u();
-                    height = vw.To_int32u();
-                }
-                else
-                {
-                    width = vw.To_int32u();
-                    height = vh.To_int32u();
-                }
-
-                fps = vfr.To_int32u();
-                playtime = (coalesce(gd.To_int32u(), coalesce(vd.To_int32u(), ad.To_int32u()))) / 1000;
-                videocodecNames = vci.To_Local();
-                videocodecFormat = vcf.To_Local();
-                audiocodecNames = aci.To_Local();
-                audiocodecFormat = acf.To_Local();
-                containerName = gci.To_Local();
-                containerFormat = gf.To_Local();
-                is_VFR = vrm.To_Local() == "VFR"; // variable frame rate - send through as 0 in fps field
-                if (!fps)
-                {
-                    ZenLib::Ztring vrn = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("FrameRate_Num"), MediaInfoLib::Info_Text);
-                    ZenLib::Ztring vrd = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("FrameRate_Den"), MediaInfoLib::Info_Text);
-                    uint32_t num = vrn.To_int32u();
-                    uint32_t den = vrd.To_int32u();
-                    if (num > 0 && den > 0)
-                    {
-                        fps = (num + den / 2) / den;
-                    }
-                }
-                if (!fps)
-                {
-                    ZenLib::Ztring vro = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("FrameRate_Original"), MediaInfoLib::Info_Text);
-                    fps = vro.To_int32u();
-                }
-
-                if (SimpleLogger::getLogLevel() >= logDebug)
-                {
-                    LOG_debug << "MediaInfo on " << localFilename << " | " << vw.To_Local() << " " << vh.To_Local() << " " << vd.To_Local() << " " << vr.To_Local() << " |\"" << gci.To_Local() << "\",\"" << gf.To_Local() << "\",\"" << vci.To_Local() << "\",\"" << vcf.To_Local() << "\",\"" << aci.To_Local() << "\",\"" << acf.To_Local() << "\"";
-                }
+                readMediaInfo(minfo, localFilename.toPath(false));
             }
         }
         catch (std::exception& e)
@@ -921,6 +893,109 @@ void MediaProperties::extractMediaPropertyFileAttributes(LocalPath& localFilenam
     }
 }
 
+bool MediaProperties::extractMediaPropertyFileAttributes(const std::string& header, const std::string& footer, m_off_t fileSize)
+{
+    if (m_off_t(header.size() + footer.size()) > fileSize)
+    {
+        LOG_err << "media header and footer are larger than the file";
+        return false;
+    }
+
+    try
+    {
+        MediaInfoLib::MediaInfo minfo;
+
+        if (mediaInfoOpenWithLimits(minfo, fileSize, header, footer, nullptr, 0, 0))
+        {
+            readMediaInfo(minfo, "header and footer");
+            return true;
+        }
+    }
+    catch (std::exception& e)
+    {
+        LOG_err << "exception caught reading media file attibutes: " << e.what();
+    }
+    catch (...)
+    {
+        LOG_err << "unknown excption caught reading media file attributes";
+    }
+    return false;
+}
+
+void MediaProperties::readMediaInfo(MediaInfoLib::MediaInfo& minfo, const std::string& source)
+{
+    if (!minfo.Count_Get(MediaInfoLib::Stream_General, 0))
+    {
+        LOG_warn << "mediainfo: no general information found in file";
+    }
+    if (!minfo.Count_Get(MediaInfoLib::Stream_Video, 0))
+    {
+        LOG_warn << "mediainfo: no video information found in file";
+    }
+    if (!minfo.Count_Get(MediaInfoLib::Stream_Audio, 0))
+    {
+        LOG_warn << "mediainfo: no audio information found in file";
+        no_audio = true;
+    }
+
+    ZenLib::Ztring gci = minfo.Get(MediaInfoLib::Stream_General, 0, __T("CodecID"), MediaInfoLib::Info_Text);
+    ZenLib::Ztring gf = minfo.Get(MediaInfoLib::Stream_General, 0, __T("Format"), MediaInfoLib::Info_Text);
+    ZenLib::Ztring gd = minfo.Get(MediaInfoLib::Stream_General, 0, __T("Duration"), MediaInfoLib::Info_Text);
+    ZenLib::Ztring vw = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("Width"), MediaInfoLib::Info_Text);
+    ZenLib::Ztring vh = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("Height"), MediaInfoLib::Info_Text);
+    ZenLib::Ztring vd = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("Duration"), MediaInfoLib::Info_Text);
+    ZenLib::Ztring vfr = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("FrameRate"), MediaInfoLib::Info_Text);
+    ZenLib::Ztring vrm = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("FrameRate_Mode"), MediaInfoLib::Info_Text);
+    ZenLib::Ztring vci = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("CodecID"), MediaInfoLib::Info_Text);
+    ZenLib::Ztring vcf = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("Format"), MediaInfoLib::Info_Text);
+    ZenLib::Ztring vr = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("Rotation"), MediaInfoLib::Info_Text);
+    ZenLib::Ztring aci = minfo.Get(MediaInfoLib::Stream_Audio, 0, __T("CodecID"), MediaInfoLib::Info_Text);
+    ZenLib::Ztring acf = minfo.Get(MediaInfoLib::Stream_Audio, 0, __T("Format"), MediaInfoLib::Info_Text);
+    ZenLib::Ztring ad = minfo.Get(MediaInfoLib::Stream_Audio, 0, __T("Duration"), MediaInfoLib::Info_Text);
+
+    if (vr.To_int32u() == 90 || vr.To_int32u() == 270)
+    {
+        width = vh.To_int32u();
+        height = vw.To_int32u();
+    }
+    else
+    {
+        width = vw.To_int32u();
+        height = vh.To_int32u();
+    }
+
+    fps = vfr.To_int32u();
+    playtime = (coalesce(gd.To_int32u(), coalesce(vd.To_int32u(), ad.To_int32u()))) / 1000;
+    videocodecNames = vci.To_Local();
+    videocodecFormat = vcf.To_Local();
+    audiocodecNames = aci.To_Local();
+    audiocodecFormat = acf.To_Local();
+    containerName = gci.To_Local();
+    containerFormat = gf.To_Local();
+    is_VFR = vrm.To_Local() == "VFR"; // variable frame rate - send through as 0 in fps field
+    if (!fps)
+    {
+        ZenLib::Ztring vrn = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("FrameRate_Num"), MediaInfoLib::Info_Text);
+        ZenLib::Ztring vrd = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("FrameRate_Den"), MediaInfoLib::Info_Text);
+        uint32_t num = vrn.To_int32u();
+        uint32_t den = vrd.To_int32u();
+        if (num > 0 && den > 0)
+        {
+            fps = (num + den / 2) / den;
+        }
+    }
+    if (!fps)
+    {
+        ZenLib::Ztring vro = minfo.Get(MediaInfoLib::Stream_Video, 0, __T("FrameRate_Original"), MediaInfoLib::Info_Text);
+        fps = vro.To_int32u();
+    }
+
+    if (SimpleLogger::getLogLevel() >= logDebug)
+    {
+        LOG_debug << "MediaInfo on " << source << " | " << vw.To_Local() << " " << vh.To_Local() << " " << vd.To_Local() << " " << vr.To_Local() << " |\"" << gci.To_Local() << "\",\"" << gf.To_Local() << "\",\"" << vci.To_Local() << "\",\"" << vcf.To_Local() << "\",\"" << aci.To_Local() << "\",\"" << acf.To_Local() << "\"";
+    }
+}
+
 std::string MediaProperties::convertMediaPropertyFileAttributes(uint32_t fakey[4], MediaFileInfo& mediaInfo)
 {
     containerid = mediaInfo.Lookup(containerName, mediaInfo.mediaCodecs.containers, 0);
@@ -227,6 +227,85 @@ int MegaNodeList::size() const
 
 void MegaNodeList::addNode(MegaNode*) {}
 
+int MegaNodeList::getHandles(MegaHandle*, int) const
+{
+    return 0;
+}
+
+int MegaNodeList::getSizes(int64_t*, int) const
+{
+    return 0;
+}
+
+int MegaNodeList::getCreationTimes(int64_t*, int) const
+{
+    return 0;
+}
+
+int MegaNodeList::getModificationTimes(int64_t*, int) const
+{
+    return 0;
+}
+
+int MegaNodeList::getTypes(int*, int) const
+{
+    return 0;
+}
+
+size_t MegaNodeList::getNamesSize() const
+{
+    return 0;
+}
+
+int MegaNodeList::getNames(char*, size_t, int*, int) const
+{
+    return 0;
+}
+
+MegaNodeChangeList::MegaNodeChangeList() {}
+
+MegaNodeChangeList::~MegaNodeChangeList() {}
+
+MegaNodeChangeList* MegaNodeChangeList::copy() const
+{
+    return nullptr;
+}
+
+int MegaNodeChangeList::size() const
+{
+    return 0;
+}
+
+long long MegaNodeChangeList::getSequenceNumber(int) const
+{
+    return 0;
+}
+
+MegaHandle MegaNodeChangeList::getNodeHandle(int) const
+{
+    return INVALID_HANDLE;
+}
+
+uint64_t MegaNodeChangeList::getChanges(int) const
+{
+    return 0;
+}
+
+MegaHandle MegaNodeChangeList::getSCSN(int) const
+{
+    return INVALID_HANDLE;
+}
+
+long long MegaNodeChangeList::getLastSequenceNumber() const
+{
+    return 0;
+}
+
+bool MegaNodeChangeList::hasMissedChanges() const
+{
+    return false;
+}
+
 MegaTransferList::~MegaTransferList() { }
 
 MegaTransfer *MegaTransferList::get(int)
@@ -239,6 +318,31 @@ int MegaTransferList::size()
     return 0;
 }
 
+int MegaTransferList::getTags(int*, int)
+{
+    return 0;
+}
+
+int MegaTransferList::getStates(int*, int)
+{
+    return 0;
+}
+
+int MegaTransferList::getTransferredBytes(int64_t*, int)
+{
+    return 0;
+}
+
+int MegaTransferList::getTotalBytes(int64_t*, int)
+{
+    return 0;
+}
+
+int MegaTransferList::getNodeHandles(MegaHandle*, int)
+{
+    return 0;
+}
+
 MegaContactRequestList::~MegaContactRequestList() { }
 
 MegaContactRequestList *MegaContactRequestList::copy()
@@ -2158,6 +2262,11 @@ char *MegaApi::getMyRSAPrivateKey()
     return pImpl->getMyRSAPrivateKey();
 }
 
+void MegaApi::setSharedResources(bool enable)
+{
+    MegaApiImpl::setSharedResources(enable);
+}
+
 void MegaApi::setLogLevel(int logLevel)
 {
     MegaApiImpl::setLogLevel(logLevel);
@@ -2183,6 +2292,26 @@ void MegaApi::setLogJSONContent(bool enable)
     MegaApiImpl::setLogJSONContent(enable);
 }
 
+void MegaApi::setLogAsync(bool enable)
+{
+    MegaApiImpl::setLogAsync(enable);
+}
+
+char* MegaApi::getMetrics()
+{
+    return MegaApiImpl::getMetrics();
+}
+
+void MegaApi::setTracing(bool enable)
+{
+    MegaApiImpl::setTracing(enable);
+}
+
+char* MegaApi::getTrace()
+{
+    return MegaApiImpl::getTrace();
+}
+
 void MegaApi::addLoggerObject(MegaLogger *megaLogger, bool singleExclusiveLogger)
 {
     MegaApiImpl::addLoggerClass(megaLogger, singleExclusiveLogger);
@@ -2787,6 +2916,16 @@ void MegaApi::getPreview(MegaNode* node, const char *dstFilePath, MegaRequestLis
     pImpl->getPreview(node, dstFilePath, listener);
 }
 
+void MegaApi::getThumbnails(MegaNodeList* nodes, const char* dstFolderPath, MegaRequestListener* listener)
+{
+    pImpl->getThumbnails(nodes, dstFolderPath, listener);
+}
+
+void MegaApi::getPreviews(MegaNodeList* nodes, const char* dstFolderPath, MegaRequestListener* listener)
+{
+    pImpl->getPreviews(nodes, dstFolderPath, listener);
+}
+
 void MegaApi::cancelGetPreview(MegaNode* node, MegaRequestListener *listener)
 {
 	pImpl->cancelGetPreview(node, listener);
@@ -3002,6 +3141,11 @@ void MegaApi::exportNode(MegaNode *node, int64_t expireTime, bool writable, bool
     pImpl->exportNode(node, expireTime, writable, megaHosted, listener);
 }
 
+void MegaApi::exportNodes(MegaNodeList* nodes, int64_t expireTime, bool writable, bool megaHosted, MegaRequestListener* listener)
+{
+    pImpl->exportNodes(nodes, expireTime, writable, megaHosted, listener);
+}
+
 void MegaApi::disableExport(MegaNode *node, MegaRequestListener *listener)
 {
     pImpl->disableExport(node, listener);
@@ -3692,6 +3836,16 @@ void MegaApi::startDownload(MegaNode* node, const char* localPath, const char *c
     pImpl->startDownload(startFirst, node, localPath, customName, 0 /*folderTransferTag*/, appData, convertToCancelToken(cancelToken), collisionCheck, collisionResolution, undelete, listener);
 }
 
+void MegaApi::startUploads(MegaStringList* localPaths, MegaNode* parent, bool startFirst, MegaCancelToken* cancelToken, MegaTransferListener* listener)
+{
+    pImpl->startUploads(localPaths, parent, startFirst, convertToCancelToken(cancelToken), listener);
+}
+
+void MegaApi::startDownloads(MegaNodeList* nodes, const char* localFolder, bool startFirst, MegaCancelToken* cancelToken, int collisionCheck, int collisionResolution, MegaTransferListener* listener)
+{
+    pImpl->startDownloads(nodes, localFolder, startFirst, convertToCancelToken(cancelToken), collisionCheck, collisionResolution, listener);
+}
+
 void MegaApi::cancelTransfer(MegaTransfer *t, MegaRequestListener *listener)
 {
     pImpl->cancelTransfer(t, listener);
@@ -3878,6 +4032,11 @@ long long MegaApi::getNumLocalNodes()
     return pImpl->getNumLocalNodes();
 }
 
+const char* MegaApi::getSyncTelemetry(bool includeHistograms)
+{
+    return pImpl->getSyncTelemetry(includeHistograms);
+}
+
 void MegaApi::getMegaSyncStallList(MegaRequestListener* listener)
 {
     pImpl->getMegaSyncStallList(listener);
@@ -4684,11 +4843,171 @@ void MegaApi::setLRUCacheSize(unsigned long long size)
     pImpl->setLRUCacheSize(size);
 }
 
+void MegaApi::setLRUCacheSizeInBytes(unsigned long long bytes)
+{
+    pImpl->setLRUCacheSizeInBytes(bytes);
+}
+
+void MegaApi::setNodesUpdateBatching(int minInterval, int maxBatch)
+{
+    pImpl->setNodesUpdateBatching(minInterval, maxBatch);
+}
+
+void MegaApi::setSlowTaskThreshold(int milliseconds)
+{
+    pImpl->setSlowTaskThreshold(milliseconds);
+}
+
+const char* MegaApi::getEventLoopStats(bool reset)
+{
+    return pImpl->getEventLoopStats(reset);
+}
+
+void MegaApi::setLRUCachePolicy(int policy)
+{
+    pImpl->setLRUCachePolicy(policy);
+}
+
 unsigned long long MegaApi::getNumNodesAtCacheLRU() const
 {
     return pImpl->getNumNodesAtCacheLRU();
 }
 
+void MegaApi::setCompactNodes(bool enable)
+{
+    pImpl->setCompactNodes(enable);
+}
+
+void MegaApi::setBulkLoadDbMode(bool enable)
+{
+    pImpl->setBulkLoadDbMode(enable);
+}
+
+void MegaApi::setDbNodeCompression(bool enable)
+{
+    pImpl->setDbNodeCompression(enable);
+}
+
+void MegaApi::setActionPacketCoalescing(bool enable)
+{
+    pImpl->setActionPacketCoalescing(enable);
+}
+
+void MegaApi::setSecondaryCommandChannel(bool enable)
+{
+    pImpl->setSecondaryCommandChannel(enable);
+}
+
+bool MegaApi::setHttp2Multiplexing(bool api, bool transfers)
+{
+    return pImpl->setHttp2Multiplexing(api, transfers);
+}
+
+void MegaApi::setStorageConnectionPrewarming(bool enable)
+{
+    pImpl->setStorageConnectionPrewarming(enable);
+}
+
+bool MegaApi::setHappyEyeballs(bool enable)
+{
+    return pImpl->setHappyEyeballs(enable);
+}
+
+bool MegaApi::setHostBandwidthLimit(int direction, const char* host, long long bpslimit)
+{
+    return pImpl->setHostBandwidthLimit(direction, host, bpslimit);
+}
+
+bool MegaApi::setBandwidthClassLimit(int direction, int bandwidthClass, long long bpslimit)
+{
+    return pImpl->setBandwidthClassLimit(direction, bandwidthClass, bpslimit);
+}
+
+void MegaApi::setAdaptiveConnections(bool enable)
+{
+    pImpl->setAdaptiveConnections(enable);
+}
+
+bool MegaApi::setDownloadBufferSize(int bytes)
+{
+    return pImpl->setDownloadBufferSize(bytes);
+}
+
+bool MegaApi::setApiCompression(bool enable)
+{
+    return pImpl->setApiCompression(enable);
+}
+
+bool MegaApi::setDownloadDiskAllocation(int mode)
+{
+    return pImpl->setDownloadDiskAllocation(mode);
+}
+
+void MegaApi::setDownloadHardLinks(bool enable)
+{
+    pImpl->setDownloadHardLinks(enable);
+}
+
+void MegaApi::setRaidLookahead(long long bytes)
+{
+    pImpl->setRaidLookahead(bytes);
+}
+
+void MegaApi::setMemoryPressure(int level)
+{
+    pImpl->setMemoryPressure(level);
+}
+
+bool MegaApi::setNodeChangeJournalEnabled(bool enable)
+{
+    return pImpl->setNodeChangeJournalEnabled(enable);
+}
+
+bool MegaApi::isNodeChangeJournalEnabled()
+{
+    return pImpl->isNodeChangeJournalEnabled();
+}
+
+MegaNodeChangeList* MegaApi::getNodeChanges(long long afterSequenceNumber, int limit)
+{
+    return pImpl->getNodeChanges(afterSequenceNumber, limit);
+}
+
+void MegaApi::setUploadContentDedup(bool enable)
+{
+    pImpl->setUploadContentDedup(enable);
+}
+
+void MegaApi::setSmallUploadBatching(bool enable)
+{
+    pImpl->setSmallUploadBatching(enable);
+}
+
+void MegaApi::setStreamingCacheSize(long long bytes)
+{
+    pImpl->setStreamingCacheSize(bytes);
+}
+
+void MegaApi::setFileAttributesAfterUpload(bool enable)
+{
+    pImpl->setFileAttributesAfterUpload(enable);
+}
+
+void MegaApi::setDownloadMemoryBudget(long long bytes)
+{
+    pImpl->setDownloadMemoryBudget(bytes);
+}
+
+long long MegaApi::getDownloadPipelineBytes(int stage)
+{
+    return pImpl->getDownloadPipelineBytes(stage);
+}
+
+unsigned long long MegaApi::getMemoryUsageOfNodesAtCacheLRU() const
+{
+    return pImpl->getMemoryUsageOfNodesAtCacheLRU();
+}
+
 long long MegaApi::getTotalDownloadedBytes()
 {
     return pImpl->getTotalDownloadedBytes();
@@ -4836,6 +5155,16 @@ bool MegaApi::httpServerIsOfflineAttributeEnabled()
     return pImpl->httpServerIsOfflineAttributeEnabled();
 }
 
+void MegaApi::httpServerEnableMetrics(bool enable)
+{
+    pImpl->httpServerEnableMetrics(enable);
+}
+
+bool MegaApi::httpServerIsMetricsEnabled()
+{
+    return pImpl->httpServerIsMetricsEnabled();
+}
+
 bool MegaApi::httpServerIsFolderServerEnabled()
 {
     return pImpl->httpServerIsFolderServerEnabled();
@@ -4921,6 +5250,16 @@ int MegaApi::httpServerGetMaxOutputSize()
     return pImpl->httpServerGetMaxOutputSize();
 }
 
+void MegaApi::httpServerSetLoopCount(int count)
+{
+    pImpl->httpServerSetLoopCount(count);
+}
+
+int MegaApi::httpServerGetLoopCount()
+{
+    return pImpl->httpServerGetLoopCount();
+}
+
 //FTP Server:
 bool MegaApi::ftpServerStart(bool localOnly, int port, int dataportBegin, int dataPortEnd, bool useTLS, const char * certificatepath, const char * keypath)
 {
@@ -8261,6 +8600,10 @@ MegaFuseExecutorFlags::MegaFuseExecutorFlags() = default;
 
 MegaFuseExecutorFlags::~MegaFuseExecutorFlags() = default;
 
+MegaFuseFileCacheFlags::MegaFuseFileCacheFlags() = default;
+
+MegaFuseFileCacheFlags::~MegaFuseFileCacheFlags() = default;
+
 MegaFuseFlags::MegaFuseFlags() = default;
 
 MegaFuseFlags::~MegaFuseFlags() = default;
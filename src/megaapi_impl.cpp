@@ -51,7 +51,9 @@
 #ifndef _LARGEFILE64_SOURCE
     #define _LARGEFILE64_SOURCE
 #endif
+#include <fcntl.h>
 #include <signal.h>
+#include <unistd.h>
 #endif
 
 
@@ -71,6 +73,7 @@
 #include "mega/mega_zxcvbn.h"
 
 // FUSE
+#include <mega/fuse/common/error_or.h>
 #include <mega/fuse/common/mount_event_type.h>
 #include <mega/fuse/common/mount_event.h>
 #include <mega/fuse/common/mount_info.h>
@@ -274,13 +277,38 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
     this->mFavourite = false;
     this->mLabel = LBL_UNKNOWN;
 
+    // looked up once rather than for every attribute of every node
+    static const nameid nameidD = AttrMap::string2nameid("d");
+    static const nameid nameidL = AttrMap::string2nameid("l");
+    static const nameid nameidGp = AttrMap::string2nameid("gp");
+    static const nameid nameidRr = AttrMap::string2nameid("rr");
+    static const nameid nameidC = AttrMap::string2nameid("c");
+    static const nameid nameidC0 = AttrMap::string2nameid("c0");
+    static const nameid nameidFav = AttrMap::string2nameid("fav");
+    static const nameid nameidSen = AttrMap::string2nameid("sen");
+    static const nameid nameidLbl = AttrMap::string2nameid("lbl");
+    static const nameid nameidDevId = AttrMap::string2nameid("dev-id");
+    static const nameid nameidDrvId = AttrMap::string2nameid("drv-id");
+    static const nameid nameidS4 = AttrMap::string2nameid("s4");
+    static const nameid nameidPwm = AttrMap::string2nameid(MegaClient::NODE_ATTR_PASSWORD_MANAGER);
+    static const nameid nameidDescription = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION);
+    static const nameid nameidTags = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS);
+
     char buf[10];
     for (attr_map::iterator it = node->attrs.map.begin(); it != node->attrs.map.end(); it++)
     {
-        int attrlen = node->attrs.nameid2string(it->first, buf);
-        buf[attrlen] = '\0';
-        if (buf[0] == '_')
+        // the first character is the most significant byte in use
+        nameid first = it->first;
+        while (first > 0xFF)
         {
+            first >>= 8;
+        }
+
+        if (first == '_')
+        {
+           int attrlen = node->attrs.nameid2string(it->first, buf);
+           buf[attrlen] = '\0';
+
            if (!customAttrs)
            {
                customAttrs = new attr_map();
@@ -291,27 +319,27 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
         }
         else
         {
-            if (it->first == AttrMap::string2nameid("d"))
+            if (it->first == nameidD)
             {
                if (node->type == FILENODE)
                {
                    duration = int(Base64::atoi(&it->second));
                }
             }
-            else if (it->first == AttrMap::string2nameid("l") || it->first == AttrMap::string2nameid("gp"))
+            else if (it->first == nameidL || it->first == nameidGp)
             {
                 if (node->type == FILENODE)
                 {
                     string coords = it->second;
-                    if ((it->first == AttrMap::string2nameid("l") && coords.size() != 8) ||
-                        (it->first == AttrMap::string2nameid("gp") && coords.size() != Base64Str<16>::STRLEN))
+                    if ((it->first == nameidL && coords.size() != 8) ||
+                        (it->first == nameidGp && coords.size() != Base64Str<16>::STRLEN))
                     {
                        LOG_warn << "Malformed GPS coordinates attribute";
                     }
                     else
                     {
                         bool ok = true;
-                        if (it->first == AttrMap::string2nameid("gp"))
+                        if (it->first == nameidGp)
                         {
                             if (node->client && node->client->unshareablekey.size() == Base64Str<SymmCipher::KEYLENGTH>::STRLEN && coords.size() == Base64Str<16>::STRLEN)
                             {
@@ -366,7 +394,7 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
                     }
                }
             }
-            else if (it->first == AttrMap::string2nameid("rr"))
+            else if (it->first == nameidRr)
             {
                 handle rr = 0;
                 if (Base64::atob(it->second.c_str(), (byte *)&rr, sizeof(rr)) == MegaClient::NODEHANDLE)
@@ -374,15 +402,15 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
                     restorehandle = rr;
                 }
             }
-            else if (it->first == AttrMap::string2nameid("c") && !fingerprint)
+            else if (it->first == nameidC && !fingerprint)
             {
                 fingerprint = MegaApi::strdup(it->second.c_str());
             }
-            else if (it->first == AttrMap::string2nameid("c0"))
+            else if (it->first == nameidC0)
             {
                 originalfingerprint = MegaApi::strdup(it->second.c_str());
             }
-            else if (it->first == AttrMap::string2nameid("fav"))
+            else if (it->first == nameidFav)
             {
                 try
                 {
@@ -401,7 +429,7 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
                     LOG_err << "Conversion failure for node attr fav: " << ex.what();
                 }
             }
-            else if (it->first == AttrMap::string2nameid("sen"))
+            else if (it->first == nameidSen)
             {
                 try
                 {
@@ -420,7 +448,7 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
                     LOG_err << "Conversion failure for node attr sen: " << ex.what();
                 }
             }
-            else if (it->first == AttrMap::string2nameid("lbl"))
+            else if (it->first == nameidLbl)
             {
                 try
                 {
@@ -439,18 +467,18 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
                     LOG_err << "Conversion failure for node attr lbl: " << ex.what();
                 }
             }
-            else if (it->first == AttrMap::string2nameid("dev-id") ||
-                     it->first == AttrMap::string2nameid("drv-id"))
+            else if (it->first == nameidDevId ||
+                     it->first == nameidDrvId)
             {
                 mDeviceId = it->second;
             }
-            else if (it->first == AttrMap::string2nameid("s4"))
+            else if (it->first == nameidS4)
             {
                 mS4 = it->second;
             }
-            else if (it->first == AttrMap::string2nameid(MegaClient::NODE_ATTR_PASSWORD_MANAGER) ||
-                     it->first == AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION) ||
-                     it->first == AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS))
+            else if (it->first == nameidPwm ||
+                     it->first == nameidDescription ||
+                     it->first == nameidTags)
             {
                 if (!mOfficialAttrs) mOfficialAttrs = std::make_unique<attr_map>();
 
@@ -471,79 +499,26 @@ MegaNodePrivate::MegaNodePrivate(Node *node)
     this->fileattrstring = node->fileattrstring;
     this->nodekey = node->nodekeyUnchecked();
 
-    this->changed = 0;
-    if(node->changed.attrs)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_ATTRIBUTES;
-    }
-    if(node->changed.ctime)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_TIMESTAMP;
-    }
-    if(node->changed.fileattrstring)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_FILE_ATTRIBUTES;
-    }
-    if(node->changed.inshare)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_INSHARE;
-    }
-    if(node->changed.outshares)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_OUTSHARE;
-    }
-    if(node->changed.pendingshares)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_PENDINGSHARE;
-    }
-    if(node->changed.owner)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_OWNER;
-    }
-    if(node->changed.parent)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_PARENT;
-    }
-    if(node->changed.removed)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_REMOVED;
-    }
-    if(node->changed.publiclink)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_PUBLIC_LINK;
-    }
-    if(node->changed.newnode)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_NEW;
-    }
-    if (node->changed.name)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_NAME;
-    }
-    if (node->changed.favourite)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_FAVOURITE;
-    }
-    if (node->changed.counter)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_COUNTER;
-    }
-    if (node->changed.sensitive)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_SENSITIVE;
-    }
-    if (node->changed.pwd)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_PWD;
-    }
-    if (node->changed.description)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_DESCRIPTION;
-    }
-    if (node->changed.tags)
-    {
-        this->changed |= MegaNode::CHANGE_TYPE_TAGS;
-    }
+    // the values of the mask are the ones of MegaNode
+    static_assert(static_cast<uint64_t>(Node::CHANGED_REMOVED) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_REMOVED));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_ATTRS) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_ATTRIBUTES));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_OWNER) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_OWNER));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_CTIME) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_TIMESTAMP));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_FILEATTRSTRING) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_FILE_ATTRIBUTES));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_INSHARE) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_INSHARE));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_OUTSHARES) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_OUTSHARE));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_PARENT) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_PARENT));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_PENDINGSHARES) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_PENDINGSHARE));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_PUBLICLINK) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_PUBLIC_LINK));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_NEWNODE) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_NEW));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_NAME) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_NAME));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_FAVOURITE) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_FAVOURITE));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_COUNTER) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_COUNTER));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_SENSITIVE) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_SENSITIVE));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_PWD) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_PWD));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_DESCRIPTION) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_DESCRIPTION));
+    static_assert(static_cast<uint64_t>(Node::CHANGED_TAGS) == static_cast<uint64_t>(MegaNode::CHANGE_TYPE_TAGS));
+    this->changed = node->changedMask();
 
     this->thumbnailAvailable = (node->hasfileattribute(0) != 0);
     this->previewAvailable = (node->hasfileattribute(1) != 0);
@@ -5520,6 +5495,17 @@ MegaNodeListPrivate::MegaNodeListPrivate(sharedNode_vector& v)
         list[i] = MegaNodePrivate::fromNode(v[i].get());
 }
 
+MegaNodeListPrivate::MegaNodeListPrivate(std::vector<std::unique_ptr<MegaNode>>&& nodes)
+{
+    list = NULL;
+    s = static_cast<int>(nodes.size());
+    if (!s) return;
+
+    list = new MegaNode*[s];
+    for (int i = 0; i < s; i++)
+        list[i] = nodes[i].release();
+}
+
 MegaNodeListPrivate::MegaNodeListPrivate(sharedNode_list& l)
 {
     list = NULL;
@@ -5563,6 +5549,83 @@ int MegaNodeListPrivate::size() const
     return s;
 }
 
+template<typename T, typename GetValue>
+int MegaNodeListPrivate::getValues(T* values, int count, GetValue&& value) const
+{
+    if (!values || !list)
+    {
+        return 0;
+    }
+
+    int n = std::min(count, s);
+    for (int i = 0; i < n; ++i)
+    {
+        values[i] = static_cast<T>(value(*list[i]));
+    }
+    return std::max(n, 0);
+}
+
+int MegaNodeListPrivate::getHandles(MegaHandle* handles, int count) const
+{
+    return getValues(handles, count, [](MegaNode& node) { return node.getHandle(); });
+}
+
+int MegaNodeListPrivate::getSizes(int64_t* sizes, int count) const
+{
+    return getValues(sizes, count, [](MegaNode& node) { return node.getSize(); });
+}
+
+int MegaNodeListPrivate::getCreationTimes(int64_t* times, int count) const
+{
+    return getValues(times, count, [](MegaNode& node) { return node.getCreationTime(); });
+}
+
+int MegaNodeListPrivate::getModificationTimes(int64_t* times, int count) const
+{
+    return getValues(times, count, [](MegaNode& node) { return node.getModificationTime(); });
+}
+
+int MegaNodeListPrivate::getTypes(int* types, int count) const
+{
+    return getValues(types, count, [](MegaNode& node) { return node.getType(); });
+}
+
+size_t MegaNodeListPrivate::getNamesSize() const
+{
+    size_t size = 0;
+    for (int i = 0; list && i < s; ++i)
+    {
+        const char* name = list[i]->getName();
+        size += name ? strlen(name) : 0;
+    }
+    return size;
+}
+
+int MegaNodeListPrivate::getNames(char* buffer, size_t size, int* ends, int count) const
+{
+    if (!buffer || !ends || !list)
+    {
+        return 0;
+    }
+
+    size_t offset = 0;
+    int n = std::min(count, s);
+    for (int i = 0; i < n; ++i)
+    {
+        const char* name = list[i]->getName();
+        size_t length = name ? strlen(name) : 0;
+        if (length > size - offset || offset + length > static_cast<size_t>(std::numeric_limits<int>::max()))
+        {
+            return i;
+        }
+
+        memcpy(buffer + offset, name, length);
+        offset += length;
+        ends[i] = static_cast<int>(offset);
+    }
+    return std::max(n, 0);
+}
+
 
 void MegaNodeListPrivate::addNode(std::unique_ptr<MegaNode> node)
 {
@@ -5892,6 +5955,63 @@ int MegaShareListPrivate::size()
     return s;
 }
 
+MegaNodeChangeListPrivate::MegaNodeChangeListPrivate(std::vector<DBNodeChange>&& changes,
+                                                     uint64_t lastSequence,
+                                                     bool missed):
+    mChanges(std::move(changes)),
+    mLastSequence(lastSequence),
+    mMissed(missed)
+{}
+
+MegaNodeChangeList* MegaNodeChangeListPrivate::copy() const
+{
+    return new MegaNodeChangeListPrivate(std::vector<DBNodeChange>(mChanges), mLastSequence, mMissed);
+}
+
+int MegaNodeChangeListPrivate::size() const
+{
+    return static_cast<int>(mChanges.size());
+}
+
+const DBNodeChange* MegaNodeChangeListPrivate::at(int i) const
+{
+    return i >= 0 && static_cast<size_t>(i) < mChanges.size() ? &mChanges[static_cast<size_t>(i)] : nullptr;
+}
+
+long long MegaNodeChangeListPrivate::getSequenceNumber(int i) const
+{
+    const DBNodeChange* change = at(i);
+    return change ? static_cast<long long>(change->sequence) : 0;
+}
+
+MegaHandle MegaNodeChangeListPrivate::getNodeHandle(int i) const
+{
+    const DBNodeChange* change = at(i);
+    return change ? change->node.as8byte() : INVALID_HANDLE;
+}
+
+uint64_t MegaNodeChangeListPrivate::getChanges(int i) const
+{
+    const DBNodeChange* change = at(i);
+    return change ? change->changes : 0;
+}
+
+MegaHandle MegaNodeChangeListPrivate::getSCSN(int i) const
+{
+    const DBNodeChange* change = at(i);
+    return change ? change->scsn : INVALID_HANDLE;
+}
+
+long long MegaNodeChangeListPrivate::getLastSequenceNumber() const
+{
+    return static_cast<long long>(mLastSequence);
+}
+
+bool MegaNodeChangeListPrivate::hasMissedChanges() const
+{
+    return mMissed;
+}
+
 MegaTransferListPrivate::MegaTransferListPrivate()
 {
     list = NULL;
@@ -5935,6 +6055,47 @@ int MegaTransferListPrivate::size()
     return s;
 }
 
+template<typename T, typename GetValue>
+int MegaTransferListPrivate::getValues(T* values, int count, GetValue&& value) const
+{
+    if (!values || !list)
+    {
+        return 0;
+    }
+
+    int n = std::min(count, s);
+    for (int i = 0; i < n; ++i)
+    {
+        values[i] = static_cast<T>(value(*list[i]));
+    }
+    return std::max(n, 0);
+}
+
+int MegaTransferListPrivate::getTags(int* tags, int count)
+{
+    return getValues(tags, count, [](MegaTransfer& transfer) { return transfer.getTag(); });
+}
+
+int MegaTransferListPrivate::getStates(int* states, int count)
+{
+    return getValues(states, count, [](MegaTransfer& transfer) { return transfer.getState(); });
+}
+
+int MegaTransferListPrivate::getTransferredBytes(int64_t* bytes, int count)
+{
+    return getValues(bytes, count, [](MegaTransfer& transfer) { return transfer.getTransferredBytes(); });
+}
+
+int MegaTransferListPrivate::getTotalBytes(int64_t* bytes, int count)
+{
+    return getValues(bytes, count, [](MegaTransfer& transfer) { return transfer.getTotalBytes(); });
+}
+
+int MegaTransferListPrivate::getNodeHandles(MegaHandle* handles, int count)
+{
+    return getValues(handles, count, [](MegaTransfer& transfer) { return transfer.getNodeHandle(); });
+}
+
 MegaContactRequestListPrivate::MegaContactRequestListPrivate()
 {
     list = NULL;
@@ -6562,9 +6723,11 @@ void MegaApiImpl::init(MegaApi *api, const char *appKey, std::unique_ptr<GfxProc
     httpServer = NULL;
     httpServerMaxBufferSize = 0;
     httpServerMaxOutputSize = 0;
+    httpServerLoopCount = 1;
     httpServerEnableFiles = true;
     httpServerEnableFolders = false;
     httpServerOfflineAttributeEnabled = false;
+    httpServerMetricsEnabled = false;
     httpServerRestrictedMode = MegaApi::TCP_SERVER_ALLOW_CREATED_LOCAL_LINKS;
     httpServerSubtitlesSupportEnabled = false;
 
@@ -6611,6 +6774,13 @@ void MegaApiImpl::init(MegaApi *api, const char *appKey, std::unique_ptr<GfxProc
     }
     client = new MegaClient(this, waiter, httpio, dbAccess, gfxAccess, appKey, userAgent, clientWorkerThreadCount, MegaClient::ClientType(clientType));
 
+    if (basePath)
+    {
+        LocalPath cacheFolder = LocalPath::fromAbsolutePath(basePath);
+        cacheFolder.appendWithSeparator(LocalPath::fromRelativePath("fileattributes"), false);
+        client->mFileAttributeCache = std::make_unique<FileAttributeCache>(*client->fsaccess, cacheFolder);
+    }
+
 #if defined(_WIN32)
     httpio->unlock();
 #endif
@@ -6865,6 +7035,11 @@ void MegaApiImpl::setLogExtraForModules(bool networking, bool syncs)
 #endif
 }
 
+void MegaApiImpl::setSharedResources(bool enable)
+{
+    SharedResources::setEnabled(enable);
+}
+
 void MegaApiImpl::setLogLevel(int logLevel)
 {
     SimpleLogger::setLogLevel(LogLevel(logLevel));
@@ -6875,6 +7050,22 @@ void MegaApiImpl::setMaxPayloadLogSize(long long maxSize)
     SimpleLogger::setMaxPayloadLogSize(maxSize);
 }
 
+// whether the loggers are called from a thread of their own
+static std::atomic<bool> gAsyncLogging{false};
+
+static void setLogOutput(Logger* output)
+{
+    if (gAsyncLogging)
+    {
+        g_asyncLogger.setTarget(output);
+        SimpleLogger::setOutputClass(&g_asyncLogger);
+    }
+    else
+    {
+        SimpleLogger::setOutputClass(output);
+    }
+}
+
 void MegaApiImpl::addLoggerClass(MegaLogger *megaLogger, bool singleExclusiveLogger)
 {
 
@@ -6893,7 +7084,7 @@ void MegaApiImpl::addLoggerClass(MegaLogger *megaLogger, bool singleExclusiveLog
                 );
         };
 
-        SimpleLogger::setOutputClass(&g_exclusiveLogger);
+        setLogOutput(&g_exclusiveLogger);
     }
     else
     {
@@ -6917,7 +7108,10 @@ void MegaApiImpl::removeLoggerClass(MegaLogger *megaLogger, bool singleExclusive
 {
     if (singleExclusiveLogger)
     {
-        SimpleLogger::setOutputClass(&g_externalLogger);
+        setLogOutput(&g_externalLogger);
+
+        // the drain thread may still be calling it
+        g_asyncLogger.flush();
         g_exclusiveLogger.exclusiveCallback = nullptr;
     }
     else
@@ -6937,6 +7131,33 @@ void MegaApiImpl::setLogJSONContent(bool enable)
     gLogJSONRequests = enable;
 }
 
+char* MegaApiImpl::getMetrics()
+{
+    return MegaApi::strdup(MetricsRegistry::instance().exportText().c_str());
+}
+
+void MegaApiImpl::setTracing(bool enable)
+{
+    Tracer::instance().setEnabled(enable);
+}
+
+char* MegaApiImpl::getTrace()
+{
+    return MegaApi::strdup(Tracer::instance().exportChromeJson().c_str());
+}
+
+void MegaApiImpl::setLogAsync(bool enable)
+{
+    gAsyncLogging = enable;
+    setLogOutput(g_exclusiveLogger.exclusiveCallback ? static_cast<Logger*>(&g_exclusiveLogger) : &g_externalLogger);
+
+    if (!enable)
+    {
+        // what was queued before goes out before what follows
+        g_asyncLogger.flush();
+    }
+}
+
 void MegaApiImpl::log(int logLevel, const char *message, const char *filename, int line)
 {
     SimpleLogger::postLog(LogLevel(logLevel), message, filename, line);
@@ -7570,12 +7791,21 @@ void MegaApiImpl::loop()
     httpio->lock();
 #endif
 
+    Tracer::instance().setThreadName("client");
+
     while(true)
     {
         int r;
         {
             SdkMutexGuard g(sdkMutex);
             r = client->preparewait();
+
+            // wake up when the coalesced node changes are due
+            if (!r && !mPendingNodesUpdate.empty())
+            {
+                auto due = std::chrono::duration_cast<std::chrono::milliseconds>((mLastNodesUpdate + mNodesUpdateInterval).time_since_epoch());
+                client->waiter->wakeupatms(due.count());
+            }
         }
 
         if (!r)
@@ -7592,11 +7822,19 @@ void MegaApiImpl::loop()
         {
             WAIT_CLASS::bumpds();
             updateBackups();
-            if (sendPendingTransfers(nullptr))
+            bool yieldAfterTransfers;
+            {
+                EventLoopMonitor::Scope loopScope(client->mLoopMonitor, EventLoopMonitor::PHASE_SEND_TRANSFERS);
+                yieldAfterTransfers = sendPendingTransfers(nullptr);
+            }
+            if (yieldAfterTransfers)
             {
                 yield();
             }
-            sendPendingRequests();
+            {
+                EventLoopMonitor::Scope loopScope(client->mLoopMonitor, EventLoopMonitor::PHASE_SEND_REQUESTS);
+                sendPendingRequests();
+            }
             sendPendingScRequest();
             if (threadExit)
             {
@@ -7608,6 +7846,12 @@ void MegaApiImpl::loop()
                 client->exec();
             }
         }
+
+        if (!mPendingNodesUpdate.empty())
+        {
+            SdkMutexGuard g(sdkMutex);
+            flushNodesUpdate(!mNodesUpdateInterval.count());
+        }
     }
 
     SdkMutexGuard g(sdkMutex);
@@ -7985,6 +8229,16 @@ void MegaApiImpl::getPreview(MegaNode* node, const char *dstFilePath, MegaReques
     getNodeAttribute(node, GfxProc::PREVIEW, dstFilePath, listener);
 }
 
+void MegaApiImpl::getThumbnails(MegaNodeList* nodes, const char* dstFolderPath, MegaRequestListener* listener)
+{
+    getNodeAttributes(nodes, GfxProc::THUMBNAIL, dstFolderPath, listener);
+}
+
+void MegaApiImpl::getPreviews(MegaNodeList* nodes, const char* dstFolderPath, MegaRequestListener* listener)
+{
+    getNodeAttributes(nodes, GfxProc::PREVIEW, dstFolderPath, listener);
+}
+
 void MegaApiImpl::cancelGetPreview(MegaNode* node, MegaRequestListener *listener)
 {
     cancelGetNodeAttribute(node, GfxProc::PREVIEW, listener);
@@ -8612,6 +8866,22 @@ void MegaApiImpl::exportNode(MegaNode *node, int64_t expireTime, bool writable,
     waiter->notify();
 }
 
+void MegaApiImpl::exportNodes(MegaNodeList* nodes, int64_t expireTime, bool writable, bool megaHosted, MegaRequestListener* listener)
+{
+    if (!nodes)
+    {
+        return;
+    }
+
+    // holding the lock, the SDK thread takes all of them in the same sendPendingRequests(),
+    // so their commands go together in the next cs batches
+    SdkMutexGuard g(sdkMutex);
+    for (int i = 0; i < nodes->size(); ++i)
+    {
+        exportNode(nodes->get(i), expireTime, writable, megaHosted, listener);
+    }
+}
+
 void MegaApiImpl::disableExport(MegaNode *node, MegaRequestListener *listener)
 {
     MegaRequestPrivate *request = new MegaRequestPrivate(MegaRequest::TYPE_EXPORT, listener);
@@ -9758,6 +10028,15 @@ MegaTransferPrivate* MegaApiImpl::createUploadTransfer(bool startFirst, const ch
             if (fa->type == FILENODE) // just file nodes have a valid fingerprint
             {
                 transfer->fingerprint_onDisk.genfingerprint(fa.get());
+
+                if (mUploadContentDedup && transfer->fingerprint_onDisk.isvalid)
+                {
+                    FileInputStream is(fa.get());
+                    if (!generateContentHash(is, transfer->contentHash_onDisk))
+                    {
+                        transfer->contentHash_onDisk.clear();
+                    }
+                }
             }
         }
     }
@@ -9793,6 +10072,48 @@ void MegaApiImpl::startDownload (bool startFirst, MegaNode *node, const char* lo
     waiter->notify();
 }
 
+void MegaApiImpl::startUploads(MegaStringList* localPaths, MegaNode* parent, bool startFirst, CancelToken cancelToken, MegaTransferListener* listener)
+{
+    std::vector<MegaTransferPrivate*> transfers;
+    for (int i = 0; localPaths && i < localPaths->size(); i++)
+    {
+        transfers.push_back(createUploadTransfer(startFirst, localPaths->get(i), parent, nullptr /*fileName*/, nullptr /*targetUser*/,
+                                                 MegaApi::INVALID_CUSTOM_MOD_TIME, 0 /*folderTransferTag*/, false /*isBackup*/,
+                                                 nullptr /*appData*/, false /*isSourceFileTemporary*/, false /*forceNewUpload*/,
+                                                 FS_UNKNOWN, cancelToken, listener));
+    }
+
+    // a single lock and wakeup however many there are
+    transferQueue.push(std::move(transfers));
+    waiter->notify();
+}
+
+void MegaApiImpl::startDownloads(MegaNodeList* nodes, const char* localFolder, bool startFirst, CancelToken cancelToken, int collisionCheck, int collisionResolution, MegaTransferListener* listener)
+{
+    // every node is saved inside the folder, under its own name
+    string parentPath = localFolder ? localFolder : "";
+    FileSystemType fsType = FS_UNKNOWN;
+    if (!parentPath.empty())
+    {
+        if (parentPath.back() != LocalPath::localPathSeparator_utf8)
+        {
+            parentPath.push_back(LocalPath::localPathSeparator_utf8);
+        }
+        fsType = fsAccess->getlocalfstype(LocalPath::fromAbsolutePath(parentPath));
+    }
+
+    std::vector<MegaTransferPrivate*> transfers;
+    for (int i = 0; nodes && i < nodes->size(); i++)
+    {
+        transfers.push_back(createDownloadTransfer(startFirst, nodes->get(i), parentPath.empty() ? nullptr : parentPath.c_str(), nullptr /*customName*/, 0 /*folderTransferTag*/,
+                                                   nullptr /*appData*/, cancelToken, collisionCheck, collisionResolution, false /*undelete*/,
+                                                   listener, fsType));
+    }
+
+    transferQueue.push(std::move(transfers));
+    waiter->notify();
+}
+
 MegaTransferPrivate* MegaApiImpl::createDownloadTransfer(bool startFirst, MegaNode *node, const char* localPath, const char *customName, int folderTransferTag, const char *appData, CancelToken cancelToken, int collisionCheck, int collisionResolution, bool undelete, MegaTransferListener *listener, FileSystemType fsType)
 {
     assert(!undelete || node);
@@ -9964,6 +10285,14 @@ int MegaApiImpl::syncPathState(string* platformEncoded)
         return cached_ts;
     }
 
+    // any path the syncs have reported a state for is here, without waiting for the sync thread
+    treestate_t indexed_ts;
+    nodetype_t indexed_type;
+    if (client->syncs.mTreestateIndex.lookup(localpath, indexed_ts, indexed_type))
+    {
+        return indexed_ts;
+    }
+
     handle containingSyncId = client->syncs.getSyncIdContainingActivePath(localpath);
 
     if (containingSyncId == UNDEF) return MegaApi::STATE_IGNORED;
@@ -10183,6 +10512,11 @@ long long MegaApiImpl::getNumLocalNodes()
     return client->syncs.totalLocalNodes;
 }
 
+const char* MegaApiImpl::getSyncTelemetry(bool includeHistograms)
+{
+    return MegaApi::strdup(client->syncs.telemetryJson(includeHistograms).c_str());
+}
+
 #endif
 
 void MegaApiImpl::moveOrRemoveDeconfiguredBackupNodes(MegaHandle deconfiguredBackupRoot, MegaHandle backupDestination, MegaRequestListener* listener)
@@ -10641,8 +10975,10 @@ bool MegaApiImpl::httpServerStart(bool localOnly, int port, bool useTLS, const c
     httpServer = new MegaHTTPServer(this, basePath, useTLS, certificatepath ? certificatepath : string(), keypath ? keypath : string(), useIPv6);
     httpServer->setMaxBufferSize(httpServerMaxBufferSize);
     httpServer->setMaxOutputSize(httpServerMaxOutputSize);
+    httpServer->setLoopCount(static_cast<unsigned>(httpServerLoopCount));
     httpServer->enableFileServer(httpServerEnableFiles);
     httpServer->enableOfflineAttribute(httpServerOfflineAttributeEnabled);
+    httpServer->enableMetrics(httpServerMetricsEnabled);
     httpServer->enableFolderServer(httpServerEnableFolders);
     httpServer->setRestrictedMode(httpServerRestrictedMode);
     httpServer->enableSubtitlesSupport(httpServerRestrictedMode != 0);
@@ -10831,6 +11167,18 @@ int MegaApiImpl::httpServerGetMaxOutputSize()
     }
 }
 
+void MegaApiImpl::httpServerSetLoopCount(int count)
+{
+    SdkMutexGuard g(sdkMutex);
+    httpServerLoopCount = count > 0 ? count : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+int MegaApiImpl::httpServerGetLoopCount()
+{
+    SdkMutexGuard g(sdkMutex);
+    return httpServerLoopCount;
+}
+
 void MegaApiImpl::httpServerEnableFileServer(bool enable)
 {
     SdkMutexGuard g(sdkMutex);
@@ -10876,6 +11224,21 @@ bool MegaApiImpl::httpServerIsOfflineAttributeEnabled()
     return httpServerOfflineAttributeEnabled;
 }
 
+void MegaApiImpl::httpServerEnableMetrics(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    this->httpServerMetricsEnabled = enable;
+    if (httpServer)
+    {
+        httpServer->enableMetrics(enable);
+    }
+}
+
+bool MegaApiImpl::httpServerIsMetricsEnabled()
+{
+    return httpServerMetricsEnabled;
+}
+
 void MegaApiImpl::httpServerSetRestrictedMode(int mode)
 {
     if (mode != MegaApi::TCP_SERVER_DENY_ALL
@@ -12132,6 +12495,28 @@ bool MegaApiImpl::processMegaTree(MegaNode* n, MegaTreeProcessor* processor, boo
     }
 
     SdkMutexGuard g(sdkMutex);
+
+    if (recursive && n->getType() != FILENODE && !n->isForeign() && !n->isPublic())
+    {
+        // load the whole subtree with a single query, so the traversal is resolved from RAM
+        client->mNodeManager.prefetchSubtree(NodeHandle().set6byte(n->getHandle()), 0);
+    }
+
+    return processMegaTreeNodes(n, processor, recursive);
+}
+
+bool MegaApiImpl::processMegaTreeNodes(MegaNode* n, MegaTreeProcessor* processor, bool recursive)
+{
+    if (!n)
+    {
+        return true;
+    }
+
+    if (!processor)
+    {
+        return false;
+    }
+
     std::shared_ptr<Node> node = NULL;
 
     if (!n->isForeign() && !n->isPublic())
@@ -12151,7 +12536,7 @@ bool MegaApiImpl::processMegaTree(MegaNode* n, MegaTreeProcessor* processor, boo
                     MegaNode *child = nList->get(i);
                     if (recursive)
                     {
-                        if (!processMegaTree(child, processor))
+                        if (!processMegaTreeNodes(child, processor, true))
                         {
                             return 0;
                         }
@@ -12179,7 +12564,7 @@ bool MegaApiImpl::processMegaTree(MegaNode* n, MegaTreeProcessor* processor, boo
             unique_ptr<MegaNode> megaNode(MegaNodePrivate::fromNode(node));
             if (recursive)
             {
-                if (!processMegaTree(megaNode.get(), processor))
+                if (!processMegaTreeNodes(megaNode.get(), processor, true))
                 {
                     return 0;
                 }
@@ -14546,6 +14931,11 @@ void MegaApiImpl::putnodes_result(const Error& inputErr,
         if (!e)
         {
             transfer->setState(MegaTransfer::STATE_COMPLETED);
+
+            if (n && n->type == FILENODE && !transfer->contentHash_onDisk.empty())
+            {
+                client->mContentHashIndex.add(transfer->contentHash_onDisk, n->nodeHandle());
+            }
         }
         else
         {
@@ -15000,6 +15390,9 @@ void MegaApiImpl::copysession_result(string *session, error e)
 
 void MegaApiImpl::clearing()
 {
+    mPendingNodesUpdate.clear();
+    mPendingNodesUpdateByHandle.clear();
+
 #ifdef ENABLE_SYNC
     mCachedMegaSyncPrivate.reset();
 #endif
@@ -15596,6 +15989,42 @@ void MegaApiImpl::nodes_updated(sharedNode_vector* nodes, int count)
         return;
     }
 
+    if (nodes != NULL && mNodesUpdateInterval.count())
+    {
+        for (auto& node : *nodes)
+        {
+            std::unique_ptr<MegaNodePrivate> snapshot(static_cast<MegaNodePrivate*>(MegaNodePrivate::fromNode(node.get())));
+
+            auto it = mPendingNodesUpdateByHandle.find(snapshot->getHandle());
+            if (it != mPendingNodesUpdateByHandle.end())
+            {
+                // keeps its place in the queue, with the latest state
+                snapshot->addChanges((*it->second)->getChanges());
+                *it->second = std::move(snapshot);
+            }
+            else
+            {
+                MegaHandle h = snapshot->getHandle();
+                mPendingNodesUpdate.push_back(std::move(snapshot));
+                mPendingNodesUpdateByHandle[h] = std::prev(mPendingNodesUpdate.end());
+            }
+        }
+
+        flushNodesUpdate(false);
+        return;
+    }
+
+    // what is still pending goes first, or is superseded by a full reload
+    if (nodes != NULL)
+    {
+        flushNodesUpdate(true);
+    }
+    else
+    {
+        mPendingNodesUpdate.clear();
+        mPendingNodesUpdateByHandle.clear();
+    }
+
     MegaNodeList *nodeList = NULL;
     if (nodes != NULL)
     {
@@ -15609,6 +16038,39 @@ void MegaApiImpl::nodes_updated(sharedNode_vector* nodes, int count)
     delete nodeList;
 }
 
+void MegaApiImpl::flushNodesUpdate(bool force)
+{
+    if (mPendingNodesUpdate.empty())
+    {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (!force && now - mLastNodesUpdate < mNodesUpdateInterval)
+    {
+        return;
+    }
+    mLastNodesUpdate = now;
+
+    size_t count = mPendingNodesUpdate.size();
+    if (!force && mNodesUpdateMaxBatch)
+    {
+        count = std::min(count, mNodesUpdateMaxBatch);
+    }
+
+    std::vector<std::unique_ptr<MegaNode>> batch;
+    batch.reserve(count);
+    while (count--)
+    {
+        mPendingNodesUpdateByHandle.erase(mPendingNodesUpdate.front()->getHandle());
+        batch.push_back(std::move(mPendingNodesUpdate.front()));
+        mPendingNodesUpdate.pop_front();
+    }
+
+    MegaNodeListPrivate nodeList(std::move(batch));
+    fireOnNodesUpdate(&nodeList);
+}
+
 void MegaApiImpl::account_details(AccountDetails*, bool, bool, bool, bool, bool, bool)
 {
     if(requestMap.find(client->restag) == requestMap.end()) return;
@@ -17154,10 +17616,9 @@ void MegaApiImpl::fireOnTransferUpdate(MegaTransferPrivate *transfer)
 
 void MegaApiImpl::fireOnFolderTransferUpdate(MegaTransferPrivate *transfer, int stage, uint32_t foldercount, uint32_t createdfoldercount, uint32_t filecount, const LocalPath* currentFolder, const LocalPath* currentFileLeafname)
 {
-    // this occurs on worker thread for scanning stage (for uploads) and create tree (for downloads), and on SDK thread for the rest of calls
+    // this occurs on worker thread for scanning stage (for uploads), and on SDK thread for the rest of calls
     assert((threadId != std::this_thread::get_id()
-                && ((stage == MegaTransfer::STAGE_SCAN && transfer->getType() == MegaTransfer::TYPE_UPLOAD)
-                        || (stage == MegaTransfer::STAGE_CREATE_TREE && transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)))
+                && stage == MegaTransfer::STAGE_SCAN && transfer->getType() == MegaTransfer::TYPE_UPLOAD)
             || threadId == std::this_thread::get_id());
 
     notificationNumber++;
@@ -18355,31 +18816,7 @@ MegaNodeList *MegaApiImpl::getVersions(MegaNode *node)
     }
 
     SdkMutexGuard g(sdkMutex);
-    std::shared_ptr<Node> current = client->nodebyhandle(node->getHandle());
-    if (!current || current->type != FILENODE)
-    {
-        return new MegaNodeListPrivate();
-    }
-
-    vector<std::shared_ptr<Node> > versions;
-    versions.push_back(current);
-    bool lookingFor = true;
-    while (lookingFor)
-    {
-        sharedNode_list nodeList = client->getChildren(current.get());
-        if (nodeList.empty())
-        {
-            lookingFor = false;
-        }
-        else
-        {
-            assert(nodeList.back()->parent == current);
-            current = nodeList.back();
-            assert(current->type == FILENODE);
-            versions.push_back(current);
-        }
-    }
-
+    sharedNode_vector versions = client->mNodeManager.getVersions(NodeHandle().set6byte(node->getHandle()));
     return new MegaNodeListPrivate(versions);
 }
 
@@ -18935,6 +19372,15 @@ unsigned MegaApiImpl::sendPendingTransfers(TransferQueue *queue, MegaRecursiveOp
                     if (!forceToUpload)
                     {
                         std::shared_ptr<Node> samenode = client->mNodeManager.getNodeByFingerprint(fp_forCloud);
+
+                        // same content under another fingerprint: the copy gets this file's one
+                        bool sameContentOnly = false;
+                        if (!samenode && !transfer->contentHash_onDisk.empty())
+                        {
+                            samenode = client->mContentHashIndex.lookup(transfer->contentHash_onDisk, fp_forCloud.size);
+                            sameContentOnly = samenode != nullptr;
+                        }
+
                         if (samenode && samenode->nodekey().size() && !hasToForceUpload(*samenode, *transfer))
                         {
                             pendingUploads++;
@@ -18961,6 +19407,11 @@ unsigned MegaApiImpl::sendPendingTransfers(TransferQueue *queue, MegaRecursiveOp
                             string sname = fileName;
                             LocalPath::utf8_normalize(&sname);
                             attrs.map['n'] = sname;
+                            if (sameContentOnly)
+                            {
+                                LOG_debug << "Copying a node with the same content hash instead of uploading";
+                                fp_forCloud.serializefingerprint(&attrs.map['c']);
+                            }
                             attrs.getjson(&attrstring);
                             client->makeattr(&key, tc.nn[0].attrstring, attrstring.c_str());
                             if (tc.nn[0].type == FILENODE)
@@ -19561,6 +20012,8 @@ void MegaApiImpl::sendPendingRequests()
 
         lastRequestType = request->getType();
 
+        EventLoopMonitor::Task loopTask(client->mLoopMonitor, "request", request->getRequestString());
+
         // only try this in the 1st iteration
         if (firstIteration && request->getType() != MegaRequest::TYPE_LOGOUT)
         {
@@ -21039,6 +21492,22 @@ error MegaApiImpl::performRequest_logout(MegaRequestPrivate* request)
             return API_OK;
 }
 
+void MegaApiImpl::getNodeAttributes(MegaNodeList* nodes, int type, const char* dstFolderPath, MegaRequestListener* listener)
+{
+    if (!nodes)
+    {
+        return;
+    }
+
+    // holding the lock, the SDK thread starts all of them in the same pass: their getfa()
+    // are then grouped per cluster before the channels dispatch the next POST
+    SdkMutexGuard g(sdkMutex);
+    for (int i = 0; i < nodes->size(); ++i)
+    {
+        getNodeAttribute(nodes->get(i), type, dstFolderPath, listener);
+    }
+}
+
 void MegaApiImpl::getNodeAttribute(MegaNode* node, int type, const char* dstFilePath, MegaRequestListener* listener)
 {
     MegaRequestPrivate* request = new MegaRequestPrivate(MegaRequest::TYPE_GET_ATTR_FILE, listener);
@@ -24979,18 +25448,24 @@ void MegaApiImpl::getFolderInfo(MegaNode* node, MegaRequestListener* listener)
                 return API_EARGS;
             }
 
-            std::shared_ptr<Node> node = client->nodebyhandle(h);
-            if (!node)
+            // single look-up of the aggregates in DB, unless the folder has to be loaded
+            NodeCounter nc;
+            if (!client->mNodeManager.getFolderCounter(NodeHandle().set6byte(h), nc))
             {
-                return API_ENOENT;
-            }
+                std::shared_ptr<Node> node = client->nodebyhandle(h);
+                if (!node)
+                {
+                    return API_ENOENT;
+                }
 
-            if (node->type == FILENODE)
-            {
-                return API_EARGS;
+                if (node->type == FILENODE)
+                {
+                    return API_EARGS;
+                }
+
+                nc = node->getCounter();
             }
 
-            NodeCounter nc = node->getCounter();
             std::unique_ptr<MegaFolderInfo> folderInfo = std::make_unique<MegaFolderInfoPrivate>((int)nc.files, (int)nc.folders, (int)nc.versions, nc.storage, nc.versionStorage);
             request->setMegaFolderInfo(folderInfo.get());
 
@@ -26037,11 +26512,268 @@ void MegaApiImpl::setLRUCacheSize(unsigned long long size)
     client->mNodeManager.setCacheLRUMaxSize(size);
 }
 
+void MegaApiImpl::setLRUCacheSizeInBytes(unsigned long long bytes)
+{
+    client->mNodeManager.setCacheLRUMaxBytes(bytes);
+}
+
+void MegaApiImpl::setNodesUpdateBatching(int minInterval, int maxBatch)
+{
+    SdkMutexGuard g(sdkMutex);
+    mNodesUpdateInterval = std::chrono::milliseconds(std::max(0, minInterval));
+    mNodesUpdateMaxBatch = static_cast<size_t>(std::max(0, maxBatch));
+
+    // anything pending is delivered by the next loop, all at once if disabled
+    waiter->notify();
+}
+
+void MegaApiImpl::setSlowTaskThreshold(int milliseconds)
+{
+    client->mLoopMonitor.setSlowThreshold(std::chrono::milliseconds(std::max(0, milliseconds)));
+}
+
+const char* MegaApiImpl::getEventLoopStats(bool reset)
+{
+    return MegaApi::strdup(client->mLoopMonitor.toJson(reset).c_str());
+}
+
+void MegaApiImpl::setLRUCachePolicy(int policy)
+{
+    switch (policy)
+    {
+        case MegaApi::LRU_CACHE_POLICY_LRU:
+            client->mNodeManager.setCacheLRUPolicy(NodeManager::CacheLRUPolicy::LRU);
+            break;
+        case MegaApi::LRU_CACHE_POLICY_2Q:
+            client->mNodeManager.setCacheLRUPolicy(NodeManager::CacheLRUPolicy::TWO_QUEUES);
+            break;
+        default:
+            LOG_err << "Invalid LRU cache policy: " << policy;
+            assert(false);
+            break;
+    }
+}
+
 unsigned long long MegaApiImpl::getNumNodesAtCacheLRU() const
 {
     return client->mNodeManager.getNumNodesAtCacheLRU();
 }
 
+void MegaApiImpl::setCompactNodes(bool enable)
+{
+    client->mNodeManager.setCompactNodes(enable);
+}
+
+void MegaApiImpl::setBulkLoadDbMode(bool enable)
+{
+    client->mNodeManager.setBulkLoadDb(enable);
+}
+
+void MegaApiImpl::setDbNodeCompression(bool enable)
+{
+    client->mNodeManager.setDbBlobCompression(enable);
+}
+
+void MegaApiImpl::setActionPacketCoalescing(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->mCoalesceActionPackets = enable;
+}
+
+void MegaApiImpl::setSecondaryCommandChannel(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->setSecondaryCommandChannel(enable);
+}
+
+bool MegaApiImpl::setHttp2Multiplexing(bool api, bool transfers)
+{
+    SdkMutexGuard g(sdkMutex);
+    return httpio->setHttp2Multiplexing(api, transfers);
+}
+
+void MegaApiImpl::setStorageConnectionPrewarming(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->mPrewarmStorageConnections = enable;
+}
+
+bool MegaApiImpl::setHappyEyeballs(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    return httpio->setHappyEyeballs(enable);
+}
+
+bool MegaApiImpl::setHostBandwidthLimit(int direction, const char* host, long long bpslimit)
+{
+    if (direction != MegaTransfer::TYPE_DOWNLOAD && direction != MegaTransfer::TYPE_UPLOAD)
+    {
+        return false;
+    }
+
+    SdkMutexGuard g(sdkMutex);
+    return httpio->setHostBandwidthLimit(direction == MegaTransfer::TYPE_DOWNLOAD ? GET : PUT, host ? host : "", bpslimit);
+}
+
+bool MegaApiImpl::setBandwidthClassLimit(int direction, int bandwidthClass, long long bpslimit)
+{
+    if ((direction != MegaTransfer::TYPE_DOWNLOAD && direction != MegaTransfer::TYPE_UPLOAD)
+            || bandwidthClass < MegaApi::BANDWIDTH_CLASS_USER || bandwidthClass > MegaApi::BANDWIDTH_CLASS_BACKUP)
+    {
+        return false;
+    }
+
+    SdkMutexGuard g(sdkMutex);
+    return httpio->setBandwidthClassLimit(direction == MegaTransfer::TYPE_DOWNLOAD ? GET : PUT, static_cast<bwclass_t>(bandwidthClass), bpslimit);
+}
+
+void MegaApiImpl::setAdaptiveConnections(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->mAdaptiveConnections = enable;
+}
+
+bool MegaApiImpl::setDownloadBufferSize(int bytes)
+{
+    SdkMutexGuard g(sdkMutex);
+    return httpio->setDownloadBufferSize(bytes);
+}
+
+bool MegaApiImpl::setApiCompression(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    return httpio->setApiCompression(enable);
+}
+
+bool MegaApiImpl::setDownloadDiskAllocation(int mode)
+{
+    if (mode < MegaApi::DISK_ALLOCATION_GROW || mode > MegaApi::DISK_ALLOCATION_SPARSE)
+    {
+        return false;
+    }
+
+    SdkMutexGuard g(sdkMutex);
+    client->mDownloadDiskAllocation = static_cast<Transfer::DiskAllocation>(mode);
+    return true;
+}
+
+void MegaApiImpl::setDownloadHardLinks(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->mDistributeWithHardLinks = enable;
+}
+
+void MegaApiImpl::setRaidLookahead(long long bytes)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->mRaidLookaheadBytes = std::max<long long>(bytes, 0);
+}
+
+void MegaApiImpl::setMemoryPressure(int level)
+{
+    MegaClient::MemoryPressure pressure;
+    switch (level)
+    {
+        case MegaApi::MEMORY_PRESSURE_NONE:
+            pressure = MegaClient::MemoryPressure::NONE;
+            break;
+        case MegaApi::MEMORY_PRESSURE_MODERATE:
+            pressure = MegaClient::MemoryPressure::MODERATE;
+            break;
+        case MegaApi::MEMORY_PRESSURE_CRITICAL:
+            pressure = MegaClient::MemoryPressure::CRITICAL;
+            break;
+        default:
+            LOG_warn << "Invalid memory pressure level: " << level;
+            return;
+    }
+
+    SdkMutexGuard g(sdkMutex);
+    client->setMemoryPressure(pressure);
+}
+
+bool MegaApiImpl::setNodeChangeJournalEnabled(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    return client->mNodeManager.setChangeJournalEnabled(enable);
+}
+
+bool MegaApiImpl::isNodeChangeJournalEnabled()
+{
+    SdkMutexGuard g(sdkMutex);
+    return client->mNodeManager.isChangeJournalEnabled();
+}
+
+MegaNodeChangeList* MegaApiImpl::getNodeChanges(long long afterSequenceNumber, int limit)
+{
+    std::vector<DBNodeChange> changes;
+    uint64_t lastSequence = 0;
+    bool missed = false;
+
+    SdkMutexGuard g(sdkMutex);
+    if (!client->mNodeManager.getNodeChanges(static_cast<uint64_t>(std::max<long long>(afterSequenceNumber, 0)),
+                                             static_cast<size_t>(std::max(limit, 0)),
+                                             changes,
+                                             lastSequence,
+                                             missed))
+    {
+        return nullptr;
+    }
+
+    return new MegaNodeChangeListPrivate(std::move(changes), lastSequence, missed);
+}
+
+void MegaApiImpl::setUploadContentDedup(bool enable)
+{
+    mUploadContentDedup = enable;
+}
+
+void MegaApiImpl::setSmallUploadBatching(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->mBatchSmallUploads = enable;
+}
+
+void MegaApiImpl::setStreamingCacheSize(long long bytes)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->mStreamingCache.setLimit(bytes > 0 ? static_cast<size_t>(bytes) : 0);
+}
+
+void MegaApiImpl::setFileAttributesAfterUpload(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->mAttachFileAttributesLater = enable;
+}
+
+void MegaApiImpl::setDownloadMemoryBudget(long long bytes)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->mDownloadMemoryBudget = bytes > 0 ? bytes : 0;
+}
+
+long long MegaApiImpl::getDownloadPipelineBytes(int stage)
+{
+    SdkMutexGuard g(sdkMutex);
+    stats::DownloadPipelineStats pipeline = client->downloadPipelineStats();
+    switch (stage)
+    {
+        case MegaApi::DOWNLOAD_STAGE_RECEIVE:
+            return pipeline.receive.bytes;
+        case MegaApi::DOWNLOAD_STAGE_DECRYPT:
+            return pipeline.decrypt.bytes;
+        case MegaApi::DOWNLOAD_STAGE_WRITE:
+            return pipeline.write.bytes;
+        default:
+            return 0;
+    }
+}
+
+unsigned long long MegaApiImpl::getMemoryUsageOfNodesAtCacheLRU() const
+{
+    return client->mNodeManager.getMemoryUsageOfNodesAtCacheLRU();
+}
+
 long long MegaApiImpl::getTotalDownloadedBytes()
 {
     return totalDownloadedBytes;
@@ -26567,6 +27299,23 @@ bool MegaApiImpl::isCached(const char* path)
     return client->mFuseService.cached(LocalPath::fromPlatformEncodedAbsolute(path));
 }
 
+bool MegaApiImpl::cachedContentPath(MegaNode* node, LocalPath& path)
+{
+    assert(node);
+
+    SdkMutexGuard guard(sdkMutex);
+
+    auto result = client->mFuseService.cachedContent(NodeHandle().set6byte(node->getHandle()),
+                                                     node->getModificationTime(),
+                                                     node->getSize());
+    if (!result)
+        return false;
+
+    path = std::move(*result);
+
+    return true;
+}
+
 bool MegaApiImpl::isFUSESupported()
 {
     SdkMutexGuard guard(sdkMutex);
@@ -26624,7 +27373,10 @@ MegaFuseFlags* MegaApiImpl::getFUSEFlags()
 {
     SdkMutexGuard guard(sdkMutex);
 
-    return new MegaFuseFlagsPrivate(client->mFuseService.serviceFlags());
+    return new MegaFuseFlagsPrivate(client->mFuseService.serviceFlags(),
+                                    client->mFuseService.fileCacheStatistics(),
+                                    client->mFuseService.inodeCacheStatistics(),
+                                    client->mFuseService.operationStatistics());
 }
 
 void MegaApiImpl::setMountFlags(const MegaMountFlags* flags,
@@ -27410,7 +28162,30 @@ void MegaApiImpl::importPasswordsFromFile(const char* filePath,
             return API_EARGS;
         }
 
-        PassFileParseResult parserResult = readPasswordImportFile(filePath, source);
+        sharedNode_list children = client->getChildren(parent.get());
+        std::vector<std::string> childrenNames;
+        std::transform(children.begin(),
+                       children.end(),
+                       std::back_inserter(childrenNames),
+                       [](const std::shared_ptr<Node>& child) -> std::string
+                       {
+                           return child->displayname();
+                       });
+        ncoll::NameCollisionSolver solver{std::move(childrenNames)};
+
+        // rows are validated as they are read, so the file's contents are never held twice
+        MegaClient::BadPasswordData badEntries;
+        MegaClient::ValidPasswordData goodEntries;
+        PassFileParseResult parserResult =
+            readPasswordImportFile(filePath,
+                                   source,
+                                   [&solver, &badEntries, &goodEntries](PassEntryParseResult&& entry)
+                                   {
+                                       MegaClient::validatePasswordEntry(std::move(entry),
+                                                                         solver,
+                                                                         badEntries,
+                                                                         goodEntries);
+                                   });
         switch (parserResult.mErrCode)
         {
             case PassFileParseResult::ErrCode::OK:
@@ -27428,20 +28203,6 @@ void MegaApiImpl::importPasswordsFromFile(const char* filePath,
                 return API_EACCESS;
         }
 
-        sharedNode_list children = client->getChildren(parent.get());
-        std::vector<std::string> childrenNames;
-        std::transform(children.begin(),
-                       children.end(),
-                       std::back_inserter(childrenNames),
-                       [](const std::shared_ptr<Node>& child) -> std::string
-                       {
-                           return child->displayname();
-                       });
-        ncoll::NameCollisionSolver solver{std::move(childrenNames)};
-
-        const auto [badEntries, goodEntries] =
-            MegaClient::validatePasswordEntries(std::move(parserResult.mResults), solver);
-
         if (goodEntries.empty())
         {
             LOG_err << "Import password: none entry is valid";
@@ -27458,7 +28219,15 @@ void MegaApiImpl::importPasswordsFromFile(const char* filePath,
 
         request->setMegaStringIntegerMap(&stringIntegerMap);
 
-        return client->createPasswordNodes(std::move(goodEntries), parent, request->getTag());
+        return client->createPasswordNodes(goodEntries,
+                                           parent,
+                                           request->getTag(),
+                                           [this, request](size_t created, size_t total)
+                                           {
+                                               request->setTransferredBytes(static_cast<long long>(created));
+                                               request->setTotalBytes(static_cast<long long>(total));
+                                               fireOnRequestUpdate(request);
+                                           });
     };
 
     requestQueue.push(request);
@@ -28219,6 +28988,16 @@ void TransferQueue::push(MegaTransferPrivate *transfer)
     transfer->setPlaceInQueue(++lastPushedTransferTag);
 }
 
+void TransferQueue::push(std::vector<MegaTransferPrivate *>&& newTransfers)
+{
+    std::lock_guard<std::mutex> g(mutex);
+    for (MegaTransferPrivate* transfer : newTransfers)
+    {
+        transfers.push_back(transfer);
+        transfer->setPlaceInQueue(++lastPushedTransferTag);
+    }
+}
+
 void TransferQueue::push_front(MegaTransferPrivate *transfer)
 {
     std::lock_guard<std::mutex> g(mutex);
@@ -29996,7 +30775,7 @@ void MegaFolderUploadController::start(MegaNode*)
 
         // if the thread runs, we always queue a function to execute on MegaApi thread for onFinish()
         // we keep a pointer to it in case we need to execute it early and directly on cancel()
-        mCompletionForMegaApiThread.reset(new ExecuteOnce([this, scanResult, weak_this, filecount]() {
+        mCompletionForMegaApiThread.reset(new ExecuteOnce([this, scanResult, weak_this, foldercount, filecount]() {
 
             // double check our object still exists when completion function starts executing
             if (!weak_this.lock()) return;
@@ -30024,18 +30803,17 @@ void MegaFolderUploadController::start(MegaNode*)
                 return;
             }
 
+            LOG_debug << "MegaFolderUploadController: scanned " << foldercount << " folders and " << filecount << " files";
+
+            // every file is expected from the start, as their uploads begin while folders are still being created,
+            // and so is the tree itself, so the last file to finish doesn't complete the operation before the last folder
+            mFileCount = filecount;
+            setTransfersTotalCount(size_t(filecount) + 1);
+
             // create folders in batches, not too many at once
-            // createNextFolderBatch is responsible for starting the transfers once all needed folders (if any) are created.
+            // createFolders is responsible for starting the transfers as the folders they go to are created.
             notifyStage(MegaTransfer::STAGE_CREATE_TREE);
-            vector<NewNode> newnodes;
-#ifndef NDEBUG
-            batchResult r =
-#endif
-            createNextFolderBatch(mUploadTree, newnodes, filecount, true);
-
-            assert(r == batchResult_cancelled ||
-                   r == batchResult_requestSent ||
-                   r == batchResult_batchesComplete);
+            createFolders();
         }));
 
         // Queue that function.
@@ -30137,71 +30915,130 @@ MegaFolderUploadController::~MegaFolderUploadController()
 
 MegaFolderUploadController::scanFolder_result MegaFolderUploadController::scanFolder(Tree& tree, LocalPath& localPath, uint32_t& foldercount, uint32_t& filecount)
 {
-    recursive++;
-    unique_ptr<DirAccess> da(fsaccess->newdiraccess());
-    if (!da->dopen(&localPath, nullptr, false))
+    // A folder found, to be scanned by the workers of the filesystem it's on.
+    struct Folder
+    {
+        Tree* tree;
+        LocalPath path;
+        handle fsid;
+        fsfp_t fsfp;
+    };
+
+    // the fsid a folder is scanned by, for the root (a link to it is followed, as on the scan itself) and mount points
+    auto folderFsid = [this](const LocalPath& path, handle& fsid) {
+        auto fa = fsaccess->newfileaccess();
+        if (!fa->fopen(path, true, false, FSLogging::logOnError) || fa->type != FOLDERNODE || !fa->fsidvalid)
+        {
+            LOG_err << "Can't open local directory" << path;
+            return false;
+        }
+        fsid = fa->fsid;
+        return true;
+    };
+
+    handle rootFsid = UNDEF;
+    if (!folderFsid(localPath, rootFsid))
     {
-        LOG_err << "Can't open local directory" << localPath;
-        recursive--;
         return scanFolder_failed;
     }
+    tree.fsType = fsaccess->getlocalfstype(localPath);
+
+    ScanService scanService;
+    auto waiter = std::make_shared<WAIT_CLASS>();
 
-    megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_SCAN, foldercount, 0, filecount, &localPath, nullptr);
+    std::deque<Folder> pending;
+    pending.push_back(Folder{&tree, localPath, rootFsid, fsaccess->fsFingerprint(localPath)});
 
-    LocalPath localname;
-    nodetype_t dirEntryType;
-    while (da->dnext(localPath, localname, false, &dirEntryType))
+    // enough to keep the workers busy, without queueing the whole tree ahead of a cancel
+    size_t maxScanning = scanService.workerThreads(pending.front().fsfp, localPath) * FOLDER_SCANS_PER_WORKER;
+    std::vector<std::pair<Folder, ScanService::RequestPtr>> scanning;
+
+    while (!pending.empty() || !scanning.empty())
     {
         if (isStoppedOrCancelled("MegaFolderUploadController::scanFolder"))
         {
             return scanFolder_cancelled;
         }
 
-        megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_SCAN, foldercount, 0, filecount, &localPath, &localname);
-
-        auto restoreLen = makeScopedSizeRestorer(localPath);
-        localPath.appendWithSeparator(localname, false);
-        if (dirEntryType == FILENODE)
+        while (!pending.empty() && scanning.size() < maxScanning)
         {
-            // Do the fingerprinting for uploads on the scan thread, so we don't lock the main mutex for so long
-            FileFingerprint fp;
-            auto fa = fsaccess->newfileaccess();
-            if (fa->fopen(localPath, true, false, FSLogging::logOnError))
-            {
-                fp.genfingerprint(fa.get());
-            }
+            Folder& folder = pending.front();
+            auto request = scanService.queueScan(folder.fsfp, folder.path, folder.fsid, false, map<LocalPath, FSNode>(), waiter);
+            scanning.emplace_back(std::move(folder), std::move(request));
+            pending.pop_front();
+        }
 
-            // if we couldn't get the fingerprint, !isvalid and we'll fail the transfer
-            tree.files.emplace_back(localPath, fp);
+        auto completed = std::find_if(scanning.begin(), scanning.end(), [](const std::pair<Folder, ScanService::RequestPtr>& s) {
+            return s.second->completed();
+        });
 
-            filecount += 1;
+        if (completed == scanning.end())
+        {
+            // the workers notify as each request completes, the timeout is for noticing a cancel
+            waiter->init(2);
+            waiter->wait();
+            continue;
         }
-        else if (dirEntryType == FOLDERNODE)
+
+        Folder folder = std::move(completed->first);
+        ScanService::RequestPtr request = std::move(completed->second);
+        scanning.erase(completed);
+
+        if (request->completionResult() != SCAN_SUCCESS)
         {
-            // generate new subtree
-            unique_ptr<Tree> newTreeNode(new Tree);
-            newTreeNode->folderName = localname.toName(*fsaccess);
-            newTreeNode->fsType = fsaccess->getlocalfstype(localPath);
+            LOG_err << "Can't open local directory" << folder.path;
+            return scanFolder_failed;
+        }
 
-            // generate fresh random key and node attributes
-            MegaClient::putnodes_prepareOneFolder(&newTreeNode->newnode, newTreeNode->folderName, rng, tmpnodecipher, false);
+        megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_SCAN, foldercount, 0, filecount, &folder.path, nullptr);
 
-            // set nodeHandle
-            newTreeNode->newnode.nodehandle = nextUploadId();
-            newTreeNode->newnode.parenthandle = tree.newnode.nodehandle;
+        std::vector<FSNode> nodes = request->resultNodes();
+        for (auto& node : nodes)
+        {
+            LocalPath path = folder.path;
+            path.appendWithSeparator(node.localname, false);
 
-            scanFolder_result sr = scanFolder(*newTreeNode, localPath, foldercount, filecount);
-            if (sr != scanFolder_succeeded)
+            if (node.type == FILENODE)
             {
-                recursive--;
-                return sr;
+                // fingerprinted by the worker already
+                // if it couldn't get the fingerprint, !isvalid and we'll fail the transfer
+                folder.tree->files.emplace_back(path, node.fingerprint);
+
+                filecount += 1;
             }
-            tree.subtrees.push_back(std::move(newTreeNode));
+            else if (node.type == FOLDERNODE || node.type == TYPE_NESTED_MOUNT)
+            {
+                // generate new subtree
+                unique_ptr<Tree> newTreeNode(new Tree);
+                newTreeNode->folderName = node.localname.toName(*fsaccess);
+                newTreeNode->fsType = folder.tree->fsType;
+
+                Folder subfolder{newTreeNode.get(), path, node.fsid, folder.fsfp};
+                if (node.type == TYPE_NESTED_MOUNT)
+                {
+                    // another filesystem, with its own workers (and fs type), scanned from the fsid of its root
+                    if (!folderFsid(path, subfolder.fsid))
+                    {
+                        return scanFolder_failed;
+                    }
+                    subfolder.fsfp = fsaccess->fsFingerprint(path);
+                    newTreeNode->fsType = fsaccess->getlocalfstype(path);
+                }
 
-            foldercount += 1;
+                // generate fresh random key and node attributes
+                MegaClient::putnodes_prepareOneFolder(&newTreeNode->newnode, newTreeNode->folderName, rng, tmpnodecipher, false);
+
+                // set nodeHandle
+                newTreeNode->newnode.nodehandle = nextUploadId();
+                newTreeNode->newnode.parenthandle = folder.tree->newnode.nodehandle;
+
+                folder.tree->subtrees.push_back(std::move(newTreeNode));
+                pending.push_back(std::move(subfolder));
+
+                foldercount += 1;
+            }
         }
     }
-    recursive--;
     return scanFolder_succeeded;
 }
 
@@ -30234,6 +31071,12 @@ MegaFolderUploadController::batchResult MegaFolderUploadController::createNextFo
             t->megaNode.reset(megaApi->getChildNodeOfType(tree.megaNode.get(), t->folderName.c_str(), MegaNode::TYPE_FOLDER));
         }
 
+        if (!t->megaNode && t->creating)
+        {
+            // on its way in a batch still in flight, its subfolders wait for that one
+            continue;
+        }
+
         // if node doesn't exist yet and we haven't exceeded the limit per batch
         if (!t->megaNode && newnodes.size() < MAXNODESUPLOAD)
         {
@@ -30244,6 +31087,7 @@ MegaFolderUploadController::batchResult MegaFolderUploadController::createNextFo
                 assert(tree.megaNode);
                 t->newnode.parenthandle = UNDEF;
             }
+            t->creating = true;
             newnodes.push_back(std::move(t->newnode));
         }
 
@@ -30257,7 +31101,6 @@ MegaFolderUploadController::batchResult MegaFolderUploadController::createNextFo
 
     if (isCancelledByFolderTransferToken())
     {
-        complete(API_EINCOMPLETE, true);
         return batchResult_cancelled;
     }
 
@@ -30275,7 +31118,7 @@ MegaFolderUploadController::batchResult MegaFolderUploadController::createNextFo
             megaapiThreadClient()->nextreqtag(),
             false,
             {}, // customerIpPort
-            [this, weak_this, filecount](const Error& e,
+            [this, weak_this](const Error& e,
                                          targettype_t,
                                          vector<NewNode>&,
                                          bool,
@@ -30289,25 +31132,18 @@ MegaFolderUploadController::batchResult MegaFolderUploadController::createNextFo
                 assert(mMainThreadId == std::this_thread::get_id());
 
                 // lambda function that will be executed as completion function in putnodes procresult
-                if (e)
+                assert(mFolderBatchesInFlight > 0);
+                --mFolderBatchesInFlight;
+
+                if (e && !mFolderCreationError)
                 {
-                    complete(e);
+                    mFolderCreationError = e;
                 }
-                else
-                {
-                    // start the next batch, if there are any left (or start transfers, if we are ready)
-                    vector<NewNode> newnodes;
-#ifndef NDEBUG
-                    batchResult r =
-#endif
-                    createNextFolderBatch(mUploadTree, newnodes, filecount, true);
-
-                    assert(r == batchResult_cancelled ||
-                           r == batchResult_requestSent ||
-                           r == batchResult_batchesComplete);
 
-                }
+                // start the next batches, if there are any left, and the transfers of the folders created
+                createFolders();
             });
+        ++mFolderBatchesInFlight;
 
         unsigned existing = 0, total = 0;
         mUploadTree.recursiveCountFolders(existing, total);
@@ -30318,27 +31154,7 @@ MegaFolderUploadController::batchResult MegaFolderUploadController::createNextFo
 
     if (&tree == &mUploadTree)
     {
-        // we recursed the entire tree without finding any more folder nodes to create.
-        // time to set the file uploads in motion.
-
-        TransferQueue transferQueue;
-        if (!genUploadTransfersForFiles(mUploadTree, transferQueue))
-        {
-            complete(API_EINCOMPLETE, true);
-        }
-        else if (transferQueue.empty())
-        {
-            complete(API_OK);
-        }
-        else
-        {
-            // once we call sendPendingTransfers, we are guaranteed start/finish callbacks for each file transfer
-            // the last callback of onFinish for one of these will also complete and destroy this MegaFolderUploadController
-            transfersTotalCount = transferQueue.size();
-            megaApi->sendPendingTransfers(&transferQueue, this);
-            // no further code can be added here, this object may now be deleted (eg, due to cancel token activation)
-        }
-
+        // we recursed the entire tree without finding any more folder nodes to create for now.
         return batchResult_batchesComplete;
     }
 
@@ -30347,14 +31163,24 @@ MegaFolderUploadController::batchResult MegaFolderUploadController::createNextFo
 
 bool MegaFolderUploadController::genUploadTransfersForFiles(Tree& tree, TransferQueue& transferQueue)
 {
-    for (const auto& localpath : tree.files)
+    if (!tree.megaNode)
+    {
+        // not created yet, nor anything below it
+        return true;
+    }
+
+    if (!tree.filesQueued)
     {
-        MegaTransferPrivate *subTransfer = megaApi->createUploadTransfer(false, localpath.lp.toPath(false).c_str(),
-                                                                      tree.megaNode.get(), nullptr, (const char*)NULL,
-                                                                      MegaApi::INVALID_CUSTOM_MOD_TIME, tag, false, nullptr /*appdata*/, false, false, tree.fsType, transfer->accessCancelToken(), this, &localpath.fp);
-        transferQueue.push(subTransfer);
+        for (const auto& localpath : tree.files)
+        {
+            MegaTransferPrivate *subTransfer = megaApi->createUploadTransfer(false, localpath.lp.toPath(false).c_str(),
+                                                                          tree.megaNode.get(), nullptr, (const char*)NULL,
+                                                                          MegaApi::INVALID_CUSTOM_MOD_TIME, tag, false, nullptr /*appdata*/, false, false, tree.fsType, transfer->accessCancelToken(), this, &localpath.fp);
+            transferQueue.push(subTransfer);
 
-        if (isCancelledByFolderTransferToken()) return false;
+            if (isCancelledByFolderTransferToken()) return false;
+        }
+        tree.filesQueued = true;
     }
 
     for (auto& t : tree.subtrees)
@@ -30366,6 +31192,89 @@ bool MegaFolderUploadController::genUploadTransfersForFiles(Tree& tree, Transfer
     return true;
 }
 
+void MegaFolderUploadController::createFolders()
+{
+    assert(mMainThreadId == std::this_thread::get_id());
+
+    while (!mFolderCreationError && mFolderBatchesInFlight < MAX_FOLDER_BATCHES_IN_FLIGHT)
+    {
+        vector<NewNode> newnodes;
+        batchResult r = createNextFolderBatch(mUploadTree, newnodes, mFileCount, true);
+
+        assert(r == batchResult_cancelled ||
+               r == batchResult_requestSent ||
+               r == batchResult_batchesComplete);
+
+        if (r == batchResult_cancelled)
+        {
+            mFolderCreationError = API_EINCOMPLETE;
+            mFolderCreationCancelled = true;
+        }
+
+        if (r != batchResult_requestSent)
+        {
+            break;
+        }
+    }
+
+    // the files of every folder created so far can go, whether the rest of the tree exists yet or not
+    TransferQueue transferQueue;
+    if (!mFolderCreationError && !genUploadTransfersForFiles(mUploadTree, transferQueue))
+    {
+        mFolderCreationError = API_EINCOMPLETE;
+        mFolderCreationCancelled = true;
+    }
+    mFilesQueued += transferQueue.size();
+
+    if (!mFolderBatchesInFlight)
+    {
+        // every folder exists by now, or never will
+        if (!mFolderCreationError && mFilesQueued < mFileCount)
+        {
+            LOG_err << "MegaFolderUploadController: nothing else to create, but " << (mFileCount - mFilesQueued) << " files have no folder to go to";
+            mFolderCreationError = API_EINCOMPLETE;
+        }
+
+        // the files of the folders that weren't created are not expected anymore, nor is the tree
+        size_t unqueued = mFileCount - mFilesQueued;
+        mFilesQueued = mFileCount;
+        setTransfersTotalCount(getTransfersTotalCount() - unqueued - 1);
+
+        // they count as failed, so the operation finishes as incomplete
+        mIncompleteTransfers += unqueued;
+        if (mFolderCreationError && !mIncompleteTransfers)
+        {
+            ++mIncompleteTransfers;
+        }
+
+        if (transferQueue.empty())
+        {
+            if (allSubtransfersResolved())
+            {
+                // no file transfer left to complete the operation
+                complete(mFolderCreationError ? Error(mFolderCreationError) : Error(mIncompleteTransfers ? API_EINCOMPLETE : API_OK), mFolderCreationCancelled);
+                return;
+            }
+
+            if (transfersStartedCount == getTransfersTotalCount() && !startedTransferring && !mFolderCreationError)
+            {
+                // the last files started while the tree wasn't finished yet
+                notifyStage(MegaTransfer::STAGE_TRANSFERRING_FILES);
+                megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_TRANSFERRING_FILES, 0, 0, unsigned(transfersTotalCount), nullptr, nullptr);
+                startedTransferring = true;
+            }
+        }
+    }
+
+    if (!transferQueue.empty())
+    {
+        // once we call sendPendingTransfers, we are guaranteed start/finish callbacks for each file transfer
+        // the last callback of onFinish for one of these will also complete and destroy this MegaFolderUploadController
+        megaApi->sendPendingTransfers(&transferQueue, this);
+        // no further code can be added here, this object may now be deleted (eg, due to cancel token activation)
+    }
+}
+
 void MegaRecursiveOperation::setRootNodeHandleInTransfer()
 {
     if (transfer && transfer->getType() == MegaTransfer::TYPE_UPLOAD)
@@ -31584,9 +32493,22 @@ void MegaFolderDownloadController::start(MegaNode *node)
     }
 
     notifyStage(MegaTransfer::STAGE_SCAN);
-    // for download scan is just checking nodes, we can do this all in one quick pass
-    unsigned fileAddedCount = 0;
-    scanFolder_result sr = scanFolder(node, path, fsType, fileAddedCount);
+
+    if (!node->isForeign() && !node->isPublic())
+    {
+        // load the whole subtree with a single query, so the walk is resolved from RAM (as far as the cache allows)
+        megaapiThreadClient()->mNodeManager.prefetchSubtree(NodeHandle().set6byte(node->getHandle()), 0);
+    }
+
+    mFsType = fsType;
+    unique_ptr<MegaNode> rootNode(node->isForeign() ? nullptr : node->copy());
+    MegaNode* root = rootNode ? rootNode.get() : node;
+    mFoldersToWalk.push_back(FolderToWalk{std::move(rootNode), root, path});
+
+    // for download scan is just checking nodes, the first step is taken here and the rest as the
+    // folders of the previous one are created, so transfers start while the walk goes on
+    unique_ptr<Step> step(new Step);
+    scanFolder_result sr = walkNextStep(*step);
 
     if (sr != scanFolder_succeeded)
     {
@@ -31598,145 +32520,231 @@ void MegaFolderDownloadController::start(MegaNode *node)
         {
             complete(API_EINTERNAL);
         }
+        return;
     }
-    else
-    {
-        // it's mandatory to notify stage change from MegaApiImpl's thread to avoid deadlocks and other issues
-        notifyStage(MegaTransfer::STAGE_CREATE_TREE);
 
-        // start worker thread to create local folder tree
-        mWorkerThread = std::thread([this, fsType, path, fileAddedCount](){
+    // the walk itself counts as one more sub-transfer, so the last file to finish doesn't
+    // complete the operation while there are folders left to walk
+    transfersTotalCount = 1;
+
+    // it's mandatory to notify stage change from MegaApiImpl's thread to avoid deadlocks and other issues
+    notifyStage(MegaTransfer::STAGE_CREATE_TREE);
+    handStepToWorker(std::move(step));
+
+    // start worker thread to create local folder tree
+    mWorkerThread = std::thread([this]() {
+
+        // use a weak_ptr in case this 'this' object doesn't exist anymore when a step completion starts executing
+        weak_ptr<MegaFolderDownloadController> weak_this = shared_from_this();
+
+        for (;;)
+        {
+            unique_ptr<Step> step;
+            {
+                std::unique_lock<std::mutex> lock(mStepMutex);
+                while (!mNextStep && !mWalkFinished)
+                {
+                    if (mWorkerThreadStopFlag)
+                    {
+                        return;
+                    }
+                    mStepCondition.wait_for(lock, std::chrono::milliseconds(100));
+                }
+
+                if (!mNextStep)
+                {
+                    // the main thread is done with the walk
+                    return;
+                }
+                step = std::move(mNextStep);
+            }
 
             // local folder creation runs on the download worker thread (and checks the cancelled flag)
             Error e;
-            std::shared_ptr<TransferQueue> transferQueue = createFolderGenDownloadTransfersForFiles(fsType, fileAddedCount, e);
+            std::shared_ptr<TransferQueue> transferQueue = createFolderGenDownloadTransfersForFiles(*step, e);
 
             // mCompletionForMegaApiThread lambda will be executed on the MegaApiImpl's thread
-            // use a weak_ptr in case this 'this' object doesn't exist anymore when lambda starts executing
-            weak_ptr<MegaFolderDownloadController> weak_this = shared_from_this();
-
-            // the thread always queues a function to execute on MegaApi thread for onFinish()
-            // we keep a pointer to it in case we need to cancel()
-            mCompletionForMegaApiThread.reset(new ExecuteOnce([this, e, transferQueue, path, weak_this]() {
+            // there is a single one queued at a time, the next step isn't handed to this thread before it runs
+            mCompletionForMegaApiThread.reset(new ExecuteOnce([this, e, transferQueue, weak_this]() {
 
                 // double check our object still exists when completion function starts executing
                 if (!weak_this.lock()) return;
                 assert(weak_this.lock().get() == this);
 
                 // these next parts must run on MegaApiImpl's thread again, as
-                // genUploadTransfersForFiles or checkCompletion may call the fireOnXYZ() functions
+                // sendPendingTransfers or complete may call the fireOnXYZ() functions
                 assert(mMainThreadId == std::this_thread::get_id());
 
-                // make sure the thread is joined.  This lets us add error-catching asserts elsewhere.
-                if (mWorkerThread.joinable())
-                {
-                    mWorkerThread.join();
-                }
-
-                if (e)
-                {
-                    complete(e);
-                }
-                else
-                {
-                    // downloadFiles must run on the megaApi thread, as it may call fireOnTransferXYZ()
-                    if (!transferQueue)
-                    {
-                        complete(API_EINCOMPLETE, true);
-                    }
-                    else if (transferQueue->empty())
-                    {
-                        complete(API_OK);
-                    }
-                    else
-                    {
-                        // once we call sendPendingTransfers, we are guaranteed start/finish callbacks for each file transfer
-                        // the last callback of onFinish for one of these will also complete and destroy this MegaFolderUploadController
-                        transfersTotalCount = transferQueue->size();
-
-                        megaApi->sendPendingTransfers(transferQueue.get(), this, megaapiThreadClient()->fsaccess->availableDiskSpace(path));
-                        // no further code can be added here, this object may now be deleted (eg, due to cancel token activation)
-
-                        // complete() will finally be called when the last sub-transfer finishes
-                    }
-                }
+                stepCompleted(transferQueue, e);
             }));
 
             // Queue that function.
             megaApi->executeOnThread(mCompletionForMegaApiThread);
-        });
-    }
+
+            if (e)
+            {
+                return;
+            }
+        }
+    });
 }
 
-MegaFolderDownloadController::scanFolder_result MegaFolderDownloadController::scanFolder(MegaNode *node, LocalPath& localpath, FileSystemType fsType, unsigned& fileAddedCount)
+MegaFolderDownloadController::scanFolder_result MegaFolderDownloadController::walkNextStep(Step& step)
 {
     assert(mMainThreadId == std::this_thread::get_id());
 
-    if (isCancelledByFolderTransferToken())
+    // subfolders wait for the next step, their parents are created with this one
+    vector<FolderToWalk> subfolders;
+    size_t files = 0;
+
+    while (!mFoldersToWalk.empty() && step.folders.size() < FOLDERS_PER_STEP && files < FILES_PER_STEP)
     {
-        return scanFolder_cancelled;
+        if (isCancelledByFolderTransferToken())
+        {
+            return scanFolder_cancelled;
+        }
+
+        FolderToWalk folder = std::move(mFoldersToWalk.back());
+        mFoldersToWalk.pop_back();
+
+        step.folders.emplace_back(folder.localPath);
+        LocalTree& localTree = step.folders.back();
+        mFolderCount += 1;
+
+        megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_SCAN, mFolderCount, 0, mFileCount, &folder.localPath, nullptr);
+
+        MegaNodeList *children = nullptr;
+        unique_ptr<MegaNodeList> autoDelChildren;
+        if (folder.node->isForeign())
+        {
+            children = folder.node->getChildren();
+        }
+        else
+        {
+            children = megaApi->getChildren(folder.node, MegaApi::ORDER_NONE);  // no order is much faster for a very large folder (or nested folders with large subfolders)
+            autoDelChildren.reset(children);
+        }
+
+        if (!children)
+        {
+            LOG_err << "Child nodes not found: " << folder.localPath;
+            return scanFolder_failed;
+        }
+
+        for (int i = 0; i < children->size(); i++)
+        {
+            MegaNode *child = children->get(i);
+            if (child->getType() == MegaNode::TYPE_FILE)
+            {
+                localTree.childrenNodes.emplace_back(child->copy());
+                mFileCount += 1;
+                files += 1;
+            }
+            else
+            {
+                LocalPath localpath = folder.localPath;
+                localpath.appendWithSeparator(LocalPath::fromRelativeName(child->getName(), *fsaccess, mFsType), true);
+                unique_ptr<MegaNode> subfolder(folder.node->isForeign() ? nullptr : child->copy());
+                MegaNode* subfolderNode = subfolder ? subfolder.get() : child;
+                subfolders.push_back(FolderToWalk{std::move(subfolder), subfolderNode, std::move(localpath)});
+            }
+        }
     }
 
-    recursive++;
-    size_t index = 0;
-    if (node->getType() == FOLDERNODE || node->getType() == ROOTNODE)
+    std::move(subfolders.begin(), subfolders.end(), std::back_inserter(mFoldersToWalk));
+    return scanFolder_succeeded;
+}
+
+void MegaFolderDownloadController::handStepToWorker(unique_ptr<Step> step)
+{
+    assert(mMainThreadId == std::this_thread::get_id());
+
+    megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_CREATE_TREE, mFolderCount, mFoldersHanded, mFileCount, nullptr, nullptr);
+    mFoldersHanded += step ? unsigned(step->folders.size()) : 0;
+
     {
-       // If node is a folder or root node, store it's localPath, along with a vector with it's children file nodes
-       mLocalTree.emplace_back(LocalTree(localpath));
-       index = mLocalTree.size() - 1;
+        std::lock_guard<std::mutex> lock(mStepMutex);
+        mNextStep = std::move(step);
+        mWalkFinished = !mNextStep;
     }
+    mStepCondition.notify_one();
+}
 
-    megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_SCAN, unsigned(mLocalTree.size()), 0, fileAddedCount, &localpath, nullptr);
+void MegaFolderDownloadController::stepCompleted(shared_ptr<TransferQueue> transferQueue, Error e)
+{
+    assert(mMainThreadId == std::this_thread::get_id());
+
+    // the worker thread fails a step with API_EINCOMPLETE when cancelled
+    bool cancelled = e == API_EINCOMPLETE;
+    size_t queued = transferQueue ? transferQueue->size() : 0;
+    transfersTotalCount += queued;
 
-    MegaNodeList *children = nullptr;
-    unique_ptr<MegaNodeList> autoDelChildren;
-    if (node->isForeign())
+    if (!e && !cancelled)
     {
-        children = node->getChildren();
+        unique_ptr<Step> step(new Step);
+        scanFolder_result sr = walkNextStep(*step);
+
+        if (sr == scanFolder_cancelled)
+        {
+            e = API_EINCOMPLETE;
+            cancelled = true;
+        }
+        else if (sr == scanFolder_failed)
+        {
+            // inconsistent node state
+            e = API_EINTERNAL;
+        }
+        else if (!step->folders.empty())
+        {
+            handStepToWorker(std::move(step));
+
+            if (queued)
+            {
+                // once we call sendPendingTransfers, we are guaranteed start/finish callbacks for each file transfer
+                megaApi->sendPendingTransfers(transferQueue.get(), this, megaapiThreadClient()->fsaccess->availableDiskSpace(LocalPath::fromAbsolutePath(transfer->getPath())));
+            }
+            return;
+        }
     }
-    else
+
+    // the walk is over, stop the worker thread. This lets us add error-catching asserts elsewhere.
+    handStepToWorker(nullptr);
+    if (mWorkerThread.joinable())
     {
-        children = megaApi->getChildren(node, MegaApi::ORDER_NONE);  // no order is much faster for a very large folder (or nested folders with large subfolders)
-        autoDelChildren.reset(children);
+        mWorkerThread.join();
     }
 
-    if (!children)
+    // nor is the walk expected anymore
+    --transfersTotalCount;
+    if (e && !mIncompleteTransfers)
     {
-        LOG_err << "Child nodes not found: " << localpath;
-        recursive--;
-        return scanFolder_failed;
+        // so the operation finishes as incomplete, even if all the transfers started succeed
+        ++mIncompleteTransfers;
     }
 
-    for (int i = 0; i < children->size(); i++)
+    if (!queued)
     {
-        if (isCancelledByFolderTransferToken())
+        if (allSubtransfersResolved())
         {
-            return scanFolder_cancelled;
+            // no file transfer left to complete the operation
+            complete(e ? e : Error(mIncompleteTransfers ? API_EINCOMPLETE : API_OK), cancelled);
+            return;
         }
 
-        MegaNode *child = children->get(i);
-        if (child->getType() == MegaNode::TYPE_FILE)
+        if (transfersStartedCount == transfersTotalCount && !startedTransferring && !e)
         {
-            // Add child node to vector in mLocalTree at index we have stored it's localPath
-            ::mega::unique_ptr<MegaNode> childNode (child->copy());
-            mLocalTree.at(index).childrenNodes.push_back(std::move(childNode));
-            fileAddedCount += 1;
-        }
-        else
-        {
-            auto restoreLen = makeScopedSizeRestorer(localpath);
-            localpath.appendWithSeparator(LocalPath::fromRelativeName(child->getName(), *fsaccess, fsType), true);
-            scanFolder_result result = scanFolder(child, localpath, fsType, fileAddedCount);
-
-            if (result != scanFolder_succeeded)
-            {
-                recursive--;
-                return result;
-            }
+            // the last files started while the walk was still going on
+            notifyStage(MegaTransfer::STAGE_TRANSFERRING_FILES);
+            megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_TRANSFERRING_FILES, 0, 0, unsigned(transfersTotalCount), nullptr, nullptr);
+            startedTransferring = true;
         }
+        return;
     }
-    recursive--;
-    return scanFolder_succeeded;
+
+    // once we call sendPendingTransfers, we are guaranteed start/finish callbacks for each file transfer
+    // the last callback of onFinish for one of these will also complete and destroy this MegaFolderDownloadController
+    megaApi->sendPendingTransfers(transferQueue.get(), this, megaapiThreadClient()->fsaccess->availableDiskSpace(LocalPath::fromAbsolutePath(transfer->getPath())));
+    // no further code can be added here, this object may now be deleted (eg, due to cancel token activation)
 }
 
 bool MegaRecursiveOperation::isStoppedOrCancelled(const std::string& name) const
@@ -31754,24 +32762,42 @@ bool MegaRecursiveOperation::isStoppedOrCancelled(const std::string& name) const
     return false;
 }
 
-// Create all local directories in one shot (on the download worker thread)
+// Create the local directories of a step (on the download worker thread)
 // for performance and reducing UI waiting time, we combine createFolder and transferQueue generating in one loop
-std::unique_ptr<TransferQueue> MegaFolderDownloadController::createFolderGenDownloadTransfersForFiles(FileSystemType fsType, uint32_t fileCount, Error &e)
+std::unique_ptr<TransferQueue> MegaFolderDownloadController::createFolderGenDownloadTransfersForFiles(Step& step, Error &e)
 {
-    unsigned created = 0;
     assert(mMainThreadId != std::this_thread::get_id());
 
     auto transferQueue = std::make_unique<TransferQueue>();
 
-    // update stage to begin
-    if (!mLocalTree.empty())
+    // the parents of all of them exist already, so they are created at once
+    vector<Error> results(step.folders.size());
+    auto createFolders = [this, &step, &results](FileSystemAccess& fsa, size_t first, size_t stride) {
+        for (size_t i = first; i < step.folders.size() && !isStoppedOrCancelled("MegaFolderDownloadController::createFolderGenDownloadTransfersForFiles"); i += stride)
+        {
+            results[i] = MegaApiImpl::createLocalFolder_unlocked(step.folders[i].localPath, fsa);
+        }
+    };
+
+    size_t threads = std::min<size_t>(FOLDER_CREATION_THREADS, step.folders.size());
+    vector<std::thread> creators;
+    for (size_t t = 1; t < threads; ++t)
     {
-        megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_CREATE_TREE, unsigned(mLocalTree.size()), created, fileCount, nullptr, nullptr);
+        creators.emplace_back([this, &createFolders, t, threads]() {
+            MegaFileSystemAccess fsa;
+            fsa.setdefaultfilepermissions(megaApi->getDefaultFilePermissions());
+            fsa.setdefaultfolderpermissions(megaApi->getDefaultFolderPermissions());
+            createFolders(fsa, t, threads);
+        });
+    }
+    createFolders(*fsaccess, 0, std::max<size_t>(threads, 1));
+    for (auto& creator : creators)
+    {
+        creator.join();
     }
 
     // creating folders and generate transfers for files
-    auto it = mLocalTree.begin();
-    while (it != mLocalTree.end())
+    for (size_t i = 0; i < step.folders.size(); ++i)
     {
         if (isStoppedOrCancelled("MegaFolderDownloadController::createFolderGenDownloadTransfersForFiles"))
         {
@@ -31779,30 +32805,24 @@ std::unique_ptr<TransferQueue> MegaFolderDownloadController::createFolderGenDown
             return nullptr;
         }
 
-        LocalPath &localpath = it->localPath;
-
-        // try to create the folder
-        e = MegaApiImpl::createLocalFolder_unlocked(localpath, *fsaccess);
+        e = results[i];
 
         // errors besides the folder already exists is an error
         if (e && e != API_EEXIST)
         {
-            mLocalTree.clear();
             return nullptr;
         }
 
         auto folderAlreadyExist = (e && e == API_EEXIST);
 
-        if (!genDownloadTransfersForFiles(transferQueue.get(), *it, fsType, folderAlreadyExist))
+        if (!genDownloadTransfersForFiles(transferQueue.get(), step.folders[i], mFsType, folderAlreadyExist))
         {
             e = API_EINCOMPLETE;
             return nullptr;
         }
 
-        ++it;
-        ++created;
-
-        megaApi->fireOnFolderTransferUpdate(transfer, MegaTransfer::STAGE_CREATE_TREE, unsigned(mLocalTree.size()), created, fileCount, nullptr, nullptr);
+        // no need to keep the file nodes around anymore
+        step.folders[i].childrenNodes.clear();
     }
 
     e = API_OK;
@@ -31916,6 +32936,7 @@ void StreamingBuffer::init(size_t capacity)
     }
 
     this->capacity = static_cast<unsigned>(capacity);
+    delete [] this->buffer;
     this->buffer = new char[this->capacity];
     this->inpos = 0;
     this->outpos = 0;
@@ -32066,6 +33087,17 @@ void StreamingBuffer::freeData(size_t len)
     free += len;
 }
 
+void StreamingBuffer::release()
+{
+    delete [] buffer;
+    buffer = NULL;
+    capacity = 0;
+    inpos = 0;
+    outpos = 0;
+    size = 0;
+    free = 0;
+}
+
 void StreamingBuffer::setMaxBufferSize(unsigned int bufferSize)
 {
     LOG_debug << "[Streaming] Set new max buffer size for StreamingBuffer: " << bufferSize;
@@ -32159,6 +33191,297 @@ std::string StreamingBuffer::bufferStatus() const
     return bufferState;
 }
 
+static double movingAverage(double average, double sample)
+{
+    return average ? average * 0.75 + sample * 0.25 : sample;
+}
+
+static double secondsBetween(StreamingBufferController::time_point from, StreamingBufferController::time_point to)
+{
+    return std::chrono::duration<double>(to - from).count();
+}
+
+StreamingBufferController::StreamingBufferController(size_t minSize, size_t maxSize)
+    : minSize(std::min(minSize, maxSize))
+    , maxSize(maxSize)
+{
+}
+
+void StreamingBufferController::onDrained(size_t len, bool ranDry, time_point now)
+{
+    if (lastDrain == time_point() || secondsBetween(lastDrain, now) > MAX_DRAIN_GAP)
+    {
+        // what was written meanwhile doesn't tell the client's pace
+        sampleStart = now;
+        sampleBytes = 0;
+    }
+    else
+    {
+        sampleBytes += len;
+        double elapsed = secondsBetween(sampleStart, now);
+        if (elapsed >= MIN_SAMPLE_TIME)
+        {
+            rate = movingAverage(rate, static_cast<double>(sampleBytes) / elapsed);
+            sampleStart = now;
+            sampleBytes = 0;
+        }
+    }
+    lastDrain = now;
+
+    if (ranDry && margin < MAX_MARGIN)
+    {
+        margin = std::min(margin * 2, MAX_MARGIN);
+        LOG_debug << "[Streaming] Connection ran out of data. Drain rate: " << static_cast<size_t>(rate) << " B/s, margin: " << margin << " secs";
+    }
+}
+
+void StreamingBufferController::onPaused()
+{
+    margin = std::max(margin * 0.9, MIN_MARGIN);
+}
+
+size_t StreamingBufferController::queueSize(double readLatency, double readRate) const
+{
+    if (!rate || (readRate && readRate < rate * 1.25))
+    {
+        return maxSize;
+    }
+
+    double size = rate * (readLatency + margin);
+    if (size >= static_cast<double>(maxSize))
+    {
+        return maxSize;
+    }
+    return std::max(minSize, static_cast<size_t>(size));
+}
+
+StreamingFeed::StreamingFeed(MegaApiImpl *megaApi, MegaNode *node, m_off_t start)
+    : megaApi(megaApi)
+    , node(node->copy())
+    , readPos(start)
+    , readEnd(start)
+{
+}
+
+StreamingFeed::~StreamingFeed()
+{
+    // stops the read, if any
+    megaApi->removeTransferListener(this);
+}
+
+bool StreamingFeed::isFeeding(MegaNode *n) const
+{
+    return n->getHandle() == node->getHandle() && *n->getNodeKey() == *node->getNodeKey();
+}
+
+bool StreamingFeed::canServe(m_off_t pos)
+{
+    std::lock_guard<std::mutex> g(feedMutex);
+    m_off_t windowStart = window.empty() ? readPos : window.front().first;
+    return pos >= windowStart && pos <= readPos;
+}
+
+void StreamingFeed::follow(MegaHTTPContext *httpctx, m_off_t start, m_off_t end)
+{
+    std::lock_guard<std::mutex> g(feedMutex);
+
+    // no less than the default buffer, no more than the buffer the connection would have had
+    size_t budget = httpctx->streamingBuffer.getMaxBufferSize();
+    followers.push_back(Follower{httpctx, start, end, StreamingBufferController(StreamingBuffer::MAX_BUFFER_SIZE, budget)});
+    if (deliver(followers.back()))
+    {
+        LOG_debug << "[Streaming] Range served from recently read data. From " << start << " size " << (end - start);
+        followers.pop_back();
+        return;
+    }
+    read();
+}
+
+void StreamingFeed::unfollow(MegaHTTPContext *httpctx)
+{
+    std::lock_guard<std::mutex> g(feedMutex);
+    followers.remove_if([httpctx](const Follower& f) { return f.httpctx == httpctx; });
+}
+
+void StreamingFeed::drained(MegaHTTPContext *httpctx, size_t len)
+{
+    std::lock_guard<std::mutex> g(feedMutex);
+    for (auto& follower : followers)
+    {
+        if (follower.httpctx == httpctx)
+        {
+            uv_mutex_lock(&httpctx->mutex);
+            bool ranDry = follower.delivered && !httpctx->queuedBytes;
+            uv_mutex_unlock(&httpctx->mutex);
+
+            follower.controller.onDrained(len, ranDry, std::chrono::steady_clock::now());
+            break;
+        }
+    }
+    read();
+}
+
+bool StreamingFeed::deliver(Follower &follower)
+{
+    MegaHTTPContext *httpctx = follower.httpctx;
+    size_t queued = 0;
+
+    uv_mutex_lock(&httpctx->mutex);
+    for (auto it = window.begin(); it != window.end() && follower.pos < follower.end; it++)
+    {
+        m_off_t chunkEnd = it->first + static_cast<m_off_t>(it->second->size());
+        if (chunkEnd <= follower.pos)
+        {
+            continue;
+        }
+
+        size_t offset = static_cast<size_t>(follower.pos - it->first);
+        size_t len = static_cast<size_t>(std::min(chunkEnd, follower.end) - follower.pos);
+        httpctx->slices.push_back(StreamingSlice{it->second, offset, len});
+        httpctx->queuedBytes += len;
+        follower.pos += static_cast<m_off_t>(len);
+        queued += len;
+    }
+    uv_mutex_unlock(&httpctx->mutex);
+
+    if (queued)
+    {
+        follower.delivered = true;
+
+        // notify the HTTP server
+        uv_async_send(&httpctx->asynchandle);
+    }
+    return follower.pos >= follower.end;
+}
+
+bool StreamingFeed::backlogged(bool resuming)
+{
+    bool full = false;
+    for (auto& follower : followers)
+    {
+        uv_mutex_lock(&follower.httpctx->mutex);
+        size_t queued = follower.httpctx->queuedBytes;
+        uv_mutex_unlock(&follower.httpctx->mutex);
+
+        size_t queueSize = follower.controller.queueSize(readLatency, readRate);
+        if (resuming ? queued > queueSize / 2 : queued >= queueSize)
+        {
+            if (resuming)
+            {
+                return true;
+            }
+            follower.controller.onPaused();
+            full = true;
+        }
+    }
+    return full;
+}
+
+void StreamingFeed::read()
+{
+    if (reading || stopping)
+    {
+        return;
+    }
+
+    m_off_t end = readPos;
+    for (auto& follower : followers)
+    {
+        end = std::max(end, follower.end);
+    }
+
+    if (end == readPos || backlogged(true))
+    {
+        return;
+    }
+
+    LOG_debug << "[Streaming] Reading from " << readPos << " len: " << (end - readPos)
+              << " for " << followers.size() << " connection(s)";
+    reading = true;
+    readEnd = end;
+    readStarted = std::chrono::steady_clock::now();
+    awaitingData = true;
+    megaApi->startStreaming(node.get(), readPos, end - readPos, this);
+}
+
+bool StreamingFeed::onTransferData(MegaApi *, MegaTransfer *transfer, char *buffer, size_t size)
+{
+    LOG_verbose << "Streaming data received: " << transfer->getTransferredBytes() << " Size: " << size;
+
+    std::lock_guard<std::mutex> g(feedMutex);
+
+    auto now = std::chrono::steady_clock::now();
+    if (awaitingData)
+    {
+        readLatency = movingAverage(readLatency, secondsBetween(readStarted, now));
+        awaitingData = false;
+    }
+    else if (now > lastData)
+    {
+        readRate = movingAverage(readRate, static_cast<double>(size) / secondsBetween(lastData, now));
+    }
+    lastData = now;
+
+    // the only copy of the data, whatever the number of connections it's written to
+    window.emplace_back(readPos, std::make_shared<const string>(buffer, size));
+    windowSize += size;
+    readPos += static_cast<m_off_t>(size);
+    while (window.size() > 1 && windowSize - window.front().second->size() >= WINDOW_SIZE)
+    {
+        windowSize -= window.front().second->size();
+        window.pop_front();
+    }
+
+    m_off_t needed = readPos;
+    for (auto it = followers.begin(); it != followers.end(); )
+    {
+        if (deliver(*it))
+        {
+            it = followers.erase(it);
+        }
+        else
+        {
+            needed = std::max(needed, it->end);
+            it++;
+        }
+    }
+
+    if (readPos < readEnd && needed > readPos && !backlogged(false))
+    {
+        return true;
+    }
+
+    if (readPos < readEnd)
+    {
+        LOG_debug << "[Streaming] " << (needed > readPos ? "Pausing" : "Stopping") << " the read at " << readPos;
+    }
+    stopping = true;
+    return false;
+}
+
+void StreamingFeed::onTransferFinish(MegaApi *, MegaTransfer *, MegaError *e)
+{
+    std::lock_guard<std::mutex> g(feedMutex);
+    reading = false;
+    stopping = false;
+
+    int ecode = e->getErrorCode();
+    if (ecode != API_OK && ecode != API_EINCOMPLETE)
+    {
+        LOG_warn << "Transfer failed with error code: " << ecode << ". Connections following it: " << followers.size();
+        for (auto& follower : followers)
+        {
+            follower.httpctx->failed = true;
+            uv_async_send(&follower.httpctx->asynchandle);
+        }
+        followers.clear();
+        return;
+    }
+
+    // resumes after a pause, or reads further for connections that joined meanwhile
+    read();
+}
+
 // http_parser settings
 http_parser_settings MegaTCPServer::parsercfg;
 
@@ -32180,6 +33503,7 @@ MegaTCPServer::MegaTCPServer(MegaApiImpl *megaApi, string basePath, bool tls, st
     this->lastHandle = INVALID_HANDLE;
     this->remainingcloseevents = 0;
     this->closing = false;
+    this->loopCount = 1;
     this->thread = new MegaThread();
 #ifdef ENABLE_EVT_TLS
     this->certificatepath = certificatepath;
@@ -32300,60 +33624,22 @@ void MegaTCPServer::run()
     }
 #endif
 
+    unsigned loops = 1;
+#if defined(__linux__) && defined(SO_REUSEPORT)
+    // elsewhere, the connections may not be spread between the sockets sharing a port,
+    // and the TLS context isn't meant to be used from several threads
+    if (!useTLS)
+    {
+        loops = loopCount;
+    }
+#endif
+
     uv_loop_init(&uv_loop);
 
     uv_async_init(&uv_loop, &exit_handle, onCloseRequested);
     exit_handle.data = this;
 
-    uv_tcp_init(&uv_loop, &server);
-    server.data = this;
-
-    uv_tcp_keepalive(&server, 0, 0);
-
-    union {
-        struct sockaddr_in6 ipv6;
-        struct sockaddr_in ipv4;
-    } address;
-
-    if (useIPv6)
-    {
-        if (localOnly)
-        {
-            uv_ip6_addr("::1", port, &address.ipv6);
-        }
-        else
-        {
-            uv_ip6_addr("::", port, &address.ipv6);
-        }
-    }
-    else
-    {
-        if (localOnly)
-        {
-            uv_ip4_addr("127.0.0.1", port, &address.ipv4);
-        }
-        else
-        {
-            uv_ip4_addr("0.0.0.0", port, &address.ipv4);
-        }
-    }
-
-    uv_connection_cb onNewClientCB;
-#ifdef ENABLE_EVT_TLS
-    if (useTLS)
-    {
-         onNewClientCB = onNewClient_tls;
-    }
-    else
-    {
-#endif
-        onNewClientCB = onNewClient;
-#ifdef ENABLE_EVT_TLS
-    }
-#endif
-
-    if(uv_tcp_bind(&server, (const struct sockaddr*)&address, 0)
-        || uv_listen((uv_stream_t*)&server, 32, onNewClientCB))
+    if (!listen(&uv_loop, &server, loops > 1))
     {
         LOG_err << "TCP failed to bind/listen port = " << port;
         port = 0;
@@ -32371,6 +33657,8 @@ void MegaTCPServer::run()
         return;
     }
 
+    startWorkers(loops - 1);
+
     LOG_info << "TCP" << (useTLS ? "(tls)" : "") << " server started on port " << port;
     started = true;
     uv_sem_post(&semaphoreStartup);
@@ -32379,6 +33667,7 @@ void MegaTCPServer::run()
     uv_run(&uv_loop, UV_RUN_DEFAULT);
 
     LOG_info << "UV loop ended";
+    assert(workers.empty());
 #ifdef ENABLE_EVT_TLS
     if (useTLS)
     {
@@ -32483,6 +33772,152 @@ void MegaTCPServer::initializeAndStartListening()
     LOG_debug << "UV loop already alive!";
 }
 
+bool MegaTCPServer::listen(uv_loop_t *loop, uv_tcp_t *handle, bool reusePort)
+{
+    if (reusePort)
+    {
+#if defined(__linux__) && defined(SO_REUSEPORT)
+        // the option has to be set before binding: create the socket now
+        if (uv_tcp_init_ex(loop, handle, static_cast<unsigned>(useIPv6 ? AF_INET6 : AF_INET)))
+        {
+            uv_tcp_init(loop, handle);
+            return false;
+        }
+
+        uv_os_fd_t fd;
+        int on = 1;
+        if (uv_fileno((uv_handle_t*)handle, &fd)
+            || setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)))
+        {
+            LOG_err << "Unable to share port " << port << " between event loops";
+            return false;
+        }
+#else
+        assert(false);
+        uv_tcp_init(loop, handle);
+#endif
+    }
+    else
+    {
+        uv_tcp_init(loop, handle);
+    }
+    handle->data = this;
+
+    uv_tcp_keepalive(handle, 0, 0);
+
+    union {
+        struct sockaddr_in6 ipv6;
+        struct sockaddr_in ipv4;
+    } address;
+
+    if (useIPv6)
+    {
+        if (localOnly)
+        {
+            uv_ip6_addr("::1", port, &address.ipv6);
+        }
+        else
+        {
+            uv_ip6_addr("::", port, &address.ipv6);
+        }
+    }
+    else
+    {
+        if (localOnly)
+        {
+            uv_ip4_addr("127.0.0.1", port, &address.ipv4);
+        }
+        else
+        {
+            uv_ip4_addr("0.0.0.0", port, &address.ipv4);
+        }
+    }
+
+    uv_connection_cb onNewClientCB;
+#ifdef ENABLE_EVT_TLS
+    if (useTLS)
+    {
+         onNewClientCB = onNewClient_tls;
+    }
+    else
+    {
+#endif
+        onNewClientCB = onNewClient;
+#ifdef ENABLE_EVT_TLS
+    }
+#endif
+
+    return !uv_tcp_bind(handle, (const struct sockaddr*)&address, 0)
+        && !uv_listen((uv_stream_t*)handle, 32, onNewClientCB);
+}
+
+void MegaTCPServer::startWorkers(unsigned count)
+{
+    assert(workers.empty());
+    while (count--)
+    {
+        std::unique_ptr<WorkerLoop> worker(new WorkerLoop());
+        worker->tcpServer = this;
+        uv_loop_init(&worker->uv_loop);
+        uv_async_init(&worker->uv_loop, &worker->exit_handle, onWorkerCloseRequested);
+        worker->exit_handle.data = worker.get();
+
+        bool running = listen(&worker->uv_loop, &worker->server, true);
+        if (running)
+        {
+            WorkerLoop *w = worker.get();
+            try
+            {
+                worker->thread = std::thread([w]()
+                {
+                    uv_run(&w->uv_loop, UV_RUN_DEFAULT);
+                    int closeVal = uv_loop_close(&w->uv_loop);
+                    if (closeVal)
+                    {
+                        LOG_err << "[MegaTCPServer::startWorkers] Error closing uv_loop: " << uv_strerror(closeVal);
+                    }
+                });
+            }
+            catch (std::system_error& e)
+            {
+                LOG_err << "Failed to start event loop thread: " << e.what();
+                running = false;
+            }
+        }
+
+        if (!running)
+        {
+            // the connections go to the loops running already
+            uv_close((uv_handle_t *)&worker->exit_handle, NULL);
+            uv_close((uv_handle_t *)&worker->server, NULL);
+            uv_run(&worker->uv_loop, UV_RUN_DEFAULT);
+            uv_loop_close(&worker->uv_loop);
+            break;
+        }
+        workers.push_back(std::move(worker));
+    }
+
+    if (workers.size())
+    {
+        LOG_info << "TCP server port = " << port << " running " << workers.size() + 1 << " event loops";
+    }
+}
+
+void MegaTCPServer::stopWorkers()
+{
+    for (auto& worker : workers)
+    {
+        uv_async_send(&worker->exit_handle);
+    }
+
+    // their connections close on their own threads
+    for (auto& worker : workers)
+    {
+        worker->thread.join();
+    }
+    workers.clear();
+}
+
 void MegaTCPServer::stop(bool doNotWait)
 {
     if (!started)
@@ -32542,6 +33977,16 @@ int MegaTCPServer::getMaxOutputSize()
     return StreamingBuffer::MAX_OUTPUT_SIZE;
 }
 
+void MegaTCPServer::setLoopCount(unsigned count)
+{
+    loopCount = std::max(1u, count);
+}
+
+unsigned MegaTCPServer::getLoopCount()
+{
+    return loopCount;
+}
+
 void MegaTCPServer::setRestrictedMode(int mode)
 {
     this->restrictedMode = mode;
@@ -32712,16 +34157,16 @@ void MegaTCPServer::onNewClient_tls(uv_stream_t *server_handle, int status)
     // Create an object to save context information
     MegaTCPContext* tcpctx = ((MegaTCPServer *)server_handle->data)->initializeContext(server_handle);
 
-    LOG_debug << "Connection received at port " << tcpctx->server->port << " ! " << tcpctx->server->connections.size();
+    LOG_debug << "Connection received at port " << tcpctx->server->port << " !";
 
     // Mutex to protect the data buffer
     uv_mutex_init(&tcpctx->mutex);
 
     // Async handle to perform writes
-    uv_async_init(&tcpctx->server->uv_loop, &tcpctx->asynchandle, onAsyncEvent);
+    uv_async_init(server_handle->loop, &tcpctx->asynchandle, onAsyncEvent);
 
     // Accept the connection
-    uv_tcp_init(&tcpctx->server->uv_loop, &tcpctx->tcphandle);
+    uv_tcp_init(server_handle->loop, &tcpctx->tcphandle);
     if (uv_accept(server_handle, (uv_stream_t*)&tcpctx->tcphandle))
     {
         LOG_err << "uv_accept failed";
@@ -32739,7 +34184,10 @@ void MegaTCPServer::onNewClient_tls(uv_stream_t *server_handle, int status)
         return;
     }
 
-    tcpctx->server->connections.push_back(tcpctx);
+    {
+        std::lock_guard<std::mutex> g(tcpctx->server->connectionsMutex);
+        tcpctx->server->connections.push_back(tcpctx);
+    }
 
     tcpctx->server->readData(tcpctx);
 }
@@ -32771,16 +34219,16 @@ void MegaTCPServer::onNewClient(uv_stream_t* server_handle, int status)
     // Create an object to save context information
     MegaTCPContext* tcpctx = ((MegaTCPServer *)server_handle->data)->initializeContext(server_handle);
 
-    LOG_debug << "Connection received at port " << tcpctx->server->port << "! " << tcpctx->server->connections.size() << " tcpctx = " << tcpctx;
+    LOG_debug << "Connection received at port " << tcpctx->server->port << "! tcpctx = " << tcpctx;
 
     // Mutex to protect the data buffer
     uv_mutex_init(&tcpctx->mutex);
 
-    // Async handle to perform writes
-    uv_async_init(&tcpctx->server->uv_loop, &tcpctx->asynchandle, onAsyncEvent);
+    // Async handle to perform writes, on the loop that accepted it
+    uv_async_init(server_handle->loop, &tcpctx->asynchandle, onAsyncEvent);
 
     // Accept the connection
-    uv_tcp_init(&tcpctx->server->uv_loop, &tcpctx->tcphandle);
+    uv_tcp_init(server_handle->loop, &tcpctx->tcphandle);
     if (uv_accept(server_handle, (uv_stream_t*)&tcpctx->tcphandle))
     {
         LOG_err << "uv_accept failed";
@@ -32788,7 +34236,14 @@ void MegaTCPServer::onNewClient(uv_stream_t* server_handle, int status)
         return;
     }
 
-    tcpctx->server->connections.push_back(tcpctx);
+    size_t count;
+    {
+        std::lock_guard<std::mutex> g(tcpctx->server->connectionsMutex);
+        tcpctx->server->connections.push_back(tcpctx);
+        count = tcpctx->server->connections.size();
+    }
+    LOG_verbose << "Connections at port " << tcpctx->server->port << ": " << count;
+
     if (tcpctx->server->respondNewConnection(tcpctx))
     {
         // Start reading
@@ -32847,12 +34302,20 @@ void MegaTCPServer::onClose(uv_handle_t* handle)
 {
     MegaTCPContext* tcpctx = (MegaTCPContext*) handle->data;
 
+    // before its async handle goes
+    tcpctx->server->processOnClose(tcpctx);
+
     // streaming transfers are automatically stopped when their listener is removed
     tcpctx->megaApi->removeTransferListener(tcpctx);
     tcpctx->megaApi->removeRequestListener(tcpctx);
 
-    tcpctx->server->connections.remove(tcpctx);
-    LOG_debug << "Connection closed: " << tcpctx->server->connections.size() << " port = " << tcpctx->server->port << " closing async handle";
+    size_t count;
+    {
+        std::lock_guard<std::mutex> g(tcpctx->server->connectionsMutex);
+        tcpctx->server->connections.remove(tcpctx);
+        count = tcpctx->server->connections.size();
+    }
+    LOG_debug << "Connection closed: " << count << " port = " << tcpctx->server->port << " closing async handle";
     uv_close((uv_handle_t *)&tcpctx->asynchandle, onAsyncEventClose);
 }
 
@@ -32863,12 +34326,17 @@ void MegaTCPServer::onAsyncEventClose(uv_handle_t *handle)
 
     int port = tcpctx->server->port;
 
-    tcpctx->server->remainingcloseevents--;
+    // the connections of the workers end with their loops
+    bool counted = tcpctx->server->isMainLoop(handle->loop);
+    if (counted)
+    {
+        tcpctx->server->remainingcloseevents--;
+    }
     tcpctx->server->processOnAsyncEventClose(tcpctx);
 
     LOG_verbose << "At onAsyncEventClose port = " << tcpctx->server->port << " remaining=" << tcpctx->server->remainingcloseevents;
 
-    if (!tcpctx->server->remainingcloseevents && tcpctx->server->closing && !tcpctx->server->semaphoresdestroyed)
+    if (counted && !tcpctx->server->remainingcloseevents && tcpctx->server->closing && !tcpctx->server->semaphoresdestroyed)
     {
         uv_sem_post(&tcpctx->server->semaphoreStartup);
         uv_sem_post(&tcpctx->server->semaphoreEnd);
@@ -33019,9 +34487,17 @@ void MegaTCPServer::onCloseRequested(uv_async_t *handle)
     MegaTCPServer *tcpServer = (MegaTCPServer*) handle->data;
     LOG_debug << "TCP server stopping port=" << tcpServer->port;
 
+    // the connections left are those of this loop
+    tcpServer->stopWorkers();
     tcpServer->closing = true;
 
-    for (list<MegaTCPContext*>::iterator it = tcpServer->connections.begin(); it != tcpServer->connections.end(); it++)
+    list<MegaTCPContext*> connections;
+    {
+        std::lock_guard<std::mutex> g(tcpServer->connectionsMutex);
+        connections = tcpServer->connections;
+    }
+
+    for (list<MegaTCPContext*>::iterator it = connections.begin(); it != connections.end(); it++)
     {
         MegaTCPContext *tcpctx = (*it);
         closeTCPConnection(tcpctx);
@@ -33035,6 +34511,34 @@ void MegaTCPServer::onCloseRequested(uv_async_t *handle)
     uv_close((uv_handle_t *)&tcpServer->exit_handle, onExitHandleClose);
 }
 
+void MegaTCPServer::onWorkerCloseRequested(uv_async_t *handle)
+{
+    WorkerLoop *worker = (WorkerLoop*) handle->data;
+    MegaTCPServer *tcpServer = worker->tcpServer;
+
+    list<MegaTCPContext*> connections;
+    {
+        std::lock_guard<std::mutex> g(tcpServer->connectionsMutex);
+        for (MegaTCPContext *tcpctx : tcpServer->connections)
+        {
+            if (tcpctx->tcphandle.loop == handle->loop)
+            {
+                connections.push_back(tcpctx);
+            }
+        }
+    }
+    LOG_debug << "TCP server event loop stopping port=" << tcpServer->port << " connections: " << connections.size();
+
+    for (MegaTCPContext *tcpctx : connections)
+    {
+        closeTCPConnection(tcpctx);
+    }
+
+    // the loop ends once the connections are closed
+    uv_close((uv_handle_t *)&worker->server, NULL);
+    uv_close((uv_handle_t *)&worker->exit_handle, NULL);
+}
+
 void MegaTCPServer::closeConnection(MegaTCPContext *tcpctx)
 {
     LOG_verbose << "At closeConnection port = " << tcpctx->server->port;
@@ -33058,7 +34562,10 @@ void MegaTCPServer::closeTCPConnection(MegaTCPContext *tcpctx)
     tcpctx->finished = true;
     if (!uv_is_closing((uv_handle_t*)&tcpctx->tcphandle))
     {
-        tcpctx->server->remainingcloseevents++;
+        if (tcpctx->server->isMainLoop(tcpctx->tcphandle.loop))
+        {
+            tcpctx->server->remainingcloseevents++;
+        }
         LOG_verbose << "At closeTCPConnection port = " << tcpctx->server->port << " remainingcloseevent = " << tcpctx->server->remainingcloseevents;
         uv_close((uv_handle_t*)&tcpctx->tcphandle, onClose);
     }
@@ -33074,6 +34581,10 @@ void MegaTCPServer::processOnExitHandleClose(MegaTCPServer*) // without this clo
     LOG_debug << "At supposed to be virtual processOnExitHandleClose";
 }
 
+void MegaTCPServer::processOnClose(MegaTCPContext*)
+{
+}
+
 void MegaTCPServer::processReceivedData(MegaTCPContext*, ssize_t /*nread*/, const uv_buf_t*)
 {
     LOG_debug << "At supposed to be virtual processReceivedData";
@@ -33104,6 +34615,7 @@ MegaHTTPServer::MegaHTTPServer(MegaApiImpl *megaApi, string basePath, bool useTL
     this->folderServerEnabled = true;
     this->offlineAttribute = false;
     this->subtitlesSupportEnabled = false;
+    this->metricsEnabled = false;
 }
 
 MegaTCPContext * MegaHTTPServer::initializeContext(uv_stream_t *server_handle)
@@ -33143,6 +34655,18 @@ void MegaHTTPServer::processReceivedData(MegaTCPContext *tcpctx, ssize_t nread,
         {
             parsed = http_parser_execute(&httpctx->parser, &parsercfg, buf->base, nread);
         }
+
+        if (HTTP_PARSER_ERRNO(&httpctx->parser) == HPE_PAUSED)
+        {
+            // pipelined: an earlier request is being answered, this one waits its turn
+            httpctx->pipelined.append(buf->base + parsed, static_cast<size_t>(nread - parsed));
+            parsed = nread;
+            if (httpctx->pipelined.size() > MAX_PIPELINED_SIZE)
+            {
+                LOG_warn << "Too many pipelined requests: " << httpctx->pipelined.size() << " bytes";
+                parsed = -1;
+            }
+        }
     }
 
     LOG_verbose << " at onDataReceived, received " << nread << " parsed = " << parsed;
@@ -33180,35 +34704,130 @@ void MegaHTTPServer::processWriteFinished(MegaTCPContext* tcpctx, int status)
             {
                 httpctx->resultCode = API_OK;
             }
+
+            if (httpctx->keepAlive)
+            {
+                processNextRequest(httpctx);
+                return;
+            }
         }
 
         closeConnection(httpctx);
         return;
     }
 
+    size_t written = httpctx->lastBufferLen;
     uv_mutex_lock(&httpctx->mutex);
-    if (httpctx->lastBufferLen)
+    releaseWrittenData(httpctx);
+    uv_mutex_unlock(&httpctx->mutex);
+
+    if (httpctx->feed)
+    {
+        httpctx->feed->drained(httpctx, written);
+    }
+
+    uv_async_send(&httpctx->asynchandle);
+}
+
+void MegaHTTPServer::releaseWrittenData(MegaHTTPContext *httpctx)
+{
+    if (httpctx->writingSlices.size())
+    {
+        // other connections may still write from the same chunks
+        httpctx->writingSlices.clear();
+    }
+    else if (httpctx->lastBufferLen)
     {
         httpctx->streamingBuffer.freeData(httpctx->lastBufferLen);
     }
+    httpctx->lastBufferLen = 0;
+}
 
-    if (httpctx->pause)
+void MegaHTTPServer::followFeed(MegaHTTPContext *httpctx, m_off_t start, m_off_t len)
+{
+    std::shared_ptr<StreamingFeed> feed;
+    std::lock_guard<std::mutex> g(feedsMutex);
+    for (auto it = feeds.begin(); it != feeds.end(); )
     {
-        if (httpctx->streamingBuffer.availableSpace() >= DirectReadSlot::MAX_DELIVERY_CHUNK)
+        std::shared_ptr<StreamingFeed> f = it->lock();
+        if (!f)
         {
-            httpctx->pause = false;
-            m_off_t start = httpctx->rangeStart + httpctx->rangeWritten + httpctx->streamingBuffer.availableData();
-            m_off_t len =  httpctx->rangeEnd - httpctx->rangeStart - httpctx->rangeWritten - httpctx->streamingBuffer.availableData();
+            it = feeds.erase(it);
+            continue;
+        }
 
-            LOG_debug << "[Streaming] Resuming streaming from " << start << " len: " << len
-                      << " " << httpctx->streamingBuffer.bufferStatus();
-            httpctx->megaApi->startStreaming(httpctx->node, start, len, httpctx);
+        if (!feed && f->isFeeding(httpctx->node) && f->canServe(start))
+        {
+            feed = std::move(f);
         }
+        it++;
     }
-    httpctx->lastBufferLen = 0;
+
+    if (feed)
+    {
+        LOG_debug << "[Streaming] Following the read of another connection. From " << start << " size " << len;
+    }
+    else
+    {
+        feed = std::make_shared<StreamingFeed>(megaApi, httpctx->node, start);
+        feeds.push_back(feed);
+    }
+
+    httpctx->feed = feed;
+    feed->follow(httpctx, start, start + len);
+}
+
+void MegaHTTPServer::unfollowFeed(MegaHTTPContext *httpctx)
+{
+    if (httpctx->feed)
+    {
+        httpctx->feed->unfollow(httpctx);
+
+        // the read stops with its last follower
+        httpctx->feed.reset();
+    }
+}
+
+void MegaHTTPServer::processNextRequest(MegaHTTPContext *httpctx)
+{
+    LOG_debug << "Keeping the connection open for the next request";
+    if (httpctx->transfer)
+    {
+        httpctx->megaApi->fireOnStreamingFinish(httpctx->transfer.release(), std::make_unique<MegaErrorPrivate>(httpctx->resultCode)); // transfer will be deleted in fireOnStreamingFinish
+    }
+
+    unfollowFeed(httpctx);
+    uv_mutex_lock(&httpctx->mutex);
+    httpctx->resetRequest();
     uv_mutex_unlock(&httpctx->mutex);
 
-    uv_async_send(&httpctx->asynchandle);
+    http_parser_pause(&httpctx->parser, 0);
+    if (!parsePipelined(httpctx))
+    {
+        LOG_debug << "Finishing request. Unsupported pipelined data";
+        closeConnection(httpctx);
+    }
+}
+
+bool MegaHTTPServer::parsePipelined(MegaHTTPContext *httpctx)
+{
+    if (httpctx->pipelined.empty())
+    {
+        return true;
+    }
+
+    LOG_debug << "Parsing pipelined data: " << httpctx->pipelined.size() << " bytes";
+    string data = std::move(httpctx->pipelined);
+    httpctx->pipelined.clear();
+
+    size_t parsed = http_parser_execute(&httpctx->parser, &parsercfg, data.data(), data.size());
+    if (HTTP_PARSER_ERRNO(&httpctx->parser) == HPE_PAUSED)
+    {
+        // the next one is being answered already
+        httpctx->pipelined.assign(data, parsed, string::npos);
+        return true;
+    }
+    return parsed == data.size() && !httpctx->parser.upgrade;
 }
 
 void MegaHTTPServer::processOnAsyncEventClose(MegaTCPContext* tcpctx)
@@ -33237,6 +34856,12 @@ bool MegaHTTPServer::respondNewConnection(MegaTCPContext*)
 
 void MegaHTTPServer::processOnExitHandleClose(MegaTCPServer*) {}
 
+void MegaHTTPServer::processOnClose(MegaTCPContext* tcpctx)
+{
+    // no more data for it from the read it follows
+    unfollowFeed(dynamic_cast<MegaHTTPContext *>(tcpctx));
+}
+
 MegaHTTPServer::~MegaHTTPServer()
 {
     // if not stopped, the uv thread might want to access a pointer to this.
@@ -33295,6 +34920,16 @@ bool MegaHTTPServer::isOfflineAttributeEnabled()
     return offlineAttribute;
 }
 
+void MegaHTTPServer::enableMetrics(bool enable)
+{
+    this->metricsEnabled = enable;
+}
+
+bool MegaHTTPServer::isMetricsEnabled()
+{
+    return metricsEnabled;
+}
+
 bool MegaHTTPServer::isSubtitlesSupportEnabled()
 {
     return subtitlesSupportEnabled;
@@ -33974,6 +35609,9 @@ int MegaHTTPServer::onMessageComplete(http_parser *parser)
     MegaNode *node = NULL;
     std::ostringstream response;
     MegaHTTPContext* httpctx = (MegaHTTPContext*) parser->data;
+
+    // one request at a time: any pipelined after this one waits until it's answered
+    http_parser_pause(parser, 1);
     httpctx->bytesWritten = 0;
     httpctx->size = 0;
     httpctx->streamingBuffer.setMaxBufferSize(httpctx->server->getMaxBufferSize());
@@ -34010,6 +35648,27 @@ int MegaHTTPServer::onMessageComplete(http_parser *parser)
         return 0;
     }
 
+    if (httpctx->path == "/metrics" && httpserver->isMetricsEnabled()
+            && (parser->method == HTTP_GET || parser->method == HTTP_HEAD))
+    {
+        string metrics = MetricsRegistry::instance().exportText();
+        response << "HTTP/1.1 200 OK\r\n"
+                 << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                 << "Connection: close\r\n"
+                 << "Content-Length: " << metrics.size() << "\r\n"
+                 << "\r\n";
+
+        if (parser->method != HTTP_HEAD)
+        {
+            response << metrics;
+        }
+
+        httpctx->resultCode = API_OK;
+        string resstr = response.str();
+        sendHeaders(httpctx, &resstr);
+        return 0;
+    }
+
     if (httpctx->path == "/favicon.ico")
     {
         LOG_debug << "Favicon requested";
@@ -34843,15 +36502,17 @@ int MegaHTTPServer::streamNode(MegaHTTPContext *httpctx)
         response << "HTTP/1.1 200 OK\r\n";
     }
 
+    // players seeking around send one range request after another
+    httpctx->keepAlive = !httpctx->server->useTLS && len > 0 && http_should_keep_alive(&httpctx->parser);
+
     response << "Content-Type: " << mimeType << "\r\n"
-        << "Connection: close\r\n"
+        << (httpctx->keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n")
         << "Content-Length: " << len << "\r\n"
         << "Access-Control-Allow-Origin: *\r\n"
         << "Accept-Ranges: bytes\r\n"
         << "\r\n";
 
     delete [] mimeType;
-    httpctx->pause = false;
     httpctx->lastBuffer = NULL;
     httpctx->lastBufferLen = 0;
     if (httpctx->transfer)
@@ -34866,7 +36527,8 @@ int MegaHTTPServer::streamNode(MegaHTTPContext *httpctx)
     string resstr = response.str();
     if (httpctx->parser.method != HTTP_HEAD)
     {
-        httpctx->streamingBuffer.init(std::max(static_cast<size_t>(len), resstr.size()));
+        // only for the headers: the node data is written from the chunks read
+        httpctx->streamingBuffer.init(resstr.size());
         httpctx->server->setMaxBufferSize(httpctx->streamingBuffer.getMaxBufferSize());
         httpctx->server->setMaxOutputSize(httpctx->streamingBuffer.getMaxOutputSize());
         httpctx->size = len;
@@ -34880,14 +36542,13 @@ int MegaHTTPServer::streamNode(MegaHTTPContext *httpctx)
 
     LOG_debug << "Requesting range. From " << start << "  size " << len;
     httpctx->rangeWritten = 0;
+    MegaHTTPServer *httpserver = ((MegaHTTPServer *)httpctx->server);
     if (start || len)
     {
-        httpctx->streamingBuffer.reset(!httpctx->lastBufferLen, resstr.size());
-        httpctx->megaApi->startStreaming(node, start, len, httpctx);
+        httpserver->followFeed(httpctx, start, len);
     }
     else
     {
-        MegaHTTPServer *httpserver = ((MegaHTTPServer *)httpctx->server);
         LOG_debug << "Skipping startStreaming call since empty file";
         httpserver->processWriteFinished(httpctx, 0);
     }
@@ -35003,38 +36664,67 @@ void MegaHTTPServer::sendNextBytes(MegaHTTPContext *httpctx)
     }
 
     uv_mutex_lock(&httpctx->mutex);
-    if (httpctx->lastBufferLen)
-    {
-        httpctx->streamingBuffer.freeData(httpctx->lastBufferLen);
-        httpctx->lastBufferLen = 0;
-    }
+    releaseWrittenData(httpctx);
 
-    if (httpctx->tcphandle.write_queue_size > httpctx->streamingBuffer.availableCapacity() / 8)
+    if (httpctx->tcphandle.write_queue_size > httpctx->streamingBuffer.getMaxBufferSize() / 8)
     {
-        LOG_warn << "[Streaming] Skipping write. Too much queued data. " << httpctx->streamingBuffer.bufferStatus();
+        LOG_warn << "[Streaming] Skipping write. Too much queued data. Queued: " << httpctx->queuedBytes;
         uv_mutex_unlock(&httpctx->mutex);
         return;
     }
 
-    uv_buf_t resbuf = httpctx->streamingBuffer.nextBuffer();
+    // headers and other responses first, then node data, written straight from the chunks read
+    uv_buf_t resbufs[MAX_WRITE_BUFFERS];
+    unsigned numbufs = 0;
+    size_t len = 0;
+    if (httpctx->streamingBuffer.availableData())
+    {
+        resbufs[numbufs++] = httpctx->streamingBuffer.nextBuffer();
+        len = resbufs[0].len;
+    }
+    else
+    {
+        // a TLS write is encrypted from a single buffer
+        unsigned maxbufs = httpctx->server->useTLS ? 1 : MAX_WRITE_BUFFERS;
+        size_t maxlen = httpctx->streamingBuffer.getMaxOutputSize();
+        while (httpctx->slices.size() && numbufs < maxbufs && len < maxlen)
+        {
+            StreamingSlice& slice = httpctx->slices.front();
+            size_t piece = std::min(slice.len, maxlen - len);
+            resbufs[numbufs++] = uv_buf_init(const_cast<char*>(slice.chunk->data()) + slice.offset, static_cast<unsigned>(piece));
+            httpctx->writingSlices.push_back(StreamingSlice{slice.chunk, slice.offset, piece});
+            len += piece;
+
+            if (piece == slice.len)
+            {
+                httpctx->slices.pop_front();
+            }
+            else
+            {
+                slice.offset += piece;
+                slice.len -= piece;
+            }
+        }
+        httpctx->queuedBytes -= len;
+        httpctx->rangeWritten += static_cast<m_off_t>(len);
+    }
     uv_mutex_unlock(&httpctx->mutex);
 
-    if (!resbuf.len)
+    if (!len)
     {
         LOG_debug << "[Streaming] Skipping write. No data available. " << httpctx->streamingBuffer.bufferStatus();
         return;
     }
 
-    LOG_verbose << "Writing " << resbuf.len << " bytes";
-    httpctx->rangeWritten += resbuf.len;
-    httpctx->lastBuffer = resbuf.base;
-    httpctx->lastBufferLen = resbuf.len;
+    LOG_verbose << "Writing " << len << " bytes";
+    httpctx->lastBuffer = resbufs[0].base;
+    httpctx->lastBufferLen = len;
 
 #ifdef ENABLE_EVT_TLS
     if (httpctx->server->useTLS)
     {
         //notice this, contrary to !useTLS is synchronous
-        int err = evt_tls_write(httpctx->evt_tls, resbuf.base, resbuf.len, onWriteFinished_tls);
+        int err = evt_tls_write(httpctx->evt_tls, resbufs[0].base, resbufs[0].len, onWriteFinished_tls);
         if (err <= 0)
         {
             LOG_warn << "[Streaming] Finishing due to an error sending the response: " << err;
@@ -35047,7 +36737,7 @@ void MegaHTTPServer::sendNextBytes(MegaHTTPContext *httpctx)
         uv_write_t *req = new uv_write_t();
         req->data = httpctx;
 
-        if (int err = uv_write(req, (uv_stream_t*)&httpctx->tcphandle, &resbuf, 1, onWriteFinished))
+        if (int err = uv_write(req, (uv_stream_t*)&httpctx->tcphandle, resbufs, numbufs, onWriteFinished))
         {
             delete req;
             LOG_warn << "[Streaming] Finishing due to an error in uv_write: " << err;
@@ -35069,8 +36759,9 @@ MegaHTTPContext::MegaHTTPContext()
     rangeWritten = -1;
     range = false;
     failed = false;
-    pause = false;
     nodereceived = false;
+    queuedBytes = 0;
+    keepAlive = false;
     resultCode = API_EINTERNAL;
     node = NULL;
     nodesize = -1;
@@ -35108,34 +36799,46 @@ void MegaHTTPContext::onTransferStart(MegaApi *, MegaTransfer *transfer)
     }
 }
 
-bool MegaHTTPContext::onTransferData(MegaApi *, MegaTransfer *transfer, char *buffer, size_t size)
+void MegaHTTPContext::resetRequest()
 {
-    LOG_verbose << "Streaming data received: " << transfer->getTransferredBytes()
-                << " Size: " << size
-                << " Queued: " << this->tcphandle.write_queue_size
-                << " " << streamingBuffer.bufferStatus();
-
-    if (finished)
-    {
-        LOG_info << "Removing streaming transfer after " << transfer->getTransferredBytes() << " bytes";
-        return false;
-    }
+    bytesWritten = 0;
+    size = -1;
+    lastBuffer = NULL;
+    lastBufferLen = 0;
+    streamingBuffer.release();
+    slices.clear();
+    queuedBytes = 0;
+    writingSlices.clear();
+    keepAlive = false;
 
-    // append the data to the buffer
-    uv_mutex_lock(&mutex);
-    long long remaining = size + (transfer->getTotalBytes() - transfer->getTransferredBytes());
-    long long availableSpace = streamingBuffer.availableSpace();
-    if ((remaining > availableSpace) && ((availableSpace - size) < static_cast<long long>(DirectReadSlot::MAX_DELIVERY_CHUNK)))
-    {
-        LOG_debug << "[Streaming] Buffer full: Pausing streaming. " << streamingBuffer.bufferStatus();
-        pause = true;
-    }
-    streamingBuffer.append(buffer, size);
-    uv_mutex_unlock(&mutex);
+    range = false;
+    rangeStart = -1;
+    rangeEnd = -1;
+    rangeWritten = -1;
+    delete node;
+    node = NULL;
+    path.clear();
+    nodehandle.clear();
+    nodekey.clear();
+    nodename.clear();
+    nodesize = -1;
+    nodepubauth.clear();
+    nodeprivauth.clear();
+    nodechatauth.clear();
+    resultCode = API_EINTERNAL;
 
-    // notify the HTTP server
-    uv_async_send(&asynchandle);
-    return !pause;
+    depth = -1;
+    lastheader.clear();
+    subpathrelative.clear();
+    delete [] messageBody;
+    messageBody = NULL;
+    messageBodySize = 0;
+    host.clear();
+    destination.clear();
+    overwrite = true;
+    newname.clear();
+    nodeToMove = UNDEF;
+    newParentNode = UNDEF;
 }
 
 void MegaHTTPContext::onTransferFinish(MegaApi *, MegaTransfer *, MegaError *e)
@@ -37440,7 +39143,11 @@ void MegaFTPDataServer::processAsyncEvent(MegaTCPContext *tcpctx)
 
             LOG_debug << "Requesting range. From " << start << "  size " << len;
             ftpdatactx->rangeWritten = 0;
-            if (start || len)
+            if (len && sendCachedContent(ftpdatactx, start))
+            {
+                LOG_debug << "Sending " << len << " bytes from the FUSE cache";
+            }
+            else if (start || len)
             {
                 ftpdatactx->megaApi->startStreaming(nodeToDownload, start, len, ftpdatactx);
             }
@@ -37512,6 +39219,185 @@ bool MegaFTPDataServer::respondNewConnection(MegaTCPContext* tcpctx)
 
 void MegaFTPDataServer::processOnExitHandleClose(MegaTCPServer*) {}
 
+void MegaFTPDataServer::processOnClose(MegaTCPContext* tcpctx)
+{
+#ifndef _WIN32
+    MegaFTPDataContext* ftpdatactx = dynamic_cast<MegaFTPDataContext *>(tcpctx);
+    if (ftpdatactx->cachedSocketPoll)
+    {
+        // no longer watched once stopped, so its descriptor can go right away
+        uv_poll_stop(ftpdatactx->cachedSocketPoll);
+        uv_close((uv_handle_t *)ftpdatactx->cachedSocketPoll, [](uv_handle_t* handle)
+        {
+            delete (uv_poll_t *)handle;
+        });
+        ftpdatactx->cachedSocketPoll = NULL;
+    }
+    if (ftpdatactx->cachedSocket >= 0)
+    {
+        close(ftpdatactx->cachedSocket);
+        ftpdatactx->cachedSocket = -1;
+    }
+    if (ftpdatactx->cachedFile >= 0)
+    {
+        uv_fs_t req;
+        uv_fs_close(tcpctx->tcphandle.loop, &req, ftpdatactx->cachedFile, NULL);
+        uv_fs_req_cleanup(&req);
+        ftpdatactx->cachedFile = -1;
+    }
+#else
+    (void)tcpctx;
+#endif
+}
+
+#ifndef _WIN32
+bool MegaFTPDataServer::sendCachedContent(MegaFTPDataContext *ftpdatactx, m_off_t start)
+{
+    // the data is encrypted on its way out
+    if (useTLS)
+    {
+        return false;
+    }
+
+    LocalPath path;
+    if (!megaApi->cachedContentPath(ftpdatactx->node, path))
+    {
+        return false;
+    }
+
+    uv_loop_t* loop = ftpdatactx->tcphandle.loop;
+    uv_fs_t req;
+    uv_file file = uv_fs_open(loop, &req, path.platformEncoded().c_str(), O_RDONLY, 0, NULL);
+    uv_fs_req_cleanup(&req);
+    if (file < 0)
+    {
+        LOG_warn << "Unable to open cached content: " << uv_err_name(file);
+        return false;
+    }
+
+    // libuv polls the socket for reading already: a copy of it is polled for writing
+    uv_os_fd_t fd;
+    int socket = -1;
+    if (uv_fileno((uv_handle_t *)&ftpdatactx->tcphandle, &fd) || (socket = dup(fd)) < 0)
+    {
+        LOG_warn << "Unable to send cached content on the data socket";
+        uv_fs_close(loop, &req, file, NULL);
+        uv_fs_req_cleanup(&req);
+        return false;
+    }
+
+    uv_poll_t* poll = new uv_poll_t();
+    if (uv_poll_init(loop, poll, socket))
+    {
+        LOG_warn << "Unable to poll the data socket";
+        delete poll;
+        close(socket);
+        uv_fs_close(loop, &req, file, NULL);
+        uv_fs_req_cleanup(&req);
+        return false;
+    }
+    poll->data = ftpdatactx;
+
+    ftpdatactx->cachedFile = file;
+    ftpdatactx->cachedSocket = socket;
+    ftpdatactx->cachedSocketPoll = poll;
+    ftpdatactx->cachedOffset = start;
+
+    sendCachedBytes(ftpdatactx);
+    return true;
+}
+
+void MegaFTPDataServer::sendCachedBytes(MegaFTPDataContext *ftpdatactx)
+{
+    if (ftpdatactx->finished)
+    {
+        uv_poll_stop(ftpdatactx->cachedSocketPoll);
+        return;
+    }
+
+    uv_loop_t* loop = ftpdatactx->tcphandle.loop;
+    size_t sentNow = 0;
+    while (ftpdatactx->bytesWritten < ftpdatactx->size)
+    {
+        if (sentNow >= MAX_CACHED_SEND)
+        {
+            // the rest when the loop comes back to it
+            uv_poll_start(ftpdatactx->cachedSocketPoll, UV_WRITABLE, onCachedSocketWritable);
+            return;
+        }
+
+        size_t len = static_cast<size_t>(std::min<m_off_t>(ftpdatactx->size - ftpdatactx->bytesWritten,
+                                                           static_cast<m_off_t>(MAX_CACHED_SEND)));
+        uv_fs_t req;
+        int sent = uv_fs_sendfile(loop, &req, ftpdatactx->cachedSocket, ftpdatactx->cachedFile,
+                                  ftpdatactx->cachedOffset, len, NULL);
+        uv_fs_req_cleanup(&req);
+
+        if (sent == UV_EAGAIN)
+        {
+            uv_poll_start(ftpdatactx->cachedSocketPoll, UV_WRITABLE, onCachedSocketWritable);
+            return;
+        }
+
+        if (sent <= 0)
+        {
+            // a file cut short is as bad as a failed write
+            LOG_warn << "[Streaming] Finishing due to an error sending cached content: " << (sent ? uv_err_name(sent) : "EOF");
+            uv_poll_stop(ftpdatactx->cachedSocketPoll);
+            ftpdatactx->ecode = API_EREAD;
+            closeConnection(ftpdatactx);
+            return;
+        }
+
+        ftpdatactx->cachedOffset += sent;
+        ftpdatactx->bytesWritten += sent;
+        ftpdatactx->rangeWritten += sent;
+        sentNow += static_cast<size_t>(sent);
+    }
+
+    uv_poll_stop(ftpdatactx->cachedSocketPoll);
+    finishCachedContent(ftpdatactx);
+}
+
+void MegaFTPDataServer::finishCachedContent(MegaFTPDataContext *ftpdatactx)
+{
+    LOG_debug << "Finishing request. All cached data sent";
+
+    if (ftpdatactx->transfer)
+    {
+        ftpdatactx->transfer->setTransferredBytes(ftpdatactx->bytesWritten);
+        ftpdatactx->megaApi->fireOnFtpStreamingFinish(ftpdatactx->transfer, std::make_unique<MegaErrorPrivate>(API_OK));
+        ftpdatactx->transfer = NULL; // this has been deleted in fireOnStreamingFinish
+    }
+
+    if (this->controlftpctx)
+    {
+        ftpdatactx->setControlCodeUponDataClose(226);
+    }
+    else
+    {
+        LOG_verbose << "Avoiding waking controlftp aync handle, ftpctx already closed";
+    }
+    closeConnection(ftpdatactx);
+}
+
+void MegaFTPDataServer::onCachedSocketWritable(uv_poll_t* handle, int status, int)
+{
+    MegaFTPDataContext* ftpdatactx = static_cast<MegaFTPDataContext *>(handle->data);
+    MegaFTPDataServer* fds = static_cast<MegaFTPDataServer *>(ftpdatactx->server);
+
+    if (status < 0)
+    {
+        LOG_warn << "[Streaming] Finishing due to an error polling the data socket: " << uv_err_name(status);
+        uv_poll_stop(handle);
+        closeConnection(ftpdatactx);
+        return;
+    }
+
+    fds->sendCachedBytes(ftpdatactx);
+}
+#endif
+
 void MegaFTPDataServer::sendNextBytes(MegaFTPDataContext *ftpdatactx)
 {
     if (ftpdatactx->finished)
@@ -37520,6 +39406,14 @@ void MegaFTPDataServer::sendNextBytes(MegaFTPDataContext *ftpdatactx)
         return;
     }
 
+#ifndef _WIN32
+    if (ftpdatactx->sendingCachedContent())
+    {
+        // written as the socket has room for it
+        return;
+    }
+#endif
+
     if (ftpdatactx->lastBuffer)
     {
         LOG_verbose << "[Streaming] Skipping write due to another ongoing write";
@@ -37596,6 +39490,12 @@ MegaFTPDataContext::MegaFTPDataContext()
     rangeStart = 0;
     tmpFileAccess = NULL;
     tmpFileSize = 0;
+#ifndef _WIN32
+    cachedFile = -1;
+    cachedSocket = -1;
+    cachedSocketPoll = NULL;
+    cachedOffset = 0;
+#endif
     this->controlRespondedElsewhere = false;
     this->controlResponseCode = 426;
 }
@@ -39848,6 +41748,11 @@ MegaStringMap* MegaNotificationPrivate::getRenderModeFields(const char* mode) co
     return nullptr;
 }
 
+size_t MegaFuseExecutorFlagsPrivate::getDispatchThreadCount() const
+{
+    return mFlags.mDispatchThreads;
+}
+
 size_t MegaFuseExecutorFlagsPrivate::getMinThreadCount() const
 {
     return mFlags.mMinWorkers;
@@ -39863,6 +41768,16 @@ size_t MegaFuseExecutorFlagsPrivate::getMaxThreadIdleTime() const
     return static_cast<size_t>(mFlags.mIdleTime.count());
 }
 
+bool MegaFuseExecutorFlagsPrivate::setDispatchThreadCount(size_t count)
+{
+    if (!count)
+        return false;
+
+    mFlags.mDispatchThreads = count;
+
+    return true;
+}
+
 bool MegaFuseExecutorFlagsPrivate::setMaxThreadCount(size_t max)
 {
     if (!max)
@@ -39883,9 +41798,49 @@ void MegaFuseExecutorFlagsPrivate::setMaxThreadIdleTime(size_t max)
     mFlags.mIdleTime = std::chrono::seconds(max);
 }
 
-MegaFuseInodeCacheFlagsPrivate::MegaFuseInodeCacheFlagsPrivate(fuse::InodeCacheFlags& flags)
+MegaFuseFileCacheFlagsPrivate::MegaFuseFileCacheFlagsPrivate(fuse::FileCacheFlags& flags,
+                                                             const fuse::FileCacheStatistics& statistics)
+  : MegaFuseFileCacheFlags()
+  , mFlags(flags)
+  , mStatistics(statistics)
+{
+}
+
+size_t MegaFuseFileCacheFlagsPrivate::getCleanInterval() const
+{
+    return static_cast<size_t>(mFlags.mCleanInterval.count());
+}
+
+uint64_t MegaFuseFileCacheFlagsPrivate::getHits() const
+{
+    return mStatistics.mHits;
+}
+
+uint64_t MegaFuseFileCacheFlagsPrivate::getMaxSize() const
+{
+    return mFlags.mMaxSize;
+}
+
+uint64_t MegaFuseFileCacheFlagsPrivate::getMisses() const
+{
+    return mStatistics.mMisses;
+}
+
+void MegaFuseFileCacheFlagsPrivate::setCleanInterval(size_t seconds)
+{
+    mFlags.mCleanInterval = std::chrono::seconds(seconds);
+}
+
+void MegaFuseFileCacheFlagsPrivate::setMaxSize(uint64_t size)
+{
+    mFlags.mMaxSize = size;
+}
+
+MegaFuseInodeCacheFlagsPrivate::MegaFuseInodeCacheFlagsPrivate(fuse::InodeCacheFlags& flags,
+                                                               const fuse::InodeCacheStatistics& statistics)
   : MegaFuseInodeCacheFlags()
   , mFlags(flags)
+  , mStatistics(statistics)
 {
 }
 
@@ -39904,11 +41859,36 @@ size_t MegaFuseInodeCacheFlagsPrivate::getCleanSizeThreshold() const
     return mFlags.mCleanSizeThreshold;
 }
 
+uint64_t MegaFuseInodeCacheFlagsPrivate::getEvictions() const
+{
+    return mStatistics.mEvictions;
+}
+
+uint64_t MegaFuseInodeCacheFlagsPrivate::getHits() const
+{
+    return mStatistics.mHits;
+}
+
+size_t MegaFuseInodeCacheFlagsPrivate::getMaxMemory() const
+{
+    return mFlags.mMaxMemory;
+}
+
 size_t MegaFuseInodeCacheFlagsPrivate::getMaxSize() const
 {
     return mFlags.mMaxSize;
 }
 
+size_t MegaFuseInodeCacheFlagsPrivate::getMemory() const
+{
+    return mStatistics.mMemory;
+}
+
+uint64_t MegaFuseInodeCacheFlagsPrivate::getMisses() const
+{
+    return mStatistics.mMisses;
+}
+
 void MegaFuseInodeCacheFlagsPrivate::setCleanAgeThreshold(std::size_t seconds)
 {
     mFlags.mCleanAgeThreshold = std::chrono::seconds(seconds);
@@ -39924,23 +41904,43 @@ void MegaFuseInodeCacheFlagsPrivate::setCleanSizeThreshold(std::size_t size)
     mFlags.mCleanSizeThreshold = size;
 }
 
+void MegaFuseInodeCacheFlagsPrivate::setMaxMemory(size_t size)
+{
+    mFlags.mMaxMemory = size;
+}
+
 void MegaFuseInodeCacheFlagsPrivate::setMaxSize(std::size_t size)
 {
     mFlags.mMaxSize = size;
 }
 
-MegaFuseFlagsPrivate::MegaFuseFlagsPrivate(const fuse::ServiceFlags& flags)
+MegaFuseFlagsPrivate::MegaFuseFlagsPrivate(const fuse::ServiceFlags& flags,
+                                           const fuse::FileCacheStatistics& fileCacheStatistics,
+                                           const fuse::InodeCacheStatistics& inodeCacheStatistics,
+                                           const fuse::OperationStatistics& operationStatistics)
   : MegaFuseFlags()
   , mFlags(flags)
-  , mInodeCacheFlags(mFlags.mInodeCacheFlags)
+  , mFileCacheStatistics(fileCacheStatistics)
+  , mFileCacheFlags(mFlags.mFileCacheFlags, mFileCacheStatistics)
+  , mInodeCacheStatistics(inodeCacheStatistics)
+  , mInodeCacheFlags(mFlags.mInodeCacheFlags, mInodeCacheStatistics)
   , mMountExecutorFlags(mFlags.mMountExecutorFlags)
   , mSubsystemExecutorFlags(mFlags.mServiceExecutorFlags)
+  , mOperationStatistics(operationStatistics)
 {
 }
 
 MegaFuseFlags* MegaFuseFlagsPrivate::copy() const
 {
-    return new MegaFuseFlagsPrivate(mFlags);
+    return new MegaFuseFlagsPrivate(mFlags,
+                                    mFileCacheStatistics,
+                                    mInodeCacheStatistics,
+                                    mOperationStatistics);
+}
+
+MegaFuseFileCacheFlags* MegaFuseFlagsPrivate::getFileCacheFlags()
+{
+    return &mFileCacheFlags;
 }
 
 const fuse::ServiceFlags& MegaFuseFlagsPrivate::getFlags() const
@@ -39968,6 +41968,28 @@ MegaFuseExecutorFlags* MegaFuseFlagsPrivate::getMountExecutorFlags()
     return &mMountExecutorFlags;
 }
 
+static_assert(MegaFuseFlags::OPERATION_WRITE + 1 == fuse::NumOperationTypes,
+              "MegaFuseFlags::Operation must mirror fuse::OperationType");
+
+uint64_t MegaFuseFlagsPrivate::getOperationCount(int operation) const
+{
+    if (operation < 0 || operation >= static_cast<int>(fuse::NumOperationTypes))
+        return 0;
+
+    return mOperationStatistics.mOperations[static_cast<size_t>(operation)].mCount;
+}
+
+uint64_t MegaFuseFlagsPrivate::getOperationLatency(int operation,
+                                                   unsigned int percentile) const
+{
+    if (operation < 0 || operation >= static_cast<int>(fuse::NumOperationTypes))
+        return 0;
+
+    auto& histogram = mOperationStatistics.mOperations[static_cast<size_t>(operation)];
+
+    return static_cast<uint64_t>(histogram.percentile(percentile).count());
+}
+
 MegaFuseExecutorFlags* MegaFuseFlagsPrivate::getSubsystemExecutorFlags()
 {
     return &mSubsystemExecutorFlags;
@@ -40083,6 +42105,11 @@ const char* MegaMountFlagsPrivate::getName() const
     return mFlags.mName.c_str();
 }
 
+bool MegaMountFlagsPrivate::getOffline() const
+{
+    return mFlags.mOffline;
+}
+
 bool MegaMountFlagsPrivate::getPersistent() const
 {
     return mFlags.mPersistent;
@@ -40106,6 +42133,11 @@ void MegaMountFlagsPrivate::setName(const char* name)
     mFlags.mName = name;
 }
 
+void MegaMountFlagsPrivate::setOffline(bool offline)
+{
+    mFlags.mOffline = offline;
+}
+
 void MegaMountFlagsPrivate::setPersistent(bool persistent)
 {
     mFlags.mEnableAtStartup &= persistent;
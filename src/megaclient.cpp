@@ -91,12 +91,20 @@ const unsigned MegaClient::MAX_RAIDTRANSFERS_FOR_MOBILE = std::max<unsigned>(MAX
 // i.e., there must be at least this number of raid transfers to let us predict whether the next download transfer will be raided or non-raided
 const unsigned MegaClient::MEANINGFUL_PORTION_OF_MAXTRANSFERS_QUEUE_FOR_RAID_PREDICTIVE_SYSTEM = std::max<unsigned>(MAXTRANSFERS / 6, 1);
 
+// minimum time between chunk progress writes of the same transfer to the persistent cache
+// (a crash loses at most this much progress, which is transferred again on resumption)
+const dstime MegaClient::TRANSFERCACHEPROGRESS_DS = 20;
+
 // maximum number of queued putfa before halting the upload queue
 const int MegaClient::MAXQUEUEDFA = 30;
 
 // maximum number of concurrent putfa
 const int MegaClient::MAXPUTFA = 10;
 
+// maximum number of uploads with file attributes still to attach after their putnodes
+// (the image decoding queue can't grow past this; further uploads wait for their imagery)
+const size_t MegaClient::MAXLATEFILEATTRIBUTEUPLOADS = 64;
+
 #ifdef ENABLE_SYNC
 // //bin/SyncDebris/yyyy-mm-dd base folder name
 const char* const MegaClient::SYNCDEBRISFOLDERNAME = "SyncDebris";
@@ -707,7 +715,7 @@ void MegaClient::mergenewshare(NewShare *s, bool notify, bool skipWriteInDb)
                 if (skreceived && notify)
                 {
                     TreeProcApplyKey td;
-                    proctree(n, &td);
+                    proctreeInBatches(n, &td);
                 }
             }
         }
@@ -1525,6 +1533,7 @@ void MegaClient::activateoverquota(dstime timeleft, bool isPaywall)
                 t->slot->retrying = true;
                 app->transfer_failed(t, API_EOVERQUOTA, timeleft);
                 ++performanceStats.transferTempErrors;
+                mMetrics.transferTemporaryErrors.add();
             }
         }
     }
@@ -1545,6 +1554,7 @@ void MegaClient::activateoverquota(dstime timeleft, bool isPaywall)
                     t->slot->retrying = true;
                     app->transfer_failed(t, isPaywall ? API_EPAYWALL : API_EOVERQUOTA, 0);
                     ++performanceStats.transferTempErrors;
+                    mMetrics.transferTemporaryErrors.add();
                 }
             }
         }
@@ -1738,6 +1748,7 @@ void MegaClient::init()
     pendingcs_serverBusySent = false;
 
     btcs.reset();
+    btcsSecondary.reset();
     btsc.reset();
     btpfa.reset();
     btbadhost.reset();
@@ -1753,6 +1764,8 @@ void MegaClient::init()
     scnotifyurl.clear();
     mPendingCatchUps = 0;
     mReceivingCatchUp = false;
+    mCatchUpActionPackets = 0;
+    mCatchUpReload = false;
     scsn.clear();
 
     // initialize random client application instance ID (for detecting own
@@ -1777,6 +1790,7 @@ void MegaClient::init()
 MegaClient::MegaClient(MegaApp* a, shared_ptr<Waiter> w, HttpIO* h, DbAccess* d, GfxProc* g, const char* k, const char* u, unsigned workerThreadCount, ClientType clientType)
    : mAsyncQueue(*w, workerThreadCount)
    , mCachedStatus(this)
+   , mContentHashIndex(this)
    , useralerts(*this)
    , btugexpiration(rng)
    , btcs(rng)
@@ -1784,6 +1798,7 @@ MegaClient::MegaClient(MegaApp* a, shared_ptr<Waiter> w, HttpIO* h, DbAccess* d,
    , btworkinglock(rng)
    , btreqstat(rng)
    , btsc(rng)
+   , btcsSecondary(rng)
    , btpfa(rng)
    , fsaccess(new FSACCESS_CLASS())
    , dbaccess(d)
@@ -1798,6 +1813,9 @@ MegaClient::MegaClient(MegaApp* a, shared_ptr<Waiter> w, HttpIO* h, DbAccess* d,
    , mFuseClientAdapter(*this)
    , mFuseService(mFuseClientAdapter)
 {
+    // the queue is built before mMetrics, so it gets the client's labels now
+    mAsyncQueue.exportQueueLatency(mMetrics.labels);
+
     mNodeManager.reset();
     sctable.reset();
     pendingsccommit = false;
@@ -2000,9 +2018,13 @@ std::string MegaClient::getWritableLinkAuthKey(handle nodeHandle)
 void MegaClient::exec()
 {
     CodeCounter::ScopeTimer ccst(performanceStats.execFunction);
+    MEGA_TRACE_SCOPE("client", "exec");
+    EventLoopMonitor::Scope loopScope(mLoopMonitor, EventLoopMonitor::PHASE_EXEC);
 
     WAIT_CLASS::bumpds();
 
+    processPendingKeyDerivations();
+
     if (overquotauntil && overquotauntil < Waiter::ds)
     {
         overquotauntil = 0;
@@ -2072,6 +2094,11 @@ void MegaClient::exec()
             fetchtimezone();
         }
 
+        mPrewarmReqs.remove_if([](const unique_ptr<HttpReq>& req)
+        {
+            return req->status == REQ_SUCCESS || req->status == REQ_FAILURE;
+        });
+
         if (pendinghttp.size())
         {
             pendinghttp_map::iterator it = pendinghttp.begin();
@@ -2172,6 +2199,11 @@ void MegaClient::exec()
                             // remove from list
                             handle fah = MemAccess::get<handle>(fa->in.data());
 
+                            if (mFileAttributeCache && !fa->plaintext.empty())
+                            {
+                                mFileAttributeCache->put(fah, fa->plaintext);
+                            }
+
                             if (fa->th.isUndef())
                             {
                                 // client app requested the upload without a node yet, and it will use the fa handle
@@ -2214,6 +2246,10 @@ void MegaClient::exec()
                                             LOG_debug << "File attribute, type " << fa->type << " for upload handle " << fa->th << " received, but that type was no longer needed";
                                         }
                                     }
+                                    else if (lateFileAttributeResolved(fa->th.uploadHandle(), fa->type, fah))
+                                    {
+                                        LOG_debug << "File attribute, type " << fa->type << " for upload handle " << fa->th << " received after putnodes: " << toHandle(fah);
+                                    }
                                     else
                                     {
                                         LOG_debug << "File attribute, type " << fa->type << " for upload handle " << fa->th << " received, but the upload was previously resolved";
@@ -2235,7 +2271,7 @@ void MegaClient::exec()
                                     LOG_debug << "File attribute, type " << fa->type << " for upload handle " << fa->th << " failed. Discarding the need for it";
                                     uploadFAPtr->pendingfa.erase(fa->type);
                                 }
-                                else
+                                else if (!lateFileAttributeResolved(fa->th.uploadHandle(), fa->type, UNDEF))
                                 {
                                     LOG_debug << "File attribute, type " << fa->type << " for upload handle " << fa->th << " failed, but the upload was previously resolved";
                                 }
@@ -2275,7 +2311,7 @@ void MegaClient::exec()
                                     uploadFAPtr->transfer->removeAndDeleteSelf(TRANSFERSTATE_CANCELLED);
                                 }
                             }
-                            else
+                            else if (!fileAttributesAfterUpload.lookupExisting(fa->th.uploadHandle()))
                             {
                                 LOG_debug << "activefa for " << fa->th.uploadHandle() << " has been orphaned, discarding";
                                 activefa.erase(erasePos);
@@ -2296,6 +2332,15 @@ void MegaClient::exec()
             activatefa();
         }
 
+        while (!mCachedFileAttributes.empty())
+        {
+            CachedFileAttribute cached = std::move(mCachedFileAttributes.front());
+            mCachedFileAttributes.pop_front();
+
+            restag = cached.tag;
+            app->fa_complete(cached.nodehandle, cached.type, cached.data.data(), static_cast<uint32_t>(cached.data.size()));
+        }
+
         if (fafcs.size())
         {
             // file attribute fetching (handled in parallel on a per-cluster basis)
@@ -2401,6 +2446,8 @@ void MegaClient::exec()
             }
         }
 
+        execSecondaryCs();
+
         // handle API client-server requests
         for (;;)
         {
@@ -2413,6 +2460,10 @@ void MegaClient::exec()
                 if (pendingcs->status == REQ_SUCCESS || pendingcs->status == REQ_FAILURE)
                 {
                     performanceStats.csRequestWaitTime.stop();
+                    mMetrics.csRequestsInFlight.set(0);
+                    mMetrics.csRequestMilliseconds.record(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - pendingcs->postStartTime).count()));
+                    pendingcs->joinSegments();
                 }
 
                 switch (static_cast<reqstatus_t>(pendingcs->status))
@@ -2596,9 +2647,7 @@ void MegaClient::exec()
                             }
                             else
                             {
-                                mReqHashcashToken = std::move(pendingcs->mHashcashToken);
-                                pendingcs->mHashcashToken.clear(); // just to be sure
-                                mReqHashcashEasiness = pendingcs->mHashcashEasiness;
+                                solveHashcash(mReqHashcash, *pendingcs);
                             }
                         }
 
@@ -2671,7 +2720,7 @@ void MegaClient::exec()
                 }
             }
 
-            if (btcs.armed())
+            if (btcs.armed() && !solvingHashcash(mReqHashcash))
             {
                 if (reqs.readyToSend())
                 {
@@ -2685,37 +2734,25 @@ void MegaClient::exec()
                     string idempotenceId;
                     *pendingcs->out = reqs.serverrequest(pendingcs->includesFetchingNodes, v3, this, idempotenceId);
 
-                    pendingcs->posturl = httpio->APIURL;
-                    pendingcs->posturl.append("cs?id=");
-                    pendingcs->posturl.append(idempotenceId);
-                    pendingcs->posturl.append(getAuthURI());
-                    pendingcs->posturl.append(appkey);
-
-                    pendingcs->posturl.append(v3 ? "&v=3" : "&v=2");
+                    pendingcs->posturl = csUrl(idempotenceId, v3);
+                    pendingcs->type = REQ_JSON;
 
-                    if (lang.size())
-                    {
-                        pendingcs->posturl.append("&");
-                        pendingcs->posturl.append(lang);
-                    }
-                    if (trackJourneyId())
+                    if (pendingcs->includesFetchingNodes)
                     {
-                        pendingcs->posturl.append("&j=");
-                        pendingcs->posturl.append(mJourneyId.getValue());
+                        // VPN client shouldn't need chunked processing, because it'll receive a minimal response
+                        pendingcs->mChunked = !mNodeManager.hasCacheLoaded() && !isClientType(ClientType::VPN);
                     }
-                    pendingcs->type = REQ_JSON;
-
-                    if (pendingcs->includesFetchingNodes && !mNodeManager.hasCacheLoaded())
+                    else
                     {
-                        // Currently only fetchnodes requests can take advantage of chunked processing
-                        // However VPN client shouldn't need it, because it'll receive a minimal response
-                        pendingcs->mChunked = !isClientType(ClientType::VPN);
+                        // any other command alone in its batch can declare streaming filters
+                        pendingcs->mChunked = reqs.inflightStreaming();
                     }
+                    // responses without Content-Length (compressed) could be huge, too
+                    pendingcs->mSegmented = !pendingcs->mChunked;
 
-                    pendingcs->mHashcashToken = std::move(mReqHashcashToken);
-                    mReqHashcashToken.clear();
-                    pendingcs->mHashcashEasiness = mReqHashcashEasiness;
+                    attachHashcash(mReqHashcash, *pendingcs);
                     performanceStats.csRequestWaitTime.start();
+                    mMetrics.csRequestsInFlight.set(1);
                     pendingcs->post(this);
                     continue;
                 }
@@ -2819,24 +2856,7 @@ void MegaClient::exec()
                     else if (e == API_ETOOMANY)
                     {
                         LOG_warn << "Too many pending updates - reloading local state";
-
-                        // Stop the sc channel to prevent the reception of multiple
-                        // API_ETOOMANY errors causing multiple consecutive reloads
-                        scsn.stopScsn();
-
-                        app->reloading();
-                        int creqtag = reqtag;
-                        reqtag = fetchnodestag; // associate with ongoing request, if any
-                        fetchingnodes = false;
-                        fetchnodestag = 0;
-
-                        // reloading mid-session so we definitely go to the servers
-                        // the node tree will be replaced when the reply arrives
-                        // actionpacketsCurrent will be reset at that time
-                        // nocache = true so that we get to an equal or later SCSN
-                        // right away.  The ir:1 mechanism is not reliable for this
-                        fetchnodes(true, false, true);
-                        reqtag = creqtag;
+                        reloadFromServers();
                     }
                     else if (e == API_EAGAIN || e == API_ERATELIMIT)
                     {
@@ -2933,6 +2953,13 @@ void MegaClient::exec()
                 jsonsc.pos = nullptr;
                 pendingsc.reset();
                 btsc.reset();
+
+                if (mCatchUpReload)
+                {
+                    mCatchUpReload = false;
+                    LOG_warn << "Catching up the cached state would replay too many action packets - reloading local state";
+                    reloadFromServers();
+                }
             }
         }
 
@@ -3160,6 +3187,8 @@ void MegaClient::exec()
         if (!syncs.clientThreadActions.empty())
         {
             CodeCounter::ScopeTimer ccst(performanceStats.clientThreadActions);
+            EventLoopMonitor::Scope loopScope(mLoopMonitor, EventLoopMonitor::PHASE_SYNC_ACTIONS);
+            EventLoopMonitor::Task loopTask(mLoopMonitor, "sync", "client thread actions");
 
             dstime ctr_start = waiter->ds;
             size_t ctr_N = 0;
@@ -3262,7 +3291,14 @@ void MegaClient::exec()
 
         httpio->updatedownloadspeed();
         httpio->updateuploadspeed();
-    } while (httpio->doio() || execdirectreads() || (!pendingcs && reqs.readyToSend() && btcs.armed()));
+
+        if (!mQueuedUploadPutnodes.empty())
+        {
+            sendQueuedUploadPutnodes();
+        }
+    } while (httpio->doio() || execdirectreads() || (!pendingcs && reqs.readyToSend() && btcs.armed() && !solvingHashcash(mReqHashcash))
+             || (!pendingcsSecondary && reqs.secondaryChannel() && reqs.secondaryChannel()->readyToSend() && btcsSecondary.armed()
+                 && !solvingHashcash(mSecondaryHashcash)));
 
 
     if (!fetchingnodes)
@@ -3287,6 +3323,8 @@ void MegaClient::exec()
     {
         lasttime = Waiter::ds;
         LOG_info << performanceStats.report(false, httpio, waiter.get(), reqs);
+        LOG_info << mNodeManager.getDbReadPoolStats(false).report();
+        LOG_info << mNodeManager.getDbBlobStats(false).report();
 
         debugLogHeapUsage();
     }
@@ -3320,6 +3358,8 @@ int MegaClient::wait()
 int MegaClient::preparewait()
 {
     CodeCounter::ScopeTimer ccst(performanceStats.prepareWait);
+    MEGA_TRACE_SCOPE("client", "preparewait");
+    EventLoopMonitor::Scope loopScope(mLoopMonitor, EventLoopMonitor::PHASE_PREPARE_WAIT);
 
     dstime nds;
 
@@ -3367,12 +3407,18 @@ int MegaClient::preparewait()
             }
         }
 
-        // retry failed client-server requests
-        if (!pendingcs)
+        // retry failed client-server requests (once their challenge is solved, which wakes us up)
+        if (!pendingcs && !solvingHashcash(mReqHashcash))
         {
             btcs.update(&nds);
         }
 
+        if (!pendingcsSecondary && reqs.secondaryChannel() && reqs.secondaryChannel()->readyToSend()
+            && !solvingHashcash(mSecondaryHashcash))
+        {
+            btcsSecondary.update(&nds);
+        }
+
         // retry failed server-client requests
         if (!pendingsc && !pendingscUserAlerts && scsn.ready() && !mBlocked)
         {
@@ -3532,8 +3578,12 @@ int MegaClient::preparewait()
     }
 
     // nds is either MAX_INT (== no pending events) or > Waiter::ds
+    // The timers fire as Waiter::ds reaches nds, which happens at the start of that
+    // decisecond: waiting whole deciseconds from now would oversleep by up to one.
+    int64_t ndsms = Waiter::NEVERMS;
     if (EVER(nds))
     {
+        ndsms = static_cast<int64_t>(nds) * 100;
         nds -= Waiter::ds;
     }
 
@@ -3547,6 +3597,7 @@ int MegaClient::preparewait()
 #endif
 
     waiter->init(nds);
+    waiter->wakeupatms(ndsms);
 
     // set subsystem wakeup criteria (WinWaiter assumes httpio to be set first!)
     waiter->wakeupby(httpio, Waiter::NEEDEXEC);
@@ -3579,6 +3630,8 @@ int MegaClient::preparewait()
 int MegaClient::dowait()
 {
     CodeCounter::ScopeTimer ccst(performanceStats.doWait);
+    MEGA_TRACE_SCOPE("client", "dowait");
+    EventLoopMonitor::Scope loopScope(mLoopMonitor, EventLoopMonitor::PHASE_WAIT);
 
     return waiter->wait();
 }
@@ -3586,6 +3639,8 @@ int MegaClient::dowait()
 int MegaClient::checkevents()
 {
     CodeCounter::ScopeTimer ccst(performanceStats.checkEvents);
+    MEGA_TRACE_SCOPE("client", "checkevents");
+    EventLoopMonitor::Scope loopScope(mLoopMonitor, EventLoopMonitor::PHASE_CHECK_EVENTS);
 
     int r =  httpio->checkevents(waiter.get());
     r |= fsaccess->checkevents(waiter.get());
@@ -3596,6 +3651,45 @@ int MegaClient::checkevents()
     return r;
 }
 
+void MegaClient::setMemoryPressure(MemoryPressure level)
+{
+    LOG_info << "Memory pressure: " << static_cast<int>(mMemoryPressure) << " -> " << static_cast<int>(level);
+
+    bool lookaheadChanged = (level == MemoryPressure::NONE) != (mMemoryPressure == MemoryPressure::NONE);
+    mMemoryPressure = level;
+
+    if (level != MemoryPressure::NONE)
+    {
+        // the nodes unloaded are loaded again from the DB as they are needed
+        mNodeManager.releaseMemory(level == MemoryPressure::CRITICAL ? 0 : mNodeManager.getNumNodesAtCacheLRU() / 2);
+
+        for (DbTable* table : {sctable.get(), tctable.get(), statusTable.get()})
+        {
+            if (table)
+            {
+                table->releaseMemory();
+            }
+        }
+    }
+
+    if (lookaheadChanged)
+    {
+        for (TransferSlot* slot : tslots)
+        {
+            if (slot->transfer->type == GET)
+            {
+                slot->transferbuf.setRaidLookahead(raidLookaheadBytes());
+            }
+        }
+    }
+}
+
+m_off_t MegaClient::raidLookaheadBytes() const
+{
+    // any value below a chunk per part means one chunk
+    return mMemoryPressure == MemoryPressure::NONE ? mRaidLookaheadBytes : 1;
+}
+
 // reset all backoff timers and transfer retry counters
 bool MegaClient::abortbackoff(bool includexfers)
 {
@@ -3709,13 +3803,14 @@ void MegaClient::dispatchTransfers()
     }
 
     // do we have any transfer slots available?
-    if (!slotavail())
+    if (!slotavail(true))
     {
         LOG_verbose << "No slots available";
         return;
     }
 
     CodeCounter::ScopeTimer ccst(performanceStats.dispatchTransfers);
+    MEGA_TRACE_SCOPE("client", "dispatchTransfers");
 
     struct counter
     {
@@ -3822,6 +3917,12 @@ void MegaClient::dispatchTransfers()
         return 1;
     };
 
+    // a small upload is a single short POST, so several of them cost about what one other transfer does
+    auto smallUploadWeight = [this](const TransferCategory& tc, double transferWeight)
+    {
+        return mBatchSmallUploads && tc.direction == PUT && tc.sizetype == SMALLFILE ? transferWeight / 4 : transferWeight;
+    };
+
     // Determine average speed and total amount of data remaining for the given direction/size-category
     // We prepare data for put/get in index 0..1, and the put/get/big/small combinations in index 2..5
     for (TransferSlot* ts : tslots)
@@ -3848,7 +3949,7 @@ void MegaClient::dispatchTransfers()
                 }
             }
         }
-        auto transferWeight = transferWeightKnown != 0.0 ? transferWeightKnown : calcTransferWeight(tc.direction);
+        auto transferWeight = smallUploadWeight(tc, transferWeightKnown != 0.0 ? transferWeightKnown : calcTransferWeight(tc.direction));
         counters[tc.index()].addexisting(ts->transfer->size, ts->progressreported, transferWeight);
         counters[tc.directionIndex()].addexisting(ts->transfer->size, ts->progressreported, transferWeight);
     }
@@ -3879,7 +3980,7 @@ void MegaClient::dispatchTransfers()
             return true;
     };
 
-    std::function<bool(Transfer*)> testAddTransferFunction = [&counters, this, &calcTransferWeight](Transfer* t)
+    std::function<bool(Transfer*)> testAddTransferFunction = [&counters, this, &calcTransferWeight, &smallUploadWeight](Transfer* t)
         {
             TransferCategory tc(t);
 
@@ -3900,7 +4001,7 @@ void MegaClient::dispatchTransfers()
                 return false;
             }
 
-            auto transferWeight = calcTransferWeight(tc.direction);
+            auto transferWeight = smallUploadWeight(tc, calcTransferWeight(tc.direction));
             counters[tc.index()].addnew(t->size, transferWeight);
             counters[tc.directionIndex()].addnew(t->size, transferWeight);
 
@@ -3923,9 +4024,15 @@ void MegaClient::dispatchTransfers()
     {
         for (Transfer *nexttransfer : nextInCategory[category.index()])
         {
-            if (!slotavail())
+            if (!slotavail(category.direction == PUT && category.sizetype == SMALLFILE))
             {
-                return;
+                if (!slotavail(true))
+                {
+                    return;
+                }
+
+                // only small uploads may use the slots beyond MAXTOTALTRANSFERS
+                break;
             }
 
             if (category.direction == PUT && queuedfa.size() > MAXQUEUEDFA)
@@ -4119,6 +4226,30 @@ void MegaClient::dispatchTransfers()
 
                     ts->progressreported = nexttransfer->progresscompleted;
 
+                    if (nexttransfer->type == GET && !nexttransfer->progresscompleted)
+                    {
+                        bool claimed = true;
+
+                        switch (nexttransfer->mDiskAllocation)
+                        {
+                            case Transfer::DISK_ALLOCATION_PREALLOCATE:
+                                claimed = ts->fa->fpreallocate(nexttransfer->size);
+                                break;
+                            case Transfer::DISK_ALLOCATION_SPARSE:
+                                claimed = ts->fa->fsparse(nexttransfer->size);
+                                break;
+                            case Transfer::DISK_ALLOCATION_GROW:
+                                break;
+                        }
+
+                        if (!claimed)
+                        {
+                            // not fatal, the file just grows as it is written
+                            LOG_debug << "Unable to allocate " << nexttransfer->size
+                                      << " bytes up front for download: " << ts->fa->errorcode;
+                        }
+                    }
+
                     if (nexttransfer->type == PUT)
                     {
                         if (ts->fa->mtime != nexttransfer->mtime || ts->fa->size != nexttransfer->size)
@@ -4149,6 +4280,15 @@ void MegaClient::dispatchTransfers()
                                 // we want all imagery to be safely tucked away before completing the upload, so we bump minfa
                                 int bitmask = gfx->gendimensionsputfa(nexttransfer->localfilename, NodeOrUploadHandle(nexttransfer->uploadhandle), nexttransfer->transfercipher(), -1);
 
+                                if (mAttachFileAttributesLater && bitmask
+                                    && fileAttributesAfterUpload.size() < MAXLATEFILEATTRIBUTEUPLOADS)
+                                {
+                                    // unless the app prefers the node to appear first, and get them attached when ready
+                                    fileAttributesAfterUpload[nexttransfer->uploadhandle].outstanding =
+                                        !!(bitmask & (1 << GfxProc::THUMBNAIL)) + !!(bitmask & (1 << GfxProc::PREVIEW));
+                                    bitmask = 0;
+                                }
+
                                 if (bitmask & (1 << GfxProc::THUMBNAIL))
                                 {
                                     fileAttributesUploading.setFileAttributePending(nexttransfer->uploadhandle, GfxProc::THUMBNAIL, nexttransfer);
@@ -4301,6 +4441,7 @@ void MegaClient::dispatchTransfers()
                     app->transfer_update(nexttransfer);
 
                     performanceStats.transferStarts += 1;
+                    mMetrics.transfersStarted.add();
                 }
                 else if (openfinished)
                 {
@@ -4496,6 +4637,176 @@ void MegaClient::catchup()
     btsc.reset();
 }
 
+string MegaClient::csUrl(const string& idempotenceId, bool v3)
+{
+    string url = httpio->APIURL;
+    url.append("cs?id=");
+    url.append(idempotenceId);
+    url.append(getAuthURI());
+    url.append(appkey);
+
+    url.append(v3 ? "&v=3" : "&v=2");
+
+    if (lang.size())
+    {
+        url.append("&");
+        url.append(lang);
+    }
+    if (trackJourneyId())
+    {
+        url.append("&j=");
+        url.append(mJourneyId.getValue());
+    }
+    return url;
+}
+
+void MegaClient::setSecondaryCommandChannel(bool enable)
+{
+    reqs.setSecondaryChannel(enable, rng);
+}
+
+void MegaClient::prewarmStorageConnections(const std::vector<string>& urls, direction_t d)
+{
+    for (const string& url : urls)
+    {
+        size_t hostStart = url.find("://");
+        if (hostStart == string::npos)
+        {
+            continue;
+        }
+
+        size_t hostEnd = url.find('/', hostStart + 3);
+        string root = hostEnd == string::npos ? url + "/" : url.substr(0, hostEnd + 1);
+
+        dstime& last = mPrewarmedHosts[std::to_string(d) + root];
+        if (last && Waiter::ds - last < PREWARM_INTERVAL_DS)
+        {
+            continue;
+        }
+        last = Waiter::ds;
+
+        LOG_debug << "Pre-warming connection to " << root;
+        mPrewarmReqs.emplace_back(new HttpReq(true));
+        mPrewarmReqs.back()->logname = clientname + "prewarm ";
+        mPrewarmReqs.back()->setreq(root.c_str(), REQ_BINARY);
+        mPrewarmReqs.back()->prewarm(this, d);
+    }
+}
+
+void MegaClient::execSecondaryCs()
+{
+    RequestDispatcher* secondary = reqs.secondaryChannel();
+    if (!secondary)
+    {
+        return;
+    }
+
+    if (pendingcsSecondary)
+    {
+        retryreason_t reason = RETRY_CONNECTIVITY;
+
+        switch (static_cast<reqstatus_t>(pendingcsSecondary->status))
+        {
+            case REQ_SUCCESS:
+                if (*pendingcsSecondary->in.c_str() == '[')
+                {
+                    // the commands may queue others, or even log out, while it's processed
+                    unique_ptr<HttpReq> req = std::move(pendingcsSecondary);
+                    btcsSecondary.reset();
+                    secondary->serverresponse(std::move(req->in), this);
+                    return;
+                }
+
+                if (pendingcsSecondary->in != "-3" && pendingcsSecondary->in != "-4")
+                {
+                    // request-level error, for all the commands of the batch
+                    string requestError = pendingcsSecondary->in.empty() ? std::to_string(API_EINTERNAL)
+                                                                        : pendingcsSecondary->in;
+                    pendingcsSecondary.reset();
+                    btcsSecondary.reset();
+                    secondary->servererror(requestError, this);
+                    return;
+                }
+
+                reason = pendingcsSecondary->in == "-3" ? RETRY_API_LOCK : RETRY_RATE_LIMIT;
+
+            // fall through
+            case REQ_FAILURE:
+                if (pendingcsSecondary->httpstatus == 402 && !pendingcsSecondary->mHashcashToken.empty())
+                {
+                    solveHashcash(mSecondaryHashcash, *pendingcsSecondary);
+                }
+                else if (pendingcsSecondary->httpstatus == 500)
+                {
+                    reason = RETRY_SERVERS_BUSY;
+                }
+
+                pendingcsSecondary.reset();
+                btcsSecondary.backoff();
+                LOG_warn << "Retrying secondary cs request in " << btcsSecondary.retryin() << " ds";
+
+                // resent unchanged, for idempotence
+                secondary->inflightFailure(reason);
+                return;
+
+            default:
+                return;
+        }
+    }
+
+    if (btcsSecondary.armed() && secondary->readyToSend() && !solvingHashcash(mSecondaryHashcash))
+    {
+        pendingcsSecondary.reset(new HttpReq());
+        pendingcsSecondary->protect = true;
+        pendingcsSecondary->logname = clientname + "cs2 ";
+
+        bool includesFetchingNodes;
+        bool v3;
+        string idempotenceId;
+        *pendingcsSecondary->out = secondary->serverrequest(includesFetchingNodes, v3, this, idempotenceId);
+        assert(!includesFetchingNodes);
+
+        pendingcsSecondary->posturl = csUrl(idempotenceId, v3);
+        pendingcsSecondary->type = REQ_JSON;
+        attachHashcash(mSecondaryHashcash, *pendingcsSecondary);
+        pendingcsSecondary->post(this);
+    }
+}
+
+void MegaClient::solveHashcash(unique_ptr<HashcashSolver>& solver, HttpReq& req)
+{
+    string token = std::move(req.mHashcashToken);
+    req.mHashcashToken.clear(); // just to be sure
+
+    // the solver notifies from its own thread, so it holds on to the waiter
+    solver.reset(new HashcashSolver(std::move(token), req.mHashcashEasiness, [w = waiter]() { w->notify(); }));
+    LOG_debug << req.logname << "Solving X-Hashcash challenge on " << solver->threadCount() << " threads";
+}
+
+void MegaClient::attachHashcash(unique_ptr<HashcashSolver>& solver, HttpReq& req)
+{
+    if (!solver)
+    {
+        return;
+    }
+
+    assert(solver->done());
+    LOG_warn << req.logname << "X-Hashcash solved in " << solver->elapsed().count() << " ms, "
+             << solver->attempts() << " attempts, " << solver->threadCount() << " threads";
+
+    if (solver->prefix().empty())
+    {
+        LOG_err << req.logname << "No X-Hashcash solution, retrying without it";
+    }
+    else
+    {
+        req.mHashcashToken = solver->token();
+        req.mHashcashEasiness = solver->easiness();
+        req.mHashcashPrefix = solver->prefix();
+    }
+    solver.reset();
+}
+
 void MegaClient::abortlockrequest()
 {
     workinglockcs.reset();
@@ -4680,9 +4991,15 @@ void MegaClient::locallogout(bool removecaches, bool keepSyncsConfigFile)
     mNodeManager.reset();
 
     reqs.clear();
+    mQueuedUploadPutnodes.clear();
+    mPendingKeyDerivations.clear();
 
     delete pendingcs;
     pendingcs = NULL;
+    pendingcsSecondary.reset();
+    mSecondaryHashcash.reset();
+    mPrewarmReqs.clear();
+    mPrewarmedHosts.clear();
     scsn.clear();
     mBlocked = false;
     mBlockedSet = false;
@@ -4716,6 +5033,7 @@ void MegaClient::locallogout(bool removecaches, bool keepSyncsConfigFile)
     mBizStatus = BIZ_STATUS_UNKNOWN;
     mBizMasters.clear();
     mCachedStatus.clear();
+    mContentHashIndex.clear();
     scpaused = false;
     mLargestEverSeenScSeqTag.clear();
 
@@ -4733,8 +5051,10 @@ void MegaClient::locallogout(bool removecaches, bool keepSyncsConfigFile)
     }
 
     fafcs.clear();
+    mCachedFileAttributes.clear();
 
     fileAttributesUploading.clear();
+    fileAttributesAfterUpload.clear();
 
     // erase keys & session ID
     resetKeyring();
@@ -4771,9 +5091,9 @@ void MegaClient::locallogout(bool removecaches, bool keepSyncsConfigFile)
     mKeyManager.reset();
 
     mLastErrorDetected = REASON_ERROR_NO_ERROR;
-    
-    mReqHashcashEasiness = 0;
-    mReqHashcashToken.clear();
+
+    // cancels any solving in progress
+    mReqHashcash.reset();
 }
 
 void MegaClient::removeCaches()
@@ -4794,6 +5114,12 @@ void MegaClient::removeCaches()
         statusTable.reset();
     }
 
+    // decrypted content, not to be left behind for the next account
+    if (mFileAttributeCache)
+    {
+        mFileAttributeCache->clear();
+    }
+
     disabletransferresumption();
 }
 
@@ -4907,6 +5233,8 @@ bool MegaClient::procsc()
     actionpacketsCurrent = false;
 
     CodeCounter::ScopeTimer ccst(performanceStats.scProcessingTime);
+    MEGA_TRACE_SCOPE("client", "procsc");
+    EventLoopMonitor::Scope loopScope(mLoopMonitor, EventLoopMonitor::PHASE_SC_PROCESSING);
     nameid name;
 
     std::shared_ptr<Node> lastAPDeletedNode;
@@ -4964,6 +5292,15 @@ bool MegaClient::procsc()
                     applykeys();
                     mNewKeyRepository.clear();
 
+                    if (!statecurrent && insca_notlast && fetchingnodes && fnstats.mode == FetchNodesStats::MODE_DB
+                        && mCatchUpActionPackets > std::max(CATCHUP_MIN_RELOAD_ACTIONPACKETS, static_cast<size_t>(fnstats.nodesCached)))
+                    {
+                        // the backlog is still coming (spoonfed) and it already outgrew the tree: the state so far
+                        // is consistent, so finish this response and reload instead of asking for the next batch
+                        LOG_debug << "Replayed " << mCatchUpActionPackets << " action packets to catch up " << fnstats.nodesCached << " cached nodes";
+                        mCatchUpReload = true;
+                    }
+
                     if (!statecurrent && !insca_notlast)   // with actionpacket spoonfeeding, just finishing a batch does not mean we are up to date yet - keep going while "ir":1
                     {
                         if (fetchingnodes)
@@ -5188,6 +5525,11 @@ bool MegaClient::procsc()
 
             if (jsonsc.enterobject())
             {
+                if (!statecurrent)
+                {
+                    ++mCatchUpActionPackets;
+                }
+
                 // the "a" attribute is guaranteed to be the first in the object
                 if (jsonsc.getnameid() == 'a')
                 {
@@ -5198,6 +5540,8 @@ bool MegaClient::procsc()
 
                     name = jsonsc.getnameidvalue();
 
+                    EventLoopMonitor::Task loopTask(mLoopMonitor, "action packet", name);
+
                     // only process server-client request if not marked as
                     // self-originating ("i" marker element guaranteed to be following
                     // "a" element if present)
@@ -5609,6 +5953,7 @@ void MegaClient::initsc()
             // Commit now, otherwise we'll have to do fetchnodes again (on restart) if no actionpackets arrive.
             LOG_debug << "DB transaction COMMIT (sessionid: " << string(sessionid, sizeof(sessionid)) << ")";
             sctable->commit();
+            sctable->flushCommits();
             sctable->begin();
             pendingsccommit = false;
         }
@@ -5835,10 +6180,26 @@ error MegaClient::getfa(handle h, string *fileattrstring, const string &nodekey,
             }
         }
 
+        auto it = std::find_if(mCachedFileAttributes.begin(), mCachedFileAttributes.end(),
+                               [fah](const CachedFileAttribute& cached) { return cached.fah == fah; });
+        if (it != mCachedFileAttributes.end())
+        {
+            mCachedFileAttributes.erase(it);
+            return API_OK;
+        }
+
         return API_ENOENT;
     }
     else
     {
+        string data;
+        if (mFileAttributeCache && mFileAttributeCache->get(fah, data))
+        {
+            mCachedFileAttributes.push_back(CachedFileAttribute{h, t, fah, reqtag, std::move(data)});
+            waiter->notify();
+            return API_OK;
+        }
+
         // add file attribute cluster channel and set cluster reference node handle
         FileAttributeFetchChannel** fafcp = &fafcs[c];
 
@@ -5902,13 +6263,19 @@ bool MegaClient::putfa(NodeOrUploadHandle th, fatype t, SymmCipher* key, int tag
 {
     // CBC-encrypt attribute data (padded to next multiple of BLOCKSIZE)
     data->resize((data->size() + SymmCipher::BLOCKSIZE - 1) & -SymmCipher::BLOCKSIZE);
+
+    // cached as fetching would return it, once the upload reports the attribute's handle
+    string plaintext = mFileAttributeCache ? *data : string();
+
     if (!key->cbc_encrypt((byte*)data->data(), data->size()))
     {
         LOG_err << "Failed to CBC encrypt Node attribute data.";
         return false;
     }
 
-    queuedfa.emplace_back(new HttpReqFA(th, t, usehttps, tag, std::move(data), true, this));
+    auto fa = std::make_shared<HttpReqFA>(th, t, usehttps, tag, std::move(data), true, this);
+    fa->plaintext = std::move(plaintext);
+    queuedfa.push_back(std::move(fa));
     LOG_debug << "File attribute added to queue - " << th << " : " << queuedfa.size() << " queued, " << activefa.size() << " active";
 
     // no other file attribute storage request currently in progress? POST this one.
@@ -5933,9 +6300,23 @@ void MegaClient::activatefa()
 }
 
 // has the limit of concurrent transfer tslots been reached?
-bool MegaClient::slotavail() const
+bool MegaClient::slotavail(bool smallUpload) const
+{
+    unsigned maxSlots = smallUpload && mBatchSmallUploads ? 2 * MAXTOTALTRANSFERS : MAXTOTALTRANSFERS;
+    return !mBlocked && tslots.size() < maxSlots;
+}
+
+stats::DownloadPipelineStats MegaClient::downloadPipelineStats() const
 {
-    return !mBlocked && tslots.size() < MAXTOTALTRANSFERS;
+    stats::DownloadPipelineStats pipeline;
+    for (const TransferSlot* slot : tslots)
+    {
+        if (slot->transfer->type == GET)
+        {
+            slot->addDownloadPipelineStats(pipeline);
+        }
+    }
+    return pipeline;
 }
 
 bool MegaClient::setstoragestatus(storagestatus_t status)
@@ -6328,6 +6709,61 @@ bool MegaClient::CacheableStatusMap::addOrUpdate(CacheableStatus::Type type, int
     return changed;
 }
 
+std::shared_ptr<Node> MegaClient::ContentHashIndex::lookup(const string& hash, m_off_t size)
+{
+    auto it = find(hash);
+    if (it == end())
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<Node> n = mClient->nodeByHandle(it->second.mHandle);
+    if (n && n->type == FILENODE && n->size == size && n->nodekey().size())
+    {
+        return n;
+    }
+
+    if (!n)
+    {
+        // removed from the account since
+        if (mClient->statusTable && it->second.dbid)
+        {
+            DBTableTransactionCommitter committer(mClient->statusTable);
+            mClient->statusTable->del(it->second.dbid);
+        }
+        erase(it);
+    }
+    return nullptr;
+}
+
+void MegaClient::ContentHashIndex::add(const string& hash, NodeHandle h)
+{
+    auto it_bool = emplace(hash, CachedContentHash(hash, h));
+    if (!it_bool.second)
+    {
+        if (it_bool.first->second.mHandle == h)
+        {
+            return;
+        }
+        it_bool.first->second.mHandle = h; // don't replace it, or we lose the dbid
+    }
+
+    if (mClient->statusTable)
+    {
+        DBTableTransactionCommitter committer(mClient->statusTable);
+        if (!mClient->statusTable->put(MegaClient::CACHEDCONTENTHASH, &it_bool.first->second, &mClient->key))
+        {
+            LOG_err << "Failed to add/update content hash to db: " << h;
+        }
+    }
+}
+
+void MegaClient::ContentHashIndex::load(unique_ptr<CachedContentHash> entry)
+{
+    string hash = entry->mHash;
+    emplace(std::move(hash), std::move(*entry));
+}
+
 int64_t MegaClient::CacheableStatusMap::lookup(CacheableStatus::Type type, int64_t defaultValue)
 {
     auto it = find(type);
@@ -8367,6 +8803,14 @@ void MegaClient::sc_ub()
 // - deletions
 // - set export enable/disable
 // purge removed nodes after notification
+bool MegaClient::coalescingActionPackets()
+{
+    return mCoalesceActionPackets
+           && insca_notlast
+           && !fetchingnodes
+           && mNodeManager.nodeNotifySize() < MAX_COALESCED_NODES;
+}
+
 void MegaClient::notifypurge(void)
 {
     if (!mNodeManager.ready())
@@ -8375,6 +8819,12 @@ void MegaClient::notifypurge(void)
         return;
     }
 
+    if (coalescingActionPackets())
+    {
+        // more actionpackets to follow, they may change the same nodes again
+        return;
+    }
+
     int i, t;
 
     handle tscsn = cachedscsn;
@@ -9142,22 +9592,158 @@ void MegaClient::putnodes(const char* user, vector<NewNode>&& newnodes, int tag,
         return;
     }
 
-    queuepubkeyreq(user, std::make_unique<PubKeyActionPutNodes>(std::move(newnodes), tag, std::move(completion)));
+    queuepubkeyreq(user, std::make_unique<PubKeyActionPutNodes>(std::move(newnodes), tag, std::move(completion)));
+}
+
+void MegaClient::putnodesOfUpload(NodeHandle target,
+                                  VersioningOption vo,
+                                  NewNode&& newnode,
+                                  int tag,
+                                  putsource_t source,
+                                  CommandPutNodes::Completion&& completion,
+                                  bool canChangeVault)
+{
+    if (!mBatchSmallUploads)
+    {
+        vector<NewNode> newnodes;
+        newnodes.push_back(std::move(newnode));
+        reqs.add(new CommandPutNodes(this, target, NULL, vo, std::move(newnodes), tag, source,
+                                     nullptr, std::move(completion), canChangeVault, {}));
+        return;
+    }
+
+    auto& queued = mQueuedUploadPutnodes[std::make_tuple(target, vo, source, canChangeVault)];
+    queued.nodes.push_back(std::move(newnode));
+    queued.owners.emplace_back(tag, std::move(completion));
+}
+
+void MegaClient::sendQueuedUploadPutnodes()
+{
+    for (auto& q : mQueuedUploadPutnodes)
+    {
+        NodeHandle target = std::get<0>(q.first);
+        VersioningOption vo = std::get<1>(q.first);
+        putsource_t source = std::get<2>(q.first);
+        bool canChangeVault = std::get<3>(q.first);
+
+        if (q.second.owners.size() == 1)
+        {
+            auto& owner = q.second.owners.front();
+            reqs.add(new CommandPutNodes(this, target, NULL, vo, std::move(q.second.nodes), owner.first, source,
+                                         nullptr, std::move(owner.second), canChangeVault, {}));
+            continue;
+        }
+
+        LOG_debug << "Grouping the putnodes of " << q.second.owners.size() << " uploads into " << target;
+
+        auto owners = std::make_shared<vector<pair<int, CommandPutNodes::Completion>>>(std::move(q.second.owners));
+
+        // each upload gets its own node back, with its own outcome, as if it had been sent alone
+        auto splitResult = [this, owners](const Error& e, targettype_t t, vector<NewNode>& nn, bool targetOverride,
+                                          int, const map<string, string>& fileHandles)
+        {
+            assert(nn.size() == owners->size());
+            for (size_t i = 0; i < nn.size() && i < owners->size(); ++i)
+            {
+                vector<NewNode> own;
+                own.push_back(std::move(nn[i]));
+
+                Error ownError = own[0].added ? Error(API_OK)
+                               : own[0].mError != API_OK ? Error(own[0].mError)
+                               : e != API_OK ? e : Error(API_ENOENT);
+
+                auto& owner = (*owners)[i];
+                if (owner.second)
+                {
+                    owner.second(ownError, t, own, targetOverride, owner.first, fileHandles);
+                }
+                else
+                {
+                    app->putnodes_result(ownError, t, own, targetOverride, owner.first, fileHandles);
+                }
+            }
+        };
+
+        auto cmd = new CommandPutNodes(this, target, NULL, vo, std::move(q.second.nodes), owners->front().first, source,
+                                       nullptr, std::move(splitResult), canChangeVault, {});
+        for (size_t i = 1; i < owners->size(); ++i)
+        {
+            cmd->mBatchedTags.push_back((*owners)[i].first);
+        }
+        reqs.add(cmd);
+    }
+    mQueuedUploadPutnodes.clear();
+}
+
+void MegaClient::putFileAttributes(handle h, fatype t, const string& encryptedAttributes, int tag)
+{
+    std::shared_ptr<Node> node = mNodeManager.getNodeByHandle(NodeHandle().set6byte(h));
+    if (node && node->fileattrstring.size() + encryptedAttributes.size() >= MAX_FILE_ATTRIBUTE_SIZE)
+    {
+        sendevent(99485, "Exceeded size for file attribute");
+        LOG_err << "Exceede size for file attribute: " << t;
+        restag = tag;
+        app->putfa_result(h, t, API_EARGS);
+        return;
+    }
+
+    reqs.add(new CommandAttachFA(this, h, t, encryptedAttributes, tag));
+}
+
+bool MegaClient::lateFileAttributeResolved(UploadHandle uh, fatype type, handle fah)
+{
+    auto late = fileAttributesAfterUpload.lookupExisting(uh);
+    if (!late)
+    {
+        return false;
+    }
+
+    if (fah != UNDEF)
+    {
+        for (NodeHandle& node : late->nodes)
+        {
+            reqs.add(new CommandAttachFA(this, node.as8byte(), type, fah, 0));
+        }
+
+        if (!late->putnodesDone)
+        {
+            late->ready.emplace_back(type, fah);
+        }
+    }
+
+    if (--late->outstanding <= 0 && late->putnodesDone)
+    {
+        fileAttributesAfterUpload.erase(uh);
+    }
+    return true;
 }
 
-void MegaClient::putFileAttributes(handle h, fatype t, const string& encryptedAttributes, int tag)
+void MegaClient::lateFileAttributesTarget(UploadHandle uh, NodeHandle node)
 {
-    std::shared_ptr<Node> node = mNodeManager.getNodeByHandle(NodeHandle().set6byte(h));
-    if (node && node->fileattrstring.size() + encryptedAttributes.size() >= MAX_FILE_ATTRIBUTE_SIZE)
+    auto late = fileAttributesAfterUpload.lookupExisting(uh);
+    if (!late)
     {
-        sendevent(99485, "Exceeded size for file attribute");
-        LOG_err << "Exceede size for file attribute: " << t;
-        restag = tag;
-        app->putfa_result(h, t, API_EARGS);
         return;
     }
 
-    reqs.add(new CommandAttachFA(this, h, t, encryptedAttributes, tag));
+    if (!node.isUndef())
+    {
+        LOG_debug << "Attaching " << late->ready.size() << " file attributes of upload " << uh << " to " << node;
+        for (auto& fa : late->ready)
+        {
+            reqs.add(new CommandAttachFA(this, node.as8byte(), fa.first, fa.second, 0));
+        }
+        late->nodes.push_back(node);
+    }
+
+    // a further putnodes of the same upload (another target) gets only the ones still outstanding
+    late->putnodesDone = true;
+    late->ready.clear();
+
+    if (late->outstanding <= 0)
+    {
+        fileAttributesAfterUpload.erase(uh);
+    }
 }
 
 // returns 1 if node has accesslevel a or better, 0 otherwise
@@ -9696,19 +10282,23 @@ error MegaClient::pw_key(const char* utf8pw, byte* key) const
 
 SymmCipher *MegaClient::getRecycledTemporaryTransferCipher(const byte *key, int type)
 {
-    tmptransfercipher.setkey(key, type);
-    return &tmptransfercipher;
+    return SymmCipherCache::local().get(key, type);
 }
 
 SymmCipher *MegaClient::getRecycledTemporaryNodeCipher(const string *key)
 {
-    return tmpnodecipher.setkey(key) ? &tmpnodecipher : nullptr;
+    if (key->size() != FILENODEKEYLENGTH && key->size() != FOLDERNODEKEYLENGTH)
+    {
+        return nullptr;
+    }
+
+    return SymmCipherCache::local().get(reinterpret_cast<const byte*>(key->data()),
+                                        key->size() == FOLDERNODEKEYLENGTH ? FOLDERNODE : FILENODE);
 }
 
 SymmCipher *MegaClient::getRecycledTemporaryNodeCipher(const byte *key)
 {
-    tmpnodecipher.setkey(key);
-    return &tmpnodecipher;
+    return SymmCipherCache::local().get(key);
 }
 
 // compute generic string hash
@@ -9775,6 +10365,7 @@ int MegaClient::readnodes(JSON* j, int notify, putsource_t source, vector<NewNod
         }
     }
 
+    mNodeManager.flushDecodingQueue();
     mergenewshares(notify != 0);
     mNodeManager.checkOrphanNodes(missingParentNodes);
 
@@ -9817,11 +10408,17 @@ int MegaClient::readnode(JSON* j,
         nameid name;
         int nni = -1;
 
+        static constexpr NameIdDispatch fields{'h', 'p', name_id::u, 't', 'a', 'k', 's', 'i',
+                                               MAKENAMEID2('t', 's'), MAKENAMEID2('f', 'a'), 'r',
+                                               MAKENAMEID2('s', 'k'), MAKENAMEID2('s', 'u'),
+                                               MAKENAMEID3('s', 't', 's')};
+        static_assert(fields.valid(), "node record fields must hash without collisions");
+
         while ((name = j->getnameid()) != EOO)
         {
-            switch (name)
+            switch (fields(name))
             {
-                case 'h':   // new node: handle
+                case fields('h'):   // new node: handle
                     h = j->gethandle();
                     if (priorActionpacketDeletedNode && firstHandleMatchesDelete)
                     {
@@ -9830,56 +10427,56 @@ int MegaClient::readnode(JSON* j,
                     }
                     break;
 
-                case 'p':   // parent node
+                case fields('p'):   // parent node
                     ph = j->gethandle();
                     break;
 
-                case name_id::u: // owner user
+                case fields(name_id::u): // owner user
                     u = j->gethandle(USERHANDLE);
                     break;
 
-                case 't':   // type
+                case fields('t'):   // type
                     t = (nodetype_t)j->getint();
                     break;
 
-                case 'a':   // attributes
+                case fields('a'):   // attributes
                     a = j->getvalue();
                     break;
 
-                case 'k':   // key(s)
+                case fields('k'):   // key(s)
                     k = j->getvalue();
                     break;
 
-                case 's':   // file size
+                case fields('s'):   // file size
                     s = j->getint();
                     break;
 
-                case 'i':   // related source NewNode index
+                case fields('i'):   // related source NewNode index
                     nni = int(j->getint());
                     break;
 
-                case MAKENAMEID2('t', 's'):  // actual creation timestamp
+                case fields(MAKENAMEID2('t', 's')):  // actual creation timestamp
                     ts = j->getint();
                     break;
 
-                case MAKENAMEID2('f', 'a'):  // file attributes
+                case fields(MAKENAMEID2('f', 'a')):  // file attributes
                     fa = j->getvalue();
                     break;
 
                     // inbound share attributes
-                case 'r':   // share access level
+                case fields('r'):   // share access level
                     rl = (accesslevel_t)j->getint();
                     break;
 
-                case MAKENAMEID2('s', 'k'):  // share key
+                case fields(MAKENAMEID2('s', 'k')):  // share key
                     sk = j->getvalue();
                     break;
 
-                case MAKENAMEID2('s', 'u'):  // sharing user
+                case fields(MAKENAMEID2('s', 'u')):  // sharing user
                     su = j->gethandle(USERHANDLE);
                     break;
 
-                case MAKENAMEID3('s', 't', 's'):  // share timestamp
+                case fields(MAKENAMEID3('s', 't', 's')):  // share timestamp
                     sts = j->getint();
                     break;
 
@@ -10078,19 +10675,27 @@ int MegaClient::readnode(JSON* j,
                 }
             }
 
-            if (applykeys)
-            {
-                n->applykey();
-            }
-
-            if (notify)
+            if (applykeys && !notify && fetchingnodes)
             {
-                // node is save in DB at notifypurge
-                mNodeManager.notifyNode(n);
+                // key applied and node saved in DB by a batch (see CommandFetchNodes)
+                mNodeManager.queueNodeForDecoding(n);
             }
-            else // Only need to save in DB if node is not notified
+            else
             {
-                mNodeManager.saveNodeInDb(n.get());
+                if (applykeys)
+                {
+                    n->applykey();
+                }
+
+                if (notify)
+                {
+                    // node is save in DB at notifypurge
+                    mNodeManager.notifyNode(n);
+                }
+                else // Only need to save in DB if node is not notified
+                {
+                    mNodeManager.saveNodeInDb(n.get());
+                }
             }
 
             n = nullptr;    // ownership is taken by NodeManager upon addNode()
@@ -10248,31 +10853,34 @@ void MegaClient::readoutshareelement(JSON* j)
     accesslevel_t r = ACCESS_UNKNOWN;
     m_time_t ts = 0;
 
+    static constexpr NameIdDispatch fields{'h', 'p', name_id::u, 'r', MAKENAMEID2('t', 's'), EOO};
+    static_assert(fields.valid(), "outgoing share fields must hash without collisions");
+
     for (;;)
     {
-        switch (j->getnameid())
+        switch (fields(j->getnameid()))
         {
-            case 'h':
+            case fields('h'):
                 h = j->gethandle();
                 break;
 
-            case 'p':
+            case fields('p'):
                 p = j->gethandle(PCRHANDLE);
                 break;
 
-            case name_id::u: // share target user
+            case fields(name_id::u): // share target user
                 uh = j->is(EXPORTEDLINK) ? 0 : j->gethandle(USERHANDLE);
                 break;
 
-            case 'r':           // access
+            case fields('r'):           // access
                 r = (accesslevel_t)j->getint();
                 break;
 
-            case MAKENAMEID2('t', 's'):      // timestamp
+            case fields(MAKENAMEID2('t', 's')):      // timestamp
                 ts = j->getint();
                 break;
 
-            case EOO:
+            case fields(EOO):
                 if (ISUNDEF(h))
                 {
                     LOG_warn << "Missing outgoing share node";
@@ -10720,30 +11328,43 @@ int MegaClient::readuser(JSON* j, bool actionpackets)
         BizMode bizMode = BIZ_MODE_UNKNOWN;
         string pubk, puEd255, puCu255, sigPubk, sigCu255;
 
+        static constexpr NameIdDispatch fields{
+            name_id::u,
+            name_id::c,
+            'm',
+            MAKENAMEID2('t', 's'),
+            'b',
+            MAKENAMEID4('p', 'u', 'b', 'k'),
+            MAKENAMEID8('+', 'p', 'u', 'E', 'd', '2', '5', '5'),
+            MAKENAMEID8('+', 'p', 'u', 'C', 'u', '2', '5', '5'),
+            MAKENAMEID8('+', 's', 'i', 'g', 'P', 'u', 'b', 'k'),
+            EOO};
+        static_assert(fields.valid(), "user fields must hash without collisions");
+
         bool exit = false;
         while (!exit)
         {
             string fieldName = j->getnameWithoutAdvance();
             name = j->getnameid();
-            switch (name)
+            switch (fields(name))
             {
-                case name_id::u: // new user: handle
+                case fields(name_id::u): // new user: handle
                     uh = j->gethandle(USERHANDLE);
                     break;
 
-                case name_id::c: // visibility
+                case fields(name_id::c): // visibility
                     v = (visibility_t)j->getint();
                     break;
 
-                case 'm':   // email
+                case fields('m'):   // email
                     m = j->getvalue();
                     break;
 
-                case MAKENAMEID2('t', 's'):
+                case fields(MAKENAMEID2('t', 's')):
                     ts = j->getint();
                     break;
 
-                case 'b':
+                case fields('b'):
                 {
                     if (j->enterobject())
                     {
@@ -10768,23 +11389,23 @@ int MegaClient::readuser(JSON* j, bool actionpackets)
                     break;
                 }
 
-                case MAKENAMEID4('p', 'u', 'b', 'k'):
+                case fields(MAKENAMEID4('p', 'u', 'b', 'k')):
                     j->storebinary(&pubk);
                     break;
 
-                case MAKENAMEID8('+', 'p', 'u', 'E', 'd', '2', '5', '5'):
+                case fields(MAKENAMEID8('+', 'p', 'u', 'E', 'd', '2', '5', '5')):
                     j->storebinary(&puEd255);
                     break;
 
-                case MAKENAMEID8('+', 'p', 'u', 'C', 'u', '2', '5', '5'):
+                case fields(MAKENAMEID8('+', 'p', 'u', 'C', 'u', '2', '5', '5')):
                     j->storebinary(&puCu255);
                     break;
 
-                case MAKENAMEID8('+', 's', 'i', 'g', 'P', 'u', 'b', 'k'):
+                case fields(MAKENAMEID8('+', 's', 'i', 'g', 'P', 'u', 'b', 'k')):
                     j->storebinary(&sigPubk);
                     break;
 
-                case EOO:
+                case fields(EOO):
                     exit = true;
                     break;
 
@@ -10996,6 +11617,7 @@ void MegaClient::openStatusTable(bool loadFromCache)
     {
         statusTable.reset();
         mCachedStatus.clear();
+        mContentHashIndex.clear();
     }
     doOpenStatusTable();
     if (loadFromCache && statusTable)
@@ -11089,9 +11711,13 @@ void MegaClient::login2(const char *email, const char *password, const string *s
     string bsalt;
     Base64::atob(*salt, bsalt);
 
-    vector<byte> derivedKey = deriveKey(password, bsalt, 2 * SymmCipher::KEYLENGTH);
-
-    login2(email, derivedKey.data(), pin, std::move(completion));
+    string semail(email);
+    std::unique_ptr<string> spin(pin ? new string(pin) : nullptr);
+    deriveKeyAsync(password, bsalt, 2 * SymmCipher::KEYLENGTH,
+                   [this, semail, spin = shared_ptr<string>(std::move(spin)), completion = std::move(completion)](const vector<byte>& derivedKey) mutable
+    {
+        login2(semail.c_str(), derivedKey.data(), spin ? spin->c_str() : nullptr, std::move(completion));
+    });
 }
 
 void MegaClient::login2(const char *email, const byte *derivedKey, const char* pin, CommandLogin::Completion completion)
@@ -11255,9 +11881,12 @@ error MegaClient::validatepwd(const char* pswd)
     }
     else if (accountversion == 2)
     {
-        vector<byte> dk = deriveKey(pswd, accountsalt, 2 * SymmCipher::KEYLENGTH);
-        dk = vector<byte>(dk.data() + SymmCipher::KEYLENGTH, dk.data() + 2 * SymmCipher::KEYLENGTH);
-        reqs.add(new CommandValidatePassword(this, u->email.c_str(), dk));
+        string email = u->email;
+        deriveKeyAsync(pswd, accountsalt, 2 * SymmCipher::KEYLENGTH, [this, email](const vector<byte>& derivedKey)
+        {
+            vector<byte> dk(derivedKey.data() + SymmCipher::KEYLENGTH, derivedKey.data() + 2 * SymmCipher::KEYLENGTH);
+            reqs.add(new CommandValidatePassword(this, email.c_str(), dk));
+        });
 
         return API_OK;
     }
@@ -11481,6 +12110,9 @@ void MegaClient::opensctable()
                 DBTableNodes *nodeTable = dynamic_cast<DBTableNodes *>(sctable.get());
                 assert(nodeTable);
                 mNodeManager.setTable(nodeTable);
+                sctable->setGroupCommit(DB_GROUP_COMMIT_DELAY, DB_GROUP_COMMIT_MAX_COMMITS);
+                // users, PCRs, sets, alerts... are loaded at once from it by fetchsc()
+                sctable->setSnapshot(true);
 
                 // DB connection always has a transaction started (applies to both tables, statecache and nodes)
                 // We only commit once we have an up to date SCSN and the table state matches it.
@@ -11834,6 +12466,33 @@ void MegaClient::proctree(std::shared_ptr<Node> n, TreeProc* tp, bool skipinshar
     tp->proc(this, n);
 }
 
+void MegaClient::proctreeInBatches(std::shared_ptr<Node> n, TreeProc* tp, bool skipinshares, bool skipversions)
+{
+    if (!n) return;
+
+    // breadth first: reversed, every node comes after all its descendants
+    sharedNode_vector nodes{n};
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        // as in proctree(), only the versions of the root are skipped
+        if (!i && skipversions && n->type == FILENODE)
+        {
+            continue;
+        }
+
+        for (auto& child : getChildren(nodes[i].get()))
+        {
+            if (!(skipinshares && child->inshare))
+            {
+                nodes.push_back(std::move(child));
+            }
+        }
+    }
+    std::reverse(nodes.begin(), nodes.end());
+
+    tp->procBatch(this, nodes);
+}
+
 // queue PubKeyAction request to be triggered upon availability of the user's
 // public key
 void MegaClient::queuepubkeyreq(User* u, std::unique_ptr<PubKeyAction> pka)
@@ -12919,14 +13578,11 @@ void MegaClient::upgradeAccountToV2(const string& pwd, int ctag, std::function<v
     assert(accountversion == 1);
     assert(!pwd.empty());
 
-    vector<byte> clientRandomValue;
-    vector<byte> encmasterkey;
-    string hashedauthkey;
-    string salt;
-
-    fillCypheredAccountDataV2(pwd.c_str(), clientRandomValue, encmasterkey, hashedauthkey, salt);
-
-    reqs.add(new CommandAccountVersionUpgrade(std::move(clientRandomValue), std::move(encmasterkey), std::move(hashedauthkey), std::move(salt), ctag, completion));
+    fillCypheredAccountDataV2(pwd.c_str(), [this, ctag, completion](vector<byte>& clientRandomValue, vector<byte>& encmasterkey,
+                                                                     string& hashedauthkey, string& salt)
+    {
+        reqs.add(new CommandAccountVersionUpgrade(std::move(clientRandomValue), std::move(encmasterkey), std::move(hashedauthkey), std::move(salt), ctag, completion));
+    });
 }
 // -------- end of Account upgrade to V2
 
@@ -12952,6 +13608,9 @@ void MegaClient::senddevcommand(const char* command,
 
 void MegaClient::transfercacheadd(Transfer *transfer, TransferDbCommitter* committer)
 {
+    transfer->mProgressUncached = false;
+    transfer->mProgressCachedDs = Waiter::ds;
+
     if (tctable && !transfer->skipserialization)
     {
         if (committer) committer->addTransferCount += 1;
@@ -12960,8 +13619,21 @@ void MegaClient::transfercacheadd(Transfer *transfer, TransferDbCommitter* commi
     }
 }
 
+void MegaClient::transfercacheprogress(Transfer *transfer, TransferDbCommitter& committer)
+{
+    if (Waiter::ds - transfer->mProgressCachedDs < TRANSFERCACHEPROGRESS_DS)
+    {
+        transfer->mProgressUncached = true;
+        return;
+    }
+
+    transfercacheadd(transfer, &committer);
+}
+
 void MegaClient::transfercachedel(Transfer *transfer, TransferDbCommitter* committer)
 {
+    transfer->mProgressUncached = false;
+
     if (tctable && transfer->dbid)
     {
         if (committer) committer->removeTransferCount += 1;
@@ -14284,43 +14956,48 @@ error MegaClient::changePasswordV1(User* u, const char* password, const char* pi
 
 error MegaClient::changePasswordV2(const char* password, const char* pin)
 {
-    vector<byte> clientRandomValue;
-    vector<byte> encmasterkey;
-    string hashedauthkey;
-    string salt;
-
-    fillCypheredAccountDataV2(password, clientRandomValue, encmasterkey, hashedauthkey, salt);
-
-    // Pass the salt and apply to this->accountsalt if the command succeed to allow posterior checks of the password without getting it from the server
-    reqs.add(new CommandSetMasterKey(this, encmasterkey.data(), reinterpret_cast<const byte*>(hashedauthkey.data()), SymmCipher::KEYLENGTH,
-                                     clientRandomValue.data(), pin, &salt));
+    std::unique_ptr<string> spin(pin ? new string(pin) : nullptr);
+    fillCypheredAccountDataV2(password, [this, spin = shared_ptr<string>(std::move(spin))](vector<byte>& clientRandomValue, vector<byte>& encmasterkey,
+                                                                                            string& hashedauthkey, string& salt)
+    {
+        // Pass the salt and apply to this->accountsalt if the command succeed to allow posterior checks of the password without getting it from the server
+        reqs.add(new CommandSetMasterKey(this, encmasterkey.data(), reinterpret_cast<const byte*>(hashedauthkey.data()), SymmCipher::KEYLENGTH,
+                                         clientRandomValue.data(), spin ? spin->c_str() : nullptr, &salt));
+    });
     return API_OK;
 }
 
-void MegaClient::fillCypheredAccountDataV2(const char* password, vector<byte>& clientRandomValue, vector<byte>& encmasterkey,
-                                           string& hashedauthkey, string& salt)
+void MegaClient::fillCypheredAccountDataV2(const char* password, CypheredAccountDataV2Completion completion)
 {
-    clientRandomValue.resize(SymmCipher::KEYLENGTH, 0);
+    vector<byte> clientRandomValue(SymmCipher::KEYLENGTH, 0);
     rng.genblock(clientRandomValue.data(), clientRandomValue.size());
 
     string buffer = "mega.nz";
     buffer.resize(200, 'P');
     buffer.append(reinterpret_cast<const char*>(clientRandomValue.data()), clientRandomValue.size());
+    string salt;
     HashSHA256 hasher;
     hasher.add(reinterpret_cast<const byte*>(buffer.data()), unsigned(buffer.size()));
     hasher.get(&salt);
 
-    vector<byte> derivedKey = deriveKey(password, salt, 2 * SymmCipher::KEYLENGTH);
+    deriveKeyAsync(password, salt, 2 * SymmCipher::KEYLENGTH,
+                   [this, clientRandomValue, salt, completion = std::move(completion)](const vector<byte>& derivedKey) mutable
+    {
+        // the master key is the one at the time the derivation finished
+        SymmCipher cipher;
+        cipher.setkey(derivedKey.data());
+        vector<byte> encmasterkey(SymmCipher::KEYLENGTH, 0);
+        cipher.ecb_encrypt(key.key, encmasterkey.data());
 
-    SymmCipher cipher;
-    cipher.setkey(derivedKey.data());
-    encmasterkey.resize(SymmCipher::KEYLENGTH, 0);
-    cipher.ecb_encrypt(key.key, encmasterkey.data());
+        string hashedauthkey;
+        HashSHA256 hasher;
+        const byte *authkey = derivedKey.data() + SymmCipher::KEYLENGTH;
+        hasher.add(authkey, SymmCipher::KEYLENGTH);
+        hasher.get(&hashedauthkey);
+        hashedauthkey.resize(SymmCipher::KEYLENGTH);
 
-    const byte *authkey = derivedKey.data() + SymmCipher::KEYLENGTH;
-    hasher.add(authkey, SymmCipher::KEYLENGTH);
-    hasher.get(&hashedauthkey);
-    hashedauthkey.resize(SymmCipher::KEYLENGTH);
+        completion(clientRandomValue, encmasterkey, hashedauthkey, salt);
+    });
 }
 
 vector<byte> MegaClient::deriveKey(const char* password, const string& salt, size_t derivedKeySize)
@@ -14333,6 +15010,41 @@ vector<byte> MegaClient::deriveKey(const char* password, const string& salt, siz
     return derivedKey;
 }
 
+void MegaClient::deriveKeyAsync(const char* password, const string& salt, size_t derivedKeySize, std::function<void(const vector<byte>&)> completion)
+{
+    auto pending = std::make_shared<PendingKeyDerivation>();
+    pending->completion = std::move(completion);
+    pending->tag = reqtag;
+    mPendingKeyDerivations.push_back(pending);
+
+    mAsyncQueue.push([pending, spassword = string(password), salt, derivedKeySize](SymmCipher&)
+    {
+        pending->derivedKey = deriveKey(spassword.c_str(), salt, derivedKeySize);
+        pending->done.store(true, std::memory_order_release);
+    }, false);
+
+    if (pending->done.load(std::memory_order_acquire))
+    {
+        // no worker threads: derived already, exec() must run again to finish it
+        waiter->notify();
+    }
+}
+
+void MegaClient::processPendingKeyDerivations()
+{
+    while (!mPendingKeyDerivations.empty() && mPendingKeyDerivations.front()->done.load(std::memory_order_acquire))
+    {
+        auto pending = std::move(mPendingKeyDerivations.front());
+        mPendingKeyDerivations.pop_front();
+
+        // the commands sent by the completion belong to the request that started the derivation
+        int prevtag = reqtag;
+        reqtag = pending->tag;
+        pending->completion(pending->derivedKey);
+        reqtag = prevtag;
+    }
+}
+
 // create ephemeral session
 void MegaClient::createephemeral()
 {
@@ -14454,7 +15166,7 @@ void MegaClient::setkeypair()
 
 bool MegaClient::fetchsc(DbTable* sctable)
 {
-    uint32_t id;
+    uint32_t id = 0;
     string data;
     std::shared_ptr<Node> n;
     User* u;
@@ -14464,15 +15176,51 @@ bool MegaClient::fetchsc(DbTable* sctable)
 
     sctable->rewind();
 
-    bool hasNext = sctable->next(&id, &data, &key);
+    // read at once, so the records are decrypted in parallel
+    std::vector<std::pair<uint32_t, string>> records;
+    sctable->readAll(records, &key, mAsyncQueue);
     WAIT_CLASS::bumpds();
     fnstats.timeToFirstByte = Waiter::ds - fnstats.startTime;
 
+    // the types that don't depend on the client's state are unserialized by the worker threads too.
+    // Adding them (and the other types) is left to the loop below, in the records' order
+    struct ParsedRecord
+    {
+        unique_ptr<PendingContactRequest> pcr;
+        unique_ptr<Set> set;
+        unique_ptr<SetElement> element;
+    };
+    std::vector<ParsedRecord> parsed(records.size());
+    mAsyncQueue.runInBatches(records.size(),
+                             DbTable::DECRYPTION_BATCH_SIZE,
+                             [&records, &parsed](size_t begin, size_t end, SymmCipher&)
+                             {
+                                 for (size_t i = begin; i < end; ++i)
+                                 {
+                                     string* recordData = &records[i].second;
+                                     switch (records[i].first & (DbTable::IDSPACING - 1))
+                                     {
+                                         case CACHEDPCR:
+                                             parsed[i].pcr.reset(PendingContactRequest::unserialize(recordData));
+                                             break;
+                                         case CACHEDSET:
+                                             parsed[i].set = Set::unserialize(recordData);
+                                             break;
+                                         case CACHEDSETELEMENT:
+                                             parsed[i].element = SetElement::unserialize(recordData);
+                                             break;
+                                     }
+                                 }
+                             });
+
     bool isDbUpgraded = false;      // true when legacy DB is migrated to NOD's DB schema
 
     std::map<NodeHandle, std::vector<std::shared_ptr<Node> >> delayedParents;
-    while (hasNext)
+    for (size_t i = 0; i < records.size(); ++i)
     {
+        id = records[i].first;
+        data = std::move(records[i].second);
+
         switch (id & (DbTable::IDSPACING - 1))
         {
             case CACHEDSCSN:
@@ -14510,9 +15258,9 @@ bool MegaClient::fetchsc(DbTable* sctable)
                 break;
 
             case CACHEDPCR:
-                if ((pcr = PendingContactRequest::unserialize(&data)))
+                if ((pcr = parsed[i].pcr.get()))
                 {
-                    mappcr(pcr->id, unique_ptr<PendingContactRequest>(pcr));
+                    mappcr(pcr->id, std::move(parsed[i].pcr));
                     pcr->dbid = id;
                 }
                 else
@@ -14570,7 +15318,7 @@ bool MegaClient::fetchsc(DbTable* sctable)
                 break;
             case CACHEDSET:
             {
-                if (!fetchscset(&data, id))
+                if (!fetchscset(std::move(parsed[i].set), id))
                 {
                     return false;
                 }
@@ -14579,15 +15327,16 @@ bool MegaClient::fetchsc(DbTable* sctable)
 
             case CACHEDSETELEMENT:
             {
-                if (!fetchscsetelement(&data, id))
+                if (!fetchscsetelement(std::move(parsed[i].element), id))
                 {
                     return false;
                 }
                 break;
             }
         }
-        hasNext = sctable->next(&id, &data, &key);
     }
+    records.clear();
+    parsed.clear();
 
     LOG_debug << "Max dbId after resume session: " << id;
 
@@ -14673,6 +15422,18 @@ bool MegaClient::fetchStatusTable(DbTable* table)
                 }
                 break;
             }
+            case CACHEDCONTENTHASH:
+            {
+                auto entry = CachedContentHash::unserialize(data);
+                if (!entry)
+                {
+                    LOG_err << "Failed - content hash record read error";
+                    return false;
+                }
+                entry->dbid = id;
+                mContentHashIndex.load(std::move(entry));
+                break;
+            }
         }
         hasNext = table->next(&id, &data, &key);
     }
@@ -14778,6 +15539,7 @@ void MegaClient::enabletransferresumption(const char *loggedoutid)
     {
         return;
     }
+    tctable->setGroupCommit(DB_GROUP_COMMIT_DELAY, DB_GROUP_COMMIT_MAX_COMMITS);
 
     uint32_t id;
     string data;
@@ -14973,6 +15735,27 @@ bool MegaClient::accountShouldBeReloadedOrRestarted() const
     return mLastErrorDetected != REASON_ERROR_NO_ERROR;
 }
 
+void MegaClient::reloadFromServers()
+{
+    // Stop the sc channel to prevent the reception of multiple
+    // API_ETOOMANY errors causing multiple consecutive reloads
+    scsn.stopScsn();
+
+    app->reloading();
+    int creqtag = reqtag;
+    reqtag = fetchnodestag; // associate with ongoing request, if any
+    fetchingnodes = false;
+    fetchnodestag = 0;
+
+    // reloading mid-session so we definitely go to the servers
+    // the node tree will be replaced when the reply arrives
+    // actionpacketsCurrent will be reset at that time
+    // nocache = true so that we get to an equal or later SCSN
+    // right away.  The ir:1 mechanism is not reliable for this
+    fetchnodes(true, false, true);
+    reqtag = creqtag;
+}
+
 void MegaClient::fetchnodes(bool nocache, bool loadSyncs, bool forceLoadFromServers)
 {
     if (fetchingnodes)
@@ -15034,6 +15817,8 @@ void MegaClient::fetchnodes(bool nocache, bool loadSyncs, bool forceLoadFromServ
 
             statecurrent = false;
             pendingsccommit = false;
+            mCatchUpActionPackets = 0;
+            mCatchUpReload = false;
 
             // allow sc requests to start
             scsn.setScsn(cachedscsn);
@@ -16323,6 +17108,15 @@ void MegaClient::pread(Node* n, m_off_t offset, m_off_t count, void* appdata)
               offset, count, appdata);
 }
 
+// request direct read by node pointer, for a reader that takes the data itself
+void MegaClient::pread(Node* n, m_off_t offset, m_off_t count, std::unique_ptr<DirectReadConsumer> consumer)
+{
+    void* appdata = consumer.get();
+    queueread(n->nodehandle, true, n->nodecipher(),
+              MemAccess::get<int64_t>((const char*)n->nodekey().data() + SymmCipher::KEYLENGTH),
+              offset, count, appdata, nullptr, nullptr, nullptr, std::move(consumer));
+}
+
 // request direct read by exported handle / key
 void MegaClient::pread(handle ph, SymmCipher* key, int64_t ctriv, m_off_t offset, m_off_t count, void* appdata, bool isforeign, const char *privauth, const char *pubauth, const char *cauth)
 {
@@ -16343,12 +17137,39 @@ bool MegaClient::isprivatehandle(handle* hp)
     return ((char*)hp)[NODEHANDLE] != 0;
 }
 
-void MegaClient::queueread(handle h, bool p, SymmCipher* key, int64_t ctriv, m_off_t offset, m_off_t count, void* appdata, const char* privauth, const char *pubauth, const char *cauth)
+void MegaClient::queueread(handle h, bool p, SymmCipher* key, int64_t ctriv, m_off_t offset, m_off_t count, void* appdata, const char* privauth, const char *pubauth, const char *cauth, std::unique_ptr<DirectReadConsumer> consumer)
 {
     handledrn_map::iterator it;
 
     encodehandletype(&h, p);
 
+    // deliver what earlier reads left in the cache, only the rest needs fetching
+    m_off_t servedFromCache = 0;
+    while (count > 0 && mStreamingCache.enabled())
+    {
+        const string* block = mStreamingCache.find(h, ctriv, offset);
+        m_off_t blockPos = offset - offset % StreamingCache::BLOCKSIZE;
+        if (!block || blockPos + m_off_t(block->size()) <= offset)
+        {
+            break;
+        }
+
+        m_off_t len = std::min(count, blockPos + m_off_t(block->size()) - offset);
+        LOG_verbose << "Streaming " << len << " bytes at " << offset << " from the cache";
+        byte* data = (byte*)block->data() + (offset - blockPos);
+        bool more = consumer ? consumer->data(data, len, offset)
+                             : app->pread_data(data, len, offset, 0, 0, appdata);
+        offset += len;
+        count -= len;
+        servedFromCache += len;
+
+        if (!more || !count)
+        {
+            // finished (or cancelled by the app)
+            return;
+        }
+    }
+
     it = hdrns.find(h);
 
     if (it == hdrns.end())
@@ -16356,12 +17177,13 @@ void MegaClient::queueread(handle h, bool p, SymmCipher* key, int64_t ctriv, m_o
         // this handle is not being accessed yet: insert
         it = hdrns.insert(hdrns.end(), pair<handle, DirectReadNode*>(h, new DirectReadNode(this, h, p, key, ctriv, privauth, pubauth, cauth)));
         it->second->hdrn_it = it;
-        it->second->enqueue(offset, count, reqtag, appdata);
+        DirectRead* dr = it->second->enqueue(offset, count, reqtag, appdata, std::move(consumer));
+        dr->servedFromCache = servedFromCache;
 
         if (overquotauntil && overquotauntil > Waiter::ds)
         {
             dstime timeleft = dstime(overquotauntil - Waiter::ds);
-            app->pread_failure(API_EOVERQUOTA, 0, appdata, timeleft);
+            dr->failure(API_EOVERQUOTA, 0, timeleft);
             it->second->schedule(timeleft);
         }
         else
@@ -16371,11 +17193,12 @@ void MegaClient::queueread(handle h, bool p, SymmCipher* key, int64_t ctriv, m_o
     }
     else
     {
-        it->second->enqueue(offset, count, reqtag, appdata);
+        DirectRead* dr = it->second->enqueue(offset, count, reqtag, appdata, std::move(consumer));
+        dr->servedFromCache = servedFromCache;
         if (overquotauntil && overquotauntil > Waiter::ds)
         {
             dstime timeleft = dstime(overquotauntil - Waiter::ds);
-            app->pread_failure(API_EOVERQUOTA, 0, appdata, timeleft);
+            dr->failure(API_EOVERQUOTA, 0, timeleft);
             it->second->schedule(timeleft);
         }
     }
@@ -16422,9 +17245,12 @@ void MegaClient::abortreads(handle h, bool p, m_off_t offset, m_off_t count)
 
         for (dr_list::iterator it = drn->reads.begin(); it != drn->reads.end(); )
         {
-            if ((offset < 0 || offset == (*it)->offset) && (count < 0 || count == (*it)->count))
+            // as requested, before any part was served from the cache
+            m_off_t readOffset = (*it)->offset - (*it)->servedFromCache;
+            m_off_t readCount = (*it)->count + (*it)->servedFromCache;
+            if ((offset < 0 || offset == readOffset) && (count < 0 || count == readCount))
             {
-                app->pread_failure(API_EINCOMPLETE, (*it)->drn->retries, (*it)->appdata, 0);
+                (*it)->failure(API_EINCOMPLETE, (*it)->drn->retries, 0);
 
                 delete *(it++);
             }
@@ -19088,6 +19914,27 @@ const char* MegaClient::cancelLinkPrefix()
     return prefix;
 }
 
+MegaClient::Metrics::Metrics()
+    : labels([]()
+      {
+          static std::atomic<unsigned> nextClient{0};
+          return "client=\"" + std::to_string(nextClient++) + "\"";
+      }())
+    , transfersStarted("mega_transfers_started_total", "Transfers dispatched to a slot", labels)
+    , transfersFinished("mega_transfers_finished_total", "Transfers completed by their slot", labels)
+    , transferTemporaryErrors("mega_transfer_temporary_errors_total", "Transfer failures to be retried", labels)
+    , transferFailures("mega_transfer_failures_total", "Transfers failed for good", labels)
+    , csRequestsInFlight("mega_cs_requests_in_flight", "API request batches awaiting their response", labels)
+    , csRequestMilliseconds("mega_cs_request_milliseconds", "Time from posting an API request batch to its response", labels)
+    , registration({&transfersStarted,
+                    &transfersFinished,
+                    &transferTemporaryErrors,
+                    &transferFailures,
+                    &csRequestsInFlight,
+                    &csRequestMilliseconds})
+{
+}
+
 #ifdef MEGA_MEASURE_CODE
 
 extern CodeCounter::ScopeStats computeSyncSequencesStats;
@@ -19132,6 +19979,10 @@ std::string MegaClient::PerformanceStats::report(bool reset, HttpIO* httpio, Wai
         << " transfers active time: " << transfersActiveTime.report(reset) << "\n"
         << " transfer starts/finishes: " << transferStarts << " " << transferFinishes << "\n"
         << " transfer temperror/fails: " << transferTempErrors << " " << transferFails << "\n"
+        << " applyKeys nodes serial/parallel: " << applyKeysSerial << "/" << applyKeysParallel << " batches: " << applyKeysBatches << "\n"
+        << " fetchnodes keys serial/parallel: " << fetchnodesKeysSerial << "/" << fetchnodesKeysParallel << " batches: " << fetchnodesKeysBatches << "\n"
+        << " fingerprint filter DB look-ups skipped/false positives/found: " << fingerprintFilterNegatives << "/" << fingerprintFilterFalsePositives << "/" << fingerprintFilterPositives << "\n"
+        << TransferBufferPool::instance().report(reset) << "\n"
         << " nowait reason: immedate: " << prepwaitImmediate << " zero: " << prepwaitZero << " httpio: " << prepwaitHttpio << " fsaccess: " << prepwaitFsaccess << " nonzero waits: " << nonzeroWait << "\n";
     if (auto curlhttpio = dynamic_cast<CurlHttpIO*>(httpio))
     {
@@ -19143,7 +19994,8 @@ std::string MegaClient::PerformanceStats::report(bool reset, HttpIO* httpio, Wai
 #ifdef MEGA_USE_C_ARES
             << curlhttpio->countProcessAresEventsCode.report(reset) << "\n"
 #endif
-            << curlhttpio->countProcessCurlEventsCode.report(reset) << "\n";
+            << curlhttpio->countProcessCurlEventsCode.report(reset) << "\n"
+            << curlhttpio->connectionStatsReport(reset);
     }
 #ifdef WIN32
     s << " waiter nonzero timeout: " << static_cast<WinWaiter*>(waiter)->performanceStats.waitTimedoutNonzero
@@ -19155,6 +20007,7 @@ std::string MegaClient::PerformanceStats::report(bool reset, HttpIO* httpio, Wai
     {
         transferStarts = transferFinishes = transferTempErrors = transferFails = 0;
         prepwaitImmediate = prepwaitZero = prepwaitHttpio = prepwaitFsaccess = nonzeroWait = 0;
+        fingerprintFilterNegatives = fingerprintFilterFalsePositives = fingerprintFilterPositives = 0;
     }
     return s.str();
 }
@@ -19358,7 +20211,55 @@ void MegaClient::putSetElements(vector<SetElement>&& els, std::function<void(Err
         }
     }
 
-    reqs.add(new CommandPutSetElements(this, std::move(els), std::move(encrDetails), completion));
+    if (els.size() <= SET_ELEMENTS_PER_COMMAND)
+    {
+        reqs.add(new CommandPutSetElements(this, std::move(els), std::move(encrDetails), completion));
+        return;
+    }
+
+    // the commands are processed in order, so the results are appended in the order of 'els'
+    struct Results
+    {
+        size_t pending = 0;
+        Error e = API_OK;
+        vector<const SetElement*> added;
+        vector<int64_t> errs;
+    };
+    auto results = std::make_shared<Results>();
+    results->pending = (els.size() + SET_ELEMENTS_PER_COMMAND - 1) / SET_ELEMENTS_PER_COMMAND;
+    results->errs.reserve(els.size());
+
+    auto chunkCompletion = [results, completion](Error e, const vector<const SetElement*>* added, const vector<int64_t>* errs)
+    {
+        if (e != API_OK && results->e == API_OK)
+        {
+            results->e = e;
+        }
+        if (added)
+        {
+            results->added.insert(results->added.end(), added->begin(), added->end());
+        }
+        if (errs)
+        {
+            results->errs.insert(results->errs.end(), errs->begin(), errs->end());
+        }
+
+        if (!--results->pending && completion)
+        {
+            bool failed = results->e != API_OK;
+            completion(results->e, failed ? nullptr : &results->added, failed ? nullptr : &results->errs);
+        }
+    };
+
+    for (size_t begin = 0; begin < els.size(); begin += SET_ELEMENTS_PER_COMMAND)
+    {
+        size_t end = std::min(begin + SET_ELEMENTS_PER_COMMAND, els.size());
+        vector<SetElement> chunk(std::make_move_iterator(els.begin() + static_cast<ptrdiff_t>(begin)),
+                                 std::make_move_iterator(els.begin() + static_cast<ptrdiff_t>(end)));
+        vector<StringPair> chunkDetails(std::make_move_iterator(encrDetails.begin() + static_cast<ptrdiff_t>(begin)),
+                                        std::make_move_iterator(encrDetails.begin() + static_cast<ptrdiff_t>(end)));
+        reqs.add(new CommandPutSetElements(this, std::move(chunk), std::move(chunkDetails), chunkCompletion));
+    }
 }
 
 
@@ -19467,7 +20368,45 @@ void MegaClient::removeSetElements(handle sid, vector<handle>&& eids, std::funct
     // Do not validate Element ids here. Let the API return error for invalid ones,
     // to allow valid ones to be removed.
 
-    reqs.add(new CommandRemoveSetElements(this, sid, std::move(eids), completion));
+    if (eids.size() <= SET_ELEMENTS_PER_COMMAND)
+    {
+        reqs.add(new CommandRemoveSetElements(this, sid, std::move(eids), completion));
+        return;
+    }
+
+    struct Results
+    {
+        size_t pending = 0;
+        Error e = API_OK;
+        vector<int64_t> errs;
+    };
+    auto results = std::make_shared<Results>();
+    results->pending = (eids.size() + SET_ELEMENTS_PER_COMMAND - 1) / SET_ELEMENTS_PER_COMMAND;
+    results->errs.reserve(eids.size());
+
+    auto chunkCompletion = [results, completion](Error e, const vector<int64_t>* errs)
+    {
+        if (e != API_OK && results->e == API_OK)
+        {
+            results->e = e;
+        }
+        if (errs)
+        {
+            results->errs.insert(results->errs.end(), errs->begin(), errs->end());
+        }
+
+        if (!--results->pending && completion)
+        {
+            completion(results->e, results->e != API_OK ? nullptr : &results->errs);
+        }
+    };
+
+    for (size_t begin = 0; begin < eids.size(); begin += SET_ELEMENTS_PER_COMMAND)
+    {
+        size_t end = std::min(begin + SET_ELEMENTS_PER_COMMAND, eids.size());
+        vector<handle> chunk(eids.begin() + static_cast<ptrdiff_t>(begin), eids.begin() + static_cast<ptrdiff_t>(end));
+        reqs.add(new CommandRemoveSetElements(this, sid, std::move(chunk), chunkCompletion));
+    }
 }
 
 void MegaClient::removeSetElement(handle sid, handle eid, std::function<void(Error)> completion)
@@ -20708,9 +21647,8 @@ bool MegaClient::initscsetelements()
     return true;
 }
 
-bool MegaClient::fetchscset(string* data, uint32_t id)
+bool MegaClient::fetchscset(unique_ptr<Set> s, uint32_t id)
 {
-    auto s = Set::unserialize(data);
     if (!s)
     {
         LOG_err << "Failed - Set record read error";
@@ -20727,9 +21665,8 @@ bool MegaClient::fetchscset(string* data, uint32_t id)
     return true;
 }
 
-bool MegaClient::fetchscsetelement(string* data, uint32_t id)
+bool MegaClient::fetchscsetelement(unique_ptr<SetElement> el, uint32_t id)
 {
-    auto el = SetElement::unserialize(data);
     if (!el)
     {
         LOG_err << "Failed - SetElement record read error";
@@ -20902,13 +21839,9 @@ void MegaClient::notifypurgesetelements()
 
 void MegaClient::clearsetelementnotify(handle sid)
 {
-    for (size_t i = setelementnotify.size(); i; --i)
-    {
-        if (setelementnotify[i - 1]->set() == sid)
-        {
-            setelementnotify.erase(setelementnotify.begin() + i - 1);
-        }
-    }
+    // a single pass: a removed Set can take a whole album of notified Elements with it
+    auto newEnd = std::remove_if(setelementnotify.begin(), setelementnotify.end(), [sid](const SetElement* e) { return e->set() == sid; });
+    setelementnotify.erase(newEnd, setelementnotify.end());
 }
 
 void MegaClient::setProFlexi(bool newProFlexi)
@@ -21109,9 +22042,64 @@ error MegaClient::createPasswordNode(const char* name, std::unique_ptr<AttrMap>
     return createPasswordNodes(std::move(aux), nParent, rTag);
 }
 
+namespace
+{
+// the state of a password import sent in several putnodes commands
+struct PasswordNodesImport
+{
+    NodeHandle parent;
+    vector<NewNode> pending;
+    size_t next = 0;
+    vector<NewNode> created;
+    std::function<void(size_t, size_t)> progress;
+};
+
+// sends the next chunk of nodes: the following one goes once this is done
+void putPasswordNodesChunk(MegaClient& client, int tag, std::shared_ptr<PasswordNodesImport> import)
+{
+    auto first = import->pending.begin() + static_cast<ptrdiff_t>(import->next);
+    import->next = std::min(import->pending.size(), import->next + MegaClient::PASSWORD_NODES_PER_COMMAND);
+    auto last = import->pending.begin() + static_cast<ptrdiff_t>(import->next);
+    vector<NewNode> chunk(std::make_move_iterator(first), std::make_move_iterator(last));
+
+    const char* cauth = nullptr;
+    const bool canChangeVault = true;
+    client.putnodes(import->parent,
+                    VersioningOption::NoVersioning,
+                    std::move(chunk),
+                    cauth,
+                    tag,
+                    canChangeVault,
+                    {},
+                    [&client, import](const Error& e,
+                                      targettype_t type,
+                                      vector<NewNode>& nn,
+                                      bool targetOverride,
+                                      int tag,
+                                      const map<string, string>& fileHandles)
+                    {
+                        if (e == API_OK)
+                        {
+                            std::move(nn.begin(), nn.end(), std::back_inserter(import->created));
+                            if (import->next < import->pending.size())
+                            {
+                                if (import->progress)
+                                {
+                                    import->progress(import->created.size(), import->pending.size());
+                                }
+                                putPasswordNodesChunk(client, tag, import);
+                                return;
+                            }
+                        }
+                        client.app->putnodes_result(e, type, import->created, targetOverride, tag, fileHandles);
+                    });
+}
+}
+
 error MegaClient::createPasswordNodes(const std::map<std::string, std::unique_ptr<AttrMap>>& data,
                                       std::shared_ptr<Node> nParent,
-                                      int rTag)
+                                      int rTag,
+                                      std::function<void(size_t, size_t)> progress)
 {
     assert(nParent);
     if (!nParent->isPasswordNodeFolder())
@@ -21149,6 +22137,17 @@ error MegaClient::createPasswordNodes(const std::map<std::string, std::unique_pt
         NewNode& newPasswordNode = nn[nodeToFillIndex++];
         putnodes_prepareOneFolder(&newPasswordNode, name, canChangeVault, addAttrs);
     }
+
+    if (nn.size() > PASSWORD_NODES_PER_COMMAND)
+    {
+        auto import = std::make_shared<PasswordNodesImport>();
+        import->parent = nParent->nodeHandle();
+        import->pending = std::move(nn);
+        import->progress = std::move(progress);
+        putPasswordNodesChunk(*this, rTag, std::move(import));
+        return API_OK;
+    }
+
     const char* cauth = nullptr;
     putnodes(nParent->nodeHandle(),
              VersioningOption::NoVersioning,
@@ -21174,36 +22173,42 @@ std::pair<MegaClient::BadPasswordData, MegaClient::ValidPasswordData>
                                         ncoll::NameCollisionSolver& nameValidator)
 {
     std::pair<BadPasswordData, ValidPasswordData> result;
-    auto& bad = result.first;
-    auto& good = result.second;
     for (auto& entry: entries)
     {
-        if (entry.mErrCode != pwm::import::PassEntryParseResult::ErrCode::OK)
-        {
-            bad[std::move(entry.mOriginalContent)] = PasswordEntryError::PARSE_ERROR;
-            continue;
-        }
+        validatePasswordEntry(std::move(entry), nameValidator, result.first, result.second);
+    }
+    return result;
+}
 
-        auto attrMap = std::make_unique<AttrMap>();
-        auto addField = [&attrMap](std::string&& field, const char* const fieldKey)
-        {
-            if (!field.empty())
-                attrMap->map[AttrMap::string2nameid(fieldKey)] = std::move(field);
-        };
-        addField(std::move(entry.mUrl), PWM_ATTR_PASSWORD_URL);
-        addField(std::move(entry.mUserName), PWM_ATTR_PASSWORD_USERNAME);
-        addField(std::move(entry.mPassword), PWM_ATTR_PASSWORD_PWD);
-        addField(std::move(entry.mNote), PWM_ATTR_PASSWORD_NOTES);
+void MegaClient::validatePasswordEntry(pwm::import::PassEntryParseResult&& entry,
+                                       ncoll::NameCollisionSolver& nameValidator,
+                                       BadPasswordData& bad,
+                                       ValidPasswordData& good)
+{
+    if (entry.mErrCode != pwm::import::PassEntryParseResult::ErrCode::OK)
+    {
+        bad[std::move(entry.mOriginalContent)] = PasswordEntryError::PARSE_ERROR;
+        return;
+    }
 
-        if (auto validationError = validatePasswordData(*attrMap);
-            validationError != PasswordEntryError::OK)
-        {
-            bad[entry.mOriginalContent] = validationError;
-            continue;
-        }
-        good[nameValidator(entry.mName)] = std::move(attrMap);
+    auto attrMap = std::make_unique<AttrMap>();
+    auto addField = [&attrMap](std::string&& field, const char* const fieldKey)
+    {
+        if (!field.empty())
+            attrMap->map[AttrMap::string2nameid(fieldKey)] = std::move(field);
+    };
+    addField(std::move(entry.mUrl), PWM_ATTR_PASSWORD_URL);
+    addField(std::move(entry.mUserName), PWM_ATTR_PASSWORD_USERNAME);
+    addField(std::move(entry.mPassword), PWM_ATTR_PASSWORD_PWD);
+    addField(std::move(entry.mNote), PWM_ATTR_PASSWORD_NOTES);
+
+    if (auto validationError = validatePasswordData(*attrMap);
+        validationError != PasswordEntryError::OK)
+    {
+        bad[entry.mOriginalContent] = validationError;
+        return;
     }
-    return result;
+    good[nameValidator(entry.mName)] = std::move(attrMap);
 }
 
 error MegaClient::updatePasswordNode(NodeHandle nh, std::unique_ptr<AttrMap> newData,
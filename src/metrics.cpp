@@ -0,0 +1,271 @@
+/**
+ * @file metrics.cpp
+ * @brief Counters, gauges and histograms exported by the SDK's modules
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace mega {
+
+Metric::Metric(Type type, string name, string help, string labels)
+    : mType(type)
+    , mName(std::move(name))
+    , mHelp(std::move(help))
+    , mLabels(std::move(labels))
+{
+}
+
+MetricCounter::MetricCounter(string name, string help, string labels)
+    : Metric(Type::COUNTER, std::move(name), std::move(help), std::move(labels))
+{
+}
+
+MetricGauge::MetricGauge(string name, string help, string labels)
+    : Metric(Type::GAUGE, std::move(name), std::move(help), std::move(labels))
+{
+}
+
+constexpr unsigned MetricHistogram::SUB_BUCKET_BITS;
+constexpr unsigned MetricHistogram::SUB_BUCKETS;
+constexpr unsigned MetricHistogram::MAX_EXPONENT;
+constexpr size_t MetricHistogram::BUCKETS;
+
+MetricHistogram::MetricHistogram(string name, string help, string labels)
+    : Metric(Type::HISTOGRAM, std::move(name), std::move(help), std::move(labels))
+    , mBuckets(new std::atomic<uint64_t>[BUCKETS])
+{
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+        mBuckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t MetricHistogram::bucketOf(uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+    {
+        return static_cast<size_t>(value);
+    }
+
+    if (value >> MAX_EXPONENT)
+    {
+        return BUCKETS - 1;
+    }
+
+    unsigned exponent = 0;
+    for (uint64_t v = value; v >>= 1; )
+    {
+        ++exponent;
+    }
+
+    // the bits after the leading one pick the sub-bucket
+    unsigned shift = exponent - SUB_BUCKET_BITS;
+    size_t sub = static_cast<size_t>(value >> shift) - SUB_BUCKETS;
+    return SUB_BUCKETS + shift * SUB_BUCKETS + sub;
+}
+
+uint64_t MetricHistogram::bucketLimit(size_t bucket)
+{
+    if (bucket < SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    size_t shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+    size_t sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+    uint64_t lowest = uint64_t(SUB_BUCKETS + sub) << shift;
+    return lowest + (uint64_t(1) << shift) - 1;
+}
+
+void MetricHistogram::record(uint64_t value)
+{
+    mBuckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    mSum.fetch_add(value, std::memory_order_relaxed);
+}
+
+MetricHistogram::Snapshot MetricHistogram::snapshot() const
+{
+    Snapshot s;
+    s.buckets.resize(BUCKETS);
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+        s.buckets[i] = mBuckets[i].load(std::memory_order_relaxed);
+        s.count += s.buckets[i];
+    }
+    s.sum = mSum.load(std::memory_order_relaxed);
+    return s;
+}
+
+uint64_t MetricHistogram::Snapshot::quantile(double fraction) const
+{
+    if (!count)
+    {
+        return 0;
+    }
+
+    auto target = static_cast<uint64_t>(std::ceil(std::min(std::max(fraction, 0.0), 1.0) * static_cast<double>(count)));
+    target = std::max<uint64_t>(target, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i)
+    {
+        seen += buckets[i];
+        if (seen >= target)
+        {
+            return bucketLimit(i);
+        }
+    }
+    return bucketLimit(buckets.size() - 1);
+}
+
+uint64_t MetricHistogram::Snapshot::countUpTo(uint64_t value) const
+{
+    uint64_t n = 0;
+    for (size_t i = 0; i < buckets.size() && bucketLimit(i) <= value; ++i)
+    {
+        n += buckets[i];
+    }
+    return n;
+}
+
+MetricsRegistry& MetricsRegistry::instance()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+void MetricsRegistry::add(const Metric* metric)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+
+    // by name, so the instances of each metric are exported together
+    auto it = std::upper_bound(mMetrics.begin(), mMetrics.end(), metric, [](const Metric* a, const Metric* b)
+                               {
+                                   return a->name() < b->name();
+                               });
+    mMetrics.insert(it, metric);
+}
+
+void MetricsRegistry::remove(const Metric* metric)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    mMetrics.erase(std::remove(mMetrics.begin(), mMetrics.end(), metric), mMetrics.end());
+}
+
+void MetricsRegistry::visit(std::function<void(const Metric&)> visitor) const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    for (auto metric : mMetrics)
+    {
+        visitor(*metric);
+    }
+}
+
+namespace {
+
+// the sample's name and labels, with one more label for histogram buckets
+void exportSample(std::ostringstream& out, const string& name, const string& labels, const string& extra = string())
+{
+    out << name;
+    if (!labels.empty() || !extra.empty())
+    {
+        out << '{' << labels << (!labels.empty() && !extra.empty() ? "," : "") << extra << '}';
+    }
+    out << ' ';
+}
+
+} // namespace
+
+string MetricsRegistry::exportText() const
+{
+    std::ostringstream out;
+    const string* family = nullptr;
+
+    visit([&](const Metric& metric)
+    {
+        if (!family || *family != metric.name())
+        {
+            family = &metric.name();
+
+            static const char* types[] = {"counter", "gauge", "histogram"};
+            out << "# HELP " << metric.name() << ' ' << metric.help() << '\n'
+                << "# TYPE " << metric.name() << ' ' << types[static_cast<int>(metric.type())] << '\n';
+        }
+
+        switch (metric.type())
+        {
+        case Metric::Type::COUNTER:
+            exportSample(out, metric.name(), metric.labels());
+            out << static_cast<const MetricCounter&>(metric).value() << '\n';
+            break;
+
+        case Metric::Type::GAUGE:
+            exportSample(out, metric.name(), metric.labels());
+            out << static_cast<const MetricGauge&>(metric).value() << '\n';
+            break;
+
+        case Metric::Type::HISTOGRAM:
+        {
+            auto s = static_cast<const MetricHistogram&>(metric).snapshot();
+            const string bucket = metric.name() + "_bucket";
+
+            for (unsigned exponent = 0; exponent < MetricHistogram::MAX_EXPONENT; ++exponent)
+            {
+                uint64_t limit = (uint64_t(1) << exponent) - 1;
+                exportSample(out, bucket, metric.labels(), "le=\"" + std::to_string(limit) + "\"");
+                out << s.countUpTo(limit) << '\n';
+            }
+            exportSample(out, bucket, metric.labels(), "le=\"+Inf\"");
+            out << s.count << '\n';
+
+            exportSample(out, metric.name() + "_sum", metric.labels());
+            out << s.sum << '\n';
+            exportSample(out, metric.name() + "_count", metric.labels());
+            out << s.count << '\n';
+            break;
+        }
+        }
+    });
+
+    return out.str();
+}
+
+MetricsRegistration::MetricsRegistration(std::initializer_list<const Metric*> metrics, MetricsRegistry& registry)
+    : mRegistry(registry)
+    , mMetrics(metrics)
+{
+    for (auto metric : mMetrics)
+    {
+        mRegistry.add(metric);
+    }
+}
+
+MetricsRegistration::~MetricsRegistration()
+{
+    for (auto metric : mMetrics)
+    {
+        mRegistry.remove(metric);
+    }
+}
+
+} // namespace
@@ -12,6 +12,12 @@ std::tuple<std::string, ENameType, nameId_t> getBaseNameKindId(const std::string
 {
     static const std::regex pattern(R"(^(.*?)(\ ?)\((\d+)\)$)");
 
+    // most names don't end in "(n)": no need to run the regex over them
+    if (input.size() < 3 || input.back() != ')')
+    {
+        return {input, ENameType::baseNameOnly, 0};
+    }
+
     if (std::smatch matches; std::regex_match(input, matches, pattern) && matches[1].matched &&
                              matches[2].matched && matches[3].matched)
     {
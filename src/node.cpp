@@ -522,6 +522,30 @@ void Node::setkey(const byte* newkey)
     setattr();
 }
 
+uint64_t Node::changedMask() const
+{
+    uint64_t mask = 0;
+    if (changed.removed) mask |= CHANGED_REMOVED;
+    if (changed.attrs) mask |= CHANGED_ATTRS;
+    if (changed.owner) mask |= CHANGED_OWNER;
+    if (changed.ctime) mask |= CHANGED_CTIME;
+    if (changed.fileattrstring) mask |= CHANGED_FILEATTRSTRING;
+    if (changed.inshare) mask |= CHANGED_INSHARE;
+    if (changed.outshares) mask |= CHANGED_OUTSHARES;
+    if (changed.parent) mask |= CHANGED_PARENT;
+    if (changed.pendingshares) mask |= CHANGED_PENDINGSHARES;
+    if (changed.publiclink) mask |= CHANGED_PUBLICLINK;
+    if (changed.newnode) mask |= CHANGED_NEWNODE;
+    if (changed.name) mask |= CHANGED_NAME;
+    if (changed.favourite) mask |= CHANGED_FAVOURITE;
+    if (changed.counter) mask |= CHANGED_COUNTER;
+    if (changed.sensitive) mask |= CHANGED_SENSITIVE;
+    if (changed.pwd) mask |= CHANGED_PWD;
+    if (changed.description) mask |= CHANGED_DESCRIPTION;
+    if (changed.tags) mask |= CHANGED_TAGS;
+    return mask;
+}
+
 // set the node key (encrypted or decrypted)
 void Node::setKey(const string& key)
 {
@@ -795,32 +819,38 @@ void Node::setattr()
 
     if (attrstring && (cipher = nodecipher()) && (buf = decryptattr(cipher, attrstring->c_str(), attrstring->size())))
     {
-        AttrMap oldAttrs(attrs);
-        attrs.map.clear();
-        attrs.fromjson(reinterpret_cast<char*>(buf) + 5);
+        setattr(buf);
+    }
+}
 
-        auto it = attrs.map.find('n');
-        if (it != std::end(attrs.map)) LocalPath::utf8_normalize(&it->second);
+// build attribute hash from the already decrypted attrstring (takes ownership of buf)
+void Node::setattr(byte* buf)
+{
+    AttrMap oldAttrs(attrs);
+    attrs.map.clear();
+    attrs.fromjson(reinterpret_cast<char*>(buf) + 5);
 
-        changed.name = attrs.hasDifferentValue('n', oldAttrs.map);
-        changed.favourite = attrs.hasDifferentValue(AttrMap::string2nameid("fav"), oldAttrs.map);
-        changed.sensitive = attrs.hasDifferentValue(AttrMap::string2nameid("sen"), oldAttrs.map);
+    auto it = attrs.map.find('n');
+    if (it != std::end(attrs.map)) LocalPath::utf8_normalize(&it->second);
 
-        const auto pwdNameid = AttrMap::string2nameid(MegaClient::NODE_ATTR_PASSWORD_MANAGER);
-        changed.pwd = attrs.hasDifferentValue(pwdNameid, oldAttrs.map);
+    changed.name = attrs.hasDifferentValue('n', oldAttrs.map);
+    changed.favourite = attrs.hasDifferentValue(AttrMap::string2nameid("fav"), oldAttrs.map);
+    changed.sensitive = attrs.hasDifferentValue(AttrMap::string2nameid("sen"), oldAttrs.map);
 
-        const auto descriptionNameid = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION);
-        changed.description = attrs.hasDifferentValue(descriptionNameid, oldAttrs.map);
+    const auto pwdNameid = AttrMap::string2nameid(MegaClient::NODE_ATTR_PASSWORD_MANAGER);
+    changed.pwd = attrs.hasDifferentValue(pwdNameid, oldAttrs.map);
 
-        const auto tagsNameid = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS);
-        changed.tags = attrs.hasDifferentValue(tagsNameid, oldAttrs.map);
+    const auto descriptionNameid = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION);
+    changed.description = attrs.hasDifferentValue(descriptionNameid, oldAttrs.map);
 
-        setfingerprint();
+    const auto tagsNameid = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS);
+    changed.tags = attrs.hasDifferentValue(tagsNameid, oldAttrs.map);
 
-        delete[] buf;
+    setfingerprint();
 
-        attrstring.reset();
-    }
+    delete[] buf;
+
+    attrstring.reset();
 }
 
 nameid Node::sdsId()
@@ -1122,24 +1152,16 @@ int Node::hasfileattribute(const string *fileattrstring, fatype t)
 }
 
 // attempt to apply node key - sets nodekey to a raw key if successful
-bool Node::applykey()
+// locate the node key that can be decrypted with the keys available (sc): the personal key
+// or a subkey for one of the shares the node is in. Returns nullptr if no suitable key is
+// available yet (it might arrive soon)
+const char* Node::locateDecryptableKey(SymmCipher*& sc, bool& foreign)
 {
-    if (type > FOLDERNODE)
-    {
-        //Root nodes contain an empty attrstring
-        attrstring.reset();
-    }
-
-    if (keyApplied() || !nodekeydata.size())
-    {
-        return false;
-    }
-
     int l = -1;
     size_t t = 0;
     handle h;
-    const char* k = NULL;
-    SymmCipher* sc = &client->key;
+    sc = &client->key;
+    foreign = false;
     handle me = client->loggedIntoFolder() ? client->mNodeManager.getRootNodeFiles().as8byte() : client->me;
 
     while ((t = nodekeydata.find_first_of(':', t)) != string::npos)
@@ -1196,51 +1218,179 @@ bool Node::applykey()
                 }
 
                 // this key will be rewritten when the node leaves the outbound share
-                foreignkey = true;
+                foreign = true;
             }
         }
 
-        k = nodekeydata.c_str() + t;
-        break;
+        return nodekeydata.c_str() + t;
     }
 
     // no: found => personal key, use directly
-    // otherwise, no suitable key available yet - bail (it might arrive soon)
+    return (l < 0) ? nodekeydata.c_str() : nullptr;
+}
+
+bool Node::applykey()
+{
+    if (type > FOLDERNODE)
+    {
+        //Root nodes contain an empty attrstring
+        attrstring.reset();
+    }
+
+    if (keyApplied() || !nodekeydata.size())
+    {
+        return false;
+    }
+
+    SymmCipher* sc = nullptr;
+    bool foreign = false;
+    const char* k = locateDecryptableKey(sc, foreign);
+    if (!k)
+    {
+        return false;
+    }
+
+    if (foreign)
+    {
+        foreignkey = true;
+    }
+
+    byte key[FILENODEKEYLENGTH];
+    unsigned keylength = (type == FILENODE) ? FILENODEKEYLENGTH : FOLDERNODEKEYLENGTH;
+
+    if (client->decryptkey(k, key, static_cast<int>(keylength), sc, 0, nodehandle))
+    {
+        setDecryptedKey(key, keylength, nullptr);
+    }
+
+    return checkKeyApplied();
+}
+
+bool Node::prepareKeyDecryption(KeyDecryption& kd)
+{
+    if (type > FOLDERNODE || keyApplied() || !nodekeydata.size())
+    {
+        return false;
+    }
+
+    SymmCipher* sc = nullptr;
+    const char* k = locateDecryptableKey(sc, kd.foreign);
     if (!k)
     {
-        if (l < 0)
+        return false;
+    }
+
+    // RSA-encrypted keys need the client's private key (see MegaClient::decryptkey())
+    size_t keyLen = strcspn(k, "\"/");
+    if (keyLen > 4 * FILENODEKEYLENGTH / 3 + 1)
+    {
+        if (!client->asymkey.isvalid(AsymmCipher::PRIVKEY))
         {
-            k = nodekeydata.c_str();
+            return false;
         }
-        else
+        kd.rsaKey = &client->asymkey;
+    }
+    else
+    {
+        memcpy(kd.cipherKey, sc->key, sizeof kd.cipherKey);
+    }
+
+    kd.encryptedKey.assign(k, keyLen);
+    kd.keyLength = (type == FILENODE) ? FILENODEKEYLENGTH : FOLDERNODEKEYLENGTH;
+    kd.attrString = attrstring.get();
+    return true;
+}
+
+void Node::KeyDecryption::decrypt(SymmCipher& cipher)
+{
+    if (rsaKey)
+    {
+        // same steps as MegaClient::decryptkey(), the costly part being the modular exponentiation
+        size_t bufLen = encryptedKey.size() / 4 * 3 + 3;
+        if (bufLen > 4096)
         {
-            return false;
+            return;
+        }
+
+        std::unique_ptr<byte[]> buf(new byte[bufLen]);
+        int l = Base64::atob(encryptedKey.c_str(), buf.get(), static_cast<int>(bufLen));
+        if (!rsaKey->decrypt(buf.get(), static_cast<size_t>(l), key, keyLength))
+        {
+            LOG_warn << "Corrupt or invalid RSA node key";
+            return;
+        }
+    }
+    else
+    {
+        if (Base64::atob(encryptedKey.c_str(), key, static_cast<int>(keyLength)) != static_cast<int>(keyLength))
+        {
+            LOG_warn << "Corrupt or invalid symmetric node key";
+            return;
         }
+
+        cipher.setkey(cipherKey);
+        cipher.ecb_decrypt(key, keyLength);
     }
+    keyDecrypted = true;
 
-    byte key[FILENODEKEYLENGTH];
-    unsigned keylength = (type == FILENODE) ? FILENODEKEYLENGTH : FOLDERNODEKEYLENGTH;
+    string nodeKey(reinterpret_cast<const char*>(key), keyLength);
+    if (attrString && cipher.setkey(&nodeKey))
+    {
+        attrs.reset(Node::decryptattr(&cipher, attrString->c_str(), attrString->size()));
+    }
+}
 
-    if (client->decryptkey(k, key, static_cast<int>(keylength), sc, 0, nodehandle))
+bool Node::finishKeyDecryption(KeyDecryption& kd)
+{
+    if (keyApplied())
+    {
+        return false;
+    }
+
+    if (kd.foreign)
+    {
+        foreignkey = true;
+    }
+
+    if (kd.keyDecrypted)
+    {
+        setDecryptedKey(kd.key, kd.keyLength, &kd.attrs);
+    }
+
+    return checkKeyApplied();
+}
+
+// 'decryptedAttrs' are the attributes already decrypted with 'key' (if nullptr, they are decrypted here)
+void Node::setDecryptedKey(const byte* key, unsigned keylength, std::unique_ptr<byte[]>* decryptedAttrs)
+{
+    std::string undecryptedKey = nodekeydata;
+    client->mAppliedKeyNodeCount++;
+    nodekeydata.assign((const char*)key, keylength);
+    if (!decryptedAttrs)
     {
-        std::string undecryptedKey = nodekeydata;
-        client->mAppliedKeyNodeCount++;
-        nodekeydata.assign((const char*)key, keylength);
         setattr();
-        if (attrstring)
+    }
+    else if (attrstring && *decryptedAttrs)
+    {
+        setattr(decryptedAttrs->release());
+    }
+
+    if (attrstring)
+    {
+        if (foreignkey)
         {
-            if (foreignkey)
-            {
-                // Decryption with a foreign share key failed.
-                // Restoring the undecrypted node key because an updated
-                // share key can be received later.
-                client->mAppliedKeyNodeCount--;
-                nodekeydata = undecryptedKey;
-            }
-            LOG_warn << "Failed to decrypt attributes for node: " << toNodeHandle(nodehandle);
+            // Decryption with a foreign share key failed.
+            // Restoring the undecrypted node key because an updated
+            // share key can be received later.
+            client->mAppliedKeyNodeCount--;
+            nodekeydata = undecryptedKey;
         }
+        LOG_warn << "Failed to decrypt attributes for node: " << toNodeHandle(nodehandle);
     }
+}
 
+bool Node::checkKeyApplied()
+{
     bool applied = keyApplied();
     if (!applied)
     {
@@ -1444,6 +1594,93 @@ bool Node::isPasswordNodeFolder() const
     return ((type == FOLDERNODE) && (nodeHandle() == nhBase || isAncestor(nhBase))) && !isPasswordNode();
 }
 
+// bytes allocated in the heap by a string (zero if it fits in the small-string buffer)
+static size_t heapSize(const string& s)
+{
+    static const size_t inlineCapacity = string().capacity();
+    return s.capacity() > inlineCapacity ? s.capacity() + 1 : 0;
+}
+
+// bytes allocated in the heap by one element of a node-based container (std::map, std::list):
+// the value plus the links and color/size bookkeeping of the node
+template<typename T>
+static constexpr size_t heapNodeSize()
+{
+    return sizeof(T) + 4 * sizeof(void*);
+}
+
+size_t Node::getMemoryFootprint() const
+{
+    size_t bytes = sizeof(Node);
+
+    bytes += heapSize(nodekeydata);
+    bytes += heapSize(fileattrstring);
+
+    if (attrstring)
+    {
+        bytes += sizeof(string) + heapSize(*attrstring);
+    }
+
+    bytes += attrs.map.capacity() * sizeof(attr_map::value_type);
+    for (const auto& attr : attrs.map)
+    {
+        bytes += heapSize(attr.second);
+    }
+
+    if (inshare)
+    {
+        bytes += sizeof(Share);
+    }
+
+    for (const share_map* shares : {outshares.get(), pendingshares.get()})
+    {
+        if (shares)
+        {
+            bytes += sizeof(share_map) + shares->size() * (heapNodeSize<share_map::value_type>() + sizeof(Share));
+        }
+    }
+
+    if (sharekey)
+    {
+        bytes += sizeof(SymmCipher);
+    }
+
+    if (plink)
+    {
+        bytes += sizeof(PublicLink) + heapSize(plink->mAuthKey);
+    }
+
+    return bytes;
+}
+
+void Node::shrinkToFit()
+{
+    nodekeydata.shrink_to_fit();
+    fileattrstring.shrink_to_fit();
+
+    attrs.map.shrink_to_fit();
+    for (auto& attr : attrs.map)
+    {
+        attr.second.shrink_to_fit();
+    }
+
+    if (plink)
+    {
+        plink->mAuthKey.shrink_to_fit();
+    }
+
+    // empty share containers are just overhead: their absence has the same meaning
+    if (outshares && outshares->empty())
+    {
+        outshares.reset();
+    }
+
+    if (pendingshares && pendingshares->empty())
+    {
+        pendingshares.reset();
+    }
+}
+
 
 bool NodeData::readComponents()
 {
@@ -1622,8 +1859,7 @@ bool NodeData::readComponents()
                 {
                     return false;
                 }
-                mShares.emplace_back(shareSize);
-                std::copy(ptr, ptr + shareSize, mShares.back().data());
+                mShares.emplace_back(ptr, shareSize);
             }
 
             ptr += shareSize;
@@ -1789,6 +2025,16 @@ handle NodeData::getHandle()
     return mHandle;
 }
 
+handle NodeData::getParentHandle()
+{
+    if (readFailed())
+    {
+        return UNDEF;
+    }
+
+    return mParentHandle;
+}
+
 std::unique_ptr<Node> NodeData::createNode(MegaClient& client, bool fromOldCache, std::list<std::unique_ptr<NewShare>>& ownNewshares)
 {
     assert(mComp == COMPONENT_ALL);
@@ -1798,13 +2044,14 @@ std::unique_ptr<Node> NodeData::createNode(MegaClient& client, bool fromOldCache
     }
 
     unique_ptr<Node> n = std::make_unique<Node>(client, NodeHandle().set6byte(mHandle), NodeHandle().set6byte(mParentHandle),
-                                                 mType, mSize, mUserHandle, mFileAttributes.c_str(), mCtime);
+                                                 mType, mSize, mUserHandle, nullptr, mCtime);
+    n->fileattrstring = std::move(mFileAttributes);
 
     // read inshare, outshares, or pending shares
     for (const auto& s : mShares)
     {
-        const char* ptr = s.data();
-        NewShare* newShare = Share::unserialize(mShareDirection, mHandle, mShareKey.get(), &ptr, ptr + s.size());
+        const char* ptr = s.first;
+        NewShare* newShare = Share::unserialize(mShareDirection, mHandle, mShareKey.get(), &ptr, ptr + s.second);
 
         if (!newShare)
         {
@@ -1825,7 +2072,7 @@ std::unique_ptr<Node> NodeData::createNode(MegaClient& client, bool fromOldCache
         }
     }
 
-    n->attrs = mAttrs;
+    n->attrs = std::move(mAttrs);
 
     if (fromOldCache)
     {
@@ -1848,7 +2095,7 @@ std::unique_ptr<Node> NodeData::createNode(MegaClient& client, bool fromOldCache
 
     if (mIsEncrypted)
     {
-        n->attrstring.reset(new string(mAttrString));
+        n->attrstring.reset(new string(std::move(mAttrString)));
     }
 
     n->setKey(mNodeKey); // it can be decrypted or encrypted
@@ -1909,6 +2156,12 @@ void LocalNode::setnameparent(LocalNode* newparent, const LocalPath& newlocalpat
                            (slocalname && !newshortname) ||
                            (newshortname && slocalname && *newshortname != *slocalname);
 
+    // the overlay index knows the subtree by its paths: forget the old ones while we can still make them
+    if (parent && newparent && (parentChange || localnameChange) && !sync->mDestructorRunning)
+    {
+        recursiveIndexTreestate(false);
+    }
+
     if (parent)
     {
         if (parentChange || localnameChange)
@@ -1925,10 +2178,17 @@ void LocalNode::setnameparent(LocalNode* newparent, const LocalPath& newlocalpat
             parentChange || shortnameChange))
         {
             // remove existing child linkage for slocalname
-            auto it = parent->schildren.find(*slocalname);
-            if (it != parent->schildren.end() && it->second == this)
+            if (parent->schildren)
             {
-                parent->schildren.erase(it);
+                auto it = parent->schildren->find(*slocalname);
+                if (it != parent->schildren->end() && it->second == this)
+                {
+                    parent->schildren->erase(it);
+                    if (parent->schildren->empty())
+                    {
+                        parent->schildren.reset();
+                    }
+                }
             }
         }
     }
@@ -1983,7 +2243,11 @@ void LocalNode::setnameparent(LocalNode* newparent, const LocalPath& newlocalpat
     {
         // it's quite possible that the new folder still has an older LocalNode with clashing shortname, that represents a file/folder since moved, but which we don't know about yet.
         // just assign the new one, we forget the old reference.  The other LocalNode will not remove this one since the LocalNode* will not match.
-        parent->schildren[*slocalname] = this;
+        if (!parent->schildren)
+        {
+            parent->schildren.reset(new localnode_map);
+        }
+        (*parent->schildren)[*slocalname] = this;
     }
 
     // reset treestate
@@ -1993,6 +2257,11 @@ void LocalNode::setnameparent(LocalNode* newparent, const LocalPath& newlocalpat
         // that it's different from this, and send out the true state
         recursiveSetAndReportTreestate(TREESTATE_NONE, true, false);
     }
+    else if (parent && localnameChange && !sync->mDestructorRunning)
+    {
+        // just renamed: the states still hold, under the new paths
+        recursiveIndexTreestate(true);
+    }
 
     if (oldsync)
     {
@@ -2023,7 +2292,10 @@ void LocalNode::moveContentTo(LocalNode* ln, LocalPath& fullPath, bool setScanAg
     {
         auto restoreLen = makeScopedSizeRestorer(fullPath);
         fullPath.appendWithSeparator(c->localname, true);
-        c->setnameparent(ln, fullPath.leafName(), sync->syncs.fsaccess->fsShortname(fullPath));
+
+        // The folder moved as a whole, so its entries kept their shortnames. No need to ask the
+        // filesystem once per child of a huge folder; the rescan below corrects any that changed
+        c->setnameparent(ln, fullPath.leafName(), c->cloneShortname());
 
         // if moving between syncs, removal from old sync db is already done
         ln->sync->statecacheadd(c);
@@ -2063,6 +2335,7 @@ LocalNode::LocalNode(Sync* csync)
 , moveAppliedToLocal(false)
 , scanInProgress(false)
 , scanObsolete(false)
+, scanInteractive(false)
 , parentSetScanAgain(false)
 , parentSetCheckMovesAgain(false)
 , parentSetSyncAgain(false)
@@ -2107,6 +2380,7 @@ void LocalNode::init(nodetype_t ctype, LocalNode* cparent, const LocalPath& cful
     neverScanned = 0;
     scanInProgress = false;
     scanObsolete = false;
+    scanInteractive = false;
     slocalname = NULL;
 
     if (type != FILENODE)
@@ -2421,9 +2695,29 @@ bool LocalNode::syncRequired() const
     return syncAgain != TREE_RESOLVED;
 }
 
+bool LocalNode::flaggedForVisit() const
+{
+    return scanAgain != TREE_RESOLVED
+        || checkMovesAgain != TREE_RESOLVED
+        || syncAgain != TREE_RESOLVED
+        || conflicts != TREE_RESOLVED
+        || parentSetScanAgain
+        || parentSetCheckMovesAgain
+        || parentSetSyncAgain
+        || parentSetContainsConflicts;
+}
+
 
 void LocalNode::propagateAnySubtreeFlags()
 {
+    if (scanAgain != TREE_ACTION_SUBTREE &&
+        checkMovesAgain != TREE_ACTION_SUBTREE &&
+        syncAgain != TREE_ACTION_SUBTREE)
+    {
+        // nothing to pass on, don't visit every child
+        return;
+    }
+
     for (auto& child : children)
     {
         if (child.second->type != FILENODE)
@@ -2461,12 +2755,8 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
 
     std::shared_ptr<ScanService::ScanRequest> ourScanRequest = scanInProgress ? rare().scanRequest  : nullptr;
 
-    std::shared_ptr<ScanService::ScanRequest>* availableScanSlot = nullptr;
-    if (!sync->mActiveScanRequestGeneral || sync->mActiveScanRequestGeneral->completed())
-    {
-        availableScanSlot = &sync->mActiveScanRequestGeneral;
-    }
-    else if (neverScanned &&
+    std::shared_ptr<ScanService::ScanRequest>* availableScanSlot = sync->freeGeneralScanSlot();
+    if (!availableScanSlot && neverScanned &&
             (!sync->mActiveScanRequestUnscanned || sync->mActiveScanRequestUnscanned->completed()))
     {
         availableScanSlot = &sync->mActiveScanRequestUnscanned;
@@ -2474,7 +2764,7 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
 
     if (!ourScanRequest && availableScanSlot)
     {
-        // we can start a single new request if we are still recursing and the last request from this sync completed already
+        // we can start a new request if we are still recursing and one of the requests from this sync completed already
         if (scanDelayUntil != 0 && Waiter::ds < scanDelayUntil)
         {
             LOG_verbose << sync->syncname << "Too soon to scan this folder, needs more ds: " << scanDelayUntil - Waiter::ds;
@@ -2512,12 +2802,19 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
                 child.recomputeFingerprint = false;
 
                 // Can't fingerprint directories.
-                if (child.type != FILENODE || forceRecompute)
+                if (child.type != FILENODE)
                 {
                     priorScanChildren.erase(child.localname);
                     continue;
                 }
 
+                // An entry that can't match, so the file is read rather than found in the fingerprint cache.
+                if (forceRecompute)
+                {
+                    priorScanChildren[child.localname] = FSNode();
+                    continue;
+                }
+
                 if (priorScanChildren.find(child.localname) != priorScanChildren.end())
                 {
                     // already using not yet discarded last-scan data
@@ -2537,11 +2834,20 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
                 }
             }
 
-            ourScanRequest = sync->syncs.mScanService->queueScan(fullPath.localPath,
+            // Ahead of the background scans if the filesystem told us about a change here,
+            // or entries came and went since the last scan (while we weren't running, say.)
+            bool interactive = scanInteractive
+                               || (mtimeAsScanned && mtimeAsScanned != row.fsNode->fingerprint.mtime);
+            scanInteractive = false;
+
+            ourScanRequest = sync->syncs.mScanService->queueScan(sync->fsfp(),
+                                                                 fullPath.localPath,
                                                                  row.fsNode->fsid,
                                                                  false,
                                                                  std::move(priorScanChildren),
-                                                                 sync->syncs.waiter);
+                                                                 sync->syncs.waiter,
+                                                                 interactive,
+                                                                 sync->getConfig().mBackgroundIO && !interactive);
 
             rare().scanRequest = ourScanRequest;
             *availableScanSlot = ourScanRequest;
@@ -2552,7 +2858,10 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
     else if (ourScanRequest &&
              ourScanRequest->completed())
     {
-        if (ourScanRequest == sync->mActiveScanRequestGeneral) sync->mActiveScanRequestGeneral.reset();
+        for (auto& slot : sync->mActiveScanRequestsGeneral)
+        {
+            if (ourScanRequest == slot) slot.reset();
+        }
         if (ourScanRequest == sync->mActiveScanRequestUnscanned) sync->mActiveScanRequestUnscanned.reset();
 
         scanInProgress = false;
@@ -2599,6 +2908,10 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
 
             LOG_verbose << sync->syncname << "Received " << lastFolderScan->size() << " directory scan results for: " << fullPath.localPath;
 
+            sync->mFingerprintsComputed += ourScanRequest->fingerprintsComputed();
+            sync->mFingerprintsReused += ourScanRequest->fingerprintsReused();
+            sync->mUnifiedSync.mTelemetry.scan.add(ourScanRequest->scanTime());
+
             if (neverScanned)
             {
                 neverScanned = 0;
@@ -2607,6 +2920,13 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
                 LOG_verbose << sync->syncname << "Remaining known unscanned folders: " << sync->threadSafeState->neverScannedFolderCount.load();
             }
 
+            // The root isn't in the database, it's rescanned first anyway.
+            if (mtimeAsScanned != row.fsNode->fingerprint.mtime && parent)
+            {
+                mtimeAsScanned = row.fsNode->fingerprint.mtime;
+                sync->statecacheadd(this);
+            }
+
             scanDelayUntil = Waiter::ds + 20; // don't scan too frequently
             scanAgain = TREE_RESOLVED;
             setSyncAgain(false, true, false);
@@ -2706,6 +3026,11 @@ void LocalNode::recursiveSetAndReportTreestate(treestate_t ts, bool recurse, boo
         sync->syncs.mClient.app->syncupdate_treestate(sync->getConfig(), getLocalPath(), ts, type);
     }
 
+    if (ts != mReportedSyncState)
+    {
+        sync->syncs.mTreestateIndex.set(getLocalPath(), ts, type);
+    }
+
     mReportedSyncState = ts;
 
     if (recurse)
@@ -2717,6 +3042,26 @@ void LocalNode::recursiveSetAndReportTreestate(treestate_t ts, bool recurse, boo
     }
 }
 
+void LocalNode::recursiveIndexTreestate(bool add)
+{
+    if (mReportedSyncState != TREESTATE_NONE)
+    {
+        if (add)
+        {
+            sync->syncs.mTreestateIndex.set(getLocalPath(), mReportedSyncState, type);
+        }
+        else
+        {
+            sync->syncs.mTreestateIndex.erase(getLocalPath());
+        }
+    }
+
+    for (auto& i : children)
+    {
+        i.second->recursiveIndexTreestate(add);
+    }
+}
+
 treestate_t LocalNode::checkTreestate(bool notifyChangeToApp)
 {
     // notify file explorer if the sync state overlay icon should change
@@ -2863,6 +3208,11 @@ LocalNode::~LocalNode()
         sync->statecachedel(this);
     }
 
+    if (!sync->mDestructorRunning)
+    {
+        sync->mNameConflicts.erase(this);
+    }
+
     if (neverScanned)
     {
         neverScanned = 0;
@@ -2960,6 +3310,69 @@ void LocalNode::setSubtreeNeedsRefingerprint()
     }
 }
 
+// heap bytes of a string, nothing while it fits in the object itself
+template<typename StringType>
+static size_t heapBytes(const StringType& s)
+{
+    return s.capacity() > StringType().capacity() ? (s.capacity() + 1) * sizeof(typename StringType::value_type) : 0;
+}
+
+size_t LocalNode::memoryUsage() const
+{
+    // a red-black tree node: colour and three links ahead of the value
+    constexpr size_t mapNodeBytes = 4 * sizeof(void*);
+
+    size_t bytes = sizeof(LocalNode) + heapBytes(localname.rawValue()) + heapBytes(toName_of_localname);
+
+    if (slocalname)
+    {
+        bytes += sizeof(LocalPath) + heapBytes(slocalname->rawValue());
+    }
+
+    if (parent)
+    {
+        // the children map holds its own copy of the name as the key
+        bytes += mapNodeBytes + sizeof(localnode_map::value_type) + heapBytes(localname.rawValue());
+
+        if (slocalname && parent->schildren)
+        {
+            bytes += mapNodeBytes + sizeof(localnode_map::value_type) + heapBytes(slocalname->rawValue());
+        }
+    }
+
+    if (schildren)
+    {
+        bytes += sizeof(localnode_map);
+    }
+
+    if (fsid_lastSynced_it != sync->syncs.localnodeBySyncedFsid.end())
+    {
+        bytes += mapNodeBytes + sizeof(fsid_localnode_map::value_type);
+    }
+
+    if (fsid_asScanned_it != sync->syncs.localnodeByScannedFsid.end())
+    {
+        bytes += mapNodeBytes + sizeof(fsid_localnode_map::value_type);
+    }
+
+    if (syncedCloudNodeHandle_it != sync->syncs.localnodeByNodeHandle.end())
+    {
+        bytes += mapNodeBytes + sizeof(nodehandle_localnode_map::value_type);
+    }
+
+    if (lastFolderScan)
+    {
+        bytes += sizeof(*lastFolderScan) + lastFolderScan->capacity() * sizeof(FSNode);
+    }
+
+    if (rareFields)
+    {
+        bytes += sizeof(RareFields);
+    }
+
+    return bytes;
+}
+
 LocalPath LocalNode::getLocalPath() const
 {
     LocalPath lp;
@@ -3039,7 +3452,8 @@ LocalNode* LocalNode::childbyname(LocalPath* localname)
 {
     localnode_map::iterator it;
 
-    if (!localname || ((it = children.find(*localname)) == children.end() && (it = schildren.find(*localname)) == schildren.end()))
+    if (!localname || ((it = children.find(*localname)) == children.end()
+                       && (!schildren || (it = schildren->find(*localname)) == schildren->end())))
     {
         return NULL;
     }
@@ -3280,12 +3694,18 @@ bool LocalNodeCore::write(string& destination, uint32_t parentID) const
 
     // first flag indicates we are storing slocalname.
     // Storing it is much, much faster than looking it up on startup.
-    w.serializeexpansionflags(1, 1);
+    bool hasScannedMtime = type == FOLDERNODE && mtimeAsScanned;
+    w.serializeexpansionflags(1, 1, hasScannedMtime);
     auto tmpstr = slocalname ? slocalname->platformEncoded() : string();
     w.serializepstr(slocalname ? &tmpstr : nullptr);
 
     w.serializebool(namesSynchronized);
 
+    if (hasScannedMtime)
+    {
+        w.serializecompressedi64(mtimeAsScanned);
+    }
+
     return true;
 }
 
@@ -3383,6 +3803,7 @@ bool LocalNodeCore::read(const string& source, uint32_t& parentID)
     handle h = 0;
     string localname, shortname;
     m_time_t mtime = 0;
+    m_time_t scannedMtime = 0;
     int32_t crc[4];
     memset(crc, 0, sizeof crc);
     byte syncable = 1;
@@ -3396,9 +3817,10 @@ bool LocalNodeCore::read(const string& source, uint32_t& parentID)
         (type == FILENODE && !r.unserializebinary((byte*)crc, sizeof(crc))) ||
         (type == FILENODE && !r.unserializecompressedi64(mtime)) ||
         (r.hasdataleft() && !r.unserializebyte(syncable)) ||
-        (r.hasdataleft() && !r.unserializeexpansionflags(expansionflags, 2)) ||
+        (r.hasdataleft() && !r.unserializeexpansionflags(expansionflags, 3)) ||
         (expansionflags[0] && !r.unserializecstr(shortname, false)) ||
-        (expansionflags[1] && !r.unserializebool(ns)))
+        (expansionflags[1] && !r.unserializebool(ns)) ||
+        (expansionflags[2] && !r.unserializecompressedi64(scannedMtime)))
     {
         LOG_err << "LocalNode unserialization failed at field " << r.fieldnum;
         assert(false);
@@ -3413,6 +3835,7 @@ bool LocalNodeCore::read(const string& source, uint32_t& parentID)
     this->slocalname.reset(shortname.empty() ? nullptr : new LocalPath(LocalPath::fromPlatformEncodedRelative(shortname)));
     this->slocalname_in_db = 0 != expansionflags[0];
     this->namesSynchronized = ns;
+    this->mtimeAsScanned = scannedMtime;
 
     memcpy(this->syncedFingerprint.crc.data(), crc, sizeof crc);
 
@@ -3938,12 +4361,16 @@ bool CloudNode::isIgnoreFile() const
 }
 
 NodeManagerNode::NodeManagerNode(NodeManager& nodeManager, NodeHandle nodeHandle)
-    : mLRUPosition(nodeManager.invalidCacheLRUPos())
-    , mNodeHandle(nodeHandle)
+    : mNodeHandle(nodeHandle)
     , mNodeManager(nodeManager)
 {
 }
 
+bool NodeManagerNode::isInCacheLRU() const
+{
+    return mLRUQueue != LRUQueue::NONE;
+}
+
 void NodeManagerNode::setNode(shared_ptr<Node> node)
 {
     assert(mNode.expired() && "There is a valid node assigned");
@@ -24,6 +24,7 @@
 #include "mega/base64.h"
 #include "mega/megaapp.h"
 #include "mega/share.h"
+#include "mega/mega_utf8proc.h"
 
 
 namespace mega {
@@ -133,7 +134,15 @@ void NodeManager::setTable(DBTableNodes *table)
 void NodeManager::setTable_internal(DBTableNodes *table)
 {
     assert(mMutex.owns_lock());
+    endBulkLoad_internal();
     mTable = table;
+    if (mTable)
+    {
+        mTable->setBlobCompression(mDbBlobCompression);
+    }
+
+    // its contents are unknown until nodes are loaded or cleaned
+    mFingerprintFilter.disable();
 }
 
 void NodeManager::reset()
@@ -200,6 +209,7 @@ void NodeManager::notifyNode_internal(std::shared_ptr<Node> n, sharedNode_vector
 {
     assert(mMutex.owns_lock());
     n->applykey();
+    ++mTreeGeneration;
 
     if (!mClient.fetchingnodes)
     {
@@ -308,6 +318,7 @@ bool NodeManager::addNode_internal(std::shared_ptr<Node> node, bool notify, bool
         // The NodeManagerNode could have been added by NodeManager::addChild() but, in that case, mNode would be invalid
         auto& nodePosition = pair.first;
         nodePosition->second.mAllChildrenHandleLoaded = true; // Receive a new node, children aren't received yet or they are stored in nodesWithMissingParents
+        mNodeShards.updateChildren(node->nodeHandle(), nodePosition->second);
         addChild_internal(node->parentHandle(), node->nodeHandle(), nullptr);
     }
 
@@ -337,6 +348,15 @@ bool NodeManager::updateNode_internal(Node *node)
 
 std::shared_ptr<Node> NodeManager::getNodeByHandle(NodeHandle handle)
 {
+    if (handle.isUndef()) return nullptr;
+
+    // nodes already loaded in RAM are served without contending for mMutex
+    if (std::shared_ptr<Node> node = mNodeShards.getNode(handle))
+    {
+        tryInsertNodeCacheLRU(node);
+        return node;
+    }
+
     LockGuard g(mMutex);
     return getNodeByHandle_internal(handle);
 }
@@ -473,18 +493,188 @@ sharedNode_list NodeManager::getChildren_internal(const Node *parent, CancelToke
         }
 
         parent->mNodePosition->second.mAllChildrenHandleLoaded = true;
+        mNodeShards.updateChildren(parent->nodeHandle(), parent->mNodePosition->second);
     }
 
     return childrenList;
 }
 
-sharedNode_vector NodeManager::getChildren(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page)
+size_t NodeManager::prefetchSubtree(NodeHandle root, int maxDepth, CancelToken cancelFlag)
 {
     LockGuard g(mMutex);
-    return getChildren_internal(filter, order, cancelFlag, page);
+    return prefetchSubtree_internal(root, maxDepth, cancelFlag);
+}
+
+size_t NodeManager::prefetchSubtree_internal(NodeHandle root, int maxDepth, CancelToken cancelFlag)
+{
+    assert(mMutex.owns_lock());
+
+    shared_ptr<Node> rootNode = getNodeByHandle_internal(root);
+    if (!rootNode || rootNode->type == FILENODE || !mTable)
+    {
+        return 0;
+    }
+
+    // don't read more rows than the cache LRU can keep, plus the nodes already in RAM (they are
+    // returned too, but don't count). Reaching the limit means more nodes to load than fit, so the
+    // deepest level read, which can be incomplete, is never loaded beyond the first level to load
+    uint64_t rowLimit = 0;
+    const uint64_t nodesInRam = mNodesInRam;
+    const uint64_t maxRows = std::numeric_limits<size_t>::max();
+    if (nodesInRam < maxRows && mCacheLRUMaxSize < maxRows - nodesInRam - 1)
+    {
+        rowLimit = mCacheLRUMaxSize + nodesInRam + 1;
+    }
+
+    std::vector<std::pair<NodeHandle, NodeSerialized>> nodesFromTable;
+    if (!mTable->getSubtree(root, maxDepth, static_cast<size_t>(rowLimit), nodesFromTable, cancelFlag) || cancelFlag.isCancelled())
+    {
+        return 0;
+    }
+    bool truncated = rowLimit && nodesFromTable.size() >= rowLimit;
+
+    if (nodesFromTable.empty())
+    {
+        rootNode->mNodePosition->second.mAllChildrenHandleLoaded = true;
+        mNodeShards.updateChildren(root, rootNode->mNodePosition->second);
+        return 0;
+    }
+
+    // parse all records in parallel. Nodes already loaded in RAM are skipped
+    std::vector<NodeData> nodesData;
+    std::vector<const std::string*> counters;
+    std::vector<NodeHandle> parentsInRam; // UNDEF for nodes to be loaded
+    nodesData.reserve(nodesFromTable.size());
+    counters.reserve(nodesFromTable.size());
+    parentsInRam.reserve(nodesFromTable.size());
+    for (const auto& nodeIt : nodesFromTable)
+    {
+        auto it = mNodes.find(nodeIt.first);
+        shared_ptr<Node> n = (it != mNodes.end()) ? it->second.getNodeInRam(false) : nullptr;
+        if (n)
+        {
+            parentsInRam.push_back(n->parentHandle());
+        }
+        else
+        {
+            nodesData.emplace_back(nodeIt.second.mNode.data(), nodeIt.second.mNode.size(), NodeData::COMPONENT_ALL);
+            counters.push_back(&nodeIt.second.mNodeCounter);
+            parentsInRam.push_back(NodeHandle());
+        }
+    }
+
+    mClient.mAsyncQueue.runInBatches(nodesData.size(), PARALLEL_BATCH_SIZE, [&nodesData](size_t begin, size_t end, SymmCipher&)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            nodesData[i].parse();
+        }
+    });
+
+    // depth of every node of the subtree, in order to know which folders got all their children
+    std::map<NodeHandle, int> depths;
+    std::map<int, uint64_t> nodesToLoadByDepth;
+    depths[root] = 0;
+    for (size_t i = 0, j = 0; i < nodesFromTable.size(); ++i)
+    {
+        bool toLoad = parentsInRam[i].isUndef();
+        NodeHandle parentHandle = toLoad ? NodeHandle().set6byte(nodesData[j++].getParentHandle()) : parentsInRam[i];
+
+        auto parentIt = depths.find(parentHandle);
+        assert(parentIt != depths.end());
+        int depth = (parentIt != depths.end()) ? parentIt->second + 1 : 1;
+        depths[nodesFromTable[i].first] = depth;
+        if (toLoad)
+        {
+            ++nodesToLoadByDepth[depth];
+        }
+    }
+
+    // don't load more levels than the cache LRU can keep (the first level with nodes to load is always loaded)
+    int lastDepth = 0;
+    uint64_t nodesToLoad = 0;
+    for (const auto& it : nodesToLoadByDepth)
+    {
+        if (lastDepth && nodesToLoad + it.second > mCacheLRUMaxSize)
+        {
+            break;
+        }
+
+        nodesToLoad += it.second;
+        lastDepth = it.first;
+    }
+
+    // folders above this level got all their children
+    int completeDepth = lastDepth;
+    if (truncated)
+    {
+        // the deepest level read is partial, so its parents are incomplete if it's loaded
+        int deepestRead = depths[nodesFromTable.back().first];
+        if (lastDepth >= deepestRead)
+        {
+            lastDepth = deepestRead;
+            completeDepth = deepestRead - 1;
+        }
+    }
+    else if (nodesToLoadByDepth.empty() || nodesToLoadByDepth.rbegin()->first == lastDepth)
+    {
+        // every level is loaded (or already was)
+        lastDepth = maxDepth > 0 ? maxDepth : std::numeric_limits<int>::max();
+        completeDepth = lastDepth;
+    }
+
+    // create the nodes in order, so parents are always set before their children
+    size_t loaded = 0;
+    sharedNode_vector nodes;
+    nodes.reserve(nodesData.size());
+    for (size_t i = 0; i < nodesData.size(); ++i)
+    {
+        if (cancelFlag.isCancelled())
+        {
+            return loaded;
+        }
+
+        if (depths[NodeHandle().set6byte(nodesData[i].getHandle())] > lastDepth)
+        {
+            break;
+        }
+
+        shared_ptr<Node> n = getNodeFromNodeData(nodesData[i], *counters[i]);
+        if (!n)
+        {
+            return loaded;
+        }
+
+        nodes.push_back(std::move(n));
+        ++loaded;
+    }
+
+    // folders above the last complete level loaded have all their children in RAM
+    for (const auto& depthIt : depths)
+    {
+        if (depthIt.second >= completeDepth)
+        {
+            continue;
+        }
+
+        auto it = mNodes.find(depthIt.first);
+        if (it != mNodes.end())
+        {
+            it->second.mAllChildrenHandleLoaded = true;
+            mNodeShards.updateChildren(depthIt.first, it->second);
+        }
+    }
+
+    return loaded;
+}
+
+sharedNode_vector NodeManager::getChildren(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page)
+{
+    auto g = lockForInteractiveQuery();
+    return getChildren_internal(filter, order, queryOptions(cancelFlag, DBQueryPriority::INTERACTIVE), page);
 }
 
-sharedNode_vector NodeManager::getChildren_internal(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page)
+sharedNode_vector NodeManager::getChildren_internal(const NodeSearchFilter& filter, int order, const DBQueryOptions& options, const NodeSearchPage& page)
 {
     assert(mMutex.owns_lock());
 
@@ -496,34 +686,143 @@ sharedNode_vector NodeManager::getChildren_internal(const NodeSearchFilter& filt
     }
 
     // small optimization to possibly skip the db look-up
-    if (filter.bySensitivity() == NodeSearchFilter::BoolFilter::onlyTrue)
+    if (isParentExcludedBySensitivity(filter))
     {
-        shared_ptr<Node> node = getNodeByHandle_internal(NodeHandle().set6byte(filter.byParentHandle()));
-        if (!node || node->isSensitiveInherited())
-        {
-            return sharedNode_vector();
-        }
+        return sharedNode_vector();
+    }
+
+    NodeSearchFilter indexedFilter(filter);
+    if (!setNameCandidates(indexedFilter))
+    {
+        return sharedNode_vector();
     }
 
     // db look-up
     vector<pair<NodeHandle, NodeSerialized>> nodesFromTable;
-    if (!mTable->getChildren(filter, order, nodesFromTable, cancelFlag, page))
+    if (!mTable->getChildren(indexedFilter, order, nodesFromTable, options, page))
     {
         return sharedNode_vector();
     }
 
-    sharedNode_vector nodes = processUnserializedNodes(nodesFromTable, cancelFlag);
+    sharedNode_vector nodes = processUnserializedNodes(nodesFromTable, options.cancelFlag);
 
     return nodes;
 }
 
+sharedNode_vector NodeManager::getChildren(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, size_t pageSize, NodeSearchCursor& cursor)
+{
+    auto g = lockForInteractiveQuery();
+
+    sharedNode_vector nodes;
+    getChildrenFrom_internal(filter,
+                             order,
+                             queryOptions(cancelFlag, DBQueryPriority::INTERACTIVE),
+                             pageSize,
+                             0 /* single batch */,
+                             cursor,
+                             [&nodes](sharedNode_vector& batch)
+                             {
+                                 nodes = std::move(batch);
+                                 return true;
+                             });
+    return nodes;
+}
+
+bool NodeManager::streamChildren(const NodeSearchFilter& filter,
+                                 int order,
+                                 CancelToken cancelFlag,
+                                 size_t batchSize,
+                                 NodeSearchCursor& cursor,
+                                 std::function<bool(sharedNode_vector&)> processBatch)
+{
+    auto g = lockForInteractiveQuery();
+    assert(batchSize);
+    return getChildrenFrom_internal(filter,
+                                    order,
+                                    queryOptions(cancelFlag, DBQueryPriority::INTERACTIVE),
+                                    0 /* no limit */,
+                                    batchSize,
+                                    cursor,
+                                    processBatch);
+}
+
+bool NodeManager::getChildrenFrom_internal(const NodeSearchFilter& filter,
+                                           int order,
+                                           const DBQueryOptions& options,
+                                           size_t limit,
+                                           size_t batchSize,
+                                           NodeSearchCursor& cursor,
+                                           const std::function<bool(sharedNode_vector&)>& processBatch)
+{
+    assert(mMutex.owns_lock());
+
+    // validation
+    if (filter.byParentHandle() == UNDEF || !mTable || mNodes.empty())
+    {
+        assert(filter.byParentHandle() != UNDEF && mTable && !mNodes.empty());
+        return false;
+    }
+
+    NodeSearchFilter indexedFilter(filter);
+    if (isParentExcludedBySensitivity(filter) || !setNameCandidates(indexedFilter))
+    {
+        cursor.moveToEnd();
+        return true;
+    }
+
+    return mTable->getChildrenFrom(indexedFilter,
+                                   order,
+                                   cursor,
+                                   limit,
+                                   batchSize,
+                                   [this, &options, &processBatch](vector<pair<NodeHandle, NodeSerialized>>& nodesFromTable)
+                                   {
+                                       sharedNode_vector nodes = processUnserializedNodes(nodesFromTable, options.cancelFlag);
+                                       return processBatch(nodes);
+                                   },
+                                   options);
+}
+
+bool NodeManager::isParentExcludedBySensitivity(const NodeSearchFilter& filter)
+{
+    assert(mMutex.owns_lock());
+
+    if (filter.bySensitivity() != NodeSearchFilter::BoolFilter::onlyTrue)
+    {
+        return false;
+    }
+
+    shared_ptr<Node> node = getNodeByHandle_internal(NodeHandle().set6byte(filter.byParentHandle()));
+    return !node || node->isSensitiveInherited();
+}
+
 sharedNode_vector NodeManager::getRecentNodes(unsigned maxcount,
                                               m_time_t since,
                                               bool excludeSensitives)
 {
     LockGuard g(mMutex);
 
-    sharedNode_vector result = getRecentNodes_internal(NodeSearchPage{0, maxcount}, since);
+    sharedNode_vector result;
+    if (getCachedRecentNodes(maxcount, since, excludeSensitives, result))
+    {
+        return result;
+    }
+
+    result = getRecentNodes_internal(NodeSearchPage{0, maxcount}, since);
+    if (mTable && !mNodes.empty())
+    {
+        mRecentNodes.clear();
+        mRecentNodes.reserve(result.size());
+        for (const auto& n : result)
+        {
+            mRecentNodes.emplace_back(n->nodeHandle(), n->ctime);
+        }
+        mRecentNodesValid = true;
+        mRecentNodesComplete = !maxcount || result.size() < maxcount;
+        mRecentNodesCount = maxcount;
+        mRecentNodesSince = since;
+    }
+
     if (!excludeSensitives)
         return result;
 
@@ -566,6 +865,138 @@ sharedNode_vector NodeManager::getRecentNodes(unsigned maxcount,
     }
 }
 
+bool NodeManager::getCachedRecentNodes(unsigned maxcount, m_time_t since, bool excludeSensitives, sharedNode_vector& result)
+{
+    assert(mMutex.owns_lock());
+
+    if (!mRecentNodesValid || since < mRecentNodesSince || mNodes.empty())
+    {
+        return false;
+    }
+
+    for (const auto& [handle, ctime] : mRecentNodes)
+    {
+        if (maxcount && result.size() == maxcount)
+        {
+            return true;
+        }
+        if (ctime < since)
+        {
+            // the rest are older
+            return true;
+        }
+
+        shared_ptr<Node> n = getNodeByHandle_internal(handle);
+        if (!n)
+        {
+            // gone without being notified yet: ask the DB
+            mRecentNodesValid = false;
+            mRecentNodes.clear();
+            result.clear();
+            return false;
+        }
+        if (!excludeSensitives || !n->isSensitiveInherited())
+        {
+            result.push_back(n);
+        }
+    }
+
+    // ran out of cached nodes: fine if they were all of them
+    if (mRecentNodesComplete || (maxcount && result.size() == maxcount))
+    {
+        return true;
+    }
+
+    result.clear();
+    return false;
+}
+
+bool NodeManager::isRecentNodeCandidate(const Node& node, m_time_t since) const
+{
+    return node.type == FILENODE
+        && node.ctime >= since
+        && !(node.parent && node.parent->type == FILENODE)
+        && !node.isAncestor(rootnodes.rubbish);
+}
+
+void NodeManager::updateRecentNodes(const sharedNode_vector& changedNodes)
+{
+    assert(mMutex.owns_lock());
+
+    if (!mRecentNodesValid)
+    {
+        return;
+    }
+
+    for (auto& n : changedNodes)
+    {
+        // the files below a folder that is moved or removed aren't notified themselves, and
+        // the ones not in RAM can't be checked without loading them
+        if (n->type != FILENODE && (n->changed.parent || n->changed.removed))
+        {
+            mRecentNodesValid = false;
+            mRecentNodes.clear();
+            return;
+        }
+    }
+
+    // new versions take the previous ones out. The ones with a new ctime are inserted again
+    // below, in their new position. Nodes not in RAM weren't notified, so they are unchanged
+    auto newEnd = std::remove_if(mRecentNodes.begin(), mRecentNodes.end(), [this](const std::pair<NodeHandle, m_time_t>& recent)
+    {
+        auto it = mNodes.find(recent.first);
+        if (it == mNodes.end())
+        {
+            return true;
+        }
+
+        shared_ptr<Node> n = it->second.getNodeInRam(false);
+        return n && (n->changed.removed || n->changed.ctime || !isRecentNodeCandidate(*n, mRecentNodesSince));
+    });
+    if (newEnd != mRecentNodes.end())
+    {
+        mRecentNodes.erase(newEnd, mRecentNodes.end());
+        if (!mRecentNodesComplete)
+        {
+            // still the most recent ones, just fewer
+            mRecentNodesCount = static_cast<unsigned>(mRecentNodes.size());
+        }
+    }
+
+    for (auto& n : changedNodes)
+    {
+        const NodeHandle h = n->nodeHandle();
+        if (n->changed.removed || !isRecentNodeCandidate(*n, mRecentNodesSince)
+            || std::any_of(mRecentNodes.begin(), mRecentNodes.end(), [h](const std::pair<NodeHandle, m_time_t>& recent) { return recent.first == h; }))
+        {
+            continue;
+        }
+
+        // newest first: after the ones of the same time, as the DB would
+        auto it = std::upper_bound(mRecentNodes.begin(), mRecentNodes.end(), n->ctime, [](m_time_t ctime, const std::pair<NodeHandle, m_time_t>& other)
+        {
+            return ctime > other.second;
+        });
+        if (it == mRecentNodes.end() && !mRecentNodesComplete)
+        {
+            // older than the ones known, there could be others in between
+            continue;
+        }
+        mRecentNodes.emplace(it, h, n->ctime);
+    }
+
+    if (!mRecentNodesComplete && mRecentNodes.size() > mRecentNodesCount)
+    {
+        mRecentNodes.resize(mRecentNodesCount);
+    }
+    else if (mRecentNodesComplete && mRecentNodesCount && mRecentNodes.size() > mRecentNodesCount)
+    {
+        // the DB would return mRecentNodesCount of them now
+        mRecentNodes.resize(mRecentNodesCount);
+        mRecentNodesComplete = false;
+    }
+}
+
 sharedNode_vector NodeManager::getRecentNodes_internal(const NodeSearchPage& page, m_time_t since)
 {
     assert(mMutex.owns_lock());
@@ -643,13 +1074,78 @@ uint64_t NodeManager::getNodeCount_internal()
 }
 
 std::set<std::string> NodeManager::getAllNodeTags(const char* searchString, CancelToken cancelFlag)
+{
+    std::set<std::string> result;
+    runBackgroundQuery(cancelFlag,
+                       [this, searchString, &result](const DBQueryOptions& options)
+                       {
+                           result = getAllNodeTags_internal(searchString, options);
+                       });
+    return result;
+}
+
+void NodeManager::setDbQueryDeadlines(std::chrono::milliseconds interactive,
+                                      std::chrono::milliseconds background)
 {
     LockGuard g(mMutex);
-    return getAllNodeTags_internal(searchString, cancelFlag);
+    mInteractiveQueryDeadline = interactive;
+    mBackgroundQueryDeadline = background;
+}
+
+DBQueryOptions NodeManager::queryOptions(CancelToken cancelFlag, DBQueryPriority priority) const
+{
+    DBQueryOptions options(cancelFlag);
+    options.priority = priority;
+    options.scheduler = &mQueryScheduler;
+
+    const std::chrono::milliseconds deadline = priority == DBQueryPriority::INTERACTIVE ?
+                                                   mInteractiveQueryDeadline :
+                                                   mBackgroundQueryDeadline;
+    if (deadline.count() > 0)
+    {
+        options.deadline = DBQueryOptions::Clock::now() + deadline;
+    }
+    return options;
+}
+
+std::unique_lock<NodeManager::MutexType> NodeManager::lockForInteractiveQuery()
+{
+    // only waiting queries are announced: a background query run by the owner of 'mMutex'
+    // wouldn't let anybody in by yielding
+    mQueryScheduler.interactiveWaiting();
+    std::unique_lock<MutexType> g(mMutex);
+    mQueryScheduler.interactiveServed();
+    return g;
+}
+
+void NodeManager::runBackgroundQuery(CancelToken cancelFlag,
+                                     const std::function<void(const DBQueryOptions&)>& query)
+{
+    for (unsigned yields = 0;; ++yields)
+    {
+        {
+            LockGuard g(mMutex);
+            DBQueryOptions options = queryOptions(cancelFlag, DBQueryPriority::BACKGROUND);
+            if (yields == MAX_QUERY_YIELDS)
+            {
+                // the last attempt is run to the end
+                options.scheduler = nullptr;
+            }
+
+            query(options);
+            if (!options.yielded)
+            {
+                return;
+            }
+        }
+
+        LOG_debug << "Background DB query left to interactive queries (" << (yields + 1) << ")";
+        mQueryScheduler.waitForInteractive(QUERY_YIELD_WAIT);
+    }
 }
 
 std::set<std::string> NodeManager::getAllNodeTags_internal(const char* searchString,
-                                                           CancelToken cancelFlag)
+                                                           const DBQueryOptions& options)
 {
     assert(mMutex.owns_lock());
     // validation
@@ -669,7 +1165,7 @@ std::set<std::string> NodeManager::getAllNodeTags_internal(const char* searchStr
         return {};
     }
     std::set<std::string> result;
-    if (!mTable->getAllNodeTags(auxSearchString, result, cancelFlag))
+    if (!mTable->getAllNodeTags(auxSearchString, result, options))
         return {};
 
     return result;
@@ -677,11 +1173,29 @@ std::set<std::string> NodeManager::getAllNodeTags_internal(const char* searchStr
 
 sharedNode_vector NodeManager::searchNodes(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page)
 {
-    LockGuard g(mMutex);
-    return searchNodes_internal(filter, order, cancelFlag, page);
+    const vector<handle>& ancestors = filter.byAncestorHandles();
+    const bool located = std::any_of(ancestors.begin(),
+                                     ancestors.end(),
+                                     [](handle a)
+                                     {
+                                         return a != UNDEF;
+                                     });
+    if (located)
+    {
+        auto g = lockForInteractiveQuery();
+        return searchNodes_internal(filter, order, queryOptions(cancelFlag, DBQueryPriority::INTERACTIVE), page);
+    }
+
+    sharedNode_vector nodes;
+    runBackgroundQuery(cancelFlag,
+                       [this, &filter, order, &page, &nodes](const DBQueryOptions& options)
+                       {
+                           nodes = searchNodes_internal(filter, order, options, page);
+                       });
+    return nodes;
 }
 
-sharedNode_vector NodeManager::searchNodes_internal(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page)
+sharedNode_vector NodeManager::searchNodes_internal(const NodeSearchFilter& filter, int order, const DBQueryOptions& options, const NodeSearchPage& page)
 {
     assert(mMutex.owns_lock());
 
@@ -707,14 +1221,20 @@ sharedNode_vector NodeManager::searchNodes_internal(const NodeSearchFilter& filt
         return sharedNode_vector();
     }
 
+    NodeSearchFilter indexedFilter(filter);
+    if (!setNameCandidates(indexedFilter))
+    {
+        return sharedNode_vector();
+    }
+
     // db look-up
     vector<pair<NodeHandle, NodeSerialized>> nodesFromTable;
-    if (!mTable->searchNodes(filter, order, nodesFromTable, cancelFlag, page))
+    if (!mTable->searchNodes(indexedFilter, order, nodesFromTable, options, page))
     {
         return sharedNode_vector();
     }
 
-    sharedNode_vector nodes = processUnserializedNodes(nodesFromTable, cancelFlag);
+    sharedNode_vector nodes = processUnserializedNodes(nodesFromTable, options.cancelFlag);
 
     return nodes;
 }
@@ -778,11 +1298,23 @@ sharedNode_vector NodeManager::getNodesByFingerprint_internal(FileFingerprint &f
         return nodes;
     }
 
-    // Look for nodes at DB
-    std::vector<std::pair<NodeHandle, NodeSerialized>> nodesFromTable;
     std::string fingerprintString;
     fingerprint.FileFingerprint::serialize(&fingerprintString);
+    if (!mFingerprintFilter.mightContain(fingerprintString))
+    {
+        ++mClient.performanceStats.fingerprintFilterNegatives;
+        return nodes;
+    }
+
+    // Look for nodes at DB
+    std::vector<std::pair<NodeHandle, NodeSerialized>> nodesFromTable;
     mTable->getNodesByFingerprint(fingerprintString, nodesFromTable);
+    if (mFingerprintFilter.isEnabled())
+    {
+        ++(nodesFromTable.empty() ? mClient.performanceStats.fingerprintFilterFalsePositives
+                                  : mClient.performanceStats.fingerprintFilterPositives);
+    }
+
     if (nodesFromTable.size())
     {
         for (const auto& nodeIt : nodesFromTable)
@@ -865,11 +1397,22 @@ std::shared_ptr<Node> NodeManager::getNodeByFingerprint_internal(FileFingerprint
         return n->mNodePosition->second.getNodeInRam();
     }
 
-    NodeSerialized nodeSerialized;
     std::string fingerprintString;
     fingerprint.FileFingerprint::serialize(&fingerprintString);
+    if (!mFingerprintFilter.mightContain(fingerprintString))
+    {
+        ++mClient.performanceStats.fingerprintFilterNegatives;
+        return nullptr;
+    }
+
+    NodeSerialized nodeSerialized;
     NodeHandle handle;
     mTable->getNodeByFingerprint(fingerprintString, nodeSerialized, handle);
+    if (mFingerprintFilter.isEnabled())
+    {
+        ++(handle.isUndef() ? mClient.performanceStats.fingerprintFilterFalsePositives
+                            : mClient.performanceStats.fingerprintFilterPositives);
+    }
     auto itNode = mNodes.find(handle);
     std::shared_ptr<Node> node = itNode != mNodes.end() ? itNode->second.getNodeInRam() : nullptr;
     if (!node && nodeSerialized.mNode.size()) // nodes with that fingerprint found in DB
@@ -905,6 +1448,35 @@ std::shared_ptr<Node> NodeManager::childNodeByNameType_internal(const Node* pare
         return nullptr; // valid case
     }
 
+    auto lookupKey = std::make_tuple(parent->nodeHandle(), nodeType, name);
+    if (auto it = mChildLookups.find(lookupKey); it != mChildLookups.end())
+    {
+        shared_ptr<Node> node = getNodeByHandle_internal(it->second);
+        if (node && node->parent.get() == parent && node->type == nodeType && name == node->displayname())
+        {
+            return node;
+        }
+        mChildLookups.erase(it);
+    }
+
+    shared_ptr<Node> child = findChildByNameType_internal(parent, name, nodeType);
+    if (child)
+    {
+        if (mChildLookups.size() >= LOOKUP_CACHE_SIZE)
+        {
+            mChildLookups.clear();
+        }
+        mChildLookups.emplace(std::move(lookupKey), child->nodeHandle());
+    }
+    return child;
+}
+
+std::shared_ptr<Node> NodeManager::findChildByNameType_internal(const Node* parent, const std::string& name, nodetype_t nodeType)
+{
+    assert(mMutex.owns_lock());
+
+    bool allChildrenLoaded = parent->mNodePosition->second.mAllChildrenHandleLoaded;
+
     if (parent->mNodePosition->second.mChildren)
     {
         for (const auto& itNode : *parent->mNodePosition->second.mChildren)
@@ -1056,7 +1628,17 @@ shared_ptr<Node> NodeManager::getNodeFromNodeSerialized(const NodeSerialized &no
 {
     assert(mMutex.owns_lock());
 
-    shared_ptr<Node> node = unserializeNode(&nodeSerialized.mNode, false);
+    NodeData nodeData(nodeSerialized.mNode.data(), nodeSerialized.mNode.size(), NodeData::COMPONENT_ALL);
+    return getNodeFromNodeData(nodeData, nodeSerialized.mNodeCounter);
+}
+
+shared_ptr<Node> NodeManager::getNodeFromNodeData(NodeData& nodeData, const std::string& nodeCounter)
+{
+    assert(mMutex.owns_lock());
+
+    ++mCacheLRUStats.misses;
+
+    shared_ptr<Node> node = unserializeNode(nodeData, false);
     if (!node)
     {
         assert(false);
@@ -1067,7 +1649,7 @@ shared_ptr<Node> NodeManager::getNodeFromNodeSerialized(const NodeSerialized &no
         return nullptr;
     }
 
-    setNodeCounter(node, NodeCounter(nodeSerialized.mNodeCounter), false, nullptr);
+    setNodeCounter(node, NodeCounter(nodeCounter), false, nullptr);
 
     // do not automatically try to reload the account if we can't unserialize.
     // (1) we might go around in circles downloading the account over and over, DDOSing MEGA, because we get the same data back each time
@@ -1092,11 +1674,11 @@ void NodeManager::setNodeCounter(std::shared_ptr<Node> n, const NodeCounter &cou
     }
 }
 
-void NodeManager::updateTreeCounter(std::shared_ptr<Node> origin, NodeCounter nc, OperationType operation, sharedNode_vector* nodesToReport)
+void NodeManager::updateTreeCounter(std::shared_ptr<Node> origin, NodeCounter nc, OperationType operation, sharedNode_vector* nodesToReport, const Node* stopAt)
 {
     assert(mMutex.owns_lock());
 
-    while (origin)
+    while (origin && origin.get() != stopAt)
     {
         NodeCounter ancestorCounter = origin->getCounter();
         switch (operation)
@@ -1115,6 +1697,59 @@ void NodeManager::updateTreeCounter(std::shared_ptr<Node> origin, NodeCounter nc
     }
 }
 
+void NodeManager::discountRemovedNodes(sharedNode_vector& nodesToReport)
+{
+    assert(mMutex.owns_lock());
+
+    // Only the topmost node of every removed subtree is discounted (its counter already includes
+    // the rest of the subtree), and every ancestor is updated once with the sum of the removed
+    // nodes below it, instead of once per removed node.
+    std::map<Node*, std::pair<std::shared_ptr<Node>, NodeCounter>> discounts;
+    for (const auto& n : nodesToReport)
+    {
+        if (!n->changed.removed || !n->parent || n->parent->changed.removed)
+        {
+            continue;
+        }
+
+        NodeCounter nc = n->getCounter();
+        for (std::shared_ptr<Node> ancestor = n->parent; ancestor; ancestor = ancestor->parent)
+        {
+            auto& discount = discounts[ancestor.get()];
+            discount.first = ancestor;
+            discount.second += nc;
+        }
+    }
+
+    // This will also require notifying/updating parents back to the root.  Report and
+    // update them in this same operation, to ensure consistency in case of commit
+    for (auto& it : discounts)
+    {
+        NodeCounter ancestorCounter = it.second.first->getCounter();
+        ancestorCounter -= it.second.second;
+        setNodeCounter(it.second.first, ancestorCounter, true, &nodesToReport);
+    }
+}
+
+std::shared_ptr<Node> NodeManager::getClosestCommonAncestor(std::shared_ptr<Node> a, std::shared_ptr<Node> b)
+{
+    std::set<const Node*> ancestorsOfA;
+    for (; a; a = a->parent)
+    {
+        ancestorsOfA.insert(a.get());
+    }
+
+    for (; b; b = b->parent)
+    {
+        if (ancestorsOfA.count(b.get()))
+        {
+            return b;
+        }
+    }
+
+    return nullptr;
+}
+
 NodeCounter NodeManager::calculateNodeCounter(const NodeHandle& nodehandle, nodetype_t parentType, std::shared_ptr<Node> node, bool isInRubbish)
 {
     assert(mMutex.owns_lock());
@@ -1215,6 +1850,12 @@ std::vector<NodeHandle> NodeManager::getFavouritesNodeHandles_internal(NodeHandl
 
 size_t NodeManager::getNumberOfChildrenFromNode(NodeHandle parentHandle)
 {
+    size_t numChildren = 0;
+    if (mNodeShards.getNumChildren(parentHandle, numChildren))
+    {
+        return numChildren;
+    }
+
     LockGuard g(mMutex);
     return getNumberOfChildrenFromNode_internal(parentHandle);
 }
@@ -1238,6 +1879,34 @@ size_t NodeManager::getNumberOfChildrenFromNode_internal(NodeHandle parentHandle
     return mTable->getNumberOfChildren(parentHandle);
 }
 
+bool NodeManager::getFolderCounter(NodeHandle folder, NodeCounter& counter)
+{
+    LockGuard g(mMutex);
+
+    if (!mTable || mNodes.empty())
+    {
+        return false;
+    }
+
+    auto it = mNodes.find(folder);
+    if (it == mNodes.end())
+    {
+        return false;
+    }
+
+    if (shared_ptr<Node> node = it->second.getNodeInRam(false))
+    {
+        if (node->type == FILENODE)
+        {
+            return false;
+        }
+        counter = node->getCounter();
+        return true;
+    }
+
+    return mTable->getFolderCounter(folder, counter);
+}
+
 size_t NodeManager::getNumberOfChildrenByType(NodeHandle parentHandle, nodetype_t nodeType)
 {
     LockGuard g(mMutex);
@@ -1275,7 +1944,24 @@ bool NodeManager::isAncestor_internal(NodeHandle nodehandle, NodeHandle ancestor
         return false;
     }
 
-    return mTable->isAncestor(nodehandle, ancestor, cancelFlag);
+    if (mAncestorLookupsGeneration != mTreeGeneration || mAncestorLookups.size() >= LOOKUP_CACHE_SIZE)
+    {
+        mAncestorLookups.clear();
+        mAncestorLookupsGeneration = mTreeGeneration;
+    }
+
+    auto key = std::make_pair(nodehandle, ancestor);
+    if (auto it = mAncestorLookups.find(key); it != mAncestorLookups.end())
+    {
+        return it->second;
+    }
+
+    bool result = mTable->isAncestor(nodehandle, ancestor, cancelFlag);
+    if (!cancelFlag.isCancelled())
+    {
+        mAncestorLookups.emplace(key, result);
+    }
+    return result;
 }
 
 void NodeManager::removeChanges()
@@ -1308,16 +1994,39 @@ void NodeManager::cleanNodes_internal()
 {
     assert(mMutex.owns_lock());
 
+    endBulkLoad_internal();
+
     mFingerPrints.clear();
+    mNodeShards.clear();
     mNodes.clear();
     mCacheLRU.clear();
+    mCacheLRUProbation.clear();
+    mCacheLRUBytes = 0;
     mNodesInRam = 0;
     mNodeToWriteInDb.reset();
+    mNodesToDecode.clear();
     mNodeNotify.clear();
+    mRecentNodes.clear();
+    mRecentNodesValid = false;
+    mChildLookups.clear();
+    mAncestorLookups.clear();
 
     rootnodes.clear();
 
-    if (mTable) mTable->removeNodes();
+    if (mTable)
+    {
+        mTable->removeNodes();
+        mFingerprintFilter.reset(0);
+    }
+    else
+    {
+        mFingerprintFilter.disable();
+    }
+
+    if (mNameIndex)
+    {
+        mNameIndex = std::make_unique<NodeNameIndex>();
+    }
 
     mInitialized = false;
 }
@@ -1340,9 +2049,17 @@ shared_ptr<Node> NodeManager::unserializeNode(const std::string *d, bool fromOld
 {
     assert(mMutex.owns_lock());
 
+    NodeData nodeData(d->data(), d->size(), NodeData::COMPONENT_ALL);
+    return unserializeNode(nodeData, fromOldCache);
+}
+
+shared_ptr<Node> NodeManager::unserializeNode(NodeData& nodeData, bool fromOldCache)
+{
+    assert(mMutex.owns_lock());
+
     std::list<std::unique_ptr<NewShare>> ownNewshares;
 
-    if (shared_ptr<Node> n = Node::unserialize(mClient, d, fromOldCache, ownNewshares))
+    if (shared_ptr<Node> n = nodeData.createNode(mClient, fromOldCache, ownNewshares))
     {
 
         auto pair = mNodes.emplace(n->nodeHandle(), NodeManagerNode(*this, n->nodeHandle()));
@@ -1351,6 +2068,12 @@ shared_ptr<Node> NodeManager::unserializeNode(const std::string *d, bool fromOld
         auto& nodePosition = pair.first;
         nodePosition->second.setNode(n);
         n->mNodePosition = nodePosition;
+        mNodeShards.setNode(n->nodeHandle(), n);
+
+        if (mCompactNodes)
+        {
+            n->shrinkToFit();
+        }
 
         insertNodeCacheLRU_internal(n);
 
@@ -1380,15 +2103,182 @@ void NodeManager::applyKeys_internal(uint32_t appliedKeys)
 {
     assert(mMutex.owns_lock());
 
-    if (mNodes.size() > appliedKeys)
+    if (mNodes.size() <= appliedKeys)
+    {
+        return;
+    }
+
+    // symmetric keys (most of them) and attributes are decrypted by the worker threads,
+    // the rest is resolved here one by one
+    std::deque<KeyDecryptionJob> jobs;
+
+    for (auto& it : mNodes)
+    {
+        if (shared_ptr<Node> node = it.second.getNodeInRam(false))
+        {
+            addKeyToApply_internal(jobs, std::move(node));
+        }
+    }
+
+    applyQueuedKeys_internal(jobs);
+}
+
+void NodeManager::applyKeys(const sharedNode_vector& nodes)
+{
+    LockGuard g(mMutex);
+
+    std::deque<KeyDecryptionJob> jobs;
+    for (auto& node : nodes)
+    {
+        addKeyToApply_internal(jobs, node);
+    }
+
+    applyQueuedKeys_internal(jobs);
+}
+
+void NodeManager::addKeyToApply_internal(std::deque<KeyDecryptionJob>& jobs, std::shared_ptr<Node> node)
+{
+    assert(mMutex.owns_lock());
+
+    jobs.emplace_back();
+    if (node->prepareKeyDecryption(jobs.back().kd))
+    {
+        jobs.back().node = std::move(node);
+        jobs.back().prepared = true;
+    }
+    else
+    {
+        jobs.pop_back();
+
+        // most of these have their key applied already, or no key they can decrypt yet
+        if (node->applykey())
+        {
+            ++mClient.performanceStats.applyKeysSerial;
+        }
+    }
+}
+
+void NodeManager::applyQueuedKeys_internal(std::deque<KeyDecryptionJob>& jobs)
+{
+    assert(mMutex.owns_lock());
+
+    if (jobs.empty())
     {
-        for (auto& it : mNodes)
+        return;
+    }
+
+    mClient.performanceStats.applyKeysBatches += decryptKeys(jobs);
+    mClient.performanceStats.applyKeysParallel += jobs.size();
+
+    for (auto& job : jobs)
+    {
+        job.node->finishKeyDecryption(job.kd);
+    }
+}
+
+size_t NodeManager::decryptKeys(std::deque<KeyDecryptionJob>& jobs)
+{
+    auto decrypt = [&jobs](size_t begin, size_t end, SymmCipher& cipher)
+    {
+        for (size_t i = begin; i < end; ++i)
         {
-            if (shared_ptr<Node> node = it.second.getNodeInRam(false))
+            if (jobs[i].prepared)
             {
-               node->applykey();
+                jobs[i].kd.decrypt(cipher);
             }
         }
+    };
+
+    if (jobs.size() <= PARALLEL_BATCH_SIZE)
+    {
+        SymmCipher cipher;
+        decrypt(0, jobs.size(), cipher);
+        return 1;
+    }
+
+    return mClient.mAsyncQueue.runInBatches(jobs.size(), PARALLEL_BATCH_SIZE, decrypt);
+}
+
+void NodeManager::queueNodeForDecoding(std::shared_ptr<Node> node)
+{
+    LockGuard g(mMutex);
+    queueNodeForDecoding_internal(std::move(node));
+}
+
+void NodeManager::queueNodeForDecoding_internal(std::shared_ptr<Node> node)
+{
+    assert(mMutex.owns_lock());
+
+    mNodesToDecode.emplace_back();
+    KeyDecryptionJob& job = mNodesToDecode.back();
+
+    // the queue keeps alive the nodes that addNode() didn't keep in RAM
+    job.inRam = mNodeToWriteInDb != node;
+    if (!job.inRam)
+    {
+        mNodeToWriteInDb.reset();
+    }
+    job.node = std::move(node);
+
+    if (mNodesToDecode.size() >= DECODING_QUEUE_BATCHES * PARALLEL_BATCH_SIZE)
+    {
+        flushDecodingQueue_internal();
+    }
+}
+
+void NodeManager::flushDecodingQueue()
+{
+    LockGuard g(mMutex);
+    flushDecodingQueue_internal();
+}
+
+void NodeManager::flushDecodingQueue_internal()
+{
+    assert(mMutex.owns_lock());
+
+    if (mNodesToDecode.empty())
+    {
+        return;
+    }
+
+    std::deque<KeyDecryptionJob> jobs;
+    jobs.swap(mNodesToDecode);
+
+    // keys are located here, since it depends on the client's state (share keys...)
+    size_t prepared = 0;
+    for (auto& job : jobs)
+    {
+        job.prepared = job.node->prepareKeyDecryption(job.kd);
+        prepared += job.prepared;
+    }
+
+    if (prepared)
+    {
+        mClient.performanceStats.fetchnodesKeysBatches += decryptKeys(jobs);
+        mClient.performanceStats.fetchnodesKeysParallel += prepared;
+    }
+
+    // same steps that MegaClient::readnode() does for nodes not queued, keeping their order
+    for (auto& job : jobs)
+    {
+        shared_ptr<Node> node = job.node;
+        if (!job.inRam)
+        {
+            assert(!mNodeToWriteInDb);
+            mNodeToWriteInDb = std::move(job.node);
+        }
+
+        if (job.prepared)
+        {
+            node->finishKeyDecryption(job.kd);
+        }
+        else
+        {
+            node->applykey();
+            ++mClient.performanceStats.fetchnodesKeysSerial;
+        }
+
+        saveNodeInDb_internal(node.get());
     }
 }
 
@@ -1423,6 +2313,31 @@ void NodeManager::notifyPurge()
         unsigned removed = 0;
         unsigned added = 0;
 
+        // ancestors updated here are appended to nodesToReport, so they are written to DB below
+        discountRemovedNodes(nodesToReport);
+
+        // before the changes are cleared below
+        updateRecentNodes(nodesToReport);
+
+        if (mTable && mTable->hasChangeJournal() && !mClient.fetchingnodes)
+        {
+            std::vector<DBNodeChange> changes;
+            changes.reserve(nodesToReport.size());
+            for (const auto& n : nodesToReport)
+            {
+                DBNodeChange change;
+                change.node = n->nodeHandle();
+                change.changes = n->changedMask();
+                change.scsn = mClient.scsn.getHandle();
+                changes.push_back(change);
+            }
+            mTable->appendNodeChanges(changes, MAX_JOURNAL_CHANGES);
+        }
+
+        // consecutive updates are written at once (nodesToReport keeps them alive). They're
+        // written before any removal, which looks up children in DB
+        std::vector<Node*> nodesToPut;
+
         // check all notified nodes for removed status and purge
         for (size_t i = 0; i < nodesToReport.size(); i++)
         {
@@ -1459,11 +2374,10 @@ void NodeManager::notifyPurge()
 
             if (n->changed.removed)
             {
-                NodeHandle h = n->nodeHandle();
+                putNodesInDb(nodesToPut);
+                nodesToPut.clear();
 
-                // This will also require notifying/updating parents back to the root.  Report and
-                // update them in this same operation, to ensure consistency in case of commit
-                updateTreeCounter(n->parent, n->getCounter(), DECREASE, &nodesToReport);
+                NodeHandle h = n->nodeHandle();
 
                 if (n->parent)
                 {
@@ -1481,26 +2395,34 @@ void NodeManager::notifyPurge()
                 removeFingerprint(n.get());
 
                 // effectively delete node from RAM
-                if (n->mNodePosition->second.mLRUPosition != invalidCacheLRUPos())
+                if (n->mNodePosition->second.isInCacheLRU())
                 {
-                    mCacheLRU.erase(n->mNodePosition->second.mLRUPosition);
+                    removeNodeCacheLRU_internal(n->mNodePosition->second);
                 }
 
+                mNodeShards.erase(h);
                 mNodes.erase(n->mNodePosition);
                 n->mNodePosition = mNodes.end();
 
                 mTable->remove(h);
 
+                if (mNameIndex)
+                {
+                    mNameIndex->remove(h.as8byte());
+                }
+
                 removed += 1;
             }
             else
             {
-                putNodeInDb(n.get());
+                nodesToPut.push_back(n.get());
 
                 added += 1;
             }
         }
 
+        putNodesInDb(nodesToPut);
+
         if (removed)
         {
             LOG_verbose << mClient.clientname << "Removed " << removed << " nodes from database";
@@ -1534,6 +2456,8 @@ bool NodeManager::loadNodes_internal()
         return false;
     }
 
+    rebuildFingerprintFilter();
+
     sharedNode_vector rootnodes = getRootNodes_internal();
     // We can't base in `user.sharing` because it's set yet. We have to get from DB
     sharedNode_vector inshares =
@@ -1573,6 +2497,13 @@ void NodeManager::saveNodeInRAM(std::shared_ptr<Node> node, bool isRootnode, Mis
     nodePosition->second.setNode(node);
     nodePosition->second.mAllChildrenHandleLoaded = true; // Receive a new node, children aren't received yet or they are stored a mNodesWithMissingParents
     node->mNodePosition = nodePosition;
+    mNodeShards.setNode(node->nodeHandle(), node);
+    mNodeShards.updateChildren(node->nodeHandle(), nodePosition->second);
+
+    if (mCompactNodes)
+    {
+        node->shrinkToFit();
+    }
 
     insertNodeCacheLRU_internal(node);
 
@@ -1626,6 +2557,46 @@ int NodeManager::getNumVersions(NodeHandle nodeHandle)
     return static_cast<int>(node->getCounter().versions) + 1;
 }
 
+sharedNode_vector NodeManager::getVersions(NodeHandle nodeHandle)
+{
+    LockGuard g(mMutex);
+
+    sharedNode_vector versions;
+    std::shared_ptr<Node> node = getNodeByHandle_internal(nodeHandle);
+    if (!node || node->type != FILENODE)
+    {
+        return versions;
+    }
+    versions.push_back(node);
+
+    if (!node->getCounter().versions || !mTable)
+    {
+        return versions;
+    }
+
+    std::vector<std::pair<NodeHandle, NodeSerialized>> nodesFromTable;
+    mTable->getVersions(nodeHandle, nodesFromTable);
+    for (const auto& nodeIt : nodesFromTable)
+    {
+        std::shared_ptr<Node> version;
+        auto it = mNodes.find(nodeIt.first);
+        if (it != mNodes.end())
+        {
+            version = it->second.getNodeInRam();
+        }
+
+        // newest first, so the parent of a version loaded here is already in RAM
+        if (!version && !(version = getNodeFromNodeSerialized(nodeIt.second)))
+        {
+            break;
+        }
+
+        versions.push_back(std::move(version));
+    }
+
+    return versions;
+}
+
 NodeHandle NodeManager::getRootNodeFiles() const
 {
     LockGuard g(mMutex);
@@ -1749,16 +2720,353 @@ void NodeManager::setCacheLRUMaxSize(uint64_t cacheLRUMaxSize)
 uint64_t NodeManager::getNumNodesAtCacheLRU() const
 {
     LockGuard g(mMutex);
-    return mCacheLRU.size();
+    return mCacheLRU.size() + mCacheLRUProbation.size();
 }
 
-void NodeManager::initCompleted_internal()
+uint64_t NodeManager::getCacheLRUMaxBytes() const
 {
-    assert(mMutex.owns_lock());
+    LockGuard g(mMutex);
+    return mCacheLRUMaxBytes;
+}
 
-    if (!mTable)
+void NodeManager::setCacheLRUMaxBytes(uint64_t cacheLRUMaxBytes)
+{
+    LockGuard g(mMutex);
+    mCacheLRUMaxBytes = cacheLRUMaxBytes;
+
+    // nodes are only charged while the limit is set
+    bool charge = mCacheLRUMaxBytes != std::numeric_limits<uint64_t>::max();
+    mCacheLRUBytes = 0;
+    for (auto* queue : {&mCacheLRU, &mCacheLRUProbation})
+    {
+        for (auto& node : *queue)
+        {
+            NodeManagerNode& nodeManagerNode = node->mNodePosition->second;
+            nodeManagerNode.mLRUCharge = charge ? node->getMemoryFootprint() : 0;
+            mCacheLRUBytes += nodeManagerNode.mLRUCharge;
+        }
+    }
+
+    unLoadNodeFromCacheLRU(); // check if it's necessary unload nodes
+}
+
+NodeManager::CacheLRUPolicy NodeManager::getCacheLRUPolicy() const
+{
+    LockGuard g(mMutex);
+    return mCacheLRUPolicy;
+}
+
+void NodeManager::setCacheLRUPolicy(CacheLRUPolicy policy)
+{
+    LockGuard g(mMutex);
+    mCacheLRUPolicy = policy;
+
+    if (mCacheLRUPolicy == CacheLRUPolicy::LRU)
+    {
+        // probation nodes are the least valuable ones: move them to the tail of the main queue.
+        // Iterators remain valid upon splice(), so positions at NodeManagerNode are still right
+        for (auto& node : mCacheLRUProbation)
+        {
+            node->mNodePosition->second.mLRUQueue = NodeManagerNode::LRUQueue::MAIN;
+        }
+        mCacheLRU.splice(mCacheLRU.end(), mCacheLRUProbation);
+    }
+}
+
+NodeManager::CacheLRUStats NodeManager::getCacheLRUStats() const
+{
+    LockGuard g(mMutex);
+    return mCacheLRUStats;
+}
+
+void NodeManager::setCompactNodes(bool compact)
+{
+    LockGuard g(mMutex);
+    mCompactNodes = compact;
+
+    if (mCompactNodes)
+    {
+        for (auto* queue : {&mCacheLRU, &mCacheLRUProbation})
+        {
+            for (auto& node : *queue)
+            {
+                node->shrinkToFit();
+            }
+        }
+    }
+}
+
+bool NodeManager::compactNodes() const
+{
+    LockGuard g(mMutex);
+    return mCompactNodes;
+}
+
+void NodeManager::setNameIndexEnabled(bool enabled)
+{
+    LockGuard g(mMutex);
+
+    if (!enabled)
+    {
+        mNameIndex.reset();
+        return;
+    }
+
+    if (mNameIndex || !mTable)
+    {
+        return;
+    }
+
+    std::vector<std::pair<NodeHandle, std::optional<std::string>>> names;
+    if (!mTable->getNodeNames(names))
+    {
+        LOG_err << "Failed to read node names from DB, name index not enabled";
+        return;
+    }
+
+    auto nameIndex = std::make_unique<NodeNameIndex>();
+    for (const auto& name : names)
+    {
+        nameIndex->add(name.first.as8byte(), name.second);
+    }
+    mNameIndex = std::move(nameIndex);
+
+    LOG_debug << "Name index enabled for " << mNameIndex->size() << " nodes";
+}
+
+bool NodeManager::isNameIndexEnabled() const
+{
+    LockGuard g(mMutex);
+    return mNameIndex != nullptr;
+}
+
+bool NodeManager::setNameCandidates(NodeSearchFilter& filter) const
+{
+    assert(mMutex.owns_lock());
+
+    if (!mNameIndex || !filter.hasName())
+    {
+        return true;
+    }
+
+    auto candidates = std::make_shared<std::unordered_set<handle>>();
+    if (!mNameIndex->getCandidates(filter.byName(), *candidates))
+    {
+        return true;
+    }
+
+    // with OR, nodes can still match by description or tag
+    bool nameRequired = filter.useAndForTextQuery() || (!filter.hasDescription() && !filter.hasTag());
+    if (candidates->empty() && nameRequired)
+    {
+        return false;
+    }
+
+    filter.setNameCandidates(std::move(candidates));
+    return true;
+}
+
+void NodeManager::NodeNameIndex::add(handle h, const std::optional<std::string>& name)
+{
+    remove(h);
+
+    std::vector<Trigram>& trigrams = mTrigramsByNode[h];
+    if (!name || !getTrigrams(*name, false, trigrams))
+    {
+        trigrams.clear();
+        mUnindexed.insert(h);
+        return;
+    }
+
+    for (Trigram t : trigrams)
+    {
+        mNodesByTrigram[t].insert(h);
+    }
+}
+
+void NodeManager::NodeNameIndex::remove(handle h)
+{
+    auto it = mTrigramsByNode.find(h);
+    if (it == mTrigramsByNode.end())
     {
-        assert(false);
+        return;
+    }
+
+    for (Trigram t : it->second)
+    {
+        auto nodesIt = mNodesByTrigram.find(t);
+        if (nodesIt == mNodesByTrigram.end())
+        {
+            assert(false);
+            continue;
+        }
+
+        nodesIt->second.erase(h);
+        if (nodesIt->second.empty())
+        {
+            mNodesByTrigram.erase(nodesIt);
+        }
+    }
+
+    mTrigramsByNode.erase(it);
+    mUnindexed.erase(h);
+}
+
+bool NodeManager::NodeNameIndex::getCandidates(const std::string& text, std::unordered_set<handle>& candidates) const
+{
+    std::vector<Trigram> trigrams;
+    if (!getTrigrams(text, true, trigrams) || trigrams.empty())
+    {
+        return false;
+    }
+
+    // every trigram of the literal parts of the pattern must be present in the name
+    std::vector<const std::unordered_set<handle>*> postings;
+    for (Trigram t : trigrams)
+    {
+        auto it = mNodesByTrigram.find(t);
+        if (it == mNodesByTrigram.end())
+        {
+            postings.clear();
+            break;
+        }
+        postings.push_back(&it->second);
+    }
+
+    if (!postings.empty())
+    {
+        std::sort(postings.begin(), postings.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+
+        for (handle h : *postings.front())
+        {
+            if (std::all_of(postings.begin() + 1, postings.end(), [h](const auto* p) { return p->count(h) > 0; }))
+            {
+                candidates.insert(h);
+            }
+        }
+    }
+
+    candidates.insert(mUnindexed.begin(), mUnindexed.end());
+    return true;
+}
+
+bool NodeManager::NodeNameIndex::getTrigrams(const std::string& text, bool isPattern, std::vector<Trigram>& trigrams)
+{
+    // Same folding as foldCaseAccentEqual(), hashed to 32 bits. Collisions only add candidates
+    auto fold = [](utf8proc_int32_t codePoint, uint32_t& folded)
+    {
+        std::array<utf8proc_int32_t, 8> buffer{0};
+        auto options = UTF8PROC_CASEFOLD | UTF8PROC_COMPOSE | UTF8PROC_NULLTERM | UTF8PROC_STABLE | UTF8PROC_STRIPMARK;
+        if (utf8proc_decompose_char(codePoint,
+                                    buffer.data(),
+                                    static_cast<utf8proc_ssize_t>(buffer.size()),
+                                    static_cast<utf8proc_option_t>(options),
+                                    nullptr) < 0)
+        {
+            return false;
+        }
+
+        folded = 2166136261u; // FNV-1a
+        for (utf8proc_int32_t c : buffer)
+        {
+            folded = (folded ^ static_cast<uint32_t>(c)) * 16777619u;
+        }
+        return true;
+    };
+
+    // consecutive folded characters known to be literal
+    std::vector<uint32_t> run;
+    auto flushRun = [&run, &trigrams]()
+    {
+        for (size_t i = 2; i < run.size(); ++i)
+        {
+            trigrams.push_back((static_cast<Trigram>(run[i - 2]) << 42) ^
+                               (static_cast<Trigram>(run[i - 1]) << 21) ^
+                               static_cast<Trigram>(run[i]));
+        }
+        run.clear();
+    };
+
+    auto next = reinterpret_cast<const utf8proc_uint8_t*>(text.data());
+    auto remaining = static_cast<utf8proc_ssize_t>(text.size());
+    bool escaped = false;
+    while (remaining > 0)
+    {
+        utf8proc_int32_t codePoint = 0;
+        utf8proc_ssize_t read = utf8proc_iterate(next, remaining, &codePoint);
+        if (read <= 0)
+        {
+            if (!isPattern)
+            {
+                return false;
+            }
+
+            // unknown for the pattern matching, so it breaks the literal sequence
+            flushRun();
+            read = 1;
+        }
+        else if (isPattern && escaped)
+        {
+            // escaped characters aren't folded when matching, so they break it too
+            escaped = false;
+            flushRun();
+        }
+        else if (isPattern && (codePoint == WILDCARD_MATCH_ALL || codePoint == WILDCARD_MATCH_ONE || codePoint == ESCAPE_CHARACTER))
+        {
+            escaped = codePoint == ESCAPE_CHARACTER;
+            flushRun();
+        }
+        else
+        {
+            uint32_t folded = 0;
+            if (!fold(codePoint, folded))
+            {
+                // it would match any character
+                if (!isPattern)
+                {
+                    return false;
+                }
+                flushRun();
+            }
+            else
+            {
+                run.push_back(folded);
+            }
+        }
+
+        next += read;
+        remaining -= read;
+    }
+    flushRun();
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return true;
+}
+
+uint64_t NodeManager::getMemoryUsageOfNodesAtCacheLRU() const
+{
+    LockGuard g(mMutex);
+
+    uint64_t bytes = 0;
+    for (const auto* queue : {&mCacheLRU, &mCacheLRUProbation})
+    {
+        for (const auto& node : *queue)
+        {
+            bytes += node->getMemoryFootprint();
+        }
+    }
+
+    return bytes;
+}
+
+void NodeManager::initCompleted_internal()
+{
+    assert(mMutex.owns_lock());
+
+    if (!mTable)
+    {
+        assert(false);
         return;
     }
 
@@ -1768,8 +3076,153 @@ void NodeManager::initCompleted_internal()
         calculateNodeCounter(node->nodeHandle(), TYPE_UNKNOWN, node, node->type == RUBBISHNODE);
     }
 
+    const bool bulkLoad = mInBulkLoad;
+    const auto loadEnd = std::chrono::steady_clock::now();
+    endBulkLoad_internal();
+
     mTable->createIndexes();
     mInitialized = true;
+
+    if (bulkLoad)
+    {
+        auto ms = [](std::chrono::steady_clock::duration d)
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+        };
+        LOG_info << "Bulk load of nodes into DB: " << ms(loadEnd - mBulkLoadStart)
+                 << " ms, indexes: " << ms(std::chrono::steady_clock::now() - loadEnd) << " ms";
+    }
+}
+
+void NodeManager::setBulkLoadDb(bool enable)
+{
+    LockGuard g(mMutex);
+    mBulkLoadDb = enable;
+}
+
+bool NodeManager::bulkLoadDb() const
+{
+    LockGuard g(mMutex);
+    return mBulkLoadDb;
+}
+
+void NodeManager::startBulkLoad()
+{
+    LockGuard g(mMutex);
+
+    if (!mBulkLoadDb || !mTable || mInBulkLoad)
+    {
+        return;
+    }
+
+    mTable->setBulkLoad(true);
+    mInBulkLoad = true;
+    mBulkLoadStart = std::chrono::steady_clock::now();
+}
+
+bool NodeManager::setFullTextIndexEnabled(bool enabled)
+{
+    LockGuard g(mMutex);
+
+    if (!mTable || !mTable->setFullTextIndex(enabled))
+    {
+        return false;
+    }
+
+    LOG_debug << "Full-text index " << (enabled ? "enabled" : "disabled");
+    return true;
+}
+
+bool NodeManager::isFullTextIndexEnabled() const
+{
+    LockGuard g(mMutex);
+    return mTable && mTable->hasFullTextIndex();
+}
+
+bool NodeManager::setChangeJournalEnabled(bool enabled)
+{
+    LockGuard g(mMutex);
+
+    if (!mTable || !mTable->setChangeJournal(enabled))
+    {
+        return false;
+    }
+
+    LOG_debug << "Node change journal " << (enabled ? "enabled" : "disabled");
+    return true;
+}
+
+bool NodeManager::isChangeJournalEnabled() const
+{
+    LockGuard g(mMutex);
+    return mTable && mTable->hasChangeJournal();
+}
+
+bool NodeManager::getNodeChanges(uint64_t afterSequence,
+                                 size_t limit,
+                                 std::vector<DBNodeChange>& changes,
+                                 uint64_t& lastSequence,
+                                 bool& missed)
+{
+    LockGuard g(mMutex);
+
+    uint64_t oldest = 0;
+    lastSequence = 0;
+    missed = false;
+    if (!mTable || !mTable->getNodeChanges(afterSequence, limit, changes, oldest, lastSequence))
+    {
+        return false;
+    }
+
+    // sequences survive disabling the journal, so past the last one means the local cache
+    // was created again, and behind it with nothing after the cursor means entries were lost
+    missed = afterSequence > lastSequence ||
+             (oldest ? afterSequence + 1 < oldest : afterSequence < lastSequence);
+    return true;
+}
+
+DBReadPoolStats NodeManager::getDbReadPoolStats(bool reset)
+{
+    LockGuard g(mMutex);
+    return mTable ? mTable->getReadPoolStats(reset) : DBReadPoolStats();
+}
+
+void NodeManager::setDbBlobCompression(bool enable)
+{
+    LockGuard g(mMutex);
+    mDbBlobCompression = enable;
+    if (mTable)
+    {
+        mTable->setBlobCompression(enable);
+    }
+}
+
+bool NodeManager::dbBlobCompression() const
+{
+    LockGuard g(mMutex);
+    return mDbBlobCompression;
+}
+
+DBBlobStats NodeManager::getDbBlobStats(bool reset)
+{
+    LockGuard g(mMutex);
+    return mTable ? mTable->getBlobStats(reset) : DBBlobStats();
+}
+
+void NodeManager::endBulkLoad_internal()
+{
+    assert(mMutex.owns_lock());
+
+    if (!mInBulkLoad)
+    {
+        return;
+    }
+
+    if (mTable)
+    {
+        mTable->setBulkLoad(false);
+    }
+    mInBulkLoad = false;
 }
 
 bool NodeManager::ready()
@@ -1780,12 +3233,27 @@ bool NodeManager::ready()
 void NodeManager::insertNodeCacheLRU_internal(std::shared_ptr<Node> node)
 {
     assert(mMutex.owns_lock() && "Mutex should be locked by this thread");
-    if (node->mNodePosition->second.mLRUPosition != mCacheLRU.end())
+    NodeManagerNode& nodeManagerNode = node->mNodePosition->second;
+
+    bool reused = nodeManagerNode.isInCacheLRU();
+    if (reused)
+    {
+        ++mCacheLRUStats.hits;
+        removeNodeCacheLRU_internal(nodeManagerNode);
+    }
+
+    // with 2Q, nodes have to be used twice while cached to get into the main queue
+    bool probation = !reused && mCacheLRUPolicy == CacheLRUPolicy::TWO_QUEUES;
+    nodeManagerNode.mLRUQueue = probation ? NodeManagerNode::LRUQueue::PROBATION : NodeManagerNode::LRUQueue::MAIN;
+    auto& queue = probation ? mCacheLRUProbation : mCacheLRU;
+    nodeManagerNode.mLRUPosition = queue.insert(queue.begin(), node);
+
+    if (mCacheLRUMaxBytes != std::numeric_limits<uint64_t>::max())
     {
-        mCacheLRU.erase(node->mNodePosition->second.mLRUPosition);
+        nodeManagerNode.mLRUCharge = node->getMemoryFootprint();
+        mCacheLRUBytes += nodeManagerNode.mLRUCharge;
     }
 
-    node->mNodePosition->second.mLRUPosition = mCacheLRU.insert(mCacheLRU.begin(), node);
     unLoadNodeFromCacheLRU(); // check if it's necessary unload nodes
 
     // setfingerprint again to force to insert into NodeManager::mFingerPrints
@@ -1796,16 +3264,78 @@ void NodeManager::insertNodeCacheLRU_internal(std::shared_ptr<Node> node)
     }
 }
 
+void NodeManager::tryInsertNodeCacheLRU(const std::shared_ptr<Node>& node)
+{
+    // recency is only a hint for eviction: if the client thread holds the mutex, skip it
+    std::unique_lock<MutexType> g(mMutex, std::try_to_lock);
+    if (g.owns_lock() && node->mNodePosition != mNodes.end())
+    {
+        insertNodeCacheLRU_internal(node);
+    }
+}
+
 void NodeManager::unLoadNodeFromCacheLRU()
 {
     assert(mMutex.owns_lock() && "Mutex should be locked by this thread");
-    while (mCacheLRU.size() > mCacheLRUMaxSize)
+    while (isCacheLRUOverLimits())
+    {
+        evictNodeCacheLRU_internal();
+    }
+}
+
+void NodeManager::evictNodeCacheLRU_internal()
+{
+    assert(mMutex.owns_lock() && "Mutex should be locked by this thread");
+
+    // simplified 2Q: probation is evicted first while it holds more than a quarter of the nodes
+    size_t numNodes = mCacheLRU.size() + mCacheLRUProbation.size();
+    assert(numNodes);
+    bool fromProbation = !mCacheLRUProbation.empty()
+                         && (mCacheLRU.empty() || mCacheLRUProbation.size() * 4 > numNodes);
+    std::shared_ptr<Node> node = fromProbation ? mCacheLRUProbation.back() : mCacheLRU.back();
+    removeFingerprint(node.get(), true);
+    removeNodeCacheLRU_internal(node->mNodePosition->second);
+    ++mCacheLRUStats.evictions;
+}
+
+void NodeManager::releaseMemory(uint64_t keepNodes)
+{
+    LockGuard g(mMutex);
+
+    uint64_t before = mCacheLRU.size() + mCacheLRUProbation.size();
+    while (mCacheLRU.size() + mCacheLRUProbation.size() > keepNodes)
     {
-        std::shared_ptr<Node> node = mCacheLRU.back();
-        removeFingerprint(node.get(), true);
-        node->mNodePosition->second.mLRUPosition = invalidCacheLRUPos();
-        mCacheLRU.pop_back();
+        evictNodeCacheLRU_internal();
     }
+
+    mChildLookups.clear();
+    mAncestorLookups.clear();
+    mRecentNodesValid = false;
+    mRecentNodes.clear();
+
+    LOG_debug << "Memory released from cache LRU: " << before - (mCacheLRU.size() + mCacheLRUProbation.size())
+              << " nodes unloaded, " << mCacheLRU.size() + mCacheLRUProbation.size() << " kept";
+}
+
+void NodeManager::removeNodeCacheLRU_internal(NodeManagerNode& nodeManagerNode)
+{
+    assert(mMutex.owns_lock() && "Mutex should be locked by this thread");
+    assert(nodeManagerNode.isInCacheLRU());
+
+    auto& queue = nodeManagerNode.mLRUQueue == NodeManagerNode::LRUQueue::PROBATION ? mCacheLRUProbation : mCacheLRU;
+    queue.erase(nodeManagerNode.mLRUPosition);
+    nodeManagerNode.mLRUQueue = NodeManagerNode::LRUQueue::NONE;
+
+    assert(mCacheLRUBytes >= nodeManagerNode.mLRUCharge);
+    mCacheLRUBytes -= nodeManagerNode.mLRUCharge;
+    nodeManagerNode.mLRUCharge = 0;
+}
+
+bool NodeManager::isCacheLRUOverLimits() const
+{
+    assert(mMutex.owns_lock() && "Mutex should be locked by this thread");
+    size_t numNodes = mCacheLRU.size() + mCacheLRUProbation.size();
+    return numNodes && (numNodes > mCacheLRUMaxSize || mCacheLRUBytes > mCacheLRUMaxBytes);
 }
 
 NodeCounter NodeManager::getCounterOfRootNodes()
@@ -1850,8 +3380,9 @@ void NodeManager::updateCounter_internal(std::shared_ptr<Node> n, std::shared_pt
 {
     assert(mMutex.owns_lock());
 
-    NodeCounter nc = n->getCounter();
-    updateTreeCounter(oldParent, nc, DECREASE, nullptr);
+    NodeCounter oldCounter = n->getCounter();
+    NodeCounter nc = oldCounter;
+    bool counterChanged = false;
 
     // if node is a new version
     if (n->parent && n->parent->type == FILENODE)
@@ -1865,6 +3396,7 @@ void NodeManager::updateCounter_internal(std::shared_ptr<Node> n, std::shared_pt
             nc.versions++;
             nc.versionStorage += n->size;
             setNodeCounter(n, nc, true, nullptr);
+            counterChanged = true;
         }
     }
     // newest element at chain versions has been removed, the second one element is the newest now. Update node counter properly
@@ -1875,9 +3407,22 @@ void NodeManager::updateCounter_internal(std::shared_ptr<Node> n, std::shared_pt
         nc.versions--;
         nc.versionStorage -= n->size;
         setNodeCounter(n, nc, true, nullptr);
+        counterChanged = true;
     }
 
-    updateTreeCounter(n->parent, nc, INCREASE, nullptr);
+    // Below the closest common ancestor of both locations, the old branch loses the whole old
+    // counter and the new one gains the new counter. From there up to the root, ancestors only
+    // change by the difference between both counters (nothing for plain moves)
+    std::shared_ptr<Node> commonAncestor = getClosestCommonAncestor(oldParent, n->parent);
+    updateTreeCounter(oldParent, oldCounter, DECREASE, nullptr, commonAncestor.get());
+    updateTreeCounter(n->parent, nc, INCREASE, nullptr, commonAncestor.get());
+
+    if (commonAncestor && counterChanged)
+    {
+        NodeCounter diff = nc;
+        diff -= oldCounter;
+        updateTreeCounter(commonAncestor, diff, INCREASE, nullptr);
+    }
 }
 
 FingerprintPosition NodeManager::insertFingerprint(Node *node)
@@ -1890,6 +3435,11 @@ FingerprintPosition NodeManager::insertFingerprint_internal(Node *node)
 {
     assert(mMutex.owns_lock());
 
+    if (node->type == FILENODE)
+    {
+        addToFingerprintFilter(*node);
+    }
+
     // if node is not to be kept in memory, don't save the pointer in the set
     // since it will be invalid once node is written to DB
     if (node->type == FILENODE && mNodeToWriteInDb.get() != node)
@@ -1910,6 +3460,9 @@ void NodeManager::removeFingerprint_internal(Node *node, bool unloadNode)
 {
     assert(mMutex.owns_lock());
 
+    // mFingerprintFilter isn't updated: unloaded nodes are still in DB, and removed ones stay
+    // in it until the next rebuild
+
     if (node->type == FILENODE && node->mFingerPrintPosition != mFingerPrints.end())  // remove from mFingerPrints
     {
         mFingerPrints.erase(node->mFingerPrintPosition);
@@ -1929,12 +3482,6 @@ FingerprintPosition NodeManager::invalidFingerprintPos()
     return mFingerPrints.end();
 }
 
-std::list<std::shared_ptr<Node> >::const_iterator NodeManager::invalidCacheLRUPos() const
-{
-    // no locking for this one, it returns a constant
-    return mCacheLRU.end();
-}
-
 void NodeManager::dumpNodes()
 {
     LockGuard g(mMutex);
@@ -1951,14 +3498,30 @@ void NodeManager::dumpNodes_internal()
         return;
     }
 
+    // written in batches, which also keep them alive until then
+    sharedNode_vector batch;
+    std::vector<Node*> batchNodes;
+    auto putBatch = [this, &batch, &batchNodes]()
+    {
+        putNodesInDb(batchNodes);
+        batchNodes.clear();
+        batch.clear();
+    };
+
     for (auto &it : mNodes)
     {
         shared_ptr<Node> node = getNodeFromNodeManagerNode(it.second);
         if (node)
         {
-            putNodeInDb(node.get());
+            batchNodes.push_back(node.get());
+            batch.push_back(std::move(node));
+            if (batch.size() == PARALLEL_BATCH_SIZE)
+            {
+                putBatch();
+            }
         }
     }
+    putBatch();
 
     mTable->createIndexes();
     mInitialized = true;
@@ -2021,6 +3584,7 @@ void NodeManager::addChild_internal(NodeHandle parent, NodeHandle child, Node* n
     }
 
     (*pair.first->second.mChildren)[child] = nodeManagerNode;
+    mNodeShards.updateChildren(parent, pair.first->second);
 }
 
 void NodeManager::removeChild(Node* parent, NodeHandle child)
@@ -2037,6 +3601,7 @@ void NodeManager::removeChild_internal(Node* parent, NodeHandle child)
     if (parent->mNodePosition->second.mChildren)
     {
         parent->mNodePosition->second.mChildren->erase(child);
+        mNodeShards.updateChildren(parent->nodeHandle(), parent->mNodePosition->second);
     }
 }
 
@@ -2140,27 +3705,213 @@ sharedNode_vector NodeManager::processUnserializedNodes(const std::vector<std::p
     return nodes;
 }
 
-void NodeManager::putNodeInDb(Node* node) const
+void NodeManager::putNodeInDb(Node* node)
 {
     if (!node)
     {
         return;
     }
 
-    if (node->attrstring)
+    prepareNodeForDb(*node);
+    mTable->put(node);
+    nodeStoredInDb(*node);
+}
+
+void NodeManager::putNodesInDb(const std::vector<Node*>& nodes)
+{
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    for (Node* node : nodes)
+    {
+        prepareNodeForDb(*node);
+    }
+
+    mTable->put(nodes);
+
+    for (Node* node : nodes)
+    {
+        nodeStoredInDb(*node);
+    }
+}
+
+void NodeManager::prepareNodeForDb(Node& node)
+{
+    if (node.attrstring)
     {
         // Last attempt to decrypt the node before storing it.
         LOG_debug << "Trying to store an encrypted node";
-        node->applykey();
-        node->setattr();
+        node.applykey();
+        node.setattr();
 
-        if (node->attrstring)
+        if (node.attrstring)
         {
             LOG_debug << "Storing an encrypted node.";
         }
     }
+}
 
-    mTable->put(node);
+void NodeManager::nodeStoredInDb(const Node& node)
+{
+    addToFingerprintFilter(node);
+
+    if (mNameIndex)
+    {
+        mNameIndex->add(node.nodehandle, std::string(node.displayname()));
+    }
+}
+
+void NodeManager::rebuildFingerprintFilter()
+{
+    assert(mMutex.owns_lock());
+
+    mFingerprintFilter.disable();
+    if (!mTable)
+    {
+        return;
+    }
+
+    std::vector<uint64_t> hashes;
+    if (!mTable->getFingerprints([&hashes](const std::string& fingerprint)
+                                 {
+                                     hashes.push_back(FingerprintFilter::hash(fingerprint));
+                                 }))
+    {
+        LOG_err << "Failed to read fingerprints from DB, fingerprint filter disabled";
+        return;
+    }
+
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+    mFingerprintFilter.reset(hashes.size() * 2);
+    for (uint64_t hash : hashes)
+    {
+        mFingerprintFilter.add(hash);
+    }
+
+    LOG_debug << "Fingerprint filter built for " << hashes.size() << " fingerprints";
+}
+
+void NodeManager::addToFingerprintFilter(const Node& node)
+{
+    assert(mMutex.owns_lock());
+
+    if (!mFingerprintFilter.isEnabled())
+    {
+        return;
+    }
+
+    std::string fingerprint;
+    node.FileFingerprint::serialize(&fingerprint);
+    mFingerprintFilter.add(fingerprint);
+
+    if (mFingerprintFilter.isOverloaded())
+    {
+        rebuildFingerprintFilter();
+    }
+}
+
+double NodeManager::getFingerprintFilterFalsePositiveRate() const
+{
+    LockGuard g(mMutex);
+    return mFingerprintFilter.falsePositiveRate();
+}
+
+void NodeManager::FingerprintFilter::reset(size_t expectedEntries)
+{
+    mCapacity = std::max(expectedEntries, MIN_CAPACITY);
+    mNumBits = mCapacity * BITS_PER_ENTRY;
+    mBits.assign((mNumBits + 63) / 64, 0);
+    mBitsSet = 0;
+    mEntries = 0;
+}
+
+void NodeManager::FingerprintFilter::disable()
+{
+    mBits.clear();
+    mBits.shrink_to_fit();
+    mNumBits = 0;
+    mBitsSet = 0;
+    mCapacity = 0;
+    mEntries = 0;
+}
+
+void NodeManager::FingerprintFilter::add(const std::string& fingerprint)
+{
+    add(hash(fingerprint));
+}
+
+void NodeManager::FingerprintFilter::add(uint64_t hash)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    // double hashing: the k positions are h1 + i * h2
+    const uint64_t h1 = hash;
+    const uint64_t h2 = (hash >> 32) | 1;
+    bool newBits = false;
+    for (unsigned i = 0; i < NUM_HASHES; ++i)
+    {
+        const size_t bit = static_cast<size_t>((h1 + i * h2) % mNumBits);
+        uint64_t& word = mBits[bit / 64];
+        const uint64_t mask = uint64_t(1) << (bit % 64);
+        if (!(word & mask))
+        {
+            word |= mask;
+            ++mBitsSet;
+            newBits = true;
+        }
+    }
+
+    if (newBits)
+    {
+        ++mEntries;
+    }
+}
+
+bool NodeManager::FingerprintFilter::mightContain(const std::string& fingerprint) const
+{
+    if (!isEnabled())
+    {
+        return true;
+    }
+
+    const uint64_t h1 = hash(fingerprint);
+    const uint64_t h2 = (h1 >> 32) | 1;
+    for (unsigned i = 0; i < NUM_HASHES; ++i)
+    {
+        const size_t bit = static_cast<size_t>((h1 + i * h2) % mNumBits);
+        if (!(mBits[bit / 64] & (uint64_t(1) << (bit % 64))))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+double NodeManager::FingerprintFilter::falsePositiveRate() const
+{
+    if (!isEnabled())
+    {
+        return 1.0;
+    }
+
+    return std::pow(static_cast<double>(mBitsSet) / static_cast<double>(mNumBits), NUM_HASHES);
+}
+
+uint64_t NodeManager::FingerprintFilter::hash(const std::string& fingerprint)
+{
+    // std::hash may be weak (or 32 bits), so mix it (splitmix64 finalizer)
+    uint64_t h = static_cast<uint64_t>(std::hash<std::string>{}(fingerprint));
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
 }
 
 size_t NodeManager::nodeNotifySize() const
@@ -2190,6 +3941,71 @@ void NodeManager::FingerprintContainer::clear()
     mAllFingerprintsLoaded.clear();
 }
 
+std::shared_ptr<Node> NodeManager::NodeShards::getNode(NodeHandle h) const
+{
+    const Shard& s = shard(h);
+    std::shared_lock<std::shared_mutex> g(s.mMutex);
+    auto it = s.mEntries.find(h);
+    return it != s.mEntries.end() ? it->second.mNode.lock() : nullptr;
+}
+
+bool NodeManager::NodeShards::getNumChildren(NodeHandle h, size_t& numChildren) const
+{
+    const Shard& s = shard(h);
+    std::shared_lock<std::shared_mutex> g(s.mMutex);
+    auto it = s.mEntries.find(h);
+    if (it == s.mEntries.end() || !it->second.mAllChildrenKnown)
+    {
+        return false;
+    }
+
+    numChildren = it->second.mNumChildren;
+    return true;
+}
+
+void NodeManager::NodeShards::setNode(NodeHandle h, const std::shared_ptr<Node>& node)
+{
+    Shard& s = shard(h);
+    std::unique_lock<std::shared_mutex> g(s.mMutex);
+    s.mEntries[h].mNode = node;
+}
+
+void NodeManager::NodeShards::updateChildren(NodeHandle h, const NodeManagerNode& nodeManagerNode)
+{
+    Shard& s = shard(h);
+    std::unique_lock<std::shared_mutex> g(s.mMutex);
+    Entry& entry = s.mEntries[h];
+    entry.mAllChildrenKnown = nodeManagerNode.mAllChildrenHandleLoaded;
+    entry.mNumChildren = nodeManagerNode.mChildren ? nodeManagerNode.mChildren->size() : 0;
+}
+
+void NodeManager::NodeShards::erase(NodeHandle h)
+{
+    Shard& s = shard(h);
+    std::unique_lock<std::shared_mutex> g(s.mMutex);
+    s.mEntries.erase(h);
+}
+
+void NodeManager::NodeShards::clear()
+{
+    for (auto& s : mShards)
+    {
+        std::unique_lock<std::shared_mutex> g(s.mMutex);
+        s.mEntries.clear();
+    }
+}
+
+NodeManager::NodeShards::Shard& NodeManager::NodeShards::shard(NodeHandle h)
+{
+    // handles are random: the lowest bits are as good as any hash
+    return mShards[h.as8byte() % NUM_SHARDS];
+}
+
+const NodeManager::NodeShards::Shard& NodeManager::NodeShards::shard(NodeHandle h) const
+{
+    return mShards[h.as8byte() % NUM_SHARDS];
+}
+
 void NodeManager::Rootnodes::clear()
 {
     mRootNodes.clear();
@@ -27,6 +27,7 @@
 #endif // ! __APPLE__
 
 #include "mega.h"
+#include "mega/posix/megaiouring.h"
 #include "mega/scoped_helpers.h"
 
 #include <sys/ioctl.h>
@@ -38,6 +39,10 @@
 #include "mega/osx/osxutils.h"
 #endif
 
+#if defined(__APPLE__) && defined(HAVE_AIO_RT)
+#include <dispatch/dispatch.h>
+#endif
+
 #ifdef __ANDROID__
 #include <jni.h>
 extern JavaVM *MEGAjvm;
@@ -53,6 +58,7 @@ extern JavaVM *MEGAjvm;
 #include <linux/magic.h>
 #endif /* ! __ANDROID__ */
 
+#include <sys/syscall.h>
 #include <sys/sysmacros.h>
 #include <sys/vfs.h>
 
@@ -104,9 +110,15 @@ extern JavaVM *MEGAjvm;
 #define SMB2_MAGIC_NUMBER 0xfe534d42ul
 #endif // ! SMB2_MAGIC_NUMBER
 
+// <linux/fs.h> clashes with <sys/mount.h> on older glibc
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif // ! FICLONE
+
 #endif /* __linux__ */
 
 #if defined(__APPLE__) || defined(USE_IOS)
+#include <sys/clonefile.h>
 #include <sys/mount.h>
 #include <sys/param.h>
 #endif /* __APPLE__ || USE_IOS */
@@ -227,7 +239,7 @@ PosixAsyncIOContext::~PosixAsyncIOContext()
 
 void PosixAsyncIOContext::finish()
 {
-    if (aiocb)
+    if (aiocb || inflight)
     {
         if (!finished)
         {
@@ -337,10 +349,7 @@ void PosixFileAccess::sysclose()
 bool PosixFileAccess::asyncavailable()
 {
 #ifdef HAVE_AIO_RT
-    #ifdef __APPLE__
-        return false;
-    #endif
-
+    // on Apple the operations go through dispatch, its AIO limits are far too low
     return true;
 #else
     return false;
@@ -359,13 +368,18 @@ void PosixFileAccess::asyncopfinished(sigval sigev_value)
     struct aiocb *aiocbp = context->aiocb;
     int e = aio_error(aiocbp);
     assert (e != EINPROGRESS);
-    context->retry = (e == EAGAIN);
-    context->failed = (aio_return(aiocbp) < 0);
+    asyncopcompleted(context, aio_return(aiocbp) < 0 ? (e ? e : EIO) : 0);
+}
+
+void PosixFileAccess::asyncopcompleted(PosixAsyncIOContext* context, int error)
+{
+    context->retry = (error == EAGAIN);
+    context->failed = error != 0;
     if (!context->failed)
     {
         if (context->op == AsyncIOContext::READ && context->pad)
         {
-            memset((void *)(((char *)(aiocbp->aio_buf)) + aiocbp->aio_nbytes), 0, context->pad);
+            memset(context->dataBuffer + context->dataBufferLen, 0, context->pad);
             LOG_verbose << "Async read finished OK";
         }
         else
@@ -375,7 +389,7 @@ void PosixFileAccess::asyncopfinished(sigval sigev_value)
     }
     else
     {
-        LOG_warn << "Async operation finished with error: " << e;
+        LOG_warn << "Async operation finished with error: " << error;
     }
 
     asyncfscallback userCallback = context->userCallback;
@@ -386,29 +400,9 @@ void PosixFileAccess::asyncopfinished(sigval sigev_value)
         userCallback(userData);
     }
 }
-#endif
-
-void PosixFileAccess::asyncsysopen([[maybe_unused]] AsyncIOContext *context)
-{
-#ifdef HAVE_AIO_RT
-    context->failed = !fopen(context->openPath, context->access & AsyncIOContext::ACCESS_READ,
-                             context->access & AsyncIOContext::ACCESS_WRITE, FSLogging::logOnError);
-    if (context->failed)
-    {
-        LOG_err << "Failed to fopen('" << context->openPath << "'): error " << errorcode << ": " << PosixFileSystemAccess::getErrorMessage(errorcode);
-    }
-    context->retry = retry;
-    context->finished = true;
-    if (context->userCallback)
-    {
-        context->userCallback(context->userData);
-    }
-#endif
-}
 
-void PosixFileAccess::asyncsysread([[maybe_unused]] AsyncIOContext *context)
+void PosixFileAccess::asyncsysop(AsyncIOContext* context, bool write)
 {
-#ifdef HAVE_AIO_RT
     if (!context)
     {
         return;
@@ -427,54 +421,52 @@ void PosixFileAccess::asyncsysread([[maybe_unused]] AsyncIOContext *context)
         return;
     }
 
-    struct aiocb *aiocbp = new struct aiocb;
-    memset(aiocbp, 0, sizeof (struct aiocb));
-
-    aiocbp->aio_fildes = fd;
-    aiocbp->aio_buf = (void *)posixContext->dataBuffer;
-    aiocbp->aio_nbytes = posixContext->dataBufferLen;
-    aiocbp->aio_offset = posixContext->posOfBuffer;
-    aiocbp->aio_sigevent.sigev_notify = SIGEV_THREAD;
-    aiocbp->aio_sigevent.sigev_notify_function = asyncopfinished;
-    aiocbp->aio_sigevent.sigev_value.sival_ptr = (void *)posixContext;
-    posixContext->aiocb = aiocbp;
-    if (aio_read(aiocbp))
+#if defined(__APPLE__)
+    posixContext->inflight = true;
+    posixContext->fd = fd;
+    dispatch_async_f(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), posixContext, [](void* p)
     {
-        posixContext->retry = (errno == EAGAIN);
-        posixContext->failed = true;
-        posixContext->finished = true;
-        posixContext->aiocb = NULL;
-        delete aiocbp;
+        auto c = static_cast<PosixAsyncIOContext*>(p);
+        byte* buf = c->dataBuffer;
+        size_t remaining = c->dataBufferLen;
+        off_t pos = static_cast<off_t>(c->posOfBuffer);
+        int error = 0;
 
-        LOG_warn << "Async read failed at startup:" << errno;
-        if (posixContext->userCallback)
+        while (remaining)
         {
-            posixContext->userCallback(posixContext->userData);
+            ssize_t n = c->op == AsyncIOContext::WRITE ? pwrite(c->fd, buf, remaining, pos)
+                                                       : pread(c->fd, buf, remaining, pos);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                // a short read at the end of the file is fine, as with AIO
+                error = n < 0 ? errno : (c->op == AsyncIOContext::WRITE ? EIO : 0);
+                break;
+            }
+            buf += n;
+            pos += n;
+            remaining -= static_cast<size_t>(n);
         }
-    }
-#endif
-}
-
-void PosixFileAccess::asyncsyswrite([[maybe_unused]] AsyncIOContext *context)
-{
-#ifdef HAVE_AIO_RT
-    if (!context)
-    {
-        return;
-    }
-
-    PosixAsyncIOContext *posixContext = dynamic_cast<PosixAsyncIOContext*>(context);
-    if (!posixContext)
-    {
-        context->failed = true;
-        context->retry = false;
-        context->finished = true;
-        if (context->userCallback)
+        asyncopcompleted(c, error);
+    });
+    return;
+#elif defined(__linux__) && defined(HAVE_LINUX_IO_URING_H)
+    if (IoUring* ring = IoUring::instance())
+    {
+        posixContext->inflight = true;
+        if (!ring->submit(write, fd, posixContext->dataBuffer, posixContext->dataBufferLen, posixContext->posOfBuffer,
+                          [](void* p, int result) { asyncopcompleted(static_cast<PosixAsyncIOContext*>(p), result < 0 ? -result : 0); },
+                          posixContext))
         {
-            context->userCallback(context->userData);
+            LOG_warn << "Async " << (write ? "write" : "read") << " failed at startup: " << errno;
+            asyncopcompleted(posixContext, errno);
         }
         return;
     }
+#endif
 
     struct aiocb *aiocbp = new struct aiocb;
     memset(aiocbp, 0, sizeof (struct aiocb));
@@ -488,20 +480,47 @@ void PosixFileAccess::asyncsyswrite([[maybe_unused]] AsyncIOContext *context)
     aiocbp->aio_sigevent.sigev_value.sival_ptr = (void *)posixContext;
     posixContext->aiocb = aiocbp;
 
-    if (aio_write(aiocbp))
+    if (write ? aio_write(aiocbp) : aio_read(aiocbp))
     {
-        posixContext->retry = (errno == EAGAIN);
-        posixContext->failed = true;
-        posixContext->finished = true;
+        int e = errno;
         posixContext->aiocb = NULL;
         delete aiocbp;
 
-        LOG_warn << "Async write failed at startup: " << errno;
-        if (posixContext->userCallback)
-        {
-            posixContext->userCallback(posixContext->userData);
-        }
+        LOG_warn << "Async " << (write ? "write" : "read") << " failed at startup: " << e;
+        asyncopcompleted(posixContext, e);
     }
+}
+#endif
+
+void PosixFileAccess::asyncsysopen([[maybe_unused]] AsyncIOContext *context)
+{
+#ifdef HAVE_AIO_RT
+    context->failed = !fopen(context->openPath, context->access & AsyncIOContext::ACCESS_READ,
+                             context->access & AsyncIOContext::ACCESS_WRITE, FSLogging::logOnError);
+    if (context->failed)
+    {
+        LOG_err << "Failed to fopen('" << context->openPath << "'): error " << errorcode << ": " << PosixFileSystemAccess::getErrorMessage(errorcode);
+    }
+    context->retry = retry;
+    context->finished = true;
+    if (context->userCallback)
+    {
+        context->userCallback(context->userData);
+    }
+#endif
+}
+
+void PosixFileAccess::asyncsysread([[maybe_unused]] AsyncIOContext *context)
+{
+#ifdef HAVE_AIO_RT
+    asyncsysop(context, false);
+#endif
+}
+
+void PosixFileAccess::asyncsyswrite([[maybe_unused]] AsyncIOContext *context)
+{
+#ifdef HAVE_AIO_RT
+    asyncsysop(context, true);
 #endif
 }
 
@@ -590,6 +609,47 @@ bool PosixFileAccess::ftruncate(m_off_t size)
     return false;
 }
 
+bool PosixFileAccess::fpreallocate(m_off_t size)
+{
+    retry = false;
+
+#if defined(__linux__)
+    if (::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size) == 0)
+    {
+        return true;
+    }
+#elif defined(__APPLE__)
+    fstore_t store = {F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, size, 0};
+
+    // Fall back to a fragmented allocation if there's no contiguous run that big.
+    if (fcntl(fd, F_PREALLOCATE, &store) != -1
+        || (store.fst_flags = F_ALLOCATEALL, fcntl(fd, F_PREALLOCATE, &store) != -1))
+    {
+        return true;
+    }
+#else
+    static_cast<void>(size);
+    errno = ENOTSUP;
+#endif
+
+    errorcode = errno;
+    return false;
+}
+
+bool PosixFileAccess::fsparse(m_off_t size)
+{
+    retry = false;
+
+    // Every filesystem we care about leaves the extended range as a hole.
+    if (::ftruncate(fd, size) == 0)
+    {
+        return true;
+    }
+
+    errorcode = errno;
+    return false;
+}
+
 int PosixFileAccess::stealFileDescriptor()
 {
     int toret = fd;
@@ -597,6 +657,11 @@ int PosixFileAccess::stealFileDescriptor()
     return toret;
 }
 
+int PosixFileAccess::fileDescriptor() const
+{
+    return fd;
+}
+
 bool PosixFileAccess::fopen(const LocalPath& f,
                             bool read,
                             bool write,
@@ -821,8 +886,79 @@ PosixFileSystemAccess::PosixFileSystemAccess()
 #ifdef __linux__
 #ifdef ENABLE_SYNC
 
+#ifdef USE_FANOTIFY
+
+// What we want to hear about, anywhere on a marked filesystem.
+static const uint64_t FANOTIFY_EVENTS = FAN_ATTRIB
+                                        | FAN_CLOSE_WRITE
+                                        | FAN_CREATE
+                                        | FAN_DELETE
+                                        | FAN_MOVED_FROM
+                                        | FAN_MOVED_TO
+                                        | FAN_ONDIR;
+
+// Identifies a folder as fanotify reports it: filesystem ID, handle type and handle.
+static string fanotifyKey(const void* fsid, const file_handle& handle)
+{
+    static_assert(sizeof(fsid_t) == sizeof(__kernel_fsid_t), "Filesystem IDs differ in size");
+
+    string key(static_cast<const char*>(fsid), sizeof(fsid_t));
+
+    key.append(reinterpret_cast<const char*>(&handle.handle_type), sizeof(handle.handle_type));
+    key.append(reinterpret_cast<const char*>(handle.f_handle), handle.handle_bytes);
+
+    return key;
+}
+
+// Empty if the folder has no (exportable) file handle.
+static string fanotifyKey(const char* path)
+{
+    struct statfs statbuf;
+
+    if (statfs(path, &statbuf))
+        return string();
+
+    alignas(file_handle) char buffer[sizeof(file_handle) + MAX_HANDLE_SZ];
+    auto& handle = *reinterpret_cast<file_handle*>(buffer);
+    int mountId;
+
+    handle.handle_bytes = MAX_HANDLE_SZ;
+
+    if (name_to_handle_at(AT_FDCWD, path, &handle, &mountId, 0))
+        return string();
+
+    return fanotifyKey(&statbuf.f_fsid, handle);
+}
+
+#endif // USE_FANOTIFY
+
 bool LinuxFileSystemAccess::initFilesystemNotificationSystem()
 {
+#ifdef USE_FANOTIFY
+    // One descriptor for every folder, if we may mark whole filesystems.
+    mNotifyFd = fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_CLOEXEC | FAN_NONBLOCK,
+                              O_RDONLY | O_LARGEFILE);
+
+    if (mNotifyFd >= 0)
+    {
+        // Removing a mark that isn't there tells whether we're allowed to (ENOENT) or not (EPERM.)
+        if (fanotify_mark(mNotifyFd, FAN_MARK_REMOVE | FAN_MARK_FILESYSTEM, FANOTIFY_EVENTS, AT_FDCWD, "/")
+            && errno == EPERM)
+        {
+            close(mNotifyFd);
+            mNotifyFd = -EPERM;
+        }
+        else
+        {
+            LOG_info << "Filesystem notifications through fanotify";
+            return mFanotify = true, true;
+        }
+    }
+
+    LOG_info << "Unable to use fanotify, falling back to inotify. Error: "
+             << (mNotifyFd < 0 ? -mNotifyFd : errno);
+#endif // USE_FANOTIFY
+
     mNotifyFd = inotify_init1(IN_NONBLOCK);
 
     if (mNotifyFd < 0)
@@ -896,6 +1032,139 @@ void LinuxFileSystemAccess::addevents([[maybe_unused]] Waiter* waiter, int /*fla
 #endif // ENABLE_SYNC
 }
 
+#ifdef ENABLE_SYNC
+
+// queue a notification for every node watched under handle
+int LinuxFileSystemAccess::notifyWatches(int handle, const string& name, bool deletedSelf, bool permissionsChanged)
+{
+    int result = 0;
+
+    // Loop over and notify all associated nodes.
+    auto associated = mWatches.equal_range(handle);
+
+    for (auto i = associated.first; i != associated.second;)
+    {
+        // Convenience.
+        using std::move;
+        auto& node = *i->second.first;
+        auto& sync = *node.sync;
+        auto& notifier = *sync.dirnotify;
+
+        LOG_debug << "Filesystem notification:"
+            << " Root: "
+            << node.localname
+            << " Path: "
+            << name;
+
+        if (deletedSelf)
+        {
+            // The FS directory watched is gone
+            node.mWatchHandle.invalidate();
+            // Remove it from the container (C++11 and up)
+            i = mWatches.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+
+        auto localName = LocalPath::fromPlatformEncodedRelative(name);
+        notifier.notify(notifier.fsEventq,
+                        &node,
+                        Notification::NEEDS_PARENT_SCAN,
+                        std::move(localName));
+
+        // We need to rescan the directory if it's changed permissions.
+        //
+        // The reason for this is that we may not have been able to list
+        // the directory's contents before. If we didn't rescan, we
+        // wouldn't notice these files until some other event is
+        // triggered in or below this directory.
+        if (permissionsChanged)
+            notifier.notify(notifier.fsEventq,
+                            &node,
+                            Notification::FOLDER_NEEDS_SELF_SCAN,
+                            LocalPath::fromPlatformEncodedRelative(name));
+
+        result |= Waiter::NEEDEXEC;
+    }
+
+    return result;
+}
+
+#ifdef USE_FANOTIFY
+
+// read all pending fanotify events and queue those of watched folders
+int LinuxFileSystemAccess::checkFanotifyEvents()
+{
+    int result = 0;
+
+    alignas(fanotify_event_metadata) char buf[8192];
+    ssize_t l;
+
+    while ((l = read(mNotifyFd, buf, sizeof buf)) > 0)
+    {
+        auto* event = reinterpret_cast<fanotify_event_metadata*>(buf);
+
+        for ( ; FAN_EVENT_OK(event, l); event = FAN_EVENT_NEXT(event, l))
+        {
+            // Only reported for permission events, but just in case.
+            if (event->fd >= 0)
+                close(event->fd);
+
+            if ((event->mask & FAN_Q_OVERFLOW))
+            {
+                LOG_err << "fanotify FAN_Q_OVERFLOW";
+
+                // Related syncs perform a rescan.
+                for (auto* notifier : mNotifiers)
+                    ++notifier->mErrorCount;
+
+                continue;
+            }
+
+            // The folder the event is in, and the name of its entry.
+            auto* info = reinterpret_cast<fanotify_event_info_fid*>(event + 1);
+
+            if (event->event_len < sizeof(*event) + sizeof(*info)
+                || (info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME
+                    && info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID))
+                continue;
+
+            auto& handle = *reinterpret_cast<file_handle*>(info->handle);
+
+            // Everything on the filesystem is reported, most events aren't in any sync.
+            auto id = mFileHandleIds.find(fanotifyKey(&info->fsid, handle));
+
+            if (id == mFileHandleIds.end())
+                continue;
+
+            string name;
+
+            if (info->hdr.info_type == FAN_EVENT_INFO_TYPE_DFID_NAME)
+                name = reinterpret_cast<const char*>(handle.f_handle + handle.handle_bytes);
+
+            // An event on the folder itself.
+            if (name == ".")
+                name.clear();
+
+            LOG_verbose << "Filesystem notification:"
+                << " event " << name << ": " << std::hex << event->mask;
+
+            result |= notifyWatches(id->second,
+                                    name,
+                                    false,
+                                    (event->mask & (FAN_ATTRIB | FAN_ONDIR)) == (FAN_ATTRIB | FAN_ONDIR));
+        }
+    }
+
+    return result;
+}
+
+#endif // USE_FANOTIFY
+
+#endif // ENABLE_SYNC
+
 // read all pending inotify events and queue them for processing
 int LinuxFileSystemAccess::checkevents([[maybe_unused]] Waiter* waiter)
 {
@@ -917,6 +1186,11 @@ int LinuxFileSystemAccess::checkevents([[maybe_unused]] Waiter* waiter)
     if (!MEGA_FD_ISSET(mNotifyFd, &w->rfds))
         return result;
 
+#ifdef USE_FANOTIFY
+    if (mFanotify)
+        return checkFanotifyEvents();
+#endif // USE_FANOTIFY
+
     char buf[sizeof(struct inotify_event) + NAME_MAX + 1];
     ssize_t p, l;
     inotify_event* in;
@@ -925,55 +1199,7 @@ int LinuxFileSystemAccess::checkevents([[maybe_unused]] Waiter* waiter)
 
     auto notifyAll = [&](int handle, const string& name)
     {
-        // Loop over and notify all associated nodes.
-        auto associated = mWatches.equal_range(handle);
-
-        for (auto i = associated.first; i != associated.second;)
-        {
-            // Convenience.
-            using std::move;
-            auto& node = *i->second.first;
-            auto& sync = *node.sync;
-            auto& notifier = *sync.dirnotify;
-
-            LOG_debug << "Filesystem notification:"
-                << " Root: "
-                << node.localname
-                << " Path: "
-                << name;
-
-            if ((in->mask & IN_DELETE_SELF))
-            {
-                // The FS directory watched is gone
-                node.mWatchHandle.invalidate();
-                // Remove it from the container (C++11 and up)
-                i = mWatches.erase(i);
-            }
-            else
-            {
-                ++i;
-            }
-
-            auto localName = LocalPath::fromPlatformEncodedRelative(name);
-            notifier.notify(notifier.fsEventq,
-                            &node,
-                            Notification::NEEDS_PARENT_SCAN,
-                            std::move(localName));
-
-            // We need to rescan the directory if it's changed permissions.
-            //
-            // The reason for this is that we may not have been able to list
-            // the directory's contents before. If we didn't rescan, we
-            // wouldn't notice these files until some other event is
-            // triggered in or below this directory.
-            if (in->mask == (IN_ATTRIB | IN_ISDIR))
-                notifier.notify(notifier.fsEventq,
-                                &node,
-                                Notification::FOLDER_NEEDS_SELF_SCAN,
-                                LocalPath::fromPlatformEncodedRelative(name));
-
-            result |= Waiter::NEEDEXEC;
-        }
+        result |= notifyWatches(handle, name, in->mask & IN_DELETE_SELF, in->mask == (IN_ATTRIB | IN_ISDIR));
     };
 
     while ((l = read(mNotifyFd, buf, sizeof buf)) > 0)
@@ -1048,6 +1274,43 @@ bool PosixFileSystemAccess::renamelocal(const LocalPath& oldname, const LocalPat
     return false;
 }
 
+bool PosixFileSystemAccess::hardlinklocal(const LocalPath& existing, const LocalPath& newname)
+{
+    AdjustBasePathResult existingstr = adjustBasePath(existing);
+    AdjustBasePathResult newnamestr = adjustBasePath(newname);
+
+    if (!link(existingstr.c_str(), newnamestr.c_str()))
+    {
+        return true;
+    }
+
+    // EXDEV, EPERM (no hard links on the filesystem), EMLINK...: the caller copies instead
+    target_exists = errno == EEXIST;
+    target_name_too_long = errno == ENAMETOOLONG;
+    transient_error = false;
+
+    int e = errno;
+    LOG_debug << "Unable to hard link file: " << existingstr << " to " << newnamestr << ". Error code: " << e;
+    return false;
+}
+
+// Share the source's extents with the target where the filesystem
+// supports it (btrfs, XFS, bcachefs), instead of copying the data.
+static bool clonefd(int sfd, int tfd)
+{
+#ifdef __linux__
+    if (!ioctl(tfd, FICLONE, sfd))
+    {
+        LOG_verbose << "Copied via FICLONE";
+        return true;
+    }
+#else
+    static_cast<void>(sfd);
+    static_cast<void>(tfd);
+#endif
+    return false;
+}
+
 bool PosixFileSystemAccess::copylocal(const LocalPath& oldname, const LocalPath& newname, m_time_t mtime)
 {
     AdjustBasePathResult oldnamestr = adjustBasePath(oldname);
@@ -1056,6 +1319,15 @@ bool PosixFileSystemAccess::copylocal(const LocalPath& oldname, const LocalPath&
     int sfd, tfd;
     ssize_t t = -1;
 
+#if defined(__APPLE__)
+    // Copy-on-write clone on APFS; fails with ENOTSUP elsewhere.
+    if (!clonefile(oldnamestr.c_str(), newnamestr.c_str(), 0))
+    {
+        LOG_verbose << "Copied via clonefile";
+        t = 0;
+    }
+    else
+#endif
 #ifdef HAVE_SENDFILE
     // Linux-specific - kernel 2.6.33+ required
     if ((sfd = open(oldnamestr.c_str(), O_RDONLY | O_DIRECT)) >= 0)
@@ -1065,7 +1337,8 @@ bool PosixFileSystemAccess::copylocal(const LocalPath& oldname, const LocalPath&
         if ((tfd = open(newnamestr.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, defaultfilepermissions)) >= 0)
         {
             umask(mode);
-            while ((t = sendfile(tfd, sfd, NULL, 1024 * 1024 * 1024)) > 0);
+            if (clonefd(sfd, tfd)) t = 0;
+            else while ((t = sendfile(tfd, sfd, NULL, 1024 * 1024 * 1024)) > 0);
 #else
     char buf[16384];
 
@@ -1076,7 +1349,8 @@ bool PosixFileSystemAccess::copylocal(const LocalPath& oldname, const LocalPath&
         if ((tfd = open(newnamestr.c_str(), O_WRONLY | O_CREAT | O_TRUNC, defaultfilepermissions)) >= 0)
         {
             umask(mode);
-            while (((t = read(sfd, buf, sizeof buf)) > 0) &&
+            if (clonefd(sfd, tfd)) t = 0;
+            else while (((t = read(sfd, buf, sizeof buf)) > 0) &&
                    write(tfd, buf, static_cast<size_t>(t)) == t)
                 ;
 #endif
@@ -1652,10 +1926,74 @@ LinuxDirNotify::LinuxDirNotify(LinuxFileSystemAccess& owner,
     // Did our owner initialize correctly?
     if (owner.mNotifyFd >= 0)
         setFailed(0, "");
+
+#ifdef USE_FANOTIFY
+    if (!owner.mFanotify)
+        return;
+
+    // Mark the whole filesystem, unless another notifier already did.
+    struct stat metadata;
+
+    if (stat(rootPath.localpath.c_str(), &metadata))
+    {
+        setFailed(errno, "Unable to determine the filesystem to monitor.");
+        return;
+    }
+
+    auto& notifiers = owner.mMarkedFilesystems[metadata.st_dev];
+
+    if (!notifiers
+        && fanotify_mark(owner.mNotifyFd,
+                         FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+                         FANOTIFY_EVENTS,
+                         AT_FDCWD,
+                         rootPath.localpath.c_str()))
+    {
+        auto error = errno;
+
+        LOG_err << "Unable to mark filesystem for notifications: "
+                << rootPath
+                << ". Error: "
+                << error;
+
+        owner.mMarkedFilesystems.erase(metadata.st_dev);
+        setFailed(error, "Unable to create filesystem monitor.");
+        return;
+    }
+
+    ++notifiers;
+
+    mMarked = true;
+    mDevice = metadata.st_dev;
+#endif // USE_FANOTIFY
 }
 
 LinuxDirNotify::~LinuxDirNotify()
 {
+#ifdef USE_FANOTIFY
+    // Last notifier on the filesystem removes its mark.
+    auto marked = mOwner.mMarkedFilesystems.find(mDevice);
+
+    if (mMarked && marked != mOwner.mMarkedFilesystems.end() && !--marked->second)
+    {
+        mOwner.mMarkedFilesystems.erase(marked);
+
+        // Removing takes a path on the filesystem, the root's if it's still there.
+        // Otherwise the mark lasts until the descriptor is closed.
+        struct stat metadata;
+
+        if (stat(localbasepath.localpath.c_str(), &metadata) || metadata.st_dev != mDevice
+            || fanotify_mark(mOwner.mNotifyFd,
+                             FAN_MARK_REMOVE | FAN_MARK_FILESYSTEM,
+                             FANOTIFY_EVENTS,
+                             AT_FDCWD,
+                             localbasepath.localpath.c_str()))
+        {
+            LOG_warn << "Unable to unmark filesystem: " << localbasepath << ". Error: " << errno;
+        }
+    }
+#endif // USE_FANOTIFY
+
     // Remove ourselves from our owner's list of notiifers.
     mOwner.mNotifiers.erase(mNotifiersIt);
 }
@@ -1674,6 +2012,36 @@ AddWatchResult LinuxDirNotify::addWatch(LocalNode& node,
     // Convenience.
     auto& watches = mOwner.mWatches;
 
+#ifdef USE_FANOTIFY
+    // The filesystem is marked already, we only need to recognize the folder's events.
+    if (mOwner.mFanotify)
+    {
+        auto key = fanotifyKey(path.localpath.c_str());
+
+        if (key.empty())
+        {
+            LOG_warn << "Unable to get file handle for filesystem notifications: "
+                << path
+                << ": Error: "
+                << errno;
+
+            return make_pair(watches.end(), WR_FAILURE);
+        }
+
+        auto id = mOwner.mFileHandleIds.emplace(key, mOwner.mNextFileHandleId);
+
+        if (id.second)
+            mOwner.mFileHandleKeys.emplace(mOwner.mNextFileHandleId++, std::move(key));
+
+        auto entry =
+            watches.emplace(piecewise_construct,
+                forward_as_tuple(id.first->second),
+                forward_as_tuple(&node, fsid));
+
+        return make_pair(entry, WR_SUCCESS);
+    }
+#endif // USE_FANOTIFY
+
     auto handle =
         inotify_add_watch(mOwner.mNotifyFd,
             path.localpath.c_str(),
@@ -1736,6 +2104,22 @@ void LinuxDirNotify::removeWatch(WatchMapIterator entry)
         return;
     }
 
+#ifdef USE_FANOTIFY
+    // No kernel watch to remove, just forget the folder's file handle.
+    if (mOwner.mFanotify)
+    {
+        auto key = mOwner.mFileHandleKeys.find(handle);
+
+        if (key != mOwner.mFileHandleKeys.end())
+        {
+            mOwner.mFileHandleIds.erase(key->second);
+            mOwner.mFileHandleKeys.erase(key);
+        }
+
+        return;
+    }
+#endif // USE_FANOTIFY
+
     auto const removedResult = inotify_rm_watch(mOwner.mNotifyFd, handle);
 
     if (removedResult)
@@ -1825,12 +2209,115 @@ private:
     m_off_t mSize;
 }; // UnixStreamAccess
 
+// Used by directoryScan(...) below to enumerate a directory.
+//
+// On Linux, entries come straight from getdents64(...), with a buffer
+// holding thousands of them per call rather than readdir(...)'s few hundred.
+class UnixDirectoryEntries
+{
+public:
+    // Takes ownership of the descriptor.
+    explicit UnixDirectoryEntries(int descriptor)
+      : mDescriptor(descriptor)
+    {
+#ifndef __linux__
+        if (mDescriptor >= 0 && !(mDirectory = fdopendir(mDescriptor)))
+        {
+            close(mDescriptor);
+            mDescriptor = -1;
+        }
+#endif // ! __linux__
+    }
+
+    MEGA_DISABLE_COPY_MOVE(UnixDirectoryEntries);
+
+    ~UnixDirectoryEntries()
+    {
+#ifdef __linux__
+        if (mDescriptor >= 0)
+            close(mDescriptor);
+#else // __linux__
+        if (mDirectory)
+            closedir(mDirectory);
+#endif // ! __linux__
+    }
+
+    operator bool() const
+    {
+        return mDescriptor >= 0;
+    }
+
+    // For stat(...)ing the entries relative to the directory.
+    int descriptor() const
+    {
+        return mDescriptor;
+    }
+
+    // False when there are no more entries (or they can't be read).
+    bool next(const char*& name, ino_t& inode)
+    {
+#ifdef __linux__
+        while (mOffset >= mLength)
+        {
+            auto length = syscall(SYS_getdents64, mDescriptor, mBuffer.data(), mBuffer.size());
+
+            if (length <= 0)
+                return false;
+
+            mLength = static_cast<size_t>(length);
+            mOffset = 0;
+        }
+
+        auto entry = reinterpret_cast<const Dirent64*>(mBuffer.data() + mOffset);
+
+        mOffset += entry->d_reclen;
+
+        name = entry->d_name;
+        inode = static_cast<ino_t>(entry->d_ino);
+#else // __linux__
+        auto entry = readdir(mDirectory);
+
+        if (!entry)
+            return false;
+
+        name = entry->d_name;
+        inode = entry->d_ino;
+#endif // ! __linux__
+
+        return true;
+    }
+
+private:
+#ifdef __linux__
+    // As the kernel lays them out, glibc only exposes it from 2.30.
+    struct Dirent64
+    {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+
+    static constexpr size_t BUFFER_SIZE = 128 * 1024;
+
+    std::vector<char> mBuffer = std::vector<char>(BUFFER_SIZE);
+    size_t mLength = 0;
+    size_t mOffset = 0;
+#else // __linux__
+    DIR* mDirectory = nullptr;
+#endif // ! __linux__
+
+    int mDescriptor;
+}; // UnixDirectoryEntries
+
 ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
                                                 handle expectedFsid,
                                                 map<LocalPath, FSNode>& known,
                                                 std::vector<FSNode>& results,
                                                 bool followSymLinks,
-                                                unsigned& nFingerprinted)
+                                                unsigned& nFingerprinted,
+                                                FingerprintCache* fingerprints)
 {
     // Scan path should always be absolute.
     assert(targetPath.isAbsolute());
@@ -1857,6 +2344,17 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
         return !::stat(path, &metadata);
     };
 
+    // Same for the directory's entries, without resolving the whole path each time.
+    auto statAt = [&](int directory, const char* name, struct stat& metadata) {
+        if (fstatat(directory, name, &metadata, AT_SYMLINK_NOFOLLOW))
+            return false;
+
+        if (!followSymLinks || !S_ISLNK(metadata.st_mode))
+            return true;
+
+        return !fstatat(directory, name, &metadata, 0);
+    };
+
     // Where we store file information.
     struct stat metadata;
 
@@ -1896,7 +2394,7 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
     }
 
     // Try and open the directory for iteration.
-    auto directory = opendir(targetPath.localpath.c_str());
+    UnixDirectoryEntries directory(open(targetPath.localpath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
 
     if (!directory)
     {
@@ -1913,23 +2411,24 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
     auto device = metadata.st_dev;
 
     // Iterate over the directory's children.
-    auto entry = readdir(directory);
     auto path = targetPath;
+    const char* name;
+    ino_t inode;
 
-    for ( ; entry; entry = readdir(directory))
+    while (directory.next(name, inode))
     {
         // Skip special hardlinks.
-        if (!strcmp(entry->d_name, "."))
+        if (!strcmp(name, "."))
             continue;
 
-        if (!strcmp(entry->d_name, ".."))
+        if (!strcmp(name, ".."))
             continue;
 
         // Push a new scan record.
         auto& result = (results.emplace_back(), results.back());
 
-        result.fsid = (handle)entry->d_ino;
-        result.localname = LocalPath::fromPlatformEncodedRelative(entry->d_name);
+        result.fsid = (handle)inode;
+        result.localname = LocalPath::fromPlatformEncodedRelative(name);
 
         // Compute this entry's absolute name.
         auto restorer = makeScopedSizeRestorer(path);
@@ -1937,7 +2436,7 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
         path.appendWithSeparator(result.localname, false);
 
         // Try and get information about this entry.
-        if (!stat(path.localpath.c_str(), metadata))
+        if (!statAt(directory.descriptor(), name, metadata))
         {
             LOG_warn << "directoryScan: "
                      << "Unable to stat(...) file: "
@@ -2033,6 +2532,10 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
             continue;
         }
 
+        // Was it fingerprinted elsewhere, before a move perhaps?
+        if (it == known.end() && fingerprints && fingerprints->reuse(result))
+            continue;
+
         // Try and open the file for reading.
         UnixStreamAccess isAccess(path.localpath.c_str(),
                                   result.fingerprint.size);
@@ -2055,9 +2558,6 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
         ++nFingerprinted;
     }
 
-    // We're done iterating the directory.
-    closedir(directory);
-
     return SCAN_SUCCESS;
 }
 
@@ -2387,6 +2887,56 @@ bool PosixFileSystemAccess::fsStableIDs(const LocalPath& path) const
            && type != FS_LIFS;
 }
 
+bool PosixFileSystemAccess::fsSolidState(const LocalPath& path, bool& solidState) const
+{
+#ifdef __linux__
+    struct stat statbuf;
+
+    if (stat(path.localpath.c_str(), &statbuf))
+        return false;
+
+    // Partitions share the queue of their disk, one level up.
+    auto device = "/sys/dev/block/"
+                  + std::to_string(major(statbuf.st_dev))
+                  + ":"
+                  + std::to_string(minor(statbuf.st_dev));
+
+    for (auto& attribute : {device + "/queue/rotational", device + "/../queue/rotational"})
+    {
+        ifstream infile(attribute);
+        char rotational;
+
+        if (infile >> rotational)
+            return solidState = rotational == '0', true;
+    }
+
+    // Virtual devices such as device mapper targets or btrfs subvolumes.
+    return false;
+#else // __linux__
+    return FileSystemAccess::fsSolidState(path, solidState);
+#endif // ! __linux__
+}
+
+bool PosixFileSystemAccess::setBackgroundIO(bool background)
+{
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    // From linux/ioprio.h, which not every libc ships.
+    constexpr int IOPRIO_WHO_PROCESS = 1;
+    constexpr int IOPRIO_CLASS_SHIFT = 13;
+    constexpr int IOPRIO_CLASS_IDLE = 3;
+
+    // Class none takes the priority from the thread's nice value again.
+    int priority = background ? IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT : 0;
+
+    // Who 0 is the calling thread.
+    return !syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, priority);
+#elif defined(__APPLE__)
+    return !setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD, background ? IOPOL_THROTTLE : IOPOL_DEFAULT);
+#else
+    return FileSystemAccess::setBackgroundIO(background);
+#endif
+}
+
 #endif // ENABLE_SYNC
 
 bool PosixFileSystemAccess::hardLink(const LocalPath& source, const LocalPath& target)
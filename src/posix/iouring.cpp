@@ -0,0 +1,225 @@
+/**
+ * @file posix/iouring.cpp
+ * @brief Asynchronous file reads and writes through io_uring
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega.h"
+#include "mega/posix/megaiouring.h"
+
+#if defined(__linux__) && defined(HAVE_LINUX_IO_URING_H)
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <thread>
+
+namespace mega {
+
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params* p)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+template<typename T>
+T* ringField(void* ring, unsigned offset)
+{
+    return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+// travels in the 64 bits of user_data; READV/WRITEV (kernel 5.1) rather than READ/WRITE (5.6)
+struct PendingOp
+{
+    IoUring::Completion completion;
+    void* userData;
+    iovec iov;
+};
+
+} // namespace
+
+IoUring* IoUring::instance()
+{
+    static IoUring* ring = []() -> IoUring*
+    {
+        // never destroyed: its thread may be delivering a completion while the process exits
+        auto r = new IoUring;
+        if (r->setup())
+        {
+            return r;
+        }
+        delete r;
+        return nullptr;
+    }();
+    return ring;
+}
+
+bool IoUring::setup()
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    mFd = io_uring_setup(ENTRIES, &params);
+    if (mFd < 0)
+    {
+        LOG_info << "io_uring not available (" << errno << "), using POSIX AIO";
+        return false;
+    }
+
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        // kernels before 5.4, not worth a separate completion queue mapping
+        LOG_info << "io_uring too old, using POSIX AIO";
+        close(mFd);
+        mFd = -1;
+        return false;
+    }
+
+    size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    size_t ringSize = std::max(sqSize, cqSize);
+
+    void* ring = mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_SQ_RING);
+    void* sqes = ring == MAP_FAILED ? MAP_FAILED
+                                    : mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                                           MAP_SHARED | MAP_POPULATE, mFd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        LOG_err << "Failed to map the io_uring queues: " << errno;
+        if (ring != MAP_FAILED)
+        {
+            munmap(ring, ringSize);
+        }
+        close(mFd);
+        mFd = -1;
+        return false;
+    }
+
+    mSqHead = ringField<unsigned>(ring, params.sq_off.head);
+    mSqTail = ringField<unsigned>(ring, params.sq_off.tail);
+    mSqMask = ringField<unsigned>(ring, params.sq_off.ring_mask);
+    mSqArray = ringField<unsigned>(ring, params.sq_off.array);
+    mSqes = static_cast<io_uring_sqe*>(sqes);
+
+    mCqHead = ringField<unsigned>(ring, params.cq_off.head);
+    mCqTail = ringField<unsigned>(ring, params.cq_off.tail);
+    mCqMask = ringField<unsigned>(ring, params.cq_off.ring_mask);
+    mCqes = ringField<io_uring_cqe>(ring, params.cq_off.cqes);
+
+    try
+    {
+        std::thread([this]() { completionLoop(); }).detach();
+    }
+    catch (std::system_error& e)
+    {
+        LOG_err << "Failed to start the io_uring completion thread: " << e.what();
+        close(mFd);
+        mFd = -1;
+        return false;
+    }
+
+    LOG_debug << "File I/O through io_uring, " << params.sq_entries << " entries";
+    return true;
+}
+
+bool IoUring::submit(bool write, int fd, void* buf, unsigned len, m_off_t pos, Completion completion, void* userData)
+{
+    if (++mInFlight > ENTRIES)
+    {
+        --mInFlight;
+        errno = EAGAIN;
+        return false;
+    }
+
+    auto pending = new PendingOp{completion, userData, iovec{buf, len}};
+
+    std::lock_guard<std::mutex> g(mSubmitMutex);
+
+    unsigned tail = *mSqTail;
+    unsigned index = tail & *mSqMask;
+
+    io_uring_sqe* sqe = &mSqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&pending->iov);
+    sqe->len = 1;
+    sqe->off = static_cast<uint64_t>(pos);
+    sqe->user_data = reinterpret_cast<uint64_t>(pending);
+
+    mSqArray[index] = index;
+    __atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+
+    if (io_uring_enter(mFd, 1, 0, 0) < 0)
+    {
+        int e = errno;
+
+        // take it back, the kernel didn't consume it
+        __atomic_store_n(mSqTail, tail, __ATOMIC_RELEASE);
+        delete pending;
+        --mInFlight;
+        errno = e;
+        return false;
+    }
+    return true;
+}
+
+void IoUring::completionLoop()
+{
+    for (;;)
+    {
+        unsigned head = *mCqHead;
+        unsigned tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+
+        if (head == tail)
+        {
+            if (io_uring_enter(mFd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+            {
+                LOG_err << "io_uring wait failed: " << errno;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            continue;
+        }
+
+        for (; head != tail; ++head)
+        {
+            io_uring_cqe* cqe = &mCqes[head & *mCqMask];
+            std::unique_ptr<PendingOp> pending(reinterpret_cast<PendingOp*>(cqe->user_data));
+            int result = cqe->res;
+
+            // release the slot before the callback, which may queue the next operation
+            __atomic_store_n(mCqHead, head + 1, __ATOMIC_RELEASE);
+            --mInFlight;
+
+            pending->completion(pending->userData, result);
+        }
+    }
+}
+
+} // namespace
+
+#endif
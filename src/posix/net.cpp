@@ -196,6 +196,38 @@ unsigned long CurlHttpIO::id_function()
 
 #endif
 
+// With SharedResources, one share for all the instances of the process: the DNS cache and the
+// TLS sessions of one client are reused by the others. Connections stay with each instance,
+// as libcurl doesn't support sharing them between multi handles on concurrent threads.
+static std::shared_ptr<CURLSH> processCurlShare()
+{
+    static std::mutex shareMutex;
+    static std::weak_ptr<CURLSH> share;
+    static std::mutex dataMutexes[CURL_LOCK_DATA_LAST];
+
+    std::lock_guard<std::mutex> g(shareMutex);
+    if (auto sh = share.lock())
+    {
+        return sh;
+    }
+
+    std::shared_ptr<CURLSH> sh(curl_share_init(), curl_share_cleanup);
+    curl_share_setopt(sh.get(), CURLSHOPT_LOCKFUNC, +[](CURL*, curl_lock_data data, curl_lock_access, void*)
+    {
+        dataMutexes[data].lock();
+    });
+    curl_share_setopt(sh.get(), CURLSHOPT_UNLOCKFUNC, +[](CURL*, curl_lock_data data, void*)
+    {
+        dataMutexes[data].unlock();
+    });
+    curl_share_setopt(sh.get(), CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(sh.get(), CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    LOG_debug << "Sharing the cURL DNS cache and TLS sessions";
+    share = sh;
+    return sh;
+}
+
 CurlHttpIO::CurlHttpIO()
 {
 #ifdef WIN32
@@ -367,9 +399,17 @@ CurlHttpIO::CurlHttpIO()
     curltimeoutreset[PUT] = -1;
     arerequestspaused[PUT] = false;
 
-    curlsh = curl_share_init();
-    curl_share_setopt(curlsh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
-    curl_share_setopt(curlsh, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    if (SharedResources::enabled())
+    {
+        mCurlShare = processCurlShare();
+    }
+    else
+    {
+        mCurlShare.reset(curl_share_init(), curl_share_cleanup);
+        curl_share_setopt(mCurlShare.get(), CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(mCurlShare.get(), CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+    curlsh = mCurlShare.get();
 
     contenttypejson = curl_slist_append(NULL, "Content-Type: application/json");
     contenttypejson = curl_slist_append(contenttypejson, "Expect:");
@@ -562,6 +602,11 @@ void CurlHttpIO::addaresevents([[maybe_unused]] Waiter* waiter)
 #if defined(_WIN32)
             info.createAssociateEvent();
 #else
+    #ifdef USE_EPOLL
+            // c-ares can close a socket and open another one with the same number at any time,
+            // without telling, so its sockets are registered again on every wait
+            ((PosixWaiter *)waiter)->forgetfd(info.fd);
+    #endif
             if (readable)
             {
                 MEGA_FD_SET(info.fd, &((PosixWaiter *)waiter)->rfds);
@@ -796,7 +841,8 @@ CurlHttpIO::~CurlHttpIO()
     curl_multi_cleanup(curlm[API]);
     curl_multi_cleanup(curlm[GET]);
     curl_multi_cleanup(curlm[PUT]);
-    curl_share_cleanup(curlsh);
+    curlsh = nullptr;
+    mCurlShare.reset();
 
 #ifdef MEGA_USE_C_ARES
     closearesevents();
@@ -825,6 +871,10 @@ CurlHttpIO::~CurlHttpIO()
 
 int CurlHttpIO::instanceCount = 0;
 
+const double CurlHttpIO::HEALTH_EWMA_WEIGHT = 0.2;
+const double CurlHttpIO::DEGRADED_HOST_SCORE = 0.25;
+const dstime CurlHttpIO::HEALTH_MAX_AGE_DS = 3000;
+
 void CurlHttpIO::setuseragent(string* u)
 {
     useragent = *u;
@@ -928,6 +978,10 @@ void CurlHttpIO::disconnect()
     curltimeoutreset[PUT] = -1;
     arerequestspaused[PUT] = false;
 
+    applyMultiplexing(API);
+    applyMultiplexing(GET);
+    applyMultiplexing(PUT);
+
     disconnecting = false;
 #ifdef MEGA_USE_C_ARES
     if (dnsservers.size())
@@ -948,18 +1002,434 @@ void CurlHttpIO::disconnect()
     }
 }
 
+bool CurlHttpIO::setHttp2Multiplexing(bool api, bool transfers)
+{
+#if LIBCURL_VERSION_NUM >= 0x073200 // At least cURL 7.50.0
+    if (!(curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2))
+    {
+        LOG_warn << "cURL built without HTTP/2 support";
+        return false;
+    }
+
+    http2multiplexing[API] = api;
+    http2multiplexing[GET] = transfers;
+    http2multiplexing[PUT] = transfers;
+    applyMultiplexing(API);
+    applyMultiplexing(GET);
+    applyMultiplexing(PUT);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool CurlHttpIO::setHappyEyeballs(bool enable)
+{
+#if defined(MEGA_USE_C_ARES) && LIBCURL_VERSION_NUM >= 0x073b00 // At least cURL 7.59.0
+    happyeyeballs = enable;
+    return true;
+#else
+    // without c-ares, cURL resolves the hostnames itself and already races the addresses
+    return false;
+#endif
+}
+
+bool CurlHttpIO::raceableaddresses(CurlHttpContext* httpctx)
+{
+#if LIBCURL_VERSION_NUM >= 0x073b00 // At least cURL 7.59.0, for several addresses per host
+    auto it = dnscache.find(httpctx->hostname);
+    if (it == dnscache.end())
+    {
+        return false;
+    }
+
+    CurlDNSEntry& dnsEntry = it->second;
+    if (dnsEntry.ipv6.empty() || dnsEntry.isIPv6Expired() || dnsEntry.ipv4.empty() || dnsEntry.isIPv4Expired())
+    {
+        return false;
+    }
+
+    std::ostringstream oss;
+    oss << httpctx->hostname << ":" << httpctx->port << ":[" << dnsEntry.ipv6 << "]," << dnsEntry.ipv4;
+    curl_slist_free_all(httpctx->resolve);
+    httpctx->resolve = curl_slist_append(nullptr, oss.str().c_str());
+    return httpctx->resolve != nullptr;
+#else
+    return false;
+#endif
+}
+
+void CurlHttpIO::applyMultiplexing(direction_t d)
+{
+#if LIBCURL_VERSION_NUM >= 0x073200 // At least cURL 7.50.0
+    if (http2multiplexing[d])
+    {
+        curl_multi_setopt(curlm[d], CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    }
+#endif
+}
+
+void CurlHttpIO::recordConnection(CURL* easy_handle, HttpReq* req)
+{
+    auto httpctx = static_cast<CurlHttpContext*>(req->httpiohandle);
+    if (!httpctx)
+    {
+        return;
+    }
+
+    HostConnectionStats& stats = hostConnectionStats[httpctx->hostname];
+    stats.requests++;
+
+    double connectTime = 0;
+    double tlsTime = 0;
+    if (curl_easy_getinfo(easy_handle, CURLINFO_CONNECT_TIME, &connectTime) == CURLE_OK
+            && curl_easy_getinfo(easy_handle, CURLINFO_APPCONNECT_TIME, &tlsTime) == CURLE_OK)
+    {
+        // APPCONNECT_TIME is 0 without TLS, and both are measured from the start of the request
+        connectTime *= 1000;
+        tlsTime = tlsTime > 0 ? tlsTime * 1000 - connectTime : 0;
+        double resolveTime = std::max(httpctx->resolveTime, 0.0);
+
+        LOG_verbose << req->logname << "Resolve/connect/TLS time: " << resolveTime << "/" << connectTime << "/" << tlsTime << " ms";
+        stats.resolveMs += resolveTime;
+        stats.connectMs += connectTime;
+        stats.tlsMs += tlsTime;
+    }
+
+    long connects = 0;
+    if (curl_easy_getinfo(easy_handle, CURLINFO_NUM_CONNECTS, &connects) == CURLE_OK && connects > 0)
+    {
+        stats.newConnections += static_cast<uint64_t>(connects);
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x073200 // At least cURL 7.50.0
+    long version = 0;
+    if (curl_easy_getinfo(easy_handle, CURLINFO_HTTP_VERSION, &version) == CURLE_OK
+            && version == CURL_HTTP_VERSION_2_0)
+    {
+        stats.http2Streams++;
+    }
+#endif
+
+#if LIBCURL_VERSION_NUM >= 0x073700 // At least cURL 7.55.0
+    curl_off_t encodedBytes = 0;
+    if (httpctx->encodedresponse
+            && curl_easy_getinfo(easy_handle, CURLINFO_SIZE_DOWNLOAD_T, &encodedBytes) == CURLE_OK)
+    {
+        stats.encodedResponses++;
+        stats.encodedBytes += static_cast<m_off_t>(encodedBytes);
+        stats.decodedBytes += httpctx->decodedbytes;
+    }
+#endif
+}
+
+void CurlHttpIO::updatehealth(CURL* easy_handle, HttpReq* req, bool failed)
+{
+    auto httpctx = static_cast<CurlHttpContext*>(req->httpiohandle);
+    if (!httpctx || httpctx->d == API || req->mPrewarmDirection != NONE)
+    {
+        return;
+    }
+
+    double firstByteMs = -1;
+    double bytesPerSecond = -1;
+    double pretransfer = 0;
+    double starttransfer = 0;
+    double total = 0;
+    if (!failed
+            && curl_easy_getinfo(easy_handle, CURLINFO_PRETRANSFER_TIME, &pretransfer) == CURLE_OK
+            && curl_easy_getinfo(easy_handle, CURLINFO_STARTTRANSFER_TIME, &starttransfer) == CURLE_OK
+            && curl_easy_getinfo(easy_handle, CURLINFO_TOTAL_TIME, &total) == CURLE_OK)
+    {
+        if (httpctx->d == GET)
+        {
+            firstByteMs = (starttransfer - pretransfer) * 1000;
+        }
+
+        // small requests are dominated by the latency
+        curl_off_t bytes = 0;
+        curl_easy_getinfo(easy_handle, httpctx->d == GET ? CURLINFO_SIZE_DOWNLOAD_T : CURLINFO_SIZE_UPLOAD_T, &bytes);
+        if (bytes >= 256 * 1024 && total > pretransfer)
+        {
+            bytesPerSecond = static_cast<double>(bytes) / (total - pretransfer);
+        }
+    }
+
+    updatehealth(hostHealth[httpctx->hostname], failed, firstByteMs, bytesPerSecond);
+}
+
+void CurlHttpIO::updatehealth(HostHealth& health, bool failed, double firstByteMs, double bytesPerSecond)
+{
+    if (health.samples && Waiter::ds - health.updated > HEALTH_MAX_AGE_DS)
+    {
+        // too old to describe the server now
+        health = HostHealth();
+    }
+
+    double weight = health.samples ? HEALTH_EWMA_WEIGHT : 1;
+    health.errorRate += weight * ((failed ? 1 : 0) - health.errorRate);
+    if (firstByteMs >= 0)
+    {
+        health.firstByteMs = health.firstByteMs > 0 ? health.firstByteMs + HEALTH_EWMA_WEIGHT * (firstByteMs - health.firstByteMs) : firstByteMs;
+    }
+    if (bytesPerSecond > 0)
+    {
+        health.bytesPerSecond = health.bytesPerSecond > 0 ? health.bytesPerSecond + HEALTH_EWMA_WEIGHT * (bytesPerSecond - health.bytesPerSecond) : bytesPerSecond;
+    }
+    health.samples++;
+    health.updated = Waiter::ds;
+}
+
+double CurlHttpIO::hostscore(const string& host) const
+{
+    auto fresh = [](const HostHealth& h)
+    {
+        return h.samples >= 3 && Waiter::ds - h.updated <= HEALTH_MAX_AGE_DS;
+    };
+
+    auto it = hostHealth.find(host);
+    if (it == hostHealth.end() || !fresh(it->second))
+    {
+        return 1;
+    }
+
+    std::vector<double> firstByteMs;
+    std::vector<double> bytesPerSecond;
+    for (auto& h : hostHealth)
+    {
+        if (fresh(h.second))
+        {
+            if (h.second.firstByteMs > 0) firstByteMs.push_back(h.second.firstByteMs);
+            if (h.second.bytesPerSecond > 0) bytesPerSecond.push_back(h.second.bytesPerSecond);
+        }
+    }
+
+    auto median = [](std::vector<double>& v)
+    {
+        std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(v.size() / 2), v.end());
+        return v[v.size() / 2];
+    };
+
+    const HostHealth& health = it->second;
+    double score = 1 - health.errorRate;
+    if (health.firstByteMs > 0 && firstByteMs.size() > 1)
+    {
+        score *= std::min(1.0, median(firstByteMs) / health.firstByteMs);
+    }
+    if (health.bytesPerSecond > 0 && bytesPerSecond.size() > 1)
+    {
+        score *= std::min(1.0, health.bytesPerSecond / median(bytesPerSecond));
+    }
+    return score;
+}
+
+bool CurlHttpIO::isHostDegraded(const string& url)
+{
+    string scheme, host;
+    int port;
+    if (!crackurl(&url, &scheme, &host, &port))
+    {
+        return false;
+    }
+
+    double score = hostscore(host);
+    if (score < DEGRADED_HOST_SCORE)
+    {
+        LOG_debug << "Storage server " << host << " is degraded (score " << score << ")";
+        return true;
+    }
+    return false;
+}
+
+void CurlHttpIO::hostStalled(const string& url)
+{
+    string scheme, host;
+    int port;
+    if (crackurl(&url, &scheme, &host, &port))
+    {
+        updatehealth(hostHealth[host], true, -1, -1);
+    }
+}
+
+string CurlHttpIO::connectionStatsReport(bool reset)
+{
+    std::ostringstream s;
+    for (auto& hostStats : hostConnectionStats)
+    {
+        const HostConnectionStats& stats = hostStats.second;
+        s << " " << hostStats.first << " requests: " << stats.requests
+          << " http2 streams: " << stats.http2Streams
+          << " new connections: " << stats.newConnections
+          << " mean resolve/connect/TLS ms: " << stats.resolveMs / double(stats.requests)
+          << "/" << stats.connectMs / double(stats.requests)
+          << "/" << stats.tlsMs / double(stats.requests);
+        if (stats.encodedResponses)
+        {
+            s << " compressed responses: " << stats.encodedResponses
+              << " bytes saved: " << (stats.decodedBytes - stats.encodedBytes);
+        }
+        if (hostHealth.count(hostStats.first))
+        {
+            s << " health score: " << hostscore(hostStats.first);
+        }
+        s << "\n";
+    }
+
+    if (reset)
+    {
+        hostConnectionStats.clear();
+    }
+    return s.str();
+}
+
 bool CurlHttpIO::setmaxdownloadspeed(m_off_t bpslimit)
 {
     maxspeed[GET] = bpslimit;
+    directionbuckets[GET].setRate(bpslimit);
     return true;
 }
 
 bool CurlHttpIO::setmaxuploadspeed(m_off_t bpslimit)
 {
     maxspeed[PUT] = bpslimit;
+    directionbuckets[PUT].setRate(bpslimit);
     return true;
 }
 
+bool CurlHttpIO::setHostBandwidthLimit(direction_t d, const string& host, m_off_t bpslimit)
+{
+    if (d != GET && d != PUT)
+    {
+        return false;
+    }
+
+    if (bpslimit > 0)
+    {
+        hostlimits[d][host] = bpslimit;
+    }
+    else
+    {
+        hostlimits[d].erase(host);
+    }
+
+    for (auto& it : hostbuckets[d])
+    {
+        if (host.empty() || it.first == host)
+        {
+            it.second.setRate(hostlimit(d, it.first));
+        }
+    }
+
+    LOG_debug << "Bandwidth limit for " << (host.empty() ? string("every host") : host)
+              << (d == GET ? " (downloads): " : " (uploads): ") << bpslimit;
+    return true;
+}
+
+bool CurlHttpIO::setApiCompression(bool enable)
+{
+    apiacceptencoding.clear();
+    if (!enable)
+    {
+        return true;
+    }
+
+    curl_version_info_data* data = curl_version_info(CURLVERSION_NOW);
+    if (data->features & CURL_VERSION_LIBZ)
+    {
+        apiacceptencoding.append("gzip, deflate, ");
+    }
+#if LIBCURL_VERSION_NUM >= 0x073900 // At least cURL 7.57.0
+    if (data->features & CURL_VERSION_BROTLI)
+    {
+        apiacceptencoding.append("br, ");
+    }
+#endif
+#if LIBCURL_VERSION_NUM >= 0x074800 // At least cURL 7.72.0
+    if (data->features & CURL_VERSION_ZSTD)
+    {
+        apiacceptencoding.append("zstd, ");
+    }
+#endif
+
+    if (apiacceptencoding.empty())
+    {
+        LOG_warn << "cURL can't decode any compressed encoding";
+        return false;
+    }
+
+    apiacceptencoding.resize(apiacceptencoding.size() - 2);
+    LOG_debug << "Accept-Encoding for the API: " << apiacceptencoding;
+    return true;
+}
+
+bool CurlHttpIO::setDownloadBufferSize(long bytes)
+{
+#if LIBCURL_VERSION_NUM >= 0x073500 // At least cURL 7.53.0
+    // cURL accepts between 1 KB and CURL_MAX_READ_SIZE
+    downloadbuffersize = bytes > 0 ? std::min<long>(std::max<long>(bytes, 1024), CURL_MAX_READ_SIZE) : 0;
+    LOG_debug << "cURL download buffer size: " << downloadbuffersize;
+    return true;
+#else
+    (void)bytes;
+    return false;
+#endif
+}
+
+bool CurlHttpIO::setBandwidthClassLimit(direction_t d, bwclass_t c, m_off_t bpslimit)
+{
+    if ((d != GET && d != PUT) || c < BW_USER || c >= BW_CLASSES)
+    {
+        return false;
+    }
+
+    classbuckets[d][c].setRate(std::max<m_off_t>(bpslimit, 0));
+    return true;
+}
+
+m_off_t CurlHttpIO::hostlimit(direction_t d, const string& host) const
+{
+    auto it = hostlimits[d].find(host);
+    if (it == hostlimits[d].end())
+    {
+        it = hostlimits[d].find(string());
+    }
+    return it != hostlimits[d].end() ? it->second : 0;
+}
+
+m_off_t CurlHttpIO::bandwidthallowance(CurlHttpContext* httpctx)
+{
+    if (!httpctx || (httpctx->d != GET && httpctx->d != PUT))
+    {
+        return std::numeric_limits<m_off_t>::max();
+    }
+
+    TokenBucket::clock::time_point now = TokenBucket::clock::now();
+    m_off_t bytes = directionbuckets[httpctx->d].available(now);
+    if (bytes <= 0)
+    {
+        // the whole direction is out of budget, stop processing it until the next refill
+        arerequestspaused[httpctx->d] = true;
+        return 0;
+    }
+
+    bytes = std::min(bytes, classbuckets[httpctx->d][httpctx->req->mBandwidthClass].available(now));
+    if (httpctx->hostbucket)
+    {
+        bytes = std::min(bytes, httpctx->hostbucket->available(now));
+    }
+    return bytes;
+}
+
+void CurlHttpIO::consumebandwidth(CurlHttpContext* httpctx, m_off_t bytes)
+{
+    directionbuckets[httpctx->d].consume(bytes);
+    classbuckets[httpctx->d][httpctx->req->mBandwidthClass].consume(bytes);
+    if (httpctx->hostbucket)
+    {
+        httpctx->hostbucket->consume(bytes);
+    }
+}
+
 m_off_t CurlHttpIO::getmaxdownloadspeed()
 {
     return maxspeed[GET];
@@ -1037,14 +1507,15 @@ void CurlHttpIO::addevents(Waiter* w, int)
 
     for (int d = GET; d == GET || d == PUT; d += PUT - GET)
     {
-        if (arerequestspaused[d])
+        if (arerequestspaused[d] || !pausedrequests[d].empty())
         {
             if (curltimeoutms < 0 || curltimeoutms > 100)
             {
                 curltimeoutms = 100;
             }
         }
-        else
+
+        if (!arerequestspaused[d])
         {
             addcurlevents(waiter, (direction_t)d);
             if (curltimeoutreset[d] >= 0)
@@ -1452,50 +1923,6 @@ struct curl_slist* CurlHttpIO::clone_curl_slist(struct curl_slist* inlist)
     return outlist;
 }
 
-// Generate cash function
-// FIXME: make async/make multithreaded
-std::string gencash(const string& token, uint8_t easiness)
-{
-    // Calculate threshold from easiness
-    // easiness: encoded threshold (maximum acceptable value in the first 32 byte of the
-    // hash (little endian) - the lower, the harder to solve)
-    uint32_t threshold =
-        static_cast<uint32_t>((((easiness & 63) << 1) + 1) << ((easiness >> 6) * 7 + 3));
-    
-    // Token is 64 chars in B64, we need the 48 bytes in binary
-    string tokenBinary = Base64::atob(token);
-
-    // Buffer to hold 4-byte prefix + 262144 * 48 bytes of the token
-    std::vector<uint8_t> buffer(4 + 262144 * 48); // total size = 12582916
-    for (auto i = 0; i < 262144; ++i)
-    {
-        std::copy(tokenBinary.begin(), tokenBinary.end(), buffer.begin() + 4 + i * 48);
-    }
-
-    uint32_t* prefixptr = reinterpret_cast<uint32_t*>(buffer.data());
-
-    for (;;)
-    {
-        // increment prefix (the final result, but not its correctness, will depend on the CPU's endianness)
-	// we do not have an explicit abort condition (the actual easiness will be lenient enough)
-	(*prefixptr)++;
-
-        // SHA-256 hash
-        HashSHA256 hasher;
-        hasher.add((const byte*)buffer.data(), static_cast<unsigned>(buffer.size()));
-
-        string hash;
-        hasher.get(&hash);
-
-        if (htonl(*(reinterpret_cast<uint32_t*>(hash.data()))) <= threshold)
-        {
-            // success - return the prefix
-            string prefixToReturn(buffer.begin(), buffer.begin() + 4);
-            return Base64::btoa(prefixToReturn);
-        }
-    }
-}
-
 void CurlHttpIO::send_request(CurlHttpContext* httpctx)
 {
     CurlHttpIO* httpio = httpctx->httpio;
@@ -1505,12 +1932,18 @@ void CurlHttpIO::send_request(CurlHttpContext* httpctx)
 
     LOG_debug << httpctx->req->logname << req->getMethodString() << " target URL: " << getSafeUrl(req->posturl);
 
+    if (httpctx->resolveTime < 0)
+    {
+        httpctx->resolveTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - req->postStartTime).count();
+    }
+
     if (req->binary)
     {
         LOG_debug << httpctx->req->logname << "[sending " << (data ? len : req->out->size()) << " bytes of raw data]";
     }
-    else
+    else if (MEGA_LOG_ENABLED(MEGA_JSON_LOG_MAX_LEVEL, logDebug))
     {
+        // the payloads are JSON requests, under that subsystem's level
         if (gLogJSONRequests || req->out->size() < size_t(SimpleLogger::getMaxPayloadLogSize()))
         {
             LOG_debug << httpctx->req->logname << "Sending " << req->out->size() << ": " << DirectMessage(req->out->c_str(), req->out->size())
@@ -1530,11 +1963,14 @@ void CurlHttpIO::send_request(CurlHttpContext* httpctx)
 
     if (!req->mHashcashToken.empty())
     {
-        string nextValue = gencash(req->mHashcashToken, req->mHashcashEasiness);
+        // normally solved beforehand, off this thread
+        string nextValue = req->mHashcashPrefix.empty() ? gencash(req->mHashcashToken, req->mHashcashEasiness)
+                                                        : std::move(req->mHashcashPrefix);
         string xHashcashHeader{"X-Hashcash: 1:" + req->mHashcashToken + ":" + std::move(nextValue)};
         httpctx->headers = curl_slist_append(httpctx->headers, xHashcashHeader.c_str());
         LOG_warn << "X-Hashcash computed: " << xHashcashHeader;
         req->mHashcashToken.clear();
+        req->mHashcashPrefix.clear();
     }
 
 #ifdef MEGA_USE_C_ARES
@@ -1542,6 +1978,13 @@ void CurlHttpIO::send_request(CurlHttpContext* httpctx)
     {
         NET_debug << "Using the hostname instead of the IP";
     }
+    else if (httpio->happyeyeballs && req->method != METHOD_NONE && httpio->ipv6requestsenabled
+             && httpio->raceableaddresses(httpctx))
+    {
+        // the hostname stays in the URL, cURL connects to both addresses, IPv6 first
+        NET_debug << "Racing the IPs of the hostname: " << httpctx->resolve->data;
+        httpctx->isIPv6 = true;
+    }
     else if(httpctx->hostip.size())
     {
         NET_debug << "Using the IP of the hostname: " << httpctx->hostip;
@@ -1554,6 +1997,8 @@ void CurlHttpIO::send_request(CurlHttpContext* httpctx)
         req->status = REQ_FAILURE;
         req->httpiohandle = NULL;
         curl_slist_free_all(httpctx->headers);
+        curl_slist_free_all(httpctx->resolve);
+        httpctx->resolve = nullptr;
 
         httpctx->req = NULL;
         if (!httpctx->ares_pending)
@@ -1582,12 +2027,21 @@ void CurlHttpIO::send_request(CurlHttpContext* httpctx)
             break;
         }
 
+        if (req->mPrewarmDirection != NONE)
+        {
+            curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+        }
+
         if (req->timeoutms)
         {
             curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, req->timeoutms);
         }
 
         curl_easy_setopt(curl, CURLOPT_URL, httpctx->posturl.c_str());
+        if (httpctx->resolve)
+        {
+            curl_easy_setopt(curl, CURLOPT_RESOLVE, httpctx->resolve);
+        }
         curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_data);
         curl_easy_setopt(curl, CURLOPT_READDATA, (void*)req);
         curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, seek_data);
@@ -1614,6 +2068,22 @@ void CurlHttpIO::send_request(CurlHttpContext* httpctx)
         curl_easy_setopt(curl, CURLOPT_QUICK_EXIT, 1L);
 #endif
 
+#if LIBCURL_VERSION_NUM >= 0x073200 // At least cURL 7.50.0
+        if (httpio->http2multiplexing[httpctx->d])
+        {
+            // HTTP/1.1 is still negotiated with servers that don't support HTTP/2, and
+            // concurrent requests wait to share the connection being set up instead of opening more
+            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+            curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+        }
+#endif
+
+        if (httpctx->d == API && !httpio->apiacceptencoding.empty())
+        {
+            // cURL decodes the response as it arrives, so data reaches the JSON splitter already inflated
+            curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, httpio->apiacceptencoding.c_str());
+        }
+
         // Some networks (eg vodafone UK) seem to block TLS 1.3 ClientHello.  1.2 is secure, and works:
         curl_easy_setopt(curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2 | CURL_SSLVERSION_MAX_TLSv1_2);
 
@@ -1622,6 +2092,19 @@ void CurlHttpIO::send_request(CurlHttpContext* httpctx)
             LOG_debug << "Low maxspeed, set curl buffer size to 4 KB";
             curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, 4096L);
         }
+        else if (httpctx->d == GET && httpio->downloadbuffersize)
+        {
+            curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, httpio->downloadbuffersize);
+        }
+
+#if LIBCURL_VERSION_NUM >= 0x073e00 // At least cURL 7.62.0
+        if (httpctx->d == PUT && !httpio->maxspeed[PUT])
+        {
+            // read_data() hands the encrypted chunk to cURL from req->out, fill its upload
+            // buffer in fewer and larger calls, which also become fewer and larger TLS writes
+            curl_easy_setopt(curl, CURLOPT_UPLOAD_BUFFERSIZE, UPLOAD_BUFFER_SIZE);
+        }
+#endif
 
         if (req->minspeed)
         {
@@ -1735,6 +2218,8 @@ void CurlHttpIO::send_request(CurlHttpContext* httpctx)
         req->status = REQ_FAILURE;
         req->httpiohandle = NULL;
         curl_slist_free_all(httpctx->headers);
+        curl_slist_free_all(httpctx->resolve);
+        httpctx->resolve = nullptr;
 
         httpctx->req = NULL;
 
@@ -1951,7 +2436,14 @@ void CurlHttpIO::post(HttpReq* req, const char* data, unsigned len)
 #ifdef MEGA_USE_C_ARES
     httpctx->ares_pending = 0;
 #endif
-    httpctx->d = (req->type == REQ_JSON || req->method == METHOD_NONE) ? API : ((data ? len : req->out->size()) ? PUT : GET);
+    if (req->mPrewarmDirection != NONE)
+    {
+        httpctx->d = req->mPrewarmDirection;
+    }
+    else
+    {
+        httpctx->d = (req->type == REQ_JSON || req->method == METHOD_NONE) ? API : ((data ? len : req->out->size()) ? PUT : GET);
+    }
     req->httpiohandle = (void*)httpctx;
 
     bool validrequest = true;
@@ -1974,6 +2466,17 @@ void CurlHttpIO::post(HttpReq* req, const char* data, unsigned len)
         return;
     }
 
+    if (httpctx->d != API)
+    {
+        auto it = hostbuckets[httpctx->d].find(httpctx->hostname);
+        if (it == hostbuckets[httpctx->d].end())
+        {
+            it = hostbuckets[httpctx->d].emplace(httpctx->hostname, TokenBucket()).first;
+            it->second.setRate(hostlimit(httpctx->d, httpctx->hostname));
+        }
+        httpctx->hostbucket = &it->second;
+    }
+
     if (!ipv6requestsenabled && ipv6available() && Waiter::ds - ipv6deactivationtime > IPV6_RETRY_INTERVAL_DS)
     {
         ipv6requestsenabled = true;
@@ -2179,10 +2682,12 @@ void CurlHttpIO::cancel(HttpReq* req)
         if (httpctx->curl)
         {
             numconnections[httpctx->d]--;
-            pausedrequests[httpctx->d].erase(httpctx->curl);
+            pausedrequests[httpctx->d].erase(std::remove(pausedrequests[httpctx->d].begin(), pausedrequests[httpctx->d].end(), httpctx->curl), pausedrequests[httpctx->d].end());
             curl_multi_remove_handle(curlm[httpctx->d], httpctx->curl);
             curl_easy_cleanup(httpctx->curl);
             curl_slist_free_all(httpctx->headers);
+            curl_slist_free_all(httpctx->resolve);
+            httpctx->resolve = nullptr;
         }
 
         httpctx->req = NULL;
@@ -2240,19 +2745,34 @@ bool CurlHttpIO::doio()
 
     for (int d = GET; d == GET || d == PUT; d += PUT - GET)
     {
-        partialdata[d] = 0;
-        if (arerequestspaused[d])
+        if (!pausedrequests[d].empty())
         {
+            // user-initiated transfers get the refilled budget first, then syncs, then backups.
+            // Within a class, requests take turns: a request paused again goes to the back
+            bool resumed = false;
             arerequestspaused[d] = false;
-            set<CURL *>::iterator it = pausedrequests[d].begin();
-            while (!arerequestspaused[d] && it != pausedrequests[d].end())
+            for (int c = BW_USER; c < BW_CLASSES && !arerequestspaused[d]; c++)
             {
-                CURL *easy_handle = *it;
-                pausedrequests[d].erase(it++);
-                curl_easy_pause(easy_handle, CURLPAUSE_CONT);
+                for (size_t n = pausedrequests[d].size(); n && !arerequestspaused[d]; n--)
+                {
+                    CURL *easy_handle = pausedrequests[d].front();
+                    pausedrequests[d].pop_front();
+
+                    HttpReq* req = nullptr;
+                    curl_easy_getinfo(easy_handle, CURLINFO_PRIVATE, (char**)&req);
+                    if (!req || req->mBandwidthClass != c
+                            || bandwidthallowance((CurlHttpContext*)req->httpiohandle) <= 0)
+                    {
+                        pausedrequests[d].push_back(easy_handle);
+                        continue;
+                    }
+
+                    resumed = true;
+                    curl_easy_pause(easy_handle, CURLPAUSE_CONT);
+                }
             }
 
-            if (!arerequestspaused[d])
+            if (resumed && !arerequestspaused[d])
             {
                 int dummy;
                 curl_multi_socket_action(curlm[d], CURL_SOCKET_TIMEOUT, 0, &dummy);
@@ -2285,6 +2805,7 @@ bool CurlHttpIO::multidoio(CURLM *curlmhandle)
             if (msg->msg == CURLMSG_DONE)
             {
                 measureLatency(msg->easy_handle, req);
+                recordConnection(msg->easy_handle, req);
 
                 CURLcode errorCode = msg->data.result;
                 if (errorCode != CURLE_OK && errorCode != CURLE_HTTP_RETURNED_ERROR && errorCode != CURLE_WRITE_ERROR)
@@ -2352,6 +2873,7 @@ bool CurlHttpIO::multidoio(CURLM *curlmhandle)
                 long httpstatus;
                 curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &httpstatus);
                 req->httpstatus = int(httpstatus);
+                req->joinSegments();
 
                 LOG_debug << req->logname << "CURLMSG_DONE with HTTP status: " << req->httpstatus << " from "
                           << (req->httpiohandle ? (((CurlHttpContext*)req->httpiohandle)->hostname + " - " + ((CurlHttpContext*)req->httpiohandle)->hostip) : "(unknown) ");
@@ -2434,6 +2956,10 @@ bool CurlHttpIO::multidoio(CURLM *curlmhandle)
                              << "  bufferSize: " << (req->buf ? req->bufpos : (int)req->in.size());
                 }
 
+                // server or network errors, not the expected refusals like an expired URL or overquota
+                updatehealth(msg->easy_handle, req, req->status != REQ_SUCCESS
+                             && (!req->httpstatus || (req->httpstatus >= 500 && req->httpstatus != 509)));
+
                 if (req->httpstatus)
                 {
                     success = true;
@@ -2487,10 +3013,12 @@ bool CurlHttpIO::multidoio(CURLM *curlmhandle)
                                     ))
                         {
                             numconnections[httpctx->d]--;
-                            pausedrequests[httpctx->d].erase(msg->easy_handle);
+                            pausedrequests[httpctx->d].erase(std::remove(pausedrequests[httpctx->d].begin(), pausedrequests[httpctx->d].end(), msg->easy_handle), pausedrequests[httpctx->d].end());
                             curl_multi_remove_handle(curlmhandle, msg->easy_handle);
                             curl_easy_cleanup(msg->easy_handle);
                             curl_slist_free_all(httpctx->headers);
+                            curl_slist_free_all(httpctx->resolve);
+                            httpctx->resolve = nullptr;
                             httpctx->isCachedIp = false;
                             httpctx->headers = NULL;
                             httpctx->curl = NULL;
@@ -2532,9 +3060,13 @@ bool CurlHttpIO::multidoio(CURLM *curlmhandle)
             if (httpctx)
             {
                 numconnections[httpctx->d]--;
-                pausedrequests[httpctx->d].erase(httpctx->curl);
+                pausedrequests[httpctx->d].erase(std::remove(pausedrequests[httpctx->d].begin(), pausedrequests[httpctx->d].end(), httpctx->curl), pausedrequests[httpctx->d].end());
 
                 curl_slist_free_all(httpctx->headers);
+
+                curl_slist_free_all(httpctx->resolve);
+
+                httpctx->resolve = nullptr;
                 req->httpiohandle = NULL;
 
                 httpctx->req = NULL;
@@ -2668,25 +3200,20 @@ size_t CurlHttpIO::read_data(void* ptr, size_t size, size_t nmemb, void* source)
 
     req->lastdata = Waiter::ds;
 
-    if (httpio->maxspeed[PUT])
+    if (httpctx->d == PUT)
     {
-        bool isApi = (req->type == REQ_JSON);
-        if (!isApi)
+        m_off_t maxbytes = httpio->bandwidthallowance(httpctx);
+        if (maxbytes <= 0)
         {
-            long maxbytes = long( ((httpio->maxspeed[PUT] - httpio->uploadSpeed) * SpeedController::SPEED_MEAN_CIRCULAR_BUFFER_SIZE_SECONDS) - httpio->partialdata[PUT] );
-            if (maxbytes <= 0)
-            {
-                httpio->pausedrequests[PUT].insert(httpctx->curl);
-                httpio->arerequestspaused[PUT] = true;
-                return CURL_READFUNC_PAUSE;
-            }
+            httpio->pausedrequests[PUT].push_back(httpctx->curl);
+            return CURL_READFUNC_PAUSE;
+        }
 
-            if (nread > (size_t)maxbytes)
-            {
-                nread = static_cast<size_t>(maxbytes);
-            }
-            httpio->partialdata[PUT] += nread;
+        if (static_cast<m_off_t>(nread) > maxbytes)
+        {
+            nread = static_cast<size_t>(maxbytes);
         }
+        httpio->consumebandwidth(httpctx, static_cast<m_off_t>(nread));
     }
 
     memcpy(ptr, buf, nread);
@@ -2702,27 +3229,25 @@ size_t CurlHttpIO::write_data(void* ptr, size_t size, size_t nmemb, void* target
     CurlHttpIO* httpio = (CurlHttpIO*)req->httpio;
     if (httpio)
     {
-        if (httpio->maxspeed[GET])
+        CurlHttpContext* httpctx = (CurlHttpContext*)req->httpiohandle;
+        if (httpctx && httpctx->d == GET && len)
         {
-            CurlHttpContext* httpctx = (CurlHttpContext*)req->httpiohandle;
-            bool isUpload = (httpctx->data ? httpctx->len : req->out->size()) > 0;
-            bool isApi = (req->type == REQ_JSON);
-            if (!isApi && !isUpload)
+            // cURL can't take a partial write, so accept it whole and let the budgets go into debt
+            if (httpio->bandwidthallowance(httpctx) <= 0)
             {
-                if ((httpio->downloadSpeed + ((httpio->partialdata[GET] + len) / static_cast<m_off_t>(SpeedController::SPEED_MEAN_CIRCULAR_BUFFER_SIZE_SECONDS))) > httpio->maxspeed[GET])
-                {
-                    CurlHttpContext* httpctx = (CurlHttpContext*)req->httpiohandle;
-                    httpio->pausedrequests[GET].insert(httpctx->curl);
-                    httpio->arerequestspaused[GET] = true;
-                    return CURL_WRITEFUNC_PAUSE;
-                }
-                httpio->partialdata[GET] += len;
+                httpio->pausedrequests[GET].push_back(httpctx->curl);
+                return CURL_WRITEFUNC_PAUSE;
             }
+            httpio->consumebandwidth(httpctx, len);
         }
 
         if (len)
         {
             req->put(ptr, static_cast<unsigned>(len), true);
+            if (httpctx && httpctx->encodedresponse)
+            {
+                httpctx->decodedbytes += len;
+            }
         }
 
         httpio->lastdata = Waiter::ds;
@@ -2757,7 +3282,8 @@ size_t CurlHttpIO::check_header(void* ptr, size_t size, size_t nmemb, void* targ
     }
     else if (len > 15 && !memcmp(ptr, "Content-Length:", 15))
     {
-        if (req->contentlength < 0)
+        CurlHttpContext* httpctx = (CurlHttpContext*)req->httpiohandle;
+        if (req->contentlength < 0 && !(httpctx && httpctx->encodedresponse))
         {
             req->setcontentlength(atoll((char*)ptr + 15));
         }
@@ -2765,6 +3291,24 @@ size_t CurlHttpIO::check_header(void* ptr, size_t size, size_t nmemb, void* targ
     else if (len > 24 && !memcmp(ptr, "Original-Content-Length:", 24))
     {
         req->setcontentlength(atoll((char*)ptr + 24));
+        if (CurlHttpContext* httpctx = (CurlHttpContext*)req->httpiohandle)
+        {
+            httpctx->originalcontentlength = true;
+        }
+    }
+    else if (len > 18 && !strncasecmp((const char*)ptr, "Content-Encoding:", 17)
+             && strncasecmp((const char*)ptr + 17, " identity", 9))
+    {
+        CurlHttpContext* httpctx = (CurlHttpContext*)req->httpiohandle;
+        if (httpctx && !httpctx->encodedresponse)
+        {
+            httpctx->encodedresponse = true;
+            if (!httpctx->originalcontentlength)
+            {
+                // the Content-Length received is the encoded one
+                req->contentlength = -1;
+            }
+        }
     }
     else if (len > 17 && !memcmp(ptr, "X-MEGA-Time-Left:", 17))
     {
@@ -2879,6 +3423,11 @@ int CurlHttpIO::socket_callback(CURL *, curl_socket_t s, int what, void *userp,
 
 #if defined(_WIN32)
             it->second.closeEvent();
+#elif defined(USE_EPOLL)
+            if (httpio->waiter)
+            {
+                httpio->waiter->forgetfd(s);
+            }
 #endif
             it->second.mode = 0;
         }
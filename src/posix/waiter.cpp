@@ -42,11 +42,22 @@ PosixWaiter::PosixWaiter()
         LOG_err << "fcntl error";
     }
 
+#ifdef USE_EPOLL
+    if ((mEpollFd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+    {
+        LOG_fatal << "Error creating epoll instance: " << errno;
+        throw std::runtime_error("Error creating epoll instance");
+    }
+#endif
+
     maxfd = -1;
 }
 
 PosixWaiter::~PosixWaiter()
 {
+#ifdef USE_EPOLL
+    close(mEpollFd);
+#endif
     close(m_pipe[0]);
     close(m_pipe[1]);
 }
@@ -84,9 +95,109 @@ bool PosixWaiter::fd_filter(int nfds, mega_fd_set_t* fds, mega_fd_set_t* ignoref
     return false;
 }
 
+#ifdef USE_EPOLL
+void PosixWaiter::forgetfd(int fd)
+{
+    auto it = std::lower_bound(mRegistered.begin(), mRegistered.end(), std::make_pair(fd, uint32_t(0)));
+    if (it != mRegistered.end() && it->first == fd)
+    {
+        // if it's still open, the next registration will find it and modify it
+        mRegistered.erase(it);
+    }
+}
+
+// bring the epoll interest list in line with rfds/wfds/efds
+void PosixWaiter::updateregistrations()
+{
+    // the fd sets are sorted, merge them
+    mWanted.clear();
+    auto r = rfds.begin();
+    auto w = wfds.begin();
+    auto e = efds.begin();
+    while (r != rfds.end() || w != wfds.end() || e != efds.end())
+    {
+        int fd = std::numeric_limits<int>::max();
+        if (r != rfds.end()) fd = std::min(fd, *r);
+        if (w != wfds.end()) fd = std::min(fd, *w);
+        if (e != efds.end()) fd = std::min(fd, *e);
+
+        uint32_t events = 0;
+        if (r != rfds.end() && *r == fd)
+        {
+            events |= EPOLLIN;
+            r++;
+        }
+        if (w != wfds.end() && *w == fd)
+        {
+            events |= EPOLLOUT;
+            w++;
+        }
+        if (e != efds.end() && *e == fd)
+        {
+            events |= EPOLLPRI;
+            e++;
+        }
+        mWanted.emplace_back(fd, events);
+    }
+
+    auto ctl = [this](int op, int fd, uint32_t events)
+    {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        if (!epoll_ctl(mEpollFd, op, fd, &ev))
+        {
+            return;
+        }
+
+        // the fd was closed without forgetfd(), or reopened with the same number
+        if (op == EPOLL_CTL_ADD && errno == EEXIST)
+        {
+            epoll_ctl(mEpollFd, EPOLL_CTL_MOD, fd, &ev);
+        }
+        else if (op == EPOLL_CTL_MOD && errno == ENOENT)
+        {
+            epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &ev);
+        }
+        else if (op != EPOLL_CTL_DEL)
+        {
+            LOG_warn << "epoll_ctl failed for fd " << fd << ": " << errno;
+        }
+    };
+
+    auto registered = mRegistered.begin();
+    auto wanted = mWanted.begin();
+    while (registered != mRegistered.end() || wanted != mWanted.end())
+    {
+        if (wanted == mWanted.end() || (registered != mRegistered.end() && registered->first < wanted->first))
+        {
+            ctl(EPOLL_CTL_DEL, registered->first, 0);    // closed fds are already out of the interest list
+            registered++;
+        }
+        else if (registered == mRegistered.end() || wanted->first < registered->first)
+        {
+            ctl(EPOLL_CTL_ADD, wanted->first, wanted->second);
+            wanted++;
+        }
+        else
+        {
+            if (registered->second != wanted->second)
+            {
+                ctl(EPOLL_CTL_MOD, wanted->first, wanted->second);
+            }
+            registered++;
+            wanted++;
+        }
+    }
+
+    mRegistered.swap(mWanted);
+}
+#endif
+
 // wait for supplied events (sockets, filesystem changes), plus timeout + application events
 // maxds specifies the maximum amount of time to wait in deciseconds (or
-// NEVER if no timeout scheduled) returns application-specific bitmask.
+// NEVER if no timeout scheduled), and maxms may bring it forward to the millisecond.
+// Returns application-specific bitmask.
 // bit 0 set indicates that exec() needs to be called.
 int PosixWaiter::wait()
 {
@@ -98,21 +209,28 @@ int PosixWaiter::wait()
 
     bumpmaxfd(m_pipe[0]);
 
-    if (EVER(maxds))
-    {
-        dstime us = 1000000 / 10 * maxds;
+    int64_t waitms = timeoutms();
 
-        tv.tv_sec = us / 1000000;
-        tv.tv_usec = (suseconds_t)(us - tv.tv_sec * 1000000);
+    if (waitms >= 0)
+    {
+        tv.tv_sec = static_cast<time_t>(waitms / 1000);
+        tv.tv_usec = static_cast<suseconds_t>(waitms % 1000 * 1000);
     }
 
-#ifdef USE_POLL
-    // wait infinite (-1) if maxds is max dstime OR it would overflow platform's int
+#if defined(USE_POLL) || defined(USE_EPOLL)
+    // wait infinite (-1) if there is no timeout OR it would overflow platform's int
     int timeoutInMs = -1;
-    if (EVER(maxds) && maxds <= std::numeric_limits<int>::max() / 100)
+    if (waitms >= 0 && waitms <= std::numeric_limits<int>::max())
     {
-        timeoutInMs = static_cast<int>(maxds) * 100;
+        timeoutInMs = static_cast<int>(waitms);
     }
+#endif
+
+#ifdef USE_EPOLL
+    updateregistrations();
+    mEvents.resize(std::max<size_t>(mRegistered.size(), 1));
+    numfd = epoll_wait(mEpollFd, mEvents.data(), static_cast<int>(mEvents.size()), timeoutInMs);
+#elif defined(USE_POLL)
     auto total = rfds.size() + wfds.size() + efds.size();
     struct pollfd fds[total];
 
@@ -139,7 +257,7 @@ int PosixWaiter::wait()
     }
     numfd = poll(fds, total, timeoutInMs);
 #else
-    numfd = select(maxfd + 1, &rfds, &wfds, &efds, EVER(maxds) ? &tv : NULL);
+    numfd = select(maxfd + 1, &rfds, &wfds, &efds, waitms >= 0 ? &tv : NULL);
 #endif
 
     // empty pipe
@@ -162,7 +280,16 @@ int PosixWaiter::wait()
     }
 
     // request exec() to be run only if a non-ignored fd was triggered
-#ifdef USE_POLL
+#ifdef USE_EPOLL
+    for (int i = 0; i < numfd; i++)
+    {
+        if (!MEGA_FD_ISSET(mEvents[static_cast<size_t>(i)].data.fd, &ignorefds))
+        {
+            return NEEDEXEC;
+        }
+    }
+    return 0;
+#elif defined(USE_POLL)
     for (unsigned int i = 0 ; i < total ; i++)
     {
         if  ((fds[i].revents & (POLLIN_SET | POLLOUT_SET | POLLEX_SET) )  && !MEGA_FD_ISSET(fds[i].fd, &ignorefds) )
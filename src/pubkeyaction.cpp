@@ -41,13 +41,40 @@ void PubKeyActionPutNodes::proc(MegaClient* client, User* u)
 {
     if (u && u->pubk.isvalid())
     {
-        byte buf[AsymmCipher::MAXKEYLENGTH];
-        int t;
+        // re-encrypt all node keys to the user's public key. Every key is a modular
+        // exponentiation, so big batches are spread over the worker threads (each one with its
+        // own random generator) and the keys are only replaced once all of them succeeded
+        const AsymmCipher& pubk = u->pubk;
+        vector<string> encrypted(nn.size());
+        auto encrypt = [this, &pubk, &encrypted](size_t begin, size_t end, PrnGen& rng)
+        {
+            byte buf[AsymmCipher::MAXKEYLENGTH];
+            for (size_t i = begin; i < end; ++i)
+            {
+                int t = pubk.encrypt(rng, (const byte*)nn[i].nodekey.data(), nn[i].nodekey.size(), buf, sizeof buf);
+                if (t)
+                {
+                    encrypted[i].assign((char*)buf, static_cast<size_t>(t));
+                }
+            }
+        };
+
+        if (nn.size() <= PARALLEL_BATCH_SIZE)
+        {
+            encrypt(0, nn.size(), client->rng);
+        }
+        else
+        {
+            client->mAsyncQueue.runInBatches(nn.size(), PARALLEL_BATCH_SIZE, [&encrypt](size_t begin, size_t end, SymmCipher&)
+            {
+                PrnGen rng;
+                encrypt(begin, end, rng);
+            });
+        }
 
-        // re-encrypt all node keys to the user's public key
-        for (size_t i = nn.size(); i--;)
+        for (size_t i = 0; i < nn.size(); ++i)
         {
-            if (!(t = u->pubk.encrypt(client->rng, (const byte*)nn[i].nodekey.data(), nn[i].nodekey.size(), buf, sizeof buf)))
+            if (encrypted[i].empty())
             {
                 if (completion)
                     completion(API_EINTERNAL, USER_HANDLE, nn, false, tag, {});
@@ -55,8 +82,11 @@ void PubKeyActionPutNodes::proc(MegaClient* client, User* u)
                     client->app->putnodes_result(API_EINTERNAL, USER_HANDLE, nn, false, tag, {});
                 return;
             }
+        }
 
-            nn[i].nodekey.assign((char*)buf, static_cast<size_t>(t));
+        for (size_t i = 0; i < nn.size(); ++i)
+        {
+            nn[i].nodekey = std::move(encrypted[i]);
         }
 
         client->reqs.add(new CommandPutNodes(client,
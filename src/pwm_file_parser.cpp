@@ -46,6 +46,19 @@ inline bool fileIsAccessible(const std::string& fname)
 }
 
 PassFileParseResult parseGooglePasswordCSVFile(const std::string& filePath)
+{
+    std::vector<PassEntryParseResult> entries;
+    PassFileParseResult result = parseGooglePasswordCSVFile(filePath,
+                                                            [&entries](PassEntryParseResult&& entry)
+                                                            {
+                                                                entries.emplace_back(std::move(entry));
+                                                            });
+    result.mResults = std::move(entries);
+    return result;
+}
+
+PassFileParseResult parseGooglePasswordCSVFile(const std::string& filePath,
+                                               const PassEntryConsumer& onEntry)
 {
     csv::CSVFormat format;
     format.delimiter(',').header_row(0).variable_columns(true);
@@ -92,6 +105,7 @@ PassFileParseResult parseGooglePasswordCSVFile(const std::string& filePath)
         return result;
     }
     size_t expectedNumCols = colNames.size();
+    bool thereIsAnEntry = false;
     bool thereIsAValidEntry = false;
 
     for (auto& row: reader)
@@ -99,10 +113,11 @@ PassFileParseResult parseGooglePasswordCSVFile(const std::string& filePath)
         PassEntryParseResult entryResult;
         // Save the original line
         std::getline(openFile, entryResult.mOriginalContent);
+        thereIsAnEntry = true;
         if (row.size() != expectedNumCols)
         {
             entryResult.mErrCode = PassEntryParseResult::ErrCode::INVALID_NUM_OF_COLUMN;
-            result.mResults.emplace_back(std::move(entryResult));
+            onEntry(std::move(entryResult));
             continue;
         }
 
@@ -112,13 +127,13 @@ PassFileParseResult parseGooglePasswordCSVFile(const std::string& filePath)
         entryResult.mPassword = row["password"].get();
         entryResult.mNote = row["note"].get();
 
-        result.mResults.emplace_back(std::move(entryResult));
+        onEntry(std::move(entryResult));
         thereIsAValidEntry = true;
     }
     if (!thereIsAValidEntry)
     {
         result.mErrCode = PassFileParseResult::ErrCode::NO_VALID_ENTRIES;
-        result.mErrMsg = result.mResults.empty() ?
+        result.mErrMsg = !thereIsAnEntry ?
                              "The input file has no entries to read" :
                              "All the entries in the file were wrongly formatted";
     }
@@ -126,6 +141,21 @@ PassFileParseResult parseGooglePasswordCSVFile(const std::string& filePath)
 }
 
 PassFileParseResult readPasswordImportFile(const std::string& filePath, const FileSource source)
+{
+    std::vector<PassEntryParseResult> entries;
+    PassFileParseResult result = readPasswordImportFile(filePath,
+                                                        source,
+                                                        [&entries](PassEntryParseResult&& entry)
+                                                        {
+                                                            entries.emplace_back(std::move(entry));
+                                                        });
+    result.mResults = std::move(entries);
+    return result;
+}
+
+PassFileParseResult readPasswordImportFile(const std::string& filePath,
+                                           const FileSource source,
+                                           const PassEntryConsumer& onEntry)
 {
     // Common validation
     // TODO: Once C++17 filesystem is allowed, check for existence for a more detailed error report
@@ -140,7 +170,7 @@ PassFileParseResult readPasswordImportFile(const std::string& filePath, const Fi
     switch (source)
     {
         case FileSource::GOOGLE_PASSWORD:
-            return parseGooglePasswordCSVFile(filePath);
+            return parseGooglePasswordCSVFile(filePath, onEntry);
     }
     assert(false); // All cases should be covered by the switch statement
     return {};
@@ -66,9 +66,10 @@ struct FaultyServers
     /**
      * @brief Select the worst server based on records of recent failures
      * @param urls The set of URLs to check against previosly failing servers
+     * @param httpio If none of the URLs failed recently, the first one whose server it reports as degraded is selected
      * @return The index from 0 to 5, or 6 (RAIDPARTS) if none of the URLs have failed recently.
      */
-    unsigned selectWorstServer(vector<string> urls)
+    unsigned selectWorstServer(vector<string> urls, HttpIO* httpio = nullptr)
     {
         // start with 6 connections and drop the slowest to respond, build the file from the other 5.
         // (unless we recently had problems with the server of one of the 6 URLs, in which case start with the other 5 right away)
@@ -99,6 +100,14 @@ struct FaultyServers
             }
         }
 
+        for (unsigned i = 0; httpio && worstindex == RAIDPARTS && i < urls.size(); ++i)
+        {
+            if (httpio->isHostDegraded(urls[i]))
+            {
+                worstindex = i;
+            }
+        }
+
         return worstindex;
     }
 
@@ -115,7 +124,7 @@ RaidBufferManager::FilePiece::FilePiece()
 
 RaidBufferManager::FilePiece::FilePiece(m_off_t p, size_t len)
     : pos(p)
-    , buf(new byte[len + std::min<size_t>(SymmCipher::BLOCKSIZE, RAIDSECTOR)], 0, len)   // SymmCipher::ctr_crypt requirement: decryption: data must be padded to BLOCKSIZE.  Also make sure we can xor up to RAIDSECTOR more for convenience
+    , buf(HttpReq::http_buf_t::allocate(len + std::min<size_t>(SymmCipher::BLOCKSIZE, RAIDSECTOR)), 0, len)   // SymmCipher::ctr_crypt requirement: decryption: data must be padded to BLOCKSIZE.  Also make sure we can xor up to RAIDSECTOR more for convenience
 {
 }
 
@@ -274,6 +283,64 @@ bool RaidBufferManager::isRaidConnectionProgressBlocked(unsigned connectionNum)
     return connectionPaused[connectionNum];
 }
 
+void RaidBufferManager::setRaidLookahead(m_off_t bytes)
+{
+    raidLookaheadBytes = std::max<m_off_t>(bytes, 0);
+}
+
+m_off_t RaidBufferManager::raidPartLookahead() const
+{
+    m_off_t chunk = m_off_t(raidLinesPerChunk) * RAIDSECTOR;
+    if (!raidLookaheadBytes)
+    {
+        return RaidReadAheadChunksPausePoint * chunk;
+    }
+
+    // at least one chunk ahead, so the fast parts still overlap with the slowest
+    m_off_t perPart = raidLookaheadBytes / EFFECTIVE_RAIDPARTS;
+    return std::max(perPart - perPart % RAIDSECTOR, chunk);
+}
+
+m_off_t RaidBufferManager::raidPartReceivedPos(unsigned connectionNum) const
+{
+    const std::deque<FilePiece*>& connectionpieces = raidinputparts[connectionNum];
+    return connectionpieces.empty() ? raidpartspos : connectionpieces.back()->pos + m_off_t(connectionpieces.back()->buf.datalen());
+}
+
+m_off_t RaidBufferManager::raidPartLag(unsigned connectionNum) const
+{
+    assert(connectionNum < RAIDPARTS);
+
+    m_off_t furthest = raidpartspos;
+    for (unsigned i = RAIDPARTS; i--; )
+    {
+        if (i != unusedRaidConnection)
+        {
+            furthest = std::max(furthest, raidPartReceivedPos(i));
+        }
+    }
+    return furthest - raidPartReceivedPos(connectionNum);
+}
+
+m_off_t RaidBufferManager::bufferedInputBytes() const
+{
+    size_t bytes = leftoverchunk.buf.datalen();
+    for (unsigned i = RAIDPARTS; i--; )
+    {
+        for (const FilePiece* piece : raidinputparts[i])
+        {
+            bytes += piece->buf.datalen();
+        }
+    }
+    return static_cast<m_off_t>(bytes);
+}
+
+m_off_t RaidBufferManager::outputPieceBytes(unsigned connectionNum) const
+{
+    auto i = asyncoutputbuffers.find(connectionNum);
+    return i == asyncoutputbuffers.end() || !i->second ? 0 : static_cast<m_off_t>(i->second->buf.datalen());
+}
+
 const std::string& RaidBufferManager::tempURL(unsigned connectionNum)
 {
     if (isRaid())
@@ -385,9 +452,23 @@ std::pair<m_off_t, m_off_t> RaidBufferManager::nextNPosForConnection(unsigned co
         m_off_t maxpos = transferSize(connectionNum);
 
         // if this connection gets too far ahead of the others, pause it until the others catch up a bit
-        if ((curpos >= raidpartspos + RaidReadAheadChunksPausePoint * raidLinesPerChunk * RAIDSECTOR) ||
-            (curpos > raidpartspos + RaidReadAheadChunksUnpausePoint * raidLinesPerChunk * RAIDSECTOR && connectionPaused[connectionNum]))
+        m_off_t lookahead = raidPartLookahead();
+        if ((curpos >= raidpartspos + lookahead) ||
+            (curpos > raidpartspos + lookahead / 2 && connectionPaused[connectionNum]))
         {
+            if (!connectionPaused[connectionNum])
+            {
+                unsigned slowest = connectionNum;
+                for (unsigned i = RAIDPARTS; i--; )
+                {
+                    if (i != unusedRaidConnection && raidPartLag(i) > raidPartLag(slowest))
+                    {
+                        slowest = i;
+                    }
+                }
+                LOG_debug << "Raid part " << connectionNum << " paused " << lookahead << " bytes ahead, part "
+                          << slowest << " lags by " << raidPartLag(slowest);
+            }
             connectionPaused[connectionNum] = true;
             pauseConnectionForRaid = true;
             return std::make_pair(curpos, curpos);
@@ -692,11 +773,21 @@ m_off_t TransferBufferManager::calcOutputChunkPos(m_off_t acquiredpos)
     return ChunkedHash::chunkfloor(acquiredpos);  // we can only mac to the chunk boundary, hold the rest over
 }
 
+unsigned RaidBufferManager::FilePiece::finalizeParts(unsigned workers)
+{
+    size_t parts = buf.datalen() / FINALIZE_PART_SIZE;
+    parts = std::max<size_t>(1, std::min<size_t>(parts, workers));
+    pendingParts = static_cast<unsigned>(parts);
+    return static_cast<unsigned>(parts);
+}
+
 // decrypt, mac downloaded chunk
-bool RaidBufferManager::FilePiece::finalize(bool parallel, m_off_t filesize, int64_t ctriv, SymmCipher *cipher, chunkmac_map* source_chunkmacs)
+bool RaidBufferManager::FilePiece::finalize(bool parallel, m_off_t filesize, int64_t ctriv, SymmCipher *cipher, chunkmac_map* source_chunkmacs, unsigned part, unsigned parts)
 {
     assert(!finalized);
+    assert(parallel || parts == 1);
     bool queueParallel = false;
+    unsigned wholeChunks = 0;
 
     byte *chunkstart = buf.datastart();
     m_off_t startpos = pos;
@@ -713,13 +804,18 @@ bool RaidBufferManager::FilePiece::finalize(bool parallel, m_off_t filesize, int
     while (chunksize)
     {
         m_off_t chunkid = ChunkedHash::chunkfloor(startpos);
-        if (!chunkmacs.finishedAt(chunkid))
+        bool wholeChunk = endpos == ChunkedHash::chunkceil(chunkid, filesize);
+
+        // other parts may be working on the rest of the whole chunks, don't even look at their entries
+        bool ours = !wholeChunk || wholeChunks++ % parts == part;
+
+        if (ours && !chunkmacs.finishedAt(chunkid))
         {
             if (source_chunkmacs)
             {
                 source_chunkmacs->copyEntryTo(chunkid, chunkmacs);
             }
-            if (endpos == ChunkedHash::chunkceil(chunkid, filesize))
+            if (wholeChunk)
             {
                 if (parallel)
                 {
@@ -746,6 +842,11 @@ bool RaidBufferManager::FilePiece::finalize(bool parallel, m_off_t filesize, int
         chunksize = static_cast<unsigned>(endpos - startpos);
     }
 
+    if (parts > 1 && --pendingParts)
+    {
+        return false;
+    }
+
     finalized = !queueParallel;
     if (finalized)
         finalizedCV.notify_one();
@@ -885,6 +986,17 @@ void TransferBufferManager::setIsRaid(Transfer* t, const std::vector<std::string
 {
     transfer = t;
     RaidBufferManager::setIsRaid(tempUrls, resumepos, t->size, t->size, maxRequestSize, isNewRaid && t->type == GET);
+    setRaidLookahead(t->client->raidLookaheadBytes());
+
+    if (isRaid() && getUnusedRaidConnection() == RAIDPARTS)
+    {
+        // no recent failures, but a server may be known to be degraded by the other transfers
+        unsigned degraded = g_faultyServers.selectWorstServer(tempUrls, t->client->httpio);
+        if (degraded < RAIDPARTS)
+        {
+            setUnusedRaidConnection(degraded);
+        }
+    }
 }
 
 m_off_t& TransferBufferManager::transferPos(unsigned connectionNum)
@@ -924,9 +1036,26 @@ std::pair<m_off_t, m_off_t> TransferBufferManager::nextNPosForConnection(unsigne
                 maxsize /= 2;
             if (npos + maxsize > transfer->size)
                 maxsize /= 2;
-            m_off_t speedsize = std::min<m_off_t>(maxsize, uploadSpeed * 2 / 3);        // two seconds of data over 3 connections
+            // two seconds of data per connection, from this slot's own throughput once there is one
+            // (the client's upload speed is shared by all the uploads in progress)
+            m_off_t slotSpeed = transfer->slot ? transfer->slot->mTransferSpeed.getCircularMeanSpeed() : 0;
+            m_off_t speedsize = slotSpeed > 0 ? slotSpeed * 2 / std::max<m_off_t>(connectionCount, 1)
+                                              : uploadSpeed * 2 / 3;        // two seconds of data over 3 connections
+            speedsize = std::min<m_off_t>(maxsize, speedsize);
             m_off_t sizesize = transfer->size > largeSize ? 8 * 1024 * 1024 : 0; // start with large-ish portions for large files.
             m_off_t targetsize = std::max<m_off_t>(sizesize, speedsize);
+
+            if (transfer->slot)
+            {
+                // a failed request loses all of its data: on lossy paths, halve the size for each
+                // tenth of the requests that failed (down to single chunks)
+                double failedRatio = transfer->slot->tsStats.failedRequestRatio();
+                for (double step = 0.1; step <= failedRatio && targetsize; step += 0.1)
+                {
+                    targetsize /= 2;
+                }
+                transfer->slot->tsStats.mUploadRequestSize = targetsize;
+            }
             maxReqSize = targetsize;
         }
         else if (transfer->type == GET)
@@ -1209,7 +1338,7 @@ public:
         mStarted = true;
         if (mUnusedRaidConnection == RAIDPARTS)
         {
-            mUnusedRaidConnection = static_cast<uint8_t>(g_faultyServers.selectWorstServer(mTSlot->transferbuf.tempUrlVector()));
+            mUnusedRaidConnection = static_cast<uint8_t>(g_faultyServers.selectWorstServer(mTSlot->transferbuf.tempUrlVector(), mClient->httpio));
         }
         LOG_debug << "[CloudRaid::start] CloudRAID started. Initial unused raid connection: " << (int)mUnusedRaidConnection;
         return true;
@@ -1,12 +1,19 @@
 #include <algorithm>
 #include <map>
-#include <bitset>
 #include <cstdint>
 #include <climits>
 
 #include "mega/raidproxy.h"
 #include "mega.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MEGA_RAID_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define MEGA_RAID_NEON
+#endif
+
 using namespace ::mega::RaidProxy;
 
 #define MAX_DELAY_IN_SECONDS 30
@@ -19,6 +26,50 @@ using namespace ::mega::RaidProxy;
 #define SECTORSPERPART(NL) (NL * RAIDSECTOR)
 
 
+void mega::RaidProxy::recoverLines(byte* lines, const byte* parity, m_off_t count, unsigned missing)
+{
+    assert(missing < EFFECTIVE_RAIDPARTS);
+
+    // The sectors of a line sit RAIDSECTOR bytes apart and the lines RAIDLINE apart, so a
+    // sector is the widest contiguous load: wider registers would need a shuffle per line.
+    unsigned others[EFFECTIVE_RAIDPARTS - 1];
+    for (unsigned j = 0, k = 0; j < EFFECTIVE_RAIDPARTS; ++j)
+    {
+        if (j != missing)
+        {
+            others[k++] = j * RAIDSECTOR;
+        }
+    }
+    byte* target = lines + missing * RAIDSECTOR;
+
+    for (; count > 0; --count, lines += RAIDLINE, target += RAIDLINE, parity += RAIDSECTOR)
+    {
+#if defined(MEGA_RAID_SSE2)
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(parity));
+        x = _mm_xor_si128(x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(lines + others[0])));
+        x = _mm_xor_si128(x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(lines + others[1])));
+        x = _mm_xor_si128(x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(lines + others[2])));
+        x = _mm_xor_si128(x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(lines + others[3])));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target), x);
+#elif defined(MEGA_RAID_NEON)
+        uint8x16_t x = vld1q_u8(parity);
+        x = veorq_u8(x, vld1q_u8(lines + others[0]));
+        x = veorq_u8(x, vld1q_u8(lines + others[1]));
+        x = veorq_u8(x, vld1q_u8(lines + others[2]));
+        x = veorq_u8(x, vld1q_u8(lines + others[3]));
+        vst1q_u8(target, x);
+#else
+        // this method requires source and target are both aligned to their size
+        raidsector_t& t = *reinterpret_cast<raidsector_t*>(target);
+        t = *reinterpret_cast<const raidsector_t*>(parity);
+        t ^= *reinterpret_cast<const raidsector_t*>(lines + others[0]);
+        t ^= *reinterpret_cast<const raidsector_t*>(lines + others[1]);
+        t ^= *reinterpret_cast<const raidsector_t*>(lines + others[2]);
+        t ^= *reinterpret_cast<const raidsector_t*>(lines + others[3]);
+#endif
+    }
+}
+
 /* -------------- PartFetcher --------------*/
 
 PartFetcher::PartFetcher()
@@ -1058,60 +1109,60 @@ void RaidReq::procdata(uint8_t part, byte* ptr, m_off_t pos, m_off_t len)
 
     // merge new consecutive completed RAID lines so they are ready to be sent, direct from the data[] array
     auto old_completed = mCompleted;
-    for (; mCompleted < until; mCompleted++)
+    while (mCompleted < until)
     {
-        unsigned char mask = mInvalid[mCompleted];
-        std::bitset<CHAR_BIT * sizeof(unsigned char)> bits(mask);
-        auto bitsSet = bits.count();
+        unsigned char mask = static_cast<unsigned char>(mInvalid[mCompleted]);
 
-        assert(bitsSet);
-        if (bitsSet > 1)
+        assert(mask);
+        if (mask & (mask - 1))
         {
+            // more than one sector of this line still missing
             break;
         }
-        else
+
+        // the run of lines that miss the same sector, usually all of them as one part is left out
+        m_off_t end = mCompleted + 1;
+        while (end < until && static_cast<unsigned char>(mInvalid[end]) == mask)
         {
-            if (!(mask & 1))
-            {
-                // parity involved in this line
+            ++end;
+        }
 
-                int index = -1;
+        if (mask > 1)
+        {
+            // parity involved in these lines
+            int index = -1;
 #ifdef _MSC_VER
-                unsigned long bitIndex;
-                if (_BitScanForward(&bitIndex, mask))
-                {
-                    index = static_cast<int>(bitIndex);
-                }
+            unsigned long bitIndex;
+            if (_BitScanForward(&bitIndex, mask))
+            {
+                index = static_cast<int>(bitIndex);
+            }
 #else
-                // __GNUC__ is defined for both GCC and Clang
+            // __GNUC__ is defined for both GCC and Clang
 #if defined(__GNUC__)
-                index = __builtin_ctz(mask); // counts least significant consecutive 0 bits (ie 0-based index of least significant 1 bit).  Windows equivalent is _bitScanForward
+            index = __builtin_ctz(mask); // counts least significant consecutive 0 bits (ie 0-based index of least significant 1 bit).  Windows equivalent is _bitScanForward
 #else
-                // Fallback to a loop for other compilers
-                for (uint8_t i = 0; i < RAIDLINE; ++i)
+            // Fallback to a loop for other compilers
+            for (uint8_t i = 0; i < RAIDPARTS; ++i)
+            {
+                if (mask & (1 << i))
                 {
-                    if (mask & (1 << i))
-                    {
-                        index = i;
-                        break;
-                    }
+                    index = i;
+                    break;
                 }
+            }
 #endif
 #endif
-                if (index != -1) // index > 0 && index < RAIDLINE
-                {
-                    auto sectors = reinterpret_cast<raidsector_t*>(mData.get() + (RAIDLINE * mCompleted));
-                    raidsector_t& target = sectors[index - 1];
-
-                    target = reinterpret_cast<raidsector_t*>(mParity.get())[mCompleted];
-                    if (!(mask & (1 << 1))) target ^= sectors[0]; // this method requires source and target are both aligned to their size
-                    if (!(mask & (1 << 2))) target ^= sectors[1];
-                    if (!(mask & (1 << 3))) target ^= sectors[2];
-                    if (!(mask & (1 << 4))) target ^= sectors[3];
-                    if (!(mask & (1 << 5))) target ^= sectors[4];
-                }
+            if (index > 0) // index < RAIDPARTS
+            {
+                recoverLines(mData.get() + RAIDLINE * mCompleted,
+                             mParity.get() + RAIDSECTOR * mCompleted,
+                             end - mCompleted,
+                             static_cast<unsigned>(index - 1));
             }
         }
+
+        mCompleted = end;
     }
 
     if (mCompleted > old_completed)
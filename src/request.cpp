@@ -31,6 +31,11 @@ bool Request::isFetchNodes() const
     return cmds.size() == 1 && dynamic_cast<CommandFetchNodes*>(cmds.back().get());
 }
 
+bool Request::isStreaming() const
+{
+    return cmds.size() == 1 && !cmds.back()->mFilters.empty();
+}
+
 void Request::add(Command* c)
 {
     // Once this becomes the in-progress request, it must not have anything added
@@ -49,7 +54,18 @@ string Request::get(MegaClient* client, char reqidCounter[10], string& idempoten
     if (cachedJSON.empty())
     {
         // concatenate all command objects, resulting in an API request
+        // sized at once, instead of growing while appending thousands of commands
+        std::vector<std::string_view> cmdJSONs;
+        cmdJSONs.reserve(cmds.size());
+        size_t length = 2;
+        for (auto& cmd : cmds)
+        {
+            cmdJSONs.emplace_back(cmd->getJSON(client));
+            length += cmdJSONs.back().size() + 3;
+        }
+
         string& req = cachedJSON;
+        req.reserve(length);
         req = "[";
 
         map<string, int> counts;
@@ -57,7 +73,7 @@ string Request::get(MegaClient* client, char reqidCounter[10], string& idempoten
         for (int i = 0; i < (int)cmds.size(); i++)
         {
             req.append(i ? ",{" : "{");
-            req.append(cmds[static_cast<size_t>(i)]->getJSON(client));
+            req.append(cmdJSONs[static_cast<size_t>(i)]);
             req.append("}");
             ++counts[cmds[static_cast<size_t>(i)]->commandStr];
         }
@@ -165,8 +181,7 @@ m_off_t Request::processChunk(const char* chunk, MegaClient *client)
         return 0;
     }
 
-    // Only fetchnodes command is currently supported
-    assert(isFetchNodes());
+    assert(isStreaming());
 
     m_off_t consumed = 0;
     Command& cmd = *cmds[0];
@@ -188,7 +203,10 @@ m_off_t Request::processChunk(const char* chunk, MegaClient *client)
         assert(mJsonSplitter.isStarting());
     }
 
-    consumed += mJsonSplitter.processChunk(&cmd.mFilters, json.pos);
+    {
+        EventLoopMonitor::Task loopTask(client->mLoopMonitor, "command", cmd.commandStr.c_str());
+        consumed += mJsonSplitter.processChunk(&cmd.mFilters, json.pos);
+    }
     if (mJsonSplitter.hasFailed())
     {
         // stop the processing
@@ -238,6 +256,8 @@ void Request::process(MegaClient* client)
 
         cmd->client = client;
 
+        EventLoopMonitor::Task loopTask(client->mLoopMonitor, "command", cmd->commandStr.c_str());
+
         auto cmdJSON = processingJson;
         bool parsedOk = true;
 
@@ -383,12 +403,44 @@ void Request::swap(Request& r)
     assert(processindex == 0 && r.processindex == 0);
 }
 
+void CommandBatchSizer::completed(size_t commands, std::chrono::milliseconds elapsed)
+{
+    // exponential moving averages, so the limit follows changes of network or load
+    constexpr double WEIGHT = 0.25;
+
+    double elapsedMs = static_cast<double>(elapsed.count());
+    if (commands <= SMALL_BATCH)
+    {
+        mRoundTripMs += WEIGHT * (elapsedMs - mRoundTripMs);
+    }
+    else
+    {
+        double perCommandMs = std::max(0.0, elapsedMs - mRoundTripMs) / static_cast<double>(commands);
+        mPerCommandMs += WEIGHT * (perCommandMs - mPerCommandMs);
+    }
+
+    size_t limit = MAX_COMMANDS;
+    double budgetMs = static_cast<double>(TARGET_BATCH_TIME.count()) - mRoundTripMs;
+    if (mPerCommandMs > 0 && budgetMs < mPerCommandMs * MAX_COMMANDS)
+    {
+        limit = std::max(MIN_COMMANDS, static_cast<size_t>(std::max(0.0, budgetMs) / mPerCommandMs));
+    }
+
+    if (limit != mLimit)
+    {
+        LOG_verbose << "cs batch limit: " << limit << " commands (round trip: " << mRoundTripMs
+                    << " ms, per command: " << mPerCommandMs << " ms)";
+        mLimit = limit;
+    }
+}
+
 RequestDispatcher::RequestDispatcher(PrnGen& rng)
 {
     // initialize random API request sequence ID (server API is idempotent)
     resetId(reqid, sizeof reqid, rng);
 
     nextreqs.push_back(Request());
+    nextBulkReqs.push_back(Request());
 }
 
 #if defined(MEGA_MEASURE_CODE) || defined(DEBUG)
@@ -414,31 +466,42 @@ void RequestDispatcher::add(Command *c)
     }
 #endif
 
-    if (nextreqs.back().size() >= MAX_COMMANDS)
+    if (c->mIndependent && mSecondaryChannel)
     {
-        LOG_debug << "Starting an additional Request due to MAX_COMMANDS";
-        nextreqs.push_back(Request());
+        mSecondaryReqs->add(c);
+        return;
+    }
+
+    add(c->mBulk ? nextBulkReqs : nextreqs, c);
+}
+
+void RequestDispatcher::add(deque<Request>& queue, Command* c)
+{
+    if (queue.back().size() >= mBatchSizer.limit())
+    {
+        LOG_debug << "Starting an additional Request due to the batch limit";
+        queue.push_back(Request());
     }
-    if (c->batchSeparately && !nextreqs.back().empty())
+    if (c->batchSeparately && !queue.back().empty())
     {
         LOG_debug << "Starting an additional Request for a batch-separately command";
-        nextreqs.push_back(Request());
+        queue.push_back(Request());
     }
 
-    if (!nextreqs.back().empty() && nextreqs.back().mV3 != c->mV3)
+    if (!queue.back().empty() && queue.back().mV3 != c->mV3)
     {
         LOG_debug << "Starting an additional Request for v3 transition " << c->mV3;
-        nextreqs.push_back(Request());
+        queue.push_back(Request());
     }
-    if (nextreqs.back().empty())
+    if (queue.back().empty())
     {
-        nextreqs.back().mV3 = c->mV3;
+        queue.back().mV3 = c->mV3;
     }
 
-    nextreqs.back().add(c);
+    queue.back().add(c);
     if (c->batchSeparately)
     {
-        nextreqs.push_back(Request());
+        queue.push_back(Request());
     }
 }
 
@@ -451,8 +514,7 @@ bool RequestDispatcher::readyToSend() const
     }
     else
     {
-        return nextreqs.empty() ? false :
-              !nextreqs.front().empty();
+        return !nextreqs.front().empty() || !nextBulkReqs.front().empty();
     }
 }
 
@@ -478,13 +540,15 @@ string RequestDispatcher::serverrequest(bool &includesFetchingNodes, bool& v3, M
     else
     {
         assert(inflightreq.empty());
-        inflightreq.swap(nextreqs.front());
-        nextreqs.pop_front();
-        if (nextreqs.empty())
+        deque<Request>& queue = nextreqs.front().empty() ? nextBulkReqs : nextreqs;
+        inflightreq.swap(queue.front());
+        queue.pop_front();
+        if (queue.empty())
         {
-            nextreqs.push_back(Request());
+            queue.push_back(Request());
         }
     }
+    inflightSent = std::chrono::steady_clock::now();
     string requestJSON = inflightreq.get(client, reqid, idempotenceId);
     includesFetchingNodes = inflightreq.isFetchNodes();
     v3 = inflightreq.mV3;
@@ -513,14 +577,19 @@ void RequestDispatcher::inflightFailure(retryreason_t reason)
 void RequestDispatcher::serverresponse(std::string&& movestring, MegaClient *client)
 {
     CodeCounter::ScopeTimer ccst(client->performanceStats.csResponseProcessingTime);
+    MEGA_TRACE_SCOPE("client", "serverresponse");
+    EventLoopMonitor::Scope loopScope(client->mLoopMonitor, EventLoopMonitor::PHASE_CS_RESPONSE);
 
 #ifdef MEGA_MEASURE_CODE
     csBatchesReceived += 1;
     csRequestsCompleted += inflightreq.size();
 #endif
     processing = true;
+    size_t commands = inflightreq.size();
     inflightreq.serverresponse(std::move(movestring), client);
     inflightreq.process(client);
+    mBatchSizer.completed(commands, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                        std::chrono::steady_clock::now() - inflightSent));
     processing = false;
     if (clearWhenSafe)
     {
@@ -545,6 +614,11 @@ size_t RequestDispatcher::chunkedProgress()
     return static_cast<size_t>(inflightreq.totalChunkedProgress());
 }
 
+bool RequestDispatcher::inflightStreaming() const
+{
+    return inflightreq.isStreaming();
+}
+
 void RequestDispatcher::servererror(const std::string& e, MegaClient *client)
 {
     // notify all the commands in the batch of the failure
@@ -573,8 +647,22 @@ void RequestDispatcher::continueProcessing(MegaClient* client)
     }
 }
 
+void RequestDispatcher::setSecondaryChannel(bool enable, PrnGen& rng)
+{
+    if (enable && !mSecondaryReqs)
+    {
+        mSecondaryReqs.reset(new RequestDispatcher(rng));
+    }
+    mSecondaryChannel = enable;
+}
+
 void RequestDispatcher::clear()
 {
+    if (mSecondaryReqs)
+    {
+        mSecondaryReqs->clear();
+    }
+
     if (processing)
     {
         // we are being called from a command that is in progress (eg. logout) - delay wiping the data structure until that call ends.
@@ -591,6 +679,12 @@ void RequestDispatcher::clear()
         }
         nextreqs.clear();
         nextreqs.push_back(Request());
+        for (auto& r : nextBulkReqs)
+        {
+            r.clear();
+        }
+        nextBulkReqs.clear();
+        nextBulkReqs.push_back(Request());
         processing = false;
         clearWhenSafe = false;
     }
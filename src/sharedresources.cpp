@@ -0,0 +1,208 @@
+/**
+ * @file sharedresources.cpp
+ * @brief Worker threads and caches shared by the clients of a process
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/sharedresources.h"
+#include "mega/logging.h"
+
+#include <algorithm>
+
+namespace mega {
+
+SharedWorkerPool::Lane::Lane(std::shared_ptr<SharedWorkerPool> pool, unsigned maxRunning)
+    : mPool(std::move(pool))
+    , mMaxRunning(std::max(1u, maxRunning))
+{
+    std::lock_guard<std::mutex> g(mPool->mMutex);
+    mPool->mLanes.push_back(this);
+}
+
+SharedWorkerPool::Lane::~Lane()
+{
+    std::unique_lock<std::mutex> g(mPool->mMutex);
+    mPool->mJobDone.wait(g, [this]() { return mJobs.empty() && !mRunning; });
+
+    auto& lanes = mPool->mLanes;
+    auto it = std::find(lanes.begin(), lanes.end(), this);
+    assert(it != lanes.end());
+
+    // keep the turn with the lane that was next
+    if (static_cast<size_t>(it - lanes.begin()) < mPool->mNextLane)
+    {
+        --mPool->mNextLane;
+    }
+    lanes.erase(it);
+}
+
+void SharedWorkerPool::Lane::push(std::function<void()> job, bool discardable, bool urgent)
+{
+    {
+        std::lock_guard<std::mutex> g(mPool->mMutex);
+        if (urgent)
+        {
+            mJobs.push_front(Job{std::move(job), discardable});
+        }
+        else
+        {
+            mJobs.push_back(Job{std::move(job), discardable});
+        }
+    }
+    mPool->mWorkAvailable.notify_one();
+}
+
+void SharedWorkerPool::Lane::clear(bool discardableOnly)
+{
+    {
+        std::lock_guard<std::mutex> g(mPool->mMutex);
+        mJobs.erase(std::remove_if(mJobs.begin(), mJobs.end(), [discardableOnly](const Job& job)
+                                   {
+                                       return job.discardable || !discardableOnly;
+                                   }),
+                    mJobs.end());
+    }
+
+    // a lane being destroyed may be waiting for its queue to empty
+    mPool->mJobDone.notify_all();
+}
+
+unsigned SharedWorkerPool::Lane::threadCount() const
+{
+    return std::min(mMaxRunning, mPool->threadCount());
+}
+
+SharedWorkerPool::SharedWorkerPool(unsigned threadCount)
+{
+    for (unsigned i = std::max(1u, threadCount); i--; )
+    {
+        try
+        {
+            mThreads.emplace_back([this]() { loop(); });
+        }
+        catch (std::system_error& e)
+        {
+            LOG_err << "Failed to start shared worker thread: " << e.what();
+            break;
+        }
+    }
+    LOG_debug << "Shared worker threads running: " << mThreads.size();
+}
+
+SharedWorkerPool::~SharedWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        assert(mLanes.empty());
+        mExiting = true;
+    }
+    mWorkAvailable.notify_all();
+
+    for (auto& t : mThreads)
+    {
+        t.join();
+    }
+}
+
+SharedWorkerPool::Lane* SharedWorkerPool::nextLane()
+{
+    for (size_t i = 0; i < mLanes.size(); ++i)
+    {
+        size_t index = (mNextLane + i) % mLanes.size();
+        Lane* lane = mLanes[index];
+        if (!lane->mJobs.empty() && lane->mRunning < lane->mMaxRunning)
+        {
+            mNextLane = (index + 1) % mLanes.size();
+            return lane;
+        }
+    }
+    return nullptr;
+}
+
+void SharedWorkerPool::loop()
+{
+    std::unique_lock<std::mutex> g(mMutex);
+    for (;;)
+    {
+        Lane* lane = nullptr;
+        mWorkAvailable.wait(g, [&]() { return mExiting || (lane = nextLane()); });
+        if (mExiting)
+        {
+            return;
+        }
+
+        std::function<void()> f = std::move(lane->mJobs.front().f);
+        lane->mJobs.pop_front();
+        ++lane->mRunning;
+
+        g.unlock();
+        if (f)
+        {
+            f();
+        }
+        g.lock();
+
+        // the lane can't go away while its job runs, and may take another one now
+        --lane->mRunning;
+        mJobDone.notify_all();
+        if (!lane->mJobs.empty())
+        {
+            mWorkAvailable.notify_one();
+        }
+    }
+}
+
+std::atomic<bool> SharedResources::sEnabled{false};
+std::mutex SharedResources::sMutex;
+std::weak_ptr<SharedWorkerPool> SharedResources::sCryptoPool;
+std::weak_ptr<SharedWorkerPool> SharedResources::sGfxPool;
+
+void SharedResources::setEnabled(bool enabled)
+{
+    sEnabled = enabled;
+    LOG_info << "Shared resources for new clients " << (enabled ? "enabled" : "disabled");
+}
+
+bool SharedResources::enabled()
+{
+    return sEnabled;
+}
+
+std::shared_ptr<SharedWorkerPool> SharedResources::pool(std::weak_ptr<SharedWorkerPool>& pool, unsigned threadCount)
+{
+    std::lock_guard<std::mutex> g(sMutex);
+    auto p = pool.lock();
+    if (!p)
+    {
+        p = std::make_shared<SharedWorkerPool>(threadCount);
+        pool = p;
+    }
+    return p;
+}
+
+std::shared_ptr<SharedWorkerPool> SharedResources::cryptoPool()
+{
+    return pool(sCryptoPool, std::max(2u, std::thread::hardware_concurrency()));
+}
+
+std::shared_ptr<SharedWorkerPool> SharedResources::gfxPool(unsigned threadCount)
+{
+    return pool(sGfxPool, threadCount);
+}
+
+} // namespace
@@ -100,6 +100,74 @@ void ShareNodeKeys::add(const string& nodekey, handle nodehandle, std::shared_pt
     }
 }
 
+void ShareNodeKeys::add(const sharedNode_vector& nodes, std::shared_ptr<Node> sn, bool includeParentChain, MegaClientAsyncQueue& queue)
+{
+    // the shares walked by add() are the same for every node, as they start from sn
+    sharedNode_vector keyedShares;
+    vector<int> shareIndexes;
+    for (auto s = sn; s; s = includeParentChain ? s->parent : nullptr)
+    {
+        if (s->sharekey)
+        {
+            keyedShares.push_back(s);
+            shareIndexes.push_back(addshare(s));
+        }
+    }
+
+    if (keyedShares.empty())
+    {
+        return;
+    }
+
+    vector<const Node*> keyedNodes;
+    keyedNodes.reserve(nodes.size());
+    for (auto& n : nodes)
+    {
+        if (n->attrstring)  // invalid nodekey or undecryptable attributes
+        {
+            LOG_err << "Skip CR request for node: " << toNodeHandle(n->nodehandle) << " (invalid node key)";
+            continue;
+        }
+        keyedNodes.push_back(n.get());
+    }
+
+    // every node gets an item, so their indexes are known upfront
+    size_t firstItem = items.size();
+    vector<string> nodeKeys(keyedNodes.size());
+
+    queue.runInBatches(keyedNodes.size(), ENCRYPTION_BATCH_SIZE, [&](size_t begin, size_t end, SymmCipher& cipher)
+    {
+        char buf[96];
+        byte key[FILENODEKEYLENGTH];
+
+        for (size_t s = 0; s < keyedShares.size(); ++s)
+        {
+            cipher.setkey(keyedShares[s]->sharekey->key);
+
+            for (size_t i = begin; i < end; ++i)
+            {
+                const string& nodekey = keyedNodes[i]->nodekey();
+
+                snprintf(buf, sizeof(buf), ",%d,%d,\"", shareIndexes[s], static_cast<int>(firstItem + i));
+                cipher.ecb_encrypt((byte*)nodekey.data(), key, nodekey.size());
+
+                char* ptr = strchr(buf + 5, 0);
+                ptr += Base64::btoa(key, int(nodekey.size()), ptr);
+                *ptr++ = '"';
+
+                nodeKeys[i].append(buf, static_cast<size_t>(ptr - buf));
+            }
+        }
+    });
+
+    items.reserve(firstItem + keyedNodes.size());
+    for (size_t i = 0; i < keyedNodes.size(); ++i)
+    {
+        keys.append(nodeKeys[i]);
+        items.emplace_back((const char*)&keyedNodes[i]->nodehandle, MegaClient::NODEHANDLE);
+    }
+}
+
 void ShareNodeKeys::get(Command* c, bool skiphandles)
 {
     if (keys.size())
@@ -34,6 +34,10 @@
 #include "mega/sync.h"
 #include "mega/transfer.h"
 
+// the sync engine logs a lot per node: it may be built with less of it
+#undef MEGA_LOG_UNIT_MAX_LEVEL
+#define MEGA_LOG_UNIT_MAX_LEVEL MEGA_SYNC_LOG_MAX_LEVEL
+
 namespace mega {
 
 const int Sync::SCANNING_DELAY_DS = 5;
@@ -45,14 +49,87 @@ const dstime Sync::RECENT_VERSION_INTERVAL_SECS = 10800;
 const unsigned Sync::MAX_CLOUD_DEPTH = 64;
 
 const std::chrono::milliseconds Syncs::MIN_DELAY_BETWEEN_SYNC_STALLS_OR_CONFLICTS_COUNT{100}; // 100 ms
-const std::chrono::milliseconds Syncs::MAX_DELAY_BETWEEN_SYNC_STALLS_OR_CONFLICTS_COUNT{10000}; // 10 secs
 const std::chrono::milliseconds Syncs::MIN_DELAY_BETWEEN_SYNC_VERBOSE_TIMED{20000}; // 20 secs
 const std::chrono::milliseconds Syncs::TIME_WINDOW_FOR_SYNC_VERBOSE_TIMED{1000}; // 1 sec
+const std::chrono::milliseconds Sync::STATECACHE_WRITE_BUDGET{250};
 
 #define SYNC_verbose if (syncs.mDetailedSyncLogging) LOG_verbose
 #define SYNC_verbose_timed if (syncs.mDetailedSyncLogging) SYNCS_verbose_timed
 #define SYNCS_verbose_timed LOG_verbose_timed(Syncs::MIN_DELAY_BETWEEN_SYNC_VERBOSE_TIMED, Syncs::TIME_WINDOW_FOR_SYNC_VERBOSE_TIMED)
 
+constexpr std::array<unsigned, 5> SyncTelemetry::Timing::BUCKET_LIMITS_MS;
+
+void SyncTelemetry::Timing::add(std::chrono::steady_clock::duration elapsed)
+{
+    auto us = uint64_t(std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(), 0));
+
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalUs.fetch_add(us, std::memory_order_relaxed);
+
+    // only the sync thread writes, so there's no race between the load and the store
+    if (us > maxUs.load(std::memory_order_relaxed))
+    {
+        maxUs.store(us, std::memory_order_relaxed);
+    }
+
+    size_t bucket = 0;
+    while (bucket < BUCKET_LIMITS_MS.size() && us >= uint64_t(BUCKET_LIMITS_MS[bucket]) * 1000)
+    {
+        ++bucket;
+    }
+    histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void SyncTelemetry::Timing::toJson(JSONWriter& writer, const char* name, bool withHistogram) const
+{
+    writer.beginobject(name);
+    writer.arg("count", m_off_t(count.load(std::memory_order_relaxed)));
+    writer.arg("totalUs", m_off_t(totalUs.load(std::memory_order_relaxed)));
+    writer.arg("maxUs", m_off_t(maxUs.load(std::memory_order_relaxed)));
+
+    if (withHistogram)
+    {
+        writer.beginarray("limitsMs");
+        for (auto limit : BUCKET_LIMITS_MS)
+        {
+            writer.element(int(limit));
+        }
+        writer.endarray();
+
+        writer.beginarray("histogram");
+        for (auto& n : histogram)
+        {
+            writer.addcomma();
+            writer.appendraw(std::to_string(n.load(std::memory_order_relaxed)).c_str());
+        }
+        writer.endarray();
+    }
+
+    writer.endobject();
+}
+
+// Adds the time until it goes out of scope to a telemetry timing.
+class SyncTelemetryTimer
+{
+public:
+    explicit SyncTelemetryTimer(SyncTelemetry::Timing& timing)
+      : mTiming(timing)
+      , mStarted(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~SyncTelemetryTimer()
+    {
+        mTiming.add(std::chrono::steady_clock::now() - mStarted);
+    }
+
+    MEGA_DISABLE_COPY_MOVE(SyncTelemetryTimer)
+
+private:
+    SyncTelemetry::Timing& mTiming;
+    std::chrono::steady_clock::time_point mStarted;
+};
+
 bool PerSyncStats::operator==(const PerSyncStats& other)
 {
     return  scanning == other.scanning &&
@@ -60,7 +137,9 @@ bool PerSyncStats::operator==(const PerSyncStats& other)
             numFiles == other.numFiles &&
             numFolders == other.numFolders &&
             numUploads == other.numUploads &&
-            numDownloads == other.numDownloads;
+            numDownloads == other.numDownloads &&
+            numFingerprintsComputed == other.numFingerprintsComputed &&
+            numFingerprintsReused == other.numFingerprintsReused;
 }
 
 bool PerSyncStats::operator!=(const PerSyncStats& other)
@@ -703,6 +782,10 @@ Sync::Sync(UnifiedSync& us, const string& cdebris,
     // Make sure the engine knows about this fingerprint.
     syncs.mFingerprintTracker.add(fsfp);
 
+    // As many scans in flight as the filesystem has worker threads.
+    mActiveScanRequestsGeneral.resize(syncs.mScanService->workerThreads(fsfp, mLocalPath));
+    mFingerprintCache = syncs.mScanService->fingerprintCache(fsfp);
+
     LOG_debug << "Constructed Sync has filesystemId: "
               << us.mConfig.mFilesystemFingerprint.toString()
               << " and root folder id: "
@@ -737,9 +820,19 @@ Sync::~Sync()
     mDestructorRunning = true;
     mUnifiedSync.mConfig.mRunState = mUnifiedSync.mConfig.mDatabaseExists ? SyncRunState::Suspend : SyncRunState::Disable;
 
+    // the LocalNodes won't unreport themselves one by one now
+    syncs.mTreestateIndex.eraseBelow(mLocalPath);
+
     // unlock tmp lock
     tmpfa.reset();
 
+    // write whatever the sync loop's budget left queued
+    if (statecachetable)
+    {
+        DBTableTransactionCommitter committer(statecachetable);
+        cachenodes();
+    }
+
     // Deleting localnodes after this will not remove them from the db.
     statecachetable.reset();
 
@@ -771,9 +864,34 @@ bool Sync::openOrCreateDb(DBErrorCallback&& errorHandler)
                                      DB_OPEN_FLAG_RECYCLE | DB_OPEN_FLAG_TRANSACTED,
                                      std::move(errorHandler)));
 
+    // The disk is synced in the background, off the sync thread. A crash may lose the last
+    // commits, as if cachenodes() hadn't run yet: those nodes are rebuilt from the next scan
+    if (statecachetable)
+    {
+        statecachetable->setGroupCommit(MegaClient::DB_GROUP_COMMIT_DELAY, MegaClient::DB_GROUP_COMMIT_MAX_COMMITS);
+    }
+
     return dbExistsOnDisk || statecachetable != nullptr;
 };
 
+std::shared_ptr<ScanService::ScanRequest>* Sync::freeGeneralScanSlot()
+{
+    for (auto& slot : mActiveScanRequestsGeneral)
+    {
+        if (!slot || slot->completed())
+        {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+bool Sync::anyGeneralScanRequest() const
+{
+    return std::any_of(mActiveScanRequestsGeneral.begin(), mActiveScanRequestsGeneral.end(),
+                       [](const std::shared_ptr<ScanService::ScanRequest>& slot) { return !!slot; });
+}
+
 bool Sync::isBackup() const
 {
     assert(syncs.onSyncThread());
@@ -869,6 +987,12 @@ void Sync::addstatecachechildren(uint32_t parent_dbid, idlocalnode_map* tmap, Lo
         l->setSyncedNodeHandle(l->syncedCloudNodeHandle);
         l->oneTimeUseSyncedFingerprintInScan = true;
 
+        // Wherever the file is found now, it needn't be read if it's unchanged.
+        if (l->type == FILENODE && mFingerprintCache)
+        {
+            mFingerprintCache->add(fsid, l->syncedFingerprint);
+        }
+
         if (!l->slocalname_in_db)
         {
             statecacheadd(l);
@@ -932,6 +1056,7 @@ void Sync::readstatecache()
     cachenodes();
 
     LOG_debug << syncname << "Sync " << toHandle(getConfig().mBackupId) << " loaded from db with " << numLocalNodes << " sync nodes";
+    logLocalNodeMemoryUsage("loaded from db");
 
     localroot->setScanAgain(false, true, true, 0);
 }
@@ -988,7 +1113,7 @@ void Sync::statecacheadd(LocalNode* l)
     assert(l->parent);
 }
 
-void Sync::cachenodes()
+void Sync::cachenodes(bool all)
 {
     assert(syncs.onSyncThread());
 
@@ -1005,6 +1130,10 @@ void Sync::cachenodes()
 
         DBTableTransactionCommitter committer(statecachetable);
 
+        auto deadline = std::chrono::steady_clock::now() + STATECACHE_WRITE_BUDGET;
+        unsigned written = 0;
+        bool outOfTime = false;
+
         // additions - we iterate until completion or until we get stuck
         bool added;
 
@@ -1013,6 +1142,13 @@ void Sync::cachenodes()
 
             for (set<LocalNode*>::iterator it = insertq.begin(); it != insertq.end(); )
             {
+                // the clock is only read every so often, a node is written in microseconds
+                if (!all && !(++written % 256) && std::chrono::steady_clock::now() > deadline)
+                {
+                    outOfTime = true;
+                    break;
+                }
+
                 assert((*it)->type >= 0);
                 assert((*it)->sync == this);
                 assert((*it)->parent->parent || (*it)->parent == localroot.get());
@@ -1026,9 +1162,13 @@ void Sync::cachenodes()
                 }
                 else it++;
             }
-        } while (added);
+        } while (added && !outOfTime);
 
-        if (insertq.size())
+        if (outOfTime)
+        {
+            LOG_debug << syncname << "LocalNode database write budget spent, " << insertq.size() << " additions left for later";
+        }
+        else if (insertq.size())
         {
             LOG_err << "LocalNode caching did not complete";
             assert(false);
@@ -1178,7 +1318,7 @@ LocalNode* Sync::localnodebypath(LocalNode* l, const LocalPath& localpath, Local
 
         localnode_map::iterator it;
         if ((it = l->children.find(component)) == l->children.end()
-            && (it = l->schildren.find(component)) == l->schildren.end())
+            && (!l->schildren || (it = l->schildren->find(component)) == l->schildren->end()))
         {
             // no full match: store residual path, return NULL with the
             // matching component LocalNode in parent
@@ -2723,9 +2863,49 @@ bool Sync::checkScanningWasComplete()
 {
     mScanningWasCompletePreviously = mScanningWasComplete && !syncs.mSyncFlags->isInitialPass;
     mScanningWasComplete = !isSyncScanning();
+
+    if (mScanningWasComplete && !mLocalNodeMemoryLogged)
+    {
+        // once per run, the tree is at its full size by now
+        mLocalNodeMemoryLogged = true;
+        logLocalNodeMemoryUsage("first full scan");
+    }
+
     return mScanningWasComplete;
 }
 
+size_t Sync::localNodeMemoryUsage(size_t& numNodes) const
+{
+    size_t bytes = 0;
+    numNodes = 0;
+
+    vector<const LocalNode*> pending(1, localroot.get());
+    while (!pending.empty())
+    {
+        const LocalNode* node = pending.back();
+        pending.pop_back();
+
+        bytes += node->memoryUsage();
+        ++numNodes;
+
+        for (auto& child : node->children)
+        {
+            pending.push_back(child.second);
+        }
+    }
+
+    return bytes;
+}
+
+void Sync::logLocalNodeMemoryUsage(const char* when) const
+{
+    size_t numNodes = 0;
+    size_t bytes = localNodeMemoryUsage(numNodes);
+
+    LOG_info << syncname << "LocalNode memory (" << when << "): " << numNodes << " nodes, "
+             << bytes / 1024 << " KB, " << bytes / std::max<size_t>(numNodes, 1) << " bytes per node";
+}
+
 void Sync::unsetScanningWasComplete()
 {
     mScanningWasComplete = false;
@@ -2827,6 +3007,8 @@ bool Sync::processCompletedUploadFromHere(SyncRow& row,
         row.syncNode->setSyncedNodeHandle(upload->putnodesResultHandle);
         statecacheadd(row.syncNode);
 
+        mUnifiedSync.mTelemetry.upload.add(std::chrono::steady_clock::now() - upload->queuedAt);
+
         // void going into syncItem() in case we only just got the cloud Node
         // and we are iterating that very directory already, in which case we won't have
         // the cloud side node, and we would create an extra upload
@@ -3648,6 +3830,7 @@ dstime Sync::procscanq()
         }
 
         nearest->setScanAgain(false, true, scanDescendants, SCANNING_DELAY_DS);
+        nearest->scanInteractive = true;
 
         if (nearest->rareRO().scanBlocked)
         {
@@ -5347,6 +5530,48 @@ string Syncs::exportSyncConfigs(const SyncConfigVector configs) const
     return writer.getstring();
 }
 
+string Syncs::telemetryJson(bool withHistograms) const
+{
+    JSONWriter writer;
+    writer.beginobject();
+
+    writer.arg("syncThreadQueue", m_off_t(const_cast<ThreadSafeDeque<QueuedSyncFunc>&>(syncThreadActions).size()));
+    writer.arg("clientThreadQueue", m_off_t(const_cast<ThreadSafeDeque<QueuedClientFunc>&>(clientThreadActions).size()));
+
+    // the stalls as last reported by the sync thread
+    {
+        lock_guard<mutex> g(stallReportMutex);
+        writer.arg("stalls", m_off_t(stallReport.size()));
+
+        writer.beginarray("syncs");
+
+        lock_guard<std::recursive_mutex> guard(mSyncVecMutex);
+        for (auto& us : mSyncVec)
+        {
+            auto backupId = us->mConfig.mBackupId;
+            auto it = stallReport.syncStallInfoMaps.find(backupId);
+
+            writer.beginobject();
+            writer.arg("id", backupId, sizeof(handle));
+            writer.arg("running", m_off_t(!!us->mSync));
+            writer.arg("stalls", m_off_t(it != stallReport.syncStallInfoMaps.end() ? it->second.size() : 0));
+
+            auto& t = us->mTelemetry;
+            t.scan.toJson(writer, "scan", withHistograms);
+            t.triplets.toJson(writer, "triplets", withHistograms);
+            t.resolve.toJson(writer, "resolve", withHistograms);
+            t.upload.toJson(writer, "upload", withHistograms);
+            t.download.toJson(writer, "download", withHistograms);
+            writer.endobject();
+        }
+
+        writer.endarray();
+    }
+
+    writer.endobject();
+    return writer.getstring();
+}
+
 string Syncs::exportSyncConfigs() const
 {
     assert(!onSyncThread());
@@ -6321,6 +6546,48 @@ void Syncs::renameSync_inThread(handle backupId, const string& newname, std::fun
     completion(API_EEXIST);
 }
 
+void Syncs::setSyncBackgroundIO(handle backupId, bool backgroundIO, std::function<void(Error e)> completion)
+{
+    assert(!onSyncThread());
+    assert(completion);
+
+    auto clientCompletion = [this, completion](Error e)
+    {
+        queueClient(
+            [completion, e](MegaClient&, TransferDbCommitter&)
+            {
+                completion(e);
+            });
+    };
+    queueSync([this, backupId, backgroundIO, clientCompletion]()
+        {
+            setSyncBackgroundIO_inThread(backupId, backgroundIO, clientCompletion);
+        }, "setSyncBackgroundIO");
+}
+
+void Syncs::setSyncBackgroundIO_inThread(handle backupId, bool backgroundIO, std::function<void(Error e)> completion)
+{
+    assert(onSyncThread());
+
+    lock_guard<std::recursive_mutex> guard(mSyncVecMutex);
+
+    for (auto &i : mSyncVec)
+    {
+        if (i->mConfig.mBackupId == backupId)
+        {
+            i->mConfig.mBackgroundIO = backgroundIO;
+
+            // queue saving the change locally
+            if (mSyncConfigStore) mSyncConfigStore->markDriveDirty(i->mConfig.mExternalDrivePath);
+
+            completion(API_OK);
+            return;
+        }
+    }
+
+    completion(API_EEXIST);
+}
+
 void Syncs::disableSyncs(SyncError syncError, bool newEnabledFlag, bool keepSyncDb)
 {
     assert(!onSyncThread());
@@ -6967,17 +7234,98 @@ void Syncs::resumeSyncsOnStateCurrent_inThread()
     mClient.app->syncs_restored(NO_SYNC_ERROR);
 }
 
-void Sync::recursiveCollectNameConflicts(list<NameConflict>* conflicts, size_t* count, size_t* limit)
+void Sync::collectNameConflicts(list<NameConflict>* conflicts, size_t* count, size_t* limit) const
 {
     assert(syncs.onSyncThread());
 
     assert(conflicts || count);
-    FSNode rootFsNode(localroot->getLastSyncedFSDetails());
-    SyncRow row{ &cloudRoot, localroot.get(), &rootFsNode };
-    SyncPath pathBuffer(syncs, localroot->localname, cloudRootPath);
     size_t dummyCount = 0;
-    size_t dummyMax = std::numeric_limits<size_t>::max();
-    recursiveCollectNameConflicts(row, pathBuffer, conflicts, count ? *count : dummyCount, limit ? *limit : dummyMax);
+    size_t& n = count ? *count : dummyCount;
+    size_t max = limit ? *limit : std::numeric_limits<size_t>::max();
+
+    if (n >= max)
+    {
+        return;
+    }
+
+    // in path order, as a walk of the tree would list them
+    vector<std::pair<LocalPath, const list<NameConflict>*>> folders;
+    folders.reserve(mNameConflicts.size());
+    for (auto& entry : mNameConflicts)
+    {
+        folders.emplace_back(entry.first->getLocalPath(), &entry.second);
+    }
+    std::sort(folders.begin(), folders.end(), [](const std::pair<LocalPath, const list<NameConflict>*>& a,
+                                                 const std::pair<LocalPath, const list<NameConflict>*>& b)
+              { return a.first < b.first; });
+
+    for (auto& folder : folders)
+    {
+        if (localdebris.isContainingPathOf(folder.first))
+        {
+            continue;
+        }
+
+        for (auto& nc : *folder.second)
+        {
+            if (conflicts)
+            {
+                conflicts->push_back(nc);
+            }
+            if (++n >= max)
+            {
+                return;
+            }
+        }
+    }
+}
+
+void Sync::indexNameConflicts(const LocalNode& folder, const SyncPath& fullPath, const vector<SyncRow>& childRows)
+{
+    assert(syncs.onSyncThread());
+
+    list<NameConflict> ncs;
+
+    for (auto& childRow : childRows)
+    {
+        if (!childRow.hasClashes())
+        {
+            continue;
+        }
+
+        NameConflict nc;
+
+        if (childRow.hasCloudPresence())
+            nc.cloudPath = fullPath.cloudPath;
+
+        if (childRow.hasLocalPresence())
+            nc.localPath = fullPath.localPath;
+
+        // Only meaningful if there are no cloud clashes.
+        if (auto* c = childRow.cloudNode)
+            nc.clashingCloud.emplace_back(c->name, c->handle);
+
+        // Only meaningful if there are no local clashes.
+        if (auto* f = childRow.fsNode)
+            nc.clashingLocalNames.emplace_back(f->localname);
+
+        for (auto* c : childRow.cloudClashingNames)
+            nc.clashingCloud.emplace_back(c->name, c->handle);
+
+        for (auto* f : childRow.fsClashingNames)
+            nc.clashingLocalNames.emplace_back(f->localname);
+
+        ncs.emplace_back(std::move(nc));
+    }
+
+    if (ncs.empty())
+    {
+        mNameConflicts.erase(&folder);
+    }
+    else
+    {
+        mNameConflicts[&folder] = std::move(ncs);
+    }
 }
 
 void Sync::purgeStaleDownloads()
@@ -7046,6 +7394,8 @@ void SyncRow::inferOrCalculateChildSyncRows(bool wasSynced, vector<SyncRow>& chi
     // (Plus for those SyncNode folders where regeneration wouldn't match the FSNodes (yet))
     // (SyncNode = LocalNode, we'll rename LocalNode eventually)
 
+    SyncTelemetryTimer timer(syncNode->sync->mUnifiedSync.mTelemetry.triplets);
+
     if (wasSynced && !belowRemovedFsNode &&
         !syncNode->lastFolderScan && syncNode->syncAgain < TREE_ACTION_HERE &&   // if fully matching, we would have removed the fsNode vector to save space
         syncNode->sync->inferRegeneratableTriplets(cloudChildren, *syncNode, fsInferredChildren, childRows))
@@ -7088,90 +7438,6 @@ void SyncRow::inferOrCalculateChildSyncRows(bool wasSynced, vector<SyncRow>& chi
 }
 
 
-void Sync::recursiveCollectNameConflicts(SyncRow& row, SyncPath& fullPath, list<NameConflict>* ncs, size_t& count, size_t& limit)
-{
-    assert(syncs.onSyncThread());
-
-    assert(row.syncNode);
-    if (!row.syncNode->conflictsDetected())
-    {
-        return;
-    }
-
-    if (count >= limit)
-    {
-        return;
-    }
-
-    // Get sync triplets.
-    vector<SyncRow> childRows;
-    vector<FSNode> fsInferredChildren;
-    vector<FSNode> fsChildren;
-    vector<CloudNode> cloudChildren;
-
-    if (row.cloudNode)
-    {
-        syncs.lookupCloudChildren(row.cloudNode->handle, cloudChildren);
-    }
-
-    bool wasSynced = false;  // todo
-    row.inferOrCalculateChildSyncRows(wasSynced, childRows, fsInferredChildren, fsChildren, cloudChildren, false, syncs.localnodeByScannedFsid);
-
-
-    for (auto& childRow : childRows)
-    {
-        if (childRow.hasClashes())
-        {
-            if (ncs)
-            {
-                NameConflict nc;
-
-                if (childRow.hasCloudPresence())
-                    nc.cloudPath = fullPath.cloudPath;
-
-                if (childRow.hasLocalPresence())
-                    nc.localPath = fullPath.localPath;
-
-                // Only meaningful if there are no cloud clashes.
-                if (auto* c = childRow.cloudNode)
-                    nc.clashingCloud.emplace_back(c->name, c->handle);
-
-                // Only meaningful if there are no local clashes.
-                if (auto* f = childRow.fsNode)
-                    nc.clashingLocalNames.emplace_back(f->localname);
-
-                for (auto* c : childRow.cloudClashingNames)
-                    nc.clashingCloud.emplace_back(c->name, c->handle);
-
-                for (auto* f : childRow.fsClashingNames)
-                    nc.clashingLocalNames.emplace_back(f->localname);
-
-                ncs->emplace_back(std::move(nc));
-            }
-            if (++count >= limit)
-            {
-                break;
-            }
-        }
-
-        // recurse after dealing with all items, so any renames within the folder have been completed
-        if (childRow.syncNode && childRow.syncNode->type == FOLDERNODE)
-        {
-            auto syncPathRestore = makeScopedSyncPathRestorer(fullPath);
-
-            if (!fullPath.appendRowNames(childRow, mFilesystemType) ||
-                localdebris.isContainingPathOf(fullPath.localPath))
-            {
-                // This is a legitimate case; eg. we only had a syncNode and it is removed in resolve_delSyncNode
-                // Or if this is the debris folder, ignore it
-                continue;
-            }
-
-            recursiveCollectNameConflicts(childRow, fullPath, ncs, count, limit);
-        }
-    }
-}
-
 bool SyncRow::hasClashes() const
 {
     return !cloudClashingNames.empty() || !fsClashingNames.empty();
@@ -7506,18 +7772,66 @@ void Sync::combineTripletSet(vector<SyncRow>::iterator a, vector<SyncRow>::itera
 #endif
 }
 
+// Sorts by a name that compareUtf() would compare without unescaping: that order is the order
+// of the UTF-8 bytes, after uppercasing each codepoint when case insensitive.
+template<typename T, typename NameOf>
+static void sortByName(vector<T*>& items, bool caseInsensitive, NameOf nameOf)
+{
+    if (!caseInsensitive)
+    {
+        std::sort(items.begin(), items.end(), [&nameOf](T* lhs, T* rhs) { return nameOf(*lhs) < nameOf(*rhs); });
+        return;
+    }
+
+    // uppercased once each, rather than on every comparison
+    vector<std::pair<string, T*>> keyed;
+    keyed.reserve(items.size());
+    for (auto* item : items)
+    {
+        keyed.emplace_back(Utils::toUpperUtf8(nameOf(*item)), item);
+    }
+
+    std::sort(keyed.begin(), keyed.end(), [](const std::pair<string, T*>& lhs, const std::pair<string, T*>& rhs)
+              { return lhs.first < rhs.first; });
+
+    for (size_t i = 0; i < keyed.size(); ++i)
+    {
+        items[i] = keyed[i].second;
+    }
+}
+
 auto Sync::computeSyncTriplets(vector<CloudNode>& cloudNodes, const LocalNode& syncParent, vector<FSNode>& fsNodes) const -> vector<SyncRow>
 {
     assert(syncs.onSyncThread());
 
     CodeCounter::ScopeTimer rst(syncs.mClient.performanceStats.computeSyncTripletsTime);
+    MEGA_TRACE_SCOPE("sync", "computeSyncTriplets");
 
     vector<SyncRow> triplets;
     triplets.reserve(cloudNodes.size() + syncParent.children.size() + fsNodes.size());
 
-    for (auto& cn : cloudNodes)          triplets.emplace_back(&cn, nullptr, nullptr);
-    for (auto& sn : syncParent.children) triplets.emplace_back(nullptr, sn.second, nullptr);
-    for (auto& fsn : fsNodes)            triplets.emplace_back(nullptr, nullptr, &fsn);
+    // Each source is sorted on its own and then the three are merged. Cloud names may hold
+    // escapes, so they need compareUtf, but the local names of a single source can be sorted
+    // by their (uppercased) UTF-8 bytes, which orders them just as compareUtf() would.
+    vector<CloudNode*> sortedCloud;
+    sortedCloud.reserve(cloudNodes.size());
+    for (auto& cn : cloudNodes) sortedCloud.push_back(&cn);
+    std::sort(sortedCloud.begin(), sortedCloud.end(), [this](const CloudNode* lhs, const CloudNode* rhs)
+              { return compareUtf(lhs->name, true, rhs->name, true, mCaseInsensitive) < 0; });
+
+    vector<LocalNode*> sortedSync;
+    sortedSync.reserve(syncParent.children.size());
+    for (auto& sn : syncParent.children) sortedSync.push_back(sn.second);
+    sortByName(sortedSync, mCaseInsensitive, [](const LocalNode& n) -> const string& { return n.toName_of_localname; });
+
+    vector<FSNode*> sortedFs;
+    sortedFs.reserve(fsNodes.size());
+    for (auto& fsn : fsNodes) sortedFs.push_back(&fsn);
+    sortByName(sortedFs, mCaseInsensitive, [this](FSNode& n) -> const string& { return n.toName_of_localname(*syncs.fsaccess); });
+
+    for (auto* cn : sortedCloud) triplets.emplace_back(cn, nullptr, nullptr);
+    for (auto* sn : sortedSync)  triplets.emplace_back(nullptr, sn, nullptr);
+    for (auto* fsn : sortedFs)   triplets.emplace_back(nullptr, nullptr, fsn);
 
     auto tripletCompare = [this](const SyncRow& lhs, const SyncRow& rhs) -> int {
         // Sanity.
@@ -7580,9 +7894,13 @@ auto Sync::computeSyncTriplets(vector<CloudNode>& cloudNodes, const LocalNode& s
         }
     };
 
-    std::sort(triplets.begin(), triplets.end(),
-           [=](const SyncRow& lhs, const SyncRow& rhs)
-           { return tripletCompare(lhs, rhs) < 0; });
+    auto tripletLess = [=](const SyncRow& lhs, const SyncRow& rhs)
+                       { return tripletCompare(lhs, rhs) < 0; };
+
+    auto syncBegin = triplets.begin() + ptrdiff_t(sortedCloud.size());
+    auto fsBegin = syncBegin + ptrdiff_t(sortedSync.size());
+    std::inplace_merge(triplets.begin(), syncBegin, fsBegin, tripletLess);
+    std::inplace_merge(triplets.begin(), fsBegin, triplets.end(), tripletLess);
 
     auto currSet = triplets.begin();
     auto end  = triplets.end();
@@ -7656,6 +7974,62 @@ bool Sync::inferRegeneratableTriplets(vector<CloudNode>& cloudChildren, const Lo
     return true;
 }
 
+bool Sync::inferFlaggedChildTriplets(NodeHandle cloudParent, const LocalNode& syncParent, vector<CloudNode>& cloudChildren, vector<FSNode>& inferredFsNodes, vector<SyncRow>& inferredRows) const
+{
+    assert(syncs.onSyncThread());
+
+    CodeCounter::ScopeTimer rst(syncs.mClient.performanceStats.inferSyncTripletsTime);
+
+    vector<LocalNode*> visit;
+    for (auto& child : syncParent.children)
+    {
+        if (child.second->flaggedForVisit())
+        {
+            visit.push_back(child.second);
+        }
+    }
+
+    // recursiveSync works out the ignore file state from its row, so it must always have one
+    if (syncParent.rareRO().filterChain)
+    {
+        auto it = syncParent.children.find(IGNORE_FILE_NAME);
+        if (it == syncParent.children.end())
+        {
+            // it may differ in case only, let the full algorithm match it up
+            return false;
+        }
+        if (!it->second->flaggedForVisit())
+        {
+            visit.push_back(it->second);
+        }
+    }
+
+    // the rows point into these
+    cloudChildren.reserve(visit.size());
+    inferredFsNodes.reserve(visit.size());
+
+    for (LocalNode* child : visit)
+    {
+        CloudNode node;
+        if (!syncs.lookupCloudNode(child->syncedCloudNodeHandle, node, nullptr, nullptr, nullptr, nullptr, nullptr, Syncs::EXACT_VERSION) ||
+            node.parentHandle != cloudParent ||
+            child->fsid_asScanned == UNDEF ||
+            (!child->scannedFingerprint.isvalid && child->type == FILENODE))
+        {
+            // not synced, or the cloud side changed under us.  The full algorithm will sort it out
+            cloudChildren.clear();
+            inferredFsNodes.clear();
+            inferredRows.clear();
+            return false;
+        }
+
+        cloudChildren.push_back(std::move(node));
+        inferredFsNodes.push_back(child->getScannedFSDetails());
+        inferredRows.emplace_back(&cloudChildren.back(), child, &inferredFsNodes.back());
+    }
+    return true;
+}
+
 using IndexPair = pair<size_t, size_t>;
 using IndexPairVector = vector<IndexPair>;
 
@@ -7840,12 +8214,33 @@ bool Sync::recursiveSync(SyncRow& row, SyncPath& fullPath, bool belowRemovedClou
         vector<FSNode> fsChildren;
         vector<CloudNode> cloudChildren;
 
-        if (row.cloudNode)
+        // Only on the way to flagged descendants?  Then the clean children have nothing to do
+        // at this level either, and the pass costs what changed rather than the folder size.
+        // Changes in this very folder, cloud or local, would have flagged it for action here.
+        bool passingThrough = wasSynced && !syncHere && recurseHere &&
+                              !belowRemovedCloudNode && !belowRemovedFsNode &&
+                              row.cloudNode && !row.syncNode->lastFolderScan &&
+                              row.syncNode->scanAgain < TREE_ACTION_HERE &&
+                              row.syncNode->syncAgain < TREE_ACTION_HERE &&
+                              originalConflicsFlag < TREE_ACTION_HERE;
+
+        bool flaggedRowsOnly = passingThrough &&
+            inferFlaggedChildTriplets(row.cloudNode->handle, *row.syncNode, cloudChildren, fsInferredChildren, childRows);
+
+        if (flaggedRowsOnly)
         {
-            syncs.lookupCloudChildren(row.cloudNode->handle, cloudChildren);
+            SYNC_verbose_timed << syncname << "Passing through, " << childRows.size() << " of "
+                               << row.syncNode->children.size() << " children flagged at " << fullPath.syncPath;
         }
+        else
+        {
+            if (row.cloudNode)
+            {
+                syncs.lookupCloudChildren(row.cloudNode->handle, cloudChildren);
+            }
 
-        row.inferOrCalculateChildSyncRows(wasSynced, childRows, fsInferredChildren, fsChildren, cloudChildren, belowRemovedFsNode, syncs.localnodeByScannedFsid);
+            row.inferOrCalculateChildSyncRows(wasSynced, childRows, fsInferredChildren, fsChildren, cloudChildren, belowRemovedFsNode, syncs.localnodeByScannedFsid);
+        }
 
         bool anyNameConflicts = false;
 
@@ -8104,7 +8499,13 @@ bool Sync::recursiveSync(SyncRow& row, SyncPath& fullPath, bool belowRemovedClou
                         else if (syncHere && !childRow.itemProcessed)
                         {
                             // normal case: consider all the combinations
-                            if (!syncItem(childRow, row, fullPath, pflsc))
+                            bool resolved;
+                            {
+                                SyncTelemetryTimer timer(mUnifiedSync.mTelemetry.resolve);
+                                resolved = syncItem(childRow, row, fullPath, pflsc);
+                            }
+
+                            if (!resolved)
                             {
                                 if (childRow.syncNode && childRow.syncNode->type != FOLDERNODE)
                                 {
@@ -8183,6 +8584,12 @@ bool Sync::recursiveSync(SyncRow& row, SyncPath& fullPath, bool belowRemovedClou
             //}
         }
 
+        // Passing through, this folder had no conflicts of its own, and only the flagged rows are here.
+        if (!flaggedRowsOnly)
+        {
+            indexNameConflicts(*row.syncNode, fullPath, childRows);
+        }
+
         if (!anyNameConflicts)
         {
             // here childRows still contains pointers into lastFolderScan, fsAddedSiblings etc
@@ -8402,7 +8809,10 @@ bool Sync::syncItem_checkMoves(SyncRow& row, SyncRow& parentRow, SyncPath& fullP
         }
     }
 
-    if (row.cloudNode &&
+    // A backup's cloud side only changes by our hand, so there are no cloud moves to infer there.
+    // Should something else change it, the row comparison in syncItem() sees the difference:
+    // a mirroring backup overwrites it with the local state, a monitoring one is disabled.
+    if (row.cloudNode && !isBackup() &&
         (!row.syncNode ||
           row.syncNode->syncedCloudNodeHandle.isUndef() ||
           row.syncNode->syncedCloudNodeHandle != row.cloudNode->handle ||
@@ -8649,6 +9059,8 @@ bool Sync::syncItem_checkDownloadCompletion(SyncRow& row, SyncRow& parentRow, Sy
             // Download was moved into place.
             downloadPtr->wasDistributed = true;
 
+            mUnifiedSync.mTelemetry.download.add(std::chrono::steady_clock::now() - downloadPtr->queuedAt);
+
             // No longer necessary as the transfer's complete.
             row.syncNode->resetTransfer(nullptr);
 
@@ -10067,19 +10479,33 @@ bool Sync::resolve_upsync(SyncRow& row, SyncRow& parentRow, SyncPath& fullPath,
             {
                 LOG_debug << syncname << "Sync - local file addition detected: " << fullPath.localPath;
 
-                //if (checkIfFileIsChanging(*row.fsNode, fullPath.localPath))
-                //{
-                //    LOG_debug << syncname
-                //              << "Waiting for file to stabilize before uploading: "
-                //              << fullPath.localPath.toPath();
+                // Files written a moment ago are likely still being written: uploading them now
+                // would only take a slot from the stable ones and be cancelled when they change.
+                // Only those are opened to check, the scan's mtime is enough for the rest.
+                if (m_time() - row.fsNode->fingerprint.mtime < FILE_UPDATE_DELAY_DS / 10)
+                {
+                    // nullopt is the first check, which has nothing to compare with yet
+                    auto waitforupdateOpt = checkIfFileIsChanging(*row.fsNode, fullPath.localPath);
 
-                //    monitor.waitingLocal(fullPath.localPath,
-                //                         LocalPath(),
-                //                         string(),
-                //                         SyncWaitReason::WaitingForFileToStopChanging);
+                    if (!waitforupdateOpt || *waitforupdateOpt)
+                    {
+                        LOG_debug << syncname
+                                  << "Waiting for file to stabilize before uploading: "
+                                  << fullPath.localPath;
 
-                //    return false;
-                //}
+                        monitor.waitingLocal(fullPath.localPath, SyncStallEntry(
+                            SyncWaitReason::FileIssue, false, false,
+                            {}, {},
+                            {fullPath.localPath, PathProblem::FileChangingFrequently}, {}));
+
+                        return false;
+                    }
+                }
+                else
+                {
+                    // settled since it was last checked
+                    syncs.mFileChangingCheckState.erase(fullPath.localPath);
+                }
 
                 // Ask the controller if we should defer uploading this file.
                 if (deferred("Upload deferred by controller",
@@ -11495,6 +11921,9 @@ void Syncs::processTriggerHandles()
         NodeHandle h = t.first;
         bool recurse = t.second;
 
+        // names of the cloud folders we climbed through, deepest first
+        vector<string> unmatchedNames;
+
         for (;;)
         {
             auto range = localnodeByNodeHandle.equal_range(h);
@@ -11515,7 +11944,7 @@ void Syncs::processTriggerHandles()
                     {
                         auto& syncs = *this;
                         SYNC_verbose << mClient.clientname << "Trigger syncNode not found for " << cloudNodePath << ", will trigger parent";
-                        recurse = true;
+                        unmatchedNames.push_back(cloudNode.name);
                         h = cloudNode.parentHandle;
                         continue;
                     }
@@ -11527,8 +11956,32 @@ void Syncs::processTriggerHandles()
                 for (auto it = range.first; it != range.second; ++it)
                 {
                     auto& syncs = *this;
-                    SYNC_verbose << mClient.clientname << "Triggering sync flag for " << it->second->getLocalPath() << (recurse ? " recursive" : "");
-                    it->second->setSyncAgain(false, true, recurse);
+                    LocalNode* ln = it->second;
+
+                    // Only flag the branch leading to the change, not the whole subtree below the
+                    // ancestor we found.  Where that branch has no LocalNodes yet, syncing this
+                    // folder creates them from the cloud, and new folders flag their own subtree.
+                    // A LocalNode that exists but isn't synced to the cloud folder we climbed
+                    // through is re-evaluated along with everything below it.
+                    LocalNode* unmatched = nullptr;
+                    for (auto name = unmatchedNames.rbegin(); name != unmatchedNames.rend(); ++name)
+                    {
+                        auto localname = LocalPath::fromRelativeName(*name, *fsaccess, ln->sync->mFilesystemType);
+                        LocalNode* child = (unmatched ? unmatched : ln)->childbyname(&localname);
+                        if (!child) break;
+                        unmatched = child;
+                    }
+
+                    if (unmatched)
+                    {
+                        SYNC_verbose << mClient.clientname << "Triggering sync flag for " << unmatched->getLocalPath() << " recursive";
+                        unmatched->setSyncAgain(true, true, true);
+                    }
+                    else
+                    {
+                        SYNC_verbose << mClient.clientname << "Triggering sync flag for " << ln->getLocalPath() << (recurse ? " recursive" : "");
+                        ln->setSyncAgain(false, true, recurse);
+                    }
                 }
             }
             break;
@@ -12306,6 +12759,7 @@ bool SyncConfigIOContext::deserialize(SyncConfig& config, JSON& reader, bool isE
     const auto TYPE_TARGET_HANDLE   = MAKENAMEID2('t', 'h');
     const auto TYPE_TARGET_PATH     = MAKENAMEID2('t', 'p');
     const auto TYPE_LEGACY_INELIGIB = MAKENAMEID2('l', 'i');
+    const auto TYPE_BACKGROUND_IO   = MAKENAMEID2('b', 'i');
 
     // Temporary storage.
     std::uint64_t fsFingerprint = 0;
@@ -12411,6 +12865,10 @@ bool SyncConfigIOContext::deserialize(SyncConfig& config, JSON& reader, bool isE
             config.mLegacyExclusionsIneligigble = reader.getbool();
             break;
 
+        case TYPE_BACKGROUND_IO:
+            config.mBackgroundIO = reader.getbool();
+            break;
+
         default:
             if (!reader.storeobject())
             {
@@ -12482,6 +12940,7 @@ void SyncConfigIOContext::serialize(const SyncConfig& config,
     writer.arg("cm", config.mChangeDetectionMethod);
     writer.arg("si", config.mScanIntervalSec);
     writer.arg("li", config.mLegacyExclusionsIneligigble);
+    writer.arg("bi", config.mBackgroundIO);
     writer.endobject();
 }
 
@@ -12491,6 +12950,8 @@ void Syncs::syncLoop()
     syncThreadId = std::this_thread::get_id();
     assert(onSyncThread());
 
+    Tracer::instance().setThreadName("sync");
+
     std::condition_variable cv;
     std::mutex dummy_mutex;
     std::unique_lock<std::mutex> dummy_lock(dummy_mutex);
@@ -12552,6 +13013,7 @@ void Syncs::syncLoop()
                 LOG_debug << "Sync thread executing request: " << f.second;
             }
 
+            MEGA_TRACE_SCOPE("sync", "syncThreadAction");
             f.first();
         }
 
@@ -12745,6 +13207,7 @@ void Syncs::syncLoop()
         bool earlyExit = false;
         auto recurseStart = std::chrono::high_resolution_clock::now();
         CodeCounter::ScopeTimer rst(mClient.performanceStats.recursiveSyncTime);
+        MEGA_TRACE_SCOPE("sync", "recursiveSync");
 
         if (!lastLoopEarlyExit)
         {
@@ -12770,7 +13233,20 @@ void Syncs::syncLoop()
 
         unsigned skippedForScanning = 0;
 
+        // A sync's pass can take long while its tree is still being built.  Those go last, so
+        // the syncs that are up to date get their changes detected first.
+        vector<UnifiedSync*> passOrder;
+        passOrder.reserve(mSyncVec.size());
         for (auto& us : mSyncVec)
+        {
+            passOrder.push_back(us.get());
+        }
+        std::stable_partition(passOrder.begin(), passOrder.end(), [](UnifiedSync* us)
+        {
+            return us->mConfig.mFinishedInitialScanning;
+        });
+
+        for (UnifiedSync* us : passOrder)
         {
             Sync* sync = us->mSync.get();
 
@@ -12779,6 +13255,9 @@ void Syncs::syncLoop()
                 // Does this sync rely on filesystem notifications?
                 if (auto* notifier = sync->dirnotify.get())
                 {
+                    // take the ones that arrived while the syncs before it were processed
+                    sync->procscanq();
+
                     // Has it encountered a recoverable error?
                     if (notifier->mErrorCount.load() > 0)
                     {
@@ -12829,15 +13308,15 @@ void Syncs::syncLoop()
                 }
 
                 {
-                    bool activeIncomplete = sync->mActiveScanRequestGeneral &&
-                        !sync->mActiveScanRequestGeneral->completed();
+                    // all the general slots are busy
+                    bool activeIncomplete = !sync->freeGeneralScanSlot();
 
                     bool unscannedIncomplete = sync->mActiveScanRequestUnscanned &&
                         !sync->mActiveScanRequestUnscanned->completed();
 
                     if ((activeIncomplete && unscannedIncomplete) ||
                         (activeIncomplete && sync->threadSafeState->neverScannedFolderCount.load() == 0) ||
-                        (unscannedIncomplete && !sync->mActiveScanRequestGeneral))
+                        (unscannedIncomplete && !sync->anyGeneralScanRequest()))
                     {
                         // Save CPU by not starting another recurse of the LocalNode tree
                         // if a scan is not finished yet.  Scans can take a fair while for large
@@ -12869,7 +13348,7 @@ void Syncs::syncLoop()
                             earlyExit = true;
                         }
 
-                        sync->cachenodes();
+                        sync->cachenodes(false);
                     }
 
                     if (!earlyExit)
@@ -12901,6 +13380,8 @@ void Syncs::syncLoop()
                 SyncTransferCounts stc = sync->threadSafeState->transferCounts();
                 counts.numUploads = static_cast<int32_t>(stc.mUploads.mPending);
                 counts.numDownloads = static_cast<int32_t>(stc.mDownloads.mPending);
+                counts.numFingerprintsComputed = sync->mFingerprintsComputed;
+                counts.numFingerprintsReused = sync->mFingerprintsReused;
                 if (us->lastReportedDisplayStats != counts)
                 {
                     mClient.app->syncupdate_stats(us->mConfig.mBackupId, counts);
@@ -13120,7 +13601,7 @@ bool Syncs::conflictsDetected(SyncIDtoConflictInfoMap& conflicts)
                 conflicts.clear();
                 break;
             }
-            sync->recursiveCollectNameConflicts(&it->second);
+            sync->collectNameConflicts(&it->second);
             totalConflicts += it->second.size();
         }
     }
@@ -13150,7 +13631,7 @@ size_t Syncs::conflictsDetectedCount(size_t limit) const
                     count = limit;
                     break;
                 }
-                sync->recursiveCollectNameConflicts(nullptr, &count, limit ? &limit : nullptr);
+                sync->collectNameConflicts(nullptr, &count, limit ? &limit : nullptr);
                 if (count >= limit) break;
             }
         }
@@ -13182,7 +13663,7 @@ void Syncs::collectSyncNameConflicts(handle backupId, std::function<void(list<Na
             {
                 if (us->mSync && (us->mConfig.mBackupId == backupId || backupId == UNDEF))
                 {
-                    us->mSync->recursiveCollectNameConflicts(&nc);
+                    us->mSync->collectNameConflicts(&nc);
                 }
             }
             finalcompletion(std::move(nc));
@@ -13281,21 +13762,16 @@ void Syncs::processSyncConflicts()
     else if (conflictsNow && !mClient.app->isSyncStalledChanged() &&
             ((std::chrono::steady_clock::now() - lastSyncConflictsCount) >= MIN_DELAY_BETWEEN_SYNC_STALLS_OR_CONFLICTS_COUNT))
     {
-        auto minDelayBetweenConflictsCount = std::min(std::max(MIN_DELAY_BETWEEN_SYNC_STALLS_OR_CONFLICTS_COUNT,
-                                                                std::chrono::milliseconds(totalSyncConflicts.load() * 10)), // 1 second for every 100 conflicts
-                                                        MAX_DELAY_BETWEEN_SYNC_STALLS_OR_CONFLICTS_COUNT);
-        if ((std::chrono::steady_clock::now() - lastSyncConflictsCount) >= minDelayBetweenConflictsCount)
+        // Counting reads the conflict index, not the tree, so there's no need to back off as conflicts grow.
+        auto updatedTotalSyncsConflict = conflictsDetectedCount(totalSyncConflicts.load() + 1); // We only need to know either if there are now less conflicts or at least one conflict more than before
+        if (totalSyncConflicts.load() != updatedTotalSyncsConflict)
         {
-            auto updatedTotalSyncsConflict = conflictsDetectedCount(totalSyncConflicts.load() + 1); // We only need to know either if there are now less conflicts or at least one conflict more than before
-            if (totalSyncConflicts.load() != updatedTotalSyncsConflict)
-            {
-                assert(onSyncThread());
-                mClient.app->syncupdate_totalconflicts(true);
-                LOG_info << mClient.clientname << "Sync conflicting paths state app update notified [previousSyncConflictsTotal = " << totalSyncConflicts.load() << ", updatedTotalSyncsConflict = " << updatedTotalSyncsConflict << "]";
-                totalSyncConflicts.store(updatedTotalSyncsConflict);
-            }
-            lastSyncConflictsCount = std::chrono::steady_clock::now();
+            assert(onSyncThread());
+            mClient.app->syncupdate_totalconflicts(true);
+            LOG_info << mClient.clientname << "Sync conflicting paths state app update notified [previousSyncConflictsTotal = " << totalSyncConflicts.load() << ", updatedTotalSyncsConflict = " << updatedTotalSyncsConflict << "]";
+            totalSyncConflicts.store(updatedTotalSyncsConflict);
         }
+        lastSyncConflictsCount = std::chrono::steady_clock::now();
     }
 }
 
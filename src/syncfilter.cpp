@@ -58,6 +58,13 @@ public:
     // True if this filter matches the string pair p.
     virtual bool match(const RemotePathPair& p) const = 0;
 
+    // True if this filter matches the path rather than the name.
+    virtual bool matchesPath() const = 0;
+
+    // True if this filter matches only the string s.
+    // s is uppercased unless caseSensitive is set.
+    bool literal(string& s, bool& caseSensitive) const;
+
     virtual string debugDescription() const = 0;
 
 protected:
@@ -87,6 +94,8 @@ public:
 
     bool match(const RemotePathPair& p) const override;
 
+    bool matchesPath() const override;
+
     string debugDescription() const override;
 }; /* NameFilter */
 
@@ -101,6 +110,8 @@ public:
 
     bool match(const RemotePathPair& p) const override;
 
+    bool matchesPath() const override;
+
     string debugDescription() const override;
 }; /* PathFilter */
 
@@ -112,6 +123,12 @@ public:
     // True if this matcher matches the string s.
     virtual bool match(const string& s) const = 0;
 
+    // True if this matcher matches only the string s (see StringFilter::literal).
+    virtual bool literal(string&, bool&) const
+    {
+        return false;
+    }
+
     virtual string debugDescription() const = 0;
 
 protected:
@@ -127,6 +144,9 @@ public:
     // True if the wildcard pattern matches the string s.
     bool match(const string& s) const override;
 
+    // True if the pattern has no wildcards.
+    bool literal(string& s, bool& caseSensitive) const override;
+
     string debugDescription() const override;
 
 private:
@@ -522,6 +542,34 @@ void FilterChain::clear()
     mFingerprint = FileFingerprint();
     mSizeFilter.reset();
     mStringFilters.clear();
+    index();
+}
+
+void FilterChain::index()
+{
+    for (auto& byCase : mLiteralFilters)
+    {
+        for (auto& filters : byCase)
+        {
+            filters.clear();
+        }
+    }
+    mPatternFilters.clear();
+
+    for (size_t i = 0; i < mStringFilters.size(); ++i)
+    {
+        string s;
+        bool caseSensitive;
+
+        if (mStringFilters[i]->literal(s, caseSensitive))
+        {
+            mLiteralFilters[mStringFilters[i]->matchesPath()][!caseSensitive][s].push_back(i);
+        }
+        else
+        {
+            mPatternFilters.push_back(i);
+        }
+    }
 }
 
 FilterLoadResult FilterChain::load(FileSystemAccess& fsAccess, const LocalPath& path)
@@ -620,6 +668,7 @@ FilterLoadResult FilterChain::load(FileAccess& fileAccess)
     // Move new filters into place.
     mStringFilters = std::move(stringFilters);
     mSizeFilter = std::move(sizeFilter);
+    index();
 
     LOG_info << "New exclusion rules from file are as follows";
     for (auto &e : mStringFilters)
@@ -642,22 +691,61 @@ ExclusionState FilterChain::match(const RemotePathPair& p,
 {
     if (!mLoadSucceeded) return ES_UNKNOWN;
 
-    auto i = mStringFilters.rbegin();
-    auto j = mStringFilters.rend();
+    auto eligible = [&](const StringFilter& filter)
+    {
+        return (!onlyInheritable || filter.inheritable()) && filter.applicable(type);
+    };
+
+    // The last filter to match decides. Find the last literal one by lookup...
+    size_t last = 0;
+    bool found = false;
 
-    for ( ; i != j; ++i)
+    for (unsigned path = 0; path < 2; ++path)
     {
-        if (onlyInheritable && !(*i)->inheritable())
+        const string& s = path ? p.second : p.first;
+
+        for (unsigned caseInsensitive = 0; caseInsensitive < 2; ++caseInsensitive)
         {
-            continue;
+            const auto& filters = mLiteralFilters[path][caseInsensitive];
+            if (filters.empty())
+            {
+                continue;
+            }
+
+            auto it = filters.find(caseInsensitive ? toUpper(s) : s);
+            if (it == filters.end())
+            {
+                continue;
+            }
+
+            for (auto i = it->second.rbegin(); i != it->second.rend(); ++i)
+            {
+                if ((!found || *i > last) && eligible(*mStringFilters[*i]))
+                {
+                    last = *i;
+                    found = true;
+                    break;
+                }
+            }
         }
+    }
+
+    // ...then only the patterns defined after it need to be tried.
+    for (auto i = mPatternFilters.rbegin(); i != mPatternFilters.rend() && (!found || *i > last); ++i)
+    {
+        const StringFilter& filter = *mStringFilters[*i];
 
-        if ((*i)->applicable(type) && (*i)->match(p))
+        if (eligible(filter) && filter.match(p))
         {
-            return (*i)->inclusion() ? ES_INCLUDED : ES_EXCLUDED;
+            return filter.inclusion() ? ES_INCLUDED : ES_EXCLUDED;
         }
     }
 
+    if (found)
+    {
+        return mStringFilters[last]->inclusion() ? ES_INCLUDED : ES_EXCLUDED;
+    }
+
     return ES_UNMATCHED;
 }
 
@@ -778,6 +866,11 @@ bool StringFilter::match(const string& s) const
     return mMatcher->match(s);
 }
 
+bool StringFilter::literal(string& s, bool& caseSensitive) const
+{
+    return mMatcher->literal(s, caseSensitive);
+}
+
 NameFilter::NameFilter(MatcherPtr matcher,
                        const Target& target,
                        const bool inclusion,
@@ -794,6 +887,11 @@ bool NameFilter::match(const RemotePathPair& p) const
     return StringFilter::match(p.first);
 }
 
+bool NameFilter::matchesPath() const
+{
+    return false;
+}
+
 string NameFilter::debugDescription() const
 {
     string s = "name: " + mMatcher->debugDescription();
@@ -818,6 +916,11 @@ bool PathFilter::match(const RemotePathPair& p) const
     return StringFilter::match(p.second);
 }
 
+bool PathFilter::matchesPath() const
+{
+    return true;
+}
+
 string PathFilter::debugDescription() const
 {
     string s = "path: " + mMatcher->debugDescription();
@@ -842,6 +945,18 @@ bool GlobMatcher::match(const string& s) const
     return wildcardMatch(toUpper(s), mPattern);
 }
 
+bool GlobMatcher::literal(string& s, bool& caseSensitive) const
+{
+    if (mPattern.find_first_of("*?") != string::npos)
+    {
+        return false;
+    }
+
+    s = mPattern;
+    caseSensitive = mCaseSensitive;
+    return true;
+}
+
 string GlobMatcher::debugDescription() const
 {
     string s = mPattern;
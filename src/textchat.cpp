@@ -545,7 +545,7 @@ bool TextChat::serialize(string *d) const
 
     d->append((char*)&chatOptions, 1);
 
-    char hasSheduledMeetings = !mScheduledMeetings.empty() ? 1 : 0;
+    char hasSheduledMeetings = !mScheduledMeetings.empty() || !mSerializedSchedMeetings.empty() ? 1 : 0;
     d->append((char*)&hasSheduledMeetings, 1);
 
     d->append("\0\0\0", 3); // additional bytes for backwards compatibility
@@ -575,7 +575,20 @@ bool TextChat::serialize(string *d) const
         d->append((char*) unifiedKey.data(), unifiedKey.size());
     }
 
-    if (hasSheduledMeetings)
+    if (hasSheduledMeetings && !mSerializedSchedMeetings.empty())
+    {
+        // not unserialized since they were read: the same records
+        ll = static_cast<unsigned short>(mSerializedSchedMeetings.size());
+        d->append((char *)&ll, sizeof ll);
+
+        for (auto& schedMeetingStr : mSerializedSchedMeetings)
+        {
+            ll = static_cast<unsigned short>(schedMeetingStr.size());
+            d->append((char *)&ll, sizeof ll);
+            d->append(schedMeetingStr.data(), schedMeetingStr.size());
+        }
+    }
+    else if (hasSheduledMeetings)
     {
         // serialize the number of scheduledMeetings
         ll = static_cast<unsigned short>(mScheduledMeetings.size());
@@ -833,20 +846,8 @@ TextChat* TextChat::unserialize(class MegaClient *client, string *d)
         return NULL;
     }
 
-    vector<unique_ptr<ScheduledMeeting>> schedMeetings;
-    for (const auto& i : scheduledMeetingsStr)
-    {
-        ScheduledMeeting* auxMeet = ScheduledMeeting::unserialize(i, id);
-        if (!auxMeet)
-        {
-            LOG_err << "Failure at schedule meeting unserialization";
-            assert(auxMeet);
-            return NULL;
-        }
-        schedMeetings.push_back(std::unique_ptr<ScheduledMeeting>(auxMeet));
-    }
-
     TextChat*& chat = client->chats[id]; // use reference to pointer to avoid 3 searches instead of one
+    bool inRam = chat != nullptr;
     if (!chat)
     {
         chat = new TextChat(publicchat);
@@ -871,14 +872,47 @@ TextChat* TextChat::unserialize(class MegaClient *client, string *d)
     chat->meeting = meetingRoom != 0;
     chat->chatOptions = chatOptions;
 
-    for (auto& sm : schedMeetings)
+    if (inRam)
     {
-        chat->addSchedMeeting(std::move(sm), false /*notify*/);
+        // merged with the ones it already has
+        chat->loadSchedMeetings();
+    }
+    chat->mSerializedSchedMeetings.insert(chat->mSerializedSchedMeetings.end(),
+                                          std::make_move_iterator(scheduledMeetingsStr.begin()),
+                                          std::make_move_iterator(scheduledMeetingsStr.end()));
+    if (inRam)
+    {
+        chat->loadSchedMeetings();
     }
 
     return chat;
 }
 
+void TextChat::loadSchedMeetings() const
+{
+    if (mSerializedSchedMeetings.empty())
+    {
+        return;
+    }
+
+    std::vector<string> records;
+    records.swap(mSerializedSchedMeetings);
+    for (const auto& record : records)
+    {
+        std::unique_ptr<ScheduledMeeting> sm(ScheduledMeeting::unserialize(record, id));
+        if (!sm)
+        {
+            LOG_err << "Failure at schedule meeting unserialization";
+            assert(false);
+            continue;
+        }
+
+        // the first one prevails, as addSchedMeeting() does
+        handle schedId = sm->schedId();
+        mScheduledMeetings.emplace(schedId, std::move(sm));
+    }
+}
+
 void TextChat::setChatId(handle newId)
 {
     id = newId;
@@ -1064,6 +1098,7 @@ byte TextChat::getChatOptions() const
 
 bool TextChat::hasScheduledMeeting(handle smid) const
 {
+    loadSchedMeetings();
     return mScheduledMeetings.find(smid) != mScheduledMeetings.end();
 }
 
@@ -1157,6 +1192,7 @@ void TextChat::addUpdatedSchedMeetingOccurrence(std::unique_ptr<ScheduledMeeting
 
 const ScheduledMeeting* TextChat::getSchedMeetingById(handle id) const
 {
+    loadSchedMeetings();
     auto it = mScheduledMeetings.find(id);
     if (it != mScheduledMeetings.end())
     {
@@ -1167,6 +1203,7 @@ const ScheduledMeeting* TextChat::getSchedMeetingById(handle id) const
 
 const map<handle/*schedId*/, std::unique_ptr<ScheduledMeeting>>& TextChat::getSchedMeetings() const
 {
+    loadSchedMeetings();
     return mScheduledMeetings;
 }
 
@@ -1186,6 +1223,7 @@ bool TextChat::addSchedMeeting(std::unique_ptr<ScheduledMeeting> sm, bool notify
         return false;
     }
 
+    loadSchedMeetings();
     handle schedId = sm->schedId();
     if (mScheduledMeetings.find(schedId) != mScheduledMeetings.end())
     {
@@ -1204,6 +1242,7 @@ bool TextChat::addSchedMeeting(std::unique_ptr<ScheduledMeeting> sm, bool notify
 bool TextChat::removeSchedMeeting(handle schedId)
 {
     assert(schedId != UNDEF);
+    loadSchedMeetings();
     if (mScheduledMeetings.find(schedId) == mScheduledMeetings.end())
     {
         return false;
@@ -1222,6 +1261,7 @@ handle_set TextChat::removeChildSchedMeetings(handle parentSchedId)
 {
     // remove all scheduled meeting whose parent is parentSchedId
     handle_set deletedChildren;
+    loadSchedMeetings();
     for (auto it = mScheduledMeetings.begin(); it != mScheduledMeetings.end(); it++)
     {
         if (it->second->parentSchedId() == parentSchedId)
@@ -1238,6 +1278,7 @@ handle_set TextChat::removeChildSchedMeetings(handle parentSchedId)
 bool TextChat::updateSchedMeeting(std::unique_ptr<ScheduledMeeting> sm)
 {
     assert(sm);
+    loadSchedMeetings();
     auto it = mScheduledMeetings.find(sm->schedId());
     if (it == mScheduledMeetings.end())
     {
@@ -1271,6 +1312,7 @@ bool TextChat::addOrUpdateSchedMeeting(std::unique_ptr<ScheduledMeeting> sm, boo
         return false;
     }
 
+    loadSchedMeetings();
     return mScheduledMeetings.find(sm->schedId()) == mScheduledMeetings.end()
             ? addSchedMeeting(std::move(sm), notify)
             : updateSchedMeeting(std::move(sm));
@@ -0,0 +1,255 @@
+/**
+ * @file tracing.cpp
+ * @brief Timeline of the SDK's hot paths, in per-thread ring buffers
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/tracing.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <sstream>
+
+namespace mega {
+
+constexpr size_t Tracer::DEFAULT_RING_SIZE;
+constexpr size_t Tracer::MAX_RETIRED_RINGS;
+
+TraceRing::TraceRing(size_t capacity, unsigned id)
+    : mCapacity(std::max<size_t>(capacity, 1))
+    , mId(id)
+    , mSlots(new Slot[mCapacity])
+{
+}
+
+void TraceRing::push(const char* category, const char* name, uint64_t start, uint64_t duration)
+{
+    uint64_t n = mWritten.load(std::memory_order_relaxed);
+
+    // a reader seeing any of the stores below sees this one too
+    mWriting.store(n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Slot& slot = mSlots[n % mCapacity];
+    slot.category.store(category, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.duration.store(duration, std::memory_order_relaxed);
+
+    mWritten.store(n + 1, std::memory_order_release);
+}
+
+std::vector<TraceRing::Event> TraceRing::events() const
+{
+    uint64_t written = mWritten.load(std::memory_order_acquire);
+    uint64_t first = std::max(written > mCapacity ? written - mCapacity : 0,
+                              std::min(mCleared.load(std::memory_order_relaxed), written));
+
+    std::vector<Event> copied;
+    copied.reserve(static_cast<size_t>(written - first));
+    for (uint64_t i = first; i < written; ++i)
+    {
+        const Slot& slot = mSlots[i % mCapacity];
+        Event e;
+        e.category = slot.category.load(std::memory_order_relaxed);
+        e.name = slot.name.load(std::memory_order_relaxed);
+        e.start = slot.start.load(std::memory_order_relaxed);
+        e.duration = slot.duration.load(std::memory_order_relaxed);
+        copied.push_back(e);
+    }
+
+    // the slots the writer got to while copying may hold a mix of two events
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t writing = mWriting.load(std::memory_order_relaxed);
+    uint64_t valid = writing > mCapacity ? writing - mCapacity : 0;
+    if (valid > first)
+    {
+        copied.erase(copied.begin(), copied.begin() + static_cast<ptrdiff_t>(std::min(valid - first, uint64_t(copied.size()))));
+    }
+    return copied;
+}
+
+void TraceRing::clear()
+{
+    mCleared.store(mWritten.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+void TraceRing::setThreadName(string name)
+{
+    std::lock_guard<std::mutex> g(mNameMutex);
+    mThreadName = std::move(name);
+}
+
+string TraceRing::threadName() const
+{
+    std::lock_guard<std::mutex> g(mNameMutex);
+    return mThreadName;
+}
+
+// the calling thread's ring, handed to the tracer's retired ones once the thread ends
+class TraceThreadRing
+{
+public:
+    ~TraceThreadRing()
+    {
+        if (mRing)
+        {
+            Tracer::instance().retire(mRing);
+        }
+    }
+
+    std::shared_ptr<TraceRing> mRing;
+};
+
+static thread_local TraceThreadRing gThreadRing;
+
+Tracer& Tracer::instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::setRingSize(size_t events)
+{
+    mRingSize.store(std::max<size_t>(events, 1), std::memory_order_relaxed);
+}
+
+TraceRing& Tracer::ring()
+{
+    if (!gThreadRing.mRing)
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        gThreadRing.mRing = std::make_shared<TraceRing>(mRingSize.load(std::memory_order_relaxed), mNextId++);
+        mRings.push_back(gThreadRing.mRing);
+    }
+    return *gThreadRing.mRing;
+}
+
+void Tracer::retire(const std::shared_ptr<TraceRing>& ring)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    mRings.erase(std::remove(mRings.begin(), mRings.end(), ring), mRings.end());
+
+    mRetired.push_back(ring);
+    if (mRetired.size() > MAX_RETIRED_RINGS)
+    {
+        mRetired.pop_front();
+    }
+}
+
+void Tracer::record(const char* category, const char* name, uint64_t start, uint64_t duration)
+{
+    ring().push(category, name, start, duration);
+}
+
+void Tracer::setThreadName(string name)
+{
+    ring().setThreadName(std::move(name));
+}
+
+void Tracer::clear()
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    mRetired.clear();
+
+    for (auto& r : mRings)
+    {
+        r->clear();
+    }
+}
+
+namespace {
+
+// names are literals from the SDK, but a quote or a backslash would break the dump
+void exportString(std::ostringstream& out, const char* s)
+{
+    out << '"';
+    for (; s && *s; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+        {
+            out << '\\';
+        }
+        if (static_cast<unsigned char>(*s) >= 0x20)
+        {
+            out << *s;
+        }
+    }
+    out << '"';
+}
+
+// the format's timestamps are in microseconds
+void exportMicroseconds(std::ostringstream& out, uint64_t ns)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof buffer, "%" PRIu64 ".%03u", ns / 1000, static_cast<unsigned>(ns % 1000));
+    out << buffer;
+}
+
+} // namespace
+
+string Tracer::exportChromeJson() const
+{
+    std::vector<std::shared_ptr<TraceRing>> rings;
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        rings.assign(mRetired.begin(), mRetired.end());
+        rings.insert(rings.end(), mRings.begin(), mRings.end());
+    }
+
+    std::ostringstream out;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    auto separate = [&]()
+    {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    for (auto& r : rings)
+    {
+        string threadName = r->threadName();
+        if (!threadName.empty())
+        {
+            separate();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << r->id() << ",\"args\":{\"name\":";
+            exportString(out, threadName.c_str());
+            out << "}}";
+        }
+
+        for (auto& e : r->events())
+        {
+            separate();
+            out << "{\"name\":";
+            exportString(out, e.name);
+            out << ",\"cat\":";
+            exportString(out, e.category);
+            out << ",\"ph\":\"X\",\"ts\":";
+            exportMicroseconds(out, e.start);
+            out << ",\"dur\":";
+            exportMicroseconds(out, e.duration);
+            out << ",\"pid\":1,\"tid\":" << r->id() << '}';
+        }
+    }
+
+    out << "\n]}\n";
+    return out.str();
+}
+
+} // namespace
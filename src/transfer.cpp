@@ -32,6 +32,10 @@
 #include "mega/utils.h"
 #include "megawaiter.h"
 
+// transfers log their progress often: a build may keep only the coarser levels
+#undef MEGA_LOG_UNIT_MAX_LEVEL
+#define MEGA_LOG_UNIT_MAX_LEVEL MEGA_TRANSFER_LOG_MAX_LEVEL
+
 namespace mega {
 
 TransferCategory::TransferCategory(direction_t d, filesizetype_t s)
@@ -81,6 +85,7 @@ Transfer::Transfer(MegaClient* cclient, direction_t ctype)
     state = TRANSFERSTATE_NONE;
 
     skipserialization = false;
+    mDiskAllocation = ctype == GET ? cclient->mDownloadDiskAllocation : DISK_ALLOCATION_GROW;
 
     transfers_it = client->multi_transfers[type].end();
 }
@@ -102,6 +107,12 @@ Transfer::~Transfer()
         client->fileAttributesUploading.erase(uploadhandle);
     }
 
+    if (!uploadhandle.isUndef() && state != TRANSFERSTATE_COMPLETED)
+    {
+        // no putnodes will come to attach them to
+        client->fileAttributesAfterUpload.erase(uploadhandle);
+    }
+
     for (file_list::iterator it = files.begin(); it != files.end(); it++)
     {
         if (finished)
@@ -393,6 +404,27 @@ void Transfer::removeAndDeleteSelf(transferstate_t finalState)
     delete this;
 }
 
+bwclass_t Transfer::bandwidthClass() const
+{
+    bwclass_t c = files.empty() ? BW_USER : BW_BACKUP;
+    for (File* f : files)
+    {
+        if (!f->syncxfer)
+        {
+            return BW_USER;
+        }
+
+#ifdef ENABLE_SYNC
+        auto stf = dynamic_cast<SyncTransfer_inClient*>(f);
+        if (!stf || !stf->syncThreadSafeState || !stf->syncThreadSafeState->mCanChangeVault)
+#endif
+        {
+            c = BW_SYNC;
+        }
+    }
+    return c;
+}
+
 // transfer attempt failed, notify all related files, collect request on
 // whether to abort the transfer, kill transfer if unanimous
 void Transfer::failed(const Error& e, TransferDbCommitter& committer, dstime timeleft)
@@ -412,6 +444,7 @@ void Transfer::failed(const Error& e, TransferDbCommitter& committer, dstime tim
             client->activateoverquota(timeleft, (e == API_EPAYWALL));
             client->app->transfer_failed(this, e, timeleft);
             ++client->performanceStats.transferTempErrors;
+            client->mMetrics.transferTemporaryErrors.add();
         }
         else
         {
@@ -452,6 +485,7 @@ void Transfer::failed(const Error& e, TransferDbCommitter& committer, dstime tim
         state = TRANSFERSTATE_RETRYING;
         client->app->transfer_failed(this, e, timeleft);
         ++client->performanceStats.transferTempErrors;
+        client->mMetrics.transferTemporaryErrors.add();
     }
 
     for (file_list::iterator it = files.begin(); it != files.end();)
@@ -563,6 +597,7 @@ void Transfer::failed(const Error& e, TransferDbCommitter& committer, dstime tim
         }
         client->app->transfer_removed(this);
         ++client->performanceStats.transferFails;
+        client->mMetrics.transferFailures.add();
         delete this;
     }
 }
@@ -809,7 +844,7 @@ void Transfer::complete(TransferDbCommitter& committer)
             if (!downloadDistributor)
             {
                 // we keep the old one in case there was a temporary_error previously
-                downloadDistributor.reset(new FileDistributor(localfilename, files.size(), mtime, *this));
+                downloadDistributor.reset(new FileDistributor(localfilename, files.size(), mtime, *this, client->mDistributeWithHardLinks));
             }
 
             set<string> keys;
@@ -1205,7 +1240,7 @@ void DirectReadNode::retry(const Error& e, dstime timeleft)
             if (e)
             {
                 LOG_debug << "[DirectReadNode::retry] Calling pread_failure for DirectRead (" << (void*)(*it) << ")" << " [this = " << this << "]";
-                dstime retryds = client->app->pread_failure(e, retries, (*it)->appdata, timeleft);
+                dstime retryds = (*it)->failure(e, retries, timeleft);
 
                 if (retryds < minretryds && !(e == API_ETOOMANY && e.hasExtraInfo()))
                 {
@@ -1325,9 +1360,9 @@ void DirectReadNode::schedule(dstime deltads)
     }
 }
 
-void DirectReadNode::enqueue(m_off_t offset, m_off_t count, int reqtag, void* appdata)
+DirectRead* DirectReadNode::enqueue(m_off_t offset, m_off_t count, int reqtag, void* appdata, std::unique_ptr<DirectReadConsumer> consumer)
 {
-    new DirectRead(this, count, offset, reqtag, appdata);
+    return new DirectRead(this, count, offset, reqtag, appdata, std::move(consumer));
 }
 
 size_t UnusedConn::getNum() const
@@ -1410,7 +1445,13 @@ bool DirectReadSlot::processAnyOutputPieces()
             LOG_verbose << "DirectReadSlot -> Delivering assembled part ->"
                         << "len = " << len << ", speed = " << mSpeed << ", meanSpeed = " << (mMeanSpeed / 1024) << " KB/s"
                         << ", slotThroughput = " << ((calcThroughput(mSlotThroughput.first, mSlotThroughput.second) * 1000) / 1024) << " KB/s]" << " [this = " << this << "]";
-            continueDirectRead = mDr->drn->client->app->pread_data(outputPiece->buf.datastart(), len, mPos, mSpeed, mMeanSpeed, mDr->appdata);
+            MegaClient* client = mDr->drn->client;
+            if (client->mStreamingCache.enabled())
+            {
+                client->mStreamingCache.fill(mDr->drn->h, mDr->drn->ctriv, mDr->drn->size, mPos,
+                                             outputPiece->buf.datastart(), len, mDr->cachePartial);
+            }
+            continueDirectRead = mDr->deliver(outputPiece->buf.datastart(), len, mPos, mSpeed, mMeanSpeed);
         }
         else
         {
@@ -2213,8 +2254,80 @@ m_off_t DirectRead::drMaxReqSize() const
     return std::max(drn->size / numParts, TransferSlot::MAX_REQ_SIZE);
 }
 
-DirectRead::DirectRead(DirectReadNode* cdrn, m_off_t ccount, m_off_t coffset, int creqtag, void* cappdata)
+void StreamingCache::setLimit(size_t bytes)
+{
+    mLimit = bytes;
+    trim();
+}
+
+const string* StreamingCache::find(handle h, int64_t ctriv, m_off_t pos)
+{
+    auto it = mIndex.find(BlockKey(h, ctriv, pos / BLOCKSIZE));
+    if (it == mIndex.end())
+    {
+        return nullptr;
+    }
+
+    mBlocks.splice(mBlocks.begin(), mBlocks, it->second);
+    return &it->second->second;
+}
+
+void StreamingCache::fill(handle h, int64_t ctriv, m_off_t fileSize, m_off_t pos, const byte* data, size_t len, Partial& partial)
+{
+    while (len && enabled())
+    {
+        if (partial.pos < 0 || partial.pos + m_off_t(partial.data.size()) != pos)
+        {
+            // not continuing the block in progress: start one at the next boundary,
+            // unless that one is cached already
+            partial.pos = -1;
+            partial.data.clear();
+
+            m_off_t blockStart = pos - pos % BLOCKSIZE;
+            if (pos != blockStart || mIndex.count(BlockKey(h, ctriv, pos / BLOCKSIZE)))
+            {
+                size_t skip = size_t(std::min<m_off_t>(m_off_t(len), blockStart + BLOCKSIZE - pos));
+                pos += m_off_t(skip);
+                data += skip;
+                len -= skip;
+                continue;
+            }
+            partial.pos = pos;
+            partial.data.reserve(size_t(std::min(BLOCKSIZE, fileSize - pos)));
+        }
+
+        m_off_t blockEnd = std::min(partial.pos + BLOCKSIZE, fileSize);
+        size_t take = size_t(std::min<m_off_t>(m_off_t(len), blockEnd - pos));
+        partial.data.append(reinterpret_cast<const char*>(data), take);
+        pos += m_off_t(take);
+        data += take;
+        len -= take;
+
+        if (pos == blockEnd)
+        {
+            mSize += partial.data.size();
+            mBlocks.emplace_front(BlockKey(h, ctriv, partial.pos / BLOCKSIZE), std::move(partial.data));
+            mIndex[mBlocks.front().first] = mBlocks.begin();
+            partial.pos = -1;
+            partial.data = string();
+            trim();
+        }
+    }
+}
+
+void StreamingCache::trim()
+{
+    while (mSize > mLimit && !mBlocks.empty())
+    {
+        mSize -= mBlocks.back().second.size();
+        mIndex.erase(mBlocks.back().first);
+        mBlocks.pop_back();
+    }
+}
+
+DirectRead::DirectRead(DirectReadNode* cdrn, m_off_t ccount, m_off_t coffset, int creqtag, void* cappdata, std::unique_ptr<DirectReadConsumer> cconsumer)
     : drbuf(this)
+    , consumer(std::move(cconsumer))
 {
     LOG_debug << "[DirectRead::DirectRead] New DirectRead [cappdata = " << cappdata << "]" << " [this = " << this << "]";
     drn = cdrn;
@@ -2255,6 +2368,31 @@ DirectRead::~DirectRead()
     }
 }
 
+bool DirectRead::deliver(byte* buffer, m_off_t len, m_off_t pos, m_off_t speed, m_off_t meanSpeed)
+{
+    if (consumer)
+    {
+        return consumer->data(buffer, len, pos);
+    }
+    return drn->client->app->pread_data(buffer, len, pos, speed, meanSpeed, appdata);
+}
+
+dstime DirectRead::failure(const Error& e, int retries, dstime timeLeft)
+{
+    if (!consumer)
+    {
+        return drn->client->app->pread_failure(e, retries, appdata, timeLeft);
+    }
+
+    dstime retryds = consumer->failure(e, retries, timeLeft);
+    if (retryds == NEVER)
+    {
+        // given up, the read goes as those of deleted app transfers do
+        appdata = nullptr;
+    }
+    return retryds;
+}
+
 std::string DirectReadSlot::adjustURLPort(std::string url)
 {
     if (!memcmp(url.c_str(), "http:", 5))
@@ -2489,19 +2627,54 @@ void TransferList::movetransfer(transfer_list::iterator it, transfer_list::itera
     if (prevpriority == newpriority)
     {
         LOG_warn << "There is no space for the move. Adjusting priorities.";
-        int positions = dstindex;
-        uint64_t fixedPriority = transfers[transfer->type][0]->priority - PRIORITY_STEP * (positions + 1);
-        for (int i = 0; i < positions; i++)
+
+        // Spread out only the transfers just before the destination, widening the range until
+        // it has room, so a move in a long queue rewrites (and persists) a few neighbours
+        // rather than everything ahead of it
+        int first = dstindex;
+        uint64_t spacing = 0;
+        for (int width = 1; width < dstindex; width *= 2)
+        {
+            first = dstindex - width;
+            uint64_t lowerBound = transfers[transfer->type][first - 1]->priority;
+            spacing = (nextpriority - lowerBound) / (width + 2);
+            if (spacing >= PRIORITY_STEP / 256)
+            {
+                break;
+            }
+            spacing = 0;
+        }
+
+        if (spacing)
+        {
+            uint64_t fixedPriority = transfers[transfer->type][first - 1]->priority + spacing;
+            for (int i = first; i < dstindex; i++)
+            {
+                Transfer *t = transfers[transfer->type][i];
+                t->priority = fixedPriority;
+                client->transfercacheadd(t, &committer);
+                client->app->transfer_update(t);
+                fixedPriority += spacing;
+            }
+            newpriority = fixedPriority;
+            LOG_debug << "Adjusted the priority of " << (dstindex - first) << " transfers. New: " << newpriority;
+        }
+        else
         {
-            Transfer *t = transfers[transfer->type][i];
-            LOG_debug << "Adjusting priority of transfer " << i << " to " << fixedPriority;
-            t->priority = fixedPriority;
-            client->transfercacheadd(t, &committer);
-            client->app->transfer_update(t);
-            fixedPriority += PRIORITY_STEP;
+            int positions = dstindex;
+            uint64_t fixedPriority = transfers[transfer->type][0]->priority - PRIORITY_STEP * (positions + 1);
+            for (int i = 0; i < positions; i++)
+            {
+                Transfer *t = transfers[transfer->type][i];
+                LOG_debug << "Adjusting priority of transfer " << i << " to " << fixedPriority;
+                t->priority = fixedPriority;
+                client->transfercacheadd(t, &committer);
+                client->app->transfer_update(t);
+                fixedPriority += PRIORITY_STEP;
+            }
+            newpriority = fixedPriority;
+            LOG_debug << "Fixed priority: " << fixedPriority;
         }
-        newpriority = fixedPriority;
-        LOG_debug << "Fixed priority: " << fixedPriority;
     }
 
     transfer->priority = newpriority;
@@ -2692,6 +2865,11 @@ std::array<vector<Transfer*>, 6> TransferList::nexttransfers(std::function<bool(
 
     for (direction_t direction : putget)
     {
+        // once continuefunction turns a size down, it won't take more of that size in this pass:
+        // stop asking, and stop traversing when both are full (rather than visiting every queued transfer)
+        bool continueLarge = true;
+        bool continueSmall = true;
+
         for (Transfer *transfer : transfers[direction])
         {
             if (!transfer->slot)
@@ -2708,9 +2886,6 @@ std::array<vector<Transfer*>, 6> TransferList::nexttransfers(std::function<bool(
             // don't traverse the whole list if we already have as many as we are going to get
             if (!directionContinuefunction(direction)) break;
 
-            bool continueLarge = true;
-            bool continueSmall = true;
-
             if ((!transfer->slot && isReady(transfer))
                 || (transfer->asyncopencontext
                     && transfer->asyncopencontext->finished))
@@ -2733,10 +2908,11 @@ std::array<vector<Transfer*>, 6> TransferList::nexttransfers(std::function<bool(
                         chosenTransfers[tc.index()].push_back(transfer);
                     }
                 }
-                if (!continueLarge && !continueSmall)
-                {
-                    break;
-                }
+            }
+
+            if (!continueLarge && !continueSmall)
+            {
+                break;
             }
         }
     }
@@ -31,6 +31,9 @@
 #include "mega/raid.h"
 #include "mega/testhooks.h"
 
+#undef MEGA_LOG_UNIT_MAX_LEVEL
+#define MEGA_LOG_UNIT_MAX_LEVEL MEGA_TRANSFER_LOG_MAX_LEVEL
+
 namespace mega {
 
 TransferSlotFileAccess::TransferSlotFileAccess(std::unique_ptr<FileAccess>&& p, Transfer* t)
@@ -101,6 +104,9 @@ const dstime TransferSlot::PROGRESSTIMEOUT = 10;
 const m_off_t TransferSlot::MAX_REQ_SIZE_NEW_RAID = 2 * 1024 * 1024; // 2 MB for each raidpart
 const m_off_t TransferSlot::UPPER_FILESIZE_LIMIT_FOR_SMALLER_CHUNKS = 25 * 1024 * 1024; // 25 MB
 const m_off_t TransferSlot::MIN_FILESIZE_FOR_MULTIPLE_CONNECTIONS = 131072 + 1; // 128 KB + 1 -> legacy value
+const m_off_t TransferSlot::MIN_FILESIZE_FOR_ADAPTIVE_CONNECTIONS = 64 * 1024 * 1024; // 64 MB
+const dstime TransferSlot::CONNECTION_PROBE_DS = 60;
+const dstime TransferSlot::HOST_HEALTH_CHECK_DS = 50;
 const m_off_t TransferSlot::MAX_GAP_SIZE = 256 * 1024 * 1024; // 256 MB
 
 TransferSlot::TransferSlot(Transfer* ctransfer)
@@ -177,6 +183,20 @@ bool TransferSlot::createconnectionsonce()
         }
 
         connections = transferbuf.isRaid() ? RAIDPARTS : transfer->size >= MIN_FILESIZE_FOR_MULTIPLE_CONNECTIONS ? transfer->client->connections[transfer->type] : 1;
+        mActiveConnections = connections;
+
+        MegaClient* client = transfer->client;
+        if (client->mAdaptiveConnections && !transferbuf.isRaid() && !transferbuf.isNewRaid()
+                && transfer->size >= MIN_FILESIZE_FOR_ADAPTIVE_CONNECTIONS)
+        {
+            // slow start from 2 connections, or from what the previous transfers converged on
+            mAdaptiveConnections = true;
+            connections = static_cast<int>(MegaClient::MAX_NUM_CONNECTIONS);
+            int learned = client->mLearnedConnections[transfer->type];
+            mActiveConnections = learned ? learned : std::min(2, connections);
+            mConnectionsSlowStart = !learned;
+            mConnectionsChanged = Waiter::ds;
+        }
 #ifdef MEGASDK_DEBUG_TEST_HOOKS_ENABLED
         if (transfer->size >= MIN_FILESIZE_FOR_MULTIPLE_CONNECTIONS && transferbuf.isNewRaid())
         {
@@ -196,6 +216,61 @@ bool TransferSlot::createconnectionsonce()
     return true;
 }
 
+void TransferSlot::adaptConnections()
+{
+    m_off_t speed = mTransferSpeed.getCircularMeanSpeed();
+    if (Waiter::ds - mConnectionsChanged < CONNECTION_PROBE_DS || speed <= 0)
+    {
+        return;
+    }
+    mConnectionsChanged = Waiter::ds;
+
+    int next = mActiveConnections;
+    if (mActiveConnections == mBestConnections)
+    {
+        // holding the best count: its throughput follows the path, so refresh it
+        bool dropped = speed < mBestConnectionsSpeed * 3 / 4;
+        mBestConnectionsSpeed = speed;
+        if (dropped && mActiveConnections > 1)
+        {
+            next = mActiveConnections - 1;
+        }
+        else if (++mConnectionProbesSkipped >= 3 && mActiveConnections < connections)
+        {
+            next = mActiveConnections + 1;
+        }
+    }
+    else if (!mBestConnections || speed > mBestConnectionsSpeed + mBestConnectionsSpeed / 10)
+    {
+        mBestConnections = mActiveConnections;
+        mBestConnectionsSpeed = speed;
+        if (mConnectionsSlowStart)
+        {
+            next = std::min(connections, mActiveConnections * 2);
+            mConnectionsSlowStart = next != mActiveConnections;
+        }
+    }
+    else
+    {
+        // the change didn't pay off
+        mConnectionsSlowStart = false;
+        next = mBestConnections;
+    }
+
+    if (!mConnectionsSlowStart)
+    {
+        transfer->client->mLearnedConnections[transfer->type] = mBestConnections;
+    }
+
+    if (next != mActiveConnections)
+    {
+        LOG_debug << "Adapting connections of " << transfer->localfilename << " from " << mActiveConnections << " to " << next
+                  << " (" << (speed / 1024) << " KB/s, best " << mBestConnections << " at " << (mBestConnectionsSpeed / 1024) << " KB/s)";
+        mActiveConnections = next;
+        mConnectionProbesSkipped = 0;
+    }
+}
+
 // delete slot and associated resources, but keep transfer intact (can be
 // reused on a new slot)
 TransferSlot::~TransferSlot()
@@ -263,7 +338,7 @@ TransferSlot::~TransferSlot()
                         std::mutex finalizedMutex;
                         std::unique_lock<std::mutex> guard(finalizedMutex);
                         auto outputPiece = transferbuf.getAsyncOutputBufferPointer(i);
-                        outputPiece->finalizedCV.wait(guard, [&](){ return outputPiece->finalized; });
+                        outputPiece->finalizedCV.wait(guard, [&](){ return outputPiece->finalized.load(); });
                         downloadRequest->status = REQ_DECRYPTED;
                         break;
                     }
@@ -319,6 +394,11 @@ TransferSlot::~TransferSlot()
         }
     }
 
+    if (transfer->mProgressUncached)
+    {
+        transfer->client->transfercacheadd(transfer, nullptr);
+    }
+
     // Manage transfer stats before setting the slot to NULL
     LOG_verbose << "[TransferSlot::~TransferSlot] Stats: FailedRequestRatio = "
                 << tsStats.failedRequestRatio()
@@ -327,6 +407,7 @@ TransferSlot::~TransferSlot()
                 << " [totalRequests = " << tsStats.mNumTotalRequests
                 << ", failedRequests = " << tsStats.mNumFailedRequests
                 << ", totalRequestsWithLatency = " << tsStats.mNumRequestsWithCalculatedLatency
+                << ", lastUploadRequestSize = " << tsStats.mUploadRequestSize
                 << "] [cloudRaid = " << (void*)(cloudRaid.get()) << "]";
     if (transfer->addTransferStats())
     {
@@ -351,6 +432,7 @@ TransferSlot::~TransferSlot()
 
         transfer->client->tslots.erase(slots_it);
         transfer->client->performanceStats.transferFinishes += 1;
+        transfer->client->mMetrics.transfersFinished.add();
     }
 
     if (pendingcmd)
@@ -563,7 +645,8 @@ bool TransferSlot::testForSlowRaidConnection(unsigned connectionNum, bool& incre
             {
                 LOG_warn << "Raid connection " << connectionNum
                          << " is much slower than its peers, with speed " << thisRate
-                         << " while they are managing " << averageOtherRate;
+                         << " while they are managing " << averageOtherRate
+                         << ", lagging by " << transferbuf.raidPartLag(connectionNum);
 
                 mRaidChannelSwapsForSlowness += 1;
                 incrementErrors = false;
@@ -578,6 +661,7 @@ bool TransferSlot::testForSlowRaidConnection(unsigned connectionNum, bool& incre
 void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
 {
     CodeCounter::ScopeTimer pbt(client->performanceStats.transferslotDoio);
+    MEGA_TRACE_SCOPE("transfer", "doio");
 
     if (!fa || (transfer->size && transfer->progresscompleted == transfer->size)
             || (transfer->type == PUT && transfer->ultoken))
@@ -616,6 +700,11 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
     }
 
     retrying = false;
+
+    if (transfer->mProgressUncached)
+    {
+        client->transfercacheprogress(transfer, committer);
+    }
     retrybt.reset();  // in case we don't delete the slot, and in case retrybt.next=1
     transfer->state = TRANSFERSTATE_ACTIVE;
 
@@ -681,6 +770,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                         if (tryRaidRecoveryFromHttpGetError(i, incrementErrors))
                         {
                             LOG_warn << "Connection " << i << " is slow or stalled, trying the other 5 cloudraid connections";
+                            client->httpio->hostStalled(reqs[i]->posturl);
                             reqs[i]->disconnect();
                             reqs[i]->status = REQ_READY;
                         }
@@ -866,7 +956,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
 
                         errorcount = 0;
                         transfer->failcount = 0;
-                        client->transfercacheadd(transfer, &committer);
+                        client->transfercacheprogress(transfer, committer);
                         reqs[i]->status = REQ_READY;
 
                         DEBUG_TEST_HOOK_UPLOADCHUNK_SUCCEEDED(transfer, committer);  // this will return if the hook returns false
@@ -918,13 +1008,21 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                                     auto filesize = transfer->size;
                                     req->status = REQ_DECRYPTING;
 
-                                    client->mAsyncQueue.push([req, i, outputPiece, transferkey, ctriv, filesize](SymmCipher& sc)
+                                    // large pieces are spread over the worker pool, whole chunks being independent of each other
+                                    unsigned parts = outputPiece->finalizeParts(client->mAsyncQueue.threadCount());
+                                    for (unsigned part = 0; part < parts; ++part)
                                     {
-                                        sc.setkey(transferkey.data());
-                                        outputPiece->finalize(true, filesize, ctriv, &sc, nullptr);
-                                        LOG_debug << "Conn " << i << " : REQ_DECRYPTED [parallel]";
-                                        req->status = REQ_DECRYPTED;
-                                    }, false);  // not discardable:  if we downloaded the data, don't waste it - decrypt and write as much as we can to file
+                                        client->mAsyncQueue.push([req, i, outputPiece, transferkey, ctriv, filesize, part, parts](SymmCipher& sc)
+                                        {
+                                            sc.setkey(transferkey.data());
+                                            outputPiece->finalize(true, filesize, ctriv, &sc, nullptr, part, parts);
+                                            if (outputPiece->finalized)
+                                            {
+                                                LOG_debug << "Conn " << i << " : REQ_DECRYPTED [parallel, " << parts << " parts]";
+                                                req->status = REQ_DECRYPTED;
+                                            }
+                                        }, false);  // not discardable:  if we downloaded the data, don't waste it - decrypt and write as much as we can to file
+                                    }
                                 }
                                 else
                                 {
@@ -1031,7 +1129,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                                 return;
                             }
 
-                            client->transfercacheadd(transfer, &committer);
+                            client->transfercacheprogress(transfer, committer);
                             reqs[i]->status = REQ_READY;
                         }
                     }
@@ -1064,12 +1162,20 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                                 req->pos = pos;
                                 req->status = REQ_ENCRYPTING;
 
-                                client->mAsyncQueue.push([req, transferkey, ctriv, finaltempurl, pos, npos](SymmCipher& sc)
-                                    {
-                                        sc.setkey(transferkey.data());
-                                        req->prepare(finaltempurl.c_str(), &sc, ctriv, pos, npos);
-                                        req->status = REQ_PREPARED;
-                                    }, true);   // discardable - if the transfer or client are being destroyed, we won't be sending that data.
+                                // large chunks are spread over the worker pool, so one upload isn't held to one core
+                                auto ulreq = static_cast<HttpReqUL*>(req.get());
+                                unsigned parts = ulreq->prepareParts(pos, npos, client->mAsyncQueue.threadCount());
+                                for (unsigned part = 0; part < parts; ++part)
+                                {
+                                    client->mAsyncQueue.push([req, ulreq, transferkey, ctriv, finaltempurl, pos, npos, part, parts](SymmCipher& sc)
+                                        {
+                                            sc.setkey(transferkey.data());
+                                            if (ulreq->preparePart(finaltempurl.c_str(), &sc, ctriv, pos, npos, part, parts))
+                                            {
+                                                req->status = REQ_PREPARED;
+                                            }
+                                        }, true);   // discardable - if the transfer or client are being destroyed, we won't be sending that data.
+                                }
                             }
                             else
                             {
@@ -1085,7 +1191,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                                     return;
                                 }
 
-                                client->transfercacheadd(transfer, &committer);
+                                client->transfercacheprogress(transfer, committer);
                                 reqs[i]->status = REQ_READY;
 
                                 if (client->orderdownloadedchunks && !transferbuf.isRaid())
@@ -1150,11 +1256,12 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
 
         if (!failure)
         {
-            if (!reqs[i] || (reqs[i]->status == REQ_READY))
+            // connections beyond the active ones finish their request and stay idle
+            if ((!reqs[i] || (reqs[i]->status == REQ_READY)) && i < mActiveConnections)
             {
                 bool newInputBufferSupplied = false;
                 bool pauseConnectionInputForRaid = false;
-                std::pair<m_off_t, m_off_t> posrange = transferbuf.nextNPosForConnection(i, maxRequestSize, connections, newInputBufferSupplied, pauseConnectionInputForRaid, client->httpio->uploadSpeed);
+                std::pair<m_off_t, m_off_t> posrange = transferbuf.nextNPosForConnection(i, maxRequestSize, static_cast<unsigned>(mActiveConnections), newInputBufferSupplied, pauseConnectionInputForRaid, client->httpio->uploadSpeed);
 
                 // we might have a raid-reassembled block to write, or a previously loaded block, or a skip block to process.
                 bool newOutputBufferSupplied = false;
@@ -1173,6 +1280,12 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                     LOG_verbose << "Conn " << i << " : process supplied block, or just wait until other connections catch up a bit";
                     // process supplied block, or just wait until other connections catch up a bit
                 }
+                else if (transfer->type == GET && client->mDownloadMemoryBudget
+                         && !(transferbuf.isRaid() && transferbuf.raidPartLag(i) > 0)   // the parts behind free the others' data
+                         && client->downloadPipelineStats().bytes() >= client->mDownloadMemoryBudget)
+                {
+                    LOG_verbose << "Conn " << i << " : download memory budget used up, waiting for decryption and writes";
+                }
                 else if (posrange.second > posrange.first || !transfer->size || (transfer->type == PUT && asyncIO[i]))
                 {
                     LOG_verbose << "Conn " << i << " : download/upload specified range";
@@ -1183,6 +1296,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                         reqs[i].reset(transfer->type == PUT ? (HttpReqXfer*)new HttpReqUL() : (HttpReqXfer*)new HttpReqDL());
                         reqs[i]->logname = client->clientname + (transfer->type == PUT ? "U" : "D") + std::to_string(++client->transferHttpCounter) + " ";
                     }
+                    reqs[i]->mBandwidthClass = transfer->bandwidthClass();
 
                     bool prepare = true;
                     if (transfer->type == PUT)
@@ -1374,6 +1488,10 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
             m_off_t naturalDiff = std::max<m_off_t>(diff, 0);
             speed = mTransferSpeed.calculateSpeed(naturalDiff);
             meanSpeed = mTransferSpeed.getMeanSpeed();
+            if (mAdaptiveConnections)
+            {
+                adaptConnections();
+            }
             if ((Waiter::ds % 50 == 0) || (diff < 0) || (p > transfer->size)) // every 5s
             {
                 if (transferbuf.isRaid() || transferbuf.isNewRaid())
@@ -1404,6 +1522,20 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
         progress();
     }
 
+    // a non-raid download has no other server to fall back on: if other transfers found that
+    // its server is degraded, ask for the URL again (once) instead of waiting for the timeout
+    if (!failure && transfer->type == GET && !transferbuf.isRaid() && !transferbuf.isNewRaid()
+            && !transfer->mRenewedUrlForDegradedHost && Waiter::ds - mLastHostHealthCheck >= HOST_HEALTH_CHECK_DS)
+    {
+        mLastHostHealthCheck = Waiter::ds;
+        if (client->httpio->isHostDegraded(transferbuf.tempURL(0)))
+        {
+            LOG_warn << "The storage server of the download is degraded, requesting a new URL";
+            transfer->mRenewedUrlForDegradedHost = true;
+            return transfer->failed(API_EAGAIN, committer);  // either the (this) slot has been deleted, or the whole transfer including slot has been deleted
+        }
+    }
+
     assert(lastdata != NEVER);
     if (Waiter::ds - lastdata >= XFERTIMEOUT && !failure)
     {
@@ -1431,6 +1563,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
             {
                 chunkfailed = true;
                 client->setchunkfailed(&reqs[i]->posturl);
+                client->httpio->hostStalled(reqs[i]->posturl);
                 reqs[i]->disconnect();
 
                 if (changeport)
@@ -1452,6 +1585,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
             LOG_warn << "Chunk failed due to a timeout";
             client->app->transfer_failed(transfer, API_EFAILED);
             ++client->performanceStats.transferTempErrors;
+            client->mMetrics.transferTemporaryErrors.add();
         }
     }
 
@@ -1489,6 +1623,46 @@ bool TransferSlot::tryRaidRecoveryFromHttpGetError(unsigned connectionNum, bool
 }
 
 
+void TransferSlot::addDownloadPipelineStats(stats::DownloadPipelineStats& stats) const
+{
+    m_off_t input = transferbuf.bufferedInputBytes();
+    if (input)
+    {
+        stats.receive.pieces++;
+        stats.receive.bytes += input;
+    }
+
+    for (unsigned i = 0; i < reqs.size(); i++)
+    {
+        if (!reqs[i])
+        {
+            continue;
+        }
+
+        switch (reqs[i]->status)
+        {
+            case REQ_INFLIGHT:
+                stats.receive.pieces++;
+                stats.receive.bytes += reqs[i]->size;
+                break;
+
+            case REQ_DECRYPTING:
+                stats.decrypt.pieces++;
+                stats.decrypt.bytes += transferbuf.outputPieceBytes(i);
+                break;
+
+            case REQ_DECRYPTED:
+            case REQ_ASYNCIO:
+                stats.write.pieces++;
+                stats.write.bytes += transferbuf.outputPieceBytes(i);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
 // transfer progress notification to app and related files
 void TransferSlot::progress()
 {
@@ -1642,6 +1816,7 @@ std::pair<error, dstime> TransferSlot::processRequestFailure(MegaClient* client,
             client->app->transfer_failed(transfer, API_EFAILED);
             client->setchunkfailed(&httpReq->posturl);
             ++client->performanceStats.transferTempErrors;
+            client->mMetrics.transferTemporaryErrors.add();
 
             if (changeport)
             {
@@ -24,6 +24,14 @@
 #include "mega/logging.h"
 
 namespace mega {
+void TreeProc::procBatch(MegaClient* client, sharedNode_vector& nodes)
+{
+    for (auto& n : nodes)
+    {
+        proc(client, n);
+    }
+}
+
 // create share keys
 TreeProcShareKeys::TreeProcShareKeys(std::shared_ptr<Node> n, bool includeParentChain)
     : sn(n)
@@ -36,6 +44,11 @@ void TreeProcShareKeys::proc(MegaClient*, std::shared_ptr<Node> n)
     snk.add(n, sn, includeParentChain);
 }
 
+void TreeProcShareKeys::procBatch(MegaClient* client, sharedNode_vector& nodes)
+{
+    snk.add(nodes, sn, includeParentChain, client->mAsyncQueue);
+}
+
 void TreeProcShareKeys::get(Command* c)
 {
     snk.get(c);
@@ -82,6 +95,24 @@ void TreeProcApplyKey::proc(MegaClient *client, std::shared_ptr<Node> n)
     }
 }
 
+void TreeProcApplyKey::procBatch(MegaClient* client, sharedNode_vector& nodes)
+{
+    nodes.erase(std::remove_if(nodes.begin(), nodes.end(),
+                               [](const std::shared_ptr<Node>& n) { return !n->attrstring; }),
+                nodes.end());
+
+    client->mNodeManager.applyKeys(nodes);
+
+    for (auto& n : nodes)
+    {
+        if (!n->attrstring)
+        {
+            n->changed.attrs = true;
+            client->mNodeManager.notifyNode(n);
+        }
+    }
+}
+
 void TreeProcCopy::allocnodes()
 {
     nn.resize(nc);
@@ -0,0 +1,278 @@
+/**
+ * @file treestateindex.cpp
+ * @brief The sync state of each local path, for the shell's overlay icons
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/treestateindex.h"
+
+#include <algorithm>
+#include <bitset>
+
+namespace mega {
+
+static constexpr unsigned BITS_PER_LEVEL = 5;
+static constexpr uint64_t LEVEL_MASK = (1u << BITS_PER_LEVEL) - 1;
+
+// A branch has a child for each bit set in its bitmap, in the order of the bits. A leaf has the
+// entries whose hash is its own: more than one only if their whole hashes collide.
+struct TreestateIndex::Node
+{
+    uint32_t bitmap = 0;
+    std::vector<NodePtr> children;
+
+    uint64_t hash = 0;
+    std::vector<Entry> entries;
+
+    bool isLeaf() const { return !bitmap; }
+
+    size_t position(uint32_t bit) const
+    {
+        return std::bitset<32>(bitmap & (bit - 1)).count();
+    }
+};
+
+TreestateIndex::TreestateIndex() = default;
+TreestateIndex::~TreestateIndex() = default;
+
+uint64_t TreestateIndex::hashOf(const LocalPath& path)
+{
+    // the standard hash may be 32 bits wide, or weak in its high bits: mix it over the 64
+    uint64_t h = std::hash<std::decay_t<decltype(path.rawValue())>>()(path.rawValue());
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+bool TreestateIndex::lookup(const LocalPath& path, treestate_t& ts, nodetype_t& type) const
+{
+    uint64_t hash = hashOf(path);
+
+    NodePtr held = root();
+    const Node* node = held.get();
+    for (unsigned shift = 0; node && !node->isLeaf(); shift += BITS_PER_LEVEL)
+    {
+        uint32_t bit = 1u << ((hash >> shift) & LEVEL_MASK);
+        node = node->bitmap & bit ? node->children[node->position(bit)].get() : nullptr;
+    }
+
+    if (!node || node->hash != hash)
+    {
+        return false;
+    }
+
+    for (auto& e : node->entries)
+    {
+        if (e.path == path)
+        {
+            ts = e.ts;
+            type = e.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+TreestateIndex::NodePtr TreestateIndex::inserted(const NodePtr& node, uint64_t hash, unsigned shift, const Entry& entry, bool& added)
+{
+    if (!node)
+    {
+        auto leaf = std::make_shared<Node>();
+        leaf->hash = hash;
+        leaf->entries.push_back(entry);
+        added = true;
+        return leaf;
+    }
+
+    if (node->isLeaf())
+    {
+        if (node->hash == hash)
+        {
+            auto leaf = std::make_shared<Node>(*node);
+            auto it = std::find_if(leaf->entries.begin(), leaf->entries.end(), [&](const Entry& e) { return e.path == entry.path; });
+            if (it != leaf->entries.end())
+            {
+                *it = entry;
+            }
+            else
+            {
+                leaf->entries.push_back(entry);
+                added = true;
+            }
+            return leaf;
+        }
+
+        // two hashes at this level now: a branch takes the leaf, and then the entry
+        auto branch = std::make_shared<Node>();
+        branch->bitmap = 1u << ((node->hash >> shift) & LEVEL_MASK);
+        branch->children.push_back(node);
+        return inserted(branch, hash, shift, entry, added);
+    }
+
+    uint32_t bit = 1u << ((hash >> shift) & LEVEL_MASK);
+    size_t pos = node->position(bit);
+
+    auto branch = std::make_shared<Node>(*node);
+    if (node->bitmap & bit)
+    {
+        branch->children[pos] = inserted(node->children[pos], hash, shift + BITS_PER_LEVEL, entry, added);
+    }
+    else
+    {
+        branch->bitmap |= bit;
+        branch->children.insert(branch->children.begin() + static_cast<ptrdiff_t>(pos), inserted(nullptr, hash, shift + BITS_PER_LEVEL, entry, added));
+    }
+    return branch;
+}
+
+TreestateIndex::NodePtr TreestateIndex::erased(const NodePtr& node, uint64_t hash, unsigned shift, const LocalPath& path)
+{
+    if (!node)
+    {
+        return node;
+    }
+
+    if (node->isLeaf())
+    {
+        if (node->hash != hash)
+        {
+            return node;
+        }
+
+        auto it = std::find_if(node->entries.begin(), node->entries.end(), [&](const Entry& e) { return e.path == path; });
+        if (it == node->entries.end())
+        {
+            return node;
+        }
+        if (node->entries.size() == 1)
+        {
+            return nullptr;
+        }
+
+        auto leaf = std::make_shared<Node>(*node);
+        leaf->entries.erase(leaf->entries.begin() + (it - node->entries.begin()));
+        return leaf;
+    }
+
+    uint32_t bit = 1u << ((hash >> shift) & LEVEL_MASK);
+    if (!(node->bitmap & bit))
+    {
+        return node;
+    }
+
+    size_t pos = node->position(bit);
+    NodePtr child = erased(node->children[pos], hash, shift + BITS_PER_LEVEL, path);
+    if (child == node->children[pos])
+    {
+        return node;
+    }
+
+    // a branch left with a single leaf is that leaf: lookups stop as soon as they reach one
+    if (node->children.size() == 1 && (!child || child->isLeaf()))
+    {
+        return child;
+    }
+    if (!child && node->children.size() == 2 && node->children[1 - pos]->isLeaf())
+    {
+        return node->children[1 - pos];
+    }
+
+    auto branch = std::make_shared<Node>(*node);
+    if (child)
+    {
+        branch->children[pos] = std::move(child);
+    }
+    else
+    {
+        branch->bitmap &= ~bit;
+        branch->children.erase(branch->children.begin() + static_cast<ptrdiff_t>(pos));
+    }
+    return branch;
+}
+
+void TreestateIndex::visit(const NodePtr& node, const std::function<void(const Entry&)>& visitor)
+{
+    if (!node)
+    {
+        return;
+    }
+
+    for (auto& e : node->entries)
+    {
+        visitor(e);
+    }
+    for (auto& c : node->children)
+    {
+        visit(c, visitor);
+    }
+}
+
+void TreestateIndex::set(const LocalPath& path, treestate_t ts, nodetype_t type)
+{
+    if (ts == TREESTATE_NONE)
+    {
+        erase(path);
+        return;
+    }
+
+    bool added = false;
+    publish(inserted(root(), hashOf(path), 0, Entry{path, ts, type}, added));
+    if (added)
+    {
+        mSize.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void TreestateIndex::erase(const LocalPath& path)
+{
+    NodePtr before = root();
+    NodePtr after = erased(before, hashOf(path), 0, path);
+    if (after != before)
+    {
+        publish(std::move(after));
+        mSize.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void TreestateIndex::eraseBelow(const LocalPath& root)
+{
+    std::vector<LocalPath> below;
+    visit(this->root(), [&](const Entry& e)
+    {
+        if (root.isContainingPathOf(e.path))
+        {
+            below.push_back(e.path);
+        }
+    });
+
+    for (auto& path : below)
+    {
+        erase(path);
+    }
+}
+
+void TreestateIndex::clear()
+{
+    publish(nullptr);
+    mSize.store(0, std::memory_order_relaxed);
+}
+
+} // namespace
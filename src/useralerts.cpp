@@ -23,6 +23,7 @@
 #include "mega/megaclient.h"
 #include "mega/useralerts.h"
 
+#include <unordered_set>
 #include <utility>
 
 using std::to_string;
@@ -1981,10 +1982,45 @@ void UserAlerts::add(UserAlertRaw& un)
 
 UserAlert::Base* UserAlerts::findAlertToCombineWith(const UserAlert::Base* a, nameid t) const
 {
-    if (a->type == t)
+    if (a->type != t)
     {
-        auto ait = std::find_if(alerts.rbegin(), alerts.rend(), [](UserAlert::Base* b) { return !b->removed(); });
-        return ait != alerts.rend() && (*ait)->type == t ? *ait : nullptr;
+        return nullptr;
+    }
+
+    // Not only the latest alert: when several users work in the shares at once their alerts
+    // interleave, and each of them would take one of the (at most 200) alerts kept
+    for (auto ait = alerts.rbegin(); ait != alerts.rend(); ++ait)
+    {
+        UserAlert::Base* b = *ait;
+        if (b->removed())
+        {
+            continue;
+        }
+        if (a->ts() - b->ts() >= 300)
+        {
+            // the rest are too old to be combined
+            break;
+        }
+        if (b->user() != a->user())
+        {
+            continue;
+        }
+        if (b->type != t)
+        {
+            // keep the order of the actions of the same user
+            break;
+        }
+        if (t == name_id::put)
+        {
+            // new nodes are combined per folder
+            auto np = dynamic_cast<const UserAlert::NewSharedNodes*>(a);
+            auto op = dynamic_cast<const UserAlert::NewSharedNodes*>(b);
+            if (!np || !op || np->parentHandle != op->parentHandle)
+            {
+                continue;
+            }
+        }
+        return b;
     }
 
     return nullptr;
@@ -2870,17 +2906,15 @@ void UserAlerts::purgescalerts() // called from MegaClient::notifypurge()
     LOG_debug << "Notifying " << useralertnotify.size() << " user alerts";
     mc.app->useralerts_updated(&useralertnotify[0], (int)useralertnotify.size());
 
+    // the removed ones leave `alerts` in a single pass, rather than one search per alert
+    std::unordered_set<UserAlert::Base*> removedAlerts;
     for (auto a : useralertnotify)
     {
         mc.persistAlert(a); // persist to db (add/update/remove)
 
         if (a->removed())
         {
-            auto it = find(alerts.begin(), alerts.end(), a);
-            assert(it != alerts.end());
-            alerts.erase(it);
-
-            delete a;
+            removedAlerts.insert(a);
         }
         else
         {
@@ -2888,6 +2922,18 @@ void UserAlerts::purgescalerts() // called from MegaClient::notifypurge()
         }
     }
 
+    if (!removedAlerts.empty())
+    {
+        auto newEnd = std::remove_if(alerts.begin(), alerts.end(), [&removedAlerts](UserAlert::Base* a) { return removedAlerts.count(a) > 0; });
+        assert(static_cast<size_t>(alerts.end() - newEnd) == removedAlerts.size());
+        alerts.erase(newEnd, alerts.end());
+
+        for (auto a : removedAlerts)
+        {
+            delete a;
+        }
+    }
+
     useralertnotify.clear();
 }
 
@@ -26,6 +26,7 @@
 #include "mega/logging.h"
 #include "mega/mega_utf8proc.h"
 #include "mega/megaclient.h"
+#include "mega/metrics.h"
 #include "mega/serialize64.h"
 
 #include <cctype>
@@ -411,11 +412,47 @@ bool CacheableReader::unserializebinary(byte* data, size_t len)
 }
 
 
+auto chunkmac_map::find(m_off_t pos) -> vector<MacEntry>::iterator
+{
+    if (!mMacs.empty())
+    {
+        auto slot = static_cast<size_t>(ChunkedHash::chunkindex(pos) - ChunkedHash::chunkindex(mMacs.front().first));
+        if (slot < mMacs.size() && mMacs[slot].first == pos)
+        {
+            return mMacs.begin() + static_cast<ptrdiff_t>(slot);
+        }
+    }
+
+    auto it = std::lower_bound(mMacs.begin(), mMacs.end(), pos,
+                               [](const MacEntry& e, m_off_t p) { return e.first < p; });
+    return it != mMacs.end() && it->first == pos ? it : mMacs.end();
+}
+
+chunkmac_map::ChunkMAC& chunkmac_map::entry(m_off_t pos)
+{
+    // chunks mostly arrive in order, so this is usually an append
+    if (mMacs.empty() || mMacs.back().first < pos)
+    {
+        mMacs.emplace_back(pos, ChunkMAC());
+        return mMacs.back().second;
+    }
+
+    auto it = find(pos);
+    if (it == mMacs.end())
+    {
+        it = std::lower_bound(mMacs.begin(), mMacs.end(), pos,
+                              [](const MacEntry& e, m_off_t p) { return e.first < p; });
+        it = mMacs.emplace(it, pos, ChunkMAC());
+    }
+    return it->second;
+}
+
 void chunkmac_map::serialize(string& d) const
 {
     unsigned short ll = (unsigned short)size();
+    d.reserve(d.size() + sizeof(ll) + ll * (sizeof(m_off_t) + sizeof(ChunkMAC)));
     d.append((char*)&ll, sizeof(ll));
-    for (auto& it : mMacMap)
+    for (auto& it : mMacs)
     {
         d.append((char*)&it.first, sizeof(it.first));
         d.append((char*)&it.second, sizeof(it.second));
@@ -431,16 +468,18 @@ bool chunkmac_map::unserialize(const char*& ptr, const char* end)
     }
 
     ptr += sizeof(ll);
+    mMacs.reserve(mMacs.size() + ll);
 
     for (int i = 0; i < ll; i++)
     {
         m_off_t pos = MemAccess::get<m_off_t>(ptr);
         ptr += sizeof(m_off_t);
 
-        memcpy(&(mMacMap[pos]), ptr, sizeof(ChunkMAC));
+        ChunkMAC& chunk = entry(pos);
+        memcpy(&chunk, ptr, sizeof(ChunkMAC));
         ptr += sizeof(ChunkMAC);
 
-        if (mMacMap[pos].isMacsmacSoFar())
+        if (chunk.isMacsmacSoFar())
         {
             macsmacSoFarPos = pos;
             assert(i == 0);
@@ -458,7 +497,7 @@ void chunkmac_map::calcprogress(m_off_t size, m_off_t& chunkpos, m_off_t& progre
     chunkpos = 0;
     progresscompleted = 0;
 
-    for (auto& it : mMacMap)
+    for (auto& it : mMacs)
     {
         m_off_t chunkceil = ChunkedHash::chunkceil(it.first, size);
 
@@ -497,9 +536,9 @@ m_off_t chunkmac_map::nextUnprocessedPosFrom(m_off_t pos)
 {
     assert(pos > macsmacSoFarPos);
 
-    for (auto it = mMacMap.find(ChunkedHash::chunkfloor(pos));
-        it != mMacMap.end();
-        it = mMacMap.find(ChunkedHash::chunkfloor(pos)))
+    for (auto it = find(ChunkedHash::chunkfloor(pos));
+        it != mMacs.end();
+        it = find(ChunkedHash::chunkfloor(pos)))
     {
         if (it->second.finished)
         {
@@ -518,11 +557,11 @@ m_off_t chunkmac_map::expandUnprocessedPiece(m_off_t pos, m_off_t npos, m_off_t
 {
     assert(pos > macsmacSoFarPos);
 
-    for (auto it = mMacMap.find(npos);
+    for (auto it = find(npos);
         npos < fileSize &&
         (npos - pos) < maxReqSize &&
-        (it == mMacMap.end() || it->second.notStarted());
-        it = mMacMap.find(npos))
+        (it == mMacs.end() || it->second.notStarted());
+        it = find(npos))
     {
         npos = ChunkedHash::chunkceil(npos, fileSize);
     }
@@ -533,8 +572,8 @@ m_off_t chunkmac_map::hasUnfinishedGap(m_off_t fileSize)
 {
     bool sawUnfinished = false;
 
-    for (auto it = mMacMap.begin();
-        it != mMacMap.end(); )
+    for (auto it = mMacs.begin();
+        it != mMacs.end(); )
     {
         if (!it->second.finished)
         {
@@ -542,9 +581,9 @@ m_off_t chunkmac_map::hasUnfinishedGap(m_off_t fileSize)
         }
 
         auto nextpos = ChunkedHash::chunkceil(it->first, fileSize);
-        auto expected_it = mMacMap.find(nextpos);
+        auto expected_it = find(nextpos);
 
-        if (sawUnfinished && expected_it != mMacMap.end() && expected_it->second.finished)
+        if (sawUnfinished && expected_it != mMacs.end() && expected_it->second.finished)
         {
             return true;
         }
@@ -565,7 +604,7 @@ void chunkmac_map::ctr_encrypt(m_off_t chunkid, SymmCipher *cipher, byte *chunks
     assert(startpos > macsmacSoFarPos);
 
     // encrypt is always done on whole chunks
-    auto& chunk = mMacMap[chunkid];
+    auto& chunk = entry(chunkid);
     cipher->ctr_crypt(chunkstart, unsigned(chunksize), startpos, ctriv, chunk.mac, true, true);
     chunk.offset = 0;
     chunk.finished = finishesChunk;  // when encrypting for uploads, only set finished after confirmation of the chunk uploading.
@@ -577,7 +616,7 @@ void chunkmac_map::ctr_decrypt(m_off_t chunkid, SymmCipher *cipher, byte *chunks
     assert(chunkid > macsmacSoFarPos);
     assert(startpos >= chunkid);
     assert(startpos + chunksize <= ChunkedHash::chunkceil(chunkid));
-    ChunkMAC& chunk = mMacMap[chunkid];
+    ChunkMAC& chunk = entry(chunkid);
 
     cipher->ctr_crypt(chunkstart, chunksize, startpos, ctriv, chunk.mac, false, chunk.notStarted());
 
@@ -596,13 +635,13 @@ void chunkmac_map::ctr_decrypt(m_off_t chunkid, SymmCipher *cipher, byte *chunks
 
 void chunkmac_map::finishedUploadChunks(chunkmac_map& macs)
 {
-    for (auto& m : macs.mMacMap)
+    for (auto& m : macs.mMacs)
     {
         assert(m.first > macsmacSoFarPos);
-        assert(mMacMap.find(m.first) == mMacMap.end() || !mMacMap[m.first].isMacsmacSoFar());
+        assert(find(m.first) == mMacs.end() || !find(m.first)->second.isMacsmacSoFar());
 
         m.second.finished = true;
-        mMacMap[m.first] = m.second;
+        entry(m.first) = m.second;
         LOG_verbose << "Upload chunk completed: " << m.first;
     }
 }
@@ -611,8 +650,8 @@ bool chunkmac_map::finishedAt(m_off_t pos)
 {
     assert(pos > macsmacSoFarPos);
 
-    auto pcit = mMacMap.find(pos);
-    return pcit != mMacMap.end()
+    auto pcit = find(pos);
+    return pcit != mMacs.end()
         && pcit->second.finished;
 }
 
@@ -630,12 +669,13 @@ m_off_t chunkmac_map::updateContiguousProgress(m_off_t fileSize)
 void chunkmac_map::updateMacsmacProgress(SymmCipher *cipher)
 {
     bool updated = false;
+    size_t collapsed = 0;   // leading entries already folded into the next one, erased together at the end
     while (macsmacSoFarPos + 1024 * 1024 * 5 < progresscontiguous  // never go past contiguous-from-start section
-           && size() > 32 * 3 + 5)   // leave enough room for the mac-with-late-gaps corrective calculation to occur
+           && size() - collapsed > 32 * 3 + 5)   // leave enough room for the mac-with-late-gaps corrective calculation to occur
     {
-        if (mMacMap.begin()->second.isMacsmacSoFar())
+        if (mMacs[collapsed].second.isMacsmacSoFar())
         {
-            auto it = mMacMap.begin();
+            auto it = mMacs.begin() + static_cast<ptrdiff_t>(collapsed);
             auto& calcSoFar = it->second;
             auto& next = (++it)->second;
 
@@ -647,11 +687,11 @@ void chunkmac_map::updateMacsmacProgress(SymmCipher *cipher)
             macsmacSoFarPos = it->first;
             next.offset = unsigned(-1);
             assert(next.isMacsmacSoFar());
-            mMacMap.erase(mMacMap.begin());
+            ++collapsed;
         }
-        else if (mMacMap.begin()->first == 0 && finishedAt(0))
+        else if (mMacs[collapsed].first == 0 && finishedAt(0))
         {
-            auto& first = mMacMap.begin()->second;
+            auto& first = mMacs[collapsed].second;
 
             byte mac[SymmCipher::BLOCKSIZE] = { 0 };
             SymmCipher::xorblock(first.mac, mac);
@@ -665,30 +705,39 @@ void chunkmac_map::updateMacsmacProgress(SymmCipher *cipher)
         updated = true;
     }
 
+    mMacs.erase(mMacs.begin(), mMacs.begin() + static_cast<ptrdiff_t>(collapsed));
+
     if (updated)
     {
-        LOG_verbose << "Macsmac calculation advanced to " << mMacMap.begin()->first;
+        LOG_verbose << "Macsmac calculation advanced to " << mMacs.begin()->first;
     }
 }
 
 void chunkmac_map::copyEntriesTo(chunkmac_map& other)
 {
-    for (auto& e : mMacMap)
+    for (auto& e : mMacs)
     {
         assert(e.first > macsmacSoFarPos);
-        other.mMacMap[e.first] = e.second;
+        other.entry(e.first) = e.second;
     }
 }
 
+void chunkmac_map::addEntry(m_off_t pos)
+{
+    assert(pos > macsmacSoFarPos);
+    entry(pos);
+}
+
 void chunkmac_map::copyEntryTo(m_off_t pos, chunkmac_map& other)
 {
     assert(pos > macsmacSoFarPos);
-    mMacMap[pos] = other.mMacMap[pos];
+    ChunkMAC& source = other.entry(pos);
+    entry(pos) = source;
 }
 
 void chunkmac_map::debugLogOuputMacs()
 {
-    for (auto& it : mMacMap)
+    for (auto& it : mMacs)
     {
         LOG_debug << "macs: " << it.first << " " << Base64Str<SymmCipher::BLOCKSIZE>(it.second.mac) << " " << it.second.finished;
     }
@@ -699,11 +748,11 @@ int64_t chunkmac_map::macsmac(SymmCipher *cipher)
 {
     byte mac[SymmCipher::BLOCKSIZE] = { 0 };
 
-    for (auto& it : mMacMap)
+    for (auto& it : mMacs)
     {
         if (it.second.isMacsmacSoFar())
         {
-            assert(it.first == mMacMap.begin()->first);
+            assert(it.first == mMacs.begin()->first);
             memcpy(mac, it.second.mac, sizeof(mac));
         }
         else
@@ -727,7 +776,7 @@ int64_t chunkmac_map::macsmac_gaps(SymmCipher *cipher, size_t g1, size_t g2, siz
     byte mac[SymmCipher::BLOCKSIZE] = { 0 };
 
     size_t n = 0;
-    for (auto it = mMacMap.begin(); it != mMacMap.end(); it++, n++)
+    for (auto it = mMacs.begin(); it != mMacs.end(); it++, n++)
     {
         if (it->second.isMacsmacSoFar())
         {
@@ -1109,6 +1158,23 @@ m_off_t ChunkedHash::chunkfloor(m_off_t p)
     return ((p - cp) & - (8 * SEGSIZE)) + cp;
 }
 
+m_off_t ChunkedHash::chunkindex(m_off_t p)
+{
+    m_off_t cp = 0;
+
+    for (unsigned i = 1; i <= 8; i++)
+    {
+        cp += i * SEGSIZE;
+
+        if (p < cp)
+        {
+            return i - 1;
+        }
+    }
+
+    return 8 + (p - cp) / (8 * SEGSIZE);
+}
+
 // end of chunk (== start of next chunk)
 m_off_t ChunkedHash::chunkceil(m_off_t p, m_off_t limit)
 {
@@ -1308,15 +1374,69 @@ size_t Utils::utf8SequenceSize(unsigned char c)
     }
 }
 
+bool Utils::isAscii(const char* data, size_t size)
+{
+    static constexpr uint64_t HIGH_BITS = 0x8080808080808080ull;
+
+    // four words per iteration, so the compiler can keep them in a vector register
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        uint64_t w[4];
+        memcpy(w, data + i, sizeof(w));
+        if ((w[0] | w[1] | w[2] | w[3]) & HIGH_BITS)
+        {
+            return false;
+        }
+    }
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, data + i, sizeof(w));
+        if (w & HIGH_BITS)
+        {
+            return false;
+        }
+    }
+    for (; i < size; ++i)
+    {
+        if (static_cast<unsigned char>(data[i]) & 0x80)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 string  Utils::toUpperUtf8(const string& text)
 {
+    if (isAscii(text))
+    {
+        string result(text);
+        for (auto& ch : result)
+        {
+            if (ch >= 'a' && ch <= 'z') ch = static_cast<char>(ch - 'a' + 'A');
+        }
+        return result;
+    }
+
     string result;
+    result.reserve(text.size());
 
     auto n = utf8proc_ssize_t(text.size());
     auto d = text.data();
 
     for (;;)
     {
+        // most names are ASCII, which needs neither decoding nor the tables
+        if (n && static_cast<unsigned char>(*d) < 0x80)
+        {
+            char ch = *d++;
+            --n;
+            result.push_back(ch >= 'a' && ch <= 'z' ? static_cast<char>(ch - 'a' + 'A') : ch);
+            continue;
+        }
+
         utf8proc_int32_t c;
         auto nn = utf8proc_iterate((utf8proc_uint8_t *)d, n, &c);
 
@@ -1338,6 +1458,16 @@ string  Utils::toUpperUtf8(const string& text)
 
 string  Utils::toLowerUtf8(const string& text)
 {
+    if (isAscii(text))
+    {
+        string result(text);
+        for (auto& ch : result)
+        {
+            if (ch >= 'A' && ch <= 'Z') ch = static_cast<char>(ch - 'A' + 'a');
+        }
+        return result;
+    }
+
     string result;
 
     auto n = utf8proc_ssize_t(text.size());
@@ -1727,11 +1857,14 @@ m_time_t m_mktime(struct tm* stm)
 
 dstime m_clock_getmonotonictimeDS()
 {
-    using namespace std::chrono;
+    return static_cast<dstime>(m_clock_getmonotonictimeMS() / 100);
+}
 
-    auto timeMs = duration_cast<milliseconds>(steady_clock::now().time_since_epoch());
+int64_t m_clock_getmonotonictimeMS()
+{
+    using namespace std::chrono;
 
-    return duration<dstime, std::milli>(timeMs).count() / 100;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
 }
 
 m_time_t m_mktime_UTC(const struct tm *src)
@@ -2188,6 +2321,32 @@ bool CacheableStatus::serialize(std::string* data) const
     return true;
 }
 
+CachedContentHash::CachedContentHash(const string& hash, NodeHandle h)
+    : mHash(hash)
+    , mHandle(h)
+{ }
+
+bool CachedContentHash::serialize(std::string* data) const
+{
+    CacheableWriter writer{*data};
+    writer.serializestring(mHash);
+    writer.serializenodehandle(mHandle.as8byte());
+    return true;
+}
+
+unique_ptr<CachedContentHash> CachedContentHash::unserialize(const std::string& data)
+{
+    string hash;
+    handle h;
+
+    CacheableReader reader(data);
+    if (!reader.unserializestring(hash) || !reader.unserializenodehandle(h))
+    {
+        return nullptr;
+    }
+    return std::make_unique<CachedContentHash>(hash, NodeHandle().set6byte(h));
+}
+
 int64_t CacheableStatus::value() const
 {
     return mValue;
@@ -2267,6 +2426,30 @@ std::pair<bool, int64_t> generateMetaMac(SymmCipher &cipher, InputStreamAccess &
     return std::make_pair(true, chunkMacs.macsmac(&cipher));
 }
 
+bool generateContentHash(InputStreamAccess& isAccess, string& hash)
+{
+    static const unsigned int SZ_1024K = 1l << 20;
+
+    auto buffer = std::make_unique<byte[]>(SZ_1024K);
+    HashSHA256 sha;
+    m_off_t remaining = isAccess.size();
+
+    while (remaining > 0)
+    {
+        auto length = static_cast<unsigned int>(std::min<m_off_t>(remaining, SZ_1024K));
+
+        if (!isAccess.read(buffer.get(), length))
+            return false;
+
+        sha.add(buffer.get(), length);
+        remaining -= length;
+    }
+
+    hash.clear();
+    sha.get(&hash);
+    return true;
+}
+
 bool CompareLocalFileMetaMacWithNodeKey(FileAccess* fa, const std::string& nodeKey, int type)
 {
     SymmCipher cipher;
@@ -2283,9 +2466,24 @@ bool CompareLocalFileMetaMacWithNode(FileAccess* fa, Node* node)
     return CompareLocalFileMetaMacWithNodeKey(fa, node->nodekey(), node->type);
 }
 
-void MegaClientAsyncQueue::push(std::function<void(SymmCipher&)> f, bool discardable)
+void MegaClientAsyncQueue::push(std::function<void(SymmCipher&)> f, bool discardable, Priority priority)
 {
-    if (mThreads.empty())
+    if (mSharedLane)
+    {
+        mSharedLane->push([this, f = std::move(f), priority, queued = std::chrono::steady_clock::now()]()
+        {
+            {
+                std::lock_guard<std::mutex> g(mMutex);
+                recordQueueLatency(priority, queued);
+            }
+
+            // the shared workers run the jobs of every client, each with a cipher of its own
+            thread_local SymmCipher cipher;
+            f(cipher);
+            mWaiter.notify();
+        }, discardable, priority == URGENT);
+    }
+    else if (mThreads.empty())
     {
         if (f)
         {
@@ -2296,15 +2494,55 @@ void MegaClientAsyncQueue::push(std::function<void(SymmCipher&)> f, bool discard
     {
         {
             std::lock_guard<std::mutex> g(mMutex);
-            mQueue.emplace_back(discardable, std::move(f));
+            mQueues[priority].emplace_back(discardable, std::move(f));
         }
         mConditionVariable.notify_one();
     }
 }
 
+size_t MegaClientAsyncQueue::runInBatches(size_t count, size_t batchSize, std::function<void(size_t, size_t, SymmCipher&)> f)
+{
+    std::mutex batchesMutex;
+    std::condition_variable batchesCv;
+    size_t pendingBatches = 0;
+    size_t batches = 0;
+    for (size_t begin = 0; begin < count; begin += batchSize)
+    {
+        size_t end = std::min(begin + batchSize, count);
+
+        {
+            std::lock_guard<std::mutex> g(batchesMutex);
+            ++pendingBatches;
+        }
+        ++batches;
+
+        push([&f, &batchesMutex, &batchesCv, &pendingBatches, begin, end](SymmCipher& cipher)
+        {
+            f(begin, end, cipher);
+
+            std::lock_guard<std::mutex> g(batchesMutex);
+            --pendingBatches;
+            batchesCv.notify_one();
+        }, false, URGENT);
+    }
+
+    std::unique_lock<std::mutex> g(batchesMutex);
+    batchesCv.wait(g, [&pendingBatches]() { return !pendingBatches; });
+    return batches;
+}
+
 MegaClientAsyncQueue::MegaClientAsyncQueue(Waiter& w, unsigned threadCount)
     : mWaiter(w)
 {
+    // no threads means synchronous, which still holds with shared resources
+    if (threadCount && SharedResources::enabled())
+    {
+        auto pool = SharedResources::cryptoPool();
+        mSharedLane = std::make_unique<SharedWorkerPool::Lane>(pool, pool->threadCount());
+        LOG_debug << "MegaClient using the shared worker threads: " << pool->threadCount();
+        return;
+    }
+
     for (int i = threadCount; i--; )
     {
         try
@@ -2326,6 +2564,12 @@ MegaClientAsyncQueue::MegaClientAsyncQueue(Waiter& w, unsigned threadCount)
 MegaClientAsyncQueue::~MegaClientAsyncQueue()
 {
     clearDiscardable();
+    if (mSharedLane)
+    {
+        // waits for the rest of our jobs, the threads stay for the other clients
+        mSharedLane.reset();
+        return;
+    }
     push(nullptr, false);
     mConditionVariable.notify_all();
     LOG_warn << "~MegaClientAsyncQueue() joining threads";
@@ -2338,9 +2582,42 @@ MegaClientAsyncQueue::~MegaClientAsyncQueue()
 
 void MegaClientAsyncQueue::clearDiscardable()
 {
+    if (mSharedLane)
+    {
+        mSharedLane->clear(true);
+        return;
+    }
+
+    std::lock_guard<std::mutex> g(mMutex);
+    for (auto& queue : mQueues)
+    {
+        auto newEnd = std::remove_if(queue.begin(), queue.end(), [](Entry& entry){ return entry.discardable; });
+        queue.erase(newEnd, queue.end());
+    }
+}
+
+void MegaClientAsyncQueue::exportQueueLatency(const string& labels)
+{
+    static const char* names[NUM_PRIORITIES] = { "normal", "urgent" };
+
     std::lock_guard<std::mutex> g(mMutex);
-    auto newEnd = std::remove_if(mQueue.begin(), mQueue.end(), [](Entry& entry){ return entry.discardable; });
-    mQueue.erase(newEnd, mQueue.end());
+    for (int i = 0; i < NUM_PRIORITIES; ++i)
+    {
+        mQueueLatency[i] = std::make_unique<MetricHistogram>("mega_async_queue_wait_microseconds",
+                                                             "Time a worker thread job waits to be started",
+                                                             labels + ",priority=\"" + names[i] + "\"");
+    }
+    mQueueLatencyRegistration = std::make_unique<MetricsRegistration>(
+        std::initializer_list<const Metric*>{mQueueLatency[NORMAL].get(), mQueueLatency[URGENT].get()});
+}
+
+void MegaClientAsyncQueue::recordQueueLatency(Priority priority, std::chrono::steady_clock::time_point queued)
+{
+    if (mQueueLatency[priority])
+    {
+        auto waited = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - queued);
+        mQueueLatency[priority]->record(static_cast<uint64_t>(waited.count()));
+    }
 }
 
 void MegaClientAsyncQueue::asyncThreadLoop()
@@ -2351,11 +2628,14 @@ void MegaClientAsyncQueue::asyncThreadLoop()
         std::function<void(SymmCipher&)> f;
         {
             std::unique_lock<std::mutex> g(mMutex);
-            mConditionVariable.wait(g, [this]() { return !mQueue.empty(); });
-            assert(!mQueue.empty());
-            f = std::move(mQueue.front().f);
+            mConditionVariable.wait(g, [this]() { return !mQueues[URGENT].empty() || !mQueues[NORMAL].empty(); });
+            Priority priority = mQueues[URGENT].empty() ? NORMAL : URGENT;
+            auto& queue = mQueues[priority];
+            assert(!queue.empty());
+            f = std::move(queue.front().f);
             if (!f) return;   // nullptr is not popped, and causes all the threads to exit
-            mQueue.pop_front();
+            recordQueueLatency(priority, queue.front().queued);
+            queue.pop_front();
         }
         f(cipher);
         mWaiter.notify();
@@ -3049,6 +3329,101 @@ bool foldCaseAccentEqual(uint32_t codePoint1, uint32_t codePoint2, bool stripAcc
            u_foldCase(codePoint1, U_FOLD_CASE_DEFAULT);
 }
 
+bool foldCaseAccent(const std::string& text, std::string& folded, const bool stripAccents)
+{
+    auto options = UTF8PROC_CASEFOLD | UTF8PROC_COMPOSE | UTF8PROC_STABLE;
+    if (stripAccents)
+    {
+        options |= UTF8PROC_STRIPMARK;
+    }
+
+    folded.clear();
+    folded.reserve(text.size());
+
+    auto next = reinterpret_cast<const utf8proc_uint8_t*>(text.data());
+    auto remaining = static_cast<utf8proc_ssize_t>(text.size());
+    while (remaining > 0)
+    {
+        utf8proc_int32_t codePoint = 0;
+        utf8proc_ssize_t read = utf8proc_iterate(next, remaining, &codePoint);
+        if (read <= 0)
+        {
+            return false;
+        }
+        next += read;
+        remaining -= read;
+
+        // same buffer as foldCaseAccentEqual()
+        std::array<utf8proc_int32_t, 8> buffer{0};
+        utf8proc_ssize_t length = utf8proc_decompose_char(codePoint,
+                                                          buffer.data(),
+                                                          static_cast<utf8proc_ssize_t>(buffer.size()),
+                                                          static_cast<utf8proc_option_t>(options),
+                                                          nullptr);
+        if (length < 0 || length > static_cast<utf8proc_ssize_t>(buffer.size()))
+        {
+            return false;
+        }
+
+        for (utf8proc_ssize_t i = 0; i < length; ++i)
+        {
+            utf8proc_uint8_t encoded[4];
+            utf8proc_ssize_t size = utf8proc_encode_char(buffer[static_cast<size_t>(i)], encoded);
+            folded.append(reinterpret_cast<const char*>(encoded), static_cast<size_t>(size));
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> getPatternLiterals(const std::string& pattern)
+{
+    std::vector<std::string> literals(1);
+    auto flush = [&literals]()
+    {
+        if (!literals.back().empty())
+        {
+            literals.emplace_back();
+        }
+    };
+
+    auto next = reinterpret_cast<const utf8proc_uint8_t*>(pattern.data());
+    auto remaining = static_cast<utf8proc_ssize_t>(pattern.size());
+    bool escaped = false;
+    while (remaining > 0)
+    {
+        utf8proc_int32_t codePoint = 0;
+        utf8proc_ssize_t read = utf8proc_iterate(next, remaining, &codePoint);
+        if (read <= 0)
+        {
+            escaped = false;
+            flush();
+            read = 1;
+        }
+        else if (escaped)
+        {
+            escaped = false;
+            flush();
+        }
+        else if (codePoint == WILDCARD_MATCH_ALL || codePoint == WILDCARD_MATCH_ONE || codePoint == ESCAPE_CHARACTER)
+        {
+            escaped = codePoint == ESCAPE_CHARACTER;
+            flush();
+        }
+        else
+        {
+            literals.back().append(reinterpret_cast<const char*>(next), static_cast<size_t>(read));
+        }
+        next += read;
+        remaining -= read;
+    }
+
+    if (literals.back().empty())
+    {
+        literals.pop_back();
+    }
+    return literals;
+}
+
 // This code has been taken from sqlite repository (https://www.sqlite.org/src/file?name=ext/icu/icu.c)
 
 /*
@@ -3298,10 +3673,13 @@ int naturalsorting_compare(const char* i, const char* j)
                 {
                     if (iCharType == CharType::CSYMBOL || iCharType == CharType::CALPHA)
                     {
-                        if (int difference = strncasecmp(reinterpret_cast<const char*>(&char_i),
-                                                         reinterpret_cast<const char*>(&char_j),
-                                                         1);
-                            difference)
+                        // as strncasecmp() would, without a call per character
+                        auto lower = [](char c) -> int
+                        {
+                            auto u = static_cast<unsigned char>(c);
+                            return u >= 'A' && u <= 'Z' ? u - 'A' + 'a' : u;
+                        };
+                        if (int difference = lower(char_i) - lower(char_j); difference)
                         {
                             return difference;
                         }
@@ -3381,6 +3759,53 @@ int naturalsorting_compare(const char* i, const char* j)
     return 0;
 }
 
+std::string naturalsorting_key(const std::string& name)
+{
+    static const char* hexDigits = "0123456789abcdef";
+    static const size_t maxDigits = 9999;
+
+    std::string key;
+    key.reserve(name.size() * 3);
+
+    size_t i = 0;
+    while (i < name.size())
+    {
+        CharType charType = getCharType(static_cast<unsigned char>(name[i]));
+        key.push_back(static_cast<char>('0' + static_cast<int>(charType)));
+
+        if (charType != CharType::CDIGIT)
+        {
+            // same folding as naturalsorting_compare()
+            auto u = static_cast<unsigned char>(name[i++]);
+            u = u >= 'A' && u <= 'Z' ? static_cast<unsigned char>(u - 'A' + 'a') : u;
+            key.push_back(hexDigits[u >> 4]);
+            key.push_back(hexDigits[u & 0xf]);
+            continue;
+        }
+
+        // numbers are compared by value: leading zeros are dropped and the shorter goes first
+        size_t end = i;
+        while (end < name.size() && is_digit(static_cast<unsigned char>(name[end])))
+        {
+            ++end;
+        }
+
+        while (i + 1 < end && name[i] == '0')
+        {
+            ++i;
+        }
+
+        size_t numDigits = std::min(end - i, maxDigits);
+        char length[5];
+        snprintf(length, sizeof(length), "%04u", static_cast<unsigned>(numDigits));
+        key.append(length, 4);
+        key.append(name, i, numDigits);
+        i = end;
+    }
+
+    return key;
+}
+
 std::string ensureAsteriskSurround(std::string str)
 {
     if (str.empty())
@@ -37,6 +37,36 @@ void Waiter::bumpds()
 void Waiter::init(dstime ds)
 {
     maxds = ds;
+    maxms = NEVERMS;
+}
+
+void Waiter::wakeupatms(int64_t ms)
+{
+    for (int64_t current = maxms; ms < current && !maxms.compare_exchange_weak(current, ms); );
+}
+
+int64_t Waiter::timeoutms() const
+{
+    int64_t timeout = -1;
+
+    // anything beyond a year is as good as for ever, and can't overflow below
+    dstime ds = maxds;
+    if (EVER(ds) && ds <= 10 * 3600 * 24 * 365)
+    {
+        timeout = static_cast<int64_t>(ds) * 100;
+    }
+
+    int64_t deadline = maxms;
+    if (deadline != NEVERMS)
+    {
+        int64_t untilDeadline = std::max<int64_t>(0, deadline - m_clock_getmonotonictimeMS());
+        if (timeout < 0 || untilDeadline < timeout)
+        {
+            timeout = untilDeadline;
+        }
+    }
+
+    return timeout;
 }
 
 // add events to wakeup criteria
@@ -365,6 +365,46 @@ bool WinFileAccess::ftruncate(m_off_t size)
     return false;
 }
 
+bool WinFileAccess::fpreallocate(m_off_t size)
+{
+    assert(size >= 0);
+
+    // Unlike SetFileValidData, this needs no privilege and never exposes
+    // whatever was on the disk before: unwritten ranges still read as zero.
+    FILE_ALLOCATION_INFO info;
+    info.AllocationSize.QuadPart = size;
+
+    if (SetFileInformationByHandle(hFile, FileAllocationInfo, &info, sizeof(info)))
+    {
+        return true;
+    }
+
+    auto error = GetLastError();
+    errorcode = error;
+    retry = WinFileSystemAccess::istransient(error);
+    return false;
+}
+
+bool WinFileAccess::fsparse(m_off_t size)
+{
+    assert(size >= 0);
+
+    DWORD bytesReturned;
+    FILE_END_OF_FILE_INFO info;
+    info.EndOfFile.QuadPart = size;
+
+    if (DeviceIoControl(hFile, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &bytesReturned, nullptr)
+        && SetFileInformationByHandle(hFile, FileEndOfFileInfo, &info, sizeof(info)))
+    {
+        return true;
+    }
+
+    auto error = GetLastError();
+    errorcode = error;
+    retry = WinFileSystemAccess::istransient(error);
+    return false;
+}
+
 m_time_t FileTime_to_POSIX(FILETIME* ft)
 {
     LARGE_INTEGER date;
@@ -1013,11 +1053,113 @@ bool WinFileSystemAccess::renamelocal(const LocalPath& oldnamePath, const LocalP
     return r;
 }
 
+bool WinFileSystemAccess::hardlinklocal(const LocalPath& existingPath, const LocalPath& newnamePath)
+{
+    assert(existingPath.isAbsolute());
+    assert(newnamePath.isAbsolute());
+
+    if (CreateHardLinkW(newnamePath.localpath.c_str(), existingPath.localpath.c_str(), nullptr))
+    {
+        return true;
+    }
+
+    DWORD e = GetLastError();
+    LOG_debug << "Unable to hard link file. Error code: " << e;
+
+    target_exists = e == ERROR_ALREADY_EXISTS;
+    target_name_too_long = isPathError(e)
+                           && exists(existingPath)
+                           && exists(newnamePath.parentPath());
+    transient_error = false;
+    return false;
+}
+
+// Block cloning (ReFS, Dev Drive): the target shares the source's clusters
+// until either is written. False if the volume can't, so the caller copies.
+static bool duplicateExtents(const wstring& source, const wstring& target)
+{
+    HANDLE hSource = CreateFileW(source.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                                 nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hSource == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    std::unique_ptr<void, decltype(&CloseHandle)> sourceGuard(hSource, &CloseHandle);
+
+    DWORD fsFlags = 0;
+    if (!GetVolumeInformationByHandleW(hSource, nullptr, 0, nullptr, nullptr, &fsFlags, nullptr, 0)
+        || !(fsFlags & FILE_SUPPORTS_BLOCK_REFCOUNTING))
+    {
+        return false;
+    }
+
+    DWORD bytesReturned;
+    FSCTL_GET_INTEGRITY_INFORMATION_BUFFER integrity;
+    FILE_BASIC_INFO basic;
+    FILE_STANDARD_INFO standard;
+    if (!DeviceIoControl(hSource, FSCTL_GET_INTEGRITY_INFORMATION, nullptr, 0, &integrity, sizeof(integrity), &bytesReturned, nullptr)
+        || !GetFileInformationByHandleEx(hSource, FileBasicInfo, &basic, sizeof(basic))
+        || !GetFileInformationByHandleEx(hSource, FileStandardInfo, &standard, sizeof(standard)))
+    {
+        return false;
+    }
+
+    HANDLE hTarget = CreateFileW(target.c_str(), GENERIC_READ | GENERIC_WRITE | DELETE, 0,
+                                 nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hTarget == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    std::unique_ptr<void, decltype(&CloseHandle)> targetGuard(hTarget, &CloseHandle);
+
+    // The ranges must be whole clusters, so the target gets its final size first
+    // and the last range may run past the end of both files.
+    FILE_END_OF_FILE_INFO eof;
+    eof.EndOfFile = standard.EndOfFile;
+
+    bool ok = (basic.FileAttributes & FILE_ATTRIBUTE_SPARSE_FILE
+               ? !!DeviceIoControl(hTarget, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &bytesReturned, nullptr)
+               : true)
+              && SetFileInformationByHandle(hTarget, FileEndOfFileInfo, &eof, sizeof(eof));
+
+    const LONGLONG cluster = integrity.ClusterSizeInBytes;
+    const LONGLONG maxRange = 1LL << 30;
+    const LONGLONG size = (standard.EndOfFile.QuadPart + cluster - 1) / cluster * cluster;
+
+    for (LONGLONG offset = 0; ok && offset < size; offset += maxRange)
+    {
+        DUPLICATE_EXTENTS_DATA extents;
+        extents.FileHandle = hSource;
+        extents.SourceFileOffset.QuadPart = offset;
+        extents.TargetFileOffset.QuadPart = offset;
+        extents.ByteCount.QuadPart = std::min(maxRange, size - offset);
+
+        ok = !!DeviceIoControl(hTarget, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &extents, sizeof(extents),
+                               nullptr, 0, &bytesReturned, nullptr);
+    }
+
+    // CopyFileW keeps the timestamps, so the clone does too
+    ok = ok && SetFileInformationByHandle(hTarget, FileBasicInfo, &basic, sizeof(basic));
+
+    if (!ok)
+    {
+        FILE_DISPOSITION_INFO disposition = { TRUE };
+        SetFileInformationByHandle(hTarget, FileDispositionInfo, &disposition, sizeof(disposition));
+        return false;
+    }
+
+    LOG_verbose << "Copied via block cloning";
+    return true;
+}
+
 bool WinFileSystemAccess::copylocal(const LocalPath& oldnamePath, const LocalPath& newnamePath, m_time_t)
 {
     assert(oldnamePath.isAbsolute());
     assert(newnamePath.isAbsolute());
-    bool r = !!CopyFileW(oldnamePath.localpath.c_str(), newnamePath.localpath.c_str(), FALSE);
+    bool r = duplicateExtents(oldnamePath.localpath, newnamePath.localpath)
+             || CopyFileW(oldnamePath.localpath.c_str(), newnamePath.localpath.c_str(), FALSE);
 
     if (!r)
     {
@@ -1427,6 +1569,64 @@ bool WinFileSystemAccess::fsStableIDs(const LocalPath& path) const
     return true;
 }
 
+bool WinFileSystemAccess::fsSolidState(const LocalPath& path, bool& solidState) const
+{
+    // Which volume contains the path?
+    wchar_t mountPoint[MAX_PATH + 1];
+    wchar_t volumeName[MAX_PATH + 1];
+
+    if (!GetVolumePathNameW(path.localpath.c_str(), mountPoint, MAX_PATH + 1)
+        || !GetVolumeNameForVolumeMountPointW(mountPoint, volumeName, MAX_PATH + 1))
+        return false;
+
+    // Without its trailing separator, the volume name opens the volume itself.
+    std::wstring device(volumeName);
+
+    if (!device.empty() && device.back() == L'\\')
+        device.pop_back();
+
+    // No access rights are needed to query the device's properties.
+    ScopedFileHandle handle = CreateFileW(device.c_str(),
+                                          0,
+                                          FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                          nullptr,
+                                          OPEN_EXISTING,
+                                          0,
+                                          nullptr);
+
+    if (!handle)
+        return false;
+
+    STORAGE_PROPERTY_QUERY query{};
+    query.PropertyId = StorageDeviceSeekPenaltyProperty;
+    query.QueryType = PropertyStandardQuery;
+
+    DEVICE_SEEK_PENALTY_DESCRIPTOR penalty{};
+    DWORD returned = 0;
+
+    if (!DeviceIoControl(handle.get(),
+                         IOCTL_STORAGE_QUERY_PROPERTY,
+                         &query,
+                         sizeof(query),
+                         &penalty,
+                         sizeof(penalty),
+                         &returned,
+                         nullptr)
+        || returned < sizeof(penalty))
+        return false;
+
+    solidState = !penalty.IncursSeekPenalty;
+
+    return true;
+}
+
+bool WinFileSystemAccess::setBackgroundIO(bool background)
+{
+    // Background mode lowers both the thread's scheduling and its I/O priority.
+    return SetThreadPriority(GetCurrentThread(),
+                             background ? THREAD_MODE_BACKGROUND_BEGIN : THREAD_MODE_BACKGROUND_END);
+}
+
 VOID CALLBACK WinDirNotify::completion(DWORD dwErrorCode, DWORD dwBytes, LPOVERLAPPED lpOverlapped)
 {
     assert( std::this_thread::get_id() == smNotifierThread->get_id());
@@ -1449,30 +1649,24 @@ void WinDirNotify::process(DWORD dwBytes)
     {
         // No bytes delivered indicates the OS could not deliver some notifications.
         // Maybe it ran out of buffer (maybe we were too slow)
-        // Incrementing mErrorCount will cause a full rescan of the sync
+        // Without the journal to replay, a full rescan of the sync recovers them
         // We used to send an additional notification with localnode and empty path to
         // trigger it but that is not needed anymore
 
-        int errCount = ++mErrorCount;
         LOG_err << "Empty filesystem notification: " << (localrootnode ? localrootnode->localname.toPath(false).c_str() : "NULL")
-                << " errors: " << errCount;
+                << " errors: " << mErrorCount.load();
 
-        // reissue request for notifications
+        // reissue request for notifications, then recover what was lost before it
+        LONGLONG fromUsn = mReadFromUsn;
         readchanges();
+        overflowed(fromUsn);
     }
     else
     {
         assert(dwBytes >= offsetof(FILE_NOTIFY_INFORMATION, FileName)); // 3 uint32_t.  The filename can be entirely absent, with the filename length field 0  (via samba share from qnap device)
 
-        string processbuf;
-        if (dwBytes <= 4096)
-        {
-            processbuf = notifybuf;  // even under high load, usually the buffer is under 4k.
-        }
-        else
-        {
-            processbuf.swap(notifybuf);  // use existing buffer, a new one will be allocated for receiving
-        }
+        // the two buffers take turns, the next read is issued into the other before this one is processed
+        processbuf.swap(notifybuf);
         char* ptr = (char*)processbuf.data();
 
         readchanges();
@@ -1513,13 +1707,17 @@ void WinDirNotify::readchanges()
 {
     assert( std::this_thread::get_id() == smNotifierThread->get_id());
 
-    if (notifybuf.size() != 65534)
+    if (notifybuf.size() != notifybufsize)
+    {
+        notifybuf.resize(notifybufsize);
+    }
+
+    // ReadDirectoryChangesW keeps collecting between reads, so this read gets what follows
+    if (!journalPosition(mReadFromUsn))
     {
-        // Use 65534 for the buffer size because (from doco):
-        // ReadDirectoryChangesW fails with ERROR_INVALID_PARAMETER when the buffer length is greater than 64 KB and the application is
-        // monitoring a directory over the network. This is due to a packet size limitation with the underlying file sharing protocols.
-        notifybuf.resize(65534);
+        mReadFromUsn = -1;
     }
+
     auto readRet = ReadDirectoryChangesW(hDirectory, (LPVOID)notifybuf.data(),
                               (DWORD)notifybuf.size(), TRUE,
                               FILE_NOTIFY_CHANGE_FILE_NAME
@@ -1554,6 +1752,229 @@ void WinDirNotify::readchanges()
     }
 }
 
+// the path of an open file or folder, in the same form for any of them so they can be compared
+static std::wstring finalPathByHandle(HANDLE handle)
+{
+    std::wstring path(MAX_PATH, L'\0');
+
+    for (;;)
+    {
+        auto n = GetFinalPathNameByHandleW(handle, const_cast<wchar_t*>(path.data()), DWORD(path.size()),
+                                           FILE_NAME_NORMALIZED | VOLUME_NAME_DOS);
+        if (!n)
+        {
+            return std::wstring();
+        }
+
+        // too small, n is the size needed
+        bool fits = n < path.size();
+        path.resize(n);
+
+        if (fits)
+        {
+            return path;
+        }
+    }
+}
+
+void WinDirNotify::openJournal(const std::wstring& longname)
+{
+    // Which volume contains the sync?
+    wchar_t mountPoint[MAX_PATH + 1];
+    wchar_t volumeName[MAX_PATH + 1];
+
+    // Network shares have no journal we could read.
+    if (!GetVolumePathNameW(longname.c_str(), mountPoint, MAX_PATH + 1)
+        || GetDriveTypeW(mountPoint) == DRIVE_REMOTE
+        || !GetVolumeNameForVolumeMountPointW(mountPoint, volumeName, MAX_PATH + 1))
+        return;
+
+    // Local volumes take larger notification buffers, so bursts overflow them less often.
+    notifybufsize = 1024 * 1024;
+
+    std::wstring device(volumeName);
+
+    if (!device.empty() && device.back() == L'\\')
+        device.pop_back();
+
+    // Reading the journal usually needs administrator rights.
+    HANDLE volume = CreateFileW(device.c_str(),
+                                GENERIC_READ,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                nullptr,
+                                OPEN_EXISTING,
+                                0,
+                                nullptr);
+
+    USN_JOURNAL_DATA_V0 journal{};
+    DWORD returned = 0;
+
+    if (volume == INVALID_HANDLE_VALUE
+        || !DeviceIoControl(volume, FSCTL_QUERY_USN_JOURNAL, nullptr, 0, &journal, sizeof(journal), &returned, nullptr)
+        || (mRootFinalPath = finalPathByHandle(hDirectory)).empty())
+    {
+        LOG_debug << "Change journal not available, notification overflows will rescan the sync. Error: " << GetLastError();
+
+        if (volume != INVALID_HANDLE_VALUE)
+            CloseHandle(volume);
+        return;
+    }
+
+    hVolume = volume;
+    mJournalId = journal.UsnJournalID;
+}
+
+bool WinDirNotify::journalPosition(LONGLONG& nextUsn)
+{
+    if (hVolume == INVALID_HANDLE_VALUE)
+        return false;
+
+    USN_JOURNAL_DATA_V0 journal{};
+    DWORD returned = 0;
+
+    // A journal deleted or recreated since it was opened has lost our position in it.
+    if (!DeviceIoControl(hVolume, FSCTL_QUERY_USN_JOURNAL, nullptr, 0, &journal, sizeof(journal), &returned, nullptr)
+        || journal.UsnJournalID != mJournalId)
+        return false;
+
+    nextUsn = journal.NextUsn;
+    return true;
+}
+
+bool WinDirNotify::replayJournal(LONGLONG fromUsn, LONGLONG toUsn)
+{
+    assert( std::this_thread::get_id() == smNotifierThread->get_id());
+
+    if (fromUsn < 0 || toUsn < fromUsn)
+        return false;
+
+    // Where each parent folder is now, relative to the root, or none when outside the sync.
+    std::map<DWORDLONG, std::optional<std::wstring>> parents;
+
+    auto parentPath = [&](DWORDLONG parent, const std::optional<std::wstring>*& relative) {
+        auto it = parents.find(parent);
+        if (it == parents.end())
+        {
+            FILE_ID_DESCRIPTOR id{};
+            id.dwSize = sizeof(id);
+            id.Type = FileIdType;
+            id.FileId.QuadPart = LONGLONG(parent);
+
+            ScopedFileHandle folder = OpenFileById(hVolume,
+                                                   &id,
+                                                   0,
+                                                   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                                   nullptr,
+                                                   FILE_FLAG_BACKUP_SEMANTICS);
+            std::optional<std::wstring> path;
+
+            if (folder)
+            {
+                auto fullPath = finalPathByHandle(folder.get());
+                auto n = mRootFinalPath.size();
+
+                if (!fullPath.compare(0, n, mRootFinalPath)
+                    && (fullPath.size() == n || fullPath[n] == L'\\'))
+                    path = fullPath.substr(std::min(n + 1, fullPath.size()));
+            }
+            else
+            {
+                // Gone since: its own removal was journaled against a parent that still exists.
+                auto e = GetLastError();
+                if (e != ERROR_INVALID_PARAMETER && e != ERROR_FILE_NOT_FOUND)
+                {
+                    LOG_warn << "Unable to locate a folder from the change journal. Error: " << e;
+                    return false;
+                }
+            }
+            it = parents.emplace(parent, std::move(path)).first;
+        }
+        relative = &it->second;
+        return true;
+    };
+
+    READ_USN_JOURNAL_DATA_V0 read{};
+    read.StartUsn = fromUsn;
+    read.ReasonMask = 0xFFFFFFFF;
+    read.UsnJournalID = mJournalId;
+
+    // USN records are 8 byte aligned
+    std::vector<DWORDLONG> buffer(8192);
+    size_t replayed = 0;
+
+    while (read.StartUsn < toUsn)
+    {
+        DWORD returned = 0;
+
+        // Fails if the journal wrapped past our position meanwhile.
+        if (!DeviceIoControl(hVolume, FSCTL_READ_USN_JOURNAL, &read, sizeof(read),
+                             buffer.data(), DWORD(buffer.size() * sizeof(DWORDLONG)), &returned, nullptr)
+            || returned < sizeof(USN))
+        {
+            LOG_warn << "Unable to read the change journal. Error: " << GetLastError();
+            return false;
+        }
+
+        auto* data = reinterpret_cast<const char*>(buffer.data());
+        USN next = *reinterpret_cast<const USN*>(data);
+
+        for (DWORD offset = sizeof(USN); offset < returned; )
+        {
+            auto* record = reinterpret_cast<const USN_RECORD_V2*>(data + offset);
+            offset += record->RecordLength;
+
+            if (record->MajorVersion != 2)
+                return false;
+
+            if (record->Usn >= toUsn)
+            {
+                next = toUsn;
+                break;
+            }
+
+            const std::optional<std::wstring>* relative;
+            if (!parentPath(record->ParentFileReferenceNumber, relative))
+                return false;
+
+            if (!*relative)
+                continue;
+
+            std::wstring path = **relative;
+            if (!path.empty())
+                path += L'\\';
+            path.append(reinterpret_cast<const wchar_t*>(reinterpret_cast<const char*>(record) + record->FileNameOffset),
+                        record->FileNameLength / sizeof(wchar_t));
+
+#ifdef ENABLE_SYNC
+            notify(fsEventq, localrootnode, Notification::NEEDS_PARENT_SCAN,
+                   LocalPath::fromPlatformEncodedRelative(std::move(path)));
+#endif
+            ++replayed;
+        }
+
+        // nothing journaled beyond what we read
+        if (next <= read.StartUsn)
+            break;
+
+        read.StartUsn = next;
+    }
+
+    LOG_debug << "Replayed " << replayed << " changes from the change journal: " << localbasepath;
+    return true;
+}
+
+void WinDirNotify::overflowed(LONGLONG fromUsn)
+{
+    LONGLONG toUsn = mReadFromUsn;
+
+    // Everything since the lost read was issued, up to the one just issued, is in the journal.
+    if (mOverlappedEnabled && toUsn >= 0 && replayJournal(fromUsn, toUsn))
+        return;
+
+    // Incrementing mErrorCount will cause a full rescan of the sync
+    ++mErrorCount;
+}
+
 std::mutex WinDirNotify::smNotifyMutex;
 std::atomic<unsigned> WinDirNotify::smNotifierCount{0};
 HANDLE WinDirNotify::smEventHandle = NULL;
@@ -1628,6 +2049,14 @@ WinDirNotify::WinDirNotify(LocalNode& root,
     mOverlappedEnabled = false;
     mOverlappedExit = false;
 
+    // Use 65534 for the buffer size unless the volume is local because (from doco):
+    // ReadDirectoryChangesW fails with ERROR_INVALID_PARAMETER when the buffer length is greater than 64 KB and the application is
+    // monitoring a directory over the network. This is due to a packet size limitation with the underlying file sharing protocols.
+    notifybufsize = 65534;
+    hVolume = INVALID_HANDLE_VALUE;
+    mJournalId = 0;
+    mReadFromUsn = -1;
+
     // ReadDirectoryChangesW: If you opened the file using the short name, you can receive change notifications for the short name.  (so make sure it's a long name)
     std::wstring longname;
     auto r = localbasepath.localpath.size() + 20;
@@ -1651,6 +2080,8 @@ WinDirNotify::WinDirNotify(LocalNode& root,
     {
         setFailed(0, "");
 
+        openJournal(longname);
+
         // So we know when we've asked the system for directory notifications.
         std::promise<void> requested;
 
@@ -1701,6 +2132,11 @@ WinDirNotify::~WinDirNotify()
 
         CloseHandle(hDirectory);
     }
+
+    if (hVolume != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(hVolume);
+    }
     fsaccess->dirnotifys.erase(this);
 
     {
@@ -1924,7 +2360,8 @@ ScanResult WinFileSystemAccess::directoryScan(const LocalPath& path,
                                               map<LocalPath, FSNode>& known,
                                               std::vector<FSNode>& results,
                                               [[maybe_unused]] bool followSymLinks,
-                                              unsigned& nFingerprinted)
+                                              unsigned& nFingerprinted,
+                                              FingerprintCache* fingerprints)
 {
     assert(path.isAbsolute());
     assert(!followSymLinks && "Symlinks are not supported on Windows!");
@@ -1965,11 +2402,15 @@ ScanResult WinFileSystemAccess::directoryScan(const LocalPath& path,
         return SCAN_INACCESSIBLE;
     }
 
-    alignas(8) byte bytes[1024 * 10];
+    // Entries come with their attributes, so a large buffer means few calls for big folders.
+    // On the heap (suitably aligned) rather than the scan thread's stack.
+    std::vector<byte> buffer(64 * 1024);
+    byte* bytes = buffer.data();
+    DWORD bufferSize = static_cast<DWORD>(buffer.size());
 
     if (GetFileInformationByHandleEx( rightTypeHandle.get(),
         FileIdBothDirectoryRestartInfo,  // starts the listing from the beginning
-        bytes, sizeof(bytes)))
+        bytes, bufferSize))
     {
         do
         {
@@ -2070,6 +2511,10 @@ ScanResult WinFileSystemAccess::directoryScan(const LocalPath& path,
                         result.fingerprint = std::move(it->second.fingerprint);
                         known.erase(it);
                     }
+                    else if (it == known.end() && fingerprints && fingerprints->reuse(result))
+                    {
+                        // Fingerprinted elsewhere, before a move perhaps.
+                    }
                     else
                     {
                         LocalPath p = path;
@@ -2093,7 +2538,7 @@ ScanResult WinFileSystemAccess::directoryScan(const LocalPath& path,
         }
         while (GetFileInformationByHandleEx( rightTypeHandle.get(),
             FileIdBothDirectoryInfo,  // continues but does not restart
-            bytes, sizeof(bytes)));
+            bytes, bufferSize));
 
     }
 
@@ -46,13 +46,14 @@ int WinWaiter::wait()
     if (index <= MAXIMUM_WAIT_OBJECTS)
     {
         assert(!handles.empty());
+        int64_t waitms = timeoutms();
         DWORD dwWaitResult = WaitForMultipleObjectsEx(
             static_cast<DWORD>(index),
             &handles.front(),
             FALSE,
-            (maxds > static_cast<dstime>(std::numeric_limits<DWORD>::max() / 100)) ?
+            (waitms < 0 || waitms >= static_cast<int64_t>(std::numeric_limits<DWORD>::max())) ?
                 std::numeric_limits<DWORD>::max() :
-                static_cast<DWORD>(maxds * 100),
+                static_cast<DWORD>(waitms),
             TRUE);
 
         assert(dwWaitResult != WAIT_FAILED);
@@ -0,0 +1,303 @@
+/**
+ * @file DownloadBenchmark.cpp
+ * @brief Raid download through the buffer manager, against a fake storage server replaying a trace
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "DownloadBenchmark.h"
+
+#include <ctime>
+#include <limits>
+
+namespace mt
+{
+
+using namespace mega;
+
+namespace
+{
+
+// Serves the six parts of a raid file. The file repeats a block of random lines, so the parts
+// are copied from precomputed blocks too, and requests cost next to nothing to answer.
+class FakeStorageServer
+{
+public:
+    explicit FakeStorageServer(m_off_t fileSize)
+        : mFileSize(fileSize)
+        , mFile(PATTERN_LINES * RAIDLINE)
+    {
+        PrnGen rng;
+        rng.genblock(mFile.data(), mFile.size());
+
+        for (unsigned part = 0; part < RAIDPARTS; ++part)
+        {
+            mParts[part].resize(PATTERN_LINES * RAIDSECTOR);
+            for (size_t q = 0; q < mParts[part].size(); ++q)
+            {
+                mParts[part][q] = partByte(part, m_off_t(q));
+            }
+        }
+    }
+
+    void read(unsigned part, m_off_t pos, ::mega::byte* out, size_t len) const
+    {
+        // the last, partial line has zeros in place of the missing data for the parity
+        m_off_t partialLine = mFileSize / RAIDLINE * RAIDSECTOR;
+
+        for (size_t done = 0; done < len; )
+        {
+            m_off_t q = pos + m_off_t(done);
+            if (q >= partialLine)
+            {
+                out[done++] = partByte(part, q);
+                continue;
+            }
+
+            size_t offset = size_t(q % m_off_t(mParts[part].size()));
+            size_t n = std::min({len - done, mParts[part].size() - offset, size_t(partialLine - q)});
+            memcpy(out + done, mParts[part].data() + offset, n);
+            done += n;
+        }
+    }
+
+    bool matches(m_off_t pos, const ::mega::byte* data, size_t len) const
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            if (data[i] != fileByte(pos + m_off_t(i)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t PATTERN_LINES = 4096;
+
+    ::mega::byte fileByte(m_off_t pos) const
+    {
+        return pos < mFileSize ? mFile[size_t(pos % m_off_t(mFile.size()))] : 0;
+    }
+
+    // part 0 is the parity of the five data sectors of each line
+    ::mega::byte partByte(unsigned part, m_off_t q) const
+    {
+        m_off_t line = q / RAIDSECTOR * RAIDLINE + q % RAIDSECTOR;
+        if (part)
+        {
+            return fileByte(line + (part - 1) * RAIDSECTOR);
+        }
+
+        ::mega::byte parity = 0;
+        for (unsigned sector = 0; sector < EFFECTIVE_RAIDPARTS; ++sector)
+        {
+            parity ^= fileByte(line + sector * RAIDSECTOR);
+        }
+        return parity;
+    }
+
+    m_off_t mFileSize;
+    std::vector<::mega::byte> mFile;
+    std::vector<::mega::byte> mParts[RAIDPARTS];
+};
+
+class BenchmarkBufferManager : public RaidBufferManager
+{
+    // decrypted by the benchmark once delivered, as the transfer slot does on its workers
+    void finalize(FilePiece&) override
+    {
+    }
+
+    m_off_t calcOutputChunkPos(m_off_t acquiredpos) override
+    {
+        return ChunkedHash::chunkfloor(acquiredpos);
+    }
+};
+
+struct Connection
+{
+    bool busy = false;
+    bool replied = false;
+    bool paused = false;
+    double headersAt = 0;
+    double completedAt = 0;
+    m_off_t pos = 0;
+    m_off_t npos = 0;
+};
+
+} // namespace
+
+DownloadBenchmarkResult runRaidDownload(const NetworkTrace& trace, const DownloadBenchmarkOptions& options)
+{
+    DownloadBenchmarkResult result;
+
+    // different servers on every run: the buffer manager remembers the ones it dropped as the slowest
+    static unsigned runs = 0;
+    std::string run = std::to_string(++runs);
+    std::vector<std::string> urls;
+    for (unsigned i = 0; i < RAIDPARTS; ++i)
+    {
+        urls.push_back("https://gfs" + std::to_string(i) + ".run" + run + ".benchmark.invalid/dl");
+    }
+
+    FakeStorageServer server(options.fileSize);
+
+    BenchmarkBufferManager manager;
+    manager.setIsRaid(urls, 0, options.fileSize, options.fileSize, options.maxRequestSize, false);
+    manager.setRaidLookahead(options.raidLookahead);
+
+    // the content is ciphertext to the server, any key decrypts it as far as the cost goes
+    ::mega::byte key[SymmCipher::KEYLENGTH] = { 0x6d, 0x65, 0x67, 0x61 };
+    SymmCipher cipher(key);
+    int64_t ctriv = 0x0123456789abcdefLL;
+    chunkmac_map chunkmacs;
+
+    std::clock_t cpu = 0;
+    auto measured = [&cpu](auto&& work)
+    {
+        std::clock_t start = std::clock();
+        work();
+        cpu += std::clock() - start;
+    };
+
+    Connection connections[RAIDPARTS];
+    double now = 0;
+
+    while (result.bytes < options.fileSize)
+    {
+        // one pass of the transfer slot: take any output, then give the idle connections a new range
+        for (bool progress = true; progress; )
+        {
+            progress = false;
+            for (unsigned i = RAIDPARTS; i--; )
+            {
+                std::shared_ptr<RaidBufferManager::FilePiece> piece;
+                measured([&]() { piece = manager.getAsyncOutputBufferPointer(i); });
+                if (piece)
+                {
+                    if (options.verify && !server.matches(piece->pos, piece->buf.datastart(), piece->buf.datalen()))
+                    {
+                        result.error = "wrong data in the piece at " + std::to_string(piece->pos);
+                        return result;
+                    }
+
+                    measured([&]()
+                    {
+                        if (piece->finalize(false, options.fileSize, ctriv, &cipher, &chunkmacs))
+                        {
+                            unsigned parts = piece->finalizeParts(1);
+                            piece->finalize(true, options.fileSize, ctriv, &cipher, nullptr, 0, parts);
+                        }
+                        manager.bufferWriteCompleted(i, true);
+                    });
+                    result.bytes += m_off_t(piece->buf.datalen());
+                    progress = true;
+                }
+
+                Connection& c = connections[i];
+                if (c.busy)
+                {
+                    continue;
+                }
+
+                bool supplied, paused;
+                std::pair<m_off_t, m_off_t> range;
+                measured([&]() { range = manager.nextNPosForConnection(i, supplied, paused); });
+
+                if (paused && !c.paused)
+                {
+                    ++result.pauses;
+                }
+                c.paused = paused;
+
+                if (supplied)
+                {
+                    progress = true;
+                }
+                else if (range.first < range.second)
+                {
+                    manager.transferPos(i) = std::max(manager.transferPos(i), range.second);
+
+                    c.busy = true;
+                    c.pos = range.first;
+                    c.npos = range.second;
+                    c.headersAt = trace.headersAt(i, now);
+                    c.completedAt = trace.completedAt(i, now, range.second - range.first);
+                    ++result.requests;
+                }
+            }
+        }
+
+        result.peakBufferedBytes = std::max(result.peakBufferedBytes, manager.bufferedInputBytes());
+
+        // on to the next reply headers or completed request
+        unsigned next = RAIDPARTS;
+        double at = std::numeric_limits<double>::infinity();
+        for (unsigned i = RAIDPARTS; i--; )
+        {
+            const Connection& c = connections[i];
+            double t = c.replied ? c.completedAt : c.headersAt;
+            if (c.busy && t <= at)
+            {
+                next = i;
+                at = t;
+            }
+        }
+
+        if (next == RAIDPARTS)
+        {
+            result.error = "stalled with " + std::to_string(options.fileSize - result.bytes) + " bytes to go";
+            break;
+        }
+        if (at == std::numeric_limits<double>::infinity())
+        {
+            result.error = "part " + std::to_string(next) + " never recovers from an outage";
+            break;
+        }
+
+        now = at;
+        Connection& c = connections[next];
+        if (!c.replied)
+        {
+            c.replied = true;
+
+            unsigned slowest;
+            if (manager.detectSlowestRaidConnection(next, slowest))
+            {
+                connections[slowest] = Connection();
+                manager.resetPart(slowest);
+                result.unusedPart = slowest;
+            }
+            continue;
+        }
+
+        auto piece = new RaidBufferManager::FilePiece(c.pos, size_t(c.npos - c.pos));
+        server.read(next, c.pos, piece->buf.datastart(), piece->buf.datalen());
+        measured([&]() { manager.submitBuffer(next, piece); });
+
+        c.busy = false;
+        c.replied = false;
+    }
+
+    result.simulatedMs = now;
+    result.cpuSeconds = double(cpu) / CLOCKS_PER_SEC;
+    return result;
+}
+
+} // namespace
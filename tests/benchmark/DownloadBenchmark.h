@@ -0,0 +1,73 @@
+/**
+ * @file DownloadBenchmark.h
+ * @brief Raid download through the buffer manager, against a fake storage server replaying a trace
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#pragma once
+
+#include "NetworkTrace.h"
+
+namespace mt
+{
+
+struct DownloadBenchmarkOptions
+{
+    m_off_t fileSize = 256 * 1024 * 1024;
+
+    // as TransferSlot picks it, it sizes the raid chunks
+    m_off_t maxRequestSize = mega::TransferSlot::MAX_REQ_SIZE;
+
+    // RaidBufferManager::setRaidLookahead, 0 for the default
+    m_off_t raidLookahead = 0;
+
+    // compare every output piece with the file the server holds
+    bool verify = false;
+};
+
+struct DownloadBenchmarkResult
+{
+    // empty if the whole file was delivered (and matched, when verifying)
+    std::string error;
+
+    m_off_t bytes = 0;
+
+    // virtual time from the first request to the last piece, network bound
+    double simulatedMs = 0;
+
+    // processor time spent in the buffer manager and decrypting, the client's own cost
+    double cpuSeconds = 0;
+
+    // most data held by the buffer manager at once, received but not delivered yet
+    m_off_t peakBufferedBytes = 0;
+
+    unsigned requests = 0;
+
+    // times a part was held back because it got too far ahead of the slowest one
+    unsigned pauses = 0;
+
+    // the part dropped as the slowest to reply, RAIDPARTS if none was
+    unsigned unusedPart = mega::RAIDPARTS;
+};
+
+// Downloads a raid file the way TransferSlot drives the connections: every idle connection asks the
+// RaidBufferManager for its next range, the reply arrives when the trace says, the combined output
+// pieces are decrypted and released. Time only advances from one network event to the next.
+DownloadBenchmarkResult runRaidDownload(const NetworkTrace& trace, const DownloadBenchmarkOptions& options);
+
+} // namespace
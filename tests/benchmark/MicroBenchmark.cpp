@@ -0,0 +1,733 @@
+/**
+ * @file MicroBenchmark.cpp
+ * @brief Timings of the core primitives, comparable from one release to the next
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "MicroBenchmark.h"
+
+#include "mega.h"
+#include "mega/name_collision.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <random>
+
+namespace mt
+{
+
+using namespace mega;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// returns something derived from its work, folded into gSink so none of it is optimized away
+using Operation = std::function<uint64_t()>;
+
+volatile uint64_t gSink = 0;
+
+struct MicroBenchmark
+{
+    const char* name;
+    size_t bytesPerOp;
+
+    // builds what the operation works on, kept by the operation itself
+    std::function<Operation()> setup;
+};
+
+std::string randomBytes(size_t n, unsigned seed)
+{
+    std::mt19937 generator(seed);
+    std::string bytes(n, '\0');
+    for (auto& c : bytes)
+    {
+        c = static_cast<char>(generator() & 0xff);
+    }
+    return bytes;
+}
+
+double runOps(const Operation& operation, uint64_t n)
+{
+    uint64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        sink += operation();
+    }
+    auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    gSink = gSink + sink;
+    return ns;
+}
+
+// JSON
+
+// an "f" array the way fetchnodes returns it
+std::string fetchnodesJson(unsigned nodes)
+{
+    std::mt19937_64 generator(1);
+    JSONWriter writer;
+    writer.beginobject();
+    writer.beginarray("f");
+    for (unsigned i = 0; i < nodes; ++i)
+    {
+        writer.beginobject();
+        writer.arg("h", generator(), MegaClient::NODEHANDLE);
+        writer.arg("p", generator(), MegaClient::NODEHANDLE);
+        writer.arg("u", generator(), MegaClient::USERHANDLE);
+        writer.arg("t", m_off_t(FILENODE));
+        writer.arg_B64("a", randomBytes(64, i));
+        writer.arg("k", Base64::btoa(randomBytes(8, i)) + ":" + Base64::btoa(randomBytes(32, i)));
+        writer.arg("s", m_off_t(generator() % (1 << 30)));
+        writer.arg("ts", m_off_t(1700000000 + i));
+        writer.endobject();
+    }
+    writer.endarray();
+    writer.endobject();
+    return writer.getstring();
+}
+
+Operation jsonScan()
+{
+    auto json = std::make_shared<std::string>(fetchnodesJson(1000));
+    return [json]()
+    {
+        uint64_t scanned = 0;
+        string skipped;
+        JSON j;
+        j.begin(json->c_str());
+        j.enterobject();
+        j.getnameid();
+        j.enterarray();
+        while (j.enterobject())
+        {
+            for (nameid name; (name = j.getnameid()) != EOO; )
+            {
+                switch (name)
+                {
+                case 'h':
+                case 'p':
+                    scanned += j.gethandle(MegaClient::NODEHANDLE);
+                    break;
+                case 'u':
+                    scanned += j.gethandle(MegaClient::USERHANDLE);
+                    break;
+                case 't':
+                case 's':
+                    scanned += static_cast<uint64_t>(j.getint());
+                    break;
+                default:
+                    j.storeobject(&skipped);
+                    scanned += skipped.size();
+                }
+            }
+            j.leaveobject();
+        }
+        j.leavearray();
+        return scanned;
+    };
+}
+
+Operation jsonWrite()
+{
+    auto key = std::make_shared<std::string>(randomBytes(32, 2));
+    return [key]()
+    {
+        // a putnodes command with 100 nodes
+        JSONWriter writer;
+        writer.cmd("p");
+        writer.arg("t", UNDEF, MegaClient::NODEHANDLE);
+        writer.beginarray("n");
+        for (int i = 0; i < 100; ++i)
+        {
+            writer.beginobject();
+            writer.arg("h", "xxxxxxxx");
+            writer.arg("t", m_off_t(FILENODE));
+            writer.arg_B64("a", *key);
+            writer.arg_B64("k", *key);
+            writer.arg_stringWithEscapes("n", "name with \"quotes\" and \\backslashes\\");
+            writer.endobject();
+        }
+        writer.endarray();
+        return uint64_t(writer.size());
+    };
+}
+
+// Base64
+
+const size_t BASE64_BYTES = 16 * 1024;
+
+Operation base64Encode()
+{
+    auto data = std::make_shared<std::string>(randomBytes(BASE64_BYTES, 3));
+    return [data]()
+    {
+        return uint64_t(Base64::btoa(*data).size());
+    };
+}
+
+Operation base64Decode()
+{
+    auto data = std::make_shared<std::string>(Base64::btoa(randomBytes(BASE64_BYTES, 3)));
+    return [data]()
+    {
+        return uint64_t(Base64::atob(*data).size());
+    };
+}
+
+// SymmCipher
+
+const size_t CIPHER_BYTES = 64 * 1024;
+
+struct CipherFixture
+{
+    CipherFixture()
+        : key(randomBytes(SymmCipher::KEYLENGTH, 4))
+        , cipher(reinterpret_cast<const byte*>(key.data()))
+        , data(randomBytes(CIPHER_BYTES, 5))
+    {
+    }
+
+    string key;
+    SymmCipher cipher;
+    string data;
+};
+
+Operation cipherCtr()
+{
+    auto f = std::make_shared<CipherFixture>();
+    return [f]()
+    {
+        // the chunk MAC is computed on the way, as transfers do
+        byte mac[SymmCipher::BLOCKSIZE];
+        f->cipher.ctr_crypt(reinterpret_cast<byte*>(f->data.data()), unsigned(f->data.size()), 0, 0x1234567890abcdefull, mac, true);
+        return uint64_t(mac[0]);
+    };
+}
+
+Operation cipherCbc()
+{
+    auto f = std::make_shared<CipherFixture>();
+    return [f]()
+    {
+        f->cipher.cbc_encrypt(reinterpret_cast<byte*>(f->data.data()), f->data.size());
+        return uint64_t(byte(f->data[0]));
+    };
+}
+
+Operation cipherGcm()
+{
+    auto f = std::make_shared<CipherFixture>();
+    return [f]()
+    {
+        static const byte iv[12] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+        string result;
+        f->cipher.gcm_encrypt(&f->data, iv, sizeof iv, 16, &result);
+        return uint64_t(result.size());
+    };
+}
+
+// chunkmac_map
+
+// every chunk of a 4 GB download, finished
+struct ChunkMacsFixture
+{
+    static constexpr m_off_t FILE_SIZE = m_off_t(4) << 30;
+
+    ChunkMacsFixture()
+        : key(randomBytes(SymmCipher::KEYLENGTH, 6))
+        , cipher(reinterpret_cast<const byte*>(key.data()))
+    {
+        byte data[SymmCipher::BLOCKSIZE] = {};
+        for (m_off_t pos = 0; pos < FILE_SIZE; pos = ChunkedHash::chunkceil(pos, FILE_SIZE))
+        {
+            chunks.push_back(pos);
+            macs.ctr_decrypt(pos, &cipher, data, sizeof data, pos, 42, true);
+        }
+    }
+
+    string key;
+    SymmCipher cipher;
+    chunkmac_map macs;
+    std::vector<m_off_t> chunks;
+    size_t next = 0;
+};
+
+Operation chunkMacsCalcProgress()
+{
+    auto f = std::make_shared<ChunkMacsFixture>();
+    return [f]()
+    {
+        m_off_t chunkpos = 0;
+        m_off_t completed = 0;
+        f->macs.calcprogress(ChunkMacsFixture::FILE_SIZE, chunkpos, completed);
+        return uint64_t(completed);
+    };
+}
+
+Operation chunkMacsFinishedAt()
+{
+    auto f = std::make_shared<ChunkMacsFixture>();
+    return [f]()
+    {
+        // strided, so consecutive lookups don't hit the same cache lines
+        f->next = (f->next + 613) % f->chunks.size();
+        return uint64_t(f->macs.finishedAt(f->chunks[f->next]));
+    };
+}
+
+Operation chunkMacsMacsmac()
+{
+    auto f = std::make_shared<ChunkMacsFixture>();
+    return [f]()
+    {
+        return uint64_t(f->macs.macsmac(&f->cipher));
+    };
+}
+
+Operation chunkMacsSerialize()
+{
+    auto f = std::make_shared<ChunkMacsFixture>();
+    return [f]()
+    {
+        string serialized;
+        f->macs.serialize(serialized);
+        return uint64_t(serialized.size());
+    };
+}
+
+// FileFingerprint
+
+// the same block over and over, as long as the size says
+class PatternInputStream : public InputStreamAccess
+{
+public:
+    explicit PatternInputStream(m_off_t size)
+        : mSize(size)
+        , mPattern(randomBytes(64 * 1024, 7))
+    {
+    }
+
+    void rewind() { mPos = 0; }
+
+    m_off_t size() override { return mSize; }
+
+    bool read(byte* buffer, unsigned length) override
+    {
+        if (mPos + length > mSize)
+        {
+            return false;
+        }
+
+        // no buffer: skip ahead
+        for (unsigned done = 0; buffer && done < length; )
+        {
+            size_t offset = size_t(mPos + done) % mPattern.size();
+            size_t n = std::min<size_t>(length - done, mPattern.size() - offset);
+            memcpy(buffer + done, mPattern.data() + offset, n);
+            done += unsigned(n);
+        }
+        mPos += length;
+        return true;
+    }
+
+private:
+    m_off_t mSize;
+    m_off_t mPos = 0;
+    string mPattern;
+};
+
+Operation fingerprint(m_off_t size)
+{
+    auto stream = std::make_shared<PatternInputStream>(size);
+    return [stream]()
+    {
+        stream->rewind();
+        FileFingerprint fp;
+        fp.genfingerprint(stream.get(), 1700000000);
+        return uint64_t(fp.crc[0]);
+    };
+}
+
+// LocalPath
+
+const char* const PATH_A = "/home/user/M\xc3\xbasica/Cafe\xcc\x81 del Mar/Vol. 2024/01 - Ca\xc3\xb1on%25.flac";
+const char* const PATH_B = "/home/user/M\xc3\xbasica/Cafe\xcc\x81 del Mar/Vol. 2024/01 - CA\xc3\xb1ON%25.FLAC";
+
+Operation localPathFromAbsolute()
+{
+    return []()
+    {
+        return uint64_t(LocalPath::fromAbsolutePath(PATH_A).toPath(false).size());
+    };
+}
+
+Operation localPathCompareUtf()
+{
+    auto paths = std::make_shared<std::pair<LocalPath, LocalPath>>(LocalPath::fromAbsolutePath(PATH_A),
+                                                                   LocalPath::fromAbsolutePath(PATH_B));
+    return [paths]()
+    {
+        // unescaping and case insensitive, as the sync compares names on such filesystems
+        return uint64_t(compareUtf(paths->first, true, paths->second, true, true) + 1);
+    };
+}
+
+Operation localPathContains()
+{
+    auto paths = std::make_shared<std::pair<LocalPath, LocalPath>>(LocalPath::fromAbsolutePath("/home/user/M\xc3\xbasica/Cafe\xcc\x81 del Mar"),
+                                                                   LocalPath::fromAbsolutePath(PATH_A));
+    return [paths]()
+    {
+        size_t index = 0;
+        return uint64_t(paths->first.isContainingPathOf(paths->second, &index)) + index;
+    };
+}
+
+// Names
+
+// a folder's children the way users name them: mostly ASCII, numbered, a few accented
+std::vector<std::string> childNames(unsigned n)
+{
+    static const char* const stems[] = {"IMG_", "Report ", "track", "Cafe\xcc\x81 ", "notes-v", "Scan "};
+
+    std::mt19937 generator(5);
+    std::vector<std::string> names;
+    names.reserve(n);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        names.push_back(stems[generator() % 6] + std::to_string(generator() % 10000) + (i % 3 ? ".jpg" : " (2).pdf"));
+    }
+    return names;
+}
+
+Operation namesNaturalSort()
+{
+    auto names = std::make_shared<std::vector<std::string>>(childNames(10000));
+    return [names]()
+    {
+        auto sorted = *names;
+        std::sort(sorted.begin(), sorted.end(), NaturalSortingComparator());
+        return uint64_t(sorted.front().size());
+    };
+}
+
+Operation namesToUpper()
+{
+    auto names = std::make_shared<std::vector<std::string>>(childNames(1000));
+    return [names]()
+    {
+        uint64_t n = 0;
+        for (auto& name : *names)
+        {
+            n += Utils::toUpperUtf8(name).size();
+        }
+        return n;
+    };
+}
+
+Operation namesNormalize()
+{
+    auto names = std::make_shared<std::vector<std::string>>(childNames(1000));
+    return [names]()
+    {
+        uint64_t n = 0;
+        for (auto name : *names)
+        {
+            LocalPath::utf8_normalize(&name);
+            n += name.size();
+        }
+        return n;
+    };
+}
+
+Operation namesCollisions()
+{
+    auto names = std::make_shared<std::vector<std::string>>(childNames(1000));
+    return [names]()
+    {
+        ncoll::FileNameCollisionSolver solver(*names);
+        return uint64_t(solver(names->front()).size());
+    };
+}
+
+// NodeManager and SqliteAccountState
+
+// A client with a database of its own: the root, and folders of named files under it.
+class SyntheticAccount
+{
+public:
+    static constexpr unsigned FOLDERS = 100;
+    static constexpr unsigned FILES_PER_FOLDER = 200;
+    static constexpr uint64_t CACHE_LRU_SIZE = 1000;
+
+    SyntheticAccount()
+        : mFolder(fs::temp_directory_path() / ("mega_microbenchmark_" + std::to_string(std::random_device()())))
+    {
+        fs::create_directories(mFolder);
+
+        auto waiter = std::make_shared<WAIT_CLASS>();
+        mClient.reset(new MegaClient(&mApp, waiter, &mHttpIO, new SqliteDbAccess(LocalPath::fromAbsolutePath(mFolder.string())),
+                                     nullptr, "XXX", "microbenchmark", 0));
+        mClient->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+        mClient->opensctable();
+        mClient->mNodeManager.setCacheLRUMaxSize(CACHE_LRU_SIZE);
+
+        uint64_t index = 1;
+        auto root = add(ROOTNODE, NodeHandle().set6byte(index++), NodeHandle(), nullptr, true);
+        mRoot = root->nodeHandle();
+        add(VAULTNODE, NodeHandle().set6byte(index++), NodeHandle(), nullptr, true);
+        add(RUBBISHNODE, NodeHandle().set6byte(index++), NodeHandle(), nullptr, true);
+
+        std::mt19937 generator(8);
+        for (unsigned i = 0; i < FOLDERS; ++i)
+        {
+            auto folder = add(FOLDERNODE, NodeHandle().set6byte(index++), mRoot, "folder" + std::to_string(i), true);
+            mFolders.push_back(folder->nodeHandle());
+
+            for (unsigned j = 0; j < FILES_PER_FOLDER; ++j)
+            {
+                auto name = "file" + std::to_string(i * FILES_PER_FOLDER + j) + ".dat";
+                add(FILENODE, NodeHandle().set6byte(index++), folder->nodeHandle(), name, false, m_off_t(generator() % (1 << 24)));
+                mNames.push_back(name);
+            }
+        }
+
+        // visited in this order, so consecutive files aren't neighbours in the database either
+        mFiles.reserve(mNames.size());
+        for (uint64_t h = index - mNames.size(); h < index; ++h)
+        {
+            mFiles.push_back(NodeHandle().set6byte(h));
+        }
+        std::shuffle(mFiles.begin(), mFiles.end(), generator);
+    }
+
+    ~SyntheticAccount()
+    {
+        mClient.reset();
+
+        std::error_code e;
+        fs::remove_all(mFolder, e);
+    }
+
+    MegaClient& client() { return *mClient; }
+    NodeHandle root() const { return mRoot; }
+    const std::vector<NodeHandle>& folders() const { return mFolders; }
+    const std::vector<NodeHandle>& files() const { return mFiles; }
+    const std::vector<string>& names() const { return mNames; }
+
+private:
+    struct NoHttpIO : HttpIO
+    {
+        void addevents(Waiter*, int) override {}
+        void post(HttpReq*, const char* = NULL, unsigned = 0) override {}
+        void cancel(HttpReq*) override {}
+        m_off_t postpos(void*) override { return {}; }
+        bool doio(void) override { return {}; }
+        void setuseragent(std::string*) override {}
+    };
+
+    std::shared_ptr<Node> add(nodetype_t type, NodeHandle handle, NodeHandle parent, const string& name, bool fetching, m_off_t size = -1)
+    {
+        auto node = std::make_shared<Node>(*mClient, handle, parent, type, size, UNDEF, nullptr, 0);
+        if (type == FILENODE || type == FOLDERNODE)
+        {
+            node->setkey(reinterpret_cast<const byte*>(string(type == FILENODE ? FILENODEKEYLENGTH : FOLDERNODEKEYLENGTH, 'X').c_str()));
+            node->attrs.map['n'] = name;
+            node->ctime = 1700000000;
+        }
+
+        // fetched nodes stay in RAM, the others go through the cache LRU
+        NodeManager::MissingParentNodes missingParentNodes;
+        mClient->mNodeManager.addNode(node, !fetching, fetching, missingParentNodes);
+        mClient->mNodeManager.saveNodeInDb(node.get());
+        return node;
+    }
+
+    const fs::path mFolder;
+    MegaApp mApp;
+    NoHttpIO mHttpIO;
+    std::unique_ptr<MegaClient> mClient;
+
+    NodeHandle mRoot;
+    std::vector<NodeHandle> mFolders;
+    std::vector<NodeHandle> mFiles;
+    std::vector<string> mNames;
+};
+
+struct AccountFixture
+{
+    SyntheticAccount account;
+    size_t next = 0;
+};
+
+Operation nodeManagerCached()
+{
+    auto f = std::make_shared<AccountFixture>();
+    return [f]()
+    {
+        // fewer than the cache LRU holds
+        f->next = (f->next + 1) % (SyntheticAccount::CACHE_LRU_SIZE / 2);
+        return uint64_t(f->account.client().mNodeManager.getNodeByHandle(f->account.files()[f->next]) != nullptr);
+    };
+}
+
+Operation nodeManagerEvicting()
+{
+    auto f = std::make_shared<AccountFixture>();
+    return [f]()
+    {
+        // each one is loaded from the database, and pushes the least recent out of the cache LRU
+        f->next = (f->next + 1) % f->account.files().size();
+        return uint64_t(f->account.client().mNodeManager.getNodeByHandle(f->account.files()[f->next]) != nullptr);
+    };
+}
+
+Operation sqliteSearchByName()
+{
+    auto f = std::make_shared<AccountFixture>();
+    return [f]()
+    {
+        f->next = (f->next + 7919) % f->account.names().size();
+
+        NodeSearchFilter filter;
+        filter.byAncestors({f->account.root().as8byte(), UNDEF, UNDEF});
+        filter.byName(f->account.names()[f->next]);
+        return uint64_t(f->account.client().mNodeManager.searchNodes(filter, 0 /*order none*/, CancelToken(), NodeSearchPage{0, 0}).size());
+    };
+}
+
+Operation sqliteChildrenPage()
+{
+    auto f = std::make_shared<AccountFixture>();
+    return [f]()
+    {
+        f->next = (f->next + 1) % f->account.folders().size();
+
+        // the first screen of a folder, by name
+        NodeSearchFilter filter;
+        filter.byLocationHandle(f->account.folders()[f->next].as8byte());
+        return uint64_t(f->account.client().mNodeManager.getChildren(filter, 1 /*default, ascending*/, CancelToken(), NodeSearchPage{0, 50}).size());
+    };
+}
+
+Operation sqliteCountChildren()
+{
+    auto f = std::make_shared<AccountFixture>();
+    return [f]()
+    {
+        f->next = (f->next + 1) % f->account.folders().size();
+        return uint64_t(f->account.client().mNodeManager.getNumberOfChildrenByType(f->account.folders()[f->next], FILENODE));
+    };
+}
+
+const std::vector<MicroBenchmark>& microBenchmarks()
+{
+    static const std::vector<MicroBenchmark> benchmarks = {
+        {"json/scan_fetchnodes_1000", 0, jsonScan},
+        {"json/write_putnodes_100", 0, jsonWrite},
+        {"base64/encode_16k", BASE64_BYTES, base64Encode},
+        {"base64/decode_16k", BASE64_BYTES, base64Decode},
+        {"cipher/ctr_mac_64k", CIPHER_BYTES, cipherCtr},
+        {"cipher/cbc_64k", CIPHER_BYTES, cipherCbc},
+        {"cipher/gcm_64k", CIPHER_BYTES, cipherGcm},
+        {"chunkmac/calcprogress_4g", 0, chunkMacsCalcProgress},
+        {"chunkmac/finishedat_4g", 0, chunkMacsFinishedAt},
+        {"chunkmac/macsmac_4g", 0, chunkMacsMacsmac},
+        {"chunkmac/serialize_4g", 0, chunkMacsSerialize},
+        {"fingerprint/full_4k", 4096, []() { return fingerprint(4096); }},
+        {"fingerprint/sparse_1g", 0, []() { return fingerprint(m_off_t(1) << 30); }},
+        {"localpath/from_absolute", 0, localPathFromAbsolute},
+        {"localpath/compare_utf", 0, localPathCompareUtf},
+        {"localpath/contains", 0, localPathContains},
+        {"names/natural_sort_10000", 0, namesNaturalSort},
+        {"names/to_upper_1000", 0, namesToUpper},
+        {"names/normalize_1000", 0, namesNormalize},
+        {"names/collisions_1000", 0, namesCollisions},
+        {"nodemanager/get_cached", 0, nodeManagerCached},
+        {"nodemanager/get_evicting", 0, nodeManagerEvicting},
+        {"sqlite/search_by_name", 0, sqliteSearchByName},
+        {"sqlite/children_page_50", 0, sqliteChildrenPage},
+        {"sqlite/count_children", 0, sqliteCountChildren},
+    };
+    return benchmarks;
+}
+
+} // namespace
+
+std::vector<std::string> microBenchmarkNames()
+{
+    std::vector<std::string> names;
+    for (auto& b : microBenchmarks())
+    {
+        names.push_back(b.name);
+    }
+    return names;
+}
+
+void runMicroBenchmarks(const MicroBenchmarkOptions& options,
+                        const std::function<void(const MicroBenchmarkResult&)>& report)
+{
+    for (auto& b : microBenchmarks())
+    {
+        if (!options.filter.empty() && std::string(b.name).find(options.filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        MicroBenchmarkResult result;
+        result.name = b.name;
+        result.bytesPerOp = b.bytesPerOp;
+
+        try
+        {
+            Operation operation = b.setup();
+
+            // as many as take about a sample, growing from one
+            uint64_t n = 1;
+            for (double ns; (ns = runOps(operation, n)) < options.sampleMs * 1e6; )
+            {
+                n = ns < options.sampleMs * 1e4
+                    ? n * 10
+                    : std::max<uint64_t>(n + 1, uint64_t(double(n) * options.sampleMs * 1e6 / ns));
+            }
+            result.opsPerSample = n;
+
+            std::vector<double> perOp;
+            for (unsigned i = 0; i < std::max(1u, options.samples); ++i)
+            {
+                perOp.push_back(runOps(operation, n) / double(n));
+            }
+            std::sort(perOp.begin(), perOp.end());
+
+            result.medianNs = perOp[perOp.size() / 2];
+            result.minNs = perOp.front();
+            result.maxNs = perOp.back();
+        }
+        catch (std::exception& e)
+        {
+            result.error = e.what();
+        }
+
+        report(result);
+    }
+}
+
+} // namespace
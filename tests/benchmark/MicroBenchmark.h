@@ -0,0 +1,69 @@
+/**
+ * @file MicroBenchmark.h
+ * @brief Timings of the core primitives, comparable from one release to the next
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace mt
+{
+
+struct MicroBenchmarkOptions
+{
+    // only the benchmarks whose name contains it, all if empty
+    std::string filter;
+
+    // each sample runs the operation as many times as fit in sampleMs, the first being a warm-up
+    unsigned samples = 9;
+    double sampleMs = 100;
+};
+
+struct MicroBenchmarkResult
+{
+    std::string name;
+
+    // empty if the benchmark ran
+    std::string error;
+
+    // the data an operation goes through, 0 if it isn't about throughput
+    size_t bytesPerOp = 0;
+
+    uint64_t opsPerSample = 0;
+
+    // per operation, over the samples: the median is the figure to compare, and the spread
+    // between the fastest and the slowest sample says how much to trust it
+    double medianNs = 0;
+    double minNs = 0;
+    double maxNs = 0;
+};
+
+// The names of the benchmarks, in the order they run.
+std::vector<std::string> microBenchmarkNames();
+
+// Runs each benchmark in turn on synthetic data generated from fixed seeds, so two runs (and two
+// releases) measure the same work. report is called as each one finishes.
+void runMicroBenchmarks(const MicroBenchmarkOptions& options,
+                        const std::function<void(const MicroBenchmarkResult&)>& report);
+
+} // namespace
@@ -0,0 +1,132 @@
+/**
+ * @file NetworkTrace.cpp
+ * @brief Latency and bandwidth profiles of the raid part servers, replayed on a virtual clock
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "NetworkTrace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace mt
+{
+
+bool NetworkTrace::load(const std::string& path, std::string& error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "can't open " + path;
+        return false;
+    }
+
+    size_t slash = path.find_last_of("/\\");
+    mName = path.substr(slash == std::string::npos ? 0 : slash + 1);
+    mName = mName.substr(0, mName.rfind('.'));
+
+    for (auto& segments : mParts)
+    {
+        segments.clear();
+    }
+
+    std::string line;
+    for (unsigned lineNumber = 1; std::getline(file, line); ++lineNumber)
+    {
+        std::istringstream fields(line);
+        std::string part;
+        if (!(fields >> part) || part[0] == '#')
+        {
+            continue;
+        }
+
+        Segment segment;
+        double kbPerSecond;
+        if (!(fields >> segment.from >> segment.latency >> kbPerSecond)
+            || segment.from < 0 || segment.latency < 0 || kbPerSecond < 0
+            || (part != "*" && (part.size() != 1 || part[0] < '0' || part[0] >= '0' + mega::RAIDPARTS)))
+        {
+            error = path + ":" + std::to_string(lineNumber) + ": expected <part> <from_ms> <latency_ms> <KB/s>";
+            return false;
+        }
+        segment.bytesPerMs = kbPerSecond * 1024 / 1000;
+
+        for (unsigned i = 0; i < mega::RAIDPARTS; ++i)
+        {
+            if (part == "*" || part[0] - '0' == int(i))
+            {
+                mParts[i].push_back(segment);
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < mega::RAIDPARTS; ++i)
+    {
+        auto& segments = mParts[i];
+        std::stable_sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) { return a.from < b.from; });
+        if (segments.empty() || segments.front().from > 0)
+        {
+            error = path + ": part " + std::to_string(i) + " has no segment from time 0";
+            return false;
+        }
+    }
+    return true;
+}
+
+const NetworkTrace::Segment& NetworkTrace::segmentAt(unsigned part, double t, double& next) const
+{
+    const auto& segments = mParts[part];
+    auto i = std::upper_bound(segments.begin(), segments.end(), t, [](double t, const Segment& s) { return t < s.from; });
+    next = i == segments.end() ? std::numeric_limits<double>::infinity() : i->from;
+    return *--i;
+}
+
+double NetworkTrace::headersAt(unsigned part, double start) const
+{
+    double next;
+    return start + segmentAt(part, start, next).latency;
+}
+
+double NetworkTrace::completedAt(unsigned part, double start, m_off_t bytes) const
+{
+    double t = headersAt(part, start);
+    double remaining = double(bytes);
+
+    // the body arrives at whatever rate each segment allows while it lasts
+    while (remaining > 0)
+    {
+        double next;
+        const Segment& segment = segmentAt(part, t, next);
+        double available = segment.bytesPerMs * (next - t);
+        if (segment.bytesPerMs > 0 && available >= remaining)
+        {
+            return t + remaining / segment.bytesPerMs;
+        }
+        if (next == std::numeric_limits<double>::infinity())
+        {
+            return next;
+        }
+        remaining -= available;
+        t = next;
+    }
+    return t;
+}
+
+} // namespace
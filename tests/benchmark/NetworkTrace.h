@@ -0,0 +1,68 @@
+/**
+ * @file NetworkTrace.h
+ * @brief Latency and bandwidth profiles of the raid part servers, replayed on a virtual clock
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#pragma once
+
+#include "mega.h"
+
+#include <string>
+#include <vector>
+
+namespace mt
+{
+
+// The connection to each of the six raid part servers as a sequence of segments, each one
+// holding from its start time until the next one of the same part.
+//
+// A .trace file has one segment per line, "<part> <from_ms> <latency_ms> <KB/s>", where
+// part is 0 - 5 (0 being parity) or * for all of them. Lines starting with # are comments.
+// A bandwidth of 0 is an outage: requests stall until a later segment of the part.
+class NetworkTrace
+{
+public:
+    // false with a description of the problem if the file can't be used
+    bool load(const std::string& path, std::string& error);
+
+    // file name without the extension
+    const std::string& name() const { return mName; }
+
+    // virtual time (ms) at which a request sent at start receives its reply headers
+    double headersAt(unsigned part, double start) const;
+
+    // virtual time (ms) at which the last byte of a request sent at start arrives, infinity if it never does
+    double completedAt(unsigned part, double start, m_off_t bytes) const;
+
+private:
+    struct Segment
+    {
+        double from;
+        double latency;
+        double bytesPerMs;
+    };
+
+    // the segment in force at time t, and when the next one starts (infinity for the last)
+    const Segment& segmentAt(unsigned part, double t, double& next) const;
+
+    std::string mName;
+    std::vector<Segment> mParts[mega::RAIDPARTS];
+};
+
+} // namespace
@@ -0,0 +1,327 @@
+/**
+ * @file SyncScanBenchmark.cpp
+ * @brief Sync scanner passes over a generated folder tree, with churn between passes
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "SyncScanBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <unordered_map>
+
+#ifdef ENABLE_SYNC
+
+namespace mt
+{
+
+using namespace mega;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// An item as a pass found it, keyed by its fsid, much as the sync's LocalNodes remember them.
+struct SeenNode
+{
+    handle parent = UNDEF;
+    LocalPath name;
+    LocalPath path;
+    nodetype_t type = TYPE_UNKNOWN;
+    FileFingerprint fingerprint;
+};
+
+using Snapshot = std::unordered_map<handle, SeenNode>;
+
+// The results of the previous pass, the prior children of the next scan of each folder.
+using FolderResults = std::map<LocalPath, std::vector<FSNode>>;
+
+double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// every file gets a few bytes, so it needs a real fingerprint
+void appendTo(const fs::path& path, size_t n)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::app);
+    file << std::string(1 + n % 31, char('a' + n % 26));
+}
+
+size_t generate(const fs::path& folder, unsigned depth, const SyncScanBenchmarkOptions& options)
+{
+    size_t nodes = 0;
+
+    for (unsigned i = 0; i < options.filesPerFolder; ++i, ++nodes)
+    {
+        appendTo(folder / ("file" + std::to_string(i) + ".dat"), i);
+    }
+
+    for (unsigned i = 0; depth && i < options.foldersPerFolder; ++i, ++nodes)
+    {
+        fs::path subfolder = folder / ("folder" + std::to_string(i));
+        fs::create_directory(subfolder);
+        nodes += generate(subfolder, depth - 1, options);
+    }
+
+    return nodes;
+}
+
+fs::path toFsPath(const LocalPath& path)
+{
+    return fs::path(path.platformEncoded());
+}
+
+// Changes the tree the way users do between two passes, picking from what the last one found.
+void churn(const Snapshot& seen, const SyncScanBenchmarkOptions& options, std::mt19937& rng)
+{
+    std::vector<const SeenNode*> files, folders;
+    for (auto& entry : seen)
+    {
+        (entry.second.type == FILENODE ? files : folders).push_back(&entry.second);
+    }
+
+    auto pick = [&rng](const std::vector<const SeenNode*>& from) {
+        return from[std::uniform_int_distribution<size_t>(0, from.size() - 1)(rng)];
+    };
+    std::error_code ec;
+
+    for (size_t i = size_t(double(files.size()) * options.changedFraction); i-- && !files.empty(); )
+    {
+        appendTo(toFsPath(pick(files)->path), i);
+    }
+
+    for (size_t i = size_t(double(files.size()) * options.renamedFraction); i-- && !files.empty(); )
+    {
+        fs::path path = toFsPath(pick(files)->path);
+        fs::rename(path, path.string() + "r", ec);
+    }
+
+    // paths below a folder moved already are gone, those picks just fail
+    for (unsigned i = options.movedFolders; i-- && folders.size() > 1; )
+    {
+        fs::path source = toFsPath(pick(folders)->path);
+        fs::path target = toFsPath(pick(folders)->path);
+
+        // not into itself or a folder below it
+        std::string prefix = source.string() + "/";
+        if (target == source || target.string().compare(0, prefix.size(), prefix) == 0)
+        {
+            continue;
+        }
+        fs::rename(source, target / (source.filename().string() + "m"), ec);
+    }
+}
+
+// One full pass, scanning level by level, each one all at once.
+bool scanPass(ScanService& service, const fsfp_t& fsfp, const LocalPath& root, handle rootFsid,
+              FolderResults& known, Snapshot& seen, SyncScanBenchmarkPass& pass, std::string& error)
+{
+    auto waiter = std::make_shared<WAIT_CLASS>();
+
+    std::vector<std::pair<LocalPath, handle>> level{{root, rootFsid}};
+    FolderResults results;
+
+    while (!level.empty())
+    {
+        std::vector<ScanService::RequestPtr> requests;
+        for (auto& folder : level)
+        {
+            map<LocalPath, FSNode> prior;
+            auto it = known.find(folder.first);
+            if (it != known.end())
+            {
+                for (auto& node : it->second)
+                {
+                    prior.emplace(node.localname, node.clone());
+                }
+            }
+            requests.push_back(service.queueScan(fsfp, folder.first, folder.second, false, std::move(prior), waiter));
+        }
+
+        // the workers notify as each request completes
+        while (!std::all_of(requests.begin(), requests.end(), [](const ScanService::RequestPtr& r) { return r->completed(); }))
+        {
+            waiter->init(NEVER);
+            waiter->wait();
+        }
+
+        std::vector<std::pair<LocalPath, handle>> next;
+        for (size_t i = 0; i < requests.size(); ++i)
+        {
+            auto& request = *requests[i];
+            const LocalPath& folder = level[i].first;
+
+            if (request.completionResult() != SCAN_SUCCESS)
+            {
+                error = "can't scan " + folder.toPath(false);
+                return false;
+            }
+            pass.fingerprintsComputed += request.fingerprintsComputed();
+            pass.fingerprintsReused += request.fingerprintsReused();
+
+            std::vector<FSNode> nodes = request.resultNodes();
+            for (auto& node : nodes)
+            {
+                SeenNode& s = seen[node.fsid];
+                s.parent = level[i].second;
+                s.name = node.localname;
+                s.path = folder;
+                s.path.appendWithSeparator(node.localname, true);
+                s.type = node.type;
+                s.fingerprint = node.fingerprint;
+
+                if (node.type == FOLDERNODE)
+                {
+                    next.emplace_back(s.path, node.fsid);
+                    ++pass.folders;
+                }
+                else
+                {
+                    ++pass.files;
+                }
+            }
+            results[folder] = std::move(nodes);
+        }
+        level = std::move(next);
+    }
+
+    known = std::move(results);
+    return true;
+}
+
+void compare(const Snapshot& before, const Snapshot& after, SyncScanBenchmarkPass& pass)
+{
+    for (auto& entry : after)
+    {
+        auto it = before.find(entry.first);
+        if (it == before.end())
+        {
+            ++pass.added;
+            continue;
+        }
+
+        const SeenNode& was = it->second;
+        const SeenNode& is = entry.second;
+        if (was.parent != is.parent || was.name != is.name)
+        {
+            ++pass.moved;
+        }
+        if (is.type == FILENODE && !(was.fingerprint == is.fingerprint))
+        {
+            ++pass.changed;
+        }
+    }
+
+    for (auto& entry : before)
+    {
+        if (!after.count(entry.first))
+        {
+            ++pass.removed;
+        }
+    }
+}
+
+} // namespace
+
+SyncScanBenchmarkResult runSyncScan(const SyncScanBenchmarkOptions& options)
+{
+    SyncScanBenchmarkResult result;
+
+    bool temporary = options.folder.empty();
+    fs::path folder = temporary
+        ? fs::temp_directory_path() / ("sync_scan_benchmark_" + std::to_string(std::random_device()()))
+        : fs::path(options.folder);
+
+    std::error_code ec;
+    if (!fs::create_directories(folder, ec) && (ec || !fs::is_empty(folder, ec)))
+    {
+        result.error = "need a new or empty folder at " + folder.string();
+        return result;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    result.nodes = generate(folder, options.depth, options);
+    result.generateMs = msSince(started);
+
+    FSACCESS_CLASS fsAccess;
+    LocalPath root = LocalPath::fromAbsolutePath(fs::absolute(folder).string());
+    unique_ptr<FSNode> rootNode = FSNode::fromPath(fsAccess, root, false, FSLogging::logOnError);
+    fsfp_t fsfp = fsAccess.fsFingerprint(root);
+
+    ScanService service;
+    FolderResults known;
+    Snapshot seen;
+    std::mt19937 rng(1);
+
+    for (unsigned i = 0; rootNode && i < options.passes; ++i)
+    {
+        if (i)
+        {
+            churn(seen, options, rng);
+        }
+
+        SyncScanBenchmarkPass pass;
+        Snapshot now;
+
+        started = std::chrono::steady_clock::now();
+        if (!scanPass(service, fsfp, root, rootNode->fsid, known, now, pass, result.error))
+        {
+            break;
+        }
+        pass.ms = msSince(started);
+
+        if (i)
+        {
+            compare(seen, now, pass);
+        }
+        seen = std::move(now);
+        result.passes.push_back(pass);
+    }
+
+    if (!rootNode)
+    {
+        result.error = "can't open " + folder.string();
+    }
+
+    size_t bytes = 0, nodes = 0;
+    for (auto& entry : known)
+    {
+        for (auto& node : entry.second)
+        {
+            bytes += sizeof(FSNode) + node.localname.platformEncoded().size();
+            ++nodes;
+        }
+    }
+    result.bytesPerNode = nodes ? double(bytes) / double(nodes) : 0;
+
+    if (temporary)
+    {
+        fs::remove_all(folder, ec);
+    }
+
+    return result;
+}
+
+} // namespace
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * @file SyncScanBenchmark.h
+ * @brief Sync scanner passes over a generated folder tree, with churn between passes
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#pragma once
+
+#include "mega.h"
+
+#include <string>
+#include <vector>
+
+#ifdef ENABLE_SYNC
+
+namespace mt
+{
+
+struct SyncScanBenchmarkOptions
+{
+    // where the tree is generated, a temporary folder (removed afterwards) if empty
+    std::string folder;
+
+    // levels of subfolders below the root, each folder holding the same
+    unsigned depth = 3;
+    unsigned foldersPerFolder = 10;
+    unsigned filesPerFolder = 100;
+
+    // between passes: files whose content grows, and files renamed within their folder
+    double changedFraction = 0.01;
+    double renamedFraction = 0.01;
+
+    // between passes: folders moved, with everything below, under another folder
+    unsigned movedFolders = 0;
+
+    unsigned passes = 3;
+};
+
+struct SyncScanBenchmarkPass
+{
+    double ms = 0;
+
+    size_t folders = 0;
+    size_t files = 0;
+
+    unsigned fingerprintsComputed = 0;
+    unsigned fingerprintsReused = 0;
+
+    // What the sync would have to act on, comparing by fsid with the previous pass.
+    // An item moved with its folder is not a move of its own.
+    size_t added = 0;
+    size_t removed = 0;
+    size_t changed = 0;
+    size_t moved = 0;
+};
+
+struct SyncScanBenchmarkResult
+{
+    // empty if every pass scanned the whole tree
+    std::string error;
+
+    // the folders and files generated, the root not counted
+    size_t nodes = 0;
+
+    double generateMs = 0;
+
+    // the scan results kept between passes (the FSNodes and their names), per item
+    double bytesPerNode = 0;
+
+    std::vector<SyncScanBenchmarkPass> passes;
+};
+
+// Scans a generated tree with the ScanService the way a sync's full pass does: every folder
+// found is scanned next, many at once, with the children of its previous scan to reuse their
+// fingerprints. The first pass is the initial scan, the others follow the given churn.
+SyncScanBenchmarkResult runSyncScan(const SyncScanBenchmarkOptions& options);
+
+} // namespace
+
+#endif
@@ -0,0 +1,323 @@
+/**
+ * @file main.cpp
+ * @brief Transfer benchmark: raid downloads replaying network traces
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "DownloadBenchmark.h"
+#include "MicroBenchmark.h"
+#include "SyncScanBenchmark.h"
+
+#include "mega/arguments.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+
+#include <sys/resource.h>
+
+using mega::Arguments;
+using mega::ArgumentsParser;
+
+namespace
+{
+
+std::string USAGE = R"(
+Transfer benchmark
+Usage:
+  test_benchmark [OPTION...]
+
+  -h                   Show help
+  -p=arg               Profile to replay, a .trace file (default: every one in )" BENCHMARK_PROFILES_DIR R"()
+  -s=arg               File size in MB (default: 256)
+  -r=arg               Maximum request size in bytes (default: TransferSlot::MAX_REQ_SIZE)
+  -l=arg               Raid lookahead in bytes (default: 0, the buffer manager's own)
+  -v                   Verify the downloaded data
+)"
+R"(
+Microbenchmarks of the core primitives, instead of the transfers
+  -micro               Time JSON, Base64, ciphers, chunk MACs, fingerprints, paths, nodes and queries
+  -b=arg               Only the ones whose name contains this (see -list)
+  -k=arg               Samples per benchmark, the median is reported (default: 9)
+  -e=arg               Milliseconds per sample (default: 100)
+  -list                List the microbenchmarks
+)"
+#ifdef ENABLE_SYNC
+R"(
+Sync scan benchmark, instead of the transfers
+  -sync                Scan a generated folder tree
+  -t=arg               Folder to generate the tree in, new or empty (default: a temporary one)
+  -d=arg               Levels of subfolders (default: 3)
+  -w=arg               Subfolders per folder (default: 10)
+  -f=arg               Files per folder (default: 100)
+  -c=arg               Percentage of the files changed between passes (default: 1)
+  -m=arg               Percentage of the files renamed between passes (default: 1)
+  -n=arg               Folders moved elsewhere between passes (default: 0)
+  -i=arg               Passes (default: 3)
+)"
+#endif
+;
+
+struct Config
+{
+    std::vector<std::string> profiles;
+    mt::DownloadBenchmarkOptions options;
+
+    static Config fromArguments(const Arguments& arguments);
+};
+
+Config Config::fromArguments(const Arguments& arguments)
+{
+    Config config;
+
+    if (arguments.contains("-p"))
+    {
+        config.profiles.push_back(arguments.getValue("-p"));
+    }
+    else
+    {
+        for (const auto& entry : std::filesystem::directory_iterator(BENCHMARK_PROFILES_DIR))
+        {
+            if (entry.path().extension() == ".trace")
+            {
+                config.profiles.push_back(entry.path().string());
+            }
+        }
+        std::sort(config.profiles.begin(), config.profiles.end());
+    }
+
+    // file size, minimum 1 MB
+    config.options.fileSize = std::max<m_off_t>(1, std::stoll(arguments.getValue("-s", "256"))) * 1024 * 1024;
+
+    config.options.maxRequestSize = std::stoll(arguments.getValue("-r", std::to_string(config.options.maxRequestSize)));
+    config.options.raidLookahead = std::stoll(arguments.getValue("-l", "0"));
+    config.options.verify = arguments.contains("-v");
+
+    return config;
+}
+
+#ifdef ENABLE_SYNC
+mt::SyncScanBenchmarkOptions syncOptionsFromArguments(const Arguments& arguments)
+{
+    mt::SyncScanBenchmarkOptions options;
+    options.folder = arguments.getValue("-t");
+    options.depth = unsigned(std::stoul(arguments.getValue("-d", "3")));
+    options.foldersPerFolder = unsigned(std::stoul(arguments.getValue("-w", "10")));
+    options.filesPerFolder = unsigned(std::stoul(arguments.getValue("-f", "100")));
+    options.changedFraction = std::stod(arguments.getValue("-c", "1")) / 100;
+    options.renamedFraction = std::stod(arguments.getValue("-m", "1")) / 100;
+    options.movedFolders = unsigned(std::stoul(arguments.getValue("-n", "0")));
+    options.passes = std::max(1u, unsigned(std::stoul(arguments.getValue("-i", "3"))));
+    return options;
+}
+#endif
+
+mt::MicroBenchmarkOptions microOptionsFromArguments(const Arguments& arguments)
+{
+    mt::MicroBenchmarkOptions options;
+    options.filter = arguments.getValue("-b");
+    options.samples = std::max(1u, unsigned(std::stoul(arguments.getValue("-k", "9"))));
+    options.sampleMs = std::max(1.0, std::stod(arguments.getValue("-e", "100")));
+    return options;
+}
+
+// peak resident set of the whole process so far, in MB
+double peakRssMB()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return double(usage.ru_maxrss) / (1024 * 1024);
+#else
+    return double(usage.ru_maxrss) / 1024;
+#endif
+}
+
+// one line per benchmark, with the spread of the samples around the median
+int reportMicroBenchmarks(const mt::MicroBenchmarkOptions& options)
+{
+    int failures = 0;
+    std::cout << std::left << std::setw(32) << "benchmark" << std::right
+              << std::setw(14) << "ns/op" << std::setw(10) << "spread" << std::setw(12) << "MB/s"
+              << std::setw(12) << "ops/sample" << std::endl;
+
+    mt::runMicroBenchmarks(options, [&](const mt::MicroBenchmarkResult& result)
+    {
+        std::cout << std::left << std::setw(32) << result.name << std::right;
+        if (!result.error.empty())
+        {
+            std::cout << " " << result.error << std::endl;
+            ++failures;
+            return;
+        }
+
+        double spread = result.medianNs > 0 ? (result.maxNs - result.minNs) * 100 / result.medianNs : 0;
+        std::cout << std::fixed << std::setprecision(1)
+                  << std::setw(14) << result.medianNs
+                  << std::setw(9) << spread << "%";
+        if (result.bytesPerOp && result.medianNs > 0)
+        {
+            std::cout << std::setw(12) << double(result.bytesPerOp) * 1e9 / result.medianNs / (1024 * 1024);
+        }
+        else
+        {
+            std::cout << std::setw(12) << "-";
+        }
+        std::cout << std::setw(12) << result.opsPerSample << std::endl;
+    });
+
+    return failures ? 1 : 0;
+}
+
+#ifdef ENABLE_SYNC
+int reportSyncScan(const mt::SyncScanBenchmarkOptions& options)
+{
+    mt::SyncScanBenchmarkResult result = mt::runSyncScan(options);
+
+    std::cout << std::fixed << std::setprecision(2)
+              << result.nodes << " nodes generated in " << result.generateMs / 1000 << " s"
+              << ", " << result.bytesPerNode << " bytes of scan results per node"
+              << ", peak RSS " << peakRssMB() << " MB" << std::endl;
+
+    for (size_t i = 0; i < result.passes.size(); ++i)
+    {
+        const auto& pass = result.passes[i];
+        std::cout << "pass " << i + 1 << ": " << pass.ms << " ms"
+                  << " (" << (pass.ms > 0 ? double(pass.folders + pass.files) * 1000 / pass.ms : 0) << " nodes/s)"
+                  << ", " << pass.folders << " folders, " << pass.files << " files"
+                  << ", fingerprints " << pass.fingerprintsComputed << " computed, " << pass.fingerprintsReused << " reused";
+        if (i)
+        {
+            std::cout << ", " << pass.added << " added, " << pass.removed << " removed"
+                      << ", " << pass.changed << " changed, " << pass.moved << " moved";
+        }
+        std::cout << std::endl;
+    }
+
+    if (!result.error.empty())
+    {
+        std::cerr << result.error << std::endl;
+        return 1;
+    }
+    return 0;
+}
+#endif
+
+}
+
+int main(int argc, char** argv)
+{
+    auto arguments = ArgumentsParser::parse(argc, argv);
+
+    if (arguments.contains("-h"))
+    {
+        std::cout << USAGE << std::endl;
+        return 0;
+    }
+
+    mega::SimpleLogger::setLogLevel(mega::logWarning);
+
+    if (arguments.contains("-list"))
+    {
+        for (const auto& name : mt::microBenchmarkNames())
+        {
+            std::cout << name << std::endl;
+        }
+        return 0;
+    }
+
+    if (arguments.contains("-micro"))
+    {
+        mt::MicroBenchmarkOptions options;
+        try
+        {
+            options = microOptionsFromArguments(arguments);
+        }
+        catch (...)
+        {
+            std::cout << USAGE << std::endl;
+            return 1;
+        }
+        return reportMicroBenchmarks(options);
+    }
+
+#ifdef ENABLE_SYNC
+    if (arguments.contains("-sync"))
+    {
+        mt::SyncScanBenchmarkOptions options;
+        try
+        {
+            options = syncOptionsFromArguments(arguments);
+        }
+        catch (...)
+        {
+            std::cout << USAGE << std::endl;
+            return 1;
+        }
+        return reportSyncScan(options);
+    }
+#endif
+
+    Config config;
+    try
+    {
+        config = Config::fromArguments(arguments);
+    }
+    catch (...)
+    {
+        std::cout << USAGE << std::endl;
+        return 1;
+    }
+
+    int failures = 0;
+    for (const auto& path : config.profiles)
+    {
+        mt::NetworkTrace trace;
+        std::string error;
+        if (!trace.load(path, error))
+        {
+            std::cerr << error << std::endl;
+            ++failures;
+            continue;
+        }
+
+        mt::DownloadBenchmarkResult result = mt::runRaidDownload(trace, config.options);
+
+        double mb = double(result.bytes) / (1024 * 1024);
+        double gb = mb / 1024;
+        std::cout << std::fixed << std::setprecision(2)
+                  << trace.name() << ": " << mb << " MB"
+                  << ", " << result.simulatedMs / 1000 << " s simulated"
+                  << " (" << (result.simulatedMs > 0 ? mb * 1000 / result.simulatedMs : 0) << " MB/s)"
+                  << ", CPU " << (gb > 0 ? result.cpuSeconds / gb : 0) << " s/GB"
+                  << ", " << result.requests << " requests"
+                  << ", " << result.pauses << " raid pauses"
+                  << ", unused part " << (result.unusedPart < mega::RAIDPARTS ? std::to_string(result.unusedPart) : "none")
+                  << ", peak buffered " << double(result.peakBufferedBytes) / (1024 * 1024) << " MB"
+                  << ", peak RSS " << peakRssMB() << " MB" << std::endl;
+
+        if (!result.error.empty())
+        {
+            std::cerr << trace.name() << ": " << result.error << std::endl;
+            ++failures;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
@@ -60,4 +60,51 @@ TEST(AttrMap, unserialize_32bit)
 
     ASSERT_EQ(expMap.map, newMap.map);
 }
-#endif
\ No newline at end of file
+#endif
+
+TEST(AttrMap, keeps_entries_sorted)
+{
+    mega::attr_map map;
+    map['n'] = "name";
+    map['c'] = "fingerprint";
+    map[mega::AttrMap::string2nameid("c0")] = "original";
+    map['a'] = "first";
+
+    std::vector<mega::nameid> ids;
+    for (auto& entry : map)
+    {
+        ids.push_back(entry.first);
+    }
+    ASSERT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+    ASSERT_EQ(map.size(), 4u);
+
+    ASSERT_FALSE(map.emplace('n', "other").second);
+    ASSERT_EQ(map['n'], "name");
+    ASSERT_TRUE(map.contains('c'));
+    ASSERT_EQ(map.count('x'), 0u);
+    ASSERT_THROW(map.at('x'), std::out_of_range);
+
+    ASSERT_EQ(map.erase('c'), 1u);
+    ASSERT_EQ(map.erase('c'), 0u);
+    ASSERT_EQ(map.find('c'), map.end());
+    ASSERT_EQ(map.at(mega::AttrMap::string2nameid("c0")), "original");
+}
+
+TEST(AttrMap, apply_updates)
+{
+    mega::AttrMap attrs;
+    attrs.map['n'] = "name";
+    attrs.map['c'] = "fingerprint";
+
+    mega::attr_map updates;
+    updates['c'] = "";
+    updates['n'] = "renamed";
+    updates['t'] = "tag";
+
+    ASSERT_TRUE(attrs.hasUpdate('c', updates));
+    ASSERT_FALSE(attrs.hasUpdate('x', updates));
+    attrs.applyUpdates(updates);
+
+    mega::attr_map expected(std::map<mega::nameid, std::string>{{'n', "renamed"}, {'t', "tag"}});
+    ASSERT_EQ(attrs.map, expected);
+}
@@ -0,0 +1,179 @@
+/**
+ * @file BackoffTimer_test.cpp
+ * @brief Unit tests for the tracked backoff timers and their timer wheel
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/backofftimer.h>
+#include <mega/utils.h>
+#include <mega/waiter.h>
+
+#include <memory>
+#include <random>
+
+using namespace mega;
+
+namespace
+{
+
+class BackoffTimerGroupTrackerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        mSavedDs = Waiter::ds;
+        Waiter::ds = 1000;
+    }
+
+    void TearDown() override
+    {
+        Waiter::ds = mSavedDs;
+    }
+
+    PrnGen mRng;
+    BackoffTimerGroupTracker mTracker;
+    dstime mSavedDs = 0;
+};
+
+} // namespace
+
+TEST_F(BackoffTimerGroupTrackerTest, TracksOnlyPendingTimeouts)
+{
+    BackoffTimerTracked a(mRng, mTracker);
+    EXPECT_EQ(mTracker.size(), 0u);
+
+    a.backoff(50);
+    EXPECT_EQ(mTracker.size(), 1u);
+    EXPECT_EQ(mTracker.nextTimeout(), 1050);
+
+    a.enable(false);
+    EXPECT_EQ(mTracker.size(), 0u);
+    a.enable(true);
+    EXPECT_EQ(mTracker.size(), 1u);
+
+    a.backoff(NEVER);
+    EXPECT_EQ(mTracker.size(), 0u);
+
+    {
+        BackoffTimerTracked b(mRng, mTracker);
+        b.backoff(10);
+        EXPECT_EQ(mTracker.size(), 1u);
+    }
+    EXPECT_EQ(mTracker.size(), 0u);
+    EXPECT_EQ(mTracker.nextTimeout(), NEVER);
+}
+
+TEST_F(BackoffTimerGroupTrackerTest, TransferTimersFireOnce)
+{
+    BackoffTimerTracked a(mRng, mTracker);
+    BackoffTimerTracked b(mRng, mTracker);
+    a.backoff(10);
+    b.backoff(3000);
+
+    dstime waituntil = NEVER;
+    mTracker.update(&waituntil, true);
+    EXPECT_EQ(waituntil, 1010);
+    EXPECT_FALSE(a.armed());
+
+    Waiter::ds = 1010;
+    waituntil = NEVER;
+    mTracker.update(&waituntil, true);
+
+    // a fired, and stays armed without being tracked any longer
+    EXPECT_EQ(waituntil, 0);
+    EXPECT_TRUE(a.armed());
+    EXPECT_EQ(a.nextset(), 0);
+    EXPECT_EQ(mTracker.size(), 1u);
+    EXPECT_EQ(mTracker.nextTimeout(), 4000);
+}
+
+TEST_F(BackoffTimerGroupTrackerTest, SoonestOfManyAsTimePasses)
+{
+    std::mt19937 generator(7);
+    std::vector<std::unique_ptr<BackoffTimerTracked>> timers;
+    std::vector<dstime> deltas;
+    for (int i = 0; i < 2000; ++i)
+    {
+        // from a few deciseconds to a few years, to reach the wheel's upper levels
+        dstime delta = 1 + static_cast<dstime>(generator() % (i % 2 ? 100 : 1000000000));
+        timers.push_back(std::make_unique<BackoffTimerTracked>(mRng, mTracker));
+        timers.back()->backoff(delta);
+        deltas.push_back(Waiter::ds + delta);
+    }
+
+    // cancel some of them
+    for (size_t i = 0; i < timers.size(); i += 5)
+    {
+        timers[i]->reset();
+        deltas[i] = NEVER;
+    }
+    std::sort(deltas.begin(), deltas.end());
+    deltas.erase(std::find(deltas.begin(), deltas.end(), NEVER), deltas.end());
+    ASSERT_EQ(mTracker.size(), deltas.size());
+
+    // each step jumps to the soonest timeout, which is then done with
+    size_t expired = 0;
+    while (expired < deltas.size())
+    {
+        ASSERT_EQ(mTracker.nextTimeout(), deltas[expired]);
+
+        Waiter::ds = deltas[expired];
+        dstime waituntil = NEVER;
+        mTracker.update(&waituntil, true);
+        ASSERT_EQ(waituntil, 0);
+
+        while (expired < deltas.size() && deltas[expired] <= Waiter::ds) ++expired;
+        ASSERT_EQ(mTracker.size(), deltas.size() - expired);
+    }
+    EXPECT_EQ(mTracker.nextTimeout(), NEVER);
+}
+
+TEST(Waiter, MillisecondCeiling)
+{
+    struct TestWaiter : public Waiter
+    {
+        int wait() override { return 0; }
+        void notify() override {}
+    } waiter;
+
+    waiter.init(NEVER);
+    EXPECT_EQ(waiter.timeoutms(), -1);
+
+    waiter.init(5);
+    EXPECT_EQ(waiter.timeoutms(), 500);
+
+    // the finer ceiling wins when it is sooner, and can't be pushed back
+    waiter.wakeupatms(m_clock_getmonotonictimeMS() + 10000);
+    EXPECT_EQ(waiter.timeoutms(), 500);
+    waiter.wakeupatms(m_clock_getmonotonictimeMS() + 50);
+    EXPECT_LE(waiter.timeoutms(), 50);
+    waiter.wakeupatms(m_clock_getmonotonictimeMS() + 10000);
+    EXPECT_LE(waiter.timeoutms(), 50);
+
+    // a deadline in the past means not waiting at all
+    waiter.wakeupatms(m_clock_getmonotonictimeMS() - 10);
+    EXPECT_EQ(waiter.timeoutms(), 0);
+
+    // and a new cycle starts without it
+    waiter.init(NEVER);
+    waiter.wakeupatms(m_clock_getmonotonictimeMS() + 50);
+    EXPECT_GE(waiter.timeoutms(), 0);
+    EXPECT_LE(waiter.timeoutms(), 50);
+}
@@ -20,6 +20,10 @@
  */
 
 #include <gtest/gtest.h>
+#include <sqlite3.h>
+
+#include <atomic>
+#include <thread>
 
 #include <mega/megaclient.h>
 #include <mega/megaapp.h>
@@ -684,14 +688,14 @@ TEST(CacheLRU, getNodeByHandle)
     // Node at RAM and LRU
     auxiliarNode = client->mNodeManager.getNodeByHandle(lasttNodeHandle);
     ASSERT_NE(auxiliarNode, nullptr);
-    ASSERT_NE(auxiliarNode->mNodePosition->second.mLRUPosition, client->mNodeManager.invalidCacheLRUPos());
+    ASSERT_TRUE(auxiliarNode->mNodePosition->second.isInCacheLRU());
     node = client->mNodeManager.getNodeByHandle(lasttNodeHandle);
     ASSERT_EQ(auxiliarNode.get(), node.get());
 
     // Node at RAM, no at LRU
     //ASSERT_NE(client->mNodeManager.getNodeInRAM(nodeInRAMHandle).get(), nullptr);
     ASSERT_NE(nodeInRAM, nullptr);
-    ASSERT_EQ(nodeInRAM->mNodePosition->second.mLRUPosition, client->mNodeManager.invalidCacheLRUPos());
+    ASSERT_FALSE(nodeInRAM->mNodePosition->second.isInCacheLRU());
     node = client->mNodeManager.getNodeByHandle(nodeInRAMHandle);
     ASSERT_EQ(nodeInRAM.get(), node.get());
 }
@@ -845,3 +849,1519 @@ TEST(CacheLRU, reduceCacheLRUSize)
     ASSERT_EQ(client->mNodeManager.getNodeCount(), numNodes + 4);
 
 }
+
+TEST(CacheLRU, releaseMemory)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    uint32_t LRUsize = 20;
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    client->mNodeManager.setCacheLRUMaxSize(LRUsize);
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    auto& folder = mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), &rootNode);
+    auxiliarNode.reset(&folder);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    uint32_t numNodes = LRUsize;
+    for (uint32_t i = 0; i < numNodes; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &folder);
+        file.size = static_cast<m_off_t>(index);
+        std::string name = "name" + std::to_string(index);
+        file.attrs.map = std::map<mega::nameid, std::string>{{110, name}};
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    }
+    auxiliarNode.reset();
+
+    ASSERT_EQ(client->mNodeManager.getNumNodesAtCacheLRU(), LRUsize);
+
+    client->mNodeManager.releaseMemory(LRUsize / 2);
+    ASSERT_EQ(client->mNodeManager.getNumNodesAtCacheLRU(), LRUsize / 2);
+
+    client->mNodeManager.releaseMemory(0);
+    ASSERT_EQ(client->mNodeManager.getNumNodesAtCacheLRU(), 0u);
+
+    // unloaded nodes remain available from DB, and the limits of the cache are kept
+    ASSERT_EQ(client->mNodeManager.getNodeCount(), numNodes + 2);
+    ASSERT_EQ(client->mNodeManager.getCacheLRUMaxSize(), LRUsize);
+}
+
+TEST(CacheLRU, concurrentLookupsWhileAddingNodes)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    auto& folder = mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), &rootNode);
+    std::shared_ptr<mega::Node> auxiliarNode(&folder);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    const mega::NodeHandle rootHandle = rootNode.nodeHandle();
+    const mega::NodeHandle folderHandle = folder.nodeHandle();
+
+    // readers only see nodes already in RAM, so they must never get a wrong node
+    std::atomic<bool> done{false};
+    std::atomic<bool> mismatch{false};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; i++)
+    {
+        readers.emplace_back([&]()
+        {
+            while (!done)
+            {
+                std::shared_ptr<mega::Node> n = client->mNodeManager.getNodeByHandle(rootHandle);
+                if (!n || n->nodeHandle() != rootHandle)
+                {
+                    mismatch = true;
+                }
+                client->mNodeManager.getNumberOfChildrenFromNode(folderHandle);
+            }
+        });
+    }
+
+    uint32_t numNodes = 200;
+    for (uint32_t i = 0; i < numNodes; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &folder);
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    }
+
+    done = true;
+    for (auto& t : readers)
+    {
+        t.join();
+    }
+
+    ASSERT_FALSE(mismatch);
+    ASSERT_EQ(client->mNodeManager.getNumberOfChildrenFromNode(folderHandle), numNodes);
+    ASSERT_EQ(client->mNodeManager.getNodeByHandle(folderHandle).get(), &folder);
+}
+
+TEST(CacheLRU, memoryUsageInCompactMode)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    std::shared_ptr<mega::Node> auxiliarNode;
+    uint32_t numNodes = 10;
+    for (uint32_t i = 0; i < numNodes; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode);
+        std::string name = "a long enough name to not fit in the small string buffer " + std::to_string(index);
+        file.attrs.map = std::map<mega::nameid, std::string>{{101, "foo"}, {110, name}};
+        file.attrs.map[110].reserve(1024);
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    }
+
+    uint64_t bytes = client->mNodeManager.getMemoryUsageOfNodesAtCacheLRU();
+    ASSERT_GE(bytes, client->mNodeManager.getNumNodesAtCacheLRU() * sizeof(mega::Node));
+
+    // the spare capacity of the names is released
+    client->mNodeManager.setCompactNodes(true);
+    ASSERT_TRUE(client->mNodeManager.compactNodes());
+    uint64_t compactBytes = client->mNodeManager.getMemoryUsageOfNodesAtCacheLRU();
+    ASSERT_LT(compactBytes, bytes);
+    ASSERT_GE(compactBytes, client->mNodeManager.getNumNodesAtCacheLRU() * sizeof(mega::Node));
+}
+
+TEST(CacheLRU, twoQueuesPolicyKeepsReusedNodes)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    uint32_t LRUsize = 8;
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    client->mNodeManager.setCacheLRUMaxSize(LRUsize);
+    client->mNodeManager.setCacheLRUPolicy(mega::NodeManager::CacheLRUPolicy::TWO_QUEUES);
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    auto& folder = mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), &rootNode);
+    std::shared_ptr<mega::Node> auxiliarNode(&folder);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    auto& hotFile = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &folder);
+    auxiliarNode.reset(&hotFile);
+    client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    mega::NodeHandle hotHandle = hotFile.nodeHandle();
+    auxiliarNode.reset();
+
+    // second use: it's promoted from probation to the main queue
+    ASSERT_NE(client->mNodeManager.getNodeByHandle(hotHandle), nullptr);
+
+    // a one-off walk through many more nodes than the LRU can hold
+    uint32_t numNodes = 4 * LRUsize;
+    for (uint32_t i = 0; i < numNodes; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &folder);
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    }
+    auxiliarNode.reset();
+
+    ASSERT_EQ(client->mNodeManager.getNumNodesAtCacheLRU(), LRUsize);
+
+    mega::NodeManager::CacheLRUStats stats = client->mNodeManager.getCacheLRUStats();
+    ASSERT_GE(stats.evictions, numNodes - LRUsize);
+
+    // the reused node survived the walk: it's served from RAM, not from DB
+    std::shared_ptr<mega::Node> hotNode = client->mNodeManager.getNodeByHandle(hotHandle);
+    ASSERT_NE(hotNode, nullptr);
+    ASSERT_TRUE(hotNode->mNodePosition->second.isInCacheLRU());
+    ASSERT_EQ(client->mNodeManager.getCacheLRUStats().misses, stats.misses);
+    ASSERT_GT(client->mNodeManager.getCacheLRUStats().hits, stats.hits);
+}
+
+TEST(CacheLRU, maxBytes)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    std::shared_ptr<mega::Node> auxiliarNode;
+    uint32_t numNodes = 16;
+    for (uint32_t i = 0; i < numNodes; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode);
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    }
+    auxiliarNode.reset();
+
+    uint64_t numNodesAtLRU = client->mNodeManager.getNumNodesAtCacheLRU();
+    uint64_t bytes = client->mNodeManager.getMemoryUsageOfNodesAtCacheLRU();
+    ASSERT_EQ(numNodesAtLRU, numNodes + 1);
+
+    // keep roughly half of the bytes: nodes are unloaded until the limit is honored
+    client->mNodeManager.setCacheLRUMaxBytes(bytes / 2);
+    ASSERT_LT(client->mNodeManager.getNumNodesAtCacheLRU(), numNodesAtLRU);
+    ASSERT_LE(client->mNodeManager.getMemoryUsageOfNodesAtCacheLRU(), bytes / 2);
+    ASSERT_GT(client->mNodeManager.getCacheLRUStats().evictions, 0u);
+}
+
+TEST(CacheLRU, prefetchSubtree)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    uint32_t LRUsize = 2;
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    client->mNodeManager.setCacheLRUMaxSize(LRUsize);
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    std::shared_ptr<mega::Node> folder1(&mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), &rootNode));
+    client->mNodeManager.addNode(folder1, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(folder1.get());
+
+    std::shared_ptr<mega::Node> folder2(&mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), folder1.get()));
+    client->mNodeManager.addNode(folder2, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(folder2.get());
+
+    std::shared_ptr<mega::Node> auxiliarNode;
+    uint32_t numFilesPerFolder = 8;
+    for (mega::Node* parent : {folder1.get(), folder2.get()})
+    {
+        for (uint32_t i = 0; i < numFilesPerFolder; i++)
+        {
+            auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), parent);
+            file.attrs.map = std::map<mega::nameid, std::string>{{101, "foo"}, {102, "bar"}};
+            auxiliarNode.reset(&file);
+            client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+            client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+        }
+    }
+    auxiliarNode.reset();
+
+    // only the folders (held by the test) and the LRU are in RAM
+    uint64_t nodesInRam = client->mNodeManager.getNumberNodesInRam();
+    ASSERT_LT(nodesInRam, 2 * numFilesPerFolder + 3);
+
+    // two levels below root don't fit in the LRU, but the first level with nodes to load is always loaded
+    size_t loaded = client->mNodeManager.prefetchSubtree(rootNode.nodeHandle(), 2);
+    ASSERT_GT(loaded, 0u);
+
+    // reading stops at the limit, in breadth-first order
+    auto table = dynamic_cast<mega::DBTableNodes*>(client->sctable.get());
+    ASSERT_NE(table, nullptr);
+    std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>> rows;
+    ASSERT_TRUE(table->getSubtree(rootNode.nodeHandle(), 0, 3, rows, mega::DBQueryOptions()));
+    ASSERT_EQ(rows.size(), 3u);
+    ASSERT_EQ(rows.front().first, folder1->nodeHandle());
+
+    // without a depth limit only the rows that can fit are read, and a partially read level
+    // doesn't mark its parents as having all their children
+    client->mNodeManager.prefetchSubtree(rootNode.nodeHandle(), 0);
+    ASSERT_EQ(client->mNodeManager.getChildren(folder1.get()).size(), numFilesPerFolder + 1);
+    ASSERT_EQ(client->mNodeManager.getChildren(folder2.get()).size(), numFilesPerFolder);
+
+    // the whole subtree fits now
+    client->mNodeManager.setCacheLRUMaxSize(64);
+    client->mNodeManager.prefetchSubtree(rootNode.nodeHandle(), 0);
+    ASSERT_EQ(client->mNodeManager.getNumberNodesInRam(), 2 * numFilesPerFolder + 3);
+
+    // children are resolved from RAM, without loading anything from DB
+    uint64_t misses = client->mNodeManager.getCacheLRUStats().misses;
+    ASSERT_EQ(client->mNodeManager.getChildren(folder1.get()).size(), numFilesPerFolder + 1);
+    ASSERT_EQ(client->mNodeManager.getChildren(folder2.get()).size(), numFilesPerFolder);
+    ASSERT_EQ(client->mNodeManager.getCacheLRUStats().misses, misses);
+
+    // nothing else to load
+    ASSERT_EQ(client->mNodeManager.prefetchSubtree(rootNode.nodeHandle(), 0), 0u);
+}
+
+TEST(CacheLRU, recentNodesDontKeepNodesInRam)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    uint32_t LRUsize = 4;
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    client->mNodeManager.setCacheLRUMaxSize(LRUsize);
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarRootNode.get());
+
+    std::shared_ptr<mega::Node> auxiliarNode;
+    uint32_t numFiles = 16;
+    for (uint32_t i = 0; i < numFiles; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode);
+        file.ctime = i + 1;
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    }
+    auxiliarNode.reset();
+
+    // the first call queries the DB, the second one is served from the recent handles
+    for (int i = 0; i < 2; i++)
+    {
+        mega::sharedNode_vector recent = client->mNodeManager.getRecentNodes(0, 0, false);
+        ASSERT_EQ(recent.size(), numFiles);
+        ASSERT_EQ(recent.front()->ctime, static_cast<mega::m_time_t>(numFiles));
+        ASSERT_EQ(recent.back()->ctime, 1);
+        recent.clear();
+
+        // once the caller drops them, only the cache LRU keeps nodes in RAM
+        ASSERT_LE(client->mNodeManager.getNumberNodesInRam(), LRUsize + 1);
+    }
+}
+
+TEST(CacheLRU, applyKeysInBatches)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    std::string masterKey(mega::SymmCipher::KEYLENGTH, 'M');
+    client->key.setkey(reinterpret_cast<const mega::byte*>(masterKey.data()));
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+
+    // more nodes than a single batch, with keys encrypted with the master key
+    size_t numNodes = mega::NodeManager::PARALLEL_BATCH_SIZE + 10;
+    std::vector<std::shared_ptr<mega::Node>> files;
+    for (size_t i = 0; i < numNodes; i++)
+    {
+        std::shared_ptr<mega::Node> file(&mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode));
+
+        std::string nodeKey(mega::FILENODEKEYLENGTH, static_cast<char>(i));
+        mega::SymmCipher nodeCipher;
+        nodeCipher.setkey(&nodeKey);
+        std::string attrs;
+        mega::MegaClient::makeattr(&nodeCipher, &attrs, "\"n\":\"file\"");
+        file->attrstring.reset(new std::string);
+        mega::Base64::btoa(attrs, *file->attrstring);
+
+        std::string encryptedKey = nodeKey;
+        client->key.ecb_encrypt(reinterpret_cast<mega::byte*>(encryptedKey.data()), reinterpret_cast<mega::byte*>(encryptedKey.data()), encryptedKey.size());
+        std::string encodedKey;
+        mega::Base64::btoa(encryptedKey, encodedKey);
+        file->setKey(encodedKey);
+        ASSERT_FALSE(file->keyApplied());
+
+        client->mNodeManager.addNode(file, false, true, missingParentNodes);
+        files.push_back(std::move(file));
+    }
+
+    client->mNodeManager.applyKeys(0);
+
+    ASSERT_EQ(client->performanceStats.applyKeysParallel, numNodes);
+    ASSERT_EQ(client->performanceStats.applyKeysBatches, 2u);
+    for (size_t i = 0; i < numNodes; i++)
+    {
+        ASSERT_TRUE(files[i]->keyApplied());
+        ASSERT_EQ(files[i]->nodekey(), std::string(mega::FILENODEKEYLENGTH, static_cast<char>(i)));
+        ASSERT_FALSE(files[i]->attrstring);
+        ASSERT_STREQ(files[i]->displayname(), "file");
+    }
+}
+
+TEST(CacheLRU, decodingQueueWritesFetchedNodes)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    std::string masterKey(mega::SymmCipher::KEYLENGTH, 'M');
+    client->key.setkey(reinterpret_cast<const mega::byte*>(masterKey.data()));
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> root(&rootNode);
+    client->mNodeManager.addNode(root, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(root.get());
+
+    auto& folderNode = mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(index++), &rootNode);
+    std::shared_ptr<mega::Node> folder(&folderNode);
+    client->mNodeManager.addNode(folder, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(folder.get());
+
+    // as received by fetchnodes: not kept in RAM, keys encrypted with the master key
+    // (but the last one, whose key is already applied)
+    size_t queueSize = mega::NodeManager::DECODING_QUEUE_BATCHES * mega::NodeManager::PARALLEL_BATCH_SIZE;
+    size_t numNodes = queueSize + 10;
+    uint64_t firstFile = index;
+    for (size_t i = 0; i <= numNodes; i++)
+    {
+        std::shared_ptr<mega::Node> file(&mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &folderNode));
+
+        if (i < numNodes)
+        {
+            std::string nodeKey(mega::FILENODEKEYLENGTH, static_cast<char>(i));
+            mega::SymmCipher nodeCipher;
+            nodeCipher.setkey(&nodeKey);
+            std::string attrs;
+            mega::MegaClient::makeattr(&nodeCipher, &attrs, "\"n\":\"file\"");
+            file->attrstring.reset(new std::string);
+            mega::Base64::btoa(attrs, *file->attrstring);
+
+            std::string encryptedKey = nodeKey;
+            client->key.ecb_encrypt(reinterpret_cast<mega::byte*>(encryptedKey.data()), reinterpret_cast<mega::byte*>(encryptedKey.data()), encryptedKey.size());
+            std::string encodedKey;
+            mega::Base64::btoa(encryptedKey, encodedKey);
+            file->setKey(encodedKey);
+        }
+
+        client->mNodeManager.addNode(file, false, true, missingParentNodes);
+        client->mNodeManager.queueNodeForDecoding(std::move(file));
+    }
+
+    // a full queue is flushed by itself, the rest waits for the end of the array
+    auto table = dynamic_cast<mega::DBTableNodes*>(client->sctable.get());
+    ASSERT_NE(table, nullptr);
+    ASSERT_EQ(table->getNumberOfChildren(folderNode.nodeHandle()), queueSize);
+    ASSERT_EQ(client->performanceStats.fetchnodesKeysBatches, mega::NodeManager::DECODING_QUEUE_BATCHES);
+
+    client->mNodeManager.flushDecodingQueue();
+
+    ASSERT_EQ(table->getNumberOfChildren(folderNode.nodeHandle()), numNodes + 1);
+    ASSERT_EQ(client->performanceStats.fetchnodesKeysParallel, numNodes);
+    ASSERT_EQ(client->performanceStats.fetchnodesKeysSerial, 1u);
+    ASSERT_EQ(client->performanceStats.fetchnodesKeysBatches, mega::NodeManager::DECODING_QUEUE_BATCHES + 1);
+
+    for (size_t i : {size_t(0), queueSize - 1, queueSize, numNodes - 1})
+    {
+        std::shared_ptr<mega::Node> file = client->mNodeManager.getNodeByHandle(mega::NodeHandle().set6byte(firstFile + i));
+        ASSERT_TRUE(file);
+        ASSERT_TRUE(file->keyApplied());
+        ASSERT_EQ(file->nodekey(), std::string(mega::FILENODEKEYLENGTH, static_cast<char>(i)));
+        ASSERT_STREQ(file->displayname(), "file");
+    }
+}
+
+TEST(CacheLRU, actionPacketCoalescingPostponesPurge)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(1), nullptr);
+    std::shared_ptr<mega::Node> root(&rootNode);
+    client->mNodeManager.addNode(root, false, false, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(root.get());
+    client->mNodeManager.initCompleted();
+
+    auto& fileNode = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(2), &rootNode);
+    std::shared_ptr<mega::Node> file(&fileNode);
+    client->mNodeManager.addNode(file, true, false, missingParentNodes);
+    client->mNodeManager.notifyNode(file);
+
+    // more batches of actionpackets to follow
+    client->mCoalesceActionPackets = true;
+    client->insca_notlast = true;
+    client->notifypurge();
+    ASSERT_EQ(client->mNodeManager.nodeNotifySize(), 1u);
+
+    // notified again by a later batch, reported once with the last one
+    client->mNodeManager.notifyNode(file);
+    ASSERT_EQ(client->mNodeManager.nodeNotifySize(), 1u);
+    client->insca_notlast = false;
+    client->notifypurge();
+    ASSERT_EQ(client->mNodeManager.nodeNotifySize(), 0u);
+}
+
+TEST(CacheLRU, moveUpdatesCountersBelowCommonAncestor)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarRootNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarRootNode, false, true, missingParentNodes);
+
+    auto addNode = [&](mega::nodetype_t type, mega::Node* parent)
+    {
+        std::shared_ptr<mega::Node> node(&mt::makeNode(*client, type, mega::NodeHandle().set6byte(index++), parent));
+        if (type == mega::FILENODE)
+        {
+            node->size = 100;
+            mega::NodeCounter nc;
+            nc.files = 1;
+            nc.storage = node->size;
+            node->setCounter(nc);
+        }
+        client->mNodeManager.addNode(node, false, false, missingParentNodes);
+        return node;
+    };
+
+    auto folderA = addNode(mega::nodetype_t::FOLDERNODE, &rootNode);
+    auto folderA1 = addNode(mega::nodetype_t::FOLDERNODE, folderA.get());
+    auto folderB = addNode(mega::nodetype_t::FOLDERNODE, folderA.get());
+    auto file = addNode(mega::nodetype_t::FILENODE, folderA1.get());
+    folderA->changed.counter = false;
+    folderB->changed.counter = false;
+
+    mega::NodeCounter counterA1 = folderA1->getCounter();
+    mega::NodeCounter counterA = folderA->getCounter();
+    mega::NodeCounter counterB = folderB->getCounter();
+    mega::NodeCounter counterRoot = rootNode.getCounter();
+
+    // A is the closest common ancestor: only A1 and B change
+    file->setparent(folderB, true);
+
+    ASSERT_EQ(folderA1->getCounter().files, counterA1.files - 1);
+    ASSERT_EQ(folderA1->getCounter().storage, counterA1.storage - 100);
+    ASSERT_EQ(folderB->getCounter().files, counterB.files + 1);
+    ASSERT_EQ(folderB->getCounter().storage, counterB.storage + 100);
+    ASSERT_EQ(folderA->getCounter().files, counterA.files);
+    ASSERT_EQ(folderA->getCounter().storage, counterA.storage);
+    ASSERT_EQ(rootNode.getCounter().files, counterRoot.files);
+    ASSERT_FALSE(folderA->changed.counter);
+    ASSERT_TRUE(folderB->changed.counter);
+}
+
+TEST(CacheLRU, searchNodesWithNameIndex)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    client->mNodeManager.setCacheLRUMaxSize(2);
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    auto addFile = [&](const std::string& name)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode);
+        file.attrs.map = std::map<mega::nameid, std::string>{{110, name}};
+        std::shared_ptr<mega::Node> node(&file);
+        client->mNodeManager.addNode(node, false, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(node.get());
+    };
+
+    // indexed when the index is built from DB...
+    addFile("Ångström report.pdf");
+    addFile("report 2024.txt");
+    client->mNodeManager.setNameIndexEnabled(true);
+    ASSERT_TRUE(client->mNodeManager.isNameIndexEnabled());
+
+    // ...and when written to DB afterwards
+    addFile("holidays.jpg");
+    addFile("ab");
+
+    auto search = [&](const std::string& name)
+    {
+        mega::NodeSearchFilter searchFilter;
+        searchFilter.byAncestors({rootNode.nodehandle, mega::UNDEF, mega::UNDEF});
+        searchFilter.byName(name);
+        return client->mNodeManager.searchNodes(searchFilter,
+                                                0 /*order None*/,
+                                                mega::CancelToken(),
+                                                mega::NodeSearchPage{0, 0}).size();
+    };
+
+    ASSERT_EQ(search("angstrom"), 1);
+    ASSERT_EQ(search("REPORT"), 2);
+    ASSERT_EQ(search("rep*pdf"), 1);
+    ASSERT_EQ(search("holi?ays"), 1);
+    ASSERT_EQ(search("missing"), 0);
+    // too short to be narrowed by the index
+    ASSERT_EQ(search("ab"), 1);
+
+    client->mNodeManager.setNameIndexEnabled(false);
+    ASSERT_FALSE(client->mNodeManager.isNameIndexEnabled());
+    ASSERT_EQ(search("REPORT"), 2);
+}
+
+TEST(CacheLRU, getChildrenWithCursor)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    client->mNodeManager.setCacheLRUMaxSize(4);
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    uint32_t numNodes = 11;
+    for (uint32_t i = 0; i < numNodes; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode);
+        file.size = static_cast<m_off_t>(i % 3);
+        file.attrs.map = std::map<mega::nameid, std::string>{{110, "file" + std::to_string(i)}};
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, false, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    }
+
+    mega::NodeSearchFilter filter;
+    filter.byAncestors({rootNode.nodehandle, mega::UNDEF, mega::UNDEF});
+
+    for (int order : {1 /*default asc*/, 4 /*size desc*/})
+    {
+        mega::sharedNode_vector expected = client->mNodeManager.getChildren(filter,
+                                                                             order,
+                                                                             mega::CancelToken(),
+                                                                             mega::NodeSearchPage{0, 0});
+        ASSERT_EQ(expected.size(), numNodes);
+
+        // pages of 4 follow the same order as the offset look-up
+        mega::NodeSearchCursor cursor;
+        mega::sharedNode_vector paged;
+        while (!cursor.atEnd())
+        {
+            mega::sharedNode_vector page = client->mNodeManager.getChildren(filter, order, mega::CancelToken(), 4, cursor);
+            ASSERT_LE(page.size(), 4u);
+            paged.insert(paged.end(), page.begin(), page.end());
+        }
+        ASSERT_EQ(paged, expected);
+
+        // streaming hands out batches while reading, and can stop at any of them
+        mega::NodeSearchCursor streamCursor;
+        std::vector<size_t> batchSizes;
+        ASSERT_TRUE(client->mNodeManager.streamChildren(filter,
+                                                        order,
+                                                        mega::CancelToken(),
+                                                        5,
+                                                        streamCursor,
+                                                        [&batchSizes](mega::sharedNode_vector& batch)
+                                                        {
+                                                            batchSizes.push_back(batch.size());
+                                                            return batchSizes.size() < 2;
+                                                        }));
+        ASSERT_EQ(batchSizes, (std::vector<size_t>{5, 5}));
+        ASSERT_FALSE(streamCursor.atEnd());
+
+        // and resume from the cursor
+        mega::sharedNode_vector rest = client->mNodeManager.getChildren(filter, order, mega::CancelToken(), 0, streamCursor);
+        ASSERT_EQ(rest.size(), 1u);
+        ASSERT_EQ(rest.front(), expected.back());
+        ASSERT_TRUE(streamCursor.atEnd());
+    }
+}
+
+TEST(CacheLRU, fingerprintFilterSkipsMisses)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    // empty DB, so all fingerprints written from now on are known
+    client->mNodeManager.cleanNodes();
+    client->mNodeManager.setCacheLRUMaxSize(8);
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    auto makeFingerprint = [](int32_t seed)
+    {
+        mega::FileFingerprint fp;
+        fp.size = seed;
+        fp.mtime = 44;
+        fp.crc.fill(seed);
+        fp.isvalid = true;
+        return fp;
+    };
+
+    // enough files to outgrow the initial size of the filter, so it gets rebuilt from DB
+    const int32_t numNodes = 2000;
+    for (int32_t i = 0; i < numNodes; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode);
+        static_cast<mega::FileFingerprint&>(file) = makeFingerprint(i);
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, false, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    }
+
+    ASSERT_LT(client->mNodeManager.getFingerprintFilterFalsePositiveRate(), 0.05);
+
+    auto& stats = client->performanceStats;
+    for (int32_t i = 0; i < numNodes; i += 100)
+    {
+        mega::FileFingerprint fp = makeFingerprint(i);
+        ASSERT_TRUE(client->mNodeManager.getNodeByFingerprint(fp));
+    }
+    ASSERT_EQ(stats.fingerprintFilterNegatives, 0u);
+
+    const int32_t numMisses = 200;
+    for (int32_t i = 0; i < numMisses; i++)
+    {
+        mega::FileFingerprint fp = makeFingerprint(numNodes + i);
+        ASSERT_TRUE(client->mNodeManager.getNodesByFingerprint(fp).empty());
+    }
+    ASSERT_EQ(stats.fingerprintFilterNegatives + stats.fingerprintFilterFalsePositives, static_cast<uint64_t>(numMisses));
+    ASSERT_GT(stats.fingerprintFilterNegatives, static_cast<uint64_t>(numMisses * 9 / 10));
+}
+
+TEST(CacheLRU, notifyPurgeWritesNodesInBulk)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    // more than one multi-row statement, plus a remainder written row by row
+    uint32_t numNodes = 150;
+    for (uint32_t i = 0; i < numNodes; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode);
+        file.attrs.map = std::map<mega::nameid, std::string>{{110, "bulk" + std::to_string(i)}};
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.notifyNode(auxiliarNode);
+    }
+    auxiliarNode.reset();
+    client->mNodeManager.notifyPurge();
+
+    mega::NodeSearchFilter filter;
+    filter.byAncestors({rootNode.nodehandle, mega::UNDEF, mega::UNDEF});
+    filter.byName("bulk");
+    mega::sharedNode_vector nodes = client->mNodeManager.getChildren(filter,
+                                                                     0 /*order None*/,
+                                                                     mega::CancelToken(),
+                                                                     mega::NodeSearchPage{0, 0});
+    ASSERT_EQ(nodes.size(), numNodes);
+
+    // and their blobs can be read back
+    filter.byName("bulk149");
+    nodes = client->mNodeManager.getChildren(filter, 0 /*order None*/, mega::CancelToken(), mega::NodeSearchPage{0, 0});
+    ASSERT_EQ(nodes.size(), 1u);
+    ASSERT_STREQ(nodes.front()->displayname(), "bulk149");
+}
+
+TEST(CacheLRU, getVersionsFollowsTheChain)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    auto addFile = [&](mega::Node* parent) -> mega::Node&
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), parent);
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+        auxiliarNode.reset();
+        return file;
+    };
+
+    // newest version at the root, each one the only child of the next newer
+    mega::Node& current = addFile(&rootNode);
+    mega::Node& previous = addFile(&current);
+    mega::Node& oldest = addFile(&previous);
+    // another file, out of the chain
+    mega::Node& other = addFile(&rootNode);
+    const std::vector<mega::NodeHandle> expected{previous.nodeHandle(), oldest.nodeHandle()};
+
+    auto table = dynamic_cast<mega::DBTableNodes*>(client->sctable.get());
+    ASSERT_NE(table, nullptr);
+
+    // ordered by depth, from the newest version to the oldest one
+    std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>> versions;
+    ASSERT_TRUE(table->getVersions(current.nodeHandle(), versions));
+    ASSERT_EQ(versions.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        ASSERT_EQ(versions[i].first, expected[i]);
+    }
+
+    // the chain ends at the oldest version
+    versions.clear();
+    ASSERT_TRUE(table->getVersions(oldest.nodeHandle(), versions));
+    ASSERT_TRUE(versions.empty());
+
+    versions.clear();
+    ASSERT_TRUE(table->getVersions(other.nodeHandle(), versions));
+    ASSERT_TRUE(versions.empty());
+}
+
+TEST(CacheLRU, nodeChangeJournal)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    ASSERT_TRUE(client->mNodeManager.setChangeJournalEnabled(true));
+    ASSERT_TRUE(client->mNodeManager.isChangeJournalEnabled());
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    std::vector<mega::NodeHandle> files;
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode);
+        file.attrs.map = std::map<mega::nameid, std::string>{{110, "journal" + std::to_string(i)}};
+        file.changed.newnode = true;
+        files.push_back(file.nodeHandle());
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.notifyNode(auxiliarNode);
+    }
+    auxiliarNode.reset();
+    client->mNodeManager.notifyPurge();
+
+    auto changesOf = [](const std::vector<mega::DBNodeChange>& changes, mega::NodeHandle h)
+    {
+        auto it = std::find_if(changes.begin(), changes.end(), [h](const mega::DBNodeChange& c) { return c.node == h; });
+        return it == changes.end() ? 0 : it->changes;
+    };
+
+    std::vector<mega::DBNodeChange> changes;
+    uint64_t lastSequence = 0;
+    bool missed = true;
+    ASSERT_TRUE(client->mNodeManager.getNodeChanges(0, 0, changes, lastSequence, missed));
+    ASSERT_FALSE(missed);
+    ASSERT_GE(changes.size(), files.size());
+    ASSERT_EQ(lastSequence, changes.back().sequence);
+    for (size_t i = 1; i < changes.size(); ++i)
+    {
+        ASSERT_LT(changes[i - 1].sequence, changes[i].sequence);
+    }
+    for (mega::NodeHandle h : files)
+    {
+        ASSERT_TRUE(changesOf(changes, h) & mega::Node::CHANGED_NEWNODE);
+    }
+
+    // limited reads continue from the last entry read
+    std::vector<mega::DBNodeChange> page;
+    ASSERT_TRUE(client->mNodeManager.getNodeChanges(0, 1, page, lastSequence, missed));
+    ASSERT_EQ(page.size(), 1u);
+    ASSERT_EQ(page.front().sequence, changes.front().sequence);
+
+    // nothing new
+    const uint64_t consumed = lastSequence;
+    changes.clear();
+    ASSERT_TRUE(client->mNodeManager.getNodeChanges(consumed, 0, changes, lastSequence, missed));
+    ASSERT_TRUE(changes.empty());
+    ASSERT_FALSE(missed);
+
+    std::shared_ptr<mega::Node> nodeToRemove = client->mNodeManager.getNodeByHandle(files.front());
+    ASSERT_NE(nodeToRemove, nullptr);
+    nodeToRemove->changed.removed = true;
+    client->mNodeManager.notifyNode(nodeToRemove);
+    nodeToRemove.reset();
+    client->mNodeManager.notifyPurge();
+
+    ASSERT_TRUE(client->mNodeManager.getNodeChanges(consumed, 0, changes, lastSequence, missed));
+    ASSERT_FALSE(missed);
+    ASSERT_TRUE(changesOf(changes, files.front()) & mega::Node::CHANGED_REMOVED);
+    ASSERT_EQ(changesOf(changes, files.back()), 0u);
+
+    // a consumer ahead of the journal (i.e. it was created again) has to start over
+    changes.clear();
+    ASSERT_TRUE(client->mNodeManager.getNodeChanges(lastSequence + 5, 0, changes, lastSequence, missed));
+    ASSERT_TRUE(missed);
+
+    // catch up before disabling the journal
+    changes.clear();
+    ASSERT_TRUE(client->mNodeManager.getNodeChanges(consumed, 0, changes, lastSequence, missed));
+    const uint64_t caughtUp = lastSequence;
+
+    ASSERT_TRUE(client->mNodeManager.setChangeJournalEnabled(false));
+    ASSERT_FALSE(client->mNodeManager.isChangeJournalEnabled());
+    ASSERT_FALSE(client->mNodeManager.getNodeChanges(0, 0, changes, lastSequence, missed));
+
+    // changes while disabled aren't recorded
+    std::shared_ptr<mega::Node> nodeToChange = client->mNodeManager.getNodeByHandle(files.back());
+    ASSERT_NE(nodeToChange, nullptr);
+    nodeToChange->changed.attrs = true;
+    client->mNodeManager.notifyNode(nodeToChange);
+    client->mNodeManager.notifyPurge();
+
+    // sequences aren't assigned again once enabled, and the consumer learns it missed changes
+    ASSERT_TRUE(client->mNodeManager.setChangeJournalEnabled(true));
+    changes.clear();
+    ASSERT_TRUE(client->mNodeManager.getNodeChanges(caughtUp, 0, changes, lastSequence, missed));
+    ASSERT_TRUE(changes.empty());
+    ASSERT_GE(lastSequence, caughtUp);
+    ASSERT_TRUE(missed);
+
+    nodeToChange->changed.attrs = true;
+    client->mNodeManager.notifyNode(nodeToChange);
+    nodeToChange.reset();
+    client->mNodeManager.notifyPurge();
+
+    changes.clear();
+    ASSERT_TRUE(client->mNodeManager.getNodeChanges(caughtUp, 0, changes, lastSequence, missed));
+    ASSERT_TRUE(missed);
+    ASSERT_FALSE(changes.empty());
+    ASSERT_GT(changes.front().sequence, caughtUp);
+    ASSERT_TRUE(changesOf(changes, files.back()) & mega::Node::CHANGED_ATTRS);
+
+    // after starting over from the new entries, it's caught up again
+    const uint64_t restarted = lastSequence;
+    changes.clear();
+    ASSERT_TRUE(client->mNodeManager.getNodeChanges(restarted, 0, changes, lastSequence, missed));
+    ASSERT_TRUE(changes.empty());
+    ASSERT_FALSE(missed);
+    ASSERT_EQ(lastSequence, restarted);
+}
+
+TEST(CacheLRU, bulkLoadDbRestoresIndexes)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    client->mNodeManager.setBulkLoadDb(true);
+    ASSERT_TRUE(client->mNodeManager.bulkLoadDb());
+    client->mNodeManager.startBulkLoad();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    uint32_t numNodes = 20;
+    for (uint32_t i = 0; i < numNodes; i++)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode);
+        file.attrs.map = std::map<mega::nameid, std::string>{{110, "load" + std::to_string(i)}};
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, true, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    }
+    auxiliarNode.reset();
+
+    // leaves the bulk load mode and rebuilds the indexes
+    client->mNodeManager.initCompleted();
+
+    mega::NodeSearchFilter filter;
+    filter.byAncestors({rootNode.nodehandle, mega::UNDEF, mega::UNDEF});
+    filter.byName("load");
+    mega::sharedNode_vector nodes = client->mNodeManager.getChildren(filter,
+                                                                     0 /*order None*/,
+                                                                     mega::CancelToken(),
+                                                                     mega::NodeSearchPage{0, 0});
+    ASSERT_EQ(nodes.size(), numNodes);
+    ASSERT_EQ(client->mNodeManager.getNumberOfChildrenFromNode(rootNode.nodeHandle()), numNodes);
+}
+
+TEST(CacheLRU, readQueriesUsePooledConnectionsOnceCommitted)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    auto addFile = [&](const std::string& name)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode);
+        file.attrs.map = std::map<mega::nameid, std::string>{{110, name}};
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+        auxiliarNode.reset();
+    };
+    addFile("pooled1");
+
+    mega::NodeSearchFilter filter;
+    filter.byAncestors({rootNode.nodehandle, mega::UNDEF, mega::UNDEF});
+    filter.byName("pooled");
+    auto search = [&]()
+    {
+        return client->mNodeManager.searchNodes(filter, 0 /*order None*/, mega::CancelToken(), mega::NodeSearchPage{0, 0});
+    };
+
+    // uncommitted nodes are only visible from the primary connection
+    client->mNodeManager.getDbReadPoolStats(true);
+    ASSERT_EQ(search().size(), 1u);
+    mega::DBReadPoolStats stats = client->mNodeManager.getDbReadPoolStats(true);
+    ASSERT_EQ(stats.pooled, 0u);
+    ASSERT_EQ(stats.primary, 1u);
+
+    client->sctable->commit();
+    client->sctable->begin();
+    ASSERT_EQ(search().size(), 1u);
+    stats = client->mNodeManager.getDbReadPoolStats(true);
+    ASSERT_EQ(stats.pooled, 1u);
+    ASSERT_EQ(stats.primary, 0u);
+    ASSERT_EQ(stats.waits, 0u);
+
+    addFile("pooled2");
+    ASSERT_EQ(search().size(), 2u);
+    stats = client->mNodeManager.getDbReadPoolStats(true);
+    ASSERT_EQ(stats.pooled, 0u);
+}
+
+TEST(CacheLRU, fullTextIndexNarrowsNameSearches)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    uint64_t index = 1;
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(index++), nullptr);
+    std::shared_ptr<mega::Node> auxiliarNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    auto addFile = [&](const std::string& name)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(index++), &rootNode);
+        file.attrs.map = std::map<mega::nameid, std::string>{{110, name}};
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+        auxiliarNode.reset();
+    };
+    addFile("Résumé 2024.pdf");
+    addFile("summary.txt");
+
+    if (!client->mNodeManager.setFullTextIndexEnabled(true))
+    {
+        GTEST_SKIP() << "SQLite built without FTS5";
+    }
+    ASSERT_TRUE(client->mNodeManager.isFullTextIndexEnabled());
+
+    // added after the index was populated
+    addFile("ab.doc");
+
+    auto countChildren = [&](const std::string& name)
+    {
+        mega::NodeSearchFilter filter;
+        filter.byAncestors({rootNode.nodehandle, mega::UNDEF, mega::UNDEF});
+        filter.byName(name);
+        return client->mNodeManager.getChildren(filter, 0 /*order None*/, mega::CancelToken(), mega::NodeSearchPage{0, 0}).size();
+    };
+
+    ASSERT_EQ(countChildren("resume"), 1u);
+    ASSERT_EQ(countChildren("*2024*pdf"), 1u);
+    ASSERT_EQ(countChildren("mmar"), 1u);
+    ASSERT_EQ(countChildren("missing"), 0u);
+    // too short to be narrowed by the index
+    ASSERT_EQ(countChildren("ab"), 1u);
+    ASSERT_EQ(countChildren("b.d"), 1u);
+
+    ASSERT_TRUE(client->mNodeManager.setFullTextIndexEnabled(false));
+    ASSERT_FALSE(client->mNodeManager.isFullTextIndexEnabled());
+    ASSERT_EQ(countChildren("resume"), 1u);
+}
+
+TEST(CacheLRU, groupCommitFlushesOnBarrier)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+    auto client = mt::makeClient(app, dbAccess);
+
+    // opened directly, so group commit is off until enabled below
+    const std::string name = "groupcommit_test";
+    std::unique_ptr<mega::DbTable> table(dbAccess->open(client->rng, *client->fsaccess, name, 0, nullptr));
+    ASSERT_NE(table, nullptr);
+    const std::string dbPath = dbAccess->databasePath(*client->fsaccess, name, mega::DbAccess::DB_VERSION).toPath(false);
+
+    // rows in the DB file itself, ignoring the WAL, as they would be found after a crash
+    auto rowsOnDisk = [&dbPath]()
+    {
+        int rows = -1;
+        sqlite3* db = nullptr;
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_open_v2(("file:" + dbPath + "?immutable=1").c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_URI, nullptr) == SQLITE_OK &&
+            sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM statecache", -1, &stmt, nullptr) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            rows = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+        return rows;
+    };
+
+    table->begin();
+    table->truncate();
+    table->commit();
+
+    // neither the delay nor the number of commits is reached before the barrier
+    if (!table->setGroupCommit(std::chrono::minutes(10), 1000))
+    {
+        GTEST_SKIP() << "DB not in WAL mode";
+    }
+    ASSERT_TRUE(table->flushCommits());
+    ASSERT_EQ(rowsOnDisk(), 0);
+
+    std::string data = "content";
+    for (uint32_t i = 1; i <= 10; ++i)
+    {
+        table->begin();
+        ASSERT_TRUE(table->put(i * mega::DbTable::IDSPACING + mega::MegaClient::CACHEDUSER, &data));
+        table->commit();
+    }
+
+    // committed, but only in the WAL
+    std::string read;
+    ASSERT_TRUE(table->get(10 * mega::DbTable::IDSPACING + mega::MegaClient::CACHEDUSER, &read));
+    ASSERT_EQ(read, data);
+    ASSERT_EQ(rowsOnDisk(), 0);
+
+    ASSERT_TRUE(table->flushCommits());
+    ASSERT_EQ(rowsOnDisk(), 10);
+
+    ASSERT_TRUE(table->setGroupCommit(std::chrono::milliseconds(0), 0));
+    ASSERT_TRUE(table->flushCommits());
+    table->remove();
+}
+
+TEST(CacheLRU, compressedNodeBlobsReadBack)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+    client->mNodeManager.setDbBlobCompression(true);
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(1), nullptr);
+    std::shared_ptr<mega::Node> auxiliarNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(2), &rootNode);
+    file.attrs.map = std::map<mega::nameid, std::string>{{110, "compressed.txt"},
+                                                         {mega::AttrMap::string2nameid("des"), std::string(2000, 'd')}};
+    auxiliarNode.reset(&file);
+    client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    mega::DBBlobStats stats = client->mNodeManager.getDbBlobStats(true);
+    ASSERT_EQ(stats.written, 2u);
+    ASSERT_EQ(stats.compressed, 1u); // the root node is too small
+    ASSERT_LT(stats.storedBytes, stats.rawBytes);
+
+    std::string serialized;
+    file.serialize(&serialized);
+    auxiliarNode.reset();
+
+    auto table = dynamic_cast<mega::DBTableNodes*>(client->sctable.get());
+    ASSERT_NE(table, nullptr);
+    mega::NodeSerialized fromDb;
+    ASSERT_TRUE(table->getNode(mega::NodeHandle().set6byte(2), fromDb));
+    ASSERT_EQ(fromDb.mNode, serialized);
+    ASSERT_EQ(client->mNodeManager.getDbBlobStats(false).decompressed, 1u);
+}
+
+TEST(CacheLRU, snapshotServesRecordsUntilTheyChange)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+    auto client = mt::makeClient(app, dbAccess);
+
+    const std::string name = "snapshot_test";
+    auto open = [&]()
+    {
+        std::unique_ptr<mega::DbTable> table(dbAccess->open(client->rng, *client->fsaccess, name, 0, nullptr));
+        table->setSnapshot(true);
+        return table;
+    };
+    mega::LocalPath snapshotPath = dbAccess->databasePath(*client->fsaccess, name, mega::DbAccess::DB_VERSION);
+    snapshotPath.append(mega::LocalPath::fromRelativePath("-snapshot"));
+
+    std::string scsn = "12345678";
+    std::string record = "record";
+    auto table = open();
+    table->begin();
+    table->truncate();
+    ASSERT_TRUE(table->put(0, &scsn));
+    ASSERT_TRUE(table->put(mega::DbTable::IDSPACING + mega::MegaClient::CACHEDUSER, &record));
+    table->commit();
+    table.reset();
+    ASSERT_TRUE(client->fsaccess->fileExistsAt(snapshotPath));
+
+    table = open();
+    table->rewind();
+    uint32_t id = 0;
+    std::string data;
+    std::map<uint32_t, std::string> records;
+    while (table->next(&id, &data))
+    {
+        records[id] = data;
+    }
+    ASSERT_EQ(records.size(), 2u);
+    ASSERT_EQ(records[0], scsn);
+    ASSERT_EQ(records[mega::DbTable::IDSPACING + mega::MegaClient::CACHEDUSER], record);
+
+    // changed records make it outdated
+    table->begin();
+    ASSERT_TRUE(table->del(mega::DbTable::IDSPACING + mega::MegaClient::CACHEDUSER));
+    ASSERT_FALSE(client->fsaccess->fileExistsAt(snapshotPath));
+    table->commit();
+
+    table->remove();
+    ASSERT_FALSE(client->fsaccess->fileExistsAt(snapshotPath));
+}
+
+TEST(CacheLRU, queryOptionsInterruptQueries)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(1), nullptr);
+    std::shared_ptr<mega::Node> auxiliarNode(&rootNode);
+    client->mNodeManager.addNode(auxiliarNode, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+
+    // enough rows for the progress handler to be called several times
+    constexpr size_t numFiles = 500;
+    for (size_t i = 0; i < numFiles; ++i)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(i + 2), &rootNode);
+        auxiliarNode.reset(&file);
+        client->mNodeManager.addNode(auxiliarNode, true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(auxiliarNode.get());
+    }
+    auxiliarNode.reset();
+
+    auto table = dynamic_cast<mega::DBTableNodes*>(client->sctable.get());
+    ASSERT_NE(table, nullptr);
+
+    mega::NodeSearchFilter filter;
+    filter.byAncestors({rootNode.nodehandle, mega::UNDEF, mega::UNDEF});
+    std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>> nodes;
+
+    mega::DBQueryOptions expired;
+    expired.deadline = mega::DBQueryOptions::Clock::now() - std::chrono::seconds(1);
+    ASSERT_FALSE(table->getChildren(filter, 0 /*order None*/, nodes, expired, mega::NodeSearchPage{0, 0}));
+    ASSERT_TRUE(expired.timedOut);
+    ASSERT_FALSE(expired.yielded);
+
+    // a background query yields while an interactive one is waiting
+    mega::DBQueryScheduler scheduler;
+    mega::DBQueryOptions background;
+    background.priority = mega::DBQueryPriority::BACKGROUND;
+    background.scheduler = &scheduler;
+
+    scheduler.interactiveWaiting();
+    nodes.clear();
+    ASSERT_FALSE(table->getChildren(filter, 0 /*order None*/, nodes, background, mega::NodeSearchPage{0, 0}));
+    ASSERT_TRUE(background.yielded);
+
+    scheduler.interactiveServed();
+    nodes.clear();
+    ASSERT_TRUE(table->getChildren(filter, 0 /*order None*/, nodes, background, mega::NodeSearchPage{0, 0}));
+    ASSERT_FALSE(background.yielded);
+    ASSERT_EQ(nodes.size(), numFiles);
+
+    // interactive queries never yield
+    mega::DBQueryOptions interactive;
+    interactive.scheduler = &scheduler;
+    scheduler.interactiveWaiting();
+    nodes.clear();
+    ASSERT_TRUE(table->getChildren(filter, 0 /*order None*/, nodes, interactive, mega::NodeSearchPage{0, 0}));
+    ASSERT_EQ(nodes.size(), numFiles);
+    scheduler.interactiveServed();
+}
+
+TEST(CacheLRU, folderCountersFollowNodeWrites)
+{
+    mega::MegaApp app;
+    mega::SqliteDbAccess* dbAccess = new mega::SqliteDbAccess(mega::LocalPath::fromAbsolutePath("."));
+
+    auto client = mt::makeClient(app, dbAccess);
+    client->sid = "AWA5YAbtb4JO-y2zWxmKZpSe5-6XM7CTEkA-3Nv7J4byQUpOazdfSC1ZUFlS-kah76gPKUEkTF9g7MeE";
+
+    client->opensctable();
+
+    mega::NodeManager::MissingParentNodes missingParentNodes;
+    auto& rootNode = mt::makeNode(*client, mega::nodetype_t::ROOTNODE, mega::NodeHandle().set6byte(1), nullptr);
+    std::shared_ptr<mega::Node> root(&rootNode);
+    client->mNodeManager.addNode(root, false, true, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(root.get());
+
+    auto& folderNode = mt::makeNode(*client, mega::nodetype_t::FOLDERNODE, mega::NodeHandle().set6byte(2), &rootNode);
+    std::shared_ptr<mega::Node> folder(&folderNode);
+    client->mNodeManager.addNode(folder, true, false, missingParentNodes);
+    client->mNodeManager.saveNodeInDb(folder.get());
+
+    std::vector<std::shared_ptr<mega::Node>> files;
+    for (uint64_t h = 3; h < 6; ++h)
+    {
+        auto& file = mt::makeNode(*client, mega::nodetype_t::FILENODE, mega::NodeHandle().set6byte(h), &folderNode);
+        files.emplace_back(&file);
+        client->mNodeManager.addNode(files.back(), true, false, missingParentNodes);
+        client->mNodeManager.saveNodeInDb(files.back().get());
+    }
+
+    auto table = dynamic_cast<mega::DBTableNodes*>(client->sctable.get());
+    ASSERT_NE(table, nullptr);
+
+    ASSERT_EQ(table->getNumberOfChildren(rootNode.nodeHandle()), 1u);
+    ASSERT_EQ(table->getNumberOfChildren(folderNode.nodeHandle()), 3u);
+
+    // counters written without the rest of the node
+    mega::NodeCounter nc;
+    nc.files = 3;
+    nc.storage = 300;
+    nc.versions = 1;
+    nc.versionStorage = 50;
+    table->updateCounter(folderNode.nodeHandle(), nc.serialize());
+
+    mega::NodeCounter fromDb;
+    ASSERT_TRUE(table->getFolderCounter(folderNode.nodeHandle(), fromDb));
+    ASSERT_EQ(fromDb.files, 3u);
+    ASSERT_EQ(fromDb.storage, 300);
+    ASSERT_EQ(fromDb.versions, 1u);
+    ASSERT_EQ(fromDb.versionStorage, 50);
+    ASSERT_EQ(fromDb.folders, 0u);
+
+    // files have no aggregates
+    ASSERT_FALSE(table->getFolderCounter(files[0]->nodeHandle(), fromDb));
+
+    // rewriting a child doesn't count it twice, moving it counts it at the new parent
+    files[0]->parenthandle = rootNode.nodehandle;
+    ASSERT_TRUE(table->put(files[0].get()));
+    ASSERT_TRUE(table->put(files[1].get()));
+    ASSERT_EQ(table->getNumberOfChildren(rootNode.nodeHandle()), 2u);
+    ASSERT_EQ(table->getNumberOfChildren(folderNode.nodeHandle()), 2u);
+
+    ASSERT_TRUE(table->remove(files[1]->nodeHandle()));
+    ASSERT_EQ(table->getNumberOfChildren(folderNode.nodeHandle()), 1u);
+
+    ASSERT_TRUE(table->removeNodes());
+    ASSERT_FALSE(table->getFolderCounter(folderNode.nodeHandle(), fromDb));
+    ASSERT_EQ(table->getNumberOfChildren(rootNode.nodeHandle()), 0u);
+
+    files.clear();
+    folder.reset();
+    root.reset();
+}
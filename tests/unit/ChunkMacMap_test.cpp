@@ -18,10 +18,137 @@
 
 #include <gtest/gtest.h>
 
+#include <mega/http.h>
 #include <mega/utils.h>
 
 namespace mega {
 
+TEST(ChunkMacMap, chunkIndexMatchesChunkBoundaries)
+{
+    m_off_t pos = 0;
+    for (m_off_t index = 0; index < 20; ++index)
+    {
+        m_off_t next = ChunkedHash::chunkceil(pos);
+        ASSERT_EQ(ChunkedHash::chunkindex(pos), index);
+        ASSERT_EQ(ChunkedHash::chunkindex(next - 1), index);
+        pos = next;
+    }
+}
+
+TEST(ChunkMacMap, lookupsAcrossGaps)
+{
+    byte key[SymmCipher::KEYLENGTH] = {};
+    SymmCipher cipher(key);
+
+    std::vector<m_off_t> chunks;
+    for (m_off_t pos = 0; chunks.size() < 12; pos = ChunkedHash::chunkceil(pos))
+    {
+        chunks.push_back(pos);
+    }
+
+    chunkmac_map macs;
+    for (size_t i : { 0, 1, 2, 5, 9, 10 })
+    {
+        byte data[SymmCipher::BLOCKSIZE] = {};
+        macs.ctr_encrypt(chunks[i], &cipher, data, sizeof(data), chunks[i], 0, true);
+    }
+
+    ASSERT_TRUE(macs.finishedAt(chunks[2]));
+    ASSERT_FALSE(macs.finishedAt(chunks[3]));
+    ASSERT_TRUE(macs.finishedAt(chunks[5]));
+    ASSERT_TRUE(macs.finishedAt(chunks[10]));
+    ASSERT_FALSE(macs.finishedAt(chunks[11]));
+    ASSERT_FALSE(macs.finishedAt(chunks[5] + SymmCipher::BLOCKSIZE));
+
+    ASSERT_EQ(macs.nextUnprocessedPosFrom(chunks[1]), chunks[3]);
+    ASSERT_EQ(macs.nextUnprocessedPosFrom(chunks[9]), chunks[11]);
+    ASSERT_EQ(macs.expandUnprocessedPiece(chunks[6], chunks[6], chunks[11], chunks[11]), chunks[9]);
+}
+
+TEST(ChunkMacMap, macsmacDoesNotDependOnArrivalOrder)
+{
+    byte key[SymmCipher::KEYLENGTH] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+    SymmCipher cipher(key);
+
+    const m_off_t fileSize = 1024 * 1024 * 1024;
+    std::vector<m_off_t> chunks;
+    for (m_off_t pos = 0; chunks.size() < 120; pos = ChunkedHash::chunkceil(pos, fileSize))
+    {
+        chunks.push_back(pos);
+    }
+
+    // the macs only depend on the chunk position and content, a block per chunk is enough here
+    auto addChunk = [&cipher](chunkmac_map& macs, m_off_t pos)
+    {
+        byte data[SymmCipher::BLOCKSIZE] = {};
+        MemAccess::set<int64_t>(data, pos);
+        macs.ctr_encrypt(pos, &cipher, data, sizeof(data), pos, 0x0123456789LL, true);
+    };
+
+    chunkmac_map ordered, shuffled;
+    for (m_off_t pos : chunks)
+    {
+        addChunk(ordered, pos);
+    }
+    for (size_t i = 0; i < chunks.size(); i += 2)
+    {
+        addChunk(shuffled, chunks[chunks.size() - 1 - i]);
+    }
+    for (size_t i = 1; i < chunks.size(); i += 2)
+    {
+        addChunk(shuffled, chunks[chunks.size() - 1 - i]);
+    }
+
+    std::string a, b;
+    ordered.serialize(a);
+    shuffled.serialize(b);
+    ASSERT_EQ(a, b);
+
+    int64_t expected = ordered.macsmac(&cipher);
+    ASSERT_EQ(shuffled.macsmac(&cipher), expected);
+
+    // folding the leading chunks as the download progresses must not change the result
+    ASSERT_EQ(shuffled.updateContiguousProgress(fileSize), chunks.back() + 1024 * 1024);
+    shuffled.updateMacsmacProgress(&cipher);
+    ASSERT_LT(shuffled.size(), chunks.size());
+    ASSERT_EQ(shuffled.macsmac(&cipher), expected);
+}
+
+TEST(ChunkMacMap, uploadPartsMatchWholeEncryption)
+{
+    byte key[SymmCipher::KEYLENGTH] = {};
+    SymmCipher cipher(key);
+
+    // from the start of the file, so the chunks grow, ending within a chunk
+    m_off_t pos = 0;
+    m_off_t npos = 5 * 1024 * 1024 + 12345;
+    std::string data(static_cast<size_t>(npos) + SymmCipher::BLOCKSIZE, 0);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = static_cast<char>(i * 7);
+    }
+
+    HttpReqUL whole;
+    whole.out->assign(data);
+    whole.prepare("http://u", &cipher, 99, pos, npos);
+
+    HttpReqUL inParts;
+    inParts.out->assign(data);
+    unsigned parts = inParts.prepareParts(pos, npos, 3);
+    ASSERT_EQ(parts, 3u);
+    for (unsigned part = parts; part--; )
+    {
+        ASSERT_EQ(inParts.preparePart("http://u", &cipher, 99, pos, npos, part, parts), part == 0);
+    }
+
+    ASSERT_EQ(*inParts.out, *whole.out);
+    ASSERT_EQ(inParts.posturl, whole.posturl);
+
+    std::string a, b;
+    whole.mChunkmacs.serialize(a);
+    inParts.mChunkmacs.serialize(b);
+    ASSERT_EQ(a, b);
+}
 
 }
 
@@ -311,6 +311,68 @@ TEST(Crypto, Ed25519_Signing)
 
 #endif
 
+TEST(Crypto, SymmCipherCache_ReusesAndEvictsLeastRecent)
+{
+    byte fileKey[FILENODEKEYLENGTH];
+    byte n = 0;
+    std::generate(fileKey, fileKey + sizeof(fileKey), [&n]() { return n++; });
+
+    SymmCipher reference;
+    reference.setkey(fileKey, FILENODE);
+
+    SymmCipherCache cache;
+    SymmCipher* cipher = cache.get(fileKey, FILENODE);
+    ASSERT_EQ(memcmp(cipher->key, reference.key, SymmCipher::KEYLENGTH), 0);
+    ASSERT_EQ(cipher, cache.get(fileKey, FILENODE));
+
+    byte block[SymmCipher::BLOCKSIZE] = {};
+    byte expected[SymmCipher::BLOCKSIZE] = {};
+    cipher->ecb_encrypt(block);
+    reference.ecb_encrypt(expected);
+    ASSERT_EQ(memcmp(block, expected, sizeof(block)), 0);
+
+    // as many other keys as entries: the file key was the least recently used one
+    for (unsigned i = 0; i < SymmCipherCache::ENTRIES; ++i)
+    {
+        byte other[SymmCipher::KEYLENGTH];
+        memset(other, static_cast<int>(0x80 + i), sizeof(other));
+        ASSERT_EQ(memcmp(cache.get(other)->key, other, sizeof(other)), 0);
+    }
+    ASSERT_NE(memcmp(cipher->key, reference.key, SymmCipher::KEYLENGTH), 0);
+
+    cipher = cache.get(fileKey, FILENODE);
+    ASSERT_EQ(memcmp(cipher->key, reference.key, SymmCipher::KEYLENGTH), 0);
+}
+
+TEST(Crypto, HashCRC32_MatchesReferenceInAnyChunking)
+{
+    HashCRC32 crc32;
+    byte out[4];
+    crc32.add(reinterpret_cast<const byte*>("123456789"), 9);
+    crc32.get(out);
+    const byte check[4] = { 0x26, 0x39, 0xF4, 0xCB }; // 0xCBF43926, little-endian
+    ASSERT_EQ(memcmp(out, check, sizeof(out)), 0);
+
+    // long enough for the folding path, with a tail and an unaligned start
+    std::vector<byte> data(1000);
+    byte n = 7;
+    std::generate(data.begin(), data.end(), [&n]() { return n = static_cast<byte>(n * 31 + 11); });
+
+    byte whole[4];
+    crc32.add(data.data() + 1, 999);
+    crc32.get(whole);
+    const byte expected[4] = { 0x00, 0x99, 0xFA, 0x7F };
+    ASSERT_EQ(memcmp(whole, expected, sizeof(whole)), 0);
+
+    for (unsigned split : { 1u, 63u, 64u, 100u, 500u })
+    {
+        crc32.add(data.data() + 1, split);
+        crc32.add(data.data() + 1 + split, 999 - split);
+        crc32.get(out);
+        ASSERT_EQ(memcmp(out, whole, sizeof(out)), 0) << split;
+    }
+}
+
 TEST(Crypto, SymmCipher_xorblock_bytes)
 {
     byte src[10] = { (byte)0, (byte)1, (byte)2, (byte)3, (byte)4, (byte)5, (byte)6, (byte)7, (byte)8, (byte)9 };
@@ -358,6 +420,55 @@ TEST(Crypto, SymmCipher_xorblock_block_unaligned)
     ASSERT_EQ(memcmp(dest, result, sizeof(dest)), 0);
 }
 
+// ctr_crypt() must match plain CTR plus a CBC-MAC over the plaintext built from single ECB blocks,
+// whether or not the hardware kernel handles the whole blocks
+TEST(Crypto, SymmCipher_ctr_crypt_matches_ecb)
+{
+    byte key[SymmCipher::KEYLENGTH];
+    byte n = 7;
+    std::generate(key, key + sizeof(key), [&n]() { return n = static_cast<byte>(n * 31 + 5); });
+    SymmCipher cipher(key);
+
+    const SymmCipher::ctr_iv iv = 0x0123456789abcdefULL;
+    const m_off_t pos = 0x1230;
+
+    for (unsigned len : { 0u, 5u, 16u, 48u, 64u, 100u, 1024u, 1037u })
+    {
+        unsigned padded = (len + SymmCipher::BLOCKSIZE - 1) & ~(SymmCipher::BLOCKSIZE - 1);
+        std::vector<byte> plain(padded, 0);
+        std::generate(plain.begin(), plain.begin() + len, [&n]() { return n = static_cast<byte>(n * 13 + 1); });
+
+        // reference
+        std::vector<byte> expected(plain);
+        byte ctr[SymmCipher::BLOCKSIZE], ks[SymmCipher::BLOCKSIZE], expectedmac[SymmCipher::BLOCKSIZE];
+        MemAccess::set<int64_t>(ctr, static_cast<int64_t>(iv));
+        SymmCipher::setint64(pos / SymmCipher::BLOCKSIZE, ctr + sizeof iv);
+        memcpy(expectedmac, ctr, sizeof iv);
+        memcpy(expectedmac + sizeof iv, ctr, sizeof iv);
+        for (unsigned i = 0; i < padded; i += SymmCipher::BLOCKSIZE)
+        {
+            SymmCipher::xorblock(&plain[i], expectedmac);
+            cipher.ecb_encrypt(expectedmac);
+            cipher.ecb_encrypt(ctr, ks);
+            SymmCipher::xorblock(ks, &expected[i]);
+            SymmCipher::incblock(ctr);
+        }
+
+        std::vector<byte> data(plain);
+        byte mac[SymmCipher::BLOCKSIZE];
+        cipher.ctr_crypt(data.data(), len, pos, iv, mac, true);
+        ASSERT_EQ(memcmp(data.data(), expected.data(), padded), 0) << "len " << len;
+        ASSERT_EQ(memcmp(mac, expectedmac, sizeof mac), 0) << "len " << len;
+
+        cipher.ctr_crypt(data.data(), len, pos, iv, mac, false);
+        ASSERT_EQ(memcmp(data.data(), plain.data(), len), 0) << "len " << len;
+        ASSERT_EQ(memcmp(mac, expectedmac, sizeof mac), 0) << "len " << len;
+
+        cipher.ctr_crypt(data.data(), len, pos, iv, nullptr, true);
+        ASSERT_EQ(memcmp(data.data(), expected.data(), len), 0) << "len " << len;
+    }
+}
+
 // Test SymmCipher::isZeroKey
 //
 // Test whether a key is a zerokey or generated with a zerokey
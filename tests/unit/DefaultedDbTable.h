@@ -66,6 +66,10 @@ public:
     {
         return false;
     }
+    bool getVersions(mega::NodeHandle, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>&) override
+    {
+        return false;
+    }
     bool getRootNodes(std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>&) override
     {
         return false;
@@ -81,17 +85,39 @@ public:
     {
         return 0;
     }
-    bool getChildren(const mega::NodeSearchFilter&, int, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>&, mega::CancelToken, const mega::NodeSearchPage&) override
+    bool getChildren(const mega::NodeSearchFilter&, int, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>&, const mega::DBQueryOptions&, const mega::NodeSearchPage&) override
     {
         return false;
         //throw NotImplemented(__func__);
     }
-    bool searchNodes(const mega::NodeSearchFilter&, int, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>&, mega::CancelToken, const mega::NodeSearchPage&) override
+    bool searchNodes(const mega::NodeSearchFilter&, int, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>&, const mega::DBQueryOptions&, const mega::NodeSearchPage&) override
     {
         return false;
         //throw NotImplemented(__func__);
     }
-    bool getAllNodeTags(const std::string&, std::set<std::string>&, mega::CancelToken) override
+    bool getChildrenFrom(const mega::NodeSearchFilter&,
+                         int,
+                         mega::NodeSearchCursor&,
+                         size_t,
+                         size_t,
+                         const std::function<bool(std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>&)>&,
+                         const mega::DBQueryOptions&) override
+    {
+        return false;
+    }
+    bool getSubtree(mega::NodeHandle, int, size_t, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>&, const mega::DBQueryOptions&) override
+    {
+        return false;
+    }
+    bool getNodeNames(std::vector<std::pair<mega::NodeHandle, std::optional<std::string>>>&) override
+    {
+        return false;
+    }
+    bool getFingerprints(const std::function<void(const std::string&)>&) override
+    {
+        return false;
+    }
+    bool getAllNodeTags(const std::string&, std::set<std::string>&, const mega::DBQueryOptions&) override
     {
         return false;
         // throw NotImplemented(__func__);
@@ -123,7 +149,11 @@ public:
     {
         return false;
     }
-    bool isAncestor(mega::NodeHandle, mega::NodeHandle, mega::CancelToken) override
+    bool isAncestor(mega::NodeHandle, mega::NodeHandle, const mega::DBQueryOptions&) override
+    {
+        return false;
+    }
+    bool getFolderCounter(mega::NodeHandle, mega::NodeCounter&) override
     {
         return false;
     }
@@ -147,6 +177,44 @@ public:
     void createIndexes() override
     {
 
+    }
+    void setBulkLoad(bool) override
+    {
+    }
+    mega::DBReadPoolStats getReadPoolStats(bool) override
+    {
+        return {};
+    }
+    bool setFullTextIndex(bool) override
+    {
+        return false;
+    }
+    bool hasFullTextIndex() const override
+    {
+        return false;
+    }
+    void setBlobCompression(bool) override
+    {
+    }
+    mega::DBBlobStats getBlobStats(bool) override
+    {
+        return {};
+    }
+    bool setChangeJournal(bool) override
+    {
+        return false;
+    }
+    bool hasChangeJournal() const override
+    {
+        return false;
+    }
+    bool appendNodeChanges(const std::vector<mega::DBNodeChange>&, uint64_t) override
+    {
+        return false;
+    }
+    bool getNodeChanges(uint64_t, size_t, std::vector<mega::DBNodeChange>&, uint64_t&, uint64_t&) override
+    {
+        return false;
     }
     bool put(uint32_t, char*, unsigned) override
     {
@@ -158,6 +226,10 @@ public:
         return false;
         //throw NotImplemented{__func__};
     }
+    bool put(const std::vector<mega::Node*>&) override
+    {
+        return false;
+    }
     bool del(uint32_t) override
     {
         return false;
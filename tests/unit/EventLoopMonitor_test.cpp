@@ -0,0 +1,108 @@
+/**
+ * @file EventLoopMonitor_test.cpp
+ * @brief Unit tests for the client thread's event loop monitor
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/eventloopmonitor.h>
+
+#include "mega.h"
+
+using namespace mega;
+
+TEST(EventLoopMonitor, CountsNestedPhases)
+{
+    EventLoopMonitor monitor;
+
+    {
+        EventLoopMonitor::Scope exec(monitor, EventLoopMonitor::PHASE_EXEC);
+        EventLoopMonitor::Scope sc(monitor, EventLoopMonitor::PHASE_SC_PROCESSING);
+    }
+    {
+        EventLoopMonitor::Scope wait(monitor, EventLoopMonitor::PHASE_WAIT);
+    }
+
+    EXPECT_EQ(monitor.phaseStats(EventLoopMonitor::PHASE_EXEC).count, 1u);
+    EXPECT_EQ(monitor.phaseStats(EventLoopMonitor::PHASE_SC_PROCESSING).count, 1u);
+    EXPECT_EQ(monitor.phaseStats(EventLoopMonitor::PHASE_WAIT).count, 1u);
+    EXPECT_EQ(monitor.phaseStats(EventLoopMonitor::PHASE_CHECK_EVENTS).count, 0u);
+
+    auto stats = monitor.phaseStats(EventLoopMonitor::PHASE_EXEC);
+    uint64_t bucketed = 0;
+    for (auto n : stats.buckets)
+    {
+        bucketed += n;
+    }
+    EXPECT_EQ(bucketed, 1u);
+    EXPECT_GE(stats.total, stats.longest);
+
+    monitor.reset();
+    EXPECT_EQ(monitor.phaseStats(EventLoopMonitor::PHASE_EXEC).count, 0u);
+}
+
+TEST(EventLoopMonitor, NamesTheLongestTaskOfASlowSlice)
+{
+    EventLoopMonitor monitor;
+    monitor.setSlowThreshold(std::chrono::milliseconds(5));
+
+    // quick, not kept
+    {
+        EventLoopMonitor::Scope exec(monitor, EventLoopMonitor::PHASE_EXEC);
+        EventLoopMonitor::Task task(monitor, "command", "ug");
+    }
+    EXPECT_TRUE(monitor.slowSlices().empty());
+
+    {
+        EventLoopMonitor::Scope exec(monitor, EventLoopMonitor::PHASE_EXEC);
+        {
+            EventLoopMonitor::Task task(monitor, "command", "ug");
+        }
+        {
+            EventLoopMonitor::Scope sc(monitor, EventLoopMonitor::PHASE_SC_PROCESSING);
+            EventLoopMonitor::Task task(monitor, "action packet", MAKENAMEID1('t'));
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    auto slices = monitor.slowSlices();
+    ASSERT_EQ(slices.size(), 1u);
+    EXPECT_EQ(slices[0].phase, EventLoopMonitor::PHASE_EXEC);
+    EXPECT_GE(slices[0].duration, std::chrono::milliseconds(10));
+    EXPECT_EQ(slices[0].taskKind, "action packet");
+    EXPECT_EQ(slices[0].taskName, "t");
+    EXPECT_LE(slices[0].taskDuration, slices[0].duration);
+
+    // the waits don't hold the thread up
+    {
+        EventLoopMonitor::Scope wait(monitor, EventLoopMonitor::PHASE_WAIT);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(monitor.slowSlices().size(), 1u);
+
+    EXPECT_NE(monitor.toJson(true).find("\"taskName\":\"t\""), string::npos);
+    EXPECT_TRUE(monitor.slowSlices().empty());
+
+    monitor.setSlowThreshold(std::chrono::milliseconds(0));
+    {
+        EventLoopMonitor::Scope exec(monitor, EventLoopMonitor::PHASE_EXEC);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(monitor.slowSlices().empty());
+}
@@ -0,0 +1,110 @@
+/**
+ * @file FileAttributeCache_test.cpp
+ * @brief Unit tests for the file attribute cache
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/fileattributecache.h>
+
+#include "mega.h"
+
+using namespace mega;
+
+class FileAttributeCacheTest
+  : public ::testing::Test
+{
+public:
+        FileAttributeCacheTest()
+          : rootPath(LocalPath::fromAbsolutePath("."))
+        {
+            bool result = fsAccess.cwd(rootPath);
+            if (!result)
+                assert(result);
+
+            rootPath.appendWithSeparator(
+                LocalPath::fromRelativePath("fileattributes"), false);
+
+            fsAccess.emptydirlocal(rootPath);
+            fsAccess.rmdirlocal(rootPath);
+        }
+
+        ~FileAttributeCacheTest()
+        {
+            fsAccess.emptydirlocal(rootPath);
+            fsAccess.rmdirlocal(rootPath);
+        }
+
+        FSACCESS_CLASS fsAccess;
+        LocalPath rootPath;
+}; // FileAttributeCacheTest
+
+TEST_F(FileAttributeCacheTest, GetReturnsWhatWasPut)
+{
+    FileAttributeCache cache(fsAccess, rootPath);
+
+    string data;
+    EXPECT_FALSE(cache.get(1, data));
+
+    cache.put(1, "thumbnail");
+    ASSERT_TRUE(cache.get(1, data));
+    EXPECT_EQ(data, "thumbnail");
+    EXPECT_EQ(cache.size(), 9);
+}
+
+TEST_F(FileAttributeCacheTest, EvictsLeastRecentlyUsed)
+{
+    FileAttributeCache cache(fsAccess, rootPath, 20);
+
+    string data;
+    cache.put(1, string(8, 'a'));
+    cache.put(2, string(8, 'b'));
+
+    // 1 is now the most recently used, so 2 makes room for 3
+    ASSERT_TRUE(cache.get(1, data));
+    cache.put(3, string(8, 'c'));
+
+    EXPECT_TRUE(cache.get(1, data));
+    EXPECT_FALSE(cache.get(2, data));
+    EXPECT_TRUE(cache.get(3, data));
+    EXPECT_EQ(cache.size(), 16);
+
+    // never bigger than the capacity
+    cache.put(4, string(21, 'd'));
+    EXPECT_FALSE(cache.get(4, data));
+}
+
+TEST_F(FileAttributeCacheTest, SurvivesRestart)
+{
+    {
+        FileAttributeCache cache(fsAccess, rootPath);
+        cache.put(0x0123456789abcdefULL, "preview");
+    }
+
+    FileAttributeCache cache(fsAccess, rootPath);
+
+    string data;
+    ASSERT_TRUE(cache.get(0x0123456789abcdefULL, data));
+    EXPECT_EQ(data, "preview");
+    EXPECT_EQ(cache.size(), 7);
+
+    cache.clear();
+    EXPECT_FALSE(cache.get(0x0123456789abcdefULL, data));
+    EXPECT_EQ(cache.size(), 0);
+}
@@ -24,6 +24,7 @@
 #include <gtest/gtest.h>
 
 #include <mega/filefingerprint.h>
+#include <mega/filesystem.h>
 
 #include "DefaultedFileAccess.h"
 
@@ -363,6 +364,70 @@ TEST(FileFingerprint, serializefingerprint_unserializefingerprint)
     ASSERT_EQ(ffp2.isvalid, ffp.isvalid);
 }
 
+TEST(FileFingerprint, FingerprintCache_reusesSameFsidSizeAndMtime)
+{
+    mega::FileFingerprint ffp;
+    ffp.size = 100;
+    ffp.mtime = 200;
+    std::iota(ffp.crc.begin(), ffp.crc.end(), 3);
+    ffp.isvalid = true;
+
+    mega::FingerprintCache cache;
+    cache.add(7, ffp);
+
+    // moved elsewhere, unchanged
+    mega::FSNode node;
+    node.type = mega::FILENODE;
+    node.fsid = 7;
+    node.fingerprint.size = 100;
+    node.fingerprint.mtime = 200;
+    ASSERT_TRUE(cache.reuse(node));
+    ASSERT_EQ(node.fingerprint, ffp);
+    ASSERT_TRUE(node.fingerprint.isvalid);
+
+    // modified
+    node.fingerprint = mega::FileFingerprint();
+    node.fingerprint.size = 101;
+    node.fingerprint.mtime = 200;
+    ASSERT_FALSE(cache.reuse(node));
+    ASSERT_FALSE(node.fingerprint.isvalid);
+
+    // a different file
+    node.fsid = 8;
+    node.fingerprint.size = 100;
+    ASSERT_FALSE(cache.reuse(node));
+
+    // folders are never fingerprinted
+    node.fsid = 7;
+    node.type = mega::FOLDERNODE;
+    ASSERT_FALSE(cache.reuse(node));
+}
+
+TEST(FileFingerprint, FingerprintCache_dropsOldestEntries)
+{
+    mega::FileFingerprint ffp;
+    ffp.size = 1;
+    ffp.mtime = 2;
+    ffp.isvalid = true;
+
+    mega::FingerprintCache cache;
+    for (mega::handle fsid = 0; fsid <= mega::FingerprintCache::MAX_ENTRIES; ++fsid)
+    {
+        cache.add(fsid, ffp);
+    }
+
+    mega::FSNode node;
+    node.type = mega::FILENODE;
+    node.fingerprint.size = 1;
+    node.fingerprint.mtime = 2;
+
+    node.fsid = 0;
+    ASSERT_FALSE(cache.reuse(node));
+
+    node.fsid = 1;
+    ASSERT_TRUE(cache.reuse(node));
+}
+
 //TEST(FileFingerprint, genfingerprint_FileAccess_forTinyFile)
 //{
 //    mega::FileFingerprint ffp;
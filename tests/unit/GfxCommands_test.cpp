@@ -3,12 +3,15 @@
 #include "mega/gfx/worker/commands.h"
 #include "mega/gfx/worker/comms.h"
 
+#include <algorithm>
 #include <chrono>
 
 using mega::GfxDimension;
 using mega::gfx::CommandHello;
 using mega::gfx::CommandHelloResponse;
 using mega::gfx::CommandNewGfx;
+using mega::gfx::CommandNewGfxBatch;
+using mega::gfx::CommandNewGfxBatchResponse;
 using mega::gfx::CommandNewGfxResponse;
 using mega::gfx::CommandSerializer;
 using mega::gfx::CommandShutDown;
@@ -34,6 +37,17 @@ namespace gfx
         return lhs.ErrorCode == rhs.ErrorCode && lhs.ErrorText == rhs.ErrorText && lhs.Images == rhs.Images;
     }
 
+    bool operator==(const CommandNewGfxBatch& lhs, const CommandNewGfxBatch& rhs)
+    {
+        return std::equal(lhs.Tasks.begin(), lhs.Tasks.end(), rhs.Tasks.begin(), rhs.Tasks.end(),
+                          [](const GfxTask& l, const GfxTask& r) { return l.Path == r.Path && l.Dimensions == r.Dimensions; });
+    }
+
+    bool operator==(const CommandNewGfxBatchResponse& lhs, const CommandNewGfxBatchResponse& rhs)
+    {
+        return lhs.Index == rhs.Index && lhs.ErrorCode == rhs.ErrorCode && lhs.ErrorText == rhs.ErrorText && lhs.Images == rhs.Images;
+    }
+
     bool operator==(const CommandShutDown& /*lhs*/, const CommandShutDown& /*rhs*/)
     {
         return true;
@@ -214,3 +228,55 @@ TEST(GfxCommandSerializer, CommandSupportFormatsResponseSerializeAndUnserializeS
     ASSERT_NE(targetCommand, nullptr);
     ASSERT_EQ(sourceCommand, *targetCommand);
 }
+
+TEST(GfxCommandSerializer, CommandNewGfxBatchSerializeAndUnserializeSuccessfully)
+{
+    CommandNewGfxBatch sourceCommand;
+    sourceCommand.Tasks.resize(2);
+    sourceCommand.Tasks[0].Path = "c:\\path\\image.png";
+    sourceCommand.Tasks[0].Dimensions = std::vector<GfxDimension>{ {1000, 1000}, {200, 0} };
+    sourceCommand.Tasks[1].Path = "c:\\path\\video.mp4";
+    sourceCommand.Tasks[1].Dimensions = std::vector<GfxDimension>{ {200, 0} };
+
+    auto data = CommandSerializer::serialize(&sourceCommand);
+    ASSERT_NE(data, nullptr);
+
+    StringReader reader(std::move(*data));
+    auto command = CommandSerializer::unserialize(reader, 5000ms);
+    ASSERT_NE(command, nullptr);
+    auto targetCommand = dynamic_cast<CommandNewGfxBatch*>(command.get());
+    ASSERT_NE(targetCommand, nullptr);
+    ASSERT_EQ(sourceCommand, *targetCommand);
+}
+
+TEST(GfxCommandSerializer, CommandNewGfxBatchWithEmptyDimensionsIsRejected)
+{
+    CommandNewGfxBatch sourceCommand;
+    sourceCommand.Tasks.resize(1);
+    sourceCommand.Tasks[0].Path = "c:\\path\\image.png";
+
+    auto data = CommandSerializer::serialize(&sourceCommand);
+    ASSERT_NE(data, nullptr);
+
+    StringReader reader(std::move(*data));
+    ASSERT_EQ(CommandSerializer::unserialize(reader, 5000ms), nullptr);
+}
+
+TEST(GfxCommandSerializer, CommandNewGfxBatchResponseSerializeAndUnserializeSuccessfully)
+{
+    CommandNewGfxBatchResponse sourceCommand;
+    sourceCommand.Index = 3;
+    sourceCommand.ErrorCode = 0;
+    sourceCommand.ErrorText = "OK";
+    sourceCommand.Images.push_back("imagedata");
+
+    auto data = CommandSerializer::serialize(&sourceCommand);
+    ASSERT_NE(data, nullptr);
+
+    StringReader reader(std::move(*data));
+    auto command = CommandSerializer::unserialize(reader, 5000ms);
+    ASSERT_NE(command, nullptr);
+    auto targetCommand = dynamic_cast<CommandNewGfxBatchResponse*>(command.get());
+    ASSERT_NE(targetCommand, nullptr);
+    ASSERT_EQ(sourceCommand, *targetCommand);
+}
@@ -517,3 +517,112 @@ TEST(Logging, Extract_file_name_from_full_path)
     ASSERT_EQ(0, strcmp(::mega::log_file_leafname("include/mega/logging.h"), "logging.h"));
     ASSERT_EQ(0, strcmp(::mega::log_file_leafname("include\\mega\\logging.h"), "logging.h" ));
 }
+
+namespace {
+
+class CollectingLogger : public mega::Logger
+{
+public:
+    void log(const char*, int loglevel, const char*, const char *message
+#ifdef ENABLE_LOG_PERFORMANCE
+             , const char **, size_t *, unsigned
+#endif
+             ) override
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mLevels.push_back(loglevel);
+        mMessages.push_back(message);
+    }
+
+    std::mutex mMutex;
+    std::vector<int> mLevels;
+    std::vector<std::string> mMessages;
+};
+
+void asyncLog(mega::AsyncLogger& logger, mega::LogLevel level, const std::string& message)
+{
+    logger.log(nullptr, level, nullptr, message.c_str()
+#ifdef ENABLE_LOG_PERFORMANCE
+               , nullptr, nullptr, 0
+#endif
+               );
+}
+
+}
+
+TEST(Logging, asyncLogger_deliversInOrderPerThread)
+{
+    CollectingLogger target;
+    mega::AsyncLogger logger;
+    logger.setTarget(&target);
+
+    auto produce = [&logger](char id)
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            asyncLog(logger, mega::logDebug, std::string(1, id) + std::to_string(i));
+        }
+    };
+
+    std::thread a(produce, 'a');
+    std::thread b(produce, 'b');
+    a.join();
+    b.join();
+    logger.flush();
+
+    ASSERT_EQ(logger.dropped(), 0u);
+    ASSERT_EQ(target.mMessages.size(), 2000u);
+
+    int next[2] = {0, 0};
+    for (auto& message : target.mMessages)
+    {
+        int& expected = next[message[0] - 'a'];
+        EXPECT_EQ(message.substr(1), std::to_string(expected++));
+    }
+}
+
+TEST(Logging, asyncLogger_countsDroppedMessages)
+{
+    CollectingLogger target;
+
+    // no target yet: nothing is drained and the smallest ring fills up
+    mega::AsyncLogger logger(4096);
+    const std::string message(100, 'x');
+    for (int i = 0; i < 100; ++i)
+    {
+        asyncLog(logger, mega::logInfo, message);
+    }
+    ASSERT_GT(logger.dropped(), 0u);
+    uint64_t dropped = logger.dropped();
+
+    logger.setTarget(&target);
+    logger.flush();
+
+    ASSERT_EQ(target.mMessages.size(), 100 - dropped + 1);
+    EXPECT_EQ(target.mLevels.back(), mega::logWarning);
+    EXPECT_NE(target.mMessages.back().find(std::to_string(dropped) + " log messages dropped"), std::string::npos);
+}
+
+TEST(Logging, levelsLeftOutAreNotEvaluated)
+{
+    const auto level = mega::SimpleLogger::getLogLevel();
+    int evaluated = 0;
+    auto evaluate = [&evaluated]() { return ++evaluated; };
+
+    mega::SimpleLogger::setLogLevel(mega::logMax);
+
+    // as in a translation unit built with its debug messages compiled out
+#undef MEGA_LOG_UNIT_MAX_LEVEL
+#define MEGA_LOG_UNIT_MAX_LEVEL 3
+    LOG_debug << evaluate();
+    LOG_info << evaluate();
+#undef MEGA_LOG_UNIT_MAX_LEVEL
+#define MEGA_LOG_UNIT_MAX_LEVEL MEGA_LOG_MAX_LEVEL
+
+    // and below the level set
+    mega::SimpleLogger::setLogLevel(mega::logError);
+    LOG_info << evaluate();
+
+    mega::SimpleLogger::setLogLevel(level);
+    EXPECT_EQ(evaluated, MEGA_LOG_MAX_LEVEL >= mega::logInfo ? 1 : 0);
+}
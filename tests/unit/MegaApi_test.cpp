@@ -487,3 +487,46 @@ TEST(MegaApi, MegaApiImpl_calcRecommendedProLevel)
     ASSERT_EQ(test(MegaAccountDetails::ACCOUNT_TYPE_BUSINESS, gb), MegaAccountDetails::ACCOUNT_TYPE_BUSINESS);
     ASSERT_EQ(test(MegaAccountDetails::ACCOUNT_TYPE_PRO_FLEXI, gb), MegaAccountDetails::ACCOUNT_TYPE_PRO_FLEXI);
 }
+
+#ifdef HAVE_LIBUV
+TEST(MegaApi, StreamingBufferController_followsDrainRate)
+{
+    const size_t MB = 1024 * 1024;
+    StreamingBufferController controller(2 * MB, 64 * MB);
+
+    // the client's pace isn't known yet
+    ASSERT_EQ(controller.queueSize(0.5, 0), 64 * MB);
+
+    // 1 MB every 100 ms
+    auto now = std::chrono::steady_clock::now();
+    for (int i = 0; i < 20; ++i)
+    {
+        controller.onDrained(MB, false, now);
+        now += std::chrono::milliseconds(100);
+    }
+    ASSERT_NEAR(controller.drainRate(), 10.0 * MB, 0.5 * MB);
+
+    // 10 MB/s for the latency and the margin, with a read fast enough
+    size_t size = controller.queueSize(0.5, 100.0 * MB);
+    ASSERT_GT(size, 14 * MB);
+    ASSERT_LT(size, 16 * MB);
+
+    // a read barely keeping up may buffer as much as allowed
+    ASSERT_EQ(controller.queueSize(0.5, 11.0 * MB), 64 * MB);
+
+    // running dry widens the margin, pausing with a full queue shrinks it back
+    controller.onDrained(MB, true, now);
+    ASSERT_DOUBLE_EQ(controller.marginSeconds(), 2 * StreamingBufferController::MIN_MARGIN);
+    ASSERT_GT(controller.queueSize(0.5, 100.0 * MB), size);
+    for (int i = 0; i < 20; ++i)
+    {
+        controller.onPaused();
+    }
+    ASSERT_DOUBLE_EQ(controller.marginSeconds(), StreamingBufferController::MIN_MARGIN);
+
+    // a client pausing for a while doesn't count as a slow one
+    now += std::chrono::seconds(30);
+    controller.onDrained(MB, false, now);
+    ASSERT_NEAR(controller.drainRate(), 10.0 * MB, 0.5 * MB);
+}
+#endif
@@ -0,0 +1,104 @@
+/**
+ * @file Metrics_test.cpp
+ * @brief Unit tests for the metrics registry and its export
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/metrics.h>
+
+#include <thread>
+
+using namespace mega;
+
+TEST(MetricHistogram, BucketsWithinASixteenth)
+{
+    for (uint64_t value : {0ull, 1ull, 15ull, 16ull, 17ull, 31ull, 32ull, 33ull, 1000ull, 123456789ull, (1ull << 40) - 1})
+    {
+        size_t bucket = MetricHistogram::bucketOf(value);
+        ASSERT_LT(bucket, MetricHistogram::BUCKETS);
+
+        uint64_t limit = MetricHistogram::bucketLimit(bucket);
+        EXPECT_GE(limit, value);
+        EXPECT_LE(limit - value, value / MetricHistogram::SUB_BUCKETS);
+
+        // the bucket before ends below the value
+        if (bucket)
+        {
+            EXPECT_LT(MetricHistogram::bucketLimit(bucket - 1), value);
+        }
+    }
+
+    EXPECT_EQ(MetricHistogram::bucketOf(uint64_t(1) << 50), MetricHistogram::BUCKETS - 1);
+}
+
+TEST(MetricHistogram, Quantiles)
+{
+    MetricHistogram histogram("test_values", "Values");
+    for (uint64_t i = 1; i <= 1000; ++i)
+    {
+        histogram.record(i);
+    }
+
+    auto s = histogram.snapshot();
+    EXPECT_EQ(s.count, 1000u);
+    EXPECT_EQ(s.sum, 500500u);
+    EXPECT_NEAR(static_cast<double>(s.quantile(0.5)), 500, 500 / 16.0);
+    EXPECT_NEAR(static_cast<double>(s.quantile(0.99)), 990, 990 / 16.0);
+    EXPECT_EQ(s.countUpTo(0), 0u);
+    EXPECT_EQ(s.countUpTo(15), 15u);
+    EXPECT_EQ(s.countUpTo(uint64_t(1) << 40), 1000u);
+}
+
+TEST(MetricsRegistry, ExportsRegisteredMetrics)
+{
+    MetricsRegistry registry;
+
+    MetricCounter a("test_requests_total", "Requests", "client=\"0\"");
+    MetricCounter b("test_requests_total", "Requests", "client=\"1\"");
+    MetricGauge gauge("test_queued", "Queued");
+    MetricHistogram histogram("test_milliseconds", "Milliseconds");
+
+    {
+        MetricsRegistration registration({&a, &b, &gauge, &histogram}, registry);
+
+        std::thread other([&]() { a.add(5); });
+        b.add();
+        other.join();
+        gauge.set(-3);
+        histogram.record(2);
+        histogram.record(100);
+
+        auto text = registry.exportText();
+
+        // one family per name, whatever the number of instances
+        EXPECT_EQ(text.find("# TYPE test_requests_total counter"), text.rfind("# TYPE test_requests_total counter"));
+        EXPECT_NE(text.find("test_requests_total{client=\"0\"} 5\n"), std::string::npos);
+        EXPECT_NE(text.find("test_requests_total{client=\"1\"} 1\n"), std::string::npos);
+        EXPECT_NE(text.find("# TYPE test_queued gauge\ntest_queued -3\n"), std::string::npos);
+        EXPECT_NE(text.find("test_milliseconds_bucket{le=\"1\"} 0\n"), std::string::npos);
+        EXPECT_NE(text.find("test_milliseconds_bucket{le=\"3\"} 1\n"), std::string::npos);
+        EXPECT_NE(text.find("test_milliseconds_bucket{le=\"127\"} 2\n"), std::string::npos);
+        EXPECT_NE(text.find("test_milliseconds_bucket{le=\"+Inf\"} 2\n"), std::string::npos);
+        EXPECT_NE(text.find("test_milliseconds_sum 102\n"), std::string::npos);
+        EXPECT_NE(text.find("test_milliseconds_count 2\n"), std::string::npos);
+    }
+
+    EXPECT_TRUE(registry.exportText().empty());
+}
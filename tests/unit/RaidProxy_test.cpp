@@ -0,0 +1,56 @@
+/**
+ * (c) 2024 by Mega Limited, Wellsford, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/raidproxy.h>
+
+#include <random>
+
+namespace mega {
+
+TEST(RaidProxy, recoverLinesRebuildsEachMissingSector)
+{
+    constexpr m_off_t NUMLINES = 257;
+
+    std::mt19937 rng(42);
+    std::unique_ptr<byte[]> data(new byte[NUMLINES * RAIDLINE]);
+    std::unique_ptr<byte[]> parity(new byte[NUMLINES * RAIDSECTOR]());
+
+    for (m_off_t i = 0; i < NUMLINES * RAIDLINE; ++i)
+    {
+        data[i] = static_cast<byte>(rng());
+        parity[(i / RAIDLINE) * RAIDSECTOR + i % RAIDSECTOR] ^= data[i];
+    }
+
+    const std::vector<byte> original(data.get(), data.get() + NUMLINES * RAIDLINE);
+
+    for (unsigned missing = 0; missing < EFFECTIVE_RAIDPARTS; ++missing)
+    {
+        for (m_off_t line = 0; line < NUMLINES; ++line)
+        {
+            memset(data.get() + line * RAIDLINE + missing * RAIDSECTOR, 0xAA, RAIDSECTOR);
+        }
+
+        RaidProxy::recoverLines(data.get(), parity.get(), NUMLINES, missing);
+
+        ASSERT_TRUE(std::equal(original.begin(), original.end(), data.get())) << "missing sector " << missing;
+    }
+}
+
+} // namespace mega
@@ -17,6 +17,9 @@
  */
 
 #include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
 #include <memory>
 #include <numeric>
 #include <thread>
@@ -39,6 +42,212 @@ TEST(Serialization, JSON_storeobject)
     j.storeobject(&in_str);
 }
 
+TEST(Serialization, JSON_storeobjectSkipsEscapes)
+{
+    const std::string in_str(R"({"a":"x\"}y","b":[1,{"c":"\\"}],"d":"\\\""},"next")");
+    mega::JSON j(in_str);
+    std::string object;
+    ASSERT_TRUE(j.storeobject(&object));
+    ASSERT_EQ(object, R"({"a":"x\"}y","b":[1,{"c":"\\"}],"d":"\\\""})");
+    ASSERT_STREQ(j.pos, R"(,"next")");
+
+    // unterminated strings
+    mega::JSON unterminated(R"({"a":"x\")");
+    ASSERT_FALSE(unterminated.storeobject());
+}
+
+TEST(Serialization, JSON_scanString)
+{
+    // every alignment of the start and of the character found
+    std::string text(100, 'a');
+    for (char c : {'"', '\\', '\0'})
+    {
+        for (size_t at = 0; at < 70; ++at)
+        {
+            std::string data = text;
+            data[at] = c;
+            for (size_t start = 0; start <= at; ++start)
+            {
+                ASSERT_EQ(mega::JSON::scanString(data.c_str() + start), data.c_str() + at);
+            }
+        }
+    }
+    ASSERT_EQ(mega::JSON::scanString(text.c_str()), text.c_str() + text.size());
+}
+
+TEST(Serialization, NameIdDispatch_mapsFieldsToPositions)
+{
+    using namespace mega;
+    static constexpr NameIdDispatch fields{'h', 'p', name_id::u, MAKENAMEID3('s', 't', 's'),
+                                           MAKENAMEID8('+', 'p', 'u', 'E', 'd', '2', '5', '5'),
+                                           EOO};
+    static_assert(fields.valid(), "");
+    static_assert(fields('p') == 1, "");
+
+    ASSERT_EQ(fields.size(), 6u);
+    ASSERT_EQ(fields('h'), 0u);
+    ASSERT_EQ(fields(name_id::u), 2u);
+    ASSERT_EQ(fields(MAKENAMEID3('s', 't', 's')), 3u);
+    ASSERT_EQ(fields(MAKENAMEID8('+', 'p', 'u', 'E', 'd', '2', '5', '5')), 4u);
+    ASSERT_EQ(fields(EOO), 5u);
+
+    // names outside the set, parsed from JSON as readnode() does
+    JSON json("{\"h\":1,\"ts\":2,\"st\":3,\"sts\":4}");
+    json.enterobject();
+    std::vector<size_t> positions;
+    nameid name;
+    while ((name = json.getnameid()) != EOO)
+    {
+        positions.push_back(fields(name));
+        ASSERT_TRUE(json.storeobject());
+    }
+    ASSERT_EQ(positions, (std::vector<size_t>{0, fields.size(), fields.size(), 3}));
+}
+
+// Throughput of storeobject() over a fetchnodes-like response, or over the recorded response at
+// the file pointed by MEGA_JSON_BENCHMARK_FILE. Run with --gtest_also_run_disabled_tests
+TEST(Serialization, DISABLED_JSON_storeobjectThroughput)
+{
+    std::string response;
+    if (const char* file = getenv("MEGA_JSON_BENCHMARK_FILE"))
+    {
+        std::ifstream in(file, std::ios::binary);
+        ASSERT_TRUE(in) << "Unable to read " << file;
+        response.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    else
+    {
+        response = "{\"f\":[";
+        for (int i = 0; i < 200000; ++i)
+        {
+            response += (i ? ",{" : "{");
+            response += "\"h\":\"" + std::to_string(100000000 + i) + "\",\"p\":\"abcdefgh\",\"u\":\"QWERTYUIOPa\","
+                        "\"t\":0,\"a\":\"" + std::string(120 + i % 64, 'A') + "\","
+                        "\"k\":\"QWERTYUIOPa:" + std::string(43, 'k') + "\",\"s\":" + std::to_string(i * 1000) +
+                        ",\"ts\":1700000000}";
+        }
+        response += "]}";
+    }
+
+    constexpr int rounds = 10;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        mega::JSON j(response);
+        ASSERT_TRUE(j.storeobject());
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "storeobject(): " << (static_cast<double>(response.size()) * rounds / elapsed.count() / (1 << 20))
+              << " MiB/s over " << response.size() << " bytes" << std::endl;
+}
+
+TEST(Serialization, Base64_roundTrip)
+{
+    // lengths around the sizes of the vector blocks, from every offset of the buffers
+    std::string binary;
+    for (int i = 0; i < 300; ++i)
+    {
+        binary += static_cast<char>(i * 131 + 7);
+    }
+
+    for (size_t offset = 0; offset < 4; ++offset)
+    {
+        for (size_t size = 0; size + offset <= binary.size(); size += (size < 100 ? 1 : 13))
+        {
+            const std::string in = binary.substr(offset, size);
+            const std::string encoded = mega::Base64::btoa(in);
+            ASSERT_EQ(encoded.size(), (size * 4 + 2) / 3);
+            ASSERT_EQ(encoded.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"),
+                      std::string::npos);
+            ASSERT_EQ(mega::Base64::atob(encoded), in) << size;
+
+            // decoding stops at the first character that isn't base64
+            if (size > 40)
+            {
+                std::string cut = encoded;
+                cut[36] = '=';
+                ASSERT_EQ(mega::Base64::atob(cut), in.substr(0, 27));
+            }
+        }
+    }
+
+    ASSERT_EQ(mega::Base64::btoa(std::string("\xfb\xff\xfe")), "-__-");
+    ASSERT_EQ(mega::Base64::atob(std::string("-__-")), mega::Base64::atob(std::string("+//+")));
+}
+
+TEST(Serialization, Base64_handle)
+{
+    mega::handle h = 0;
+    ASSERT_TRUE(mega::Base64::atob("AQIDBAUG", h, 6));
+    ASSERT_EQ(h, mega::MemAccess::get<mega::handle>("\x01\x02\x03\x04\x05\x06\x00\x00"));
+
+    // too short, too long, or not base64
+    ASSERT_FALSE(mega::Base64::atob("AQIDBA", h, 6));
+    ASSERT_FALSE(mega::Base64::atob("AQIDBAUGBw", h, 6));
+    ASSERT_FALSE(mega::Base64::atob("!QIDBAUG", h, 6));
+
+    mega::NodeHandle nh;
+    ASSERT_TRUE(mega::Base64::atob("AQIDBAUG\"", nh));
+    ASSERT_EQ(nh, h);
+
+    mega::JSON json("[\"AQIDBAUG\",\"AQIDBAUGBwg\",\"AQIDBAUGBwg\"]");
+    ASSERT_TRUE(json.enterarray());
+    ASSERT_EQ(json.gethandle(6), h);
+    ASSERT_EQ(json.gethandle(6), mega::UNDEF);
+    ASSERT_NE(json.gethandle(8), mega::UNDEF);
+    ASSERT_TRUE(json.leavearray());
+}
+
+// Throughput of Base64 encoding and decoding of keys and attributes. Run with --gtest_also_run_disabled_tests
+TEST(Serialization, DISABLED_Base64_throughput)
+{
+    std::string binary(1 << 20, '\0');
+    for (size_t i = 0; i < binary.size(); ++i)
+    {
+        binary[i] = static_cast<char>(i * 131);
+    }
+
+    using seconds = std::chrono::duration<double>;
+    constexpr int rounds = 100;
+    std::string encoded;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        mega::Base64::btoa(binary, encoded);
+    }
+    const seconds encoding = std::chrono::steady_clock::now() - start;
+
+    std::string decoded;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        mega::Base64::atob(encoded, decoded);
+    }
+    const seconds decoding = std::chrono::steady_clock::now() - start;
+    ASSERT_EQ(decoded, binary);
+
+    // node handles, each one followed by its closing quote as in JSON::gethandle()
+    std::string handleList;
+    for (size_t i = 0; i < 1024; ++i)
+    {
+        handleList += encoded.substr(i * 8, 8) + '"';
+    }
+
+    constexpr int handles = 1000000;
+    mega::handle h = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < handles; ++i)
+    {
+        ASSERT_TRUE(mega::Base64::atob(handleList.c_str() + (i & 1023) * 9, h, 6));
+    }
+    const seconds handleDecoding = std::chrono::steady_clock::now() - start;
+
+    const double mib = static_cast<double>(binary.size()) * rounds / (1 << 20);
+    std::cout << "btoa(): " << mib / encoding.count() << " MiB/s, atob(): " << mib / decoding.count()
+              << " MiB/s, handles: " << handles / handleDecoding.count() / 1e6 << " M/s" << std::endl;
+}
+
 // Test 64-bit int serialization/unserialization
 TEST(Serialization, Serialize64_serialize)
 {
@@ -568,3 +777,20 @@ TEST(Serialization, Node_forFolder_withoutShares_32bit)
     auto dn = client.cli->mNodeManager.getNodeFromBlob(&data);
     checkDeserializedNode(*dn, *n, true);
 }
+
+TEST(Serialization, CachedContentHash)
+{
+    const std::string hash(32, '\x5a');
+    const mega::CachedContentHash entry(hash, ::mega::NodeHandle().set6byte(0x123456789aULL));
+
+    std::string data;
+    ASSERT_TRUE(entry.serialize(&data));
+
+    auto read = mega::CachedContentHash::unserialize(data);
+    ASSERT_TRUE(read);
+    ASSERT_EQ(read->mHash, hash);
+    ASSERT_EQ(read->mHandle, entry.mHandle);
+
+    data.pop_back();
+    ASSERT_FALSE(mega::CachedContentHash::unserialize(data));
+}
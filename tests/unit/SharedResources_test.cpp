@@ -0,0 +1,137 @@
+/**
+ * @file SharedResources_test.cpp
+ * @brief Unit tests for the worker pools shared between clients
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/sharedresources.h>
+
+#include "mega.h"
+
+#include <future>
+
+using namespace mega;
+
+TEST(SharedWorkerPool, LanesTakeTurns)
+{
+    auto pool = std::make_shared<SharedWorkerPool>(1);
+
+    std::mutex m;
+    std::string order;
+    auto record = [&](char c) { return [&, c]() { std::lock_guard<std::mutex> g(m); order += c; }; };
+
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> blocking;
+
+    {
+        SharedWorkerPool::Lane a(pool, 1);
+        SharedWorkerPool::Lane b(pool, 1);
+
+        // keep the only worker busy while both lanes queue up
+        a.push([&]() { blocking.set_value(); released.wait(); }, false);
+        blocking.get_future().wait();
+
+        for (int i = 0; i < 3; ++i)
+        {
+            a.push(record('a'), false);
+        }
+        b.push(record('b'), false);
+        release.set_value();
+
+        // the lanes wait for their jobs as they go
+    }
+
+    EXPECT_EQ(order, "baaa");
+}
+
+TEST(SharedWorkerPool, ClearedAndLimitedLanes)
+{
+    auto pool = std::make_shared<SharedWorkerPool>(4);
+
+    std::atomic<int> running{0};
+    std::atomic<int> mostRunning{0};
+    std::atomic<int> done{0};
+
+    {
+        SharedWorkerPool::Lane lane(pool, 2);
+        EXPECT_EQ(lane.threadCount(), 2u);
+
+        for (int i = 0; i < 20; ++i)
+        {
+            lane.push([&]()
+            {
+                int now = ++running;
+                for (int most = mostRunning; now > most && !mostRunning.compare_exchange_weak(most, now); );
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                --running;
+                ++done;
+            }, false);
+        }
+    }
+
+    EXPECT_EQ(done, 20);
+    EXPECT_LE(mostRunning, 2);
+
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> blocking;
+    bool discardedRan = false;
+    bool keptRan = false;
+
+    {
+        SharedWorkerPool::Lane lane(pool, 1);
+        lane.push([&]() { blocking.set_value(); released.wait(); }, false);
+        blocking.get_future().wait();
+
+        lane.push([&]() { discardedRan = true; }, true);
+        lane.push([&]() { keptRan = true; }, false);
+        lane.clear(true);
+        release.set_value();
+    }
+
+    EXPECT_FALSE(discardedRan);
+    EXPECT_TRUE(keptRan);
+}
+
+TEST(SharedWorkerPool, UrgentJobsGoFirst)
+{
+    auto pool = std::make_shared<SharedWorkerPool>(1);
+
+    std::string order;
+    auto record = [&](char c) { return [&, c]() { order += c; }; };
+
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> blocking;
+
+    {
+        SharedWorkerPool::Lane lane(pool, 1);
+        lane.push([&]() { blocking.set_value(); released.wait(); }, false);
+        blocking.get_future().wait();
+
+        lane.push(record('n'), false);
+        lane.push(record('m'), false);
+        lane.push(record('u'), false, true);
+        release.set_value();
+    }
+
+    EXPECT_EQ(order, "unm");
+}
@@ -662,6 +662,7 @@ TEST_F(SyncConfigIOContextTest, Serialize)
         config.mWarning = LOCAL_IS_FAT;
         config.mSyncType = SyncConfig::TYPE_BACKUP;
         config.mBackupState = SYNC_BACKUP_MIRROR;
+        config.mBackgroundIO = false;
 
         written.emplace_back(config);
     }
@@ -695,6 +696,7 @@ TEST_F(SyncConfigIOContextTest, Serialize)
         EXPECT_EQ(a.mWarning, b.mWarning);
         EXPECT_EQ(a.mSyncType, b.mSyncType);
         EXPECT_EQ(a.mBackupState, b.mBackupState);
+        EXPECT_EQ(a.mBackgroundIO, b.mBackgroundIO);
     }
 }
 
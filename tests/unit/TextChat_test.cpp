@@ -120,4 +120,39 @@ TEST(TextChat, unserialize_32bit)
     auto newTc = mega::TextChat::unserialize(client.get(), &d);
     checkTextChats(tc, *newTc);
 }
+
+TEST(TextChat, serialize_unserialize_scheduled_meetings)
+{
+    mega::MegaApp app;
+    auto client = mt::makeClient(app);
+
+    mega::TextChat tc(true);
+    tc.setChatId(1);
+    tc.setOwnPrivileges(mega::PRIV_STANDARD);
+    tc.addUserPrivileges(3, mega::PRIV_MODERATOR);
+    for (mega::handle schedId = 10; schedId < 13; ++schedId)
+    {
+        ASSERT_TRUE(tc.addSchedMeeting(std::make_unique<mega::ScheduledMeeting>(1, "Europe/Madrid", 100, 200, "title", "description", 3, schedId), false));
+    }
+
+    std::string d;
+    ASSERT_TRUE(tc.serialize(&d));
+
+    // serialized again before the meetings are looked at, the record doesn't change
+    auto newTc = mega::TextChat::unserialize(client.get(), &d);
+    ASSERT_NE(newTc, nullptr);
+    std::string d2;
+    ASSERT_TRUE(newTc->serialize(&d2));
+    EXPECT_EQ(d, d2);
+
+    ASSERT_EQ(newTc->getSchedMeetings().size(), 3u);
+    EXPECT_TRUE(newTc->hasScheduledMeeting(11));
+    ASSERT_NE(newTc->getSchedMeetingById(12), nullptr);
+    EXPECT_EQ(newTc->getSchedMeetingById(12)->title(), "title");
+
+    EXPECT_TRUE(newTc->removeSchedMeeting(10));
+    std::string d3;
+    ASSERT_TRUE(newTc->serialize(&d3));
+    EXPECT_LT(d3.size(), d2.size());
+}
 #endif
@@ -0,0 +1,116 @@
+/**
+ * @file Tracing_test.cpp
+ * @brief Unit tests for the per-thread trace rings and their export
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/tracing.h>
+
+#include <thread>
+
+using namespace mega;
+
+TEST(TraceRing, KeepsTheLastEvents)
+{
+    TraceRing ring(4, 1);
+    for (uint64_t i = 0; i < 10; ++i)
+    {
+        ring.push("test", "event", i, 1);
+    }
+
+    auto events = ring.events();
+    ASSERT_EQ(events.size(), 4u);
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        EXPECT_EQ(events[i].start, 6 + i);
+    }
+
+    ring.clear();
+    EXPECT_TRUE(ring.events().empty());
+
+    ring.push("test", "event", 10, 1);
+    ASSERT_EQ(ring.events().size(), 1u);
+    EXPECT_EQ(ring.events()[0].start, 10u);
+}
+
+TEST(TraceRing, CopiedWhileWritten)
+{
+    TraceRing ring(64, 1);
+    std::atomic<bool> stop{false};
+
+    // duration is start, so a slot holding parts of two events shows
+    std::thread writer([&]()
+    {
+        for (uint64_t i = 0; !stop; ++i)
+        {
+            ring.push("test", "event", i, i);
+        }
+    });
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        auto events = ring.events();
+        EXPECT_LE(events.size(), 64u);
+        for (size_t j = 0; j < events.size(); ++j)
+        {
+            ASSERT_EQ(events[j].start, events[j].duration);
+            if (j)
+            {
+                ASSERT_EQ(events[j].start, events[j - 1].start + 1);
+            }
+        }
+    }
+
+    stop = true;
+    writer.join();
+}
+
+TEST(Tracer, ExportsEnabledScopes)
+{
+    auto& tracer = Tracer::instance();
+    tracer.clear();
+
+    {
+        MEGA_TRACE_SCOPE("test", "disabledScope");
+    }
+
+    tracer.setEnabled(true);
+    std::thread worker([]()
+    {
+        Tracer::instance().setThreadName("worker");
+        MEGA_TRACE_SCOPE("test", "workerScope");
+    });
+    worker.join();
+    {
+        MEGA_TRACE_SCOPE("test", "\"quoted\"");
+    }
+    tracer.setEnabled(false);
+
+    string json = tracer.exportChromeJson();
+    EXPECT_EQ(json.find("disabledScope"), string::npos);
+    EXPECT_NE(json.find("{\"name\":\"thread_name\",\"ph\":\"M\""), string::npos);
+    EXPECT_NE(json.find("\"args\":{\"name\":\"worker\"}"), string::npos);
+    EXPECT_NE(json.find("{\"name\":\"workerScope\",\"cat\":\"test\",\"ph\":\"X\",\"ts\":"), string::npos);
+    EXPECT_NE(json.find("\"\\\"quoted\\\"\""), string::npos);
+    EXPECT_EQ(json.compare(0, 15, "{\"displayTimeUn"), 0);
+
+    tracer.clear();
+    EXPECT_EQ(tracer.exportChromeJson().find("Scope"), string::npos);
+}
@@ -87,3 +87,55 @@ TEST(Transfer, serialize_unserialize)
 }
 
 
+
+TEST(Transfer, StreamingCacheFillsAlignedBlocksAndEvictsLeastRecent)
+{
+    using ::mega::byte;
+    using mega::StreamingCache;
+
+    const m_off_t block = StreamingCache::BLOCKSIZE;
+    const m_off_t fileSize = 2 * block + 100;
+    std::string content(static_cast<size_t>(fileSize), '\0');
+    for (size_t i = 0; i < content.size(); ++i)
+    {
+        content[i] = static_cast<char>(i * 7);
+    }
+    auto data = [&content](m_off_t pos) { return reinterpret_cast<const byte*>(content.data() + pos); };
+
+    StreamingCache cache;
+    StreamingCache::Partial partial;
+
+    // disabled by default
+    cache.fill(1, 2, fileSize, 0, data(0), static_cast<size_t>(block), partial);
+    ASSERT_EQ(cache.find(1, 2, 0), nullptr);
+
+    cache.setLimit(static_cast<size_t>(4 * block));
+
+    // a read starting mid-block only caches from the next boundary, in pieces at any offsets
+    m_off_t pos = 10;
+    for (m_off_t piece : {block - 10 + 5, block - 5, m_off_t(100)})
+    {
+        cache.fill(1, 2, fileSize, pos, data(pos), static_cast<size_t>(piece), partial);
+        pos += piece;
+    }
+    ASSERT_EQ(pos, fileSize);
+
+    ASSERT_EQ(cache.find(1, 2, 5), nullptr);
+    const std::string* second = cache.find(1, 2, block + 1);
+    ASSERT_NE(second, nullptr);
+    ASSERT_EQ(*second, content.substr(static_cast<size_t>(block), static_cast<size_t>(block)));
+    const std::string* last = cache.find(1, 2, 2 * block);
+    ASSERT_NE(last, nullptr);
+    ASSERT_EQ(*last, content.substr(static_cast<size_t>(2 * block)));
+
+    // same handle with another key is a different file
+    ASSERT_EQ(cache.find(1, 3, block), nullptr);
+
+    // the least recently used block goes first
+    cache.setLimit(static_cast<size_t>(block));
+    ASSERT_NE(cache.find(1, 2, 2 * block), nullptr);
+    ASSERT_EQ(cache.find(1, 2, block), nullptr);
+
+    cache.setLimit(0);
+    ASSERT_EQ(cache.size(), 0u);
+}
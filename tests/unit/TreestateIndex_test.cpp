@@ -0,0 +1,187 @@
+/**
+ * @file TreestateIndex_test.cpp
+ * @brief Unit tests for the index of the syncs' treestates
+ *
+ * (c) 2013-2024 by Mega Limited, Auckland, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/treestateindex.h>
+
+#include <thread>
+
+using namespace mega;
+
+namespace
+{
+
+LocalPath pathOf(const string& utf8)
+{
+#ifdef _WIN32
+    return LocalPath::fromAbsolutePath("C:\\sync\\" + utf8);
+#else
+    return LocalPath::fromAbsolutePath("/sync/" + utf8);
+#endif
+}
+
+LocalPath childOf(LocalPath path, const string& name)
+{
+    path.appendWithSeparator(LocalPath::fromRelativePath(name), true);
+    return path;
+}
+
+} // namespace
+
+TEST(TreestateIndex, SetLookupErase)
+{
+    TreestateIndex index;
+    treestate_t ts = TREESTATE_NONE;
+    nodetype_t type = TYPE_UNKNOWN;
+
+    EXPECT_FALSE(index.lookup(pathOf("a"), ts, type));
+
+    index.set(pathOf("a"), TREESTATE_SYNCING, FOLDERNODE);
+    index.set(pathOf("a/b"), TREESTATE_PENDING, FILENODE);
+    EXPECT_EQ(index.size(), 2u);
+
+    ASSERT_TRUE(index.lookup(pathOf("a"), ts, type));
+    EXPECT_EQ(ts, TREESTATE_SYNCING);
+    EXPECT_EQ(type, FOLDERNODE);
+
+    index.set(pathOf("a/b"), TREESTATE_SYNCED, FILENODE);
+    EXPECT_EQ(index.size(), 2u);
+    ASSERT_TRUE(index.lookup(pathOf("a/b"), ts, type));
+    EXPECT_EQ(ts, TREESTATE_SYNCED);
+    EXPECT_EQ(type, FILENODE);
+
+    index.set(pathOf("a/b"), TREESTATE_NONE, FILENODE);
+    EXPECT_FALSE(index.lookup(pathOf("a/b"), ts, type));
+    EXPECT_EQ(index.size(), 1u);
+
+    index.erase(pathOf("a/b"));
+    index.erase(pathOf("a"));
+    EXPECT_FALSE(index.lookup(pathOf("a"), ts, type));
+    EXPECT_EQ(index.size(), 0u);
+}
+
+TEST(TreestateIndex, ManyPaths)
+{
+    TreestateIndex index;
+    const int n = 20000;
+
+    for (int i = 0; i < n; ++i)
+    {
+        index.set(pathOf(std::to_string(i)), i % 2 ? TREESTATE_SYNCED : TREESTATE_PENDING, FILENODE);
+    }
+    EXPECT_EQ(index.size(), static_cast<size_t>(n));
+
+    for (int i = 0; i < n; i += 2)
+    {
+        index.erase(pathOf(std::to_string(i)));
+    }
+    EXPECT_EQ(index.size(), static_cast<size_t>(n / 2));
+
+    for (int i = 0; i < n; ++i)
+    {
+        treestate_t ts;
+        nodetype_t type;
+        bool found = index.lookup(pathOf(std::to_string(i)), ts, type);
+        ASSERT_EQ(found, i % 2 == 1) << i;
+        if (found)
+        {
+            EXPECT_EQ(ts, TREESTATE_SYNCED);
+        }
+    }
+
+    index.clear();
+    EXPECT_EQ(index.size(), 0u);
+}
+
+TEST(TreestateIndex, EraseBelow)
+{
+    TreestateIndex index;
+    auto root = pathOf("root");
+    auto sibling = pathOf("rootsibling");
+
+    index.set(root, TREESTATE_SYNCED, FOLDERNODE);
+    index.set(childOf(root, "f"), TREESTATE_SYNCED, FILENODE);
+    index.set(childOf(childOf(root, "d"), "g"), TREESTATE_SYNCED, FILENODE);
+    index.set(sibling, TREESTATE_SYNCED, FOLDERNODE);
+
+    index.eraseBelow(root);
+
+    treestate_t ts;
+    nodetype_t type;
+    EXPECT_FALSE(index.lookup(root, ts, type));
+    EXPECT_FALSE(index.lookup(childOf(root, "f"), ts, type));
+    EXPECT_TRUE(index.lookup(sibling, ts, type));
+    EXPECT_EQ(index.size(), 1u);
+}
+
+TEST(TreestateIndex, LookupWhileUpdated)
+{
+    TreestateIndex index;
+    const int n = 512;
+
+    vector<LocalPath> paths;
+    for (int i = 0; i < n; ++i)
+    {
+        paths.push_back(pathOf(std::to_string(i)));
+    }
+
+    // the odd paths stay put while the even ones come and go
+    for (int i = 1; i < n; i += 2)
+    {
+        index.set(paths[i], TREESTATE_SYNCED, FILENODE);
+    }
+
+    std::atomic<bool> stop{false};
+    std::thread writer([&]()
+    {
+        for (int round = 0; !stop; ++round)
+        {
+            for (int i = 0; i < n; i += 2)
+            {
+                if (round % 2) index.erase(paths[i]);
+                else index.set(paths[i], TREESTATE_SYNCING, FILENODE);
+            }
+        }
+    });
+
+    for (int round = 0; round < 200; ++round)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            treestate_t ts;
+            nodetype_t type;
+            bool found = index.lookup(paths[i], ts, type);
+            if (i % 2)
+            {
+                ASSERT_TRUE(found);
+                ASSERT_EQ(ts, TREESTATE_SYNCED);
+            }
+            else if (found)
+            {
+                ASSERT_EQ(ts, TREESTATE_SYNCING);
+            }
+        }
+    }
+
+    stop = true;
+    writer.join();
+}
@@ -18,20 +18,51 @@
 
 #include <gtest/gtest.h>
 
-namespace mega
+#include <mega/hashcash.h>
+
+#include <future>
+
+namespace
 {
-std::string gencash(const std::string& token, uint8_t easiness);
+const std::vector<std::tuple<std::string, uint8_t, std::string>> hashcash{
+    {"wFqIT_wY3tYKcrm5zqwaUoWym3ZCz32cCsrJOgYBgihtpaWUhGyWJ--EY-zfwI-i", 180, "owAAAA"},
+    {"3NIjq_fgu6bTyepwHuKiaB8a1YRjISBhktWK1fjhRx86RhOqKZNAcOZht0wJvmhQ", 180, "AQAAAA"},
+};
 }
 
 TEST(hashcash, gencash)
 {
-    std::vector<std::tuple<std::string, uint8_t, std::string>> hashcash{
-        {"wFqIT_wY3tYKcrm5zqwaUoWym3ZCz32cCsrJOgYBgihtpaWUhGyWJ--EY-zfwI-i", 180, "owAAAA"},
-        {"3NIjq_fgu6bTyepwHuKiaB8a1YRjISBhktWK1fjhRx86RhOqKZNAcOZht0wJvmhQ", 180, "AQAAAA"},
-    };
-
     for (const auto& t : hashcash)
     {
         ASSERT_EQ(::mega::gencash(std::get<0>(t), std::get<1>(t)), std::get<2>(t));
     }
 }
+
+TEST(hashcash, SameSolutionOnAnyThreadCount)
+{
+    for (unsigned threads : {1u, 3u, 8u})
+    {
+        for (const auto& t : hashcash)
+        {
+            std::promise<void> notified;
+            ::mega::HashcashSolver solver(std::get<0>(t), std::get<1>(t), [&]() { notified.set_value(); }, threads);
+            notified.get_future().wait();
+
+            ASSERT_TRUE(solver.done());
+            ASSERT_EQ(solver.prefix(), std::get<2>(t)) << threads << " threads";
+            ASSERT_EQ(solver.threadCount(), threads);
+            ASSERT_GE(solver.attempts(), 1u);
+        }
+    }
+}
+
+TEST(hashcash, Cancel)
+{
+    // the hardest challenge, not solved any time soon
+    ::mega::HashcashSolver solver(std::get<0>(hashcash[0]), 0, nullptr, 2);
+    solver.cancel();
+    solver.wait();
+
+    ASSERT_TRUE(solver.done());
+    ASSERT_TRUE(solver.prefix().empty());
+}
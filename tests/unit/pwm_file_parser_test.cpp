@@ -198,3 +198,32 @@ test2.com,https://test2.com/,test,hello.1234,
     ASSERT_EQ(resultsDirect.mErrCode, resultsRead.mErrCode);
     ASSERT_EQ(resultsDirect.mResults.size(), resultsRead.mResults.size());
 }
+
+TEST(PWMImportGooglePasswordCSVFile, StreamedEntries)
+{
+    const std::string fname = "test.csv";
+
+    constexpr std::string_view fileContents{R"(name,url,username,password,note
+foo.com,https://foo.com/,tx,hello.1234,
+hello.co,https://hello.co/,hello
+test.com,https://test.com/,test3,"hello.12,34",
+)"};
+    sdk_test::LocalTempFile f{fname, fileContents};
+    std::vector<PassEntryParseResult> streamed;
+    auto results = readPasswordImportFile(fname,
+                                          FileSource::GOOGLE_PASSWORD,
+                                          [&streamed](PassEntryParseResult&& entry)
+                                          {
+                                              streamed.emplace_back(std::move(entry));
+                                          });
+    EXPECT_EQ(results.mErrCode, PassFileParseResult::ErrCode::OK);
+    EXPECT_TRUE(results.mResults.empty());
+    ASSERT_EQ(streamed.size(), 3);
+    EXPECT_EQ(streamed[0].mName, "foo.com");
+    EXPECT_EQ(streamed[1].mErrCode, PassEntryParseResult::ErrCode::INVALID_NUM_OF_COLUMN);
+    EXPECT_EQ(streamed[1].mOriginalContent, "hello.co,https://hello.co/,hello");
+    EXPECT_EQ(streamed[2].mPassword, "hello.12,34");
+
+    auto stored = parseGooglePasswordCSVFile(fname);
+    ASSERT_EQ(stored.mResults.size(), streamed.size());
+}
@@ -17,13 +17,16 @@
  */
 
 #include "megafs.h"
+#include "utils.h"
 
 #include <gtest/gtest.h>
 #include <mega/base64.h>
+#include <mega/command.h>
 #include <mega/db.h>
 #include <mega/db/sqlite.h>
 #include <mega/filesystem.h>
 #include <mega/json.h>
+#include <mega/megaapp.h>
 #include <mega/process.h>
 #include <mega/scoped_helpers.h>
 #include <mega/utils.h>
@@ -431,6 +434,42 @@ TEST_F(ComparatorTest, CompareLocalPathAgainstString)
     }
 }
 
+TEST_F(ComparatorTest, CompareIdenticalStrings)
+{
+    // Identical, and read the same way.
+    EXPECT_EQ(compareUtf(string("a%30b"), true, string("a%30b"), true, false), 0);
+    EXPECT_EQ(compareUtf(string("a%30b"), false, string("a%30b"), false, true), 0);
+    EXPECT_EQ(compareUtf(fromRelPath("a%30b"), true, fromRelPath("a%30b"), true, false), 0);
+
+    // Identical, but only one side's escapes are decoded.
+    EXPECT_NE(compareUtf(string("a%30b"), true, string("a%30b"), false, false), 0);
+    EXPECT_NE(compareUtf(fromRelPath("a%30b"), false, fromRelPath("a%30b"), true, true), 0);
+}
+
+TEST(Utils, ToUpperUtf8)
+{
+    EXPECT_EQ(Utils::toUpperUtf8("abc-XYZ_09"), "ABC-XYZ_09");
+    EXPECT_EQ(Utils::toUpperUtf8("\xc3\xa1" "b" "\xc3\xa9"), "\xc3\x81" "B" "\xc3\x89");
+    EXPECT_EQ(Utils::toUpper('q'), 'Q');
+    EXPECT_EQ(Utils::toUpper(0xe1), 0xc1);
+    EXPECT_EQ(Utils::toLowerUtf8("ABC-xyz_09"), "abc-xyz_09");
+}
+
+TEST(Utils, IsAscii)
+{
+    // long enough for the word-at-a-time loops, with a non-ASCII byte at each position
+    string text(77, 'a');
+    EXPECT_TRUE(Utils::isAscii(text));
+    EXPECT_TRUE(Utils::isAscii(""));
+
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        string other = text;
+        other[i] = '\xc3';
+        EXPECT_FALSE(Utils::isAscii(other)) << i;
+    }
+}
+
 TEST(Conversion, HexVal)
 {
     // Decimal [0-9]
@@ -807,6 +846,406 @@ TEST(JSONWriter, escape)
     EXPECT_EQ(writer.escape(input.c_str(), input.size()), expected);
 }
 
+TEST(JSONWriter, arg_stringView)
+{
+    JSONWriter writer;
+    std::string value = "value,ignored";
+    writer.arg("k", std::string_view(value).substr(0, 5));
+    writer.arg("n", std::string_view("1"), 0);
+    writer.arg_stringWithEscapes("e", std::string_view("\"\\x").substr(0, 2));
+    EXPECT_EQ(writer.getstring(), "\"k\":\"value\",\"n\":1,\"e\":\"\\\"\\\\\"");
+}
+
+TEST(JSONWriter, reusesBuffers)
+{
+    size_t capacity = 0;
+    {
+        JSONWriter writer;
+        writer.arg("k", std::string(1000, 'x'));
+        capacity = writer.getstring().capacity();
+    }
+
+    // the next writer in this thread gets the buffer back, empty
+    JSONWriter writer;
+    EXPECT_TRUE(writer.getstring().empty());
+    EXPECT_EQ(writer.getstring().capacity(), capacity);
+
+    // and a copy doesn't share it
+    writer.arg("k", "v");
+    JSONWriter copy(writer);
+    EXPECT_EQ(copy.getstring(), writer.getstring());
+    EXPECT_NE(copy.getstring().data(), writer.getstring().data());
+}
+
+TEST(HttpReq, segmentedResponseIsJoined)
+{
+    HttpReq req;
+    req.mSegmented = true;
+    req.contentlength = -1;
+
+    // more than a segment, put in pieces that straddle their boundaries
+    string expected;
+    string piece(HttpReq::SEGMENT_SIZE / 3 + 7, 'x');
+    for (char c = 'a'; expected.size() <= HttpReq::SEGMENT_SIZE; ++c)
+    {
+        std::fill(piece.begin(), piece.end(), c);
+        req.put(piece.data(), static_cast<unsigned>(piece.size()));
+        expected.append(piece);
+    }
+
+    ASSERT_TRUE(req.in.empty());
+    ASSERT_EQ(req.mSegments.size(), 2u);
+    ASSERT_EQ(req.transferred(nullptr), static_cast<m_off_t>(expected.size()));
+
+    req.joinSegments();
+    ASSERT_TRUE(req.mSegments.empty());
+    ASSERT_EQ(req.in, expected);
+
+    // responses of known size go straight to 'in'
+    req.init();
+    req.setcontentlength(3);
+    req.put(piece.data(), 3);
+    ASSERT_TRUE(req.mSegments.empty());
+    ASSERT_EQ(req.in, piece.substr(0, 3));
+}
+
+TEST(HttpReq, downloadBufferIsAligned)
+{
+    HttpReqDL req;
+    req.prepare(nullptr, nullptr, 0, 0, 1000);
+    ASSERT_NE(req.buf, nullptr);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(req.buf) % HttpReq::http_buf_t::ALIGNMENT, 0u);
+
+    std::unique_ptr<HttpReq::http_buf_t> released(req.release_buf());
+    ASSERT_EQ(req.buf, nullptr);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(released->datastart()) % HttpReq::http_buf_t::ALIGNMENT, 0u);
+}
+
+TEST(TransferBufferPool, reusesFreedBuffers)
+{
+    auto& pool = TransferBufferPool::instance();
+    size_t inUse = pool.inUseBytes();
+
+    ::mega::byte* a = pool.allocate(100000);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(a) % TransferBufferPool::HEADER, 0u);
+    ASSERT_GE(pool.inUseBytes() - inUse, 100000u);
+    pool.deallocate(a);
+    ASSERT_EQ(pool.inUseBytes(), inUse);
+
+    // same size class, so the cached buffer comes back
+    ::mega::byte* b = pool.allocate(99000);
+    ASSERT_EQ(a, b);
+    pool.deallocate(b);
+
+    // nothing is kept beyond the limit
+    pool.setMaxCachedBytes(0);
+    ASSERT_EQ(pool.cachedBytes(), 0u);
+    ::mega::byte* c = pool.allocate(3 * 1024 * 1024);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(c - TransferBufferPool::HEADER) % TransferBufferPool::HUGEPAGE_SIZE, 0u);
+    pool.deallocate(c);
+    ASSERT_EQ(pool.cachedBytes(), 0u);
+    ASSERT_EQ(pool.inUseBytes(), inUse);
+
+    pool.setMaxCachedBytes(TransferBufferPool::DEFAULT_MAX_CACHED_BYTES);
+}
+
+TEST(TokenBucket, pacesToTheRate)
+{
+    using namespace std::chrono;
+    TokenBucket::clock::time_point t0 = TokenBucket::clock::now();
+
+    TokenBucket bucket;
+    ASSERT_EQ(bucket.available(t0), std::numeric_limits<m_off_t>::max());
+
+    // starts with a full second of traffic, and can go into debt
+    bucket.setRate(1000, t0);
+    ASSERT_EQ(bucket.available(t0), 1000);
+    bucket.consume(1500);
+    ASSERT_EQ(bucket.available(t0), 0);
+    ASSERT_EQ(bucket.available(t0 + milliseconds(500)), 0);
+    ASSERT_EQ(bucket.available(t0 + milliseconds(1000)), 500);
+
+    // the burst never exceeds one second
+    ASSERT_EQ(bucket.available(t0 + seconds(10)), 1000);
+
+    // changing the rate keeps the tokens, capped to the new burst
+    bucket.setRate(100, t0 + seconds(10));
+    ASSERT_EQ(bucket.available(t0 + seconds(10)), 100);
+    bucket.setRate(0, t0 + seconds(10));
+    ASSERT_EQ(bucket.available(t0 + seconds(10)), std::numeric_limits<m_off_t>::max());
+}
+
+TEST(CommandBatchSizer, followsBatchTimes)
+{
+    using std::chrono::milliseconds;
+
+    CommandBatchSizer sizer;
+    ASSERT_EQ(sizer.limit(), CommandBatchSizer::MAX_COMMANDS);
+
+    // fast commands never reach the target time
+    for (int i = 0; i < 20; ++i)
+    {
+        sizer.completed(1, milliseconds(200));
+        sizer.completed(1000, milliseconds(250));
+    }
+    ASSERT_EQ(sizer.limit(), CommandBatchSizer::MAX_COMMANDS);
+
+    // 10 ms per command: (2000 - 200) / 10
+    for (int i = 0; i < 50; ++i)
+    {
+        sizer.completed(1000, milliseconds(10200));
+    }
+    ASSERT_NEAR(static_cast<double>(sizer.limit()), 180.0, 5.0);
+
+    // never below the minimum, even if a round trip takes longer than the target
+    for (int i = 0; i < 50; ++i)
+    {
+        sizer.completed(1, milliseconds(5000));
+    }
+    ASSERT_EQ(sizer.limit(), CommandBatchSizer::MIN_COMMANDS);
+}
+
+TEST(RequestDispatcher, bulkCommandsWaitForTheOthers)
+{
+    struct TestCommand : public Command
+    {
+        TestCommand(const char* name, bool bulk)
+        {
+            cmd(name);
+            mBulk = bulk;
+        }
+
+        bool procresult(Result, JSON&) override { return true; }
+    };
+
+    MegaApp app;
+    auto client = mt::makeClient(app);
+    RequestDispatcher reqs(client->rng);
+    reqs.add(new TestCommand("bulk", true));
+    reqs.add(new TestCommand("first", false));
+    reqs.add(new TestCommand("second", false));
+    ASSERT_TRUE(reqs.readyToSend());
+
+    bool fetchingNodes = false;
+    bool v3 = false;
+    string idempotenceId;
+    string json = reqs.serverrequest(fetchingNodes, v3, client.get(), idempotenceId);
+    ASSERT_EQ(json, "[{\"a\":\"first\"},{\"a\":\"second\"}]");
+    ASSERT_FALSE(reqs.readyToSend());
+
+    // sent once the batch in flight is done
+    reqs.servererror("-1", client.get());
+    ASSERT_TRUE(reqs.readyToSend());
+    json = reqs.serverrequest(fetchingNodes, v3, client.get(), idempotenceId);
+    ASSERT_EQ(json, "[{\"a\":\"bulk\"}]");
+}
+
+TEST(RequestDispatcher, independentCommandsUseTheSecondaryChannel)
+{
+    struct TestCommand : public Command
+    {
+        TestCommand(const char* name, bool independent)
+        {
+            cmd(name);
+            mIndependent = independent;
+        }
+
+        bool procresult(Result, JSON&) override { return true; }
+    };
+
+    MegaApp app;
+    auto client = mt::makeClient(app);
+    RequestDispatcher reqs(client->rng);
+    reqs.add(new TestCommand("before", true));
+    ASSERT_EQ(reqs.secondaryChannel(), nullptr);
+
+    reqs.setSecondaryChannel(true, client->rng);
+    reqs.add(new TestCommand("independent", true));
+    reqs.add(new TestCommand("other", false));
+
+    bool fetchingNodes = false;
+    bool v3 = false;
+    string idempotenceId;
+    string json = reqs.serverrequest(fetchingNodes, v3, client.get(), idempotenceId);
+    ASSERT_EQ(json, "[{\"a\":\"before\"},{\"a\":\"other\"}]");
+
+    // not held back by the batch in flight
+    RequestDispatcher* secondary = reqs.secondaryChannel();
+    ASSERT_NE(secondary, nullptr);
+    ASSERT_TRUE(secondary->readyToSend());
+    string secondaryIdempotenceId;
+    json = secondary->serverrequest(fetchingNodes, v3, client.get(), secondaryIdempotenceId);
+    ASSERT_EQ(json, "[{\"a\":\"independent\"}]");
+    ASSERT_NE(idempotenceId, secondaryIdempotenceId);
+
+    // disabling it leaves the queued commands there
+    reqs.setSecondaryChannel(false, client->rng);
+    reqs.add(new TestCommand("after", true));
+    ASSERT_FALSE(secondary->readyToSend());
+    ASSERT_TRUE(secondary->cmdsInflight());
+
+    reqs.servererror("-1", client.get());
+    json = reqs.serverrequest(fetchingNodes, v3, client.get(), idempotenceId);
+    ASSERT_EQ(json, "[{\"a\":\"after\"}]");
+}
+
+TEST(RequestDispatcher, streamingCommandIsProcessedInChunks)
+{
+    struct SessionsApp : public MegaApp
+    {
+        size_t mSessions = 0;
+        int mCalls = 0;
+
+        void account_details(AccountDetails* details, bool, bool, bool, bool, bool, bool) override
+        {
+            mSessions = details->sessions.size();
+            ++mCalls;
+        }
+    };
+
+    SessionsApp app;
+    auto client = mt::makeClient(app);
+    auto details = std::make_shared<AccountDetails>();
+    RequestDispatcher reqs(client->rng);
+    reqs.add(new CommandGetUserSessions(client.get(), details));
+
+    bool fetchingNodes = false;
+    bool v3 = false;
+    string idempotenceId;
+    reqs.serverrequest(fetchingNodes, v3, client.get(), idempotenceId);
+    ASSERT_FALSE(fetchingNodes);
+    ASSERT_TRUE(reqs.inflightStreaming());
+
+    // the first session is complete, the second one isn't yet
+    string data = "[[[1,2,\"ua\",\"ip\",\"ES\",1,\"AAAAAAAAAAA\",1,\"dev\"],[3,4";
+    size_t consumed = reqs.serverChunk(data.c_str(), client.get());
+    ASSERT_EQ(details->sessions.size(), 1u);
+    ASSERT_EQ(details->sessions[0].useragent, "ua");
+    ASSERT_EQ(app.mCalls, 0);
+
+    data = data.substr(consumed) + ",\"ua2\",\"ip2\",\"FR\",0,\"AAAAAAAAAAA\",1,\"dev2\"]]]";
+    reqs.serverChunk(data.c_str(), client.get());
+    ASSERT_EQ(app.mCalls, 1);
+    ASSERT_EQ(app.mSessions, 2u);
+    ASSERT_EQ(details->sessions[1].deviceid, "dev2");
+    ASSERT_EQ(reqs.chunkedProgress(), 0u);
+}
+
+#ifndef _WIN32
+class PosixWaiterTest : public ::testing::Test
+{
+protected:
+    static constexpr int NUM_SOCKETS = 500;
+
+    void SetUp() override
+    {
+        // idle sockets, like the connections of many transfers waiting for data
+        for (auto& s : mSockets)
+        {
+            s = socket(AF_INET, SOCK_DGRAM, 0);
+            ASSERT_GE(s, 0);
+        }
+        ASSERT_EQ(pipe(mIgnored), 0);
+        ASSERT_EQ(pipe(mWatched), 0);
+    }
+
+    void TearDown() override
+    {
+        for (auto s : mSockets)
+        {
+            close(s);
+        }
+        for (auto fd : {mIgnored[0], mIgnored[1], mWatched[0], mWatched[1]})
+        {
+            close(fd);
+        }
+    }
+
+    // everything is waited for, and everything but mWatched is ignored
+    void prepare(PosixWaiter& waiter)
+    {
+        waiter.init(0);
+        for (auto fd : mSockets)
+        {
+            MEGA_FD_SET(fd, &waiter.rfds);
+            MEGA_FD_SET(fd, &waiter.ignorefds);
+            waiter.bumpmaxfd(fd);
+        }
+        MEGA_FD_SET(mIgnored[0], &waiter.rfds);
+        MEGA_FD_SET(mIgnored[0], &waiter.ignorefds);
+        waiter.bumpmaxfd(mIgnored[0]);
+        MEGA_FD_SET(mWatched[0], &waiter.rfds);
+        waiter.bumpmaxfd(mWatched[0]);
+    }
+
+    int mSockets[NUM_SOCKETS];
+    int mIgnored[2];
+    int mWatched[2];
+};
+
+TEST_F(PosixWaiterTest, onlyNonIgnoredFdsNeedExec)
+{
+    PosixWaiter waiter;
+    char c = 0;
+
+    ASSERT_EQ(write(mIgnored[1], &c, 1), 1);
+    prepare(waiter);
+    ASSERT_EQ(waiter.wait(), 0);
+
+    ASSERT_EQ(write(mWatched[1], &c, 1), 1);
+    prepare(waiter);
+    ASSERT_EQ(waiter.wait(), int(Waiter::NEEDEXEC));
+
+    ASSERT_EQ(read(mWatched[0], &c, 1), 1);
+    prepare(waiter);
+    ASSERT_EQ(waiter.wait(), 0);
+
+#ifdef USE_EPOLL
+    // a closed fd whose number is reused by another one is registered again
+    int watched = mWatched[0];
+    close(mWatched[0]);
+    close(mWatched[1]);
+    waiter.forgetfd(watched);
+
+    ASSERT_EQ(pipe(mWatched), 0);
+    if (mWatched[0] != watched)
+    {
+        ASSERT_EQ(dup2(mWatched[0], watched), watched);
+        close(mWatched[0]);
+        mWatched[0] = watched;
+    }
+    ASSERT_EQ(write(mWatched[1], &c, 1), 1);
+    prepare(waiter);
+    ASSERT_EQ(waiter.wait(), int(Waiter::NEEDEXEC));
+#endif
+}
+
+TEST_F(PosixWaiterTest, DISABLED_waitOverhead)
+{
+    PosixWaiter waiter;
+    char c = 0;
+    ASSERT_EQ(write(mIgnored[1], &c, 1), 1);
+
+    static constexpr int ROUNDS = 10000;
+    std::chrono::steady_clock::duration waiting{};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = ROUNDS; i--; )
+    {
+        prepare(waiter);
+        auto waitStart = std::chrono::steady_clock::now();
+        ASSERT_EQ(waiter.wait(), 0);
+        waiting += std::chrono::steady_clock::now() - waitStart;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    using std::chrono::duration_cast;
+    using std::chrono::nanoseconds;
+    std::cout << "With " << NUM_SOCKETS << " sockets, init + wait: "
+              << duration_cast<nanoseconds>(elapsed).count() / ROUNDS << " ns, wait: "
+              << duration_cast<nanoseconds>(waiting).count() / ROUNDS << " ns" << std::endl;
+}
+#endif // ! _WIN32
+
 TEST(JSON, stripWhitespace)
 {
     auto input = string(" a\rb\n c\r{\"a\":\"q\\r \\\" s\"\n} x y\n z\n");
@@ -910,6 +1349,33 @@ TEST(Utils, natural_sorting)
     ASSERT_GT(naturalsorting_compare("0124", "00123"), 0);
 }
 
+TEST(Utils, natural_sorting_key)
+{
+    const std::vector<std::string> names{"", "!", "#", "a ", "a!", "a#", "0", "00123", "123", "124",
+                                         "2", "10", "100", "a", "A", "a1", "a01b", "a1c", "a2", "a10",
+                                         "ab", "abc", "B", "b1", "file 9.txt", "file 10.txt",
+                                         "File 11.txt", "z\xc3\xa9"};
+
+    auto sign = [](int value)
+    {
+        return (value > 0) - (value < 0);
+    };
+
+    // the keys compare like the names do
+    for (const auto& i: names)
+    {
+        for (const auto& j: names)
+        {
+            ASSERT_EQ(sign(naturalsorting_key(i).compare(naturalsorting_key(j))),
+                      sign(naturalsorting_compare(i.c_str(), j.c_str())))
+                << "'" << i << "' vs '" << j << "'";
+        }
+    }
+
+    ASSERT_EQ(naturalsorting_key("A0"), "261" "10001" "0");
+    ASSERT_EQ(naturalsorting_key("007"), "10001" "7");
+}
+
 TEST(RemotePath, nextPathComponent)
 {
     // Absolute path.
@@ -1059,6 +1525,32 @@ TEST_F(TooLongNameTest, Copy)
     }
 }
 
+TEST_F(TooLongNameTest, HardLink)
+{
+    auto source = Append(mPrefixPath, "s");
+    auto target = AppendLongName(mPrefixPath, 'u');
+
+    ASSERT_TRUE(CreateDummyFile(source));
+
+    ASSERT_FALSE(mFsAccess.hardlinklocal(source, target));
+    ASSERT_TRUE(mFsAccess.target_name_too_long);
+
+    target = Append(mPrefixPath, "u");
+    target = Append(target, "v");
+
+    ASSERT_FALSE(mFsAccess.hardlinklocal(source, target));
+    ASSERT_FALSE(mFsAccess.target_name_too_long);
+
+    // The link shares the content of the source.
+    target = Append(mPrefixPath, "w");
+
+    ASSERT_TRUE(mFsAccess.hardlinklocal(source, target));
+
+    auto fileAccess = mFsAccess.newfileaccess(false);
+    ASSERT_TRUE(fileAccess->fopen(target, true, false, FSLogging::logOnError));
+    ASSERT_EQ(fileAccess->size, 1);
+}
+
 TEST_F(TooLongNameTest, CreateDirectory)
 {
     // Absolute
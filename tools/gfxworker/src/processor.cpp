@@ -10,6 +10,7 @@
 #include "mega/logging.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <iterator>
 #include <numeric>
@@ -53,7 +54,9 @@ GfxTaskResult GfxProcessor::process(const GfxTask& task)
 
     // generate thumbnails
     LOG_info << "generate for, " << path;
-    auto images = mGfxProvider->generateImages(path, sortedDimensions);
+    auto provider = acquireProvider();
+    auto images = provider->generateImages(path, sortedDimensions);
+    releaseProvider(std::move(provider));
 
     // assign back to original order
     for (decltype(images)::size_type i = 0; i < images.size(); ++i)
@@ -64,6 +67,29 @@ GfxTaskResult GfxProcessor::process(const GfxTask& task)
     return GfxTaskResult(std::move(outputImages), GfxTaskProcessStatus::SUCCESS);
 }
 
+std::unique_ptr<IGfxProvider> GfxProcessor::acquireProvider()
+{
+    {
+        std::lock_guard<std::mutex> g(mProvidersMutex);
+        if (!mIdleProviders.empty())
+        {
+            auto provider = std::move(mIdleProviders.back());
+            mIdleProviders.pop_back();
+            return provider;
+        }
+    }
+
+    auto provider = mGfxProvider->clone();
+    assert(provider);
+    return provider;
+}
+
+void GfxProcessor::releaseProvider(std::unique_ptr<IGfxProvider> provider)
+{
+    std::lock_guard<std::mutex> g(mProvidersMutex);
+    mIdleProviders.emplace_back(std::move(provider));
+}
+
 //
 // Put more probmatic format (likely crash) by freeimage here in extraFormatsByWorker
 // note order by length of ext. If we has this order: .tiff.tif, the match with .tif fails
@@ -85,6 +111,7 @@ std::string GfxProcessor::supportedvideoformats() const
 RequestProcessor::RequestProcessor(size_t threadCount,
                                    size_t maxQueueSize)
                                    : mGfxProcessor()
+                                   , mThreadCount(std::max<size_t>(threadCount, 1))
                                    , mThreadPool(threadCount, maxQueueSize)
 {
 }
@@ -139,6 +166,11 @@ bool RequestProcessor::process(std::unique_ptr<IEndpoint> endpoint)
                 processSupportFormats(sharedEndpoint.get());
                 break;
             }
+            case CommandType::NEW_GFX_BATCH:
+            {
+                processGfxBatch(sharedEndpoint, std::dynamic_pointer_cast<CommandNewGfxBatch>(command));
+                break;
+            }
             default:
                 break;
             }
@@ -181,6 +213,65 @@ void RequestProcessor::processGfx(IEndpoint* endpoint, CommandNewGfx* request)
     writer.writeCommand(&response, WRITE_TIMEOUT);
 }
 
+void RequestProcessor::processGfxBatch(std::shared_ptr<IEndpoint> endpoint,
+                                       std::shared_ptr<CommandNewGfxBatch> request)
+{
+    assert(endpoint);
+    assert(request);
+
+    struct Batch
+    {
+        std::shared_ptr<IEndpoint> endpoint;
+        std::shared_ptr<CommandNewGfxBatch> request;
+        std::atomic<size_t> next{0};
+
+        // responses are written one at a time
+        std::mutex writeMutex;
+    };
+
+    auto batch = std::make_shared<Batch>();
+    batch->endpoint = std::move(endpoint);
+    batch->request = std::move(request);
+
+    auto& tasks = batch->request->Tasks;
+    LOG_info << "gfx batch processing, " << tasks.size() << " tasks";
+
+    // takes the remaining tasks one by one, replying to each as soon as it's done
+    auto work = [this](const std::shared_ptr<Batch>& batch)
+    {
+        auto& tasks = batch->request->Tasks;
+        for (size_t i; (i = batch->next++) < tasks.size(); )
+        {
+            auto result = mGfxProcessor.process(tasks[i]);
+
+            CommandNewGfxBatchResponse response;
+            response.Index = static_cast<uint32_t>(i);
+            response.ErrorCode = static_cast<uint32_t>(result.ProcessStatus);
+            response.ErrorText = result.ProcessStatus == GfxTaskProcessStatus::SUCCESS ? "OK" : "ERROR";
+            response.Images = std::move(result.OutputImages);
+
+            LOG_info << "gfx batch result " << i << ", " << response.ErrorText;
+
+            std::lock_guard<std::mutex> g(batch->writeMutex);
+            ProtocolWriter writer{ batch->endpoint.get() };
+            writer.writeCommand(&response, WRITE_TIMEOUT);
+        }
+    };
+
+    // Idle threads in the pool help. This one works through the batch as well, so it
+    // completes even if they are all busy: a helper starting late finds nothing left.
+    auto helpers = std::min(tasks.size(), mThreadCount) - 1;
+    for (size_t i = 0; i < helpers; ++i)
+    {
+        if (!mThreadPool.push([work, batch]() { work(batch); }))
+        {
+            break;
+        }
+    }
+
+    work(batch);
+}
+
 void RequestProcessor::processSupportFormats(IEndpoint* endpoint)
 {
     assert(endpoint);
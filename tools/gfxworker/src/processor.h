@@ -8,6 +8,8 @@
 
 #include <chrono>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace mega {
 namespace gfx {
@@ -24,9 +26,19 @@ public:
     std::string supportedvideoformats() const;
 private:
 
+    // Tasks run concurrently on the thread pool and a provider keeps the bitmap it
+    // decodes, so each task takes a provider of its own and returns it when done
+    std::unique_ptr<::mega::IGfxProvider> acquireProvider();
+
+    void releaseProvider(std::unique_ptr<::mega::IGfxProvider> provider);
+
     mega::FSACCESS_CLASS mFaccess;
 
     std::unique_ptr<::mega::IGfxProvider> mGfxProvider;
+
+    std::mutex mProvidersMutex;
+
+    std::vector<std::unique_ptr<::mega::IGfxProvider>> mIdleProviders;
 };
 
 class RequestProcessor
@@ -45,10 +57,14 @@ private:
 
     void processGfx(IEndpoint* endpoint, CommandNewGfx* request);
 
+    void processGfxBatch(std::shared_ptr<IEndpoint> endpoint, std::shared_ptr<CommandNewGfxBatch> request);
+
     void processSupportFormats(IEndpoint* endpoint);
 
     GfxProcessor mGfxProcessor;
 
+    size_t mThreadCount;
+
     ThreadPool mThreadPool;
 
     static constexpr std::chrono::milliseconds READ_TIMEOUT{5000};
@@ -99,6 +99,70 @@ TEST_F(ServerClientTest, RunGfxTaskSuccessfully)
     }
 }
 
+TEST_F(ServerClientTest, RunGfxBatchSuccessfully)
+{
+    Server server(
+        std::make_unique<RequestProcessor>(),
+        mEndpointName
+    );
+
+    std::thread serverThread(std::ref(server));
+
+    auto dimensions = std::vector<GfxDimension> {
+        { 200, 0 },     // THUMBNAIL: square thumbnail, cropped from near center
+        { 1000, 1000 }  // PREVIEW: scaled version inside 1000x1000 bounding square
+    };
+
+    LocalPath pngImage = LocalPath::fromAbsolutePath(ExecutableDir::get());
+    pngImage.appendWithSeparator(LocalPath::fromRelativePath("logo.png"), false);
+
+    // the same png a few times and one that doesn't exist
+    std::vector<mega::gfx::GfxTask> tasks(4);
+    for (auto& task : tasks)
+    {
+        task.Path = pngImage.platformEncoded();
+        task.Dimensions = dimensions;
+    }
+    LocalPath missingImage = LocalPath::fromAbsolutePath(ExecutableDir::get());
+    missingImage.appendWithSeparator(LocalPath::fromRelativePath("missing.png"), false);
+    tasks.back().Path = missingImage.platformEncoded();
+
+    std::vector<std::vector<std::string>> results(tasks.size());
+    std::vector<int> reported(tasks.size());
+    EXPECT_TRUE(
+        GfxClient(
+            std::make_unique<GfxCommunicationsClient>(mEndpointName)
+        ).runGfxBatch(tasks, [&](size_t index, std::vector<std::string>&& images) {
+            ++reported[index];
+            results[index] = std::move(images);
+        })
+    );
+
+    EXPECT_EQ(reported, std::vector<int>(tasks.size(), 1));
+    for (size_t i = 0; i + 1 < tasks.size(); ++i)
+    {
+        ASSERT_EQ(results[i].size(), 2);
+        EXPECT_GT(results[i][0].size(), 4500);
+        EXPECT_GT(results[i][1].size(), 800);
+    }
+    for (auto& image : results.back())
+    {
+        EXPECT_TRUE(image.empty());
+    }
+
+    // shutdown
+    EXPECT_TRUE(
+        GfxClient(
+            std::make_unique<GfxCommunicationsClient>(mEndpointName)
+        ).runShutDown()
+    );
+
+    if (serverThread.joinable())
+    {
+        serverThread.join();
+    }
+}
+
 TEST_F(ServerClientTest, RunHelloRequestResponseSuccessfully)
 {
     Server server(